@@ -41,9 +41,14 @@
 AccelerometerAdaptor::AccelerometerAdaptor(const QString& id) :
     InputDevAdaptor(id, 1)
 {
-    accelerometerBuffer_ = new DeviceAdaptorRingBuffer<OrientationData>(1);
+    accelerometerBuffer_ = new DeviceAdaptorRingBuffer<OrientationData>(ringSize("accelerometer", 1));
     setAdaptedSensor("accelerometer", "Internal accelerometer coordinates", accelerometerBuffer_);
     setDescription("Input device accelerometer adaptor (lis302d)");
+
+    setEventHandling(EventIgnored);
+    setEventHandling(EV_ABS, ABS_X, EventTracked);
+    setEventHandling(EV_ABS, ABS_Y, EventTracked);
+    setEventHandling(EV_ABS, ABS_Z, EventTracked);
 }
 
 AccelerometerAdaptor::~AccelerometerAdaptor()
@@ -51,30 +56,13 @@ AccelerometerAdaptor::~AccelerometerAdaptor()
     delete accelerometerBuffer_;
 }
 
-void AccelerometerAdaptor::interpretEvent(int src, struct input_event *ev)
+void AccelerometerAdaptor::interpretFrame(int src, const InputFrame& frame, struct input_event *ev)
 {
     Q_UNUSED(src);
 
-    switch (ev->type) {
-        case EV_ABS:
-            switch (ev->code) {
-                case ABS_X:
-                    orientationValue_.x_ = ev->value;
-                    break;
-                case ABS_Y:
-                    orientationValue_.y_ = ev->value;
-                    break;
-                case ABS_Z:
-                    orientationValue_.z_ = ev->value;
-                    break;
-            }
-            break;
-    }
-}
-
-void AccelerometerAdaptor::interpretSync(int src, struct input_event *ev)
-{
-    Q_UNUSED(src);
+    orientationValue_.x_ = frame.absValue(ABS_X);
+    orientationValue_.y_ = frame.absValue(ABS_Y);
+    orientationValue_.z_ = frame.absValue(ABS_Z);
     commitOutput(ev);
 }
 
@@ -95,25 +83,6 @@ void AccelerometerAdaptor::commitOutput(struct input_event *ev)
 
 unsigned int AccelerometerAdaptor::evaluateIntervalRequests(int& sessionId) const
 {
-    if (m_intervalMap.size() == 0)
-    {
-        sessionId = -1;
-        return defaultInterval();
-    }
-
     // Get the smallest positive request, 0 is reserved for HW wakeup
-    QMap<int, unsigned int>::const_iterator it = m_intervalMap.constBegin();
-    unsigned int highestValue = it.value();
-    int winningSessionId = it.key();
-
-    for (++it; it != m_intervalMap.constEnd(); ++it)
-    {
-        if (((it.value() < highestValue) && (it.value() > 0)) || highestValue == 0) {
-            highestValue = it.value();
-            winningSessionId = it.key();
-        }
-    }
-
-    sessionId = winningSessionId;
-    return highestValue > 0 ? highestValue : defaultInterval();
+    return lowestIntervalRequest(sessionId, true);
 }
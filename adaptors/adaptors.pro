@@ -25,6 +25,8 @@ SUBDIRS += oemtabletaccelerometer
 SUDBIRS += oemtabletgyroscopeadaptor
 SUBDIRS += steaccelerometeradaptor
 SUBDIRS += mpu6050accelerometer
+SUBDIRS += loadgenadaptor
+SUBDIRS += replayadaptor
 
 contains(CONFIG,hybris) {
     SUBDIRS = hybrisaccelerometer
@@ -33,6 +35,7 @@ contains(CONFIG,hybris) {
     SUBDIRS += hybrismagnetometeradaptor
     SUBDIRS += hybrisproximityadaptor
     SUBDIRS += hybrisorientationadaptor
+    SUBDIRS += hybrisrotationvectoradaptor
 }
 
 
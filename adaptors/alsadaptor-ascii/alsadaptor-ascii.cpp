@@ -36,6 +36,7 @@
 #include <QFile>
 
 #include "logging.h"
+#include "tracelog.h"
 #include "config.h"
 #include "alsadaptor-ascii.h"
 #include "datatypes/utils.h"
@@ -47,7 +48,8 @@
 ALSAdaptorAscii::ALSAdaptorAscii(const QString& id) : SysfsAdaptor(id, SysfsAdaptor::IntervalMode)
 {
     memset(buf, 0x0, 16);
-    alsBuffer_ = new DeviceAdaptorRingBuffer<TimedUnsigned>(1);
+    setPayloadFormat(1);
+    alsBuffer_ = new DeviceAdaptorRingBuffer<TimedUnsigned>(ringSize("als", 1));
     setAdaptedSensor("als", "Internal ambient light sensor lux values", alsBuffer_);
     setDescription("Ambient light");
 
@@ -75,23 +77,18 @@ ALSAdaptorAscii::~ALSAdaptorAscii()
     delete alsBuffer_;
 }
 
-void ALSAdaptorAscii::processSample(int pathId, int fd) {
+void ALSAdaptorAscii::processValues(int pathId, const long* values, int count) {
     Q_UNUSED(pathId);
+    Q_UNUSED(count);
 
-    if (read(fd, buf, sizeof(buf)) <= 0) {
-        sensordLogW() << "read():" << strerror(errno);
-        return;
-    }
-    buf[sizeof(buf)-1] = '\0';
-
-    sensordLogT() << "Ambient light value: " << buf;
+    sensordTraceRate(SENSORD_TRACE_RATE) << "Ambient light value: " << values[0];
 
-    __u16 idata = atoi(buf);
+    __u16 idata = values[0];
 
     TimedUnsigned* lux = alsBuffer_->nextSlot();
 
     lux->value_ = idata;
-    lux->timestamp_ = Utils::getTimeStamp();
+    lux->timestamp_ = sampleTimestamp();
 
     alsBuffer_->commit();
     alsBuffer_->wakeUpReaders();
@@ -100,7 +97,7 @@ void ALSAdaptorAscii::processSample(int pathId, int fd) {
 bool ALSAdaptorAscii::startSensor()
 {
     if(!powerStatePath.isEmpty()) {
-        writeToFile(powerStatePath, powerMode);
+        writeControl(powerStatePath, powerMode);
     }
 
     if (!(SysfsAdaptor::startSensor()))
@@ -112,7 +109,7 @@ bool ALSAdaptorAscii::startSensor()
 void ALSAdaptorAscii::stopSensor()
 {
     if(!powerStatePath.isEmpty()) {
-        writeToFile(powerStatePath, "0");
+        writeControl(powerStatePath, "0");
     }
     SysfsAdaptor::stopSensor();
 }
@@ -55,7 +55,7 @@ protected:
     virtual bool setStandbyOverride(const bool override) { Q_UNUSED(override); return false; }
 private:
 
-    void processSample(int pathId, int fd);
+    void processValues(int pathId, const long* values, int count);
     char buf[16];
 
     DeviceAdaptorRingBuffer<TimedUnsigned>* alsBuffer_;
@@ -29,6 +29,7 @@
 */
 
 #include "logging.h"
+#include "tracelog.h"
 #include "config.h"
 #include "alsadaptor-sysfs.h"
 #include <errno.h>
@@ -40,8 +41,9 @@
 ALSAdaptorSysfs::ALSAdaptorSysfs(const QString& id) :
     SysfsAdaptor(id, SysfsAdaptor::IntervalMode, true)
 {
-    alsBuffer_ = new DeviceAdaptorRingBuffer<TimedUnsigned>(1);
+    alsBuffer_ = new DeviceAdaptorRingBuffer<TimedUnsigned>(ringSize("als", 1));
     setAdaptedSensor("als", "Internal ambient light sensor lux values", alsBuffer_);
+    setPayloadFormat(1);
 }
 
 ALSAdaptorSysfs::~ALSAdaptorSysfs()
@@ -49,29 +51,19 @@ ALSAdaptorSysfs::~ALSAdaptorSysfs()
     delete alsBuffer_;
 }
 
-void ALSAdaptorSysfs::processSample(int pathId, int fd)
+void ALSAdaptorSysfs::processValues(int pathId, const long* values, int count)
 {
     Q_UNUSED(pathId);
+    Q_UNUSED(count);
 
-    char asciidata[6];
-    __u16 idata = 0;
+    __u16 idata = values[0];
 
-    int bytesRead = read(fd, &asciidata, sizeof(asciidata));
-    asciidata[sizeof(asciidata)-1] = '\0';
-
-    idata = atoi(asciidata);
-
-    if (bytesRead <= 0) {
-        sensordLogW() << "read(): " << strerror(errno);
-        return;
-    }
-
-    sensordLogT() << "Ambient light value: " << idata;
+    sensordTraceRate(SENSORD_TRACE_RATE) << "Ambient light value: " << idata;
 
     TimedUnsigned* lux = alsBuffer_->nextSlot();
     lux->value_ = idata;
 
-    lux->timestamp_ = Utils::getTimeStamp();
+    lux->timestamp_ = sampleTimestamp();
 
     alsBuffer_->commit();
     alsBuffer_->wakeUpReaders();
@@ -76,13 +76,14 @@ protected:
 private:
 
     /**
-     * Read and process data. Run when sysfsadaptor has detected new available
+     * Process data. Run when sysfsadaptor has detected new available
      * data.
      * @param pathId PathId for the file that had event. Always 0, as we monitor
      *               only single file and don't set any proper id.
-     * @param fd     Open file descriptor with new data. See #SysfsAdaptor::processSample()
+     * @param values Light value. See #SysfsAdaptor::processValues()
+     * @param count  Number of values, always 1.
      */
-    void processSample(int pathId, int fd);
+    void processValues(int pathId, const long* values, int count);
 
     DeviceAdaptorRingBuffer<TimedUnsigned>* alsBuffer_;
 };
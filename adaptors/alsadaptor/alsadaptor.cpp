@@ -31,6 +31,7 @@
 */
 
 #include "logging.h"
+#include "tracelog.h"
 #include "config.h"
 #include "alsadaptor.h"
 #include <errno.h>
@@ -57,9 +58,10 @@ ALSAdaptor::ALSAdaptor(const QString& id):
 #ifdef SENSORFW_MCE_WATCHER
     alsEnabled(false),
 #endif
-    deviceType_(DeviceUnknown)
+    deviceType_(DeviceUnknown),
+    thresholds_("als")
 {
-    alsBuffer_ = new DeviceAdaptorRingBuffer<TimedUnsigned>(1);
+    alsBuffer_ = new DeviceAdaptorRingBuffer<TimedUnsigned>(ringSize("als", 1));
     setAdaptedSensor("als", "Internal ambient light sensor lux values", alsBuffer_);
     setDescription("Ambient light");
     deviceType_ = (DeviceType)Config::configuration()->value<int>("als/driver_type", DeviceUnknown);
@@ -105,7 +107,12 @@ bool ALSAdaptor::startSensor()
 {
     if(!powerStatePath_.isEmpty())
     {
-        writeToFile(powerStatePath_, "1");
+        writeControl(powerStatePath_, "1");
+    }
+    // Reader is not running yet, the window is not being moved
+    if (!isRunning())
+    {
+        thresholds_.close(*this);
     }
     if (SysfsAdaptor::startSensor())
     {
@@ -121,7 +128,7 @@ void ALSAdaptor::stopSensor()
 {
     if(!powerStatePath_.isEmpty())
     {
-        writeToFile(powerStatePath_, "0");
+        writeControl(powerStatePath_, "0");
     }
 #ifdef SENSORFW_MCE_WATCHER
     disableALS();
@@ -153,6 +160,16 @@ bool ALSAdaptor::resume()
     return false;
 }
 
+bool ALSAdaptor::concurrentPowerTransition() const
+{
+#ifdef SENSORFW_MCE_WATCHER
+    // ALS is enabled in MCE through the D-Bus connection of the main thread
+    return false;
+#else
+    return SysfsAdaptor::concurrentPowerTransition();
+#endif
+}
+
 void ALSAdaptor::processSample(int pathId, int fd)
 {
     Q_UNUSED(pathId);
@@ -168,11 +185,11 @@ void ALSAdaptor::processSample(int pathId, int fd)
             sensordLogW() << "read(): " << strerror(errno);
             return;
         }
-        sensordLogT() << "Ambient light value: " << als_data.lux;
+        sensordTraceRate(SENSORD_TRACE_RATE) << "Ambient light value: " << als_data.lux;
 
         TimedUnsigned* lux = alsBuffer_->nextSlot();
         lux->value_ = als_data.lux;
-        lux->timestamp_ = Utils::getTimeStamp();
+        lux->timestamp_ = sampleTimestamp();
     }
     else if (deviceType_ == RM696)
     {
@@ -185,11 +202,11 @@ void ALSAdaptor::processSample(int pathId, int fd)
             sensordLogW() << "read(): " << strerror(errno);
             return;
         }
-        sensordLogT() << "Ambient light value: " << als_data.lux;
+        sensordTraceRate(SENSORD_TRACE_RATE) << "Ambient light value: " << als_data.lux;
 
         TimedUnsigned* lux = alsBuffer_->nextSlot();
         lux->value_ = als_data.lux;
-        lux->timestamp_ = Utils::getTimeStamp();
+        lux->timestamp_ = sampleTimestamp();
     }
     else if (deviceType_ == NCDK)
     {
@@ -209,14 +226,15 @@ void ALSAdaptor::processSample(int pathId, int fd)
         }
         TimedUnsigned* lux = alsBuffer_->nextSlot();
         lux->value_ = fValue * 10;
-        lux->timestamp_ = Utils::getTimeStamp();
-        sensordLogT() << "Ambient light value: " << lux->value_;
+        lux->timestamp_ = sampleTimestamp();
+        sensordTraceRate(SENSORD_TRACE_RATE) << "Ambient light value: " << lux->value_;
     }
     else
     {
         sensordLogW() << "Not known device type: " << deviceType_;
         return;
     }
+    thresholds_.centre(*this, alsBuffer_->nextSlot()->value_);
     alsBuffer_->commit();
     alsBuffer_->wakeUpReaders();
 }
@@ -33,11 +33,13 @@
 
 #include "sysfsadaptor.h"
 #include "deviceadaptorringbuffer.h"
+#include "thresholdwindow.h"
 #include "datatypes/timedunsigned.h"
 #include <QTime>
-#include <QDBusInterface>
 
 #ifdef SENSORFW_MCE_WATCHER
+#include <QDBusInterface>
+
 // these come from mce/mode-names.h
 // and mce/dbus-names.h
 #define MCE_SERVICE                     "com.nokia.mce"
@@ -54,7 +56,9 @@
  * Sysfs driver interface can be found at @e dev/bh1770glc_als .
  *
  * Value output frequency depends on driver decision - only changed values
- * are pushed out of driver.
+ * are pushed out of driver. With als/threshold_low_path and
+ * als/threshold_high_path set, the interrupt thresholds of the chip are
+ * kept around the latest reading, see ThresholdWindow.
  */
 class ALSAdaptor : public SysfsAdaptor
 {
@@ -87,6 +91,8 @@ public:
 
     virtual bool resume();
 
+    virtual bool concurrentPowerTransition() const;
+
 protected:
 
     /**
@@ -111,6 +117,7 @@ private:
     DeviceAdaptorRingBuffer<TimedUnsigned>* alsBuffer_;
     DeviceType deviceType_;
     QByteArray powerStatePath_;
+    ThresholdWindow thresholds_;
 };
 
 #endif
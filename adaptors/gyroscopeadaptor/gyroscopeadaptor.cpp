@@ -38,7 +38,7 @@
 GyroscopeAdaptor::GyroscopeAdaptor(const QString& id) :
         SysfsAdaptor(id, SysfsAdaptor::SelectMode)
 {
-    gyroscopeBuffer_ = new DeviceAdaptorRingBuffer<TimedXyzData>(1);
+    gyroscopeBuffer_ = new DeviceAdaptorRingBuffer<TimedXyzData>(ringSize("gyroscope", 1));
     setAdaptedSensor("gyroscope", "l3g4200dh", gyroscopeBuffer_);
     setDescription("Sysfs Gyroscope adaptor (l3g4200dh)");   
     dataRatePath_ = Config::configuration()->value("gyroscope/path_datarate").toByteArray();
@@ -78,13 +78,13 @@ bool GyroscopeAdaptor::setInterval(const unsigned int value, const int sessionId
     int rate = value==0?100:1000/value;
     sensordLogD() << "Setting poll interval for " << dataRatePath_ << " to " << rate;
     QByteArray dataRateString(QString("%1\n").arg(rate).toLocal8Bit());
-    return writeToFile(dataRatePath_, dataRateString);
+    return writeControl(dataRatePath_, dataRateString);
 }
 
 unsigned int GyroscopeAdaptor::interval() const
 {
     if (mode() == SysfsAdaptor::IntervalMode)
         return SysfsAdaptor::interval();
-    QByteArray byteArray = readFromFile(dataRatePath_);
+    QByteArray byteArray = readControl(dataRatePath_);
     return byteArray.size() > 0 ? byteArray.toInt() : 0;
 }
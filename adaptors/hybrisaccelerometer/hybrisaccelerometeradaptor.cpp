@@ -24,9 +24,12 @@
 #include <hardware/sensors.h>
 
 HybrisAccelerometerAdaptor::HybrisAccelerometerAdaptor(const QString& id) :
-    HybrisAdaptor(id,SENSOR_TYPE_ACCELEROMETER)
+    HybrisAdaptor(id,SENSOR_TYPE_ACCELEROMETER),
+    // sensorfw wants milli-G', axes inverted
+    converter_(-1000 / 9.80665)
 {
-    buffer = new DeviceAdaptorRingBuffer<AccelerationData>(1);
+    converter_.configure(id());
+    buffer = new DeviceAdaptorRingBuffer<AccelerationData>(ringSize("accelerometer", eventBatchSize()));
     setAdaptedSensor("accelerometer", "Internal accelerometer coordinates", buffer);
 
     setDescription("Hybris accelerometer");
@@ -57,11 +60,8 @@ void HybrisAccelerometerAdaptor::processSample(const sensors_event_t& data)
 {
 
     AccelerationData *d = buffer->nextSlot();
-    d->timestamp_ = quint64(data.timestamp * .001);
-    // sensorfw wants milli-G'
-    d->x_ = -(data.data[0] / 9.80665 * 1000);
-    d->y_ = -(data.data[1] / 9.80665 * 1000);
-    d->z_ = -(data.data[2] / 9.80665 * 1000);
+    d->timestamp_ = eventTimestamp(data);
+    converter_.convert(data.data, *d);
 //  qt's sensorfw plugin expects G == 9.81286, but it should be
     //9.80665
     buffer->commit();
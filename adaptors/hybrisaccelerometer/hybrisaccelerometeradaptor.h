@@ -48,6 +48,7 @@ protected:
 
 private:
     DeviceAdaptorRingBuffer<AccelerationData>* buffer;
+    HybrisXyzConverter converter_;
     int sensorType;
 
 };
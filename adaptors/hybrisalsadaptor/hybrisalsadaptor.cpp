@@ -26,7 +26,7 @@
 HybrisAlsAdaptor::HybrisAlsAdaptor(const QString& id) :
     HybrisAdaptor(id,SENSOR_TYPE_LIGHT)
 {
-    buffer = new DeviceAdaptorRingBuffer<TimedUnsigned>(1);
+    buffer = new DeviceAdaptorRingBuffer<TimedUnsigned>(ringSize("als", eventBatchSize()));
     setAdaptedSensor("als", "Internal ambient light sensor lux values", buffer);
    // setDefaultInterval(50);
     setDescription("Hybris als");
@@ -55,7 +55,7 @@ void HybrisAlsAdaptor::stopSensor()
 void HybrisAlsAdaptor::processSample(const sensors_event_t& data)
 {
     TimedUnsigned *d = buffer->nextSlot();
-    d->timestamp_ = quint64(data.timestamp * .0001);
+    d->timestamp_ = eventTimestamp(data);
     d->value_ = data.light;
 
     buffer->commit();
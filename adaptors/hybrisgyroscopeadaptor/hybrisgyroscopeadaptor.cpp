@@ -26,9 +26,12 @@
 
 
 HybrisGyroscopeAdaptor::HybrisGyroscopeAdaptor(const QString& id) :
-    HybrisAdaptor(id,SENSOR_TYPE_GYROSCOPE)
+    HybrisAdaptor(id,SENSOR_TYPE_GYROSCOPE),
+    // rad/s to mdeg/s
+    converter_(57295.7795)
 {
-    buffer = new DeviceAdaptorRingBuffer<TimedXyzData>(1);
+    converter_.configure(id());
+    buffer = new DeviceAdaptorRingBuffer<TimedXyzData>(ringSize("gyroscopeadaptor", eventBatchSize()));
     setAdaptedSensor("gyroscopeadaptor", "Internal gyroscope coordinates", buffer);
 
     setDescription("Hybris gyroscope");
@@ -60,10 +63,8 @@ void HybrisGyroscopeAdaptor::processSample(const sensors_event_t& data)
 {
 
     TimedXyzData *d = buffer->nextSlot();
-    d->timestamp_ = quint64(data.timestamp * .001);
-    d->x_ = (data.acceleration.x) * 57295.7795;
-    d->y_ = (data.acceleration.y) * 57295.7795;
-    d->z_ = (data.acceleration.z) * 57295.7795;
+    d->timestamp_ = eventTimestamp(data);
+    converter_.convert(data.gyro.v, *d);
 
     buffer->commit();
     buffer->wakeUpReaders();
@@ -49,6 +49,7 @@ protected:
 
 private:
     DeviceAdaptorRingBuffer<TimedXyzData>* buffer;
+    HybrisXyzConverter converter_;
     int sensorType;
 };
 #endif
@@ -25,10 +25,21 @@
 #include <hardware/sensors.h>
 
 HybrisMagnetometerAdaptor::HybrisMagnetometerAdaptor(const QString& id) :
-    HybrisAdaptor(id,SENSOR_TYPE_MAGNETIC_FIELD)
+    HybrisAdaptor(id,SENSOR_TYPE_MAGNETIC_FIELD),
+    //uT to nT
+    converter_(1000),
+    buffer(NULL),
+    calibratedBuffer_(NULL),
+    calibrated_(Config::configuration()->value<bool>("magnetometer/hal_calibration", false))
 {
-    buffer = new DeviceAdaptorRingBuffer<TimedXyzData>(1);
-    setAdaptedSensor("magnetometer", "Internal magnetometer coordinates", buffer);
+    converter_.configure(id());
+    if (calibrated_) {
+        calibratedBuffer_ = new DeviceAdaptorRingBuffer<CalibratedMagneticFieldData>(ringSize("magnetometer", eventBatchSize()));
+        setAdaptedSensor("magnetometer", "HAL calibrated magnetometer coordinates", calibratedBuffer_);
+    } else {
+        buffer = new DeviceAdaptorRingBuffer<TimedXyzData>(ringSize("magnetometer", eventBatchSize()));
+        setAdaptedSensor("magnetometer", "Internal magnetometer coordinates", buffer);
+    }
 
     setDescription("Hybris magnetometer");
     //setStandbyOverride(false);
@@ -38,6 +49,12 @@ HybrisMagnetometerAdaptor::HybrisMagnetometerAdaptor(const QString& id) :
 HybrisMagnetometerAdaptor::~HybrisMagnetometerAdaptor()
 {
     delete buffer;
+    delete calibratedBuffer_;
+}
+
+bool HybrisMagnetometerAdaptor::calibrated() const
+{
+    return calibrated_;
 }
 
 bool HybrisMagnetometerAdaptor::startSensor()
@@ -56,12 +73,25 @@ void HybrisMagnetometerAdaptor::stopSensor()
 
 void HybrisMagnetometerAdaptor::processSample(const sensors_event_t& data)
 {
+    if (calibrated_) {
+        TimedXyzData field;
+        converter_.convert(data.magnetic.v, field);
+        CalibratedMagneticFieldData *d = calibratedBuffer_->nextSlot();
+        d->timestamp_ = eventTimestamp(data);
+        // HAL does not report the uncalibrated field along
+        d->x_ = d->rx_ = field.x_;
+        d->y_ = d->ry_ = field.y_;
+        d->z_ = d->rz_ = field.z_;
+        // Accuracy from unreliable to high maps onto levels 0 to 3
+        d->level_ = qBound(0, (int)data.magnetic.status, 3);
+        calibratedBuffer_->commit();
+        calibratedBuffer_->wakeUpReaders();
+        return;
+    }
+
     TimedXyzData *d = buffer->nextSlot();
-    d->timestamp_ = quint64(data.timestamp * .0001);
-    //uT to nT
-    d->x_ = (data.acceleration.x * 1000);
-    d->y_ = (data.acceleration.y * 1000);
-    d->z_ = (data.acceleration.z * 1000);
+    d->timestamp_ = eventTimestamp(data);
+    converter_.convert(data.magnetic.v, *d);
 
     buffer->commit();
     buffer->wakeUpReaders();
@@ -29,9 +29,19 @@
 #include "datatypes/orientationdata.h"
 #include <QTime>
 
+/**
+ * @brief Adaptor for hybris magnetometer.
+ *
+ * HAL magnetic field events are calibrated by the HAL. By default they are
+ * published as raw TimedXyzData and calibrated again by
+ * magcalibrationchain. With <em>magnetometer/hal_calibration</em> set they
+ * are published as CalibratedMagneticFieldData, with the HAL accuracy as
+ * calibration level, and the chain passes them through.
+ */
 class HybrisMagnetometerAdaptor : public HybrisAdaptor
 {
     Q_OBJECT
+    Q_PROPERTY(bool calibrated READ calibrated)
 
 public:
     static DeviceAdaptor* factoryMethod(const QString& id) {
@@ -43,12 +53,22 @@ public:
     bool startSensor();
     void stopSensor();
 
+    /**
+     * Are samples published calibrated.
+     *
+     * @return true if the buffer holds CalibratedMagneticFieldData.
+     */
+    bool calibrated() const;
+
 protected:
     void processSample(const sensors_event_t& data);
     void init();
 
 private:
     DeviceAdaptorRingBuffer<TimedXyzData>* buffer;
+    DeviceAdaptorRingBuffer<CalibratedMagneticFieldData>* calibratedBuffer_; /**< used instead of buffer if calibrated */
+    bool calibrated_; /**< magnetometer/hal_calibration */
+    HybrisXyzConverter converter_;
     int sensorType;
 
 };
@@ -43,7 +43,7 @@
 HybrisOrientationAdaptor::HybrisOrientationAdaptor(const QString& id) :
     HybrisAdaptor(id,SENSOR_TYPE_ORIENTATION)
 {
-    buffer = new DeviceAdaptorRingBuffer<CompassData>(1);
+    buffer = new DeviceAdaptorRingBuffer<CompassData>(ringSize("orientation", eventBatchSize()));
     setAdaptedSensor("orientation", "Internal orientation coordinates", buffer);
 
     setDescription("Hybris orientation");
@@ -73,7 +73,7 @@ void HybrisOrientationAdaptor::stopSensor()
 void HybrisOrientationAdaptor::processSample(const sensors_event_t& data)
 {
     CompassData *d = buffer->nextSlot();
-    d->timestamp_ = quint64(data.timestamp * .001);
+    d->timestamp_ = eventTimestamp(data);
     d->degrees_ = data.data[0] * 1000; //azimuth
     switch (data.orientation.status) {
     case SENSOR_STATUS_UNRELIABLE:
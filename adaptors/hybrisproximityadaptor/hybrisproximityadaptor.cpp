@@ -32,7 +32,7 @@
 HybrisProximityAdaptor::HybrisProximityAdaptor(const QString& id) :
     HybrisAdaptor(id,SENSOR_TYPE_PROXIMITY)
 {
-    buffer = new DeviceAdaptorRingBuffer<ProximityData>(1);
+    buffer = new DeviceAdaptorRingBuffer<ProximityData>(ringSize("proximity", eventBatchSize()));
     setAdaptedSensor("proximity", "Internal proximity coordinates", buffer);
 
     setDescription("Hybris proximity");
@@ -123,7 +123,7 @@ void HybrisProximityAdaptor::stopSensor()
 void HybrisProximityAdaptor::processSample(const sensors_event_t& data)
 {
     ProximityData *d = buffer->nextSlot();
-    d->timestamp_ = quint64(data.timestamp * .0001);
+    d->timestamp_ = eventTimestamp(data);
     bool near = false;
 
     sensordLogD() << "Guhl: HybrisProximityAdaptor processSample absinfo.value=" << data.distance << ", maxRange=" << maxRange << "\n";
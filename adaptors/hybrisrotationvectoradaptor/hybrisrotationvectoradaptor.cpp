@@ -0,0 +1,130 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Jolla Ltd
+** Contact: lorn.potter@jollamobile.com
+**
+**
+** $QT_BEGIN_LICENSE:LGPL$
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "hybrisrotationvectoradaptor.h"
+#include "logging.h"
+#include "config.h"
+#include <hardware/sensors.h>
+#include <math.h>
+
+#ifndef SENSOR_TYPE_ROTATION_VECTOR
+#define SENSOR_TYPE_ROTATION_VECTOR (11)
+#endif
+#ifndef SENSOR_TYPE_GAME_ROTATION_VECTOR
+#define SENSOR_TYPE_GAME_ROTATION_VECTOR (15)
+#endif
+#ifndef SENSOR_TYPE_GEOMAGNETIC_ROTATION_VECTOR
+#define SENSOR_TYPE_GEOMAGNETIC_ROTATION_VECTOR (20)
+#endif
+
+static const float RADIANS_TO_DEGREES = 57.2957795f;
+
+static int roundDegrees(float degrees)
+{
+    return degrees >= 0 ? (int)(degrees + 0.5f) : (int)(degrees - 0.5f);
+}
+
+HybrisRotationVectorAdaptor::HybrisRotationVectorAdaptor(const QString& id) :
+    HybrisAdaptor(id, configuredType())
+{
+    buffer = new DeviceAdaptorRingBuffer<TimedXyzData>(ringSize("rotationvector", eventBatchSize()));
+    setAdaptedSensor("rotationvector", "Sensor hub rotation in degrees", buffer);
+
+    setDescription("Hybris rotation vector");
+    setDefaultInterval(50);
+}
+
+HybrisRotationVectorAdaptor::~HybrisRotationVectorAdaptor()
+{
+    delete buffer;
+}
+
+int HybrisRotationVectorAdaptor::configuredType()
+{
+    QString name = Config::configuration()->value<QString>("rotationvector/hal_sensor", "rotation");
+    if (name == "game")
+        return SENSOR_TYPE_GAME_ROTATION_VECTOR;
+    if (name == "geomagnetic")
+        return SENSOR_TYPE_GEOMAGNETIC_ROTATION_VECTOR;
+    if (name != "rotation")
+        sensordLogW() << "Unknown rotationvector/hal_sensor " << name << ", using rotation";
+    return SENSOR_TYPE_ROTATION_VECTOR;
+}
+
+bool HybrisRotationVectorAdaptor::absolute() const
+{
+    return sensorType != SENSOR_TYPE_GAME_ROTATION_VECTOR;
+}
+
+bool HybrisRotationVectorAdaptor::startSensor()
+{
+    if (!(HybrisAdaptor::startSensor()))
+        return false;
+
+    sensordLogD() << "HybrisRotationVectorAdaptor start\n";
+    return true;
+}
+
+void HybrisRotationVectorAdaptor::stopSensor()
+{
+    HybrisAdaptor::stopSensor();
+    sensordLogD() << "HybrisRotationVectorAdaptor stop\n";
+}
+
+void HybrisRotationVectorAdaptor::processSample(const sensors_event_t& data)
+{
+    float x = data.data[0];
+    float y = data.data[1];
+    float z = data.data[2];
+    float w = data.data[3];
+    // Older HALs leave the scalar part out of the event
+    if (w == 0) {
+        float norm = 1 - x * x - y * y - z * z;
+        w = norm > 0 ? sqrtf(norm) : 0;
+    }
+
+    // Rows of the matrix taking device coordinates to east, north and up
+    float r01 = 2 * (x * y - w * z);
+    float r11 = 1 - 2 * (x * x + z * z);
+    float gx = -2 * (x * z - w * y);
+    float gy = -2 * (y * z + w * x);
+    float gz = -(1 - 2 * (x * x + y * y));
+
+    // Same rotation as AttitudeFilter publishes
+    int heading = roundDegrees(atan2f(r01, r11) * RADIANS_TO_DEGREES);
+    heading = (heading + 360) % 360;
+    float pitch = -atan2f(gy, sqrtf(gx * gx + gz * gz)) * RADIANS_TO_DEGREES;
+    float yz = sqrtf(gy * gy + gz * gz);
+    float roll = (gx == 0 && gz == 0) ? 0 : atan2f(gx, gz >= 0 ? -yz : yz) * RADIANS_TO_DEGREES;
+    int degrees = roundDegrees(roll);
+
+    TimedXyzData *d = buffer->nextSlot();
+    d->timestamp_ = eventTimestamp(data);
+    d->x_ = roundDegrees(pitch);
+    d->y_ = degrees == -180 ? 180 : degrees;
+    d->z_ = 180 - heading;
+
+    buffer->commit();
+    buffer->wakeUpReaders();
+}
+
+void HybrisRotationVectorAdaptor::init()
+{
+}
@@ -0,0 +1,76 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Jolla Ltd
+** Contact: lorn.potter@jollamobile.com
+**
+**
+** $QT_BEGIN_LICENSE:LGPL$
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef HYBRISROTATIONVECTORADAPTOR_H
+#define HYBRISROTATIONVECTORADAPTOR_H
+#include "hybrisadaptor.h"
+
+#include <QString>
+#include "deviceadaptorringbuffer.h"
+#include "datatypes/orientationdata.h"
+
+/**
+ * @brief Adaptor for the rotation vector computed by the sensor hub.
+ *
+ * Attitude quaternions of the HAL are published as rotation in the format
+ * of RotationFilter, degrees around x, y and z, so that rotationsensor can
+ * use them in place of its own filter. The HAL sensor is selected with
+ * <em>rotationvector/hal_sensor</em>: <em>rotation</em> (default) for the
+ * magnetometer referenced rotation vector, <em>game</em> for the game
+ * rotation vector whose heading is relative, or <em>geomagnetic</em> for
+ * the accelerometer and magnetometer only one.
+ */
+class HybrisRotationVectorAdaptor : public HybrisAdaptor
+{
+    Q_OBJECT
+    Q_PROPERTY(bool absolute READ absolute)
+
+public:
+    static DeviceAdaptor* factoryMethod(const QString& id) {
+        return new HybrisRotationVectorAdaptor(id);
+    }
+    HybrisRotationVectorAdaptor(const QString& id);
+    ~HybrisRotationVectorAdaptor();
+
+    bool startSensor();
+    void stopSensor();
+
+    /**
+     * Is rotation around z referenced to north.
+     *
+     * @return false for the game rotation vector.
+     */
+    bool absolute() const;
+
+    /**
+     * HAL sensor type selected by rotationvector/hal_sensor.
+     *
+     * @return sensor type.
+     */
+    static int configuredType();
+
+protected:
+    void processSample(const sensors_event_t& data);
+    void init();
+
+private:
+    DeviceAdaptorRingBuffer<TimedXyzData>* buffer;
+};
+#endif
@@ -0,0 +1,11 @@
+TARGET       = hybrisrotationvectoradaptor
+
+HEADERS += hybrisrotationvectoradaptor.h \
+           hybrisrotationvectoradaptorplugin.h
+
+SOURCES += hybrisrotationvectoradaptor.cpp \
+           hybrisrotationvectoradaptorplugin.cpp
+
+LIBS+= -L../../core -lhybrissensorfw-qt5
+
+include( ../adaptor-config.pri )
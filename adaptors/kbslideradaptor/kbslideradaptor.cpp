@@ -37,11 +37,14 @@
 #define SELFDEF_EV_KBSLIDE 10
 
 KeyboardSliderAdaptor::KeyboardSliderAdaptor(const QString& id) :
-    InputDevAdaptor(id, 1), newKbEventRecorded_(false), currentState_(KeyboardSliderStateUnknown)
+    InputDevAdaptor(id, 1), currentState_(KeyboardSliderStateUnknown)
 {
-    kbstateBuffer_ = new DeviceAdaptorRingBuffer<KeyboardSliderState>(1);
+    kbstateBuffer_ = new DeviceAdaptorRingBuffer<KeyboardSliderState>(ringSize("keyboardslider", 1));
     setAdaptedSensor("keyboardslider", "Device keyboard slider state", kbstateBuffer_);
     setDescription("Keyboard slider events (via input device)");
+
+    setEventHandling(EventIgnored);
+    setEventHandling(SELFDEF_EV_KB, SELFDEF_EV_KBSLIDE, EventTracked);
 }
 
 KeyboardSliderAdaptor::~KeyboardSliderAdaptor()
@@ -49,40 +52,14 @@ KeyboardSliderAdaptor::~KeyboardSliderAdaptor()
     delete kbstateBuffer_;
 }
 
-void KeyboardSliderAdaptor::interpretEvent(int src, struct input_event *ev)
+void KeyboardSliderAdaptor::interpretFrame(int src, const InputFrame& frame, struct input_event *ev)
 {
     Q_UNUSED(src);
+    Q_UNUSED(ev);
 
-    switch (ev->type) {
-        case SELFDEF_EV_KB:
-        {
-            switch (ev->code) {
-                case SELFDEF_EV_KBSLIDE:
-                {
-                    newKbEventRecorded_ = true;
-                    if (ev->value == 0) {
-                        currentState_ = KeyboardSliderStateClosed;
-                    }
-                    else if (ev->value == 1) {
-                        currentState_ = KeyboardSliderStateOpen;
-                    }
-                    else {
-                        currentState_ = KeyboardSliderStateUnknown;
-                    }
-                }
-                break;
-                default: break;
-            }
-        }
-        break;
-        default: break;
+    if (frame.switchChanged(SELFDEF_EV_KBSLIDE)) {
+        currentState_ = frame.switchValue(SELFDEF_EV_KBSLIDE) ? KeyboardSliderStateOpen : KeyboardSliderStateClosed;
     }
-}
-
-void KeyboardSliderAdaptor::interpretSync(int src, struct input_event *ev)
-{
-    Q_UNUSED(src);
-    Q_UNUSED(ev);
     commitOutput();
 }
 
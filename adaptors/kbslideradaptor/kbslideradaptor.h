@@ -71,12 +71,10 @@ protected:
 private:
 
     DeviceAdaptorRingBuffer<KeyboardSliderState>* kbstateBuffer_;
-    bool                                          newKbEventRecorded_;
     KeyboardSliderState                           currentState_;
 
-    void interpretEvent(int src, struct input_event *ev);
+    void interpretFrame(int src, const InputFrame& frame, struct input_event *ev);
     void commitOutput();
-    void interpretSync(int src, struct input_event *ev);
 };
 
 #endif
@@ -0,0 +1,181 @@
+/**
+   @file loadgenadaptor.cpp
+   @brief LoadGenAdaptor
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+*/
+
+#include "loadgenadaptor.h"
+#include "config.h"
+#include "logging.h"
+#include "datatypes/atomic.h"
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+
+/** Samples in one period of the generated sine wave */
+static const unsigned WAVE_LENGTH = 200;
+
+/** Generator resynchronizes when it falls behind by more than this */
+static const quint64 MAX_LAG_NS = 1000000000ULL;
+
+static quint64 monotonicNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+LoadGenThread::LoadGenThread(LoadGenAdaptor* parent) :
+    parent_(parent)
+{
+}
+
+void LoadGenThread::run()
+{
+    parent_->generate();
+}
+
+LoadGenAdaptor::LoadGenAdaptor(const QString& id) :
+    DeviceAdaptor(id),
+    running_(0),
+    sequence_(0)
+{
+    QString sensor = id.contains("magnetometer") ? "magnetometer" : "accelerometer";
+
+    rate_ = qMax(1u, Config::configuration()->value<unsigned int>(sensor + "/loadgen_rate", 1000));
+    batch_ = qMax(1u, Config::configuration()->value<unsigned int>(sensor + "/loadgen_batch", 1));
+    burstOn_ = Config::configuration()->value<unsigned int>(sensor + "/loadgen_burst_on", 0);
+    burstOff_ = Config::configuration()->value<unsigned int>(sensor + "/loadgen_burst_off", 0);
+    amplitude_ = Config::configuration()->value<int>(sensor + "/loadgen_amplitude", 1000);
+    if (burstOff_ && !burstOn_) {
+        sensordLogW() << "loadgen_burst_off set without loadgen_burst_on, generating continuously";
+        burstOff_ = 0;
+    }
+
+    thread_ = new LoadGenThread(this);
+    buffer_ = new DeviceAdaptorRingBuffer<TimedXyzData>(qMax(1024u, 4 * batch_));
+    setAdaptedSensor(sensor, "Synthetic " + sensor + " load", buffer_);
+    setDescription(QString("Load generator, %1 Hz in batches of %2").arg(rate_).arg(batch_));
+}
+
+LoadGenAdaptor::~LoadGenAdaptor()
+{
+    stopSensor();
+    delete thread_;
+    delete buffer_;
+}
+
+bool LoadGenAdaptor::startAdaptor()
+{
+    return true;
+}
+
+void LoadGenAdaptor::stopAdaptor()
+{
+}
+
+void LoadGenAdaptor::init()
+{
+    introduceAvailableDataRanges(name());
+    if (getAvailableDataRanges().isEmpty())
+        introduceAvailableDataRange(DataRange(-amplitude_, amplitude_, 1));
+    introduceAvailableIntervals(name());
+    if (getAvailableIntervals().isEmpty())
+        introduceAvailableInterval(DataRange(0, 1000, 0));
+}
+
+bool LoadGenAdaptor::startSensor()
+{
+    if (Atomic::load(running_))
+        return true;
+    sensordLogD() << "Generating " << name() << " load at " << rate_ << " Hz, batch " << batch_
+                  << ", bursts " << burstOn_ << "/" << burstOff_ << " ms";
+    Atomic::store(running_, 1);
+    thread_->start();
+    return true;
+}
+
+void LoadGenAdaptor::stopSensor()
+{
+    if (!Atomic::load(running_))
+        return;
+    Atomic::store(running_, 0);
+    thread_->wait();
+    sensordLogD() << "Load generator stopped after " << sequence_ << " samples";
+}
+
+unsigned int LoadGenAdaptor::interval() const
+{
+    return qMax(1u, 1000 / rate_);
+}
+
+bool LoadGenAdaptor::setInterval(const unsigned int value, const int sessionId)
+{
+    sensordLogT() << "Ignoring interval " << value << " of session " << sessionId << ", rate is configured";
+    return true;
+}
+
+void LoadGenAdaptor::generate()
+{
+    const quint64 period = 1000000000ULL / rate_;
+    const quint64 burstOn = burstOn_ * 1000000ULL;
+    const quint64 cycle = burstOff_ ? burstOn + burstOff_ * 1000000ULL : 0;
+    const quint64 start = monotonicNs();
+    quint64 next = start;
+
+    while (Atomic::load(running_)) {
+        next += period * batch_;
+        if (cycle) {
+            quint64 phase = (next - start) % cycle;
+            if (phase >= burstOn)
+                next += cycle - phase;
+        }
+
+        quint64 now = monotonicNs();
+        if (now > next + MAX_LAG_NS) {
+            sensordLogW() << "Load generator fell behind by " << (now - next) / 1000000 << " ms, resynchronizing";
+            next = now;
+        } else if (now < next) {
+            struct timespec deadline;
+            deadline.tv_sec = next / 1000000000ULL;
+            deadline.tv_nsec = next % 1000000000ULL;
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR)
+                ;
+        }
+
+        commitBatch(batch_, next);
+    }
+}
+
+void LoadGenAdaptor::commitBatch(unsigned count, quint64 last)
+{
+    const quint64 period = 1000000000ULL / rate_;
+
+    beginBatch();
+    for (unsigned i = 0; i < count; ++i) {
+        double phase = (sequence_++ % WAVE_LENGTH) * 2 * M_PI / WAVE_LENGTH;
+        TimedXyzData* sample = buffer_->nextSlot();
+        sample->timestamp_ = (last - (count - 1 - i) * period) / 1000;
+        sample->x_ = (int)(amplitude_ * sin(phase));
+        sample->y_ = (int)(amplitude_ * cos(phase));
+        sample->z_ = (int)(amplitude_ * sin(2 * phase));
+        buffer_->commit();
+        buffer_->wakeUpReaders();
+    }
+    endBatch();
+}
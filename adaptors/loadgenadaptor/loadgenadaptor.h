@@ -0,0 +1,120 @@
+/**
+   @file loadgenadaptor.h
+   @brief LoadGenAdaptor
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+*/
+
+#ifndef LOADGENADAPTOR_H
+#define LOADGENADAPTOR_H
+
+#include "deviceadaptor.h"
+#include "deviceadaptorringbuffer.h"
+#include "datatypes/orientationdata.h"
+#include <QAtomicInt>
+#include <QThread>
+
+class LoadGenAdaptor;
+
+/**
+ * Thread generating samples for LoadGenAdaptor.
+ */
+class LoadGenThread : public QThread
+{
+    Q_OBJECT
+public:
+    LoadGenThread(LoadGenAdaptor* parent);
+    void run();
+
+private:
+    LoadGenAdaptor* parent_;
+};
+
+/**
+ * @brief Adaptor generating synthetic samples at a configurable rate.
+ *
+ * Replaces a real accelerometer or magnetometer adaptor for soak and
+ * scaling benchmarks, e.g. with <code>plugins/accelerometeradaptor =
+ * loadgenadaptor</code>. Samples are sine waves of the configured
+ * amplitude, timestamped at their nominal generation time so that
+ * client side latency can be measured against the real clock.
+ *
+ * Configured from the adapted sensor section (accelerometer or
+ * magnetometer):
+ * <ul>
+ * <li><em>loadgen_rate</em> samples per second, default 1000.</li>
+ * <li><em>loadgen_batch</em> samples committed per wakeup, default 1.</li>
+ * <li><em>loadgen_burst_on</em> and <em>loadgen_burst_off</em> length
+ *     of generating and silent phases in milliseconds. Generation is
+ *     continuous when burst_off is 0 (default).</li>
+ * <li><em>loadgen_amplitude</em> peak value, default 1000.</li>
+ * </ul>
+ * Session interval requests are accepted but do not change the rate.
+ */
+class LoadGenAdaptor : public DeviceAdaptor
+{
+    Q_OBJECT
+public:
+    static DeviceAdaptor* factoryMethod(const QString& id)
+    {
+        return new LoadGenAdaptor(id);
+    }
+
+    bool startAdaptor();
+    void stopAdaptor();
+
+    bool startSensor();
+    void stopSensor();
+
+    void init();
+
+protected:
+    LoadGenAdaptor(const QString& id);
+    ~LoadGenAdaptor();
+
+    unsigned int interval() const;
+
+    bool setInterval(const unsigned int value, const int sessionId);
+
+private:
+    friend class LoadGenThread;
+
+    /**
+     * Generate samples until stopped.
+     */
+    void generate();
+
+    /**
+     * Commit a batch of samples and wake up readers once.
+     *
+     * @param count number of samples.
+     * @param last timestamp of the last sample in nanoseconds.
+     */
+    void commitBatch(unsigned count, quint64 last);
+
+    LoadGenThread*                         thread_;    /**< generator thread */
+    DeviceAdaptorRingBuffer<TimedXyzData>* buffer_;    /**< output buffer */
+    QAtomicInt                             running_;   /**< is generator running */
+    unsigned                               rate_;      /**< samples per second */
+    unsigned                               batch_;     /**< samples per wakeup */
+    unsigned                               burstOn_;   /**< generating phase in ms */
+    unsigned                               burstOff_;  /**< silent phase in ms */
+    int                                    amplitude_; /**< peak sample value */
+    quint64                                sequence_;  /**< samples generated */
+};
+
+#endif
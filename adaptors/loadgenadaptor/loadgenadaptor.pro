@@ -0,0 +1,9 @@
+TARGET       = loadgenadaptor
+
+HEADERS += loadgenadaptor.h \
+           loadgenadaptorplugin.h
+
+SOURCES += loadgenadaptor.cpp \
+           loadgenadaptorplugin.cpp
+
+include( ../adaptor-config.pri )
@@ -0,0 +1,51 @@
+/**
+   @file loadgenadaptorplugin.cpp
+   @brief Plugin for LoadGenAdaptor
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+*/
+
+#include "loadgenadaptorplugin.h"
+#include "loadgenadaptor.h"
+#include "sensormanager.h"
+#include "config.h"
+#include "logging.h"
+
+void LoadGenAdaptorPlugin::Register(class Loader&)
+{
+    // Stand in for every adaptor mapped to this plugin, or for both when
+    // the plugin is loaded by its own name.
+    QStringList adaptors;
+    adaptors << "accelerometeradaptor" << "magnetometeradaptor";
+    QStringList mapped;
+    foreach (const QString& adaptor, adaptors) {
+        if (Config::configuration()->value("plugins/" + adaptor).toString() == "loadgenadaptor")
+            mapped << adaptor;
+    }
+    if (mapped.isEmpty())
+        mapped = adaptors;
+
+    SensorManager& sm = SensorManager::instance();
+    foreach (const QString& adaptor, mapped) {
+        sensordLogD() << "registering loadgenadaptor as " << adaptor;
+        sm.registerDeviceAdaptor<LoadGenAdaptor>(adaptor);
+    }
+}
+
+#if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
+Q_EXPORT_PLUGIN2(loadgenadaptor, LoadGenAdaptorPlugin)
+#endif
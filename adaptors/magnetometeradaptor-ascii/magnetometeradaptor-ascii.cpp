@@ -42,8 +42,8 @@
 MagnetometerAdaptorAscii::MagnetometerAdaptorAscii(const QString& id) :
     SysfsAdaptor(id, SysfsAdaptor::IntervalMode)
 {
-    memset(buf, 0x0, 32);
-    magnetBuffer_ = new DeviceAdaptorRingBuffer<TimedXyzData>(1);
+    setPayloadFormat(3, SysfsAdaptor::HexValues);
+    magnetBuffer_ = new DeviceAdaptorRingBuffer<TimedXyzData>(ringSize("magnetometer", 1));
     setAdaptedSensor("magnetometer", "ak8974 ascii", magnetBuffer_);
 }
 
@@ -52,24 +52,16 @@ MagnetometerAdaptorAscii::~MagnetometerAdaptorAscii()
     delete magnetBuffer_;
 }
 
-void MagnetometerAdaptorAscii::processSample(int, int fd)
+void MagnetometerAdaptorAscii::processValues(int, const long* values, int)
 {
-    unsigned short x, y, z;
-
-    lseek(fd, 0, SEEK_SET);
-    if (read(fd, buf, sizeof(buf)) <= 0) {
-        sensordLogW() << "read(): " << strerror(errno);
-        return;
-    }
-    sensordLogT() << "Magnetometer output value: " << buf;
-
-    sscanf(buf, "%hx:%hx:%hx\n", &x, &y, &z);
+    sensordLogT() << "Magnetometer output value: " << values[0] << ":" << values[1] << ":" << values[2];
 
+    // Registers are 16-bit two's complement
     TimedXyzData* pos = magnetBuffer_->nextSlot();
-    pos->x_ = (short)x;
-    pos->y_ = (short)y;
-    pos->z_ = (short)z;
-    pos->timestamp_ = Utils::getTimeStamp();
+    pos->x_ = (short)values[0];
+    pos->y_ = (short)values[1];
+    pos->z_ = (short)values[2];
+    pos->timestamp_ = sampleTimestamp();
 
     magnetBuffer_->commit();
     magnetBuffer_->wakeUpReaders();
@@ -50,8 +50,7 @@ protected:
     ~MagnetometerAdaptorAscii();
 
 private:
-    void processSample(int pathId, int fd);
-    char buf[32];
+    void processValues(int pathId, const long* values, int count);
 
     DeviceAdaptorRingBuffer<TimedXyzData>* magnetBuffer_;
 };
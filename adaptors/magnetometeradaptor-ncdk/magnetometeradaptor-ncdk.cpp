@@ -37,7 +37,7 @@ MagnetometerAdaptorNCDK::MagnetometerAdaptorNCDK(const QString& id) :
     intervalCompensation_ = Config::configuration()->value<int>("magnetometer/interval_compensation", 0);
     powerStateFilePath_ = Config::configuration()->value<QByteArray>("magnetometer/path_power_state", "");
     sensAdjFilePath_ = Config::configuration()->value<QByteArray>("magnetometer/path_sens_adjust", "");
-    magnetometerBuffer_ = new DeviceAdaptorRingBuffer<TimedXyzData>(128);
+    magnetometerBuffer_ = new DeviceAdaptorRingBuffer<TimedXyzData>(ringSize("magnetometer", 128));
     setAdaptedSensor("magnetometer", "Internal magnetometer coordinates", magnetometerBuffer_);
     setDescription("Magnetometer adaptor (ak8975) for NCDK");
 
@@ -86,7 +86,7 @@ void MagnetometerAdaptorNCDK::processSample(int pathId, int fd)
 
     TimedXyzData* sample = magnetometerBuffer_->nextSlot();
 
-    sample->timestamp_ = Utils::getTimeStamp();
+    sample->timestamp_ = sampleTimestamp();
     sample->x_ = x;
     sample->y_ = y;
     sample->z_ = z;
@@ -101,7 +101,7 @@ bool MagnetometerAdaptorNCDK::setPowerState(bool value) const
 
     QByteArray powerStateStr = QByteArray::number(value);
 
-    if (!writeToFile(powerStateFilePath_, powerStateStr))
+    if (!writeControl(powerStateFilePath_, powerStateStr))
     {
         sensordLogW() << "Unable to set power state for compass driver";
         return false;
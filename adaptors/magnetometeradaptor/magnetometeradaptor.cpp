@@ -47,7 +47,7 @@ MagnetometerAdaptor::MagnetometerAdaptor(const QString& id) :
     SysfsAdaptor(id, SysfsAdaptor::IntervalMode, false)
 {
     intervalCompensation_ = Config::configuration()->value<int>("magnetometer/interval_compensation", 0);
-    magnetometerBuffer_ = new DeviceAdaptorRingBuffer<TimedXyzData>(1);
+    magnetometerBuffer_ = new DeviceAdaptorRingBuffer<TimedXyzData>(ringSize("magnetometer", 1));
     setAdaptedSensor("magnetometer", "Internal magnetometer coordinates", magnetometerBuffer_);
     overflowLimit_ = Config::configuration()->value<int>("magnetometer/overflow_limit", 8000);
     setDescription("Input device Magnetometer adaptor (ak897x)");
@@ -80,7 +80,7 @@ void MagnetometerAdaptor::processSample(int pathId, int fd)
 
     TimedXyzData* sample = magnetometerBuffer_->nextSlot();
 
-    sample->timestamp_ = Utils::getTimeStamp();
+    sample->timestamp_ = sampleTimestamp();
     sample->x_ = mag_data.x;
     sample->y_ = mag_data.y;
     sample->z_ = mag_data.z;
@@ -60,8 +60,10 @@ Mpu6050AccelAdaptor::Mpu6050AccelAdaptor (const QString& id) :
         return;
     }
     addPath(zAxisPath, Z_AXIS);
+    // Axes of one sample are read back to back and committed together
+    setSampleAssembly(true);
 
-    buffer = new DeviceAdaptorRingBuffer<OrientationData>(128);
+    buffer = new DeviceAdaptorRingBuffer<OrientationData>(ringSize("accelerometer", 128));
     setAdaptedSensor("accelerometer", "MPU6050 accelerometer", buffer);
 
     setDescription("MPU 6050 accelerometer");
@@ -87,43 +89,17 @@ void Mpu6050AccelAdaptor::stopSensor () {
     sensordLogD() << "MPU6050 AccelAdaptor stop\n";
 }
 
-void Mpu6050AccelAdaptor::processSample (int pathId, int fd) {
-    char buf[32];
-    int val;
-
-    if ( pathId < X_AXIS || pathId > Z_AXIS ) {
-        sensordLogW() << "Wrong pathId: " << pathId;
+void Mpu6050AccelAdaptor::processAssembled (const long* values, int count) {
+    if ( count != 3 ) {
+        sensordLogW() << "Wrong number of axes: " << count;
         return;
     }
 
-    lseek (fd, 0, SEEK_SET);
-    if (read (fd, buf, sizeof(buf)) < 0) {
-        sensordLogW() << "Read failed";
-        return;
-    }
-
-    if (sscanf (buf, "%d", &val) == 0 ) {
-        sensordLogW() << "Wrong data format: " << buf;
-        return;
-    }
-
-    switch (pathId) {
-        case X_AXIS:
-            currentData = buffer->nextSlot();                
-            currentData->timestamp_ = Utils::getTimeStamp();
-            currentData->x_ = qRound(val / CORRECTION_FACTOR);
-            break;
-        case Y_AXIS:
-            currentData->y_ = qRound(val / CORRECTION_FACTOR);
-            break;
-        case Z_AXIS:
-            currentData->z_ = qRound(val / CORRECTION_FACTOR);
-            buffer->commit();
-            buffer->wakeUpReaders();
-            break;
-        default:
-            sensordLogW() << "Invalid pathId: " << pathId;
-            break;
-    }
+    OrientationData* d = buffer->nextSlot();
+    d->timestamp_ = sampleTimestamp();
+    d->x_ = qRound(values[0] / CORRECTION_FACTOR);
+    d->y_ = qRound(values[1] / CORRECTION_FACTOR);
+    d->z_ = qRound(values[2] / CORRECTION_FACTOR);
+    buffer->commit();
+    buffer->wakeUpReaders();
 }
-
@@ -46,10 +46,9 @@ class Mpu6050AccelAdaptor : public SysfsAdaptor {
         void stopSensor ();
 
     protected:
-        void processSample (int pathId, int fd);
+        void processAssembled (const long* values, int count);
 
     private:
         DeviceAdaptorRingBuffer<OrientationData>* buffer;
-        OrientationData *currentData;
 };
 #endif
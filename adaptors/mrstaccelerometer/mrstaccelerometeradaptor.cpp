@@ -34,7 +34,7 @@
 MRSTAccelAdaptor::MRSTAccelAdaptor (const QString& id) :
     SysfsAdaptor (id, SysfsAdaptor::IntervalMode)
 {
-    buffer = new DeviceAdaptorRingBuffer<OrientationData>(1);
+    buffer = new DeviceAdaptorRingBuffer<OrientationData>(ringSize("accelerometer", 1));
     setAdaptedSensor("accelerometer", "MRST accelerometer", buffer);
     setDescription("MRST accelerometer");
 }
@@ -59,7 +59,7 @@ void MRSTAccelAdaptor::processSample (int, int fd) {
     }
 
     OrientationData* d = buffer->nextSlot ();
-    d->timestamp_ = Utils::getTimeStamp();
+    d->timestamp_ = sampleTimestamp();
     d->x_ = x;
     d->y_ = y;
     d->z_ = z;
@@ -22,7 +22,7 @@ class OaktrailAccelAdaptor : public SysfsAdaptor {
         void stopSensor ();
 
     protected:
-        void processSample (int pathId, int fd);
+        void processAssembled (const long* values, int count);
 
     private:
         DeviceAdaptorRingBuffer<OrientationData>* buffer;
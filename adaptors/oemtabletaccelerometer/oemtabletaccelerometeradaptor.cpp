@@ -21,7 +21,8 @@ OemtabletAccelAdaptor::OemtabletAccelAdaptor (const QString& id) :
 
     devId = 0;
     addPath (devPath, devId);
-    buffer = new DeviceAdaptorRingBuffer<OrientationData>(128);
+    setSampleAssembly(true);
+    buffer = new DeviceAdaptorRingBuffer<OrientationData>(ringSize("accelerometer", 128));
     setAdaptedSensor("accelerometer", "OEM tablet accelerometer", buffer);
 
     setDescription("OEM tablet accelerometer");
@@ -47,31 +48,17 @@ void OemtabletAccelAdaptor::stopSensor () {
     sensordLogD() << "OEM tablet AccelAdaptor stop\n";
 }
 
-void OemtabletAccelAdaptor::processSample (int pathId, int fd) {
-    char buf[32];
-    int x, y, z;
-
-    if ( pathId != devId ) {
-        sensordLogW () << "Wrong pathId" << pathId;
-        return;
-    }
-
-    lseek (fd, 0, SEEK_SET);
-    if ( read (fd, buf, sizeof(buf)) < 0 ) {
-        sensordLogW () << "Read failed";
-        return;
-    }
-
-    if ( sscanf (buf, "(%d,%d,%d)", &x, &y, &z) == 0 ) {
+void OemtabletAccelAdaptor::processAssembled (const long* values, int count) {
+    if ( count != 3 ) {
         sensordLogW () << "Wrong data format";
         return;
     }
 
     OrientationData* d = buffer->nextSlot ();
-    d->timestamp_ = Utils::getTimeStamp();
-    d->x_ = x;
-    d->y_ = y;
-    d->z_ = z;
+    d->timestamp_ = sampleTimestamp();
+    d->x_ = values[0];
+    d->y_ = values[1];
+    d->z_ = values[2];
 
     buffer->commit ();
     buffer->wakeUpReaders ();
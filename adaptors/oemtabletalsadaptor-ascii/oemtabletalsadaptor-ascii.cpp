@@ -4,6 +4,7 @@
 #include <QFile>
 
 #include "logging.h"
+#include "tracelog.h"
 #include "config.h"
 #include "oemtabletalsadaptor-ascii.h"
 #include "datatypes/utils.h"
@@ -37,7 +38,8 @@ OEMTabletALSAdaptorAscii::OEMTabletALSAdaptorAscii(const QString& id) : SysfsAda
     }
 
     addPath(devPath);
-    alsBuffer_ = new DeviceAdaptorRingBuffer<TimedUnsigned>(16);
+    setPayloadFormat(1);
+    alsBuffer_ = new DeviceAdaptorRingBuffer<TimedUnsigned>(ringSize("als", 16));
     setAdaptedSensor("als", "Internal ambient light sensor lux values", alsBuffer_);
 
     setDescription("Ambient light");
@@ -51,23 +53,18 @@ OEMTabletALSAdaptorAscii::~OEMTabletALSAdaptorAscii()
     delete alsBuffer_;
 }
 
-void OEMTabletALSAdaptorAscii::processSample(int pathId, int fd) {
+void OEMTabletALSAdaptorAscii::processValues(int pathId, const long* values, int count) {
     Q_UNUSED(pathId);
+    Q_UNUSED(count);
 
-    if (read(fd, buf, sizeof(buf)) <= 0) {
-        sensordLogW() << "read():" << strerror(errno);
-        return;
-    }
-    buf[sizeof(buf)-1] = '\0';
-
-    sensordLogT() << "Ambient light value: " << buf;
+    sensordTraceRate(SENSORD_TRACE_RATE) << "Ambient light value: " << values[0];
 
-    __u16 idata = atoi(buf);
+    __u16 idata = values[0];
 
     TimedUnsigned* lux = alsBuffer_->nextSlot();
 
     lux->value_ = idata;
-    lux->timestamp_ = Utils::getTimeStamp();
+    lux->timestamp_ = sampleTimestamp();
 
     alsBuffer_->commit();
     alsBuffer_->wakeUpReaders();
@@ -9,7 +9,7 @@
 OEMTabletGyroscopeAdaptor::OEMTabletGyroscopeAdaptor(const QString& id) :
     SysfsAdaptor(id, SysfsAdaptor::IntervalMode)
 {
-    gyroscopeBuffer_ = new DeviceAdaptorRingBuffer<TimedXyzData>(32);
+    gyroscopeBuffer_ = new DeviceAdaptorRingBuffer<TimedXyzData>(ringSize("gyroscope", 32));
 
     setAdaptedSensor("gyroscope", "mpu3050", gyroscopeBuffer_);
 
@@ -41,7 +41,7 @@ void OEMTabletGyroscopeAdaptor::processSample(int pathId, int fd)
     pos->x_ = x;
     pos->y_ = y;
     pos->z_ = z;
-    pos->timestamp_ = Utils::getTimeStamp();
+    pos->timestamp_ = sampleTimestamp();
 
     gyroscopeBuffer_->commit();
     gyroscopeBuffer_->wakeUpReaders();
@@ -15,7 +15,7 @@ OemtabletMagnetometerAdaptor::OemtabletMagnetometerAdaptor(const QString& id) :
         return;
     }
     addPath(SYSFS_MAGNET_PATH, devId);
-    magnetBuffer_ = new DeviceAdaptorRingBuffer<TimedXyzData>(16);
+    magnetBuffer_ = new DeviceAdaptorRingBuffer<TimedXyzData>(ringSize("magnetometer", 16));
     addAdaptedSensor("magnetometer", "ak8974 ascii", magnetBuffer_);
 
     setDescription("OEM tablet magnetometer");
@@ -50,7 +50,7 @@ void OemtabletMagnetometerAdaptor::processSample(int pathId, int fd)
     pos->x_ = x;
     pos->y_ = y;
     pos->z_ = z;
-    pos->timestamp_ = Utils::getTimeStamp();
+    pos->timestamp_ = sampleTimestamp();
 
     magnetBuffer_->commit();
     magnetBuffer_->wakeUpReaders();
@@ -26,7 +26,7 @@ PegatronAccelerometerAdaptor::PegatronAccelerometerAdaptor(const QString& id) :
         sensordLogW() << "Input device not found.";
     }
 
-    accelerometerBuffer_ = new DeviceAdaptorRingBuffer<OrientationData>(128);
+    accelerometerBuffer_ = new DeviceAdaptorRingBuffer<OrientationData>(ringSize("accelerometer", 128));
     setAdaptedSensor("accelerometer", "Internal accelerometer coordinates", accelerometerBuffer_);
 
     // Set Metadata
@@ -35,6 +35,11 @@ PegatronAccelerometerAdaptor::PegatronAccelerometerAdaptor(const QString& id) :
     introduceAvailableInterval(DataRange(0, 0, 0));
     introduceAvailableInterval(DataRange(50, 2000, 0)); // -> [1,100] Hz
     setDefaultInterval(300);
+
+    setEventHandling(EventIgnored);
+    setEventHandling(EV_ABS, ABS_X, EventTracked);
+    setEventHandling(EV_ABS, ABS_Y, EventTracked);
+    setEventHandling(EV_ABS, ABS_Z, EventTracked);
 }
 
 PegatronAccelerometerAdaptor::~PegatronAccelerometerAdaptor()
@@ -42,31 +47,13 @@ PegatronAccelerometerAdaptor::~PegatronAccelerometerAdaptor()
     delete accelerometerBuffer_;
 }
 
-void PegatronAccelerometerAdaptor::interpretEvent(int src, struct input_event *ev)
+void PegatronAccelerometerAdaptor::interpretFrame(int src, const InputFrame& frame, struct input_event *ev)
 {
     Q_UNUSED(src);
 
-    switch (ev->type) {
-        case EV_ABS:
-            switch (ev->code) {
-                case ABS_X:
-                    orientationValue_.x_ = ev->value;
-                    break;
-                case ABS_Y:
-                    orientationValue_.y_ = ev->value;
-                    break;
-                case ABS_Z:
-                    orientationValue_.z_ = ev->value;
-                    break;
-            }
-            break;
-
-    }
-}
-
-void PegatronAccelerometerAdaptor::interpretSync(int src, struct input_event *ev)
-{
-    Q_UNUSED(src);
+    orientationValue_.x_ = frame.absValue(ABS_X);
+    orientationValue_.y_ = frame.absValue(ABS_Y);
+    orientationValue_.z_ = frame.absValue(ABS_Z);
     commitOutput(ev);
 }
 
@@ -37,9 +37,8 @@ private:
     OrientationData orientationValue_;
     QTime time;
 
-    void interpretEvent(int src, struct input_event *ev);
+    void interpretFrame(int src, const InputFrame& frame, struct input_event *ev);
     void commitOutput(struct input_event *ev);
-    void interpretSync(int src, struct input_event *ev);
 };
 
 #endif
@@ -42,8 +42,9 @@
 ProximityAdaptorAscii::ProximityAdaptorAscii(const QString& id) :
     SysfsAdaptor(id, SysfsAdaptor::IntervalMode)
 {
-    proximityBuffer_ = new DeviceAdaptorRingBuffer<ProximityData>(1);
+    proximityBuffer_ = new DeviceAdaptorRingBuffer<ProximityData>(ringSize("proximity", 1));
     setAdaptedSensor("proximity", "apds9802ps ascii", proximityBuffer_);
+    setPayloadFormat(1);
 }
 
 ProximityAdaptorAscii::~ProximityAdaptorAscii()
@@ -51,20 +52,14 @@ ProximityAdaptorAscii::~ProximityAdaptorAscii()
     delete proximityBuffer_;
 }
 
-void ProximityAdaptorAscii::processSample(int, int fd)
+void ProximityAdaptorAscii::processValues(int, const long* values, int)
 {
-    char buf[16];
-    lseek(fd, 0, SEEK_SET);
-    if (read(fd, buf, sizeof(buf)) <= 0) {
-        sensordLogW() << "read(): " << strerror(errno);
-        return;
-    }
-    sensordLogT() << "Proximity output value: " << buf;
+    sensordLogT() << "Proximity output value: " << values[0];
 
     ProximityData* proximity = proximityBuffer_->nextSlot();
-    sscanf(buf, "%d", &proximity->value_);
+    proximity->value_ = values[0];
     proximity->withinProximity_ = proximity->value_;
-    proximity->timestamp_ = Utils::getTimeStamp();
+    proximity->timestamp_ = sampleTimestamp();
     proximityBuffer_->commit();
     proximityBuffer_->wakeUpReaders();
 }
@@ -50,7 +50,7 @@ protected:
     ~ProximityAdaptorAscii();
 
 private:
-    void processSample(int pathId, int fd);
+    void processValues(int pathId, const long* values, int count);
 
     DeviceAdaptorRingBuffer<ProximityData>* proximityBuffer_;
 };
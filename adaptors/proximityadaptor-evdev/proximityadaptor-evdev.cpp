@@ -43,8 +43,11 @@ ProximityAdaptorEvdev::ProximityAdaptorEvdev(const QString& id) :
     InputDevAdaptor(id, 1),
     currentState_(ProximityStateUnknown)
 {
-    proximityBuffer_ = new DeviceAdaptorRingBuffer<ProximityData>(1);
+    proximityBuffer_ = new DeviceAdaptorRingBuffer<ProximityData>(ringSize("proximity", 1));
     setAdaptedSensor("proximity", "Proximity state", proximityBuffer_);
+
+    setEventHandling(EventIgnored);
+    setEventHandling(SELFDEF_EV_SW, SELFDEF_EV_FRONT_PROXIMITY, EventTracked);
 }
 
 ProximityAdaptorEvdev::~ProximityAdaptorEvdev()
@@ -52,38 +55,13 @@ ProximityAdaptorEvdev::~ProximityAdaptorEvdev()
     delete proximityBuffer_;
 }
 
-void ProximityAdaptorEvdev::interpretEvent(int src, struct input_event *ev)
+void ProximityAdaptorEvdev::interpretFrame(int src, const InputFrame& frame, struct input_event *ev)
 {
     Q_UNUSED(src);
 
-    switch (ev->type) {
-        case SELFDEF_EV_SW:
-        {
-            switch (ev->code) {
-                case SELFDEF_EV_FRONT_PROXIMITY:
-                {
-                    if (ev->value == 0) {
-                        currentState_ = ProximityStateOpen;
-                    }
-                    else if (ev->value == 1) {
-                        currentState_ = ProximityStateClosed;
-                    }
-                    else {
-                        currentState_ = ProximityStateUnknown;
-                    }
-                }
-                break;
-                default: break;
-            }
-        }
-        break;
-        default: break;
+    if (frame.switchChanged(SELFDEF_EV_FRONT_PROXIMITY)) {
+        currentState_ = frame.switchValue(SELFDEF_EV_FRONT_PROXIMITY) ? ProximityStateClosed : ProximityStateOpen;
     }
-}
-
-void ProximityAdaptorEvdev::interpretSync(int src, struct input_event *ev)
-{
-    Q_UNUSED(src);
     commitOutput(ev);
 }
 
@@ -73,9 +73,8 @@ private:
     DeviceAdaptorRingBuffer<ProximityData>*   proximityBuffer_;
     ProximityState                            currentState_;
 
-    void interpretEvent(int src, struct input_event *ev);
+    void interpretFrame(int src, const InputFrame& frame, struct input_event *ev);
     void commitOutput(struct input_event *ev);
-    void interpretSync(int src, struct input_event *ev);
 };
 
 #endif
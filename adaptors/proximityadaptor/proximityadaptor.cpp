@@ -51,7 +51,8 @@ struct apds990x_data {
 } __attribute__((packed));
 
 ProximityAdaptor::ProximityAdaptor(const QString& id) :
-    SysfsAdaptor(id, SysfsAdaptor::SelectMode, false)
+    SysfsAdaptor(id, SysfsAdaptor::SelectMode, false),
+    thresholds_("proximity")
 {
 
 #ifdef SENSORFW_MCE_WATCHER
@@ -68,7 +69,7 @@ ProximityAdaptor::ProximityAdaptor(const QString& id) :
         dbusIfc_->call(QDBus::NoBlock, "req_proximity_sensor_enable");
 #endif
     }
-    proximityBuffer_ = new DeviceAdaptorRingBuffer<ProximityData>(1);
+    proximityBuffer_ = new DeviceAdaptorRingBuffer<ProximityData>(ringSize("proximity", 1));
     setAdaptedSensor("proximity", "Proximity state", proximityBuffer_);
     setDescription("Proximity sensor readings (Dipro sensor)");
 }
@@ -89,7 +90,12 @@ bool ProximityAdaptor::startSensor()
 {
     if(deviceType_ == NCDK && !powerStatePath_.isEmpty())
     {
-        writeToFile(powerStatePath_, "1");
+        writeControl(powerStatePath_, "1");
+    }
+    // Reader is not running yet, the window is not being moved
+    if (!isRunning())
+    {
+        thresholds_.close(*this);
     }
     return SysfsAdaptor::startSensor();
 }
@@ -98,7 +104,7 @@ void ProximityAdaptor::stopSensor()
 {
     if(deviceType_ == NCDK && !powerStatePath_.isEmpty())
     {
-        writeToFile(powerStatePath_, "0");
+        writeControl(powerStatePath_, "0");
     }
     SysfsAdaptor::stopSensor();
 }
@@ -165,9 +171,17 @@ void ProximityAdaptor::processSample(int pathId, int fd)
         return;
     }
 
+    if (thresholds_.isEnabled())
+    {
+        if (ret)
+            thresholds_.program(*this, threshold_ + 1, thresholds_.maximum());
+        else
+            thresholds_.program(*this, 0, threshold_);
+    }
+
     ProximityData* proximityData = proximityBuffer_->nextSlot();
 
-    proximityData->timestamp_ = Utils::getTimeStamp();
+    proximityData->timestamp_ = sampleTimestamp();
     proximityData->withinProximity_ = ret;
     proximityData->value_ = rawdata;
     proximityBuffer_->commit();
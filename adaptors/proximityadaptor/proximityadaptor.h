@@ -29,12 +29,14 @@
 #ifndef PROXIMITYADAPTOR_H
 #define PROXIMITYADAPTOR_H
 
-#include <QDBusInterface>
 #include "sysfsadaptor.h"
 #include "deviceadaptorringbuffer.h"
+#include "thresholdwindow.h"
 #include "datatypes/orientationdata.h"
 
 #ifdef SENSORFW_MCE_WATCHER
+#include <QDBusInterface>
+
 // these come from mce/mode-names.h
 // and mce/dbus-names.h
 #define MCE_SERVICE                     "com.nokia.mce"
@@ -48,6 +50,10 @@
  * Adaptor for proximity. Uses SysFs driver interface in interval
  * polling mode, i.e. values are read with given constant interval.
  *
+ * With proximity/threshold_low_path and proximity/threshold_high_path set,
+ * the interrupt window of the chip ends at proximity/threshold on the side
+ * of the current state, so the adaptor only wakes up when the state
+ * changes. Readings within a state are not reported then.
  */
 class ProximityAdaptor : public SysfsAdaptor
 {
@@ -98,6 +104,7 @@ private:
     int threshold_;
     ProximityAdaptor::DeviceType deviceType_;
     QByteArray powerStatePath_;
+    ThresholdWindow thresholds_;
 
 #ifdef SENSORFW_MCE_WATCHER
     QDBusInterface *dbusIfc_;
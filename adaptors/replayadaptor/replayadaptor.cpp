@@ -0,0 +1,238 @@
+/**
+   @file replayadaptor.cpp
+   @brief ReplayAdaptor
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+*/
+
+#include "replayadaptor.h"
+#include "config.h"
+#include "logging.h"
+#include "datatypes/atomic.h"
+#include <errno.h>
+#include <limits.h>
+#include <string.h>
+#include <time.h>
+
+/** Longest single sleep, bounds the time stopSensor() waits for the thread */
+static const quint64 MAX_SLEEP_NS = 100000000ULL;
+
+static quint64 monotonicNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+ReplayThread::ReplayThread(ReplayAdaptor* parent) :
+    parent_(parent)
+{
+}
+
+void ReplayThread::run()
+{
+    parent_->replay();
+}
+
+ReplayAdaptor::ReplayAdaptor(const QString& id) :
+    DeviceAdaptor(id),
+    running_(0),
+    block_(-1),
+    period_(0),
+    replayed_(0)
+{
+    QString sensor = id.contains("magnetometer") ? "magnetometer" : "accelerometer";
+
+    QString file = Config::configuration()->value<QString>(sensor + "/replay_file", "");
+    speed_ = qMax(0.0, Config::configuration()->value<double>(sensor + "/replay_speed", 1.0));
+    loop_ = Config::configuration()->value<bool>(sensor + "/replay_loop", true);
+    batch_ = qMax(1u, Config::configuration()->value<unsigned int>(sensor + "/replay_batch", 32));
+
+    if (file.isEmpty()) {
+        sensordLogW() << "No " << sensor << "/replay_file configured";
+    } else if (TraceArchive::probe(file)) {
+        if (archive_.open(file) && archive_.count() > 1)
+            period_ = (archive_.block(archive_.blockCount() - 1).lastTimestamp -
+                       archive_.block(0).firstTimestamp) / (archive_.count() - 1);
+    } else if (trace_.open(file) && trace_.count() > 1) {
+        period_ = (trace_.at(trace_.count() - 1).timestamp - trace_.at(0).timestamp) / (trace_.count() - 1);
+    }
+
+    thread_ = new ReplayThread(this);
+    buffer_ = new DeviceAdaptorRingBuffer<TimedXyzData>(qMax(1024u, 4 * batch_));
+    setAdaptedSensor(sensor, "Replayed " + sensor + " trace", buffer_);
+    setDescription(QString("Replay of %1, %2 samples").arg(file).arg(count()));
+}
+
+ReplayAdaptor::~ReplayAdaptor()
+{
+    stopSensor();
+    delete thread_;
+    delete buffer_;
+}
+
+bool ReplayAdaptor::startAdaptor()
+{
+    return true;
+}
+
+void ReplayAdaptor::stopAdaptor()
+{
+}
+
+void ReplayAdaptor::init()
+{
+    introduceAvailableDataRanges(name());
+    if (getAvailableDataRanges().isEmpty())
+        introduceAvailableDataRange(DataRange(INT_MIN, INT_MAX, 1));
+    introduceAvailableIntervals(name());
+    if (getAvailableIntervals().isEmpty())
+        introduceAvailableInterval(DataRange(0, 1000, 0));
+}
+
+bool ReplayAdaptor::startSensor()
+{
+    if (Atomic::load(running_))
+        return true;
+    if (count() == 0) {
+        sensordLogW() << "Nothing to replay for " << name();
+        return false;
+    }
+    sensordLogD() << "Replaying " << count() << " samples for " << name() << " at speed " << speed_
+                  << (loop_ ? ", looping" : "");
+    Atomic::store(running_, 1);
+    thread_->start();
+    return true;
+}
+
+void ReplayAdaptor::stopSensor()
+{
+    if (!Atomic::load(running_))
+        return;
+    Atomic::store(running_, 0);
+    thread_->wait();
+    sensordLogD() << "Replay stopped after " << replayed_ << " samples";
+}
+
+unsigned int ReplayAdaptor::interval() const
+{
+    if (speed_ <= 0)
+        return 1;
+    return qMax(1u, (unsigned)(period_ / speed_ / 1000));
+}
+
+bool ReplayAdaptor::setInterval(const unsigned int value, const int sessionId)
+{
+    sensordLogT() << "Ignoring interval " << value << " of session " << sessionId << ", timing comes from the trace";
+    return true;
+}
+
+bool ReplayAdaptor::waitUntil(quint64 deadline)
+{
+    quint64 now;
+    while (Atomic::load(running_) && (now = monotonicNs()) < deadline) {
+        quint64 wake = qMin(deadline, now + MAX_SLEEP_NS);
+        struct timespec ts;
+        ts.tv_sec = wake / 1000000000ULL;
+        ts.tv_nsec = wake % 1000000000ULL;
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+            ;
+    }
+    return Atomic::load(running_);
+}
+
+void ReplayAdaptor::replay()
+{
+    const unsigned total = count();
+    const quint64 first = record(0).timestamp;
+    quint64 start = monotonicNs();
+    quint64 due = start;
+    quint64 last = 0;
+    unsigned pending = 0;
+
+    while (Atomic::load(running_)) {
+        for (unsigned i = 0; i < total && Atomic::load(running_); ++i) {
+            const SensorTraceRecord& sample = record(i);
+            if (speed_ > 0) {
+                // Records going back in time are replayed immediately.
+                quint64 offset = sample.timestamp > first ? sample.timestamp - first : 0;
+                due = start + (quint64)(offset * 1000 / speed_);
+                if (pending && (pending >= batch_ || due > monotonicNs())) {
+                    endBatch();
+                    pending = 0;
+                }
+                if (!waitUntil(due))
+                    break;
+            } else if (pending >= batch_) {
+                endBatch();
+                pending = 0;
+                QThread::yieldCurrentThread();
+            }
+            if (!pending) {
+                beginBatch();
+                if (speed_ <= 0)
+                    due = monotonicNs();
+            }
+            last = qMax(due / 1000, last);
+            commitSample(sample, last);
+            ++pending;
+        }
+        if (!loop_)
+            break;
+        // Continue one mean period after the last record.
+        if (speed_ > 0)
+            start = due + (quint64)(period_ * 1000 / speed_);
+    }
+    if (pending)
+        endBatch();
+    if (!loop_)
+        sensordLogD() << "Replay of " << name() << " reached end of trace";
+}
+
+unsigned ReplayAdaptor::count() const
+{
+    return archive_.blockCount() ? archive_.count() : trace_.count();
+}
+
+const SensorTraceRecord& ReplayAdaptor::record(unsigned index)
+{
+    if (!archive_.blockCount())
+        return trace_.at(index);
+
+    int block = index / archive_.blockSize();
+    if (block != block_) {
+        decoded_.resize(archive_.blockSize());
+        if (!archive_.decode(block, decoded_.data())) {
+            sensordLogW() << "Block " << block << " of replayed archive is corrupted";
+            memset(decoded_.data(), 0, decoded_.size() * sizeof(SensorTraceRecord));
+        }
+        block_ = block;
+    }
+    return decoded_.at(index % archive_.blockSize());
+}
+
+void ReplayAdaptor::commitSample(const SensorTraceRecord& record, quint64 timestamp)
+{
+    TimedXyzData* sample = buffer_->nextSlot();
+    sample->timestamp_ = timestamp;
+    sample->x_ = record.x;
+    sample->y_ = record.y;
+    sample->z_ = record.z;
+    buffer_->commit();
+    buffer_->wakeUpReaders();
+    ++replayed_;
+}
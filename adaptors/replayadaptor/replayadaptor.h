@@ -0,0 +1,153 @@
+/**
+   @file replayadaptor.h
+   @brief ReplayAdaptor
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+*/
+
+#ifndef REPLAYADAPTOR_H
+#define REPLAYADAPTOR_H
+
+#include "deviceadaptor.h"
+#include "deviceadaptorringbuffer.h"
+#include "datatypes/orientationdata.h"
+#include "datatypes/sensortrace.h"
+#include "datatypes/tracearchive.h"
+#include <QVector>
+#include <QAtomicInt>
+#include <QThread>
+
+class ReplayAdaptor;
+
+/**
+ * Thread replaying samples for ReplayAdaptor.
+ */
+class ReplayThread : public QThread
+{
+    Q_OBJECT
+public:
+    ReplayThread(ReplayAdaptor* parent);
+    void run();
+
+private:
+    ReplayAdaptor* parent_;
+};
+
+/**
+ * @brief Adaptor replaying a recorded sensor trace.
+ *
+ * Replaces a real accelerometer or magnetometer adaptor for
+ * reproducible benchmarks, e.g. with <code>plugins/accelerometeradaptor =
+ * replayadaptor</code>. The trace (see SensorTrace) or trace archive (see
+ * TraceArchive) is memory mapped and its records are restamped with the
+ * replay clock so that client side latency can be measured against the
+ * real clock. Archive blocks are decoded one at a time as the replay
+ * reaches them.
+ *
+ * Configured from the adapted sensor section (accelerometer or
+ * magnetometer):
+ * <ul>
+ * <li><em>replay_file</em> trace or trace archive file path.</li>
+ * <li><em>replay_speed</em> timing scale, default 1.0 for original
+ *     timing, 2.0 for twice as fast. 0 replays as fast as possible.</li>
+ * <li><em>replay_loop</em> restart from the beginning at the end of the
+ *     trace, default true.</li>
+ * <li><em>replay_batch</em> maximum samples committed per wakeup,
+ *     default 32.</li>
+ * </ul>
+ * Session interval requests are accepted but do not change the timing.
+ */
+class ReplayAdaptor : public DeviceAdaptor
+{
+    Q_OBJECT
+public:
+    static DeviceAdaptor* factoryMethod(const QString& id)
+    {
+        return new ReplayAdaptor(id);
+    }
+
+    bool startAdaptor();
+    void stopAdaptor();
+
+    bool startSensor();
+    void stopSensor();
+
+    void init();
+
+protected:
+    ReplayAdaptor(const QString& id);
+    ~ReplayAdaptor();
+
+    unsigned int interval() const;
+
+    bool setInterval(const unsigned int value, const int sessionId);
+
+private:
+    friend class ReplayThread;
+
+    /**
+     * Replay the trace until stopped or, when not looping, until its end.
+     */
+    void replay();
+
+    /**
+     * Wait until given time or until stopped.
+     *
+     * @param deadline monotonic time in nanoseconds.
+     * @return is the replay still running.
+     */
+    bool waitUntil(quint64 deadline);
+
+    /**
+     * Number of records in the trace or archive.
+     *
+     * @return record count.
+     */
+    unsigned count() const;
+
+    /**
+     * Record of the trace or archive. Archive records are valid until a
+     * record of another block is requested.
+     *
+     * @param index record index, less than #count().
+     * @return record, zeroed if its archive block is corrupted.
+     */
+    const SensorTraceRecord& record(unsigned index);
+
+    /**
+     * Write one sample into the output buffer.
+     *
+     * @param record traced sample.
+     * @param timestamp replay timestamp in microseconds.
+     */
+    void commitSample(const SensorTraceRecord& record, quint64 timestamp);
+
+    ReplayThread*                          thread_;   /**< replay thread */
+    DeviceAdaptorRingBuffer<TimedXyzData>* buffer_;   /**< output buffer */
+    SensorTrace                            trace_;    /**< mapped trace */
+    TraceArchive                           archive_;  /**< mapped archive, used if open */
+    QVector<SensorTraceRecord>             decoded_;  /**< records of the decoded archive block */
+    int                                    block_;    /**< decoded archive block, -1 for none */
+    QAtomicInt                             running_;  /**< is replay running */
+    double                                 speed_;    /**< timing scale, 0 for no timing */
+    bool                                   loop_;     /**< restart at end of trace */
+    unsigned                               batch_;    /**< maximum samples per wakeup */
+    unsigned                               period_;   /**< mean trace period in microseconds */
+    quint64                                replayed_; /**< samples replayed */
+};
+
+#endif
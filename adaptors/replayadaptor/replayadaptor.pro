@@ -0,0 +1,9 @@
+TARGET       = replayadaptor
+
+HEADERS += replayadaptor.h \
+           replayadaptorplugin.h
+
+SOURCES += replayadaptor.cpp \
+           replayadaptorplugin.cpp
+
+include( ../adaptor-config.pri )
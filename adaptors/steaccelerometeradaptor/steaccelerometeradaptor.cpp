@@ -16,7 +16,7 @@
 SteAccelAdaptor::SteAccelAdaptor(const QString& id) :
     SysfsAdaptor(id, SysfsAdaptor::IntervalMode)
 {
-    buffer = new DeviceAdaptorRingBuffer<OrientationData>(128);
+    buffer = new DeviceAdaptorRingBuffer<OrientationData>(ringSize("accelerometer", 128));
     setAdaptedSensor("accelerometer", "ste accelerometer", buffer);
     introduceAvailableInterval(DataRange(50, 1000, 0));
 
@@ -83,7 +83,7 @@ SteAccelAdaptor::~SteAccelAdaptor()
 bool SteAccelAdaptor::startSensor()
 {
     if(!powerStatePath.isEmpty()) {
-        writeToFile(powerStatePath, range);
+        writeControl(powerStatePath, range);
     }
 
     if ( !(SysfsAdaptor::startSensor()) )
@@ -95,7 +95,7 @@ bool SteAccelAdaptor::startSensor()
 void SteAccelAdaptor::stopSensor()
 {
     if(!powerStatePath.isEmpty()) {
-        writeToFile(powerStatePath, "0");
+        writeControl(powerStatePath, "0");
     }
     SysfsAdaptor::stopSensor();
 }
@@ -126,7 +126,7 @@ void SteAccelAdaptor::processSample(int pathId, int fd)
 
     AccelerationData *d = buffer->nextSlot();
 
-    d->timestamp_ = Utils::getTimeStamp();
+    d->timestamp_ = sampleTimestamp();
 
     d->x_ = x * 0.1 * 9.812865328;
     d->y_ = y * 0.1 * 9.812865328;
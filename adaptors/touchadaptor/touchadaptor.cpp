@@ -33,11 +33,11 @@
 #include <linux/input.h>
 #include <unistd.h>
 
-const int TouchAdaptor::HARD_MAX_TOUCH_POINTS = 5;
+const int TouchAdaptor::HARD_MAX_TOUCH_POINTS;
 
 TouchAdaptor::TouchAdaptor(const QString& id) : InputDevAdaptor(id, HARD_MAX_TOUCH_POINTS)
 {
-    outputBuffer_ = new DeviceAdaptorRingBuffer<TouchData>(1);
+    outputBuffer_ = new DeviceAdaptorRingBuffer<TouchData>(ringSize("touch", HARD_MAX_TOUCH_POINTS));
     setAdaptedSensor("touch", "Touch screen input", outputBuffer_);
     setDescription("Touch screen events");
 }
@@ -107,6 +107,9 @@ bool TouchAdaptor::checkInputDevice(QString path, QString matchString)
 
 void TouchAdaptor::interpretEvent(int src, struct input_event *ev)
 {
+    DeviceContacts& device = contacts_[src];
+    TouchValues* contact = device.slot >= 0 ? &device.slots[device.slot] : NULL;
+
     switch (ev->type) {
 
         case EV_SYN:
@@ -116,13 +119,45 @@ void TouchAdaptor::interpretEvent(int src, struct input_event *ev)
         case EV_ABS:
             switch (ev->code) {
                 case ABS_X:
-                    touchValues_[src].x = ev->value;
+                    device.single.x = ev->value;
+                    device.single.changed = true;
                     break;
                 case ABS_Y:
-                    touchValues_[src].y = ev->value;
+                    device.single.y = ev->value;
+                    device.single.changed = true;
                     break;
                 case ABS_Z:
-                    touchValues_[src].z = ev->value;
+                    device.single.z = ev->value;
+                    device.single.changed = true;
+                    break;
+                case ABS_MT_SLOT:
+                    device.multiTouch = true;
+                    device.slot = (ev->value >= 0 && ev->value < HARD_MAX_TOUCH_POINTS) ? ev->value : -1;
+                    break;
+                case ABS_MT_TRACKING_ID:
+                    device.multiTouch = true;
+                    if (contact) {
+                        contact->fingerState = ev->value < 0 ? TouchData::FingerStateNotPresent : TouchData::FingerStateAccurate;
+                        contact->changed = true;
+                    }
+                    break;
+                case ABS_MT_POSITION_X:
+                    if (contact) {
+                        contact->x = ev->value;
+                        contact->changed = true;
+                    }
+                    break;
+                case ABS_MT_POSITION_Y:
+                    if (contact) {
+                        contact->y = ev->value;
+                        contact->changed = true;
+                    }
+                    break;
+                case ABS_MT_PRESSURE:
+                    if (contact) {
+                        contact->z = ev->value;
+                        contact->changed = true;
+                    }
                     break;
             }
             break;
@@ -131,15 +166,17 @@ void TouchAdaptor::interpretEvent(int src, struct input_event *ev)
             switch (ev->code) {
                 case BTN_TOUCH:
                     if (ev->value) {
-                        touchValues_[src].fingerState = TouchData::FingerStateAccurate;
+                        device.single.fingerState = TouchData::FingerStateAccurate;
                     } else {
-                        touchValues_[src].fingerState = TouchData::FingerStateNotPresent;
+                        device.single.fingerState = TouchData::FingerStateNotPresent;
                     }
+                    device.single.changed = true;
                     break;
 
                 case BTN_MODE:
-                    if (ev->value && touchValues_[src].fingerState!=TouchData::FingerStateNotPresent) {
-                        touchValues_[src].fingerState = TouchData::FingerStateInaccurate;
+                    if (ev->value && device.single.fingerState!=TouchData::FingerStateNotPresent) {
+                        device.single.fingerState = TouchData::FingerStateInaccurate;
+                        device.single.changed = true;
                     }
                     break;
             }
@@ -153,16 +190,39 @@ void TouchAdaptor::interpretSync(int src, struct input_event *ev)
 }
 
 void TouchAdaptor::commitOutput(int src, struct input_event *ev)
+{
+    DeviceContacts& device = contacts_[src];
+    quint64 timestamp = Utils::getTimeStamp(&(ev->time));
+
+    // Contacts of a frame are committed together and readers woken up
+    // once. Multi-touch devices also report their first contact through
+    // ABS_X and ABS_Y, only the slots are used for them, and only slots
+    // changed in the frame are re-emitted.
+    outputBuffer_->deferWakeups();
+    if (device.multiTouch) {
+        for (int slot = 0; slot < HARD_MAX_TOUCH_POINTS; ++slot) {
+            if (device.slots[slot].changed)
+                commitContact(device.slots[slot], src * HARD_MAX_TOUCH_POINTS + slot, timestamp);
+        }
+        device.single.changed = false;
+    } else if (device.single.changed) {
+        commitContact(device.single, src, timestamp);
+    }
+    outputBuffer_->flushWakeups();
+}
+
+void TouchAdaptor::commitContact(TouchValues& values, int object, quint64 timestamp)
 {
     TouchData* d = outputBuffer_->nextSlot();
 
-    d->timestamp_ = Utils::getTimeStamp(&(ev->time));
-    d->x_ = touchValues_[src].x;
-    d->y_ = touchValues_[src].y;
-    d->z_ = touchValues_[src].z;
-    d->object_ = src;
-    d->state_ = touchValues_[src].fingerState;
+    d->timestamp_ = timestamp;
+    d->x_ = values.x;
+    d->y_ = values.y;
+    d->z_ = values.z;
+    d->object_ = object;
+    d->state_ = values.fingerState;
 
     outputBuffer_->commit();
     outputBuffer_->wakeUpReaders();
+    values.changed = false;
 }
@@ -61,18 +61,35 @@ protected:
 
 private:
 
-    static const int HARD_MAX_TOUCH_POINTS;
+    static const int HARD_MAX_TOUCH_POINTS = 5;
 
     /**
      * Holds values read from the driver.
      */
     struct TouchValues {
+        TouchValues() : x(0), y(0), z(0), volume(0), toolWidth(0),
+                        fingerState(TouchData::FingerStateNotPresent), changed(false) {};
+
         int x;
         int y;
         int z;
         int volume;
         int toolWidth;
         TouchData::FingerState fingerState;
+        bool changed; /**< Updated since the last frame was committed */
+    };
+
+    /**
+     * Contacts of one input device. Devices using multi-touch protocol B
+     * report contacts in slots, others report a single contact.
+     */
+    struct DeviceContacts {
+        DeviceContacts() : slot(0), multiTouch(false) {};
+
+        TouchValues single;                        /**< Contact from ABS_X and ABS_Y */
+        TouchValues slots[HARD_MAX_TOUCH_POINTS];  /**< Contacts from multi-touch slots */
+        int slot;                                  /**< Slot receiving events, -1 if out of range */
+        bool multiTouch;                           /**< Device reports multi-touch slots */
     };
 
     /**
@@ -101,15 +118,24 @@ private:
     void interpretEvent(int src, struct input_event *ev);
 
     /**
-     * Pushes recorded events into filterchain.
+     * Pushes contacts changed during the frame into filterchain and
+     * wakes up readers once for the whole frame.
      * @param src Event source.
      */
     void commitOutput(int src, struct input_event *ev);
 
+    /**
+     * Store a contact into output buffer.
+     * @param values Contact values.
+     * @param object Contact identifier.
+     * @param timestamp Frame timestamp.
+     */
+    void commitContact(TouchValues& values, int object, quint64 timestamp);
+
     void interpretSync(int src, struct input_event *ev);
 
     DeviceAdaptorRingBuffer<TouchData>* outputBuffer_;
-    TouchValues touchValues_[5];
+    DeviceContacts contacts_[HARD_MAX_TOUCH_POINTS];
     RangeInfo rangeInfo_;
 };
 
@@ -0,0 +1,31 @@
+QT += network
+TARGET = sensorclient-c
+
+TEMPLATE = lib
+
+include( ../common-config.pri )
+
+SOURCES += sensorfw-c.cpp \
+    sessionreceiver.cpp
+
+HEADERS += sensorfw-c.h \
+    sessionreceiver.h
+
+SENSORFW_INCLUDEPATHS = .. \
+    ../include \
+    ../datatypes \
+    ../core \
+    ../qt-api
+
+DEPENDPATH += $$SENSORFW_INCLUDEPATHS
+INCLUDEPATH += $$SENSORFW_INCLUDEPATHS
+equals(QT_MAJOR_VERSION, 4): {
+    QMAKE_LIBDIR_FLAGS += -L../qt-api -lsensorclient -L../datatypes -lsensordatatypes
+}
+equals(QT_MAJOR_VERSION, 5): {
+    QMAKE_LIBDIR_FLAGS += -L../qt-api -lsensorclient-qt5 -L../datatypes -lsensordatatypes-qt5
+}
+include(../common-install.pri)
+publicheaders.files = sensorfw-c.h
+target.path = $$SHAREDLIBPATH
+INSTALLS += target
@@ -0,0 +1,468 @@
+/**
+   @file sensorfw-c.cpp
+   @brief C-API for sensor framework
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include <QCoreApplication>
+#include <QLocalSocket>
+#include <QMap>
+#include "idutils.h"
+#include "sensormanagerinterface.h"
+#include "accelerometersensor_i.h"
+#include "alssensor_i.h"
+#include "compasssensor_i.h"
+#include "fusionsensor_i.h"
+#include "gyroscopesensor_i.h"
+#include "integratedgyroscopesensor_i.h"
+#include "magnetometersensor_i.h"
+#include "orientationsensor_i.h"
+#include "proximitysensor_i.h"
+#include "rotationsensor_i.h"
+#include "statisticssensor_i.h"
+#include "tapsensor_i.h"
+#include "sessionreceiver.h"
+#include "samplepredictor.h"
+#include "sensorfw-c.h"
+
+/** Samples queued per session for sensorfw_read_batch() */
+static const unsigned int QUEUE_SIZE = 1024;
+
+/**
+ * Sensor known to the C API.
+ */
+struct SensorType
+{
+    const char*  name;                        /**< sensor name */
+    void         (*registerInterface)(const char* name); /**< interface registration */
+    unsigned int sampleSize;                  /**< size of samples sent by sensord */
+    SampleValues values;                      /**< values for prediction, NULL if not predictable */
+    int          valueCount;                  /**< number of values */
+};
+
+template<class SensorInterfaceType>
+static void registerInterface(const char* name)
+{
+    SensorManagerInterface::instance().registerSensorInterface<SensorInterfaceType>(name);
+}
+
+template<class Sample>
+static void xyzValues(const void* sample, quint64& timestamp, double* values)
+{
+    const Sample& data = *(const Sample*)sample;
+    timestamp = data.timestamp_;
+    values[0] = data.x_;
+    values[1] = data.y_;
+    values[2] = data.z_;
+}
+
+static void fusionValues(const void* sample, quint64& timestamp, double* values)
+{
+    const FusionData& data = *(const FusionData*)sample;
+    timestamp = data.timestamp_;
+    for (int i = 0; i < 3; ++i) {
+        values[i] = data.accelerometer_[i];
+        values[3 + i] = data.gyroscope_[i];
+        values[6 + i] = data.magnetometer_[i];
+    }
+}
+
+static const SensorType SENSOR_TYPES[] = {
+    { "accelerometersensor", &registerInterface<AccelerometerSensorChannelInterface>, sizeof(AccelerationData), &xyzValues<AccelerationData>, 3 },
+    { "alssensor",           &registerInterface<ALSSensorChannelInterface>,           sizeof(TimedUnsigned), 0, 0 },
+    { "compasssensor",       &registerInterface<CompassSensorChannelInterface>,       sizeof(CompassData), 0, 0 },
+    { "fusionsensor",        &registerInterface<FusionSensorChannelInterface>,        sizeof(FusionData), &fusionValues, 9 },
+    { "gyroscopesensor",     &registerInterface<GyroscopeSensorChannelInterface>,     sizeof(TimedXyzData), &xyzValues<TimedXyzData>, 3 },
+    { "integratedgyroscopesensor", &registerInterface<IntegratedGyroscopeSensorChannelInterface>, sizeof(RotationDeltaData), 0, 0 },
+    { "magnetometersensor",  &registerInterface<MagnetometerSensorChannelInterface>,  sizeof(CalibratedMagneticFieldData), &xyzValues<CalibratedMagneticFieldData>, 3 },
+    { "orientationsensor",   &registerInterface<OrientationSensorChannelInterface>,   sizeof(TimedUnsigned), 0, 0 },
+    { "proximitysensor",     &registerInterface<ProximitySensorChannelInterface>,     sizeof(ProximityData), 0, 0 },
+    { "rotationsensor",      &registerInterface<RotationSensorChannelInterface>,      sizeof(TimedXyzData), &xyzValues<TimedXyzData>, 3 },
+    { "accelerometerstatisticssensor", &registerInterface<StatisticsSensorChannelInterface>, sizeof(XyzStatisticsData), 0, 0 },
+    { "gyroscopestatisticssensor",     &registerInterface<StatisticsSensorChannelInterface>, sizeof(XyzStatisticsData), 0, 0 },
+    { "tapsensor",           &registerInterface<TapSensorChannelInterface>,           sizeof(TapData), 0, 0 }
+};
+
+/**
+ * Open session of the C API.
+ */
+struct Session
+{
+    AbstractSensorChannelInterface* interface;   /**< control interface */
+    const SensorType*               type;        /**< sensor of the session */
+    SessionReceiver*                receiver;    /**< receive thread */
+    SamplePredictor*                predictor;   /**< predictor of the values, or NULL */
+    bool                            running;     /**< is the sensor started */
+    bool                            polled;      /**< received by sensorfw_drain() */
+    QByteArray                      description; /**< last description returned */
+    QByteArray                      error;       /**< last error string returned */
+};
+
+static QMap<int, Session*> sessions;
+
+static const SensorType* findSensorType(const QString& sensorName)
+{
+    QString name = getCleanId(sensorName);
+    for (unsigned int i = 0; i < sizeof(SENSOR_TYPES) / sizeof(SENSOR_TYPES[0]); ++i)
+        if (name == SENSOR_TYPES[i].name)
+            return &SENSOR_TYPES[i];
+    return 0;
+}
+
+static Session* findSession(int sessionId)
+{
+    return sessions.value(sessionId, 0);
+}
+
+/**
+ * D-Bus and the session sockets need an application object. It is never
+ * executed; samples are read by the receive threads.
+ */
+static void ensureApplication()
+{
+    static int argc = 1;
+    static char name[] = "sensorfw-c";
+    static char* argv[] = { name, 0 };
+    if (!QCoreApplication::instance())
+        new QCoreApplication(argc, argv);
+}
+
+bool sensorfw_init(const char* sensor_name)
+{
+    const SensorType* type = sensor_name ? findSensorType(sensor_name) : 0;
+    if (!type) {
+        qWarning() << "Unknown sensor " << sensor_name;
+        return false;
+    }
+    ensureApplication();
+
+    SensorManagerInterface& sm = SensorManagerInterface::instance();
+    if (!sm.isValid())
+        return false;
+    QDBusReply<bool> reply = sm.loadPlugin(type->name);
+    if (!reply.isValid() || !reply.value()) {
+        qWarning() << "Failed to load plugin " << type->name;
+        return false;
+    }
+    type->registerInterface(type->name);
+    return true;
+}
+
+static bool socketTransport()
+{
+    QByteArray transport = qgetenv("SENSORFW_TRANSPORT");
+    if (!transport.isEmpty() && transport != "socket") {
+        qWarning() << "C API sessions require socket transport, SENSORFW_TRANSPORT is " << transport;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Add session for an interface of given sensor type. Interface is
+ * deleted if the session can not be received.
+ */
+static Session* addSession(AbstractSensorChannelInterface* interface, const SensorType* type)
+{
+    QLocalSocket* socket = interface->findChild<QLocalSocket*>();
+    if (!interface->isValid() || !socket) {
+        delete interface;
+        return 0;
+    }
+
+    Session* session = new Session;
+    session->interface = interface;
+    session->type = type;
+    session->predictor = 0;
+    session->receiver = new SessionReceiver(interface->sessionId(), socket->socketDescriptor(), type->sampleSize, QUEUE_SIZE);
+    session->running = false;
+    session->polled = false;
+    sessions.insert(interface->sessionId(), session);
+    return session;
+}
+
+int sensorfw_open_session(const char* sensor_name)
+{
+    const SensorType* type = sensor_name ? findSensorType(sensor_name) : 0;
+    if (!type || !socketTransport())
+        return -1;
+
+    AbstractSensorChannelInterface* interface = SensorManagerInterface::instance().interface(sensor_name);
+    if (!interface)
+        return -1;
+    Session* session = addSession(interface, type);
+    return session ? session->interface->sessionId() : -1;
+}
+
+int sensorfw_open_sessions(sensorfw_session_setup_t* setups, unsigned int count)
+{
+    if (!setups || !count)
+        return 0;
+    for (unsigned int i = 0; i < count; ++i)
+        setups[i].session_id = -1;
+    if (!socketTransport())
+        return 0;
+    ensureApplication();
+
+    SensorManagerInterface& sm = SensorManagerInterface::instance();
+    if (!sm.isValid())
+        return 0;
+
+    QStringList names;
+    QList<unsigned int> requested;
+    for (unsigned int i = 0; i < count; ++i) {
+        const SensorType* type = setups[i].sensor_name ? findSensorType(setups[i].sensor_name) : 0;
+        if (!type) {
+            qWarning() << "Unknown sensor " << setups[i].sensor_name;
+            continue;
+        }
+        type->registerInterface(type->name);
+        names.append(setups[i].sensor_name);
+        requested.append(i);
+    }
+    if (names.isEmpty())
+        return 0;
+
+    QList<AbstractSensorChannelInterface*> interfaces = sm.interfaces(names);
+    QList<Session*> opened;
+    QList<AbstractSensorChannelInterface*> starting;
+    QList<unsigned int> indices;
+    for (int i = 0; i < requested.size(); ++i) {
+        const sensorfw_session_setup_t& setup = setups[requested.at(i)];
+        Session* session = interfaces.at(i) ? addSession(interfaces.at(i), findSensorType(setup.sensor_name)) : 0;
+        if (!session)
+            continue;
+        // Stopped interfaces only record the configuration
+        session->interface->setInterval(setup.interval);
+        session->interface->setBufferSize(setup.buffer_size);
+        session->interface->setStandbyOverride(setup.standby_override);
+        opened.append(session);
+        starting.append(session->interface);
+        indices.append(requested.at(i));
+    }
+    if (opened.isEmpty())
+        return 0;
+
+    QList<bool> started = sm.startInterfaces(starting);
+    int running = 0;
+    for (int i = 0; i < opened.size(); ++i) {
+        Session* session = opened.at(i);
+        session->running = started.at(i);
+        if (session->running && session->receiver->startReceiving()) {
+            setups[indices.at(i)].session_id = session->interface->sessionId();
+            ++running;
+        } else {
+            sensorfw_close_session(session->interface->sessionId());
+        }
+    }
+    return running;
+}
+
+/**
+ * Stop receiving and the sensor of a session.
+ */
+static bool stopSession(Session* session)
+{
+    if (!session->running)
+        return true;
+    session->receiver->stopReceiving();
+    session->running = false;
+    return session->interface->stop().isValid();
+}
+
+bool sensorfw_close_session(int sessionId)
+{
+    Session* session = sessions.take(sessionId);
+    if (!session)
+        return false;
+    stopSession(session);
+    delete session->receiver;
+    delete session->predictor;
+    delete session->interface;
+    delete session;
+    return true;
+}
+
+bool sensorfw_start_sensor(int sessionId)
+{
+    Session* session = findSession(sessionId);
+    if (!session)
+        return false;
+    if (session->running)
+        return true;
+    if (!session->interface->start().isValid())
+        return false;
+    if (!session->polled && !session->receiver->startReceiving()) {
+        session->interface->stop();
+        return false;
+    }
+    session->running = true;
+    return true;
+}
+
+bool sensorfw_stop_sensor(int sessionId)
+{
+    Session* session = findSession(sessionId);
+    return session && stopSession(session);
+}
+
+bool sensorfw_running(int sessionId)
+{
+    Session* session = findSession(sessionId);
+    return session && session->running;
+}
+
+int sensorfw_get_interval(int sessionId)
+{
+    Session* session = findSession(sessionId);
+    return session ? session->interface->interval() : -1;
+}
+
+bool sensorfw_set_interval(int sessionId, int interval)
+{
+    Session* session = findSession(sessionId);
+    if (!session)
+        return false;
+    session->interface->setInterval(interval);
+    return session->interface->errorCode() == SNoError;
+}
+
+bool sensorfw_get_standby_override(int sessionId)
+{
+    Session* session = findSession(sessionId);
+    return session && session->interface->standbyOverride();
+}
+
+bool sensorfw_set_standby_override(int sessionId, bool override)
+{
+    Session* session = findSession(sessionId);
+    return session && session->interface->setStandbyOverride(override);
+}
+
+bool sensorfw_get_description(int sessionId, char** description)
+{
+    Session* session = findSession(sessionId);
+    if (!session || !description)
+        return false;
+    session->description = session->interface->description().toUtf8();
+    *description = session->description.data();
+    return true;
+}
+
+bool sensorfw_register_callback(int sessionId, void (*cb_func)(void *data))
+{
+    Session* session = findSession(sessionId);
+    if (!session)
+        return false;
+    session->receiver->setSampleCallback(cb_func);
+    return true;
+}
+
+bool sensorfw_register_batch_callback(int sessionId, sensorfw_batch_callback_t cb_func, void* user_data)
+{
+    Session* session = findSession(sessionId);
+    if (!session)
+        return false;
+    session->receiver->setBatchCallback(cb_func, user_data);
+    return true;
+}
+
+int sensorfw_read_batch(int sessionId, void* buf, unsigned int max)
+{
+    Session* session = findSession(sessionId);
+    if (!session || (!buf && max))
+        return -1;
+    return session->receiver->readBatch(buf, max);
+}
+
+int sensorfw_get_fd(int sessionId)
+{
+    Session* session = findSession(sessionId);
+    if (!session)
+        return -1;
+    session->polled = true;
+    session->receiver->stopReceiving();
+    return session->receiver->fd();
+}
+
+int sensorfw_drain(int sessionId, void* buf, unsigned int max)
+{
+    Session* session = findSession(sessionId);
+    if (!session || !session->polled || (!buf && max))
+        return -1;
+    return session->receiver->drain(buf, max);
+}
+
+unsigned int sensorfw_get_sample_size(int sessionId)
+{
+    Session* session = findSession(sessionId);
+    return session ? session->receiver->sampleSize() : 0;
+}
+
+bool sensorfw_enable_prediction(int sessionId, sensorfw_predict_mode_t mode, unsigned int horizon_us)
+{
+    Session* session = findSession(sessionId);
+    if (!session || !session->type->values)
+        return false;
+    // Quaternion mode needs sensors reporting rotation quaternions
+    if (mode == SENSORFW_PREDICT_QUATERNION && session->type->valueCount != 4)
+        return false;
+
+    SamplePredictor* predictor = new SamplePredictor(mode == SENSORFW_PREDICT_QUATERNION ?
+                                                     SamplePredictor::Quaternion : SamplePredictor::Linear,
+                                                     session->type->valueCount);
+    if (horizon_us)
+        predictor->setHorizon(horizon_us);
+    session->receiver->setPredictor(predictor, session->type->values);
+    delete session->predictor;
+    session->predictor = predictor;
+    return true;
+}
+
+int sensorfw_predict(int sessionId, unsigned long long timestamp, double* values, unsigned int max)
+{
+    Session* session = findSession(sessionId);
+    if (!session || !session->predictor || (!values && max))
+        return -1;
+    double predicted[SamplePredictor::MAX_VALUES];
+    if (!session->predictor->predict(timestamp, predicted))
+        return 0;
+    unsigned int count = qMin(max, (unsigned int)session->predictor->valueCount());
+    memcpy(values, predicted, count * sizeof(double));
+    return count;
+}
+
+bool sensorfw_prepare_for_calibration(int sessionId)
+{
+    Session* session = findSession(sessionId);
+    MagnetometerSensorChannelInterface* magnetometer =
+        session ? qobject_cast<MagnetometerSensorChannelInterface*>(session->interface) : 0;
+    return magnetometer && magnetometer->reset().isValid();
+}
+
+int sensorfw_last_error(int sessionId, char** error_string)
+{
+    Session* session = findSession(sessionId);
+    if (!session)
+        return SmIdNotRegistered;
+    if (error_string) {
+        session->error = session->interface->errorString().toUtf8();
+        *error_string = session->error.data();
+    }
+    return session->interface->errorCode();
+}
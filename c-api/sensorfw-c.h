@@ -1,13 +1,20 @@
 /**
    @file sensorfw-c.h
-   @brief C-API for sensor framework. <b>NOTE THAT THIS HAS NOT BEEN IMPLEMENTED YET<b>
+   @brief C-API for sensor framework.
+
+   Control functions are blocking D-Bus calls and must all be made from the
+   same thread. Sample data does not go through a Qt event loop: every
+   started session has a receive thread of its own, which parses frames
+   from the session socket and either passes them to the registered
+   callback or queues them for sensorfw_read_batch(). The application
+   must not run a Qt event loop in the thread using this API, and the
+   socket transport must be used (<em>SENSORFW_TRANSPORT</em> unset).
 
     @todo
     <ul>
     <li>Querying and setting values for Data range</li>
     <li>Querying possible values for Interval and Data range</li>
     <li>Control / Listen separation?</li>
-    <li>Generic type for callbacks, or callback must know what to expect?</li>
     </ul>
 
    <p>
@@ -34,6 +41,12 @@
 #ifndef SENSORFW_CAPI
 #define SENSORFW_CAPI
 
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /**
  * @brief Structure containing interval information for sensor.
  *
@@ -54,6 +67,40 @@ typedef struct {
     int accuracy; ///< Minimal detected change
 } sensorfw_range_t;
 
+/**
+ * @brief Setup of one session opened with sensorfw_open_sessions().
+ */
+typedef struct {
+    const char*  sensor_name;      ///< Name of the sensor to open
+    int          interval;         ///< Milliseconds between samples, see sensorfw_set_interval
+    unsigned int buffer_size;      ///< Samples per frame, 0 or 1 for no buffering
+    bool         standby_override; ///< See sensorfw_set_standby_override
+    int          session_id;       ///< Set to the session ID, \c -1 on failure
+} sensorfw_session_setup_t;
+
+/**
+ * @brief Callback receiving a batch of samples.
+ *
+ * Called from the receive thread of the session. The samples are in the
+ * binary format sent by sensord for the sensor, e.g. TimedXyzData for
+ * accelerometersensor, and are valid only during the call. The callback
+ * should return quickly as it delays reception of further samples.
+ *
+ * @param sessionId Session the samples belong to.
+ * @param samples Pointer to the first sample, aligned for the sample type.
+ * @param count Number of samples.
+ * @param user_data Pointer given at registration.
+ */
+typedef void (*sensorfw_batch_callback_t)(int sessionId, const void* samples, unsigned int count, void* user_data);
+
+/**
+ * @brief Extrapolation used by sensorfw_predict().
+ */
+typedef enum {
+    SENSORFW_PREDICT_LINEAR = 0, ///< Values move linearly
+    SENSORFW_PREDICT_QUATERNION  ///< Values are a rotation quaternion w, x, y, z
+} sensorfw_predict_mode_t;
+
 /**
  * @brief Initialises the sensor for operation.
  *
@@ -75,6 +122,24 @@ bool sensorfw_init(const char* sensor_name);
  */
 int sensorfw_open_session(const char* sensor_name);
 
+/**
+ * @brief Opens, configures and starts sessions for several sensors.
+ *
+ * Does what sensorfw_init, sensorfw_open_session, sensorfw_set_interval,
+ * sensorfw_set_standby_override and sensorfw_start_sensor would do for
+ * each sensor, with one request to sensord for opening all sessions and
+ * one for starting them instead of a request per sensor and step. The
+ * data socket of each session is still connected separately. Sessions
+ * are closed with sensorfw_close_session as usual.
+ *
+ * @param setups Sessions to open. \c session_id of each is set to the
+ *        started session, or to \c -1 if the sensor could not be
+ *        opened or started.
+ * @param count Number of entries in \c setups.
+ * @return Number of sessions started.
+ */
+int sensorfw_open_sessions(sensorfw_session_setup_t* setups, unsigned int count);
+
 /**
  * @brief Closes a sensor session.
  *
@@ -166,7 +231,10 @@ bool sensorfw_get_description(int sessionId, char** description);
 /**
  * @brief Registers a callback function to handle sensor output.
  *
- * @todo Description of callback requirements.
+ * The callback is called from the receive thread of the session once
+ * for every sample, with a pointer to the sample. See
+ * sensorfw_batch_callback_t for the sample format. Pass \c NULL to
+ * unregister.
  *
  * @param sessionId Session ID to run this request on.
  * @param cb_func Pointer to function to use as callback.
@@ -174,6 +242,104 @@ bool sensorfw_get_description(int sessionId, char** description);
  */
 bool sensorfw_register_callback(int sessionId, void (*cb_func)(void *data));
 
+/**
+ * @brief Registers a callback function to handle batches of sensor output.
+ *
+ * The callback is called from the receive thread of the session once for
+ * every frame received from sensord. With buffering (bufferSize) a frame
+ * holds multiple samples. Pass \c NULL to unregister.
+ *
+ * @param sessionId Session ID to run this request on.
+ * @param cb_func Pointer to function to use as callback.
+ * @param user_data Pointer passed to the callback.
+ * @return \c true on success, \c false on failure or invalid session ID.
+ */
+bool sensorfw_register_batch_callback(int sessionId, sensorfw_batch_callback_t cb_func, void* user_data);
+
+/**
+ * @brief Reads queued samples without blocking.
+ *
+ * While no callback is registered the receive thread queues samples of
+ * the session. Samples not read before the queue fills up are dropped.
+ *
+ * @param sessionId Session ID to run this request on.
+ * @param buf Buffer for at least \c max samples of
+ *        sensorfw_get_sample_size() bytes each.
+ * @param max Maximum number of samples to read.
+ * @return Number of samples read, \c -1 on invalid session ID.
+ */
+int sensorfw_read_batch(int sessionId, void* buf, unsigned int max);
+
+/**
+ * @brief Tells the socket of the session for the application's poll loop.
+ *
+ * Switches the session to polled mode: no receive thread is used and
+ * samples are received only by sensorfw_drain() calls, so the descriptor
+ * should be watched for readability with poll() or epoll. Registered
+ * callbacks are then called from sensorfw_drain().
+ *
+ * @param sessionId Session ID to run this request on.
+ * @return Socket descriptor, \c -1 on invalid session ID.
+ */
+int sensorfw_get_fd(int sessionId);
+
+/**
+ * @brief Receives and reads samples of a polled session without blocking.
+ *
+ * Reads everything waiting in the socket of the session and copies out up
+ * to \c max samples. Samples not fitting are kept for the next call.
+ *
+ * @param sessionId Session ID to run this request on.
+ * @param buf Buffer for at least \c max samples of
+ *        sensorfw_get_sample_size() bytes each.
+ * @param max Maximum number of samples to read.
+ * @return Number of samples read, \c -1 on invalid session ID, if the
+ *         session is not in polled mode or if the connection was lost.
+ */
+int sensorfw_drain(int sessionId, void* buf, unsigned int max);
+
+/**
+ * @brief Tells the size of a single sample of the session.
+ *
+ * @param sessionId Session ID to run this request on.
+ * @return Size of a sample in bytes, \c 0 on invalid session ID.
+ */
+unsigned int sensorfw_get_sample_size(int sessionId);
+
+/**
+ * @brief Starts predicting sensor values of the session.
+ *
+ * Every sample received afterwards, whether read, drained or passed to
+ * callbacks, updates the prediction. A client rendering at display rate
+ * can then run the sensor at a lower interval and ask for the values at
+ * each frame time with sensorfw_predict().
+ *
+ * @param sessionId Session ID to run this request on.
+ * @param mode Extrapolation of the values.
+ * @param horizon_us Most microseconds values are predicted past the latest
+ *        sample, \c 0 for the default of 100 ms.
+ * @return \c true on success, \c false on invalid session ID or if the
+ *         sensor values can not be predicted in the mode.
+ */
+bool sensorfw_enable_prediction(int sessionId, sensorfw_predict_mode_t mode, unsigned int horizon_us);
+
+/**
+ * @brief Predicts sensor values of the session at given time.
+ *
+ * Values are x, y and z for accelerometer, gyroscope, rotation and
+ * magnetometer sessions, and accelerometer, gyroscope and magnetometer
+ * x, y and z for fusion sessions.
+ *
+ * @param sessionId Session ID to run this request on.
+ * @param timestamp Time in microseconds of the monotonic clock, as in the
+ *        sample timestamps.
+ * @param values Buffer for at least \c max values.
+ * @param max Maximum number of values to write.
+ * @return Number of values written, \c 0 if no sample has been received
+ *         yet, \c -1 on invalid session ID or if prediction is not enabled.
+ */
+int sensorfw_predict(int sessionId, unsigned long long timestamp, double* values, unsigned int max);
+
 /**
  * @brief Prepares the sensor for calibration.
  *
@@ -196,4 +362,8 @@ bool sensorfw_prepare_for_calibration(int sessionId);
  */
 int sensorfw_last_error(int sessionId, char** error_string);
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif // SENSORFW_CAPI
@@ -0,0 +1,281 @@
+/**
+   @file sessionreceiver.cpp
+   @brief Receive thread of a C API session
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "sessionreceiver.h"
+#include "samplepredictor.h"
+#include "datatypes/atomic.h"
+#include <QDebug>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * Round queue size up to a power of two, so that the sample counters
+ * map to the same slots after they wrap around.
+ */
+static unsigned int queueCapacity(unsigned int size)
+{
+    unsigned int capacity = 1;
+    while (capacity < size && capacity < (1u << 31))
+        capacity <<= 1;
+    return capacity;
+}
+
+SessionReceiver::SessionReceiver(int sessionId, int fd, unsigned int sampleSize, unsigned int queueSize) :
+    sessionId_(sessionId),
+    fd_(fd),
+    sampleSize_(sampleSize),
+    running_(0),
+    sampleCallback_(0),
+    batchCallback_(0),
+    userData_(0),
+    predictor_(0),
+    predictorValues_(0),
+    count_(0),
+    countBytes_(0),
+    frameBytes_(0),
+    queueSize_(queueCapacity(queueSize)),
+    head_(0),
+    tail_(0),
+    dropped_(0)
+{
+    wakeup_[0] = wakeup_[1] = -1;
+    if (pipe(wakeup_) < 0)
+        qWarning() << "Failed to create wakeup pipe: " << strerror(errno);
+    for (int i = 0; i < 2; ++i)
+        if (wakeup_[i] >= 0)
+            fcntl(wakeup_[i], F_SETFD, FD_CLOEXEC);
+    int flags = fd_ >= 0 ? fcntl(fd_, F_GETFL) : -1;
+    if (flags < 0 || fcntl(fd_, F_SETFL, flags | O_NONBLOCK) < 0)
+        qWarning() << "Failed to make session socket non-blocking: " << strerror(errno);
+
+    // Both are allocated once, the receive path only reuses them.
+    frame_.resize((MAX_FRAME_OBJECTS * sampleSize_ + sizeof(quint64) - 1) / sizeof(quint64));
+    queue_.resize(((size_t)queueSize_ * sampleSize_ + sizeof(quint64) - 1) / sizeof(quint64));
+}
+
+SessionReceiver::~SessionReceiver()
+{
+    stopReceiving();
+    for (int i = 0; i < 2; ++i)
+        if (wakeup_[i] >= 0)
+            ::close(wakeup_[i]);
+}
+
+bool SessionReceiver::startReceiving()
+{
+    if (Atomic::load(running_))
+        return true;
+    if (fd_ < 0 || wakeup_[0] < 0 || !sampleSize_)
+        return false;
+    Atomic::store(running_, 1);
+    start();
+    return true;
+}
+
+void SessionReceiver::stopReceiving()
+{
+    if (!Atomic::load(running_))
+        return;
+    Atomic::store(running_, 0);
+    char byte = 0;
+    while (write(wakeup_[1], &byte, 1) < 0 && errno == EINTR)
+        ;
+    wait();
+    while (read(wakeup_[0], &byte, 1) < 0 && errno == EINTR)
+        ;
+}
+
+void SessionReceiver::setSampleCallback(void (*callback)(void* data))
+{
+    bool running = Atomic::load(running_);
+    stopReceiving();
+    sampleCallback_ = callback;
+    if (running)
+        startReceiving();
+}
+
+void SessionReceiver::setBatchCallback(sensorfw_batch_callback_t callback, void* userData)
+{
+    bool running = Atomic::load(running_);
+    stopReceiving();
+    batchCallback_ = callback;
+    userData_ = userData;
+    if (running)
+        startReceiving();
+}
+
+void SessionReceiver::setPredictor(SamplePredictor* predictor, SampleValues values)
+{
+    bool running = Atomic::load(running_);
+    stopReceiving();
+    predictor_ = predictor;
+    predictorValues_ = values;
+    if (running)
+        startReceiving();
+}
+
+int SessionReceiver::drain(void* buffer, unsigned int max)
+{
+    if (Atomic::load(running_) || fd_ < 0 || !sampleSize_)
+        return -1;
+    bool connected = receive();
+    unsigned int count = readBatch(buffer, max);
+    return (count || connected) ? (int)count : -1;
+}
+
+int SessionReceiver::fd() const
+{
+    return fd_;
+}
+
+unsigned int SessionReceiver::readBatch(void* buffer, unsigned int max)
+{
+    unsigned int tail = Atomic::load(tail_);
+    unsigned int count = qMin(max, (unsigned int)Atomic::loadAcquire(head_) - tail);
+    if (!count)
+        return 0;
+
+    const char* queue = (const char*)queue_.constData();
+    unsigned int first = tail % queueSize_;
+    unsigned int wrapped = qMin(count, queueSize_ - first);
+    memcpy(buffer, queue + (size_t)first * sampleSize_, (size_t)wrapped * sampleSize_);
+    memcpy((char*)buffer + (size_t)wrapped * sampleSize_, queue, (size_t)(count - wrapped) * sampleSize_);
+    Atomic::storeRelease(tail_, tail + count);
+    return count;
+}
+
+unsigned int SessionReceiver::sampleSize() const
+{
+    return sampleSize_;
+}
+
+unsigned int SessionReceiver::dropped() const
+{
+    return Atomic::load(dropped_);
+}
+
+void SessionReceiver::run()
+{
+    struct pollfd fds[2];
+    fds[0].fd = fd_;
+    fds[0].events = POLLIN;
+    fds[1].fd = wakeup_[0];
+    fds[1].events = POLLIN;
+
+    while (Atomic::load(running_)) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            qWarning() << "Polling session " << sessionId_ << " failed: " << strerror(errno);
+            break;
+        }
+        if (fds[1].revents)
+            break;
+        if (fds[0].revents && !receive()) {
+            qWarning() << "Session " << sessionId_ << " socket closed or corrupted";
+            break;
+        }
+    }
+}
+
+bool SessionReceiver::receive()
+{
+    for (;;) {
+        char* target;
+        size_t wanted;
+        if (countBytes_ < sizeof(count_)) {
+            target = (char*)&count_ + countBytes_;
+            wanted = sizeof(count_) - countBytes_;
+        } else {
+            target = (char*)frame_.data() + frameBytes_;
+            wanted = count_ * sampleSize_ - frameBytes_;
+        }
+
+        ssize_t bytes = ::read(fd_, target, wanted);
+        if (bytes < 0) {
+            if (errno == EINTR)
+                continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        if (bytes == 0)
+            return false;
+
+        if (countBytes_ < sizeof(count_)) {
+            countBytes_ += bytes;
+            if (countBytes_ < sizeof(count_))
+                continue;
+            if (count_ > MAX_FRAME_OBJECTS) {
+                qWarning() << "Too many samples in frame of session " << sessionId_;
+                return false;
+            }
+            frameBytes_ = 0;
+        } else {
+            frameBytes_ += bytes;
+        }
+
+        if (frameBytes_ == count_ * sampleSize_) {
+            if (count_)
+                deliver((const char*)frame_.constData(), count_);
+            countBytes_ = 0;
+        }
+    }
+}
+
+void SessionReceiver::deliver(const char* samples, unsigned int count)
+{
+    if (predictor_) {
+        quint64 timestamp;
+        double values[SamplePredictor::MAX_VALUES];
+        for (unsigned int i = 0; i < count; ++i) {
+            predictorValues_(samples + (size_t)i * sampleSize_, timestamp, values);
+            predictor_->addSample(timestamp, values);
+        }
+    }
+    if (batchCallback_)
+        batchCallback_(sessionId_, samples, count, userData_);
+    if (sampleCallback_)
+        for (unsigned int i = 0; i < count; ++i)
+            sampleCallback_((void*)(samples + (size_t)i * sampleSize_));
+    if (!batchCallback_ && !sampleCallback_)
+        enqueue(samples, count);
+}
+
+void SessionReceiver::enqueue(const char* samples, unsigned int count)
+{
+    unsigned int head = Atomic::load(head_);
+    unsigned int room = queueSize_ - (head - (unsigned int)Atomic::loadAcquire(tail_));
+    if (count > room) {
+        dropped_.fetchAndAddRelaxed(count - room);
+        count = room;
+    }
+    if (!count)
+        return;
+
+    char* queue = (char*)queue_.data();
+    unsigned int first = head % queueSize_;
+    unsigned int wrapped = qMin(count, queueSize_ - first);
+    memcpy(queue + (size_t)first * sampleSize_, samples, (size_t)wrapped * sampleSize_);
+    memcpy(queue, samples + (size_t)wrapped * sampleSize_, (size_t)(count - wrapped) * sampleSize_);
+    Atomic::storeRelease(head_, head + count);
+}
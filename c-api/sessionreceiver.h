@@ -0,0 +1,201 @@
+/**
+   @file sessionreceiver.h
+   @brief Receive thread of a C API session
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef SESSIONRECEIVER_H
+#define SESSIONRECEIVER_H
+
+#include <QThread>
+#include <QAtomicInt>
+#include <QVector>
+#include "sensorfw-c.h"
+
+class SamplePredictor;
+
+/**
+ * Values of a sample for prediction.
+ *
+ * @param sample sample in the format sent by sensord.
+ * @param timestamp set to the sample timestamp.
+ * @param values set to the values, at most SamplePredictor::MAX_VALUES.
+ */
+typedef void (*SampleValues)(const void* sample, quint64& timestamp, double* values);
+
+/**
+ * Reads frames of a session directly from its socket in a thread of its
+ * own, so that no Qt event loop is needed to receive samples.
+ *
+ * Each frame is passed to the registered callbacks. Without callbacks the
+ * samples go into a single producer, single consumer queue from which
+ * readBatch() takes them without locking.
+ */
+class SessionReceiver : public QThread
+{
+public:
+    /**
+     * Constructor.
+     *
+     * @param sessionId session ID passed to the callbacks.
+     * @param fd socket of the session.
+     * @param sampleSize size of a sample in bytes.
+     * @param queueSize maximum number of queued samples, rounded up to a
+     *                  power of two.
+     */
+    SessionReceiver(int sessionId, int fd, unsigned int sampleSize, unsigned int queueSize);
+
+    /**
+     * Destructor. Stops the thread.
+     */
+    ~SessionReceiver();
+
+    /**
+     * Start the receive thread.
+     *
+     * @return was the thread started.
+     */
+    bool startReceiving();
+
+    /**
+     * Stop the thread. Queued samples can still be read.
+     */
+    void stopReceiving();
+
+    /**
+     * Set callback for every sample. Receiving is paused during the call.
+     *
+     * @param callback callback or NULL.
+     */
+    void setSampleCallback(void (*callback)(void* data));
+
+    /**
+     * Set callback for every frame. Receiving is paused during the call.
+     *
+     * @param callback callback or NULL.
+     * @param userData pointer passed to the callback.
+     */
+    void setBatchCallback(sensorfw_batch_callback_t callback, void* userData);
+
+    /**
+     * Set predictor updated with every sample. Receiving is paused during
+     * the call.
+     *
+     * @param predictor predictor or NULL, not owned.
+     * @param values values of a sample for the predictor.
+     */
+    void setPredictor(SamplePredictor* predictor, SampleValues values);
+
+    /**
+     * Receive samples in the calling thread instead of the receive thread,
+     * which must not be running. Frames waiting in the socket are passed
+     * to the callbacks or queued, and queued samples are taken.
+     *
+     * @param buffer location for at most max samples.
+     * @param max maximum number of samples.
+     * @return number of samples taken, -1 if the connection was lost.
+     */
+    int drain(void* buffer, unsigned int max);
+
+    /**
+     * Socket of the session.
+     *
+     * @return socket descriptor.
+     */
+    int fd() const;
+
+    /**
+     * Take queued samples. Must be called from one thread at a time.
+     *
+     * @param buffer location for at most max samples.
+     * @param max maximum number of samples.
+     * @return number of samples taken.
+     */
+    unsigned int readBatch(void* buffer, unsigned int max);
+
+    /**
+     * Size of a sample.
+     *
+     * @return sample size in bytes.
+     */
+    unsigned int sampleSize() const;
+
+    /**
+     * Number of samples dropped because the queue was full.
+     *
+     * @return dropped sample count.
+     */
+    unsigned int dropped() const;
+
+protected:
+    void run();
+
+private:
+    Q_DISABLE_COPY(SessionReceiver)
+
+    /**
+     * Read everything available in the socket and deliver complete frames.
+     *
+     * @return false if the connection was closed or is corrupted.
+     */
+    bool receive();
+
+    /**
+     * Pass objects of a frame to the callbacks or to the queue.
+     *
+     * @param samples first sample.
+     * @param count number of samples.
+     */
+    void deliver(const char* samples, unsigned int count);
+
+    /**
+     * Append samples to the queue, dropping what does not fit.
+     *
+     * @param samples first sample.
+     * @param count number of samples.
+     */
+    void enqueue(const char* samples, unsigned int count);
+
+    /** Frames with more objects are treated as stream corruption. */
+    static const unsigned int MAX_FRAME_OBJECTS = 1000;
+
+    int                       sessionId_;      /**< session ID */
+    int                       fd_;             /**< session socket */
+    int                       wakeup_[2];      /**< pipe waking up the thread to stop */
+    unsigned int              sampleSize_;     /**< sample size in bytes */
+    QAtomicInt                running_;        /**< is the thread running */
+
+    void                      (*sampleCallback_)(void* data); /**< per sample callback */
+    sensorfw_batch_callback_t batchCallback_;  /**< per frame callback */
+    void*                     userData_;       /**< argument of batchCallback_ */
+    SamplePredictor*          predictor_;      /**< predictor fed with the samples, or NULL */
+    SampleValues              predictorValues_; /**< values of a sample for predictor_ */
+
+    unsigned int              count_;          /**< object count of the frame being read */
+    unsigned int              countBytes_;     /**< bytes of count_ read */
+    unsigned int              frameBytes_;     /**< bytes of the frame objects read */
+    QVector<quint64>          frame_;          /**< aligned storage of the frame objects */
+
+    QVector<quint64>          queue_;          /**< aligned storage of the queue */
+    unsigned int              queueSize_;      /**< queue capacity in samples */
+    QAtomicInt                head_;           /**< samples ever queued */
+    QAtomicInt                tail_;           /**< samples ever taken */
+    QAtomicInt                dropped_;        /**< samples dropped from a full queue */
+};
+
+#endif // SESSIONRECEIVER_H
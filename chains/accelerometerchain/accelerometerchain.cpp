@@ -39,6 +39,7 @@
 AccelerometerChain::AccelerometerChain(const QString& id) :
     AbstractChain(id)
 {
+    NodeArenaScope scope(&arena());
     setMatrixFromString("1,0,0,\
                          0,1,0,\
                          0,0,1");
@@ -48,7 +49,7 @@ AccelerometerChain::AccelerometerChain(const QString& id) :
     Q_ASSERT( accelerometerAdaptor_ );
     setValid(accelerometerAdaptor_->isValid());
 
-    accelerometerReader_ = new BufferReader<AccelerationData>(1);
+    accelerometerReader_ = new BufferReader<AccelerationData>(FILTER_BATCH_SIZE);
 
     // Get the transformation matrix from config file
     QString aconvString = Config::configuration()->value<QString>("accelerometer/transformation_matrix", "");
@@ -64,7 +65,7 @@ AccelerometerChain::AccelerometerChain(const QString& id) :
     Q_ASSERT(accCoordinateAlignFilter_);
     ((CoordinateAlignFilter*)accCoordinateAlignFilter_)->setMatrix(TMatrix(aconv_));
 
-    outputBuffer_ = new RingBuffer<AccelerationData>(1);
+    outputBuffer_ = new RingBuffer<AccelerationData>(FILTER_BATCH_SIZE);
     nameOutputBuffer("accelerometer", outputBuffer_);
 
     // Create buffers for filter chain
@@ -121,6 +122,19 @@ bool AccelerometerChain::stop()
     return true;
 }
 
+void AccelerometerChain::reconfigure(const QStringList& keys)
+{
+    if (keys.contains("accelerometer/transformation_matrix"))
+    {
+        QString aconvString = Config::configuration()->value<QString>("accelerometer/transformation_matrix", "1,0,0,0,1,0,0,0,1");
+        if (setMatrixFromString(aconvString))
+            ((CoordinateAlignFilter*)accCoordinateAlignFilter_)->setMatrix(TMatrix(aconv_));
+        else
+            sensordLogW() << "Failed to parse 'transformation_matrix' configuration key. Keeping previous alignment";
+    }
+    filterBin_->reconfigure(keys);
+}
+
 bool AccelerometerChain::setMatrixFromString(const QString& str)
 {
     QStringList strList = str.split(',');
@@ -60,6 +60,8 @@ public:
         return sc;
     }
 
+    void reconfigure(const QStringList& keys);
+
 public Q_SLOTS:
     bool start();
     bool stop();
@@ -23,6 +23,7 @@
 #include <QDebug>
 
 #include "compasschain.h"
+#include "compassfilter.h"
 #include "orientationfilter.h"
 #include "sensormanager.h"
 #include "bin.h"
@@ -35,8 +36,10 @@
 
 CompassChain::CompassChain(const QString& id) :
     AbstractChain(id),
-    hasOrientationAdaptor(false)
+    hasOrientationAdaptor(false),
+    outputInterval(0)
 {
+    NodeArenaScope scope(&arena());
     SensorManager& sm = SensorManager::instance();
 
     orientAdaptor = sm.requestDeviceAdaptor("orientationadaptor");
@@ -46,7 +49,7 @@ CompassChain::CompassChain(const QString& id) :
         hasOrientationAdaptor = true;
         setValid(orientAdaptor->isValid());
         if (orientAdaptor->isValid())
-            orientationdataReader = new BufferReader<CompassData>(1);
+            orientationdataReader = new BufferReader<CompassData>(FILTER_BATCH_SIZE);
 
         orientationFilter = sm.instantiateFilter("orientationfilter");
         Q_ASSERT(orientationFilter);
@@ -64,9 +67,9 @@ CompassChain::CompassChain(const QString& id) :
         Q_ASSERT(accelerometerChain);
         setValid(accelerometerChain->isValid());
 
-        accelerometerReader = new BufferReader<AccelerationData>(1);
+        accelerometerReader = new BufferReader<AccelerationData>(FILTER_BATCH_SIZE);
 
-        magReader = new BufferReader<CalibratedMagneticFieldData>(1);
+        magReader = new BufferReader<CalibratedMagneticFieldData>(FILTER_BATCH_SIZE);
 
         compassFilter = sm.instantiateFilter("compassfilter");
         Q_ASSERT(compassFilter);
@@ -81,10 +84,10 @@ CompassChain::CompassChain(const QString& id) :
         Q_ASSERT(avgaccFilter);
     }
 
-    trueNorthBuffer = new RingBuffer<CompassData>(1);
+    trueNorthBuffer = new RingBuffer<CompassData>(FILTER_BATCH_SIZE);
     nameOutputBuffer("truenorth", trueNorthBuffer); //
 
-    magneticNorthBuffer = new RingBuffer<CompassData>(1);
+    magneticNorthBuffer = new RingBuffer<CompassData>(FILTER_BATCH_SIZE);
     nameOutputBuffer("magneticnorth", magneticNorthBuffer); //
 
     // Create buffers for filter chain
@@ -153,14 +156,18 @@ CompassChain::CompassChain(const QString& id) :
 
     setDescription("Compass direction"); //compass north in degrees
     introduceAvailableDataRange(DataRange(0, 359, 1));
-    introduceAvailableInterval(DataRange(50,200,0));
 
     if (!hasOrientationAdaptor) {
         setRangeSource(magChain);
         addStandbyOverrideSource(magChain);
 
         addStandbyOverrideSource(accelerometerChain);
-        setIntervalSource(accelerometerChain);
+        // Interval is kept locally so that heading is computed only as
+        // often as compass sessions need, accelerometer may run faster.
+        foreach (const DataRange& range, accelerometerChain->getAvailableIntervals())
+            introduceAvailableInterval(range);
+    } else {
+        introduceAvailableInterval(DataRange(50,200,0));
     }
 }
 
@@ -174,6 +181,8 @@ CompassChain::~CompassChain()
         delete accelerometerReader;
         delete magReader;
         delete compassFilter;
+        delete avgaccFilter;
+        delete downsampleFilter;
     } else {
         disconnectFromSource(orientAdaptor, "orientation", orientationdataReader);
         sm.releaseDeviceAdaptor("orientationadaptor");
@@ -186,10 +195,40 @@ CompassChain::~CompassChain()
     delete filterBin;
 }
 
+unsigned int CompassChain::interval() const
+{
+    if (hasOrientationAdaptor)
+        return AbstractChain::interval();
+    return qMax(outputInterval, accelerometerChain->getInterval());
+}
+
+bool CompassChain::setInterval(unsigned int value, int sessionId)
+{
+    if (hasOrientationAdaptor)
+        return AbstractChain::setInterval(value, sessionId);
+
+    setOutputInterval(value);
+    return accelerometerChain->setIntervalRequest(sessionId, value);
+}
+
+void CompassChain::setOutputInterval(unsigned int value)
+{
+    outputInterval = value;
+    CompassFilter* filter = dynamic_cast<CompassFilter*>(compassFilter);
+    if (filter)
+        filter->setOutputInterval(value);
+}
+
 bool CompassChain::start()
 {
     if (AbstractSensorChannel::start()) {
         sensordLogD() << "Starting compassChain";
+        if (!hasOrientationAdaptor) {
+            // Removed requests do not reach setInterval(), use the current winner
+            int sessionId;
+            unsigned int value = evaluateIntervalRequests(sessionId);
+            setOutputInterval(sessionId >= 0 ? value : 0);
+        }
         filterBin->start();
         if (hasOrientationAdaptor) {
             orientAdaptor->startSensor();
@@ -64,7 +64,32 @@ protected:
     CompassChain(const QString& id);
     ~CompassChain();
 
+    /**
+     * Interval of headings, which is never shorter than accelerometer
+     * interval.
+     *
+     * @return interval in milliseconds.
+     */
+    virtual unsigned int interval() const;
+
+    /**
+     * Compute heading at given interval and request accelerometer to run
+     * at least that fast.
+     *
+     * @param value interval in milliseconds.
+     * @param sessionId Session ID.
+     * @return was interval set succesfully.
+     */
+    virtual bool setInterval(unsigned int value, int sessionId);
+
 private:
+    /**
+     * Set interval of headings without touching accelerometer requests.
+     *
+     * @param value interval in milliseconds, 0 for accelerometer rate.
+     */
+    void setOutputInterval(unsigned int value);
+
     Bin* filterBin;
 
     AbstractChain *accelerometerChain;
@@ -88,6 +113,7 @@ private:
     RingBuffer<CompassData> *magneticNorthBuffer;
 
     bool hasOrientationAdaptor;
+    unsigned int outputInterval; /**< heading interval in milliseconds */
 };
 
 #endif // COMPASSCHAIN_H
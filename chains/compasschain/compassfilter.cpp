@@ -22,6 +22,7 @@
 #include "config.h"
 
 #include <QtCore/qmath.h>
+#include <math.h>
 
 #define RADIANS_TO_DEGREES 57.2957795
 #define DEGREES_TO_RADIANS 0.017453292
@@ -29,15 +30,46 @@
 CompassFilter::CompassFilter() :
         magDataSink(this, &CompassFilter::magDataAvailable),
         accelSink(this, &CompassFilter::accelDataAvailable),
-        factor(1)
+        factor(1),
+        trigFree(false),
+        interval(0),
+        deadline(0)
 {
     addSink(&magDataSink, "magsink");
     addSink(&accelSink, "accsink");
     addSource(&magSource, "magnorthangle");
+    if (Config::configuration())
+        trigFree = Config::configuration()->value<bool>("compass/trig_free_tilt", false);
 }
 
-void CompassFilter::magDataAvailable(unsigned, const CalibratedMagneticFieldData *data)
+void CompassFilter::setTrigFree(bool value)
 {
+    trigFree = value;
+}
+
+bool CompassFilter::isTrigFree() const
+{
+    return trigFree;
+}
+
+void CompassFilter::setOutputInterval(unsigned int ms)
+{
+    interval = (quint64)ms * 1000;
+    deadline = 0;
+}
+
+unsigned int CompassFilter::outputInterval() const
+{
+    return interval / 1000;
+}
+
+void CompassFilter::magDataAvailable(unsigned n, const CalibratedMagneticFieldData *data)
+{
+    // Only the latest magnetometer sample is used for heading
+    if (!n)
+        return;
+    data += n - 1;
+
     adjX = data->x_;
     adjY = data->y_;
     adjZ = data->z_;
@@ -49,11 +81,32 @@ void CompassFilter::magDataAvailable(unsigned, const CalibratedMagneticFieldData
     level = data->level_;
 }
 
-void CompassFilter::accelDataAvailable(unsigned, const AccelerationData *data)
+void CompassFilter::accelDataAvailable(unsigned n, const AccelerationData *data)
+{
+    FilterBatch<CompassData> batch;
+    for (unsigned i = 0; i < n; ++i) {
+        if (interval) {
+            // Timestamp before the last heading restarts the schedule
+            if (data[i].timestamp_ + interval < deadline)
+                deadline = data[i].timestamp_;
+            if (data[i].timestamp_ < deadline)
+                continue;
+            // Deadlines advance by the interval to keep the average rate,
+            // unless accelerometer was slower than that
+            if (data[i].timestamp_ >= deadline + interval)
+                deadline = data[i].timestamp_;
+            deadline += interval;
+        }
+        batch.append(trigFree ? northAngleTrigFree(data[i]) : northAngle(data[i]));
+    }
+    batch.propagate(magSource);
+}
+
+CompassData CompassFilter::northAngle(const AccelerationData& data)
 {
-    qreal x = data->x_ * 0.00980665; // to m/s^2
-    qreal y = data->y_ * 0.00980665;
-    qreal z = data->z_ * 0.00980665;
+    qreal x = data.x_ * 0.00980665; // to m/s^2
+    qreal y = data.y_ * 0.00980665;
+    qreal z = data.z_ * 0.00980665;
     ///////////////
     /// \brief this algorithm is from Circuit Cellar Aug 2012
     ///  by Mark Pedley
@@ -114,8 +167,56 @@ void CompassFilter::accelDataAvailable(unsigned, const AccelerationData *data)
 int offset = 90;
     ////////////////////////////////////////
     CompassData compassData; //north angle
-    compassData.timestamp_ = data->timestamp_;
+    compassData.timestamp_ = data.timestamp_;
+    compassData.degrees_ = (int)(Psi + (360 - offset)) % 360;
+    compassData.level_ = level;
+    return compassData;
+}
+
+CompassData CompassFilter::northAngleTrigFree(const AccelerationData& data)
+{
+    // Same de-rotation as northAngle(), but sin and cos of roll and pitch
+    // are the gravity components over their length. Scale of the gravity
+    // vector cancels out.
+    float Gx = data.x_;
+    float Gy = data.y_;
+    float Gz = data.z_;
+
+    float Bx = magRX - adjX;
+    float By = magRY - adjY;
+    float Bz = magRZ - adjZ;
+
+    /* roll Phi = atan2(Gy, Gz) */
+    float length = sqrtf(Gy * Gy + Gz * Gz);
+    float sinPhi = 0;
+    float cosPhi = 1;
+    if (length > 0) {
+        sinPhi = Gy / length;
+        cosPhi = Gz / length;
+    }
+
+    float fBfy = By * cosPhi - Bz * sinPhi;
+    Bz = By * sinPhi + Bz * cosPhi;
+    Gz = length; /* Gy.sin(Phi)+Gz.cos(Phi) */
+
+    /* pitch Theta = atan(-Gx / Gz), cos(Theta) is never negative */
+    length = sqrtf(Gx * Gx + Gz * Gz);
+    float sinThe = 0;
+    float cosThe = 1;
+    if (length > 0) {
+        sinThe = -Gx / length;
+        cosThe = Gz / length;
+    }
+
+    float fBfx = Bx * cosThe + Bz * sinThe;
+
+    float Psi = atan2f(-fBfy, fBfx) * (float)RADIANS_TO_DEGREES;
+
+    // because sensorfw expects x,y axis to be opposite from what this algo expects
+    int offset = 90;
+    CompassData compassData; //north angle
+    compassData.timestamp_ = data.timestamp_;
     compassData.degrees_ = (int)(Psi + (360 - offset)) % 360;
     compassData.level_ = level;
-    magSource.propagate(1, &compassData);
+    return compassData;
 }
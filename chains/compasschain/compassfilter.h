@@ -36,6 +36,39 @@ public:
         return new CompassFilter;
     }
 
+    /**
+     * Select tilt compensation kernel. The trig-free kernel derives sine
+     * and cosine of roll and pitch from normalized gravity components in
+     * single precision, leaving one atan2 for the heading. Default is
+     * read from compass/trig_free_tilt.
+     *
+     * @param value use trig-free kernel.
+     */
+    void setTrigFree(bool value);
+
+    /**
+     * Is trig-free tilt compensation kernel used.
+     *
+     * @return is trig-free kernel used.
+     */
+    bool isTrigFree() const;
+
+    /**
+     * Set how often heading is computed. Accelerometer samples arriving
+     * in between are dropped without evaluating the heading.
+     *
+     * @param ms interval in milliseconds, 0 computes heading for every
+     *           accelerometer sample.
+     */
+    void setOutputInterval(unsigned int ms);
+
+    /**
+     * How often heading is computed.
+     *
+     * @return interval in milliseconds.
+     */
+    unsigned int outputInterval() const;
+
 protected:
 
     CompassFilter();
@@ -48,6 +81,8 @@ private:
 
     void magDataAvailable(unsigned, const CalibratedMagneticFieldData*);
     void accelDataAvailable(unsigned, const AccelerationData*);
+    CompassData northAngle(const AccelerationData& data);
+    CompassData northAngleTrigFree(const AccelerationData& data);
 
     int factor;
     CalibratedMagneticFieldData magData;
@@ -62,6 +97,9 @@ private:
 
     qreal level;
     qreal oldHeading;
+    bool trigFree;
+    quint64 interval; /**< output interval in microseconds */
+    quint64 deadline; /**< timestamp at which next heading is due */
 };
 
 #endif
@@ -30,14 +30,18 @@ OrientationFilter::OrientationFilter()
     addSource(&magSource, "magnorthangle");
 }
 
-void OrientationFilter::orientDataAvailable(unsigned, const CompassData *data)
+void OrientationFilter::orientDataAvailable(unsigned n, const CompassData *data)
 {
-    CompassData compassData; //north angle
-    compassData.timestamp_ = data->timestamp_;
-    compassData.degrees_ = data->degrees_ * .001;
-    if (data->level_ > 0 && data->level_ < 3.1)
-        compassData.level_ = data->level_;
-    else
-        compassData.level_ = level;
-    magSource.propagate(1, &compassData);
+    FilterBatch<CompassData> batch;
+    for (unsigned i = 0; i < n; ++i, ++data) {
+        CompassData compassData; //north angle
+        compassData.timestamp_ = data->timestamp_;
+        compassData.degrees_ = data->degrees_ * .001;
+        if (data->level_ > 0 && data->level_ < 3.1)
+            compassData.level_ = data->level_;
+        else
+            compassData.level_ = level;
+        batch.append(compassData);
+    }
+    batch.propagate(magSource);
 }
@@ -0,0 +1,317 @@
+/**
+   @file attitudefilter.cpp
+   @brief Quaternion attitude filter fusing gyroscope, accelerometer and magnetometer
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "attitudefilter.h"
+#include "config.h"
+#include <QMutexLocker>
+#include <math.h>
+
+static const float RADIANS_TO_DEGREES = 57.2957795f;
+
+/** Gyroscope mdps to rad/s */
+static const float MDPS_TO_RADIANS = 0.017453293f / 1000;
+
+/** Accelerometer samples this far from 1 G in mG are not trusted as gravity */
+static const float MAX_LINEAR_ACCELERATION = 500;
+
+/**
+ * Normalize a vector.
+ *
+ * @return false if the vector has no direction.
+ */
+static bool normalize(float v[3])
+{
+    float length = sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+    if (length <= 0)
+        return false;
+    for (int i = 0; i < 3; ++i)
+        v[i] /= length;
+    return true;
+}
+
+static void cross(const float a[3], const float b[3], float c[3])
+{
+    c[0] = a[1] * b[2] - a[2] * b[1];
+    c[1] = a[2] * b[0] - a[0] * b[2];
+    c[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+static int roundDegrees(float degrees)
+{
+    return degrees >= 0 ? (int)(degrees + 0.5f) : (int)(degrees - 0.5f);
+}
+
+AttitudeFilter::AttitudeFilter() :
+        gyroscopeDataSink_(this, &AttitudeFilter::updateGyroscope),
+        accelerometerDataSink_(this, &AttitudeFilter::updateAccelerometer),
+        magnetometerDataSink_(this, &AttitudeFilter::updateMagnetometer),
+        hasUp_(false),
+        hasField_(false),
+        level_(0),
+        gyroscope_(false),
+        proportional_(1.0f),
+        integral_(0.05f)
+{
+    addSink(&gyroscopeDataSink_, "gyroscopesink");
+    addSink(&accelerometerDataSink_, "accelerometersink");
+    addSink(&magnetometerDataSink_, "magnetometersink");
+    addSource(&rotationSource_, "rotation");
+    addSource(&compassSource_, "compass");
+    addSource(&gravitySource_, "gravity");
+
+    if (Config::configuration()) {
+        proportional_ = Config::configuration()->value<float>("fusion/attitude_gain", proportional_);
+        integral_ = Config::configuration()->value<float>("fusion/attitude_bias_gain", integral_);
+    }
+    reset();
+}
+
+void AttitudeFilter::setGains(float proportional, float integral)
+{
+    QMutexLocker locker(&mutex_);
+    proportional_ = proportional;
+    integral_ = integral;
+}
+
+void AttitudeFilter::reset()
+{
+    QMutexLocker locker(&mutex_);
+    q_[0] = 1;
+    q_[1] = q_[2] = q_[3] = 0;
+    bias_[0] = bias_[1] = bias_[2] = 0;
+    solved_ = false;
+    timestamp_ = 0;
+}
+
+void AttitudeFilter::updateGyroscope(unsigned n, const TimedXyzData* data)
+{
+    FilterBatch<TimedXyzData> rotation;
+    FilterBatch<CompassData> compass;
+    FilterBatch<AccelerationData> gravity;
+
+    QMutexLocker locker(&mutex_);
+    gyroscope_ = true;
+    for (unsigned i = 0; i < n; ++i, ++data) {
+        // Start over after a gap or from a sample older than the attitude
+        if (!solved_ || data->timestamp_ < timestamp_ || data->timestamp_ > timestamp_ + MAX_STEP) {
+            if (!solve())
+                continue;
+        } else {
+            integrate(*data, (data->timestamp_ - timestamp_) / 1000000.0f);
+        }
+        timestamp_ = data->timestamp_;
+        publish(timestamp_, rotation, compass, gravity);
+    }
+    propagate(rotation, compass, gravity);
+}
+
+void AttitudeFilter::updateAccelerometer(unsigned n, const AccelerationData* data)
+{
+    FilterBatch<TimedXyzData> rotation;
+    FilterBatch<CompassData> compass;
+    FilterBatch<AccelerationData> gravity;
+
+    QMutexLocker locker(&mutex_);
+    for (unsigned i = 0; i < n; ++i, ++data) {
+        // Accelerometer measures gravity pointing down
+        up_[0] = -data->x_;
+        up_[1] = -data->y_;
+        up_[2] = -data->z_;
+        float length = sqrtf(up_[0] * up_[0] + up_[1] * up_[1] + up_[2] * up_[2]);
+        hasUp_ = fabsf(length - 1000) < MAX_LINEAR_ACCELERATION && normalize(up_);
+
+        if (!gyroscope_ && solve()) {
+            timestamp_ = data->timestamp_;
+            publish(timestamp_, rotation, compass, gravity);
+        }
+    }
+    propagate(rotation, compass, gravity);
+}
+
+void AttitudeFilter::updateMagnetometer(unsigned n, const CalibratedMagneticFieldData* data)
+{
+    // Only the latest magnetometer sample is used for feedback
+    if (!n)
+        return;
+    data += n - 1;
+
+    QMutexLocker locker(&mutex_);
+    field_[0] = data->x_;
+    field_[1] = data->y_;
+    field_[2] = data->z_;
+    hasField_ = normalize(field_);
+    level_ = data->level_;
+}
+
+bool AttitudeFilter::solve()
+{
+    if (!hasUp_)
+        return false;
+
+    // Rows of the matrix are north, west and up in device frame. Without
+    // magnetic field the top edge of the device is taken as north.
+    float r[3][3];
+    for (int i = 0; i < 3; ++i)
+        r[2][i] = up_[i];
+    float east[3];
+    bool hasEast = false;
+    if (hasField_) {
+        cross(field_, up_, east);
+        hasEast = normalize(east);
+    }
+    if (hasEast) {
+        cross(up_, east, r[0]);
+    } else {
+        // Top edge, or right edge when top points up or down
+        float axis[3] = { 0, 1, 0 };
+        if (fabsf(up_[1]) > 0.9f) {
+            axis[0] = 1;
+            axis[1] = 0;
+        }
+        float along = axis[0] * up_[0] + axis[1] * up_[1];
+        for (int i = 0; i < 3; ++i)
+            r[0][i] = axis[i] - along * up_[i];
+        normalize(r[0]);
+    }
+    cross(r[2], r[0], r[1]);
+
+    // Quaternion of the rotation matrix
+    float trace = r[0][0] + r[1][1] + r[2][2];
+    if (trace > 0) {
+        float s = 0.5f / sqrtf(trace + 1);
+        q_[0] = 0.25f / s;
+        q_[1] = (r[2][1] - r[1][2]) * s;
+        q_[2] = (r[0][2] - r[2][0]) * s;
+        q_[3] = (r[1][0] - r[0][1]) * s;
+    } else if (r[0][0] > r[1][1] && r[0][0] > r[2][2]) {
+        float s = 2 * sqrtf(1 + r[0][0] - r[1][1] - r[2][2]);
+        q_[0] = (r[2][1] - r[1][2]) / s;
+        q_[1] = 0.25f * s;
+        q_[2] = (r[0][1] + r[1][0]) / s;
+        q_[3] = (r[0][2] + r[2][0]) / s;
+    } else if (r[1][1] > r[2][2]) {
+        float s = 2 * sqrtf(1 + r[1][1] - r[0][0] - r[2][2]);
+        q_[0] = (r[0][2] - r[2][0]) / s;
+        q_[1] = (r[0][1] + r[1][0]) / s;
+        q_[2] = 0.25f * s;
+        q_[3] = (r[1][2] + r[2][1]) / s;
+    } else {
+        float s = 2 * sqrtf(1 + r[2][2] - r[0][0] - r[1][1]);
+        q_[0] = (r[1][0] - r[0][1]) / s;
+        q_[1] = (r[0][2] + r[2][0]) / s;
+        q_[2] = (r[1][2] + r[2][1]) / s;
+        q_[3] = 0.25f * s;
+    }
+    solved_ = true;
+    return true;
+}
+
+void AttitudeFilter::integrate(const TimedXyzData& rate, float dt)
+{
+    float omega[3] = { rate.x_ * MDPS_TO_RADIANS, rate.y_ * MDPS_TO_RADIANS, rate.z_ * MDPS_TO_RADIANS };
+
+    if (hasUp_) {
+        float r[3][3];
+        matrix(r);
+
+        // Rotate estimated directions towards the measured ones
+        float error[3];
+        cross(up_, r[2], error);
+        if (hasField_) {
+            // Field is expected to point north with the inclination it
+            // has in earth frame, which leaves heading to the feedback
+            float north = r[0][0] * field_[0] + r[0][1] * field_[1] + r[0][2] * field_[2];
+            float west = r[1][0] * field_[0] + r[1][1] * field_[1] + r[1][2] * field_[2];
+            float up = r[2][0] * field_[0] + r[2][1] * field_[1] + r[2][2] * field_[2];
+            float horizontal = sqrtf(north * north + west * west);
+            float expected[3];
+            for (int i = 0; i < 3; ++i)
+                expected[i] = horizontal * r[0][i] + up * r[2][i];
+            float fieldError[3];
+            cross(field_, expected, fieldError);
+            for (int i = 0; i < 3; ++i)
+                error[i] += fieldError[i];
+        }
+        for (int i = 0; i < 3; ++i) {
+            bias_[i] += integral_ * error[i] * dt;
+            omega[i] += proportional_ * error[i] + bias_[i];
+        }
+    }
+
+    // q' = q + q * (0, omega) * dt / 2
+    float h = 0.5f * dt;
+    float w = q_[0], x = q_[1], y = q_[2], z = q_[3];
+    q_[0] += (-x * omega[0] - y * omega[1] - z * omega[2]) * h;
+    q_[1] += ( w * omega[0] + y * omega[2] - z * omega[1]) * h;
+    q_[2] += ( w * omega[1] - x * omega[2] + z * omega[0]) * h;
+    q_[3] += ( w * omega[2] + x * omega[1] - y * omega[0]) * h;
+
+    float norm = sqrtf(q_[0] * q_[0] + q_[1] * q_[1] + q_[2] * q_[2] + q_[3] * q_[3]);
+    for (int i = 0; i < 4; ++i)
+        q_[i] /= norm;
+}
+
+void AttitudeFilter::matrix(float r[3][3]) const
+{
+    float w = q_[0], x = q_[1], y = q_[2], z = q_[3];
+    r[0][0] = 1 - 2 * (y * y + z * z);
+    r[0][1] = 2 * (x * y - w * z);
+    r[0][2] = 2 * (x * z + w * y);
+    r[1][0] = 2 * (x * y + w * z);
+    r[1][1] = 1 - 2 * (x * x + z * z);
+    r[1][2] = 2 * (y * z - w * x);
+    r[2][0] = 2 * (x * z - w * y);
+    r[2][1] = 2 * (y * z + w * x);
+    r[2][2] = 1 - 2 * (x * x + y * y);
+}
+
+void AttitudeFilter::publish(quint64 timestamp, FilterBatch<TimedXyzData>& rotation,
+                             FilterBatch<CompassData>& compass, FilterBatch<AccelerationData>& gravity) const
+{
+    float r[3][3];
+    matrix(r);
+
+    // Gravity points down in device frame
+    float gx = -r[2][0];
+    float gy = -r[2][1];
+    float gz = -r[2][2];
+    gravity.append(AccelerationData(timestamp, qRound(gx * 1000), qRound(gy * 1000), qRound(gz * 1000)));
+
+    // Heading of the top edge clockwise from north, east being minus west
+    int heading = roundDegrees(atan2f(-r[1][1], r[0][1]) * RADIANS_TO_DEGREES);
+    heading = (heading + 360) % 360;
+    compass.append(CompassData(timestamp, heading, hasField_ ? level_ : 0));
+
+    // Same rotation as RotationFilter computes from gravity and heading
+    float x = -atan2f(gy, sqrtf(gx * gx + gz * gz)) * RADIANS_TO_DEGREES;
+    float yz = sqrtf(gy * gy + gz * gz);
+    float y = (gx == 0 && gz == 0) ? 0 : atan2f(gx, gz >= 0 ? -yz : yz) * RADIANS_TO_DEGREES;
+    int degrees = roundDegrees(y);
+    rotation.append(TimedXyzData(timestamp, roundDegrees(x), degrees == -180 ? 180 : degrees, 180 - heading));
+}
+
+void AttitudeFilter::propagate(FilterBatch<TimedXyzData>& rotation,
+                               FilterBatch<CompassData>& compass, FilterBatch<AccelerationData>& gravity)
+{
+    rotation.propagate(rotationSource_);
+    compass.propagate(compassSource_);
+    gravity.propagate(gravitySource_);
+}
@@ -0,0 +1,147 @@
+/**
+   @file attitudefilter.h
+   @brief Quaternion attitude filter fusing gyroscope, accelerometer and magnetometer
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef ATTITUDEFILTER_H
+#define ATTITUDEFILTER_H
+
+#include <QObject>
+#include <QMutex>
+
+#include "orientationdata.h"
+#include "filter.h"
+
+/**
+ * @brief Filter keeping device attitude as a unit quaternion.
+ *
+ * Attitude is integrated from every gyroscope sample. The latest
+ * accelerometer and magnetometer samples pull it towards gravity and
+ * magnetic north with complementary feedback, whose integral also
+ * cancels gyroscope bias. An update costs a few dozen multiplications
+ * and two square roots. Without gyroscope the attitude is solved from
+ * accelerometer and magnetometer at every accelerometer sample.
+ *
+ * Every update is published as rotation in the format of RotationFilter,
+ * as magnetic north heading of the top edge, and as gravity in mG with
+ * linear acceleration filtered out.
+ *
+ * Feedback gains are read from fusion/attitude_gain and
+ * fusion/attitude_bias_gain in 1/s.
+ */
+class AttitudeFilter : public QObject, public FilterBase
+{
+    Q_OBJECT;
+public:
+    /**
+     * Factory method.
+     * @return New AttitudeFilter instance as FilterBase*.
+     */
+    static FilterBase* factoryMethod()
+    {
+        return new AttitudeFilter();
+    }
+
+    /**
+     * Set feedback gains.
+     *
+     * @param proportional correction towards measured directions in 1/s.
+     * @param integral gyroscope bias correction in 1/s.
+     */
+    void setGains(float proportional, float integral);
+
+    /**
+     * Forget attitude and bias. Next update starts from the measured
+     * directions.
+     */
+    void reset();
+
+private:
+    /**
+     * Default constructor.
+     */
+    AttitudeFilter();
+
+    Sink<AttitudeFilter, TimedXyzData>                gyroscopeDataSink_;
+    Sink<AttitudeFilter, AccelerationData>            accelerometerDataSink_;
+    Sink<AttitudeFilter, CalibratedMagneticFieldData> magnetometerDataSink_;
+    Source<TimedXyzData>                              rotationSource_;
+    Source<CompassData>                               compassSource_;
+    Source<AccelerationData>                          gravitySource_;
+
+    void updateGyroscope(unsigned, const TimedXyzData*);
+    void updateAccelerometer(unsigned, const AccelerationData*);
+    void updateMagnetometer(unsigned, const CalibratedMagneticFieldData*);
+
+    /**
+     * Set attitude from the latest accelerometer and magnetometer
+     * samples. Caller holds mutex_.
+     *
+     * @return false if there is no usable accelerometer sample.
+     */
+    bool solve();
+
+    /**
+     * Integrate angular velocity with feedback from the latest
+     * accelerometer and magnetometer samples. Caller holds mutex_.
+     *
+     * @param rate angular velocity in mdps.
+     * @param dt time step in seconds.
+     */
+    void integrate(const TimedXyzData& rate, float dt);
+
+    /**
+     * Rotation matrix from device to earth frame, whose axes are
+     * magnetic north, west and up. Caller holds mutex_.
+     *
+     * @param r location for the matrix.
+     */
+    void matrix(float r[3][3]) const;
+
+    /**
+     * Append the attitude to output batches. Caller holds mutex_.
+     */
+    void publish(quint64 timestamp, FilterBatch<TimedXyzData>& rotation,
+                 FilterBatch<CompassData>& compass, FilterBatch<AccelerationData>& gravity) const;
+
+    /**
+     * Propagate output batches. Caller holds mutex_.
+     */
+    void propagate(FilterBatch<TimedXyzData>& rotation,
+                   FilterBatch<CompassData>& compass, FilterBatch<AccelerationData>& gravity);
+
+    /** Longer gyroscope gaps restart from the measured directions, us. */
+    static const quint64 MAX_STEP = 500000;
+
+    QMutex       mutex_;         /**< sinks may be fed from different threads */
+    float        q_[4];          /**< attitude, w x y z */
+    float        bias_[3];       /**< integral feedback in rad/s */
+    float        up_[3];         /**< latest unit up vector, device frame */
+    float        field_[3];      /**< latest unit magnetic field, device frame */
+    bool         hasUp_;         /**< is up_ usable */
+    bool         hasField_;      /**< is field_ usable */
+    int          level_;         /**< magnetometer calibration level */
+    bool         solved_;        /**< does q_ hold an attitude */
+    bool         gyroscope_;     /**< has gyroscope delivered samples */
+    quint64      timestamp_;     /**< time of q_ */
+    float        proportional_;  /**< proportional gain in 1/s */
+    float        integral_;      /**< integral gain in 1/s */
+};
+
+#endif // ATTITUDEFILTER_H
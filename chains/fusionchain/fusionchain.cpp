@@ -0,0 +1,182 @@
+/**
+   @file fusionchain.cpp
+   @brief FusionChain
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "fusionchain.h"
+#include "sensormanager.h"
+#include "bin.h"
+#include "bufferreader.h"
+
+FusionChain::FusionChain(const QString& id) :
+    AbstractChain(id),
+    gyroscopeReader_(NULL),
+    magnetometerReader_(NULL)
+{
+    NodeArenaScope scope(&arena());
+    SensorManager& sm = SensorManager::instance();
+
+    accelerometerChain_ = sm.requestChain("accelerometerchain");
+    Q_ASSERT( accelerometerChain_ );
+    setValid(accelerometerChain_->isValid());
+
+    accelerometerReader_ = new BufferReader<AccelerationData>(FILTER_BATCH_SIZE);
+
+    gyroscopeAdaptor_ = sm.requestDeviceAdaptor("gyroscopeadaptor");
+    if (gyroscopeAdaptor_ && gyroscopeAdaptor_->isValid()) {
+        gyroscopeReader_ = new BufferReader<TimedXyzData>(FILTER_BATCH_SIZE);
+    } else {
+        sensordLogW() << "Unable to use gyroscope for attitude, following accelerometer only.";
+    }
+
+    magnetometerChain_ = sm.requestChain("magcalibrationchain");
+    if (magnetometerChain_ && magnetometerChain_->isValid()) {
+        magnetometerReader_ = new BufferReader<CalibratedMagneticFieldData>(FILTER_BATCH_SIZE);
+    } else {
+        sensordLogW() << "Unable to use magnetometer for attitude.";
+    }
+
+    attitudeFilter_ = sm.instantiateFilter("attitudefilter");
+    Q_ASSERT(attitudeFilter_);
+
+    rotationOutput_ = new RingBuffer<TimedXyzData>(FILTER_BATCH_SIZE);
+    nameOutputBuffer("rotation", rotationOutput_);
+
+    compassOutput_ = new RingBuffer<CompassData>(FILTER_BATCH_SIZE);
+    nameOutputBuffer("compass", compassOutput_);
+
+    gravityOutput_ = new RingBuffer<AccelerationData>(FILTER_BATCH_SIZE);
+    nameOutputBuffer("gravity", gravityOutput_);
+
+    // Create buffers for filter chain
+    filterBin_ = new Bin;
+
+    filterBin_->add(accelerometerReader_, "accelerometer");
+    filterBin_->add(attitudeFilter_, "attitude");
+    filterBin_->add(rotationOutput_, "rotationbuffer");
+    filterBin_->add(compassOutput_, "compassbuffer");
+    filterBin_->add(gravityOutput_, "gravitybuffer");
+
+    // Join filterchain buffers
+    filterBin_->join("accelerometer", "source", "attitude", "accelerometersink");
+    filterBin_->join("attitude", "rotation", "rotationbuffer", "sink");
+    filterBin_->join("attitude", "compass", "compassbuffer", "sink");
+    filterBin_->join("attitude", "gravity", "gravitybuffer", "sink");
+
+    // Join datasources to the chain
+    connectToSource(accelerometerChain_, "accelerometer", accelerometerReader_);
+
+    if (hasGyroscope())
+    {
+        filterBin_->add(gyroscopeReader_, "gyroscope");
+        filterBin_->join("gyroscope", "source", "attitude", "gyroscopesink");
+        connectToSource(gyroscopeAdaptor_, "gyroscope", gyroscopeReader_);
+        addStandbyOverrideSource(gyroscopeAdaptor_);
+    }
+
+    if (hasMagnetometer())
+    {
+        filterBin_->add(magnetometerReader_, "magnetometer");
+        filterBin_->join("magnetometer", "source", "attitude", "magnetometersink");
+        connectToSource(magnetometerChain_, "calibratedmagnetometerdata", magnetometerReader_);
+        addStandbyOverrideSource(magnetometerChain_);
+    }
+
+    setDescription("Device attitude fused from gyroscope, accelerometer and magnetometer");
+    addStandbyOverrideSource(accelerometerChain_);
+    foreach (const DataRange& range, accelerometerChain_->getAvailableIntervals())
+        introduceAvailableInterval(range);
+}
+
+FusionChain::~FusionChain()
+{
+    SensorManager& sm = SensorManager::instance();
+
+    disconnectFromSource(accelerometerChain_, "accelerometer", accelerometerReader_);
+    sm.releaseChain("accelerometerchain");
+
+    if (hasGyroscope())
+    {
+        disconnectFromSource(gyroscopeAdaptor_, "gyroscope", gyroscopeReader_);
+        delete gyroscopeReader_;
+    }
+    if (gyroscopeAdaptor_)
+        sm.releaseDeviceAdaptor("gyroscopeadaptor");
+
+    if (hasMagnetometer())
+    {
+        disconnectFromSource(magnetometerChain_, "calibratedmagnetometerdata", magnetometerReader_);
+        delete magnetometerReader_;
+    }
+    if (magnetometerChain_)
+        sm.releaseChain("magcalibrationchain");
+
+    delete accelerometerReader_;
+    delete attitudeFilter_;
+    delete rotationOutput_;
+    delete compassOutput_;
+    delete gravityOutput_;
+    delete filterBin_;
+}
+
+bool FusionChain::start()
+{
+    if (AbstractSensorChannel::start()) {
+        sensordLogD() << "Starting FusionChain";
+        filterBin_->start();
+        accelerometerChain_->start();
+        if (hasGyroscope())
+            gyroscopeAdaptor_->startSensor();
+        if (hasMagnetometer())
+            magnetometerChain_->start();
+    }
+    return true;
+}
+
+bool FusionChain::stop()
+{
+    if (AbstractSensorChannel::stop()) {
+        sensordLogD() << "Stopping FusionChain";
+        accelerometerChain_->stop();
+        if (hasGyroscope())
+            gyroscopeAdaptor_->stopSensor();
+        if (hasMagnetometer())
+            magnetometerChain_->stop();
+        filterBin_->stop();
+    }
+    return true;
+}
+
+unsigned int FusionChain::interval() const
+{
+    // Gyroscope samples drive the updates when there is one
+    if (hasGyroscope())
+        return gyroscopeAdaptor_->getInterval();
+    return accelerometerChain_->getInterval();
+}
+
+bool FusionChain::setInterval(unsigned int value, int sessionId)
+{
+    bool success = accelerometerChain_->setIntervalRequest(sessionId, value);
+    if (hasGyroscope())
+        success = gyroscopeAdaptor_->setIntervalRequest(sessionId, value) && success;
+    if (hasMagnetometer())
+        success = magnetometerChain_->setIntervalRequest(sessionId, value) && success;
+    return success;
+}
@@ -0,0 +1,99 @@
+/**
+   @file fusionchain.h
+   @brief FusionChain
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef FUSIONCHAIN_H
+#define FUSIONCHAIN_H
+
+#include "abstractchain.h"
+#include "deviceadaptor.h"
+#include "bufferreader.h"
+#include "filter.h"
+#include "bin.h"
+#include "datatypes/orientationdata.h"
+
+class Bin;
+template <class TYPE> class BufferReader;
+class FilterBase;
+
+/**
+ * @brief Fusionchain provides device attitude fused from gyroscope,
+ * accelerometer and magnetometer by AttitudeFilter.
+ *
+ * Output is updated at every gyroscope sample, or at every accelerometer
+ * sample when there is no gyroscope. Missing magnetometer leaves the
+ * heading to drift with the gyroscope.
+ *
+ * <b>Output buffers:</b>
+ * <ul><li>\em rotation in the format of rotationsensor</li>
+ *     <li>\em compass magnetic north heading of the top edge</li>
+ *     <li>\em gravity gravity in mG without linear acceleration</li></ul>
+ */
+class FusionChain : public AbstractChain
+{
+    Q_OBJECT;
+
+public:
+    /**
+     * Factory method for FusionChain.
+     * @return Pointer to new FusionChain instance as AbstractChain*
+     */
+    static AbstractChain* factoryMethod(const QString& id)
+    {
+        FusionChain* sc = new FusionChain(id);
+        return sc;
+    }
+
+    bool hasGyroscope() const
+    {
+        return gyroscopeReader_;
+    }
+
+    bool hasMagnetometer() const
+    {
+        return magnetometerReader_;
+    }
+
+    virtual unsigned int interval() const;
+    virtual bool setInterval(unsigned int value, int sessionId);
+
+public Q_SLOTS:
+    bool start();
+    bool stop();
+
+protected:
+    FusionChain(const QString& id);
+    ~FusionChain();
+
+private:
+    Bin*                                        filterBin_;
+    AbstractChain*                              accelerometerChain_;
+    DeviceAdaptor*                              gyroscopeAdaptor_;
+    AbstractChain*                              magnetometerChain_;
+    BufferReader<AccelerationData>*             accelerometerReader_;
+    BufferReader<TimedXyzData>*                 gyroscopeReader_;
+    BufferReader<CalibratedMagneticFieldData>*  magnetometerReader_;
+    FilterBase*                                 attitudeFilter_;
+    RingBuffer<TimedXyzData>*                   rotationOutput_;
+    RingBuffer<CompassData>*                    compassOutput_;
+    RingBuffer<AccelerationData>*               gravityOutput_;
+};
+
+#endif // FUSIONCHAIN_H
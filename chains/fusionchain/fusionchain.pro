@@ -0,0 +1,11 @@
+TARGET       = fusionchain
+
+HEADERS += fusionchain.h   \
+           fusionchainplugin.h \
+           attitudefilter.h
+
+SOURCES += fusionchain.cpp   \
+           fusionchainplugin.cpp \
+           attitudefilter.cpp
+
+include( ../chain-config.pri )
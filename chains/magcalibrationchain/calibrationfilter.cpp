@@ -22,75 +22,126 @@
 
 #include "calibrationfilter.h"
 #include "config.h"
+#include "boosthints.h"
 
 CalibrationFilter::CalibrationFilter() :
     Filter<TimedXyzData, CalibrationFilter, CalibratedMagneticFieldData>(this, &CalibrationFilter::magDataAvailable),
     magDataSink(this, &CalibrationFilter::magDataAvailable),
-    calLevel(0)
+    hasRange(false),
+    scale(300),
+    boost(-1)
 {
     addSink(&magDataSink, "magsink");
     addSource(&magSource, "calibratedmagneticfield");
-// min, max
-    minMaxList.insert(0,qMakePair(0,0));
-    minMaxList.insert(1,qMakePair(0,0));
-    minMaxList.insert(2,qMakePair(0,0));
+    addSource(&scaledSource, "scaledmagneticfield");
+
+    unsigned int solveSamples = 100;
+    unsigned int memory = 3000;
+    if (Config::configuration()) {
+        solveSamples = Config::configuration()->value<unsigned int>("magnetometer/calibration_solve_samples", solveSamples);
+        memory = Config::configuration()->value<unsigned int>("magnetometer/calibration_memory", memory);
+    }
+    calibrator = new EllipsoidCalibrator(solveSamples, memory);
+
+    QString cachePath = "/var/lib/sensord/magnetometer-calibration";
+    unsigned int cacheInterval = 60000;
+    if (Config::configuration()) {
+        cachePath = Config::configuration()->value<QString>("magnetometer/calibration_cache", cachePath);
+        cacheInterval = Config::configuration()->value<unsigned int>("magnetometer/calibration_cache_interval", cacheInterval);
+    }
+    calibrator->setCache(cachePath, cacheInterval);
+
+    if (Config::configuration())
+        scale = Config::configuration()->value<int>("magnetometer/scale_coefficient", scale);
+
+    // No boost file by default, devices opt in with boost/magcalibration_path
+    boost = BoostHints::instance().registerHint("magcalibration");
 }
 
-#define LISTCOUNT 10
+CalibrationFilter::~CalibrationFilter()
+{
+    delete calibrator;
+}
 
-void CalibrationFilter::magDataAvailable(unsigned, const TimedXyzData *data)
+void CalibrationFilter::magDataAvailable(unsigned n, const TimedXyzData *data)
 {
-    CalibratedMagneticFieldData transformed;
+    FilterBatch<CalibratedMagneticFieldData> batch;
+    FilterBatch<CalibratedMagneticFieldData> scaled;
+    for (unsigned i = 0; i < n; ++i) {
+        batch.append(calibrate(data[i]));
+        if (scale != 1) {
+            // Scaling is part of the calibration pass, so scaled users
+            // need no stage of their own
+            scaled.append(batch[i]);
+            CalibratedMagneticFieldData& transformed = scaled[i];
+            transformed.x_ *= scale;
+            transformed.y_ *= scale;
+            transformed.z_ *= scale;
+            transformed.rx_ *= scale;
+            transformed.ry_ *= scale;
+            transformed.rz_ *= scale;
+        }
+    }
+    // Fitting is the expensive part of calibration
+    if (!calibrator->calibration())
+        BoostHints::instance().hint(boost);
+    batch.propagate(magSource);
+    batch.propagate(source_);
+    scaled.propagate(scaledSource);
+}
 
-    transformed.timestamp_ = data->timestamp_;
-
-  //  if (calLevel != 3) {
-        //    simple hard iron correction
-        if (minMaxList.at(0).first == 0) {
-            minMaxList.replace(0,qMakePair(data->x_, data->x_));
-            minMaxList.replace(1,qMakePair(data->y_, data->y_));
-            minMaxList.replace(2,qMakePair(data->z_, data->z_));
-
-        } else {
-            minMaxList.replace(0,qMakePair(qMin(minMaxList.at(0).first, data->x_),
-                                           qMax(minMaxList.at(0).second, data->x_)));
-            minMaxList.replace(1,qMakePair(qMin(minMaxList.at(1).first, data->y_),
-                                           qMax(minMaxList.at(1).second, data->y_)));
-            minMaxList.replace(2,qMakePair(qMin(minMaxList.at(2).first, data->z_),
-                                           qMax(minMaxList.at(2).second, data->z_)));
+CalibratedMagneticFieldData CalibrationFilter::calibrate(const TimedXyzData& sample)
+{
+    CalibratedMagneticFieldData transformed;
+    const int raw[3] = { sample.x_, sample.y_, sample.z_ };
+    int offset[3];
+
+    transformed.timestamp_ = sample.timestamp_;
+
+    calibrator->accumulate(sample.x_, sample.y_, sample.z_);
+    const MagCalibration* calibration = calibrator->calibration();
+    if (calibration) {
+        // Offset is what is subtracted from the raw value to get the
+        // calibrated one, so consumers need not know of soft iron
+        const double relative[3] = { raw[0] - calibration->offset[0],
+                                     raw[1] - calibration->offset[1],
+                                     raw[2] - calibration->offset[2] };
+        for (int i = 0; i < 3; ++i) {
+            double calibrated = calibration->matrix[i][0] * relative[0] +
+                                calibration->matrix[i][1] * relative[1] +
+                                calibration->matrix[i][2] * relative[2];
+            offset[i] = raw[i] - qRound(calibrated);
         }
-        qreal newX = (minMaxList.at(0).first + minMaxList.at(0).second) * .5;
-        qreal newY = (minMaxList.at(1).first + minMaxList.at(1).second) * .5;
-        qreal newZ = (minMaxList.at(2).first + minMaxList.at(2).second) * .5;
-
-        calLevel = 0;
-        if (oldX == newX)
-            calLevel += 1;
-        if (oldY == newY)
-            calLevel += 1;
-        if (oldZ == newZ)
-            calLevel += 1;
-
-        oldX = newX;
-        oldY = newY;
-        oldZ = newZ;
-  //  }
-    transformed.level_ = calLevel;
-
-    transformed.x_ = oldX;
-    transformed.y_ = oldY;
-    transformed.z_ = oldZ;
-
-    transformed.rx_ = data->x_;
-    transformed.ry_ = data->y_;
-    transformed.rz_ = data->z_;
-
-    magSource.propagate(1, &transformed);
-    source_.propagate(1, &transformed);
+        transformed.level_ = calibration->level;
+    } else {
+        // simple hard iron correction until samples make a fit
+        for (int i = 0; i < 3; ++i) {
+            minimum[i] = hasRange ? qMin(minimum[i], raw[i]) : raw[i];
+            maximum[i] = hasRange ? qMax(maximum[i], raw[i]) : raw[i];
+            offset[i] = (minimum[i] + maximum[i]) / 2;
+        }
+        hasRange = true;
+        transformed.level_ = 0;
+    }
+
+    transformed.x_ = offset[0];
+    transformed.y_ = offset[1];
+    transformed.z_ = offset[2];
+
+    transformed.rx_ = sample.x_;
+    transformed.ry_ = sample.y_;
+    transformed.rz_ = sample.z_;
+
+    return transformed;
+}
+
+int CalibrationFilter::scaleFactor() const
+{
+    return scale;
 }
 
 void CalibrationFilter::dropCalibration()
 {
-    calLevel = 0;
-    minMaxList.clear();
+    hasRange = false;
+    calibrator->reset();
 }
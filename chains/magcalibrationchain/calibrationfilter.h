@@ -25,6 +25,7 @@
 
 #include "orientationdata.h"
 #include "filter.h"
+#include "ellipsoidcalibrator.h"
 
 
 class CalibrationFilter : public QObject, public Filter<TimedXyzData, CalibrationFilter, CalibratedMagneticFieldData>
@@ -38,6 +39,14 @@ public:
     }
     void dropCalibration();
 
+    /**
+     * Factor of the scaled source, from magnetometer/scale_coefficient.
+     * @return scale factor.
+     */
+    int scaleFactor() const;
+
+    ~CalibrationFilter();
+
 protected:
 
     CalibrationFilter();
@@ -47,17 +56,20 @@ private:
     Sink<CalibrationFilter, TimedXyzData> magDataSink;
 
     Source<CalibratedMagneticFieldData> magSource;
+    Source<CalibratedMagneticFieldData> scaledSource; /**< calibrated values multiplied by #scale */
 
     void magDataAvailable(unsigned, const TimedXyzData * );
+    CalibratedMagneticFieldData calibrate(const TimedXyzData& sample);
 
     CalibratedMagneticFieldData magData;
-    QList <QPair<int,int> > minMaxList;
 
-    qreal oldX;
-    qreal oldY;
-    qreal oldZ;
+    EllipsoidCalibrator* calibrator; /**< hard and soft iron fit */
 
-    qreal calLevel;
+    bool hasRange;   /**< are minimum and maximum set */
+    int minimum[3];  /**< smallest raw values, used until the first fit */
+    int maximum[3];  /**< largest raw values, used until the first fit */
+    int scale;       /**< factor of the scaled source */
+    int boost;       /**< BoostHints handle raised until the first fit */
 };
 
 #endif
@@ -0,0 +1,448 @@
+/**
+   @file ellipsoidcalibrator.cpp
+   @brief Online hard and soft iron calibration of magnetometer
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "ellipsoidcalibrator.h"
+#include "logging.h"
+#include "datatypes/atomic.h"
+#include <QFile>
+#include <QSaveFile>
+#include <math.h>
+#include <string.h>
+
+/** Longest to shortest ellipsoid axis accepted as soft iron distortion */
+static const double MAX_AXIS_RATIO = 3.0;
+
+/**
+ * Contents of the cache file.
+ */
+struct CalibrationCache
+{
+    quint32        magic;       /**< CACHE_MAGIC */
+    quint32        version;     /**< CACHE_VERSION */
+    MagCalibration calibration; /**< latest fit */
+    EllipsoidSums  sums;        /**< samples of the fit */
+};
+
+static const quint32 CACHE_MAGIC = 0x4c41434d; // "MCAL"
+static const quint32 CACHE_VERSION = 1;
+
+/**
+ * Eigen decomposition of a symmetric 3x3 matrix with Jacobi rotations.
+ *
+ * @param a matrix, diagonal is set to the eigenvalues.
+ * @param v set to eigenvectors as columns.
+ */
+static void eigen(double a[3][3], double v[3][3])
+{
+    for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 3; ++j)
+            v[i][j] = (i == j);
+
+    for (int sweep = 0; sweep < 32; ++sweep) {
+        double off = a[0][1] * a[0][1] + a[0][2] * a[0][2] + a[1][2] * a[1][2];
+        double diagonal = a[0][0] * a[0][0] + a[1][1] * a[1][1] + a[2][2] * a[2][2];
+        if (off <= 1e-24 * diagonal)
+            return;
+        for (int p = 0; p < 2; ++p) {
+            for (int q = p + 1; q < 3; ++q) {
+                if (a[p][q] == 0)
+                    continue;
+                double theta = (a[q][q] - a[p][p]) / (2 * a[p][q]);
+                double t = (theta >= 0 ? 1 : -1) / (fabs(theta) + sqrt(theta * theta + 1));
+                double c = 1 / sqrt(t * t + 1);
+                double s = t * c;
+                for (int k = 0; k < 3; ++k) {
+                    double akp = a[k][p];
+                    double akq = a[k][q];
+                    a[k][p] = c * akp - s * akq;
+                    a[k][q] = s * akp + c * akq;
+                }
+                for (int k = 0; k < 3; ++k) {
+                    double apk = a[p][k];
+                    double aqk = a[q][k];
+                    a[p][k] = c * apk - s * aqk;
+                    a[q][k] = s * apk + c * aqk;
+                }
+                for (int k = 0; k < 3; ++k) {
+                    double vkp = v[k][p];
+                    double vkq = v[k][q];
+                    v[k][p] = c * vkp - s * vkq;
+                    v[k][q] = s * vkp + c * vkq;
+                }
+            }
+        }
+    }
+}
+
+EllipsoidCalibrator::EllipsoidCalibrator(unsigned int solveSamples, unsigned int memory) :
+    solveSamples_(qMax(solveSamples, 1u)),
+    sinceSolve_(0),
+    decay_(memory ? exp(-(double)solveSamples_ / memory) : 1),
+    current_(0),
+    published_(0),
+    pending_(false),
+    stopping_(false),
+    discard_(false),
+    generation_(0),
+    writeInterval_(0),
+    unsaved_(false)
+{
+    memset(&sums_, 0, sizeof(sums_));
+    memset(&snapshot_, 0, sizeof(snapshot_));
+}
+
+EllipsoidCalibrator::~EllipsoidCalibrator()
+{
+    mutex_.lock();
+    stopping_ = true;
+    wakeup_.wakeOne();
+    mutex_.unlock();
+    wait();
+    if (discard_)
+        QFile::remove(cachePath_);
+    else if (unsaved_)
+        writeCache();
+    delete current_;
+    delete published_.fetchAndStoreAcquire(0);
+}
+
+void EllipsoidCalibrator::accumulate(int x, int y, int z)
+{
+    if (sums_.weight == 0) {
+        sums_.origin[0] = x;
+        sums_.origin[1] = y;
+        sums_.origin[2] = z;
+    }
+    double u = x - sums_.origin[0];
+    double v = y - sums_.origin[1];
+    double w = z - sums_.origin[2];
+    const double terms[EllipsoidSums::TERMS] = { u * u, v * v, w * w, u * v, u * w, v * w, u, v, w };
+    for (int i = 0; i < EllipsoidSums::TERMS; ++i) {
+        for (int j = i; j < EllipsoidSums::TERMS; ++j)
+            sums_.product[i][j] += terms[i] * terms[j];
+        sums_.term[i] += terms[i];
+    }
+    sums_.weight += 1;
+
+    if (++sinceSolve_ < solveSamples_)
+        return;
+    sinceSolve_ = 0;
+    if (sums_.weight >= MIN_SAMPLES) {
+        mutex_.lock();
+        snapshot_ = sums_;
+        pending_ = true;
+        wakeup_.wakeOne();
+        mutex_.unlock();
+        if (!isRunning())
+            start(QThread::LowestPriority);
+    }
+    for (int i = 0; i < EllipsoidSums::TERMS; ++i) {
+        for (int j = i; j < EllipsoidSums::TERMS; ++j)
+            sums_.product[i][j] *= decay_;
+        sums_.term[i] *= decay_;
+    }
+    sums_.weight *= decay_;
+}
+
+const MagCalibration* EllipsoidCalibrator::calibration()
+{
+    if (Atomic::loadAcquire(published_)) {
+        MagCalibration* latest = published_.fetchAndStoreAcquire(0);
+        if (latest && latest->generation == sums_.generation) {
+            delete current_;
+            current_ = latest;
+        } else {
+            delete latest;
+        }
+    }
+    return current_;
+}
+
+void EllipsoidCalibrator::reset()
+{
+    unsigned int generation = sums_.generation + 1;
+    memset(&sums_, 0, sizeof(sums_));
+    sums_.generation = generation;
+    sinceSolve_ = 0;
+    delete current_;
+    current_ = 0;
+    delete published_.fetchAndStoreAcquire(0);
+
+    mutex_.lock();
+    pending_ = false;
+    generation_ = generation;
+    if (!cachePath_.isEmpty()) {
+        discard_ = true;
+        wakeup_.wakeOne();
+    }
+    mutex_.unlock();
+    if (discard_ && !isRunning())
+        start(QThread::LowestPriority);
+}
+
+bool EllipsoidCalibrator::setCache(const QString& path, unsigned int writeInterval)
+{
+    cachePath_ = path;
+    writeInterval_ = writeInterval;
+    if (path.isEmpty())
+        return false;
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    CalibrationCache cache;
+    if (file.size() != sizeof(cache) || file.read((char*)&cache, sizeof(cache)) != sizeof(cache) ||
+        cache.magic != CACHE_MAGIC || cache.version != CACHE_VERSION || !(cache.sums.weight >= 0)) {
+        sensordLogW() << "Ignoring invalid magnetometer calibration cache" << path;
+        return false;
+    }
+
+    unsigned int generation = sums_.generation;
+    sums_ = cache.sums;
+    sums_.generation = generation;
+    delete current_;
+    current_ = new MagCalibration(cache.calibration);
+    current_->generation = generation;
+    sensordLogD() << "Loaded magnetometer calibration of level" << current_->level << "from" << path;
+    return true;
+}
+
+void EllipsoidCalibrator::writeCache()
+{
+    CalibrationCache cache;
+    cache.magic = CACHE_MAGIC;
+    cache.version = CACHE_VERSION;
+    cache.calibration = unsavedCalibration_;
+    cache.sums = unsavedSums_;
+
+    QSaveFile file(cachePath_);
+    if (!file.open(QIODevice::WriteOnly) ||
+        file.write((const char*)&cache, sizeof(cache)) != sizeof(cache) ||
+        !file.commit()) {
+        sensordLogW() << "Failed to write magnetometer calibration cache" << cachePath_ << ":" << file.errorString();
+    }
+    unsaved_ = false;
+    written_.start();
+}
+
+void EllipsoidCalibrator::run()
+{
+    mutex_.lock();
+    while (!stopping_) {
+        if (discard_) {
+            discard_ = false;
+            unsaved_ = false;
+            mutex_.unlock();
+            QFile::remove(cachePath_);
+            mutex_.lock();
+            continue;
+        }
+        if (!pending_) {
+            wakeup_.wait(&mutex_);
+            continue;
+        }
+        EllipsoidSums sums = snapshot_;
+        pending_ = false;
+        mutex_.unlock();
+
+        MagCalibration* result = new MagCalibration;
+        bool solved = solve(sums, *result);
+        if (solved) {
+            sensordLogT() << "Magnetometer calibration offset" << result->offset[0] << result->offset[1]
+                          << result->offset[2] << "level" << result->level;
+            unsavedCalibration_ = *result;
+            unsavedSums_ = sums;
+            delete published_.fetchAndStoreRelease(result);
+        } else {
+            delete result;
+        }
+
+        mutex_.lock();
+        // A reset after the snapshot removes the cache in the next round
+        if (solved && !cachePath_.isEmpty() && sums.generation == generation_) {
+            unsaved_ = true;
+            if (!written_.isValid() || written_.elapsed() >= writeInterval_) {
+                mutex_.unlock();
+                writeCache();
+                mutex_.lock();
+            }
+        }
+    }
+    mutex_.unlock();
+}
+
+bool EllipsoidCalibrator::solve(const EllipsoidSums& sums, MagCalibration& calibration)
+{
+    const int n = EllipsoidSums::TERMS;
+    if (sums.weight <= 0)
+        return false;
+
+    // The reference sample lies on the ellipsoid, which cannot be written
+    // as equal to one around it. Terms are moved to the mean of the
+    // samples, which is inside: terms around the mean are t * terms + b.
+    double mean[3];
+    for (int i = 0; i < 3; ++i)
+        mean[i] = sums.term[6 + i] / sums.weight;
+    double t[n][n];
+    double b[n];
+    memset(t, 0, sizeof(t));
+    for (int i = 0; i < 3; ++i) {
+        int j = (i + 1) % 3;
+        int cross = i + j + 2; // xy, xz and yz
+        t[i][i] = 1;
+        t[i][6 + i] = -2 * mean[i];
+        b[i] = mean[i] * mean[i];
+        t[cross][cross] = 1;
+        t[cross][6 + i] = -mean[j];
+        t[cross][6 + j] = -mean[i];
+        b[cross] = mean[i] * mean[j];
+        t[6 + i][6 + i] = 1;
+        b[6 + i] = -mean[i];
+    }
+    double product[n][n];
+    double term[n];
+    for (int i = 0; i < n; ++i) {
+        for (int j = 0; j < n; ++j)
+            product[i][j] = i <= j ? sums.product[i][j] : sums.product[j][i];
+    }
+    double tp[n][n];
+    double tt[n];
+    for (int i = 0; i < n; ++i) {
+        tt[i] = 0;
+        for (int k = 0; k < n; ++k)
+            tt[i] += t[i][k] * sums.term[k];
+        for (int j = 0; j < n; ++j) {
+            tp[i][j] = 0;
+            for (int k = 0; k < n; ++k)
+                tp[i][j] += t[i][k] * product[k][j];
+        }
+    }
+    for (int i = 0; i < n; ++i) {
+        for (int j = 0; j < n; ++j) {
+            product[i][j] = tt[i] * b[j] + b[i] * tt[j] + sums.weight * b[i] * b[j];
+            for (int k = 0; k < n; ++k)
+                product[i][j] += tp[i][k] * t[j][k];
+        }
+        term[i] = tt[i] + sums.weight * b[i];
+    }
+
+    // Normal equations scaled to unit diagonal, since quadratic and linear
+    // terms differ by orders of magnitude.
+    double scale[n];
+    for (int i = 0; i < n; ++i) {
+        if (product[i][i] <= 0)
+            return false;
+        scale[i] = 1 / sqrt(product[i][i]);
+    }
+    double a[n][n + 1];
+    for (int i = 0; i < n; ++i) {
+        for (int j = 0; j < n; ++j)
+            a[i][j] = product[i][j] * scale[i] * scale[j];
+        a[i][n] = term[i] * scale[i];
+    }
+
+    for (int col = 0; col < n; ++col) {
+        int pivot = col;
+        for (int row = col + 1; row < n; ++row)
+            if (fabs(a[row][col]) > fabs(a[pivot][col]))
+                pivot = row;
+        if (fabs(a[pivot][col]) < 1e-12)
+            return false;
+        if (pivot != col)
+            for (int j = col; j <= n; ++j)
+                qSwap(a[col][j], a[pivot][j]);
+        for (int row = col + 1; row < n; ++row) {
+            double f = a[row][col] / a[col][col];
+            for (int j = col; j <= n; ++j)
+                a[row][j] -= f * a[col][j];
+        }
+    }
+    double p[n];
+    for (int i = n - 1; i >= 0; --i) {
+        double s = a[i][n];
+        for (int j = i + 1; j < n; ++j)
+            s -= a[i][j] * p[j];
+        p[i] = s / a[i][i];
+    }
+    for (int i = 0; i < n; ++i)
+        p[i] *= scale[i];
+
+    // Quadric u'Qu + q'u = 1 is (u - c)'Q(u - c) = 1 + c'Qc with c = -Q^-1 q / 2
+    double q[3][3] = {
+        { p[0],     p[3] / 2, p[4] / 2 },
+        { p[3] / 2, p[1],     p[5] / 2 },
+        { p[4] / 2, p[5] / 2, p[2]     }
+    };
+    double cof[3][3];
+    for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 3; ++j)
+            cof[i][j] = q[(j + 1) % 3][(i + 1) % 3] * q[(j + 2) % 3][(i + 2) % 3] -
+                        q[(j + 1) % 3][(i + 2) % 3] * q[(j + 2) % 3][(i + 1) % 3];
+    double det = q[0][0] * cof[0][0] + q[0][1] * cof[1][0] + q[0][2] * cof[2][0];
+    if (det == 0)
+        return false;
+    double center[3];
+    for (int i = 0; i < 3; ++i)
+        center[i] = -(cof[i][0] * p[6] + cof[i][1] * p[7] + cof[i][2] * p[8]) / (2 * det);
+    double k = 1;
+    for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 3; ++j)
+            k += center[i] * q[i][j] * center[j];
+    if (k == 0)
+        return false;
+
+    double m[3][3];
+    for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 3; ++j)
+            m[i][j] = q[i][j] / k;
+    double vectors[3][3];
+    eigen(m, vectors);
+    double lowest = qMin(m[0][0], qMin(m[1][1], m[2][2]));
+    double highest = qMax(m[0][0], qMax(m[1][1], m[2][2]));
+    if (lowest <= 0 || highest > lowest * MAX_AXIS_RATIO * MAX_AXIS_RATIO)
+        return false;
+
+    // Axes are scaled to the radius of the sphere of equal volume
+    double radius = pow(m[0][0] * m[1][1] * m[2][2], -1.0 / 6);
+    double axis[3];
+    for (int i = 0; i < 3; ++i)
+        axis[i] = radius * sqrt(m[i][i]);
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            calibration.matrix[i][j] = 0;
+            for (int l = 0; l < 3; ++l)
+                calibration.matrix[i][j] += vectors[i][l] * axis[l] * vectors[j][l];
+        }
+        calibration.offset[i] = sums.origin[i] + mean[i] + center[i];
+    }
+
+    // Residual of the terms is about twice the relative radial error
+    double residual = sums.weight;
+    for (int i = 0; i < n; ++i) {
+        residual -= 2 * p[i] * term[i];
+        for (int j = 0; j < n; ++j)
+            residual += p[i] * product[i][j] * p[j];
+    }
+    double error = sqrt(qMax(residual, 0.0) / sums.weight) / 2;
+    calibration.level = error <= 0.02 ? 3 : error <= 0.05 ? 2 : 1;
+    calibration.generation = sums.generation;
+    return true;
+}
@@ -0,0 +1,173 @@
+/**
+   @file ellipsoidcalibrator.h
+   @brief Online hard and soft iron calibration of magnetometer
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef ELLIPSOIDCALIBRATOR_H
+#define ELLIPSOIDCALIBRATOR_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicPointer>
+#include <QElapsedTimer>
+#include <QString>
+
+/**
+ * Result of an ellipsoid fit. Calibrated field is
+ * matrix * (raw - offset).
+ */
+struct MagCalibration
+{
+    double       offset[3];    /**< hard iron offset in raw units */
+    double       matrix[3][3]; /**< symmetric soft iron correction */
+    int          level;        /**< calibration level, 1 to 3 */
+    unsigned int generation;   /**< EllipsoidCalibrator::reset() count of the samples */
+};
+
+/**
+ * Normal equations of the least squares fit of
+ * ax^2 + by^2 + cz^2 + dxy + exz + fyz + gx + hy + iz = 1
+ * to samples relative to a reference sample.
+ */
+struct EllipsoidSums
+{
+    static const int TERMS = 9;
+
+    double       product[TERMS][TERMS]; /**< sum of term products, upper triangle */
+    double       term[TERMS];           /**< sum of terms */
+    double       weight;                /**< number of samples, decayed */
+    double       origin[3];             /**< reference sample */
+    unsigned int generation;            /**< EllipsoidCalibrator::reset() count */
+};
+
+/**
+ * Magnetometer calibrator fitting an ellipsoid to raw samples. Samples
+ * are accumulated into constant size normal equations in the calling
+ * thread. Accumulated sums are solved on a low priority thread every
+ * given number of samples, and the result is picked up by the calling
+ * thread without locking.
+ *
+ * Older samples are weighted down at each solve so that the fit follows
+ * changes in the magnetic environment of the device.
+ *
+ * Fits can be kept in a cache file to start from the previous
+ * calibration after restart. The file is written by the thread.
+ */
+class EllipsoidCalibrator : public QThread
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(EllipsoidCalibrator)
+
+public:
+    /**
+     * Constructor. Thread is started on first solve.
+     *
+     * @param solveSamples samples between solves.
+     * @param memory samples after which accumulated weight has decayed to about a third.
+     */
+    EllipsoidCalibrator(unsigned int solveSamples, unsigned int memory);
+
+    /**
+     * Destructor. Stops the thread.
+     */
+    ~EllipsoidCalibrator();
+
+    /**
+     * Accumulate a raw sample.
+     *
+     * @param x raw X value.
+     * @param y raw Y value.
+     * @param z raw Z value.
+     */
+    void accumulate(int x, int y, int z);
+
+    /**
+     * Latest calibration. Must be called from the thread accumulating
+     * samples.
+     *
+     * @return calibration or NULL if no fit has succeeded since reset.
+     */
+    const MagCalibration* calibration();
+
+    /**
+     * Forget accumulated samples and the calibration, cached one included.
+     */
+    void reset();
+
+    /**
+     * Keep calibration in a file. Calibration and samples in the file are
+     * taken into use, and later fits are written to it at most once per
+     * given interval. Must be called before samples are accumulated.
+     *
+     * @param path cache file, empty disables caching.
+     * @param writeInterval shortest time between writes in milliseconds.
+     * @return was a calibration loaded from the file.
+     */
+    bool setCache(const QString& path, unsigned int writeInterval);
+
+    /**
+     * Fit an ellipsoid to accumulated sums.
+     *
+     * @param sums accumulated sums.
+     * @param calibration set to the fit.
+     * @return false if the samples do not determine a plausible ellipsoid.
+     */
+    static bool solve(const EllipsoidSums& sums, MagCalibration& calibration);
+
+protected:
+    /**
+     * Thread entry-function.
+     */
+    void run();
+
+private:
+    /**
+     * Write fit waiting for the cache. Called from the thread, or after
+     * it has stopped.
+     */
+    void writeCache();
+
+    /** Fewer samples do not make a fit. */
+    static const unsigned int MIN_SAMPLES = 50;
+
+    EllipsoidSums                  sums_;        /**< accumulated samples */
+    unsigned int                   solveSamples_; /**< samples between solves */
+    unsigned int                   sinceSolve_;  /**< samples since last solve */
+    double                         decay_;       /**< weight kept at each solve */
+    MagCalibration*                current_;     /**< calibration in use, owned by accumulating thread */
+    QAtomicPointer<MagCalibration> published_;   /**< calibration solved by the thread */
+
+    QMutex                         mutex_;       /**< guards members below */
+    QWaitCondition                 wakeup_;      /**< signals pending_, discard_ or stopping_ */
+    EllipsoidSums                  snapshot_;    /**< sums waiting for solve */
+    bool                           pending_;     /**< is snapshot_ waiting */
+    bool                           stopping_;    /**< should the thread exit */
+    bool                           discard_;     /**< should the cache be removed */
+    unsigned int                   generation_;  /**< reset() count */
+
+    QString                        cachePath_;   /**< cache file or empty */
+    unsigned int                   writeInterval_; /**< shortest time between writes in ms */
+    QElapsedTimer                  written_;     /**< time since last write, used by the thread */
+    bool                           unsaved_;     /**< is a fit waiting for the cache */
+    MagCalibration                 unsavedCalibration_; /**< fit waiting for the cache */
+    EllipsoidSums                  unsavedSums_; /**< samples of the fit waiting */
+};
+
+#endif // ELLIPSOIDCALIBRATOR_H
@@ -0,0 +1,54 @@
+/**
+   @file halcalibrationfilter.cpp
+   @brief Pass through of magnetometer data calibrated by the HAL
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+
+#include "halcalibrationfilter.h"
+
+HalCalibrationFilter::HalCalibrationFilter(int scale) :
+    Filter<CalibratedMagneticFieldData, HalCalibrationFilter, CalibratedMagneticFieldData>(this, &HalCalibrationFilter::magDataAvailable),
+    magDataSink(this, &HalCalibrationFilter::magDataAvailable),
+    scale(scale)
+{
+    addSink(&magDataSink, "magsink");
+    addSource(&magSource, "calibratedmagneticfield");
+    addSource(&scaledSource, "scaledmagneticfield");
+}
+
+void HalCalibrationFilter::magDataAvailable(unsigned n, const CalibratedMagneticFieldData* data)
+{
+    magSource.propagate(n, data);
+    source_.propagate(n, data);
+    if (scale == 1)
+        return;
+
+    FilterBatch<CalibratedMagneticFieldData> scaled;
+    for (unsigned i = 0; i < n; ++i) {
+        CalibratedMagneticFieldData transformed(data[i]);
+        transformed.x_ *= scale;
+        transformed.y_ *= scale;
+        transformed.z_ *= scale;
+        transformed.rx_ *= scale;
+        transformed.ry_ *= scale;
+        transformed.rz_ *= scale;
+        scaled.append(transformed);
+    }
+    scaled.propagate(scaledSource);
+}
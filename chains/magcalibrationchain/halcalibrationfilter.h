@@ -0,0 +1,57 @@
+/**
+   @file halcalibrationfilter.h
+   @brief Pass through of magnetometer data calibrated by the HAL
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+
+#ifndef HALCALIBRATIONFILTER_H
+#define HALCALIBRATIONFILTER_H
+
+#include "orientationdata.h"
+#include "filter.h"
+
+/**
+ * @brief Stands in for CalibrationFilter when the adaptor delivers
+ * calibrated data.
+ *
+ * Samples are passed through as they are, and scaled copies are written
+ * to the scaled source, whose name matches that of CalibrationFilter so
+ * that MagCalibrationChain joins either filter the same way.
+ */
+class HalCalibrationFilter : public Filter<CalibratedMagneticFieldData, HalCalibrationFilter, CalibratedMagneticFieldData>
+{
+public:
+    /**
+     * Constructor.
+     *
+     * @param scale factor of the scaled source.
+     */
+    HalCalibrationFilter(int scale);
+
+private:
+    void magDataAvailable(unsigned n, const CalibratedMagneticFieldData* data);
+
+    Sink<HalCalibrationFilter, CalibratedMagneticFieldData> magDataSink; /**< sink named as in CalibrationFilter */
+    Source<CalibratedMagneticFieldData> magSource;    /**< samples as they are */
+    Source<CalibratedMagneticFieldData> scaledSource; /**< samples multiplied by #scale */
+
+    int scale; /**< factor of the scaled source */
+};
+
+#endif // HALCALIBRATIONFILTER_H
@@ -29,14 +29,18 @@
 #include "config.h"
 #include "logging.h"
 #include "calibrationfilter.h"
+#include "halcalibrationfilter.h"
 
 //#include "coordinatealignfilter.h"
 #include "datatypes/orientationdata.h"
 // magcalibrationchain requires: magnetometeradaptor, kbslideradaptor
 
 MagCalibrationChain::MagCalibrationChain(const QString& id) :
-    AbstractChain(id)
+    AbstractChain(id),
+    halCalibration(false),
+    scaledMagnetometerData(NULL)
 {
+    NodeArenaScope scope(&arena());
     qDebug() << Q_FUNC_INFO << id;
 
     SensorManager& sm = SensorManager::instance();
@@ -45,21 +49,32 @@ MagCalibrationChain::MagCalibrationChain(const QString& id) :
     setValid(magAdaptor->isValid());
 
 // Config::configuration()->value<int>("magnetometer/interval_compensation", 16);
-    magReader = new BufferReader<TimedXyzData>(1);
-
-    magCalFilter = sm.instantiateFilter("calibrationfilter");
-    magScaleFilter = sm.instantiateFilter("magnetometerscalefilter");
-
+    int scale;
+    halCalibration = magAdaptor->property("calibrated").toBool();
+    if (halCalibration) {
+        sensordLogD() << "Magnetometer is calibrated by HAL, software calibration is bypassed";
+        magReader = new BufferReader<CalibratedMagneticFieldData>(FILTER_BATCH_SIZE);
+        scale = Config::configuration()->value<int>("magnetometer/scale_coefficient", 300);
+        magCalFilter = new HalCalibrationFilter(scale);
+    } else {
+        magReader = new BufferReader<TimedXyzData>(FILTER_BATCH_SIZE);
+        magCalFilter = sm.instantiateFilter("calibrationfilter");
+        scale = static_cast<CalibrationFilter *>(magCalFilter)->scaleFactor();
+    }
 
-    calibratedMagnetometerData = new RingBuffer<CalibratedMagneticFieldData>(1);
+    calibratedMagnetometerData = new RingBuffer<CalibratedMagneticFieldData>(FILTER_BATCH_SIZE);
     nameOutputBuffer("calibratedmagnetometerdata", calibratedMagnetometerData);
 
+    if (scale != 1) {
+        scaledMagnetometerData = new RingBuffer<CalibratedMagneticFieldData>(FILTER_BATCH_SIZE);
+        nameOutputBuffer("scaledmagnetometerdata", scaledMagnetometerData);
+    }
+
     // Create buffers for filter chain
     filterBin = new Bin;
 //formationsink
     filterBin->add(magReader, "calibratedmagneticfield");
     filterBin->add(magCalFilter, "calibration");
-    filterBin->add(magScaleFilter,"filter");
 
     filterBin->add(calibratedMagnetometerData, "calibratedmagnetometerdata"); //calibration
 
@@ -70,6 +85,12 @@ MagCalibrationChain::MagCalibrationChain(const QString& id) :
     if (!filterBin->join("calibration", "calibratedmagneticfield", "calibratedmagnetometerdata", "sink"))
         qDebug() << Q_FUNC_INFO << "calibration join failed";
 
+    if (scaledMagnetometerData) {
+        filterBin->add(scaledMagnetometerData, "scaledmagnetometerdata");
+        if (!filterBin->join("calibration", "scaledmagneticfield", "scaledmagnetometerdata", "sink"))
+            qDebug() << Q_FUNC_INFO << "scaled calibration join failed";
+    }
+
 
 //////    ///////
 //    if (!filterBin->join("magnetometeradaptor", "source", "filter", "sink"))
@@ -99,6 +120,7 @@ MagCalibrationChain::~MagCalibrationChain()
     delete magReader;
     delete magCalFilter;
     delete calibratedMagnetometerData;
+    delete scaledMagnetometerData;
     delete filterBin;
 }
 
@@ -122,8 +144,16 @@ bool MagCalibrationChain::stop()
     return true;
 }
 
+bool MagCalibrationChain::softwareCalibration() const
+{
+    return !halCalibration;
+}
+
 void MagCalibrationChain::resetCalibration()
 {
+    // HAL keeps its calibration to itself
+    if (halCalibration)
+        return;
     CalibrationFilter *filter = static_cast<CalibrationFilter *>(magCalFilter);
     filter->dropCalibration();
     qDebug() << Q_FUNC_INFO;
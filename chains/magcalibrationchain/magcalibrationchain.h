@@ -38,7 +38,9 @@
  *
  * //// MagCalibrationChain
  * calibratedmagnetometerdata
+ * scaledmagnetometerdata, when magnetometer/scale_coefficient is not 1
  * resetCalibration
+ * softwareCalibration
  **/
 class Bin;
 template <class TYPE> class BufferReader;
@@ -46,10 +48,16 @@ class FilterBase;
 
 /**
  * @brief MagCalibrationChain
+ *
+ * Calibrates magnetometer samples with CalibrationFilter. When the adaptor
+ * publishes samples calibrated by the HAL, see its <em>calibrated</em>
+ * property, they are passed through HalCalibrationFilter instead, and the
+ * software calibration does not run.
  */
 class MagCalibrationChain : public AbstractChain
 {
     Q_OBJECT
+    Q_PROPERTY(bool softwareCalibration READ softwareCalibration)
 
 public:
     /**
@@ -62,6 +70,13 @@ public:
         return sc;
     }
 
+    /**
+     * Is the calibration done by the chain.
+     *
+     * @return false if the adaptor delivers HAL calibrated samples.
+     */
+    bool softwareCalibration() const;
+
 public Q_SLOTS:
     bool start();
     bool stop();
@@ -76,12 +91,13 @@ private:
     Bin* filterBin;
     DeviceAdaptor *magAdaptor;
 
-    BufferReader<TimedXyzData>  *magReader; //pusher/producer
+    RingBufferReaderBase *magReader; //pusher/producer
 
     FilterBase* magCalFilter;
-    FilterBase* magScaleFilter;
+    bool halCalibration; /**< magCalFilter is a HalCalibrationFilter */
 
     RingBuffer<CalibratedMagneticFieldData> *calibratedMagnetometerData; //consumer
+    RingBuffer<CalibratedMagneticFieldData> *scaledMagnetometerData;     /**< calibrated data scaled by magnetometer/scale_coefficient, or NULL */
 };
 
 #endif // MAGCALIBRATIONCHAIN_H
@@ -2,11 +2,15 @@ TARGET  = magcalibrationchain
 
 HEADERS += magcalibrationchain.h \
            calibrationfilter.h \
+           halcalibrationfilter.h \
+           ellipsoidcalibrator.h \
            magcalibrationchainplugin.h
  #       qvector3d.h
 
 SOURCES += magcalibrationchain.cpp \
            calibrationfilter.cpp \
+           halcalibrationfilter.cpp \
+           ellipsoidcalibrator.cpp \
            magcalibrationchainplugin.cpp
 #        qvector3d.cpp
 
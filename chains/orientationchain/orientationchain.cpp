@@ -31,13 +31,14 @@
 OrientationChain::OrientationChain(const QString& id) :
     AbstractChain(id)
 {
+    NodeArenaScope scope(&arena());
     SensorManager& sm = SensorManager::instance();
 
     accelerometerChain_ = sm.requestChain("accelerometerchain");
     Q_ASSERT( accelerometerChain_ );
     setValid(accelerometerChain_->isValid());
 
-    accelerometerReader_ = new BufferReader<AccelerationData>(1);
+    accelerometerReader_ = new BufferReader<AccelerationData>(FILTER_BATCH_SIZE);
 
     orientationInterpreterFilter_ = sm.instantiateFilter("orientationinterpreter");
 
@@ -86,6 +87,11 @@ OrientationChain::~OrientationChain()
     delete filterBin_;
 }
 
+void OrientationChain::reconfigure(const QStringList& keys)
+{
+    filterBin_->reconfigure(keys);
+}
+
 bool OrientationChain::start()
 {
     if (AbstractSensorChannel::start()) {
@@ -79,6 +79,8 @@ public:
         return TimedUnsigned();
     }
 
+    void reconfigure(const QStringList& keys);
+
 public Q_SLOTS:
     bool start();
     bool stop();
@@ -4,8 +4,16 @@
 #
 #
 
-QT += dbus
 QT -= gui
+
+# Headless build: no D-Bus service, sensord is controlled through its
+# socket, see core/controlhandler.h. MCE and context provider need D-Bus.
+nodbus {
+  DEFINES += SENSORFW_NO_DBUS
+  CONFIG -= mce contextprovider
+} else {
+  QT += dbus
+}
 CONFIG += debug
 CONFIG += thread
 
@@ -25,6 +33,47 @@ profile {
   QMAKE_LFLAGS += -pg
 }
 
+# Count heap allocations on the sample path, see core/alloccounter.h
+alloctracking {
+  DEFINES += SENSORD_ALLOC_TRACKING
+}
+
+# ThreadSanitizer build for validating the threaded sample path, e.g.
+# under tests/benchmark/stressbenchmark. Slows sensord down several times.
+tsan {
+  QMAKE_CXXFLAGS += -fsanitize=thread -fno-omit-frame-pointer -O1
+  QMAKE_LFLAGS += -fsanitize=thread
+}
+
+# Static tracing probes for bpftrace and perf, see core/probes.h.
+# Needs sys/sdt.h from systemtap-sdt-devel.
+sdt {
+  DEFINES += SENSORD_SDT_PROBES
+}
+
+# Batched sysfs polling through io_uring, see core/uringreader.h.
+# Needs linux/io_uring.h from kernel headers 5.1 or later.
+iouring {
+  DEFINES += SENSORD_IO_URING
+}
+
+# Link the plugins below into sensord instead of loading them at startup,
+# as directory:name:class. Other plugins are still loaded from PLUGINPATH.
+STATIC_PLUGINS = sensors/accelerometersensor:accelerometersensor:AccelerometerPlugin \
+                 sensors/orientationsensor:orientationsensor:OrientationPlugin \
+                 sensors/alssensor:alssensor:ALSPlugin \
+                 sensors/proximitysensor:proximitysensor:ProximityPlugin \
+                 chains/accelerometerchain:accelerometerchain:AccelerometerChainPlugin \
+                 chains/orientationchain:orientationchain:OrientationChainPlugin \
+                 filters/coordinatealignfilter:coordinatealignfilter:CoordinateAlignFilterPlugin \
+                 filters/orientationinterpreter:orientationinterpreter:OrientationInterpreterPlugin
+
+static_plugins:equals(QT_MAJOR_VERSION, 5):plugin {
+    for(static_plugin, STATIC_PLUGINS) {
+        equals(TARGET, $$section(static_plugin, :, 1, 1)): CONFIG += static
+    }
+}
+
 profile-libc {
   QMAKE_LFLAGS += -lc_p
 }
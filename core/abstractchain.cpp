@@ -24,6 +24,7 @@
  */
 
 #include "abstractchain.h"
+#include "latencytracer.h"
 
 AbstractChain::AbstractChain(const QString& id, bool deleteBuffers) :
     AbstractSensorChannel(id),
@@ -53,6 +54,7 @@ RingBufferBase* AbstractChain::findBuffer(const QString& name) const
 void AbstractChain::nameOutputBuffer(const QString& name, RingBufferBase* buffer)
 {
     outputBufferMap_.insert(name, buffer);
+    buffer->setLatencyProbe(LatencyTracer::instance().probe(id() + "/" + name, LatencyTracer::ChainStage));
 }
 
 const QMap<QString, RingBufferBase*>& AbstractChain::buffers() const
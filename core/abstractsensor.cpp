@@ -33,12 +33,55 @@
 #include "sockethandler.h"
 #include "idutils.h"
 #include "logging.h"
+#include "latencytracer.h"
+#include "config.h"
+#include "historyring.h"
+#include "datatypes/utils.h"
+#include "datatypes/atomic.h"
+#include <QVarLengthArray>
+#include <QStringList>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
 
 AbstractSensorChannel::AbstractSensorChannel(const QString& id) :
     NodeBase(getCleanId(id)),
     errorCode_(SNoError),
-    cnt_(0)
+    cnt_(0),
+    activeSessions_(0),
+    enqueueProbe_(LatencyTracer::instance().probe(id(), LatencyTracer::EnqueueStage)),
+    downsampleBytes_(0),
+    latencyCritical_(false),
+    pushLatest_(true),
+    history_(0),
+    linger_(0),
+    lingering_(false),
+    lingerExpired_(false),
+    soleSession_(-1),
+    directSession_(-1),
+    soleGeneration_(-1),
+    rangeGeneration_(-1),
+    converting_(false)
 {
+    lingerTimer_.setSingleShot(true);
+    connect(&lingerTimer_, SIGNAL(timeout()), this, SLOT(lingerTimeout()));
+
+    if (Config::configuration()) {
+        pushLatest_ = Config::configuration()->value<bool>("global/push_latest_on_start", true);
+        linger_ = Config::configuration()->value<int>("global/sensor_linger", 0);
+        QStringList critical = Config::configuration()->value<QStringList>("global/high_priority_sensors",
+                                                                           QStringList() << "accelerometersensor" << "gyroscopesensor"
+                                                                                         << "magnetometersensor" << "rotationsensor");
+        latencyCritical_ = critical.contains(id());
+        unsigned int historySize = Config::configuration()->value<unsigned int>(id() + "/history_size", 0);
+        if (historySize)
+            history_ = new HistoryRing(historySize);
+    }
+}
+
+AbstractSensorChannel::~AbstractSensorChannel()
+{
+    delete history_;
 }
 
 void AbstractSensorChannel::setError(SensorError errorCode, const QString& errorString)
@@ -53,24 +96,46 @@ void AbstractSensorChannel::setError(SensorError errorCode, const QString& error
 
 bool AbstractSensorChannel::start(int sessionId)
 {
-    if(!activeSessions_.contains(sessionId))
+    SessionState& state(sessionState(sessionId));
+    if(!state.active)
     {
-        activeSessions_.insert(sessionId);
+        state.active = true;
+        ++activeSessions_;
+        invalidateSoleSession();
+        rangeGeneration_ = -1;
         requestDefaultInterval(sessionId);
-        return start();
+        bool wasRunning = running();
+        bool ret = start();
+        // The first sample of the session would otherwise come up to a
+        // full interval later
+        if(wasRunning && pushLatest_)
+            writeLatest(sessionId);
+        return ret;
     }
     return false;
 }
 
 bool AbstractSensorChannel::start()
 {
+    if (lingering_) {
+        // Reference kept for the linger period goes to the new session
+        sensordLogD() << "Reattached lingering channel " << id();
+        lingering_ = false;
+        lingerTimer_.stop();
+        return false;
+    }
     return (++cnt_ == 1) ? true : false;
 }
 
 bool AbstractSensorChannel::stop(int sessionId)
 {
-    if(activeSessions_.remove(sessionId))
+    SessionState* state = findSessionState(sessionId);
+    if(state && state->active)
     {
+        state->active = false;
+        --activeSessions_;
+        invalidateSoleSession();
+        rangeGeneration_ = -1;
         removeSession(sessionId); //Note: when client restarts the session it is responsible to reconfiguring the sensor.
         return stop();
     }
@@ -79,8 +144,21 @@ bool AbstractSensorChannel::stop(int sessionId)
 
 bool AbstractSensorChannel::stop()
 {
-    if (--cnt_ == 0)
+    if (cnt_ == 1 && linger_ > 0 && !lingering_ && !lingerExpired_) {
+        sensordLogD() << "Channel " << id() << " lingers for " << linger_ << " ms";
+        lingering_ = true;
+        lingerTimer_.start(linger_);
+        return false;
+    }
+    lingering_ = false;
+    lingerTimer_.stop();
+    if (--cnt_ == 0) {
+        // Stopped channel produces nothing, the sample would go stale
+        latestSample_.clear();
+        if (history_)
+            history_->clear();
         return true;
+    }
     if (cnt_ < 0)
         cnt_ = 0;
     return false;
@@ -88,151 +166,407 @@ bool AbstractSensorChannel::stop()
 
 bool AbstractSensorChannel::writeToSession(int sessionId, const void* source, int size)
 {
-    if (!(SensorManager::instance().write(sessionId, source, size))) {
+    if (!(enqueue(&sessionId, 1, source, size))) {
         sensordLogD() << "AbstractSensor failed to write to session " << sessionId;
         return false;
     }
     return true;
 }
 
+bool AbstractSensorChannel::enqueue(const int* sessions, int count, const void* source, int size, unsigned int n)
+{
+    if (enqueueProbe_) {
+        for (unsigned int i = 0; i < n; ++i)
+            enqueueProbe_->recordRaw((const char*)source + i * size, size);
+    }
+    return SensorManager::instance().writeSamples(sessions, count, source, size, n,
+                                                  latencyCritical_ ? SensorManager::HighPriority : SensorManager::NormalPriority);
+}
+
+unsigned int AbstractSensorChannel::chunkSize(unsigned int defaultSize) const
+{
+    if (!Config::configuration())
+        return defaultSize;
+    return qMax(1u, Config::configuration()->value<unsigned int>(id() + "/chunk_size", defaultSize));
+}
+
+void AbstractSensorChannel::lingerTimeout()
+{
+    if (!lingering_)
+        return;
+    sensordLogD() << "Stopping lingering channel " << id();
+    lingering_ = false;
+    lingerExpired_ = true;
+    stop();
+    lingerExpired_ = false;
+}
+
+void AbstractSensorChannel::setLatest(const void* source, int size)
+{
+    if (!running())
+        return;
+    // Keeps the allocation across samples
+    latestSample_.resize(size);
+    memcpy(latestSample_.data(), source, size);
+}
+
+bool AbstractSensorChannel::writeLatest(int sessionId)
+{
+    if (latestSample_.isEmpty())
+        return false;
+    return writeToSession(sessionId, latestSample_.constData(), latestSample_.size());
+}
+
+void AbstractSensorChannel::recordHistory(const void* source, int size, unsigned int n)
+{
+    if (history_ && running())
+        history_->write(source, size, n);
+}
+
+bool AbstractSensorChannel::writeHistory(int sessionId, unsigned int ms)
+{
+    if (!history_)
+        return false;
+    quint64 now = Utils::getTimeStamp();
+    quint64 span = ms * 1000ULL;
+    QByteArray samples;
+    int size = 0;
+    unsigned int n = history_->window(now > span ? now - span : 0, samples, size);
+    if (!n)
+        return false;
+    // Window may exceed the per sample slots of the sample queue, so it
+    // goes to the socket handler as a whole, past the session pacing
+    return SensorManager::instance().socketHandler().writeHistory(sessionId, samples, size);
+}
+
 bool AbstractSensorChannel::writeToClients(const void* source, int size)
 {
-    bool ret = true;
-    foreach(int sessionId, activeSessions_) {
-        ret &= writeToSession(sessionId, source, size);
+    return writeToClients(source, size, 1);
+}
+
+bool AbstractSensorChannel::writeToClients(const void* source, int size, unsigned int n)
+{
+    if (!n)
+        return true;
+    setLatest((const char*)source + (n - 1) * size, size);
+    recordHistory(source, size, n);
+    if (!activeSessions_)
+        return true;
+
+    refreshSoleSession();
+    if (soleSession_ >= 0) {
+        if (!(enqueue(&soleSession_, 1, source, size, n))) {
+            sensordLogD() << "AbstractSensor failed to write to session " << soleSession_;
+            return false;
+        }
+        return true;
     }
-    return ret;
+
+    QVarLengthArray<int, 16> sessions;
+    for (QVector<SessionState>::const_iterator it = sessionStates_.constBegin(); it != sessionStates_.constEnd(); ++it) {
+        if (it->active)
+            sessions.append(it->sessionId);
+    }
+    if (!(enqueue(sessions.constData(), sessions.size(), source, size, n))) {
+        sensordLogD() << "AbstractSensor failed to write to " << sessions.size() << " session(s)";
+        return false;
+    }
+    return true;
 }
 
-bool AbstractSensorChannel::downsampleAndPropagate(const TimedXyzData& data, TimedXyzDownsampleBuffer& buffer)
+bool AbstractSensorChannel::writeChangesToClients(const void* source, int size, qint64 value, bool force)
+{
+    setLatest(source, size);
+    recordHistory(source, size, 1);
+    if (!activeSessions_)
+        return true;
+
+    QVarLengthArray<int, 16> sessions;
+    for (QVector<SessionState>::iterator it = sessionStates_.begin(); it != sessionStates_.end(); ++it) {
+        if (!it->active)
+            continue;
+        if (it->change.pass(value, force))
+            sessions.append(it->sessionId);
+    }
+    if (sessions.isEmpty())
+        return true;
+    if (!(enqueue(sessions.constData(), sessions.size(), source, size))) {
+        sensordLogD() << "AbstractSensor failed to write to " << sessions.size() << " session(s)";
+        return false;
+    }
+    return true;
+}
+
+void AbstractSensorChannel::downsamplingClasses(QVarLengthArray<int, 16>& direct, DownsampleClasses& classes) const
 {
-    bool ret = true;
     unsigned int currentInterval = getInterval();
-    foreach(int sessionId, activeSessions_)
+    for (QVector<SessionState>::const_iterator it = sessionStates_.constBegin(); it != sessionStates_.constEnd(); ++it)
     {
-        if(!downsamplingEnabled(sessionId))
+        if(!it->active || it->motion.threshold)
+            continue;
+        if(!downsamplingEnabled(*it))
         {
-            ret &= writeToSession(sessionId, (const void *)& data, sizeof(TimedXyzData));
+            direct.append(it->sessionId);
             continue;
         }
-        unsigned int sessionInterval = getInterval(sessionId);
-        int bufferSize = (sessionInterval < currentInterval || !currentInterval) ? 1 : sessionInterval / currentInterval;
-
-        QList<TimedXyzData>& samples(buffer[sessionId]);
-        samples.push_back(data);
+        classes.append(qMakePair(downsampleLength(sessionInterval(*it), currentInterval), it->sessionId));
+    }
+    qSort(classes.begin(), classes.end());
+}
 
-        for(QList<TimedXyzData>::iterator it = samples.begin(); it != samples.end(); ++it)
+bool AbstractSensorChannel::propagateMotion(const TimedXyzData* samples, unsigned int n)
+{
+    bool ret = true;
+    for (QVector<SessionState>::iterator it = sessionStates_.begin(); it != sessionStates_.end(); ++it)
+    {
+        MotionThreshold& motion(it->motion);
+        if(!it->active || !motion.threshold)
+            continue;
+        for(unsigned int i = 0; i < n; ++i)
         {
-            if(samples.size() > bufferSize ||
-               data.timestamp_ - it->timestamp_ > 2000000)
-            {
-                it = samples.erase(it);
-                if(it == samples.end())
-                    break;
-            }
-            else
-                break;
+            const TimedXyzData& data(samples[i]);
+            if(!motion.pass(data))
+                continue;
+            sensordLogT() << "Motion for session " << it->sessionId << ": " << data.x_ << ", " << data.y_ << ", " << data.z_;
+            ret &= enqueueRanged(&it->sessionId, 1, &data, 1);
         }
+    }
+    return ret;
+}
 
-        if(samples.size() < bufferSize)
-            continue;
+template <typename DATA>
+bool AbstractSensorChannel::enqueueRanged(const int* sessions, int count, const DATA* samples, unsigned int n)
+{
+    if(!converting_)
+        return enqueue(sessions, count, (const void*)samples, sizeof(DATA), n);
 
-        long x = 0;
-        long y = 0;
-        long z = 0;
-        foreach(const TimedXyzData& data, samples)
-        {
-            x += data.x_;
-            y += data.y_;
-            z += data.z_;
-        }
-        TimedXyzData downsampled(data.timestamp_,
-                                 x / samples.count(),
-                                 y / samples.count(),
-                                 z / samples.count());
-        sensordLogT() << "Downsampled for session " << sessionId << ": " << downsampled.x_ << ", " << downsampled.y_ << ", " << downsampled.z_;
+    QVarLengthArray<int, 16> plain;
+    QVarLengthArray<int, 16> ranged;
+    for(int i = 0; i < count; ++i)
+    {
+        const SessionState* state = findSessionState(sessions[i]);
+        if(state && state->range.active)
+            ranged.append(sessions[i]);
+        else
+            plain.append(sessions[i]);
+    }
+    bool ret = true;
+    if(!plain.isEmpty())
+        ret &= enqueue(plain.constData(), plain.size(), (const void*)samples, sizeof(DATA), n);
 
-        if (writeToSession(sessionId, (const void*)& downsampled, sizeof(TimedXyzData)))
+    // Samples are converted once per range class
+    QVarLengthArray<DATA, 16> converted;
+    while(!ranged.isEmpty())
+    {
+        const RangeConversion conversion(findSessionState(ranged[0])->range);
+        QVarLengthArray<int, 16> members;
+        QVarLengthArray<int, 16> rest;
+        for(int i = 0; i < ranged.size(); ++i)
         {
-            samples.clear();
+            if(findSessionState(ranged[i])->range == conversion)
+                members.append(ranged[i]);
+            else
+                rest.append(ranged[i]);
         }
-        else
+        ranged = rest;
+
+        converted.resize(n);
+        for(unsigned int i = 0; i < n; ++i)
         {
-            ret = false;
+            converted[i] = samples[i];
+            convert(conversion, converted[i]);
         }
+        ret &= enqueue(members.constData(), members.size(), (const void*)converted.constData(), sizeof(DATA), n);
     }
-
     return ret;
 }
 
-bool AbstractSensorChannel::downsampleAndPropagate(const CalibratedMagneticFieldData& data, MagneticFieldDownsampleBuffer& buffer)
+void AbstractSensorChannel::convert(const RangeConversion& conversion, TimedXyzData& data)
 {
-    bool ret = true;
-    unsigned int currentInterval = getInterval();
-    foreach(int sessionId, activeSessions_)
+    data.x_ = conversion.apply(data.x_);
+    data.y_ = conversion.apply(data.y_);
+    data.z_ = conversion.apply(data.z_);
+}
+
+void AbstractSensorChannel::convert(const RangeConversion& conversion, CalibratedMagneticFieldData& data)
+{
+    data.x_ = conversion.apply(data.x_);
+    data.y_ = conversion.apply(data.y_);
+    data.z_ = conversion.apply(data.z_);
+}
+
+void AbstractSensorChannel::refreshRanges()
+{
+    int generation = dataRangeGeneration();
+    if(rangeGeneration_ == generation)
+        return;
+    rangeGeneration_ = generation;
+    converting_ = false;
+    invalidateSoleSession();
+
+    DataRange active(getCurrentDataRange().range);
+    for (QVector<SessionState>::iterator it = sessionStates_.begin(); it != sessionStates_.end(); ++it)
     {
-        if(!downsamplingEnabled(sessionId))
-        {
-            ret &= writeToSession(sessionId, (const void *)& data, sizeof(CalibratedMagneticFieldData));
+        it->range = RangeConversion();
+        DataRange requested;
+        if(!it->active || !getDataRangeRequest(it->sessionId, requested))
             continue;
-        }
-        unsigned int sessionInterval = getInterval(sessionId);
-        int bufferSize = (sessionInterval < currentInterval || !currentInterval) ? 1 : sessionInterval / currentInterval;
 
-        QList<CalibratedMagneticFieldData>& samples(buffer[sessionId]);
-        samples.push_back(data);
+        const RangeConversion& conversion(it->range = RangeConversion::between(active, requested));
+        if(conversion.active)
+            sensordLogD() << "Session " << it->sessionId << " of " << id() << " converted into range "
+                          << requested.min << " - " << requested.max << " by " << conversion.step;
+        converting_ |= conversion.active;
+    }
+}
+
+bool AbstractSensorChannel::downsampleAndPropagate(const TimedXyzData& data, TimedXyzDownsampleBuffer& buffer)
+{
+    return downsampleAndPropagate(&data, 1, buffer);
+}
+
+bool AbstractSensorChannel::downsampleAndPropagate(const TimedXyzData* samples, unsigned int n, TimedXyzDownsampleBuffer& buffer)
+{
+    if(!n)
+        return true;
+    setLatest(samples + n - 1, sizeof(TimedXyzData));
+    recordHistory(samples, sizeof(TimedXyzData), n);
+    refreshRanges();
+    refreshSoleSession();
+    if(directSession_ >= 0)
+    {
+        if(!buffer.isEmpty())
+        {
+            buffer.clear();
+            Atomic::store(downsampleBytes_, 0);
+        }
+        return enqueue(&directSession_, 1, (const void *)samples, sizeof(TimedXyzData), n);
+    }
 
-        for(QList<CalibratedMagneticFieldData>::iterator it = samples.begin(); it != samples.end(); ++it)
+    bool ret = true;
+    QVarLengthArray<int, 16> direct;
+    DownsampleClasses classes;
+    downsamplingClasses(direct, classes);
+    pruneDownsampleBuffer(buffer, classes);
+
+    if(!direct.isEmpty())
+        ret &= enqueueRanged(direct.constData(), direct.size(), samples, n);
+    ret &= propagateMotion(samples, n);
+
+    // Average is computed once per window length and sent to every
+    // session sharing it.
+    for(int first = 0; first < classes.size();)
+    {
+        int length = classes[first].first;
+        QVarLengthArray<int, 16> sessions;
+        for(; first < classes.size() && classes[first].first == length; ++first)
+            sessions.append(classes[first].second);
+
+        DownsampleWindow<3>& window(buffer[length]);
+        window.setCapacity(length);
+        for(unsigned int i = 0; i < n; ++i)
         {
-            if(samples.size() > bufferSize ||
-               data.timestamp_ - it->timestamp_ > 2000000)
+            const TimedXyzData& data(samples[i]);
+            long values[3] = { data.x_, data.y_, data.z_ };
+            window.push(data.timestamp_, values);
+            window.expire(data.timestamp_, 2000000);
+
+            if(window.count() < length)
+                continue;
+
+            TimedXyzData downsampled(data.timestamp_,
+                                     window.average(0),
+                                     window.average(1),
+                                     window.average(2));
+            sensordLogT() << "Downsampled for " << sessions.size() << " session(s): " << downsampled.x_ << ", " << downsampled.y_ << ", " << downsampled.z_;
+
+            if (enqueueRanged(sessions.constData(), sessions.size(), &downsampled, 1))
             {
-                it = samples.erase(it);
-                if(it == samples.end())
-                    break;
+                window.clear();
             }
             else
-                break;
+            {
+                ret = false;
+            }
         }
+    }
+    Atomic::store(downsampleBytes_, windowMemoryUsage(buffer));
 
-        if(samples.size() < bufferSize)
-            continue;
+    return ret;
+}
 
-        long x = 0;
-        long y = 0;
-        long z = 0;
-        long rx = 0;
-        long ry = 0;
-        long rz = 0;
-        foreach(const CalibratedMagneticFieldData& data, samples)
-        {
-            x += data.x_;
-            y += data.y_;
-            z += data.z_;
-            rx += data.rx_;
-            ry += data.ry_;
-            rz += data.rz_;
-        }
-        CalibratedMagneticFieldData downsampled(data.timestamp_,
-                                                x / samples.count(),
-                                                y / samples.count(),
-                                                z / samples.count(),
-                                                rx / samples.count(),
-                                                ry / samples.count(),
-                                                rz / samples.count(),
-                                                data.level_);
-        sensordLogT() << "Downsampled for session " << sessionId << ": " << downsampled.x_ << ", " << downsampled.y_ << ", " << downsampled.z_ << ", " << downsampled.rx_ << ", " << downsampled.ry_ << ", " << downsampled.rz_;
-
-        if (writeToSession(sessionId, (const void*)& downsampled, sizeof(CalibratedMagneticFieldData)))
+bool AbstractSensorChannel::downsampleAndPropagate(const CalibratedMagneticFieldData& data, MagneticFieldDownsampleBuffer& buffer)
+{
+    return downsampleAndPropagate(&data, 1, buffer);
+}
+
+bool AbstractSensorChannel::downsampleAndPropagate(const CalibratedMagneticFieldData* samples, unsigned int n, MagneticFieldDownsampleBuffer& buffer)
+{
+    if(!n)
+        return true;
+    setLatest(samples + n - 1, sizeof(CalibratedMagneticFieldData));
+    recordHistory(samples, sizeof(CalibratedMagneticFieldData), n);
+    refreshRanges();
+    refreshSoleSession();
+    if(directSession_ >= 0)
+    {
+        if(!buffer.isEmpty())
         {
-            samples.clear();
+            buffer.clear();
+            Atomic::store(downsampleBytes_, 0);
         }
-        else
+        return enqueue(&directSession_, 1, (const void *)samples, sizeof(CalibratedMagneticFieldData), n);
+    }
+
+    bool ret = true;
+    QVarLengthArray<int, 16> direct;
+    DownsampleClasses classes;
+    downsamplingClasses(direct, classes);
+    pruneDownsampleBuffer(buffer, classes);
+
+    if(!direct.isEmpty())
+        ret &= enqueueRanged(direct.constData(), direct.size(), samples, n);
+
+    for(int first = 0; first < classes.size();)
+    {
+        int length = classes[first].first;
+        QVarLengthArray<int, 16> sessions;
+        for(; first < classes.size() && classes[first].first == length; ++first)
+            sessions.append(classes[first].second);
+
+        DownsampleWindow<6>& window(buffer[length]);
+        window.setCapacity(length);
+        for(unsigned int i = 0; i < n; ++i)
         {
-            ret = false;
+            const CalibratedMagneticFieldData& data(samples[i]);
+            long values[6] = { data.x_, data.y_, data.z_, data.rx_, data.ry_, data.rz_ };
+            window.push(data.timestamp_, values);
+            window.expire(data.timestamp_, 2000000);
+
+            if(window.count() < length)
+                continue;
+
+            CalibratedMagneticFieldData downsampled(data.timestamp_,
+                                                    window.average(0),
+                                                    window.average(1),
+                                                    window.average(2),
+                                                    window.average(3),
+                                                    window.average(4),
+                                                    window.average(5),
+                                                    data.level_);
+            sensordLogT() << "Downsampled for " << sessions.size() << " session(s): " << downsampled.x_ << ", " << downsampled.y_ << ", " << downsampled.z_ << ", " << downsampled.rx_ << ", " << downsampled.ry_ << ", " << downsampled.rz_;
+
+            if (enqueueRanged(sessions.constData(), sessions.size(), &downsampled, 1))
+            {
+                window.clear();
+            }
+            else
+            {
+                ret = false;
+            }
         }
-
     }
+    Atomic::store(downsampleBytes_, windowMemoryUsage(buffer));
     return ret;
 }
 
@@ -242,16 +576,24 @@ void AbstractSensorChannel::setDownsamplingEnabled(int sessionId, bool value)
     if(downsamplingSupported())
     {
         sensordLogT() << "Downsampling state for session " << sessionId << ": " << value;
-        downsampling_[sessionId] = value;
+        sessionState(sessionId).downsampling = value;
+        invalidateSoleSession();
     }
 }
 
 bool AbstractSensorChannel::downsamplingEnabled(int sessionId) const
 {
-    QMap<int, bool>::const_iterator it(downsampling_.find(sessionId));
-    if(it == downsampling_.end())
+    const SessionState* state = findSessionState(sessionId);
+    if(!state)
         return downsamplingSupported();
-    return it.value() && getInterval(sessionId);
+    return downsamplingEnabled(*state);
+}
+
+bool AbstractSensorChannel::downsamplingEnabled(const SessionState& state) const
+{
+    if(state.downsampling < 0)
+        return downsamplingSupported();
+    return state.downsampling && sessionInterval(state);
 }
 
 bool AbstractSensorChannel::downsamplingSupported() const
@@ -259,12 +601,155 @@ bool AbstractSensorChannel::downsamplingSupported() const
     return false;
 }
 
+void AbstractSensorChannel::setChangeThreshold(int sessionId, unsigned int value)
+{
+    if(!changeThresholdSupported())
+        return;
+    sensordLogT() << "Change threshold for session " << sessionId << ": " << value;
+    if(value)
+    {
+        sessionState(sessionId).change.threshold = value;
+    }
+    else if(SessionState* state = findSessionState(sessionId))
+    {
+        state->change = ChangeThreshold();
+    }
+}
+
+unsigned int AbstractSensorChannel::changeThreshold(int sessionId) const
+{
+    const SessionState* state = findSessionState(sessionId);
+    return state ? state->change.threshold : 0;
+}
+
+bool AbstractSensorChannel::changeThresholdSupported() const
+{
+    return false;
+}
+
+void AbstractSensorChannel::setMotionThreshold(int sessionId, unsigned int threshold, unsigned int duration)
+{
+    if(!motionThresholdSupported())
+        return;
+    sensordLogT() << "Motion threshold for session " << sessionId << ": " << threshold << " for " << duration << " ms";
+    if(threshold)
+    {
+        MotionThreshold& motion(sessionState(sessionId).motion);
+        motion = MotionThreshold();
+        motion.threshold = threshold;
+        motion.duration = duration * 1000;
+    }
+    else if(SessionState* state = findSessionState(sessionId))
+    {
+        state->motion = MotionThreshold();
+    }
+    invalidateSoleSession();
+}
+
+unsigned int AbstractSensorChannel::motionThreshold(int sessionId) const
+{
+    const SessionState* state = findSessionState(sessionId);
+    return state ? state->motion.threshold : 0;
+}
+
+bool AbstractSensorChannel::motionThresholdSupported() const
+{
+    return false;
+}
+
 void AbstractSensorChannel::removeSession(int sessionId)
 {
-    downsampling_.take(sessionId);
+    invalidateSoleSession();
+    rangeGeneration_ = -1;
+    SessionState* state = findSessionState(sessionId);
+    if(state && state->active)
+    {
+        state->downsampling = -1;
+        state->change = ChangeThreshold();
+        state->motion = MotionThreshold();
+    }
+    else if(state)
+    {
+        removeSessionState(sessionId);
+    }
     NodeBase::removeSession(sessionId);
 }
 
+AbstractSensorChannel::SessionState* AbstractSensorChannel::findSessionState(int sessionId)
+{
+    QHash<int, int>::const_iterator it(sessionSlots_.constFind(sessionId));
+    return it == sessionSlots_.constEnd() ? NULL : &sessionStates_[it.value()];
+}
+
+const AbstractSensorChannel::SessionState* AbstractSensorChannel::findSessionState(int sessionId) const
+{
+    QHash<int, int>::const_iterator it(sessionSlots_.constFind(sessionId));
+    return it == sessionSlots_.constEnd() ? NULL : &sessionStates_.at(it.value());
+}
+
+AbstractSensorChannel::SessionState& AbstractSensorChannel::sessionState(int sessionId)
+{
+    QHash<int, int>::const_iterator it(sessionSlots_.constFind(sessionId));
+    if(it != sessionSlots_.constEnd())
+        return sessionStates_[it.value()];
+    sessionSlots_.insert(sessionId, sessionStates_.size());
+    sessionStates_.append(SessionState(sessionId));
+    return sessionStates_.last();
+}
+
+void AbstractSensorChannel::removeSessionState(int sessionId)
+{
+    QHash<int, int>::iterator it(sessionSlots_.find(sessionId));
+    if(it == sessionSlots_.end())
+        return;
+    int slot = it.value();
+    sessionSlots_.erase(it);
+    int last = sessionStates_.size() - 1;
+    if(slot != last)
+    {
+        sessionStates_[slot] = sessionStates_.at(last);
+        sessionSlots_[sessionStates_.at(slot).sessionId] = slot;
+    }
+    sessionStates_.remove(last);
+}
+
+void AbstractSensorChannel::refreshSoleSession() const
+{
+    int generation = intervalGeneration();
+    if(soleGeneration_ == generation)
+        return;
+    soleGeneration_ = generation;
+    soleSession_ = -1;
+    directSession_ = -1;
+    if(activeSessions_ != 1)
+        return;
+
+    for (QVector<SessionState>::const_iterator it = sessionStates_.constBegin(); it != sessionStates_.constEnd(); ++it)
+    {
+        if(!it->active)
+            continue;
+        soleSession_ = it->sessionId;
+        if(it->motion.threshold || it->range.active)
+            return;
+        // Window of one sample averages nothing
+        if(downsamplingEnabled(*it) && downsampleLength(sessionInterval(*it), getInterval()) > 1)
+            return;
+        directSession_ = it->sessionId;
+        return;
+    }
+}
+
+unsigned int AbstractSensorChannel::sessionInterval(const SessionState& state) const
+{
+    int generation = intervalGeneration();
+    if(state.generation != generation)
+    {
+        state.interval = getInterval(state.sessionId);
+        state.generation = generation;
+    }
+    return state.interval;
+}
+
 SensorError AbstractSensorChannel::errorCode() const
 {
     return errorCode_;
@@ -301,3 +786,18 @@ RingBufferBase* AbstractSensorChannel::findBuffer(const QString&) const
     sensordLogW() << "Tried to locate buffer from SensorChannel!";
     return NULL;
 }
+
+void AbstractSensorChannel::nameInternalBuffer(const QString& name, RingBufferBase* buffer)
+{
+    internalBuffers_.insert(name, buffer);
+}
+
+const QMap<QString, RingBufferBase*>& AbstractSensorChannel::internalBuffers() const
+{
+    return internalBuffers_;
+}
+
+unsigned int AbstractSensorChannel::downsampleMemoryUsage() const
+{
+    return Atomic::load(downsampleBytes_);
+}
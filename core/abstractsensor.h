@@ -32,9 +32,15 @@
 #define ABSTRACTSENSOR_H
 
 #include <QString>
+#include <QByteArray>
 #include <QMap>
+#include <QHash>
 #include <QList>
-#include <QSet>
+#include <QVector>
+#include <QVarLengthArray>
+#include <QPair>
+#include <QAtomicInt>
+#include <QTimer>
 
 #include "nodebase.h"
 #include "logging.h"
@@ -42,6 +48,12 @@
 #include "datarange.h"
 #include "genericdata.h"
 #include "orientationdata.h"
+#include "downsamplewindow.h"
+#include "rangeconversion.h"
+#include "sessionthreshold.h"
+
+class LatencyProbe;
+class HistoryRing;
 
 /**
  * Base class for sensor type specific nodes. This is used as base class
@@ -61,7 +73,7 @@ public:
     /**
      * Destructor.
      */
-    virtual ~AbstractSensorChannel() {}
+    virtual ~AbstractSensorChannel();
 
     /**
      * Last occured error.
@@ -92,6 +104,14 @@ public:
      */
     bool running() const;
 
+    /**
+     * Is output of the channel delivered ahead of other channels. Taken
+     * from global/high_priority_sensors.
+     *
+     * @return is channel latency-critical.
+     */
+    bool isLatencyCritical() const { return latencyCritical_; }
+
     /**
      * Enable or disable downsampling for given session.
      *
@@ -115,6 +135,63 @@ public:
      */
     virtual bool downsamplingSupported() const;
 
+    /**
+     * Set change threshold for given session. A session with a threshold
+     * receives a sample only when its value differs from the value last
+     * delivered to the session by more than the threshold. Threshold 0
+     * delivers every sample.
+     *
+     * @param sessionId session ID.
+     * @param value change threshold in units of the sample value.
+     */
+    void setChangeThreshold(int sessionId, unsigned int value);
+
+    /**
+     * Change threshold of given session.
+     *
+     * @param sessionId session ID.
+     * @return change threshold, 0 if not set.
+     */
+    unsigned int changeThreshold(int sessionId) const;
+
+    /**
+     * Is change threshold supported for this object. Supporting channels
+     * write their samples with writeChangesToClients().
+     *
+     * @return is change threshold supported.
+     */
+    virtual bool changeThresholdSupported() const;
+
+    /**
+     * Set motion threshold for given session. A session with a threshold
+     * receives a sample only when the magnitude of its difference to the
+     * reference sample has exceeded the threshold for at least the given
+     * duration. The delivered sample becomes the new reference, so a
+     * device lying still produces no traffic at all. Threshold 0 delivers
+     * every sample.
+     *
+     * @param sessionId session ID.
+     * @param threshold delta magnitude threshold in units of the sample value.
+     * @param duration minimum duration of the motion in milliseconds.
+     */
+    void setMotionThreshold(int sessionId, unsigned int threshold, unsigned int duration);
+
+    /**
+     * Motion threshold of given session.
+     *
+     * @param sessionId session ID.
+     * @return motion threshold, 0 if not set.
+     */
+    unsigned int motionThreshold(int sessionId) const;
+
+    /**
+     * Is motion threshold supported for this object. Supporting channels
+     * write TimedXyzData with downsampleAndPropagate().
+     *
+     * @return is motion threshold supported.
+     */
+    virtual bool motionThresholdSupported() const;
+
     virtual void removeSession(int sessionId);
 
     /**
@@ -122,6 +199,8 @@ public:
      * reference counting. Which each subclass is responsible of calling.
      * Subclass implementation is responsible for starting the sensor
      * data flow depending on output from the base class method.
+     * A channel still lingering after its last stop is taken over
+     * without being started again, see stop().
      *
      * @return <b>Base class:</b> \c True when start action should be taken,
      *         \c False if not (i.e already running).<br/>
@@ -142,7 +221,9 @@ public:
      * Stop data flow. Base class implementation is responsible for
      * reference counting. Subclass implementation is responsible of
      * stopping the sensor data flow depending on output from the base class
-     * method.
+     * method. With global/sensor_linger set, the last stop keeps the data
+     * flow running for that many milliseconds, so that a session started
+     * meanwhile does not have to power the hardware up again.
      *
      * @return <b>Base class:</b>\c True when start action should be taken,
      *         \c False if not (i.e. Already stopped, or other listeners present).<br/>
@@ -158,6 +239,43 @@ public:
      */
     bool stop(int sessionId);
 
+    /**
+     * Write the latest sample of the channel to given session, whether
+     * the session is started or not. Only a running channel keeps its
+     * latest sample.
+     *
+     * @param sessionId session ID.
+     * @return was a sample written.
+     */
+    bool writeLatest(int sessionId);
+
+    /**
+     * Write the samples the channel has output during the last given
+     * milliseconds to given session as one batch, whether the session is
+     * started or not. Only channels with <tt>history_size</tt> configured
+     * keep their history, and only while running.
+     *
+     * @param sessionId session ID.
+     * @param ms length of the window in milliseconds.
+     * @return were samples written.
+     */
+    bool writeHistory(int sessionId, unsigned int ms);
+
+    /**
+     * Buffers inside the channel shown in data path statistics.
+     *
+     * @return buffers keyed by name.
+     */
+    const QMap<QString, RingBufferBase*>& internalBuffers() const;
+
+    /**
+     * Bytes held by downsampling windows of the channel, as of the last
+     * downsampled sample.
+     *
+     * @return storage size in bytes.
+     */
+    unsigned int downsampleMemoryUsage() const;
+
 Q_SIGNALS:
     /**
      * Signal is emitted for occured errors.
@@ -167,11 +285,17 @@ Q_SIGNALS:
     void errorSignal(int error);
 
 protected:
-    /** Sample buffer type for TimedXyzData downsampling. */
-    typedef QMap<int, QList<TimedXyzData> > TimedXyzDownsampleBuffer;
+    /** Sample buffer type for TimedXyzData downsampling. Windows are
+     *  keyed by window length shared by sessions of the same interval
+     *  class. */
+    typedef QMap<int, DownsampleWindow<3> > TimedXyzDownsampleBuffer;
 
-    /** Sample buffer type for CalibratedMagneticFieldData downsampling. */
-    typedef QMap<int, QList<CalibratedMagneticFieldData> > MagneticFieldDownsampleBuffer;
+    /** Sample buffer type for CalibratedMagneticFieldData downsampling.
+     *  Windows are keyed by window length. */
+    typedef QMap<int, DownsampleWindow<6> > MagneticFieldDownsampleBuffer;
+
+    /** Sessions paired with their downsampling window length. */
+    typedef QVarLengthArray<QPair<int, int>, 16> DownsampleClasses;
 
     /**
      * Constructor.
@@ -193,6 +317,25 @@ protected:
      */
     void clearError();
 
+    /**
+     * Keep sample as the latest output of the channel, see writeLatest().
+     * Called by the write methods below.
+     *
+     * @param source Object to keep.
+     * @param size Size of the object.
+     */
+    void setLatest(const void* source, int size);
+
+    /**
+     * Keep samples in the history of the channel, see writeHistory().
+     * Called by the write methods below.
+     *
+     * @param source Contiguous objects to keep.
+     * @param size Size of single object.
+     * @param n Object count.
+     */
+    void recordHistory(const void* source, int size, unsigned int n);
+
     /**
      * Write output data to all connected sessions.
      *
@@ -202,6 +345,28 @@ protected:
      */
     bool writeToClients(const void* source, int size);
 
+    /**
+     * Write consecutive output samples to all connected sessions.
+     *
+     * @param source First object to write.
+     * @param size Size of one object.
+     * @param n Number of objects.
+     * @return was data succesfully written.
+     */
+    bool writeToClients(const void* source, int size, unsigned int n);
+
+    /**
+     * Write output data to connected sessions whose change threshold the
+     * value exceeds, see setChangeThreshold().
+     *
+     * @param source Object to write.
+     * @param size Size of the object.
+     * @param value Value of the object compared against thresholds.
+     * @param force Write to every session regardless of thresholds.
+     * @return was data succesfully written.
+     */
+    bool writeChangesToClients(const void* source, int size, qint64 value, bool force = false);
+
     /**
      * Downsample and propagate data to all connected sessions.
      *
@@ -211,6 +376,17 @@ protected:
      */
     bool downsampleAndPropagate(const TimedXyzData& data, TimedXyzDownsampleBuffer& buffer);
 
+    /**
+     * Downsample and propagate consecutive samples to all connected
+     * sessions. Sessions without downsampling get the samples at once.
+     *
+     * @param data Objects to handle.
+     * @param n Number of objects.
+     * @param buffer Data buffer.
+     * @return was data succesfully handled.
+     */
+    bool downsampleAndPropagate(const TimedXyzData* data, unsigned int n, TimedXyzDownsampleBuffer& buffer);
+
     /**
      * Downsample and propagate data to all connected sessions.
      *
@@ -220,6 +396,65 @@ protected:
      */
     bool downsampleAndPropagate(const CalibratedMagneticFieldData& data, MagneticFieldDownsampleBuffer& buffer);
 
+    /**
+     * Downsample and propagate consecutive samples to all connected
+     * sessions. Sessions without downsampling get the samples at once.
+     *
+     * @param data Objects to handle.
+     * @param n Number of objects.
+     * @param buffer Data buffer.
+     * @return was data succesfully handled.
+     */
+    bool downsampleAndPropagate(const CalibratedMagneticFieldData* data, unsigned int n, MagneticFieldDownsampleBuffer& buffer);
+
+    /**
+     * Chunk size for the output buffer and readers of the channel, taken
+     * from <em>id</em>/chunk_size.
+     *
+     * @param defaultSize size used when not configured.
+     * @return chunk size, at least 1.
+     */
+    unsigned int chunkSize(unsigned int defaultSize) const;
+
+    /**
+     * Split active sessions to ones receiving every sample and ones
+     * downsampling. Downsampling sessions are sorted by window length
+     * derived from session and sensor intervals. Sessions with a motion
+     * threshold are left out, see propagateMotion().
+     *
+     * @param direct Sessions without downsampling.
+     * @param classes Downsampling sessions as (window length, session ID).
+     */
+    void downsamplingClasses(QVarLengthArray<int, 16>& direct, DownsampleClasses& classes) const;
+
+    /**
+     * Evaluate motion thresholds of active sessions and write the samples
+     * completing a motion to the sessions, see setMotionThreshold().
+     *
+     * @param samples First sample.
+     * @param n Number of samples.
+     * @return was data succesfully written.
+     */
+    bool propagateMotion(const TimedXyzData* samples, unsigned int n);
+
+    /**
+     * Remove windows of lengths which no session uses anymore.
+     *
+     * @param buffer Data buffer.
+     * @param classes Current downsampling classes.
+     */
+    template <typename BUFFER>
+    static void pruneDownsampleBuffer(BUFFER& buffer, const DownsampleClasses& classes);
+
+    /**
+     * Bytes held by windows of a downsample buffer.
+     *
+     * @param buffer Data buffer.
+     * @return storage size in bytes.
+     */
+    template <typename BUFFER>
+    static unsigned int windowMemoryUsage(const BUFFER& buffer);
+
     /**
      * Signal property change.
      *
@@ -229,7 +464,126 @@ protected:
 
     virtual RingBufferBase* findBuffer(const QString& name) const;
 
+    /**
+     * Show a buffer inside the channel in data path statistics, so that
+     * overruns of its readers can be seen. Ownership is not transferred.
+     *
+     * @param name buffer name.
+     * @param buffer buffer.
+     */
+    void nameInternalBuffer(const QString& name, RingBufferBase* buffer);
+
+private Q_SLOTS:
+    /**
+     * Stop a lingering channel. Called by the linger timer.
+     */
+    void lingerTimeout();
+
 private:
+    /**
+     * Per-session state of the channel. Records are kept in one vector
+     * so that the per-sample paths walk contiguous memory instead of
+     * looking sessions up in several maps.
+     */
+    struct SessionState
+    {
+        SessionState(int id = -1) : sessionId(id), active(false), downsampling(-1), interval(0), generation(-1) {}
+
+        int                  sessionId;    /**< session ID */
+        bool                 active;       /**< is session started */
+        int                  downsampling; /**< downsampling state, -1 if not set */
+        ChangeThreshold      change;       /**< change threshold state */
+        MotionThreshold      motion;       /**< motion threshold state */
+        RangeConversion      range;        /**< conversion into the requested range */
+        mutable unsigned int interval;     /**< cached getInterval(int) */
+        mutable int          generation;   /**< interval generation of the cache */
+    };
+
+    /**
+     * Find state record of a session.
+     *
+     * @param sessionId session ID.
+     * @return record or NULL if the session has none.
+     */
+    SessionState* findSessionState(int sessionId);
+    const SessionState* findSessionState(int sessionId) const;
+
+    /**
+     * State record of a session, created if missing.
+     *
+     * @param sessionId session ID.
+     * @return record.
+     */
+    SessionState& sessionState(int sessionId);
+
+    /**
+     * Drop state record of a session. Last record is moved to the freed
+     * slot.
+     *
+     * @param sessionId session ID.
+     */
+    void removeSessionState(int sessionId);
+
+    /**
+     * Interval of session, refreshed from NodeBase::getInterval(int) when
+     * interval requests have changed.
+     *
+     * @param state session record.
+     * @return session interval.
+     */
+    unsigned int sessionInterval(const SessionState& state) const;
+
+    /**
+     * Is downsampling enabled for session.
+     *
+     * @param state session record.
+     * @return is downsampling enabled.
+     */
+    bool downsamplingEnabled(const SessionState& state) const;
+
+    /**
+     * Refresh the sessions of the single session path when sessions or
+     * interval requests have changed. With one active session samples are
+     * enqueued for it without collecting session lists, and when it has
+     * no motion threshold and a downsampling window of one sample the
+     * downsampling bookkeeping is skipped as well.
+     */
+    void refreshSoleSession() const;
+
+    /**
+     * Mark the single session path for refresh.
+     */
+    void invalidateSoleSession() { soleGeneration_ = -1; }
+
+    /**
+     * Refresh range conversions of active sessions when data range
+     * requests or sessions have changed.
+     */
+    void refreshRanges();
+
+    /**
+     * Enqueue samples for sessions, converted once per range class for
+     * sessions whose requested range is not active. Sessions with equal
+     * conversions form a range class.
+     *
+     * @param sessions session IDs.
+     * @param count number of sessions.
+     * @param samples first sample.
+     * @param n number of samples.
+     * @return was data succesfully enqueued.
+     */
+    template <typename DATA>
+    bool enqueueRanged(const int* sessions, int count, const DATA* samples, unsigned int n);
+
+    /**
+     * Convert sample into a requested range.
+     *
+     * @param conversion range conversion.
+     * @param data sample to convert in place.
+     */
+    static void convert(const RangeConversion& conversion, TimedXyzData& data);
+    static void convert(const RangeConversion& conversion, CalibratedMagneticFieldData& data);
+
     /**
      * Write to given session.
      *
@@ -240,11 +594,40 @@ private:
      */
     bool writeToSession(int sessionId, const void* source, int size);
 
+    /**
+     * Enqueue samples for sessions, tracing their latency when enabled.
+     *
+     * @param sessions session IDs.
+     * @param count number of sessions.
+     * @param source first source object.
+     * @param size size of one object.
+     * @param n number of objects.
+     * @return was data succesfully enqueued.
+     */
+    bool enqueue(const int* sessions, int count, const void* source, int size, unsigned int n = 1);
+
     SensorError         errorCode_;       /**< previous occured error code */
     QString             errorString_;     /**< previous occured error description */
     int                 cnt_;             /**< usage reference count */
-    QSet<int>           activeSessions_;  /**< active sessions */
-    QMap<int, bool>     downsampling_;    /**< downsample state for sessions */
+    QVector<SessionState> sessionStates_; /**< session records */
+    QHash<int, int>     sessionSlots_;    /**< slots of session records by session ID */
+    int                 activeSessions_;  /**< number of active sessions */
+    LatencyProbe*       enqueueProbe_;    /**< enqueue latency probe or NULL */
+    QMap<QString, RingBufferBase*> internalBuffers_; /**< buffers shown in statistics */
+    QAtomicInt          downsampleBytes_; /**< bytes held by downsampling windows */
+    bool                latencyCritical_; /**< is output delivered with high priority */
+    QByteArray          latestSample_;    /**< latest output sample, empty if none */
+    bool                pushLatest_;      /**< is latest sample written to started sessions */
+    HistoryRing*        history_;         /**< recent output samples or NULL */
+    int                 linger_;          /**< milliseconds to keep running after the last stop */
+    bool                lingering_;       /**< is channel running only for the linger period */
+    bool                lingerExpired_;   /**< is linger period over, the next stop is final */
+    QTimer              lingerTimer_;     /**< timer for the linger period */
+    mutable int         soleSession_;     /**< only active session, -1 if none or several */
+    mutable int         directSession_;   /**< sole session taking samples unchanged, -1 if none */
+    mutable int         soleGeneration_;  /**< interval generation of the sole session, -1 when stale */
+    int                 rangeGeneration_; /**< data range generation of the conversions, -1 when stale */
+    bool                converting_;      /**< does any active session convert samples */
 };
 
 /**
@@ -252,4 +635,28 @@ private:
  */
 typedef AbstractSensorChannel* (*SensorChannelFactoryMethod)(const QString& id);
 
+template <typename BUFFER>
+void AbstractSensorChannel::pruneDownsampleBuffer(BUFFER& buffer, const DownsampleClasses& classes)
+{
+    typename BUFFER::iterator it = buffer.begin();
+    while (it != buffer.end()) {
+        bool used = false;
+        for (int i = 0; i < classes.size() && !used; ++i)
+            used = (classes[i].first == it.key());
+        if (used)
+            ++it;
+        else
+            it = buffer.erase(it);
+    }
+}
+
+template <typename BUFFER>
+unsigned int AbstractSensorChannel::windowMemoryUsage(const BUFFER& buffer)
+{
+    unsigned int bytes = 0;
+    for (typename BUFFER::const_iterator it = buffer.constBegin(); it != buffer.constEnd(); ++it)
+        bytes += it.value().memoryUsage();
+    return bytes;
+}
+
 #endif // ABSTRACTSENSOR_H
@@ -28,13 +28,52 @@
 
 #include "abstractsensor_a.h"
 #include "sfwerror.h"
+#include "probes.h"
+#include <QMetaProperty>
 #include <sensormanager.h>
 #include <sockethandler.h>
 
 AbstractSensorChannelAdaptor::AbstractSensorChannelAdaptor(QObject *parent) :
-    QDBusAbstractAdaptor(parent)
+    AdaptorBase(parent)
 {
+#ifndef SENSORFW_NO_DBUS
     setAutoRelaySignals(false); //disabling signals since no public client API supports the use of these
+#endif
+    // ...except property changes, which invalidate client side metadata caches
+    connect(parent, SIGNAL(propertyChanged(const QString&)), this, SLOT(collectPropertyChange(const QString&)));
+}
+
+void AbstractSensorChannelAdaptor::collectPropertyChange(const QString& name)
+{
+    // First change of the pass schedules the signal
+    if (changedProperties_.isEmpty())
+        QMetaObject::invokeMethod(this, "flushPropertyChanges", Qt::QueuedConnection);
+    if (!changedProperties_.contains(name))
+        changedProperties_.append(name);
+}
+
+void AbstractSensorChannelAdaptor::flushPropertyChanges()
+{
+    if (changedProperties_.isEmpty())
+        return;
+    QVariantMap changes;
+    foreach (const QString& name, changedProperties_)
+        changes.insert(name, changedValue(name));
+    changedProperties_.clear();
+    emit propertiesChanged(changes);
+}
+
+QVariant AbstractSensorChannelAdaptor::changedValue(const QString& name) const
+{
+    if (name == "datarange")
+        return QVariant::fromValue(node()->getCurrentDataRange().range);
+    const QMetaObject* meta = metaObject();
+    for (int i = 0; i < meta->propertyCount(); ++i) {
+        QMetaProperty property(meta->property(i));
+        if (name.compare(property.name(), Qt::CaseInsensitive) == 0)
+            return property.read(this);
+    }
+    return QString();
 }
 
 bool AbstractSensorChannelAdaptor::isValid() const
@@ -91,18 +130,40 @@ QString AbstractSensorChannelAdaptor::type() const
 
 void AbstractSensorChannelAdaptor::start(int sessionId)
 {
+    ControlProbe probe("start", sessionId);
     node()->start(sessionId);
+    if (SessionRecord* record = sessionRecord(sessionId))
+        record->running = true;
 }
 
 void AbstractSensorChannelAdaptor::stop(int sessionId)
 {
+    ControlProbe probe("stop", sessionId);
     node()->stop(sessionId);
+    if (SessionRecord* record = sessionRecord(sessionId))
+        record->running = false;
+}
+
+bool AbstractSensorChannelAdaptor::configureAndStart(int sessionId, bool standbyOverride, int interval,
+                                                     unsigned int bufferInterval, unsigned int bufferSize, bool downsampling)
+{
+    ControlProbe probe("configureAndStart", sessionId);
+    start(sessionId);
+    bool ok = setStandbyOverride(sessionId, standbyOverride);
+    setInterval(sessionId, interval);
+    setBufferInterval(sessionId, bufferInterval);
+    setBufferSize(sessionId, bufferSize);
+    setDownsampling(sessionId, downsampling);
+    return ok;
 }
 
 void AbstractSensorChannelAdaptor::setInterval(int sessionId, int value)
 {
+    ControlProbe probe("setInterval", sessionId);
     node()->setIntervalRequest(sessionId, value);
     SensorManager::instance().socketHandler().setInterval(sessionId, value);
+    if (SessionRecord* record = sessionRecord(sessionId))
+        record->interval = value;
 }
 
 bool AbstractSensorChannelAdaptor::standbyOverride() const
@@ -112,6 +173,9 @@ bool AbstractSensorChannelAdaptor::standbyOverride() const
 
 bool AbstractSensorChannelAdaptor::setStandbyOverride(int sessionId, bool value)
 {
+    ControlProbe probe("setStandbyOverride", sessionId);
+    if (SessionRecord* record = sessionRecord(sessionId))
+        record->standbyOverride = value;
     return node()->setStandbyOverrideRequest(sessionId, value);
 }
 
@@ -127,12 +191,22 @@ DataRange AbstractSensorChannelAdaptor::getCurrentDataRange()
 
 void AbstractSensorChannelAdaptor::requestDataRange(int sessionId, DataRange range)
 {
+    ControlProbe probe("requestDataRange", sessionId);
     node()->requestDataRange(sessionId, range);
+    if (SessionRecord* record = sessionRecord(sessionId)) {
+        record->hasRange = true;
+        record->rangeMin = range.min;
+        record->rangeMax = range.max;
+        record->rangeResolution = range.resolution;
+    }
 }
 
 void AbstractSensorChannelAdaptor::removeDataRangeRequest(int sessionId)
 {
+    ControlProbe probe("removeDataRangeRequest", sessionId);
     node()->removeDataRangeRequest(sessionId);
+    if (SessionRecord* record = sessionRecord(sessionId))
+        record->hasRange = false;
 }
 
 DataRangeList AbstractSensorChannelAdaptor::getAvailableIntervals()
@@ -142,13 +216,19 @@ DataRangeList AbstractSensorChannelAdaptor::getAvailableIntervals()
 
 bool AbstractSensorChannelAdaptor::setDefaultInterval(int sessionId)
 {
+    ControlProbe probe("setDefaultInterval", sessionId);
     bool ok = node()->requestDefaultInterval(sessionId);
     SensorManager::instance().socketHandler().clearInterval(sessionId);
+    if (SessionRecord* record = sessionRecord(sessionId))
+        record->interval = 0;
     return ok;
 }
 
 void AbstractSensorChannelAdaptor::setBufferInterval(int sessionId, unsigned int value)
 {
+    ControlProbe probe("setBufferInterval", sessionId);
+    if (SessionRecord* record = sessionRecord(sessionId))
+        record->bufferInterval = value;
     bool hwBuffering = false;
     node()->getAvailableBufferIntervals(hwBuffering);
     if(hwBuffering)
@@ -167,6 +247,9 @@ void AbstractSensorChannelAdaptor::setBufferInterval(int sessionId, unsigned int
 
 void AbstractSensorChannelAdaptor::setBufferSize(int sessionId, unsigned int value)
 {
+    ControlProbe probe("setBufferSize", sessionId);
+    if (SessionRecord* record = sessionRecord(sessionId))
+        record->bufferSize = value;
     bool hwBuffering = false;
     node()->getAvailableBufferSizes(hwBuffering);
     if(hwBuffering)
@@ -194,17 +277,101 @@ IntegerRangeList AbstractSensorChannelAdaptor::getAvailableBufferSizes() const
     return node()->getAvailableBufferSizes(dummy);
 }
 
+unsigned int AbstractSensorChannelAdaptor::droppedSamples() const
+{
+    return SensorManager::instance().socketHandler().droppedCount(node()->id());
+}
+
+unsigned int AbstractSensorChannelAdaptor::sessionDroppedSamples(int sessionId) const
+{
+    return SensorManager::instance().socketHandler().droppedCount(sessionId);
+}
+
+void AbstractSensorChannelAdaptor::setBackpressure(int sessionId, const QString& policy, int highWater)
+{
+    ControlProbe probe("setBackpressure", sessionId);
+    SensorManager::instance().socketHandler().setBackpressure(sessionId, SessionData::policyFromString(policy), highWater);
+}
+
+void AbstractSensorChannelAdaptor::setFramePacing(int sessionId, unsigned int period, unsigned int phase, unsigned int lead, bool extrapolate)
+{
+    ControlProbe probe("setFramePacing", sessionId);
+    SensorManager::instance().socketHandler().setFramePacing(sessionId, period, phase, lead, extrapolate);
+}
+
+void AbstractSensorChannelAdaptor::setPriority(int sessionId, int priority)
+{
+    ControlProbe probe("setPriority", sessionId);
+    SensorManager::instance().setSessionPriority(sessionId, priority);
+}
+
 AbstractSensorChannel* AbstractSensorChannelAdaptor::node() const
 {
     return dynamic_cast<AbstractSensorChannel*>(parent());
 }
 
+QVariantMap AbstractSensorChannelAdaptor::status(int sessionId)
+{
+    QVariantMap properties;
+    const QMetaObject* meta = metaObject();
+    for (int i = QObject::staticMetaObject.propertyCount(); i < meta->propertyCount(); ++i) {
+        QMetaProperty property(meta->property(i));
+        properties.insert(property.name(), property.read(this));
+    }
+    properties.insert("getAvailableDataRanges", QVariant::fromValue(getAvailableDataRanges()));
+    properties.insert("getCurrentDataRange", QVariant::fromValue(getCurrentDataRange()));
+    properties.insert("getAvailableIntervals", QVariant::fromValue(getAvailableIntervals()));
+    properties.insert("getAvailableBufferIntervals", QVariant::fromValue(getAvailableBufferIntervals()));
+    properties.insert("getAvailableBufferSizes", QVariant::fromValue(getAvailableBufferSizes()));
+
+    if (sessionId >= 0) {
+        properties.insert("sessionInterval", node()->getInterval(sessionId));
+        properties.insert("sessionDownsampling", node()->downsamplingEnabled(sessionId));
+        properties.insert("sessionChangeThreshold", node()->changeThreshold(sessionId));
+        properties.insert("sessionDroppedSamples", sessionDroppedSamples(sessionId));
+    }
+    return properties;
+}
+
+SessionRecord* AbstractSensorChannelAdaptor::sessionRecord(int sessionId) const
+{
+    return SensorManager::instance().sessionRecord(sessionId);
+}
+
 bool AbstractSensorChannelAdaptor::setDataRangeIndex(int sessionId, int rangeIndex)
 {
+    ControlProbe probe("setDataRangeIndex", sessionId);
     return node()->setDataRangeIndex(sessionId, rangeIndex);
 }
 
 void AbstractSensorChannelAdaptor::setDownsampling(int sessionId, bool value)
 {
+    ControlProbe probe("setDownsampling", sessionId);
     node()->setDownsamplingEnabled(sessionId, value);
+    if (SessionRecord* record = sessionRecord(sessionId))
+        record->downsampling = value;
+}
+
+void AbstractSensorChannelAdaptor::setChangeThreshold(int sessionId, unsigned int value)
+{
+    ControlProbe probe("setChangeThreshold", sessionId);
+    node()->setChangeThreshold(sessionId, value);
+}
+
+void AbstractSensorChannelAdaptor::setMotionThreshold(int sessionId, unsigned int threshold, unsigned int duration)
+{
+    ControlProbe probe("setMotionThreshold", sessionId);
+    node()->setMotionThreshold(sessionId, threshold, duration);
+}
+
+bool AbstractSensorChannelAdaptor::readLatest(int sessionId)
+{
+    ControlProbe probe("readLatest", sessionId);
+    return node()->writeLatest(sessionId);
+}
+
+bool AbstractSensorChannelAdaptor::readHistory(int sessionId, unsigned int ms)
+{
+    ControlProbe probe("readHistory", sessionId);
+    return node()->writeHistory(sessionId, ms);
 }
@@ -29,16 +29,20 @@
 #ifndef ABSTRACTSENSORADAPTOR_H
 #define ABSTRACTSENSORADAPTOR_H
 
-#include <QtDBus/QtDBus>
+#include "adaptorbase.h"
 #include "abstractsensor.h"
 #include "datatypes/datarange.h"
+#include <QStringList>
+#include <QVariantMap>
+
+struct SessionRecord;
 
 /**
  * Sensor DBus facade for handling remote method invocations. It instance
  * has associated AbstractSensorChannel to which this object delegates
  * calls.
  */
-class AbstractSensorChannelAdaptor : public QDBusAbstractAdaptor
+class AbstractSensorChannelAdaptor : public AdaptorBase
 {
     Q_OBJECT
     Q_DISABLE_COPY(AbstractSensorChannelAdaptor)
@@ -53,6 +57,7 @@ class AbstractSensorChannelAdaptor : public QDBusAbstractAdaptor
     Q_PROPERTY(QString type READ type)
     Q_PROPERTY(int errorCodeInt READ errorCodeInt)
     Q_PROPERTY(bool hwBuffering READ hwBuffering)
+    Q_PROPERTY(unsigned int droppedSamples READ droppedSamples)
 
 public:
     /**
@@ -83,6 +88,25 @@ private:
      */
     AbstractSensorChannel* node() const;
 
+    /**
+     * Resumable state of a session, updated as the client configures it.
+     *
+     * @param sessionId session ID.
+     * @return record or NULL if the session is not resumable.
+     */
+    SessionRecord* sessionRecord(int sessionId) const;
+
+    /**
+     * Current value of a changed property, matched without case to the
+     * properties of the adaptor. Data range is the current range.
+     *
+     * @param name property name as passed to propertyChanged().
+     * @return property value, empty string if there is no such property.
+     */
+    QVariant changedValue(const QString& name) const;
+
+    QStringList changedProperties_; /**< properties changed since the last propertiesChanged() */
+
 public Q_SLOTS: // METHODS
 
     /** AbstractSensorChannel::isValid() */
@@ -118,6 +142,23 @@ public Q_SLOTS: // METHODS
     /** AbstractSensorChannel::stop(int) */
     void stop(int sessionId);
 
+    /**
+     * Start the session and apply its configuration in a single call, so
+     * that a client needs one round-trip instead of one per setting.
+     * Settings are applied in the order the separate methods would be
+     * called after start().
+     *
+     * @param sessionId session ID.
+     * @param standbyOverride see setStandbyOverride().
+     * @param interval see setInterval().
+     * @param bufferInterval see setBufferInterval().
+     * @param bufferSize see setBufferSize().
+     * @param downsampling see setDownsampling().
+     * @return was standby override applied.
+     */
+    bool configureAndStart(int sessionId, bool standbyOverride, int interval,
+                           unsigned int bufferInterval, unsigned int bufferSize, bool downsampling);
+
     /** AbstractSensorChannel::setInterval(int, int)
      *
      *  Will also configure interval for the data connection.
@@ -136,6 +177,24 @@ public Q_SLOTS: // METHODS
     /** AbstractSensorChannel::setDownsampling(int, bool) */
     void setDownsampling(int sessionId, bool value);
 
+    /** AbstractSensorChannel::setChangeThreshold(int, unsigned int) */
+    void setChangeThreshold(int sessionId, unsigned int value);
+
+    /** AbstractSensorChannel::setMotionThreshold(int, unsigned int, unsigned int) */
+    void setMotionThreshold(int sessionId, unsigned int threshold, unsigned int duration);
+
+    /** AbstractSensorChannel::writeLatest(int)
+     *
+     *  Sample is delivered over the data connection of the session.
+     */
+    bool readLatest(int sessionId);
+
+    /** AbstractSensorChannel::writeHistory(int, unsigned int)
+     *
+     *  Samples are delivered over the data connection of the session.
+     */
+    bool readHistory(int sessionId, unsigned int ms);
+
     /** AbstractSensorChannel::isValid(int, unsigned int)
      *
      *  Will also configure buffer interval for the data connection.
@@ -172,9 +231,63 @@ public Q_SLOTS: // METHODS
     /** AbstractSensorChannel::hwBuffering() */
     bool hwBuffering() const;
 
+    /** SocketHandler::droppedCount(const QString&) */
+    unsigned int droppedSamples() const;
+
+    /** SocketHandler::droppedCount(int) */
+    unsigned int sessionDroppedSamples(int sessionId) const;
+
+    /**
+     * Every property of the sensor and of a session in one reply, for
+     * clients which would otherwise make a call per property. Properties
+     * of the adaptor, such as interval and description, are under their
+     * own names; ranges under the names of their getters, such as
+     * getAvailableIntervals. Session properties are sessionInterval,
+     * sessionDownsampling, sessionChangeThreshold and
+     * sessionDroppedSamples.
+     *
+     * @param sessionId session ID, -1 for sensor properties only.
+     * @return properties by name.
+     */
+    QVariantMap status(int sessionId);
+
+    /** SocketHandler::setBackpressure(int, SessionData::BackpressurePolicy, int)
+     *
+     *  Policy is one of "drop-oldest", "drop-newest" or "coalesce".
+     */
+    void setBackpressure(int sessionId, const QString& policy, int highWater);
+
+    /** SocketHandler::setFramePacing(int, unsigned int, unsigned int, unsigned int, bool) */
+    void setFramePacing(int sessionId, unsigned int period, unsigned int phase, unsigned int lead, bool extrapolate);
+
+    /** SensorManager::setSessionPriority(int, int) */
+    void setPriority(int sessionId, int priority);
+
 Q_SIGNALS:
-    /** AbstractSensorChannel::propertyChanged(name) */
-    void propertyChanged(const QString& name);
+    /**
+     * Properties of the channel have changed. Changes of one event loop
+     * pass are signalled together, so that a renegotiation touching
+     * several properties, or the same one several times, wakes clients
+     * once.
+     *
+     * @param changes current values of the changed properties by
+     *        AbstractSensorChannel::propertyChanged() name.
+     */
+    void propertiesChanged(const QVariantMap& changes);
+
+private Q_SLOTS:
+    /**
+     * Collect a property change of the channel for the next
+     * propertiesChanged().
+     *
+     * @param name property name.
+     */
+    void collectPropertyChange(const QString& name);
+
+    /**
+     * Signal the collected property changes.
+     */
+    void flushPropertyChanges();
 };
 
 #endif // ABSTRACTSENSORADAPTOR_H
@@ -0,0 +1,46 @@
+/**
+   @file adaptorbase.h
+   @brief Base class of the remote interface adaptors
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef ADAPTORBASE_H
+#define ADAPTORBASE_H
+
+#ifdef SENSORFW_NO_DBUS
+
+#include <QObject>
+
+/**
+ * Without D-Bus adaptors are plain objects. Their slots and properties
+ * are called by name from the control socket, see ControlHandler.
+ */
+typedef QObject AdaptorBase;
+
+#else
+
+#include <QtDBus/QtDBus>
+
+/**
+ * Adaptors export their slots and properties on the system bus.
+ */
+typedef QDBusAbstractAdaptor AdaptorBase;
+
+#endif
+
+#endif // ADAPTORBASE_H
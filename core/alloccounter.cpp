@@ -0,0 +1,94 @@
+/**
+   @file alloccounter.cpp
+   @brief AllocCounter
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "alloccounter.h"
+
+#include <stddef.h>
+
+#if defined(SENSORD_ALLOC_TRACKING) && defined(__GLIBC__)
+
+static unsigned long processAllocations = 0;
+// Initial-exec model keeps TLS access from calling back into malloc
+static __thread unsigned long threadAllocations __attribute__((tls_model("initial-exec"))) = 0;
+
+static inline void countAllocation()
+{
+    ++threadAllocations;
+    __sync_fetch_and_add(&processAllocations, 1);
+}
+
+// Allocator entry points of glibc, operator new and Qt containers end up
+// in the interposed functions below.
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* ptr, size_t size);
+
+extern "C" void* malloc(size_t size)
+{
+    countAllocation();
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size)
+{
+    countAllocation();
+    return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* ptr, size_t size)
+{
+    countAllocation();
+    return __libc_realloc(ptr, size);
+}
+
+bool AllocCounter::isEnabled()
+{
+    return true;
+}
+
+unsigned long AllocCounter::threadCount()
+{
+    return threadAllocations;
+}
+
+unsigned long AllocCounter::processCount()
+{
+    return __sync_fetch_and_add(&processAllocations, 0);
+}
+
+#else
+
+bool AllocCounter::isEnabled()
+{
+    return false;
+}
+
+unsigned long AllocCounter::threadCount()
+{
+    return 0;
+}
+
+unsigned long AllocCounter::processCount()
+{
+    return 0;
+}
+
+#endif
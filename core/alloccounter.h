@@ -0,0 +1,60 @@
+/**
+   @file alloccounter.h
+   @brief AllocCounter
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef ALLOCCOUNTER_H
+#define ALLOCCOUNTER_H
+
+/**
+ * Heap allocation counters of the allocation tracking build.
+ *
+ * When built with <code>qmake CONFIG+=alloctracking</code>
+ * (SENSORD_ALLOC_TRACKING), the allocator entry points are interposed and
+ * every malloc, calloc and realloc is counted, both per thread and per
+ * process. Ring buffer statistics and the sample queue then report the
+ * allocations made while delivering samples. In normal builds nothing is
+ * interposed and all counters stay at zero.
+ */
+class AllocCounter
+{
+public:
+    /**
+     * Is allocation tracking compiled in.
+     *
+     * @return is allocation tracking enabled.
+     */
+    static bool isEnabled();
+
+    /**
+     * Allocations made by the calling thread.
+     *
+     * @return allocation count.
+     */
+    static unsigned long threadCount();
+
+    /**
+     * Allocations made by all threads.
+     *
+     * @return allocation count.
+     */
+    static unsigned long processCount();
+};
+
+#endif // ALLOCCOUNTER_H
@@ -33,22 +33,99 @@
 #include "source.h"
 #include "sink.h"
 #include "ringbuffer.h"
+#include "dataflowgraph.h"
 #include "logging.h"
 
-Bin::Bin()
+QList<const Bin*> Bin::instances_;
+QMutex            Bin::instancesMutex_;
+
+Bin::Bin() :
+    arena_(NodeArena::current())
 {
+    QMutexLocker locker(&instancesMutex_);
+    instances_.append(this);
 }
 
 Bin::~Bin()
 {
+    QMutexLocker locker(&instancesMutex_);
+    instances_.removeOne(this);
+}
+
+QList<const Bin*> Bin::instances()
+{
+    QMutexLocker locker(&instancesMutex_);
+    return instances_;
+}
+
+const NodeArena* Bin::arena() const
+{
+    return arena_;
+}
+
+void Bin::describe(DataflowGraph& graph, const QString& prefix) const
+{
+    for (QHash<QString, Pusher*>::const_iterator it = pushers_.constBegin(); it != pushers_.constEnd(); ++it) {
+        const void* node = dynamic_cast<const void*>(it.value());
+        const RingBufferReaderBase* reader = dynamic_cast<const RingBufferReaderBase*>(it.value());
+        graph.addNode(node, prefix + "/" + it.key(), reader ? "reader" : "pusher");
+        graph.addSources(node, it.value());
+        if (reader)
+            graph.addReader(reader);
+    }
+
+    for (QHash<QString, Consumer*>::const_iterator it = consumers_.constBegin(); it != consumers_.constEnd(); ++it) {
+        // Plain consumers are not polymorphic, buffers are
+        const void* node = it.value();
+        foreach (RingBufferBase* buffer, buffers_) {
+            if (static_cast<Consumer*>(buffer) == it.value()) {
+                node = dynamic_cast<const void*>(buffer);
+                graph.addBuffer(prefix + "/" + it.key(), buffer);
+            }
+        }
+        graph.addNode(node, prefix + "/" + it.key(), "consumer");
+        graph.addSinks(node, it.value());
+    }
+
+    for (QHash<QString, FilterBase*>::const_iterator it = filters_.constBegin(); it != filters_.constEnd(); ++it) {
+        const void* node = dynamic_cast<const void*>(it.value());
+        graph.addNode(node, prefix + "/" + it.key(), "filter");
+        graph.addSinks(node, it.value());
+        graph.addSources(node, it.value());
+    }
 }
 
 void Bin::start()
 {
+    setReadersActive(true);
+    compile();
+}
+
+void Bin::compile()
+{
+    foreach (RingBufferBase* buffer, buffers_) {
+        buffer->setPassThrough(true);
+    }
 }
 
 void Bin::stop()
 {
+    setReadersActive(false);
+}
+
+void Bin::setReadersActive(bool active)
+{
+    foreach (Pusher* pusher, pushers_) {
+        if (RingBufferReaderBase* reader = dynamic_cast<RingBufferReaderBase*>(pusher))
+            reader->setActive(active);
+    }
+}
+
+void Bin::reconfigure(const QStringList& keys)
+{
+    foreach (FilterBase* filter, filters_) {
+        filter->reconfigure(keys);
+    }
 }
 
 void Bin::add(Pusher* pusher, const QString& name)
@@ -76,6 +153,12 @@ void Bin::add(FilterBase* filter, const QString& name)
     filters_.insert(name, filter);
 }
 
+void Bin::add(RingBufferBase* buffer, const QString& name)
+{
+    add(static_cast<Consumer*>(buffer), name);
+    buffers_.append(buffer);
+}
+
 bool Bin::join(const QString& producerName,
                const QString& sourceName,
                const QString& consumerName,
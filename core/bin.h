@@ -31,7 +31,11 @@
 #define BIN_H
 
 #include "callback.h"
+#include "nodearena.h"
 #include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QStringList>
 
 class SourceBase;
 class SinkBase;
@@ -39,6 +43,8 @@ class Pusher;
 class Producer;
 class Consumer;
 class FilterBase;
+class RingBufferBase;
+class DataflowGraph;
 
 template <class TYPE>
 class RingBuffer;
@@ -51,7 +57,7 @@ class RingBuffer;
  * It is possible to subclass bin for threaded usage where bin instance
  * is run by dedicated thread.
  */
-class Bin
+class Bin : public ArenaNode
 {
 public:
     class Command;
@@ -68,15 +74,33 @@ public:
 
     /**
      * Start bin processing. This should be called after all buffers and
-     * readers have been joined.
+     * readers have been joined. Compiles the bin.
      */
     virtual void start();
 
     /**
-     * Stop bin processing.
+     * Compile dataflow of the bin. Ring buffers of the bin are allowed to
+     * pass data straight to their reader when they have only one, so the
+     * copy into the ring and out to the reader chunk is skipped. Buffers
+     * stay joined and named, and fall back to buffering whenever other
+     * readers are connected.
+     */
+    void compile();
+
+    /**
+     * Stop bin processing. Readers of the bin stop consuming, so sources
+     * feeding nothing else skip them, see DemandNode.
      */
     virtual void stop();
 
+    /**
+     * Pass changed configuration keys to the filters of the bin, see
+     * FilterBase::reconfigure().
+     *
+     * @param keys changed configuration keys.
+     */
+    void reconfigure(const QStringList& keys);
+
     /**
      * Add new data pusher. Pusher callback is set to call the bin.
      *
@@ -101,6 +125,15 @@ public:
      */
     void add(FilterBase* filter,   const QString& name);
 
+    /**
+     * Add new ring buffer. Buffer is a consumer which #compile() may
+     * turn into pass-through.
+     *
+     * @param buffer buffer.
+     * @param name name for the buffer.
+     */
+    void add(RingBufferBase* buffer, const QString& name);
+
     /**
      * Establish dataflow connection.
      *
@@ -129,6 +162,30 @@ public:
                 const QString& consumerName,
                 const QString& sinkName);
 
+    /**
+     * Add the pushers, consumers and filters of the bin to a dataflow
+     * graph.
+     *
+     * @param graph graph.
+     * @param prefix prefix of node names, e.g. ID of the owning chain.
+     */
+    void describe(DataflowGraph& graph, const QString& prefix) const;
+
+    /**
+     * Arena the bin was built in, see NodeArenaScope. Tells which sensor
+     * or chain the bin belongs to.
+     *
+     * @return arena or NULL if the bin is on the heap.
+     */
+    const NodeArena* arena() const;
+
+    /**
+     * Bins alive in the process, in order of construction.
+     *
+     * @return bins.
+     */
+    static QList<const Bin*> instances();
+
 protected:
     /**
      * Pointer to the producer data source.
@@ -165,9 +222,21 @@ protected:
     Consumer*   consumer(const QString& name) const;
 
 private:
+    /**
+     * Activate or deactivate ring buffer readers of the bin.
+     *
+     * @param active are the readers active.
+     */
+    void setReadersActive(bool active);
+
     QHash<QString, Pusher*>     pushers_;   /**< Pushers   */
     QHash<QString, Consumer*>   consumers_; /**< Consumers */
     QHash<QString, FilterBase*> filters_;   /**< Filters   */
+    QList<RingBufferBase*>      buffers_;   /**< Ring buffers, also in consumers_ */
+    const NodeArena*            arena_;     /**< arena the bin was built in */
+
+    static QList<const Bin*>    instances_; /**< bins alive */
+    static QMutex               instancesMutex_; /**< guards instances_ */
 };
 
 #endif
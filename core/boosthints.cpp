@@ -0,0 +1,196 @@
+/**
+   @file boosthints.cpp
+   @brief Asynchronous performance boost hints
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "boosthints.h"
+#include "config.h"
+#include "logging.h"
+#include "datatypes/atomic.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include <unistd.h>
+
+static quint64 monotonicMs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000ULL + ts.tv_nsec / 1000000;
+}
+
+BoostHints& BoostHints::instance()
+{
+    static BoostHints hints;
+    return hints;
+}
+
+BoostHints::BoostHints() :
+    count_(0),
+    eventDescriptor_(-1),
+    stopping_(0)
+{
+}
+
+BoostHints::~BoostHints()
+{
+    if (isRunning()) {
+        Atomic::storeRelease(stopping_, 1);
+        quint64 one = 1;
+        if (::write(eventDescriptor_, &one, sizeof(one)) != sizeof(one))
+            sensordLogW() << "Failed to stop boost hint thread: " << strerror(errno);
+        wait();
+    }
+    int count = Atomic::loadAcquire(count_);
+    for (int i = 0; i < count; ++i) {
+        if (hints_[i].active)
+            write(hints_[i], hints_[i].release);
+        close(hints_[i].fd);
+    }
+    if (eventDescriptor_ != -1)
+        close(eventDescriptor_);
+}
+
+int BoostHints::registerHint(const QString& name, const QString& defaultPath)
+{
+    QMutexLocker locker(&mutex_);
+    int count = Atomic::loadAcquire(count_);
+    for (int i = 0; i < count; ++i) {
+        if (hints_[i].name == name)
+            return i;
+    }
+    if (count == MAX_HINTS) {
+        sensordLogW() << "Too many boost hints, " << name << " is not dispatched";
+        return -1;
+    }
+
+    Config* config = Config::configuration();
+    QString prefix("boost/" + name + "_");
+    QString path(config ? config->value<QString>(prefix + "path", defaultPath) : defaultPath);
+    if (path.isEmpty())
+        return -1;
+    int fd = open(path.toLocal8Bit().constData(), O_WRONLY | O_CLOEXEC);
+    if (fd == -1) {
+        sensordLogW() << "Failed to open " << path << " for boost hint " << name << ": " << strerror(errno);
+        return -1;
+    }
+    if (eventDescriptor_ == -1) {
+        eventDescriptor_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (eventDescriptor_ == -1) {
+            sensordLogW() << "Failed to create boost hint eventfd: " << strerror(errno);
+            close(fd);
+            return -1;
+        }
+    }
+
+    Hint& hint(hints_[count]);
+    hint.name = name;
+    hint.value = config ? config->value<QString>(prefix + "value", "1").toLocal8Bit() : QByteArray("1");
+    hint.release = config ? config->value<QString>(prefix + "release", "0").toLocal8Bit() : QByteArray("0");
+    hint.duration = config ? qMax(0, config->value<int>(prefix + "duration", 0)) : 0;
+    hint.fd = fd;
+    Atomic::store(hint.pending, 0);
+    Atomic::store(hint.writes, 0);
+    hint.active = false;
+    hint.until = 0;
+    Atomic::storeRelease(count_, count + 1);
+
+    if (!isRunning())
+        start(QThread::HighPriority);
+    sensordLogD() << "Boost hint " << name << " writes " << path;
+    return count;
+}
+
+void BoostHints::hint(int handle)
+{
+    if (handle < 0 || handle >= Atomic::loadAcquire(count_))
+        return;
+    // Only the first hint since the last dispatch wakes up the thread
+    if (hints_[handle].pending.fetchAndStoreRelease(1))
+        return;
+    quint64 one = 1;
+    if (::write(eventDescriptor_, &one, sizeof(one)) != sizeof(one))
+        Atomic::storeRelease(hints_[handle].pending, 0);
+}
+
+unsigned BoostHints::writes(int handle) const
+{
+    if (handle < 0 || handle >= Atomic::loadAcquire(count_))
+        return 0;
+    return Atomic::loadAcquire(hints_[handle].writes);
+}
+
+void BoostHints::write(Hint& hint, const QByteArray& content)
+{
+    if (pwrite(hint.fd, content.constData(), content.size(), 0) != content.size()) {
+        sensordLogD() << "Failed to write boost hint " << hint.name << ": " << strerror(errno);
+        return;
+    }
+    hint.writes.fetchAndAddRelaxed(1);
+}
+
+void BoostHints::run()
+{
+    while (!Atomic::loadAcquire(stopping_)) {
+        quint64 now = monotonicMs();
+        int timeout = -1;
+        int count = Atomic::loadAcquire(count_);
+        for (int i = 0; i < count; ++i) {
+            if (hints_[i].active) {
+                int left = hints_[i].until > now ? (int)(hints_[i].until - now) : 0;
+                timeout = timeout < 0 ? left : qMin(timeout, left);
+            }
+        }
+
+        struct pollfd pfd;
+        pfd.fd = eventDescriptor_;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if (poll(&pfd, 1, timeout) < 0 && errno != EINTR) {
+            sensordLogW() << "Boost hint poll(): " << strerror(errno);
+            msleep(100);
+            continue;
+        }
+        if (pfd.revents & POLLIN) {
+            quint64 value;
+            if (read(eventDescriptor_, &value, sizeof(value)) < 0 && errno != EAGAIN)
+                sensordLogW() << "Failed to read boost hint eventfd: " << strerror(errno);
+        }
+
+        now = monotonicMs();
+        count = Atomic::loadAcquire(count_);
+        for (int i = 0; i < count; ++i) {
+            Hint& hint(hints_[i]);
+            if (hint.pending.fetchAndStoreAcquire(0)) {
+                if (!hint.active)
+                    write(hint, hint.value);
+                if (hint.duration) {
+                    hint.active = true;
+                    hint.until = now + hint.duration;
+                }
+            } else if (hint.active && now >= hint.until) {
+                write(hint, hint.release);
+                hint.active = false;
+            }
+        }
+    }
+}
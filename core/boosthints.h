@@ -0,0 +1,131 @@
+/**
+   @file boosthints.h
+   @brief Asynchronous performance boost hints
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef BOOSTHINTS_H
+#define BOOSTHINTS_H
+
+#include <QThread>
+#include <QString>
+#include <QByteArray>
+#include <QAtomicInt>
+#include <QMutex>
+
+/**
+ * Dispatches performance boost hints, such as CPU frequency raises, from
+ * the data path. Nodes register a hint by name and raise it from any
+ * thread without blocking: raising only marks the hint pending, and a
+ * background thread writes the boost file of the hint. Hints raised
+ * before the thread gets to them are coalesced into one write.
+ *
+ * A hint is configured with boost/<name>_path (boost file, the default
+ * is given at registration), boost/<name>_value (written to boost,
+ * default "1") and boost/<name>_duration (ms). With a duration the boost
+ * is held for that long after the latest hint and then ended by writing
+ * boost/<name>_release (default "0"); hints during the boost only extend
+ * it. Without a duration the value is written on every coalesced hint
+ * and the driver decides how long the boost lasts.
+ */
+class BoostHints : public QThread
+{
+public:
+    /**
+     * Default dispatcher. Thread is started when the first hint is
+     * registered.
+     *
+     * @return dispatcher.
+     */
+    static BoostHints& instance();
+
+    /**
+     * Constructor.
+     */
+    BoostHints();
+
+    /**
+     * Destructor. Stops the thread and ends active boosts.
+     */
+    ~BoostHints();
+
+    /**
+     * Register hint. Registering a name again returns the same handle.
+     *
+     * @param name hint name, used for the configuration keys.
+     * @param defaultPath boost file used when boost/<name>_path is not set.
+     * @return handle for #hint(), -1 if the boost file can not be opened.
+     */
+    int registerHint(const QString& name, const QString& defaultPath = QString());
+
+    /**
+     * Raise hint. Does not block, may be called from any thread.
+     *
+     * @param handle handle from #registerHint(), -1 is ignored.
+     */
+    void hint(int handle);
+
+    /**
+     * How many times boost files have been written for a hint.
+     *
+     * @param handle hint handle.
+     * @return number of boost writes.
+     */
+    unsigned writes(int handle) const;
+
+protected:
+    void run();
+
+private:
+    Q_DISABLE_COPY(BoostHints)
+
+    /**
+     * Registered hint.
+     */
+    struct Hint
+    {
+        QString    name;     /**< hint name */
+        QByteArray value;    /**< written to boost */
+        QByteArray release;  /**< written to end a boost */
+        int        duration; /**< boost duration in ms, 0 if ended by the driver */
+        int        fd;       /**< boost file */
+        QAtomicInt pending;  /**< has hint been raised since last dispatch */
+        QAtomicInt writes;   /**< boost file writes */
+        bool       active;   /**< is a boost being held, dispatcher thread only */
+        quint64    until;    /**< end of the held boost, monotonic ms */
+    };
+
+    /**
+     * Write to the boost file of a hint.
+     *
+     * @param hint hint.
+     * @param content value to write.
+     */
+    static void write(Hint& hint, const QByteArray& content);
+
+    /** Most hints registered at once */
+    static const int MAX_HINTS = 16;
+
+    Hint       hints_[MAX_HINTS]; /**< registered hints */
+    QAtomicInt count_;            /**< number of registered hints, published after setup */
+    QMutex     mutex_;            /**< serializes registration */
+    int        eventDescriptor_;  /**< eventfd waking up the thread */
+    QAtomicInt stopping_;         /**< should the thread exit */
+};
+
+#endif // BOOSTHINTS_H
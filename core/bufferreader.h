@@ -74,10 +74,122 @@ public:
         }
     }
 
+protected:
+    /**
+     * Propagate objects from pass-through buffer without copying, in
+     * chunks of at most chunkSize objects.
+     */
+    bool pushDirect(unsigned n, const TYPE* values)
+    {
+        while (n) {
+            unsigned count = qMin(n, chunkSize_);
+            source_.propagate(count, values);
+            values += count;
+            n -= count;
+        }
+        return true;
+    }
+
 private:
     Source<TYPE> source_;    /**< Source */
     unsigned     chunkSize_; /**< How many objects can be buffered */
     TYPE*        chunk_;     /**< Data storage */
 };
 
+/**
+ * Buffer reader which propagates at most one object per interval into
+ * sinks attached into source "source", judged by object timestamps.
+ * Lets low-rate consumers tap a buffer fed at a higher rate by other
+ * clients without processing every object.
+ *
+ * @tparam TYPE Data type of entries in RingBuffer, derived from TimedData.
+ */
+template <class TYPE>
+class DecimatingReader : public RingBufferReader<TYPE>
+{
+
+public:
+    /**
+     * Constructor.
+     *
+     * @param chunkSize how many objects reader can process with single call
+     * @param interval least interval between propagated objects in
+     *                 milliseconds, 0 propagates every object.
+     */
+    DecimatingReader(unsigned chunkSize, unsigned interval = 0) :
+        chunkSize_(chunkSize),
+        chunk_(new TYPE[chunkSize]),
+        period_(interval * 1000ULL),
+        next_(0)
+    {
+        this->addSource(&source_, "source");
+    }
+
+    /**
+     * Destructor.
+     */
+    virtual ~DecimatingReader()
+    {
+        delete[] chunk_;
+    }
+
+    /**
+     * Set least interval between propagated objects.
+     *
+     * @param interval interval in milliseconds, 0 propagates every object.
+     */
+    void setInterval(unsigned interval)
+    {
+        period_ = interval * 1000ULL;
+    }
+
+    /**
+     * Propagate the next object regardless of the interval.
+     */
+    void reset()
+    {
+        next_ = 0;
+    }
+
+    /**
+     * Propagate data into sinks attached to source "source".
+     */
+    void pushNewData()
+    {
+        unsigned n;
+        while ((n = RingBufferReader<TYPE>::read(chunkSize_, chunk_))) {
+            propagate(n, chunk_);
+        }
+    }
+
+protected:
+    bool pushDirect(unsigned n, const TYPE* values)
+    {
+        propagate(n, values);
+        return true;
+    }
+
+private:
+    void propagate(unsigned n, const TYPE* values)
+    {
+        if (!period_) {
+            source_.propagate(n, values);
+            return;
+        }
+        for (unsigned i = 0; i < n; ++i) {
+            if (values[i].timestamp_ < next_)
+                continue;
+            source_.propagate(1, values + i);
+            // Accept some jitter from a source running at the interval
+            next_ = values[i].timestamp_ + period_ - period_ / 8;
+        }
+    }
+
+    Source<TYPE> source_;    /**< Source */
+    unsigned     chunkSize_; /**< How many objects can be buffered */
+    TYPE*        chunk_;     /**< Data storage */
+    quint64      period_;    /**< least interval in microseconds */
+    quint64      next_;      /**< earliest timestamp to propagate */
+};
+
 #endif
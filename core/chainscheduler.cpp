@@ -0,0 +1,342 @@
+/**
+   @file chainscheduler.cpp
+   @brief ChainScheduler
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "chainscheduler.h"
+#include "ringbuffer.h"
+#include "config.h"
+#include "logging.h"
+#include "datatypes/atomic.h"
+
+#include <QStringList>
+
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+
+ChainStrand::ChainStrand(const QString& name, ChainWorker* home) :
+    name_(name),
+    home_(home),
+    state_(Idle),
+    depth_(0),
+    maxDepth_(0),
+    runs_(0),
+    steals_(0),
+    coalesced_(0)
+{
+}
+
+ChainStrand::~ChainStrand()
+{
+    while (Atomic::load(state_) != Idle) {
+        if (Atomic::load(state_) == Queued && home_->scheduler().cancel(this))
+            state_.fetchAndStoreOrdered(Idle);
+        else
+            QThread::yieldCurrentThread();
+    }
+}
+
+const QString& ChainStrand::name() const
+{
+    return name_;
+}
+
+ChainWorker* ChainStrand::home() const
+{
+    return home_;
+}
+
+void ChainStrand::add(RingBufferReaderBase* reader)
+{
+    QMutexLocker locker(&mutex_);
+    if (!readers_.contains(reader))
+        readers_.append(reader);
+}
+
+void ChainStrand::remove(RingBufferReaderBase* reader)
+{
+    QMutexLocker locker(&mutex_);
+    readers_.removeAll(reader);
+}
+
+void ChainStrand::schedule()
+{
+    for (;;) {
+        int state = Atomic::load(state_);
+        if (state == Idle) {
+            if (state_.testAndSetOrdered(Idle, Queued)) {
+                home_->scheduler().submit(this);
+                return;
+            }
+        } else if (state == Running) {
+            if (state_.testAndSetOrdered(Running, Dirty))
+                return;
+        } else {
+            coalesced_.fetchAndAddRelaxed(1);
+            return;
+        }
+    }
+}
+
+void ChainStrand::run(bool stolen)
+{
+    runs_.fetchAndAddRelaxed(1);
+    if (stolen)
+        steals_.fetchAndAddRelaxed(1);
+
+    for (;;) {
+        mutex_.lock();
+        unsigned int depth = 0;
+        foreach (RingBufferReaderBase* reader, readers_)
+            depth += reader->unread();
+        depth_.fetchAndStoreRelaxed(depth);
+        if (depth > (unsigned int)Atomic::load(maxDepth_))
+            maxDepth_.fetchAndStoreRelaxed(depth);
+        foreach (RingBufferReaderBase* reader, readers_)
+            reader->runPending();
+        mutex_.unlock();
+
+        // Strand may be destroyed as soon as it is idle, nothing is
+        // touched after the state change.
+        if (state_.testAndSetOrdered(Running, Idle))
+            return;
+        state_.fetchAndStoreOrdered(Running);
+    }
+}
+
+unsigned int ChainStrand::depth() const
+{
+    return Atomic::load(depth_);
+}
+
+unsigned int ChainStrand::maxDepth() const
+{
+    return Atomic::load(maxDepth_);
+}
+
+unsigned int ChainStrand::runs() const
+{
+    return Atomic::load(runs_);
+}
+
+unsigned int ChainStrand::steals() const
+{
+    return Atomic::load(steals_);
+}
+
+unsigned int ChainStrand::coalesced() const
+{
+    return Atomic::load(coalesced_);
+}
+
+ChainWorker::ChainWorker(ChainScheduler& scheduler, int index, int cpu) :
+    scheduler_(scheduler),
+    cpu_(cpu)
+{
+    setObjectName(QString("sensord-chain%1").arg(index));
+}
+
+ChainScheduler& ChainWorker::scheduler() const
+{
+    return scheduler_;
+}
+
+int ChainWorker::cpu() const
+{
+    return cpu_;
+}
+
+void ChainWorker::run()
+{
+    if (cpu_ >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu_, &set);
+        int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (err) {
+            sensordLogW() << "Failed to bind" << objectName() << "to CPU" << cpu_ << ":" << strerror(err);
+        }
+    }
+    scheduler_.work(this);
+}
+
+ChainScheduler& ChainScheduler::instance()
+{
+    static ChainScheduler scheduler;
+    static bool configured = false;
+    if (!configured && Config::configuration()) {
+        configured = true;
+
+        int count = Config::configuration()->value<int>("global/chain_workers", 0);
+        if (count < 0)
+            count = QThread::idealThreadCount();
+
+        QList<int> cpus;
+        foreach (const QString& cpu, Config::configuration()->value<QStringList>("global/chain_worker_cpus")) {
+            bool ok;
+            int index = cpu.trimmed().toInt(&ok);
+            if (ok && index >= 0 && index < CPU_SETSIZE)
+                cpus.append(index);
+            else
+                sensordLogW() << "Ignoring invalid chain worker CPU" << cpu;
+        }
+
+        if (count > 0) {
+            sensordLogD() << "Executing filter chains on" << count << "worker threads";
+            scheduler.start(count, cpus);
+        }
+    }
+    return scheduler;
+}
+
+ChainScheduler::ChainScheduler() :
+    queued_(0),
+    running_(0)
+{
+}
+
+ChainScheduler::~ChainScheduler()
+{
+    stop();
+}
+
+bool ChainScheduler::start(int count, const QList<int>& cpus)
+{
+    if (!workers_.isEmpty() || count <= 0)
+        return false;
+
+    running_.fetchAndStoreOrdered(1);
+    for (int i = 0; i < count; ++i) {
+        workers_.append(new ChainWorker(*this, i, cpus.isEmpty() ? -1 : cpus.at(i % cpus.size())));
+        load_.append(0);
+    }
+    foreach (ChainWorker* worker, workers_)
+        worker->start();
+    return true;
+}
+
+void ChainScheduler::stop()
+{
+    if (workers_.isEmpty())
+        return;
+
+    running_.fetchAndStoreOrdered(0);
+    idleMutex_.lock();
+    idleCond_.wakeAll();
+    idleMutex_.unlock();
+
+    foreach (ChainWorker* worker, workers_) {
+        worker->wait();
+        foreach (ChainStrand* strand, worker->queue_)
+            strand->state_.fetchAndStoreOrdered(ChainStrand::Idle);
+    }
+    qDeleteAll(workers_);
+    workers_.clear();
+    load_.clear();
+    assigned_.clear();
+    queued_.fetchAndStoreOrdered(0);
+}
+
+bool ChainScheduler::isEnabled() const
+{
+    return !workers_.isEmpty();
+}
+
+ChainWorker* ChainScheduler::workerFor(const QString& adaptorId)
+{
+    if (workers_.isEmpty())
+        return NULL;
+
+    QMap<QString, ChainWorker*>::const_iterator it = assigned_.constFind(adaptorId);
+    if (it != assigned_.constEnd())
+        return it.value();
+
+    int least = 0;
+    for (int i = 1; i < load_.size(); ++i) {
+        if (load_.at(i) < load_.at(least))
+            least = i;
+    }
+    ++load_[least];
+    assigned_.insert(adaptorId, workers_.at(least));
+    sensordLogD() << "Chains of" << adaptorId << "run on" << workers_.at(least)->objectName();
+    return workers_.at(least);
+}
+
+void ChainScheduler::submit(ChainStrand* strand)
+{
+    ChainWorker* home = strand->home_;
+    home->mutex_.lock();
+    home->queue_.append(strand);
+    home->mutex_.unlock();
+
+    queued_.fetchAndAddOrdered(1);
+    QMutexLocker locker(&idleMutex_);
+    idleCond_.wakeOne();
+}
+
+bool ChainScheduler::cancel(ChainStrand* strand)
+{
+    bool found = false;
+    foreach (ChainWorker* worker, workers_) {
+        QMutexLocker locker(&worker->mutex_);
+        int removed = worker->queue_.removeAll(strand);
+        if (removed) {
+            queued_.fetchAndAddOrdered(-removed);
+            found = true;
+        }
+    }
+    return found;
+}
+
+ChainStrand* ChainScheduler::take(ChainWorker* worker, bool oldest)
+{
+    QMutexLocker locker(&worker->mutex_);
+    if (worker->queue_.isEmpty())
+        return NULL;
+    ChainStrand* strand = oldest ? worker->queue_.takeFirst() : worker->queue_.takeLast();
+    // Marked running while still in the queue lock, see ~ChainStrand()
+    strand->state_.fetchAndStoreOrdered(ChainStrand::Running);
+    queued_.fetchAndAddOrdered(-1);
+    return strand;
+}
+
+void ChainScheduler::work(ChainWorker* worker)
+{
+    int self = workers_.indexOf(worker);
+    unsigned int taken = 0;
+    while (Atomic::load(running_)) {
+        // Own queue newest first while data is hot in cache, now and
+        // then the oldest so that it gets its turn
+        ChainStrand* strand = take(worker, ++taken % FAIR_PERIOD == 0);
+        bool stolen = false;
+        for (int i = 1; !strand && i < workers_.size(); ++i) {
+            strand = take(workers_.at((self + i) % workers_.size()), true);
+            stolen = (strand != NULL);
+        }
+        if (strand) {
+            strand->run(stolen);
+            continue;
+        }
+
+        QMutexLocker locker(&idleMutex_);
+        while (!Atomic::load(queued_) && Atomic::load(running_))
+            idleCond_.wait(&idleMutex_);
+    }
+}
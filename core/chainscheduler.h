@@ -0,0 +1,326 @@
+/**
+   @file chainscheduler.h
+   @brief ChainScheduler
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef CHAINSCHEDULER_H
+#define CHAINSCHEDULER_H
+
+#include <QThread>
+#include <QList>
+#include <QMap>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInt>
+#include <QString>
+
+class RingBufferReaderBase;
+class ChainScheduler;
+class ChainWorker;
+
+/**
+ * Serialized unit of chain work. Each scheduled filter chain has a strand
+ * holding the readers through which data enters the chain. Strand runs on
+ * one worker at a time, so the filters of a chain are never executed
+ * concurrently, but separate chains run in parallel.
+ *
+ * Strand is queued to its home worker when one of its readers has new
+ * data. Idle workers steal queued strands from busy ones.
+ */
+class ChainStrand
+{
+public:
+    /**
+     * Constructor.
+     *
+     * @param name name shown in status output.
+     * @param home worker the strand is queued to.
+     */
+    ChainStrand(const QString& name, ChainWorker* home);
+
+    /**
+     * Destructor. Waits until the strand is no longer queued or running.
+     */
+    ~ChainStrand();
+
+    /**
+     * Strand name.
+     *
+     * @return name.
+     */
+    const QString& name() const;
+
+    /**
+     * Worker the strand is queued to.
+     *
+     * @return home worker.
+     */
+    ChainWorker* home() const;
+
+    /**
+     * Add reader run in this strand.
+     *
+     * @param reader reader to add.
+     */
+    void add(RingBufferReaderBase* reader);
+
+    /**
+     * Remove reader. Reader is not touched by the strand after return.
+     *
+     * @param reader reader to remove.
+     */
+    void remove(RingBufferReaderBase* reader);
+
+    /**
+     * Queue the strand for execution. Called from the writing thread after
+     * a reader of the strand has been marked pending.
+     */
+    void schedule();
+
+    /**
+     * Unread objects in the readers when the strand last ran.
+     *
+     * @return queue depth.
+     */
+    unsigned int depth() const;
+
+    /**
+     * Highest queue depth seen.
+     *
+     * @return max queue depth.
+     */
+    unsigned int maxDepth() const;
+
+    /**
+     * How many times the strand has run.
+     *
+     * @return run count.
+     */
+    unsigned int runs() const;
+
+    /**
+     * How many runs were done by some other than the home worker.
+     *
+     * @return stolen run count.
+     */
+    unsigned int steals() const;
+
+    /**
+     * How many wakeups were merged into an already queued run.
+     *
+     * @return coalesced wakeup count.
+     */
+    unsigned int coalesced() const;
+
+private:
+    Q_DISABLE_COPY(ChainStrand)
+
+    friend class ChainScheduler;
+
+    /**
+     * Strand state.
+     */
+    enum State
+    {
+        Idle = 0, /**< not queued */
+        Queued,   /**< waiting in a worker queue */
+        Running,  /**< being run */
+        Dirty     /**< being run, new data arrived meanwhile */
+    };
+
+    /**
+     * Wake up pending readers until no new data arrives.
+     *
+     * @param stolen is strand run by some other than the home worker.
+     */
+    void run(bool stolen);
+
+    QString                      name_;      /**< strand name */
+    ChainWorker*                 home_;      /**< home worker */
+    QMutex                       mutex_;     /**< guards readers_, held while running */
+    QList<RingBufferReaderBase*> readers_;   /**< readers run by the strand */
+    QAtomicInt                   state_;     /**< #State */
+    QAtomicInt                   depth_;     /**< unread objects at last run */
+    QAtomicInt                   maxDepth_;  /**< highest depth */
+    QAtomicInt                   runs_;      /**< run count */
+    QAtomicInt                   steals_;    /**< stolen run count */
+    QAtomicInt                   coalesced_; /**< merged wakeups */
+};
+
+/**
+ * Worker thread of ChainScheduler with its own queue of strands.
+ */
+class ChainWorker : public QThread
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(ChainWorker)
+
+public:
+    /**
+     * Constructor.
+     *
+     * @param scheduler owning scheduler.
+     * @param index worker index, used for naming the thread.
+     * @param cpu CPU the thread is bound to, or -1 for no affinity.
+     */
+    ChainWorker(ChainScheduler& scheduler, int index, int cpu);
+
+    /**
+     * Owning scheduler.
+     *
+     * @return scheduler.
+     */
+    ChainScheduler& scheduler() const;
+
+    /**
+     * CPU the thread is bound to.
+     *
+     * @return CPU index or -1.
+     */
+    int cpu() const;
+
+protected:
+    /**
+     * Thread entry-function.
+     */
+    void run();
+
+private:
+    friend class ChainScheduler;
+
+    ChainScheduler&     scheduler_; /**< owning scheduler */
+    int                 cpu_;       /**< bound CPU or -1 */
+    QMutex              mutex_;     /**< guards queue_ */
+    QList<ChainStrand*> queue_;     /**< queued strands, newest last */
+};
+
+/**
+ * Work-stealing executor for filter chains. Chains reading the same device
+ * adaptor share a home worker to keep the data path in one cache. Workers
+ * run their own queue newest first and steal the oldest strand from other
+ * workers when their own queue is empty. Every #FAIR_PERIOD th strand a
+ * worker takes from its own queue is the oldest one, so that strands
+ * queued early are not starved by a stream of newer ones.
+ *
+ * Default scheduler is configured with global/chain_workers (number of
+ * workers, 0 disables, negative means one per core) and
+ * global/chain_worker_cpus (comma separated CPU list, worker n is bound to
+ * the nth CPU).
+ */
+class ChainScheduler
+{
+public:
+    /**
+     * Default scheduler, started from configuration on first use.
+     *
+     * @return scheduler.
+     */
+    static ChainScheduler& instance();
+
+    /**
+     * Constructor. Scheduler is disabled until started.
+     */
+    ChainScheduler();
+
+    /**
+     * Destructor. Stops workers.
+     */
+    ~ChainScheduler();
+
+    /**
+     * Start workers.
+     *
+     * @param count number of workers.
+     * @param cpus CPUs to bind workers to, worker n uses cpus[n % size].
+     * @return false if already started or count is not positive.
+     */
+    bool start(int count, const QList<int>& cpus = QList<int>());
+
+    /**
+     * Stop all workers. Queued strands are not run.
+     */
+    void stop();
+
+    /**
+     * Are workers running.
+     *
+     * @return are chains executed on workers.
+     */
+    bool isEnabled() const;
+
+    /**
+     * Home worker for chains reading given adaptor.
+     *
+     * @param adaptorId device adaptor ID.
+     * @return worker or NULL if scheduler is not running.
+     */
+    ChainWorker* workerFor(const QString& adaptorId);
+
+private:
+    Q_DISABLE_COPY(ChainScheduler)
+
+    /**
+     * How often a worker takes the oldest strand of its own queue.
+     */
+    static const unsigned int FAIR_PERIOD = 8;
+
+    friend class ChainStrand;
+    friend class ChainWorker;
+
+    /**
+     * Queue strand to its home worker and wake up an idle worker.
+     *
+     * @param strand strand in Queued state.
+     */
+    void submit(ChainStrand* strand);
+
+    /**
+     * Remove strand from all worker queues.
+     *
+     * @param strand strand to remove.
+     * @return was strand found in some queue.
+     */
+    bool cancel(ChainStrand* strand);
+
+    /**
+     * Take strand from a worker queue and mark it running.
+     *
+     * @param worker worker whose queue is used.
+     * @param oldest take the oldest instead of the newest strand.
+     * @return strand or NULL if queue is empty.
+     */
+    ChainStrand* take(ChainWorker* worker, bool oldest);
+
+    /**
+     * Worker loop.
+     *
+     * @param worker calling worker.
+     */
+    void work(ChainWorker* worker);
+
+    QList<ChainWorker*>         workers_;   /**< worker pool */
+    QList<int>                  load_;      /**< adaptors per worker */
+    QMap<QString, ChainWorker*> assigned_;  /**< adaptor ID to home worker */
+    QMutex                      idleMutex_; /**< guards sleeping */
+    QWaitCondition              idleCond_;  /**< signalled when work is queued */
+    QAtomicInt                  queued_;    /**< queued strands in all queues */
+    QAtomicInt                  running_;   /**< should workers run */
+};
+
+#endif // CHAINSCHEDULER_H
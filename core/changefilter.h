@@ -0,0 +1,139 @@
+/**
+   @file changefilter.h
+   @brief Filter dropping unchanged samples
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef CHANGEFILTER_H
+#define CHANGEFILTER_H
+
+#include "filter.h"
+#include "datatypes/timedunsigned.h"
+#include "datatypes/posedata.h"
+#include "datatypes/orientationdata.h"
+
+/**
+ * Tells whether two samples carry the same value for ChangeFilter.
+ * Timestamps are not compared. The default uses operator==,
+ * specializations exist for the state-like sample types.
+ *
+ * @tparam TYPE sample type.
+ */
+template <class TYPE>
+struct ChangeTraits
+{
+    /**
+     * Are samples the same.
+     *
+     * @param a sample.
+     * @param b sample.
+     * @param tolerance largest difference of equal values, if the type
+     *                  has a numeric value.
+     * @return are samples the same.
+     */
+    static bool same(const TYPE& a, const TYPE& b, double tolerance)
+    {
+        Q_UNUSED(tolerance);
+        return a == b;
+    }
+};
+
+template <>
+struct ChangeTraits<TimedUnsigned>
+{
+    static bool same(const TimedUnsigned& a, const TimedUnsigned& b, double tolerance)
+    {
+        return qAbs((double)a.value_ - (double)b.value_) <= tolerance;
+    }
+};
+
+template <>
+struct ChangeTraits<ProximityData>
+{
+    static bool same(const ProximityData& a, const ProximityData& b, double tolerance)
+    {
+        return a.withinProximity_ == b.withinProximity_ &&
+               qAbs((double)a.value_ - (double)b.value_) <= tolerance;
+    }
+};
+
+template <>
+struct ChangeTraits<PoseData>
+{
+    static bool same(const PoseData& a, const PoseData& b, double tolerance)
+    {
+        Q_UNUSED(tolerance);
+        return a.orientation_ == b.orientation_;
+    }
+};
+
+/**
+ * Filter passing a sample only when it differs from the last passed
+ * one, so state-like sensors do not wake up buffers and clients for
+ * repeated values. The first sample after construction or #reset() is
+ * always passed.
+ *
+ * @tparam TYPE sample type.
+ * @tparam TRAITS comparison of samples, see ChangeTraits.
+ */
+template <class TYPE, class TRAITS = ChangeTraits<TYPE> >
+class ChangeFilter : public Filter<TYPE, ChangeFilter<TYPE, TRAITS>, TYPE>
+{
+public:
+    /**
+     * Constructor.
+     *
+     * @param tolerance largest difference of numeric values that is not
+     *                  a change.
+     */
+    ChangeFilter(double tolerance = 0) :
+        Filter<TYPE, ChangeFilter<TYPE, TRAITS>, TYPE>(this, &ChangeFilter::filter),
+        tolerance_(tolerance),
+        hasLast_(false)
+    {}
+
+    /**
+     * Forget the last passed sample.
+     */
+    void reset()
+    {
+        hasLast_ = false;
+    }
+
+private:
+    void filter(unsigned n, const TYPE* values)
+    {
+        FilterBatch<TYPE> batch;
+        for (unsigned i = 0; i < n; ++i) {
+            // Compared against the last passed sample, so slow drift
+            // within tolerance still comes through eventually
+            if (hasLast_ && TRAITS::same(values[i], last_, tolerance_))
+                continue;
+            last_ = values[i];
+            hasLast_ = true;
+            batch.append(values[i]);
+        }
+        batch.propagate(this->source_);
+    }
+
+    double tolerance_; /**< largest difference that is not a change */
+    bool   hasLast_;   /**< is #last_ set */
+    TYPE   last_;      /**< last passed sample */
+};
+
+#endif // CHANGEFILTER_H
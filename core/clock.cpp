@@ -0,0 +1,162 @@
+/**
+   @file clock.cpp
+   @brief Injectable monotonic time source
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+
+#include "clock.h"
+#include <errno.h>
+#include <time.h>
+
+Clock* Clock::instance_ = 0;
+
+Clock* Clock::instance()
+{
+    static SystemClock system;
+    return instance_ ? instance_ : &system;
+}
+
+void Clock::setInstance(Clock* clock)
+{
+    instance_ = clock;
+}
+
+quint64 SystemClock::now() const
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+void SystemClock::sleep(unsigned long ms)
+{
+    struct timespec ts;
+    ts.tv_sec = ms / 1000;
+    ts.tv_nsec = (ms % 1000) * 1000000L;
+    while (nanosleep(&ts, &ts) == -1 && errno == EINTR)
+        ;
+}
+
+VirtualClock::VirtualClock(quint64 start, QObject* parent) :
+    QObject(parent),
+    now_(start)
+{
+}
+
+quint64 VirtualClock::now() const
+{
+    QMutexLocker locker(&mutex_);
+    return now_;
+}
+
+void VirtualClock::sleep(unsigned long ms)
+{
+    QMutexLocker locker(&mutex_);
+    quint64 deadline = now_ + ms * 1000ULL;
+    while (now_ < deadline)
+        moved_.wait(&mutex_);
+}
+
+void VirtualClock::advance(quint64 us)
+{
+    advanceTo(now() + us);
+}
+
+void VirtualClock::advanceTo(quint64 us)
+{
+    {
+        QMutexLocker locker(&mutex_);
+        if (us <= now_)
+            return;
+        now_ = us;
+        moved_.wakeAll();
+    }
+    emit advanced(us);
+}
+
+ClockTimer::ClockTimer(QObject* parent) :
+    QObject(parent),
+    timer_(this),
+    virtual_(0),
+    deadline_(0),
+    interval_(0),
+    singleShot_(false)
+{
+    connect(&timer_, SIGNAL(timeout()), this, SLOT(timerTimeout()));
+}
+
+void ClockTimer::start(int ms)
+{
+    stop();
+    interval_ = qMax(ms, 0);
+    virtual_ = dynamic_cast<VirtualClock*>(Clock::instance());
+    if (!virtual_) {
+        timer_.start(interval_);
+        return;
+    }
+    deadline_ = virtual_->now() + interval_ * 1000ULL;
+    connect(virtual_, SIGNAL(advanced(quint64)), this, SLOT(clockAdvanced(quint64)));
+}
+
+void ClockTimer::stop()
+{
+    timer_.stop();
+    if (virtual_)
+        disconnect(virtual_, SIGNAL(advanced(quint64)), this, SLOT(clockAdvanced(quint64)));
+    virtual_ = 0;
+}
+
+bool ClockTimer::isActive() const
+{
+    return virtual_ ? true : timer_.isActive();
+}
+
+void ClockTimer::setSingleShot(bool singleShot)
+{
+    singleShot_ = singleShot;
+    timer_.setSingleShot(singleShot);
+}
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+void ClockTimer::setTimerType(Qt::TimerType type)
+{
+    timer_.setTimerType(type);
+}
+#endif
+
+void ClockTimer::clockAdvanced(quint64 now)
+{
+    if (!virtual_ || now < deadline_)
+        return;
+    if (singleShot_) {
+        stop();
+        emit timeout();
+        return;
+    }
+    // A long advance expires a periodic timer once per interval
+    while (virtual_ && now >= deadline_) {
+        deadline_ += qMax(interval_, 1) * 1000ULL;
+        emit timeout();
+    }
+}
+
+void ClockTimer::timerTimeout()
+{
+    emit timeout();
+}
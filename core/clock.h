@@ -0,0 +1,245 @@
+/**
+   @file clock.h
+   @brief Injectable monotonic time source
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <QObject>
+#include <QTimer>
+#include <QMutex>
+#include <QWaitCondition>
+
+/**
+ * Monotonic time source of timing dependent code: session downsampling,
+ * TimerWheel, ClockTimer and reader back-off sleeps. The system clock is
+ * used unless a test installs another one, usually a VirtualClock, with
+ * #setInstance() before the components are created.
+ *
+ * Sample timestamps from Utils::getTimeStamp() and kernel timers of
+ * adaptors stay on the system clock; replayed traces bring their own
+ * timestamps.
+ */
+class Clock
+{
+public:
+    /**
+     * Destructor.
+     */
+    virtual ~Clock() {}
+
+    /**
+     * Current time.
+     *
+     * @return monotonic time in microseconds.
+     */
+    virtual quint64 now() const = 0;
+
+    /**
+     * Block the calling thread.
+     *
+     * @param ms milliseconds to wait.
+     */
+    virtual void sleep(unsigned long ms) = 0;
+
+    /**
+     * Time source in use.
+     *
+     * @return clock.
+     */
+    static Clock* instance();
+
+    /**
+     * Install time source. Clock is not owned and must outlive its use.
+     *
+     * @param clock clock, or NULL for the system clock.
+     */
+    static void setInstance(Clock* clock);
+
+    /**
+     * Current time of the clock in use.
+     *
+     * @return monotonic time in microseconds.
+     */
+    static quint64 monotonicUs() { return instance()->now(); }
+
+    /**
+     * Current time of the clock in use.
+     *
+     * @return monotonic time in milliseconds.
+     */
+    static quint64 monotonicMs() { return instance()->now() / 1000; }
+
+    /**
+     * Block the calling thread on the clock in use.
+     *
+     * @param ms milliseconds to wait.
+     */
+    static void msleep(unsigned long ms) { instance()->sleep(ms); }
+
+private:
+    static Clock* instance_; /**< installed clock or NULL */
+};
+
+/**
+ * CLOCK_MONOTONIC.
+ */
+class SystemClock : public Clock
+{
+public:
+    quint64 now() const;
+    void sleep(unsigned long ms);
+};
+
+/**
+ * Clock which moves only when told to. Threads sleeping on it wake up
+ * when time is advanced past their deadline, and ClockTimers expire in
+ * #advance(), so a test can run minutes of timeouts in milliseconds, for
+ * example by setting the time from the timestamps of a replayed trace.
+ */
+class VirtualClock : public QObject, public Clock
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(VirtualClock)
+
+public:
+    /**
+     * Constructor.
+     *
+     * @param start initial time in microseconds, zero is avoided as
+     *        users take it as "never".
+     * @param parent parent object.
+     */
+    VirtualClock(quint64 start = 1000000, QObject* parent = 0);
+
+    quint64 now() const;
+    void sleep(unsigned long ms);
+
+    /**
+     * Move time forward.
+     *
+     * @param us microseconds to advance.
+     */
+    void advance(quint64 us);
+
+    /**
+     * Move time forward to given time. Earlier times are ignored.
+     *
+     * @param us time in microseconds.
+     */
+    void advanceTo(quint64 us);
+
+Q_SIGNALS:
+    /**
+     * Time was advanced. Emitted in the thread advancing the clock.
+     *
+     * @param now current time in microseconds.
+     */
+    void advanced(quint64 now);
+
+private:
+    mutable QMutex mutex_;   /**< guards now_ */
+    QWaitCondition moved_;   /**< signalled when time advances */
+    quint64        now_;     /**< current time in microseconds */
+};
+
+/**
+ * Timer on the clock in use, with the QTimer interface its users need.
+ * It is a QTimer on the system clock, and expires in
+ * VirtualClock::advance() on a virtual clock. The clock is looked up
+ * when the timer is started.
+ */
+class ClockTimer : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(ClockTimer)
+
+public:
+    /**
+     * Constructor.
+     *
+     * @param parent parent object.
+     */
+    ClockTimer(QObject* parent = 0);
+
+    /**
+     * Start or restart the timer.
+     *
+     * @param ms interval in milliseconds.
+     */
+    void start(int ms);
+
+    /**
+     * Stop the timer.
+     */
+    void stop();
+
+    /**
+     * Is the timer running.
+     *
+     * @return is timer active.
+     */
+    bool isActive() const;
+
+    /**
+     * Fire once per start.
+     *
+     * @param singleShot is the timer single shot.
+     */
+    void setSingleShot(bool singleShot);
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+    /**
+     * Timer type of the system clock timer.
+     *
+     * @param type timer type.
+     */
+    void setTimerType(Qt::TimerType type);
+#endif
+
+Q_SIGNALS:
+    /**
+     * Timer expired.
+     */
+    void timeout();
+
+private Q_SLOTS:
+    /**
+     * Virtual clock advanced.
+     *
+     * @param now current time in microseconds.
+     */
+    void clockAdvanced(quint64 now);
+
+    /**
+     * System clock timer expired.
+     */
+    void timerTimeout();
+
+private:
+    QTimer        timer_;      /**< timer on the system clock */
+    VirtualClock* virtual_;    /**< virtual clock the timer runs on, or NULL */
+    quint64       deadline_;   /**< virtual deadline in microseconds */
+    int           interval_;   /**< interval in milliseconds */
+    bool          singleShot_; /**< is the timer single shot */
+};
+
+#endif // CLOCK_H
@@ -0,0 +1,87 @@
+/**
+   @file clockdomain.cpp
+   @brief Conversion of sample timestamps to the monotonic clock
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "clockdomain.h"
+#include "logging.h"
+#include <time.h>
+
+#ifndef CLOCK_BOOTTIME
+#define CLOCK_BOOTTIME 7
+#endif
+
+/**
+ * Cached offset of one clock, per thread.
+ */
+struct ClockOffset
+{
+    qint64  offset;    /**< clock minus monotonic time, us */
+    quint64 refreshed; /**< coarse monotonic time of measurement, us, 0 if never */
+};
+
+static __thread ClockOffset clockOffsets[ClockDomain::Clocks];
+
+static quint64 readClock(clockid_t id)
+{
+    struct timespec ts;
+    clock_gettime(id, &ts);
+    return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+quint64 ClockDomain::toMonotonic(Clock clock, quint64 timestamp)
+{
+    if (clock == Monotonic)
+        return timestamp;
+    qint64 monotonic = (qint64)timestamp - offset(clock);
+    return monotonic > 0 ? monotonic : 0;
+}
+
+qint64 ClockDomain::offset(Clock clock)
+{
+    if (clock <= Monotonic || clock >= Clocks)
+        return 0;
+
+    ClockOffset& cached = clockOffsets[clock];
+    quint64 coarse = readClock(CLOCK_MONOTONIC_COARSE);
+    if (cached.refreshed && coarse - cached.refreshed < REFRESH_INTERVAL)
+        return cached.offset;
+
+    // Other clock is read between two monotonic reads, the midpoint
+    // is its best match
+    clockid_t id = clock == Boottime ? CLOCK_BOOTTIME : CLOCK_REALTIME;
+    quint64 before = readClock(CLOCK_MONOTONIC);
+    quint64 other = readClock(id);
+    quint64 after = readClock(CLOCK_MONOTONIC);
+    cached.offset = (qint64)other - (qint64)(before + (after - before) / 2);
+    cached.refreshed = coarse ? coarse : 1;
+    return cached.offset;
+}
+
+ClockDomain::Clock ClockDomain::clockFromString(const QString& name, Clock defaultClock)
+{
+    if (name == "monotonic")
+        return Monotonic;
+    if (name == "boottime")
+        return Boottime;
+    if (name == "realtime")
+        return Realtime;
+    sensordLogW() << "Unknown clock" << name;
+    return defaultClock;
+}
@@ -0,0 +1,84 @@
+/**
+   @file clockdomain.h
+   @brief Conversion of sample timestamps to the monotonic clock
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef CLOCKDOMAIN_H
+#define CLOCKDOMAIN_H
+
+#include <QString>
+
+/**
+ * Single time domain for sample timestamps: CLOCK_MONOTONIC
+ * microseconds, as given by Utils::getTimeStamp(). Adaptors whose
+ * source stamps samples with another clock convert the timestamps once
+ * when reading, so chains joining streams compare like with like.
+ *
+ * Offset of each clock to the monotonic clock is cached per thread and
+ * measured again once a second, so conversion is a subtraction. Boot
+ * time runs ahead of monotonic time during suspend: samples stamped
+ * before a suspend and converted after it are off by up to the suspend
+ * time until the offset has been measured again.
+ */
+class ClockDomain
+{
+public:
+    /**
+     * Clocks timestamps come from.
+     */
+    enum Clock
+    {
+        Monotonic = 0, /**< CLOCK_MONOTONIC, the sample domain */
+        Boottime,      /**< CLOCK_BOOTTIME, e.g. Android sensor HALs */
+        Realtime,      /**< CLOCK_REALTIME, e.g. evdev by default */
+        Clocks         /**< number of clocks */
+    };
+
+    /** How often cached offsets are measured again, us */
+    static const quint64 REFRESH_INTERVAL = 1000000;
+
+    /**
+     * Convert timestamp to the monotonic domain.
+     *
+     * @param clock clock of the timestamp.
+     * @param timestamp timestamp in microseconds.
+     * @return monotonic timestamp in microseconds, 0 if the timestamp
+     *         precedes the monotonic epoch.
+     */
+    static quint64 toMonotonic(Clock clock, quint64 timestamp);
+
+    /**
+     * Cached offset of a clock to the monotonic clock.
+     *
+     * @param clock clock.
+     * @return clock minus monotonic time in microseconds.
+     */
+    static qint64 offset(Clock clock);
+
+    /**
+     * Parse clock name used in configuration.
+     *
+     * @param name "monotonic", "boottime" or "realtime".
+     * @param defaultClock clock returned for unknown names.
+     * @return clock.
+     */
+    static Clock clockFromString(const QString& name, Clock defaultClock);
+};
+
+#endif // CLOCKDOMAIN_H
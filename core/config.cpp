@@ -30,11 +30,47 @@
 #include <QSettings>
 #include <QVariant>
 #include <QFile>
+#include <QFileInfo>
 #include <QDir>
 #include <QList>
+#include <QDataStream>
+#include <QDateTime>
+#include <QSaveFile>
+#include <QReadLocker>
+#include <QWriteLocker>
 
 static Config *static_configuration = 0;
 
+/** Cache file magic, "SCFG" */
+static const quint32 CACHE_MAGIC = 0x47464353;
+
+/** Cache file format version */
+static const quint32 CACHE_VERSION = 1;
+
+/**
+ * Append path, size and modification time of a file to stamps.
+ */
+static void appendStamp(QDataStream &stream, const QString &path)
+{
+    QFileInfo info(path);
+    stream << path << (qint64)info.size() << (qint64)info.lastModified().toMSecsSinceEpoch();
+}
+
+/**
+ * Files of a configuration file and its configuration directory.
+ */
+static QStringList configPaths(const QString &defConfigPath, const QString &configDPath)
+{
+    QStringList paths(defConfigPath);
+    if(!configDPath.isEmpty())
+    {
+        QDir dir(configDPath, "*.conf", QDir::Name, QDir::Files);
+        foreach(const QString& file, dir.entryList())
+            paths << dir.absoluteFilePath(file);
+    }
+    return paths;
+}
+
 Config::Config() {
 }
 
@@ -43,12 +79,14 @@ Config::~Config() {
 }
 
 void Config::clearConfig() {
-    foreach(QSettings* setting, settings)
-        delete setting;
-    settings.clear();
+    QWriteLocker locker(&lock_);
+    values_.clear();
+    groups_.clear();
+    inputDevices_.clear();
+    stamps_.clear();
 }
 
-bool Config::loadConfig(const QString &defConfigPath, const QString &configDPath) {
+bool Config::loadConfig(const QString &defConfigPath, const QString &configDPath, const QString &cachePath) {
     Config *config = NULL;
     bool ret = true;
 
@@ -59,20 +97,34 @@ bool Config::loadConfig(const QString &defConfigPath, const QString &configDPath
         config = new Config();
     }
 
-    if (!config->loadConfigFile(defConfigPath))
-        ret = false;
-
     /* Scan config.d dir */
-    QStringList fileList;
-    if(!configDPath.isEmpty())
+    QStringList paths(configPaths(defConfigPath, configDPath));
+    config->sources_.append(qMakePair(defConfigPath, configDPath));
+
+    /* Cache holds a complete merge, so it is used only for a fresh config */
+    bool cached = false;
+    QByteArray stamps;
+    if(!cachePath.isEmpty() && config->isEmpty())
     {
-        QDir dir(configDPath, "*.conf", QDir::Name, QDir::Files);
-        fileList = dir.entryList();
-        foreach(const QString& file, fileList)
+        QDataStream stream(&stamps, QIODevice::WriteOnly);
+        foreach(const QString& path, paths)
+            appendStamp(stream, path);
+        config->cachePath_ = cachePath;
+        cached = config->readCache(stamps);
+    }
+
+    if(!cached)
+    {
+        foreach(const QString& path, paths)
         {
-            if (!config->loadConfigFile(dir.absoluteFilePath(file)))
+            if (!config->loadConfigFile(path))
                 ret = false;
         }
+        if(!stamps.isEmpty() && ret)
+        {
+            config->stamps_ = stamps;
+            config->writeCache();
+        }
     }
 
     static_configuration = config;
@@ -80,54 +132,187 @@ bool Config::loadConfig(const QString &defConfigPath, const QString &configDPath
     return ret;
 }
 
+bool Config::reloadConfig(QStringList &changed) {
+    changed.clear();
+    Config *config = static_configuration;
+    if (!config)
+        return false;
+
+    Config fresh;
+    QByteArray stamps;
+    QDataStream stream(&stamps, QIODevice::WriteOnly);
+    typedef QPair<QString, QString> Source;
+    foreach(const Source& source, config->sources_)
+    {
+        foreach(const QString& path, configPaths(source.first, source.second))
+        {
+            if (!fresh.loadConfigFile(path))
+            {
+                sensordLogW() << "Config reload failed, keeping previous values";
+                return false;
+            }
+            appendStamp(stream, path);
+        }
+    }
+
+    {
+        // Readers in other threads see either the old or the new table
+        QWriteLocker locker(&config->lock_);
+        for(QHash<QString, QVariant>::const_iterator it = fresh.values_.constBegin(); it != fresh.values_.constEnd(); ++it)
+        {
+            QHash<QString, QVariant>::const_iterator old(config->values_.constFind(it.key()));
+            if(old == config->values_.constEnd() || old.value() != it.value())
+                changed << it.key();
+        }
+        for(QHash<QString, QVariant>::const_iterator it = config->values_.constBegin(); it != config->values_.constEnd(); ++it)
+        {
+            if(!fresh.values_.contains(it.key()))
+                changed << it.key();
+        }
+
+        config->values_ = fresh.values_;
+        config->groups_ = fresh.groups_;
+    }
+    if(!config->cachePath_.isEmpty())
+    {
+        config->stamps_ = stamps;
+        config->writeCache();
+    }
+    sensordLogD() << "Config reloaded," << changed.size() << "key(s) changed";
+    return true;
+}
+
+bool Config::readCache(const QByteArray &stamps) {
+    QFile file(cachePath_);
+    if(!file.open(QIODevice::ReadOnly))
+        return false;
+    uchar* data = file.map(0, file.size());
+    if(!data)
+        return false;
+
+    QByteArray raw(QByteArray::fromRawData((const char*)data, file.size()));
+    QDataStream stream(raw);
+    stream.setVersion(QDataStream::Qt_5_0);
+    quint32 magic = 0;
+    quint32 version = 0;
+    QByteArray cachedStamps;
+    stream >> magic >> version;
+    if(magic != CACHE_MAGIC || version != CACHE_VERSION)
+        return false;
+    stream >> cachedStamps;
+    if(stream.status() != QDataStream::Ok || cachedStamps != stamps)
+    {
+        sensordLogD() << "Config cache \"" << cachePath_ << "\" is out of date";
+        return false;
+    }
+
+    QHash<QString, QVariant> values;
+    QStringList groups;
+    QHash<QString, int> inputDevices;
+    stream >> values >> groups >> inputDevices;
+    if(stream.status() != QDataStream::Ok)
+    {
+        sensordLogW() << "Config cache \"" << cachePath_ << "\" is corrupted";
+        return false;
+    }
+    QWriteLocker locker(&lock_);
+    values_ = values;
+    groups_ = groups;
+    inputDevices_ = inputDevices;
+    stamps_ = stamps;
+    sensordLogD() << "Config loaded from cache \"" << cachePath_ << "\"";
+    return true;
+}
+
+void Config::writeCache() const {
+    if(cachePath_.isEmpty() || stamps_.isEmpty())
+        return;
+
+    QSaveFile file(cachePath_);
+    if(!file.open(QIODevice::WriteOnly))
+    {
+        sensordLogW() << "Unable to write config cache \"" << cachePath_ << "\"";
+        return;
+    }
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    {
+        QReadLocker locker(&lock_);
+        stream << CACHE_MAGIC << CACHE_VERSION << stamps_ << values_ << groups_ << inputDevices_;
+    }
+    if(stream.status() != QDataStream::Ok || !file.commit())
+        sensordLogW() << "Unable to write config cache \"" << cachePath_ << "\"";
+}
+
+int Config::inputDeviceHint(const QString &typeName) const {
+    QReadLocker locker(&lock_);
+    return inputDevices_.value(typeName, -1);
+}
+
+void Config::setInputDeviceHint(const QString &typeName, int number) {
+    {
+        QWriteLocker locker(&lock_);
+        if(inputDevices_.value(typeName, -1) == number)
+            return;
+        inputDevices_.insert(typeName, number);
+    }
+    writeCache();
+}
+
 bool Config::loadConfigFile(const QString &configFileName) {
     if(!QFile::exists(configFileName))
     {
         sensordLogW() << "File does not exists \"" << configFileName <<  "\"";
         return false;
     }
-    QSettings* setting = new QSettings(configFileName, QSettings::IniFormat);
-    if(setting->status() == QSettings::NoError) {
-        settings.append(setting);
+    QSettings setting(configFileName, QSettings::IniFormat);
+    if(setting.status() == QSettings::NoError) {
+        /* Keys in the first files have preference over the last. */
+        QWriteLocker locker(&lock_);
+        foreach(const QString& key, setting.allKeys()) {
+            if(!values_.contains(key))
+                values_.insert(key, setting.value(key));
+        }
+        foreach(const QString& group, setting.childGroups()) {
+            if(!groups_.contains(group))
+                groups_ << group;
+        }
         sensordLogD() << "Config file \"" << configFileName << "\" successfully loaded";
         return true;
     }
-    else if(setting->status() == QSettings::AccessError)
+    else if(setting.status() == QSettings::AccessError)
         sensordLogW() << "Unable to open \"" << configFileName <<  "\" configuration file";
-    else if(setting->status() == QSettings::FormatError)
+    else if(setting.status() == QSettings::FormatError)
         sensordLogW() << "Configuration file \"" << configFileName <<  "\" is in wrong format";
     else
-        sensordLogW() << "Configuration file \"" << configFileName <<  "\" parsing failed to unknown error: " << setting->status();
-    delete setting;
+        sensordLogW() << "Configuration file \"" << configFileName <<  "\" parsing failed to unknown error: " << setting.status();
     return false;
 }
 
 QVariant Config::value(const QString &key) const {
-    /* Iterate through configs so that keys in the first files
-     * have preference over the last.
-     */
-    foreach(QSettings* setting, settings) {
-        if(setting->contains(key))
-        {
-            QVariant var = setting->value(key, QVariant());
-            if(var.isValid())
-                sensordLogD() << "Value for key '" << key << "': " << var.toString();
-            return var;
-        }
+    QVariant value;
+    {
+        QReadLocker locker(&lock_);
+        QHash<QString, QVariant>::const_iterator it(values_.find(key));
+        if(it == values_.end())
+            return QVariant();
+        value = it.value();
     }
-    return QVariant();
+    if(value.isValid())
+        sensordLogD() << "Value for key '" << key << "': " << value.toString();
+    return value;
 }
 
 QStringList Config::groups() const
 {
-    QStringList groups;
-    foreach(QSettings* setting, settings) {
-        foreach(const QString& group, setting->childGroups()) {
-            if(!groups.contains(group))
-                groups << group;
-        }
-    }
-    return groups;
+    QReadLocker locker(&lock_);
+    return groups_;
+}
+
+bool Config::isEmpty() const
+{
+    QReadLocker locker(&lock_);
+    return values_.isEmpty();
 }
 
 Config *Config::configuration() {
@@ -144,5 +329,7 @@ void Config::close() {
 
 bool Config::exists(const QString &key) const
 {
-    return value(key).isValid();
+    QReadLocker locker(&lock_);
+    QHash<QString, QVariant>::const_iterator it(values_.find(key));
+    return it != values_.end() && it.value().isValid();
 }
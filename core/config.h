@@ -30,13 +30,17 @@
 
 #include <QString>
 #include <QVariant>
-#include <QSettings>
-#include <QList>
+#include <QHash>
+#include <QStringList>
+#include <QPair>
+#include <QReadWriteLock>
 
 /**
  * Sensord configuration parser. Configuration is read and parsed with
  * the QSettings class. Config is a singleton instance to which configuration
- * is loaded once during startup.
+ * is loaded once during startup. Values of all files are merged into one
+ * table when loaded, so that lookups do not scan the files. Lookups may
+ * run in any thread while reloadConfig() replaces the table.
  */
 class Config
 {
@@ -92,10 +96,45 @@ public:
      * Load configuration from given paths and append them to singleton
      * configuration instance.
      *
+     * When a cache path is given and the singleton is empty, merged
+     * values are taken from the cache file if it was written from files
+     * of the same sizes and modification times. Otherwise the files are
+     * parsed and the cache is rewritten.
+     *
      * @param defConfigPath Path to the config file.
      * @param configDPath Path to the directory with config files.
+     * @param cachePath Path to the cache file, empty disables caching.
+     */
+    static bool loadConfig(const QString &defConfigPath, const QString &configDPath,
+                           const QString &cachePath = QString());
+
+    /**
+     * Read the files given to loadConfig() again and replace the values
+     * of the singleton instance. Values are kept as they are if any of
+     * the files fails to load. Must be called from the main thread.
+     *
+     * @param changed set to keys added, removed or changed.
+     * @return was configuration reloaded.
+     */
+    static bool reloadConfig(QStringList &changed);
+
+    /**
+     * Input device number found for a device type on a previous run.
+     * The device must still be checked; event numbering may change.
+     *
+     * @param typeName device type name.
+     * @return device number or -1 if not known.
      */
-    static bool loadConfig(const QString &defConfigPath, const QString &configDPath);
+    int inputDeviceHint(const QString &typeName) const;
+
+    /**
+     * Remember input device number found for a device type. Kept in the
+     * cache file, which is rewritten when the number changes.
+     *
+     * @param typeName device type name.
+     * @param number device number.
+     */
+    void setInputDeviceHint(const QString &typeName, int number);
 
     /**
      * Close singleton instance.
@@ -136,7 +175,33 @@ private:
      */
     void clearConfig();
 
-    QList<QSettings*> settings; /**< parsed QSettings */
+    /**
+     * Are no values loaded.
+     *
+     * @return is the value table empty.
+     */
+    bool isEmpty() const;
+
+    /**
+     * Read merged values from the cache file.
+     *
+     * @param stamps stamps of the configuration files.
+     * @return did the cache match the files.
+     */
+    bool readCache(const QByteArray &stamps);
+
+    /**
+     * Write merged values to the cache file.
+     */
+    void writeCache() const;
+
+    mutable QReadWriteLock   lock_; /**< guards values_, groups_ and inputDevices_ */
+    QHash<QString, QVariant> values_; /**< values by key, first file defining a key wins */
+    QStringList              groups_; /**< groups in order of appearance */
+    QHash<QString, int>      inputDevices_; /**< input device numbers by type */
+    QString                  cachePath_; /**< cache file or empty */
+    QByteArray               stamps_; /**< stamps of the files the values came from */
+    QList<QPair<QString, QString> > sources_; /**< file and directory of each loadConfig() */
 };
 
 template<typename T>
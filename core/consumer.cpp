@@ -43,3 +43,8 @@ SinkBase* Consumer::sink(const QString& name) const
     }
     return it.value();
 }
+
+const QHash<QString, SinkBase*>& Consumer::sinks() const
+{
+    return sinks_;
+}
@@ -47,6 +47,13 @@ public:
      */
     SinkBase* sink(const QString& name) const;
 
+    /**
+     * Sinks of the consumer.
+     *
+     * @return sinks keyed by name.
+     */
+    const QHash<QString, SinkBase*>& sinks() const;
+
 protected:
     /**
      * Add sink with given name.
@@ -0,0 +1,151 @@
+/**
+   @file controlhandler.cpp
+   @brief Control requests received through the data socket
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "controlhandler.h"
+#include "sockethandler.h"
+#include "sensormanager.h"
+#include "sensormanager_a.h"
+#include "abstractsensor_a.h"
+#include "datatypes/datarange.h"
+#include "logging.h"
+#include <QMetaMethod>
+#include <QStringList>
+
+/** Most arguments QMetaMethod::invoke() takes */
+static const int MAX_ARGUMENTS = 10;
+
+ControlHandler::ControlHandler(SocketHandler* socketHandler, QObject* parent) :
+    QObject(parent),
+    socketHandler_(socketHandler)
+{
+    connect(socketHandler_, SIGNAL(controlRequest(int, QByteArray)), this, SLOT(request(int, QByteArray)));
+}
+
+void ControlHandler::request(int connection, const QByteArray& line)
+{
+    QByteArray reply(execute(line));
+    sensordLogT() << "[ControlHandler]: " << line << " -> " << reply;
+    socketHandler_->controlReply(connection, reply);
+}
+
+QByteArray ControlHandler::execute(const QByteArray& line) const
+{
+    QList<QByteArray> words(line.simplified().split(' '));
+    if (words.size() < 2)
+        return "error usage: <object> <name> [argument ...]";
+
+    QObject* object = target(QString::fromUtf8(words.takeFirst()));
+    if (!object)
+        return "error no such object";
+    QByteArray name(words.takeFirst());
+    if (words.size() > MAX_ARGUMENTS)
+        return "error too many arguments";
+
+    // Methods of QObject itself, such as deleteLater(), are not offered
+    const QMetaObject* meta = object->metaObject();
+    for (int i = QObject::staticMetaObject.methodCount(); i < meta->methodCount(); ++i) {
+        QMetaMethod method(meta->method(i));
+        if (method.access() != QMetaMethod::Public ||
+            method.methodType() == QMetaMethod::Signal ||
+            method.name() != name ||
+            method.parameterCount() != words.size())
+            continue;
+
+        QVariant values[MAX_ARGUMENTS];
+        QGenericArgument args[MAX_ARGUMENTS];
+        for (int arg = 0; arg < words.size(); ++arg) {
+            int type = method.parameterType(arg);
+            values[arg] = QVariant(QString::fromUtf8(words.at(arg)));
+            if (!values[arg].convert(type))
+                return "error invalid argument " + words.at(arg);
+            args[arg] = QGenericArgument(QMetaType::typeName(type), values[arg].constData());
+        }
+
+        int returnType = method.returnType();
+        QVariant result;
+        bool ok;
+        if (returnType == QMetaType::Void) {
+            ok = method.invoke(object, Qt::DirectConnection,
+                               args[0], args[1], args[2], args[3], args[4],
+                               args[5], args[6], args[7], args[8], args[9]);
+        } else {
+            result = QVariant(returnType, (const void*)0);
+            ok = method.invoke(object, Qt::DirectConnection,
+                               QGenericReturnArgument(QMetaType::typeName(returnType), result.data()),
+                               args[0], args[1], args[2], args[3], args[4],
+                               args[5], args[6], args[7], args[8], args[9]);
+        }
+        if (!ok)
+            return "error call failed";
+
+        QByteArray text;
+        if (result.isValid() && !format(result, text))
+            return "error can not write " + QByteArray(result.typeName());
+        return text.isEmpty() ? QByteArray("ok") : "ok " + text;
+    }
+
+    int property = words.isEmpty() ? meta->indexOfProperty(name.constData()) : -1;
+    if (property < QObject::staticMetaObject.propertyCount())
+        return "error no such method";
+    QVariant value(meta->property(property).read(object));
+    QByteArray text;
+    if (!format(value, text))
+        return "error can not write " + QByteArray(value.typeName());
+    return text.isEmpty() ? QByteArray("ok") : "ok " + text;
+}
+
+QObject* ControlHandler::target(const QString& name) const
+{
+    SensorManager& sm = SensorManager::instance();
+    if (name == "manager")
+        return sm.findChild<SensorManagerAdaptor*>(QString(), Qt::FindDirectChildrenOnly);
+
+    const SensorInstanceEntry* entry = sm.getSensorInstance(name);
+    if (!entry || !entry->sensor_)
+        return 0;
+    return entry->sensor_->findChild<AbstractSensorChannelAdaptor*>(QString(), Qt::FindDirectChildrenOnly);
+}
+
+bool ControlHandler::format(const QVariant& value, QByteArray& text)
+{
+    int type = value.userType();
+    QStringList items;
+    if (type == qMetaTypeId<DataRange>()) {
+        const DataRange& range = *(const DataRange*)value.constData();
+        items << QString("%1,%2,%3").arg(range.min).arg(range.max).arg(range.resolution);
+    } else if (type == qMetaTypeId<DataRangeList>()) {
+        foreach (const DataRange& range, *(const DataRangeList*)value.constData())
+            items << QString("%1,%2,%3").arg(range.min).arg(range.max).arg(range.resolution);
+    } else if (type == qMetaTypeId<IntegerRangeList>()) {
+        foreach (const IntegerRange& range, *(const IntegerRangeList*)value.constData())
+            items << QString("%1,%2").arg(range.first).arg(range.second);
+    } else if (type == QMetaType::QStringList) {
+        items = value.toStringList();
+    } else if (value.canConvert<QString>()) {
+        items << value.toString();
+    } else {
+        return false;
+    }
+
+    // Reply is a single line
+    text = items.join(";").replace('\n', ' ').toUtf8();
+    return true;
+}
@@ -0,0 +1,103 @@
+/**
+   @file controlhandler.h
+   @brief Control requests received through the data socket
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef CONTROLHANDLER_H
+#define CONTROLHANDLER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QList>
+#include <QVariant>
+
+class SocketHandler;
+
+/**
+ * Runs requests of control connections, see ControlTransport. Each
+ * request is a line
+ *
+ *     <object> <name> [argument ...]
+ *
+ * where object is "manager" for SensorManagerAdaptor or the ID of an
+ * instantiated sensor for its AbstractSensorChannelAdaptor. Name is a
+ * slot of the adaptor, called with the whitespace separated arguments
+ * converted to its parameter types, or a property read when no
+ * arguments are given. So the control connection offers the methods of
+ * the D-Bus interface, without D-Bus.
+ *
+ * Each request gets one line as reply, either "ok" followed by the
+ * return value, or "error" followed by a description. Lists are
+ * separated with ';', data ranges are written as min,max,resolution.
+ *
+ * Handler runs in the main thread with the adaptors.
+ */
+class ControlHandler : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(ControlHandler)
+
+public:
+    /**
+     * Constructor.
+     *
+     * @param socketHandler socket handler receiving the requests.
+     * @param parent parent object.
+     */
+    ControlHandler(SocketHandler* socketHandler, QObject* parent = 0);
+
+public Q_SLOTS:
+    /**
+     * Run request and send the reply to the connection.
+     *
+     * @param connection control connection.
+     * @param line request without line feed.
+     */
+    void request(int connection, const QByteArray& line);
+
+private:
+    /**
+     * Run request.
+     *
+     * @param line request.
+     * @return reply without line feed.
+     */
+    QByteArray execute(const QByteArray& line) const;
+
+    /**
+     * Adaptor of request object.
+     *
+     * @param name "manager" or sensor ID.
+     * @return adaptor or NULL if not instantiated.
+     */
+    QObject* target(const QString& name) const;
+
+    /**
+     * Reply text of a value.
+     *
+     * @param value return value or property.
+     * @param text reply text.
+     * @return could the value be written.
+     */
+    static bool format(const QVariant& value, QByteArray& text);
+
+    SocketHandler* socketHandler_; /**< socket handler receiving the requests */
+};
+
+#endif // CONTROLHANDLER_H
@@ -25,6 +25,7 @@ equals(QT_MAJOR_VERSION, 5):{
 }
 
 SOURCES += sensormanager.cpp \
+    sessionstore.cpp \
     sensormanager_a.cpp \
     pusher.cpp \
     ringbuffer.cpp \
@@ -38,15 +39,42 @@ SOURCES += sensormanager.cpp \
     plugin.cpp \
     abstractsensor_a.cpp \
     abstractsensor.cpp \
+    historyring.cpp \
     parameterparser.cpp \
     abstractchain.cpp \
     sysfsadaptor.cpp \
+    thresholdwindow.cpp \
     sockethandler.cpp \
+    controlhandler.cpp \
     inputdevadaptor.cpp \
+    iioadaptor.cpp \
     config.cpp \
-    nodebase.cpp
+    nodebase.cpp \
+    nodearena.cpp \
+    samplequeue.cpp \
+    chainscheduler.cpp \
+    latencyhistogram.cpp \
+    latencytracer.cpp \
+    tracerecorder.cpp \
+    tracelog.cpp \
+    boosthints.cpp \
+    powertransition.cpp \
+    demand.cpp \
+    clock.cpp \
+    startuptrace.cpp \
+    dataflowgraph.cpp \
+    overloadcontroller.cpp \
+    devicediscovery.cpp \
+    uringreader.cpp \
+    timestampreconstructor.cpp \
+    lowlatency.cpp \
+    threadpolicy.cpp \
+    timerwheel.cpp \
+    clockdomain.cpp \
+    alloccounter.cpp
 
 HEADERS += sensormanager.h \
+    sessionstore.h \
     sensormanager_a.h \
     dataemitter.h \
     pusher.h \
@@ -58,21 +86,57 @@ HEADERS += sensormanager.h \
     sink.h \
     bin.h \
     filter.h \
+    xyzlanes.h \
+    changefilter.h \
+    staticchain.h \
     deviceadaptor.h \
     deviceadaptorringbuffer.h \
     bufferreader.h \
     loader.h \
     plugin.h \
     abstractsensor_a.h \
+    adaptorbase.h \
     abstractsensor.h \
+    historyring.h \
+    rangeconversion.h \
+    sessionthreshold.h \
     logging.h \
     parameterparser.h \
     abstractchain.h \
     sysfsadaptor.h \
+    thresholdwindow.h \
     sockethandler.h \
+    controlhandler.h \
     inputdevadaptor.h \
+    iioadaptor.h \
     config.h \
-    nodebase.h
+    nodebase.h \
+    nodearena.h \
+    samplequeue.h \
+    spscqueue.h \
+    chainscheduler.h \
+    latencyhistogram.h \
+    latencytracer.h \
+    tracerecorder.h \
+    tracelog.h \
+    boosthints.h \
+    powertransition.h \
+    demand.h \
+    clock.h \
+    startuptrace.h \
+    dataflowgraph.h \
+    overloadcontroller.h \
+    devicediscovery.h \
+    uringreader.h \
+    timestampreconstructor.h \
+    lowlatency.h \
+    threadpolicy.h \
+    timerwheel.h \
+    clockdomain.h \
+    downsamplewindow.h \
+    runningstatistics.h \
+    alloccounter.h \
+    probes.h
 
 mce {
     SOURCES += mcewatcher.cpp
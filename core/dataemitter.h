@@ -67,9 +67,7 @@ public:
     {
         unsigned n;
         while ((n = RingBufferReader<TYPE>::read(chunkSize_, chunk_))) {
-            for (unsigned i = 0; i < n; ++i) {
-                emitData(chunk_[i]);
-            }
+            emitData(chunk_, n);
         }
     }
 
@@ -79,6 +77,31 @@ protected:
      */
     virtual void emitData(const TYPE& value) = 0;
 
+    /**
+     * Callback for chunks of emitted objects. Default implementation
+     * calls emitData(const TYPE&) for each of them, emitters override it
+     * to handle a whole chunk at once.
+     *
+     * @param values objects.
+     * @param n number of objects.
+     */
+    virtual void emitData(const TYPE* values, unsigned n)
+    {
+        for (unsigned i = 0; i < n; ++i) {
+            emitData(values[i]);
+        }
+    }
+
+    /**
+     * Emit objects from pass-through buffer without copying.
+     */
+    bool pushDirect(unsigned n, const TYPE* values)
+    {
+        if (n)
+            emitData(values, n);
+        return true;
+    }
+
 private:
     unsigned     chunkSize_; /**< How many objects can be buffered */
     TYPE*        chunk_;     /**< Buffer */
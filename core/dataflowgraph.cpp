@@ -0,0 +1,250 @@
+/**
+   @file dataflowgraph.cpp
+   @brief Dataflow graph export with per-edge sample rates
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "dataflowgraph.h"
+#include "producer.h"
+#include "consumer.h"
+#include "source.h"
+#include "ringbuffer.h"
+#include <QStringList>
+#include <algorithm>
+
+/**
+ * Quote text for dot and JSON strings.
+ *
+ * @param text text.
+ * @return quoted text.
+ */
+static QString quoted(const QString& text)
+{
+    QString escaped(text);
+    escaped.replace('\\', "\\\\").replace('"', "\\\"");
+    return "\"" + escaped + "\"";
+}
+
+/**
+ * Order edges by key for stable output.
+ */
+struct EdgeOrder
+{
+    EdgeOrder(const QHash<const void*, int>& keys) : keys_(keys) {}
+
+    bool operator()(const DataflowGraph::Edge& a, const DataflowGraph::Edge& b) const
+    {
+        int fromA = keys_.value(a.from), fromB = keys_.value(b.from);
+        if (fromA != fromB)
+            return fromA < fromB;
+        int toA = keys_.value(a.to), toB = keys_.value(b.to);
+        if (toA != toB)
+            return toA < toB;
+        return a.source + a.sink < b.source + b.sink;
+    }
+
+    const QHash<const void*, int>& keys_;
+};
+
+void DataflowGraph::addNode(const void* node, const QString& name, const QString& kind)
+{
+    if (!node || names_.contains(node))
+        return;
+    names_.insert(node, name);
+    kinds_.insert(node, kind);
+    order_.append(node);
+}
+
+void DataflowGraph::addBuffer(const QString& name, const RingBufferBase* buffer)
+{
+    if (buffer)
+        addNode(dynamic_cast<const void*>(buffer), name, "buffer");
+}
+
+void DataflowGraph::addSources(const void* node, const Producer* producer)
+{
+    producers_.append(qMakePair(node, producer));
+}
+
+void DataflowGraph::addSinks(const void* node, const Consumer* consumer)
+{
+    const QHash<QString, SinkBase*>& sinks = consumer->sinks();
+    for (QHash<QString, SinkBase*>::const_iterator it = sinks.constBegin(); it != sinks.constEnd(); ++it)
+        sinks_.insert(it.value(), qMakePair(node, it.key()));
+}
+
+void DataflowGraph::addReader(const RingBufferReaderBase* reader)
+{
+    readers_.append(reader);
+}
+
+void DataflowGraph::build()
+{
+    edges_.clear();
+
+    for (int i = 0; i < producers_.size(); ++i) {
+        const QHash<QString, SourceBase*>& sources = producers_.at(i).second->sources();
+        for (QHash<QString, SourceBase*>::const_iterator it = sources.constBegin(); it != sources.constEnd(); ++it) {
+            QList<SourceConnection> connections;
+            it.value()->connections(connections);
+            foreach (const SourceConnection& connection, connections) {
+                Edge edge;
+                edge.from = producers_.at(i).first;
+                edge.source = it.key();
+                QPair<const void*, QString> sink(sinks_.value(connection.sink, qMakePair((const void*)connection.sink, QString("sink"))));
+                edge.to = sink.first;
+                edge.sink = sink.second;
+                edge.samples = connection.samples;
+                edge.batches = connection.batches;
+                edge.occupancy = -1;
+                edge.capacity = 0;
+                edge.lost = 0;
+                edge.rate = -1;
+                addNode(edge.to, QString(), "sink");
+                edges_.append(edge);
+            }
+        }
+    }
+
+    foreach (const RingBufferReaderBase* reader, readers_) {
+        const RingBufferBase* buffer = reader->joinedBuffer();
+        if (!buffer)
+            continue;
+        Edge edge;
+        edge.from = dynamic_cast<const void*>(buffer);
+        edge.to = dynamic_cast<const void*>(reader);
+        edge.samples = reader->consumed();
+        edge.batches = reader->runs();
+        edge.occupancy = reader->unread();
+        edge.capacity = buffer->capacity();
+        edge.lost = reader->lost();
+        edge.rate = -1;
+        addNode(edge.from, QString(), "buffer");
+        edges_.append(edge);
+    }
+
+    QHash<const void*, int> keys;
+    for (int i = 0; i < order_.size(); ++i)
+        keys.insert(order_.at(i), i);
+    std::stable_sort(edges_.begin(), edges_.end(), EdgeOrder(keys));
+}
+
+void DataflowGraph::measure(const QHash<QString, unsigned>& previous, quint64 elapsedUs)
+{
+    if (!elapsedUs)
+        return;
+    for (int i = 0; i < edges_.size(); ++i) {
+        QHash<QString, unsigned>::const_iterator it = previous.find(key(edges_.at(i)));
+        if (it == previous.constEnd())
+            continue;
+        // Counters wrap around, the difference does not
+        edges_[i].rate = (unsigned)(edges_.at(i).samples - it.value()) * 1000000.0 / elapsedUs;
+    }
+}
+
+QHash<QString, unsigned> DataflowGraph::samples() const
+{
+    QHash<QString, unsigned> samples;
+    foreach (const Edge& edge, edges_)
+        samples.insert(key(edge), edge.samples);
+    return samples;
+}
+
+const QList<DataflowGraph::Edge>& DataflowGraph::edges() const
+{
+    return edges_;
+}
+
+QString DataflowGraph::toDot() const
+{
+    QString dot("digraph sensord {\n");
+    for (int i = 0; i < order_.size(); ++i) {
+        QString kind(kinds_.value(order_.at(i)));
+        dot.append(QString("  n%1 [label=%2 shape=%3];\n").arg(i).arg(quoted(name(order_.at(i))))
+                   .arg(QString(kind == "buffer" ? "box" : kind == "reader" ? "cds" : "ellipse")));
+    }
+    QHash<const void*, int> ids;
+    for (int i = 0; i < order_.size(); ++i)
+        ids.insert(order_.at(i), i);
+    foreach (const Edge& edge, edges_) {
+        dot.append(QString("  n%1 -> n%2 [label=%3];\n").arg(ids.value(edge.from)).arg(ids.value(edge.to))
+                   .arg(quoted(label(edge))));
+    }
+    dot.append("}\n");
+    return dot;
+}
+
+QString DataflowGraph::toJson() const
+{
+    QStringList nodes;
+    QHash<const void*, int> ids;
+    for (int i = 0; i < order_.size(); ++i) {
+        ids.insert(order_.at(i), i);
+        nodes << QString("{\"id\":%1,\"name\":%2,\"kind\":%3}").arg(i)
+                 .arg(quoted(name(order_.at(i)))).arg(quoted(kinds_.value(order_.at(i))));
+    }
+    QStringList edges;
+    foreach (const Edge& edge, edges_) {
+        QString text = QString("{\"from\":%1,\"to\":%2,\"samples\":%3,\"batches\":%4")
+            .arg(ids.value(edge.from)).arg(ids.value(edge.to)).arg(edge.samples).arg(edge.batches);
+        if (!edge.source.isEmpty())
+            text.append(QString(",\"source\":%1,\"sink\":%2").arg(quoted(edge.source)).arg(quoted(edge.sink)));
+        if (edge.occupancy >= 0)
+            text.append(QString(",\"occupancy\":%1,\"capacity\":%2,\"lost\":%3")
+                        .arg(edge.occupancy).arg(edge.capacity).arg(edge.lost));
+        if (edge.rate >= 0)
+            text.append(QString(",\"rate\":%1").arg(edge.rate, 0, 'f', 1));
+        if (edge.batches)
+            text.append(QString(",\"batch\":%1").arg((double)edge.samples / edge.batches, 0, 'f', 1));
+        edges << text + "}";
+    }
+    return "{\"nodes\":[" + nodes.join(",") + "],\"edges\":[" + edges.join(",") + "]}";
+}
+
+QString DataflowGraph::name(const void* node) const
+{
+    QString name(names_.value(node));
+    if (name.isEmpty())
+        name = QString("%1@0x%2").arg(kinds_.value(node)).arg((quintptr)node, 0, 16);
+    return name;
+}
+
+QString DataflowGraph::key(const Edge& edge) const
+{
+    // Addresses tell apart nodes of the same name, e.g. of two bins
+    return QString("%1:%2/%3->%4:%5/%6").arg((quintptr)edge.from, 0, 16).arg(name(edge.from)).arg(edge.source)
+        .arg((quintptr)edge.to, 0, 16).arg(name(edge.to)).arg(edge.sink);
+}
+
+QString DataflowGraph::label(const Edge& edge)
+{
+    QStringList parts;
+    if (edge.rate >= 0)
+        parts << QString("%1/s").arg(edge.rate, 0, 'f', 1);
+    else
+        parts << QString("%1 samples").arg(edge.samples);
+    if (edge.batches)
+        parts << QString("batch %1").arg((double)edge.samples / edge.batches, 0, 'f', 1);
+    if (edge.occupancy >= 0)
+        parts << QString("ring %1/%2").arg(edge.occupancy).arg(edge.capacity);
+    if (edge.lost)
+        parts << QString("%1 lost").arg(edge.lost);
+    if (!edge.source.isEmpty() && (edge.source != "source" || edge.sink != "sink"))
+        parts << edge.source + ">" + edge.sink;
+    return parts.join(", ");
+}
@@ -0,0 +1,188 @@
+/**
+   @file dataflowgraph.h
+   @brief Dataflow graph export with per-edge sample rates
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef DATAFLOWGRAPH_H
+#define DATAFLOWGRAPH_H
+
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QString>
+
+class Producer;
+class Consumer;
+class SinkBase;
+class RingBufferBase;
+class RingBufferReaderBase;
+
+/**
+ * Snapshot of the dataflow graph: buffers, filters and readers of bins,
+ * with an edge for every Source to Sink join and every ring buffer
+ * reader. Edges carry the samples and batches propagated through them,
+ * and buffer reader edges the objects waiting in the ring.
+ *
+ * Nodes are keyed by the address of the most derived object, so a
+ * buffer named by its chain and added again by its bin is one node; the
+ * name given first is kept. Nodes only seen as the far end of an edge
+ * get a name from their address.
+ *
+ * Rates are measured against the samples of a previous snapshot, see
+ * #measure(). A snapshot is built and written in the main thread while
+ * the counters keep running, so counts of different edges are not
+ * taken at exactly the same moment.
+ */
+class DataflowGraph
+{
+public:
+    /**
+     * Edge of the graph.
+     */
+    struct Edge
+    {
+        const void* from;      /**< producing node */
+        QString     source;    /**< source name, empty for buffer reader edges */
+        const void* to;        /**< consuming node */
+        QString     sink;      /**< sink name, empty for buffer reader edges */
+        unsigned    samples;   /**< samples passed */
+        unsigned    batches;   /**< batches passed, reader wakeups for buffer readers */
+        int         occupancy; /**< unread objects of a buffer reader, -1 for joins */
+        unsigned    capacity;  /**< ring size of a buffer reader edge */
+        unsigned    lost;      /**< objects a buffer reader lost */
+        double      rate;      /**< samples per second, negative if not measured */
+    };
+
+    /**
+     * Add node. Name of an already added node is kept.
+     *
+     * @param node address of the most derived object.
+     * @param name node name.
+     * @param kind "buffer", "filter", "reader" or other node kind.
+     */
+    void addNode(const void* node, const QString& name, const QString& kind);
+
+    /**
+     * Add named ring buffer, e.g. output buffer of an adaptor or chain.
+     *
+     * @param name buffer name.
+     * @param buffer buffer.
+     */
+    void addBuffer(const QString& name, const RingBufferBase* buffer);
+
+    /**
+     * Add sources of a producer, their joins become edges.
+     *
+     * @param node address of the most derived object of the producer.
+     * @param producer producer.
+     */
+    void addSources(const void* node, const Producer* producer);
+
+    /**
+     * Add sinks of a consumer, so that joins to them are resolved.
+     *
+     * @param node address of the most derived object of the consumer.
+     * @param consumer consumer.
+     */
+    void addSinks(const void* node, const Consumer* consumer);
+
+    /**
+     * Add ring buffer reader, it becomes an edge from its buffer.
+     *
+     * @param reader reader.
+     */
+    void addReader(const RingBufferReaderBase* reader);
+
+    /**
+     * Resolve edges of the added nodes.
+     */
+    void build();
+
+    /**
+     * Measure edge rates against samples of a previous snapshot.
+     *
+     * @param previous samples of edges, see #samples().
+     * @param elapsedUs microseconds since the previous snapshot.
+     */
+    void measure(const QHash<QString, unsigned>& previous, quint64 elapsedUs);
+
+    /**
+     * Samples of edges for measuring the next snapshot.
+     *
+     * @return samples keyed by edge.
+     */
+    QHash<QString, unsigned> samples() const;
+
+    /**
+     * Edges of the graph after #build().
+     *
+     * @return edges ordered by node names.
+     */
+    const QList<Edge>& edges() const;
+
+    /**
+     * Graph in Graphviz format, edges labeled with rate, average batch
+     * size and ring occupancy.
+     *
+     * @return dot graph.
+     */
+    QString toDot() const;
+
+    /**
+     * Graph as JSON object with "nodes" and "edges" arrays.
+     *
+     * @return JSON text.
+     */
+    QString toJson() const;
+
+private:
+    /**
+     * Name of a node.
+     *
+     * @param node node address.
+     * @return node name.
+     */
+    QString name(const void* node) const;
+
+    /**
+     * Key of an edge, stable across snapshots.
+     *
+     * @param edge edge.
+     * @return edge key.
+     */
+    QString key(const Edge& edge) const;
+
+    /**
+     * Label of an edge in dot output.
+     *
+     * @param edge edge.
+     * @return label text.
+     */
+    static QString label(const Edge& edge);
+
+    QHash<const void*, QString>                       names_;     /**< node names */
+    QHash<const void*, QString>                       kinds_;     /**< node kinds */
+    QList<const void*>                                order_;     /**< nodes in order of adding */
+    QList<QPair<const void*, const Producer*> >       producers_; /**< producers and their nodes */
+    QList<const RingBufferReaderBase*>                readers_;   /**< buffer readers */
+    QHash<const SinkBase*, QPair<const void*, QString> > sinks_;  /**< node and name of sinks */
+    QList<Edge>                                       edges_;     /**< resolved edges */
+};
+
+#endif // DATAFLOWGRAPH_H
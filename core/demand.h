@@ -0,0 +1,114 @@
+/**
+   @file demand.h
+   @brief Demand of dataflow nodes
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+
+#ifndef DEMAND_H
+#define DEMAND_H
+
+#include <QAtomicInt>
+#include "datatypes/atomic.h"
+
+/**
+ * Node of the dataflow graph which knows whether anything downstream
+ * consumes its output. Readers are consumers while their Bin runs;
+ * buffers and filters are demanded when a demanded node is joined to
+ * them. Sources skip sinks without demand, so a chain whose sensors are
+ * all stopped does no work even while its adaptor keeps writing.
+ *
+ * Demand is evaluated lazily and cached until the graph changes: joins,
+ * unjoins and Bin::start()/stop() call #invalidate().
+ */
+class DemandNode
+{
+public:
+    /**
+     * Does anything downstream consume the output of the node.
+     *
+     * @return is the node demanded.
+     */
+    bool demanded() const
+    {
+        // Epoch and demand are kept in one atomic word, a node evaluated
+        // from several threads never pairs a stale demand with a new epoch
+        unsigned epoch = (unsigned)Atomic::loadAcquire(epoch_) & EPOCH_MASK;
+        unsigned cached = (unsigned)Atomic::loadAcquire(cached_);
+        if ((cached >> 1) != epoch) {
+            bool demand = computeDemand();
+            Atomic::storeRelease(cached_, (int)((epoch << 1) | (demand ? 1u : 0u)));
+            return demand;
+        }
+        return cached & 1;
+    }
+
+    /**
+     * Graph changed, demand of every node is evaluated again.
+     */
+    static void invalidate();
+
+protected:
+    /**
+     * Constructor.
+     */
+    DemandNode();
+
+    /**
+     * Destructor.
+     */
+    virtual ~DemandNode() {}
+
+    /**
+     * Evaluate demand of the node.
+     *
+     * @return is the node demanded.
+     */
+    virtual bool computeDemand() const = 0;
+
+private:
+    /** Bits of the graph version kept with the cached demand */
+    static const unsigned EPOCH_MASK = 0x7fffffff;
+
+    static QAtomicInt epoch_;   /**< graph version */
+    mutable QAtomicInt cached_; /**< graph version shifted left by one, or'ed with the demand it was evaluated to */
+};
+
+/**
+ * Demand of a sink implementor.
+ *
+ * @param node implementor taking part in demand tracking.
+ * @return is the node demanded.
+ */
+inline bool demandOf(const DemandNode* node)
+{
+    return node->demanded();
+}
+
+/**
+ * Demand of a sink implementor which does not track demand, such
+ * implementors are always demanded.
+ *
+ * @return true.
+ */
+inline bool demandOf(const void*)
+{
+    return true;
+}
+
+#endif // DEMAND_H
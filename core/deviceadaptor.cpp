@@ -28,7 +28,10 @@
  */
 
 #include "deviceadaptor.h"
+#include "deviceadaptorringbuffer.h"
 #include "sensormanager.h"
+#include "latencytracer.h"
+#include "config.h"
 
 AdaptedSensorEntry::AdaptedSensorEntry(const QString& name, const QString& description, RingBufferBase* buffer) :
     name_(name),
@@ -103,6 +106,27 @@ void DeviceAdaptor::setAdaptedSensor(const QString& name, const QString& descrip
 void DeviceAdaptor::setAdaptedSensor(const QString& name, AdaptedSensorEntry* newAdaptedSensor)
 {
     sensor_ = qMakePair(name, newAdaptedSensor);
+    if (newAdaptedSensor && newAdaptedSensor->buffer())
+        newAdaptedSensor->buffer()->setLatencyProbe(LatencyTracer::instance().probe(id() + "/" + name, LatencyTracer::AdaptorStage));
+}
+
+unsigned int DeviceAdaptor::ringSize(const QString& name, unsigned int minimum) const
+{
+    unsigned int size = Config::configuration()->value<unsigned int>(name + "/ring_size", 0);
+    if (size > 0)
+        return size;
+
+    // 0 is reserved for HW wakeup and does not bound the rate
+    double fastest = 0;
+    foreach (const DataRange& range, parseDataRangeList(Config::configuration()->value(name + "/intervals").toString(), 0)) {
+        if (range.min > 0 && (fastest == 0 || range.min < fastest))
+            fastest = range.min;
+    }
+
+    unsigned int latency = Config::configuration()->value<unsigned int>("global/ring_latency", 100);
+    if (fastest > 0)
+        size = (unsigned int)(latency / fastest + 0.5);
+    return qMax(size, minimum);
 }
 
 AdaptedSensorEntry* DeviceAdaptor::getAdaptedSensor() const
@@ -118,6 +142,22 @@ RingBufferBase* DeviceAdaptor::findBuffer(const QString& name) const
     return entry->buffer();
 }
 
+void DeviceAdaptor::beginBatch()
+{
+    AdaptedSensorEntry* entry = getAdaptedSensor();
+    DeviceAdaptorRingBufferBase* buffer = entry ? dynamic_cast<DeviceAdaptorRingBufferBase*>(entry->buffer()) : NULL;
+    if (buffer)
+        buffer->deferWakeups();
+}
+
+void DeviceAdaptor::endBatch()
+{
+    AdaptedSensorEntry* entry = getAdaptedSensor();
+    DeviceAdaptorRingBufferBase* buffer = entry ? dynamic_cast<DeviceAdaptorRingBufferBase*>(entry->buffer()) : NULL;
+    if (buffer)
+        buffer->flushWakeups();
+}
+
 bool DeviceAdaptor::setStandbyOverride(bool override)
 {
     standbyOverride_ = override;
@@ -165,3 +205,8 @@ bool DeviceAdaptor::resume()
 {
     return false;
 }
+
+bool DeviceAdaptor::concurrentPowerTransition() const
+{
+    return false;
+}
@@ -36,6 +36,7 @@
 #include <QPair>
 #include "logging.h"
 #include "nodebase.h"
+#include "latencyhistogram.h"
 
 class RingBufferBase;
 
@@ -198,19 +199,69 @@ public:
      */
     virtual bool resume();
 
+    /**
+     * May #standby() and #resume() run in a thread other than the thread
+     * of the adaptor, concurrently with other adaptors. See
+     * PowerTransition.
+     *
+     * @return false by default.
+     */
+    virtual bool concurrentPowerTransition() const;
+
+    /**
+     * Start a batch of samples. Reader wakeups of the adaptor output
+     * buffer are deferred until #endBatch(). Calls nest.
+     */
+    void beginBatch();
+
+    /**
+     * End a batch of samples and wake up readers once if samples were
+     * committed during the batch.
+     */
+    void endBatch();
+
+    /**
+     * How late the reader thread picked up samples of this adaptor,
+     * from the sample being due or stamped to reading it.
+     *
+     * @return read latency histogram.
+     */
+    const LatencyHistogram& readLatency() const { return readLatency_; }
+
     const QString& name() { return sensor_.first; }
 
 protected:
     void setAdaptedSensor(const QString& name, const QString& description, RingBufferBase* buffer);
 
+    /**
+     * Capacity for the ring buffer of an adapted sensor. Taken from
+     * <name>/ring_size if set. Otherwise the buffer holds
+     * global/ring_latency milliseconds of samples at the fastest interval
+     * in <name>/intervals, so that readers delayed by scheduling do not
+     * lose samples.
+     *
+     * @param name adapted sensor name, also the configuration group.
+     * @param minimum smallest capacity the adaptor works with.
+     * @return ring buffer capacity.
+     */
+    unsigned int ringSize(const QString& name, unsigned int minimum) const;
+
     const QPair<QString, AdaptedSensorEntry*>& sensor() const { return sensor_; }
 
+    /**
+     * Record read latency of a sample. Reader thread only.
+     *
+     * @param ns latency in nanoseconds.
+     */
+    void recordReadLatency(quint64 ns) { readLatency_.record(ns); }
+
 private:
     void setAdaptedSensor(const QString& name, AdaptedSensorEntry* newAdaptedSensor);
 
     QPair<QString, AdaptedSensorEntry*> sensor_;
     bool standbyOverride_;                        /**< standby override state */
     bool screenBlanked_;                          /**< is display blanked */
+    LatencyHistogram readLatency_;                /**< read latency of samples */
 };
 
 /**
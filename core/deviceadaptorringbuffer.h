@@ -29,12 +29,59 @@
 
 #include "ringbuffer.h"
 
+/**
+ * Type independent part of DeviceAdaptorRingBuffer controlling deferred
+ * reader wakeups.
+ */
+class DeviceAdaptorRingBufferBase
+{
+public:
+    virtual ~DeviceAdaptorRingBufferBase() {}
+
+    /**
+     * Start deferring reader wakeups. Calls nest.
+     */
+    void deferWakeups()
+    {
+        ++deferred_;
+    }
+
+    /**
+     * End deferring reader wakeups. When the outermost deferral ends,
+     * readers are woken up once if any wakeup was deferred.
+     */
+    void flushWakeups()
+    {
+        if (deferred_ > 0 && --deferred_ == 0 && pending_) {
+            pending_ = 0;
+            wakeUpNow();
+        }
+    }
+
+protected:
+    DeviceAdaptorRingBufferBase() : deferred_(0), pending_(0) {}
+
+    /**
+     * Wake up readers immediately.
+     */
+    virtual void wakeUpNow() = 0;
+
+    int      deferred_; /**< deferral nesting depth */
+    unsigned pending_;  /**< commits since readers were woken up */
+};
+
 /**
  * Ring buffer specialization for sensor adaptors.
+ *
+ * While wakeups are deferred (see DeviceAdaptor::beginBatch()), calls to
+ * #wakeUpReaders() are merged, so the filter chain runs once per batch
+ * of samples instead of once per sample. Readers are still woken up
+ * before uncommitted samples would overwrite unread ones.
+ *
  * @tparam TYPE data type in buffer.
  */
 template <class TYPE>
-class DeviceAdaptorRingBuffer : public RingBuffer<TYPE>
+class DeviceAdaptorRingBuffer : public RingBuffer<TYPE>, public DeviceAdaptorRingBufferBase
 {
 public:
     /**
@@ -48,7 +95,24 @@ public:
 
     using RingBuffer<TYPE>::nextSlot;
     using RingBuffer<TYPE>::commit;
-    using RingBuffer<TYPE>::wakeUpReaders;
+
+    /**
+     * Wake up connected buffer readers, or defer the wakeup to the end
+     * of the current batch.
+     */
+    void wakeUpReaders()
+    {
+        if (deferred_ && ++pending_ < RingBuffer<TYPE>::capacity())
+            return;
+        pending_ = 0;
+        RingBuffer<TYPE>::wakeUpReaders();
+    }
+
+protected:
+    void wakeUpNow()
+    {
+        RingBuffer<TYPE>::wakeUpReaders();
+    }
 };
 
 #endif
@@ -0,0 +1,276 @@
+/**
+   @file devicediscovery.cpp
+   @brief Index of input and IIO devices kept up to date on hotplug
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "devicediscovery.h"
+#include "config.h"
+#include "logging.h"
+#include <QDir>
+#include <QFile>
+#include <QSocketNotifier>
+#include <QStringList>
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <unistd.h>
+
+/** Largest uevent message, see UEVENT_BUFFER_SIZE of the kernel */
+static const int UEVENT_BUFFER_SIZE = 2048;
+
+/** Netlink multicast group of kernel uevents */
+static const unsigned int KERNEL_UEVENT_GROUP = 1;
+
+Q_GLOBAL_STATIC(DeviceDiscovery, deviceDiscovery)
+
+/**
+ * Device of a DEVNAME property: "input/eventN" or "iio:deviceN".
+ *
+ * @param devName DEVNAME of the uevent.
+ * @param subsystem subsystem of the device.
+ * @param entry sysfs entry.
+ * @param number device number.
+ * @return is the device one of the indexed ones.
+ */
+static bool parseDevName(const QString& devName, DiscoveredDevice::Subsystem& subsystem, QString& entry, int& number)
+{
+    static const QString INPUT_PREFIX("input/event");
+    static const QString IIO_PREFIX("iio:device");
+    bool ok = false;
+    if (devName.startsWith(INPUT_PREFIX)) {
+        subsystem = DiscoveredDevice::Input;
+        entry = devName.mid(devName.indexOf('/') + 1);
+        number = devName.mid(INPUT_PREFIX.size()).toInt(&ok);
+    } else if (devName.startsWith(IIO_PREFIX)) {
+        subsystem = DiscoveredDevice::Iio;
+        entry = devName;
+        number = devName.mid(IIO_PREFIX.size()).toInt(&ok);
+    }
+    return ok;
+}
+
+DeviceDiscovery& DeviceDiscovery::instance()
+{
+    static bool watching = deviceDiscovery()->watch();
+    Q_UNUSED(watching);
+    return *deviceDiscovery();
+}
+
+bool DeviceDiscovery::enabled()
+{
+    return !Config::configuration() || Config::configuration()->value<bool>("global/device_discovery", true);
+}
+
+DeviceDiscovery::DeviceDiscovery(const QString& inputRoot, const QString& iioRoot, QObject* parent) :
+    QObject(parent),
+    inputRoot_(inputRoot),
+    iioRoot_(iioRoot),
+    fd_(-1),
+    notifier_(0)
+{
+    qRegisterMetaType<DiscoveredDevice>("DiscoveredDevice");
+    scan();
+}
+
+DeviceDiscovery::~DeviceDiscovery()
+{
+    delete notifier_;
+    if (fd_ >= 0)
+        close(fd_);
+}
+
+bool DeviceDiscovery::watch()
+{
+    if (fd_ >= 0)
+        return true;
+
+    fd_ = socket(AF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT);
+    if (fd_ < 0) {
+        sensordLogW() << "[DeviceDiscovery]: Can not create uevent socket: " << strerror(errno);
+        return false;
+    }
+    struct sockaddr_nl address;
+    memset(&address, 0, sizeof(address));
+    address.nl_family = AF_NETLINK;
+    address.nl_groups = KERNEL_UEVENT_GROUP;
+    if (bind(fd_, (struct sockaddr*)&address, sizeof(address)) < 0) {
+        sensordLogW() << "[DeviceDiscovery]: Can not bind uevent socket: " << strerror(errno);
+        close(fd_);
+        fd_ = -1;
+        return false;
+    }
+
+    notifier_ = new QSocketNotifier(fd_, QSocketNotifier::Read, this);
+    connect(notifier_, SIGNAL(activated(int)), this, SLOT(receive()));
+    return true;
+}
+
+QList<DiscoveredDevice> DeviceDiscovery::find(DiscoveredDevice::Subsystem subsystem, const QString& match) const
+{
+    QList<DiscoveredDevice> devices;
+    QMap<quint64, DiscoveredDevice>::const_iterator it = devices_.lowerBound(key(subsystem, 0));
+    for (; it != devices_.constEnd() && it.value().subsystem == subsystem; ++it) {
+        if (it.value().name.contains(match, Qt::CaseInsensitive))
+            devices.append(it.value());
+    }
+    return devices;
+}
+
+int DeviceDiscovery::count() const
+{
+    return devices_.size();
+}
+
+void DeviceDiscovery::handleUevent(const QByteArray& message)
+{
+    QList<QByteArray> fields(message.split('\0'));
+    QByteArray action;
+    QString devName;
+    foreach (const QByteArray& field, fields) {
+        if (field.startsWith("ACTION="))
+            action = field.mid(7);
+        else if (field.startsWith("DEVNAME="))
+            devName = QString::fromLocal8Bit(field.mid(8));
+    }
+
+    DiscoveredDevice::Subsystem subsystem;
+    QString entry;
+    int number;
+    if (devName.isEmpty() || !parseDevName(devName, subsystem, entry, number))
+        return;
+
+    quint64 index = key(subsystem, number);
+    if (action == "add") {
+        DiscoveredDevice device;
+        if (!read(subsystem, entry, device))
+            return;
+        devices_.insert(index, device);
+        sensordLogD() << "[DeviceDiscovery]: Attached " << device.node << " \"" << device.name << "\"";
+        emit deviceAdded(device);
+    } else if (action == "remove") {
+        QMap<quint64, DiscoveredDevice>::iterator it = devices_.find(index);
+        if (it == devices_.end())
+            return;
+        DiscoveredDevice device(it.value());
+        devices_.erase(it);
+        sensordLogD() << "[DeviceDiscovery]: Detached " << device.node << " \"" << device.name << "\"";
+        emit deviceRemoved(device);
+    }
+}
+
+void DeviceDiscovery::receive()
+{
+    char buffer[UEVENT_BUFFER_SIZE];
+    for (;;) {
+        struct sockaddr_nl sender;
+        socklen_t length = sizeof(sender);
+        ssize_t size = recvfrom(fd_, buffer, sizeof(buffer), 0, (struct sockaddr*)&sender, &length);
+        if (size < 0) {
+            if (errno == ENOBUFS) {
+                // Events were lost, the index is rebuilt from sysfs and
+                // the difference reported
+                sensordLogW() << "[DeviceDiscovery]: Uevents lost, rescanning";
+                QMap<quint64, DiscoveredDevice> previous(devices_);
+                scan();
+                foreach (quint64 index, previous.keys()) {
+                    if (!devices_.contains(index))
+                        emit deviceRemoved(previous.value(index));
+                }
+                foreach (quint64 index, devices_.keys()) {
+                    if (!previous.contains(index))
+                        emit deviceAdded(devices_.value(index));
+                }
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                sensordLogW() << "[DeviceDiscovery]: Can not read uevent: " << strerror(errno);
+            return;
+        }
+        // Only the kernel is trusted
+        if (length != sizeof(sender) || sender.nl_pid != 0)
+            continue;
+        handleUevent(QByteArray(buffer, size));
+    }
+}
+
+void DeviceDiscovery::scan()
+{
+    devices_.clear();
+
+    QDir input(inputRoot_);
+    foreach (const QString& entry, input.entryList(QStringList("event*"), QDir::Dirs)) {
+        DiscoveredDevice device;
+        if (read(DiscoveredDevice::Input, entry, device))
+            devices_.insert(key(device.subsystem, device.number), device);
+    }
+    QDir iio(iioRoot_);
+    foreach (const QString& entry, iio.entryList(QStringList("iio:device*"), QDir::Dirs)) {
+        DiscoveredDevice device;
+        if (read(DiscoveredDevice::Iio, entry, device))
+            devices_.insert(key(device.subsystem, device.number), device);
+    }
+}
+
+bool DeviceDiscovery::read(DiscoveredDevice::Subsystem subsystem, const QString& entry, DiscoveredDevice& device) const
+{
+    QString devName(subsystem == DiscoveredDevice::Input ? "input/" + entry : entry);
+    DiscoveredDevice::Subsystem parsed;
+    QString parsedEntry;
+    if (!parseDevName(devName, parsed, parsedEntry, device.number) || parsed != subsystem)
+        return false;
+
+    device.subsystem = subsystem;
+    device.entry = entry;
+    device.node = "/dev/" + devName;
+
+    // Name and capabilities of an event node belong to its input device
+    QString base(subsystem == DiscoveredDevice::Input ? inputRoot_ + "/" + entry + "/device" : iioRoot_ + "/" + entry);
+    QFile name(base + "/name");
+    if (!name.open(QIODevice::ReadOnly))
+        return false;
+    device.name = QString::fromLocal8Bit(name.readAll()).trimmed();
+    if (subsystem == DiscoveredDevice::Input) {
+        QFile ev(base + "/capabilities/ev");
+        if (ev.open(QIODevice::ReadOnly))
+            device.eventTypes = parseBitmap(ev.readAll());
+        QFile abs(base + "/capabilities/abs");
+        if (abs.open(QIODevice::ReadOnly))
+            device.absAxes = parseBitmap(abs.readAll());
+    }
+    return true;
+}
+
+quint64 DeviceDiscovery::parseBitmap(const QByteArray& text)
+{
+    // Words are kernel longs, written without leading zeros
+    QList<QByteArray> words(text.trimmed().split(' '));
+    quint64 bits = 0;
+    unsigned int shift = 0;
+    for (int i = words.size() - 1; i >= 0 && shift < 64; --i) {
+        bits |= words.at(i).toULongLong(0, 16) << shift;
+        shift += 8 * sizeof(long);
+    }
+    return bits;
+}
+
+quint64 DeviceDiscovery::key(DiscoveredDevice::Subsystem subsystem, int number)
+{
+    return ((quint64)subsystem << 32) | (quint32)number;
+}
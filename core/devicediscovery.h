@@ -0,0 +1,217 @@
+/**
+   @file devicediscovery.h
+   @brief Index of input and IIO devices kept up to date on hotplug
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef DEVICEDISCOVERY_H
+#define DEVICEDISCOVERY_H
+
+#include <QObject>
+#include <QString>
+#include <QList>
+#include <QMap>
+#include <QMetaType>
+
+class QSocketNotifier;
+
+/**
+ * Device known to DeviceDiscovery.
+ */
+struct DiscoveredDevice
+{
+    /**
+     * Kernel subsystem of a device.
+     */
+    enum Subsystem
+    {
+        Input = 0, /**< evdev node, /dev/input/eventN */
+        Iio        /**< IIO device, /dev/iio:deviceN */
+    };
+
+    DiscoveredDevice() : subsystem(Input), number(-1), eventTypes(0), absAxes(0) {}
+
+    /**
+     * Does the device report events of a type.
+     *
+     * @param type event type, such as EV_ABS.
+     * @return is the type reported.
+     */
+    bool hasEvent(int type) const { return type >= 0 && type < 32 && (eventTypes & (1U << type)); }
+
+    /**
+     * Does the device report an absolute axis.
+     *
+     * @param code axis code, such as ABS_X.
+     * @return is the axis reported.
+     */
+    bool hasAbs(int code) const { return code >= 0 && code < 64 && (absAxes & (1ULL << code)); }
+
+    Subsystem subsystem;  /**< subsystem of the device */
+    QString   entry;      /**< sysfs entry, such as "event3" or "iio:device0" */
+    int       number;     /**< N of eventN or iio:deviceN */
+    QString   node;       /**< device node */
+    QString   name;       /**< name reported by the driver */
+    quint32   eventTypes; /**< EV_* bits of an input device */
+    quint64   absAxes;    /**< ABS_* bits of an input device */
+};
+
+/**
+ * Index of input and IIO devices by name and capabilities. Sysfs is
+ * scanned once when the index is created; afterwards kernel uevents
+ * received over netlink add and remove devices, so adaptors look devices
+ * up from the index instead of opening every event node, and devices
+ * attached after boot, such as docks or USB sensor hubs, are found when
+ * their sensor is next requested.
+ *
+ * The index lives in the main thread. Lookups are disabled with
+ * global/device_discovery = false, adaptors then probe device nodes
+ * themselves.
+ */
+class DeviceDiscovery : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(DeviceDiscovery)
+
+public:
+    /**
+     * Index of the system, scanned and watched on first use.
+     *
+     * @return device index.
+     */
+    static DeviceDiscovery& instance();
+
+    /**
+     * Should adaptors look devices up from the index.
+     *
+     * @return is global/device_discovery set.
+     */
+    static bool enabled();
+
+    /**
+     * Constructor. Scans the sysfs roots, does not watch uevents.
+     *
+     * @param inputRoot directory of input class devices.
+     * @param iioRoot directory of IIO bus devices.
+     * @param parent parent object.
+     */
+    DeviceDiscovery(const QString& inputRoot = "/sys/class/input",
+                    const QString& iioRoot = "/sys/bus/iio/devices",
+                    QObject* parent = 0);
+
+    /**
+     * Destructor.
+     */
+    ~DeviceDiscovery();
+
+    /**
+     * Start receiving kernel uevents.
+     *
+     * @return is the netlink socket open.
+     */
+    bool watch();
+
+    /**
+     * Devices of a subsystem whose name contains given string, in
+     * ascending device number.
+     *
+     * @param subsystem subsystem of the devices.
+     * @param match string matched case insensitively, empty for all.
+     * @return matching devices.
+     */
+    QList<DiscoveredDevice> find(DiscoveredDevice::Subsystem subsystem, const QString& match) const;
+
+    /**
+     * Number of indexed devices.
+     *
+     * @return device count.
+     */
+    int count() const;
+
+    /**
+     * Apply one uevent message: "ACTION@DEVPATH" followed by
+     * NUL separated KEY=VALUE properties.
+     *
+     * @param message uevent message.
+     */
+    void handleUevent(const QByteArray& message);
+
+Q_SIGNALS:
+    /**
+     * Device was attached.
+     *
+     * @param device the new device.
+     */
+    void deviceAdded(const DiscoveredDevice& device);
+
+    /**
+     * Device was detached.
+     *
+     * @param device the removed device.
+     */
+    void deviceRemoved(const DiscoveredDevice& device);
+
+private Q_SLOTS:
+    /**
+     * Read pending uevents from the netlink socket.
+     */
+    void receive();
+
+private:
+    /**
+     * Index devices present in sysfs.
+     */
+    void scan();
+
+    /**
+     * Read device from sysfs.
+     *
+     * @param subsystem subsystem of the device.
+     * @param entry sysfs entry.
+     * @param device read device.
+     * @return is the entry a device of the subsystem.
+     */
+    bool read(DiscoveredDevice::Subsystem subsystem, const QString& entry, DiscoveredDevice& device) const;
+
+    /**
+     * Parse a sysfs capability bitmap: hex words, most significant first.
+     *
+     * @param text bitmap text.
+     * @return lowest 64 bits.
+     */
+    static quint64 parseBitmap(const QByteArray& text);
+
+    /**
+     * Index key of a device, ordering devices by subsystem and number.
+     *
+     * @param subsystem subsystem of the device.
+     * @param number device number.
+     * @return key.
+     */
+    static quint64 key(DiscoveredDevice::Subsystem subsystem, int number);
+
+    QString                         inputRoot_; /**< directory of input class devices */
+    QString                         iioRoot_;   /**< directory of IIO bus devices */
+    QMap<quint64, DiscoveredDevice> devices_;   /**< devices by #key() */
+    int                             fd_;        /**< netlink socket or -1 */
+    QSocketNotifier*                notifier_;  /**< notifier of the socket */
+};
+
+Q_DECLARE_METATYPE(DiscoveredDevice)
+
+#endif // DEVICEDISCOVERY_H
@@ -0,0 +1,184 @@
+/**
+   @file downsamplewindow.h
+   @brief DownsampleWindow
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef DOWNSAMPLEWINDOW_H
+#define DOWNSAMPLEWINDOW_H
+
+#include <QtGlobal>
+#include <QVector>
+#include <limits.h>
+
+/**
+ * Length of the window averaging channel samples down to the interval of
+ * a session. Sessions at or below the channel interval, and sessions of a
+ * channel with no interval, get a window of one sample, which passes
+ * samples unchanged.
+ *
+ * @param sessionInterval interval requested by the session.
+ * @param channelInterval current interval of the channel.
+ * @return window length in samples, 1 to INT_MAX.
+ */
+inline int downsampleLength(unsigned int sessionInterval, unsigned int channelInterval)
+{
+    if (!channelInterval || sessionInterval < channelInterval)
+        return 1;
+    return qMin(sessionInterval / channelInterval, (unsigned int)INT_MAX);
+}
+
+/**
+ * Fixed capacity circular window of samples with running sums. Pushing,
+ * expiring and averaging are O(1) per sample and no allocations are done
+ * unless capacity changes.
+ *
+ * @tparam FIELDS number of averaged fields per sample.
+ */
+template <int FIELDS>
+class DownsampleWindow
+{
+public:
+    /**
+     * Constructor.
+     */
+    DownsampleWindow() : head_(0), count_(0)
+    {
+        clear();
+    }
+
+    /**
+     * Set window capacity. Changing capacity empties the window.
+     *
+     * @param capacity max number of samples in the window.
+     */
+    void setCapacity(int capacity)
+    {
+        if (capacity < 1)
+            capacity = 1;
+        if (capacity == entries_.size())
+            return;
+        entries_.resize(capacity);
+        clear();
+    }
+
+    /**
+     * Get window capacity.
+     *
+     * @return max number of samples in the window.
+     */
+    int capacity() const { return entries_.size(); }
+
+    /**
+     * Bytes of sample storage held by the window.
+     *
+     * @return storage size in bytes.
+     */
+    int memoryUsage() const { return entries_.capacity() * sizeof(Entry); }
+
+    /**
+     * Number of samples in the window.
+     *
+     * @return sample count.
+     */
+    int count() const { return count_; }
+
+    /**
+     * Add sample to the window. Oldest sample is evicted if window is full.
+     *
+     * @param timestamp sample timestamp.
+     * @param values FIELDS values of the sample.
+     */
+    void push(quint64 timestamp, const long* values)
+    {
+        if (entries_.isEmpty())
+            setCapacity(1);
+        if (count_ == entries_.size())
+            evict();
+        Entry& entry = entries_[(head_ + count_) % entries_.size()];
+        entry.timestamp = timestamp;
+        for (int i = 0; i < FIELDS; ++i) {
+            entry.values[i] = values[i];
+            sums_[i] += values[i];
+        }
+        ++count_;
+    }
+
+    /**
+     * Evict samples older than given age.
+     *
+     * @param now current timestamp.
+     * @param maxAge max sample age.
+     */
+    void expire(quint64 now, quint64 maxAge)
+    {
+        while (count_ && now - entries_[head_].timestamp > maxAge)
+            evict();
+    }
+
+    /**
+     * Average of a field over samples in the window.
+     *
+     * @param field field index.
+     * @return average, 0 if window is empty.
+     */
+    long average(int field) const
+    {
+        return count_ ? sums_[field] / count_ : 0;
+    }
+
+    /**
+     * Empty the window.
+     */
+    void clear()
+    {
+        head_ = 0;
+        count_ = 0;
+        for (int i = 0; i < FIELDS; ++i)
+            sums_[i] = 0;
+    }
+
+private:
+    /**
+     * Remove oldest sample.
+     */
+    void evict()
+    {
+        const Entry& entry = entries_[head_];
+        for (int i = 0; i < FIELDS; ++i)
+            sums_[i] -= entry.values[i];
+        head_ = (head_ + 1) % entries_.size();
+        --count_;
+    }
+
+    /**
+     * Sample in the window.
+     */
+    struct Entry
+    {
+        quint64 timestamp;      /**< sample timestamp */
+        long    values[FIELDS]; /**< sample values */
+    };
+
+    QVector<Entry> entries_;      /**< circular sample storage */
+    int            head_;         /**< index of oldest sample */
+    int            count_;        /**< number of samples */
+    long           sums_[FIELDS]; /**< running sums of values */
+};
+
+#endif // DOWNSAMPLEWINDOW_H
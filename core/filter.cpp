@@ -30,3 +30,13 @@
 FilterBase::FilterBase()
 {
 }
+
+void FilterBase::reconfigure(const QStringList& keys)
+{
+    Q_UNUSED(keys);
+}
+
+bool FilterBase::computeDemand() const
+{
+    return sourcesDemanded();
+}
@@ -31,17 +31,67 @@
 #include "producer.h"
 #include "sink.h"
 #include "source.h"
+#include "nodearena.h"
+#include "demand.h"
+#include <QVarLengthArray>
+#include <QStringList>
+
+/**
+ * How many samples filters and the readers feeding them are expected to
+ * handle with a single call. Output batches up to this size are built
+ * without heap allocation.
+ */
+static const unsigned FILTER_BATCH_SIZE = 32;
+
+/**
+ * Output batch for filters. Filters process all samples they receive in
+ * one call and propagate the results as a single batch.
+ *
+ * @tparam TYPE output data type.
+ */
+template <class TYPE>
+class FilterBatch : public QVarLengthArray<TYPE, FILTER_BATCH_SIZE>
+{
+public:
+    /**
+     * Propagate collected samples, if any, to sinks of the source.
+     *
+     * @param source source to propagate to.
+     */
+    void propagate(Source<TYPE>& source) const
+    {
+        if (this->size())
+            source.propagate(this->size(), this->constData());
+    }
+};
 
 /**
  * Filter base class.
  */
-class FilterBase : public Consumer, public Producer
+class FilterBase : public Consumer, public Producer, public ArenaNode, public DemandNode
 {
+public:
+    /**
+     * Re-read configuration after Config::reloadConfig(). Called from the
+     * main thread by the node owning the filter. Default implementation
+     * does nothing.
+     *
+     * @param keys changed configuration keys.
+     */
+    virtual void reconfigure(const QStringList& keys);
+
 protected:
     /**
      * Default constructor.
      */
     FilterBase();
+
+    /**
+     * Filter is demanded when output of any of its sources is.
+     *
+     * @return is the filter demanded.
+     */
+    bool computeDemand() const;
 };
 
 /**
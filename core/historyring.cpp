@@ -0,0 +1,107 @@
+/**
+   @file historyring.cpp
+   @brief Recent output samples of a sensor channel
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "historyring.h"
+#include "lowlatency.h"
+#include "logging.h"
+#include <QMutexLocker>
+#include <string.h>
+
+HistoryRing::HistoryRing(unsigned int capacity) :
+    capacity_(1),
+    size_(0),
+    written_(0)
+{
+    // Power of two keeps slots continuous when the write count wraps
+    while (capacity_ < capacity)
+        capacity_ <<= 1;
+}
+
+void HistoryRing::write(const void* source, int size, unsigned int n)
+{
+    if (!n || size < (int)sizeof(quint64))
+        return;
+
+    QMutexLocker locker(&mutex_);
+    if (size != size_) {
+        if (size_)
+            sensordLogW() << "History sample size changed from " << size_ << " to " << size << ", history dropped";
+        storage_.resize(capacity_ * size);
+        LowLatency::prefault(storage_.data(), storage_.size());
+        size_ = size;
+        written_ = 0;
+    }
+
+    // Only the newest samples of a long batch survive
+    const char* from = (const char*)source;
+    if (n > capacity_) {
+        from += (n - capacity_) * size;
+        written_ += n - capacity_;
+        n = capacity_;
+    }
+    unsigned int slot = written_ % capacity_;
+    unsigned int head = qMin(n, capacity_ - slot);
+    memcpy(storage_.data() + slot * size, from, head * size);
+    memcpy(storage_.data(), from + head * size, (n - head) * size);
+    written_ += n;
+}
+
+void HistoryRing::clear()
+{
+    QMutexLocker locker(&mutex_);
+    written_ = 0;
+}
+
+unsigned int HistoryRing::window(quint64 since, QByteArray& samples, int& size) const
+{
+    QMutexLocker locker(&mutex_);
+    size = size_;
+    unsigned int stored = qMin(written_, capacity_);
+
+    // Timestamps grow, so the window is the newest run at or after since
+    unsigned int n = 0;
+    while (n < stored && timestamp(written_ - n - 1) >= since)
+        ++n;
+
+    samples.resize(n * size_);
+    copy(written_ - n, n, samples.data());
+    return n;
+}
+
+unsigned int HistoryRing::capacity() const
+{
+    return capacity_;
+}
+
+quint64 HistoryRing::timestamp(unsigned int index) const
+{
+    quint64 value;
+    memcpy(&value, storage_.constData() + (index % capacity_) * size_, sizeof(value));
+    return value;
+}
+
+void HistoryRing::copy(unsigned int first, unsigned int n, char* target) const
+{
+    unsigned int slot = first % capacity_;
+    unsigned int head = qMin(n, capacity_ - slot);
+    memcpy(target, storage_.constData() + slot * size_, head * size_);
+    memcpy(target + head * size_, storage_.constData(), (n - head) * size_);
+}
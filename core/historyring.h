@@ -0,0 +1,106 @@
+/**
+   @file historyring.h
+   @brief Recent output samples of a sensor channel
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef HISTORYRING_H
+#define HISTORYRING_H
+
+#include <QByteArray>
+#include <QMutex>
+
+/**
+ * Keeps the latest output samples of a channel in a fixed size ring, so
+ * that a client woken up by a trigger can fetch the samples leading up
+ * to it instead of streaming all the time. Samples are kept as
+ * serialized, starting with their quint64 timestamp.
+ *
+ * The ring is written by the thread running the channel and read by the
+ * main thread. Storage is allocated once, when the first sample shows
+ * its size.
+ */
+class HistoryRing
+{
+public:
+    /**
+     * Constructor.
+     *
+     * @param capacity most samples kept, rounded up to a power of two.
+     */
+    HistoryRing(unsigned int capacity);
+
+    /**
+     * Add samples, overwriting the oldest ones when the ring is full.
+     *
+     * @param source contiguous samples.
+     * @param size size of single sample in bytes.
+     * @param n sample count.
+     */
+    void write(const void* source, int size, unsigned int n);
+
+    /**
+     * Drop all samples. Storage is kept.
+     */
+    void clear();
+
+    /**
+     * Copy samples timestamped at or after given time, oldest first.
+     *
+     * @param since oldest timestamp taken, monotonic microseconds.
+     * @param samples Set to the samples.
+     * @param size Set to the size of single sample in bytes.
+     * @return sample count.
+     */
+    unsigned int window(quint64 since, QByteArray& samples, int& size) const;
+
+    /**
+     * Most samples kept.
+     *
+     * @return capacity in samples.
+     */
+    unsigned int capacity() const;
+
+private:
+    Q_DISABLE_COPY(HistoryRing)
+
+    /**
+     * Timestamp of a stored sample.
+     *
+     * @param index sample index counted from the first write.
+     * @return timestamp in microseconds.
+     */
+    quint64 timestamp(unsigned int index) const;
+
+    /**
+     * Copy stored samples into contiguous memory, unwrapping the ring.
+     *
+     * @param first index of the first sample counted from the first write.
+     * @param n sample count.
+     * @param target location to copy to.
+     */
+    void copy(unsigned int first, unsigned int n, char* target) const;
+
+    mutable QMutex  mutex_;     /**< guards the members below */
+    QByteArray      storage_;   /**< sample slots, allocated on the first write */
+    unsigned int    capacity_;  /**< most samples kept, a power of two */
+    int             size_;      /**< sample size in bytes, 0 before the first write */
+    unsigned int    written_;   /**< samples written since the last clear */
+};
+
+#endif // HISTORYRING_H
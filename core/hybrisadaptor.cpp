@@ -20,10 +20,25 @@
 
 #include "hybrisadaptor.h"
 #include "deviceadaptor.h"
+#include "config.h"
+#include "clock.h"
+#include "startuptrace.h"
 
 #include <QDebug>
 #include <QCoreApplication>
 #include <QTimer>
+#include <QSocketNotifier>
+#include <QStringList>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
 
 #include <hardware/hardware.h>
 #include <hardware/sensors.h>
@@ -67,13 +82,20 @@
 #ifndef SENSOR_TYPE_AMBIENT_TEMPERATURE
 #define SENSOR_TYPE_AMBIENT_TEMPERATURE (13)
 #endif
+#ifndef ASHMEM_SET_SIZE
+#define ASHMEM_SET_SIZE _IOW(0x77, 3, size_t)
+#endif
 //#define SENSOR_TYPE_MAGNETIC_FIELD_UNCALIBRATED (14)
-//#define SENSOR_TYPE_GAME_ROTATION_VECTOR (15)
+#ifndef SENSOR_TYPE_GAME_ROTATION_VECTOR
+#define SENSOR_TYPE_GAME_ROTATION_VECTOR (15)
+#endif
 //#define SENSOR_TYPE_GYROSCOPE_UNCALIBRATED (16)
 //#define SENSOR_TYPE_SIGNIFICANT_MOTION (17)
 //#define SENSOR_TYPE_STEP_DETECTOR (18)
 //#define SENSOR_TYPE_STEP_COUNTER (19)
-//#define SENSOR_TYPE_GEOMAGNETIC_ROTATION_VECTOR (20)
+#ifndef SENSOR_TYPE_GEOMAGNETIC_ROTATION_VECTOR
+#define SENSOR_TYPE_GEOMAGNETIC_ROTATION_VECTOR (20)
+#endif
 
 static QHash<QString,int> HybrisAdaptor_sensorTypes()
 {
@@ -88,11 +110,26 @@ static QHash<QString,int> HybrisAdaptor_sensorTypes()
     types["proximity"] = SENSOR_TYPE_PROXIMITY;
     types["gravity"] = SENSOR_TYPE_GRAVITY;
     types["lacceration"] = SENSOR_TYPE_LINEAR_ACCELERATION;
+    types["rotationvector"] = SENSOR_TYPE_ROTATION_VECTOR;
+    types["gamerotationvector"] = SENSOR_TYPE_GAME_ROTATION_VECTOR;
+    types["geomagneticrotationvector"] = SENSOR_TYPE_GEOMAGNETIC_ROTATION_VECTOR;
     return types;
 }
 
 Q_GLOBAL_STATIC(HybrisManager, hybrisManager)
 
+/** How many HAL events can wait for dispatching in the manager thread */
+static const unsigned int HYBRIS_EVENT_QUEUE_SIZE = 512;
+
+/** Default number of events read per HAL poll, see global/hybris_poll_batch */
+static const int DEFAULT_POLL_BATCH = 64;
+
+/** Default events held by the direct report channel, see global/hybris_direct_report_events */
+static const int DEFAULT_DIRECT_REPORT_EVENTS = 512;
+
+/** Default milliseconds between drains of the direct report channel */
+static const int DEFAULT_DIRECT_REPORT_DRAIN = 20;
+
 HybrisManager::HybrisManager(QObject *parent)
     : QObject(parent)
     , device(NULL)
@@ -101,14 +138,65 @@ HybrisManager::HybrisManager(QObject *parent)
     , sensorsCount(0)
     , sensorMap()
     , registeredAdaptors()
+    , dispatchTable()
     , adaptorReader(parent)
+    , motionLane(HYBRIS_EVENT_QUEUE_SIZE)
+    , slowLane(HYBRIS_EVENT_QUEUE_SIZE)
+    , pollBatch(DEFAULT_POLL_BATCH)
+    , halClock(ClockDomain::Boottime)
+    , pendingWakeups()
+    , directReportEnabled(false)
+    , directChannel(0)
+    , directFd(-1)
+    , directHandle(NULL)
+    , directMem(NULL)
+    , directSlots(DEFAULT_DIRECT_REPORT_EVENTS)
+    , directCounter(1)
+    , directAdaptors(0)
+    , directTimer(new QTimer(this))
 {
+    pendingWakeups.reserve(16);
+    int drain = DEFAULT_DIRECT_REPORT_DRAIN;
+    if (Config::configuration()) {
+        pollBatch = qBound(1, Config::configuration()->value<int>("global/hybris_poll_batch", DEFAULT_POLL_BATCH), (int)HYBRIS_EVENT_QUEUE_SIZE);
+        halClock = ClockDomain::clockFromString(Config::configuration()->value<QString>("global/hybris_clock", "boottime"), ClockDomain::Boottime);
+        directReportEnabled = Config::configuration()->value<bool>("global/hybris_direct_report", false);
+        directSlots = qMax(16, Config::configuration()->value<int>("global/hybris_direct_report_events", DEFAULT_DIRECT_REPORT_EVENTS));
+        drain = qMax(1, Config::configuration()->value<int>("global/hybris_direct_report_drain", DEFAULT_DIRECT_REPORT_DRAIN));
+    }
+    directTimer->setInterval(drain);
+    connect(directTimer, SIGNAL(timeout()), this, SLOT(drainDirectChannel()));
+
+    openLane(motionLane);
+    openLane(slowLane);
     init();
 }
 
 HybrisManager::~HybrisManager()
 {
     closeAllSensors();
+    closeLane(motionLane);
+    closeLane(slowLane);
+}
+
+void HybrisManager::openLane(HybrisEventLane& lane)
+{
+    lane.eventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (lane.eventFd < 0) {
+        sensordLogC() << "Failed to create eventfd: " << strerror(errno);
+    } else {
+        lane.notifier = new QSocketNotifier(lane.eventFd, QSocketNotifier::Read, this);
+        connect(lane.notifier, SIGNAL(activated(int)), this, SLOT(dispatchEvents()));
+    }
+}
+
+void HybrisManager::closeLane(HybrisEventLane& lane)
+{
+    delete lane.notifier;
+    lane.notifier = NULL;
+    if (lane.eventFd >= 0)
+        close(lane.eventFd);
+    lane.eventFd = -1;
 }
 
 HybrisManager *HybrisManager::instance()
@@ -119,7 +207,12 @@ HybrisManager *HybrisManager::instance()
 
 void HybrisManager::init()
 {
-    int errorCode = hw_get_module(SENSORS_HARDWARE_MODULE_ID, (hw_module_t const**)&module);
+    StartupSpan span("hal", "HybrisManager::init");
+    int errorCode;
+    {
+        StartupSpan load("hal", "hw_get_module");
+        errorCode = hw_get_module(SENSORS_HARDWARE_MODULE_ID, (hw_module_t const**)&module);
+    }
     if (errorCode != 0) {
         qDebug() << "hw_get_module() failed" <<  strerror(-errorCode);
         return ;
@@ -185,10 +278,66 @@ bool HybrisManager::setDelay(int sensorHandle, int interval)
     return true;
 }
 
+int HybrisManager::fifoMaxEventCount(int sensorType)
+{
+#ifdef SENSORS_DEVICE_API_VERSION_1_1
+    if (device && device->common.version >= SENSORS_DEVICE_API_VERSION_1_1 && sensorMap.contains(sensorType))
+        return sensorList[sensorMap[sensorType]].fifoMaxEventCount;
+#else
+    Q_UNUSED(sensorType);
+#endif
+    return 0;
+}
+
+bool HybrisManager::batch(int sensorHandle, qint64 period, qint64 latency)
+{
+#ifdef SENSORS_DEVICE_API_VERSION_1_1
+    if (!device || device->common.version < SENSORS_DEVICE_API_VERSION_1_1)
+        return false;
+
+    // Version 1 devices extend the version 0 device, see sensors.h
+    sensors_poll_device_1_t* device1 = reinterpret_cast<sensors_poll_device_1_t*>(device);
+    int result = device1->batch(device1, sensorHandle, 0, period, latency);
+    if (result < 0) {
+        sensordLogW() << "batch() failed" << strerror(-result);
+        return false;
+    }
+    return true;
+#else
+    Q_UNUSED(sensorHandle);
+    Q_UNUSED(period);
+    Q_UNUSED(latency);
+    return false;
+#endif
+}
+
+bool HybrisManager::flush(int sensorHandle)
+{
+#ifdef SENSORS_DEVICE_API_VERSION_1_1
+    if (!device || device->common.version < SENSORS_DEVICE_API_VERSION_1_1)
+        return false;
+
+    sensors_poll_device_1_t* device1 = reinterpret_cast<sensors_poll_device_1_t*>(device);
+    int result = device1->flush(device1, sensorHandle);
+    if (result < 0) {
+        sensordLogW() << "flush() failed" << strerror(-result);
+        return false;
+    }
+    return true;
+#else
+    Q_UNUSED(sensorHandle);
+    return false;
+#endif
+}
+
 void HybrisManager::startReader(HybrisAdaptor *adaptor)
 {
     if (registeredAdaptors.values().contains(adaptor)) {
+        // Sensors reporting into the direct channel need no poll()
+        if (startDirectReport(adaptor))
+            return;
         sensordLogD() << "activating " << adaptor->name();
+        pendingActivations.remove(adaptor->sensorHandle);
         int error = device->activate(device, adaptor->sensorHandle, 1);
         if (error != 0) {
             sensordLogW() <<Q_FUNC_INFO<< "failed for"<< strerror(-error);
@@ -203,16 +352,19 @@ void HybrisManager::stopReader(HybrisAdaptor *adaptor)
     QList <HybrisAdaptor *> list;
     list = registeredAdaptors.values();
     bool okToStop = true;
+    bool direct = adaptor->directReport;
+    stopDirectReport(adaptor);
 
     for (int i = 0; i < list.count(); i++) {
-        if (list.at(i) == adaptor && !list.at(i)->isRunning()) {
+        if (list.at(i) == adaptor && !list.at(i)->isRunning() && !direct) {
             sensordLogD() << "deactivating " << adaptor->name();
+            pendingActivations.remove(adaptor->sensorHandle);
             int error = device->activate(device, adaptor->sensorHandle, 0);
             if (error != 0) {
                 sensordLogW() <<Q_FUNC_INFO<< "failed for"<< strerror(-error);
             }
         }
-        if (list.at(i) != adaptor && list.at(i)->isRunning()) {
+        if (list.at(i) != adaptor && list.at(i)->isRunning() && !list.at(i)->directReport) {
             okToStop = false;
         }
     }
@@ -237,12 +389,9 @@ bool HybrisManager::resumeReader(HybrisAdaptor *adaptor)
         }
     }
 
-    if (okToResume) {
+    if (okToResume && !startDirectReport(adaptor)) {
         sensordLogD() << "activating for resume" << adaptor->name();
-        int error = device->activate(device, adaptor->sensorHandle, 1);
-        if (error != 0) {
-            sensordLogW() <<Q_FUNC_INFO<< "failed for"<< strerror(-error);
-        }
+        queueActivation(adaptor->sensorHandle, true);
     }
     return true;
 }
@@ -260,19 +409,40 @@ void HybrisManager::standbyReader(HybrisAdaptor *adaptor)
         }
     }
 
-    if (okToStandby) {
+    if (okToStandby && adaptor->directReport) {
+        sensordLogD() << "stopping direct report for standby" << adaptor->name();
+        stopDirectReport(adaptor);
+    } else if (okToStandby) {
         sensordLogD() << "deactivating for standby" << adaptor->name();
-        int error = device->activate(device, adaptor->sensorHandle, 0);
+        queueActivation(adaptor->sensorHandle, false);
+    }
+}
+
+void HybrisManager::queueActivation(int handle, bool enable)
+{
+    if (pendingActivations.isEmpty())
+        QMetaObject::invokeMethod(this, "applyActivations", Qt::QueuedConnection);
+    pendingActivations.insert(handle, enable);
+}
+
+void HybrisManager::applyActivations()
+{
+    QMap<int, bool> activations;
+    activations.swap(pendingActivations);
+    for (QMap<int, bool>::const_iterator it = activations.constBegin(); it != activations.constEnd(); ++it) {
+        int error = device->activate(device, it.key(), it.value() ? 1 : 0);
         if (error != 0) {
-            sensordLogW() <<Q_FUNC_INFO<< "failed for"<< strerror(-error);
+            sensordLogW() << Q_FUNC_INFO << "failed for" << it.key() << strerror(-error);
         }
     }
+    sensordLogD() << "applied" << activations.size() << "standby/resume activation(s)";
 }
 
 bool HybrisManager::openSensors()
 {
     if (!device) {
         sensordLogD() << "Calling sensors_open";
+        StartupSpan span("hal", "sensors_open");
         int errorCode = sensors_open(&module->common, &device);
         if (errorCode != 0) {
             sensordLogW() << "sensors_open() failed:" << strerror(-errorCode);
@@ -293,6 +463,8 @@ bool HybrisManager::closeSensors()
             }
         }
 
+        closeDirectChannel();
+
         sensordLogD() << "Calling sensors_close";
         int errorCode = sensors_close(device);
         if (errorCode != 0) {
@@ -321,25 +493,351 @@ void HybrisManager::closeAllSensors()
 
 void HybrisManager::processSample(const sensors_event_t& data)
 {
-    foreach (HybrisAdaptor *adaptor, registeredAdaptors.values(data.type)) {
+    if (data.type < 0 || data.type >= dispatchTable.size())
+        return;
+
+    // Latency from the HAL stamping the event to dispatching it
+    quint64 latency = 0;
+    if (data.timestamp > 0) {
+        quint64 now = LatencyHistogram::now();
+        quint64 stamped = HybrisAdaptor::eventTimestamp(data) * 1000;
+        latency = now > stamped ? now - stamped : 0;
+    }
+
+    const QVector<HybrisAdaptor *>& adaptors = dispatchTable.at(data.type);
+    for (int i = 0; i < adaptors.size(); ++i) {
+        HybrisAdaptor* adaptor = adaptors.at(i);
         if (adaptor->isRunning()) {
+            if (!adaptor->batchPending) {
+                adaptor->batchPending = true;
+                adaptor->beginBatch();
+                pendingWakeups.append(adaptor);
+            }
+            if (data.timestamp > 0)
+                adaptor->recordReadLatency(latency);
             adaptor->processSample(data);
         }
     }
 }
 
+bool HybrisManager::isMotionEvent(int type)
+{
+    switch (type) {
+    case SENSOR_TYPE_ACCELEROMETER:
+    case SENSOR_TYPE_MAGNETIC_FIELD:
+    case SENSOR_TYPE_ORIENTATION:
+    case SENSOR_TYPE_GYROSCOPE:
+    case SENSOR_TYPE_GRAVITY:
+    case SENSOR_TYPE_LINEAR_ACCELERATION:
+    case SENSOR_TYPE_ROTATION_VECTOR:
+    case SENSOR_TYPE_GAME_ROTATION_VECTOR:
+    case SENSOR_TYPE_GEOMAGNETIC_ROTATION_VECTOR:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool HybrisManager::queueEvent(const sensors_event_t& data)
+{
+    HybrisEventLane& lane = isMotionEvent(data.type) ? motionLane : slowLane;
+    bool wakeup;
+    if (!lane.queue.push(data, wakeup)) {
+        sensordLogT() << "Hybris" << (&lane == &motionLane ? "motion" : "slow")
+                      << "event queue full, dropped" << lane.queue.dropCount() << "events";
+        return false;
+    }
+    if (wakeup) {
+        quint64 count = 1;
+        if (::write(lane.eventFd, &count, sizeof(count)) != sizeof(count) && errno != EAGAIN) {
+            sensordLogW() << "Failed to signal hybris event queue: " << strerror(errno);
+        }
+    }
+    return true;
+}
+
+void HybrisManager::dispatchEvents()
+{
+    quint64 count;
+    HybrisEventLane* lanes[] = { &motionLane, &slowLane };
+    for (int i = 0; i < 2; ++i) {
+        if (::read(lanes[i]->eventFd, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+            sensordLogW() << "Failed to read hybris event queue eventfd: " << strerror(errno);
+        }
+    }
+
+    // Motion events wait behind at most one batch of slow events
+    dispatchLane(motionLane, false);
+    while (dispatchLane(slowLane, true))
+        dispatchLane(motionLane, false);
+}
+
+bool HybrisManager::dispatchLane(HybrisEventLane& lane, bool slice)
+{
+    // Readers are woken up once per adaptor and batch
+    sensors_event_t data;
+    int batched = 0;
+    while (lane.queue.pop(data)) {
+        processSample(data);
+        if (++batched == pollBatch) {
+            wakeUpPending();
+            if (slice)
+                return true;
+            batched = 0;
+        }
+    }
+    wakeUpPending();
+    return false;
+}
+
+void HybrisManager::wakeUpPending()
+{
+    for (int i = 0; i < pendingWakeups.size(); ++i) {
+        pendingWakeups.at(i)->batchPending = false;
+        pendingWakeups.at(i)->endBatch();
+    }
+    // resize() keeps the capacity, so steady state dispatch does not allocate
+    pendingWakeups.resize(0);
+}
+
+bool HybrisManager::startDirectReport(HybrisAdaptor *adaptor)
+{
+#ifdef SENSORS_DEVICE_API_VERSION_1_4
+    if (!directReportEnabled || !device || device->common.version < SENSORS_DEVICE_API_VERSION_1_4
+        || !sensorMap.contains(adaptor->sensorType))
+        return false;
+
+    const sensor_t& sensor = sensorList[sensorMap[adaptor->sensorType]];
+    int maxRate = (sensor.flags & SENSOR_FLAG_MASK_DIRECT_REPORT) >> SENSOR_FLAG_SHIFT_DIRECT_REPORT;
+    if (!(sensor.flags & SENSOR_FLAG_DIRECT_CHANNEL_ASHMEM) || maxRate == SENSOR_DIRECT_RATE_STOP)
+        return false;
+
+    // Rate levels are nominally 50, 200 and 800 Hz. Sensors slower than
+    // the lowest level are left to poll().
+    if (!adaptor->directReport && adaptor->cachedInterval > 20)
+        return false;
+    int rate = SENSOR_DIRECT_RATE_NORMAL;
+    if (adaptor->cachedInterval < 5)
+        rate = SENSOR_DIRECT_RATE_VERY_FAST;
+    else if (adaptor->cachedInterval < 20)
+        rate = SENSOR_DIRECT_RATE_FAST;
+    rate = qMin(rate, maxRate);
+
+    if (!openDirectChannel())
+        return false;
+
+    sensors_poll_device_1_t* device1 = reinterpret_cast<sensors_poll_device_1_t*>(device);
+    sensors_direct_cfg_t config;
+    memset(&config, 0, sizeof(config));
+    config.rate_level = rate;
+    int result = device1->config_direct_report(device1, adaptor->sensorHandle, directChannel, &config);
+    if (result < 0) {
+        sensordLogW() << "config_direct_report() failed" << strerror(-result);
+        return false;
+    }
+
+    if (!adaptor->directReport) {
+        adaptor->directReport = true;
+        if (directAdaptors++ == 0)
+            directTimer->start();
+    }
+    sensordLogD() << "Direct report of" << adaptor->id() << "at rate level" << rate;
+    return true;
+#else
+    Q_UNUSED(adaptor);
+    return false;
+#endif
+}
+
+void HybrisManager::stopDirectReport(HybrisAdaptor *adaptor)
+{
+#ifdef SENSORS_DEVICE_API_VERSION_1_4
+    if (!adaptor->directReport)
+        return;
+
+    sensors_poll_device_1_t* device1 = reinterpret_cast<sensors_poll_device_1_t*>(device);
+    sensors_direct_cfg_t config;
+    memset(&config, 0, sizeof(config));
+    config.rate_level = SENSOR_DIRECT_RATE_STOP;
+    int result = device1->config_direct_report(device1, adaptor->sensorHandle, directChannel, &config);
+    if (result < 0) {
+        sensordLogW() << "config_direct_report() failed" << strerror(-result);
+    }
+
+    adaptor->directReport = false;
+    if (--directAdaptors == 0) {
+        directTimer->stop();
+        drainDirectChannel();
+    }
+#else
+    Q_UNUSED(adaptor);
+#endif
+}
+
+bool HybrisManager::openDirectChannel()
+{
+#ifdef SENSORS_DEVICE_API_VERSION_1_4
+    if (directChannel > 0)
+        return true;
+
+    size_t size = directSlots * sizeof(sensors_event_t);
+    directFd = open("/dev/ashmem", O_RDWR | O_CLOEXEC);
+    if (directFd < 0 || ioctl(directFd, ASHMEM_SET_SIZE, size) < 0) {
+        sensordLogW() << "Failed to create direct report memory: " << strerror(errno);
+        closeDirectChannel();
+        return false;
+    }
+    void* mem = mmap(NULL, size, PROT_READ, MAP_SHARED, directFd, 0);
+    if (mem == MAP_FAILED) {
+        sensordLogW() << "Failed to map direct report memory: " << strerror(errno);
+        closeDirectChannel();
+        return false;
+    }
+    directMem = static_cast<char*>(mem);
+
+    // Handle laid out by hand, libcutils is not linked
+    native_handle_t* handle = static_cast<native_handle_t*>(malloc(sizeof(native_handle_t) + sizeof(int)));
+    handle->version = sizeof(native_handle_t);
+    handle->numFds = 1;
+    handle->numInts = 0;
+    handle->data[0] = directFd;
+    directHandle = handle;
+
+    sensors_direct_mem_t memory;
+    memset(&memory, 0, sizeof(memory));
+    memory.type = SENSOR_DIRECT_MEM_TYPE_ASHMEM;
+    memory.format = SENSOR_DIRECT_FMT_SENSORS_EVENT;
+    memory.size = size;
+    memory.handle = handle;
+    sensors_poll_device_1_t* device1 = reinterpret_cast<sensors_poll_device_1_t*>(device);
+    int result = device1->register_direct_channel(device1, &memory, -1);
+    if (result <= 0) {
+        sensordLogW() << "register_direct_channel() failed" << strerror(-result);
+        closeDirectChannel();
+        return false;
+    }
+    directChannel = result;
+    // HAL counts events of a new channel from 1
+    directCounter = 1;
+    sensordLogD() << "Registered direct report channel of" << directSlots << "events";
+    return true;
+#else
+    return false;
+#endif
+}
+
+void HybrisManager::closeDirectChannel()
+{
+#ifdef SENSORS_DEVICE_API_VERSION_1_4
+    if (directChannel > 0) {
+        sensors_poll_device_1_t* device1 = reinterpret_cast<sensors_poll_device_1_t*>(device);
+        device1->register_direct_channel(device1, NULL, directChannel);
+        directChannel = 0;
+    }
+    directTimer->stop();
+    directAdaptors = 0;
+    if (directMem) {
+        munmap(directMem, directSlots * sizeof(sensors_event_t));
+        directMem = NULL;
+    }
+    free(directHandle);
+    directHandle = NULL;
+    if (directFd >= 0) {
+        close(directFd);
+        directFd = -1;
+    }
+#endif
+}
+
+void HybrisManager::drainDirectChannel()
+{
+#ifdef SENSORS_DEVICE_API_VERSION_1_4
+    if (!directMem)
+        return;
+
+    const sensors_event_t* events = reinterpret_cast<const sensors_event_t*>(directMem);
+    sensors_event_t data;
+    int batched = 0;
+    for (;;) {
+        const sensors_event_t* slot = events + (directCounter - 1) % directSlots;
+        // HAL writes the counter of an event after its payload
+        quint32 counter = __atomic_load_n(reinterpret_cast<const quint32*>(&slot->reserved0), __ATOMIC_ACQUIRE);
+        if (counter != directCounter) {
+            if (qint32(counter - directCounter) < 0)
+                break;
+            // HAL has lapped the reader, the slot holds the oldest event left
+            sensordLogT() << "Direct report channel overrun, lost" << counter - directCounter << "events";
+            directCounter = counter;
+            continue;
+        }
+        memcpy(&data, slot, sizeof(data));
+        // Discard event overwritten while copying, next pass resyncs
+        if (__atomic_load_n(reinterpret_cast<const quint32*>(&slot->reserved0), __ATOMIC_ACQUIRE) != counter)
+            continue;
+        ++directCounter;
+
+        processSample(data);
+        if (++batched == pollBatch) {
+            wakeUpPending();
+            batched = 0;
+        }
+    }
+    wakeUpPending();
+#endif
+}
+
+int HybrisManager::pollBatchSize() const
+{
+    return pollBatch;
+}
+
+ClockDomain::Clock HybrisManager::eventClock() const
+{
+    return halClock;
+}
+
 void HybrisManager::registerAdaptor(HybrisAdaptor *adaptor)
 {
     if (!registeredAdaptors.values().contains(adaptor)) {
         registeredAdaptors.insertMulti(adaptor->sensorType, adaptor);
+        if (adaptor->sensorType >= 0) {
+            if (adaptor->sensorType >= dispatchTable.size())
+                dispatchTable.resize(adaptor->sensorType + 1);
+            dispatchTable[adaptor->sensorType].append(adaptor);
+        }
     }
 }
 
+void HybrisManager::unregisterAdaptor(HybrisAdaptor *adaptor)
+{
+    QMap<int, HybrisAdaptor *>::iterator it = registeredAdaptors.begin();
+    while (it != registeredAdaptors.end()) {
+        if (it.value() == adaptor)
+            it = registeredAdaptors.erase(it);
+        else
+            ++it;
+    }
+    for (int type = 0; type < dispatchTable.size(); ++type)
+        dispatchTable[type].removeAll(adaptor);
+    pendingWakeups.removeAll(adaptor);
+}
+
+int HybrisManager::adaptorCount(int type) const
+{
+    return registeredAdaptors.count(type);
+}
+
 //////////////////////////////////
 HybrisAdaptor::HybrisAdaptor(const QString& id, int type)
     : DeviceAdaptor(id),
       sensorType(type),
       cachedInterval(50),
+      batchPending(false),
+      directReport(false),
+      fifoSize_(0),
+      bufferSize_(0),
+      bufferInterval_(0),
+      latency_(0),
       inStandbyMode_(false),
       running_(false)
 {
@@ -356,6 +854,11 @@ HybrisAdaptor::HybrisAdaptor(const QString& id, int type)
 
 HybrisAdaptor::~HybrisAdaptor()
 {
+    // Idle adaptors are deleted and created again by SensorManager.
+    // Manager is gone already if the adaptor outlives it at exit.
+    HybrisManager *manager = hybrisManager();
+    if (manager)
+        manager->unregisterAdaptor(this);
 }
 
 void HybrisAdaptor::init()
@@ -366,6 +869,7 @@ void HybrisAdaptor::init()
     if (minDelay > 1000)
         minDelay = 0;
     resolution = hybrisManager()->resolution(sensorType);
+    fifoSize_ = hybrisManager()->fifoMaxEventCount(sensorType);
 }
 
 bool HybrisAdaptor::addSensorType(int type)
@@ -510,6 +1014,54 @@ bool HybrisAdaptor::resume()
     return true;
 }
 
+HybrisXyzConverter::HybrisXyzConverter(double scale) :
+    scale_(scale)
+{
+    for (int i = 0; i < 9; ++i)
+        m_[i] = (i % 4 == 0) ? scale_ : 0;
+}
+
+bool HybrisXyzConverter::configure(const QString& name)
+{
+    QString matrix = Config::configuration()->value<QString>(name + "/transformation_matrix", "");
+    if (matrix.isEmpty())
+        return true;
+
+    QStringList cells = matrix.split(',');
+    if (cells.size() != 9) {
+        sensordLogW() << "Invalid cell count in" << name << "transformation_matrix. Expected 9, got" << cells.size();
+        return false;
+    }
+
+    double m[9];
+    for (int i = 0; i < 9; ++i) {
+        bool ok;
+        m[i] = cells.at(i).trimmed().toDouble(&ok);
+        if (!ok) {
+            sensordLogW() << "Failed to parse" << name << "transformation_matrix:" << matrix;
+            return false;
+        }
+    }
+    for (int i = 0; i < 9; ++i)
+        m_[i] = m[i] * scale_;
+    return true;
+}
+
+quint64 HybrisAdaptor::eventTimestamp(const sensors_event_t& data)
+{
+    if (data.timestamp > 0)
+        return ClockDomain::toMonotonic(hybrisManager()->eventClock(), data.timestamp / 1000);
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000ULL + now.tv_nsec / 1000;
+}
+
+int HybrisAdaptor::eventBatchSize()
+{
+    return hybrisManager()->pollBatchSize();
+}
+
 unsigned int HybrisAdaptor::interval() const
 {
     return cachedInterval;
@@ -524,9 +1076,82 @@ bool HybrisAdaptor::setInterval(const unsigned int value, const int /*sessionId*
     if (!ok) {
         qDebug() << Q_FUNC_INFO << "setInterval not ok";
     }
+    if (ok && latency_ > 0)
+        ok = updateBatching();
+    if (ok && directReport)
+        ok = hybrisManager()->startDirectReport(this);
     return ok;
 }
 
+IntegerRangeList HybrisAdaptor::getAvailableBufferSizes(bool& hwSupported) const
+{
+    if (fifoSize_ <= 0)
+        return DeviceAdaptor::getAvailableBufferSizes(hwSupported);
+
+    IntegerRangeList list;
+    list.push_back(IntegerRange(1, fifoSize_));
+    hwSupported = true;
+    return list;
+}
+
+IntegerRangeList HybrisAdaptor::getAvailableBufferIntervals(bool& hwSupported) const
+{
+    if (fifoSize_ <= 0)
+        return DeviceAdaptor::getAvailableBufferIntervals(hwSupported);
+
+    IntegerRangeList list;
+    list.push_back(IntegerRange(0, 60000));
+    hwSupported = true;
+    return list;
+}
+
+unsigned int HybrisAdaptor::bufferSize() const
+{
+    return bufferSize_;
+}
+
+unsigned int HybrisAdaptor::bufferInterval() const
+{
+    return bufferInterval_;
+}
+
+bool HybrisAdaptor::setBufferSize(unsigned int value)
+{
+    if (fifoSize_ <= 0)
+        return false;
+    bufferSize_ = value;
+    return updateBatching();
+}
+
+bool HybrisAdaptor::setBufferInterval(unsigned int value)
+{
+    if (fifoSize_ <= 0)
+        return false;
+    bufferInterval_ = value;
+    return updateBatching();
+}
+
+bool HybrisAdaptor::updateBatching()
+{
+    qint64 period = qint64(cachedInterval) * 1000000;
+    qint64 latency = 0;
+    if (bufferInterval_ > 0)
+        latency = qint64(bufferInterval_) * 1000000;
+    else if (bufferSize_ > 1)
+        latency = qint64(bufferSize_) * period;
+
+    if (!hybrisManager()->batch(sensorHandle, period, latency))
+        return false;
+
+    // Deliver events batched with the longer latency right away
+    if (latency < latency_)
+        hybrisManager()->flush(sensorHandle);
+
+    sensordLogD() << "Batching" << id() << "with report latency" << latency / 1000000 << "ms";
+    latency_ = latency;
+    return true;
+}
+
 void HybrisAdaptor::stopReaderThread()
 {
     hybrisManager()->stopReader(this);
@@ -542,27 +1167,8 @@ bool HybrisAdaptor::startReaderThread()
 
 unsigned int HybrisAdaptor::evaluateIntervalRequests(int& sessionId) const
 {
-    if (m_intervalMap.size() == 0)
-    {
-        sessionId = -1;
-        return defaultInterval();
-    }
-
     // Get the smallest positive request, 0 is reserved for HW wakeup
-    QMap<int, unsigned int>::const_iterator it = m_intervalMap.constBegin();
-    unsigned int highestValue = it.value();
-    int winningSessionId = it.key();
-
-    for (++it; it != m_intervalMap.constEnd(); ++it)
-    {
-        if (((it.value() < highestValue) && (it.value() > 0)) || highestValue == 0) {
-            highestValue = it.value();
-            winningSessionId = it.key();
-        }
-    }
-
-    sessionId = winningSessionId;
-    return highestValue > 0 ? highestValue : defaultInterval();
+    return lowestIntervalRequest(sessionId, true);
 }
 
 /*/////////////////////////////////////////////////////////////////////
@@ -591,6 +1197,7 @@ void HybrisAdaptorReader::stopReader()
 
 void HybrisAdaptorReader::startReader()
 {
+    policy_ = ThreadPolicy::fromConfig("global/hybris_reader_");
     running_ = true;
     start();
 }
@@ -598,14 +1205,16 @@ void HybrisAdaptorReader::startReader()
 void HybrisAdaptorReader::run()
 {
     int err = 0;
-    static const size_t numEvents = 16;
-    sensors_event_t buffer[numEvents];
+    QVector<sensors_event_t> events(hybrisManager()->pollBatch);
+    sensors_event_t* buffer = events.data();
+
+    policy_.apply();
 
     while (running_) {
-        int numberOfEvents = hybrisManager()->device->poll(hybrisManager()->device, buffer, numEvents);
+        int numberOfEvents = hybrisManager()->device->poll(hybrisManager()->device, buffer, events.size());
         if (numberOfEvents < 0) {
             sensordLogW() << "poll() failed" << strerror(-err);
-            QThread::msleep(1000);
+            Clock::msleep(1000);
         } else {
             bool errorInInput = false;
 
@@ -616,11 +1225,11 @@ void HybrisAdaptorReader::run()
                     sensordLogW()<< QString("incorrect event version (version=%1, expected=%2").arg(data.version).arg(sizeof(sensors_event_t));
                     errorInInput = true;
                 }
-                hybrisManager()->processSample(data);
+                hybrisManager()->queueEvent(data);
 
             }
             if (errorInInput)
-                QThread::msleep(50);
+                Clock::msleep(50);
         }
     }
     sensordLogT() << Q_FUNC_INFO << "runner thread end";
@@ -24,11 +24,17 @@
 #include <QObject>
 #include <QThread>
 #include <QTimer>
+#include <QVector>
 
 #include "deviceadaptor.h"
+#include "spscqueue.h"
+#include "threadpolicy.h"
+#include "clockdomain.h"
+#include "datatypes/genericdata.h"
 #include <hardware/sensors.h>
 
 class HybrisAdaptor;
+class QSocketNotifier;
 
 class HybrisAdaptorReader : public QThread
 {
@@ -42,12 +48,30 @@ public:
 
     void run();
     void stopReader();
+
+    /**
+     * Start reader thread. Scheduling of the thread is read from the
+     * global/hybris_reader_* keys, see ThreadPolicy.
+     */
     void startReader();
 
 private:
     bool running_;
+    ThreadPolicy policy_; /**< scheduling of the thread */
 };
 
+/**
+ * Queue of HAL events from the reader thread to the manager thread,
+ * with the eventfd signalling it.
+ */
+struct HybrisEventLane
+{
+    HybrisEventLane(unsigned int size) : queue(size), eventFd(-1), notifier(NULL) {}
+
+    SpscQueue<sensors_event_t> queue; /**< events waiting for dispatch */
+    int eventFd;                      /**< signalled when the queue gets events */
+    QSocketNotifier* notifier;        /**< watches eventFd */
+};
 
 class HybrisManager : public QObject
 {
@@ -63,9 +87,60 @@ public:
     int resolution(int sensorType);
 
     bool setDelay(int handle, int interval);
+
+    /**
+     * How many events the hardware FIFO can batch for a sensor.
+     *
+     * @param sensorType sensor type.
+     * @return FIFO size in events, 0 if the HAL does not support batching.
+     */
+    int fifoMaxEventCount(int sensorType);
+
+    /**
+     * Set sampling period and maximum report latency of a sensor. Events
+     * are batched in the hardware FIFO for up to the latency, so the
+     * application processor is not woken up for every sample. Requires
+     * HAL version 1.1 or newer.
+     *
+     * @param handle sensor handle.
+     * @param period sampling period in nanoseconds.
+     * @param latency maximum report latency in nanoseconds, 0 disables
+     *        batching.
+     * @return was batching set.
+     */
+    bool batch(int handle, qint64 period, qint64 latency);
+
+    /**
+     * Deliver events batched in the hardware FIFO of a sensor.
+     *
+     * @param handle sensor handle.
+     * @return was flush started.
+     */
+    bool flush(int handle);
+
     void startReader(HybrisAdaptor *adaptor);
     void stopReader(HybrisAdaptor *adaptor);
 
+    /**
+     * Have the HAL write events of a sensor into the direct report
+     * channel instead of delivering them through poll(), or update the
+     * rate if the sensor already reports there. Requires
+     * global/hybris_direct_report, HAL version 1.4 and a sensor supporting
+     * ashmem direct channels.
+     *
+     * @param adaptor adaptor of the sensor.
+     * @return was direct report configured, false if the sensor has to
+     *         be activated for poll().
+     */
+    bool startDirectReport(HybrisAdaptor *adaptor);
+
+    /**
+     * Stop direct report of a sensor.
+     *
+     * @param adaptor adaptor of the sensor.
+     */
+    void stopDirectReport(HybrisAdaptor *adaptor);
+
     bool resumeReader(HybrisAdaptor *adaptor);
     void standbyReader(HybrisAdaptor *adaptor);
 
@@ -74,8 +149,133 @@ public:
 
     void registerAdaptor(HybrisAdaptor * adaptor);
 
+    /**
+     * Forget a deleted adaptor, so that events are no longer dispatched
+     * to it. Called by the adaptor destructor.
+     *
+     * @param adaptor adaptor being deleted.
+     */
+    void unregisterAdaptor(HybrisAdaptor * adaptor);
+
+    /**
+     * Number of adaptors registered for a sensor type.
+     *
+     * @param type sensor type.
+     * @return registered adaptor count.
+     */
+    int adaptorCount(int type) const;
+
+    /**
+     * Number of events read per HAL poll and dispatched before readers
+     * are woken up. Configured with global/hybris_poll_batch.
+     *
+     * @return batch size.
+     */
+    int pollBatchSize() const;
+
+    /**
+     * Clock of HAL event timestamps. Configured with global/hybris_clock.
+     *
+     * @return clock.
+     */
+    ClockDomain::Clock eventClock() const;
+
     void processSample(const sensors_event_t& data);
 
+    /**
+     * Hand event over from the reader thread to the thread of the manager.
+     * Events are dispatched to the adaptors by #dispatchEvents(). Motion
+     * events, see #isMotionEvent(), are queued apart from the others, so
+     * a backlog of slow sensors neither delays nor drops them.
+     *
+     * @param data event read from the HAL.
+     * @return false if event queue was full and event was dropped.
+     */
+    bool queueEvent(const sensors_event_t& data);
+
+private Q_SLOTS:
+    /**
+     * Dispatch queued events. Runs in the thread of the manager, so the
+     * adaptors and their filter chains are never entered from the reader
+     * thread.
+     */
+    void dispatchEvents();
+
+    /**
+     * Dispatch events the HAL has written into the direct report channel
+     * since the last call. Runs periodically in the thread of the manager
+     * while sensors report into the channel.
+     */
+    void drainDirectChannel();
+
+    /**
+     * Apply activations queued by #queueActivation() in one pass.
+     */
+    void applyActivations();
+
+private:
+    /**
+     * Queue activation or deactivation of a sensor for standby or resume.
+     * All transitions of one display state change reach the HAL together
+     * when control returns to the event loop, and a queued change is
+     * replaced by a later one for the same sensor.
+     *
+     * @param handle sensor handle.
+     * @param enable activate if true, deactivate if false.
+     */
+    void queueActivation(int handle, bool enable);
+
+    /**
+     * End the batches of adaptors which have processed samples since the
+     * last call, waking up their readers.
+     */
+    void wakeUpPending();
+
+    /**
+     * Dispatch queued events of a lane.
+     *
+     * @param lane dispatched lane.
+     * @param slice stop after one batch of events.
+     * @return true if stopped after a batch, more events may be queued.
+     */
+    bool dispatchLane(HybrisEventLane& lane, bool slice);
+
+    /**
+     * Is an event of a high rate motion sensor, dispatched ahead of the
+     * others.
+     *
+     * @param type sensor type of the event.
+     * @return does the event go to the motion lane.
+     */
+    static bool isMotionEvent(int type);
+
+    /**
+     * Create the eventfd and notifier of a lane.
+     *
+     * @param lane lane to set up.
+     */
+    void openLane(HybrisEventLane& lane);
+
+    /**
+     * Release the eventfd and notifier of a lane.
+     *
+     * @param lane lane to release.
+     */
+    void closeLane(HybrisEventLane& lane);
+
+    /**
+     * Create shared memory of the direct report channel and register it
+     * with the HAL.
+     *
+     * @return is the channel open.
+     */
+    bool openDirectChannel();
+
+    /**
+     * Unregister the direct report channel and release its memory.
+     */
+    void closeDirectChannel();
+
 protected:
     // methods
     void init();
@@ -88,11 +288,76 @@ protected:
     int sensorsCount;
     QMap <int, int> sensorMap; //type, index
     QMap <int, HybrisAdaptor *> registeredAdaptors; //type, obj
+    QVector<QVector<HybrisAdaptor *> > dispatchTable; // type -> adaptors, no allocation on dispatch
     HybrisAdaptorReader adaptorReader;
+    HybrisEventLane motionLane; // reader thread -> manager thread, motion sensors
+    HybrisEventLane slowLane; // reader thread -> manager thread, other sensors
+    int pollBatch; // events per HAL poll and per dispatch batch
+    ClockDomain::Clock halClock; // clock of HAL event timestamps
+    QVector<HybrisAdaptor *> pendingWakeups; // adaptors with an open batch
+    bool directReportEnabled; // global/hybris_direct_report
+    int directChannel; // HAL channel handle, 0 if not registered
+    int directFd; // ashmem of the channel
+    void* directHandle; // native handle passed to the HAL
+    char* directMem; // mapping of the channel
+    int directSlots; // events the channel holds
+    quint32 directCounter; // counter of the next event to read
+    int directAdaptors; // adaptors reporting into the channel
+    QTimer* directTimer; // drains the channel
+    QMap<int, bool> pendingActivations; // handle -> enable, applied by applyActivations()
 
     friend class HybrisAdaptorReader;
 };
 
+/**
+ * Conversion of three axis HAL vectors into sensorfw integer units. Unit
+ * scale is folded into a precomputed matrix when the converter is set up,
+ * together with optional axis alignment from
+ * <em>id</em>/transformation_matrix (nine comma separated values, row
+ * major, keyed by adaptor id). Converting a sample is then a single multiply-add pass, without
+ * per axis divisions or a separate CoordinateAlignFilter stage. When
+ * alignment is configured for the adaptor, the chain matrix should be left
+ * to identity, which the filter passes through.
+ */
+class HybrisXyzConverter
+{
+public:
+    /**
+     * Constructor.
+     *
+     * @param scale multiplier from HAL units to sensorfw units.
+     */
+    HybrisXyzConverter(double scale);
+
+    /**
+     * Fold alignment matrix of an adaptor into the conversion.
+     *
+     * @param name adaptor id whose transformation_matrix key is read.
+     * @return false if the key is set but cannot be parsed.
+     */
+    bool configure(const QString& name);
+
+    /**
+     * Convert a HAL vector.
+     *
+     * @param in x, y and z in HAL units.
+     * @param out sample whose coordinates are written.
+     */
+    inline void convert(const float* in, TimedXyzData& out) const
+    {
+        const double x = in[0];
+        const double y = in[1];
+        const double z = in[2];
+        out.x_ = (int)(m_[0] * x + m_[1] * y + m_[2] * z);
+        out.y_ = (int)(m_[3] * x + m_[4] * y + m_[5] * z);
+        out.z_ = (int)(m_[6] * x + m_[7] * y + m_[8] * z);
+    }
+
+private:
+    double scale_; /**< unit multiplier */
+    double m_[9];  /**< alignment times scale, row major */
+};
+
 class HybrisAdaptor : public DeviceAdaptor
 {
 public:
@@ -112,6 +377,16 @@ public:
 
     virtual bool resume();
 
+    /**
+     * Hardware buffering is reported when the HAL can batch events of
+     * the sensor.
+     */
+    virtual IntegerRangeList getAvailableBufferSizes(bool& hwSupported) const;
+    virtual IntegerRangeList getAvailableBufferIntervals(bool& hwSupported) const;
+
+    virtual unsigned int bufferSize() const;
+    virtual unsigned int bufferInterval() const;
+
     qreal maxRange;
     qint32 minDelay;
     qreal resolution;
@@ -120,21 +395,67 @@ public:
     int sensorHandle;
     int sensorType;
     int cachedInterval;
+    bool batchPending;
+    bool directReport; // events come from the direct report channel
 
     virtual void sendInitialData() {}
 
 protected:
+    /**
+     * Process HAL event. Called within DeviceAdaptor::beginBatch() and
+     * DeviceAdaptor::endBatch(), so readers are woken up once per batch.
+     *
+     * @param data HAL event.
+     */
     virtual void processSample(const sensors_event_t& data) = 0;
 
+    /**
+     * Timestamp of a HAL event. HAL stamps events with nanoseconds of
+     * global/hybris_clock (default boottime) at acquisition, which are
+     * converted to the monotonic sample domain; events without a stamp
+     * get the current time.
+     *
+     * @param data HAL event.
+     * @return monotonic timestamp in microseconds.
+     */
+    static quint64 eventTimestamp(const sensors_event_t& data);
+
+    /**
+     * Number of samples an adaptor may commit before its readers are
+     * woken up. Output buffers of this size get one wakeup per batch.
+     *
+     * @return batch size.
+     */
+    static int eventBatchSize();
+
     virtual unsigned int interval() const;
     virtual bool setInterval(const unsigned int value, const int sessionId);
     virtual unsigned int evaluateIntervalRequests(int& sessionId) const;
 
+    /**
+     * Buffer size and interval are applied as HAL batching: report
+     * latency is the buffer interval, or buffer size times sampling
+     * interval if no buffer interval is set.
+     */
+    virtual bool setBufferSize(unsigned int value);
+    virtual bool setBufferInterval(unsigned int value);
+
 private:
     void stopReaderThread();
     bool startReaderThread();
 
+    /**
+     * Apply current interval and buffering to HAL batching.
+     *
+     * @return was batching set.
+     */
+    bool updateBatching();
+
     QList<int> sensorIds;
+    int fifoSize_;
+    unsigned int bufferSize_;
+    unsigned int bufferInterval_;
+    qint64 latency_;
     unsigned int interval_;
     bool inStandbyMode_;
     bool running_;
@@ -0,0 +1,363 @@
+/**
+   @file iioadaptor.cpp
+   @brief Base class for Industrial I/O buffered capture adaptors
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "iioadaptor.h"
+#include "config.h"
+#include "devicediscovery.h"
+#include "logging.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <QDir>
+#include <QFile>
+
+/** Default kernel buffer length in records */
+static const int DEFAULT_BUFFER_LENGTH = 128;
+
+/** Default number of records before the reader is woken up */
+static const int DEFAULT_WATERMARK = 1;
+
+/** Name of the timestamp scan element */
+static const char* TIMESTAMP_CHANNEL = "in_timestamp";
+
+IioAdaptor::IioAdaptor(const QString& id, const QString& sysfsRoot, const QString& devRoot) :
+    SysfsAdaptor(id, SysfsAdaptor::SelectMode, false),
+    sysfsRoot_(sysfsRoot),
+    devRoot_(devRoot),
+    recordSize_(0),
+    bufferLength_(DEFAULT_BUFFER_LENGTH),
+    watermark_(DEFAULT_WATERMARK),
+    cachedInterval_(0),
+    reconstruct_(false)
+{
+}
+
+IioAdaptor::~IioAdaptor()
+{
+    if (!sysfsDir_.isEmpty())
+        disableBuffer();
+}
+
+int IioAdaptor::addChannel(const QString& channel)
+{
+    if (channelNames_.size() >= IIO_MAX_CHANNELS) {
+        sensordLogW() << "Too many IIO channels for " << id() << ", ignoring " << channel;
+        return -1;
+    }
+    channelNames_.append(channel);
+    return channelNames_.size() - 1;
+}
+
+QString IioAdaptor::findDevice() const
+{
+    QString device = Config::configuration()->value<QString>(name() + "/iio_device", "");
+    if (!device.isEmpty())
+        return device;
+
+    QString match = Config::configuration()->value<QString>(name() + "/iio_match", name());
+    if (DeviceDiscovery::enabled()) {
+        QList<DiscoveredDevice> devices = DeviceDiscovery::instance().find(DiscoveredDevice::Iio, match);
+        if (devices.isEmpty())
+            return QString();
+        sensordLogT() << "\"" << match << "\" matched in IIO device name: " << devices.first().name;
+        return devices.first().entry;
+    }
+
+    QDir root(sysfsRoot_);
+    foreach (const QString& entry, root.entryList(QStringList("iio:device*"), QDir::Dirs)) {
+        QByteArray deviceName = readFromFile(root.filePath(entry + "/name").toLocal8Bit()).trimmed();
+        if (QString(deviceName).contains(match, Qt::CaseInsensitive)) {
+            sensordLogT() << "\"" << match << "\" matched in IIO device name: " << deviceName;
+            return entry;
+        }
+    }
+    return QString();
+}
+
+bool IioAdaptor::readChannel(const QString& name, Channel& channel) const
+{
+    QString base = sysfsDir_ + "/scan_elements/" + name;
+    if (!QFile::exists(base + "_index"))
+        return false;
+
+    QByteArray index = readFromFile((base + "_index").toLocal8Bit());
+    QByteArray type = readFromFile((base + "_type").toLocal8Bit());
+    if (index.isEmpty() || type.isEmpty())
+        return false;
+
+    char endian = 0;
+    char sign = 0;
+    unsigned int bits = 0;
+    unsigned int storage = 0;
+    unsigned int shift = 0;
+    if (sscanf(type.constData(), "%ce:%c%u/%u>>%u", &endian, &sign, &bits, &storage, &shift) != 5 ||
+        (storage != 8 && storage != 16 && storage != 32 && storage != 64) || bits == 0 || bits > storage) {
+        sensordLogW() << "Unsupported IIO scan element type for " << name << ": " << type.trimmed();
+        return false;
+    }
+
+    channel.name = name;
+    channel.index = index.trimmed().toInt();
+    channel.offset = 0;
+    channel.storage = storage / 8;
+    channel.bits = bits;
+    channel.shift = shift;
+    channel.isSigned = (sign == 's');
+    channel.bigEndian = (endian == 'b');
+
+    // Channel specific scale, or the one shared by channels of the type
+    channel.scale = 1;
+    QString scalePath = sysfsDir_ + "/" + name + "_scale";
+    if (!QFile::exists(scalePath) && name.lastIndexOf('_') > 0)
+        scalePath = sysfsDir_ + "/" + name.left(name.lastIndexOf('_')) + "_scale";
+    if (QFile::exists(scalePath))
+        channel.scale = readFromFile(scalePath.toLocal8Bit()).trimmed().toDouble();
+
+    return true;
+}
+
+void IioAdaptor::init()
+{
+    QString device = findDevice();
+    if (device.isEmpty()) {
+        sensordLogW() << "Cannot find IIO device for: " << name();
+        setValid(false);
+        return;
+    }
+    sysfsDir_ = sysfsRoot_ + "/" + device;
+
+    // Scan layout is ordered by scan index, each element aligned to its size
+    QList<Channel> layout;
+    for (int i = 0; i < channelNames_.size(); ++i) {
+        Channel channel;
+        if (!readChannel(channelNames_.at(i), channel)) {
+            sensordLogW() << "IIO channel not available: " << channelNames_.at(i);
+            setValid(false);
+            return;
+        }
+        channel.target = i;
+        layout.append(channel);
+    }
+
+    // Kernel stamps records with real time unless told otherwise
+    Channel timestamp;
+    if (readChannel(TIMESTAMP_CHANNEL, timestamp) && timestamp.storage == 8 &&
+        QFile::exists(sysfsDir_ + "/current_timestamp_clock") &&
+        writeToFile((sysfsDir_ + "/current_timestamp_clock").toLocal8Bit(), "monotonic\n")) {
+        timestamp.target = -1;
+        timestamp.scale = 1;
+        layout.append(timestamp);
+    }
+
+    channels_.clear();
+    while (!layout.isEmpty()) {
+        int first = 0;
+        for (int i = 1; i < layout.size(); ++i) {
+            if (layout.at(i).index < layout.at(first).index)
+                first = i;
+        }
+        channels_.append(layout.takeAt(first));
+    }
+
+    int offset = 0;
+    int alignment = 1;
+    for (int i = 0; i < channels_.size(); ++i) {
+        Channel& channel = channels_[i];
+        offset = (offset + channel.storage - 1) / channel.storage * channel.storage;
+        channel.offset = offset;
+        offset += channel.storage;
+        alignment = qMax(alignment, channel.storage);
+    }
+    recordSize_ = (offset + alignment - 1) / alignment * alignment;
+
+    bufferLength_ = Config::configuration()->value<int>(name() + "/iio_buffer_length", DEFAULT_BUFFER_LENGTH);
+    if (bufferLength_ < 1)
+        bufferLength_ = DEFAULT_BUFFER_LENGTH;
+    watermark_ = qBound(1, Config::configuration()->value<int>(name() + "/iio_watermark", DEFAULT_WATERMARK), bufferLength_);
+    trigger_ = Config::configuration()->value<QString>(name() + "/iio_trigger", "");
+
+    readBuffer_.resize(recordSize_ * bufferLength_);
+    scans_.resize(bufferLength_);
+
+    cachedInterval_ = 0;
+    double hz = 0;
+    if (QFile::exists(sysfsDir_ + "/sampling_frequency")) {
+        hz = readFromFile((sysfsDir_ + "/sampling_frequency").toLocal8Bit()).trimmed().toDouble();
+        cachedInterval_ = hz > 0 ? (unsigned int)(1000 / hz) : 0;
+    }
+
+    // Kernel timestamps need no reconstruction
+    reconstruct_ = Config::configuration()->value<bool>(name() + "/iio_reconstruct_timestamps", true);
+    foreach (const Channel& channel, channels_) {
+        if (channel.target < 0)
+            reconstruct_ = false;
+    }
+    if (reconstruct_) {
+        stamps_.resize(bufferLength_);
+        timestamps_.setPeriod(hz > 0 ? (quint64)(1000000 / hz) : 0);
+    }
+
+    addPath(devRoot_ + "/" + device);
+    introduceAvailableDataRanges(name());
+    introduceAvailableIntervals(name());
+    setDefaultInterval(Config::configuration()->value<int>(name() + "/default_interval", 0));
+}
+
+double IioAdaptor::channelScale(int index) const
+{
+    foreach (const Channel& channel, channels_) {
+        if (channel.target == index)
+            return channel.scale;
+    }
+    return 1;
+}
+
+bool IioAdaptor::enableBuffer()
+{
+    disableBuffer();
+
+    bool ok = true;
+    foreach (const Channel& channel, channels_) {
+        ok &= writeToFile((sysfsDir_ + "/scan_elements/" + channel.name + "_en").toLocal8Bit(), "1\n");
+    }
+    if (!trigger_.isEmpty()) {
+        ok &= writeToFile((sysfsDir_ + "/trigger/current_trigger").toLocal8Bit(), trigger_.toLocal8Bit() + "\n");
+    }
+    ok &= writeToFile((sysfsDir_ + "/buffer/length").toLocal8Bit(), QByteArray::number(bufferLength_) + "\n");
+
+    // Watermark is not supported by older kernels, they wake up per record
+    QByteArray watermarkPath = (sysfsDir_ + "/buffer/watermark").toLocal8Bit();
+    if (QFile::exists(watermarkPath))
+        writeToFile(watermarkPath, QByteArray::number(watermark_) + "\n");
+
+    if (!ok || !writeControl((sysfsDir_ + "/buffer/enable").toLocal8Bit(), "1\n")) {
+        sensordLogW() << "Failed to enable IIO buffer for " << id();
+        return false;
+    }
+    return true;
+}
+
+void IioAdaptor::disableBuffer()
+{
+    writeControl((sysfsDir_ + "/buffer/enable").toLocal8Bit(), "0\n");
+}
+
+void IioAdaptor::descriptorOpened(int pathId, int fd)
+{
+    Q_UNUSED(pathId);
+    Q_UNUSED(fd);
+    enableBuffer();
+}
+
+void IioAdaptor::stopSensor()
+{
+    SysfsAdaptor::stopSensor();
+    if (!isRunning()) {
+        disableBuffer();
+        timestamps_.reset();
+    }
+}
+
+qint64 IioAdaptor::decode(const Channel& channel, const unsigned char* record)
+{
+    const unsigned char* data = record + channel.offset;
+    quint64 raw = 0;
+    for (int i = 0; i < channel.storage; ++i) {
+        int byte = channel.bigEndian ? i : channel.storage - 1 - i;
+        raw = (raw << 8) | data[byte];
+    }
+
+    raw >>= channel.shift;
+    if (channel.bits < 64) {
+        raw &= (1ULL << channel.bits) - 1;
+        if (channel.isSigned && (raw & (1ULL << (channel.bits - 1))))
+            raw |= ~((1ULL << channel.bits) - 1);
+    }
+    return (qint64)raw;
+}
+
+void IioAdaptor::processSample(int pathId, int fd)
+{
+    Q_UNUSED(pathId);
+
+    if (recordSize_ == 0)
+        return;
+
+    int bytes = read(fd, readBuffer_.data(), readBuffer_.size());
+    if (bytes == -1) {
+        if (errno != EAGAIN)
+            sensordLogW() << "read(): " << strerror(errno);
+        return;
+    }
+    if (bytes % recordSize_) {
+        sensordLogW() << "Partial IIO record read, dropping " << bytes % recordSize_ << " bytes";
+    }
+
+    int count = bytes / recordSize_;
+    for (int i = 0; i < count; ++i) {
+        const unsigned char* record = readBuffer_.constData() + i * recordSize_;
+        IioScan& scan = scans_[i];
+        scan.timestamp = sampleTimestamp();
+        foreach (const Channel& channel, channels_) {
+            if (channel.target < 0)
+                scan.timestamp = decode(channel, record) / 1000;
+            else
+                scan.values[channel.target] = decode(channel, record);
+        }
+    }
+
+    if (count && reconstruct_) {
+        timestamps_.reconstruct(sampleTimestamp(), count, stamps_.data());
+        for (int i = 0; i < count; ++i)
+            scans_[i].timestamp = stamps_.at(i);
+    }
+
+    if (count)
+        processScans(scans_.constData(), count);
+}
+
+unsigned int IioAdaptor::interval() const
+{
+    return cachedInterval_;
+}
+
+bool IioAdaptor::setInterval(const unsigned int value, const int sessionId)
+{
+    Q_UNUSED(sessionId);
+
+    QByteArray path = (sysfsDir_ + "/sampling_frequency").toLocal8Bit();
+    if (value == 0 || !QFile::exists(path)) {
+        // Rate is given by the trigger
+        cachedInterval_ = value;
+        return true;
+    }
+
+    sensordLogD() << "Setting sampling frequency for " << id() << " to " << 1000.0 / value << " Hz";
+    if (writeControl(path, QByteArray::number(1000.0 / value) + "\n")) {
+        cachedInterval_ = value;
+        timestamps_.setPeriod(value * 1000);
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,197 @@
+/**
+   @file iioadaptor.h
+   @brief Base class for Industrial I/O buffered capture adaptors
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef IIOADAPTOR_H
+#define IIOADAPTOR_H
+
+#include "sysfsadaptor.h"
+#include "timestampreconstructor.h"
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+/** Maximum number of scan elements decoded per record */
+#define IIO_MAX_CHANNELS 16
+
+/**
+ * Decoded IIO scan record.
+ */
+struct IioScan
+{
+    quint64 timestamp;                 /**< monotonic timestamp in microseconds */
+    qint64  values[IIO_MAX_CHANNELS];  /**< raw channel values in #IioAdaptor::addChannel() order */
+};
+
+/**
+ * @brief Base class for adaptors accessing device drivers through the
+ * Linux Industrial I/O buffer interface.
+ *
+ * IIO device is looked up from /sys/bus/iio/devices by its name, matched
+ * against <em>name</em>/iio_match (default adaptor name), or given
+ * directly as <em>name</em>/iio_device (for example iio:device0). Scan
+ * elements added with #addChannel() are enabled in the device buffer and
+ * the records are read from /dev/iio:deviceN, many per read. Records are
+ * decoded into #IioScan structures and handed to #processScans() in
+ * batches, so the child class can fill its ring buffer and wake up the
+ * readers once per batch.
+ *
+ * Buffer length and wakeup watermark are configured with
+ * <em>name</em>/iio_buffer_length (default 128) and
+ * <em>name</em>/iio_watermark (default 1). Optional trigger is set with
+ * <em>name</em>/iio_trigger. When the device provides a timestamp channel
+ * and its timestamp clock can be set to monotonic, records are stamped by
+ * the kernel at capture time. Otherwise records read together are
+ * spaced by the sample interval with TimestampReconstructor, unless
+ * <em>name</em>/iio_reconstruct_timestamps is false.
+ */
+class IioAdaptor : public SysfsAdaptor
+{
+public:
+    /**
+     * Constructor.
+     *
+     * @param id The id for the adaptor.
+     * @param sysfsRoot directory holding the IIO devices in sysfs.
+     * @param devRoot directory holding the IIO device nodes.
+     */
+    IioAdaptor(const QString& id,
+               const QString& sysfsRoot = "/sys/bus/iio/devices",
+               const QString& devRoot = "/dev");
+
+    /**
+     * Destructor.
+     */
+    virtual ~IioAdaptor();
+
+    virtual void init();
+
+    virtual void stopSensor();
+
+protected:
+    /**
+     * Add scan element to capture. Must be called before #init().
+     *
+     * @param channel scan element name, for example <code>in_accel_x</code>.
+     * @return index of the channel in IioScan::values, -1 if too many
+     *         channels have been added.
+     */
+    int addChannel(const QString& channel);
+
+    /**
+     * Scale of a channel, read from <code>channel_scale</code> or the
+     * shared <code>in_type_scale</code> attribute.
+     *
+     * @param index channel index returned by #addChannel().
+     * @return scale, 1 if the device does not provide one.
+     */
+    double channelScale(int index) const;
+
+    /**
+     * Called with records decoded from the device buffer.
+     *
+     * @param scans decoded records, oldest first.
+     * @param count number of records.
+     */
+    virtual void processScans(const IioScan* scans, int count) = 0;
+
+    void processSample(int pathId, int fd);
+
+    void descriptorOpened(int pathId, int fd);
+
+    virtual unsigned int interval() const;
+
+    virtual bool setInterval(const unsigned int value, const int sessionId);
+
+private:
+    /**
+     * Scan element layout.
+     */
+    struct Channel
+    {
+        QString name;        /**< scan element name */
+        int     index;       /**< scan index */
+        int     offset;      /**< byte offset in record */
+        int     storage;     /**< storage size in bytes */
+        int     bits;        /**< valid bits */
+        int     shift;       /**< right shift of valid bits */
+        bool    isSigned;    /**< is value signed */
+        bool    bigEndian;   /**< is value big endian */
+        double  scale;       /**< channel scale */
+        int     target;      /**< slot in IioScan::values, -1 for timestamp */
+    };
+
+    /**
+     * Look up IIO device.
+     *
+     * @return device name (iio:deviceN) or empty if not found.
+     */
+    QString findDevice() const;
+
+    /**
+     * Read layout of a scan element.
+     *
+     * @param name scan element name.
+     * @param channel layout to fill.
+     * @return false if the scan element does not exist or has an
+     *         unsupported type.
+     */
+    bool readChannel(const QString& name, Channel& channel) const;
+
+    /**
+     * Disable buffer, write scan element, length, watermark and trigger
+     * configuration and enable buffer.
+     *
+     * @return was the buffer enabled.
+     */
+    bool enableBuffer();
+
+    /**
+     * Disable buffer.
+     */
+    void disableBuffer();
+
+    /**
+     * Decode a channel value from a record.
+     *
+     * @param channel scan element layout.
+     * @param record record.
+     * @return decoded value.
+     */
+    static qint64 decode(const Channel& channel, const unsigned char* record);
+
+    QString              sysfsRoot_;      /**< root of IIO devices in sysfs */
+    QString              devRoot_;        /**< directory of IIO device nodes */
+    QStringList          channelNames_;   /**< added scan elements */
+    QVector<Channel>     channels_;       /**< scan layout ordered by index */
+    QString              sysfsDir_;       /**< device sysfs directory */
+    int                  recordSize_;     /**< bytes per record */
+    int                  bufferLength_;   /**< kernel buffer length in records */
+    int                  watermark_;      /**< records before wakeup */
+    QString              trigger_;        /**< trigger name */
+    QVector<unsigned char> readBuffer_;   /**< raw record buffer */
+    QVector<IioScan>     scans_;          /**< decoded records */
+    unsigned int         cachedInterval_; /**< cached interval */
+    bool                 reconstruct_;    /**< are timestamps of bursts reconstructed */
+    TimestampReconstructor timestamps_;   /**< timestamps of records without timestamp channel */
+    QVector<quint64>     stamps_;         /**< reconstructed timestamps */
+};
+
+#endif
@@ -31,31 +31,167 @@
 
 #include "inputdevadaptor.h"
 #include "config.h"
+#include "clockdomain.h"
+#include "devicediscovery.h"
 
 #include <errno.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 #include <QFile>
 #include <QDir>
 #include <QString>
 
+#ifndef EVIOCSCLOCKID
+#define EVIOCSCLOCKID _IOW('E', 0xa0, int)
+#endif
+
+#ifndef SYN_DROPPED
+#define SYN_DROPPED 3
+#endif
+
+/** Default number of events read from the device at once */
+static const int DEFAULT_EVENT_READ_DEPTH = 64;
+
+/** Largest accepted event read depth */
+static const int MAX_EVENT_READ_DEPTH = 4096;
+
+static inline bool testBit(const unsigned long* bits, int bit)
+{
+    return bits[bit / (8 * sizeof(long))] & (1UL << (bit % (8 * sizeof(long))));
+}
+
+static inline void setBit(unsigned long* bits, int bit, bool value)
+{
+    if (value)
+        bits[bit / (8 * sizeof(long))] |= (1UL << (bit % (8 * sizeof(long))));
+    else
+        bits[bit / (8 * sizeof(long))] &= ~(1UL << (bit % (8 * sizeof(long))));
+}
+
+InputDevAdaptor::DeviceState::DeviceState() :
+    monotonic(false),
+    dropped(false),
+    changed(false)
+{
+    memset(abs, 0x0, sizeof(abs));
+    memset(keys, 0x0, sizeof(keys));
+    memset(sw, 0x0, sizeof(sw));
+    memset(absChanged, 0x0, sizeof(absChanged));
+    memset(keysChanged, 0x0, sizeof(keysChanged));
+    memset(swChanged, 0x0, sizeof(swChanged));
+}
+
+bool InputDevAdaptor::InputFrame::isChanged() const
+{
+    return changed_;
+}
+
+int InputDevAdaptor::InputFrame::absValue(int code) const
+{
+    return (code >= 0 && code < ABS_CNT) ? abs_[code] : 0;
+}
+
+bool InputDevAdaptor::InputFrame::absChanged(int code) const
+{
+    return code >= 0 && code < ABS_CNT && testBit(absChanged_, code);
+}
+
+bool InputDevAdaptor::InputFrame::keyValue(int code) const
+{
+    return code >= 0 && code < KEY_CNT && testBit(keys_, code);
+}
+
+bool InputDevAdaptor::InputFrame::keyChanged(int code) const
+{
+    return code >= 0 && code < KEY_CNT && testBit(keysChanged_, code);
+}
+
+bool InputDevAdaptor::InputFrame::switchValue(int code) const
+{
+    return code >= 0 && code < SW_CNT && testBit(sw_, code);
+}
+
+bool InputDevAdaptor::InputFrame::switchChanged(int code) const
+{
+    return code >= 0 && code < SW_CNT && testBit(swChanged_, code);
+}
+
 InputDevAdaptor::InputDevAdaptor(const QString& id, int maxDeviceCount) :
     SysfsAdaptor(id, SysfsAdaptor::SelectMode, false),
     deviceCount_(0),
     maxDeviceCount_(maxDeviceCount),
+    evlist_(DEFAULT_EVENT_READ_DEPTH),
+    states_(maxDeviceCount),
     cachedInterval_(0)
 {
-    memset(evlist_, 0x0, sizeof(input_event)*64);
+    setEventHandling(EventInterpreted);
 }
 
 InputDevAdaptor::~InputDevAdaptor()
 {
 }
 
+void InputDevAdaptor::setEventHandling(int type, int code, EventHandling handling)
+{
+    unsigned char* table;
+    int size;
+    switch (type) {
+        case EV_ABS:
+            table = absHandling_;
+            size = ABS_CNT;
+            break;
+        case EV_KEY:
+            table = keyHandling_;
+            size = KEY_CNT;
+            break;
+        case EV_SW:
+            table = swHandling_;
+            size = SW_CNT;
+            break;
+        default:
+            if (type > EV_SYN && type < EV_CNT)
+                typeHandling_[type] = handling;
+            return;
+    }
+    if (code < 0)
+        memset(table, handling, size);
+    else if (code < size)
+        table[code] = handling;
+}
+
+void InputDevAdaptor::setEventHandling(EventHandling handling)
+{
+    memset(absHandling_, handling, sizeof(absHandling_));
+    memset(keyHandling_, handling, sizeof(keyHandling_));
+    memset(swHandling_, handling, sizeof(swHandling_));
+    memset(typeHandling_, handling, sizeof(typeHandling_));
+}
+
+void InputDevAdaptor::interpretEvent(int src, struct input_event *ev)
+{
+    Q_UNUSED(src);
+    Q_UNUSED(ev);
+}
+
+void InputDevAdaptor::interpretSync(int src, struct input_event *ev)
+{
+    Q_UNUSED(src);
+    Q_UNUSED(ev);
+}
+
+void InputDevAdaptor::interpretFrame(int src, const InputFrame& frame, struct input_event *ev)
+{
+    Q_UNUSED(frame);
+    interpretSync(src, ev);
+}
+
 int InputDevAdaptor::getInputDevices(const QString& typeName)
 {
     QString deviceSysPathString = Config::configuration()->value("global/device_sys_path").toString();
@@ -72,22 +208,61 @@ int InputDevAdaptor::getInputDevices(const QString& typeName)
         addPath(deviceName, deviceCount_);
         ++deviceCount_;
     }
+    else if (deviceSysPathString.contains("%1") && DeviceDiscovery::enabled())
+    {
+        // Only event nodes whose name matches are opened, device found on
+        // a previous run first
+        QList<DiscoveredDevice> devices = DeviceDiscovery::instance().find(DiscoveredDevice::Input, typeName);
+        int hint = Config::configuration()->inputDeviceHint(typeName);
+        for (int i = 1; i < devices.size(); ++i) {
+            if (devices.at(i).number == hint)
+                devices.move(i, 0);
+        }
+        foreach (const DiscoveredDevice& device, devices) {
+            if (deviceCount_ >= maxDeviceCount_)
+                break;
+            if (checkInputDevice(deviceSysPathString.arg(device.number), typeName)) {
+                deviceNumber = device.number;
+                addPath(deviceSysPathString.arg(device.number), deviceCount_);
+                ++deviceCount_;
+                Config::configuration()->setInputDeviceHint(typeName, deviceNumber);
+                break;
+            }
+        }
+    }
     else if(deviceSysPathString.contains("%1"))
     {
         const int MAX_EVENT_DEV = 16;
 
-        // No configuration for this device, try find the device from the device system path
-        while (deviceNumber < MAX_EVENT_DEV && deviceCount_ < maxDeviceCount_) {
-            deviceName = deviceSysPathString.arg(deviceNumber);
-            if (checkInputDevice(deviceName, typeName)) {
-                addPath(deviceName, deviceCount_);
-                ++deviceCount_;
-                break;
+        // Device found on a previous run is checked first
+        int hint = Config::configuration()->inputDeviceHint(typeName);
+        if (hint >= 0 && hint < MAX_EVENT_DEV && deviceCount_ < maxDeviceCount_ &&
+            checkInputDevice(deviceSysPathString.arg(hint), typeName)) {
+            deviceNumber = hint;
+            addPath(deviceSysPathString.arg(hint), deviceCount_);
+            ++deviceCount_;
+        } else {
+            // No configuration for this device, try find the device from the device system path
+            while (deviceNumber < MAX_EVENT_DEV && deviceCount_ < maxDeviceCount_) {
+                deviceName = deviceSysPathString.arg(deviceNumber);
+                if (checkInputDevice(deviceName, typeName)) {
+                    addPath(deviceName, deviceCount_);
+                    ++deviceCount_;
+                    Config::configuration()->setInputDeviceHint(typeName, deviceNumber);
+                    break;
+                }
+                ++deviceNumber;
             }
-            ++deviceNumber;
         }
     }
 
+    int depth = Config::configuration()->value<int>(typeName + "/event_read_depth", DEFAULT_EVENT_READ_DEPTH);
+    if (depth < 1 || depth > MAX_EVENT_READ_DEPTH) {
+        sensordLogW() << "Invalid event read depth" << depth << "for" << typeName << ", using" << DEFAULT_EVENT_READ_DEPTH;
+        depth = DEFAULT_EVENT_READ_DEPTH;
+    }
+    evlist_.resize(depth);
+
     QString pollConfigKey = QString(typeName + "/poll_file");
     if (Config::configuration()->exists(pollConfigKey)) {
         usedDevicePollFilePath_ = Config::configuration()->value<QString>(pollConfigKey, "");
@@ -101,7 +276,7 @@ int InputDevAdaptor::getInputDevices(const QString& typeName)
     }
     else
     {
-        QByteArray byteArray = readFromFile(usedDevicePollFilePath_.toLatin1());
+        QByteArray byteArray = readControl(usedDevicePollFilePath_.toLatin1());
         cachedInterval_ = byteArray.size() > 0 ? byteArray.toInt() : 0;
     }
 
@@ -110,7 +285,7 @@ int InputDevAdaptor::getInputDevices(const QString& typeName)
 
 int InputDevAdaptor::getEvents(int fd)
 {
-    int bytes = read(fd, evlist_, sizeof(struct input_event)*64);
+    int bytes = read(fd, evlist_.data(), sizeof(struct input_event) * evlist_.size());
     if (bytes == -1) {
         sensordLogW() << "Error occured: " << strerror(errno);
         return 0;
@@ -125,17 +300,203 @@ int InputDevAdaptor::getEvents(int fd)
 void InputDevAdaptor::processSample(int pathId, int fd)
 {
     int numEvents = getEvents(fd);
+    if (!numEvents)
+        return;
+
+    if (pathId >= states_.size())
+        states_.resize(pathId + 1);
+    DeviceState& state = states_[pathId];
+
+    if (!state.monotonic) {
+        // Kernel stamps events with wall clock, move them to the
+        // monotonic domain
+        for (int i = 0; i < numEvents; ++i) {
+            const struct timeval& time = evlist_[i].time;
+            quint64 stamp = ClockDomain::toMonotonic(ClockDomain::Realtime, time.tv_sec * 1000000ULL + time.tv_usec);
+            evlist_[i].time.tv_sec = stamp / 1000000;
+            evlist_[i].time.tv_usec = stamp % 1000000;
+        }
+    }
 
     for (int i = 0; i < numEvents; ++i) {
-        switch (evlist_[i].type) {
-            case EV_SYN:
-                interpretSync(pathId, &(evlist_[i]));
-                break;
-            default:
-                interpretEvent(pathId, &(evlist_[i]));
-                break;
+        input_event& ev = evlist_[i];
+
+        if (ev.type == EV_SYN && ev.code == SYN_DROPPED) {
+            if (!state.dropped)
+                sensordLogW() << "Events dropped by " << deviceString_ << ", resyncing";
+            state.dropped = true;
+            continue;
+        }
+
+        if (state.dropped) {
+            if (ev.type == EV_SYN && ev.code == SYN_REPORT) {
+                state.dropped = false;
+                syncState(pathId, fd, &ev.time);
+            }
+            continue;
+        }
+
+        trackEvent(state, ev);
+        dispatchEvent(pathId, state, ev);
+    }
+}
+
+void InputDevAdaptor::dispatchEvent(int pathId, DeviceState& state, struct input_event& ev)
+{
+    unsigned char handling;
+    unsigned long* changed = NULL;
+
+    switch (ev.type) {
+        case EV_SYN:
+            if (ev.code == SYN_REPORT) {
+                InputFrame frame;
+                frame.changed_ = state.changed;
+                frame.abs_ = state.abs;
+                frame.keys_ = state.keys;
+                frame.sw_ = state.sw;
+                frame.absChanged_ = state.absChanged;
+                frame.keysChanged_ = state.keysChanged;
+                frame.swChanged_ = state.swChanged;
+                interpretFrame(pathId, frame, &ev);
+                if (state.changed) {
+                    memset(state.absChanged, 0x0, sizeof(state.absChanged));
+                    memset(state.keysChanged, 0x0, sizeof(state.keysChanged));
+                    memset(state.swChanged, 0x0, sizeof(state.swChanged));
+                    state.changed = false;
+                }
+            } else {
+                interpretSync(pathId, &ev);
+            }
+            return;
+        case EV_ABS:
+            handling = ev.code < ABS_CNT ? absHandling_[ev.code] : (unsigned char)EventInterpreted;
+            changed = state.absChanged;
+            break;
+        case EV_KEY:
+            handling = ev.code < KEY_CNT ? keyHandling_[ev.code] : (unsigned char)EventInterpreted;
+            changed = state.keysChanged;
+            break;
+        case EV_SW:
+            handling = ev.code < SW_CNT ? swHandling_[ev.code] : (unsigned char)EventInterpreted;
+            changed = state.swChanged;
+            break;
+        default:
+            // Tracking other types is not supported, tracked ones are dropped
+            handling = ev.type < EV_CNT ? typeHandling_[ev.type] : (unsigned char)EventInterpreted;
+            break;
+    }
+
+    if (handling == EventInterpreted) {
+        interpretEvent(pathId, &ev);
+    } else if (handling == EventTracked && changed) {
+        setBit(changed, ev.code, true);
+        state.changed = true;
+    }
+}
+
+void InputDevAdaptor::descriptorOpened(int pathId, int fd)
+{
+    if (pathId >= states_.size())
+        states_.resize(pathId + 1);
+    DeviceState& state = states_[pathId];
+    state = DeviceState();
+
+    int clockId = CLOCK_MONOTONIC;
+    state.monotonic = (ioctl(fd, EVIOCSCLOCKID, &clockId) == 0);
+    if (!state.monotonic) {
+        sensordLogW() << "Failed to set monotonic clock for " << deviceString_ << ": " << strerror(errno);
+    }
+
+    syncState(pathId, fd, NULL);
+}
+
+void InputDevAdaptor::trackEvent(DeviceState& state, const struct input_event& ev)
+{
+    switch (ev.type) {
+        case EV_ABS:
+            if (ev.code < ABS_CNT)
+                state.abs[ev.code] = ev.value;
+            break;
+        case EV_KEY:
+            if (ev.code < KEY_CNT)
+                setBit(state.keys, ev.code, ev.value != 0);
+            break;
+        case EV_SW:
+            if (ev.code < SW_CNT)
+                setBit(state.sw, ev.code, ev.value != 0);
+            break;
+    }
+}
+
+void InputDevAdaptor::syncState(int pathId, int fd, const struct timeval* time)
+{
+    DeviceState& state = states_[pathId];
+
+    input_event ev;
+    memset(&ev, 0x0, sizeof(ev));
+    if (time)
+        ev.time = *time;
+
+    unsigned long bits[sizeof(state.keys) / sizeof(long)];
+
+    memset(bits, 0x0, sizeof(bits));
+    if (ioctl(fd, EVIOCGBIT(EV_ABS, sizeof(bits)), bits) >= 0) {
+        // Multi-touch slots can not be queried one axis at a time, they
+        // are left to be updated by the next frames from the device.
+        for (int code = 0; code < ABS_MT_SLOT; ++code) {
+            input_absinfo info;
+            if (!testBit(bits, code) || ioctl(fd, EVIOCGABS(code), &info) < 0)
+                continue;
+            if (time && info.value == state.abs[code])
+                continue;
+            state.abs[code] = info.value;
+            if (time) {
+                ev.type = EV_ABS;
+                ev.code = code;
+                ev.value = info.value;
+                dispatchEvent(pathId, state, ev);
+            }
+        }
+    }
+
+    memset(bits, 0x0, sizeof(bits));
+    if (ioctl(fd, EVIOCGKEY(sizeof(state.keys)), bits) >= 0) {
+        for (int code = 0; code < KEY_CNT; ++code) {
+            bool value = testBit(bits, code);
+            if (value == testBit(state.keys, code))
+                continue;
+            setBit(state.keys, code, value);
+            if (time) {
+                ev.type = EV_KEY;
+                ev.code = code;
+                ev.value = value;
+                dispatchEvent(pathId, state, ev);
+            }
         }
     }
+
+    memset(bits, 0x0, sizeof(bits));
+    if (ioctl(fd, EVIOCGSW(sizeof(state.sw)), bits) >= 0) {
+        for (int code = 0; code < SW_CNT; ++code) {
+            bool value = testBit(bits, code);
+            if (value == testBit(state.sw, code))
+                continue;
+            setBit(state.sw, code, value);
+            if (time) {
+                ev.type = EV_SW;
+                ev.code = code;
+                ev.value = value;
+                dispatchEvent(pathId, state, ev);
+            }
+        }
+    }
+
+    if (time) {
+        ev.type = EV_SYN;
+        ev.code = SYN_REPORT;
+        ev.value = 0;
+        dispatchEvent(pathId, state, ev);
+    }
 }
 
 bool InputDevAdaptor::checkInputDevice(const QString& path, const QString& matchString, bool strictChecks) const
@@ -178,7 +539,7 @@ bool InputDevAdaptor::setInterval(const unsigned int value, const int sessionId)
 
     sensordLogD() << "Setting poll interval for " << deviceString_ << " to " << value;
     QByteArray frequencyString(QString("%1\n").arg(value).toLocal8Bit());
-    if(writeToFile(usedDevicePollFilePath_.toLocal8Bit(), frequencyString))
+    if(writeControl(usedDevicePollFilePath_.toLocal8Bit(), frequencyString))
     {
         cachedInterval_ = value;
         return true;
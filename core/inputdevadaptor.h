@@ -33,11 +33,29 @@
 #include <QString>
 #include <QStringList>
 #include <QFile>
+#include <QVector>
 #include <linux/input.h>
 
 /**
  * @brief Base class for adaptors accessing device drivers through
  * Linux Input Device subsytem.
+ *
+ * Devices are switched to CLOCK_MONOTONIC event timestamps, so that
+ * Utils::getTimeStamp(const struct timeval*) gives the same time base as
+ * Utils::getTimeStamp(). Wall clock stamps of devices which cannot be
+ * switched are converted with ClockDomain. Number of events read at once is configured with
+ * <em>typeName</em>/event_read_depth (default 64).
+ *
+ * When the kernel reports SYN_DROPPED the events up to the next SYN_REPORT
+ * are discarded and the absolute axis, key and switch state is requeried
+ * from the device. Changed values are handled like read events and
+ * followed by a single SYN_REPORT, so subclasses never see torn frames.
+ *
+ * How events are handled is looked up per (type, code) from a table set
+ * up with #setEventHandling(). By default every event is passed to
+ * #interpretEvent(). Tracked events only update the device state, which
+ * is passed to #interpretFrame() once per SYN_REPORT, so a read buffer of
+ * events is decoded without a virtual call per event.
  */
 class InputDevAdaptor : public SysfsAdaptor
 {
@@ -66,6 +84,108 @@ public:
     int getDeviceCount() const;
 
 protected:
+    /**
+     * How an event is handled.
+     */
+    enum EventHandling
+    {
+        EventInterpreted = 0, /**< passed to #interpretEvent() */
+        EventTracked,         /**< stored for #interpretFrame() */
+        EventIgnored          /**< dropped */
+    };
+
+    /**
+     * Device state at the end of a frame.
+     */
+    class InputFrame
+    {
+    public:
+        /**
+         * Did any tracked event arrive during the frame.
+         *
+         * @return was anything tracked.
+         */
+        bool isChanged() const;
+
+        /**
+         * Value of an absolute axis.
+         *
+         * @param code axis code.
+         * @return last value.
+         */
+        int absValue(int code) const;
+
+        /**
+         * Was a tracked absolute axis reported during the frame.
+         *
+         * @param code axis code.
+         * @return was axis reported.
+         */
+        bool absChanged(int code) const;
+
+        /**
+         * State of a key.
+         *
+         * @param code key code.
+         * @return is key down.
+         */
+        bool keyValue(int code) const;
+
+        /**
+         * Was a tracked key reported during the frame.
+         *
+         * @param code key code.
+         * @return was key reported.
+         */
+        bool keyChanged(int code) const;
+
+        /**
+         * State of a switch.
+         *
+         * @param code switch code.
+         * @return is switch on.
+         */
+        bool switchValue(int code) const;
+
+        /**
+         * Was a tracked switch reported during the frame.
+         *
+         * @param code switch code.
+         * @return was switch reported.
+         */
+        bool switchChanged(int code) const;
+
+    private:
+        InputFrame() {}
+
+        bool                 changed_;     /**< tracked events in the frame */
+        const int*           abs_;         /**< absolute axis values */
+        const unsigned long* keys_;        /**< key state bits */
+        const unsigned long* sw_;          /**< switch state bits */
+        const unsigned long* absChanged_;  /**< axes tracked in the frame */
+        const unsigned long* keysChanged_; /**< keys tracked in the frame */
+        const unsigned long* swChanged_;   /**< switches tracked in the frame */
+
+        friend class InputDevAdaptor;
+    };
+
+    /**
+     * Set how an event is handled. Only EV_ABS, EV_KEY and EV_SW events
+     * can be tracked, other types are handled as a whole.
+     *
+     * @param type event type.
+     * @param code event code, -1 for all codes of the type.
+     * @param handling how the event is handled.
+     */
+    void setEventHandling(int type, int code, EventHandling handling);
+
+    /**
+     * Set how all events except EV_SYN are handled.
+     *
+     * @param handling how events are handled.
+     */
+    void setEventHandling(EventHandling handling);
+
     /**
      * Verify whether the input device handle on given path is of a certain
      * device type.
@@ -85,7 +205,7 @@ protected:
      * @param src Event source.
      * @param ev  Read event.
      */
-    virtual void interpretEvent(int src, struct input_event *ev) = 0;
+    virtual void interpretEvent(int src, struct input_event *ev);
 
     /**
      * Interpret a a synchronization event from the device.
@@ -93,7 +213,17 @@ protected:
      * @param src Event source.
      * @param ev  Read event.
      */
-    virtual void interpretSync(int src, struct input_event *ev) = 0;
+    virtual void interpretSync(int src, struct input_event *ev);
+
+    /**
+     * Interpret a frame ended with SYN_REPORT from the device. Default
+     * implementation calls #interpretSync().
+     *
+     * @param src   Event source.
+     * @param frame Device state with the values tracked in the frame.
+     * @param ev    SYN_REPORT event.
+     */
+    virtual void interpretFrame(int src, const InputFrame& frame, struct input_event *ev);
 
     /**
      * Scans through the /dev/input/event* device handles and registers the
@@ -106,6 +236,8 @@ protected:
 
     void processSample(int pathId, int fd);
 
+    void descriptorOpened(int pathId, int fd);
+
     virtual unsigned int interval() const;
 
     virtual bool setInterval(const unsigned int value, const int sessionId);
@@ -120,12 +252,63 @@ private:
      */
     int getEvents(int fd);
 
+    /**
+     * Last known state of an input device.
+     */
+    struct DeviceState
+    {
+        DeviceState();
+
+        bool    monotonic;                /**< are event timestamps monotonic */
+        bool    dropped;                  /**< discarding events until SYN_REPORT */
+        bool    changed;                  /**< tracked events in the current frame */
+        int           abs[ABS_CNT];                                       /**< absolute axis values */
+        unsigned long keys[(KEY_CNT + 8 * sizeof(long) - 1) / (8 * sizeof(long))]; /**< key state bits */
+        unsigned long sw[(SW_CNT + 8 * sizeof(long) - 1) / (8 * sizeof(long))];    /**< switch state bits */
+        unsigned long absChanged[(ABS_CNT + 8 * sizeof(long) - 1) / (8 * sizeof(long))]; /**< axes tracked in the frame */
+        unsigned long keysChanged[(KEY_CNT + 8 * sizeof(long) - 1) / (8 * sizeof(long))]; /**< keys tracked in the frame */
+        unsigned long swChanged[(SW_CNT + 8 * sizeof(long) - 1) / (8 * sizeof(long))];    /**< switches tracked in the frame */
+    };
+
+    /**
+     * Handle an event according to the handling table.
+     *
+     * @param pathId Event source.
+     * @param state  device state, already updated with the event.
+     * @param ev     event.
+     */
+    void dispatchEvent(int pathId, DeviceState& state, struct input_event& ev);
+
+    /**
+     * Track value of an event in the device state.
+     *
+     * @param state device state.
+     * @param ev    event.
+     */
+    static void trackEvent(DeviceState& state, const struct input_event& ev);
+
+    /**
+     * Query the device state. Values which differ from the known state are
+     * passed to #interpretEvent() when <code>time</code> is given.
+     *
+     * @param pathId Event source.
+     * @param fd     Device file descriptor.
+     * @param time   Timestamp for the synthesized events, or NULL to only
+     *               update the known state.
+     */
+    void syncState(int pathId, int fd, const struct timeval* time);
+
     QString usedDevicePollFilePath_; /**< sysfs path to input device poll file */
     QString deviceString_;           /**< input device name */
     int deviceCount_;                /**< number of available input devices */
     const int maxDeviceCount_;       /**< maximum number of supported devices */
-    input_event evlist_[64];         /**< input event buffer */
+    QVector<input_event> evlist_;    /**< input event buffer */
+    QVector<DeviceState> states_;    /**< known state of each device */
     unsigned int cachedInterval_;    /**< cached interval reading */
+    unsigned char absHandling_[ABS_CNT]; /**< handling of EV_ABS codes */
+    unsigned char keyHandling_[KEY_CNT]; /**< handling of EV_KEY codes */
+    unsigned char swHandling_[SW_CNT];   /**< handling of EV_SW codes */
+    unsigned char typeHandling_[EV_CNT]; /**< handling of other event types */
 };
 
 #endif
@@ -0,0 +1,80 @@
+/**
+   @file latencyhistogram.cpp
+   @brief LatencyHistogram
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "latencyhistogram.h"
+#include "datatypes/atomic.h"
+
+LatencyHistogram::LatencyHistogram()
+{
+    reset();
+}
+
+unsigned LatencyHistogram::count() const
+{
+    unsigned total = 0;
+    for (int i = 0; i < BUCKETS; ++i)
+        total += Atomic::load(buckets_[i]);
+    return total;
+}
+
+quint64 LatencyHistogram::percentile(int percent) const
+{
+    return permille(percent * 10);
+}
+
+quint64 LatencyHistogram::permille(int quantile) const
+{
+    unsigned counts[BUCKETS];
+    quint64 total = 0;
+    for (int i = 0; i < BUCKETS; ++i) {
+        counts[i] = Atomic::load(buckets_[i]);
+        total += counts[i];
+    }
+    if (!total)
+        return 0;
+
+    // Smallest bucket at which the cumulative count reaches the rank
+    quint64 rank = (total * quantile + 999) / 1000;
+    if (rank == 0)
+        rank = 1;
+    quint64 seen = 0;
+    for (int i = 0; i < BUCKETS; ++i) {
+        seen += counts[i];
+        if (seen >= rank)
+            return 2ULL << i;
+    }
+    return 2ULL << (BUCKETS - 1);
+}
+
+void LatencyHistogram::reset()
+{
+    for (int i = 0; i < BUCKETS; ++i)
+        buckets_[i].fetchAndStoreRelaxed(0);
+}
+
+QString LatencyHistogram::toString() const
+{
+    return QString("%1 run(s), p50 < %2 us, p99 < %3 us, max < %4 us")
+        .arg(count())
+        .arg(percentile(50) / 1000.0)
+        .arg(percentile(99) / 1000.0)
+        .arg(percentile(100) / 1000.0);
+}
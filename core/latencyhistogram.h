@@ -0,0 +1,113 @@
+/**
+   @file latencyhistogram.h
+   @brief LatencyHistogram
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+
+#include <QAtomicInt>
+#include <QString>
+#include <time.h>
+
+/**
+ * Lock-free histogram of durations in power of two buckets. Bucket n
+ * counts durations in [2^n, 2^(n+1)) nanoseconds. Recording is a single
+ * relaxed atomic increment, so histograms can be updated on the data path
+ * from several threads and read from any thread.
+ */
+class LatencyHistogram
+{
+public:
+    /** Number of buckets, last one collects everything above 2^31 ns */
+    static const int BUCKETS = 32;
+
+    /**
+     * Constructor.
+     */
+    LatencyHistogram();
+
+    /**
+     * Monotonic clock for measuring durations.
+     *
+     * @return current time in nanoseconds.
+     */
+    static quint64 now()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    }
+
+    /**
+     * Record a duration.
+     *
+     * @param ns duration in nanoseconds.
+     */
+    void record(quint64 ns)
+    {
+        int bucket = 63 - __builtin_clzll(ns | 1);
+        if (bucket >= BUCKETS)
+            bucket = BUCKETS - 1;
+        buckets_[bucket].fetchAndAddRelaxed(1);
+    }
+
+    /**
+     * Number of recorded durations.
+     *
+     * @return count.
+     */
+    unsigned count() const;
+
+    /**
+     * Upper bound of the bucket holding the given percentile.
+     *
+     * @param percent percentile, 0-100.
+     * @return duration in nanoseconds, 0 if nothing is recorded.
+     */
+    quint64 percentile(int percent) const;
+
+    /**
+     * Upper bound of the bucket holding the given quantile in tenths of
+     * a percent, for tail latencies beyond the 99th percentile.
+     *
+     * @param quantile quantile in permille, 0-1000.
+     * @return duration in nanoseconds, 0 if nothing is recorded.
+     */
+    quint64 permille(int quantile) const;
+
+    /**
+     * Forget recorded durations.
+     */
+    void reset();
+
+    /**
+     * Summary for status output.
+     *
+     * @return count and median, 99th percentile and maximum bounds.
+     */
+    QString toString() const;
+
+private:
+    Q_DISABLE_COPY(LatencyHistogram)
+
+    QAtomicInt buckets_[BUCKETS]; /**< duration counts */
+};
+
+#endif // LATENCYHISTOGRAM_H
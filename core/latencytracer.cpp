@@ -0,0 +1,157 @@
+/**
+   @file latencytracer.cpp
+   @brief LatencyTracer
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "latencytracer.h"
+#include "config.h"
+#include "logging.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+
+/** ftrace marker locations, tracefs first */
+static const char* TRACE_MARKERS[] = {
+    "/sys/kernel/tracing/trace_marker",
+    "/sys/kernel/debug/tracing/trace_marker"
+};
+
+LatencyProbe::LatencyProbe(const QString& source, const char* stage, int marker) :
+    source_(source.toLocal8Bit()),
+    stage_(stage),
+    marker_(marker)
+{
+}
+
+const LatencyHistogram& LatencyProbe::histogram() const
+{
+    return histogram_;
+}
+
+void LatencyProbe::mark(quint64 timestamp, quint64 now) const
+{
+    char line[256];
+    int length = snprintf(line, sizeof(line), "sensord_latency: source=%s stage=%s timestamp=%llu latency_ns=%lld\n",
+                          source_.constData(), stage_, (unsigned long long)timestamp,
+                          (long long)(now - timestamp * 1000));
+    if (length <= 0)
+        return;
+    if (length >= (int)sizeof(line))
+        length = sizeof(line) - 1;
+    // Marker writes are best effort, tracing may be switched off any time
+    ssize_t written = ::write(marker_, line, length);
+    Q_UNUSED(written);
+}
+
+LatencyTracer& LatencyTracer::instance()
+{
+    static LatencyTracer tracer;
+    static bool configured = false;
+    if (!configured && Config::configuration()) {
+        configured = true;
+        if (Config::configuration()->value<bool>("global/latency_trace", false))
+            tracer.start(Config::configuration()->value<bool>("global/latency_trace_marker", false));
+    }
+    return tracer;
+}
+
+LatencyTracer::LatencyTracer() :
+    enabled_(false),
+    marker_(-1)
+{
+}
+
+LatencyTracer::~LatencyTracer()
+{
+    qDeleteAll(probes_);
+    if (marker_ >= 0)
+        close(marker_);
+}
+
+bool LatencyTracer::start(bool marker)
+{
+    QMutexLocker locker(&mutex_);
+    enabled_ = true;
+    if (!marker || marker_ >= 0)
+        return true;
+
+    for (unsigned i = 0; i < sizeof(TRACE_MARKERS) / sizeof(TRACE_MARKERS[0]) && marker_ < 0; ++i)
+        marker_ = open(TRACE_MARKERS[i], O_WRONLY | O_CLOEXEC);
+    if (marker_ < 0) {
+        sensordLogW() << "Failed to open ftrace marker, latency tracepoints disabled: " << strerror(errno);
+        return false;
+    }
+    sensordLogD() << "Writing latency tracepoints into ftrace marker";
+    return true;
+}
+
+bool LatencyTracer::isEnabled() const
+{
+    QMutexLocker locker(&mutex_);
+    return enabled_;
+}
+
+LatencyProbe* LatencyTracer::probe(const QString& source, Stage stage)
+{
+    QMutexLocker locker(&mutex_);
+    if (!enabled_)
+        return NULL;
+
+    ProbeKey key(source, stage);
+    LatencyProbe* probe = probes_.value(key);
+    if (!probe) {
+        probe = new LatencyProbe(source, stageName(stage), marker_);
+        probes_.insert(key, probe);
+    }
+    return probe;
+}
+
+void LatencyTracer::statistics(QStringList& output) const
+{
+    QMutexLocker locker(&mutex_);
+    for (QMap<ProbeKey, LatencyProbe*>::const_iterator it = probes_.constBegin(); it != probes_.constEnd(); ++it) {
+        const LatencyHistogram& histogram = it.value()->histogram();
+        if (!histogram.count())
+            continue;
+        output.append(QString("    %1 %2: %3 sample(s), p50 < %4 us, p99 < %5 us, p999 < %6 us\n")
+                      .arg(it.key().first)
+                      .arg(stageName((Stage)it.key().second))
+                      .arg(histogram.count())
+                      .arg(histogram.percentile(50) / 1000.0)
+                      .arg(histogram.percentile(99) / 1000.0)
+                      .arg(histogram.permille(999) / 1000.0));
+    }
+}
+
+const char* LatencyTracer::stageName(Stage stage)
+{
+    switch (stage) {
+        case AdaptorStage:
+            return "adaptor";
+        case ChainStage:
+            return "chain";
+        case EnqueueStage:
+            return "enqueue";
+        case SocketStage:
+            return "socket";
+    }
+    return "unknown";
+}
@@ -0,0 +1,218 @@
+/**
+   @file latencytracer.h
+   @brief LatencyTracer
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef LATENCYTRACER_H
+#define LATENCYTRACER_H
+
+#include "latencyhistogram.h"
+#include "genericdata.h"
+#include <QByteArray>
+#include <QMap>
+#include <QMutex>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+#include <string.h>
+
+/**
+ * Latency of samples at one point of the data path of one sensor. Latency
+ * is the time from the sample timestamp, i.e. when the hardware produced
+ * the sample, to the moment the sample passes the probe.
+ */
+class LatencyProbe
+{
+public:
+    /**
+     * Record latency of a sample.
+     *
+     * @param timestamp sample timestamp, monotonic microseconds.
+     */
+    void record(quint64 timestamp)
+    {
+        quint64 now = LatencyHistogram::now();
+        quint64 sampled = timestamp * 1000;
+        histogram_.record(now > sampled ? now - sampled : 0);
+        if (marker_ >= 0)
+            mark(timestamp, now);
+    }
+
+    /**
+     * Record latency of a serialized sample starting with its timestamp.
+     *
+     * @param sample sample data.
+     * @param size sample size in bytes.
+     */
+    void recordRaw(const void* sample, int size)
+    {
+        if (size < (int)sizeof(quint64))
+            return;
+        quint64 timestamp;
+        memcpy(&timestamp, sample, sizeof(timestamp));
+        record(timestamp);
+    }
+
+    /**
+     * Record latency of a timestamped object if a probe is given.
+     *
+     * @param probe probe or NULL.
+     * @param data object.
+     */
+    static void recordObject(LatencyProbe* probe, const TimedData* data)
+    {
+        if (probe)
+            probe->record(data->timestamp_);
+    }
+
+    /**
+     * Objects without timestamp are not traced.
+     */
+    static void recordObject(LatencyProbe*, const void*) {}
+
+    /**
+     * Recorded latencies.
+     *
+     * @return latency histogram.
+     */
+    const LatencyHistogram& histogram() const;
+
+private:
+    Q_DISABLE_COPY(LatencyProbe)
+
+    friend class LatencyTracer;
+
+    /**
+     * Constructor.
+     *
+     * @param source traced sensor, adaptor or chain.
+     * @param stage stage name.
+     * @param marker ftrace marker descriptor or -1.
+     */
+    LatencyProbe(const QString& source, const char* stage, int marker);
+
+    /**
+     * Write tracepoint into the ftrace marker.
+     *
+     * @param timestamp sample timestamp in microseconds.
+     * @param now current time in nanoseconds.
+     */
+    void mark(quint64 timestamp, quint64 now) const;
+
+    QByteArray       source_;    /**< traced source */
+    const char*      stage_;     /**< stage name */
+    int              marker_;    /**< ftrace marker descriptor or -1 */
+    LatencyHistogram histogram_; /**< recorded latencies */
+};
+
+/**
+ * Optional end-to-end latency tracing. When enabled with
+ * global/latency_trace, samples are traced when committed into adaptor
+ * buffers, when written into chain output buffers, when enqueued for
+ * sessions and when written to client sockets, and per stage p50, p99 and
+ * p999 latencies are kept for each sensor.
+ *
+ * With global/latency_trace_marker each traced sample is also written as
+ * a sensord_latency tracepoint into the ftrace marker, so that sample
+ * delivery can be correlated with kernel scheduling traces.
+ */
+class LatencyTracer
+{
+public:
+    /**
+     * Stages of the data path.
+     */
+    enum Stage
+    {
+        AdaptorStage = 0, /**< committed into adaptor buffer */
+        ChainStage,       /**< written into chain output buffer */
+        EnqueueStage,     /**< enqueued for sessions */
+        SocketStage       /**< written to client socket */
+    };
+
+    /**
+     * Default tracer, configured on first use.
+     *
+     * @return tracer.
+     */
+    static LatencyTracer& instance();
+
+    /**
+     * Constructor. Tracer is disabled until started.
+     */
+    LatencyTracer();
+
+    /**
+     * Destructor.
+     */
+    ~LatencyTracer();
+
+    /**
+     * Enable tracing. Probes handed out before are not affected.
+     *
+     * @param marker write tracepoints into the ftrace marker.
+     * @return false if ftrace marker could not be opened. Tracing is
+     *         enabled regardless.
+     */
+    bool start(bool marker);
+
+    /**
+     * Is tracing enabled.
+     *
+     * @return is tracing enabled.
+     */
+    bool isEnabled() const;
+
+    /**
+     * Probe for given source and stage. Same probe is returned for the
+     * same pair, and it stays valid for the lifetime of the tracer.
+     *
+     * @param source traced sensor, adaptor or chain.
+     * @param stage data path stage.
+     * @return probe or NULL if tracing is disabled.
+     */
+    LatencyProbe* probe(const QString& source, Stage stage);
+
+    /**
+     * Append latency summary of probes which have seen samples.
+     *
+     * @param output StringList to append summary lines to.
+     */
+    void statistics(QStringList& output) const;
+
+    /**
+     * Name of a stage.
+     *
+     * @param stage stage.
+     * @return stage name.
+     */
+    static const char* stageName(Stage stage);
+
+private:
+    Q_DISABLE_COPY(LatencyTracer)
+
+    typedef QPair<QString, int> ProbeKey;
+
+    bool                           enabled_; /**< is tracing enabled */
+    int                            marker_;  /**< ftrace marker descriptor or -1 */
+    mutable QMutex                 mutex_;   /**< guards probes_ */
+    QMap<ProbeKey, LatencyProbe*>  probes_;  /**< probes by source and stage */
+};
+
+#endif // LATENCYTRACER_H
@@ -35,6 +35,7 @@
 
 #include "logging.h"
 #include "config.h"
+#include "startuptrace.h"
 
 Loader::Loader()
 {
@@ -51,21 +52,29 @@ bool Loader::loadPluginFile(const QString& name, QString *errorString, QStringLi
 {
     sensordLogT() << "Loading plugin:" << name;
 
+    QObject* object = 0;
+    QtPluginInstanceFunction staticInstance = staticPlugins_.value(name);
+    if (staticInstance) {
+        sensordLogT() << name << "is linked in, skipping plugin file.";
+        object = staticInstance();
+    } else {
 #if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
-    QString pluginPath = QString::fromLatin1("/usr/lib/sensord/lib%1.so").arg(name);
+        QString pluginPath = QString::fromLatin1("/usr/lib/sensord/lib%1.so").arg(name);
 #else
-    QString pluginPath = QString::fromLatin1("/usr/lib/sensord-qt5/lib%1-qt5.so").arg(name);
+        QString pluginPath = QString::fromLatin1("/usr/lib/sensord-qt5/lib%1-qt5.so").arg(name);
 #endif
 
-    QPluginLoader qpl(pluginPath);
-    qpl.setLoadHints(QLibrary::ExportExternalSymbolsHint);
-    if (!qpl.load()) {
-        *errorString = qpl.errorString();
-        sensordLogC() << "plugin loading error: " << *errorString;
-        return false;
+        StartupSpan span("plugin", "dlopen " + name);
+        QPluginLoader qpl(pluginPath);
+        qpl.setLoadHints(QLibrary::ExportExternalSymbolsHint);
+        if (!qpl.load()) {
+            *errorString = qpl.errorString();
+            sensordLogC() << "plugin loading error: " << *errorString;
+            return false;
+        }
+        object = qpl.instance();
     }
 
-    QObject* object = qpl.instance();
     if (!object) {
         *errorString = "not able to instanciate";
         sensordLogC() << "plugin loading error: " << *errorString;
@@ -86,6 +95,8 @@ bool Loader::loadPluginFile(const QString& name, QString *errorString, QStringLi
     // Get dependencies
     QStringList requiredPlugins(plugin->Dependencies());
     sensordLogT() << name << " requires: " << requiredPlugins;
+    if (lazy())
+        return true;
 
     bool loaded = true;
     for (int i = 0; i < requiredPlugins.size() && loaded; ++i) {
@@ -116,15 +127,17 @@ bool Loader::loadPlugin(const QString& name, QString* errorString)
     if (loadPluginFile(name, &error, newPluginNames, newPlugins)) {
 
         // Register newly loaded plugins
-        foreach (PluginBase* base, newPlugins) {
-            base->Register(*this);
+        for (int i = 0; i < newPlugins.size(); ++i) {
+            StartupSpan span("plugin", "register " + newPluginNames.at(i));
+            newPlugins.at(i)->Register(*this);
         }
         loadedPluginNames_.append(newPluginNames);
         loaded = true;
 
         // Init newly loaded plugins
-        foreach (PluginBase* base, newPlugins) {
-            base->Init(*this);
+        for (int i = 0; i < newPlugins.size(); ++i) {
+            StartupSpan span("plugin", "init " + newPluginNames.at(i));
+            newPlugins.at(i)->Init(*this);
         }
 
     } else {
@@ -136,6 +149,21 @@ bool Loader::loadPlugin(const QString& name, QString* errorString)
     return loaded;
 }
 
+bool Loader::loadPluginFor(const QString& id, QString* errorString)
+{
+    return loadPlugin(resolveRealPluginName(id), errorString);
+}
+
+bool Loader::lazy() const
+{
+    return Config::configuration() && Config::configuration()->value<bool>("global/lazy_plugin_loading", false);
+}
+
+void Loader::registerStaticPlugin(const QString& name, QtPluginInstanceFunction instance)
+{
+    staticPlugins_.insert(name, instance);
+}
+
 QString Loader::resolveRealPluginName(const QString& pluginName) const
 {
     QString key = QString("plugins/%1").arg(pluginName);
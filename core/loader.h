@@ -30,6 +30,8 @@
 
 #include <QString>
 #include <QStringList>
+#include <QHash>
+#include <QtPlugin>
 #include "plugin.h"
 
 /**
@@ -53,6 +55,35 @@ public:
      */
     bool loadPlugin(const QString& name, QString* errorMessage = 0);
 
+    /**
+     * Load plugin providing node with given id. Plugin name is resolved
+     * from the plugins configuration group the same way as dependencies.
+     *
+     * @param id id of a sensor, chain, adaptor or filter.
+     * @param errorMessage object to write error message if plugin loading
+     *                     fails. If NULL then error message is not written.
+     * @return was the plugin loaded.
+     */
+    bool loadPluginFor(const QString& id, QString* errorMessage = 0);
+
+    /**
+     * Are dependencies loaded on demand. When set from
+     * global/lazy_plugin_loading, dependencies of a plugin are not loaded
+     * with it but when a node they provide is first requested.
+     *
+     * @return are dependencies loaded on demand.
+     */
+    bool lazy() const;
+
+    /**
+     * Register plugin linked into the binary. Plugin with the given name
+     * is then instantiated directly instead of being loaded from a file.
+     *
+     * @param name plugin name.
+     * @param instance function returning the plugin instance.
+     */
+    void registerStaticPlugin(const QString& name, QtPluginInstanceFunction instance);
+
 private:
     Loader();
     Loader(const Loader&);
@@ -77,6 +108,7 @@ private:
     QString resolveRealPluginName(const QString& pluginName) const;
 
     QStringList loadedPluginNames_; /**< list of loaded plugins */
+    QHash<QString, QtPluginInstanceFunction> staticPlugins_; /**< plugins linked into the binary */
 };
 
 #endif
@@ -28,11 +28,65 @@
 #define LOGGING_H
 
 #include <QDebug>
+#include <QAtomicInt>
+#include "datatypes/atomic.h"
 
-#define sensordLogT() (qDebug())
-#define sensordLogD() (qDebug())
-#define sensordLogW() (qWarning())
-#define sensordLogC() (qCritical())
-#define sensordLog() (qDebug())
+/**
+ * Lowest message type which is formatted. Messages below it are skipped
+ * before their arguments are evaluated.
+ *
+ * @return runtime logging level, QtDebugMsg by default.
+ */
+inline QAtomicInt& sensordLogLevel()
+{
+    static QAtomicInt level(QtDebugMsg);
+    return level;
+}
+
+/**
+ * Set runtime logging level.
+ *
+ * @param type lowest message type to format.
+ */
+inline void sensordSetLogLevel(QtMsgType type)
+{
+    sensordLogLevel().fetchAndStoreRelaxed(type);
+}
+
+/**
+ * Is message type formatted.
+ *
+ * @param type message type.
+ * @return is type at or above the runtime logging level.
+ */
+inline bool sensordLogEnabled(QtMsgType type)
+{
+    return type >= Atomic::load(sensordLogLevel());
+}
+
+/**
+ * Swallows a finished message stream, so gated log statements are a
+ * single expression.
+ */
+struct SensordLogSink
+{
+    void operator&(const QDebug&) const {}
+};
+
+/** Format stream only if the type is enabled */
+#define sensordLogIf(enabled, stream) \
+    (!(enabled)) ? (void)0 : SensordLogSink() & stream
+
+/* Trace statements are compiled out from release builds unless
+   SENSORD_TRACE is defined. Arguments are still type checked. */
+#if defined(QT_NO_DEBUG) && !defined(SENSORD_TRACE)
+#define sensordLogT() sensordLogIf(false, qDebug())
+#else
+#define sensordLogT() sensordLogIf(sensordLogEnabled(QtDebugMsg), qDebug())
+#endif
+#define sensordLogD() sensordLogIf(sensordLogEnabled(QtDebugMsg), qDebug())
+#define sensordLogW() sensordLogIf(sensordLogEnabled(QtWarningMsg), qWarning())
+#define sensordLogC() sensordLogIf(sensordLogEnabled(QtCriticalMsg), qCritical())
+#define sensordLog() sensordLogIf(sensordLogEnabled(QtDebugMsg), qDebug())
 
 #endif //LOGGING_H
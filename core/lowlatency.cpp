@@ -0,0 +1,81 @@
+/**
+   @file lowlatency.cpp
+   @brief Opt-in mode keeping the sample path free of page faults
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+
+#include "lowlatency.h"
+#include "logging.h"
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+static bool enabled = false;
+static unsigned bufferSamples = 0;
+
+bool LowLatency::enable(size_t stackSize, unsigned bufferSize)
+{
+    enabled = true;
+    bufferSamples = bufferSize;
+
+    if (stackSize) {
+        size_t minimum = PTHREAD_STACK_MIN;
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        int error = pthread_attr_setstacksize(&attr, stackSize < minimum ? minimum : stackSize);
+        if (!error)
+            error = pthread_setattr_default_np(&attr);
+        if (error)
+            sensordLogW() << "Can not set thread stack size: " << strerror(error);
+        pthread_attr_destroy(&attr);
+    }
+
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) < 0) {
+        sensordLogW() << "Can not lock memory for low latency mode: " << strerror(errno);
+        return false;
+    }
+    sensordLogD() << "Low latency mode enabled, thread stacks " << stackSize
+                  << " bytes, session buffers for " << bufferSize << " samples";
+    return true;
+}
+
+bool LowLatency::isEnabled()
+{
+    return enabled;
+}
+
+unsigned LowLatency::reservedBufferSize()
+{
+    return bufferSamples;
+}
+
+void LowLatency::prefault(void* memory, size_t size)
+{
+    if (!enabled || !size)
+        return;
+
+    // Writing the old value back faults the page in without changing it
+    static const size_t pageSize = sysconf(_SC_PAGESIZE);
+    volatile char* bytes = (volatile char*)memory;
+    for (size_t offset = 0; offset < size; offset += pageSize)
+        bytes[offset] = bytes[offset];
+    bytes[size - 1] = bytes[size - 1];
+}
@@ -0,0 +1,78 @@
+/**
+   @file lowlatency.h
+   @brief Opt-in mode keeping the sample path free of page faults
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+
+#ifndef LOWLATENCY_H
+#define LOWLATENCY_H
+
+#include <stddef.h>
+
+/**
+ * Low latency mode, enabled with global/low_latency. Memory touched for
+ * the first time after an idle period costs a page fault on the sample
+ * path. In low latency mode all memory of sensord is locked, and memory
+ * the sample path uses later is faulted in when it is allocated:
+ *
+ * - threads started after #enable() get stacks of a fixed size, so that
+ *   locking them does not pin the default 8 MB per thread,
+ * - ring buffers are prefaulted at creation,
+ * - session buffers are allocated for #reservedBufferSize() samples, so
+ *   changing the buffer size of a session never reallocates.
+ */
+class LowLatency
+{
+public:
+    /**
+     * Enable low latency mode. Call before threads are started.
+     *
+     * @param stackSize stack size of threads started after this call, in
+     *        bytes, 0 keeps the default.
+     * @param bufferSize samples session buffers are allocated for.
+     * @return was memory locked. Buffers are prefaulted also when
+     *         locking failed.
+     */
+    static bool enable(size_t stackSize, unsigned bufferSize);
+
+    /**
+     * Is low latency mode enabled.
+     *
+     * @return true after #enable().
+     */
+    static bool isEnabled();
+
+    /**
+     * Samples session buffers are allocated for.
+     *
+     * @return sample count, 0 when low latency mode is disabled.
+     */
+    static unsigned reservedBufferSize();
+
+    /**
+     * Fault in memory in low latency mode. Contents are preserved. Does
+     * nothing when low latency mode is disabled.
+     *
+     * @param memory start of the memory.
+     * @param size size in bytes.
+     */
+    static void prefault(void* memory, size_t size);
+};
+
+#endif // LOWLATENCY_H
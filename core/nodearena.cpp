@@ -0,0 +1,113 @@
+/**
+   @file nodearena.cpp
+   @brief Monotonic allocator for node graphs
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "nodearena.h"
+#include <stdlib.h>
+#include <new>
+
+__thread NodeArena* NodeArena::current_ = 0;
+
+/** Header in front of ArenaNode objects, keeps the objects aligned */
+union ArenaNodeHeader
+{
+    NodeArena* arena;                      /**< owning arena, NULL for heap */
+    char       pad[NodeArena::ALIGNMENT];  /**< alignment of the object */
+};
+
+NodeArena::NodeArena(size_t blockSize) :
+    next_(0),
+    end_(0),
+    blockSize_(blockSize),
+    used_(0)
+{
+}
+
+NodeArena::~NodeArena()
+{
+    foreach (char* block, blocks_)
+        free(block);
+}
+
+void* NodeArena::allocate(size_t size)
+{
+    size = (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    if ((size_t)(end_ - next_) < size) {
+        // Large objects get a block of their own, the current one stays in use
+        size_t blockSize = size > blockSize_ / 4 ? size : blockSize_;
+        void* block = 0;
+        if (posix_memalign(&block, ALIGNMENT, blockSize) != 0)
+            throw std::bad_alloc();
+        blocks_.append((char*)block);
+        if (blockSize == size) {
+            used_ += size;
+            return block;
+        }
+        next_ = (char*)block;
+        end_ = next_ + blockSize;
+    }
+    void* memory = next_;
+    next_ += size;
+    used_ += size;
+    return memory;
+}
+
+size_t NodeArena::used() const
+{
+    return used_;
+}
+
+NodeArena* NodeArena::current()
+{
+    return current_;
+}
+
+NodeArenaScope::NodeArenaScope(NodeArena* arena) :
+    previous_(NodeArena::current_)
+{
+    NodeArena::current_ = arena;
+}
+
+NodeArenaScope::~NodeArenaScope()
+{
+    NodeArena::current_ = previous_;
+}
+
+void* ArenaNode::operator new(size_t size)
+{
+    NodeArena* arena = NodeArena::current();
+    ArenaNodeHeader* header;
+    if (arena) {
+        header = (ArenaNodeHeader*)arena->allocate(sizeof(ArenaNodeHeader) + size);
+    } else if (posix_memalign((void**)&header, NodeArena::ALIGNMENT, sizeof(ArenaNodeHeader) + size) != 0) {
+        throw std::bad_alloc();
+    }
+    header->arena = arena;
+    return header + 1;
+}
+
+void ArenaNode::operator delete(void* memory)
+{
+    if (!memory)
+        return;
+    ArenaNodeHeader* header = (ArenaNodeHeader*)memory - 1;
+    if (!header->arena)
+        free(header);
+}
@@ -0,0 +1,126 @@
+/**
+   @file nodearena.h
+   @brief Monotonic allocator for node graphs
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef NODEARENA_H
+#define NODEARENA_H
+
+#include <QList>
+#include <stddef.h>
+
+/**
+ * Monotonic allocator for the filters, buffers, readers and bins of one
+ * sensor or chain. Memory is handed out from contiguous blocks and is
+ * not reused while the arena lives; it is released in one go when the
+ * arena is destroyed. Objects in the arena must be destroyed before it.
+ */
+class NodeArena
+{
+public:
+    /** Alignment of allocations. */
+    static const size_t ALIGNMENT = 16;
+
+    /**
+     * Constructor. No memory is reserved before the first allocation.
+     *
+     * @param blockSize size of arena blocks in bytes.
+     */
+    NodeArena(size_t blockSize = 16384);
+
+    /**
+     * Destructor. Releases all blocks.
+     */
+    ~NodeArena();
+
+    /**
+     * Allocate memory from the arena.
+     *
+     * @param size size in bytes.
+     * @return memory aligned to #ALIGNMENT.
+     */
+    void* allocate(size_t size);
+
+    /**
+     * Bytes allocated from the arena.
+     *
+     * @return allocated bytes.
+     */
+    size_t used() const;
+
+    /**
+     * Arena of the innermost NodeArenaScope of the calling thread.
+     *
+     * @return arena or NULL if nodes are allocated from the heap.
+     */
+    static NodeArena* current();
+
+private:
+    Q_DISABLE_COPY(NodeArena)
+
+    QList<char*> blocks_;    /**< allocated blocks */
+    char*        next_;      /**< free space in the last block */
+    char*        end_;       /**< end of the last block */
+    size_t       blockSize_; /**< size of new blocks */
+    size_t       used_;      /**< allocated bytes */
+
+    static __thread NodeArena* current_; /**< arena of the innermost scope */
+
+    friend class NodeArenaScope;
+};
+
+/**
+ * Allocate nodes constructed in the calling thread from an arena while
+ * the scope lives. Scopes nest; a scope with NULL arena makes nodes
+ * come from the heap again, e.g. for shared nodes created on the way.
+ */
+class NodeArenaScope
+{
+public:
+    /**
+     * Constructor.
+     *
+     * @param arena arena to allocate from, NULL for the heap.
+     */
+    NodeArenaScope(NodeArena* arena);
+
+    /**
+     * Destructor. Restores the arena of the enclosing scope.
+     */
+    ~NodeArenaScope();
+
+private:
+    Q_DISABLE_COPY(NodeArenaScope)
+
+    NodeArena* previous_; /**< arena of the enclosing scope */
+};
+
+/**
+ * Base for node classes allocated from NodeArena::current(). Deleting
+ * such a node runs its destructor as usual; memory from an arena is
+ * released with the arena.
+ */
+class ArenaNode
+{
+public:
+    static void* operator new(size_t size);
+    static void operator delete(void* memory);
+};
+
+#endif // NODEARENA_H
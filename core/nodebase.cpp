@@ -28,6 +28,12 @@
 #include "logging.h"
 #include "ringbuffer.h"
 #include "config.h"
+#include "chainscheduler.h"
+#include "datatypes/atomic.h"
+#include <limits.h>
+
+QAtomicInt NodeBase::s_intervalGeneration(0);
+QAtomicInt NodeBase::s_dataRangeGeneration(0);
 
 NodeBase::NodeBase(const QString& id, QObject* parent) :
     QObject(parent),
@@ -37,6 +43,10 @@ NodeBase::NodeBase(const QString& id, QObject* parent) :
     m_intervalSource(NULL),
     m_hasDefault(false),
     m_defaultInterval(0),
+    m_appliedInterval(0),
+    m_appliedSession(-1),
+    m_strand(NULL),
+    m_ownsStrand(false),
     DEFAULT_DATA_RANGE_REQUEST(-1),
     id_(id),
     isValid_(false)
@@ -45,6 +55,8 @@ NodeBase::NodeBase(const QString& id, QObject* parent) :
 
 NodeBase::~NodeBase()
 {
+    if (m_ownsStrand)
+        delete m_strand;
 }
 
 const QString& NodeBase::id() const
@@ -57,6 +69,26 @@ bool NodeBase::isValid() const
     return isValid_;
 }
 
+ChainStrand* NodeBase::strand() const
+{
+    return m_strand;
+}
+
+NodeArena& NodeBase::arena()
+{
+    return m_arena;
+}
+
+unsigned int NodeBase::arenaUsage() const
+{
+    return m_arena.used();
+}
+
+bool NodeBase::ownsArena(const NodeArena* arena) const
+{
+    return arena == &m_arena;
+}
+
 bool NodeBase::isMetadataValid() const
 {
     if (!hasLocalRange())
@@ -159,6 +191,7 @@ void NodeBase::requestDataRange(int sessionId, const DataRange& range)
             DataRangeRequest request(sessionId, range);
             m_dataRangeQueue.append(request);
         }
+        s_dataRangeGeneration.ref();
 
         if (rangeChanged)
         {
@@ -191,13 +224,15 @@ void NodeBase::removeDataRangeRequest(int sessionId)
         }
 
         DataRangeRequest request = m_dataRangeQueue.takeAt(index);
+        s_dataRangeGeneration.ref();
 
         bool rangeChanged = false;
 
         if (index == 0)
         {
-            if (((m_dataRangeQueue.size() > 0) && !(m_dataRangeQueue.at(0).range == request.range)) ||
-                !(m_dataRangeList.at(0) == request.range))
+            // Next request or the default takes over
+            const DataRange& next = m_dataRangeQueue.isEmpty() ? m_dataRangeList.at(0) : m_dataRangeQueue.at(0).range;
+            if (!(next == request.range))
             {
                 rangeChanged = true;
             }
@@ -220,6 +255,7 @@ void NodeBase::removeDataRangeRequest(int sessionId)
 void NodeBase::setRangeSource(NodeBase* node)
 {
     m_dataRangeSource = node;
+    s_dataRangeGeneration.ref();
     connect(m_dataRangeSource, SIGNAL(propertyChanged(const QString&)), this, SIGNAL(propertyChanged(const QString&)));
 }
 
@@ -314,6 +350,29 @@ unsigned int NodeBase::getInterval(int sessionId) const
     return it.value();
 }
 
+int NodeBase::intervalGeneration()
+{
+    return Atomic::load(s_intervalGeneration);
+}
+
+bool NodeBase::getDataRangeRequest(int sessionId, DataRange& range) const
+{
+    if (!hasLocalRange())
+        return m_dataRangeSource->getDataRangeRequest(sessionId, range);
+    foreach (const DataRangeRequest& request, m_dataRangeQueue) {
+        if (request.id == sessionId) {
+            range = request.range;
+            return true;
+        }
+    }
+    return false;
+}
+
+int NodeBase::dataRangeGeneration()
+{
+    return Atomic::load(s_dataRangeGeneration);
+}
+
 bool NodeBase::setIntervalRequest(const int sessionId, const unsigned int value)
 {
     // Has single defined source, pass the request that way
@@ -329,19 +388,51 @@ bool NodeBase::setIntervalRequest(const int sessionId, const unsigned int value)
         return false;
     }
 
+    unsigned int snapped = snapIntervalRequest(value);
+    if (snapped != value)
+    {
+        sensordLogD() << "Interval request" << value << "of session" << sessionId << "for node" << id() << "snapped to" << snapped;
+    }
+
     // Store the request for the session
-    m_intervalMap[sessionId] = value;
+    QMap<int, unsigned int>::iterator previous = m_intervalMap.find(sessionId);
+    if (previous != m_intervalMap.end())
+    {
+        m_intervalOrder.remove(qMakePair(previous.value(), sessionId));
+        previous.value() = snapped;
+    }
+    else
+    {
+        m_intervalMap.insert(sessionId, snapped);
+    }
+    m_intervalOrder.insert(qMakePair(snapped, sessionId), sessionId);
+    s_intervalGeneration.ref();
 
-    // Store the current interval
-    unsigned int previousInterval = interval();
+    // Re-evaluate, signals listeners about change
+    applyIntervalRequests(interval());
 
-    // Re-evaluate
+    return true;
+}
+
+void NodeBase::applyIntervalRequests(unsigned int previousInterval)
+{
     int winningSessionId;
     unsigned int winningRequest = evaluateIntervalRequests(winningSessionId);
 
     if (winningSessionId >= 0) {
+        if (winningSessionId == m_appliedSession && winningRequest == m_appliedInterval &&
+            winningRequest == previousInterval)
+            return;
+
         sensordLogD() << "Setting new interval for node: " << id() << ". Evaluation won by session '" << winningSessionId << "' with request: " << winningRequest;
-        setInterval(winningRequest, winningSessionId);
+        if (setInterval(winningRequest, winningSessionId)) {
+            m_appliedInterval = winningRequest;
+            m_appliedSession = winningSessionId;
+        } else {
+            m_appliedSession = -1;
+        }
+    } else {
+        m_appliedSession = -1;
     }
 
     // Signal listeners about change
@@ -349,8 +440,6 @@ bool NodeBase::setIntervalRequest(const int sessionId, const unsigned int value)
     {
         emit propertyChanged("interval");
     }
-
-    return true;
 }
 
 void NodeBase::addStandbyOverrideSource(NodeBase* node)
@@ -421,32 +510,36 @@ bool NodeBase::hasLocalInterval() const
 void NodeBase::setIntervalSource(NodeBase* node)
 {
     m_intervalSource = node;
+    s_intervalGeneration.ref();
     connect(m_intervalSource, SIGNAL(propertyChanged(const QString&)), this, SIGNAL(propertyChanged(const QString&)));
 }
 
 unsigned int NodeBase::evaluateIntervalRequests(int& sessionId) const
 {
-    if (m_intervalMap.size() == 0)
+    return lowestIntervalRequest(sessionId);
+}
+
+unsigned int NodeBase::lowestIntervalRequest(int& sessionId, bool positive) const
+{
+    if (m_intervalOrder.isEmpty())
     {
         sessionId = -1;
         return defaultInterval();
     }
 
-    // Get the winning request
-    QMap<int, unsigned int>::const_iterator it = m_intervalMap.constBegin();
-    unsigned int highestValue = it.value();
-    int winningSessionId = it.key();
-
-    for (++it; it != m_intervalMap.constEnd(); ++it)
+    QMap<QPair<unsigned int, int>, int>::const_iterator it = m_intervalOrder.constBegin();
+    if (positive && it.key().first == 0)
     {
-        if (it.value() < highestValue) {
-            highestValue = it.value();
-            winningSessionId = it.key();
+        it = m_intervalOrder.lowerBound(qMakePair(1u, INT_MIN));
+        if (it == m_intervalOrder.constEnd())
+        {
+            sessionId = (--it).value();
+            return defaultInterval();
         }
     }
 
-    sessionId = winningSessionId;
-    return highestValue;
+    sessionId = it.value();
+    return it.key().first;
 }
 
 unsigned int NodeBase::defaultInterval() const
@@ -492,23 +585,16 @@ void NodeBase::removeIntervalRequest(const int sessionId)
     if (hasLocalInterval())
     {
         // Remove from local list
-        if (m_intervalMap.keys().contains(sessionId))
+        QMap<int, unsigned int>::iterator it = m_intervalMap.find(sessionId);
+        if (it != m_intervalMap.end())
         {
-            m_intervalMap.remove(sessionId);
+            m_intervalOrder.remove(qMakePair(it.value(), sessionId));
+            m_intervalMap.erase(it);
+            s_intervalGeneration.ref();
         }
 
-        // Re-evaluate local setting
-        int winningSessionId;
-        unsigned int winningRequest = evaluateIntervalRequests(winningSessionId);
-        if (winningSessionId >= 0) {
-            setInterval(winningRequest, winningSessionId);
-        }
-
-        // Signal listeners if changed.
-        if (previousInterval != interval())
-        {
-            emit propertyChanged("interval");
-        }
+        // Re-evaluate local setting, signals listeners if changed
+        applyIntervalRequests(previousInterval);
     }
 }
 
@@ -522,6 +608,33 @@ bool NodeBase::connectToSource(NodeBase* source, const QString& bufferName, Ring
         return false;
     }
 
+    // Each chain runs in a strand of its own, homed on the worker of the
+    // adaptor it reads. Other nodes run in the strand of their first
+    // source. Readers of sources running elsewhere are queued to the
+    // strand of this node.
+    if (!m_strand && m_sourceList.isEmpty())
+    {
+        if (inherits("AbstractChain"))
+        {
+            ChainWorker* home = source->m_strand ? source->m_strand->home() :
+                ChainScheduler::instance().workerFor(source->id());
+            if (home)
+            {
+                m_strand = new ChainStrand(id(), home);
+                m_ownsStrand = true;
+            }
+        }
+        else
+        {
+            m_strand = source->m_strand;
+        }
+    }
+    if (m_strand && m_strand != source->m_strand)
+    {
+        reader->setStrand(m_strand);
+        m_strand->add(reader);
+    }
+
     bool success = rb->join(reader);
 
     if (success)
@@ -529,6 +642,11 @@ bool NodeBase::connectToSource(NodeBase* source, const QString& bufferName, Ring
         // Store a reference to the source
         m_sourceList.append(source);
     }
+    else if (reader->strand())
+    {
+        reader->strand()->remove(reader);
+        reader->setStrand(NULL);
+    }
 
     return success;
 }
@@ -546,6 +664,13 @@ bool NodeBase::disconnectFromSource(NodeBase* source, const QString& bufferName,
 
     if (success)
     {
+        // Strand does not touch the reader after removal
+        if (reader->strand())
+        {
+            reader->strand()->remove(reader);
+            reader->setStrand(NULL);
+        }
+
         // Remove the source reference from storage
         if (!m_sourceList.removeOne(source))
         {
@@ -568,6 +693,61 @@ bool NodeBase::isValidIntervalRequest(const unsigned int value) const
     return false;
 }
 
+unsigned int NodeBase::snapIntervalRequest(const unsigned int value) const
+{
+    if (value == 0)
+    {
+        return value;
+    }
+
+    QList<unsigned int> classes;
+    foreach (const DataRange& range, m_intervalList)
+    {
+        if (range.min == range.max && range.min > 0)
+        {
+            classes.append(range.min);
+        }
+    }
+    int tolerance = 10;
+    Config* config = Config::configuration();
+    if (config)
+    {
+        foreach (const QString& entry, config->value<QString>(id() + "/interval_classes", "").split(",", QString::SkipEmptyParts))
+        {
+            bool ok = false;
+            unsigned int interval = entry.trimmed().toUInt(&ok);
+            if (ok && interval > 0 && isValidIntervalRequest(interval))
+            {
+                classes.append(interval);
+            }
+        }
+        tolerance = qMax(0, config->value<int>("global/interval_snap_tolerance", tolerance));
+    }
+
+    unsigned int faster = 0;
+    unsigned int slower = 0;
+    foreach (unsigned int interval, classes)
+    {
+        if (interval == value)
+        {
+            return value;
+        }
+        if (interval < value && interval > faster)
+        {
+            faster = interval;
+        }
+        if (interval > value && (!slower || interval < slower))
+        {
+            slower = interval;
+        }
+    }
+    if (slower && (quint64)(slower - value) * 100 <= (quint64)value * tolerance)
+    {
+        return slower;
+    }
+    return faster ? faster : value;
+}
+
 IntegerRangeList NodeBase::getAvailableBufferSizes(bool& hwSupported) const
 {
     IntegerRangeList list;
@@ -682,6 +862,11 @@ bool NodeBase::setDataRangeIndex(int sessionId, int rangeIndex)
     return ranges.at(rangeIndex) == range;
 }
 
+void NodeBase::reconfigure(const QStringList& keys)
+{
+    Q_UNUSED(keys);
+}
+
 void NodeBase::removeSession(int sessionId)
 {
     setStandbyOverrideRequest(sessionId, false);
@@ -726,14 +911,38 @@ bool NodeBase::setInterval(unsigned int value, int sessionId)
     return false;
 }
 
+NodeBase* NodeBase::hwBufferingSource() const
+{
+    foreach (NodeBase* source, m_sourceList)
+    {
+        bool hwSupported = false;
+        source->getAvailableBufferSizes(hwSupported);
+        if(hwSupported)
+            return source;
+    }
+    return NULL;
+}
+
+unsigned int NodeBase::bufferSize() const
+{
+    NodeBase* source = hwBufferingSource();
+    return source ? source->bufferSize() : 0;
+}
+
+unsigned int NodeBase::bufferInterval() const
+{
+    NodeBase* source = hwBufferingSource();
+    return source ? source->bufferInterval() : 0;
+}
+
 bool NodeBase::setBufferSize(unsigned int value)
 {
-    Q_UNUSED(value);
-    return false;
+    NodeBase* source = hwBufferingSource();
+    return source ? source->setBufferSize(value) : false;
 }
 
 bool NodeBase::setBufferInterval(unsigned int value)
 {
-    Q_UNUSED(value);
-    return false;
+    NodeBase* source = hwBufferingSource();
+    return source ? source->setBufferInterval(value) : false;
 }
@@ -30,11 +30,17 @@
 #include <QObject>
 #include <QString>
 #include <QList>
+#include <QStringList>
+#include <QMap>
+#include <QPair>
+#include <QAtomicInt>
 #include "datarange.h"
 #include "logging.h"
+#include "nodearena.h"
 
 class RingBufferReaderBase;
 class RingBufferBase;
+class ChainStrand;
 
 /**
  * Base class for all nodes in sensord framework filtering chain.
@@ -79,6 +85,13 @@ public:
      */
     bool isValid() const;
 
+    /**
+     * Chain strand the node processes its data in.
+     *
+     * @return strand or NULL if node runs in the thread of its source.
+     */
+    ChainStrand* strand() const;
+
 public Q_SLOTS:
     /**
      * Get the description for this node.
@@ -176,7 +189,9 @@ public Q_SLOTS:
 
     /**
      * Set interval request for the node. Acceptable values are listed by
-     * #getAvailableIntervals().
+     * #getAvailableIntervals(). The request is stored snapped to a rate
+     * class, see #snapIntervalRequest(), and #getInterval(int) returns
+     * the stored value.
      *
      * @param sessionId Session ID.
      * @param value interval value is milliseconds.
@@ -217,10 +232,38 @@ public Q_SLOTS:
      * Return the interval of given session.
      *
      * @param sessionId Session ID.
-     * @return interval requested by given session.
+     * @return interval requested by given session, as snapped.
      */
     unsigned int getInterval(int sessionId) const;
 
+    /**
+     * Generation of interval requests. Changes whenever a request is
+     * set or removed on any node, so per-session caches of
+     * getInterval(int) can tell when to refresh.
+     *
+     * @return interval request generation.
+     */
+    static int intervalGeneration();
+
+    /**
+     * Range requested by given session, whether it is active or waiting
+     * in the queue.
+     *
+     * @param sessionId Session ID.
+     * @param range Set to the requested range.
+     * @return does the session have a range request.
+     */
+    bool getDataRangeRequest(int sessionId, DataRange& range) const;
+
+    /**
+     * Generation of data range requests. Changes whenever a request is
+     * placed or removed on any node, so per-session caches of the active
+     * and requested ranges can tell when to refresh.
+     *
+     * @return data range request generation.
+     */
+    static int dataRangeGeneration();
+
     /**
      * Returns list of available buffer sizes. The list is ordered by
      * efficiency of the size.
@@ -239,18 +282,20 @@ public Q_SLOTS:
     virtual IntegerRangeList getAvailableBufferIntervals(bool& hwSupported) const;
 
     /**
-     * Get current buffersize of the node.
+     * Get current buffersize of the node. Default implementation returns
+     * the size of the source doing hardware buffering.
      *
      * @return current buffersize.
      */
-    virtual unsigned int bufferSize() const { return 0; }
+    virtual unsigned int bufferSize() const;
 
     /**
-     * Get current buffer interval of the node.
+     * Get current buffer interval of the node. Default implementation
+     * returns the interval of the source doing hardware buffering.
      *
      * @return current buffer interval in milliseconds.
      */
-    virtual unsigned int bufferInterval() const { return 0; }
+    virtual unsigned int bufferInterval() const;
 
     /**
      * Set buffersize for given session.
@@ -293,6 +338,16 @@ public Q_SLOTS:
      */
     virtual void removeSession(int sessionId);
 
+    /**
+     * Re-read configuration after Config::reloadConfig(), so that tuning
+     * takes effect without recreating the node and its sessions. Called
+     * from the main thread for every instantiated node. Default
+     * implementation does nothing.
+     *
+     * @param keys changed configuration keys.
+     */
+    virtual void reconfigure(const QStringList& keys);
+
 Q_SIGNALS:
     /**
      * Property value has changed signal.
@@ -301,6 +356,35 @@ Q_SIGNALS:
      */
     void propertyChanged(const QString& name);
 
+protected:
+    /**
+     * Arena for the filters, buffers, readers and bins of this node. Open
+     * a NodeArenaScope on it while building them; they must be deleted
+     * by the destructor of the subclass at the latest and must not be
+     * QObject children of the node.
+     *
+     * @return node arena.
+     */
+    NodeArena& arena();
+
+public:
+    /**
+     * Bytes the node graph has taken from the node arena, including
+     * storage of ring buffers built in it.
+     *
+     * @return allocated bytes.
+     */
+    unsigned int arenaUsage() const;
+
+    /**
+     * Is given arena the arena of this node, so that bins built in it
+     * belong to the node graph.
+     *
+     * @param arena arena.
+     * @return is it the node arena.
+     */
+    bool ownsArena(const NodeArena* arena) const;
+
 protected:
     /**
      * Set object validity state.
@@ -460,6 +544,20 @@ protected:
      */
     virtual unsigned int evaluateIntervalRequests(int& sessionId) const;
 
+    /**
+     * Smallest interval request, ties won by the lowest session ID.
+     * Requests are kept ordered, so this does not scan the sessions.
+     *
+     * @param sessionId Reference to parameter for storing the winning
+     *                  sessionId. Will be set to \c -1 if no active
+     *                  requests are in place.
+     * @param positive Skip zero requests, which are reserved for HW
+     *                 wakeup. If only zero requests are in place, the
+     *                 highest session ID wins with the default interval.
+     * @return The winning interval.
+     */
+    unsigned int lowestIntervalRequest(int& sessionId, bool positive = false) const;
+
     /**
      * Node to fetch interval from
      *
@@ -484,6 +582,21 @@ protected:
      */
     bool isValidIntervalRequest(unsigned int value) const;
 
+    /**
+     * Snap an interval request to a rate class of the node, so requests
+     * differing by a few milliseconds are served by one hardware rate
+     * and share downsampling. Classes are the discrete intervals of the
+     * node and the intervals listed in <em>id</em>/interval_classes. A
+     * request is rounded up to a class within
+     * global/interval_snap_tolerance percent, otherwise down to the
+     * closest faster class. Zero and requests without a valid class
+     * are returned as they are.
+     *
+     * @param value requested interval in milliseconds.
+     * @return interval to store for the request.
+     */
+    unsigned int snapIntervalRequest(unsigned int value) const;
+
     /**
      * Find buffer with given name.
      *
@@ -494,7 +607,8 @@ protected:
 
     /**
      * Set buffer size. Nodes subclasses supporting buffering needs to
-     * reimplement this.
+     * reimplement this. Default implementation passes the size to the
+     * source doing hardware buffering.
      *
      * @param value buffer size.
      * @return was buffer size set succesfully.
@@ -503,19 +617,40 @@ protected:
 
     /**
      * Set buffer interval. Nodes subclasses supporting buffering needs to
-     * reimplement this.
+     * reimplement this. Default implementation passes the interval to the
+     * source doing hardware buffering.
      *
      * @param value buffer interval.
      * @return was buffer interval set succesfully.
      */
     virtual bool setBufferInterval(unsigned int value);
 
+    /**
+     * Parse data range list from given text input.
+     *
+     * @param input text input.
+     * @param defaultResolution default resolution to set to created DataRange unless explicitly set.
+     * @return parsed data range list.
+     */
+    DataRangeList parseDataRangeList(const QString& input, int defaultResolution) const;
+
     QMap<int, unsigned int> m_intervalMap;    /**< active interval requests for sessions */
+    QMap<QPair<unsigned int, int>, int> m_intervalOrder; /**< m_intervalMap ordered by request and session */
 
     unsigned int            m_bufferSize;     /** buffer size */
     unsigned int            m_bufferInterval; /** buffer interval */
 
 private:
+    static QAtomicInt s_intervalGeneration; /**< interval request generation */
+    static QAtomicInt s_dataRangeGeneration; /**< data range request generation */
+
+    /**
+     * Find source which buffers in hardware.
+     *
+     * @return source or NULL if no source supports hardware buffering.
+     */
+    NodeBase* hwBufferingSource() const;
+
     /**
      * Returns whether the class defines its own output data range, or
      * whether it uses the values from previous layer.
@@ -531,15 +666,6 @@ private:
      */
     bool updateBufferSize();
 
-    /**
-     * Parse data range list from given text input.
-     *
-     * @param input text input.
-     * @param defaultResolution default resolution to set to created DataRange unless explicitly set.
-     * @return parsed data range list.
-     */
-    DataRangeList parseDataRangeList(const QString& input, int defaultResolution) const;
-
     /**
      * Re-evaluate buffer interval for the node.
      *
@@ -559,8 +685,12 @@ private:
     NodeBase*               m_intervalSource; /**< interval sources */
     bool                    m_hasDefault;     /**< does node have locally set interval */
     unsigned int            m_defaultInterval; /**< locally set interval */
+    unsigned int            m_appliedInterval; /**< interval last applied with setInterval() */
+    int                     m_appliedSession; /**< session of m_appliedInterval, -1 if none */
 
     QList<NodeBase*>        m_sourceList; /**< source nodes */
+    ChainStrand*            m_strand;     /**< strand the node runs in */
+    bool                    m_ownsStrand; /**< was strand created for this node */
 
     //Oldest session wins for these:
     QMap<int, unsigned int> m_bufferSizeMap; /**< buffersize requests for sessions. */
@@ -568,8 +698,19 @@ private:
 
     const DataRangeRequest  DEFAULT_DATA_RANGE_REQUEST; /**< default data range request */
 
+    NodeArena               m_arena; /**< storage of the node graph, released with the node */
+
     QString                 id_; /**< node ID */
     bool                    isValid_; /**< is node correctly initialized */
+
+    /**
+     * Apply the winning interval request with setInterval(), unless the
+     * same request of the same session is already in effect. Nodes using
+     * this node as interval source are not touched if nothing changed.
+     *
+     * @param previousInterval interval before the requests changed.
+     */
+    void applyIntervalRequests(unsigned int previousInterval);
 };
 
 #endif
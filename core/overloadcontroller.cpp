@@ -0,0 +1,157 @@
+/**
+   @file overloadcontroller.cpp
+   @brief Load shedding by session priority
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "overloadcontroller.h"
+#include "config.h"
+#include "logging.h"
+
+OverloadController::OverloadController(QObject* parent) :
+    QObject(parent),
+    queueThreshold_(50),
+    lagThreshold_(20),
+    recoverChecks_(5),
+    maxLevel_(4),
+    protectPriority_(10),
+    calmChecks_(0),
+    overloaded_(false),
+    exhausted_(false)
+{
+    if (Config::configuration()) {
+        queueThreshold_ = Config::configuration()->value<unsigned int>("global/overload_queue_threshold", queueThreshold_);
+        lagThreshold_ = Config::configuration()->value<unsigned int>("global/overload_lag_threshold", lagThreshold_);
+        recoverChecks_ = Config::configuration()->value<int>("global/overload_recover_checks", recoverChecks_);
+        maxLevel_ = Config::configuration()->value<int>("global/overload_max_level", maxLevel_);
+        protectPriority_ = Config::configuration()->value<int>("global/overload_protect_priority", protectPriority_);
+    }
+}
+
+void OverloadController::addSession(int sessionId, int priority)
+{
+    Session session;
+    session.priority = priority;
+    session.level = 0;
+    sessions_.insert(sessionId, session);
+    exhausted_ = false;
+}
+
+void OverloadController::removeSession(int sessionId)
+{
+    sessions_.remove(sessionId);
+}
+
+bool OverloadController::setPriority(int sessionId, int priority)
+{
+    QMap<int, Session>::iterator it = sessions_.find(sessionId);
+    if (it == sessions_.end())
+        return false;
+    it.value().priority = priority;
+    exhausted_ = false;
+    // Session which became protected gets its service back at once
+    if (priority >= protectPriority_ && it.value().level) {
+        it.value().level = 0;
+        emit levelChanged(sessionId, 0);
+    }
+    return true;
+}
+
+int OverloadController::priority(int sessionId) const
+{
+    QMap<int, Session>::const_iterator it = sessions_.constFind(sessionId);
+    return it == sessions_.constEnd() ? 0 : it.value().priority;
+}
+
+int OverloadController::level(int sessionId) const
+{
+    QMap<int, Session>::const_iterator it = sessions_.constFind(sessionId);
+    return it == sessions_.constEnd() ? 0 : it.value().level;
+}
+
+bool OverloadController::overloaded() const
+{
+    return overloaded_;
+}
+
+void OverloadController::update(unsigned int queueLoad, unsigned int lag)
+{
+    overloaded_ = queueLoad > queueThreshold_ || lag > lagThreshold_;
+    if (overloaded_) {
+        calmChecks_ = 0;
+        if (!degrade() && !exhausted_) {
+            sensordLogW() << "[OverloadController]: Overloaded (queue " << queueLoad << "%, lag " << lag
+                          << "ms) with no session left to degrade";
+            exhausted_ = true;
+        }
+        return;
+    }
+
+    // Restore only once load has settled well below the thresholds
+    if (queueLoad * 2 > queueThreshold_ || lag * 2 > lagThreshold_) {
+        calmChecks_ = 0;
+        return;
+    }
+    if (++calmChecks_ < recoverChecks_)
+        return;
+    calmChecks_ = 0;
+    exhausted_ = false;
+    restore();
+}
+
+bool OverloadController::degrade()
+{
+    QMap<int, Session>::iterator next = sessions_.end();
+    for (QMap<int, Session>::iterator it = sessions_.begin(); it != sessions_.end(); ++it) {
+        const Session& session = it.value();
+        if (session.priority >= protectPriority_ || session.level >= maxLevel_)
+            continue;
+        if (next == sessions_.end() ||
+            session.priority < next.value().priority ||
+            (session.priority == next.value().priority && session.level < next.value().level))
+            next = it;
+    }
+    if (next == sessions_.end())
+        return false;
+
+    int level = ++next.value().level;
+    sensordLogD() << "[OverloadController]: Degrading session " << next.key() << " of priority "
+                  << next.value().priority << " to level " << level;
+    emit levelChanged(next.key(), level);
+    return true;
+}
+
+void OverloadController::restore()
+{
+    QMap<int, Session>::iterator next = sessions_.end();
+    for (QMap<int, Session>::iterator it = sessions_.begin(); it != sessions_.end(); ++it) {
+        const Session& session = it.value();
+        if (!session.level)
+            continue;
+        if (next == sessions_.end() ||
+            session.priority > next.value().priority ||
+            (session.priority == next.value().priority && session.level > next.value().level))
+            next = it;
+    }
+    if (next == sessions_.end())
+        return;
+
+    int level = --next.value().level;
+    sensordLogD() << "[OverloadController]: Restoring session " << next.key() << " to level " << level;
+    emit levelChanged(next.key(), level);
+}
@@ -0,0 +1,158 @@
+/**
+   @file overloadcontroller.h
+   @brief Load shedding by session priority
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef OVERLOADCONTROLLER_H
+#define OVERLOADCONTROLLER_H
+
+#include <QObject>
+#include <QMap>
+
+/**
+ * Sheds load of low priority sessions when sensord falls behind. Load is
+ * sampled periodically by SensorManager, see #update(): fill level of
+ * the sample queues and how late the main loop runs the check. While
+ * either exceeds its threshold, one session is degraded by one level per
+ * check, the session of lowest priority and lowest level first. When
+ * both have stayed below half of their thresholds for the configured
+ * number of checks, the session of highest priority and highest level is
+ * restored by one level.
+ *
+ * Level 1 coalesces unread data of the session to the latest sample,
+ * each further level doubles its interval. Sessions at or above the
+ * protected priority are never degraded. Higher priority is more
+ * important, the default priority is 0.
+ *
+ * Thresholds are read from global/overload_queue_threshold (percent of
+ * a sample queue), global/overload_lag_threshold (ms),
+ * global/overload_recover_checks, global/overload_max_level and
+ * global/overload_protect_priority.
+ */
+class OverloadController : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(OverloadController)
+
+public:
+    /**
+     * Constructor. Reads thresholds from the configuration.
+     *
+     * @param parent parent object.
+     */
+    OverloadController(QObject* parent = 0);
+
+    /**
+     * Start watching a session.
+     *
+     * @param sessionId session ID.
+     * @param priority session priority.
+     */
+    void addSession(int sessionId, int priority);
+
+    /**
+     * Stop watching a session. No level change is signalled.
+     *
+     * @param sessionId session ID.
+     */
+    void removeSession(int sessionId);
+
+    /**
+     * Change priority of a session.
+     *
+     * @param sessionId session ID.
+     * @param priority session priority.
+     * @return is the session watched.
+     */
+    bool setPriority(int sessionId, int priority);
+
+    /**
+     * Priority of a session.
+     *
+     * @param sessionId session ID.
+     * @return priority, 0 for unknown sessions.
+     */
+    int priority(int sessionId) const;
+
+    /**
+     * Degradation level of a session.
+     *
+     * @param sessionId session ID.
+     * @return level, 0 if not degraded.
+     */
+    int level(int sessionId) const;
+
+    /**
+     * Was load over a threshold at the last check.
+     *
+     * @return is sensord overloaded.
+     */
+    bool overloaded() const;
+
+    /**
+     * Evaluate one load sample.
+     *
+     * @param queueLoad fill level of the fullest sample queue in percent.
+     * @param lag how many milliseconds late the check runs.
+     */
+    void update(unsigned int queueLoad, unsigned int lag);
+
+Q_SIGNALS:
+    /**
+     * Degradation level of a session changed.
+     *
+     * @param sessionId session ID.
+     * @param level new level, 0 when fully restored.
+     */
+    void levelChanged(int sessionId, int level);
+
+private:
+    /**
+     * Watched session.
+     */
+    struct Session
+    {
+        int priority; /**< session priority */
+        int level;    /**< degradation level */
+    };
+
+    /**
+     * Degrade the next session by one level.
+     *
+     * @return was a session degraded.
+     */
+    bool degrade();
+
+    /**
+     * Restore the next degraded session by one level.
+     */
+    void restore();
+
+    QMap<int, Session> sessions_;         /**< sessions by ID */
+    unsigned int       queueThreshold_;   /**< queue fill threshold in percent */
+    unsigned int       lagThreshold_;     /**< lag threshold in milliseconds */
+    int                recoverChecks_;    /**< calm checks before restoring a level */
+    int                maxLevel_;         /**< highest degradation level */
+    int                protectPriority_;  /**< sessions at this priority are not degraded */
+    int                calmChecks_;       /**< consecutive checks below half the thresholds */
+    bool               overloaded_;       /**< was the last check over a threshold */
+    bool               exhausted_;        /**< has everything been degraded already */
+};
+
+#endif // OVERLOADCONTROLLER_H
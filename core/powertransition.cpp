@@ -0,0 +1,71 @@
+/**
+   @file powertransition.cpp
+   @brief Concurrent standby and resume of device adaptors
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+
+#include "powertransition.h"
+#include "deviceadaptor.h"
+#include "logging.h"
+
+PowerTransition::PowerTransition(DeviceAdaptor* adaptor, bool standby) :
+    adaptor_(adaptor),
+    standby_(standby)
+{
+}
+
+void PowerTransition::run()
+{
+    transition(adaptor_, standby_);
+}
+
+void PowerTransition::transition(DeviceAdaptor* adaptor, bool standby)
+{
+    if (standby)
+        adaptor->standby();
+    else
+        adaptor->resume();
+}
+
+void PowerTransition::apply(const QList<DeviceAdaptor*>& adaptors, bool standby, bool concurrent)
+{
+    QList<PowerTransition*> threads;
+    QList<DeviceAdaptor*> local;
+    foreach (DeviceAdaptor* adaptor, adaptors) {
+        adaptor->setScreenBlanked(standby);
+        if (concurrent && adaptor->concurrentPowerTransition()) {
+            PowerTransition* thread = new PowerTransition(adaptor, standby);
+            thread->start();
+            threads.append(thread);
+        } else {
+            local.append(adaptor);
+        }
+    }
+
+    // Adaptors bound to the calling thread run while the others are in flight
+    foreach (DeviceAdaptor* adaptor, local)
+        transition(adaptor, standby);
+
+    foreach (PowerTransition* thread, threads) {
+        thread->wait();
+        delete thread;
+    }
+    sensordLogD() << (standby ? "Standby" : "Resume") << "of" << adaptors.size() << "adaptor(s) done,"
+                  << threads.size() << "concurrently";
+}
@@ -0,0 +1,78 @@
+/**
+   @file powertransition.h
+   @brief Concurrent standby and resume of device adaptors
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+
+#ifndef POWERTRANSITION_H
+#define POWERTRANSITION_H
+
+#include <QThread>
+#include <QList>
+
+class DeviceAdaptor;
+
+/**
+ * Moves device adaptors into or out of standby. Standby and resume of an
+ * adaptor may join reader threads and write power files, so adaptors
+ * which allow it, see DeviceAdaptor::concurrentPowerTransition(), are
+ * transitioned in threads of their own while the others are transitioned
+ * in the calling thread. The transition takes as long as its slowest
+ * adaptor instead of the sum of all adaptors.
+ */
+class PowerTransition : public QThread
+{
+public:
+    /**
+     * Transition adaptors. Returns when all adaptors are done.
+     *
+     * @param adaptors adaptors to transition.
+     * @param standby go into standby if true, resume if false.
+     * @param concurrent are adaptors allowed to be transitioned in
+     *        threads of their own.
+     */
+    static void apply(const QList<DeviceAdaptor*>& adaptors, bool standby, bool concurrent);
+
+protected:
+    void run();
+
+private:
+    Q_DISABLE_COPY(PowerTransition)
+
+    /**
+     * Constructor.
+     *
+     * @param adaptor adaptor to transition.
+     * @param standby go into standby if true, resume if false.
+     */
+    PowerTransition(DeviceAdaptor* adaptor, bool standby);
+
+    /**
+     * Transition adaptor.
+     *
+     * @param adaptor adaptor to transition.
+     * @param standby go into standby if true, resume if false.
+     */
+    static void transition(DeviceAdaptor* adaptor, bool standby);
+
+    DeviceAdaptor* adaptor_; /**< adaptor to transition */
+    bool           standby_; /**< go into standby */
+};
+
+#endif // POWERTRANSITION_H
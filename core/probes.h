@@ -0,0 +1,103 @@
+/**
+   @file probes.h
+   @brief Static tracing probes on the sample path
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+
+#ifndef PROBES_H
+#define PROBES_H
+
+/**
+ * @def SENSORD_PROBE(name)
+ * Static probe of provider "sensord", see SystemTap SDT. Probes compile
+ * to a single nop and an ELF note, so they cost nothing until a tracer
+ * such as bpftrace or perf attaches to them:
+ *
+ *     bpftrace -e 'usdt:/usr/sbin/sensord:sensord:sample_enqueue { @[arg0] = count(); }'
+ *
+ * Probes are built with CONFIG+=sdt, which needs sys/sdt.h. Otherwise
+ * they expand to nothing and their arguments are not evaluated.
+ *
+ * Probes and their arguments:
+ * - buffer_commit(buffer): adaptor committed an object into a buffer.
+ * - buffer_wakeup(buffer, readers): buffer wakes up its readers.
+ * - sink_entry(node, count), sink_return(node, count): node, usually a
+ *   filter, is entered with samples and returns.
+ * - sample_enqueue(session, sessions, samples, size): samples are
+ *   queued for delivery to the first of the sessions.
+ * - sample_dequeue(session, sessions, size): sample is taken out of the
+ *   queue for delivery.
+ * - session_write(session, samples, size): samples are written to a
+ *   session.
+ * - socket_send(session data, bytes, requested): sendmsg() to a client
+ *   socket returned.
+ * - control_call(method, argument), control_return(method, argument):
+ *   D-Bus or control socket method is entered and returns, argument is
+ *   the session ID or -1, see ControlProbe.
+ */
+#ifdef SENSORD_SDT_PROBES
+#include <sys/sdt.h>
+#define SENSORD_PROBE(name) DTRACE_PROBE(sensord, name)
+#define SENSORD_PROBE1(name, a) DTRACE_PROBE1(sensord, name, a)
+#define SENSORD_PROBE2(name, a, b) DTRACE_PROBE2(sensord, name, a, b)
+#define SENSORD_PROBE3(name, a, b, c) DTRACE_PROBE3(sensord, name, a, b, c)
+#define SENSORD_PROBE4(name, a, b, c, d) DTRACE_PROBE4(sensord, name, a, b, c, d)
+#else
+// sizeof() keeps arguments used without evaluating them
+#define SENSORD_PROBE(name) do {} while (0)
+#define SENSORD_PROBE1(name, a) do { (void)sizeof(a); } while (0)
+#define SENSORD_PROBE2(name, a, b) do { (void)sizeof(a); (void)sizeof(b); } while (0)
+#define SENSORD_PROBE3(name, a, b, c) do { (void)sizeof(a); (void)sizeof(b); (void)sizeof(c); } while (0)
+#define SENSORD_PROBE4(name, a, b, c, d) do { (void)sizeof(a); (void)sizeof(b); (void)sizeof(c); (void)sizeof(d); } while (0)
+#endif
+
+/**
+ * Fires control_call when constructed and control_return when destroyed,
+ * so a method call is bracketed by the probes.
+ */
+class ControlProbe
+{
+public:
+    /**
+     * Constructor.
+     *
+     * @param method method name, a string literal.
+     * @param argument session ID or -1.
+     */
+    ControlProbe(const char* method, int argument) :
+        method_(method),
+        argument_(argument)
+    {
+        SENSORD_PROBE2(control_call, method_, argument_);
+    }
+
+    /**
+     * Destructor.
+     */
+    ~ControlProbe()
+    {
+        SENSORD_PROBE2(control_return, method_, argument_);
+    }
+
+private:
+    const char* method_; /**< method name */
+    int         argument_; /**< session ID or -1 */
+};
+
+#endif // PROBES_H
@@ -25,6 +25,7 @@
  */
 
 #include "producer.h"
+#include "source.h"
 
 Producer::~Producer()
 {
@@ -39,3 +40,19 @@ SourceBase* Producer::source(const QString& name)
 {
     return sources_[name];
 }
+
+bool Producer::sourcesDemanded() const
+{
+    if (sources_.isEmpty())
+        return true;
+    foreach (SourceBase* source, sources_) {
+        if (source->demanded())
+            return true;
+    }
+    return false;
+}
+
+const QHash<QString, SourceBase*>& Producer::sources() const
+{
+    return sources_;
+}
@@ -46,6 +46,21 @@ public:
      */
     SourceBase* source(const QString& name);
 
+    /**
+     * Is output of any source of the producer consumed. Producer without
+     * sources consumes what it gets itself and is always demanded.
+     *
+     * @return is any source demanded.
+     */
+    bool sourcesDemanded() const;
+
+    /**
+     * Sources of the producer.
+     *
+     * @return sources keyed by name.
+     */
+    const QHash<QString, SourceBase*>& sources() const;
+
 protected:
     /**
      * Destructor.
@@ -0,0 +1,88 @@
+/**
+   @file rangeconversion.h
+   @brief RangeConversion
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef RANGECONVERSION_H
+#define RANGECONVERSION_H
+
+#include <QtGlobal>
+#include <math.h>
+#include <limits.h>
+#include "datarange.h"
+
+/**
+ * Conversion of samples into the range a session has requested when
+ * another range is active: values are clamped into the requested range
+ * and rounded to its resolution.
+ *
+ * Values are not scaled. All data ranges of a channel are given in the
+ * unit of the channel, so a value means the same in each of them and
+ * only its bounds and resolution differ between ranges.
+ */
+struct RangeConversion
+{
+    RangeConversion() : active(false), min(0), max(0), step(1) {}
+
+    /**
+     * Conversion from the active range into a requested one.
+     *
+     * @param current active range.
+     * @param requested range requested by the session.
+     * @return conversion, inactive when samples pass as they are.
+     */
+    static RangeConversion between(const DataRange& current, const DataRange& requested)
+    {
+        RangeConversion conversion;
+        if (requested == current || requested.min > requested.max)
+            return conversion;
+        conversion.min = (int)qBound((double)INT_MIN, ceil(requested.min), (double)INT_MAX);
+        conversion.max = (int)qBound((double)INT_MIN, floor(requested.max), (double)INT_MAX);
+        if (requested.resolution > current.resolution && requested.resolution >= 2)
+            conversion.step = qRound(requested.resolution);
+        // Range covering the active one at its resolution changes nothing
+        conversion.active = conversion.step > 1 || requested.min > current.min || requested.max < current.max;
+        return conversion;
+    }
+
+    bool operator==(const RangeConversion& other) const
+    {
+        return active == other.active && min == other.min && max == other.max && step == other.step;
+    }
+
+    /**
+     * Convert a value.
+     *
+     * @param value value in the active range.
+     * @return value in the requested range.
+     */
+    int apply(int value) const
+    {
+        if (step > 1)
+            value = (value >= 0 ? (value + step / 2) / step : -((step / 2 - value) / step)) * step;
+        return qBound(min, value, max);
+    }
+
+    bool active; /**< are samples converted */
+    int  min;    /**< lowest value */
+    int  max;    /**< highest value */
+    int  step;   /**< resolution, 1 keeps values */
+};
+
+#endif // RANGECONVERSION_H
@@ -26,17 +26,168 @@
  */
 
 #include "ringbuffer.h"
+#include "chainscheduler.h"
+#include "datatypes/atomic.h"
+
+RingBufferReaderBase::RingBufferReaderBase() :
+    strand_(0),
+    pending_(0),
+    source_(0),
+    lost_(0),
+    runs_(0),
+    active_(true)
+{
+}
 
 RingBufferReaderBase::~RingBufferReaderBase()
 {
 }
 
+void RingBufferReaderBase::setStrand(ChainStrand* strand)
+{
+    strand_ = strand;
+}
+
+ChainStrand* RingBufferReaderBase::strand() const
+{
+    return strand_;
+}
+
+void RingBufferReaderBase::schedule()
+{
+    if (!strand_) {
+        deliver();
+        return;
+    }
+    // Strand is already going to visit a reader which is pending
+    if (pending_.fetchAndStoreOrdered(1) == 0)
+        strand_->schedule();
+}
+
+void RingBufferReaderBase::runPending()
+{
+    // Clear before reading so that data written meanwhile schedules the
+    // strand again instead of being left in the buffer.
+    if (pending_.testAndSetOrdered(1, 0))
+        deliver();
+}
+
+void RingBufferReaderBase::deliver()
+{
+    Atomic::store(runs_, Atomic::load(runs_) + 1);
+    if (!source_) {
+        wakeup();
+        return;
+    }
+    quint64 start = LatencyHistogram::now();
+    unsigned long allocations = AllocCounter::threadCount();
+    wakeup();
+    source_->recordProcessing(LatencyHistogram::now() - start, AllocCounter::threadCount() - allocations);
+}
+
+unsigned RingBufferReaderBase::unread() const
+{
+    return 0;
+}
+
+unsigned RingBufferReaderBase::lost() const
+{
+    return Atomic::load(lost_);
+}
+
+unsigned RingBufferReaderBase::consumed() const
+{
+    return 0;
+}
+
+unsigned RingBufferReaderBase::runs() const
+{
+    return Atomic::load(runs_);
+}
+
+RingBufferBase* RingBufferReaderBase::joinedBuffer() const
+{
+    return source_;
+}
+
+void RingBufferReaderBase::setActive(bool active)
+{
+    if (active_ == active)
+        return;
+    active_ = active;
+    DemandNode::invalidate();
+}
+
+bool RingBufferReaderBase::computeDemand() const
+{
+    return active_ && sourcesDemanded();
+}
+
+RingBufferBase::RingBufferBase() :
+    latencyProbe_(NULL),
+    delivered_(0),
+    overwritten_(0),
+    maxLost_(0),
+    allocations_(0)
+{
+}
+
 bool RingBufferBase::join(RingBufferReaderBase* reader)
 {
-    return joinTypeChecked(reader);
+    if (!joinTypeChecked(reader))
+        return false;
+    reader->source_ = this;
+    DemandNode::invalidate();
+    return true;
 }
 
 bool RingBufferBase::unjoin(RingBufferReaderBase* reader)
 {
-    return unjoinTypeChecked(reader);
+    if (!unjoinTypeChecked(reader))
+        return false;
+    if (reader->source_ == this)
+        reader->source_ = 0;
+    DemandNode::invalidate();
+    return true;
+}
+
+unsigned RingBufferBase::delivered() const
+{
+    return Atomic::load(delivered_);
+}
+
+unsigned RingBufferBase::overwritten() const
+{
+    return Atomic::load(overwritten_);
+}
+
+unsigned RingBufferBase::maxLost() const
+{
+    return Atomic::load(maxLost_);
+}
+
+unsigned RingBufferBase::allocations() const
+{
+    return Atomic::load(allocations_);
+}
+
+const LatencyHistogram& RingBufferBase::processingTime() const
+{
+    return processing_;
+}
+
+QString RingBufferBase::statistics() const
+{
+    QString str = QString("%1 written, %2 delivered, %3 overwritten (%4 by slowest reader); processing %5")
+        .arg(written()).arg(delivered()).arg(overwritten()).arg(maxLost()).arg(processing_.toString());
+    if (AllocCounter::isEnabled()) {
+        str.append(QString("; %1 allocation(s), %2 per sample")
+                   .arg(allocations()).arg(delivered() ? (double)allocations() / delivered() : 0.0, 0, 'f', 3));
+    }
+    return str;
+}
+
+void RingBufferBase::setLatencyProbe(LatencyProbe* probe)
+{
+    latencyProbe_ = probe;
 }
@@ -33,21 +33,207 @@
 #include "sink.h"
 #include "pusher.h"
 #include "logging.h"
+#include "latencytracer.h"
+#include "alloccounter.h"
+#include "nodearena.h"
+#include "probes.h"
+#include "lowlatency.h"
+#include "datatypes/atomic.h"
 #include <QSet>
+#include <QAtomicInt>
+#include <string.h>
+#include <new>
+#if __cplusplus >= 201103L
+#include <type_traits>
+#endif
+
+/**
+ * Assumed cache line size. Ring buffer cursors are padded to this size so
+ * that writer and readers do not share cache lines with each other or
+ * with buffered data.
+ */
+#define RINGBUFFER_CACHE_LINE 64
+
+/**
+ * Can objects of the type be copied with memcpy.
+ *
+ * @tparam TYPE object type.
+ */
+template <class TYPE>
+struct RingBufferTrivialCopy
+{
+#if __cplusplus >= 201103L
+    static const bool value = std::is_trivially_copyable<TYPE>::value;
+#else
+    static const bool value = false;
+#endif
+};
 
 template <class TYPE>
 class RingBuffer;
 
+class RingBufferBase;
+class RingBufferReaderBase;
+class ChainStrand;
+
+/**
+ * Receives objects read from a ring buffer as raw bytes, see
+ * RingBufferBase::createRawReader().
+ */
+class RawObjectWriter
+{
+public:
+    /**
+     * Destructor.
+     */
+    virtual ~RawObjectWriter() {}
+
+    /**
+     * Write objects. Called in the thread running the reader.
+     *
+     * @param n object count.
+     * @param values objects.
+     * @param size size of single object in bytes.
+     */
+    virtual void writeRaw(unsigned n, const void* values, unsigned size) = 0;
+};
+
+/**
+ * Type independent handle of a reader created with
+ * RingBufferBase::createRawReader(). Deleting the handle deletes the
+ * reader.
+ */
+class RawRingBufferReaderBase
+{
+public:
+    /**
+     * Destructor.
+     */
+    virtual ~RawRingBufferReaderBase() {}
+
+    /**
+     * Reader to join and to give a strand.
+     *
+     * @return reader.
+     */
+    virtual RingBufferReaderBase* reader() = 0;
+};
+
 /**
  * Base-class for ring buffer reader subclasses.
  */
-class RingBufferReaderBase : public Pusher
+class RingBufferReaderBase : public Pusher, public ArenaNode, public DemandNode
 {
+public:
+    /**
+     * Run the reader in given chain strand instead of the thread which
+     * writes into the buffer. Only buffers of trivially copyable types
+     * can be read from another thread.
+     *
+     * @param strand strand or NULL to run synchronously.
+     */
+    void setStrand(ChainStrand* strand);
+
+    /**
+     * Strand the reader runs in.
+     *
+     * @return strand or NULL.
+     */
+    ChainStrand* strand() const;
+
+    /**
+     * Wake up the reader after data has been written. Reader with a
+     * strand is marked pending and woken up asynchronously when the
+     * strand runs, repeated wakeups are coalesced until then.
+     */
+    void schedule();
+
+    /**
+     * Wake up the reader if marked pending by #schedule(). Called by the
+     * strand.
+     */
+    void runPending();
+
+    /**
+     * How many objects are waiting to be read.
+     *
+     * @return unread object count.
+     */
+    virtual unsigned unread() const;
+
+    /**
+     * How many objects the reader has lost because the writer overwrote
+     * them before they were read.
+     *
+     * @return lost object count.
+     */
+    unsigned lost() const;
+
+    /**
+     * How many objects the reader has consumed, including objects handed
+     * to it directly by a pass-through buffer.
+     *
+     * @return consumed object count.
+     */
+    virtual unsigned consumed() const;
+
+    /**
+     * How many times the reader has been woken up to consume objects.
+     *
+     * @return wakeup count.
+     */
+    unsigned runs() const;
+
+    /**
+     * Buffer the reader is joined to.
+     *
+     * @return buffer or NULL.
+     */
+    RingBufferBase* joinedBuffer() const;
+
+    /**
+     * Mark the reader as consuming or not. Bin::start() and Bin::stop()
+     * activate and deactivate the readers they hold. Readers are active
+     * until stopped.
+     *
+     * @param active is the reader active.
+     */
+    void setActive(bool active);
+
 protected:
+    /**
+     * Constructor.
+     */
+    RingBufferReaderBase();
+
     /**
      * Destructor
      */
     virtual ~RingBufferReaderBase();
+
+    /**
+     * Reader is demanded while active if it has no sources, or when
+     * output of any of its sources is demanded.
+     *
+     * @return is the reader demanded.
+     */
+    bool computeDemand() const;
+
+private:
+    friend class RingBufferBase;
+
+    /**
+     * Wake up the reader, recording processing time into the statistics
+     * of the buffer.
+     */
+    void deliver();
+
+    ChainStrand*    strand_;  /**< strand or NULL */
+    QAtomicInt      pending_; /**< has data been written since last run */
+    RingBufferBase* source_;  /**< joined buffer or NULL */
+    QAtomicInt      lost_;    /**< objects overwritten before read */
+    QAtomicInt      runs_;    /**< wakeups, written by the thread running the reader */
+    bool            active_;  /**< is the reader active */
 };
 
 /**
@@ -62,13 +248,23 @@ public:
     /**
      * Constructor.
      */
-    RingBufferReader() : readCount_(0) {}
+    RingBufferReader() : readCount_(0), buffer_(0) {}
 
     /**
      * Destructor
      */
     virtual ~RingBufferReader() {}
 
+    unsigned unread() const
+    {
+        return buffer_ ? buffer_->unread(*this) : 0;
+    }
+
+    unsigned consumed() const
+    {
+        return Atomic::loadAcquire(readCount_);
+    }
+
 protected:
     /**
      * Read data from buffer.
@@ -82,17 +278,69 @@ protected:
         return buffer_->read(n, values, *this);
     }
 
+    /**
+     * Handle objects written to the buffer without copying them through
+     * the ring. Called by pass-through RingBuffer when this is its only
+     * reader.
+     *
+     * @param n how many objects were written.
+     * @param values written objects.
+     * @return false if reader does not support direct delivery.
+     */
+    virtual bool pushDirect(unsigned n, const TYPE* values)
+    {
+        Q_UNUSED(n);
+        Q_UNUSED(values);
+        return false;
+    }
+
 private:
     friend class RingBuffer<TYPE>;
 
-    unsigned                readCount_; /**< how many objects have been read */
+    char                    padding_[RINGBUFFER_CACHE_LINE]; /**< keeps readCount_ off the writer's lines */
+    QAtomicInt              readCount_; /**< how many objects have been read, also advanced by the writer for undemanded synchronous readers */
     const RingBuffer<TYPE>* buffer_; /**< buffer associated with this reader */
 };
 
+/**
+ * Ring buffer reader handing objects to a RawObjectWriter.
+ *
+ * @tparam TYPE datatype to read from buffer.
+ */
+template <class TYPE>
+class RawRingBufferReader : public RingBufferReader<TYPE>, public RawRingBufferReaderBase
+{
+public:
+    /**
+     * Constructor.
+     *
+     * @param writer writer receiving the objects.
+     */
+    RawRingBufferReader(RawObjectWriter* writer) : writer_(writer) {}
+
+    RingBufferReaderBase* reader()
+    {
+        return this;
+    }
+
+    void pushNewData()
+    {
+        unsigned n;
+        while ((n = RingBufferReader<TYPE>::read(CHUNK_SIZE, chunk_)))
+            writer_->writeRaw(n, chunk_, sizeof(TYPE));
+    }
+
+private:
+    static const unsigned CHUNK_SIZE = 32; /**< objects copied per read */
+
+    RawObjectWriter* writer_;            /**< writer */
+    TYPE             chunk_[CHUNK_SIZE]; /**< read objects */
+};
+
 /**
  * Base-class fo ring buffers.
  */
-class RingBufferBase : public Consumer
+class RingBufferBase : public Consumer, public ArenaNode, public DemandNode
 {
 public:
     /**
@@ -116,7 +364,170 @@ public:
      */
     bool unjoin(RingBufferReaderBase* reader);
 
+    /**
+     * Allow buffer to hand written objects directly to its reader when
+     * it has exactly one reader which supports that. Such a buffer is
+     * elided from the data path while keeping its place in the graph.
+     *
+     * @param enabled is pass-through allowed.
+     */
+    virtual void setPassThrough(bool enabled) = 0;
+
+    /**
+     * How many objects have been written into the buffer.
+     *
+     * @return written object count.
+     */
+    virtual unsigned written() const = 0;
+
+    /**
+     * Bytes of object storage held by the buffer.
+     *
+     * @return storage size in bytes.
+     */
+    virtual unsigned memoryUsage() const = 0;
+
+    /**
+     * Number of objects the buffer holds.
+     *
+     * @return buffer size.
+     */
+    virtual unsigned capacity() const = 0;
+
+    /**
+     * How many objects have been handed to readers, summed over readers.
+     *
+     * @return delivered object count.
+     */
+    unsigned delivered() const;
+
+    /**
+     * How many objects readers have missed because the writer lapped
+     * them, summed over readers.
+     *
+     * @return overwritten object count.
+     */
+    unsigned overwritten() const;
+
+    /**
+     * Highest number of objects lost by a single reader.
+     *
+     * @return lost object count of the slowest reader.
+     */
+    unsigned maxLost() const;
+
+    /**
+     * Time readers spend processing data of this buffer per wakeup,
+     * including the filters and buffers they feed synchronously.
+     *
+     * @return processing time histogram.
+     */
+    const LatencyHistogram& processingTime() const;
+
+    /**
+     * Heap allocations readers made while processing data of this buffer,
+     * including the filters and buffers they feed synchronously. Counted
+     * only in allocation tracking builds, see AllocCounter.
+     *
+     * @return allocation count.
+     */
+    unsigned allocations() const;
+
+    /**
+     * Statistics summary for status output.
+     *
+     * @return written, delivered and overwritten counts, objects lost
+     *         by the slowest reader and processing time summary.
+     */
+    QString statistics() const;
+
+    /**
+     * Trace latency of objects written into the buffer, see
+     * LatencyTracer. Only objects derived from TimedData are traced.
+     *
+     * @param probe probe or NULL to stop tracing.
+     */
+    void setLatencyProbe(LatencyProbe* probe);
+
+    /**
+     * Create reader handing objects of this buffer to a writer as raw
+     * bytes. The reader must be given a strand before it is joined.
+     *
+     * @param writer writer receiving the objects.
+     * @return new reader owned by the caller, or NULL if objects are not
+     *         trivially copyable.
+     */
+    virtual RawRingBufferReaderBase* createRawReader(RawObjectWriter* writer) = 0;
+
+protected:
+    /**
+     * Constructor.
+     */
+    RingBufferBase();
+
+    /**
+     * Count objects handed to a reader.
+     *
+     * @param n object count.
+     */
+    void countDelivered(unsigned n) const
+    {
+        delivered_.fetchAndAddRelaxed(n);
+    }
+
+    /**
+     * Count objects a reader has missed.
+     *
+     * @param reader reader which missed the objects.
+     * @param n object count.
+     */
+    void countOverwritten(RingBufferReaderBase& reader, unsigned n) const
+    {
+        overwritten_.fetchAndAddRelaxed(n);
+        unsigned lost = reader.lost_.fetchAndAddRelaxed(n) + n;
+        for (;;) {
+            int max = Atomic::load(maxLost_);
+            if (lost <= (unsigned)max || maxLost_.testAndSetRelaxed(max, lost))
+                break;
+        }
+        sensordLogT() << "Ring buffer reader lost" << n << "overwritten object(s)";
+    }
+
+    /**
+     * Record reader processing time.
+     *
+     * @param ns duration in nanoseconds.
+     * @param allocations heap allocations made meanwhile.
+     */
+    void recordProcessing(quint64 ns, unsigned long allocations)
+    {
+        processing_.record(ns);
+        if (allocations)
+            allocations_.fetchAndAddRelaxed(allocations);
+    }
+
+    /**
+     * Count a wakeup of a reader which bypassed RingBufferReaderBase,
+     * see RingBufferReaderBase::runs().
+     *
+     * @param reader reader which consumed objects.
+     */
+    static void countRun(RingBufferReaderBase& reader)
+    {
+        Atomic::store(reader.runs_, Atomic::load(reader.runs_) + 1);
+    }
+
+    LatencyProbe* latencyProbe_; /**< latency probe or NULL */
+
 private:
+    friend class RingBufferReaderBase;
+
+    mutable QAtomicInt delivered_;   /**< objects handed to readers */
+    mutable QAtomicInt overwritten_; /**< objects missed by readers */
+    mutable QAtomicInt maxLost_;     /**< objects missed by the slowest reader */
+    QAtomicInt         allocations_; /**< heap allocations by readers */
+    LatencyHistogram   processing_;  /**< reader processing time */
+
     /**
      * Connect reader to this buffer.
      *
@@ -135,7 +546,9 @@ private:
 };
 
 /**
- * Ring buffer implementation.
+ * Ring buffer implementation. Capacity is rounded up to a power of two so
+ * slots are located by masking the counters. Objects which can be copied
+ * with memcpy are read and written in bulk.
  *
  * @tparam TYPE data type in buffer.
  */
@@ -146,14 +559,27 @@ public:
     /**
      * Constructor.
      *
-     * @param size how many elements can be buffered.
+     * @param size how many elements can be buffered at least.
      */
     RingBuffer(unsigned size) :
         sink_(this, &RingBuffer::write),
-        bufferSize_(size),
-        writeCount_()
+        bufferSize_(roundUpToPowerOfTwo(size)),
+        mask_(bufferSize_ - 1),
+        writeCount_(0),
+        reserveCount_(0),
+        passThrough_(false)
     {
-        buffer_ = new TYPE[size];
+        // Storage of buffers built in an arena scope lives in the arena
+        NodeArena* arena = NodeArena::current();
+        arenaStorage_ = (arena != NULL);
+        if (arenaStorage_) {
+            buffer_ = (TYPE*)arena->allocate(bufferSize_ * sizeof(TYPE));
+            for (unsigned i = 0; i < bufferSize_; ++i)
+                new (buffer_ + i) TYPE();
+        } else {
+            buffer_ = new TYPE[bufferSize_];
+        }
+        LowLatency::prefault(buffer_, bufferSize_ * sizeof(TYPE));
         addSink(&sink_, "sink");
     }
 
@@ -162,7 +588,12 @@ public:
      */
     virtual ~RingBuffer()
     {
-        delete [] buffer_;
+        if (arenaStorage_) {
+            for (unsigned i = 0; i < bufferSize_; ++i)
+                buffer_[i].~TYPE();
+        } else {
+            delete [] buffer_;
+        }
     }
 
     /**
@@ -177,17 +608,80 @@ public:
                   TYPE*                   values,
                   RingBufferReader<TYPE>& reader) const
     {
-        unsigned itemsRead = 0;
-        while (itemsRead < n && reader.readCount_ != (unsigned)writeCount_) {
-
-            *values++ = buffer_[reader.readCount_++ % bufferSize_];
-
-            ++itemsRead;
+        unsigned written = Atomic::loadAcquire(writeCount_);
+        unsigned available = written - (unsigned)Atomic::load(reader.readCount_);
+        if (available > bufferSize_) {
+            // Reader fell behind a whole ring, skip overwritten objects
+            // to the oldest slot still holding valid data
+            countOverwritten(reader, available - bufferSize_);
+            Atomic::storeRelease(reader.readCount_, written - bufferSize_);
+            available = bufferSize_;
+        }
+        unsigned itemsRead = (n < available) ? n : available;
+        unsigned first = Atomic::load(reader.readCount_);
+
+        copy(values, first, itemsRead);
+        Atomic::storeRelease(reader.readCount_, first + itemsRead);
+
+        if (reader.strand()) {
+            // Writer runs in another thread and may have reused slots
+            // while they were copied. Objects in slots which it may have
+            // touched are discarded.
+            __sync_synchronize();
+            unsigned end = Atomic::load(writeCount_) + 1;
+            unsigned reserved = Atomic::load(reserveCount_);
+            if ((int)(reserved - end) > 0)
+                end = reserved;
+            if (end - first > bufferSize_) {
+                unsigned skip = end - first - bufferSize_;
+                if (skip > itemsRead)
+                    skip = itemsRead;
+                itemsRead -= skip;
+                for (unsigned i = 0; i < itemsRead; ++i)
+                    values[i] = values[i + skip];
+                countOverwritten(reader, skip);
+            }
         }
 
+        if (itemsRead)
+            countDelivered(itemsRead);
         return itemsRead;
     }
 
+    /**
+     * How many objects are waiting for the reader.
+     *
+     * @param reader buffer reader.
+     * @return unread object count.
+     */
+    unsigned unread(const RingBufferReader<TYPE>& reader) const
+    {
+        unsigned available = (unsigned)Atomic::loadAcquire(writeCount_) - (unsigned)Atomic::loadAcquire(reader.readCount_);
+        return (available > bufferSize_) ? bufferSize_ : available;
+    }
+
+    unsigned written() const
+    {
+        return Atomic::loadAcquire(writeCount_);
+    }
+
+    unsigned memoryUsage() const
+    {
+        return bufferSize_ * sizeof(TYPE);
+    }
+
+    RawRingBufferReaderBase* createRawReader(RawObjectWriter* writer)
+    {
+        if (!RingBufferTrivialCopy<TYPE>::value)
+            return NULL;
+        return new RawRingBufferReader<TYPE>(writer);
+    }
+
+    unsigned capacity() const
+    {
+        return bufferSize_;
+    }
+
 protected:
     /**
      * Get next slot in the ring buffer.
@@ -196,7 +690,7 @@ protected:
      */
     TYPE* nextSlot()
     {
-        return &buffer_[writeCount_ % bufferSize_];
+        return &buffer_[Atomic::load(writeCount_) & mask_];
     }
 
     /**
@@ -204,7 +698,9 @@ protected:
      */
     void commit()
     {
-        ++writeCount_;
+        LatencyProbe::recordObject(latencyProbe_, nextSlot());
+        Atomic::storeRelease(writeCount_, Atomic::load(writeCount_) + 1);
+        SENSORD_PROBE1(buffer_commit, this);
     }
 
     /**
@@ -212,12 +708,33 @@ protected:
      */
     void wakeUpReaders()
     {
+        SENSORD_PROBE2(buffer_wakeup, this, readers_.size());
         RingBufferReader<TYPE>* reader;
         foreach (reader, readers_) {
-            reader->wakeup();
+            // Reader without demand is kept current instead, so that it
+            // does not see a stale backlog once it is demanded again
+            if (!reader->strand() && !reader->demanded())
+                Atomic::storeRelease(reader->readCount_, Atomic::load(writeCount_));
+            else
+                reader->schedule();
         }
     }
 
+    /**
+     * Buffer is demanded when any of its readers is.
+     *
+     * @return is the buffer demanded.
+     */
+    bool computeDemand() const
+    {
+        RingBufferReader<TYPE>* reader;
+        foreach (reader, readers_) {
+            if (reader->demanded())
+                return true;
+        }
+        return false;
+    }
+
     /**
      * Write to buffer.
      *
@@ -226,12 +743,41 @@ protected:
      */
     void write(unsigned n, const TYPE* values)
     {
-        // buffer incoming data
-        while (n) {
-            *nextSlot() = *values++;
-            commit();
-            --n;
+        if (latencyProbe_) {
+            for (unsigned i = 0; i < n; ++i)
+                LatencyProbe::recordObject(latencyProbe_, values + i);
+        }
+
+        unsigned written = Atomic::load(writeCount_);
+        if (passThrough_ && readers_.size() == 1) {
+            RingBufferReader<TYPE>* reader = *readers_.constBegin();
+            if (!reader->strand() && (unsigned)Atomic::load(reader->readCount_) == written) {
+                quint64 start = LatencyHistogram::now();
+                unsigned long allocations = AllocCounter::threadCount();
+                if (reader->pushDirect(n, values)) {
+                    Atomic::storeRelease(writeCount_, written + n);
+                    Atomic::storeRelease(reader->readCount_, written + n);
+                    countDelivered(n);
+                    countRun(*reader);
+                    recordProcessing(LatencyHistogram::now() - start, AllocCounter::threadCount() - allocations);
+                    return;
+                }
+            }
         }
+
+        // buffer incoming data, only the newest bufferSize_ objects survive
+        unsigned skip = (n > bufferSize_) ? n - bufferSize_ : 0;
+        unsigned start = written + skip;
+        unsigned count = n - skip;
+        unsigned first = bufferSize_ - (start & mask_);
+        if (first > count)
+            first = count;
+        // Full barrier: readers in other threads must see the reservation
+        // before any of the slots below is overwritten.
+        reserveCount_.fetchAndStoreOrdered(written + n);
+        copyObjects(buffer_ + (start & mask_), values + skip, first);
+        copyObjects(buffer_, values + skip + first, count - first);
+        Atomic::storeRelease(writeCount_, written + n);
         wakeUpReaders();
     }
 
@@ -250,7 +796,7 @@ protected:
             return false;
         }
 
-        r->readCount_ = writeCount_;
+        Atomic::storeRelease(r->readCount_, Atomic::loadAcquire(writeCount_));
         r->buffer_    = this;
 
         readers_.insert(r);
@@ -276,11 +822,70 @@ protected:
 
 private:
 
-    Sink<RingBuffer, TYPE>        sink_;       /**< data sink */
-    const unsigned                bufferSize_; /**< buffer size */
-    TYPE*                         buffer_;     /**< buffer */
-    unsigned int                  writeCount_; /**< how many objects have been written */
-    QSet<RingBufferReader<TYPE>*> readers_;    /**< connected readers */
+    void setPassThrough(bool enabled)
+    {
+        passThrough_ = enabled;
+    }
+
+    /**
+     * Smallest power of two not less than given size.
+     *
+     * @param size requested size.
+     * @return buffer size.
+     */
+    static unsigned roundUpToPowerOfTwo(unsigned size)
+    {
+        unsigned rounded = 1;
+        while (rounded < size)
+            rounded <<= 1;
+        return rounded;
+    }
+
+    /**
+     * Copy objects between non-overlapping locations.
+     *
+     * @param to destination.
+     * @param from source.
+     * @param n how many objects to copy.
+     */
+    static void copyObjects(TYPE* to, const TYPE* from, unsigned n)
+    {
+        if (RingBufferTrivialCopy<TYPE>::value) {
+            if (n)
+                memcpy((void*)to, (const void*)from, n * sizeof(TYPE));
+        } else {
+            for (unsigned i = 0; i < n; ++i)
+                to[i] = from[i];
+        }
+    }
+
+    /**
+     * Copy objects out of the ring handling wrap-around.
+     *
+     * @param values destination.
+     * @param position counter value of the first object.
+     * @param n how many objects to copy.
+     */
+    void copy(TYPE* values, unsigned position, unsigned n) const
+    {
+        unsigned first = bufferSize_ - (position & mask_);
+        if (first > n)
+            first = n;
+        copyObjects(values, buffer_ + (position & mask_), first);
+        copyObjects(values + first, buffer_, n - first);
+    }
+
+    Sink<RingBuffer, TYPE>        sink_;        /**< data sink */
+    const unsigned                bufferSize_;  /**< buffer size, power of two */
+    const unsigned                mask_;        /**< bufferSize_ - 1 */
+    TYPE*                         buffer_;      /**< buffer */
+    char                          padding_[RINGBUFFER_CACHE_LINE]; /**< keeps writeCount_ off the lines above */
+    QAtomicInt                    writeCount_;  /**< how many objects have been written */
+    QAtomicInt                    reserveCount_; /**< end of the slots being written in bulk */
+    char                          padding2_[RINGBUFFER_CACHE_LINE - 2 * sizeof(QAtomicInt)]; /**< keeps the counters off the lines below */
+    QSet<RingBufferReader<TYPE>*> readers_;     /**< connected readers */
+    bool                          passThrough_; /**< may objects bypass the ring */
+    bool                          arenaStorage_; /**< is buffer_ allocated from an arena */
 };
 
 #endif
@@ -0,0 +1,128 @@
+/**
+   @file runningstatistics.h
+   @brief Running mean, variance and range of a stream of values
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef RUNNINGSTATISTICS_H
+#define RUNNINGSTATISTICS_H
+
+/**
+ * Mean and variance updated with Welford's method, so the variance does
+ * not suffer from cancellation between large sums of values and of
+ * squares. Values can be added one at a time, or replaced in a sliding
+ * window of fixed length. Minimum and maximum are tracked for added
+ * values only.
+ */
+class RunningStatistics
+{
+public:
+    /**
+     * Constructor.
+     */
+    RunningStatistics() { reset(); }
+
+    /**
+     * Forget all values.
+     */
+    void reset()
+    {
+        count_ = 0;
+        mean_ = 0;
+        m2_ = 0;
+        min_ = 0;
+        max_ = 0;
+    }
+
+    /**
+     * Add value.
+     *
+     * @param value value.
+     */
+    void add(double value)
+    {
+        if (!count_ || value < min_)
+            min_ = value;
+        if (!count_ || value > max_)
+            max_ = value;
+        ++count_;
+        double delta = value - mean_;
+        mean_ += delta / count_;
+        m2_ += delta * (value - mean_);
+    }
+
+    /**
+     * Replace a value added earlier, keeping the count. Used for sliding
+     * windows, minimum and maximum are not updated.
+     *
+     * @param oldest value leaving the window.
+     * @param value value entering the window.
+     */
+    void replace(double oldest, double value)
+    {
+        double oldMean = mean_;
+        mean_ += (value - oldest) / count_;
+        m2_ += (value - oldest) * (value - mean_ + oldest - oldMean);
+        if (m2_ < 0)
+            m2_ = 0;
+    }
+
+    /**
+     * Number of values.
+     *
+     * @return count.
+     */
+    int count() const { return count_; }
+
+    /**
+     * Mean of the values.
+     *
+     * @return mean, 0 if empty.
+     */
+    double mean() const { return mean_; }
+
+    /**
+     * Sample variance of the values.
+     *
+     * @return variance, 0 for less than two values.
+     */
+    double variance() const { return count_ > 1 ? m2_ / (count_ - 1) : 0; }
+
+    /**
+     * Smallest added value.
+     *
+     * @return minimum, 0 if empty.
+     */
+    double min() const { return min_; }
+
+    /**
+     * Largest added value.
+     *
+     * @return maximum, 0 if empty.
+     */
+    double max() const { return max_; }
+
+private:
+    int    count_; /**< number of values */
+    double mean_;  /**< mean of the values */
+    double m2_;    /**< sum of squared deviations from the mean */
+    double min_;   /**< smallest added value */
+    double max_;   /**< largest added value */
+};
+
+#endif // RUNNINGSTATISTICS_H
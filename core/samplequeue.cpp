@@ -0,0 +1,98 @@
+/**
+   @file samplequeue.cpp
+   @brief SampleQueue
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "samplequeue.h"
+#include "datatypes/atomic.h"
+#include <string.h>
+
+SampleQueue::SampleQueue(unsigned int size) :
+    queue_(size),
+    acquired_(0),
+    rejected_(0),
+    reported_(0)
+{
+}
+
+SampleQueue::~SampleQueue()
+{
+}
+
+bool SampleQueue::push(const int* sessions, int sessionCount, const void* source, int size, bool& wakeup)
+{
+    wakeup = false;
+    if (size < 0 || size > MAX_SAMPLE_SIZE || sessionCount < 1 || sessionCount > MAX_FANOUT) {
+        rejected_.fetchAndAddRelaxed(1);
+        return false;
+    }
+
+    Slot* slot = queue_.reserve();
+    if (!slot)
+        return false;
+    slot->sessionCount = sessionCount;
+    memcpy(slot->sessions, sessions, sessionCount * sizeof(int));
+    slot->size = size;
+    memcpy(slot->data, source, size);
+    queue_.commit(wakeup);
+    return true;
+}
+
+const SampleQueue::Slot* SampleQueue::front() const
+{
+    return queue_.front();
+}
+
+void SampleQueue::pop()
+{
+    queue_.pop();
+}
+
+bool SampleQueue::acquire()
+{
+    return acquired_.testAndSetOrdered(0, 1);
+}
+
+void SampleQueue::release()
+{
+    acquired_.fetchAndStoreOrdered(0);
+}
+
+unsigned int SampleQueue::dropCount() const
+{
+    return queue_.dropCount() + (unsigned int)Atomic::load(rejected_);
+}
+
+unsigned int SampleQueue::takeDrops()
+{
+    unsigned int dropped = dropCount();
+    unsigned int drops = dropped - reported_;
+    reported_ = dropped;
+    return drops;
+}
+
+unsigned int SampleQueue::depth() const
+{
+    return queue_.depth();
+}
+
+unsigned int SampleQueue::size() const
+{
+    return queue_.size();
+}
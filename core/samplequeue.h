@@ -0,0 +1,153 @@
+/**
+   @file samplequeue.h
+   @brief SampleQueue
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef SAMPLEQUEUE_H
+#define SAMPLEQUEUE_H
+
+#include <QAtomicInt>
+#include "spscqueue.h"
+
+/**
+ * Preallocated single-producer single-consumer queue for handing sensor
+ * samples from producer threads to the main thread. Sample bytes are stored
+ * inline in SpscQueue slots, filled and consumed in place, so no allocation
+ * or extra copy is done per sample.
+ *
+ * Producer side (#push()) may only be used by the thread which has
+ * acquired the queue with #acquire(). Consumer side (#front(), #pop())
+ * may only be used by a single consumer thread.
+ */
+class SampleQueue
+{
+public:
+    /**
+     * Largest sample size in bytes which fits into a queue slot.
+     */
+    static const int MAX_SAMPLE_SIZE = 64;
+
+    /**
+     * How many sessions a single slot can be addressed to.
+     */
+    static const int MAX_FANOUT = 8;
+
+    /**
+     * Queue slot. Sample is stored once no matter how many sessions it
+     * is delivered to.
+     */
+    struct Slot
+    {
+        int  sessionCount;          /**< number of receiving sessions */
+        int  sessions[MAX_FANOUT];  /**< receiving session IDs */
+        int  size;                  /**< sample size in bytes */
+        char data[MAX_SAMPLE_SIZE]; /**< sample bytes */
+    };
+
+    /**
+     * Constructor.
+     *
+     * @param size how many samples can be queued, rounded up to a power
+     *             of two.
+     */
+    SampleQueue(unsigned int size);
+
+    /**
+     * Destructor.
+     */
+    ~SampleQueue();
+
+    /**
+     * Push sample into the queue. Producer side only.
+     *
+     * @param sessions Receiving session IDs.
+     * @param sessionCount Number of receiving sessions, at most
+     *                     #MAX_FANOUT.
+     * @param source Sample location.
+     * @param size Sample size in bytes.
+     * @param wakeup Set to true if queue was empty before the push and
+     *               consumer needs to be woken up.
+     * @return false if queue is full or sample does not fit into a slot.
+     */
+    bool push(const int* sessions, int sessionCount, const void* source, int size, bool& wakeup);
+
+    /**
+     * Get oldest queued sample. Consumer side only.
+     *
+     * @return oldest queued sample or NULL if queue is empty.
+     */
+    const Slot* front() const;
+
+    /**
+     * Remove oldest queued sample. Consumer side only.
+     */
+    void pop();
+
+    /**
+     * Claim producer side of the queue for the calling thread.
+     *
+     * @return false if queue is already used by some other thread.
+     */
+    bool acquire();
+
+    /**
+     * Release producer side of the queue.
+     */
+    void release();
+
+    /**
+     * How many samples have been dropped because queue was full or the
+     * sample did not fit into a slot.
+     *
+     * @return dropped sample count.
+     */
+    unsigned int dropCount() const;
+
+    /**
+     * How many samples have been dropped since the previous call.
+     * Consumer side only.
+     *
+     * @return dropped sample count.
+     */
+    unsigned int takeDrops();
+
+    /**
+     * How many samples are waiting to be drained.
+     *
+     * @return queued sample count.
+     */
+    unsigned int depth() const;
+
+    /**
+     * How many samples can be queued.
+     *
+     * @return queue size.
+     */
+    unsigned int size() const;
+
+private:
+    Q_DISABLE_COPY(SampleQueue)
+
+    SpscQueue<Slot> queue_;    /**< queued samples */
+    QAtomicInt      acquired_; /**< is producer side in use */
+    QAtomicInt      rejected_; /**< samples not fitting into a slot */
+    unsigned int    reported_; /**< drops returned by takeDrops() */
+};
+
+#endif // SAMPLEQUEUE_H
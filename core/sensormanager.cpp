@@ -28,8 +28,22 @@
  */
 
 #include "sensormanager_a.h"
+#include "abstractsensor_a.h"
 #include "serviceinfo.h"
 #include "sensormanager.h"
+#include "chainscheduler.h"
+#include "latencytracer.h"
+#include "tracerecorder.h"
+#include "alloccounter.h"
+#include "nodearena.h"
+#include "powertransition.h"
+#include "lowlatency.h"
+#include "probes.h"
+#include "startuptrace.h"
+#include "dataflowgraph.h"
+#include "overloadcontroller.h"
+#include "bin.h"
+#include "clock.h"
 #include "loader.h"
 #include "idutils.h"
 #include "logging.h"
@@ -37,20 +51,62 @@
 #include "mcewatcher.h"
 #endif // SENSORFW_MCE_WATCHER
 #include <QSocketNotifier>
+#include <QFile>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QTimer>
 #include <errno.h>
 #include "sockethandler.h"
+#include "controlhandler.h"
+#include "samplequeue.h"
+#include "config.h"
+#include "datatypes/atomic.h"
+#include <malloc.h>
+#include <stdio.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/eventfd.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <QSettings>
+#include <QFileSystemWatcher>
+#include <QFileInfo>
+#include <QThreadStorage>
+#include <QThread>
+#include <QMutexLocker>
 
+/**
+ * Per-thread handle for the sample queues of each delivery class. Queues
+ * are handed back to the pool when the owning thread exits so restarted
+ * adaptor threads reuse them.
+ */
+class SampleQueueHandle
+{
+public:
+    SampleQueueHandle()
+    {
+        for (int i = 0; i < SensorManager::SamplePriorities; ++i)
+            queues_[i] = NULL;
+    }
+    ~SampleQueueHandle()
+    {
+        for (int i = 0; i < SensorManager::SamplePriorities; ++i) {
+            if (queues_[i])
+                queues_[i]->release();
+        }
+    }
+
+    SampleQueue* queues_[SensorManager::SamplePriorities]; /**< acquired queues */
+};
+
+static QThreadStorage<SampleQueueHandle*> threadSampleQueues;
+
+/** Location configuration holding magnetic declination */
+static const char* LOCATION_CONF = "/etc/xdg/sensorfw/location.conf";
 
-typedef struct {
-        int id;
-        int size;
-        void* buffer;
-} PipeData;
+/** Reload pipe written by requestReload(), -1 when not created */
+static int reloadPipe[2] = { -1, -1 };
 
 SensorManager* SensorManager::instance_ = NULL;
 int SensorManager::sessionIdCount_ = 0;
@@ -88,10 +144,12 @@ DeviceAdaptorInstanceEntry::~DeviceAdaptorInstanceEntry()
 {
 }
 
+#ifndef SENSORFW_NO_DBUS
 inline QDBusConnection bus()
 {
     return QDBusConnection::systemBus();
 }
+#endif
 
 SensorManager& SensorManager::instance()
 {
@@ -105,24 +163,66 @@ SensorManager& SensorManager::instance()
 
 SensorManager::SensorManager()
     : errorCode_(SmNoError),
-    pipeNotifier_(0),
-    deviation(0)
+    eventFd_(-1),
+    eventNotifier_(0),
+    reloadNotifier_(0),
+    sampleBatchLimit_(0),
+    drainedSamples_(0),
+    drainAllocations_(0),
+    writerThread_(0),
+    capabilitiesLoaded_(false),
+    idleTimer_(0),
+    idleTimeout_(0),
+    reclaimTimer_(0),
+    reclaimBefore_(0),
+    reclaimAfter_(0),
+    reclaimPooled_(0),
+    reclaimCount_(0),
+    governorMaxInterval_(0),
+    overload_(0),
+    overloadTimer_(0),
+    overloadPeriod_(0),
+    overloadDeadline_(0),
+    overloadMaxInterval_(1000),
+    graphTime_(0),
+    sessionStore_(0),
+    deviation(0),
+    locationWatcher_(0)
 {
     const char* SOCKET_NAME = "/var/run/sensord.sock";
 
     new SensorManagerAdaptor(this);
 
-    socketHandler_ = new SocketHandler(this);
+    // No parent, socket handler may be moved to the writer thread
+    socketHandler_ = new SocketHandler();
     connect(socketHandler_, SIGNAL(lostSession(int)), this, SLOT(lostClient(int)));
+    connect(socketHandler_, SIGNAL(sessionCongested(int, bool)), this, SLOT(governSession(int, bool)));
+    new ControlHandler(socketHandler_, this);
 
     Q_ASSERT(socketHandler_->listen(SOCKET_NAME));
+    QString packetSocket("/var/run/sensord-seqpacket.sock");
+    if (Config::configuration())
+        packetSocket = Config::configuration()->value<QString>("global/seqpacket_socket", packetSocket);
+    if (!packetSocket.isEmpty() && socketHandler_->listenPacket(packetSocket) &&
+        chmod(packetSocket.toLocal8Bit().constData(), S_IRWXU|S_IRWXG|S_IRWXO) != 0) {
+        sensordLogW() << "Error setting socket permissions! " << packetSocket;
+    }
+
+    eventFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (eventFd_ == -1) {
+        sensordLogC() << "Failed to create eventfd: " << strerror(errno);
+    } else {
+        eventNotifier_ = new QSocketNotifier(eventFd_, QSocketNotifier::Read);
+        // Direct connection: samples are drained in the thread owning the
+        // notifier, which is the writer thread if one is used.
+        connect(eventNotifier_, SIGNAL(activated(int)), this, SLOT(sensorDataHandler(int)), Qt::DirectConnection);
+    }
 
-    if (pipe(pipefds_) == -1) {
-        sensordLogC() << "Failed to create pipe: " << strerror(errno);
-        pipefds_[0] = pipefds_[1] = 0;
+    if (pipe2(reloadPipe, O_NONBLOCK | O_CLOEXEC) == -1) {
+        sensordLogW() << "Failed to create reload pipe: " << strerror(errno);
     } else {
-        pipeNotifier_ = new QSocketNotifier(pipefds_[0], QSocketNotifier::Read);
-        connect(pipeNotifier_, SIGNAL(activated(int)), this, SLOT(sensorDataHandler(int)));
+        reloadNotifier_ = new QSocketNotifier(reloadPipe[0], QSocketNotifier::Read, this);
+        connect(reloadNotifier_, SIGNAL(activated(int)), this, SLOT(reloadRequested(int)));
     }
 
     if (chmod(SOCKET_NAME, S_IRWXU|S_IRWXG|S_IRWXO) != 0) {
@@ -139,10 +239,34 @@ SensorManager::SensorManager()
             this, SLOT(devicePSMStateChanged(const bool)));
 
 #endif //SENSORFW_MCE_WATCHER
+
+    idleTimer_ = new QTimer(this);
+    idleTimer_->setSingleShot(true);
+    connect(idleTimer_, SIGNAL(timeout()), this, SLOT(releaseIdleAdaptors()));
+
+    reclaimTimer_ = new QTimer(this);
+    reclaimTimer_->setSingleShot(true);
+    connect(reclaimTimer_, SIGNAL(timeout()), this, SLOT(reclaimMemory()));
+
+    // Directory is watched too, as the file may not exist yet or be
+    // replaced by a new one
+    locationWatcher_ = new QFileSystemWatcher(this);
+    locationWatcher_->addPath(QFileInfo(LOCATION_CONF).absolutePath());
+    connect(locationWatcher_, SIGNAL(fileChanged(QString)), this, SLOT(loadMagneticDeviation()));
+    connect(locationWatcher_, SIGNAL(directoryChanged(QString)), this, SLOT(loadMagneticDeviation()));
+    loadMagneticDeviation();
 }
 
 SensorManager::~SensorManager()
 {
+    // sessions stay resumable when sensord exits
+    delete sessionStore_;
+    sessionStore_ = 0;
+
+    // stop trace recorders before the buffers they read are deleted
+    qDeleteAll(recorders_);
+    recorders_.clear();
+
     // stop adaptor threads and acquired resources
     for(QMap<QString, DeviceAdaptorInstanceEntry>::const_iterator it = deviceAdaptorInstanceMap_.begin(); it != deviceAdaptorInstanceMap_.end(); ++it)
     {
@@ -152,12 +276,9 @@ SensorManager::~SensorManager()
     sleep(1); // sleep for seconds so adaptor threads have time to die
 
     // close open sessions
-    for(QMap<QString, SensorInstanceEntry>::const_iterator it = sensorInstanceMap_.begin(); it != sensorInstanceMap_.end(); ++it)
+    foreach (int sessionId, sessionSensors_.keys())
     {
-        for(QSet<int>::const_iterator it2 = it.value().sessions_.begin(); it2 != it.value().sessions_.end(); ++it2)
-        {
-            lostClient(*it2);
-        }
+        releaseLostClient(sessionId);
     }
 
     // delete sensors
@@ -190,10 +311,29 @@ SensorManager::~SensorManager()
         }
     }
 
+    // Chain workers write into sample queues, stop them first
+    ChainScheduler::instance().stop();
+
+    if (writerThread_) {
+        writerThread_->quit();
+        writerThread_->wait();
+    }
     delete socketHandler_;
-    delete pipeNotifier_;
-    if (pipefds_[0]) close(pipefds_[0]);
-    if (pipefds_[1]) close(pipefds_[1]);
+    delete eventNotifier_;
+    delete writerThread_;
+    if (eventFd_ != -1) close(eventFd_);
+    delete reloadNotifier_;
+    if (reloadPipe[0] != -1) {
+        close(reloadPipe[0]);
+        close(reloadPipe[1]);
+        reloadPipe[0] = reloadPipe[1] = -1;
+    }
+
+    // Producer threads are gone by now, queues can be freed
+    for (int i = 0; i < SamplePriorities; ++i) {
+        qDeleteAll(sampleQueues_[i]);
+        sampleQueues_[i].clear();
+    }
 
 #ifdef SENSORFW_MCE_WATCHER
     delete mceWatcher_;
@@ -210,10 +350,232 @@ void SensorManager::setError(SensorManagerError errorCode, const QString& errorS
     emit errorSignal(errorCode);
 }
 
+void SensorManager::startWriterThread()
+{
+    if (writerThread_ || !Config::configuration() ||
+        !Config::configuration()->value<bool>("global/writer_thread", false))
+        return;
+
+    sensordLogD() << "Moving data sockets to writer thread";
+    writerThread_ = new QThread();
+    writerThread_->setObjectName("sensord-writer");
+    socketHandler_->moveToThread(writerThread_);
+    if (eventNotifier_)
+        eventNotifier_->moveToThread(writerThread_);
+    writerThread_->start();
+}
+
+void SensorManager::startRateGovernor()
+{
+    if (!Config::configuration())
+        return;
+    int period = Config::configuration()->value<int>("global/rate_governor_period", 0);
+    if (period <= 0)
+        return;
+    governorMaxInterval_ = Config::configuration()->value<unsigned int>("global/rate_governor_max_interval", 1000);
+    sensordLogD() << "Governing rates of slow clients every " << period << "ms";
+    socketHandler_->watchConsumption(period);
+}
+
+void SensorManager::governSession(int sessionId, bool congested)
+{
+    QHash<int, QString>::const_iterator session = sessionSensors_.constFind(sessionId);
+    if (session == sessionSensors_.constEnd())
+        return;
+    QMap<QString, SensorInstanceEntry>::iterator entry = sensorInstanceMap_.find(session.value());
+    if (entry == sensorInstanceMap_.end() || !entry.value().sensor_)
+        return;
+    AbstractSensorChannel* sensor = entry.value().sensor_;
+
+    IntervalOverride* override = findIntervalOverride(sessionId, sensor);
+    unsigned int governed = override ? override->values[RateGovernor] : 0;
+
+    if (!congested) {
+        if (governed) {
+            sensordLogD() << "[SensorManager]: Session " << sessionId << " caught up";
+            setIntervalOverride(sessionId, sensor, RateGovernor, 0);
+        }
+        return;
+    }
+
+    // Governed interval doubles by itself, a step snapped back to the
+    // current rate class is not lost
+    unsigned int slower = (governed ? governed : sensor->getInterval(sessionId)) * 2;
+    if (!slower || slower > governorMaxInterval_)
+        return;
+    sensordLogD() << "[SensorManager]: Session " << sessionId << " falling behind, governed interval " << slower;
+    setIntervalOverride(sessionId, sensor, RateGovernor, slower);
+}
+
+SensorManager::IntervalOverride* SensorManager::findIntervalOverride(int sessionId, AbstractSensorChannel* sensor)
+{
+    QHash<int, IntervalOverride>::iterator it = intervalOverrides_.find(sessionId);
+    if (it == intervalOverrides_.end())
+        return 0;
+    if (it.value().applied != sensor->getInterval(sessionId)) {
+        // Client has requested a new interval since
+        intervalOverrides_.erase(it);
+        return 0;
+    }
+    return &it.value();
+}
+
+void SensorManager::setIntervalOverride(int sessionId, AbstractSensorChannel* sensor, IntervalOverrider overrider, unsigned int value)
+{
+    IntervalOverride* override = findIntervalOverride(sessionId, sensor);
+    unsigned int current = sensor->getInterval(sessionId);
+    if (!override) {
+        // Default interval is not negotiated on behalf of the client
+        if (!value || !current)
+            return;
+        IntervalOverride fresh;
+        fresh.requested = current;
+        fresh.applied = current;
+        override = &intervalOverrides_.insert(sessionId, fresh).value();
+    }
+    override->values[overrider] = value;
+
+    bool active = false;
+    unsigned int target = override->requested;
+    for (int i = 0; i < IntervalOverriders; ++i) {
+        active |= (override->values[i] != 0);
+        target = qMax(target, override->values[i]);
+    }
+
+    if (target != current && sensor->setIntervalRequest(sessionId, target)) {
+        // Stored request is snapped to a rate class and is what
+        // findIntervalOverride() compares against
+        override->applied = sensor->getInterval(sessionId);
+        sensordLogD() << "[SensorManager]: Session " << sessionId << " interval " << current << " -> " << override->applied
+                      << ", requested " << override->requested;
+    }
+    if (!active)
+        intervalOverrides_.remove(sessionId);
+}
+
+void SensorManager::startOverloadController()
+{
+    if (overload_ || !Config::configuration())
+        return;
+    overloadPeriod_ = Config::configuration()->value<int>("global/overload_period", 0);
+    if (overloadPeriod_ <= 0)
+        return;
+    overloadMaxInterval_ = Config::configuration()->value<unsigned int>("global/overload_max_interval", overloadMaxInterval_);
+    sensordLogD() << "Checking load every " << overloadPeriod_ << "ms";
+
+    overload_ = new OverloadController(this);
+    connect(overload_, SIGNAL(levelChanged(int, int)), this, SLOT(applyOverloadLevel(int, int)));
+    foreach (int sessionId, sessionSensors_.keys()) {
+        overload_->addSession(sessionId, 0);
+        overloadUnresolved_.insert(sessionId);
+    }
+    overloadTimer_ = new ClockTimer(this);
+    connect(overloadTimer_, SIGNAL(timeout()), this, SLOT(checkOverload()));
+    overloadDeadline_ = Clock::monotonicUs() + overloadPeriod_ * 1000ULL;
+    overloadTimer_->start(overloadPeriod_);
+}
+
+void SensorManager::checkOverload()
+{
+    quint64 now = Clock::monotonicUs();
+    unsigned int lag = now > overloadDeadline_ ? (now - overloadDeadline_) / 1000 : 0;
+    overloadDeadline_ = now + overloadPeriod_ * 1000ULL;
+
+    // Client PID is known once the data socket is connected
+    foreach (int sessionId, overloadUnresolved_) {
+        bool ok;
+        qint64 pid = socketToPid(sessionId).toLongLong(&ok);
+        if (!ok)
+            continue;
+        overload_->setPriority(sessionId, policyPriority(pid));
+        overloadUnresolved_.remove(sessionId);
+    }
+
+    overload_->update(sampleQueueLoad(), lag);
+}
+
+int SensorManager::policyPriority(qint64 pid)
+{
+    if (!Config::configuration())
+        return 0;
+    QStringList policy = Config::configuration()->value<QStringList>("global/overload_priorities", QStringList());
+    if (policy.isEmpty())
+        return 0;
+
+    QFile comm(QString("/proc/%1/comm").arg(pid));
+    if (!comm.open(QIODevice::ReadOnly))
+        return 0;
+    QString name = QString::fromLocal8Bit(comm.readAll()).trimmed();
+    foreach (const QString& entry, policy) {
+        int separator = entry.lastIndexOf(':');
+        if (separator > 0 && entry.left(separator).trimmed() == name)
+            return entry.mid(separator + 1).toInt();
+    }
+    return 0;
+}
+
+bool SensorManager::setSessionPriority(int sessionId, int priority)
+{
+    if (!overload_)
+        return false;
+    overloadUnresolved_.remove(sessionId);
+    return overload_->setPriority(sessionId, priority);
+}
+
+unsigned int SensorManager::sampleQueueLoad() const
+{
+    QMutexLocker locker(&sampleQueueMutex_);
+    unsigned int load = 0;
+    for (int priority = 0; priority < SamplePriorities; ++priority) {
+        foreach (SampleQueue* queue, sampleQueues_[priority])
+            load = qMax(load, queue->depth() * 100 / queue->size());
+    }
+    return load;
+}
+
+void SensorManager::applyOverloadLevel(int sessionId, int level)
+{
+    socketHandler_->setShedding(sessionId, level > 0);
+
+    QHash<int, QString>::const_iterator session = sessionSensors_.constFind(sessionId);
+    if (session == sessionSensors_.constEnd())
+        return;
+    QMap<QString, SensorInstanceEntry>::iterator entry = sensorInstanceMap_.find(session.value());
+    if (entry == sensorInstanceMap_.end() || !entry.value().sensor_)
+        return;
+    AbstractSensorChannel* sensor = entry.value().sensor_;
+
+    IntervalOverride* override = findIntervalOverride(sessionId, sensor);
+    unsigned int requested = override ? override->requested : sensor->getInterval(sessionId);
+
+    unsigned int shed = 0;
+    if (requested && level > 1)
+        shed = qMin(requested << qMin(level - 1, 16), qMax(requested, overloadMaxInterval_));
+    if (shed == requested)
+        shed = 0;
+    if (!shed && !(override && override->values[OverloadShedding]))
+        return;
+    sensordLogD() << "[SensorManager]: Session " << sessionId << " at overload level " << level << ", shed interval " << shed;
+    setIntervalOverride(sessionId, sensor, OverloadShedding, shed);
+}
+
 bool SensorManager::registerService()
 {
     clearError();
 
+    startWriterThread();
+    startRateGovernor();
+    startOverloadController();
+    if (DeviceDiscovery::enabled()) {
+        StartupSpan span("discovery", "scan devices");
+        connect(&DeviceDiscovery::instance(), SIGNAL(deviceAdded(DiscoveredDevice)), this, SLOT(deviceAttached(DiscoveredDevice)));
+    }
+    openSessionStore();
+
+#ifdef SENSORFW_NO_DBUS
+    sensordLogD() << "Built without D-Bus, sensord is controlled through its socket";
+    return true;
+#else
     bool ok = bus().isConnected();
     if ( !ok )
     {
@@ -238,6 +600,7 @@ bool SensorManager::registerService()
         return false;
     }
     return true;
+#endif
 }
 
 AbstractSensorChannel* SensorManager::addSensor(const QString& id)
@@ -263,6 +626,8 @@ AbstractSensorChannel* SensorManager::addSensor(const QString& id)
         return NULL;
     }
 
+    // Nodes build their graphs in arenas of their own
+    NodeArenaScope heap(NULL);
     AbstractSensorChannel* sensorChannel = sensorFactoryMap_[typeName](id);
     if ( !sensorChannel->isValid() )
     {
@@ -271,6 +636,7 @@ AbstractSensorChannel* SensorManager::addSensor(const QString& id)
         return NULL;
     }
 
+#ifndef SENSORFW_NO_DBUS
     bool ok = bus().registerObject(OBJECT_PATH + "/" + sensorChannel->id(), sensorChannel);
     if ( !ok )
     {
@@ -280,6 +646,7 @@ AbstractSensorChannel* SensorManager::addSensor(const QString& id)
         delete sensorChannel;
         return NULL;
     }
+#endif
     return sensorChannel;
 }
 
@@ -288,7 +655,10 @@ void SensorManager::removeSensor(const QString& id)
     sensordLogD() << "Removing sensor: " << id;
 
     QMap<QString, SensorInstanceEntry>::iterator entryIt = sensorInstanceMap_.find(id);
+#ifndef SENSORFW_NO_DBUS
     bus().unregisterObject(OBJECT_PATH + "/" + id);
+#endif
+    stopRecordings(id);
     delete entryIt.value().sensor_;
     entryIt.value().sensor_ = 0;
 }
@@ -307,6 +677,34 @@ bool SensorManager::loadPlugin(const QString& name)
     return result;
 }
 
+void SensorManager::loadPluginOnDemand(const QString& id, bool registered)
+{
+    Loader& l = Loader::instance();
+    if (registered || !l.lazy())
+        return;
+
+    QString errorMessage;
+    if (!l.loadPluginFor(id, &errorMessage))
+        sensordLogW() << "Loading plugin for " << id << " failed: " << errorMessage;
+}
+
+void SensorManager::loadPluginsLater(const QStringList& names)
+{
+    if (queuedPlugins_.isEmpty())
+        QMetaObject::invokeMethod(this, "loadQueuedPlugins", Qt::QueuedConnection);
+    queuedPlugins_.append(names);
+}
+
+void SensorManager::loadQueuedPlugins()
+{
+    QStringList names = queuedPlugins_;
+    queuedPlugins_.clear();
+    foreach (const QString& name, names) {
+        bool loaded = loadPlugin(name);
+        sensordLogD() << "Loading " << name << " " << loaded;
+    }
+}
+
 int SensorManager::requestSensor(const QString& id)
 {
     sensordLogD() << "Requesting sensor: " << id;
@@ -314,6 +712,7 @@ int SensorManager::requestSensor(const QString& id)
     clearError();
 
     QString cleanId = getCleanId(id);
+    loadPluginOnDemand(cleanId, sensorInstanceMap_.contains(cleanId));
     QMap<QString, SensorInstanceEntry>::iterator entryIt = sensorInstanceMap_.find(cleanId);
 
     if ( entryIt == sensorInstanceMap_.end() )
@@ -322,7 +721,15 @@ int SensorManager::requestSensor(const QString& id)
         return INVALID_SESSION;
     }
 
-    int sessionId = createNewSessionId();
+    int sessionId = openSession(cleanId, createNewSessionId());
+    if (sessionId != INVALID_SESSION && sessionStore_)
+        sessionStore_->issue(sessionId, cleanId);
+    return sessionId;
+}
+
+int SensorManager::openSession(const QString& id, int sessionId)
+{
+    QMap<QString, SensorInstanceEntry>::iterator entryIt = sensorInstanceMap_.find(id);
     if(!entryIt.value().sensor_)
     {
         AbstractSensorChannel* sensor = addSensor(id);
@@ -332,12 +739,188 @@ int SensorManager::requestSensor(const QString& id)
             return INVALID_SESSION;
         }
         entryIt.value().sensor_ = sensor;
+        recordCapabilities(id, sensor);
     }
     entryIt.value().sessions_.insert(sessionId);
+    sessionSensors_.insert(sessionId, id);
+    socketHandler_->setSessionChannel(sessionId, id);
+    if (overload_) {
+        overload_->addSession(sessionId, 0);
+        overloadUnresolved_.insert(sessionId);
+    }
+    scheduleReclaim();
+
+    return sessionId;
+}
+
+quint64 SensorManager::sessionToken(int sessionId)
+{
+    SessionRecord* record = sessionRecord(sessionId);
+    return record ? record->token : 0;
+}
+
+QString SensorManager::sessionSensorId(int sessionId) const
+{
+    return sessionSensors_.value(sessionId);
+}
+
+SessionRecord* SensorManager::sessionRecord(int sessionId)
+{
+    return sessionStore_ ? sessionStore_->find(sessionId) : 0;
+}
+
+int SensorManager::resumeSession(quint64 token)
+{
+    clearError();
+
+    SessionRecord* record = sessionStore_ ? sessionStore_->findToken(token) : 0;
+    if (!record)
+    {
+        setError(SmIdNotRegistered, tr("unknown resume token"));
+        return INVALID_SESSION;
+    }
+    int sessionId = record->sessionId;
+    if (sessionSensors_.contains(sessionId))
+        return sessionId;
+
+    QString id = QString::fromLatin1(record->id);
+    loadPluginOnDemand(id, sensorInstanceMap_.contains(id));
+    if (!sensorInstanceMap_.contains(id))
+    {
+        sessionStore_->release(sessionId);
+        setError(SmIdNotRegistered, QString(tr("requested sensor id '%1' not registered")).arg(id));
+        return INVALID_SESSION;
+    }
+    if (openSession(id, sessionId) == INVALID_SESSION)
+    {
+        sessionStore_->release(sessionId);
+        return INVALID_SESSION;
+    }
 
+    sensordLogD() << "Resuming session " << sessionId << " of " << id;
+    if (pendingResumes_.isEmpty())
+        QMetaObject::invokeMethod(this, "processResumes", Qt::QueuedConnection);
+    pendingResumes_.append(*record);
     return sessionId;
 }
 
+void SensorManager::processResumes()
+{
+    QList<SessionRecord> records = pendingResumes_;
+    pendingResumes_.clear();
+
+    foreach (const SessionRecord& record, records)
+    {
+        QHash<int, QString>::const_iterator session = sessionSensors_.constFind(record.sessionId);
+        if (session == sessionSensors_.constEnd())
+            continue;
+        AbstractSensorChannel* sensor = sensorInstanceMap_.value(session.value()).sensor_;
+        AbstractSensorChannelAdaptor* adaptor = sensor ? sensor->findChild<AbstractSensorChannelAdaptor*>() : 0;
+        if (!adaptor)
+            continue;
+
+        if (record.hasRange)
+            adaptor->requestDataRange(record.sessionId, DataRange(record.rangeMin, record.rangeMax, record.rangeResolution));
+        if (record.running)
+        {
+            adaptor->configureAndStart(record.sessionId, record.standbyOverride, record.interval,
+                                       record.bufferInterval, record.bufferSize, record.downsampling);
+        }
+        else
+        {
+            adaptor->setStandbyOverride(record.sessionId, record.standbyOverride);
+            adaptor->setInterval(record.sessionId, record.interval);
+            adaptor->setBufferInterval(record.sessionId, record.bufferInterval);
+            adaptor->setBufferSize(record.sessionId, record.bufferSize);
+            adaptor->setDownsampling(record.sessionId, record.downsampling);
+        }
+    }
+    sensordLogD() << "Resumed " << records.size() << " session(s)";
+}
+
+void SensorManager::openSessionStore()
+{
+    if (sessionStore_ || !Config::configuration())
+        return;
+    QString path = Config::configuration()->value<QString>("global/session_state_file", "/run/sensord/sessions");
+    if (path.isEmpty())
+        return;
+    sessionStore_ = new SessionStore;
+    if (!sessionStore_->open(path, Config::configuration()->value<int>("global/session_state_capacity", 64)))
+    {
+        delete sessionStore_;
+        sessionStore_ = 0;
+        return;
+    }
+    sessionIdCount_ = qMax(sessionIdCount_, sessionStore_->lastSessionId());
+    if (!sessionStore_->previousSessions().isEmpty())
+        QTimer::singleShot(Config::configuration()->value<int>("global/session_resume_timeout", 60000), this, SLOT(releaseStaleSessions()));
+}
+
+void SensorManager::releaseStaleSessions()
+{
+    if (!sessionStore_)
+        return;
+    foreach (int sessionId, sessionStore_->previousSessions())
+    {
+        if (!sessionSensors_.contains(sessionId))
+        {
+            sensordLogD() << "Session " << sessionId << " was not resumed";
+            sessionStore_->release(sessionId);
+        }
+    }
+}
+
+void SensorManager::requestReload()
+{
+    if (reloadPipe[1] != -1) {
+        char byte = 0;
+        if (::write(reloadPipe[1], &byte, 1) < 0) {
+            // pipe full, a reload is pending anyway
+        }
+    }
+}
+
+void SensorManager::reloadRequested(int fd)
+{
+    char bytes[16];
+    while (read(fd, bytes, sizeof(bytes)) > 0)
+        ;
+    reloadConfig();
+}
+
+bool SensorManager::reloadConfig()
+{
+    QStringList keys;
+    if (!Config::reloadConfig(keys)) {
+        sensordLogW() << "Configuration reload failed, keeping previous configuration";
+        return false;
+    }
+    if (keys.isEmpty()) {
+        sensordLogD() << "Configuration reloaded, no changes";
+        return true;
+    }
+    sensordLogD() << "Configuration reloaded, changed keys: " << keys.join(", ");
+
+    // data flows adaptor → chain → sensor, reconfigure in the same order
+    for (QMap<QString, DeviceAdaptorInstanceEntry>::iterator it = deviceAdaptorInstanceMap_.begin(); it != deviceAdaptorInstanceMap_.end(); ++it)
+    {
+        if (it.value().adaptor_)
+            it.value().adaptor_->reconfigure(keys);
+    }
+    for (QMap<QString, ChainInstanceEntry>::iterator it = chainInstanceMap_.begin(); it != chainInstanceMap_.end(); ++it)
+    {
+        if (it.value().chain_)
+            it.value().chain_->reconfigure(keys);
+    }
+    for (QMap<QString, SensorInstanceEntry>::iterator it = sensorInstanceMap_.begin(); it != sensorInstanceMap_.end(); ++it)
+    {
+        if (it.value().sensor_)
+            it.value().sensor_->reconfigure(keys);
+    }
+    return true;
+}
+
 bool SensorManager::releaseSensor(const QString& id, int sessionId)
 {
     sensordLogD() << "Releasing sensor '" << id << "' for session: " << sessionId;
@@ -360,6 +943,7 @@ bool SensorManager::releaseSensor(const QString& id, int sessionId)
 
     /// Remove any property requests by this session
     entryIt.value().sensor_->removeSession(sessionId);
+    scheduleReclaim();
 
     if (entryIt.value().sessions_.empty())
     {
@@ -371,6 +955,13 @@ bool SensorManager::releaseSensor(const QString& id, int sessionId)
 
     if(entryIt.value().sessions_.remove( sessionId ))
     {
+        sessionSensors_.remove(sessionId);
+        intervalOverrides_.remove(sessionId);
+        overloadUnresolved_.remove(sessionId);
+        if (overload_)
+            overload_->removeSession(sessionId);
+        if (sessionStore_)
+            sessionStore_->release(sessionId);
         /** Fix for NB#242237
         if ( entryIt.value().sessions_.empty() )
         {
@@ -396,6 +987,7 @@ AbstractChain* SensorManager::requestChain(const QString& id)
     clearError();
 
     AbstractChain* chain = NULL;
+    loadPluginOnDemand(id, chainInstanceMap_.contains(id));
     QMap<QString, ChainInstanceEntry>::iterator entryIt = chainInstanceMap_.find(id);
     if (entryIt != chainInstanceMap_.end())
     {
@@ -410,6 +1002,7 @@ AbstractChain* SensorManager::requestChain(const QString& id)
             QString type = entryIt.value().type_;
             if (chainFactoryMap_.contains(type))
             {
+                NodeArenaScope heap(NULL);
                 chain = chainFactoryMap_[type](id);
                 Q_ASSERT(chain);
                 sensordLogD() << "Instantiated chain '" << id << "'. Valid = " << chain->isValid();
@@ -481,6 +1074,7 @@ DeviceAdaptor* SensorManager::requestDeviceAdaptor(const QString& id)
     }
 
     DeviceAdaptor* da = NULL;
+    loadPluginOnDemand(id, deviceAdaptorInstanceMap_.contains(id));
     QMap<QString, DeviceAdaptorInstanceEntry>::iterator entryIt = deviceAdaptorInstanceMap_.find(id);
     if ( entryIt != deviceAdaptorInstanceMap_.end() )
     {
@@ -496,6 +1090,8 @@ DeviceAdaptor* SensorManager::requestDeviceAdaptor(const QString& id)
             QString type = entryIt.value().type_;
             if ( deviceAdaptorFactoryMap_.contains(type) )
             {
+                NodeArenaScope heap(NULL);
+                StartupSpan span("adaptor", "probe " + id);
                 da = deviceAdaptorFactoryMap_[type](id);
                 Q_ASSERT( da );
                 da->init();
@@ -560,6 +1156,13 @@ void SensorManager::releaseDeviceAdaptor(const QString& id)
                 delete entryIt.value().adaptor_;
                 entryIt.value().adaptor_ = 0;
                 */
+                // Configuration is loaded after SensorManager is created
+                idleTimeout_ = Config::configuration()->value<int>("global/adaptor_idle_timeout", 0);
+                if (idleTimeout_ > 0) {
+                    entryIt.value().idle_.start();
+                    if (!idleTimer_->isActive())
+                        idleTimer_->start(idleTimeout_);
+                }
             }
             else
             {
@@ -581,6 +1184,7 @@ FilterBase* SensorManager::instantiateFilter(const QString& id)
 {
     sensordLogD() << "Instantiating filter: " << id;
 
+    loadPluginOnDemand(id, filterFactoryMap_.contains(id));
     QMap<QString, FilterFactoryMethod>::iterator it = filterFactoryMap_.find(id);
     if(it == filterFactoryMap_.end())
     {
@@ -590,54 +1194,237 @@ FilterBase* SensorManager::instantiateFilter(const QString& id)
     return it.value()();
 }
 
-bool SensorManager::write(int id, const void* source, int size)
+SampleQueue* SensorManager::threadSampleQueue(SamplePriority priority)
 {
-    void* buffer = malloc(size);
-    if(!buffer) {
-        sensordLogC() << "Malloc failed!";
-        return false;
+    if (!threadSampleQueues.hasLocalData())
+        threadSampleQueues.setLocalData(new SampleQueueHandle);
+    SampleQueueHandle* handle = threadSampleQueues.localData();
+    if (handle->queues_[priority])
+        return handle->queues_[priority];
+
+    QMutexLocker locker(&sampleQueueMutex_);
+
+    SampleQueue* queue = NULL;
+    foreach (SampleQueue* candidate, sampleQueues_[priority]) {
+        if (candidate->acquire()) {
+            queue = candidate;
+            break;
+        }
     }
-    PipeData pipeData;
-    pipeData.id = id;
-    pipeData.size = size;
-    pipeData.buffer = buffer;
 
-    memcpy(buffer, source, size);
+    if (!queue) {
+        unsigned int size = 256;
+        if (Config::configuration())
+            size = Config::configuration()->value<unsigned int>("global/sample_queue_size", size);
+        queue = new SampleQueue(size);
+        queue->acquire();
+        sampleQueues_[priority].append(queue);
+        sensordLogD() << "Created sample queue of " << size << " samples. Queues of class " << priority << " in use: " << sampleQueues_[priority].size();
+    }
 
-    if (::write(pipefds_[1], &pipeData, sizeof(pipeData)) < (int)sizeof(pipeData)) {
-        sensordLogW() << "Failed to write all data to pipe.";
-        return false;
+    handle->queues_[priority] = queue;
+    return queue;
+}
+
+bool SensorManager::write(int id, const void* source, int size, SamplePriority priority)
+{
+    return write(&id, 1, source, size, priority);
+}
+
+bool SensorManager::write(const int* ids, int count, const void* source, int size, SamplePriority priority)
+{
+    return writeSamples(ids, count, source, size, 1, priority);
+}
+
+bool SensorManager::writeSamples(const int* ids, int count, const void* samples, int size, unsigned int n, SamplePriority priority)
+{
+    SampleQueue* queue = threadSampleQueue(priority);
+    SENSORD_PROBE4(sample_enqueue, count ? ids[0] : -1, count, n, size);
+
+    bool ret = true;
+    bool signal = false;
+    const char* source = (const char*)samples;
+    for (unsigned int sample = 0; sample < n; ++sample, source += size) {
+        for (int i = 0; i < count; i += SampleQueue::MAX_FANOUT) {
+            int sessions = qMin(count - i, (int)SampleQueue::MAX_FANOUT);
+            bool wakeup = false;
+            // Drops are counted by the queue and reported by the drain
+            if (!queue->push(ids + i, sessions, source, size, wakeup))
+                ret = false;
+            signal |= wakeup;
+        }
     }
-    return true;
+
+    if (signal) {
+        quint64 value = 1;
+        if (::write(eventFd_, &value, sizeof(value)) != sizeof(value)) {
+            sensordLogW() << "Failed to signal sample queue: " << strerror(errno);
+            return false;
+        }
+    }
+    return ret;
 }
 
 void SensorManager::sensorDataHandler(int)
 {
-    PipeData pipeData;
-    read(pipefds_[0], &pipeData, sizeof(pipeData));
+    QMutexLocker batchLocker(&sampleBatchMutex_);
 
-    if (!socketHandler_->write(pipeData.id, pipeData.buffer, pipeData.size)) {
-        sensordLogW() << "Failed to write data to socket.";
+    quint64 value;
+    if (read(eventFd_, &value, sizeof(value)) != sizeof(value) && errno != EAGAIN) {
+        sensordLogW() << "Failed to read sample queue eventfd: " << strerror(errno);
+    }
+
+    if (sampleBatchLimit_ <= 0) {
+        sampleBatchLimit_ = 64;
+        if (Config::configuration())
+            sampleBatchLimit_ = Config::configuration()->value<int>("global/sample_batch_limit", sampleBatchLimit_);
+        if (sampleBatchLimit_ <= 0)
+            sampleBatchLimit_ = 1;
     }
 
-    free(pipeData.buffer);
+    unsigned long allocations = AllocCounter::threadCount();
+
+    // Fast channels are written out before slow ones are even looked at
+    bool pending = false;
+    for (int priority = 0; priority < SamplePriorities; ++priority) {
+        if (!drainSampleQueues((SamplePriority)priority))
+            pending = true;
+    }
+
+    drainAllocations_.fetchAndAddRelaxed(AllocCounter::threadCount() - allocations);
+
+    if (pending) {
+        // Let other events run before draining the rest. Producers only
+        // signal on empty queue so reschedule ourselves.
+        value = 1;
+        if (::write(eventFd_, &value, sizeof(value)) != sizeof(value)) {
+            sensordLogW() << "Failed to signal sample queue eventfd: " << strerror(errno);
+        }
+    }
 }
 
-void SensorManager::lostClient(int sessionId)
+bool SensorManager::drainSampleQueues(SamplePriority priority)
 {
-    for(QMap<QString, SensorInstanceEntry>::iterator it = sensorInstanceMap_.begin(); it != sensorInstanceMap_.end(); ++it) {
-        if (it.value().sessions_.contains(sessionId)) {
-            sensordLogD() << "[SensorManager]: Lost session " << sessionId << " detected as " << it.key();
+    QList<SampleQueue*> queues;
+    {
+        QMutexLocker locker(&sampleQueueMutex_);
+        queues = sampleQueues_[priority];
+    }
 
-            sensordLogD() << "[SensorManager]: Stopping sessionId " << sessionId;
-            it.value().sensor_->stop(sessionId);
+    int drained = 0;
+    bool pending = false;
+    reportSampleDrops(queues);
+    // Runs of samples for one session, the common case, look their batch
+    // up once. Batches only move when another session's batch is added.
+    int lastId = -1;
+    SampleBatch* lastBatch = 0;
+    foreach (SampleQueue* queue, queues) {
+        const SampleQueue::Slot* slot;
+        while ((slot = queue->front())) {
+            if (drained == sampleBatchLimit_) {
+                pending = true;
+                break;
+            }
+            SENSORD_PROBE3(sample_dequeue, slot->sessions[0], slot->sessionCount, slot->size);
+            for (int i = 0; i < slot->sessionCount; ++i) {
+                int id = slot->sessions[i];
+                if (!lastBatch || id != lastId) {
+                    lastBatch = &sampleBatches_[id];
+                    lastId = id;
+                }
+                SampleBatch& batch = *lastBatch;
+                if (batch.count && batch.size != slot->size)
+                    flushSampleBatch(id, batch);
+                if (!batch.count) {
+                    batch.size = slot->size;
+                    if (!batch.data.capacity())
+                        batch.data.reserve(sampleBatchLimit_ * slot->size);
+                }
+                batch.data.append(slot->data, slot->size);
+                ++batch.count;
+            }
+            ++drained;
+            queue->pop();
+        }
+        if (pending)
+            break;
+    }
 
-            sensordLogD() << "[SensorManager]: Releasing sessionId " << sessionId;
-            releaseSensor(it.key(), sessionId);
-            return;
+    if (drained) {
+        for (QHash<int, SampleBatch>::iterator it = sampleBatches_.begin(); it != sampleBatches_.end(); ++it) {
+            flushSampleBatch(it.key(), it.value());
         }
     }
-    sensordLogW() << "[SensorManager]: Lost session " << sessionId << " detected, but not found from session list";
+
+    drainedSamples_.fetchAndAddRelaxed(drained);
+    return !pending;
+}
+
+void SensorManager::reportSampleDrops(const QList<SampleQueue*>& queues)
+{
+    // At most once a second, so an overloaded main loop does not flood
+    // the log from the sample path
+    if (dropReport_.isValid() && dropReport_.elapsed() < 1000)
+        return;
+    unsigned int drops = 0;
+    foreach (SampleQueue* queue, queues)
+        drops += queue->takeDrops();
+    if (!drops)
+        return;
+    sensordLogW() << "Sample queue full or sample too large, dropped " << drops << " sample(s)";
+    dropReport_.start();
+}
+
+void SensorManager::flushSampleBatch(int id, SampleBatch& batch)
+{
+    if (!batch.count)
+        return;
+    if (!socketHandler_->write(id, batch.data.constData(), batch.size, batch.count)) {
+        sensordLogW() << "Failed to write data to socket.";
+    }
+    // Reserved capacity is kept over resize(0)
+    batch.data.resize(0);
+    batch.count = 0;
+}
+
+void SensorManager::lostClient(int sessionId)
+{
+    if (lostSessions_.isEmpty())
+        QMetaObject::invokeMethod(this, "releaseLostClients", Qt::QueuedConnection);
+    lostSessions_.append(sessionId);
+}
+
+void SensorManager::releaseLostClients()
+{
+    QList<int> sessionIds = lostSessions_;
+    lostSessions_.clear();
+
+    {
+        QMutexLocker locker(&sampleBatchMutex_);
+        foreach (int sessionId, sessionIds)
+            sampleBatches_.remove(sessionId);
+    }
+    foreach (int sessionId, sessionIds)
+        releaseLostClient(sessionId);
+}
+
+void SensorManager::releaseLostClient(int sessionId)
+{
+    QHash<int, QString>::const_iterator session = sessionSensors_.constFind(sessionId);
+    QMap<QString, SensorInstanceEntry>::iterator it = session == sessionSensors_.constEnd() ?
+        sensorInstanceMap_.end() : sensorInstanceMap_.find(session.value());
+    if (it == sensorInstanceMap_.end() || !it.value().sensor_) {
+        sensordLogW() << "[SensorManager]: Lost session " << sessionId << " detected, but not found from session list";
+        return;
+    }
+
+    sensordLogD() << "[SensorManager]: Lost session " << sessionId << " detected as " << it.key();
+
+    sensordLogD() << "[SensorManager]: Stopping sessionId " << sessionId;
+    it.value().sensor_->stop(sessionId);
+
+    sensordLogD() << "[SensorManager]: Releasing sessionId " << sessionId;
+    releaseSensor(it.key(), sessionId);
 }
 
 void SensorManager::displayStateChanged(bool displayState)
@@ -655,18 +1442,18 @@ void SensorManager::displayStateChanged(bool displayState)
 
     }
 
-    foreach (const DeviceAdaptorInstanceEntry& adaptor, deviceAdaptorInstanceMap_) {
-        if (adaptor.adaptor_) {
-            if (displayState) {
-                adaptor.adaptor_->setScreenBlanked(false);
-                adaptor.adaptor_->resume();
+    // Sessions kept running by standby override are batched while blanked
+    socketHandler_->setScreenBlanked(!displayState);
 
-            } else {
-                adaptor.adaptor_->setScreenBlanked(true);
-                adaptor.adaptor_->standby();
-            }
-        }
+    QList<DeviceAdaptor*> adaptors;
+    foreach (const DeviceAdaptorInstanceEntry& adaptor, deviceAdaptorInstanceMap_) {
+        if (adaptor.adaptor_)
+            adaptors.append(adaptor.adaptor_);
     }
+    bool concurrent = true;
+    if (Config::configuration())
+        concurrent = Config::configuration()->value<bool>("global/concurrent_power_transitions", concurrent);
+    PowerTransition::apply(adaptors, !displayState, concurrent);
 }
 
 void SensorManager::devicePSMStateChanged(bool psmState)
@@ -675,6 +1462,11 @@ void SensorManager::devicePSMStateChanged(bool psmState)
     {
         emit stopCalibration();
     }
+
+    QStringList wakeupSensors;
+    if (Config::configuration())
+        wakeupSensors = Config::configuration()->value<QStringList>("global/wakeup_sensors", QStringList() << "proximitysensor");
+    socketHandler_->setPowerSave(psmState, wakeupSensors);
 }
 
 void SensorManager::printStatus(QStringList& output) const
@@ -687,6 +1479,12 @@ void SensorManager::printStatus(QStringList& output) const
     output.append("  Chains:\n");
     for (QMap<QString, ChainInstanceEntry>::const_iterator it = chainInstanceMap_.constBegin(); it != chainInstanceMap_.constEnd(); ++it) {
         output.append(QString("    %1 [%2 listener(s)]. %3\n").arg(it.value().type_).arg(it.value().cnt_).arg((it.value().chain_ && it.value().chain_->running()) ? "Running" : "Stopped"));
+        const ChainStrand* strand = it.value().chain_ ? it.value().chain_->strand() : 0;
+        if (strand) {
+            output.append(QString("      on %1: queue depth %2 (max %3), %4 run(s), %5 stolen, %6 coalesced\n")
+                          .arg(strand->home()->objectName()).arg(strand->depth()).arg(strand->maxDepth())
+                          .arg(strand->runs()).arg(strand->steals()).arg(strand->coalesced()));
+        }
     }
 
     output.append("  Logical sensors:\n");
@@ -701,6 +1499,477 @@ void SensorManager::printStatus(QStringList& output) const
         str.append(QString(". %1\n").arg((it.value().sensor_ && it.value().sensor_->running()) ? "Running" : "Stopped"));
         output.append(str);
     }
+
+    output.append("  Data sessions:\n");
+    output.append(QString("    %1 reallocation(s) with slow client\n").arg(socketHandler_->blockedCount()));
+    if (overload_) {
+        int shed = 0;
+        foreach (int sessionId, sessionSensors_.keys()) {
+            if (overload_->level(sessionId))
+                ++shed;
+        }
+        output.append(QString("    %1, %2 session(s) shed, sample queues %3% full\n")
+                      .arg(overload_->overloaded() ? "Overloaded" : "Not overloaded").arg(shed).arg(sampleQueueLoad()));
+    }
+    printSessionCosts(output);
+
+    output.append("  Buffers:\n");
+    printStatistics(output);
+
+    output.append("  Memory:\n");
+    printMemoryUsage(output);
+
+    if (LatencyTracer::instance().isEnabled()) {
+        output.append("  Latency:\n");
+        LatencyTracer::instance().statistics(output);
+    }
+
+    output.append("  Dataflow:\n");
+    foreach (const QString& line, dataflowGraph("dot").split('\n', QString::SkipEmptyParts))
+        output.append(QString("    %1\n").arg(line));
+}
+
+QString SensorManager::dataflowGraph(const QString& format) const
+{
+    if (format != "dot" && format != "json")
+        return QString();
+
+    DataflowGraph graph;
+    QList<const NodeBase*> owners;
+    QStringList ownerIds;
+    for (QMap<QString, DeviceAdaptorInstanceEntry>::const_iterator it = deviceAdaptorInstanceMap_.constBegin(); it != deviceAdaptorInstanceMap_.constEnd(); ++it) {
+        const AdaptedSensorEntry* entry = it.value().adaptor_ ? it.value().adaptor_->getAdaptedSensor() : 0;
+        if (entry && entry->buffer())
+            graph.addBuffer(it.key() + "/" + entry->name(), entry->buffer());
+    }
+    for (QMap<QString, ChainInstanceEntry>::const_iterator it = chainInstanceMap_.constBegin(); it != chainInstanceMap_.constEnd(); ++it) {
+        if (!it.value().chain_)
+            continue;
+        const QMap<QString, RingBufferBase*>& buffers = it.value().chain_->buffers();
+        for (QMap<QString, RingBufferBase*>::const_iterator buffer = buffers.constBegin(); buffer != buffers.constEnd(); ++buffer)
+            graph.addBuffer(it.key() + "/" + buffer.key(), buffer.value());
+        owners.append(it.value().chain_);
+        ownerIds.append(it.key());
+    }
+    for (QMap<QString, SensorInstanceEntry>::const_iterator it = sensorInstanceMap_.constBegin(); it != sensorInstanceMap_.constEnd(); ++it) {
+        if (!it.value().sensor_)
+            continue;
+        const QMap<QString, RingBufferBase*>& buffers = it.value().sensor_->internalBuffers();
+        for (QMap<QString, RingBufferBase*>::const_iterator buffer = buffers.constBegin(); buffer != buffers.constEnd(); ++buffer)
+            graph.addBuffer(it.key() + "/" + buffer.key(), buffer.value());
+        owners.append(it.value().sensor_);
+        ownerIds.append(it.key());
+    }
+
+    // Bins are attributed to the chain or sensor whose arena they were built in
+    QList<const Bin*> bins(Bin::instances());
+    for (int i = 0; i < bins.size(); ++i) {
+        QString prefix = QString("bin%1").arg(i);
+        for (int owner = 0; owner < owners.size(); ++owner) {
+            if (bins.at(i)->arena() && owners.at(owner)->ownsArena(bins.at(i)->arena()))
+                prefix = ownerIds.at(owner);
+        }
+        bins.at(i)->describe(graph, prefix);
+    }
+    graph.build();
+
+    quint64 now = Clock::monotonicUs();
+    if (graphTime_)
+        graph.measure(graphSamples_, now - graphTime_);
+    graphSamples_ = graph.samples();
+    graphTime_ = now;
+
+    return format == "dot" ? graph.toDot() : graph.toJson();
+}
+
+void SensorManager::printStatistics(QStringList& output) const
+{
+    for (QMap<QString, DeviceAdaptorInstanceEntry>::const_iterator it = deviceAdaptorInstanceMap_.constBegin(); it != deviceAdaptorInstanceMap_.constEnd(); ++it) {
+        const AdaptedSensorEntry* entry = it.value().adaptor_ ? it.value().adaptor_->getAdaptedSensor() : 0;
+        if (entry && entry->buffer()) {
+            output.append(QString("    %1/%2: %3\n").arg(it.key()).arg(entry->name()).arg(entry->buffer()->statistics()));
+        }
+        if (it.value().adaptor_ && it.value().adaptor_->readLatency().count()) {
+            output.append(QString("    %1 read latency: %2\n").arg(it.key()).arg(it.value().adaptor_->readLatency().toString()));
+        }
+    }
+
+    for (QMap<QString, ChainInstanceEntry>::const_iterator it = chainInstanceMap_.constBegin(); it != chainInstanceMap_.constEnd(); ++it) {
+        if (!it.value().chain_)
+            continue;
+        const QMap<QString, RingBufferBase*>& buffers = it.value().chain_->buffers();
+        for (QMap<QString, RingBufferBase*>::const_iterator buffer = buffers.constBegin(); buffer != buffers.constEnd(); ++buffer) {
+            output.append(QString("    %1/%2: %3\n").arg(it.key()).arg(buffer.key()).arg(buffer.value()->statistics()));
+        }
+    }
+
+    for (QMap<QString, SensorInstanceEntry>::const_iterator it = sensorInstanceMap_.constBegin(); it != sensorInstanceMap_.constEnd(); ++it) {
+        if (!it.value().sensor_)
+            continue;
+        const QMap<QString, RingBufferBase*>& buffers = it.value().sensor_->internalBuffers();
+        for (QMap<QString, RingBufferBase*>::const_iterator buffer = buffers.constBegin(); buffer != buffers.constEnd(); ++buffer) {
+            output.append(QString("    %1/%2: %3\n").arg(it.key()).arg(buffer.key()).arg(buffer.value()->statistics()));
+        }
+    }
+
+    if (AllocCounter::isEnabled()) {
+        unsigned drained = Atomic::load(drainedSamples_);
+        unsigned allocations = Atomic::load(drainAllocations_);
+        output.append(QString("    sample queue: %1 drained; %2 allocation(s), %3 per sample\n")
+                      .arg(drained).arg(allocations).arg(drained ? (double)allocations / drained : 0.0, 0, 'f', 3));
+    }
+
+    for (QMap<QString, TraceRecorder*>::const_iterator it = recorders_.constBegin(); it != recorders_.constEnd(); ++it) {
+        output.append(QString("    %1 recording into %2: %3 recorded, %4 dropped, %5 rotation(s)\n")
+                      .arg(it.key()).arg(it.value()->path()).arg(it.value()->recorded())
+                      .arg(it.value()->dropped()).arg(it.value()->rotations()));
+    }
+}
+
+/**
+ * Bytes of object storage of given buffers.
+ *
+ * @param buffers buffers keyed by name.
+ * @return storage size in bytes.
+ */
+static qint64 bufferMemoryUsage(const QMap<QString, RingBufferBase*>& buffers)
+{
+    qint64 bytes = 0;
+    for (QMap<QString, RingBufferBase*>::const_iterator it = buffers.constBegin(); it != buffers.constEnd(); ++it)
+        bytes += it.value()->memoryUsage();
+    return bytes;
+}
+
+void SensorManager::printMemoryUsage(QStringList& output) const
+{
+    qint64 total = 0;
+
+    for (QMap<QString, DeviceAdaptorInstanceEntry>::const_iterator it = deviceAdaptorInstanceMap_.constBegin(); it != deviceAdaptorInstanceMap_.constEnd(); ++it) {
+        const AdaptedSensorEntry* entry = it.value().adaptor_ ? it.value().adaptor_->getAdaptedSensor() : 0;
+        if (entry && entry->buffer()) {
+            qint64 ring = entry->buffer()->memoryUsage();
+            output.append(QString("    %1: ring %2 bytes\n").arg(it.key()).arg(ring));
+            total += ring;
+        }
+    }
+
+    for (QMap<QString, ChainInstanceEntry>::const_iterator it = chainInstanceMap_.constBegin(); it != chainInstanceMap_.constEnd(); ++it) {
+        const AbstractChain* chain = it.value().chain_;
+        if (!chain)
+            continue;
+        qint64 buffers = bufferMemoryUsage(chain->buffers());
+        qint64 arena = chain->arenaUsage();
+        output.append(QString("    %1: buffers %2 bytes, arena %3 bytes\n").arg(it.key()).arg(buffers).arg(arena));
+        total += qMax(buffers, arena);
+    }
+
+    for (QMap<QString, SensorInstanceEntry>::const_iterator it = sensorInstanceMap_.constBegin(); it != sensorInstanceMap_.constEnd(); ++it) {
+        const AbstractSensorChannel* sensor = it.value().sensor_;
+        if (!sensor)
+            continue;
+        qint64 buffers = bufferMemoryUsage(sensor->internalBuffers());
+        qint64 arena = sensor->arenaUsage();
+        qint64 downsample = sensor->downsampleMemoryUsage();
+        output.append(QString("    %1: buffers %2 bytes, arena %3 bytes, downsampling %4 bytes, %5 session(s)\n")
+                      .arg(it.key()).arg(buffers).arg(arena).arg(downsample).arg(it.value().sessions_.size()));
+        total += qMax(buffers, arena) + downsample;
+
+        foreach (int sessionId, it.value().sessions_) {
+            qint64 buffer = socketHandler_->bufferMemoryUsage(sessionId);
+            qint64 backlog = socketHandler_->backlog(sessionId);
+            output.append(QString("      session %1: buffers %2 bytes, backlog %3 bytes\n").arg(sessionId).arg(buffer).arg(backlog));
+            total += buffer + backlog;
+        }
+    }
+
+    output.append(QString("    total: %1 bytes\n").arg(total));
+    if (reclaimCount_) {
+        output.append(QString("    last reclaim: resident %1 -> %2 bytes, %3 pooled bytes freed, %4 pass(es)\n")
+                      .arg(reclaimBefore_).arg(reclaimAfter_).arg(reclaimPooled_).arg(reclaimCount_));
+    }
+}
+
+void SensorManager::printSessionCosts(QStringList& output) const
+{
+    for (QMap<QString, SensorInstanceEntry>::const_iterator it = sensorInstanceMap_.constBegin(); it != sensorInstanceMap_.constEnd(); ++it) {
+        foreach (int sessionId, it.value().sessions_) {
+            SessionCost cost = socketHandler_->sessionCost(sessionId);
+            output.append(QString("    %1 session %2, PID %3: %4 sample(s), %5 bytes, %6 write(s), %7 ms CPU\n")
+                          .arg(it.key()).arg(sessionId).arg(socketToPid(sessionId))
+                          .arg(cost.samples).arg(cost.bytes).arg(cost.writes)
+                          .arg(cost.cpuTime / 1000000.0, 0, 'f', 3));
+        }
+    }
+}
+
+RingBufferBase* SensorManager::findBuffer(const QString& name) const
+{
+    int separator = name.indexOf('/');
+    if (separator <= 0)
+        return NULL;
+    QString id = name.left(separator);
+    QString buffer = name.mid(separator + 1);
+
+    QMap<QString, DeviceAdaptorInstanceEntry>::const_iterator adaptor = deviceAdaptorInstanceMap_.constFind(id);
+    if (adaptor != deviceAdaptorInstanceMap_.constEnd())
+        return adaptor.value().adaptor_ ? adaptor.value().adaptor_->findBuffer(buffer) : NULL;
+
+    QMap<QString, ChainInstanceEntry>::const_iterator chain = chainInstanceMap_.constFind(id);
+    if (chain != chainInstanceMap_.constEnd())
+        return chain.value().chain_ ? chain.value().chain_->buffers().value(buffer) : NULL;
+
+    QMap<QString, SensorInstanceEntry>::const_iterator sensor = sensorInstanceMap_.constFind(id);
+    if (sensor != sensorInstanceMap_.constEnd())
+        return sensor.value().sensor_ ? sensor.value().sensor_->internalBuffers().value(buffer) : NULL;
+
+    return NULL;
+}
+
+bool SensorManager::startRecording(const QString& buffer, const QString& path)
+{
+    clearError();
+
+    if (recorders_.contains(buffer)) {
+        setError(SmAlreadyUnderControl, QString(tr("buffer '%1' is already being recorded")).arg(buffer));
+        return false;
+    }
+    RingBufferBase* rb = findBuffer(buffer);
+    if (!rb) {
+        setError(SmNotInstantiated, QString(tr("buffer '%1' not instantiated, cannot record")).arg(buffer));
+        return false;
+    }
+
+    TraceRecorder* recorder = new TraceRecorder(path,
+                                                Config::configuration()->value<unsigned int>("global/trace_records", 65536),
+                                                Config::configuration()->value<unsigned int>("global/trace_files", 2));
+    if (!recorder->start(rb)) {
+        delete recorder;
+        setError(SmCanNotRegisterObject, QString(tr("cannot record buffer '%1' into '%2'")).arg(buffer).arg(path));
+        return false;
+    }
+    recorders_.insert(buffer, recorder);
+    return true;
+}
+
+bool SensorManager::stopRecording(const QString& buffer)
+{
+    clearError();
+
+    TraceRecorder* recorder = recorders_.take(buffer);
+    if (!recorder) {
+        setError(SmNotInstantiated, QString(tr("buffer '%1' is not being recorded")).arg(buffer));
+        return false;
+    }
+    delete recorder;
+    return true;
+}
+
+/**
+ * Resident size of the process.
+ *
+ * @return resident bytes, 0 if unknown.
+ */
+static qint64 residentBytes()
+{
+    long pages = 0;
+    long resident = 0;
+    FILE* statm = fopen("/proc/self/statm", "r");
+    if (!statm)
+        return 0;
+    if (fscanf(statm, "%ld %ld", &pages, &resident) != 2)
+        resident = 0;
+    fclose(statm);
+    return (qint64)resident * sysconf(_SC_PAGESIZE);
+}
+
+void SensorManager::scheduleReclaim()
+{
+    // Low latency mode keeps its prefaulted memory
+    if (LowLatency::isEnabled())
+        return;
+    int timeout = 60;
+    if (Config::configuration())
+        timeout = Config::configuration()->value<int>("global/reclaim_idle_timeout", timeout);
+    if (timeout > 0)
+        reclaimTimer_->start(timeout * 1000);
+}
+
+void SensorManager::reclaimMemory()
+{
+    reclaimBefore_ = residentBytes();
+    reclaimPooled_ = socketHandler_->compactBuffers();
+    {
+        // Batches of released sessions are dropped, idle ones give back
+        // their reserved capacity
+        QMutexLocker locker(&sampleBatchMutex_);
+        QHash<int, SampleBatch>::iterator it = sampleBatches_.begin();
+        while (it != sampleBatches_.end()) {
+            if (it.value().count) {
+                ++it;
+            } else if (!sessionSensors_.contains(it.key())) {
+                it = sampleBatches_.erase(it);
+            } else {
+                it.value().data.squeeze();
+                ++it;
+            }
+        }
+        sampleBatches_.squeeze();
+    }
+    malloc_trim(0);
+    reclaimAfter_ = residentBytes();
+    ++reclaimCount_;
+    sensordLogD() << "Reclaimed memory, resident " << reclaimBefore_ << " -> " << reclaimAfter_
+                  << " bytes, " << reclaimPooled_ << " pooled bytes freed";
+}
+
+void SensorManager::releaseIdleAdaptors()
+{
+    qint64 next = -1;
+    for (QMap<QString, DeviceAdaptorInstanceEntry>::iterator it = deviceAdaptorInstanceMap_.begin(); it != deviceAdaptorInstanceMap_.end(); ++it)
+    {
+        DeviceAdaptorInstanceEntry& entry = it.value();
+        if (!entry.adaptor_ || entry.cnt_ > 0)
+            continue;
+
+        qint64 remaining = idleTimeout_ - entry.idle_.elapsed();
+        if (remaining > 0) {
+            if (next < 0 || remaining < next)
+                next = remaining;
+            continue;
+        }
+
+        sensordLogD() << "Deleting adaptor '" << it.key() << "' idle for " << entry.idle_.elapsed() << " ms.";
+        stopRecordings(it.key());
+        delete entry.adaptor_;
+        entry.adaptor_ = 0;
+    }
+
+    if (next >= 0)
+        idleTimer_->start(next);
+}
+
+void SensorManager::deviceAttached(const DiscoveredDevice& device)
+{
+    for (QMap<QString, DeviceAdaptorInstanceEntry>::iterator it = deviceAdaptorInstanceMap_.begin(); it != deviceAdaptorInstanceMap_.end(); ++it)
+    {
+        DeviceAdaptorInstanceEntry& entry = it.value();
+        if (!entry.adaptor_ || entry.cnt_ > 0 || entry.adaptor_->isValid())
+            continue;
+
+        sensordLogD() << "Deleting adaptor '" << it.key() << "' without device, " << device.node << " attached.";
+        stopRecordings(it.key());
+        delete entry.adaptor_;
+        entry.adaptor_ = 0;
+    }
+}
+
+/** Capability cache file tag, "SCAP" */
+static const quint32 CAPABILITY_CACHE_MAGIC = 0x53434150;
+
+static QString formatRanges(const QList<DataRange>& ranges)
+{
+    QStringList list;
+    foreach (const DataRange& range, ranges)
+        list.append(QString("%1..%2/%3").arg(range.min).arg(range.max).arg(range.resolution));
+    return list.join(",");
+}
+
+static QString formatRanges(const IntegerRangeList& ranges)
+{
+    QStringList list;
+    foreach (const IntegerRange& range, ranges)
+        list.append(QString("%1..%2").arg(range.first).arg(range.second));
+    return list.join(",");
+}
+
+QVariantMap SensorManager::sensorStatus() const
+{
+    QVariantMap status;
+    for (QMap<QString, SensorInstanceEntry>::const_iterator it = sensorInstanceMap_.constBegin();
+         it != sensorInstanceMap_.constEnd(); ++it) {
+        AbstractSensorChannelAdaptor* adaptor = it.value().sensor_ ?
+            it.value().sensor_->findChild<AbstractSensorChannelAdaptor*>(QString(), Qt::FindDirectChildrenOnly) : 0;
+        if (!adaptor)
+            continue;
+        QVariantMap sensor(adaptor->status(-1));
+        QVariantMap sessions;
+        foreach (int sessionId, it.value().sessions_) {
+            QVariantMap session(adaptor->status(sessionId));
+            QVariantMap own;
+            for (QVariantMap::const_iterator property = session.constBegin(); property != session.constEnd(); ++property)
+                if (property.key().startsWith("session"))
+                    own.insert(property.key(), property.value());
+            sessions.insert(QString::number(sessionId), own);
+        }
+        sensor.insert("sessions", sessions);
+        status.insert(it.key(), sensor);
+    }
+    return status;
+}
+
+QStringList SensorManager::capabilities()
+{
+    if (!capabilitiesLoaded_) {
+        capabilitiesLoaded_ = true;
+        QFile file(Config::configuration()->value<QString>("global/capability_cache", "/var/lib/sensord/capabilities"));
+        if (file.open(QIODevice::ReadOnly)) {
+            QDataStream stream(&file);
+            stream.setVersion(QDataStream::Qt_5_0);
+            quint32 magic = 0;
+            QMap<QString, QString> cached;
+            stream >> magic >> cached;
+            if (magic == CAPABILITY_CACHE_MAGIC && stream.status() == QDataStream::Ok) {
+                // Sensors instantiated before the cache was read are newer
+                for (QMap<QString, QString>::const_iterator it = cached.constBegin(); it != cached.constEnd(); ++it) {
+                    if (!capabilities_.contains(it.key()))
+                        capabilities_.insert(it.key(), it.value());
+                }
+            } else {
+                sensordLogW() << "Ignoring invalid capability cache " << file.fileName();
+            }
+        }
+    }
+    return capabilities_.values();
+}
+
+void SensorManager::recordCapabilities(const QString& id, AbstractSensorChannel* sensor)
+{
+    bool hwBuffering = false;
+    IntegerRangeList bufferSizes = sensor->getAvailableBufferSizes(hwBuffering);
+    QString line = QString("%1: %2; ranges %3; intervals %4; buffer sizes %5 (%6)")
+                   .arg(id).arg(sensor->description())
+                   .arg(formatRanges(sensor->getAvailableDataRanges()))
+                   .arg(formatRanges(sensor->getAvailableIntervals()))
+                   .arg(formatRanges(bufferSizes)).arg(hwBuffering ? "hw" : "sw");
+
+    capabilities();
+    if (capabilities_.value(id) == line)
+        return;
+    capabilities_.insert(id, line);
+
+    QSaveFile file(Config::configuration()->value<QString>("global/capability_cache", "/var/lib/sensord/capabilities"));
+    if (!file.open(QIODevice::WriteOnly)) {
+        sensordLogD() << "Can not write capability cache " << file.fileName();
+        return;
+    }
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << CAPABILITY_CACHE_MAGIC << capabilities_;
+    if (!file.commit())
+        sensordLogW() << "Failed to write capability cache " << file.fileName();
+}
+
+void SensorManager::stopRecordings(const QString& id)
+{
+    QString prefix = id + "/";
+    for (QMap<QString, TraceRecorder*>::iterator it = recorders_.begin(); it != recorders_.end();) {
+        if (it.key().startsWith(prefix)) {
+            delete it.value();
+            it = recorders_.erase(it);
+        } else {
+            ++it;
+        }
+    }
 }
 
 QString SensorManager::socketToPid(int id) const
@@ -814,20 +2083,31 @@ void SensorManager::print() const
 
 double SensorManager::magneticDeviation()
 {
-    if (deviation == 0) {
-        QSettings confFile("/etc/xdg/sensorfw/location.conf", QSettings::IniFormat);
-        confFile.beginGroup("location");
-        deviation = confFile.value("declination",0).toDouble();
-    }
     return deviation;
 }
 
 void SensorManager::setMagneticDeviation(double level)
 {
     if (level != deviation) {
-        QSettings confFile("/etc/xdg/sensorfw/location.conf", QSettings::IniFormat);
+        QSettings confFile(LOCATION_CONF, QSettings::IniFormat);
         confFile.beginGroup("location");
         confFile.setValue("declination",level);
         deviation = level;
+        emit magneticDeviationChanged(deviation);
+    }
+}
+
+void SensorManager::loadMagneticDeviation()
+{
+    if (QFile::exists(LOCATION_CONF) && !locationWatcher_->files().contains(LOCATION_CONF))
+        locationWatcher_->addPath(LOCATION_CONF);
+
+    QSettings confFile(LOCATION_CONF, QSettings::IniFormat);
+    confFile.beginGroup("location");
+    double level = confFile.value("declination",0).toDouble();
+    if (level != deviation) {
+        sensordLogD() << "Magnetic declination changed to" << level;
+        deviation = level;
+        emit magneticDeviationChanged(deviation);
     }
 }
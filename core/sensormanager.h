@@ -38,6 +38,15 @@
 #include "idutils.h"
 #include "parameterparser.h"
 #include "logging.h"
+#include "sessionstore.h"
+#include "devicediscovery.h"
+#include <QMutex>
+#include <QAtomicInt>
+#include <QHash>
+#include <QSet>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QVariantMap>
 
 #ifdef SENSORFW_MCE_WATCHER
 #include "mcewatcher.h"
@@ -47,6 +56,13 @@ class MceWatcher;
 
 class QSocketNotifier;
 class SocketHandler;
+class QTimer;
+class SampleQueue;
+class TraceRecorder;
+class QThread;
+class QFileSystemWatcher;
+class OverloadController;
+class ClockTimer;
 
 /**
  * Sensor instance entry. Contains list of connected sessions.
@@ -117,6 +133,7 @@ public:
     DeviceAdaptor*          adaptor_;     /**< Adaptor pointer */
     int                     cnt_;         /**< Reference count */
     QString                 type_;        /**< Type */
+    QElapsedTimer           idle_;        /**< Time since reference count dropped to zero */
 };
 
 /**
@@ -132,6 +149,18 @@ class SensorManager : public QObject
     Q_PROPERTY(QString errorString READ errorString)
 
 public:
+    /**
+     * Delivery class of sensor output. Each class has its own sample
+     * queues, high priority queues are drained and written to sockets
+     * before normal ones so fast channels do not wait behind slow ones.
+     */
+    enum SamplePriority
+    {
+        HighPriority = 0, /**< latency-critical channels */
+        NormalPriority,   /**< everything else */
+        SamplePriorities  /**< number of classes */
+    };
+
     /**
      * Append current status into given StringList.
      *
@@ -139,6 +168,110 @@ public:
      */
     void printStatus(QStringList& output) const;
 
+    /**
+     * Ask for configuration to be reloaded from the event loop, see
+     * reloadConfig(). Only writes to a pipe, so it is safe to call from
+     * a signal handler.
+     */
+    static void requestReload();
+
+    /**
+     * Append data path statistics of adaptor and chain output buffers
+     * and sensor channel internal buffers into given StringList.
+     *
+     * @param output StringList to append statistics.
+     */
+    void printStatistics(QStringList& output) const;
+
+    /**
+     * Append memory held by adaptor rings, chain and sensor node graphs,
+     * downsampling windows and sessions into given StringList. Node
+     * graphs count their arena, which holds the storage of the buffers
+     * built in it, or their buffers if they have no arena in use.
+     *
+     * @param output StringList to append memory usage.
+     */
+    void printMemoryUsage(QStringList& output) const;
+
+    /**
+     * Append delivery cost of sessions into given StringList: samples,
+     * bytes and write syscalls written for each session, and CPU time
+     * spent buffering, downsampling and writing them, with the PID of
+     * the client.
+     *
+     * @param output StringList to append session costs.
+     */
+    void printSessionCosts(QStringList& output) const;
+
+    /**
+     * Dataflow graph of instantiated adaptors, chains and sensors: every
+     * Source to Sink join and ring buffer reader with its samples/sec,
+     * average batch size and ring occupancy, see DataflowGraph. Rates
+     * are measured since the previous graph or status dump; the first
+     * graph gives sample counts only.
+     *
+     * @param format "dot" for Graphviz or "json".
+     * @return graph, empty if format is unknown.
+     */
+    QString dataflowGraph(const QString& format) const;
+
+    /**
+     * Capabilities of sensors instantiated on this device: description,
+     * data ranges, intervals and buffer sizes. Sensors are recorded when
+     * first instantiated and the index is kept in global/capability_cache
+     * across restarts, so it is answered without loading plugins.
+     *
+     * @return one line per sensor id.
+     */
+    QStringList capabilities();
+
+    /**
+     * Status of every instantiated sensor, see
+     * AbstractSensorChannelAdaptor::status(). Entry "sessions" of a sensor
+     * maps IDs of its sessions to their session properties.
+     *
+     * @return status by sensor ID.
+     */
+    QVariantMap sensorStatus() const;
+
+    /**
+     * Start recording objects written into a buffer into a trace file,
+     * see TraceRecorder. Records per file and number of rotated files
+     * are configured with global/trace_records and global/trace_files.
+     *
+     * @param buffer buffer name as in #printStatistics(), e.g.
+     *               accelerometeradaptor/accelerometer.
+     * @param path trace file path.
+     * @return was recording started.
+     */
+    bool startRecording(const QString& buffer, const QString& path);
+
+    /**
+     * Stop recording a buffer.
+     *
+     * @param buffer buffer name.
+     * @return was the buffer being recorded.
+     */
+    bool stopRecording(const QString& buffer);
+
+    /**
+     * Set priority of a session for load shedding, see
+     * OverloadController. Priority set by the client replaces the one
+     * from global/overload_priorities.
+     *
+     * @param sessionId Session ID.
+     * @param priority priority, higher is more important.
+     * @return is the session known to the overload controller.
+     */
+    bool setSessionPriority(int sessionId, int priority);
+
+    /**
+     * Fill level of the fullest sample queue.
+     *
+     * @return queued samples in percent of the queue size.
+     */
+    unsigned int sampleQueueLoad() const;
+
     /**
      * Get last occured error code.
      *
@@ -193,9 +326,12 @@ public:
     void registerChain(const QString& chainName);
 
     /**
-     * Request chain.
+     * Request chain. A chain is instantiated once and shared by reference
+     * count between all requesters, so a filter graph which several
+     * sensors need should be kept in a chain of its own.
      *
      * @param id chain ID.
+     * @return shared chain instance or NULL.
      */
     AbstractChain* requestChain(const QString& id);
 
@@ -261,8 +397,34 @@ public:
      * @param id Session ID.
      * @param source Source from where to write.
      * @param size How many bytes to write.
+     * @param priority delivery class.
+     */
+    bool write(int id, const void* source, int size, SamplePriority priority = NormalPriority);
+
+    /**
+     * Write sensor data for multiple sessions. Sample is queued once per
+     * up to SampleQueue::MAX_FANOUT sessions instead of once per session.
+     *
+     * @param ids Session IDs.
+     * @param count Number of sessions.
+     * @param source Source from where to write.
+     * @param size How many bytes to write.
+     * @param priority delivery class.
+     */
+    bool write(const int* ids, int count, const void* source, int size, SamplePriority priority = NormalPriority);
+
+    /**
+     * Write consecutive samples for multiple sessions. Session writers
+     * are woken up once for the whole batch.
+     *
+     * @param ids Session IDs.
+     * @param count Number of sessions.
+     * @param samples Samples to write.
+     * @param size Size of one sample in bytes.
+     * @param n Number of samples.
+     * @param priority delivery class.
      */
-    bool write(int id, const void* source, int size);
+    bool writeSamples(const int* ids, int count, const void* samples, int size, unsigned int n, SamplePriority priority = NormalPriority);
 
     /**
      * Load plugin.
@@ -272,6 +434,15 @@ public:
      */
     bool loadPlugin(const QString& name);
 
+    /**
+     * Load plugins once the event loop runs. Plugins are loaded in given
+     * order in the main thread, after the D-Bus service has been
+     * registered if that is done before returning to the event loop.
+     *
+     * @param names plugin names.
+     */
+    void loadPluginsLater(const QStringList& names);
+
     /**
      * Request sensor.
      *
@@ -288,6 +459,43 @@ public:
      */
     bool releaseSensor(const QString& id, int sessionId);
 
+    /**
+     * Resume token of a session. Client hands the token to
+     * resumeSession() to get the session back after sensord restarts.
+     *
+     * @param sessionId Session ID.
+     * @return resume token, 0 if the session is not resumable.
+     */
+    quint64 sessionToken(int sessionId);
+
+    /**
+     * Sensor of a session.
+     *
+     * @param sessionId Session ID.
+     * @return sensor ID, empty if the session is not known.
+     */
+    QString sessionSensorId(int sessionId) const;
+
+    /**
+     * Recreate a session of a previous sensord instance from its
+     * recorded state. Session keeps its ID, so the client reconnects its
+     * data socket before resuming. The recorded configuration is applied
+     * and the session restarted for all resumptions queued so far in a
+     * single pass once the event loop runs.
+     *
+     * @param token resume token.
+     * @return session ID, or INVALID_SESSION if the token is unknown.
+     */
+    int resumeSession(quint64 token);
+
+    /**
+     * Resumable state of a session.
+     *
+     * @param sessionId Session ID.
+     * @return record or NULL if the session is not resumable.
+     */
+    SessionRecord* sessionRecord(int sessionId);
+
     /**
      * Get sensor instance.
      *
@@ -322,17 +530,73 @@ public:
     MceWatcher* MCEWatcher() const;
 #endif
 
+    /**
+     * Magnetic declination from /etc/xdg/sensorfw/location.conf. The
+     * value is cached and reloaded when the file changes.
+     *
+     * @return declination in degrees.
+     */
     double magneticDeviation();
+
+    /**
+     * Set and persist magnetic declination, e.g. by a location service
+     * computing it from a location fix.
+     *
+     * @param level declination in degrees.
+     */
     void setMagneticDeviation(double level);
 
 private Q_SLOTS:
     /**
-     * Callback for lost session connections.
+     * Reload magnetic declination from location configuration and emit
+     * #magneticDeviationChanged() if it changed.
+     */
+    void loadMagneticDeviation();
+
+    /**
+     * Callback for lost session connections. Sessions are released
+     * together by releaseLostClients() once the event loop runs, so
+     * that a connection carrying several sessions is torn down in one
+     * pass.
      *
      * @param sessionId Session ID.
      */
     void lostClient(int sessionId);
 
+    /**
+     * Stop and release sessions queued by lostClient().
+     */
+    void releaseLostClients();
+
+    /**
+     * Configure and restart sessions queued by resumeSession().
+     */
+    void processResumes();
+
+    /**
+     * Forget sessions of previous sensord instances which were not
+     * resumed within global/session_resume_timeout.
+     */
+    void releaseStaleSessions();
+
+    /**
+     * Reload configuration files and re-apply changed keys to the
+     * instantiated adaptors, chains and sensors. Sessions are left
+     * running. Keys read only when a node is created, such as device
+     * paths and plugin lists, take effect when the node is created
+     * again.
+     *
+     * @return were the files loaded.
+     */
+    bool reloadConfig();
+
+    /**
+     * Callback for the reload pipe, see requestReload().
+     *
+     * @param fd pipe read end.
+     */
+    void reloadRequested(int fd);
+
     /**
      * Callback for MCE display state change event.
      *
@@ -341,18 +605,89 @@ private Q_SLOTS:
     void displayStateChanged(bool displayState);
 
     /**
-     * Callback for MCE powersave mode change event.
+     * Callback for MCE powersave mode change event. While powersave is
+     * enabled, output of sensors not listed in global/wakeup_sensors is
+     * held in session buffers and delivered with the next output of a
+     * wakeup sensor, see SocketHandler::setPowerSave().
      *
      * @param deviceMode device PSM state.
      */
     void devicePSMStateChanged(bool deviceMode);
 
     /**
-     * Callback for arrived sensor data in internal pipe which SensorManager
-     * needs to propagate to the SocketHandler.
+     * Callback for arrived sensor data in internal sample queues which
+     * SensorManager needs to propagate to the SocketHandler. At most
+     * global/sample_batch_limit samples of each delivery class are
+     * drained per invocation, high priority samples are drained and
+     * written first. Drained samples are grouped per session so that
+     * each session gets single write per batch. Runs in the writer
+     * thread if one is used.
      */
     void sensorDataHandler(int);
 
+    /**
+     * Delete adaptors which have had no references for
+     * global/adaptor_idle_timeout milliseconds. Deleting an adaptor closes
+     * its device files and stops its reader thread. Adaptor is created
+     * again when it is next requested.
+     */
+    void releaseIdleAdaptors();
+
+    /**
+     * Delete unreferenced adaptors which found no device, so that they
+     * probe again when next requested and bind to the attached device.
+     *
+     * @param device attached device.
+     */
+    void deviceAttached(const DiscoveredDevice& device);
+
+    /**
+     * Return memory left over from closed sessions and destroyed node
+     * graphs after global/reclaim_idle_timeout seconds without session
+     * changes: pooled session buffers are freed and free heap, including
+     * the arenas of destroyed chains and sensors, is returned to the
+     * system with malloc_trim(). Resident size before and after the pass
+     * is reported by printMemoryUsage().
+     */
+    void reclaimMemory();
+
+    /**
+     * Load plugins queued with loadPluginsLater().
+     */
+    void loadQueuedPlugins();
+
+    /**
+     * Rate governor callback for sessions whose client does not keep up
+     * with the data. Interval of a congested session is doubled on its
+     * behalf, up to global/rate_governor_max_interval, and the requested
+     * interval is restored when the client catches up. Governing a
+     * session ends if the client sets an interval itself.
+     *
+     * @param sessionId Session ID.
+     * @param congested is the client falling behind.
+     */
+    void governSession(int sessionId, bool congested);
+
+    /**
+     * Sample load for the overload controller. Called every
+     * global/overload_period ms; lateness of the call is the main loop
+     * lag.
+     */
+    void checkOverload();
+
+    /**
+     * Apply degradation level chosen by the overload controller. Level 1
+     * and above coalesce unread data of the session, each level above 1
+     * doubles the requested interval, up to
+     * global/overload_max_interval. Degrading the interval ends if the
+     * client sets an interval itself. Combined with the rate governor
+     * the slower of the two intervals applies.
+     *
+     * @param sessionId Session ID.
+     * @param level degradation level.
+     */
+    void applyOverloadLevel(int sessionId, int level);
+
 Q_SIGNALS:
     /**
      * Signal for occured errors.
@@ -376,6 +711,13 @@ Q_SIGNALS:
      */
     void displayOn();
 
+    /**
+     * Signal that magnetic declination changed.
+     *
+     * @param deviation declination in degrees.
+     */
+    void magneticDeviationChanged(double deviation);
+
 private:
     /**
      * Constructor.
@@ -387,6 +729,47 @@ private:
      */
     virtual ~SensorManager();
 
+    /**
+     * Load plugin providing given id if plugins are loaded on demand and
+     * the id has not been registered yet.
+     *
+     * @param id sensor, chain, adaptor or filter id.
+     * @param registered is the id already registered.
+     */
+    void loadPluginOnDemand(const QString& id, bool registered);
+
+    /**
+     * Stop and release session of a lost client.
+     *
+     * @param sessionId Session ID.
+     */
+    void releaseLostClient(int sessionId);
+
+    /**
+     * Create session for a registered sensor, instantiating the sensor
+     * if needed.
+     *
+     * @param id clean sensor ID.
+     * @param sessionId ID for the new session.
+     * @return session ID, or INVALID_SESSION on failure.
+     */
+    int openSession(const QString& id, int sessionId);
+
+    /**
+     * Map session state file named by global/session_state_file.
+     * Session IDs issued by previous instances are not reused.
+     */
+    void openSessionStore();
+
+    /**
+     * Record capabilities of an instantiated sensor, see #capabilities().
+     * Cache is rewritten if they changed.
+     *
+     * @param id sensor ID.
+     * @param sensor sensor channel.
+     */
+    void recordCapabilities(const QString& id, AbstractSensorChannel* sensor);
+
     /**
      * Set error state.
      *
@@ -400,6 +783,12 @@ private:
      */
     void clearError();
 
+    /**
+     * Restart the reclaim timer after a session change, see
+     * #reclaimMemory().
+     */
+    void scheduleReclaim();
+
     /**
      * Add sensor with given ID.
      *
@@ -437,6 +826,120 @@ private:
      */
     QString socketToPid(const QSet<int>& ids) const;
 
+    /**
+     * Get sample queue of the calling thread for given delivery class.
+     * Queue is created on first use and recycled once the thread exits.
+     *
+     * @param priority delivery class.
+     * @return sample queue or NULL if it could not be created.
+     */
+    SampleQueue* threadSampleQueue(SamplePriority priority);
+
+    /**
+     * Drain queues of one delivery class into session batches and write
+     * the batches out. Called from #sensorDataHandler().
+     *
+     * @param priority delivery class.
+     * @return false if the batch limit was hit before the queues were
+     *         empty.
+     */
+    bool drainSampleQueues(SamplePriority priority);
+
+    /**
+     * Move SocketHandler and sample draining to a dedicated writer thread
+     * if enabled with global/writer_thread. D-Bus control stays in the
+     * main thread. Must be called before any sessions are opened.
+     */
+    void startWriterThread();
+
+    /**
+     * Start watching client consumption for governSession() if enabled
+     * with global/rate_governor_period.
+     */
+    void startRateGovernor();
+
+    /**
+     * Start the overload controller if enabled with
+     * global/overload_period.
+     */
+    void startOverloadController();
+
+    /**
+     * Priority of the client of a session from global/overload_priorities,
+     * a list of <process name>:<priority>.
+     *
+     * @param pid client PID.
+     * @return priority, 0 if the client is not listed.
+     */
+    static int policyPriority(qint64 pid);
+
+    /**
+     * Policies overriding the interval of a session on its behalf.
+     */
+    enum IntervalOverrider
+    {
+        RateGovernor = 0,  /**< governSession() */
+        OverloadShedding,  /**< applyOverloadLevel() */
+        IntervalOverriders
+    };
+
+    struct IntervalOverride;
+
+    /**
+     * Interval overrides of a session. Overrides are dropped when the
+     * client has set an interval itself since the last override.
+     *
+     * @param sessionId Session ID.
+     * @param sensor sensor channel of the session.
+     * @return overrides or NULL if none is active.
+     */
+    IntervalOverride* findIntervalOverride(int sessionId, AbstractSensorChannel* sensor);
+
+    /**
+     * Set or remove the interval override of one policy. The session
+     * runs at the slowest of its active overrides and the interval of
+     * the client, which is restored when no override is left.
+     *
+     * @param sessionId Session ID.
+     * @param sensor sensor channel of the session.
+     * @param overrider overriding policy.
+     * @param value interval in milliseconds, 0 removes the override.
+     */
+    void setIntervalOverride(int sessionId, AbstractSensorChannel* sensor, IntervalOverrider overrider, unsigned int value);
+
+    struct SampleBatch;
+
+    /**
+     * Log samples dropped by sample queues, at most once a second.
+     *
+     * @param queues queues to report.
+     */
+    void reportSampleDrops(const QList<SampleQueue*>& queues);
+
+    /**
+     * Write collected samples of a session to the SocketHandler and
+     * empty the batch.
+     *
+     * @param id Session ID.
+     * @param batch collected samples.
+     */
+    void flushSampleBatch(int id, SampleBatch& batch);
+
+    /**
+     * Find adaptor, chain or sensor channel buffer.
+     *
+     * @param name buffer name as in #printStatistics().
+     * @return buffer or NULL if not instantiated.
+     */
+    RingBufferBase* findBuffer(const QString& name) const;
+
+    /**
+     * Stop recording the buffers of a node before it is deleted.
+     *
+     * @param id node ID.
+     */
+    void stopRecordings(const QString& id);
+
     QMap<QString, SensorChannelFactoryMethod>      sensorFactoryMap_; /**< factories for sensor types */
     QMap<QString, SensorInstanceEntry>             sensorInstanceMap_; /**< sensor instances */
 
@@ -452,13 +955,80 @@ private:
     MceWatcher*                                    mceWatcher_; /**< MCE watcher */
     SensorManagerError                             errorCode_; /** global error code */
     QString                                        errorString_; /** global error description */
-    int                                            pipefds_[2]; /** pipe for sensor samples */
-    QSocketNotifier*                               pipeNotifier_; /** notifier for pipe stream */
+    int                                            eventFd_; /** eventfd signalled when a sample queue becomes non-empty */
+    QSocketNotifier*                               eventNotifier_; /** notifier for eventfd */
+    QSocketNotifier*                               reloadNotifier_; /** notifier for the reload pipe */
+    QList<SampleQueue*>                            sampleQueues_[SamplePriorities]; /** sample queues of producer threads per delivery class */
+    mutable QMutex                                 sampleQueueMutex_; /** mutex protecting sampleQueues_ */
+
+    /**
+     * Samples of single session collected during one drain pass.
+     */
+    struct SampleBatch
+    {
+        SampleBatch() : size(0), count(0) {}
+
+        int          size;  /**< size of single sample */
+        unsigned int count; /**< number of collected samples */
+        QByteArray   data;  /**< collected samples */
+    };
+
+    /**
+     * Interval of a session as requested by its client and the overrides
+     * applied on top.
+     */
+    struct IntervalOverride
+    {
+        IntervalOverride() : requested(0), applied(0)
+        {
+            for (int i = 0; i < IntervalOverriders; ++i)
+                values[i] = 0;
+        }
+
+        unsigned int requested;                  /**< interval requested by the client */
+        unsigned int applied;                    /**< interval stored at the sensor, as snapped */
+        unsigned int values[IntervalOverriders]; /**< interval of each policy, 0 if not overriding */
+    };
+
+    QHash<int, QString>                            sessionSensors_; /** sensor id of sessions */
+    QList<int>                                     lostSessions_; /** sessions waiting for releaseLostClients() */
+    QHash<int, SampleBatch>                        sampleBatches_; /** per session sample batches */
+    int                                            sampleBatchLimit_; /** max samples drained per wakeup */
+    QAtomicInt                                     drainedSamples_; /** samples drained from sample queues */
+    QElapsedTimer                                  dropReport_; /** time since sample drops were last logged */
+    QAtomicInt                                     drainAllocations_; /** heap allocations while draining */
+    QMutex                                         sampleBatchMutex_; /** mutex protecting sampleBatches_ */
+    QThread*                                       writerThread_; /** writer thread or NULL */
+    QMap<QString, TraceRecorder*>                  recorders_; /** trace recorders by buffer name */
+    QMap<QString, QString>                         capabilities_; /** capability line per sensor id */
+    bool                                           capabilitiesLoaded_; /** has capability cache been read */
+    QStringList                                    queuedPlugins_; /** plugins waiting for loadQueuedPlugins() */
+    QTimer*                                        idleTimer_; /** timer for releaseIdleAdaptors() */
+    int                                            idleTimeout_; /** adaptor idle timeout in ms, 0 keeps adaptors */
+    QTimer*                                        reclaimTimer_; /** timer for reclaimMemory() */
+    qint64                                         reclaimBefore_; /** resident bytes before the last reclaim pass */
+    qint64                                         reclaimAfter_; /** resident bytes after the last reclaim pass */
+    qint64                                         reclaimPooled_; /** pooled bytes freed by the last reclaim pass */
+    int                                            reclaimCount_; /** reclaim passes run */
+    QHash<int, IntervalOverride>                   intervalOverrides_; /** interval overrides of sessions */
+    unsigned int                                   governorMaxInterval_; /** slowest interval set by the rate governor */
+    OverloadController*                            overload_; /** overload controller or NULL */
+    ClockTimer*                                    overloadTimer_; /** timer for checkOverload() */
+    int                                            overloadPeriod_; /** overload check period in ms */
+    quint64                                        overloadDeadline_; /** expected time of the next check in microseconds */
+    unsigned int                                   overloadMaxInterval_; /** slowest interval set by the overload controller */
+    QSet<int>                                      overloadUnresolved_; /** sessions waiting for a PID based priority */
+    mutable QHash<QString, unsigned>               graphSamples_; /** edge samples of the previous dataflow graph */
+    mutable quint64                                graphTime_; /** time of the previous dataflow graph in microseconds */
+
+    SessionStore*                                  sessionStore_; /** state of resumable sessions or NULL */
+    QList<SessionRecord>                           pendingResumes_; /** sessions waiting for processResumes() */
 
     static SensorManager*                          instance_; /** singleton */
     static int                                     sessionIdCount_; /** session ID counter */
 
-    double deviation;
+    double                                         deviation; /** cached magnetic declination */
+    QFileSystemWatcher*                            locationWatcher_; /** watcher of location configuration */
 };
 
 template<class SENSOR_TYPE>
@@ -28,15 +28,22 @@
  */
 
 #include "sensormanager_a.h"
+#include "abstractsensor.h"
+#include "abstractsensor_a.h"
+#include "idutils.h"
 #include "logging.h"
+#include "latencytracer.h"
+#include "probes.h"
 
 /*
  * Implementation of adaptor class SensorManagerAdaptor
  */
 SensorManagerAdaptor::SensorManagerAdaptor(QObject *parent)
-    : QDBusAbstractAdaptor(parent)
+    : AdaptorBase(parent)
 {
+#ifndef SENSORFW_NO_DBUS
     setAutoRelaySignals(false); //disabling signals since no public client API supports the use of these
+#endif
 }
 
 int SensorManagerAdaptor::errorCodeInt() const
@@ -51,11 +58,13 @@ QString SensorManagerAdaptor::errorString() const
 
 bool SensorManagerAdaptor::loadPlugin(const QString& name)
 {
+    ControlProbe probe("loadPlugin", -1);
     return sensorManager()->loadPlugin(name);
 }
 
 int SensorManagerAdaptor::requestSensor(const QString &id, qint64 pid)
 {
+    ControlProbe probe("requestSensor", -1);
     int session = sensorManager()->requestSensor(id);
     sensordLog() << "Sensor '" << id << "' requested. Created session: " << session << ". Client PID: " << pid;
     return session;
@@ -63,10 +72,69 @@ int SensorManagerAdaptor::requestSensor(const QString &id, qint64 pid)
 
 bool SensorManagerAdaptor::releaseSensor(const QString &id, int sessionId, qint64 pid)
 {
+    ControlProbe probe("releaseSensor", sessionId);
     sensordLog() << "Sensor '" << id << "' release requested for session " << sessionId << ". Client PID: " << pid;
     return sensorManager()->releaseSensor(id, sessionId);
 }
 
+qulonglong SensorManagerAdaptor::sessionToken(int sessionId)
+{
+    return sensorManager()->sessionToken(sessionId);
+}
+
+int SensorManagerAdaptor::resumeSession(qulonglong token, qint64 pid)
+{
+    ControlProbe probe("resumeSession", -1);
+    int session = sensorManager()->resumeSession(token);
+    sensordLog() << "Session " << session << " resumed. Client PID: " << pid;
+    return session;
+}
+
+QList<int> SensorManagerAdaptor::openSessions(const QStringList& ids, qint64 pid)
+{
+    ControlProbe probe("openSessions", -1);
+    QList<int> sessions;
+    foreach (const QString& id, ids) {
+        int session = -1;
+        if (sensorManager()->loadPlugin(getCleanId(id)))
+            session = sensorManager()->requestSensor(id);
+        sensordLog() << "Sensor '" << id << "' requested. Created session: " << session << ". Client PID: " << pid;
+        sessions.append(session);
+    }
+    return sessions;
+}
+
+QList<bool> SensorManagerAdaptor::startSessions(const QList<int>& sessionIds, const QList<bool>& standbyOverrides,
+                                                const QList<int>& intervals, const QList<uint>& bufferIntervals,
+                                                const QList<uint>& bufferSizes, const QList<bool>& downsamplings)
+{
+    ControlProbe probe("startSessions", -1);
+    int count = sessionIds.size();
+    QList<bool> started;
+    if (standbyOverrides.size() != count || intervals.size() != count || bufferIntervals.size() != count ||
+        bufferSizes.size() != count || downsamplings.size() != count) {
+        sensordLogW() << "startSessions called with lists of different sizes";
+        for (int i = 0; i < count; ++i)
+            started.append(false);
+        return started;
+    }
+
+    for (int i = 0; i < count; ++i) {
+        const SensorInstanceEntry* entry = sensorManager()->getSensorInstance(sensorManager()->sessionSensorId(sessionIds.at(i)));
+        AbstractSensorChannelAdaptor* adaptor = (entry && entry->sensor_) ?
+            entry->sensor_->findChild<AbstractSensorChannelAdaptor*>(QString(), Qt::FindDirectChildrenOnly) : 0;
+        if (!adaptor) {
+            started.append(false);
+            continue;
+        }
+        if (!adaptor->configureAndStart(sessionIds.at(i), standbyOverrides.at(i), intervals.at(i),
+                                        bufferIntervals.at(i), bufferSizes.at(i), downsamplings.at(i)))
+            sensordLogW() << "Standby override not applied to session " << sessionIds.at(i);
+        started.append(true);
+    }
+    return started;
+}
+
 void SensorManagerAdaptor::setMagneticDeviation(double level)
 {
     sensorManager()->setMagneticDeviation(level);
@@ -77,6 +145,59 @@ double SensorManagerAdaptor::magneticDeviation()
     return sensorManager()->magneticDeviation();
 }
 
+QStringList SensorManagerAdaptor::statistics()
+{
+    QStringList output;
+    sensorManager()->printStatistics(output);
+    return output;
+}
+
+QStringList SensorManagerAdaptor::latency()
+{
+    QStringList output;
+    LatencyTracer::instance().statistics(output);
+    return output;
+}
+
+QStringList SensorManagerAdaptor::memoryUsage()
+{
+    QStringList output;
+    sensorManager()->printMemoryUsage(output);
+    return output;
+}
+
+QStringList SensorManagerAdaptor::sessionCosts()
+{
+    QStringList output;
+    sensorManager()->printSessionCosts(output);
+    return output;
+}
+
+QString SensorManagerAdaptor::dataflowGraph(const QString& format)
+{
+    return sensorManager()->dataflowGraph(format);
+}
+
+QStringList SensorManagerAdaptor::capabilities()
+{
+    return sensorManager()->capabilities();
+}
+
+QVariantMap SensorManagerAdaptor::sensorStatus()
+{
+    return sensorManager()->sensorStatus();
+}
+
+bool SensorManagerAdaptor::startRecording(const QString& buffer, const QString& path)
+{
+    return sensorManager()->startRecording(buffer, path);
+}
+
+bool SensorManagerAdaptor::stopRecording(const QString& buffer)
+{
+    return sensorManager()->stopRecording(buffer);
+}
+
 SensorManager* SensorManagerAdaptor::sensorManager() const
 {
     return dynamic_cast<SensorManager*>(parent());
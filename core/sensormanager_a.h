@@ -29,13 +29,13 @@
 #ifndef SENSORMANAGER_A_H
 #define SENSORMANAGER_A_H
 
-#include <QtDBus/QtDBus>
+#include "adaptorbase.h"
 #include "sensormanager.h"
 
 /**
  * Adaptor class for SensorManager DBus interface.
  */
-class SensorManagerAdaptor : public QDBusAbstractAdaptor
+class SensorManagerAdaptor : public AdaptorBase
 {
     Q_OBJECT
     Q_CLASSINFO("D-Bus Interface", "local.SensorManager")
@@ -106,9 +106,129 @@ public Q_SLOTS:
      */
     bool releaseSensor(const QString &id, int sessionId, qint64 pid);
 
+    /**
+     * Resume token of a session.
+     *
+     * @param sessionId Session ID.
+     * @return resume token, 0 if the session is not resumable.
+     */
+    qulonglong sessionToken(int sessionId);
+
+    /**
+     * Resume session of a previous sensord instance.
+     *
+     * @param token Resume token.
+     * @param pid Requestor PID.
+     * @return Session ID.
+     */
+    int resumeSession(qulonglong token, qint64 pid);
+
+    /**
+     * Load plugins of sensors and request a session for each, in one
+     * call instead of a loadPlugin() and requestSensor() pair per sensor.
+     *
+     * @param ids Sensor IDs.
+     * @param pid Requestor PID.
+     * @return Session ID for each sensor, -1 for sensors not granted.
+     */
+    QList<int> openSessions(const QStringList& ids, qint64 pid);
+
+    /**
+     * Start and configure sessions in one call, see
+     * AbstractSensorChannelAdaptor::configureAndStart(). Lists are
+     * indexed like \a sessionIds.
+     *
+     * @param sessionIds Session IDs.
+     * @param standbyOverrides standby override of each session.
+     * @param intervals interval of each session.
+     * @param bufferIntervals buffer interval of each session.
+     * @param bufferSizes buffer size of each session.
+     * @param downsamplings downsampling of each session.
+     * @return was each session started, false for unknown sessions.
+     */
+    QList<bool> startSessions(const QList<int>& sessionIds, const QList<bool>& standbyOverrides,
+                              const QList<int>& intervals, const QList<uint>& bufferIntervals,
+                              const QList<uint>& bufferSizes, const QList<bool>& downsamplings);
+
     double magneticDeviation();
     void setMagneticDeviation(double level);
 
+    /**
+     * Data path statistics: written, delivered and overwritten sample
+     * counts and processing time of adaptor, chain and sensor channel
+     * buffers.
+     *
+     * @return one line per buffer.
+     */
+    QStringList statistics();
+
+    /**
+     * End-to-end latency per sensor and data path stage, when enabled
+     * with global/latency_trace.
+     *
+     * @return one line per sensor and stage.
+     */
+    QStringList latency();
+
+    /**
+     * Memory held by adaptor rings, chain and sensor node graphs,
+     * downsampling windows, and buffers and write backlog of sessions.
+     *
+     * @return one line per adaptor, chain, sensor and session.
+     */
+    QStringList memoryUsage();
+
+    /**
+     * Delivery cost of sessions: samples, bytes and write syscalls
+     * written, and CPU time spent on delivery, with client PID.
+     *
+     * @return one line per session.
+     */
+    QStringList sessionCosts();
+
+    /**
+     * Dataflow graph with samples/sec, batch size and ring occupancy
+     * per edge, rates measured since the previous graph.
+     *
+     * @param format "dot" for Graphviz or "json".
+     * @return graph, empty if format is unknown.
+     */
+    QString dataflowGraph(const QString& format);
+
+    /**
+     * Capabilities of sensors seen on this device, without loading
+     * their plugins.
+     *
+     * @return one line per sensor.
+     */
+    QStringList capabilities();
+
+    /**
+     * Status of all sensors and their sessions in one reply, see
+     * SensorManager::sensorStatus().
+     *
+     * @return status by sensor ID.
+     */
+    QVariantMap sensorStatus();
+
+    /**
+     * Start recording a buffer into a trace file.
+     *
+     * @param buffer buffer name as in statistics, e.g.
+     *               accelerometeradaptor/accelerometer.
+     * @param path trace file path.
+     * @return was recording started.
+     */
+    bool startRecording(const QString& buffer, const QString& path);
+
+    /**
+     * Stop recording a buffer.
+     *
+     * @param buffer buffer name.
+     * @return was the buffer being recorded.
+     */
+    bool stopRecording(const QString& buffer);
+
 Q_SIGNALS:
     /**
      * Signal which is emitted for occured errors.
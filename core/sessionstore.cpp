@@ -0,0 +1,169 @@
+/**
+   @file sessionstore.cpp
+   @brief Persistent state of resumable sessions
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "sessionstore.h"
+#include "logging.h"
+#include <QFileInfo>
+#include <QDir>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+static const quint32 SESSION_STORE_MAGIC = 0x53455331; // "SES1"
+
+SessionStore::SessionStore() :
+    header_(0),
+    records_(0),
+    mapSize_(0)
+{
+}
+
+SessionStore::~SessionStore()
+{
+    if (header_)
+        munmap(header_, mapSize_);
+}
+
+bool SessionStore::open(const QString& path, int capacity)
+{
+    if (header_ || capacity <= 0)
+        return false;
+
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    int fd = ::open(path.toLocal8Bit().constData(), O_RDWR | O_CREAT | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    if (fd < 0) {
+        sensordLogW() << "Can not open session state file" << path << ":" << strerror(errno);
+        return false;
+    }
+
+    size_t size = sizeof(Header) + capacity * sizeof(SessionRecord);
+    struct stat st;
+    bool valid = fstat(fd, &st) == 0 && (size_t)st.st_size == size;
+    if (!valid && (ftruncate(fd, 0) < 0 || ftruncate(fd, size) < 0)) {
+        sensordLogW() << "Can not resize session state file" << path << ":" << strerror(errno);
+        close(fd);
+        return false;
+    }
+
+    void* map = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        sensordLogW() << "Can not map session state file" << path << ":" << strerror(errno);
+        return false;
+    }
+
+    header_ = (Header*)map;
+    records_ = (SessionRecord*)(header_ + 1);
+    mapSize_ = size;
+    if (!valid || header_->magic != SESSION_STORE_MAGIC || header_->capacity != capacity) {
+        memset(map, 0, size);
+        header_->magic = SESSION_STORE_MAGIC;
+        header_->capacity = capacity;
+    }
+
+    for (int i = 0; i < capacity; ++i) {
+        if (records_[i].token)
+            previous_.append(records_[i].sessionId);
+    }
+    sensordLogD() << "Session state file" << path << "holds" << previous_.size() << "resumable session(s)";
+    return true;
+}
+
+int SessionStore::lastSessionId() const
+{
+    return header_ ? header_->lastSessionId : 0;
+}
+
+SessionRecord* SessionStore::issue(int sessionId, const QString& id)
+{
+    if (!header_)
+        return 0;
+    QByteArray name = id.toLatin1();
+    if (name.size() >= (int)sizeof(records_->id)) {
+        sensordLogD() << "Sensor id" << id << "too long for a resumable session";
+        return 0;
+    }
+    for (int i = 0; i < header_->capacity; ++i) {
+        SessionRecord& record(records_[i]);
+        if (record.token)
+            continue;
+        memset(&record, 0, sizeof(record));
+        memcpy(record.id, name.constData(), name.size());
+        record.sessionId = sessionId;
+        record.bufferSize = 1;
+        record.downsampling = 1;
+        record.token = newToken();
+        header_->lastSessionId = qMax(header_->lastSessionId, sessionId);
+        return &record;
+    }
+    sensordLogW() << "Session state file is full, session" << sessionId << "is not resumable";
+    return 0;
+}
+
+SessionRecord* SessionStore::find(int sessionId)
+{
+    if (!header_)
+        return 0;
+    for (int i = 0; i < header_->capacity; ++i) {
+        if (records_[i].token && records_[i].sessionId == sessionId)
+            return &records_[i];
+    }
+    return 0;
+}
+
+SessionRecord* SessionStore::findToken(quint64 token)
+{
+    if (!header_ || !token)
+        return 0;
+    for (int i = 0; i < header_->capacity; ++i) {
+        if (records_[i].token == token)
+            return &records_[i];
+    }
+    return 0;
+}
+
+void SessionStore::release(int sessionId)
+{
+    if (SessionRecord* record = find(sessionId))
+        memset(record, 0, sizeof(*record));
+    previous_.removeAll(sessionId);
+}
+
+quint64 SessionStore::newToken()
+{
+    quint64 token = 0;
+    int fd = ::open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) {
+        if (read(fd, &token, sizeof(token)) != (ssize_t)sizeof(token))
+            token = 0;
+        close(fd);
+    }
+    if (!token) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        token = ((quint64)now.tv_sec << 32) ^ now.tv_nsec ^ ((quint64)getpid() << 48);
+    }
+    return token ? token : 1;
+}
@@ -0,0 +1,160 @@
+/**
+   @file sessionstore.h
+   @brief Persistent state of resumable sessions
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef SESSIONSTORE_H
+#define SESSIONSTORE_H
+
+#include <QString>
+#include <QList>
+
+/**
+ * Parameters of a session as set by its client. Records live in the
+ * mapped state file, so they are plain data of fixed layout.
+ */
+struct SessionRecord
+{
+    quint64 token;           /**< resume token, 0 for a free record */
+    qint32  sessionId;       /**< session ID */
+    qint32  interval;        /**< requested interval in milliseconds */
+    quint32 bufferInterval;  /**< buffer interval in milliseconds */
+    quint32 bufferSize;      /**< buffer size */
+    double  rangeMin;        /**< requested data range minimum */
+    double  rangeMax;        /**< requested data range maximum */
+    double  rangeResolution; /**< requested data range resolution */
+    quint8  hasRange;        /**< is a data range requested */
+    quint8  standbyOverride; /**< standby override */
+    quint8  downsampling;    /**< downsampling */
+    quint8  running;         /**< is session started */
+    char    id[48];          /**< sensor ID, NUL terminated */
+};
+
+/**
+ * Table of resumable sessions in a memory mapped file. Records are
+ * updated in place as clients configure their sessions, so the file
+ * describes every session even when sensord does not exit cleanly.
+ * After a restart clients hand their token back and the session is
+ * recreated from its record, see SensorManager::resumeSession().
+ *
+ * File should be on tmpfs, e.g. /run, so that tokens do not outlive a
+ * reboot.
+ */
+class SessionStore
+{
+public:
+    /**
+     * Constructor. Store is not usable before open().
+     */
+    SessionStore();
+
+    /**
+     * Destructor. Records are left in the file.
+     */
+    ~SessionStore();
+
+    /**
+     * Map state file, creating it if needed. File of other layout or
+     * capacity is cleared.
+     *
+     * @param path state file path.
+     * @param capacity max number of records.
+     * @return was the file mapped.
+     */
+    bool open(const QString& path, int capacity);
+
+    /**
+     * Is the state file mapped.
+     *
+     * @return is store usable.
+     */
+    bool isOpen() const { return header_ != 0; }
+
+    /**
+     * Highest session ID issued by any sensord using the file.
+     *
+     * @return session ID, 0 if none.
+     */
+    int lastSessionId() const;
+
+    /**
+     * Sessions recorded by previous sensord instances.
+     *
+     * @return session IDs found when the file was opened.
+     */
+    QList<int> previousSessions() const { return previous_; }
+
+    /**
+     * Create record for a new session.
+     *
+     * @param sessionId session ID.
+     * @param id sensor ID.
+     * @return record or NULL if the store is full or not open.
+     */
+    SessionRecord* issue(int sessionId, const QString& id);
+
+    /**
+     * Find record of a session.
+     *
+     * @param sessionId session ID.
+     * @return record or NULL.
+     */
+    SessionRecord* find(int sessionId);
+
+    /**
+     * Find record by resume token.
+     *
+     * @param token resume token.
+     * @return record or NULL.
+     */
+    SessionRecord* findToken(quint64 token);
+
+    /**
+     * Free record of a session.
+     *
+     * @param sessionId session ID.
+     */
+    void release(int sessionId);
+
+private:
+    /**
+     * Header of the state file.
+     */
+    struct Header
+    {
+        quint32 magic;         /**< file magic and layout version */
+        qint32  capacity;      /**< number of records */
+        qint32  lastSessionId; /**< highest issued session ID */
+        quint32 reserved;      /**< padding */
+    };
+
+    /**
+     * New random resume token.
+     *
+     * @return nonzero token.
+     */
+    static quint64 newToken();
+
+    Header*        header_;   /**< mapped file, NULL if not open */
+    SessionRecord* records_;  /**< records following the header */
+    size_t         mapSize_;  /**< size of the mapping */
+    QList<int>     previous_; /**< sessions found when opened */
+};
+
+#endif // SESSIONSTORE_H
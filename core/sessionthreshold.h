@@ -0,0 +1,142 @@
+/**
+   @file sessionthreshold.h
+   @brief Per-session delivery thresholds of sensor channels
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef SESSIONTHRESHOLD_H
+#define SESSIONTHRESHOLD_H
+
+#include <QtGlobal>
+#include "datatypes/genericdata.h"
+
+/**
+ * Change threshold of a session and the value last delivered to it.
+ */
+struct ChangeThreshold
+{
+    ChangeThreshold() : threshold(0), delivered(false), value(0) {}
+
+    /**
+     * Decide whether a value is delivered to the session, and if so take
+     * it as the value last delivered. The first value is always
+     * delivered; later ones when they differ from the last delivered
+     * value by more than the threshold, so a change of exactly the
+     * threshold is suppressed.
+     *
+     * @param sample value of the sample.
+     * @param force deliver regardless of the threshold.
+     * @return is the sample delivered.
+     */
+    bool pass(qint64 sample, bool force)
+    {
+        if (!threshold)
+            return true;
+        if (!force && delivered && qAbs(sample - value) <= (qint64)threshold)
+            return false;
+        delivered = true;
+        value = sample;
+        return true;
+    }
+
+    unsigned int threshold; /**< change threshold, 0 delivers every sample */
+    bool         delivered; /**< has a value been delivered */
+    qint64       value;     /**< value last delivered */
+};
+
+/**
+ * Motion threshold of a session and the reference it is measured from.
+ */
+struct MotionThreshold
+{
+    MotionThreshold() : threshold(0), duration(0), referenced(false), since(0) { reference[0] = reference[1] = reference[2] = 0; }
+
+    /**
+     * Decide whether a sample is a motion event of the session. The first
+     * sample becomes the reference. A sample is an event once samples
+     * farther from the reference than the threshold, by delta magnitude,
+     * have lasted at least the duration; the event then becomes the new
+     * reference. A sample at exactly the threshold restarts the duration.
+     * Samples without timestamp cannot be timed, they are events as soon
+     * as they exceed the threshold.
+     *
+     * @param data sample.
+     * @return is the sample delivered as a motion event.
+     */
+    bool pass(const TimedXyzData& data)
+    {
+        if (!referenced) {
+            setReference(data);
+            referenced = true;
+            return false;
+        }
+        quint64 limit = (quint64)threshold * threshold;
+        quint64 distance = square(data.x_, reference[0]);
+        distance = saturatedAdd(distance, square(data.y_, reference[1]));
+        distance = saturatedAdd(distance, square(data.z_, reference[2]));
+        if (distance <= limit) {
+            since = 0;
+            return false;
+        }
+        if (!since)
+            since = data.timestamp_ ? data.timestamp_ : 1;
+        if (data.timestamp_ - since < duration)
+            return false;
+        setReference(data);
+        since = 0;
+        return true;
+    }
+
+    /**
+     * Measure later samples from given one.
+     *
+     * @param data sample.
+     */
+    void setReference(const TimedXyzData& data)
+    {
+        reference[0] = data.x_;
+        reference[1] = data.y_;
+        reference[2] = data.z_;
+    }
+
+    /**
+     * Squared difference of two axis values. Fits quint64 over the whole
+     * int range.
+     */
+    static quint64 square(int value, int reference)
+    {
+        quint64 delta = value > reference ? (quint64)((qint64)value - reference) : (quint64)((qint64)reference - value);
+        return delta * delta;
+    }
+
+    /**
+     * Sum saturated at the largest quint64.
+     */
+    static quint64 saturatedAdd(quint64 a, quint64 b)
+    {
+        return a > ~0ULL - b ? ~0ULL : a + b;
+    }
+
+    unsigned int threshold;    /**< delta magnitude threshold */
+    unsigned int duration;     /**< minimum duration in microseconds */
+    bool         referenced;   /**< has a reference been taken */
+    int          reference[3]; /**< reference sample */
+    quint64      since;        /**< timestamp threshold was first exceeded, 0 if below */
+};
+
+#endif // SESSIONTHRESHOLD_H
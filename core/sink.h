@@ -28,11 +28,23 @@
 #ifndef SINK_H
 #define SINK_H
 
+#include "probes.h"
+#include "demand.h"
+
 /**
  * Data sink base class.
  */
 class SinkBase
 {
+public:
+    /**
+     * Does the sink consume what it collects, see DemandNode. Sources
+     * skip sinks without demand.
+     *
+     * @return is the sink demanded.
+     */
+    virtual bool demanded() const { return true; }
+
 protected:
     /**
      * Destructor.
@@ -84,10 +96,17 @@ public:
         member_(member)
     {}
 
+    bool demanded() const
+    {
+        return demandOf(instance_);
+    }
+
 private:
     void collect(int n, const TYPE* values)
     {
+        SENSORD_PROBE2(sink_entry, instance_, n);
         (instance_->*member_)(n, values);
+        SENSORD_PROBE2(sink_return, instance_, n);
     }
 
     DERIVED* instance_; /** sink callback implementor */
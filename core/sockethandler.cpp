@@ -28,316 +28,1811 @@
 
 #include <QLocalSocket>
 #include <QLocalServer>
+#include <QSocketNotifier>
+#include <QThread>
 #include <sys/socket.h>
+#include <sys/un.h>
 #include "logging.h"
+#include "tracelog.h"
+#include "config.h"
 #include "sockethandler.h"
+#include "sharedring.h"
+#include "compactframe.h"
+#include "latencytracer.h"
+#include "probes.h"
+#include "lowlatency.h"
+#include "clock.h"
 #include <unistd.h>
 #include <limits.h>
+#include <string.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <time.h>
 
-SessionData::SessionData(QLocalSocket* socket, QObject* parent) : QObject(parent),
+SessionBufferPool::SessionBufferPool()
+{
+}
+
+SessionBufferPool::~SessionBufferPool()
+{
+    for(int i = 0; i < CLASS_COUNT; ++i)
+    {
+        foreach(char* buffer, freeBuffers[i])
+            delete[] buffer;
+    }
+}
+
+int SessionBufferPool::sizeClass(int size, int& capacity)
+{
+    capacity = MIN_CLASS_SIZE;
+    for(int i = 0; i < CLASS_COUNT; ++i, capacity <<= 1)
+    {
+        if(size <= capacity)
+            return i;
+    }
+    capacity = size;
+    return -1;
+}
+
+char* SessionBufferPool::acquire(int size, int& capacity)
+{
+    int index = sizeClass(size, capacity);
+    if(index >= 0 && !freeBuffers[index].isEmpty())
+        return freeBuffers[index].takeLast();
+    return new char[capacity];
+}
+
+void SessionBufferPool::release(char* buffer, int capacity)
+{
+    if(!buffer)
+        return;
+    int classCapacity;
+    int index = sizeClass(capacity, classCapacity);
+    if(index >= 0 && classCapacity == capacity && freeBuffers[index].size() < MAX_FREE_BUFFERS)
+        freeBuffers[index].append(buffer);
+    else
+        delete[] buffer;
+}
+
+qint64 SessionBufferPool::compact()
+{
+    qint64 freed = 0;
+    int capacity = MIN_CLASS_SIZE;
+    for(int i = 0; i < CLASS_COUNT; ++i, capacity <<= 1)
+    {
+        freed += (qint64)freeBuffers[i].size() * capacity;
+        foreach(char* buffer, freeBuffers[i])
+            delete[] buffer;
+        freeBuffers[i].clear();
+    }
+    return freed;
+}
+
+SessionData::SessionData(QLocalSocket* socket, SessionBufferPool* pool, TimerWheel* wheel, QObject* parent) : QObject(parent),
                                                                   socket(socket),
                                                                   interval(-1),
+                                                                  pool(pool),
                                                                   buffer(0),
+                                                                  bufferCapacity(0),
                                                                   size(0),
                                                                   count(0),
+                                                                  wheel(wheel),
                                                                   bufferSize(1),
                                                                   bufferInterval(0),
-                                                                  downsampling(false)
+                                                                  downsampling(false),
+                                                                  batchBuffer(0),
+                                                                  batchBufferSize(0),
+                                                                  ring(0),
+                                                                  doorbell(false),
+                                                                  vectored(true),
+                                                                  blockedCount(0),
+                                                                  pendingBytes(0),
+                                                                  policy(DropOldest),
+                                                                  highWater(65536),
+                                                                  droppedCount(0),
+                                                                  latencyProbe(0),
+                                                                  muxId(-1),
+                                                                  compact(false),
+                                                                  requestedBufferSize(1),
+                                                                  requestedBufferInterval(0),
+                                                                  standbyBufferSize(0),
+                                                                  standbyBufferInterval(0),
+                                                                  deferredSize(0),
+                                                                  timestampDecimation(true),
+                                                                  lastTimestamp(0),
+                                                                  framePeriod(0),
+                                                                  framePhase(0),
+                                                                  frameLead(0),
+                                                                  frameExtrapolate(false),
+                                                                  frameTarget(0),
+                                                                  frameFresh(false),
+                                                                  costTiming(true),
+                                                                  costTimed(false),
+                                                                  shedding(false),
+                                                                  packet(false),
+                                                                  writeNotifier(0)
+{
+    lastWrite = 0;
+    if(Config::configuration())
+    {
+        vectored = Config::configuration()->value<bool>("global/socket_writev", true);
+        timestampDecimation = Config::configuration()->value<bool>("global/downsample_by_timestamp", true);
+        policy = policyFromString(Config::configuration()->value<QString>("global/backpressure_policy", "drop-oldest"));
+        highWater = Config::configuration()->value<int>("global/backpressure_high_water", highWater);
+        costTiming = Config::configuration()->value<bool>("global/session_cpu_time", true);
+    }
+    if(socket)
+        connect(socket, SIGNAL(bytesWritten(qint64)), this, SLOT(socketWritten()));
+}
+
+SessionData::~SessionData()
+{
+    wheel->cancel(this);
+    delete writeNotifier;
+    if(muxId < 0)
+        delete socket;
+    pool->release(buffer, bufferCapacity);
+    pool->release(batchBuffer, batchBufferSize);
+}
+
+void SessionData::timeout()
+{
+    CostTimer timer(this);
+    if(framePeriod)
+        flushFrame();
+    else
+        delayedWrite();
+}
+
+SessionData::BackpressurePolicy SessionData::policyFromString(const QString& name)
+{
+    if(name == "drop-newest")
+        return DropNewest;
+    if(name == "coalesce")
+        return Coalesce;
+    if(name != "drop-oldest")
+        sensordLogW() << "[SocketHandler]: unknown backpressure policy '" << name << "', using drop-oldest";
+    return DropOldest;
+}
+
+quint64 SessionData::sampleTimestamp(const void* sample, int size)
+{
+    quint64 timestamp = 0;
+    if(size >= (int)sizeof(timestamp))
+        memcpy(&timestamp, sample, sizeof(timestamp));
+    if(!timestamp)
+        timestamp = Clock::monotonicUs();
+    return timestamp;
+}
+
+qint64 SessionData::sinceLastWrite(const void* sample, int size) const
+{
+    if(timestampDecimation)
+    {
+        if(!lastTimestamp)
+            return LLONG_MAX;
+        quint64 timestamp = sampleTimestamp(sample, size);
+        // Timestamps going back mean a restarted stream
+        if(timestamp < lastTimestamp)
+            return LLONG_MAX;
+        return timestamp - lastTimestamp;
+    }
+    if(lastWrite == 0)
+        return LLONG_MAX;
+    return Clock::monotonicUs() - lastWrite;
+}
+
+void SessionData::markWritten(const void* sample, int size)
+{
+    if(timestampDecimation)
+        lastTimestamp = sampleTimestamp(sample, size);
+    else
+        lastWrite = Clock::monotonicUs();
+}
+
+bool SessionData::write(void* source, int size, unsigned int count)
+{
+    if(socket && count)
+    {
+        sensordTraceRate(SENSORD_TRACE_RATE) << "[SocketHandler]: writing " << count << " fragments to socket with payload (bytes): " << size;
+        memcpy(source, &count, sizeof(unsigned int));
+        struct iovec iov;
+        iov.iov_base = source;
+        iov.iov_len = size * count + sizeof(unsigned int);
+        return writeVectored(&iov, 1, size, count);
+    }
+    return false;
+}
+
+bool SessionData::write(const void* source, int size)
+{
+    if(ring)
+        return writeSharedRing(source, size, 1);
+    if(framePeriod)
+        return writeFrameSample(source, size);
+
+    if(buffer && size != this->size)
+        retireBuffer();
+    if(!buffer)
+        acquireBuffer(size);
+    this->size = size;
+    if(bufferSize <= 1)
+    {
+        memcpy(buffer + sizeof(unsigned int), source, size);
+        if(!downsampling || sinceLastWrite(source, size) >= interval * 1000LL)
+        {
+            sensordLogT() << "[SocketHandler]: writing, since > interval or downsampling disabled";
+            markWritten(source, size);
+            return write(buffer, size, 1);
+        }
+    }
+    else
+    {
+        memcpy(buffer + sizeof(unsigned int) + size * count, source, size);
+        ++count;
+        if(bufferSize == count)
+        {
+            sensordLogT() << "[SocketHandler]: writing, bufferSize == count";
+            return delayedWrite();
+        }
+    }
+    if(!isScheduled())
+    {
+        if(bufferSize > 1 && bufferInterval)
+        {
+            // Sessions with equal buffer intervals are flushed together
+            sensordLogT() << "[SocketHandler]: delayed write by at most " << bufferInterval << "ms";
+            wheel->schedule(this, TimerWheel::alignedDeadline(TimerWheel::now(), bufferInterval));
+        }
+        else if(!bufferSize)
+        {
+            qint64 since = sinceLastWrite(source, size) / 1000;
+            if((interval - since) > 0)
+            {
+                sensordLogT() << "[SocketHandler]: delayed write by " << (interval - since) << "ms";
+                wheel->schedule(this, TimerWheel::now() + (interval - since));
+            }
+        }
+    }
+    else
+    {
+        sensordLogT() << "[SocketHandler]: timer already running";
+    }
+    return true;
+}
+
+bool SessionData::writeHistory(const void* source, int size, unsigned int count)
+{
+    if(!socket || !count)
+        return false;
+    // Own header, the session buffer may hold samples not sent yet
+    unsigned int header = count;
+    struct iovec iov[2];
+    iov[0].iov_base = &header;
+    iov[0].iov_len = sizeof(header);
+    iov[1].iov_base = (void*)source;
+    iov[1].iov_len = size * count;
+    sensordTraceRate(SENSORD_TRACE_RATE) << "[SocketHandler]: writing " << count << " history samples to socket with payload (bytes): " << size;
+    return writeVectored(iov, 2, size, count);
+}
+
+bool SessionData::write(const void* source, int size, unsigned int count)
+{
+    if(!count)
+        return true;
+    if(ring)
+        return writeSharedRing(source, size, count);
+    if(count == 1)
+        return write(source, size);
+
+    const char* samples = (const char*)source;
+    if(framePeriod)
+    {
+        // Only the two newest samples matter for the next frame
+        writeFrameSample(samples + (count - 2) * size, size);
+        return writeFrameSample(samples + (count - 1) * size, size);
+    }
+    if(bufferSize > 1 && vectored && socket && (!this->count || size == this->size))
+    {
+        // Complete frames are sent straight from the source, only the
+        // samples left over are copied into the buffer.
+        while(count >= bufferSize - this->count)
+        {
+            unsigned int missing = bufferSize - this->count;
+            unsigned int header = bufferSize;
+            struct iovec iov[3];
+            int iovcnt = 0;
+            iov[iovcnt].iov_base = &header;
+            iov[iovcnt++].iov_len = sizeof(header);
+            if(this->count)
+            {
+                iov[iovcnt].iov_base = buffer + sizeof(unsigned int);
+                iov[iovcnt++].iov_len = this->count * size;
+            }
+            iov[iovcnt].iov_base = (void*)samples;
+            iov[iovcnt++].iov_len = missing * size;
+
+            sensordLogT() << "[SocketHandler]: writing, bufferSize == count";
+            wheel->cancel(this);
+            markWritten(samples + (missing - 1) * size, size);
+            this->count = 0;
+            if(!writeVectored(iov, iovcnt, size, bufferSize))
+                return false;
+            samples += missing * size;
+            count -= missing;
+        }
+    }
+
+    if(bufferSize > 1 || downsampling)
+    {
+        // Buffering and downsampling operate on individual samples
+        bool ret = true;
+        for(unsigned int i = 0; i < count; ++i)
+            ret &= write(samples + i * size, size);
+        return ret;
+    }
+
+    sensordTraceRate(SENSORD_TRACE_RATE) << "[SocketHandler]: writing batch of " << count << " samples";
+    markWritten(samples + (count - 1) * size, size);
+    if(vectored && socket)
+    {
+        struct iovec iov[2];
+        iov[0].iov_base = &count;
+        iov[0].iov_len = sizeof(count);
+        iov[1].iov_base = (void*)samples;
+        iov[1].iov_len = count * size;
+        return writeVectored(iov, 2, size, count);
+    }
+    reserveBatchBuffer(size * count + sizeof(unsigned int));
+    memcpy(batchBuffer + sizeof(unsigned int), samples, size * count);
+    return write(batchBuffer, size, count);
+}
+
+ssize_t SessionData::sendVectored(const struct iovec* iov, int iovcnt)
+{
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = (struct iovec*)iov;
+    msg.msg_iovlen = iovcnt;
+    ssize_t written = sendmsg(socket->socketDescriptor(), &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+    SENSORD_PROBE3(socket_send, this, written, iovcnt);
+    ++cost.writes;
+    if(written < 0)
+    {
+        if(errno != EAGAIN && errno != EWOULDBLOCK)
+        {
+            sensordLogW() << "[SocketHandler]: failed to write payload to the socket: " << strerror(errno);
+            return -1;
+        }
+        written = 0;
+    }
+    cost.bytes += written;
+    return written;
+}
+
+bool SessionData::writeVectored(const struct iovec* iov, int iovcnt, int sampleSize, unsigned int samples)
+{
+    if(!socket)
+        return false;
+
+    MultiplexedFrameHeader header;
+    struct iovec framed[4];
+    if(muxId >= 0)
+    {
+        // Count header and at most two sample slices
+        Q_ASSERT(iovcnt < 4);
+        header.sessionId = muxId;
+        header.length = 0;
+        framed[0].iov_base = &header;
+        framed[0].iov_len = sizeof(header);
+        for(int i = 0; i < iovcnt; ++i)
+        {
+            framed[i + 1] = iov[i];
+            header.length += iov[i].iov_len;
+        }
+        iov = framed;
+        ++iovcnt;
+    }
+
+    QByteArray frame;
+    // Bypassing QLocalSocket is only possible while nothing is queued,
+    // otherwise data would get reordered.
+    if(pending.isEmpty() && !socket->bytesToWrite())
+    {
+        const struct iovec* plain = iov;
+        int plainCount = iovcnt;
+        struct iovec encoded;
+        if(compact && sampleSize > 0)
+        {
+            encodeFrame(iov, iovcnt, sampleSize, samples, encoded);
+            iov = &encoded;
+            iovcnt = 1;
+        }
+        ssize_t written = sendVectored(iov, iovcnt);
+        if(written < 0)
+            return false;
+        if(packet && !written)
+        {
+            // Message is taken whole or not at all, queue it unsent
+            for(int i = 0; i < plainCount; ++i)
+                frame.append((const char*)plain[i].iov_base, plain[i].iov_len);
+            queueFrame(frame, sampleSize, samples);
+            return true;
+        }
+        if(latencyProbe)
+            traceFrame(plain, plainCount, sampleSize);
+        cost.samples += samples;
+        for(int i = 0; i < iovcnt; ++i)
+        {
+            if((size_t)written >= iov[i].iov_len)
+            {
+                written -= iov[i].iov_len;
+                continue;
+            }
+            frame.append((const char*)iov[i].iov_base + written, iov[i].iov_len - written);
+            written = 0;
+        }
+        if(frame.isEmpty())
+            return true;
+        // Partially sent frame must be completed as is
+        if(socket->write(frame) < 0)
+        {
+            sensordLogW() << "[SocketHandler]: failed to write payload to the socket: " << socket->errorString();
+            return false;
+        }
+        ++cost.writes;
+        cost.bytes += frame.size();
+        return true;
+    }
+
+    for(int i = 0; i < iovcnt; ++i)
+        frame.append((const char*)iov[i].iov_base, iov[i].iov_len);
+    queueFrame(frame, sampleSize, samples);
+    return true;
+}
+
+void SessionData::queueFrame(const QByteArray& frame, int sampleSize, unsigned int samples)
+{
+    qint64 queued = socket->bytesToWrite() + pendingBytes;
+    // Shed session keeps only the latest sample once the client lags
+    int limit = shedding ? 1 : highWater;
+    if(limit && queued + frame.size() > limit)
+    {
+        switch(shedding ? Coalesce : policy)
+        {
+            case DropNewest:
+                droppedCount += samples;
+                sensordLogT() << "[SocketHandler]: client is behind, dropped " << samples << " newest samples";
+                return;
+            case DropOldest:
+                while(!pending.isEmpty() && queued + frame.size() > limit)
+                {
+                    PendingFrame oldest = pending.takeFirst();
+                    droppedCount += oldest.samples;
+                    pendingBytes -= oldest.data.size();
+                    queued -= oldest.data.size();
+                }
+                sensordLogT() << "[SocketHandler]: client is behind, dropped oldest samples";
+                break;
+            case Coalesce:
+                foreach(const PendingFrame& old, pending)
+                    droppedCount += old.samples;
+                pending.clear();
+                pendingBytes = 0;
+                sensordLogT() << "[SocketHandler]: client is behind, coalesced to latest sample";
+                if(samples > 1)
+                {
+                    // Keep only the latest sample of the frame
+                    unsigned int one = 1;
+                    QByteArray latest;
+                    if(muxId >= 0)
+                    {
+                        MultiplexedFrameHeader header;
+                        header.sessionId = muxId;
+                        header.length = sizeof(one) + sampleSize;
+                        latest.append((const char*)&header, sizeof(header));
+                    }
+                    latest.append((const char*)&one, sizeof(one));
+                    latest.append(frame.constData() + frame.size() - sampleSize, sampleSize);
+                    droppedCount += samples - 1;
+                    appendPending(latest, sampleSize, 1);
+                    return;
+                }
+                break;
+        }
+    }
+    appendPending(frame, sampleSize, samples);
+}
+
+void SessionData::appendPending(const QByteArray& frame, int sampleSize, unsigned int samples)
+{
+    PendingFrame pendingFrame;
+    pendingFrame.data = frame;
+    pendingFrame.sampleSize = sampleSize;
+    pendingFrame.samples = samples;
+    pending.append(pendingFrame);
+    pendingBytes += frame.size();
+    flushPending();
+}
+
+void SessionData::flushPending()
+{
+    // QLocalSocket is fed one frame at a time so that everything else
+    // stays droppable. bytesWritten() tells when the next one fits.
+    while(socket && !pending.isEmpty() && !socket->bytesToWrite())
+    {
+        PendingFrame frame = pending.takeFirst();
+        pendingBytes -= frame.data.size();
+        struct iovec iov;
+        iov.iov_base = (void*)frame.data.constData();
+        iov.iov_len = frame.data.size();
+        struct iovec sent = iov;
+        if(compact && frame.sampleSize > 0)
+            encodeFrame(&iov, 1, frame.sampleSize, frame.samples, sent);
+        ssize_t written = sendVectored(&sent, 1);
+        if(written < 0)
+            return;
+        if(packet && !written)
+        {
+            pending.prepend(frame);
+            pendingBytes += frame.data.size();
+            watchWritable(true);
+            return;
+        }
+        if(latencyProbe)
+            traceFrame(&iov, 1, frame.sampleSize);
+        cost.samples += frame.samples;
+        if((size_t)written < sent.iov_len)
+        {
+            if(socket->write((const char*)sent.iov_base + written, sent.iov_len - written) < 0)
+            {
+                sensordLogW() << "[SocketHandler]: failed to write payload to the socket: " << socket->errorString();
+                return;
+            }
+            ++cost.writes;
+            cost.bytes += sent.iov_len - written;
+        }
+    }
+}
+
+void SessionData::socketWritten()
+{
+    CostTimer timer(this);
+    flushPending();
+}
+
+void SessionData::socketWritable()
+{
+    CostTimer timer(this);
+    watchWritable(false);
+    flushPending();
+}
+
+void SessionData::watchWritable(bool enabled)
+{
+    if(!enabled)
+    {
+        if(writeNotifier)
+            writeNotifier->setEnabled(false);
+        return;
+    }
+    if(!writeNotifier)
+    {
+        writeNotifier = new QSocketNotifier(socket->socketDescriptor(), QSocketNotifier::Write, this);
+        connect(writeNotifier, SIGNAL(activated(int)), this, SLOT(socketWritable()));
+    }
+    writeNotifier->setEnabled(true);
+}
+
+const SessionCost& SessionData::getCost() const
+{
+    return cost;
+}
+
+SessionData::CostTimer::CostTimer(SessionData* session) :
+    session(session && session->costTiming && !session->costTimed ? session : 0),
+    start(0)
+{
+    if(!this->session)
+        return;
+    this->session->costTimed = true;
+    struct timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    start = now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+SessionData::CostTimer::~CostTimer()
+{
+    if(!session)
+        return;
+    struct timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    session->cost.cpuTime += now.tv_sec * 1000000000ULL + now.tv_nsec - start;
+    session->costTimed = false;
+}
+
+void SessionData::setBackpressure(BackpressurePolicy policy, int highWater)
+{
+    this->policy = policy;
+    this->highWater = highWater;
+}
+
+void SessionData::setShedding(bool value)
+{
+    shedding = value;
+}
+
+SessionData::BackpressurePolicy SessionData::getBackpressurePolicy() const
+{
+    return policy;
+}
+
+int SessionData::getHighWater() const
+{
+    return highWater;
+}
+
+unsigned int SessionData::getDroppedCount() const
+{
+    return droppedCount;
+}
+
+qint64 SessionData::backlog() const
+{
+    return (socket ? socket->bytesToWrite() : 0) + pendingBytes;
+}
+
+int SessionData::bufferMemoryUsage() const
+{
+    return bufferCapacity + batchBufferSize;
+}
+
+void SessionData::reserveBatchBuffer(int size)
+{
+    if(size <= batchBufferSize)
+        return;
+    pool->release(batchBuffer, batchBufferSize);
+    batchBuffer = pool->acquire(size, batchBufferSize);
+}
+
+void SessionData::acquireBuffer(int size)
+{
+    // Low latency mode allocates for the largest buffer size up front
+    unsigned int samples = qMax(bufferSize, LowLatency::reservedBufferSize());
+    buffer = pool->acquire(samples * size + sizeof(unsigned int), bufferCapacity);
+    LowLatency::prefault(buffer, bufferCapacity);
+}
+
+void SessionData::retireBuffer()
+{
+    // Samples of the old layout are handed to the socket before the
+    // buffer is reused. QLocalSocket keeps its own copy of pending bytes
+    // so there is no need to wait for the client to read them.
+    if(bufferSize > 1 && count)
+        delayedWrite();
+    if(socket && (socket->bytesToWrite() || pendingBytes))
+    {
+        ++blockedCount;
+        sensordLogD() << "[SocketHandler]: " << socket->bytesToWrite() + pendingBytes << " bytes pending on buffer reallocation, not waiting for slow client";
+    }
+    pool->release(buffer, bufferCapacity);
+    buffer = 0;
+    bufferCapacity = 0;
+    count = 0;
+}
+
+unsigned int SessionData::getBlockedCount() const
+{
+    return blockedCount;
+}
+
+bool SessionData::writeSharedRing(const void* source, int size, unsigned int count)
+{
+    if(!ring->write(source, size, count))
+    {
+        sensordLogW() << "[SocketHandler]: sample size " << size << " does not match shared ring layout";
+        return false;
+    }
+    cost.bytes += count * size;
+    if(latencyProbe)
+    {
+        for(unsigned int i = 0; i < count; ++i)
+            latencyProbe->recordRaw((const char*)source + i * size, size);
+    }
+    cost.samples += count;
+    if(doorbell && socket)
+    {
+        quint32 sequence = ring->writeCount();
+        struct iovec iov;
+        iov.iov_base = &sequence;
+        iov.iov_len = sizeof(sequence);
+        // Doorbells carry no samples, only the latest one matters
+        return writeVectored(&iov, 1, 0, 0);
+    }
+    return true;
+}
+
+void SessionData::setFramePacing(unsigned int period, unsigned int phase, unsigned int lead, bool extrapolate)
 {
-    lastWrite.tv_sec = 0;
-    lastWrite.tv_usec = 0;
-    timer.setSingleShot(true);
-    connect(&timer, SIGNAL(timeout()), this, SLOT(timerTimeout()));
+    wheel->cancel(this);
+    if(framePeriod && frameFresh)
+        flushFrame();
+    framePeriod = period;
+    framePhase = period ? phase % period : 0;
+    frameLead = period ? lead % period : 0;
+    frameExtrapolate = extrapolate;
+    frameSample.clear();
+    framePrevious.clear();
+    frameFresh = false;
+    if(framePeriod && buffer && count)
+        delayedWrite();
+    sensordLogT() << "[SocketHandler]: frame pacing " << period << "us, phase " << framePhase << "us, lead " << frameLead << "us";
+}
+
+unsigned int SessionData::getFramePeriod() const
+{
+    return framePeriod;
+}
+
+bool SessionData::writeFrameSample(const void* source, int size)
+{
+    if(frameSample.size() == size)
+        framePrevious = frameSample;
+    else
+        framePrevious.clear();
+    frameSample = QByteArray((const char*)source, size);
+    frameFresh = true;
+    if(!isScheduled())
+        scheduleFrame();
+    return true;
+}
+
+void SessionData::scheduleFrame()
+{
+    quint64 earliest = TimerWheel::now() * 1000 + frameLead;
+    quint64 vsync = framePhase;
+    if(earliest >= framePhase)
+        vsync = ((earliest - framePhase) / framePeriod + 1) * framePeriod + framePhase;
+    frameTarget = vsync;
+    // Wheel ticks are milliseconds, rounding down delivers early
+    wheel->schedule(this, (vsync - frameLead) / 1000);
+}
+
+bool SessionData::flushFrame()
+{
+    wheel->cancel(this);
+    if(!frameFresh)
+        return true;
+    frameFresh = false;
+    int size = frameSample.size();
+    QByteArray sample(frameSample);
+
+    if(frameExtrapolate && framePrevious.size() == size && CompactFrame::encodable(size))
+    {
+        quint64 t0;
+        quint64 t1;
+        memcpy(&t0, framePrevious.constData(), sizeof(t0));
+        memcpy(&t1, frameSample.constData(), sizeof(t1));
+        if(t1 > t0 && frameTarget > t1)
+        {
+            // Prediction is limited to one frame past the newest sample
+            qint64 span = t1 - t0;
+            qint64 ahead = qMin<quint64>(frameTarget - t1, framePeriod);
+            char* data = sample.data();
+            const char* previous = framePrevious.constData();
+            for(int offset = sizeof(quint64); offset + (int)sizeof(qint32) <= size; offset += sizeof(qint32))
+            {
+                qint32 v0;
+                qint32 v1;
+                memcpy(&v0, previous + offset, sizeof(v0));
+                memcpy(&v1, data + offset, sizeof(v1));
+                qint32 v = (qint32)(v1 + ((qint64)v1 - v0) * ahead / span);
+                memcpy(data + offset, &v, sizeof(v));
+            }
+            quint64 timestamp = t1 + ahead;
+            memcpy(data, &timestamp, sizeof(timestamp));
+        }
+    }
+
+    sensordLogT() << "[SocketHandler]: writing frame sample for vsync at " << frameTarget << "us";
+    if(buffer && size != this->size)
+        retireBuffer();
+    if(!buffer)
+        acquireBuffer(size);
+    this->size = size;
+    memcpy(buffer + sizeof(unsigned int), sample.constData(), size);
+    markWritten(sample.constData(), size);
+    return write(buffer, size, 1);
+}
+
+bool SessionData::delayedWrite()
+{
+    wheel->cancel(this);
+    if(count)
+        markWritten(buffer + sizeof(unsigned int) + (count - 1) * size, size);
+    bool ret = write(buffer, size, count);
+    count = 0;
+    return ret;
+}
+
+QLocalSocket* SessionData::stealSocket()
+{
+    QLocalSocket* tmpsocket = socket;
+    socket = 0;
+    return tmpsocket;
+}
+
+QLocalSocket* SessionData::getSocket() const
+{
+    return socket;
+}
+
+void SessionData::setInterval(int interval)
+{
+    this->interval = interval;
+}
+
+int SessionData::getInterval() const
+{
+    return interval;
+}
+
+void SessionData::setBufferInterval(unsigned int interval)
+{
+    requestedBufferInterval = interval;
+    applyBuffering();
+}
+
+unsigned int SessionData::getBufferInterval() const
+{
+    return requestedBufferInterval;
+}
+
+void SessionData::setBufferSize(unsigned int size)
+{
+    requestedBufferSize = size < 1 ? 1 : size;
+    applyBuffering();
+}
+
+unsigned int SessionData::getBufferSize() const
+{
+    return requestedBufferSize;
+}
+
+void SessionData::setStandbyBatching(unsigned int size, unsigned int interval)
+{
+    standbyBufferSize = size;
+    standbyBufferInterval = interval;
+    applyBuffering();
+}
+
+void SessionData::setDeferred(unsigned int size)
+{
+    if(size == deferredSize)
+        return;
+    deferredSize = size;
+    applyBuffering();
+}
+
+bool SessionData::isDeferred() const
+{
+    return deferredSize;
+}
+
+void SessionData::flushDeferred()
+{
+    if(deferredSize && buffer && count)
+        delayedWrite();
+}
+
+void SessionData::applyBuffering()
+{
+    unsigned int size = requestedBufferSize;
+    bufferInterval = requestedBufferInterval;
+    if(standbyBufferSize)
+    {
+        size = qMax(size, standbyBufferSize);
+        bufferInterval = qMax(bufferInterval, standbyBufferInterval);
+    }
+    if(deferredSize)
+    {
+        // Held samples wait for the next wakeup instead of a timer
+        size = qMax(size, deferredSize);
+        bufferInterval = 0;
+    }
+
+    if(size != bufferSize)
+    {
+        // Samples batched with the previous size are written out here,
+        // the buffer is kept if it holds the new size too
+        if(buffer && bufferCapacity < (int)(size * this->size + sizeof(unsigned int)))
+            retireBuffer();
+        else if(bufferSize > 1 && count)
+            delayedWrite();
+        wheel->cancel(this);
+        bufferSize = size;
+        sensordLogT() << "[SocketHandler]: new buffersize: " << bufferSize;
+    }
+}
+
+void SessionData::setDownsampling(bool value)
+{
+    if(value != downsampling)
+    {
+        downsampling = value;
+        wheel->cancel(this);
+    }
+}
+
+bool SessionData::getDownsampling() const
+{
+    return downsampling;
+}
+
+void SessionData::setSharedRing(SharedRing* ring, bool doorbell)
+{
+    wheel->cancel(this);
+    this->ring = ring;
+    this->doorbell = doorbell;
+}
+
+void SessionData::setLatencyProbe(LatencyProbe* probe)
+{
+    latencyProbe = probe;
+}
+
+void SessionData::traceFrame(const struct iovec* iov, int iovcnt, int sampleSize)
+{
+    if(sampleSize <= 0)
+        return;
+    // Slices following the headers hold whole samples
+    size_t header = frameHeaderSize();
+    for(int i = 0; i < iovcnt; ++i)
+    {
+        const char* data = (const char*)iov[i].iov_base;
+        size_t offset = qMin(header, iov[i].iov_len);
+        header -= offset;
+        for(; offset + sampleSize <= iov[i].iov_len; offset += sampleSize)
+            latencyProbe->recordRaw(data + offset, sampleSize);
+    }
+}
+
+SharedRing* SessionData::getSharedRing() const
+{
+    return ring;
+}
+
+void SessionData::setMultiplexed(int sessionId)
+{
+    muxId = sessionId;
+}
+
+bool SessionData::isMultiplexed() const
+{
+    return muxId >= 0;
+}
+
+void SessionData::setCompact(bool value)
+{
+    compact = value;
+}
+
+void SessionData::setPacket(bool value)
+{
+    packet = value;
+}
+
+bool SessionData::isPacket() const
+{
+    return packet;
+}
+
+bool SessionData::isCompact() const
+{
+    return compact;
+}
+
+void SessionData::encodeFrame(const struct iovec* iov, int iovcnt, int sampleSize, unsigned int samples, struct iovec& encoded)
+{
+    // Samples follow the count header, in at most two slices
+    struct iovec slices[3];
+    int sliceCount = 0;
+    size_t header = sizeof(unsigned int);
+    for(int i = 0; i < iovcnt && sliceCount < 3; ++i)
+    {
+        size_t offset = qMin(header, iov[i].iov_len);
+        header -= offset;
+        if(offset == iov[i].iov_len)
+            continue;
+        slices[sliceCount].iov_base = (char*)iov[i].iov_base + offset;
+        slices[sliceCount++].iov_len = iov[i].iov_len - offset;
+    }
+    CompactFrame::encode(slices, sliceCount, sampleSize, samples, compactFrame);
+    encoded.iov_base = compactFrame.data();
+    encoded.iov_len = compactFrame.size();
+}
+
+int SessionData::frameHeaderSize() const
+{
+    return sizeof(unsigned int) + (muxId >= 0 ? sizeof(MultiplexedFrameHeader) : 0);
+}
+
+SocketHandler::SocketHandler(QObject* parent) : QObject(parent), m_server(NULL), m_packetServer(-1), m_packetNotifier(NULL), m_lastControl(0), m_standbyBufferSize(0), m_standbyBufferInterval(0),
+                                                   m_deferSize(0),
+                                                   m_consumptionTimer(NULL),
+                                                   m_timerWheel(this),
+                                                   m_blockedCount(0)
+{
+    qRegisterMetaType<SessionData::BackpressurePolicy>("SessionData::BackpressurePolicy");
+    qRegisterMetaType<SessionCost>("SessionCost");
+    m_server = new QLocalServer(this);
+    connect(m_server, SIGNAL(newConnection()), this, SLOT(newConnection()));
+}
+
+SocketHandler::~SocketHandler()
+{
+    if (m_server) {
+        delete m_server;
+    }
+    delete m_packetNotifier;
+    if (m_packetServer >= 0)
+        close(m_packetServer);
+    // Sessions return their buffers to the pool
+    qDeleteAll(m_idMap);
+    qDeleteAll(m_rings);
+}
+
+bool SocketHandler::listen(const QString& serverName)
+{
+    if (m_server->isListening()) {
+        sensordLogW() << "[SocketHandler]: Already listening";
+        return false;
+    }
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+    // Socket passed by systemd socket activation, see sd_listen_fds(3)
+    const int LISTEN_FDS_START = 3;
+    QByteArray listenPid = qgetenv("LISTEN_PID");
+    QByteArray listenFds = qgetenv("LISTEN_FDS");
+    unsetenv("LISTEN_PID");
+    unsetenv("LISTEN_FDS");
+    if (listenPid.toLong() == getpid() && listenFds.toInt() >= 1) {
+        if (m_server->listen(LISTEN_FDS_START)) {
+            sensordLogD() << "[SocketHandler]: Using activated socket" << m_server->fullServerName();
+            return true;
+        }
+        sensordLogW() << "[SocketHandler]: Activated socket not usable:" << m_server->errorString();
+    }
+#endif
+
+    bool unlinkDone = false;
+    while (!m_server->listen(serverName) && !unlinkDone && serverName[0] == QChar('/'))
+    {
+        if ( unlink(serverName.toLocal8Bit().constData()) == 0) {
+            sensordLogD() << "[SocketHandler]: Unlinked stale socket" << serverName;
+        } else {
+            sensordLogD() << m_server->errorString();
+        }
+        unlinkDone = true;
+    }
+    return m_server->isListening();
+}
+
+bool SocketHandler::listenPacket(const QString& path)
+{
+    if (m_packetServer >= 0) {
+        sensordLogW() << "[SocketHandler]: Already listening packet socket";
+        return false;
+    }
+
+    QByteArray name(path.toLocal8Bit());
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (name.isEmpty() || name.size() >= (int)sizeof(address.sun_path)) {
+        sensordLogW() << "[SocketHandler]: Invalid packet socket path" << path;
+        return false;
+    }
+    memcpy(address.sun_path, name.constData(), name.size());
+
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (fd < 0) {
+        sensordLogW() << "[SocketHandler]: Failed to create packet socket: " << strerror(errno);
+        return false;
+    }
+    unlink(name.constData());
+    if (bind(fd, (struct sockaddr*)&address, sizeof(address)) < 0 || ::listen(fd, SOMAXCONN) < 0) {
+        sensordLogW() << "[SocketHandler]: Failed to listen packet socket" << path << ": " << strerror(errno);
+        close(fd);
+        return false;
+    }
+
+    m_packetServer = fd;
+    m_packetNotifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+    connect(m_packetNotifier, SIGNAL(activated(int)), this, SLOT(newPacketConnection()));
+    sensordLogD() << "[SocketHandler]: Listening packet socket" << path;
+    return true;
+}
+
+bool SocketHandler::write(int id, const void* source, int size)
+{
+    QHash<int, SessionData*>::iterator it = m_idMap.find(id);
+    if (it == m_idMap.end())
+    {
+        sensordLogD() << "[SocketHandler]: Trying to write to nonexistent session (normal, no panic).";
+        return false;
+    }
+    sensordTraceRate(SENSORD_TRACE_RATE) << "[SocketHandler]: Writing to session " << id;
+    SENSORD_PROBE3(session_write, id, 1, size);
+    SessionData::CostTimer timer(*it);
+    bool ret = (*it)->write(source, size);
+    wakeupWritten(*it);
+    return ret;
+}
+
+bool SocketHandler::write(int id, const void* source, int size, unsigned int count)
+{
+    QHash<int, SessionData*>::iterator it = m_idMap.find(id);
+    if (it == m_idMap.end())
+    {
+        sensordLogD() << "[SocketHandler]: Trying to write to nonexistent session (normal, no panic).";
+        return false;
+    }
+    sensordTraceRate(SENSORD_TRACE_RATE) << "[SocketHandler]: Writing " << count << " samples to session " << id;
+    SENSORD_PROBE3(session_write, id, count, size);
+    SessionData::CostTimer timer(*it);
+    bool ret = (*it)->write(source, size, count);
+    wakeupWritten(*it);
+    return ret;
+}
+
+bool SocketHandler::removeSession(int sessionId)
+{
+    if (!inOwnThread()) {
+        bool value = false;
+        QMetaObject::invokeMethod(const_cast<SocketHandler*>(this), "removeSession", Qt::BlockingQueuedConnection,
+                                  Q_RETURN_ARG(bool, value), Q_ARG(int, sessionId));
+        return value;
+    }
+    QHash<int, SessionData*>::iterator it = m_idMap.find(sessionId);
+    if (it == m_idMap.end()) {
+        sensordLogW() << "[SocketHandler]: Trying to remove nonexistent session.";
+        return false;
+    }
+
+    QLocalSocket* socket = (*it)->stealSocket();
+    SessionData* session = *it;
+    m_idMap.erase(it);
+    m_backlogs.remove(sessionId);
+    m_congested.remove(sessionId);
+    m_socketSessions.remove(socket, sessionId);
+
+    // Multiplexed connection stays open for the other sessions
+    if (socket && session->isMultiplexed()) {
+        if (socketInUse(socket))
+            socket = 0;
+        else
+            m_muxSockets.remove(socket);
+    }
+
+    if (socket) {
+        disconnect(socket, SIGNAL(readyRead()), this, SLOT(socketReadable()));
+        disconnect(socket, SIGNAL(disconnected()), this, SLOT(socketDisconnected()));
+        disconnect(socket, SIGNAL(error(QLocalSocket::LocalSocketError)), this, SLOT(socketError(QLocalSocket::LocalSocketError)));
+        socket->deleteLater();
+    }
+
+    m_blockedCount += session->getBlockedCount();
+    delete session;
+    releaseSharedRing(sessionId);
+    m_sessionChannels.remove(sessionId);
+
+    return true;
+}
+
+void SocketHandler::newConnection()
+{
+    sensordLogT() << "[SocketHandler]: New connection received.";
+
+    while (m_server->hasPendingConnections()) {
+
+        greetConnection(m_server->nextPendingConnection());
+    }
+}
+
+void SocketHandler::newPacketConnection()
+{
+    int fd;
+    while ((fd = accept4(m_packetServer, 0, 0, SOCK_CLOEXEC | SOCK_NONBLOCK)) >= 0) {
+        sensordLogT() << "[SocketHandler]: New packet connection received.";
+        QLocalSocket* socket = new QLocalSocket(this);
+        if (!socket->setSocketDescriptor(fd)) {
+            sensordLogW() << "[SocketHandler]: Failed to take packet connection: " << socket->errorString();
+            close(fd);
+            delete socket;
+            continue;
+        }
+        m_packetSockets.insert(socket);
+        greetConnection(socket);
+    }
+    if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+        sensordLogW() << "[SocketHandler]: Failed to accept packet connection: " << strerror(errno);
+}
+
+void SocketHandler::greetConnection(QLocalSocket* socket)
+{
+    connect(socket, SIGNAL(readyRead()), this, SLOT(socketReadable()));
+    connect(socket, SIGNAL(disconnected()), this, SLOT(socketDisconnected()));
+    connect(socket, SIGNAL(error(QLocalSocket::LocalSocketError)), this, SLOT(socketError(QLocalSocket::LocalSocketError)));
+
+    // Initialize socket
+    socket->write("\n", 1);
+    socket->waitForBytesWritten();
+}
+
+void SocketHandler::socketReadable()
+{
+    int sessionId = -1;
+    int transport = SocketTransport;
+    QLocalSocket* socket = (QLocalSocket*)sender();
+    if (m_muxSockets.contains(socket)) {
+        readRegistrations(socket);
+        return;
+    }
+    if (m_controls.contains(socket)) {
+        readControl(socket);
+        return;
+    }
+    socket->read((char*)&sessionId, sizeof(int));
+    // Clients requesting other transport write it together with session ID
+    if (socket->bytesAvailable() >= (qint64)sizeof(int))
+        socket->read((char*)&transport, sizeof(int));
+
+    // Packet socket only carries message framed sessions, and only it
+    bool packetSocket = m_packetSockets.remove(socket);
+    if (packetSocket != (transport == SeqPacketTransport)) {
+        sensordLogW() << "[SocketHandler]: Transport " << transport << " not available on this socket. Closing socket.";
+        char reply = 'N';
+        socket->write(&reply, sizeof(reply));
+        socket->flush();
+        socket->abort();
+        return;
+    }
+
+    if (transport == ControlTransport) {
+        setupControl(socket);
+        return;
+    }
+
+    if (transport != MultiplexedTransport)
+        disconnect(socket, SIGNAL(readyRead()), this, SLOT(socketReadable()));
+
+    if (sessionId >= 0) {
+        if (addSession(sessionId, socket)) {
+            if (transport == MultiplexedTransport)
+                setupMultiplexed(sessionId);
+            else if (transport == CompactSocketTransport)
+                setupCompact(sessionId);
+            else if (transport == SeqPacketTransport)
+                setupPacket(sessionId);
+            else if (transport != SocketTransport)
+                setupSharedRing(sessionId, transport);
+        } else if (transport == MultiplexedTransport) {
+            disconnect(socket, SIGNAL(readyRead()), this, SLOT(socketReadable()));
+        }
+    } else {
+        sensordLogC() << "[SocketHandler]: Failed to read valid session ID from client. Closing socket.";
+        socket->abort();
+    }
 }
 
-SessionData::~SessionData()
+SessionData* SocketHandler::addSession(int sessionId, QLocalSocket* socket)
 {
-    timer.stop();
-    delete socket;
-    delete[] buffer;
+    if (m_idMap.contains(sessionId))
+        return 0;
+    SessionData* session = new SessionData(socket, &m_bufferPool, &m_timerWheel, this);
+    QString channel = m_sessionChannels.value(sessionId);
+    if (!channel.isEmpty())
+        session->setLatencyProbe(LatencyTracer::instance().probe(channel, LatencyTracer::SocketStage));
+    m_idMap.insert(sessionId, session);
+    m_socketSessions.insert(socket, sessionId);
+    if (m_standbyBufferSize)
+        session->setStandbyBatching(m_standbyBufferSize, m_standbyBufferInterval);
+    if (m_deferSize)
+        applyDeferral(sessionId, session);
+    return session;
 }
 
-void SessionData::timerTimeout()
+bool SocketHandler::socketInUse(QLocalSocket* socket) const
 {
-    delayedWrite();
+    return m_socketSessions.contains(socket);
 }
 
-long SessionData::sinceLastWrite() const
+void SocketHandler::setupMultiplexed(int sessionId)
 {
-    if(lastWrite.tv_sec == 0)
-        return LONG_MAX;
-    struct timeval now;
-    gettimeofday(&now, 0);
-    return (now.tv_sec - lastWrite.tv_sec) * 1000 + ((now.tv_usec - lastWrite.tv_usec) / 1000);
+    SessionData* session = m_idMap.value(sessionId);
+    QLocalSocket* socket = session->getSocket();
+    bool enabled = !Config::configuration() || Config::configuration()->value<bool>("global/multiplexed_transport", true);
+
+    char reply = enabled ? 'M' : 'N';
+    if (socket->write(&reply, sizeof(reply)) != sizeof(reply) || !socket->flush()) {
+        sensordLogW() << "[SocketHandler]: Failed to reply to transport request: " << socket->errorString();
+        enabled = false;
+    }
+
+    if (!enabled) {
+        // Refused connection is an ordinary session socket
+        sensordLogD() << "[SocketHandler]: Multiplexed transport refused for session " << sessionId;
+        disconnect(socket, SIGNAL(readyRead()), this, SLOT(socketReadable()));
+        return;
+    }
+
+    sensordLogD() << "[SocketHandler]: Session " << sessionId << " starts multiplexed connection";
+    session->setMultiplexed(sessionId);
+    m_muxSockets.insert(socket);
+    readRegistrations(socket);
 }
 
-bool SessionData::write(void* source, int size, unsigned int count)
+void SocketHandler::setupCompact(int sessionId)
 {
-    if(socket && count)
-    {
-        sensordLogT() << "[SocketHandler]: writing " << count << " fragments to socket with payload (bytes): " << size;
-        memcpy(source, &count, sizeof(unsigned int));
-        int written = socket->write((const char*)source, size * count + sizeof(unsigned int));
-        if(written < 0)
-        {
-            sensordLogW() << "[SocketHandler]: failed to write payload to the socket: " << socket->errorString();
-            return false;
-        }
-        return true;
+    SessionData* session = m_idMap.value(sessionId);
+    QLocalSocket* socket = session->getSocket();
+    bool enabled = !Config::configuration() || Config::configuration()->value<bool>("global/compact_transport", true);
+
+    char reply = enabled ? 'C' : 'N';
+    if (socket->write(&reply, sizeof(reply)) != sizeof(reply) || !socket->flush()) {
+        sensordLogW() << "[SocketHandler]: Failed to reply to transport request: " << socket->errorString();
+        return;
     }
-    return false;
+
+    sensordLogD() << "[SocketHandler]: Compact transport " << (enabled ? "accepted" : "refused") << " for session " << sessionId;
+    session->setCompact(enabled);
 }
 
-bool SessionData::write(const void* source, int size)
+void SocketHandler::setupPacket(int sessionId)
 {
-    long since = sinceLastWrite();
-    int allocSize = bufferSize * size + sizeof(unsigned int);
-    if(!buffer)
-        buffer = new char[allocSize];
-    else if(size != this->size)
-    {
-        socket->waitForBytesWritten();
-        delete[] buffer;
-        buffer = new char[allocSize];
+    SessionData* session = m_idMap.value(sessionId);
+    QLocalSocket* socket = session->getSocket();
+
+    char reply = 'P';
+    if (socket->write(&reply, sizeof(reply)) != sizeof(reply) || !socket->flush()) {
+        sensordLogW() << "[SocketHandler]: Failed to reply to transport request: " << socket->errorString();
+        return;
     }
-    this->size = size;
-    if(bufferSize <= 1)
-    {
-        memcpy(buffer + sizeof(unsigned int), source, size);
-        if(!downsampling || (downsampling && since >= interval))
-        {
-            sensordLogT() << "[SocketHandler]: writing, since > interval or downsampling disabled";
-            gettimeofday(&lastWrite, 0);
-            return write(buffer, size, 1);
-        }
+
+    sensordLogD() << "[SocketHandler]: Session " << sessionId << " uses packet transport";
+    session->setPacket(true);
+}
+
+void SocketHandler::setupControl(QLocalSocket* socket)
+{
+#ifdef SENSORFW_NO_DBUS
+    bool enabled = !Config::configuration() || Config::configuration()->value<bool>("global/control_transport", true);
+#else
+    bool enabled = Config::configuration() && Config::configuration()->value<bool>("global/control_transport", false);
+#endif
+
+    char reply = enabled ? 'K' : 'N';
+    if (socket->write(&reply, sizeof(reply)) != sizeof(reply) || !socket->flush()) {
+        sensordLogW() << "[SocketHandler]: Failed to reply to transport request: " << socket->errorString();
+        enabled = false;
     }
-    else
-    {
-        memcpy(buffer + sizeof(unsigned int) + size * count, source, size);
-        ++count;
-        if(bufferSize == count)
-        {
-            sensordLogT() << "[SocketHandler]: writing, bufferSize == count";
-            return delayedWrite();
-        }
+
+    if (!enabled) {
+        sensordLogD() << "[SocketHandler]: Control transport refused";
+        disconnect(socket, SIGNAL(readyRead()), this, SLOT(socketReadable()));
+        disconnect(socket, SIGNAL(disconnected()), this, SLOT(socketDisconnected()));
+        disconnect(socket, SIGNAL(error(QLocalSocket::LocalSocketError)), this, SLOT(socketError(QLocalSocket::LocalSocketError)));
+        socket->disconnectFromServer();
+        socket->deleteLater();
+        return;
     }
-    if(!timer.isActive())
-    {
-        if(bufferSize > 1 && bufferInterval)
-        {
-            sensordLogT() << "[SocketHandler]: delayed write by " << bufferInterval << "ms";
-            timer.start(bufferInterval);
-        }
-        else if(!bufferSize && (interval - since) > 0)
-        {
-            sensordLogT() << "[SocketHandler]: delayed write by " << (interval - since) << "ms";
-            timer.start(interval - since);
-        }
+
+    m_controls.insert(socket, ++m_lastControl);
+    sensordLogD() << "[SocketHandler]: Control connection " << m_lastControl << " opened";
+    readControl(socket);
+}
+
+void SocketHandler::readControl(QLocalSocket* socket)
+{
+    const qint64 MAX_LINE = 4096;
+    int connection = m_controls.value(socket);
+    while (socket->canReadLine()) {
+        QByteArray line(socket->readLine(MAX_LINE + 1).trimmed());
+        if (!line.isEmpty())
+            emit controlRequest(connection, line);
     }
-    else
-    {
-        sensordLogT() << "[SocketHandler]: timer already running";
+    if (socket->bytesAvailable() > MAX_LINE) {
+        sensordLogW() << "[SocketHandler]: Too long request on control connection " << connection << ", closing it";
+        removeControl(socket);
     }
-    return true;
 }
 
-bool SessionData::delayedWrite()
+void SocketHandler::removeControl(QLocalSocket* socket)
 {
-    if(timer.isActive())
-        timer.stop();
-    gettimeofday(&lastWrite, 0);
-    bool ret = write(buffer, size, count);
-    count = 0;
-    return ret;
+    if (!m_controls.remove(socket))
+        return;
+    disconnect(socket, SIGNAL(readyRead()), this, SLOT(socketReadable()));
+    disconnect(socket, SIGNAL(disconnected()), this, SLOT(socketDisconnected()));
+    disconnect(socket, SIGNAL(error(QLocalSocket::LocalSocketError)), this, SLOT(socketError(QLocalSocket::LocalSocketError)));
+    socket->abort();
+    socket->deleteLater();
 }
 
-QLocalSocket* SessionData::stealSocket()
+void SocketHandler::controlReply(int connection, const QByteArray& reply)
 {
-    QLocalSocket* tmpsocket = socket;
-    socket = 0;
-    return tmpsocket;
+    if (!inOwnThread()) {
+        // Replies keep the order of the requests, no need to block
+        QMetaObject::invokeMethod(this, "controlReply", Qt::QueuedConnection,
+                                  Q_ARG(int, connection), Q_ARG(QByteArray, reply));
+        return;
+    }
+    QLocalSocket* socket = m_controls.key(connection);
+    if (!socket)
+        return;
+    if (socket->write(reply + '\n') < 0)
+        sensordLogW() << "[SocketHandler]: Failed to write control reply: " << socket->errorString();
 }
 
-QLocalSocket* SessionData::getSocket() const
+bool SocketHandler::writeHistory(int sessionId, const QByteArray& samples, int size)
 {
-    return socket;
+    if (!inOwnThread()) {
+        bool value = false;
+        QMetaObject::invokeMethod(this, "writeHistory", Qt::BlockingQueuedConnection,
+                                  Q_RETURN_ARG(bool, value), Q_ARG(int, sessionId),
+                                  Q_ARG(QByteArray, samples), Q_ARG(int, size));
+        return value;
+    }
+    if (size <= 0 || samples.size() % size)
+        return false;
+    QHash<int, SessionData*>::iterator it = m_idMap.find(sessionId);
+    if (it == m_idMap.end()) {
+        sensordLogD() << "[SocketHandler]: Trying to write history to nonexistent session.";
+        return false;
+    }
+    SENSORD_PROBE3(session_write, sessionId, samples.size() / size, size);
+    SessionData::CostTimer timer(*it);
+    bool ret = (*it)->writeHistory(samples.constData(), size, samples.size() / size);
+    wakeupWritten(*it);
+    return ret;
 }
 
-void SessionData::setInterval(int interval)
+void SocketHandler::readRegistrations(QLocalSocket* socket)
 {
-    this->interval = interval;
+    int request[2];
+    while (socket->bytesAvailable() >= (qint64)sizeof(request)) {
+        socket->read((char*)request, sizeof(request));
+        if (request[0] < 0 || request[1] != MultiplexedTransport) {
+            sensordLogW() << "[SocketHandler]: Invalid registration on multiplexed connection, session " << request[0];
+            continue;
+        }
+        SessionData* session = addSession(request[0], socket);
+        if (!session) {
+            sensordLogW() << "[SocketHandler]: Session " << request[0] << " is already connected";
+            continue;
+        }
+        sensordLogD() << "[SocketHandler]: Session " << request[0] << " joins multiplexed connection";
+        session->setMultiplexed(request[0]);
+    }
 }
 
-int SessionData::getInterval() const
+void SocketHandler::setupSharedRing(int sessionId, int transport)
 {
-    return interval;
+    SessionData* session = m_idMap.value(sessionId);
+    SharedRing* ring = 0;
+
+    if (transport != SharedRingDoorbellTransport && transport != SharedRingPollTransport) {
+        sensordLogW() << "[SocketHandler]: Unknown transport " << transport << " requested by session " << sessionId;
+    } else if (Config::configuration() && !Config::configuration()->value<bool>("global/shared_ring_transport", true)) {
+        sensordLogD() << "[SocketHandler]: Shared ring transport disabled by configuration";
+    } else {
+        ring = m_rings.value(sessionId);
+        if (!ring) {
+            unsigned int capacity = 16384;
+            if (Config::configuration())
+                capacity = Config::configuration()->value<unsigned int>("global/shared_ring_size", capacity);
+            ring = new SharedRing(capacity);
+            if (ring->isValid()) {
+                m_rings.insert(sessionId, ring);
+            } else {
+                delete ring;
+                ring = 0;
+            }
+        }
+    }
+
+    char reply = ring ? 'R' : 'N';
+    struct iovec iov;
+    iov.iov_base = &reply;
+    iov.iov_len = sizeof(reply);
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    char control[CMSG_SPACE(sizeof(int))];
+    if (ring) {
+        int fd = ring->fd();
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+    }
+
+    // Reply bypasses QLocalSocket so anything queued there must go first
+    session->getSocket()->flush();
+    if (sendmsg(session->getSocket()->socketDescriptor(), &msg, MSG_NOSIGNAL) != sizeof(reply)) {
+        sensordLogW() << "[SocketHandler]: Failed to reply to transport request: " << strerror(errno);
+        if (ring) {
+            ring = 0;
+            releaseSharedRing(sessionId);
+        }
+    }
+
+    if (ring) {
+        sensordLogD() << "[SocketHandler]: Session " << sessionId << " uses shared ring";
+        session->setSharedRing(ring, transport == SharedRingDoorbellTransport);
+    }
 }
 
-void SessionData::setBufferInterval(unsigned int interval)
+void SocketHandler::releaseSharedRing(int sessionId)
 {
-    bufferInterval = interval;
+    delete m_rings.take(sessionId);
 }
 
-unsigned int SessionData::getBufferInterval() const
+unsigned int SocketHandler::blockedCount() const
 {
-    return bufferInterval;
+    if (!inOwnThread()) {
+        unsigned int value = 0;
+        QMetaObject::invokeMethod(const_cast<SocketHandler*>(this), "blockedCount", Qt::BlockingQueuedConnection,
+                                  Q_RETURN_ARG(unsigned int, value));
+        return value;
+    }
+    unsigned int count = m_blockedCount;
+    for(QHash<int, SessionData*>::const_iterator it = m_idMap.constBegin(); it != m_idMap.constEnd(); ++it)
+        count += it.value()->getBlockedCount();
+    return count;
 }
 
-void SessionData::setBufferSize(unsigned int size)
+qint64 SocketHandler::bufferMemoryUsage(int sessionId) const
 {
-    if(size != bufferSize)
-    {
-        if(timer.isActive())
-            timer.stop();
-        socket->waitForBytesWritten();
-        delete[] buffer;
-        buffer = 0;
-        count = 0;
-        bufferSize = size;
-        if(bufferSize < 1)
-            bufferSize = 1;
-        sensordLogT() << "[SocketHandler]: new buffersize: " << bufferSize;
+    if (!inOwnThread()) {
+        qint64 value = 0;
+        QMetaObject::invokeMethod(const_cast<SocketHandler*>(this), "bufferMemoryUsage", Qt::BlockingQueuedConnection,
+                                  Q_RETURN_ARG(qint64, value), Q_ARG(int, sessionId));
+        return value;
     }
+    QHash<int, SessionData*>::const_iterator it = m_idMap.find(sessionId);
+    if (it != m_idMap.end())
+        return (*it)->bufferMemoryUsage();
+    return 0;
 }
 
-unsigned int SessionData::getBufferSize() const
+qint64 SocketHandler::compactBuffers()
 {
-    return bufferSize;
+    if (!inOwnThread()) {
+        qint64 value = 0;
+        QMetaObject::invokeMethod(this, "compactBuffers", Qt::BlockingQueuedConnection,
+                                  Q_RETURN_ARG(qint64, value));
+        return value;
+    }
+    return m_bufferPool.compact();
 }
 
-void SessionData::setDownsampling(bool value)
+qint64 SocketHandler::backlog(int sessionId) const
 {
-    if(value != downsampling)
-    {
-        downsampling = value;
-        if(timer.isActive())
-            timer.stop();
+    if (!inOwnThread()) {
+        qint64 value = 0;
+        QMetaObject::invokeMethod(const_cast<SocketHandler*>(this), "backlog", Qt::BlockingQueuedConnection,
+                                  Q_RETURN_ARG(qint64, value), Q_ARG(int, sessionId));
+        return value;
     }
+    QHash<int, SessionData*>::const_iterator it = m_idMap.find(sessionId);
+    if (it != m_idMap.end())
+        return (*it)->backlog();
+    return 0;
 }
 
-bool SessionData::getDownsampling() const
+SessionCost SocketHandler::sessionCost(int sessionId) const
 {
-    return downsampling;
+    if (!inOwnThread()) {
+        SessionCost value;
+        QMetaObject::invokeMethod(const_cast<SocketHandler*>(this), "sessionCost", Qt::BlockingQueuedConnection,
+                                  Q_RETURN_ARG(SessionCost, value), Q_ARG(int, sessionId));
+        return value;
+    }
+    QHash<int, SessionData*>::const_iterator it = m_idMap.find(sessionId);
+    if (it != m_idMap.end())
+        return (*it)->getCost();
+    return SessionCost();
 }
 
-SocketHandler::SocketHandler(QObject* parent) : QObject(parent), m_server(NULL)
+void SocketHandler::setBackpressure(int sessionId, SessionData::BackpressurePolicy policy, int highWater)
 {
-    m_server = new QLocalServer(this);
-    connect(m_server, SIGNAL(newConnection()), this, SLOT(newConnection()));
+    if (!inOwnThread()) {
+        QMetaObject::invokeMethod(this, "setBackpressure", Qt::BlockingQueuedConnection, Q_ARG(int, sessionId), Q_ARG(SessionData::BackpressurePolicy, policy), Q_ARG(int, highWater));
+        return;
+    }
+    QHash<int, SessionData*>::iterator it = m_idMap.find(sessionId);
+    if (it != m_idMap.end())
+        (*it)->setBackpressure(policy, highWater);
 }
 
-SocketHandler::~SocketHandler()
+void SocketHandler::setShedding(int sessionId, bool value)
 {
-    if (m_server) {
-        delete m_server;
+    if (!inOwnThread()) {
+        QMetaObject::invokeMethod(this, "setShedding", Qt::BlockingQueuedConnection, Q_ARG(int, sessionId), Q_ARG(bool, value));
+        return;
     }
+    QHash<int, SessionData*>::iterator it = m_idMap.find(sessionId);
+    if (it != m_idMap.end())
+        (*it)->setShedding(value);
 }
 
-bool SocketHandler::listen(const QString& serverName)
+void SocketHandler::setFramePacing(int sessionId, unsigned int period, unsigned int phase, unsigned int lead, bool extrapolate)
 {
-    if (m_server->isListening()) {
-        sensordLogW() << "[SocketHandler]: Already listening";
-        return false;
+    if (!inOwnThread()) {
+        QMetaObject::invokeMethod(this, "setFramePacing", Qt::BlockingQueuedConnection, Q_ARG(int, sessionId),
+                                  Q_ARG(unsigned int, period), Q_ARG(unsigned int, phase), Q_ARG(unsigned int, lead), Q_ARG(bool, extrapolate));
+        return;
     }
+    QHash<int, SessionData*>::iterator it = m_idMap.find(sessionId);
+    if (it != m_idMap.end())
+        (*it)->setFramePacing(period, phase, lead, extrapolate);
+}
 
-    bool unlinkDone = false;
-    while (!m_server->listen(serverName) && !unlinkDone && serverName[0] == QChar('/'))
-    {
-        if ( unlink(serverName.toLocal8Bit().constData()) == 0) {
-            sensordLogD() << "[SocketHandler]: Unlinked stale socket" << serverName;
-        } else {
-            sensordLogD() << m_server->errorString();
-        }
-        unlinkDone = true;
+unsigned int SocketHandler::droppedCount(int sessionId) const
+{
+    if (!inOwnThread()) {
+        unsigned int value = 0;
+        QMetaObject::invokeMethod(const_cast<SocketHandler*>(this), "droppedCount", Qt::BlockingQueuedConnection,
+                                  Q_RETURN_ARG(unsigned int, value), Q_ARG(int, sessionId));
+        return value;
     }
-    return m_server->isListening();
+    QHash<int, SessionData*>::const_iterator it = m_idMap.find(sessionId);
+    if (it != m_idMap.end())
+        return (*it)->getDroppedCount();
+    return 0;
 }
 
-bool SocketHandler::write(int id, const void* source, int size)
+unsigned int SocketHandler::droppedCount(const QString& channel) const
 {
-    QMap<int, SessionData*>::iterator it = m_idMap.find(id);
-    if (it == m_idMap.end())
+    if (!inOwnThread()) {
+        unsigned int value = 0;
+        QMetaObject::invokeMethod(const_cast<SocketHandler*>(this), "droppedCount", Qt::BlockingQueuedConnection,
+                                  Q_RETURN_ARG(unsigned int, value), Q_ARG(QString, channel));
+        return value;
+    }
+    unsigned int count = 0;
+    for(QMap<int, QString>::const_iterator it = m_sessionChannels.constBegin(); it != m_sessionChannels.constEnd(); ++it)
     {
-        sensordLogD() << "[SocketHandler]: Trying to write to nonexistent session (normal, no panic).";
-        return false;
+        if(it.value() == channel)
+            count += droppedCount(it.key());
     }
-    sensordLogT() << "[SocketHandler]: Writing to session " << id;
-    return (*it)->write(source, size);
+    return count;
 }
 
-bool SocketHandler::removeSession(int sessionId)
+void SocketHandler::setScreenBlanked(bool blanked)
 {
-    if (!(m_idMap.keys().contains(sessionId))) {
-        sensordLogW() << "[SocketHandler]: Trying to remove nonexistent session.";
-        return false;
+    if (!inOwnThread()) {
+        QMetaObject::invokeMethod(this, "setScreenBlanked", Qt::BlockingQueuedConnection, Q_ARG(bool, blanked));
+        return;
     }
-
-    QLocalSocket* socket = (*m_idMap.find(sessionId))->stealSocket();
-
-    if (socket) {
-        disconnect(socket, SIGNAL(readyRead()), this, SLOT(socketReadable()));
-        disconnect(socket, SIGNAL(disconnected()), this, SLOT(socketDisconnected()));
-        disconnect(socket, SIGNAL(error(QLocalSocket::LocalSocketError)), this, SLOT(socketError(QLocalSocket::LocalSocketError)));
-        socket->deleteLater();
+    m_standbyBufferSize = 0;
+    m_standbyBufferInterval = 0;
+    if (blanked && Config::configuration()) {
+        m_standbyBufferSize = Config::configuration()->value<unsigned int>("global/screen_off_buffer_size", 0);
+        m_standbyBufferInterval = Config::configuration()->value<unsigned int>("global/screen_off_buffer_interval", 1000);
     }
-
-    delete m_idMap.take(sessionId);
-
-    return true;
+    sensordLogD() << "[SocketHandler]: Screen " << (blanked ? "blanked" : "unblanked") << ", batching " << m_standbyBufferSize << " samples";
+    for (QHash<int, SessionData*>::iterator it = m_idMap.begin(); it != m_idMap.end(); ++it)
+        (*it)->setStandbyBatching(m_standbyBufferSize, m_standbyBufferInterval);
 }
 
-void SocketHandler::newConnection()
+void SocketHandler::setPowerSave(bool enabled, const QStringList& wakeupChannels)
 {
-    sensordLogT() << "[SocketHandler]: New connection received.";
+    if (!inOwnThread()) {
+        QMetaObject::invokeMethod(this, "setPowerSave", Qt::BlockingQueuedConnection,
+                                  Q_ARG(bool, enabled), Q_ARG(QStringList, wakeupChannels));
+        return;
+    }
+    m_deferSize = 0;
+    m_wakeupChannels = wakeupChannels;
+    if (enabled && Config::configuration())
+        m_deferSize = Config::configuration()->value<unsigned int>("global/psm_defer_samples", 0);
+    sensordLogD() << "[SocketHandler]: Power save " << (enabled ? "enabled" : "disabled") << ", deferring " << m_deferSize << " samples";
+    for (QHash<int, SessionData*>::iterator it = m_idMap.begin(); it != m_idMap.end(); ++it)
+        applyDeferral(it.key(), *it);
+}
 
-    while (m_server->hasPendingConnections()) {
+void SocketHandler::applyDeferral(int sessionId, SessionData* session)
+{
+    bool wakeup = m_wakeupChannels.contains(m_sessionChannels.value(sessionId));
+    session->setDeferred(wakeup ? 0 : m_deferSize);
+}
 
-        QLocalSocket* socket = m_server->nextPendingConnection();
-        connect(socket, SIGNAL(readyRead()), this, SLOT(socketReadable()));
-        connect(socket, SIGNAL(disconnected()), this, SLOT(socketDisconnected()));
-        connect(socket, SIGNAL(error(QLocalSocket::LocalSocketError)), this, SLOT(socketError(QLocalSocket::LocalSocketError)));
+void SocketHandler::wakeupWritten(SessionData* session)
+{
+    if (!m_deferSize || session->isDeferred())
+        return;
+    // System is awake for this client anyway, deliver what others hold
+    for (QHash<int, SessionData*>::iterator it = m_idMap.begin(); it != m_idMap.end(); ++it)
+        (*it)->flushDeferred();
+}
 
-        // Initialize socket
-        socket->write("\n", 1);
-        socket->waitForBytesWritten();
+void SocketHandler::watchConsumption(int period)
+{
+    if (!inOwnThread()) {
+        QMetaObject::invokeMethod(this, "watchConsumption", Qt::BlockingQueuedConnection, Q_ARG(int, period));
+        return;
+    }
+    if (!m_consumptionTimer) {
+        m_consumptionTimer = new QTimer(this);
+        connect(m_consumptionTimer, SIGNAL(timeout()), this, SLOT(checkConsumption()));
     }
+    m_backlogs.clear();
+    if (period > 0)
+        m_consumptionTimer->start(period);
+    else
+        m_consumptionTimer->stop();
 }
 
-void SocketHandler::socketReadable()
+void SocketHandler::checkConsumption()
 {
-    int sessionId = -1;
-    QLocalSocket* socket = (QLocalSocket*)sender();
-    ((QLocalSocket*)sender())->read((char*)&sessionId, sizeof(int));
-
-    disconnect(socket, SIGNAL(readyRead()), this, SLOT(socketReadable()));
+    for (QHash<int, SessionData*>::const_iterator it = m_idMap.constBegin(); it != m_idMap.constEnd(); ++it) {
+        // Ring sessions overwrite old samples instead of queueing them
+        if ((*it)->getSharedRing())
+            continue;
+        qint64 backlog = (*it)->backlog();
+        qint64 previous = m_backlogs.value(it.key(), 0);
+        m_backlogs.insert(it.key(), backlog);
+        if (previous && backlog > previous) {
+            m_congested.insert(it.key());
+            emit sessionCongested(it.key(), true);
+        } else if (!backlog && m_congested.remove(it.key())) {
+            emit sessionCongested(it.key(), false);
+        }
+    }
+}
 
-    if (sessionId >= 0) {
-        if(!m_idMap.contains(sessionId))
-            m_idMap.insert(sessionId, new SessionData((QLocalSocket*)sender(), this));
-    } else {
-        sensordLogC() << "[SocketHandler]: Failed to read valid session ID from client. Closing socket.";
-        socket->abort();
+void SocketHandler::setSessionChannel(int sessionId, const QString& channel)
+{
+    if (!inOwnThread()) {
+        QMetaObject::invokeMethod(this, "setSessionChannel", Qt::BlockingQueuedConnection, Q_ARG(int, sessionId), Q_ARG(QString, channel));
+        return;
     }
+    m_sessionChannels.insert(sessionId, channel);
 }
 
 void SocketHandler::socketDisconnected()
 {
     QLocalSocket* socket = (QLocalSocket*)sender();
 
-    int sessionId = -1;
-    for(QMap<int, SessionData*>::const_iterator it = m_idMap.constBegin(); it != m_idMap.constEnd(); ++it)
-    {
-        if(it.value()->getSocket() == socket)
-            sessionId = it.key();
+    if (m_packetSockets.remove(socket)) {
+        socket->deleteLater();
+        return;
+    }
+
+    if (m_controls.contains(socket)) {
+        sensordLogD() << "[SocketHandler]: Control connection " << m_controls.value(socket) << " closed";
+        removeControl(socket);
+        return;
     }
 
-    if (sessionId == -1) {
+    // Multiplexed connection carries several sessions
+    QList<int> sessionIds = m_socketSessions.values(socket);
+
+    if (sessionIds.isEmpty()) {
         sensordLogW() << "[SocketHandler]: Noticed lost session, but can't find it.";
         return;
     }
 
-    sensordLogW() << "[SocketHandler]: Noticed lost session: " << sessionId;
-    emit lostSession(sessionId);
+    foreach (int sessionId, sessionIds) {
+        sensordLogW() << "[SocketHandler]: Noticed lost session: " << sessionId;
+        emit lostSession(sessionId);
+    }
 }
 
 void SocketHandler::socketError(QLocalSocket::LocalSocketError socketError)
@@ -346,9 +1841,20 @@ void SocketHandler::socketError(QLocalSocket::LocalSocketError socketError)
     socketDisconnected();
 }
 
+bool SocketHandler::inOwnThread() const
+{
+    return QThread::currentThread() == thread();
+}
+
 int SocketHandler::getSocketFd(int sessionId) const
 {
-    QMap<int, SessionData*>::const_iterator it = m_idMap.find(sessionId);
+    if (!inOwnThread()) {
+        int value = 0;
+        QMetaObject::invokeMethod(const_cast<SocketHandler*>(this), "getSocketFd", Qt::BlockingQueuedConnection,
+                                  Q_RETURN_ARG(int, value), Q_ARG(int, sessionId));
+        return value;
+    }
+    QHash<int, SessionData*>::const_iterator it = m_idMap.find(sessionId);
     if (it != m_idMap.end() && (*it)->getSocket())
         return (*it)->getSocket()->socketDescriptor();
     return 0;
@@ -356,21 +1862,35 @@ int SocketHandler::getSocketFd(int sessionId) const
 
 void SocketHandler::setInterval(int sessionId, int value)
 {
-    QMap<int, SessionData*>::iterator it = m_idMap.find(sessionId);
+    if (!inOwnThread()) {
+        QMetaObject::invokeMethod(this, "setInterval", Qt::BlockingQueuedConnection, Q_ARG(int, sessionId), Q_ARG(int, value));
+        return;
+    }
+    QHash<int, SessionData*>::iterator it = m_idMap.find(sessionId);
     if (it != m_idMap.end())
         (*it)->setInterval(value);
 }
 
 void SocketHandler::clearInterval(int sessionId)
 {
-    QMap<int, SessionData*>::iterator it = m_idMap.find(sessionId);
+    if (!inOwnThread()) {
+        QMetaObject::invokeMethod(this, "clearInterval", Qt::BlockingQueuedConnection, Q_ARG(int, sessionId));
+        return;
+    }
+    QHash<int, SessionData*>::iterator it = m_idMap.find(sessionId);
     if (it != m_idMap.end())
         (*it)->setInterval(-1);
 }
 
 int SocketHandler::interval(int sessionId) const
 {
-    QMap<int, SessionData*>::const_iterator it = m_idMap.find(sessionId);
+    if (!inOwnThread()) {
+        int value = 0;
+        QMetaObject::invokeMethod(const_cast<SocketHandler*>(this), "interval", Qt::BlockingQueuedConnection,
+                                  Q_RETURN_ARG(int, value), Q_ARG(int, sessionId));
+        return value;
+    }
+    QHash<int, SessionData*>::const_iterator it = m_idMap.find(sessionId);
     if (it != m_idMap.end())
         return (*it)->getInterval();
     return 0;
@@ -378,7 +1898,11 @@ int SocketHandler::interval(int sessionId) const
 
 void SocketHandler::setBufferSize(int sessionId, unsigned int value)
 {
-    QMap<int, SessionData*>::iterator it = m_idMap.find(sessionId);
+    if (!inOwnThread()) {
+        QMetaObject::invokeMethod(this, "setBufferSize", Qt::BlockingQueuedConnection, Q_ARG(int, sessionId), Q_ARG(unsigned int, value));
+        return;
+    }
+    QHash<int, SessionData*>::iterator it = m_idMap.find(sessionId);
     if (it != m_idMap.end())
         (*it)->setBufferSize(value);
 }
@@ -390,7 +1914,13 @@ void SocketHandler::clearBufferSize(int sessionId)
 
 unsigned int SocketHandler::bufferSize(int sessionId) const
 {
-    QMap<int, SessionData*>::const_iterator it = m_idMap.find(sessionId);
+    if (!inOwnThread()) {
+        unsigned int value = 0;
+        QMetaObject::invokeMethod(const_cast<SocketHandler*>(this), "bufferSize", Qt::BlockingQueuedConnection,
+                                  Q_RETURN_ARG(unsigned int, value), Q_ARG(int, sessionId));
+        return value;
+    }
+    QHash<int, SessionData*>::const_iterator it = m_idMap.find(sessionId);
     if (it != m_idMap.end())
         return (*it)->getBufferSize();
     return 0;
@@ -398,7 +1928,11 @@ unsigned int SocketHandler::bufferSize(int sessionId) const
 
 void SocketHandler::setBufferInterval(int sessionId, unsigned int value)
 {
-    QMap<int, SessionData*>::iterator it = m_idMap.find(sessionId);
+    if (!inOwnThread()) {
+        QMetaObject::invokeMethod(this, "setBufferInterval", Qt::BlockingQueuedConnection, Q_ARG(int, sessionId), Q_ARG(unsigned int, value));
+        return;
+    }
+    QHash<int, SessionData*>::iterator it = m_idMap.find(sessionId);
     if (it != m_idMap.end())
         (*it)->setBufferInterval(value);
 }
@@ -410,7 +1944,13 @@ void SocketHandler::clearBufferInterval(int sessionId)
 
 unsigned int SocketHandler::bufferInterval(int sessionId) const
 {
-    QMap<int, SessionData*>::const_iterator it = m_idMap.find(sessionId);
+    if (!inOwnThread()) {
+        unsigned int value = 0;
+        QMetaObject::invokeMethod(const_cast<SocketHandler*>(this), "bufferInterval", Qt::BlockingQueuedConnection,
+                                  Q_RETURN_ARG(unsigned int, value), Q_ARG(int, sessionId));
+        return value;
+    }
+    QHash<int, SessionData*>::const_iterator it = m_idMap.find(sessionId);
     if (it != m_idMap.end())
         return (*it)->getBufferInterval();
     return 0;
@@ -418,7 +1958,13 @@ unsigned int SocketHandler::bufferInterval(int sessionId) const
 
 bool SocketHandler::downsampling(int sessionId) const
 {
-    QMap<int, SessionData*>::const_iterator it = m_idMap.find(sessionId);
+    if (!inOwnThread()) {
+        bool value = false;
+        QMetaObject::invokeMethod(const_cast<SocketHandler*>(this), "downsampling", Qt::BlockingQueuedConnection,
+                                  Q_RETURN_ARG(bool, value), Q_ARG(int, sessionId));
+        return value;
+    }
+    QHash<int, SessionData*>::const_iterator it = m_idMap.find(sessionId);
     if (it != m_idMap.end())
         return (*it)->getBufferSize();
     return 0;
@@ -426,7 +1972,11 @@ bool SocketHandler::downsampling(int sessionId) const
 
 void SocketHandler::setDownsampling(int sessionId, bool value)
 {
-    QMap<int, SessionData*>::iterator it = m_idMap.find(sessionId);
+    if (!inOwnThread()) {
+        QMetaObject::invokeMethod(this, "setDownsampling", Qt::BlockingQueuedConnection, Q_ARG(int, sessionId), Q_ARG(bool, value));
+        return;
+    }
+    QHash<int, SessionData*>::iterator it = m_idMap.find(sessionId);
     if (it != m_idMap.end())
         (*it)->setBufferInterval(value);
 }
@@ -31,31 +31,128 @@
 #include <QObject>
 #include <QMap>
 #include <QTimer>
+#include "timerwheel.h"
 #include <QList>
+#include <QSet>
+#include <QHash>
+#include <QStringList>
 #include <QMutex>
 #include <QLocalSocket>
 #include <sys/time.h>
+#include <sys/uio.h>
 
 class QLocalServer;
+class QSocketNotifier;
+class SharedRing;
+class LatencyProbe;
+
+/**
+ * Pool of sample buffers shared by all sessions. Buffers are grouped in
+ * power of two size classes so sessions changing their sample or buffer
+ * size can reuse each others allocations.
+ */
+class SessionBufferPool
+{
+public:
+    /**
+     * Constructor.
+     */
+    SessionBufferPool();
+
+    /**
+     * Destructor. Frees all pooled buffers.
+     */
+    ~SessionBufferPool();
+
+    /**
+     * Get buffer of at least given size.
+     *
+     * @param size required size in bytes.
+     * @param capacity set to actual size of the returned buffer.
+     * @return buffer.
+     */
+    char* acquire(int size, int& capacity);
+
+    /**
+     * Return buffer to the pool.
+     *
+     * @param buffer buffer returned by #acquire(). NULL is ignored.
+     * @param capacity capacity returned by #acquire().
+     */
+    void release(char* buffer, int capacity);
+
+    /**
+     * Free all pooled buffers.
+     *
+     * @return freed bytes.
+     */
+    qint64 compact();
+
+private:
+    Q_DISABLE_COPY(SessionBufferPool)
+
+    static const int MIN_CLASS_SIZE = 64;  /**< smallest size class in bytes */
+    static const int CLASS_COUNT = 12;     /**< number of size classes */
+    static const int MAX_FREE_BUFFERS = 4; /**< max pooled buffers per class */
+
+    /**
+     * Find size class for given size.
+     *
+     * @param size required size in bytes.
+     * @param capacity set to size of the class.
+     * @return class index or -1 if size is too large to be pooled.
+     */
+    static int sizeClass(int size, int& capacity);
+
+    QList<char*> freeBuffers[CLASS_COUNT]; /**< free buffers per class */
+};
+
+/**
+ * Delivery cost of a session. Bytes handed to QLocalSocket are counted as
+ * written, with one write syscall, when they are handed over.
+ */
+struct SessionCost
+{
+    SessionCost() : samples(0), bytes(0), writes(0), cpuTime(0) {}
+
+    quint64 samples; /**< samples written to the socket or shared ring */
+    quint64 bytes;   /**< bytes written to the socket or shared ring */
+    quint64 writes;  /**< write syscalls */
+    quint64 cpuTime; /**< thread CPU time spent in the session, nanoseconds */
+};
 
 /**
  * Class contains data for single sensor session related data socket
- * connection.
+ * connection. Delayed writes are scheduled on the timer wheel of the
+ * SocketHandler.
  */
-class SessionData : public QObject
+class SessionData : public QObject, public TimerWheel::Entry
 {
     Q_OBJECT
     Q_DISABLE_COPY(SessionData)
 
 public:
+    /**
+     * What to do when client does not read data fast enough and more
+     * than high-water mark bytes are waiting to be written.
+     */
+    enum BackpressurePolicy
+    {
+        DropOldest = 0, /**< drop oldest queued frames */
+        DropNewest,     /**< drop the frame being written */
+        Coalesce        /**< replace queued frames with the latest sample */
+    };
+
     /**
      * Constructor.
      *
      * @param socket Established socket connection. SessionData will take
      *               the ownership of it.
+     * @param pool Pool for sample buffers. Must outlive the session.
+     * @param wheel Timer wheel for delayed writes. Must outlive the session.
      * @param parent Parent object.
      */
-    SessionData(QLocalSocket* socket, QObject* parent = 0);
+    SessionData(QLocalSocket* socket, SessionBufferPool* pool, TimerWheel* wheel, QObject* parent = 0);
 
     /**
      * Destructor.
@@ -71,6 +168,34 @@ public:
      */
     bool write(const void* source, int size);
 
+    /**
+     * Write batch of samples to socket. Samples are expected to be stored
+     * contiguously and to be of equal size. Unless sample buffering or
+     * downsampling is in use the whole batch is written with single
+     * socket write. With vectored writes enabled (global/socket_writev)
+     * the count header and samples are written with single sendmsg()
+     * without copying samples into a staging buffer.
+     *
+     * @param source Source from where to write.
+     * @param size Size of single sample in bytes.
+     * @param count How many samples to write.
+     * @return was data succesfully written.
+     */
+    bool write(const void* source, int size, unsigned int count);
+
+    /**
+     * Write batch of samples to socket as one frame, bypassing the shared
+     * ring, frame pacing, buffering and downsampling of the session.
+     * Used for history, which the client asked for as a whole. Samples
+     * buffered but not sent yet follow the frame.
+     *
+     * @param source Source from where to write.
+     * @param size Size of single sample in bytes.
+     * @param count How many samples to write.
+     * @return was data succesfully written.
+     */
+    bool writeHistory(const void* source, int size, unsigned int count);
+
     /**
      * Get used local socket pointer.
      *
@@ -131,6 +256,38 @@ public:
      */
     unsigned int getBufferInterval() const;
 
+    /**
+     * Batch samples while the screen is blanked. Buffer size and buffer
+     * interval are raised to at least the given values, and the
+     * requested ones are taken back into use when batching ends.
+     *
+     * @param size least buffer size, 0 ends batching.
+     * @param interval least buffer interval in milliseconds.
+     */
+    void setStandbyBatching(unsigned int size, unsigned int interval);
+
+    /**
+     * Hold samples while the system is in power save mode. Buffer size
+     * is raised to at least the given value and the buffer timer is not
+     * used, so samples are written only when the buffer fills or on
+     * #flushDeferred().
+     *
+     * @param size least buffer size, 0 ends deferring.
+     */
+    void setDeferred(unsigned int size);
+
+    /**
+     * Is delivery deferred.
+     *
+     * @return are samples held for #flushDeferred().
+     */
+    bool isDeferred() const;
+
+    /**
+     * Write out samples held by deferred delivery.
+     */
+    void flushDeferred();
+
     /**
      * Enable or disable downsampling. Downsampling is implemented by
      * just dropping extra samples.
@@ -146,14 +303,246 @@ public:
      */
     bool getDownsampling() const;
 
+    /**
+     * Pace delivery to display frames. Only the newest sample received
+     * during a frame is written, once per frame and lead microseconds
+     * before its vsync, i.e. at phase - lead + k * period on the
+     * monotonic clock. Buffering and downsampling settings do not apply
+     * to paced sessions.
+     *
+     * With extrapolation the written sample is predicted to the vsync
+     * time from the two newest samples. Sample is then taken to be its
+     * quint64 timestamp followed by 32-bit integer words, as in
+     * TimedXyzData; samples of other layouts are written as they are.
+     *
+     * @param period frame period in microseconds, 0 ends pacing.
+     * @param phase vsync time modulo period in microseconds.
+     * @param lead how long before vsync the sample is written, in microseconds.
+     * @param extrapolate predict the sample to the vsync time.
+     */
+    void setFramePacing(unsigned int period, unsigned int phase, unsigned int lead, bool extrapolate);
+
+    /**
+     * Get frame period.
+     *
+     * @return frame period in microseconds, 0 if delivery is not paced.
+     */
+    unsigned int getFramePeriod() const;
+
+    /**
+     * Deliver samples through shared memory ring instead of the socket.
+     * Every session has a ring of its own, since the samples of sessions
+     * of the same sensor differ by downsampling, thresholds and data
+     * range. Buffering and downsampling settings of the socket do not
+     * apply to ring sessions.
+     *
+     * @param ring Ring to write samples to. Ownership is not transferred.
+     * @param doorbell write ring write count to the socket after samples
+     *                 have been appended.
+     */
+    void setSharedRing(SharedRing* ring, bool doorbell);
+
+    /**
+     * Get used shared memory ring.
+     *
+     * @return ring or NULL if socket transport is used.
+     */
+    SharedRing* getSharedRing() const;
+
+    /**
+     * Deliver frames over socket shared with other sessions of the same
+     * client. Each frame is preceded by MultiplexedFrameHeader carrying
+     * the session ID. Socket is not owned by multiplexed sessions:
+     * it is deleted by SocketHandler when its last session is removed.
+     *
+     * @param sessionId Session ID written to frame headers.
+     */
+    void setMultiplexed(int sessionId);
+
+    /**
+     * Is the socket shared with other sessions.
+     *
+     * @return is multiplexed transport used.
+     */
+    bool isMultiplexed() const;
+
+    /**
+     * Write frames in compact encoding, see CompactFrame. Queued frames
+     * are kept plain and encoded when handed to the socket, so that
+     * backpressure can still drop and coalesce samples.
+     *
+     * @param value enable or disable compact encoding.
+     */
+    void setCompact(bool value);
+
+    /**
+     * Are frames written in compact encoding.
+     *
+     * @return is compact encoding used.
+     */
+    bool isCompact() const;
+
+    /**
+     * Socket is SOCK_SEQPACKET, see SeqPacketTransport. Every frame is
+     * sent as one message, whole or not at all. Frames the socket does
+     * not take are queued, and sent from a write notifier instead of
+     * through QLocalSocket which would join and split them.
+     *
+     * @param value enable or disable message framing.
+     */
+    void setPacket(bool value);
+
+    /**
+     * Is every frame sent as one message.
+     *
+     * @return is SeqPacketTransport used.
+     */
+    bool isPacket() const;
+
+    /**
+     * How many times buffer was reallocated while the client had not yet
+     * read all pending data, i.e. how many times waiting for slow client
+     * would have blocked the main loop.
+     *
+     * @return blocked reallocation count.
+     */
+    unsigned int getBlockedCount() const;
+
+    /**
+     * Set backpressure policy. Defaults are read from
+     * global/backpressure_policy ("drop-oldest", "drop-newest" or
+     * "coalesce") and global/backpressure_high_water.
+     *
+     * @param policy Policy to apply when high-water mark is exceeded.
+     * @param highWater Max bytes waiting to be written. 0 disables
+     *                  backpressure.
+     */
+    void setBackpressure(BackpressurePolicy policy, int highWater);
+
+    /**
+     * Get backpressure policy.
+     *
+     * @return backpressure policy.
+     */
+    BackpressurePolicy getBackpressurePolicy() const;
+
+    /**
+     * Get high-water mark.
+     *
+     * @return max bytes waiting to be written.
+     */
+    int getHighWater() const;
+
+    /**
+     * How many samples have been dropped because of backpressure.
+     *
+     * @return dropped sample count.
+     */
+    unsigned int getDroppedCount() const;
+
+    /**
+     * Shed load of the session: whatever backpressure is set, frames
+     * the client has not read are coalesced to the latest sample. Set by
+     * the overload controller, see OverloadController.
+     *
+     * @param value is load shed.
+     */
+    void setShedding(bool value);
+
+    /**
+     * Parse backpressure policy name.
+     *
+     * @param name policy name.
+     * @return policy, DropOldest for unknown names.
+     */
+    static BackpressurePolicy policyFromString(const QString& name);
+
+    /**
+     * Trace latency of samples when they are written to the socket or
+     * appended into the shared memory ring.
+     *
+     * @param probe probe or NULL to stop tracing.
+     */
+    void setLatencyProbe(LatencyProbe* probe);
+
+    /**
+     * Bytes written for the session which the client has not read yet.
+     *
+     * @return bytes waiting in the socket and in pending frames.
+     */
+    qint64 backlog() const;
+
+    /**
+     * Bytes allocated for sample and batch buffers of the session.
+     *
+     * @return allocated buffer bytes.
+     */
+    int bufferMemoryUsage() const;
+
+    /**
+     * Delivery cost of the session so far. CPU time covers buffering,
+     * downsampling and writing in the SocketHandler thread, and is
+     * measured when global/session_cpu_time is enabled.
+     *
+     * @return delivery cost.
+     */
+    const SessionCost& getCost() const;
+
+    /**
+     * Thread CPU time accounting of a session. Nested timers only count
+     * once, so entry points can be timed without knowing each other.
+     */
+    class CostTimer
+    {
+    public:
+        /**
+         * Start timing.
+         *
+         * @param session session the time is accounted to.
+         */
+        CostTimer(SessionData* session);
+
+        /**
+         * Stop timing and add the elapsed time to the session.
+         */
+        ~CostTimer();
+
+    private:
+        SessionData* session; /**< timed session or NULL when nested or disabled */
+        quint64 start;        /**< thread CPU time at start, nanoseconds */
+    };
+
 private:
     /**
-     * How many milliseconds since last time data was written to socket.
+     * How many microseconds since last time data was written to socket.
+     * With timestamp decimation the time is taken from the timestamps
+     * of the given and the last written sample, otherwise from the wall
+     * clock.
      *
-     * @return How many milliseconds since last time data was
+     * @param sample sample about to be written.
+     * @param size sample size in bytes.
+     * @return How many microseconds since last time data was
      *         written to socket.
      */
-    long sinceLastWrite() const;
+    qint64 sinceLastWrite(const void* sample, int size) const;
+
+    /**
+     * Remember when data was last written to socket.
+     *
+     * @param sample last written sample.
+     * @param size sample size in bytes.
+     */
+    void markWritten(const void* sample, int size);
+
+    /**
+     * Timestamp of a sample. Samples start with the monotonic timestamp
+     * of TimedData, samples without one are stamped with current time.
+     *
+     * @param sample sample.
+     * @param size sample size in bytes.
+     * @return timestamp in microseconds.
+     */
+    static quint64 sampleTimestamp(const void* sample, int size);
 
     /**
      * Write data directly to the socket.
@@ -164,6 +553,135 @@ private:
      */
     bool write(void* source, int size, unsigned int count);
 
+    /**
+     * Keep sample for the next frame of a paced session.
+     *
+     * @param source sample.
+     * @param size sample size in bytes.
+     * @return true.
+     */
+    bool writeFrameSample(const void* source, int size);
+
+    /**
+     * Write the newest sample of a paced session, extrapolated when
+     * requested.
+     *
+     * @return was writing to socket succesful.
+     */
+    bool flushFrame();
+
+    /**
+     * Schedule delivery for the next frame whose vsync is at least lead
+     * microseconds away.
+     */
+    void scheduleFrame();
+
+    /**
+     * Make sure batch buffer can hold given amount of bytes.
+     *
+     * @param size required size in bytes.
+     */
+    void reserveBatchBuffer(int size);
+
+    /**
+     * Get buffer for the current buffer size from the pool.
+     *
+     * @param size sample size in bytes.
+     */
+    void acquireBuffer(int size);
+
+    /**
+     * Write out buffered samples and return buffer to the pool.
+     */
+    void retireBuffer();
+
+    /**
+     * Write frame consisting of data slices to the socket with single
+     * sendmsg() call. If client is behind the frame is queued subject to
+     * backpressure policy.
+     *
+     * @param iov data slices.
+     * @param iovcnt number of slices.
+     * @param sampleSize size of single sample in the frame.
+     * @param samples number of samples in the frame.
+     * @return was data succesfully written or queued.
+     */
+    bool writeVectored(const struct iovec* iov, int iovcnt, int sampleSize, unsigned int samples);
+
+    /**
+     * Write data slices to the socket without blocking.
+     *
+     * @param iov data slices.
+     * @param iovcnt number of slices.
+     * @return bytes written or -1 on error.
+     */
+    ssize_t sendVectored(const struct iovec* iov, int iovcnt);
+
+    /**
+     * Queue frame applying backpressure policy.
+     *
+     * @param frame frame data.
+     * @param sampleSize size of single sample in the frame.
+     * @param samples number of samples in the frame.
+     */
+    void queueFrame(const QByteArray& frame, int sampleSize, unsigned int samples);
+
+    /**
+     * Append frame to pending frames and try to flush them.
+     *
+     * @param frame frame data.
+     * @param sampleSize size of single sample in the frame.
+     * @param samples number of samples in the frame.
+     */
+    void appendPending(const QByteArray& frame, int sampleSize, unsigned int samples);
+
+    /**
+     * Size of headers preceding samples of a frame.
+     *
+     * @return header size in bytes.
+     */
+    int frameHeaderSize() const;
+
+    /**
+     * Record latency of samples in a frame handed to the socket.
+     *
+     * @param iov frame slices, count header first.
+     * @param iovcnt number of slices.
+     * @param sampleSize size of single sample in the frame.
+     */
+    void traceFrame(const struct iovec* iov, int iovcnt, int sampleSize);
+
+    /**
+     * Encode plain frame into #compactFrame.
+     *
+     * @param iov plain frame slices, count header first.
+     * @param iovcnt number of slices.
+     * @param sampleSize size of single sample in the frame.
+     * @param samples number of samples in the frame.
+     * @param encoded set to the encoded frame.
+     */
+    void encodeFrame(const struct iovec* iov, int iovcnt, int sampleSize, unsigned int samples, struct iovec& encoded);
+
+    /**
+     * Frame waiting to be written.
+     */
+    struct PendingFrame
+    {
+        QByteArray data;      /**< frame data */
+        int sampleSize;       /**< size of single sample in the frame */
+        unsigned int samples; /**< number of samples in the frame */
+    };
+
+    /**
+     * Append samples into the shared memory ring.
+     *
+     * @param source Source from where to write.
+     * @param size Size of single sample in bytes.
+     * @param count How many samples to write.
+     * @return was data succesfully written.
+     */
+    bool writeSharedRing(const void* source, int size, unsigned int count);
+
     /**
      * Delayed write invocation.
      *
@@ -173,25 +691,95 @@ private:
 
     QLocalSocket* socket;        /**< socket pointer. */
     int interval;                /**< interval in milliseconds. */
+    SessionBufferPool* pool;     /**< buffer pool */
     char* buffer;                /**< pointer to buffer allocation. */
-    int size;                    /**< allocated buffer size. */
+    int bufferCapacity;          /**< allocated buffer size in bytes */
+    int size;                    /**< sample size of the buffer. */
     unsigned int count;          /**< how many elements are in the buffer */
-    struct timeval lastWrite;    /**< when data was written last time */
-    QTimer timer;                /**< timer for delayed write */
+    quint64 lastWrite;           /**< when data was written last time, Clock microseconds, 0 if never */
+    bool timestampDecimation;    /**< downsample by sample timestamps instead of the wall clock */
+    quint64 lastTimestamp;       /**< timestamp of the sample written last, 0 if none */
+    TimerWheel* wheel;           /**< timer wheel for delayed write */
     unsigned int bufferSize;     /**< buffer size */
     unsigned int bufferInterval; /**< buffer interval in milliseconds */
     bool downsampling;           /**< sample dropping */
+    char* batchBuffer;           /**< buffer for batched writes */
+    int batchBufferSize;         /**< allocated batch buffer size */
+    SharedRing* ring;            /**< shared memory ring or NULL */
+    bool doorbell;               /**< write ring doorbell to socket */
+    bool vectored;               /**< use vectored socket writes */
+    unsigned int blockedCount;   /**< reallocations with pending data */
+    QList<PendingFrame> pending; /**< frames waiting for the client */
+    qint64 pendingBytes;         /**< bytes in pending frames */
+    BackpressurePolicy policy;   /**< backpressure policy */
+    int highWater;               /**< max bytes waiting for the client */
+    unsigned int droppedCount;   /**< samples dropped by backpressure */
+    LatencyProbe* latencyProbe;  /**< socket latency probe or NULL */
+    int muxId;                   /**< session ID in frame headers or -1 */
+    bool compact;                /**< write frames in compact encoding */
+    QByteArray compactFrame;     /**< last encoded frame */
+    unsigned int requestedBufferSize;     /**< buffer size set by the client */
+    unsigned int requestedBufferInterval; /**< buffer interval set by the client */
+    unsigned int standbyBufferSize;       /**< least buffer size while screen is blanked, 0 if not batching */
+    unsigned int standbyBufferInterval;   /**< least buffer interval while screen is blanked */
+    unsigned int deferredSize;            /**< least buffer size while deferred, 0 if not deferred */
+    unsigned int framePeriod;             /**< frame period in microseconds, 0 if not paced */
+    unsigned int framePhase;              /**< vsync time modulo frame period in microseconds */
+    unsigned int frameLead;               /**< delivery time before vsync in microseconds */
+    bool frameExtrapolate;                /**< predict samples to vsync time */
+    quint64 frameTarget;                  /**< vsync time of the scheduled frame in microseconds */
+    QByteArray frameSample;               /**< newest sample of a paced session */
+    QByteArray framePrevious;             /**< sample before the newest one */
+    bool frameFresh;                      /**< has newest sample not been written yet */
+    SessionCost cost;                     /**< delivery cost */
+    bool costTiming;                      /**< measure CPU time of the session */
+    bool costTimed;                       /**< is a CostTimer running */
+    bool shedding;                        /**< coalesce unread frames to the latest sample */
+    bool packet;                          /**< socket preserves message boundaries */
+    QSocketNotifier* writeNotifier;       /**< writability of a packet socket, or NULL */
 
-private slots:
+    /**
+     * Apply requested buffering raised by standby batching.
+     */
+    void applyBuffering();
+
+    /**
+     * Watch a packet socket for room for the pending frames.
+     *
+     * @param enabled start or stop watching.
+     */
+    void watchWritable(bool enabled);
 
+protected:
     /**
      * Callback for delayed write timer.
      */
-    void timerTimeout();
+    void timeout();
+
+private slots:
+    /**
+     * Move pending frames to the socket when it has room.
+     */
+    void flushPending();
+
+    /**
+     * Socket has written data, continue with pending frames.
+     */
+    void socketWritten();
+
+    /**
+     * Packet socket has room, continue with pending frames.
+     */
+    void socketWritable();
 };
 
 /**
  * Establishes and track session data connections.
+ *
+ * SocketHandler may live in a dedicated writer thread. Control methods
+ * marked Q_INVOKABLE can be called from other threads, the calls are
+ * then forwarded to the owning thread and block until done. Writes must
+ * happen in the owning thread.
  */
 class SocketHandler : public QObject
 {
@@ -212,13 +800,24 @@ public:
     ~SocketHandler();
 
     /**
-     * Start to listen incoming connections.
+     * Start to listen incoming connections. Socket passed by systemd
+     * socket activation is used instead of creating one if present.
      *
      * @param serverName Name to listen for connections.
      * @return was listening started succesfully.
      */
     bool listen(const QString& serverName);
 
+    /**
+     * Start to listen SOCK_SEQPACKET connections on a second socket. Its
+     * clients must request SeqPacketTransport, every frame is then
+     * received as one message.
+     *
+     * @param path Filesystem path of the socket.
+     * @return was listening started succesfully.
+     */
+    bool listenPacket(const QString& path);
+
     /**
      * Write data to given session.
      *
@@ -228,13 +827,23 @@ public:
      */
     bool write(int id, const void* source, int size);
 
+    /**
+     * Write batch of equally sized samples to given session.
+     *
+     * @param id Session ID.
+     * @param source Location from where to write.
+     * @param size Size of single sample in bytes.
+     * @param count How many samples to write.
+     */
+    bool write(int id, const void* source, int size, unsigned int count);
+
     /**
      * Close related socket connection for session.
      *
      * @param sessionId Session ID.
      * @return was socket connection closed succesfully.
      */
-    bool removeSession(int sessionId);
+    Q_INVOKABLE bool removeSession(int sessionId);
 
     /**
      * Get socket file descriptor for given session.
@@ -242,7 +851,7 @@ public:
      * @param sessionId Session ID.
      * @return socket file descriptor.
      */
-    int getSocketFd(int sessionId) const;
+    Q_INVOKABLE int getSocketFd(int sessionId) const;
 
     /**
      * Set interval for given session. For more details see
@@ -251,14 +860,14 @@ public:
      * @param sessionId Session ID.
      * @param value Interval in milliseconds.
      */
-    void setInterval(int sessionId, int value);
+    Q_INVOKABLE void setInterval(int sessionId, int value);
 
     /**
      * Remove set interval from given session.
      *
      * @param sessionId Session ID.
      */
-    void clearInterval(int sessionId);
+    Q_INVOKABLE void clearInterval(int sessionId);
 
     /**
      * Get interval for given session. For more details see
@@ -267,7 +876,7 @@ public:
      * @param sessionId Session ID.
      * @return interval in milliseconds.
      */
-    int interval(int sessionId) const;
+    Q_INVOKABLE int interval(int sessionId) const;
 
     /**
      * Set buffer size for given session. For more details see
@@ -276,7 +885,7 @@ public:
      * @param sessionId Session ID.
      * @param value buffer size.
      */
-    void setBufferSize(int sessionId, unsigned int value);
+    Q_INVOKABLE void setBufferSize(int sessionId, unsigned int value);
 
     /**
      * Remove set buffer size for given session.
@@ -292,7 +901,7 @@ public:
      * @param sessionId Session ID.
      * @return buffer size.
      */
-    unsigned int bufferSize(int sessionId) const;
+    Q_INVOKABLE unsigned int bufferSize(int sessionId) const;
 
     /**
      * Set buffer interval for given session. For more details see
@@ -301,7 +910,7 @@ public:
      * @param sessionId Session ID.
      * @param value buffer inteval in milliseconds.
      */
-    void setBufferInterval(int sessionId, unsigned int value);
+    Q_INVOKABLE void setBufferInterval(int sessionId, unsigned int value);
 
     /**
      * Remove set buffer inteval for given session.
@@ -317,7 +926,7 @@ public:
      * @param sessionId Session ID.
      * @return interval in milliseconds.
      */
-    unsigned int bufferInterval(int sessionId) const;
+    Q_INVOKABLE unsigned int bufferInterval(int sessionId) const;
 
     /**
      * Is downsampling enabled for given session. For more details see
@@ -326,7 +935,7 @@ public:
      * @param sessionId Session ID.
      * @return is downsampling enabled.
      */
-    bool downsampling(int sessionId) const;
+    Q_INVOKABLE bool downsampling(int sessionId) const;
 
     /**
      * Set downsampling for given session. For more details see
@@ -335,7 +944,162 @@ public:
      * @param sessionId Session ID.
      * @param value downsampling state.
      */
-    void setDownsampling(int sessionId, bool value);
+    Q_INVOKABLE void setDownsampling(int sessionId, bool value);
+
+    /**
+     * Batch samples of all sessions while the screen is blanked, see
+     * #SessionData::setStandbyBatching(). Buffer size and interval are
+     * read from global/screen_off_buffer_size and
+     * global/screen_off_buffer_interval. Batching is disabled if the
+     * size is 0.
+     *
+     * @param blanked is the screen blanked.
+     */
+    Q_INVOKABLE void setScreenBlanked(bool blanked);
+
+    /**
+     * Defer delivery of sessions while the system is in power save mode,
+     * see #SessionData::setDeferred(). Sessions of wakeup channels are
+     * written as usual, and each write to them flushes the deferred
+     * sessions too. Held sample count is read from
+     * global/psm_defer_samples, 0 disables deferring.
+     *
+     * @param enabled is power save mode enabled.
+     * @param wakeupChannels sensor channels delivered without deferring.
+     */
+    Q_INVOKABLE void setPowerSave(bool enabled, const QStringList& wakeupChannels);
+
+    /**
+     * Watch how clients consume data. Backlog of each socket session is
+     * sampled periodically, and #sessionCongested() is emitted when it
+     * has grown over two samples, or when a congested session has read
+     * everything.
+     *
+     * @param period sampling period in milliseconds, 0 stops watching.
+     */
+    Q_INVOKABLE void watchConsumption(int period);
+
+    /**
+     * Associate session with sensor channel.
+     *
+     * @param sessionId Session ID.
+     * @param channel Sensor channel name.
+     */
+    Q_INVOKABLE void setSessionChannel(int sessionId, const QString& channel);
+
+    /**
+     * How many times slow client would have blocked the main loop on
+     * buffer reallocation. For more details see
+     * #SessionData::getBlockedCount().
+     *
+     * @return blocked reallocation count over all sessions.
+     */
+    Q_INVOKABLE unsigned int blockedCount() const;
+
+    /**
+     * Bytes allocated for buffers of given session. For more details see
+     * #SessionData::bufferMemoryUsage().
+     *
+     * @param sessionId Session ID.
+     * @return allocated buffer bytes.
+     */
+    Q_INVOKABLE qint64 bufferMemoryUsage(int sessionId) const;
+
+    /**
+     * Free sample buffers pooled for future sessions, see
+     * SessionBufferPool::compact().
+     *
+     * @return freed bytes.
+     */
+    Q_INVOKABLE qint64 compactBuffers();
+
+    /**
+     * Bytes written for given session which the client has not read
+     * yet. For more details see #SessionData::backlog().
+     *
+     * @param sessionId Session ID.
+     * @return bytes waiting to be read.
+     */
+    Q_INVOKABLE qint64 backlog(int sessionId) const;
+
+    /**
+     * Delivery cost of given session. For more details see
+     * #SessionData::getCost().
+     *
+     * @param sessionId Session ID.
+     * @return delivery cost, zero for unknown sessions.
+     */
+    Q_INVOKABLE SessionCost sessionCost(int sessionId) const;
+
+    /**
+     * Set backpressure policy for given session. For more details see
+     * #SessionData::setBackpressure().
+     *
+     * @param sessionId Session ID.
+     * @param policy Backpressure policy.
+     * @param highWater Max bytes waiting to be written.
+     */
+    Q_INVOKABLE void setBackpressure(int sessionId, SessionData::BackpressurePolicy policy, int highWater);
+
+    /**
+     * Shed load of given session. For more details see
+     * #SessionData::setShedding().
+     *
+     * @param sessionId Session ID.
+     * @param value is load shed.
+     */
+    Q_INVOKABLE void setShedding(int sessionId, bool value);
+
+    /**
+     * Pace delivery of given session to display frames. For more details
+     * see #SessionData::setFramePacing().
+     *
+     * @param sessionId Session ID.
+     * @param period frame period in microseconds, 0 ends pacing.
+     * @param phase vsync time modulo period in microseconds.
+     * @param lead how long before vsync the sample is written, in microseconds.
+     * @param extrapolate predict the sample to the vsync time.
+     */
+    Q_INVOKABLE void setFramePacing(int sessionId, unsigned int period, unsigned int phase, unsigned int lead, bool extrapolate);
+
+    /**
+     * How many samples have been dropped for given session because of
+     * backpressure.
+     *
+     * @param sessionId Session ID.
+     * @return dropped sample count.
+     */
+    Q_INVOKABLE unsigned int droppedCount(int sessionId) const;
+
+    /**
+     * How many samples have been dropped for sessions of given channel
+     * because of backpressure.
+     *
+     * @param channel Sensor channel name.
+     * @return dropped sample count.
+     */
+    Q_INVOKABLE unsigned int droppedCount(const QString& channel) const;
+
+    /**
+     * Write reply to a control connection, see ControlTransport.
+     * Replies to closed connections are dropped.
+     *
+     * @param connection control connection.
+     * @param reply reply without line feed.
+     */
+    Q_INVOKABLE void controlReply(int connection, const QByteArray& reply);
+
+    /**
+     * Write history samples to given session as one frame, see
+     * SessionData::writeHistory(). Unlike write() it can be called from
+     * other threads.
+     *
+     * @param sessionId Session ID.
+     * @param samples Contiguous samples.
+     * @param size Size of single sample in bytes.
+     * @return was data succesfully written.
+     */
+    Q_INVOKABLE bool writeHistory(int sessionId, const QByteArray& samples, int size);
 
 Q_SIGNALS:
     /**
@@ -346,12 +1110,35 @@ Q_SIGNALS:
      */
     void lostSession(int sessionId);
 
+    /**
+     * Signal is emitted when client of a session falls behind, and when
+     * it has caught up. See #watchConsumption().
+     *
+     * @param sessionId Session ID.
+     * @param congested is the client falling behind.
+     */
+    void sessionCongested(int sessionId, bool congested);
+
+    /**
+     * Signal is emitted for every request line read from a control
+     * connection. Reply with #controlReply().
+     *
+     * @param connection control connection.
+     * @param line request without line feed.
+     */
+    void controlRequest(int connection, const QByteArray& line);
+
 private slots:
     /**
      * Callback for new client connection.
      */
     void newConnection();
 
+    /**
+     * Callback for new connections to the packet socket.
+     */
+    void newPacketConnection();
+
     /**
      * Callback for new data in socket.
      */
@@ -369,10 +1156,153 @@ private slots:
      */
     void socketError(QLocalSocket::LocalSocketError socketError);
 
+    /**
+     * Compare backlog of sessions to the previous check, see
+     * #watchConsumption().
+     */
+    void checkConsumption();
+
 private:
 
-    QLocalServer*            m_server; /**< listening server socket. */
-    QMap<int, SessionData*>  m_idMap;  /**< map of client sessions. */
+    /**
+     * Is the caller running in the thread owning SocketHandler.
+     *
+     * @return true if in owning thread.
+     */
+    bool inOwnThread() const;
+
+    /**
+     * Handle shared memory transport request of a session. Reply with
+     * ring file descriptor or refusal.
+     *
+     * @param sessionId Session ID.
+     * @param transport requested transport.
+     */
+    void setupSharedRing(int sessionId, int transport);
+
+    /**
+     * Handle multiplexed transport request of the first session of a
+     * connection. Reply with acceptance or refusal.
+     *
+     * @param sessionId Session ID.
+     */
+    void setupMultiplexed(int sessionId);
+
+    /**
+     * Handle compact transport request of a session. Reply with
+     * acceptance or refusal.
+     *
+     * @param sessionId Session ID.
+     */
+    void setupCompact(int sessionId);
+
+    /**
+     * Accept SeqPacketTransport of a session connected to the packet
+     * socket.
+     *
+     * @param sessionId Session ID.
+     */
+    void setupPacket(int sessionId);
+
+    /**
+     * Bring up an accepted connection: watch it and write the greeting.
+     *
+     * @param socket new connection.
+     */
+    void greetConnection(QLocalSocket* socket);
+
+    /**
+     * Handle control transport request. Reply with acceptance or
+     * refusal.
+     *
+     * @param socket control connection.
+     */
+    void setupControl(QLocalSocket* socket);
+
+    /**
+     * Emit requests read from a control connection.
+     *
+     * @param socket control connection.
+     */
+    void readControl(QLocalSocket* socket);
+
+    /**
+     * Close control connection.
+     *
+     * @param socket control connection.
+     */
+    void removeControl(QLocalSocket* socket);
+
+    /**
+     * Add sessions registered on a multiplexed connection.
+     *
+     * @param socket multiplexed connection.
+     */
+    void readRegistrations(QLocalSocket* socket);
+
+    /**
+     * Create session using given socket.
+     *
+     * @param sessionId Session ID.
+     * @param socket data connection.
+     * @return created session or NULL if the session already exists.
+     */
+    SessionData* addSession(int sessionId, QLocalSocket* socket);
+
+    /**
+     * Is the socket used by any session.
+     *
+     * @param socket data connection.
+     * @return is socket in use.
+     */
+    bool socketInUse(QLocalSocket* socket) const;
+
+    /**
+     * Delete shared memory ring of a session.
+     *
+     * @param sessionId Session ID.
+     */
+    void releaseSharedRing(int sessionId);
+
+    /**
+     * Apply deferred delivery of power save mode to a session.
+     *
+     * @param sessionId Session ID.
+     * @param session Session data.
+     */
+    void applyDeferral(int sessionId, SessionData* session);
+
+    /**
+     * Write out samples held by deferred sessions after a write to
+     * given session, if it is not deferred itself.
+     *
+     * @param session Session written to.
+     */
+    void wakeupWritten(SessionData* session);
+
+    QLocalServer*                m_server;          /**< listening server socket. */
+    int                          m_packetServer;    /**< listening SOCK_SEQPACKET socket or -1 */
+    QSocketNotifier*             m_packetNotifier;  /**< connections to m_packetServer, or NULL */
+    QSet<QLocalSocket*>          m_packetSockets;   /**< SOCK_SEQPACKET connections before handshake */
+    QHash<int, SessionData*>      m_idMap;           /**< map of client sessions. */
+    QMap<int, QString>           m_sessionChannels; /**< sensor channel of sessions */
+    QMap<int, SharedRing*>       m_rings;           /**< shared memory rings of sessions */
+    QSet<QLocalSocket*>          m_muxSockets;      /**< multiplexed connections */
+    QMultiHash<QLocalSocket*, int> m_socketSessions; /**< sessions by connection */
+    QHash<QLocalSocket*, int>    m_controls;        /**< control connections and their IDs */
+    int                          m_lastControl;     /**< last control connection ID */
+    unsigned int                 m_standbyBufferSize; /**< least buffer size while screen is blanked, 0 if not batching */
+    unsigned int                 m_standbyBufferInterval; /**< least buffer interval while screen is blanked */
+    unsigned int                 m_deferSize;       /**< samples held in power save mode, 0 if not deferring */
+    QStringList                  m_wakeupChannels;  /**< channels not deferred in power save mode */
+    QTimer*                      m_consumptionTimer; /**< timer for checkConsumption() or NULL */
+    QHash<int, qint64>           m_backlogs;        /**< backlog of sessions at the previous check */
+    QSet<int>                    m_congested;       /**< sessions reported congested */
+    SessionBufferPool            m_bufferPool;      /**< sample buffers of sessions */
+    TimerWheel                   m_timerWheel;      /**< delayed writes of sessions, child so it follows moveToThread() */
+    unsigned int                 m_blockedCount;    /**< blocked count of removed sessions */
 };
 
+Q_DECLARE_METATYPE(SessionCost)
+
 #endif // SOCKETHANDLER_H
@@ -27,15 +27,18 @@
  */
 
 #include "source.h"
+#include "demand.h"
 
 bool SourceBase::join(SinkBase* sink)
 {
     joinTypeChecked(sink);
+    DemandNode::invalidate();
     return true;
 }
 
 bool SourceBase::unjoin(SinkBase* sink)
 {
     unjoinTypeChecked(sink);
+    DemandNode::invalidate();
     return true;
 }
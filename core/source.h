@@ -31,11 +31,51 @@
 
 #include "sink.h"
 #include "logging.h"
+#include "datatypes/atomic.h"
 #include <typeinfo>
-#include <QSet>
+#include <QAtomicInt>
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QVector>
 
 class SinkBase;
 
+/**
+ * Samples a source has propagated to one sink, see
+ * SourceBase::connections().
+ */
+struct SourceConnection
+{
+    SinkBase* sink;    /**< connected sink */
+    unsigned  samples; /**< samples propagated to the sink */
+    unsigned  batches; /**< propagate() calls which reached the sink */
+};
+
+/**
+ * Propagation counters of one sink of a source. A source is written by
+ * one thread at a time, so counters are updated without atomic
+ * read-modify-write; they are only read for status output.
+ */
+struct SourceCounters
+{
+    SourceCounters() : samples(0), batches(0) {}
+
+    /**
+     * Count a batch propagated to the sink.
+     *
+     * @param n samples in the batch.
+     */
+    void count(int n) const
+    {
+        Atomic::store(samples, Atomic::load(samples) + n);
+        Atomic::store(batches, Atomic::load(batches) + 1);
+    }
+
+    mutable QAtomicInt samples; /**< propagated samples */
+    mutable QAtomicInt batches; /**< propagated batches */
+};
+
 /**
  * Base-class for data source.
  */
@@ -58,6 +98,21 @@ public:
      */
     bool unjoin(SinkBase* sink);
 
+    /**
+     * Is any connected sink demanded, see DemandNode.
+     *
+     * @return does anything consume data of the source.
+     */
+    virtual bool demanded() const = 0;
+
+    /**
+     * Connected sinks with the samples propagated to each, for the
+     * dataflow graph, see DataflowGraph.
+     *
+     * @param connections list to append connections to.
+     */
+    virtual void connections(QList<SourceConnection>& connections) const = 0;
+
 protected:
     /**
      * Destructor.
@@ -83,7 +138,16 @@ private:
 };
 
 /**
- * Data source.
+ * Data source. Connected sinks are kept in a flat vector in join order,
+ * so propagation walks contiguous memory in deterministic order. The
+ * vector is modified only in #join() and #unjoin(), which may run in
+ * another thread than #propagate(). Propagation walks a snapshot of the
+ * implicitly shared vector taken under the topology lock, so a join
+ * detaches the vector instead of reallocating it under the walk. A sink
+ * unjoined meanwhile may still get the batch being propagated. Sinks
+ * without demand are skipped. Samples propagated to each sink are counted
+ * for the dataflow graph; counts of a batch in flight while the topology
+ * changes may be lost.
  *
  * @tparam TYPE type of data streamed from the source.
  */
@@ -99,17 +163,67 @@ public:
      */
     void propagate(int n, const TYPE* values)
     {
-        foreach (SinkTyped<TYPE>* sink, sinks_) {
-            sink->collect(n, values);
+        mutex_.lock();
+        const QVector<SinkTyped<TYPE>*> sinks(sinks_);
+        const QVector<SourceCounters> counters(counters_);
+        mutex_.unlock();
+        propagate(n, values, sinks.constData(), sinks.size(), counters.constData());
+    }
+
+    bool demanded() const
+    {
+        QMutexLocker locker(&mutex_);
+        for (int i = 0; i < sinks_.size(); ++i) {
+            if (sinks_.at(i)->demanded())
+                return true;
+        }
+        return false;
+    }
+
+    void connections(QList<SourceConnection>& connections) const
+    {
+        QMutexLocker locker(&mutex_);
+        for (int i = 0; i < sinks_.size(); ++i) {
+            SourceConnection connection;
+            connection.sink = sinks_.at(i);
+            connection.samples = Atomic::load(counters_.at(i).samples);
+            connection.batches = Atomic::load(counters_.at(i).batches);
+            connections.append(connection);
         }
     }
+
 private:
+    /**
+     * Propagate data to a snapshot of the connected sinks.
+     *
+     * @param n how many elements to stream.
+     * @param values source from where to stream data.
+     * @param sink first sink.
+     * @param count number of sinks.
+     * @param counters counters of the sinks, same order.
+     */
+    static void propagate(int n, const TYPE* values, SinkTyped<TYPE>* const* sink, int count,
+                          const SourceCounters* counters)
+    {
+        SinkTyped<TYPE>* const* end = sink + count;
+        for (; sink != end; ++sink, ++counters) {
+            if ((*sink)->demanded()) {
+                counters->count(n);
+                (*sink)->collect(n, values);
+            }
+        }
+    }
+
     bool joinTypeChecked(SinkBase* sink)
     {
         SinkTyped<TYPE>* type = dynamic_cast<SinkTyped<TYPE>*>(sink);
         if(type)
         {
-            sinks_.insert(type);
+            QMutexLocker locker(&mutex_);
+            if (!sinks_.contains(type)) {
+                sinks_.append(type);
+                counters_.append(SourceCounters());
+            }
             return true;
         }
         sensordLogC() << "Failed to join type '" << typeid(type).name() << " to source!";
@@ -121,14 +235,21 @@ private:
         SinkTyped<TYPE>* type = dynamic_cast<SinkTyped<TYPE>*>(sink);
         if(type)
         {
-            sinks_.remove(type);
+            QMutexLocker locker(&mutex_);
+            int index = sinks_.indexOf(type);
+            if (index >= 0) {
+                sinks_.remove(index);
+                counters_.remove(index);
+            }
             return true;
         }
         sensordLogC() << "Failed to unjoin type '" << typeid(type).name() << " from source!";
         return false;
     }
 
-    QSet<SinkTyped<TYPE>*> sinks_; /**< connected sinks. */
+    mutable QMutex            mutex_;    /**< topology lock, guards the vectors below */
+    QVector<SinkTyped<TYPE>*> sinks_;    /**< connected sinks in join order. */
+    QVector<SourceCounters>   counters_; /**< counters of sinks_, same order */
 };
 
 #endif
@@ -0,0 +1,227 @@
+/**
+   @file spscqueue.h
+   @brief SpscQueue
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <QAtomicInt>
+#include "datatypes/atomic.h"
+
+/**
+ * Preallocated bounded single-producer single-consumer queue for handing
+ * values of trivially copyable type from one thread to another without
+ * locks. Producer publishes slots with release semantics and consumer
+ * observes them with acquire semantics, so value contents written before
+ * #push() are visible after #pop() returns them.
+ *
+ * #push() reports when the queue was empty before the push. Consumer which
+ * sleeps on some wakeup primitive (eventfd, semaphore) must drain the queue
+ * until #pop() fails after each wakeup; then a wakeup is never lost.
+ *
+ * Large values can be filled and consumed in place with #reserve() and
+ * #commit() on the producer side and #front() and #pop() on the consumer
+ * side, which give the same guarantees.
+ *
+ * Capacity is rounded up to a power of two, so that slot positions stay
+ * continuous when the free-running counters wrap.
+ *
+ * @tparam TYPE queued value type.
+ */
+template <class TYPE>
+class SpscQueue
+{
+public:
+    /**
+     * Constructor.
+     *
+     * @param size how many values can be queued, rounded up to a power
+     *             of two.
+     * @param start initial value of the counters. Lets tests cross the
+     *              counter wrap without pushing 2^32 values.
+     */
+    SpscQueue(unsigned int size, unsigned int start = 0) :
+        size_(roundUpToPowerOfTwo(size)),
+        mask_(size_ - 1),
+        slots_(new TYPE[size_]),
+        writeCount_(start),
+        readCount_(start),
+        dropCount_(0)
+    {
+    }
+
+    /**
+     * Destructor.
+     */
+    ~SpscQueue()
+    {
+        delete[] slots_;
+    }
+
+    /**
+     * Push value into the queue. Producer side only.
+     *
+     * @param value value to queue.
+     * @param wakeup Set to true if queue was empty before the push and
+     *               consumer needs to be woken up.
+     * @return false if queue is full and value was dropped.
+     */
+    bool push(const TYPE& value, bool& wakeup)
+    {
+        wakeup = false;
+        TYPE* slot = reserve();
+        if (!slot)
+            return false;
+        *slot = value;
+        commit(wakeup);
+        return true;
+    }
+
+    /**
+     * Get the next free slot to fill in place. Producer side only. The
+     * slot is queued with #commit().
+     *
+     * @return free slot or NULL if queue is full; the value is then
+     *         counted as dropped.
+     */
+    TYPE* reserve()
+    {
+        unsigned int written = Atomic::load(writeCount_);
+        if (written - (unsigned int)Atomic::loadAcquire(readCount_) >= size_)
+        {
+            dropCount_.fetchAndAddRelaxed(1);
+            return 0;
+        }
+        return &slots_[written & mask_];
+    }
+
+    /**
+     * Queue the slot filled after #reserve(). Producer side only.
+     *
+     * @param wakeup Set to true if queue was empty before the commit and
+     *               consumer needs to be woken up.
+     */
+    void commit(bool& wakeup)
+    {
+        unsigned int written = Atomic::load(writeCount_);
+
+        // Full barrier: publishing the slot must be ordered before checking
+        // whether the consumer has already drained the queue. Paired with
+        // the barrier in pop() either the consumer sees the new slot or we
+        // see the empty queue and wake the consumer up.
+        writeCount_.fetchAndStoreOrdered(written + 1);
+        wakeup = ((unsigned int)Atomic::loadAcquire(readCount_) == written);
+    }
+
+    /**
+     * Take oldest value from the queue. Consumer side only.
+     *
+     * @param value location for the value.
+     * @return false if queue is empty.
+     */
+    bool pop(TYPE& value)
+    {
+        const TYPE* slot = front();
+        if (!slot)
+            return false;
+        value = *slot;
+        pop();
+        return true;
+    }
+
+    /**
+     * Get oldest value in place. Consumer side only. The value stays
+     * valid until #pop().
+     *
+     * @return oldest value or NULL if queue is empty.
+     */
+    const TYPE* front() const
+    {
+        unsigned int read = Atomic::load(readCount_);
+        if (read == (unsigned int)Atomic::loadAcquire(writeCount_))
+            return 0;
+        return &slots_[read & mask_];
+    }
+
+    /**
+     * Remove oldest value returned by #front(). Consumer side only.
+     */
+    void pop()
+    {
+        // Slot may be reused by the producer once the count is published
+        readCount_.fetchAndStoreOrdered(Atomic::load(readCount_) + 1);
+    }
+
+    /**
+     * How many values have been dropped because queue was full.
+     *
+     * @return dropped value count.
+     */
+    unsigned int dropCount() const
+    {
+        return Atomic::load(dropCount_);
+    }
+
+    /**
+     * How many values are waiting to be popped.
+     *
+     * @return queued value count.
+     */
+    unsigned int depth() const
+    {
+        return (unsigned int)Atomic::loadAcquire(writeCount_) - (unsigned int)Atomic::loadAcquire(readCount_);
+    }
+
+    /**
+     * How many values can be queued. Power of two.
+     *
+     * @return queue size.
+     */
+    unsigned int size() const
+    {
+        return size_;
+    }
+
+private:
+    Q_DISABLE_COPY(SpscQueue)
+
+    /**
+     * Smallest power of two not less than given size, at most 2^31.
+     *
+     * @param size requested size.
+     * @return rounded size.
+     */
+    static unsigned int roundUpToPowerOfTwo(unsigned int size)
+    {
+        unsigned int rounded = 1;
+        while (rounded < size && rounded < 0x80000000u)
+            rounded <<= 1;
+        return rounded;
+    }
+
+    const unsigned int size_;       /**< queue size, power of two */
+    const unsigned int mask_;       /**< size_ - 1 */
+    TYPE*              slots_;      /**< queue slots */
+    QAtomicInt         writeCount_; /**< how many values have been pushed */
+    QAtomicInt         readCount_;  /**< how many values have been popped */
+    QAtomicInt         dropCount_;  /**< how many values have been dropped */
+};
+
+#endif // SPSCQUEUE_H
@@ -0,0 +1,137 @@
+/**
+   @file startuptrace.cpp
+   @brief Timeline of sensord startup in Chrome trace format
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+
+#include "startuptrace.h"
+#include "logging.h"
+#include <QFile>
+#include <QMutexLocker>
+#include <stdio.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * Write text as JSON string.
+ */
+static QByteArray jsonString(const QString& text)
+{
+    QByteArray out("\"");
+    QByteArray utf8(text.toUtf8());
+    for (int i = 0; i < utf8.size(); ++i) {
+        char c = utf8.at(i);
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if ((unsigned char)c < 0x20) {
+            char escape[8];
+            snprintf(escape, sizeof(escape), "\\u%04x", (unsigned char)c);
+            out += escape;
+        } else {
+            out += c;
+        }
+    }
+    return out + '"';
+}
+
+StartupTrace& StartupTrace::instance()
+{
+    static StartupTrace trace;
+    return trace;
+}
+
+StartupTrace::StartupTrace() :
+    enabled_(false)
+{
+}
+
+void StartupTrace::start(const QString& path)
+{
+    path_ = path;
+    enabled_ = true;
+    mark("sensord", "start");
+}
+
+quint64 StartupTrace::now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+void StartupTrace::record(const char* category, const QString& name, quint64 start, quint64 end)
+{
+    append(category, name, start, end > start ? end - start : 0, false);
+}
+
+void StartupTrace::mark(const char* category, const QString& name)
+{
+    append(category, name, now(), 0, true);
+}
+
+void StartupTrace::append(const char* category, const QString& name, quint64 start, quint64 duration, bool instant)
+{
+    if (!enabled_)
+        return;
+    Event event;
+    event.category = category;
+    event.name = name;
+    event.start = start;
+    event.duration = duration;
+    event.tid = syscall(SYS_gettid);
+    event.instant = instant;
+    QMutexLocker locker(&mutex_);
+    events_.append(event);
+}
+
+bool StartupTrace::finish()
+{
+    if (!enabled_)
+        return false;
+    mark("sensord", "ready");
+    enabled_ = false;
+
+    QMutexLocker locker(&mutex_);
+    QByteArray pid(QByteArray::number(getpid()));
+    QByteArray json("{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    json += "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": " + pid + ", \"args\": {\"name\": \"sensord\"}}";
+    foreach (const Event& event, events_) {
+        json += ",\n{\"name\": " + jsonString(event.name) +
+                ", \"cat\": \"" + event.category + "\"" +
+                ", \"ts\": " + QByteArray::number(event.start) +
+                ", \"pid\": " + pid +
+                ", \"tid\": " + QByteArray::number(event.tid);
+        if (event.instant)
+            json += ", \"ph\": \"i\", \"s\": \"p\"}";
+        else
+            json += ", \"ph\": \"X\", \"dur\": " + QByteArray::number(event.duration) + "}";
+    }
+    json += "\n]}\n";
+
+    QFile file(path_);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || file.write(json) != json.size()) {
+        sensordLogW() << "Can not write startup trace " << path_ << ": " << file.errorString();
+        return false;
+    }
+    sensordLogD() << "Startup trace of " << events_.size() << " events written to " << path_;
+    events_.clear();
+    return true;
+}
@@ -0,0 +1,170 @@
+/**
+   @file startuptrace.h
+   @brief Timeline of sensord startup in Chrome trace format
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+
+#ifndef STARTUPTRACE_H
+#define STARTUPTRACE_H
+
+#include <QObject>
+#include <QList>
+#include <QMutex>
+#include <QString>
+
+/**
+ * Optional timeline of sensord startup: configuration loading, plugin
+ * loading, registration and initialization, adaptor probing, HAL
+ * opening and service registration are recorded as spans and written
+ * as a Chrome trace JSON file, viewable in chrome://tracing or Perfetto.
+ * Enabled with the --startup-trace=<path> command line option, so that
+ * configuration loading is covered too.
+ *
+ * Spans are recorded until #finish() writes the file once the event
+ * loop has run the work queued during startup. Later plugin loading is
+ * not recorded.
+ */
+class StartupTrace : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(StartupTrace)
+
+public:
+    /**
+     * Default trace.
+     *
+     * @return trace.
+     */
+    static StartupTrace& instance();
+
+    /**
+     * Start recording.
+     *
+     * @param path file the trace is written into.
+     */
+    void start(const QString& path);
+
+    /**
+     * Are spans recorded.
+     *
+     * @return is the trace recording.
+     */
+    bool isEnabled() const { return enabled_; }
+
+    /**
+     * Record a span.
+     *
+     * @param category span category, e.g. "plugin".
+     * @param name span name.
+     * @param start start time, monotonic microseconds.
+     * @param end end time, monotonic microseconds.
+     */
+    void record(const char* category, const QString& name, quint64 start, quint64 end);
+
+    /**
+     * Record a point in time.
+     *
+     * @param category event category.
+     * @param name event name.
+     */
+    void mark(const char* category, const QString& name);
+
+    /**
+     * Current time for spans.
+     *
+     * @return monotonic time in microseconds.
+     */
+    static quint64 now();
+
+public Q_SLOTS:
+    /**
+     * Stop recording and write the trace.
+     *
+     * @return was the trace written.
+     */
+    bool finish();
+
+private:
+    StartupTrace();
+
+    /**
+     * Recorded span or point.
+     */
+    struct Event
+    {
+        const char* category; /**< event category */
+        QString     name;     /**< event name */
+        quint64     start;    /**< monotonic microseconds */
+        quint64     duration; /**< microseconds */
+        int         tid;      /**< recording thread */
+        bool        instant;  /**< is the event a point */
+    };
+
+    /**
+     * Append event.
+     */
+    void append(const char* category, const QString& name, quint64 start, quint64 duration, bool instant);
+
+    volatile bool enabled_; /**< are events recorded */
+    QString       path_;    /**< output file */
+    QMutex        mutex_;   /**< guards events_ */
+    QList<Event>  events_;  /**< recorded events */
+};
+
+/**
+ * Records the lifetime of the object as a span of the startup trace.
+ * Does nothing when the trace is not recording.
+ */
+class StartupSpan
+{
+public:
+    /**
+     * Start span.
+     *
+     * @param category span category.
+     * @param name span name.
+     */
+    StartupSpan(const char* category, const QString& name) :
+        category_(category),
+        start_(0)
+    {
+        if (StartupTrace::instance().isEnabled()) {
+            name_ = name;
+            start_ = StartupTrace::now();
+        }
+    }
+
+    /**
+     * End span.
+     */
+    ~StartupSpan()
+    {
+        if (start_)
+            StartupTrace::instance().record(category_, name_, start_, StartupTrace::now());
+    }
+
+private:
+    Q_DISABLE_COPY(StartupSpan)
+
+    const char* category_; /**< span category */
+    QString     name_;     /**< span name */
+    quint64     start_;    /**< start time, 0 when not recording */
+};
+
+#endif // STARTUPTRACE_H
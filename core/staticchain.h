@@ -0,0 +1,197 @@
+/**
+   @file staticchain.h
+   @brief Filter pipelines composed at compile time
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef STATICCHAIN_H
+#define STATICCHAIN_H
+
+#include "filter.h"
+#include <QStringList>
+
+/**
+ * Names of the stages of a pipeline, in data flow order. A stage is a
+ * class providing:
+ *
+ * - typedefs Input and Output for the sample types,
+ * - static const char* name() for introspection,
+ * - template <class NEXT> void process(const Input& value, NEXT& next),
+ *   calling next(output) for every output sample.
+ *
+ * @tparam STAGE stage type.
+ */
+template <class STAGE>
+struct StageNames
+{
+    /**
+     * Append stage names.
+     *
+     * @param names list to append to.
+     */
+    static void append(QStringList& names)
+    {
+        names.append(QLatin1String(STAGE::name()));
+    }
+};
+
+/**
+ * Two stages joined at compile time. The output of the first one is
+ * handed to the second through an inlined call, so the pipeline has no
+ * buffers, joins or virtual calls between its stages. StaticChain is a
+ * stage itself, longer pipelines nest: StaticChain<A, StaticChain<B, C> >.
+ *
+ * @tparam FIRST first stage.
+ * @tparam SECOND second stage, taking the output of FIRST.
+ */
+template <class FIRST, class SECOND>
+class StaticChain
+{
+public:
+    typedef typename FIRST::Input   Input;  /**< input sample type */
+    typedef typename SECOND::Output Output; /**< output sample type */
+
+    /**
+     * First stage.
+     *
+     * @return stage.
+     */
+    FIRST& first() { return first_; }
+
+    /**
+     * Second stage.
+     *
+     * @return stage.
+     */
+    SECOND& second() { return second_; }
+
+    /**
+     * Run a sample through both stages.
+     *
+     * @param value input sample.
+     * @param next receiver of the output samples.
+     */
+    template <class NEXT>
+    void process(const Input& value, NEXT& next)
+    {
+        Link<NEXT> link(second_, next);
+        first_.process(value, link);
+    }
+
+private:
+    /**
+     * Passes output of the first stage to the second one.
+     */
+    template <class NEXT>
+    struct Link
+    {
+        Link(SECOND& stage, NEXT& next) : stage_(stage), next_(next) {}
+
+        void operator()(const typename FIRST::Output& value)
+        {
+            stage_.process(value, next_);
+        }
+
+        SECOND& stage_; /**< second stage */
+        NEXT&   next_;  /**< receiver of the pipeline output */
+    };
+
+    FIRST  first_;  /**< first stage */
+    SECOND second_; /**< second stage */
+};
+
+template <class FIRST, class SECOND>
+struct StageNames<StaticChain<FIRST, SECOND> >
+{
+    static void append(QStringList& names)
+    {
+        StageNames<FIRST>::append(names);
+        StageNames<SECOND>::append(names);
+    }
+};
+
+/**
+ * Filter running a pipeline of stages, see StaticChain. Whole batches
+ * go through the pipeline sample by sample and the output is propagated
+ * as one batch, so the filter joins Bin graphs like any other while
+ * its stages compile into a single loop.
+ *
+ * @tparam PIPE stage or StaticChain of stages.
+ */
+template <class PIPE>
+class StaticChainFilter : public Filter<typename PIPE::Input, StaticChainFilter<PIPE>, typename PIPE::Output>
+{
+public:
+    typedef typename PIPE::Input  Input;  /**< input sample type */
+    typedef typename PIPE::Output Output; /**< output sample type */
+
+    /**
+     * Constructor.
+     */
+    StaticChainFilter() :
+        Filter<Input, StaticChainFilter<PIPE>, Output>(this, &StaticChainFilter::filter)
+    {}
+
+    /**
+     * Pipeline of the filter.
+     *
+     * @return pipeline.
+     */
+    PIPE& pipe() { return pipe_; }
+
+    /**
+     * Names of the pipeline stages in data flow order.
+     *
+     * @return stage names.
+     */
+    QStringList stageNames() const
+    {
+        QStringList names;
+        StageNames<PIPE>::append(names);
+        return names;
+    }
+
+private:
+    /**
+     * Collects pipeline output into a batch.
+     */
+    struct Collect
+    {
+        Collect(FilterBatch<Output>& batch) : batch_(batch) {}
+
+        void operator()(const Output& value)
+        {
+            batch_.append(value);
+        }
+
+        FilterBatch<Output>& batch_; /**< output batch */
+    };
+
+    void filter(unsigned n, const Input* values)
+    {
+        FilterBatch<Output> batch;
+        Collect collect(batch);
+        for (unsigned i = 0; i < n; ++i)
+            pipe_.process(values[i], collect);
+        batch.propagate(this->source_);
+    }
+
+    PIPE pipe_; /**< pipeline */
+};
+
+#endif // STATICCHAIN_H
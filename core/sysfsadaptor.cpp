@@ -28,14 +28,57 @@
 
 #include "sysfsadaptor.h"
 #include <errno.h>
+#include <limits.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/prctl.h>
+#include <sys/timerfd.h>
+#include <time.h>
 #include <unistd.h>
 #include <QFile>
 #include "logging.h"
 #include "config.h"
+#include "clock.h"
+#include "datatypes/atomic.h"
+
+/** Largest file content handed to SysfsAdaptor::processData(), sysfs
+    attributes are limited to a page */
+static const int SYSFS_READ_SIZE = 4096;
+
+/** Most values of an assembled sample */
+static const int MAX_ASSEMBLED_VALUES = 16;
+
+/** Control pipe command: stop the reader thread */
+static const quint64 READER_STOP = 1;
+
+/** Control pipe command: interval has changed, re-arm the timer */
+static const quint64 READER_REARM = 2;
+
+/** Control pipe command: standby, close input files and idle */
+static const quint64 READER_PARK = 3;
+
+/** Control pipe command: resume, reopen input files */
+static const quint64 READER_UNPARK = 4;
+
+/** Adaptors handled per SysfsReactor wakeup */
+static const int REACTOR_MAX_EVENTS = 16;
+
+/** Back-off after an input error (ms) */
+static const int INPUT_ERROR_DELAY = 50;
+
+/** Back-off after a failed epoll_wait() (ms) */
+static const int POLL_FAILED_DELAY = 1000;
+
+/** Monotonic time in milliseconds */
+static quint64 monotonicMs()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000ULL + now.tv_nsec / 1000000;
+}
 
 SysfsAdaptor::SysfsAdaptor(const QString& id,
                            PollMode mode,
@@ -44,13 +87,25 @@ SysfsAdaptor::SysfsAdaptor(const QString& id,
                            const int pathId) :
     DeviceAdaptor(id),
     reader_(this),
+    shared_(false),
     mode_(mode),
     epollDescriptor_(-1),
+    timerDescriptor_(-1),
+    timerDeadline_(0),
+    timerPeriod_(0),
+    sampleTime_(0),
+    armedInterval_(0),
+    timerGrid_(0),
     interval_(0),
     inStandbyMode_(false),
+    parked_(false),
     running_(false),
     shouldBeRunning_(false),
-    doSeek_(seek)
+    doSeek_(seek),
+    positionalRead_(false),
+    assembled_(false),
+    payloadValues_(0),
+    valueFormat_(DecimalValues)
 {
     if (!path.isEmpty()) {
         addPath(path, pathId);
@@ -58,11 +113,19 @@ SysfsAdaptor::SysfsAdaptor(const QString& id,
 
     pipeDescriptors_[0] = -1;
     pipeDescriptors_[1] = -1;
+
+    int grid = Config::configuration()->value<int>("global/interval_grid", 0);
+    if (grid > 0)
+        timerGrid_ = grid * 1000000ULL;
 }
 
 SysfsAdaptor::~SysfsAdaptor()
 {
     stopAdaptor();
+    foreach (int fd, controlWriteFds_)
+        close(fd);
+    foreach (int fd, controlReadFds_)
+        close(fd);
 }
 
 bool SysfsAdaptor::addPath(const QString& path, const int id)
@@ -152,9 +215,10 @@ void SysfsAdaptor::stopSensor()
 
     entry->removeReference();
     if (entry->referenceCount() <= 0) {
-        if (!inStandbyMode_) {
+        if (!inStandbyMode_ || parked_) {
             stopReaderThread();
             closeAllFds();
+            parked_ = false;
         }
         entry->setIsRunning(false);
         running_ = false;
@@ -181,8 +245,13 @@ bool SysfsAdaptor::standby()
     }
 
     sensordLogD() << "Adaptor '" << id() << "' going to standby";
-    stopReaderThread();
-    closeAllFds();
+    // Reader stays parked on the control pipe, only input files are closed
+    if (signalReader(READER_PARK)) {
+        parked_ = true;
+    } else {
+        stopReaderThread();
+        closeAllFds();
+    }
 
     running_ = false;
 
@@ -208,6 +277,16 @@ bool SysfsAdaptor::resume()
 
     sensordLogD() << "Adaptor '" << id() << "' resuming from standby";
 
+    if (parked_) {
+        parked_ = false;
+        if (signalReader(READER_UNPARK)) {
+            running_ = true;
+            return true;
+        }
+        stopReaderThread();
+        closeAllFds();
+    }
+
     if (!startReaderThread()) {
         sensordLogW() << "Adaptor '" << id() << "' failed to resume from standby!";
         return false;
@@ -217,10 +296,13 @@ bool SysfsAdaptor::resume()
     return true;
 }
 
-bool SysfsAdaptor::openFds()
+bool SysfsAdaptor::concurrentPowerTransition() const
 {
-    QMutexLocker locker(&mutex_);
+    return true;
+}
 
+bool SysfsAdaptor::openSysfsFds()
+{
     int fd;
     for (int i = 0; i < paths_.size(); i++) {
         if ((fd = open(paths_.at(i).toLatin1().constData(), O_RDONLY)) == -1) {
@@ -228,31 +310,57 @@ bool SysfsAdaptor::openFds()
             return false;
         }
         sysfsDescriptors_.append(fd);
+        descriptorOpened(pathIds_.at(i), fd);
     }
 
-    // Set up epoll for select mode
-    if (mode_ == SelectMode) {
+    // Polled files are read from offset 0 every period, so the reads batch
+    if (mode_ == IntervalMode && doSeek_ &&
+        Config::configuration()->value<bool>("global/sysfs_io_uring", false)) {
+        if (uring_.open(sysfsDescriptors_.toVector(), SYSFS_READ_SIZE))
+            sensordLogD() << "Adaptor '" << id() << "' reads " << sysfsDescriptors_.size() << " file(s) through io_uring";
+    }
+    return true;
+}
 
-        if (pipe(pipeDescriptors_) == -1 ) {
-            sensordLogW() << "pipe(): " << strerror(errno);
-            return false;
+void SysfsAdaptor::closeSysfsFds()
+{
+    uring_.close();
+    while (!sysfsDescriptors_.empty()) {
+        if (sysfsDescriptors_.last() != -1) {
+            close(sysfsDescriptors_.last());
         }
+        sysfsDescriptors_.removeLast();
+    }
+}
 
-        if (fcntl(pipeDescriptors_[0], F_SETFD, FD_CLOEXEC) == -1) {
-            sensordLogW() << "fcntl(): " << strerror(errno);
-            return false;
-        }
+bool SysfsAdaptor::openFds()
+{
+    QMutexLocker locker(&mutex_);
 
-        // Set up epoll fd
-        if ((epollDescriptor_ = epoll_create(sysfsDescriptors_.size() + 1)) == -1) {
-            sensordLogW() << "epoll_create(): " << strerror(errno);
-            return false;
-        }
+    if (!openSysfsFds())
+        return false;
 
-        struct epoll_event ev;
-        memset(&ev, 0, sizeof(epoll_event));
-        ev.events  = EPOLLIN;
+    if (pipe(pipeDescriptors_) == -1 ) {
+        sensordLogW() << "pipe(): " << strerror(errno);
+        return false;
+    }
+
+    if (fcntl(pipeDescriptors_[0], F_SETFD, FD_CLOEXEC) == -1) {
+        sensordLogW() << "fcntl(): " << strerror(errno);
+        return false;
+    }
+
+    // Set up epoll fd
+    if ((epollDescriptor_ = epoll_create(sysfsDescriptors_.size() + 2)) == -1) {
+        sensordLogW() << "epoll_create(): " << strerror(errno);
+        return false;
+    }
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(epoll_event));
+    ev.events  = EPOLLIN;
 
+    if (mode_ == SelectMode) {
         // Set up epolling for the list
         for (int i = 0; i < sysfsDescriptors_.size(); ++i) {
             ev.data.fd = sysfsDescriptors_.at(i);
@@ -261,15 +369,26 @@ bool SysfsAdaptor::openFds()
                 return false;
             }
         }
-
-        // Add control pipe to poll list
-        ev.data.fd = pipeDescriptors_[0];
-        if (epoll_ctl(epollDescriptor_, EPOLL_CTL_ADD, pipeDescriptors_[0], &ev) == -1) {
+    } else {
+        // Interval mode is driven by a timer, armed by the reader thread
+        if ((timerDescriptor_ = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK)) == -1) {
+            sensordLogW() << "timerfd_create(): " << strerror(errno);
+            return false;
+        }
+        ev.data.fd = timerDescriptor_;
+        if (epoll_ctl(epollDescriptor_, EPOLL_CTL_ADD, timerDescriptor_, &ev) == -1) {
             sensordLogW() << "epoll_ctl(): " << strerror(errno);
             return false;
         }
     }
 
+    // Add control pipe to poll list
+    ev.data.fd = pipeDescriptors_[0];
+    if (epoll_ctl(epollDescriptor_, EPOLL_CTL_ADD, pipeDescriptors_[0], &ev) == -1) {
+        sensordLogW() << "epoll_ctl(): " << strerror(errno);
+        return false;
+    }
+
     return true;
 }
 
@@ -283,6 +402,12 @@ void SysfsAdaptor::closeAllFds()
         epollDescriptor_ = -1;
     }
 
+    /* Timer */
+    if (timerDescriptor_ != -1) {
+        close(timerDescriptor_);
+        timerDescriptor_ = -1;
+    }
+
     /* Pipe */
     for (int i = 0; i < 2; ++i) {
         if (pipeDescriptors_[i] != -1) {
@@ -292,33 +417,106 @@ void SysfsAdaptor::closeAllFds()
     }
 
     /* SysFS */
-    while (!sysfsDescriptors_.empty()) {
-        if (sysfsDescriptors_.last() != -1) {
-            close(sysfsDescriptors_.last());
+    closeSysfsFds();
+}
+
+bool SysfsAdaptor::signalReader(quint64 command)
+{
+    QMutexLocker locker(&mutex_);
+
+    if (pipeDescriptors_[1] == -1)
+        return false;
+    if (write(pipeDescriptors_[1], &command, sizeof(command)) == -1) {
+        sensordLogW() << "Failed to signal reader of '" << id() << "': " << strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+void SysfsAdaptor::park()
+{
+    QMutexLocker locker(&mutex_);
+
+    if (mode_ == IntervalMode) {
+        struct itimerspec spec;
+        memset(&spec, 0, sizeof(spec));
+        if (timerfd_settime(timerDescriptor_, 0, &spec, NULL) == -1) {
+            sensordLogW() << "timerfd_settime(): " << strerror(errno);
+        }
+        timerDeadline_ = 0;
+    } else {
+        for (int i = 0; i < sysfsDescriptors_.size(); ++i) {
+            epoll_ctl(epollDescriptor_, EPOLL_CTL_DEL, sysfsDescriptors_.at(i), NULL);
         }
-        sysfsDescriptors_.removeLast();
     }
+    closeSysfsFds();
 }
 
-void SysfsAdaptor::stopReaderThread()
+void SysfsAdaptor::unpark()
 {
+    QMutexLocker locker(&mutex_);
+
+    if (!openSysfsFds()) {
+        sensordLogW() << "Adaptor '" << id() << "' failed to reopen files after standby";
+        closeSysfsFds();
+        return;
+    }
+
     if (mode_ == SelectMode) {
-        quint64 dummy = 1;
-        write(pipeDescriptors_[1], &dummy, 8);
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(epoll_event));
+        ev.events  = EPOLLIN;
+        for (int i = 0; i < sysfsDescriptors_.size(); ++i) {
+            ev.data.fd = sysfsDescriptors_.at(i);
+            if (epoll_ctl(epollDescriptor_, EPOLL_CTL_ADD, sysfsDescriptors_.at(i), &ev) == -1) {
+                sensordLogW() << "epoll_ctl(): " << strerror(errno);
+            }
+        }
+    } else {
+        armedInterval_ = interval();
+        armTimer(armedInterval_);
     }
-    else
-        reader_.stopReader();
+}
+
+void SysfsAdaptor::stopReaderThread()
+{
+    if (shared_) {
+        SysfsReactor::instance().remove(this);
+        shared_ = false;
+        return;
+    }
+
+    reader_.stopReader();
+    write(pipeDescriptors_[1], &READER_STOP, sizeof(READER_STOP));
     reader_.wait();
 }
 
 bool SysfsAdaptor::startReaderThread()
 {
+    if (parked_) {
+        parked_ = false;
+        if (signalReader(READER_UNPARK))
+            return true;
+        stopReaderThread();
+        closeAllFds();
+    }
+
     if (!openFds()) {
 
         closeAllFds();
         return false;
     }
 
+    SysfsReactor& reactor = SysfsReactor::instance();
+    if (reactor.isEnabled()) {
+        if (!reactor.add(this)) {
+            closeAllFds();
+            return false;
+        }
+        shared_ = true;
+        return true;
+    }
+
     reader_.startReader();
 
     return true;
@@ -363,6 +561,76 @@ QByteArray SysfsAdaptor::readFromFile(const QByteArray& path)
     return data;
 }
 
+int SysfsAdaptor::controlFile(const QByteArray& path, bool write) const
+{
+    QHash<QByteArray, int>& fds = write ? controlWriteFds_ : controlReadFds_;
+    QHash<QByteArray, int>::const_iterator it = fds.constFind(path);
+    if (it != fds.constEnd())
+        return it.value();
+
+    int fd = open(path.constData(), (write ? O_WRONLY : O_RDONLY) | O_CLOEXEC);
+    if (fd == -1) {
+        sensordLogW() << "Failed to open '" << path << "': " << strerror(errno);
+        return -1;
+    }
+    fds.insert(path, fd);
+    return fd;
+}
+
+void SysfsAdaptor::dropControlFile(const QByteArray& path, bool write) const
+{
+    QHash<QByteArray, int>& fds = write ? controlWriteFds_ : controlReadFds_;
+    QHash<QByteArray, int>::iterator it = fds.find(path);
+    if (it == fds.end())
+        return;
+    close(it.value());
+    fds.erase(it);
+}
+
+bool SysfsAdaptor::writeControl(const QByteArray& path, const QByteArray& content) const
+{
+    sensordLogT() << "Writing to '" << path << ": " << content;
+    QMutexLocker locker(&controlMutex_);
+    for (;;) {
+        bool cached = controlWriteFds_.contains(path);
+        int fd = controlFile(path, true);
+        if (fd == -1)
+            return false;
+        if (pwrite(fd, content.constData(), content.size(), 0) == content.size())
+            return true;
+        int error = errno;
+        dropControlFile(path, true);
+        if (!cached) {
+            sensordLogW() << "Failed to write '" << path << "': " << strerror(error);
+            return false;
+        }
+    }
+}
+
+QByteArray SysfsAdaptor::readControl(const QByteArray& path) const
+{
+    QMutexLocker locker(&controlMutex_);
+    for (;;) {
+        bool cached = controlReadFds_.contains(path);
+        int fd = controlFile(path, false);
+        if (fd == -1)
+            return QByteArray();
+        char data[SYSFS_READ_SIZE];
+        ssize_t size = pread(fd, data, sizeof(data), 0);
+        if (size >= 0) {
+            QByteArray content(data, size);
+            sensordLogT() << "Read from '" << path << ": " << content;
+            return content;
+        }
+        int error = errno;
+        dropControlFile(path, false);
+        if (!cached) {
+            sensordLogW() << "Failed to read '" << path << "': " << strerror(error);
+            return QByteArray();
+        }
+    }
+}
+
 bool SysfsAdaptor::checkIntervalUsage() const
 {
     if (mode_ == SysfsAdaptor::SelectMode)
@@ -390,9 +658,297 @@ bool SysfsAdaptor::setInterval(const unsigned int value, const int sessionId)
     if(!checkIntervalUsage())
         return false;
     interval_ = value;
+
+    // Let running reader apply the new interval right away
+    QMutexLocker locker(&mutex_);
+    if (mode_ == IntervalMode && pipeDescriptors_[1] != -1) {
+        if (write(pipeDescriptors_[1], &READER_REARM, sizeof(READER_REARM)) == -1) {
+            sensordLogW() << "Failed to signal interval change: " << strerror(errno);
+        }
+    }
+    return true;
+}
+
+bool SysfsAdaptor::armTimer(unsigned int interval)
+{
+    // Timer period must be non-zero
+    quint64 period = (interval ? interval : 1) * 1000000ULL;
+
+    // Periods on a common grid make deadlines of unrelated intervals
+    // coincide, so adaptors share wakeups.
+    if (timerGrid_)
+        period = qMax(timerGrid_, (period + timerGrid_ / 2) / timerGrid_ * timerGrid_);
+
+    // Deadlines are absolute multiples of the period, so reading time
+    // does not accumulate as drift and adaptors using the same interval
+    // sample in phase.
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    quint64 first = ((now.tv_sec * 1000000000ULL + now.tv_nsec) / period + 1) * period;
+
+    return setTimer(first, period);
+}
+
+bool SysfsAdaptor::setTimer(quint64 first, quint64 period)
+{
+    struct itimerspec spec;
+    spec.it_value.tv_sec = first / 1000000000ULL;
+    spec.it_value.tv_nsec = first % 1000000000ULL;
+    spec.it_interval.tv_sec = period / 1000000000ULL;
+    spec.it_interval.tv_nsec = period % 1000000000ULL;
+    if (timerfd_settime(timerDescriptor_, TFD_TIMER_ABSTIME, &spec, NULL) == -1) {
+        sensordLogW() << "timerfd_settime(): " << strerror(errno);
+        return false;
+    }
+    timerDeadline_ = first;
+    timerPeriod_ = period;
+    return true;
+}
+
+bool SysfsAdaptor::readAhead(quint64 now, quint64 slack)
+{
+    if (mode_ != IntervalMode || timerDescriptor_ == -1)
+        return false;
+
+    // Never serve more than one deadline per period
+    slack = qMin(slack, timerPeriod_ / 2);
+    if (timerDeadline_ <= now || timerDeadline_ > now + slack)
+        return false;
+
+    // Stamped with the read time, data is not from the future
+    beginBatch();
+    sampleTime_ = now / 1000;
+    readAll();
+    endBatch();
+
+    // Deadline has been served, timer continues from the next one
+    return setTimer(timerDeadline_ + timerPeriod_, timerPeriod_);
+}
+
+void SysfsAdaptor::processSample(int pathId, int fd)
+{
+    Q_UNUSED(pathId);
+    Q_UNUSED(fd);
+    sensordLogW() << "Adaptor '" << id() << "' does not implement processSample()";
+}
+
+void SysfsAdaptor::processData(int pathId, const char* data, int size)
+{
+    Q_UNUSED(pathId);
+    Q_UNUSED(data);
+    Q_UNUSED(size);
+    sensordLogW() << "Adaptor '" << id() << "' does not implement processData()";
+}
+
+void SysfsAdaptor::processAssembled(const long* values, int count)
+{
+    Q_UNUSED(values);
+    Q_UNUSED(count);
+    sensordLogW() << "Adaptor '" << id() << "' does not implement processAssembled()";
+}
+
+void SysfsAdaptor::descriptorOpened(int pathId, int fd)
+{
+    Q_UNUSED(pathId);
+    Q_UNUSED(fd);
+}
+
+quint64 SysfsAdaptor::sampleTimestamp() const
+{
+    return sampleTime_;
+}
+
+void SysfsAdaptor::setPositionalRead(bool enabled)
+{
+    positionalRead_ = enabled;
+}
+
+void SysfsAdaptor::setSampleAssembly(bool enabled)
+{
+    assembled_ = enabled;
+}
+
+void SysfsAdaptor::readAll()
+{
+    // Adaptors reading files themselves need the descriptors
+    if (uring_.isOpen() && (assembled_ || positionalRead_) && readBatched())
+        return;
+    if (assembled_) {
+        readAssembled();
+        return;
+    }
+    for (int j = 0; j < sysfsDescriptors_.size(); ++j) {
+        readSample(j);
+    }
+}
+
+void SysfsAdaptor::readAssembled()
+{
+    if (sysfsDescriptors_.isEmpty())
+        return;
+
+    long values[MAX_ASSEMBLED_VALUES];
+    int count = 0;
+    for (int j = 0; j < sysfsDescriptors_.size(); ++j) {
+        char data[SYSFS_READ_SIZE];
+        int fd = sysfsDescriptors_.at(j);
+        ssize_t size = doSeek_ ? pread(fd, data, sizeof(data) - 1, 0) : read(fd, data, sizeof(data) - 1);
+        if (!appendAssembled(j, data, size, values, count))
+            return;
+    }
+    processAssembled(values, count);
+}
+
+bool SysfsAdaptor::appendAssembled(int index, char* data, int size, long* values, int& count)
+{
+    if (size < 0) {
+        sensordLogW() << "Failed to read fd: " << strerror(errno);
+        return false;
+    }
+    int found = parseValues(data, size, values + count, MAX_ASSEMBLED_VALUES - count, valueFormat_);
+    if (found <= 0) {
+        data[size] = '\0';
+        sensordLogW() << "Adaptor '" << id() << "' read no valid value from " << paths_.at(index) << ": " << data;
+        return false;
+    }
+    count += found;
+    return true;
+}
+
+bool SysfsAdaptor::readBatched()
+{
+    if (!uring_.readAll()) {
+        sensordLogW() << "Adaptor '" << id() << "' failed to read through io_uring, reading files one by one";
+        uring_.close();
+        return false;
+    }
+    for (int j = 0; j < sysfsDescriptors_.size(); ++j) {
+        if (uring_.result(j) < 0) {
+            // Read errors of the file are reported by the plain read
+            sensordLogW() << "Adaptor '" << id() << "' can not read " << paths_.at(j) << " through io_uring: "
+                          << strerror(-uring_.result(j)) << ", reading files one by one";
+            uring_.close();
+            return false;
+        }
+    }
+
+    if (assembled_) {
+        long values[MAX_ASSEMBLED_VALUES];
+        int count = 0;
+        for (int j = 0; j < sysfsDescriptors_.size(); ++j) {
+            if (!appendAssembled(j, uring_.data(j), uring_.result(j), values, count))
+                return true;
+        }
+        processAssembled(values, count);
+        return true;
+    }
+    for (int j = 0; j < sysfsDescriptors_.size(); ++j)
+        handlePayload(j, uring_.data(j), uring_.result(j));
     return true;
 }
 
+void SysfsAdaptor::processValues(int pathId, const long* values, int count)
+{
+    Q_UNUSED(pathId);
+    Q_UNUSED(values);
+    Q_UNUSED(count);
+    sensordLogW() << "Adaptor '" << id() << "' does not implement processValues()";
+}
+
+void SysfsAdaptor::setPayloadFormat(int count, ValueFormat format)
+{
+    payloadValues_ = qBound(0, count, MAX_ASSEMBLED_VALUES);
+    valueFormat_ = format;
+    if (payloadValues_)
+        positionalRead_ = true;
+}
+
+static int digitValue(char c, int base)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (base == 16 && c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (base == 16 && c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+int SysfsAdaptor::parseValues(const char* data, int size, long* values, int max, ValueFormat format)
+{
+    const int base = format == HexValues ? 16 : 10;
+    const long limit = LONG_MAX / base;
+    int count = 0;
+    int i = 0;
+    while (i < size) {
+        bool negative = false;
+        if (base == 10 && (data[i] == '-' || data[i] == '+') && i + 1 < size && digitValue(data[i + 1], base) >= 0) {
+            negative = data[i] == '-';
+            ++i;
+        }
+        if (digitValue(data[i], base) < 0) {
+            ++i;
+            continue;
+        }
+        if (count == max)
+            return -1;
+
+        long value = 0;
+        int digit;
+        while (i < size && (digit = digitValue(data[i], base)) >= 0) {
+            if (value > limit || (value == limit && digit > LONG_MAX % base))
+                return -1;
+            value = value * base + digit;
+            ++i;
+        }
+        values[count++] = negative ? -value : value;
+    }
+    return count;
+}
+
+void SysfsAdaptor::readSample(int index)
+{
+    int fd = sysfsDescriptors_.at(index);
+
+    if (positionalRead_) {
+        char data[SYSFS_READ_SIZE];
+        ssize_t size = doSeek_ ? pread(fd, data, sizeof(data) - 1, 0) : read(fd, data, sizeof(data) - 1);
+        if (size < 0) {
+            sensordLogW() << "Failed to read fd: " << strerror(errno);
+            return;
+        }
+        handlePayload(index, data, size);
+        return;
+    }
+
+    processSample(pathIds_.at(index), fd);
+
+    if (doSeek_)
+    {
+        if (lseek(fd, 0, SEEK_SET) == -1)
+        {
+            sensordLogW() << "Failed to lseek fd: " << strerror(errno);
+            Clock::msleep(1000);
+        }
+    }
+}
+
+void SysfsAdaptor::handlePayload(int index, char* data, int size)
+{
+    if (payloadValues_) {
+        long values[MAX_ASSEMBLED_VALUES];
+        if (parseValues(data, size, values, payloadValues_, valueFormat_) != payloadValues_) {
+            data[size] = '\0';
+            sensordLogW() << "Adaptor '" << id() << "' read malformed payload from " << paths_.at(index) << ": " << data;
+            return;
+        }
+        processValues(pathIds_.at(index), values, payloadValues_);
+        return;
+    }
+    data[size] = '\0';
+    processData(pathIds_.at(index), data, size);
+}
+
 SysfsAdaptor::PollMode SysfsAdaptor::mode() const
 {
     return mode_;
@@ -409,69 +965,341 @@ void SysfsAdaptorReader::stopReader()
 
 void SysfsAdaptorReader::startReader()
 {
+    policy_ = ThreadPolicy::fromConfig(parent_->name() + "/reader_");
     running_ = true;
     start();
 }
 
 void SysfsAdaptorReader::run()
 {
+    policy_.apply();
+    parent_->startPolling();
+
     while (running_) {
+        switch (parent_->pollEvents(-1)) {
+        case SysfsAdaptor::PollStopped:
+            running_ = false;
+            break;
+        case SysfsAdaptor::PollFailed:
+            Clock::msleep(POLL_FAILED_DELAY);
+            break;
+        case SysfsAdaptor::PollInputError:
+            Clock::msleep(INPUT_ERROR_DELAY);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+void SysfsAdaptor::startPolling()
+{
+    if (mode_ == IntervalMode) {
+        armedInterval_ = interval();
+        armTimer(armedInterval_);
+    }
+}
 
-        if (parent_->mode_ == SysfsAdaptor::SelectMode) {
+SysfsAdaptor::PollResult SysfsAdaptor::pollEvents(int timeout)
+{
+    const int maxEvents = sysfsDescriptors_.size() + 2;
+    struct epoll_event events[maxEvents];
+    memset(events, 0x0, sizeof(events));
 
-            struct epoll_event events[parent_->sysfsDescriptors_.size() + 1];
-            memset(events, 0x0, sizeof(events));
+    int descriptors = epoll_wait(epollDescriptor_, events, maxEvents, timeout);
 
-            int descriptors = epoll_wait(parent_->epollDescriptor_, events, parent_->sysfsDescriptors_.size() + 1, -1);
+    if (descriptors == -1) {
+        sensordLogD() << "epoll_wait(): " << strerror(errno);
+        return PollFailed;
+    }
 
-            if (descriptors == -1) {
-                sensordLogD() << "epoll_wait(): " << strerror(errno);
-                QThread::msleep(1000);
-            } else {
-                bool errorInInput = false;
-                for (int i = 0; i < descriptors; ++i) {
-                    if (events[i].events & (EPOLLHUP | EPOLLERR)) {
-                        //Note: we ignore error so the sensordiverter.sh works. This should be handled better when testcases are improved.
-                        sensordLogD() << "epoll_wait(): error in input fd";
-                        errorInInput = true;
-                    }
-                    int index = parent_->sysfsDescriptors_.lastIndexOf(events[i].data.fd);
-                    if (index != -1) {
-                        parent_->processSample(parent_->pathIds_.at(index), events[i].data.fd);
-
-                        if (parent_->doSeek_)
-                        {
-                            if (lseek(events[i].data.fd, 0, SEEK_SET) == -1)
-                            {
-                                sensordLogW() << "Failed to lseek fd: " << strerror(errno);
-                                QThread::msleep(1000);
-                            }
-                        }
-                    } else if (events[i].data.fd == parent_->pipeDescriptors_[0]) {
-                        running_ = false;
-                    }
-                }
-                if (errorInInput)
-                    QThread::msleep(50);
+    if (mode_ == SelectMode) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        sampleTime_ = now.tv_sec * 1000000ULL + now.tv_nsec / 1000;
+    }
+
+    // Samples of one wakeup are handed to the chain at once
+    beginBatch();
+
+    bool errorInInput = false;
+    bool stopped = false;
+    bool assemble = false;
+    for (int i = 0; i < descriptors; ++i) {
+        if (events[i].events & (EPOLLHUP | EPOLLERR)) {
+            //Note: we ignore error so the sensordiverter.sh works. This should be handled better when testcases are improved.
+            sensordLogD() << "epoll_wait(): error in input fd";
+            errorInInput = true;
+        }
+        int index = sysfsDescriptors_.lastIndexOf(events[i].data.fd);
+        if (index != -1) {
+            if (assembled_)
+                assemble = true;
+            else
+                readSample(index);
+        } else if (events[i].data.fd == timerDescriptor_) { //IntervalMode
+            quint64 expirations = 0;
+            if (read(timerDescriptor_, &expirations, sizeof(expirations)) != sizeof(expirations))
+                continue;
+            if (expirations > 1) {
+                sensordLogT() << "Adaptor '" << id() << "' missed " << expirations - 1 << " read deadline(s)";
             }
-        } else { //IntervalMode
+
+            // Stamp samples with the latest expired deadline, how late
+            // the thread woke up for it is the read latency
+            quint64 deadline = timerDeadline_ + (expirations - 1) * timerPeriod_;
+            quint64 now = LatencyHistogram::now();
+            recordReadLatency(now > deadline ? now - deadline : 0);
+            sampleTime_ = deadline / 1000;
+            timerDeadline_ += expirations * timerPeriod_;
 
             // Read through all fds.
-            for (int i = 0; i < parent_->sysfsDescriptors_.size(); ++i) {
-                parent_->processSample(parent_->pathIds_.at(i), parent_->sysfsDescriptors_.at(i));
-
-                if (parent_->doSeek_)
-                {
-                    if (lseek(parent_->sysfsDescriptors_.at(i), 0, SEEK_SET) == -1)
-                    {
-                        sensordLogW() << "Failed to lseek fd: " << strerror(errno);
-                        QThread::msleep(1000);
-                    }
+            readAll();
+
+            // Catch interval changes of adaptors overriding interval()
+            if (interval() != armedInterval_) {
+                armedInterval_ = interval();
+                armTimer(armedInterval_);
+            }
+        } else if (events[i].data.fd == pipeDescriptors_[0]) {
+            quint64 command = READER_STOP;
+            if (read(pipeDescriptors_[0], &command, sizeof(command)) != sizeof(command))
+                command = READER_STOP;
+            if (command == READER_REARM) {
+                if (mode_ == IntervalMode && timerDeadline_) {
+                    armedInterval_ = interval();
+                    armTimer(armedInterval_);
                 }
+            } else if (command == READER_PARK) {
+                park();
+            } else if (command == READER_UNPARK) {
+                unpark();
+            } else {
+                stopped = true;
             }
+        }
+    }
+    if (assemble)
+        readAssembled();
+    endBatch();
+
+    if (stopped)
+        return PollStopped;
+    return errorInInput ? PollInputError : PollOk;
+}
 
-            // Sleep for interval
-            QThread::msleep(parent_->interval());
+SysfsReactor& SysfsReactor::instance()
+{
+    static SysfsReactor reactor;
+    static bool configured = false;
+    if (!configured && Config::configuration()) {
+        configured = true;
+        if (Config::configuration()->value<bool>("global/sysfs_shared_reader", false)) {
+            sensordLogD() << "Reading sysfs adaptors on a shared thread";
+            reactor.slackConfig_ = Config::configuration()->value<int>("global/sysfs_timer_slack", 0);
+            reactor.policy_ = ThreadPolicy::fromConfig("global/sysfs_reader_");
+            reactor.startReactor();
+        }
+    }
+    return reactor;
+}
+
+SysfsReactor::SysfsReactor() :
+    epollDescriptor_(-1),
+    eventDescriptor_(-1),
+    running_(0),
+    slackConfig_(0),
+    slack_(0)
+{
+    setObjectName("sensord-sysfs");
+}
+
+SysfsReactor::~SysfsReactor()
+{
+    if (isEnabled()) {
+        running_.fetchAndStoreOrdered(0);
+        quint64 value = 1;
+        if (write(eventDescriptor_, &value, sizeof(value)) == -1) {
+            sensordLogW() << "Failed to stop sysfs reactor: " << strerror(errno);
+        }
+        wait();
+    }
+    if (eventDescriptor_ != -1)
+        close(eventDescriptor_);
+    if (epollDescriptor_ != -1)
+        close(epollDescriptor_);
+}
+
+bool SysfsReactor::startReactor()
+{
+    if (isEnabled())
+        return false;
+
+    if ((epollDescriptor_ = epoll_create1(EPOLL_CLOEXEC)) == -1) {
+        sensordLogW() << "epoll_create1(): " << strerror(errno);
+        return false;
+    }
+    if ((eventDescriptor_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) == -1) {
+        sensordLogW() << "eventfd(): " << strerror(errno);
+        return false;
+    }
+
+    // Stop event is the only one without an adaptor
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(epoll_event));
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL;
+    if (epoll_ctl(epollDescriptor_, EPOLL_CTL_ADD, eventDescriptor_, &ev) == -1) {
+        sensordLogW() << "epoll_ctl(): " << strerror(errno);
+        return false;
+    }
+
+    running_.fetchAndStoreOrdered(1);
+    start();
+    return true;
+}
+
+bool SysfsReactor::isEnabled() const
+{
+    return Atomic::load(running_);
+}
+
+bool SysfsReactor::add(SysfsAdaptor* adaptor)
+{
+    QMutexLocker locker(&mutex_);
+
+    adaptor->startPolling();
+
+    // One-shot, so an adaptor is re-armed only after it has been read
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(epoll_event));
+    ev.events = EPOLLIN | EPOLLONESHOT;
+    ev.data.ptr = adaptor;
+    if (epoll_ctl(epollDescriptor_, EPOLL_CTL_ADD, adaptor->epollDescriptor_, &ev) == -1) {
+        sensordLogW() << "epoll_ctl(): " << strerror(errno);
+        return false;
+    }
+    adaptors_.append(adaptor);
+    return true;
+}
+
+void SysfsReactor::remove(SysfsAdaptor* adaptor)
+{
+    QMutexLocker locker(&mutex_);
+
+    if (!adaptors_.removeAll(adaptor))
+        return;
+    if (epoll_ctl(epollDescriptor_, EPOLL_CTL_DEL, adaptor->epollDescriptor_, NULL) == -1) {
+        sensordLogW() << "epoll_ctl(): " << strerror(errno);
+    }
+    for (int i = delayed_.size() - 1; i >= 0; --i) {
+        if (delayed_.at(i).adaptor == adaptor)
+            delayed_.removeAt(i);
+    }
+}
+
+void SysfsReactor::rearm(SysfsAdaptor* adaptor)
+{
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(epoll_event));
+    ev.events = EPOLLIN | EPOLLONESHOT;
+    ev.data.ptr = adaptor;
+    if (epoll_ctl(epollDescriptor_, EPOLL_CTL_MOD, adaptor->epollDescriptor_, &ev) == -1) {
+        sensordLogW() << "epoll_ctl(): " << strerror(errno);
+    }
+}
+
+void SysfsReactor::run()
+{
+    struct epoll_event events[REACTOR_MAX_EVENTS];
+
+    policy_.apply();
+
+    // Slack set for the thread, or inherited from the process, is the
+    // window in which upcoming deadlines are served early
+    if (slackConfig_ > 0 && prctl(PR_SET_TIMERSLACK, slackConfig_ * 1000UL) == -1) {
+        sensordLogW() << "Failed to set timer slack: " << strerror(errno);
+    }
+    int slack = prctl(PR_GET_TIMERSLACK);
+    slack_ = slack > 0 ? slack : 0;
+
+    while (Atomic::load(running_)) {
+        // Sleep until the next backed off adaptor is due
+        int timeout = -1;
+        mutex_.lock();
+        if (!delayed_.isEmpty()) {
+            quint64 now = monotonicMs();
+            quint64 deadline = delayed_.first().deadline;
+            foreach (const Delayed& delayed, delayed_)
+                deadline = qMin(deadline, delayed.deadline);
+            timeout = deadline > now ? deadline - now : 0;
+        }
+        mutex_.unlock();
+
+        int descriptors = epoll_wait(epollDescriptor_, events, REACTOR_MAX_EVENTS, timeout);
+        if (descriptors == -1) {
+            if (errno != EINTR) {
+                sensordLogD() << "epoll_wait(): " << strerror(errno);
+                Clock::msleep(POLL_FAILED_DELAY);
+            }
+            continue;
+        }
+
+        QMutexLocker locker(&mutex_);
+        for (int i = 0; i < descriptors; ++i) {
+            SysfsAdaptor* adaptor = static_cast<SysfsAdaptor*>(events[i].data.ptr);
+            // Adaptor may have been removed after epoll_wait() returned
+            if (adaptor == NULL || !adaptors_.contains(adaptor))
+                continue;
+
+            int delay = 0;
+            switch (adaptor->pollEvents(0)) {
+            case SysfsAdaptor::PollFailed:
+                delay = POLL_FAILED_DELAY;
+                break;
+            case SysfsAdaptor::PollInputError:
+                delay = INPUT_ERROR_DELAY;
+                break;
+            default:
+                break;
+            }
+
+            if (delay) {
+                Delayed delayed;
+                delayed.adaptor = adaptor;
+                delayed.deadline = monotonicMs() + delay;
+                delayed_.append(delayed);
+            } else {
+                rearm(adaptor);
+            }
+        }
+
+        quint64 now = monotonicMs();
+        for (int i = delayed_.size() - 1; i >= 0; --i) {
+            if (delayed_.at(i).deadline <= now) {
+                rearm(delayed_.at(i).adaptor);
+                delayed_.removeAt(i);
+            }
+        }
+
+        // CPU is awake anyway, read adaptors which are due within slack
+        if (descriptors > 0)
+            readAhead();
+    }
+}
+
+void SysfsReactor::readAhead()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    quint64 now = ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+
+    foreach (SysfsAdaptor* adaptor, adaptors_) {
+        bool backedOff = false;
+        foreach (const Delayed& delayed, delayed_)
+            backedOff |= (delayed.adaptor == adaptor);
+        if (!backedOff && adaptor->readAhead(now, slack_)) {
+            sensordLogT() << "Adaptor '" << adaptor->id() << "' read ahead of its deadline";
         }
     }
 }
@@ -494,3 +1322,9 @@ void SysfsAdaptor::init()
     introduceAvailableIntervals(name());
     setDefaultInterval(Config::configuration()->value<int>(name() + "/default_interval", 0));
 }
+
+void SysfsAdaptor::reconfigure(const QStringList& keys)
+{
+    if (keys.contains(name() + "/default_interval"))
+        setDefaultInterval(Config::configuration()->value<int>(name() + "/default_interval", 0));
+}
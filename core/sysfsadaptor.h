@@ -31,10 +31,15 @@
 
 #include "deviceadaptor.h"
 #include "deviceadaptorringbuffer.h"
+#include "threadpolicy.h"
+#include "uringreader.h"
 #include <QString>
 #include <QStringList>
 #include <QThread>
 #include <QMutex>
+#include <QAtomicInt>
+#include <QList>
+#include <QHash>
 #include <QFile>
 
 class SysfsAdaptor;
@@ -68,13 +73,125 @@ public:
     void stopReader();
 
     /**
-     * Initiate reader starting.
+     * Initiate reader starting. Scheduling of the thread is read from
+     * the <em>adaptor</em>/reader_* keys, see ThreadPolicy.
      */
     void startReader();
 
 private:
     bool          running_; /**< should thread be running or not */
     SysfsAdaptor *parent_;  /**< parent object. */
+    ThreadPolicy  policy_;  /**< scheduling of the thread */
+};
+
+/**
+ * Shared reader thread for SysfsAdaptor instances. Instead of running a
+ * SysfsAdaptorReader each, registered adaptors are multiplexed by one
+ * thread: the epoll descriptor of each adaptor is watched in the epoll
+ * set of the reactor, and the adaptor handles its own events when it
+ * becomes readable. Adaptors with input errors are backed off without
+ * stalling the others.
+ *
+ * After each wakeup, IntervalMode adaptors whose next deadline is within
+ * the timer slack of the thread are read ahead of time, so adaptors with
+ * nearby deadlines share wakeups. Slack is set with
+ * global/sysfs_timer_slack (us), otherwise the slack of the process
+ * (PR_SET_TIMERSLACK) is used.
+ *
+ * Enabled with global/sysfs_shared_reader (default false). Should not be
+ * invoked directly by anything except #SysfsAdaptor.
+ */
+class SysfsReactor : public QThread
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(SysfsReactor)
+
+public:
+    /**
+     * Default reactor, started from configuration on first use.
+     *
+     * @return reactor.
+     */
+    static SysfsReactor& instance();
+
+    /**
+     * Constructor. Reactor is disabled until started.
+     */
+    SysfsReactor();
+
+    /**
+     * Destructor. Stops the thread.
+     */
+    ~SysfsReactor();
+
+    /**
+     * Start the reactor thread.
+     *
+     * @return was the thread started.
+     */
+    bool startReactor();
+
+    /**
+     * Is the reactor thread running.
+     *
+     * @return are adaptors read by the reactor.
+     */
+    bool isEnabled() const;
+
+    /**
+     * Start reading an adaptor whose descriptors are open.
+     *
+     * @param adaptor adaptor to read.
+     * @return was adaptor registered.
+     */
+    bool add(SysfsAdaptor* adaptor);
+
+    /**
+     * Stop reading an adaptor. Adaptor is not touched by the reactor
+     * after return, so its descriptors may be closed.
+     *
+     * @param adaptor adaptor to remove.
+     */
+    void remove(SysfsAdaptor* adaptor);
+
+protected:
+    /**
+     * Reactor thread entry-function.
+     */
+    void run();
+
+private:
+    /**
+     * Adaptor waiting for re-arming after an error.
+     */
+    struct Delayed
+    {
+        SysfsAdaptor* adaptor;  /**< adaptor */
+        quint64       deadline; /**< monotonic re-arm time (ms) */
+    };
+
+    /**
+     * Watch adaptor for the next event. Called with #mutex_ held.
+     *
+     * @param adaptor registered adaptor.
+     */
+    void rearm(SysfsAdaptor* adaptor);
+
+    /**
+     * Read adaptors which are due within the slack. Called with #mutex_
+     * held.
+     */
+    void readAhead();
+
+    int                  epollDescriptor_; /**< epoll of adaptor epolls */
+    int                  eventDescriptor_; /**< eventfd stopping the thread */
+    QAtomicInt           running_;         /**< should the thread run */
+    QMutex               mutex_;           /**< guards lists, held while adaptors are read */
+    QList<SysfsAdaptor*> adaptors_;        /**< registered adaptors */
+    QList<Delayed>       delayed_;         /**< backed off adaptors */
+    int                  slackConfig_;     /**< configured timer slack (us) */
+    quint64              slack_;           /**< timer slack of the thread (ns) */
+    ThreadPolicy         policy_;          /**< scheduling of the thread */
 };
 
 /**
@@ -88,6 +205,13 @@ private:
  *
  * Simultaneous monitoring of several files is supported by giving unique
  * index for each file.
+ *
+ * Files are read by a reader thread of the adaptor, or by the shared
+ * #SysfsReactor when global/sysfs_shared_reader is set. In IntervalMode,
+ * files which are read from offset 0 for the adaptor (positional or
+ * assembled reads with seeking) are read with one io_uring submission
+ * per period when global/sysfs_io_uring is set and sensord is built with
+ * CONFIG+=iouring, see UringReader.
  */
 class SysfsAdaptor : public DeviceAdaptor
 {
@@ -97,6 +221,31 @@ public:
         IntervalMode    /**< Read constantly with given frequency. */
     };
 
+    /**
+     * Notation of integers in sysfs payloads, see #parseValues().
+     */
+    enum ValueFormat {
+        DecimalValues = 0, /**< decimal, e.g. "N", "N N N", "(x,y,z)" or "x: N y: N" */
+        HexValues          /**< hexadecimal without prefix, e.g. "x:y:z" */
+    };
+
+    /**
+     * Parse integers of a sysfs payload. Exactly the given bytes are
+     * parsed, the payload needs no terminator. Anything between values,
+     * such as labels, separators and white space, is skipped; a decimal
+     * value may be preceded by a sign. Parsing is locale independent and
+     * does not allocate.
+     *
+     * @param data   payload.
+     * @param size   payload size in bytes.
+     * @param values array receiving the values.
+     * @param max    size of the values array.
+     * @param format notation of the values.
+     * @return number of values parsed, -1 if the payload holds more than
+     *         max values or a value overflows.
+     */
+    static int parseValues(const char* data, int size, long* values, int max, ValueFormat format = DecimalValues);
+
     /**
      * Constructor.
      *
@@ -115,6 +264,14 @@ public:
 
     virtual void init();
 
+    /**
+     * Re-read default interval of the adaptor. Paths and poll mode are
+     * only read by init().
+     *
+     * @param keys changed configuration keys.
+     */
+    virtual void reconfigure(const QStringList& keys);
+
     /**
      * Add a new file device for monitoring. Adaptor must be restarted to
      * get the newly added path into monitoring list.
@@ -150,10 +307,19 @@ public:
 
     virtual bool resume();
 
+    /**
+     * Standby and resume only signal the reader or restart it, reader
+     * state is guarded by the adaptor mutex.
+     *
+     * @return true.
+     */
+    virtual bool concurrentPowerTransition() const;
+
 protected:
     /**
      * Called when new data is available on some file descriptor.
-     * Must be implemented by the child class.
+     * Must be implemented by the child class unless positional reads
+     * are enabled with #setPositionalRead().
      *
      * @param pathId Path ID for the file that has received new data.
      *               If path ID was not set when file path was added,
@@ -161,7 +327,95 @@ protected:
      * @param fd     Open file descriptor where the new data can be read. This
      *               file descriptor must not be closed!
      */
-    virtual void processSample(int pathId, int fd) = 0;
+    virtual void processSample(int pathId, int fd);
+
+    /**
+     * Called with the content of a file which has received new data, when
+     * positional reads are enabled with #setPositionalRead(). With seeking
+     * enabled the file is read from the beginning with a single pread(),
+     * so no separate lseek() is needed.
+     *
+     * @param pathId Path ID for the file that has received new data.
+     * @param data   File content, NUL terminated.
+     * @param size   Number of bytes read, excluding the terminator.
+     */
+    virtual void processData(int pathId, const char* data, int size);
+
+    /**
+     * Let the adaptor read the files and pass their content to
+     * #processData() instead of passing file descriptors to
+     * #processSample().
+     *
+     * @param enabled are positional reads used.
+     */
+    void setPositionalRead(bool enabled);
+
+    /**
+     * Called with the values of all files as one sample, when sample
+     * assembly is enabled with #setSampleAssembly().
+     *
+     * @param values integers parsed from the files, in the order the
+     *               paths were added.
+     * @param count  number of values.
+     */
+    virtual void processAssembled(const long* values, int count);
+
+    /**
+     * Read all files back to back as one sample whenever the adaptor is
+     * read, and pass their values to #processAssembled() instead of
+     * handing files to #processSample() one by one. Each file is read
+     * with a single pread() and every integer in it is taken, so a
+     * sample may be split over per-axis files or held in one "(x,y,z)"
+     * file. In SelectMode files becoming readable on one wakeup are read
+     * as one sample.
+     *
+     * @param enabled is sample assembly used.
+     */
+    void setSampleAssembly(bool enabled);
+
+    /**
+     * Called with the values of a file which has received new data, when
+     * its payload format is declared with #setPayloadFormat().
+     *
+     * @param pathId Path ID for the file that has received new data.
+     * @param values values parsed from the file.
+     * @param count  number of values, as declared.
+     */
+    virtual void processValues(int pathId, const long* values, int count);
+
+    /**
+     * Declare that each file holds given number of integers. Files are
+     * then read with positional reads and parsed with #parseValues(),
+     * and payloads holding exactly count values are passed to
+     * #processValues(). Others are rejected with a warning. Also sets
+     * the notation used by #setSampleAssembly().
+     *
+     * @param count  values per file, 0 to pass file content to
+     *               #processData() again.
+     * @param format notation of the values.
+     */
+    void setPayloadFormat(int count, ValueFormat format = DecimalValues);
+
+    /**
+     * Called for each file after it has been opened,
+     * before the reader thread is started. Can be used to configure the
+     * device (ioctl) or to read its initial state.
+     *
+     * @param pathId Path ID for the opened file.
+     * @param fd     Opened file descriptor. Must not be closed!
+     */
+    virtual void descriptorOpened(int pathId, int fd);
+
+    /**
+     * Timestamp for the sample being processed. Valid in #processSample()
+     * and #processData(). In IntervalMode this is the timer deadline which
+     * triggered the read, so scheduling latency of the reader thread does
+     * not show up as jitter. In SelectMode the monotonic clock is read
+     * once per wakeup and shared by all files read on it.
+     *
+     * @return monotonic timestamp in microseconds.
+     */
+    quint64 sampleTimestamp() const;
 
     /**
      * Utility function for writing to files. Can be used to control
@@ -181,6 +435,27 @@ protected:
      */
     static QByteArray readFromFile(const QByteArray& path);
 
+    /**
+     * Write to a control file of the adaptor, such as a power state or
+     * rate attribute. The file is opened on first use and kept open by
+     * the adaptor, so later writes cost a single pwrite(). A stale
+     * descriptor, e.g. after the device was rebound, is reopened once.
+     *
+     * @param path    Path of the file to write to
+     * @param content What to write
+     * @return True on success, false on failure.
+     */
+    bool writeControl(const QByteArray& path, const QByteArray& content) const;
+
+    /**
+     * Read a control file of the adaptor with a single pread() on a
+     * descriptor kept open by the adaptor, see #writeControl().
+     *
+     * @param path    Path of the file to read from
+     * @return Content of the file, empty on failure.
+     */
+    QByteArray readControl(const QByteArray& path) const;
+
 protected:
     /**
      * Returns the current interval. Valid for PollMode.
@@ -192,8 +467,8 @@ protected:
 
     /**
      * Sets the interval for the adaptor. This function is valid for
-     * adaptors using PollMode. It just sets the number of milliseconds
-     * that the adaptor will sleep between reads.
+     * adaptors using PollMode. It sets the period of the timer driving
+     * reads; running reader applies the change immediately.
      *
      * For adaptors using SelectMode, reimplementation is a must as this
      * implementatino will have no effect on the behavior.
@@ -214,6 +489,16 @@ protected:
     PollMode mode() const;
 
 private:
+    /**
+     * Outcome of handling reader events.
+     */
+    enum PollResult {
+        PollOk = 0,      /**< events handled */
+        PollInputError,  /**< some input reported an error */
+        PollFailed,      /**< epoll_wait() failed */
+        PollStopped      /**< stop was requested through the control pipe */
+    };
+
     /**
      * Opens all file descriptors required by the adaptor.
      *
@@ -228,6 +513,56 @@ private:
      */
     void closeAllFds();
 
+    /**
+     * Open files of #paths_ into #sysfsDescriptors_. Caller holds #mutex_.
+     *
+     * @return were files opened succesfully.
+     */
+    bool openSysfsFds();
+
+    /**
+     * Close files of #sysfsDescriptors_. Caller holds #mutex_.
+     */
+    void closeSysfsFds();
+
+    /**
+     * Write a command to the control pipe of the reader.
+     *
+     * @param command control pipe command.
+     * @return was command written.
+     */
+    bool signalReader(quint64 command);
+
+    /**
+     * Close input files and disarm the timer for standby, keeping the
+     * reader waiting on the control pipe. Called from the reader thread.
+     */
+    void park();
+
+    /**
+     * Reopen input files and rearm the timer after #park(). Called from
+     * the reader thread.
+     */
+    void unpark();
+
+    /**
+     * Cached descriptor of a control file, opened if not cached yet.
+     * Caller holds #controlMutex_.
+     *
+     * @param path  control file path.
+     * @param write is the file opened for writing or for reading.
+     * @return descriptor or -1 if the file can not be opened.
+     */
+    int controlFile(const QByteArray& path, bool write) const;
+
+    /**
+     * Close a cached control file. Caller holds #controlMutex_.
+     *
+     * @param path  control file path.
+     * @param write was the file opened for writing or for reading.
+     */
+    void dropControlFile(const QByteArray& path, bool write) const;
+
     /**
      * Stop reader thread.
      */
@@ -245,21 +580,133 @@ private:
      */
     bool checkIntervalUsage() const;
 
+    /**
+     * Read new data from file and hand it to the child class.
+     * Called from the reader thread.
+     *
+     * @param index index of the file in #sysfsDescriptors_.
+     */
+    void readSample(int index);
+
+    /**
+     * Read all files, as one assembled sample or each on its own.
+     * Called from the reader thread.
+     */
+    void readAll();
+
+    /**
+     * Read all files as one sample and hand it to #processAssembled().
+     * Called from the reader thread.
+     */
+    void readAssembled();
+
+    /**
+     * Read all files with one io_uring submission and hand them to the
+     * child class like #readAll(). Called from the reader thread.
+     *
+     * @return were the files read, false if the ring failed and was
+     *         closed.
+     */
+    bool readBatched();
+
+    /**
+     * Hand data read from a file to the child class, parsed when a
+     * payload format is set.
+     *
+     * @param index index of the file in #sysfsDescriptors_.
+     * @param data read bytes, with room for a terminator.
+     * @param size number of read bytes.
+     */
+    void handlePayload(int index, char* data, int size);
+
+    /**
+     * Parse data read from a file into an assembled sample.
+     *
+     * @param index index of the file in #sysfsDescriptors_.
+     * @param data read bytes, with room for a terminator.
+     * @param size number of read bytes, negative on read error.
+     * @param values values of the sample.
+     * @param count number of values, advanced by the parsed ones.
+     * @return did the file hold valid values.
+     */
+    bool appendAssembled(int index, char* data, int size, long* values, int& count);
+
+    /**
+     * Prepare for reading, arming the timer in IntervalMode. Called from
+     * the thread reading the adaptor before #pollEvents().
+     */
+    void startPolling();
+
+    /**
+     * Wait for events on the descriptors of the adaptor and handle them
+     * as one batch.
+     *
+     * @param timeout epoll_wait() timeout (ms), -1 to block.
+     * @return outcome of handling the events.
+     */
+    PollResult pollEvents(int timeout);
+
+    /**
+     * Arm interval mode timer with deadlines aligned to the interval.
+     * With global/interval_grid (ms) set, the period is rounded to a
+     * multiple of the grid. Called from the reader thread.
+     *
+     * @param interval read interval (ms).
+     * @return was timer armed succesfully.
+     */
+    bool armTimer(unsigned int interval);
+
+    /**
+     * Set interval mode timer.
+     *
+     * @param first absolute monotonic time of the first deadline (ns).
+     * @param period timer period (ns).
+     * @return was timer set succesfully.
+     */
+    bool setTimer(quint64 first, quint64 period);
+
+    /**
+     * Serve the next IntervalMode deadline early if it is within the
+     * slack. Called from SysfsReactor.
+     *
+     * @param now current monotonic time (ns).
+     * @param slack how early a deadline may be served (ns).
+     * @return were files read.
+     */
+    bool readAhead(quint64 now, quint64 slack);
+
     SysfsAdaptorReader  reader_; /**< reader thread instance */
+    bool                shared_; /**< is adaptor read by SysfsReactor */
     PollMode            mode_;   /**< used poll mode */
     int                 epollDescriptor_;    /**< open epoll descriptors */
     int                 pipeDescriptors_[2]; /**< open pipe descriptors */
+    int                 timerDescriptor_;    /**< interval mode timerfd */
+    quint64             timerDeadline_;      /**< next timer deadline (ns) */
+    quint64             timerPeriod_;        /**< timer period (ns) */
+    quint64             sampleTime_;         /**< timestamp of current sample (us) */
+    unsigned int        armedInterval_;      /**< interval the timer is armed with */
+    quint64             timerGrid_;          /**< deadline grid (ns), 0 if not used */
     QStringList         paths_;   /**< added paths. */
     QList<int>          pathIds_; /**< added path IDs. */
     unsigned int interval_; /**< used interval */
     bool inStandbyMode_;    /**< are we in standby */
+    bool parked_;           /**< is reader kept waiting through standby */
     bool running_;          /**< are we running */
     bool shouldBeRunning_;  /**< should we be running */
     bool doSeek_;           /**< should lseek() be performed after reading */
+    bool positionalRead_;   /**< does the adaptor read files for the child class */
+    bool assembled_;        /**< are files read as one sample */
+    int payloadValues_;     /**< declared values per file, 0 if not parsed */
+    ValueFormat valueFormat_; /**< notation of values in the files */
     QList<int> sysfsDescriptors_; /**< List of open file descriptors. */
+    UringReader uring_;     /**< batched IntervalMode reads, see global/sysfs_io_uring */
     QMutex mutex_;          /** mutex protecting starting and stopping. */
+    mutable QHash<QByteArray, int> controlWriteFds_; /**< control files open for writing */
+    mutable QHash<QByteArray, int> controlReadFds_;  /**< control files open for reading */
+    mutable QMutex controlMutex_; /**< guards control file caches */
 
     friend class SysfsAdaptorReader;
+    friend class SysfsReactor;
 };
 
 #endif
@@ -0,0 +1,125 @@
+/**
+   @file threadpolicy.cpp
+   @brief Scheduling policy of reader threads
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "threadpolicy.h"
+#include "config.h"
+#include "logging.h"
+#include <QStringList>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+ThreadPolicy::ThreadPolicy() :
+    scheduler_(SCHED_OTHER),
+    priority_(0),
+    setNice_(false),
+    nice_(0)
+{
+}
+
+ThreadPolicy ThreadPolicy::fromConfig(const QString& prefix)
+{
+    ThreadPolicy policy;
+    Config* config = Config::configuration();
+    if (!config)
+        return policy;
+    policy.prefix_ = prefix;
+
+    QString scheduler = config->value<QString>(prefix + "scheduler", "other");
+    if (scheduler == "fifo") {
+        policy.scheduler_ = SCHED_FIFO;
+    } else if (scheduler == "rr") {
+        policy.scheduler_ = SCHED_RR;
+    } else if (scheduler != "other") {
+        sensordLogW() << "Unknown scheduler" << scheduler << "in" << prefix + "scheduler";
+    }
+    if (policy.scheduler_ != SCHED_OTHER) {
+        int priority = config->value<int>(prefix + "priority", 1);
+        policy.priority_ = qBound(sched_get_priority_min(policy.scheduler_), priority, sched_get_priority_max(policy.scheduler_));
+    }
+
+    if (config->exists(prefix + "nice")) {
+        policy.setNice_ = true;
+        policy.nice_ = config->value<int>(prefix + "nice", 0);
+    }
+
+    foreach (const QString& range, config->value<QString>(prefix + "cpus", "").split(",", QString::SkipEmptyParts)) {
+        QStringList bounds = range.split("-");
+        bool firstOk = false;
+        bool lastOk = false;
+        int first = bounds.first().trimmed().toInt(&firstOk);
+        int last = bounds.last().trimmed().toInt(&lastOk);
+        if (bounds.size() > 2 || !firstOk || !lastOk || first < 0 || last < first || last >= CPU_SETSIZE) {
+            sensordLogW() << "Invalid CPU range" << range << "in" << prefix + "cpus";
+            continue;
+        }
+        for (int cpu = first; cpu <= last; ++cpu)
+            policy.cpus_.append(cpu);
+    }
+    return policy;
+}
+
+bool ThreadPolicy::isDefault() const
+{
+    return scheduler_ == SCHED_OTHER && !setNice_ && cpus_.isEmpty();
+}
+
+bool ThreadPolicy::apply() const
+{
+    bool ok = true;
+
+    if (scheduler_ != SCHED_OTHER) {
+        struct sched_param param;
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = priority_;
+        int err = pthread_setschedparam(pthread_self(), scheduler_, &param);
+        if (err) {
+            sensordLogW() << "Failed to set" << prefix_ + "scheduler:" << strerror(err);
+            ok = false;
+        }
+    }
+
+    // Nice value is per thread on Linux
+    if (setNice_ && setpriority(PRIO_PROCESS, syscall(SYS_gettid), nice_) == -1) {
+        sensordLogW() << "Failed to set" << prefix_ + "nice:" << strerror(errno);
+        ok = false;
+    }
+
+    if (!cpus_.isEmpty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        foreach (int cpu, cpus_)
+            CPU_SET(cpu, &set);
+        int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (err) {
+            sensordLogW() << "Failed to set" << prefix_ + "cpus:" << strerror(err);
+            ok = false;
+        }
+    }
+
+    if (ok && !isDefault())
+        sensordLogD() << "Applied thread policy" << prefix_;
+    return ok;
+}
@@ -0,0 +1,80 @@
+/**
+   @file threadpolicy.h
+   @brief Scheduling policy of reader threads
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef THREADPOLICY_H
+#define THREADPOLICY_H
+
+#include <QString>
+#include <QList>
+
+/**
+ * Scheduling class, priority, nice value and CPU affinity of a thread,
+ * read from configuration keys sharing a prefix:
+ *
+ * - <em>prefix</em>scheduler: other (default), fifo or rr
+ * - <em>prefix</em>priority: real-time priority for fifo and rr (default 1)
+ * - <em>prefix</em>nice: nice value, left as it is if not set
+ * - <em>prefix</em>cpus: CPUs to run on, e.g. "0,2-3"; all if not set
+ *
+ * Policy is read in the thread starting the reader and applied by the
+ * reader thread itself, failures are logged and leave the thread running
+ * with the defaults.
+ */
+class ThreadPolicy
+{
+public:
+    /**
+     * Constructor. Default policy changes nothing.
+     */
+    ThreadPolicy();
+
+    /**
+     * Read policy from configuration.
+     *
+     * @param prefix key prefix, e.g. "accelerometer/reader_".
+     * @return policy.
+     */
+    static ThreadPolicy fromConfig(const QString& prefix);
+
+    /**
+     * Does the policy change anything.
+     *
+     * @return is policy the default one.
+     */
+    bool isDefault() const;
+
+    /**
+     * Apply policy to the calling thread.
+     *
+     * @return was everything applied.
+     */
+    bool apply() const;
+
+private:
+    QString    prefix_;    /**< configuration prefix, for logging */
+    int        scheduler_; /**< SCHED_OTHER, SCHED_FIFO or SCHED_RR */
+    int        priority_;  /**< real-time priority */
+    bool       setNice_;   /**< is nice value set */
+    int        nice_;      /**< nice value */
+    QList<int> cpus_;      /**< CPU affinity, empty for all */
+};
+
+#endif // THREADPOLICY_H
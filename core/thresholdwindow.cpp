@@ -0,0 +1,111 @@
+/**
+   @file thresholdwindow.cpp
+   @brief Interrupt threshold window of a light or proximity chip
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "thresholdwindow.h"
+#include "sysfsadaptor.h"
+#include "config.h"
+#include "logging.h"
+
+ThresholdWindow::ThresholdWindow(const QString& name) :
+    percent_(10),
+    minWidth_(1),
+    max_(65535),
+    divider_(1),
+    programmed_(false),
+    low_(0),
+    high_(0)
+{
+    Config* config = Config::configuration();
+    if (!config)
+        return;
+    lowPath_ = config->value(name + "/threshold_low_path").toByteArray();
+    highPath_ = config->value(name + "/threshold_high_path").toByteArray();
+    percent_ = config->value<unsigned int>(name + "/threshold_window", percent_);
+    minWidth_ = config->value<unsigned int>(name + "/threshold_min_width", minWidth_);
+    max_ = config->value<unsigned int>(name + "/threshold_max", max_);
+    divider_ = qMax(1u, config->value<unsigned int>(name + "/threshold_divider", divider_));
+    if (isEnabled())
+        sensordLogD() << "Threshold window of " << name << ": " << percent_ << "% of the reading, at least " << minWidth_;
+}
+
+bool ThresholdWindow::isEnabled() const
+{
+    return !lowPath_.isEmpty() && !highPath_.isEmpty();
+}
+
+bool ThresholdWindow::close(const SysfsAdaptor& adaptor)
+{
+    if (!isEnabled())
+        return false;
+    programmed_ = false;
+    // Any reading is outside a window from the maximum down to zero
+    return program(adaptor, max_, 0);
+}
+
+bool ThresholdWindow::centre(const SysfsAdaptor& adaptor, unsigned int value)
+{
+    if (!isEnabled())
+        return false;
+    value /= divider_;
+    if (programmed_ && low_ <= high_ && value >= low_ && value <= high_)
+        return true;
+
+    unsigned int low;
+    unsigned int high;
+    bounds(value, percent_, minWidth_, max_, low, high);
+    return program(adaptor, low, high);
+}
+
+void ThresholdWindow::bounds(unsigned int value, unsigned int percent, unsigned int minWidth, unsigned int max,
+                             unsigned int& low, unsigned int& high)
+{
+    value = qMin(value, max);
+    unsigned int width = (unsigned int)qMin((quint64)value * percent / 100, (quint64)max);
+    width = qMax(minWidth, width);
+    low = value > width ? value - width : 0;
+    high = max - value > width ? value + width : max;
+}
+
+bool ThresholdWindow::program(const SysfsAdaptor& adaptor, unsigned int low, unsigned int high)
+{
+    if (!isEnabled())
+        return false;
+    bool ok = true;
+    // Widen before narrowing, so that the chip never sees a window
+    // missing the current reading on either side
+    bool lowFirst = programmed_ && low < low_;
+    if (lowFirst)
+        ok &= adaptor.writeControl(lowPath_, QByteArray::number(low));
+    if (!programmed_ || high != high_)
+        ok &= adaptor.writeControl(highPath_, QByteArray::number(high));
+    if (!lowFirst && (!programmed_ || low != low_))
+        ok &= adaptor.writeControl(lowPath_, QByteArray::number(low));
+    if (!ok) {
+        sensordLogW() << "Failed to program threshold window " << low << " - " << high;
+        programmed_ = false;
+        return false;
+    }
+    sensordLogT() << "Threshold window " << low << " - " << high;
+    programmed_ = true;
+    low_ = low;
+    high_ = high;
+    return true;
+}
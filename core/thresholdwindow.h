@@ -0,0 +1,132 @@
+/**
+   @file thresholdwindow.h
+   @brief Interrupt threshold window of a light or proximity chip
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef THRESHOLDWINDOW_H
+#define THRESHOLDWINDOW_H
+
+#include <QByteArray>
+#include <QString>
+
+class SysfsAdaptor;
+
+/**
+ * Programmable low and high interrupt thresholds of a chip, such as the
+ * lux0_thresh_below_value and lux0_thresh_above_value attributes of
+ * bh1770glc and apds990x. The chip interrupts only when its reading
+ * leaves the window, so in stable conditions a select mode adaptor is
+ * not woken up at all. After each reading the window is moved around it.
+ *
+ * Configured with the keys of the adaptor:
+ * <ul>
+ *   <li><tt>threshold_low_path</tt>, <tt>threshold_high_path</tt> -
+ *       threshold attributes, the window is disabled unless both are set.</li>
+ *   <li><tt>threshold_window</tt> - half width of the window in percent
+ *       of the reading, default 10.</li>
+ *   <li><tt>threshold_min_width</tt> - least half width in threshold
+ *       units, default 1.</li>
+ *   <li><tt>threshold_max</tt> - largest threshold, default 65535.</li>
+ *   <li><tt>threshold_divider</tt> - readings per threshold unit, for
+ *       drivers reporting scaled values, default 1.</li>
+ * </ul>
+ */
+class ThresholdWindow
+{
+public:
+    /**
+     * Constructor.
+     *
+     * @param name configuration group of the adaptor.
+     */
+    ThresholdWindow(const QString& name);
+
+    /**
+     * Are threshold attributes configured.
+     *
+     * @return is the window in use.
+     */
+    bool isEnabled() const;
+
+    /**
+     * Close the window so that the next reading interrupts at once.
+     * Called before the reader of the adaptor is started, as the window
+     * left from a previous run can hold the current reading.
+     *
+     * @param adaptor adaptor writing the attributes.
+     * @return were the thresholds written.
+     */
+    bool close(const SysfsAdaptor& adaptor);
+
+    /**
+     * Move the window around a reading unless it is inside already.
+     *
+     * @param adaptor adaptor writing the attributes.
+     * @param value reading of the adaptor.
+     * @return were the thresholds written or already in place.
+     */
+    bool centre(const SysfsAdaptor& adaptor, unsigned int value);
+
+    /**
+     * Program given window. Attributes already holding the value are not
+     * written again.
+     *
+     * @param adaptor adaptor writing the attributes.
+     * @param low lowest value not interrupting, in threshold units.
+     * @param high highest value not interrupting, in threshold units.
+     * @return were the thresholds written or already in place.
+     */
+    bool program(const SysfsAdaptor& adaptor, unsigned int low, unsigned int high);
+
+    /**
+     * Window around a reading. Half width is given percent of the
+     * reading, at least minWidth, and the window is clipped to 0 and max.
+     * Readings above max are taken as max, since the thresholds can not
+     * go past it.
+     *
+     * @param value reading in threshold units.
+     * @param percent half width in percent of the reading.
+     * @param minWidth least half width.
+     * @param max largest threshold.
+     * @param low Set to the lowest value not interrupting.
+     * @param high Set to the highest value not interrupting.
+     */
+    static void bounds(unsigned int value, unsigned int percent, unsigned int minWidth, unsigned int max,
+                       unsigned int& low, unsigned int& high);
+
+    /**
+     * Largest threshold.
+     *
+     * @return threshold_max.
+     */
+    unsigned int maximum() const { return max_; }
+
+private:
+    QByteArray   lowPath_;    /**< low threshold attribute */
+    QByteArray   highPath_;   /**< high threshold attribute */
+    unsigned int percent_;    /**< half width in percent of the reading */
+    unsigned int minWidth_;   /**< least half width */
+    unsigned int max_;        /**< largest threshold */
+    unsigned int divider_;    /**< readings per threshold unit */
+    bool         programmed_; /**< do low_ and high_ hold the chip thresholds */
+    unsigned int low_;        /**< programmed low threshold */
+    unsigned int high_;       /**< programmed high threshold */
+};
+
+#endif // THRESHOLDWINDOW_H
@@ -0,0 +1,262 @@
+/**
+   @file timerwheel.cpp
+   @brief TimerWheel
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "timerwheel.h"
+
+TimerWheel::Entry::Entry() :
+    wheel_(0),
+    head_(0),
+    prev_(0),
+    next_(0),
+    level_(0),
+    deadline_(0)
+{
+}
+
+TimerWheel::Entry::~Entry()
+{
+    if (wheel_)
+        wheel_->cancel(this);
+}
+
+TimerWheel::TimerWheel(QObject* parent) :
+    QObject(parent),
+    count_(0),
+    current_(now()),
+    armed_(0),
+    timer_(this)
+{
+    for (int level = 0; level < LEVELS; ++level) {
+        levelCount_[level] = 0;
+        for (int slot = 0; slot < SLOTS; ++slot)
+            slots_[level][slot] = 0;
+    }
+    timer_.setSingleShot(true);
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+    // Coarse timers may fire early, which would only cost a rearm
+    timer_.setTimerType(Qt::PreciseTimer);
+#endif
+    connect(&timer_, SIGNAL(timeout()), this, SLOT(timerTimeout()));
+}
+
+TimerWheel::~TimerWheel()
+{
+    for (int level = 0; level < LEVELS; ++level) {
+        for (int slot = 0; slot < SLOTS; ++slot) {
+            while (Entry* entry = slots_[level][slot]) {
+                unlink(entry);
+                entry->wheel_ = 0;
+            }
+        }
+    }
+}
+
+quint64 TimerWheel::now()
+{
+    return Clock::monotonicMs();
+}
+
+quint64 TimerWheel::alignedDeadline(quint64 now, unsigned int period)
+{
+    if (!period)
+        return now;
+    return (now / period + 1) * period;
+}
+
+void TimerWheel::schedule(Entry* entry, quint64 deadline)
+{
+    if (entry->wheel_ == this) {
+        unlink(entry);
+    } else {
+        if (entry->wheel_)
+            entry->wheel_->cancel(entry);
+        // Idle wheel has not been ticking, catch up before placing
+        if (!count_)
+            current_ = qMax(current_, now());
+        entry->wheel_ = this;
+        ++count_;
+    }
+
+    entry->deadline_ = qMax(deadline, current_ + 1);
+    place(entry);
+
+    // Timer already fires early enough for later deadlines
+    if (!armed_ || !timer_.isActive() || entry->deadline_ < armed_)
+        arm();
+}
+
+void TimerWheel::cancel(Entry* entry)
+{
+    if (entry->wheel_ != this)
+        return;
+    unlink(entry);
+    entry->wheel_ = 0;
+    --count_;
+    // Timer is left armed, a spurious wakeup is cheaper than a rescan
+    if (!count_) {
+        timer_.stop();
+        armed_ = 0;
+    }
+}
+
+int TimerWheel::expire(quint64 now)
+{
+    int expired = 0;
+    while (current_ < now) {
+        if (!count_) {
+            current_ = now;
+            break;
+        }
+        if (!levelCount_[0]) {
+            // Nothing expires before the next cascade
+            quint64 boundary = ((current_ >> SLOT_BITS) + 1) << SLOT_BITS;
+            if (boundary > now) {
+                current_ = now;
+                break;
+            }
+            current_ = boundary - 1;
+        }
+
+        ++current_;
+        if (!(current_ & SLOT_MASK)) {
+            if (!((current_ >> SLOT_BITS) & SLOT_MASK))
+                cascade(2, (current_ >> (2 * SLOT_BITS)) & SLOT_MASK);
+            cascade(1, (current_ >> SLOT_BITS) & SLOT_MASK);
+        }
+
+        // Rescheduled entries go to later ticks, so the slot drains
+        Entry** slot = &slots_[0][current_ & SLOT_MASK];
+        while (Entry* entry = *slot) {
+            unlink(entry);
+            entry->wheel_ = 0;
+            --count_;
+            ++expired;
+            entry->timeout();
+        }
+    }
+    arm();
+    return expired;
+}
+
+void TimerWheel::timerTimeout()
+{
+    armed_ = 0;
+    expire(now());
+}
+
+void TimerWheel::place(Entry* entry)
+{
+    quint64 deadline = entry->deadline_;
+    quint64 delta = deadline - current_;
+    int level;
+    int slot;
+    if (delta < (quint64)SLOTS) {
+        level = 0;
+        slot = deadline & SLOT_MASK;
+    } else if (delta < (1ULL << (2 * SLOT_BITS))) {
+        level = 1;
+        slot = (deadline >> SLOT_BITS) & SLOT_MASK;
+    } else {
+        // Deadlines beyond the wheel wait in its last slot and are
+        // placed again when it cascades
+        level = 2;
+        if (delta >= (1ULL << (3 * SLOT_BITS)))
+            deadline = current_ + (1ULL << (3 * SLOT_BITS)) - 1;
+        slot = (deadline >> (2 * SLOT_BITS)) & SLOT_MASK;
+    }
+
+    Entry** head = &slots_[level][slot];
+    entry->head_ = head;
+    entry->level_ = level;
+    entry->prev_ = 0;
+    entry->next_ = *head;
+    if (*head)
+        (*head)->prev_ = entry;
+    *head = entry;
+    ++levelCount_[level];
+}
+
+void TimerWheel::unlink(Entry* entry)
+{
+    if (entry->prev_)
+        entry->prev_->next_ = entry->next_;
+    else
+        *entry->head_ = entry->next_;
+    if (entry->next_)
+        entry->next_->prev_ = entry->prev_;
+    entry->prev_ = 0;
+    entry->next_ = 0;
+    entry->head_ = 0;
+    --levelCount_[entry->level_];
+}
+
+void TimerWheel::cascade(int level, int slot)
+{
+    while (Entry* entry = slots_[level][slot]) {
+        unlink(entry);
+        place(entry);
+    }
+}
+
+quint64 TimerWheel::nextTick() const
+{
+    quint64 next = 0;
+    if (levelCount_[0]) {
+        for (int i = 1; i < SLOTS; ++i) {
+            quint64 tick = current_ + i;
+            if (slots_[0][tick & SLOT_MASK]) {
+                next = tick;
+                break;
+            }
+        }
+    }
+    // Higher level entries are due no earlier than their slot cascades
+    for (int level = 1; level < LEVELS; ++level) {
+        if (!levelCount_[level])
+            continue;
+        int shift = level * SLOT_BITS;
+        for (int i = 1; i <= SLOTS; ++i) {
+            quint64 tick = ((current_ >> shift) + i) << shift;
+            if (next && tick >= next)
+                break;
+            if (slots_[level][(tick >> shift) & SLOT_MASK]) {
+                next = tick;
+                break;
+            }
+        }
+    }
+    return next;
+}
+
+void TimerWheel::arm()
+{
+    quint64 next = nextTick();
+    if (!next) {
+        timer_.stop();
+        armed_ = 0;
+        return;
+    }
+    if (next == armed_ && timer_.isActive())
+        return;
+    quint64 time = now();
+    armed_ = next;
+    timer_.start(next > time ? next - time : 0);
+}
@@ -0,0 +1,194 @@
+/**
+   @file timerwheel.h
+   @brief TimerWheel
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include <QObject>
+#include "clock.h"
+
+/**
+ * Hierarchical timer wheel with millisecond ticks, driven by a single
+ * ClockTimer on the Clock in use. Entries are kept in intrusive lists, so scheduling and
+ * cancelling are constant time and do not allocate. All entries due in
+ * the same tick expire in one pass, and the timer is only armed for
+ * the next occupied slot.
+ *
+ * Wheel and its entries must be used from the thread owning the wheel.
+ * The timer is a child of the wheel, so it follows the wheel when moved
+ * to another thread.
+ */
+class TimerWheel : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(TimerWheel)
+
+public:
+    /**
+     * Timer scheduled on a wheel. Cancelled when destroyed.
+     */
+    class Entry
+    {
+    public:
+        Entry();
+        virtual ~Entry();
+
+        /**
+         * Is entry waiting on a wheel.
+         *
+         * @return is entry scheduled.
+         */
+        bool isScheduled() const { return wheel_ != 0; }
+
+    protected:
+        /**
+         * Called by the wheel when the deadline has passed. Entry is no
+         * longer scheduled and may schedule itself again.
+         */
+        virtual void timeout() = 0;
+
+    private:
+        friend class TimerWheel;
+
+        TimerWheel* wheel_;    /**< wheel the entry is on, or NULL */
+        Entry**     head_;     /**< list the entry is in */
+        Entry*      prev_;     /**< previous entry in the list */
+        Entry*      next_;     /**< next entry in the list */
+        int         level_;    /**< wheel level */
+        quint64     deadline_; /**< deadline, monotonic ms */
+    };
+
+    /**
+     * Constructor.
+     *
+     * @param parent Parent object.
+     */
+    TimerWheel(QObject* parent = 0);
+
+    /**
+     * Destructor. Scheduled entries are cancelled.
+     */
+    ~TimerWheel();
+
+    /**
+     * Monotonic clock of the wheel.
+     *
+     * @return current time in milliseconds.
+     */
+    static quint64 now();
+
+    /**
+     * Deadline aligned to a multiple of the period on the wheel clock,
+     * so entries with equal periods expire in the same tick. The
+     * deadline is at most period after now.
+     *
+     * @param now current time in milliseconds.
+     * @param period period in milliseconds.
+     * @return deadline in milliseconds.
+     */
+    static quint64 alignedDeadline(quint64 now, unsigned int period);
+
+    /**
+     * Schedule entry, rescheduling it if already scheduled. Deadlines
+     * which have already passed expire on the next tick.
+     *
+     * @param entry entry to schedule.
+     * @param deadline deadline in milliseconds on the wheel clock.
+     */
+    void schedule(Entry* entry, quint64 deadline);
+
+    /**
+     * Cancel scheduled entry. Unscheduled entries are ignored.
+     *
+     * @param entry entry to cancel.
+     */
+    void cancel(Entry* entry);
+
+    /**
+     * Expire entries due by given time. Called by the wheel timer.
+     *
+     * @param now current time in milliseconds.
+     * @return how many entries expired.
+     */
+    int expire(quint64 now);
+
+    /**
+     * Number of scheduled entries.
+     *
+     * @return entry count.
+     */
+    int count() const { return count_; }
+
+private slots:
+    /**
+     * Callback for the wheel timer.
+     */
+    void timerTimeout();
+
+private:
+    static const int LEVELS = 3;      /**< wheel levels */
+    static const int SLOT_BITS = 6;   /**< log2 of slots per level */
+    static const int SLOTS = 1 << SLOT_BITS;
+    static const int SLOT_MASK = SLOTS - 1;
+
+    /**
+     * Put entry into the slot matching its deadline.
+     *
+     * @param entry entry.
+     */
+    void place(Entry* entry);
+
+    /**
+     * Unlink entry from its list.
+     *
+     * @param entry entry.
+     */
+    void unlink(Entry* entry);
+
+    /**
+     * Move entries of a slot to lower levels.
+     *
+     * @param level wheel level.
+     * @param slot slot index.
+     */
+    void cascade(int level, int slot);
+
+    /**
+     * Earliest tick at which an entry expires or cascades.
+     *
+     * @return tick in milliseconds, 0 if the wheel is empty.
+     */
+    quint64 nextTick() const;
+
+    /**
+     * Arm the timer for the next occupied slot.
+     */
+    void arm();
+
+    Entry*     slots_[LEVELS][SLOTS]; /**< entry lists */
+    int        levelCount_[LEVELS];   /**< entries per level */
+    int        count_;                /**< scheduled entries */
+    quint64    current_;              /**< last expired tick */
+    quint64    armed_;                /**< tick the timer is armed for, 0 if not armed */
+    ClockTimer timer_;                /**< wheel timer */
+};
+
+#endif // TIMERWHEEL_H
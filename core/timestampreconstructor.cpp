@@ -0,0 +1,113 @@
+/**
+   @file timestampreconstructor.cpp
+   @brief Timestamps of samples read in bursts
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "timestampreconstructor.h"
+
+/** Share of the measured period taken into the estimate per burst */
+static const double PERIOD_GAIN = 0.1;
+
+/** Most the estimate may deviate from the nominal period */
+static const double MAX_DRIFT = 0.1;
+
+/** Share of the phase error corrected per burst */
+static const double PHASE_GAIN = 0.5;
+
+/** Bursts spanning more periods than they have samples times this follow a gap */
+static const double GAP_FACTOR = 2.0;
+
+TimestampReconstructor::TimestampReconstructor() :
+    nominal_(0),
+    estimate_(0),
+    last_(0)
+{
+}
+
+void TimestampReconstructor::setPeriod(quint64 period)
+{
+    nominal_ = period;
+    estimate_ = period;
+}
+
+quint64 TimestampReconstructor::period() const
+{
+    return nominal_;
+}
+
+quint64 TimestampReconstructor::estimatedPeriod() const
+{
+    return (quint64)(estimate_ + 0.5);
+}
+
+void TimestampReconstructor::reset()
+{
+    last_ = 0;
+}
+
+void TimestampReconstructor::reconstruct(quint64 end, int count, quint64* stamps)
+{
+    if (count <= 0)
+        return;
+
+    bool continuous = last_ && end > last_;
+    if (continuous) {
+        double measured = (double)(end - last_) / count;
+        if (estimate_ <= 0) {
+            // Rate is given by a trigger, learn it from the bursts
+            estimate_ = measured;
+        } else if (measured > estimate_ * GAP_FACTOR) {
+            continuous = false;
+        } else {
+            estimate_ += (measured - estimate_) * PERIOD_GAIN;
+            if (nominal_)
+                estimate_ = qBound(nominal_ * (1 - MAX_DRIFT), estimate_, nominal_ * (1 + MAX_DRIFT));
+        }
+    }
+
+    if (count == 1) {
+        stamps[0] = (last_ && end <= last_) ? last_ + 1 : end;
+        last_ = stamps[0];
+        return;
+    }
+
+    if (!continuous) {
+        // Place burst back from the read time, after the previous one
+        for (int i = 0; i < count; ++i) {
+            double back = estimate_ * (count - 1 - i);
+            stamps[i] = back < end ? end - (quint64)back : 0;
+            if (last_ && stamps[i] <= last_)
+                stamps[i] = last_ + 1 + i;
+        }
+        last_ = stamps[count - 1];
+        return;
+    }
+
+    // Continue from the previous burst, correcting the phase error
+    // linearly over the burst. Late samples are pulled in at once.
+    double error = (double)end - (last_ + estimate_ * count);
+    double correction = error < 0 ? error : error * PHASE_GAIN;
+    quint64 previous = last_;
+    for (int i = 0; i < count; ++i) {
+        quint64 stamp = last_ + (quint64)(estimate_ * (i + 1) + correction * (i + 1) / count + 0.5);
+        stamps[i] = qMax(previous + 1, qMin(stamp, end));
+        previous = stamps[i];
+    }
+    last_ = stamps[count - 1];
+}
@@ -0,0 +1,93 @@
+/**
+   @file timestampreconstructor.h
+   @brief Timestamps of samples read in bursts
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef TIMESTAMPRECONSTRUCTOR_H
+#define TIMESTAMPRECONSTRUCTOR_H
+
+#include <QtGlobal>
+
+/**
+ * Spaces samples read from a hardware FIFO in one burst. The device
+ * captured them one period apart, but all were read at once, so stamping
+ * them with the read time would give the whole burst one timestamp.
+ *
+ * The last sample of a burst is taken to be captured at the read time.
+ * Samples continue from the previous burst one estimated period apart.
+ * The period starts from the configured output data rate and follows the
+ * rate measured over bursts, so a device clock running slightly fast or
+ * slow does not let the timestamps drift away from the read times. The
+ * phase error left at the end of a burst is corrected gradually, except
+ * that timestamps never pass the read time. After a gap, such as a
+ * FIFO overrun or a restart, the burst is placed back from the read time.
+ *
+ * Single samples are stamped with the read time, keeping the estimate
+ * up to date for the next burst.
+ */
+class TimestampReconstructor
+{
+public:
+    /**
+     * Constructor.
+     */
+    TimestampReconstructor();
+
+    /**
+     * Set nominal sample period. Resets the estimate.
+     *
+     * @param period period in microseconds, 0 if not known.
+     */
+    void setPeriod(quint64 period);
+
+    /**
+     * Nominal sample period.
+     *
+     * @return period in microseconds, 0 if not known.
+     */
+    quint64 period() const;
+
+    /**
+     * Estimated sample period.
+     *
+     * @return period in microseconds, 0 if not known yet.
+     */
+    quint64 estimatedPeriod() const;
+
+    /**
+     * Forget the previous burst, the next one is placed from its read time.
+     */
+    void reset();
+
+    /**
+     * Timestamps for a burst of samples.
+     *
+     * @param end read time of the burst, monotonic microseconds.
+     * @param count number of samples in the burst.
+     * @param stamps location for \a count timestamps, oldest first.
+     */
+    void reconstruct(quint64 end, int count, quint64* stamps);
+
+private:
+    quint64 nominal_;  /**< configured period, us */
+    double  estimate_; /**< estimated period, us */
+    quint64 last_;     /**< timestamp of the last sample, 0 after reset */
+};
+
+#endif // TIMESTAMPRECONSTRUCTOR_H
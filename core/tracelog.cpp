@@ -0,0 +1,198 @@
+/**
+   @file tracelog.cpp
+   @brief Sampled trace messages
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "tracelog.h"
+#include "config.h"
+#include "datatypes/atomic.h"
+#include <string.h>
+#include <time.h>
+
+TraceLog::Site TraceLog::sites_[TraceLog::SITES];
+
+TraceLog& TraceLog::instance()
+{
+    static TraceLog log;
+    static bool configured = false;
+    if (!configured && Config::configuration()) {
+        configured = true;
+        unsigned size = Config::configuration()->value<unsigned>("global/trace_log_size", 0);
+        if (size)
+            log.start(size);
+    }
+    return log;
+}
+
+TraceLog::TraceLog() :
+    slots_(0),
+    mask_(0),
+    appendPos_(0),
+    drainPos_(0),
+    enabled_(0),
+    stopping_(0),
+    dropped_(0),
+    reported_(0)
+{
+}
+
+TraceLog::~TraceLog()
+{
+    if (isRunning()) {
+        Atomic::storeRelease(stopping_, 1);
+        wait();
+    }
+    delete [] slots_;
+}
+
+bool TraceLog::start(unsigned size)
+{
+    if (slots_ || !size)
+        return false;
+
+    unsigned count = 1;
+    while (count < size)
+        count <<= 1;
+    slots_ = new Slot[count];
+    mask_ = count - 1;
+    for (unsigned i = 0; i < count; ++i)
+        Atomic::store(slots_[i].sequence, i);
+
+    QThread::start(QThread::LowestPriority);
+    Atomic::storeRelease(enabled_, 1);
+    sensordLogD() << "Sampled tracing into ring of " << count << " messages";
+    return true;
+}
+
+bool TraceLog::isEnabled() const
+{
+    return Atomic::loadAcquire(enabled_);
+}
+
+bool TraceLog::append(const QString& text)
+{
+    if (!isEnabled())
+        return false;
+
+    // Producers claim a position, then fill the slot. The slot is handed
+    // to the drain thread by publishing its sequence.
+    unsigned position = Atomic::loadAcquire(appendPos_);
+    Slot* slot;
+    for (;;) {
+        slot = &slots_[position & mask_];
+        int lag = (int)((unsigned)Atomic::loadAcquire(slot->sequence) - position);
+        if (lag == 0) {
+            if (appendPos_.testAndSetRelaxed(position, position + 1))
+                break;
+            position = Atomic::loadAcquire(appendPos_);
+        } else if (lag < 0) {
+            dropped_.fetchAndAddRelaxed(1);
+            return false;
+        } else {
+            position = Atomic::loadAcquire(appendPos_);
+        }
+    }
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    slot->timestamp = ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+    QByteArray bytes(text.toUtf8());
+    int length = qMin(bytes.size(), TEXT_SIZE - 1);
+    memcpy(slot->text, bytes.constData(), length);
+    slot->text[length] = '\0';
+    Atomic::storeRelease(slot->sequence, position + 1);
+    return true;
+}
+
+unsigned TraceLog::dropped() const
+{
+    return Atomic::loadAcquire(dropped_);
+}
+
+int TraceLog::drain()
+{
+    int written = 0;
+    for (;;) {
+        Slot* slot = &slots_[drainPos_ & mask_];
+        if ((unsigned)Atomic::loadAcquire(slot->sequence) != drainPos_ + 1)
+            break;
+        qDebug("[trace %llu.%06llu] %s", slot->timestamp / 1000000, slot->timestamp % 1000000, slot->text);
+        Atomic::storeRelease(slot->sequence, drainPos_ + mask_ + 1);
+        ++drainPos_;
+        ++written;
+    }
+
+    unsigned lost = dropped();
+    if (lost != reported_) {
+        qDebug("[trace] %u message(s) dropped", lost - reported_);
+        reported_ = lost;
+    }
+    return written;
+}
+
+void TraceLog::run()
+{
+    while (!Atomic::loadAcquire(stopping_)) {
+        drain();
+        msleep(DRAIN_INTERVAL);
+    }
+    drain();
+}
+
+TraceLog::Site& TraceLog::site(const char* file, int line)
+{
+    // File names are literals, their addresses are enough to tell
+    // sites apart
+    quintptr key = (quintptr)file ^ ((quintptr)line * 2654435761u);
+    return sites_[(key ^ (key >> 8)) % SITES];
+}
+
+bool TraceLog::every(const char* file, int line, unsigned n)
+{
+    if (n <= 1)
+        return true;
+    return (unsigned)site(file, line).count.fetchAndAddRelaxed(1) % n == 0;
+}
+
+bool TraceLog::rate(const char* file, int line, unsigned perSecond)
+{
+    Site& state = site(file, line);
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    int second = ts.tv_sec;
+    int window = Atomic::loadAcquire(state.second);
+    if (window != second && state.second.testAndSetRelaxed(window, second))
+        Atomic::storeRelease(state.taken, 0);
+    return (unsigned)state.taken.fetchAndAddRelaxed(1) < perSecond;
+}
+
+TraceMessage::TraceMessage() :
+    debug_(&text_)
+{
+}
+
+TraceMessage::~TraceMessage()
+{
+    TraceLog::instance().append(text_);
+}
+
+QDebug& TraceMessage::stream()
+{
+    return debug_;
+}
@@ -0,0 +1,202 @@
+/**
+   @file tracelog.h
+   @brief Sampled trace messages
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef TRACELOG_H
+#define TRACELOG_H
+
+#include "logging.h"
+#include <QThread>
+#include <QString>
+#include <QAtomicInt>
+
+/**
+ * In-memory ring of trace messages from the data path. Messages are
+ * appended without locks from any thread and written to the log by a
+ * background thread, so tracing does not block on the log. When the
+ * ring is full new messages are dropped and counted.
+ *
+ * Messages come from sensordTraceEvery() and sensordTraceRate(), which
+ * only format every Nth message or at most K messages per second of a
+ * call site. The ring is enabled with global/trace_log_size.
+ */
+class TraceLog : public QThread
+{
+public:
+    /** Max message length in bytes, longer messages are truncated. */
+    static const int TEXT_SIZE = 120;
+
+    /**
+     * Default trace log, configured on first use.
+     *
+     * @return trace log.
+     */
+    static TraceLog& instance();
+
+    /**
+     * Constructor. Trace log is disabled until started.
+     */
+    TraceLog();
+
+    /**
+     * Destructor. Writes out queued messages.
+     */
+    ~TraceLog();
+
+    /**
+     * Enable the ring and start the drain thread.
+     *
+     * @param size how many messages the ring holds, rounded up to a
+     *             power of two.
+     * @return false if already started or size is zero.
+     */
+    bool start(unsigned size);
+
+    /**
+     * Is sampled tracing enabled.
+     *
+     * @return is the ring in use.
+     */
+    bool isEnabled() const;
+
+    /**
+     * Queue message.
+     *
+     * @param text message.
+     * @return false if the ring is full or disabled.
+     */
+    bool append(const QString& text);
+
+    /**
+     * How many messages have been dropped because the ring was full.
+     *
+     * @return dropped message count.
+     */
+    unsigned dropped() const;
+
+    /**
+     * Should every Nth message of a call site be taken.
+     *
+     * @param file source file of the call site.
+     * @param line source line of the call site.
+     * @param n period, 0 and 1 take every message.
+     * @return is message taken.
+     */
+    static bool every(const char* file, int line, unsigned n);
+
+    /**
+     * Should message of a call site be taken without exceeding given
+     * messages per second.
+     *
+     * @param file source file of the call site.
+     * @param line source line of the call site.
+     * @param perSecond max messages per second.
+     * @return is message taken.
+     */
+    static bool rate(const char* file, int line, unsigned perSecond);
+
+protected:
+    void run();
+
+private:
+    /**
+     * Ring slot. Sequence tells whose turn the slot is: equal to the
+     * append position when free, one past it when filled.
+     */
+    struct Slot
+    {
+        QAtomicInt sequence;        /**< slot state */
+        quint64    timestamp;       /**< monotonic time of the message, us */
+        char       text[TEXT_SIZE]; /**< message, NUL terminated */
+    };
+
+    /**
+     * Sampling state of a call site. Call sites are hashed into a fixed
+     * table, colliding sites share their state.
+     */
+    struct Site
+    {
+        QAtomicInt count;  /**< messages seen */
+        QAtomicInt second; /**< current rate window, monotonic seconds */
+        QAtomicInt taken;  /**< messages taken in the rate window */
+    };
+
+    /**
+     * Write out queued messages. Drain thread only.
+     *
+     * @return how many messages were written.
+     */
+    int drain();
+
+    static Site& site(const char* file, int line);
+
+    /** Max interval between drains, ms */
+    static const int DRAIN_INTERVAL = 100;
+
+    /** Number of call site states */
+    static const int SITES = 256;
+
+    Slot*      slots_;      /**< ring slots */
+    unsigned   mask_;       /**< slot count - 1 */
+    QAtomicInt appendPos_;  /**< next append position */
+    unsigned   drainPos_;   /**< next drain position */
+    QAtomicInt enabled_;    /**< is the ring in use */
+    QAtomicInt stopping_;   /**< should drain thread exit */
+    QAtomicInt dropped_;    /**< messages dropped on full ring */
+    unsigned   reported_;   /**< dropped count last logged */
+
+    static Site sites_[SITES]; /**< call site states */
+};
+
+/**
+ * Formats one trace message and queues it into TraceLog when destroyed.
+ */
+class TraceMessage
+{
+public:
+    TraceMessage();
+    ~TraceMessage();
+
+    /**
+     * Message stream.
+     *
+     * @return stream.
+     */
+    QDebug& stream();
+
+private:
+    Q_DISABLE_COPY(TraceMessage)
+
+    QString text_;  /**< formatted message */
+    QDebug  debug_; /**< stream into text_ */
+};
+
+/** Messages per second for sampled traces of sensor values */
+#define SENSORD_TRACE_RATE 5
+
+/** Queue every Nth message of the call site into TraceLog */
+#define sensordTraceEvery(n) \
+    sensordLogIf(TraceLog::instance().isEnabled() && TraceLog::every(__FILE__, __LINE__, n), TraceMessage().stream())
+
+/** Queue at most K messages per second of the call site into TraceLog */
+#define sensordTraceRate(k) \
+    sensordLogIf(TraceLog::instance().isEnabled() && TraceLog::rate(__FILE__, __LINE__, k), TraceMessage().stream())
+
+#endif // TRACELOG_H
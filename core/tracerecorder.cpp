@@ -0,0 +1,209 @@
+/**
+   @file tracerecorder.cpp
+   @brief Ring buffer trace recorder
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "tracerecorder.h"
+#include "logging.h"
+#include "datatypes/atomic.h"
+#include <QFile>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+TraceRecorder::TraceRecorder(const QString& path, unsigned capacity, unsigned files) :
+    path_(path),
+    capacity_(qMax(1u, capacity)),
+    files_(qMax(1u, files)),
+    strand_(0),
+    buffer_(0),
+    reader_(0),
+    fd_(-1),
+    map_(0),
+    mapSize_(0),
+    recordSize_(0),
+    used_(0),
+    recorded_(0),
+    failed_(0),
+    rotations_(0)
+{
+}
+
+TraceRecorder::~TraceRecorder()
+{
+    stop();
+}
+
+bool TraceRecorder::start(RingBufferBase* buffer)
+{
+    if (buffer_ || !buffer)
+        return false;
+
+    reader_ = buffer->createRawReader(this);
+    if (!reader_) {
+        sensordLogW() << "Objects of the buffer cannot be recorded as raw data";
+        return false;
+    }
+
+    if (!scheduler_.start(1)) {
+        delete reader_;
+        reader_ = 0;
+        return false;
+    }
+    strand_ = new ChainStrand("recorder " + path_, scheduler_.workerFor(path_));
+    reader_->reader()->setStrand(strand_);
+    strand_->add(reader_->reader());
+    buffer_ = buffer;
+    if (!buffer_->join(reader_->reader())) {
+        stop();
+        return false;
+    }
+    sensordLogD() << "Recording trace into " << path_;
+    return true;
+}
+
+void TraceRecorder::stop()
+{
+    if (!buffer_)
+        return;
+
+    buffer_->unjoin(reader_->reader());
+    strand_->remove(reader_->reader());
+    delete strand_;
+    strand_ = 0;
+    scheduler_.stop();
+    failed_.fetchAndAddRelaxed(reader_->reader()->lost());
+    delete reader_;
+    reader_ = 0;
+    buffer_ = 0;
+
+    closeFile();
+    sensordLogD() << "Recorded " << recorded() << " objects into " << path_ << ", dropped " << dropped();
+}
+
+const QString& TraceRecorder::path() const
+{
+    return path_;
+}
+
+unsigned TraceRecorder::recorded() const
+{
+    return Atomic::load(recorded_);
+}
+
+unsigned TraceRecorder::dropped() const
+{
+    return Atomic::load(failed_) + (reader_ ? reader_->reader()->lost() : 0);
+}
+
+unsigned TraceRecorder::rotations() const
+{
+    return Atomic::load(rotations_);
+}
+
+void TraceRecorder::writeRaw(unsigned n, const void* values, unsigned size)
+{
+    // File is created on the first write, when the object size is known.
+    if (!recordSize_) {
+        recordSize_ = size;
+        openFile(size);
+    }
+    if (!map_ || size != recordSize_) {
+        failed_.fetchAndAddRelaxed(n);
+        return;
+    }
+
+    const char* from = (const char*)values;
+    while (n) {
+        unsigned count = qMin(n, capacity_ - used_);
+        memcpy(map_ + sizeof(SensorTraceHeader) + (size_t)used_ * recordSize_, from, (size_t)count * recordSize_);
+        used_ += count;
+        ((SensorTraceHeader*)map_)->count = used_;
+        recorded_.fetchAndAddRelaxed(count);
+        from += (size_t)count * recordSize_;
+        n -= count;
+        if (used_ == capacity_ && !rotate()) {
+            failed_.fetchAndAddRelaxed(n);
+            return;
+        }
+    }
+}
+
+bool TraceRecorder::openFile(unsigned recordSize)
+{
+    QByteArray path = QFile::encodeName(path_);
+    fd_ = ::open(path.constData(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        sensordLogW() << "Failed to create trace " << path_ << ": " << strerror(errno);
+        return false;
+    }
+
+    size_t size = sizeof(SensorTraceHeader) + (size_t)capacity_ * recordSize;
+    // Allocate blocks up front so that page faults on the mapping do not
+    // hit the filesystem allocator.
+    void* map = MAP_FAILED;
+    if (posix_fallocate(fd_, 0, size) == 0 || ftruncate(fd_, size) == 0)
+        map = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (map == MAP_FAILED) {
+        sensordLogW() << "Failed to allocate trace " << path_ << ": " << strerror(errno);
+        ::close(fd_);
+        fd_ = -1;
+        return false;
+    }
+
+    map_ = (char*)map;
+    mapSize_ = size;
+    recordSize_ = recordSize;
+    used_ = 0;
+    SensorTraceHeader* header = (SensorTraceHeader*)map_;
+    header->magic = SensorTrace::MAGIC;
+    header->version = SensorTrace::VERSION;
+    header->recordSize = recordSize;
+    header->count = 0;
+    return true;
+}
+
+void TraceRecorder::closeFile()
+{
+    if (!map_)
+        return;
+    munmap(map_, mapSize_);
+    map_ = 0;
+    mapSize_ = 0;
+    if (ftruncate(fd_, sizeof(SensorTraceHeader) + (size_t)used_ * recordSize_) < 0)
+        sensordLogW() << "Failed to truncate trace " << path_ << ": " << strerror(errno);
+    ::close(fd_);
+    fd_ = -1;
+}
+
+bool TraceRecorder::rotate()
+{
+    closeFile();
+    for (unsigned i = files_ - 1; i > 0; --i) {
+        QByteArray from = QFile::encodeName(i > 1 ? QString("%1.%2").arg(path_).arg(i - 1) : path_);
+        QByteArray to = QFile::encodeName(QString("%1.%2").arg(path_).arg(i));
+        if (::rename(from.constData(), to.constData()) < 0 && errno != ENOENT)
+            sensordLogW() << "Failed to rotate trace " << from << ": " << strerror(errno);
+    }
+    rotations_.fetchAndAddRelaxed(1);
+    return openFile(recordSize_);
+}
@@ -0,0 +1,148 @@
+/**
+   @file tracerecorder.h
+   @brief Ring buffer trace recorder
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef TRACERECORDER_H
+#define TRACERECORDER_H
+
+#include "ringbuffer.h"
+#include "chainscheduler.h"
+#include "datatypes/sensortrace.h"
+#include <QAtomicInt>
+#include <QString>
+
+/**
+ * Records objects written into a ring buffer into trace files in the
+ * SensorTrace format, one raw object per record. Traces of TimedXyzData
+ * buffers can be replayed with replayadaptor.
+ *
+ * The recorder reads the buffer in a strand of its own worker thread, so
+ * the writer of the buffer only marks the reader pending. When the
+ * recorder falls behind, the buffer overwrites unread objects and they
+ * are counted as dropped instead of stalling the data path.
+ *
+ * Each file is preallocated for a fixed number of records and memory
+ * mapped. When full it is rotated: <em>path</em> is renamed to
+ * <em>path</em>.1, <em>path</em>.1 to <em>path</em>.2 and so on, and
+ * the oldest file is removed.
+ */
+class TraceRecorder : public RawObjectWriter
+{
+public:
+    /**
+     * Constructor.
+     *
+     * @param path trace file path.
+     * @param capacity records per file.
+     * @param files number of files kept, including the one being written.
+     */
+    TraceRecorder(const QString& path, unsigned capacity, unsigned files);
+
+    /**
+     * Destructor. Stops recording.
+     */
+    ~TraceRecorder();
+
+    /**
+     * Start recording objects written into given buffer.
+     *
+     * @param buffer recorded buffer, must outlive recording.
+     * @return false if already recording or objects of the buffer are not
+     *         trivially copyable. Trace file is created on the first write.
+     */
+    bool start(RingBufferBase* buffer);
+
+    /**
+     * Stop recording and truncate the trace file to the written records.
+     */
+    void stop();
+
+    /**
+     * Trace file path.
+     *
+     * @return path.
+     */
+    const QString& path() const;
+
+    /**
+     * Number of recorded objects.
+     *
+     * @return recorded object count.
+     */
+    unsigned recorded() const;
+
+    /**
+     * Number of objects lost because the recorder could not keep up with
+     * the buffer or the trace file could not be written.
+     *
+     * @return dropped object count.
+     */
+    unsigned dropped() const;
+
+    /**
+     * Number of completed trace files.
+     *
+     * @return rotation count.
+     */
+    unsigned rotations() const;
+
+    void writeRaw(unsigned n, const void* values, unsigned size);
+
+private:
+    Q_DISABLE_COPY(TraceRecorder)
+
+    /**
+     * Create and map a preallocated trace file.
+     *
+     * @param recordSize record size in bytes.
+     * @return was the file created.
+     */
+    bool openFile(unsigned recordSize);
+
+    /**
+     * Unmap the trace file and truncate it to the written records.
+     */
+    void closeFile();
+
+    /**
+     * Close the full trace file, shift older files and open a new one.
+     *
+     * @return was the new file created.
+     */
+    bool rotate();
+
+    QString                  path_;       /**< trace file path */
+    unsigned                 capacity_;   /**< records per file */
+    unsigned                 files_;      /**< files kept */
+    ChainScheduler           scheduler_;  /**< runs the recording thread */
+    ChainStrand*             strand_;     /**< strand of the reader */
+    RingBufferBase*          buffer_;     /**< recorded buffer or NULL */
+    RawRingBufferReaderBase* reader_;     /**< reader of the buffer */
+    int                      fd_;         /**< trace file or -1 */
+    char*                    map_;        /**< mapped trace file */
+    size_t                   mapSize_;    /**< mapped size in bytes */
+    unsigned                 recordSize_; /**< record size in bytes */
+    unsigned                 used_;       /**< records in the current file */
+    QAtomicInt               recorded_;   /**< recorded objects */
+    QAtomicInt               failed_;     /**< objects not written */
+    QAtomicInt               rotations_;  /**< completed files */
+};
+
+#endif // TRACERECORDER_H
@@ -0,0 +1,243 @@
+/**
+   @file uringreader.cpp
+   @brief Batched sysfs reads through io_uring
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "uringreader.h"
+#include "logging.h"
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef SENSORD_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+
+static int uringSetup(unsigned entries, struct io_uring_params* params)
+{
+    return syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int uringEnter(int fd, unsigned submit, unsigned complete, unsigned flags)
+{
+    return syscall(__NR_io_uring_enter, fd, submit, complete, flags, NULL, 0);
+}
+
+static int uringRegister(int fd, unsigned opcode, const void* arg, unsigned count)
+{
+    return syscall(__NR_io_uring_register, fd, opcode, arg, count);
+}
+#endif
+
+UringReader::UringReader() :
+    ringFd_(-1),
+    sqRing_(0),
+    cqRing_(0),
+    sqSize_(0),
+    cqSize_(0),
+    sqes_(0),
+    sqesSize_(0),
+    sqTail_(0),
+    sqArray_(0),
+    sqMask_(0),
+    cqHead_(0),
+    cqTail_(0),
+    cqMask_(0),
+    cqes_(0),
+    count_(0),
+    bufferSize_(0)
+{
+}
+
+UringReader::~UringReader()
+{
+    close();
+}
+
+bool UringReader::open(const QVector<int>& fds, int bufferSize)
+{
+    close();
+    if (fds.isEmpty() || bufferSize < 2)
+        return false;
+
+#ifdef SENSORD_IO_URING
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    unsigned entries = 1;
+    while (entries < (unsigned)fds.size())
+        entries <<= 1;
+    ringFd_ = uringSetup(entries, &params);
+    if (ringFd_ < 0) {
+        sensordLogD() << "io_uring not available: " << strerror(errno);
+        ringFd_ = -1;
+        return false;
+    }
+
+    sqSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqSize_ = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single)
+        sqSize_ = cqSize_ = qMax(sqSize_, cqSize_);
+    void* sqRing = mmap(0, sqSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_SQ_RING);
+    sqRing_ = sqRing == MAP_FAILED ? 0 : sqRing;
+    void* cqRing = single ? sqRing : mmap(0, cqSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_CQ_RING);
+    cqRing_ = cqRing == MAP_FAILED ? 0 : cqRing;
+    sqesSize_ = params.sq_entries * sizeof(struct io_uring_sqe);
+    void* sqes = mmap(0, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_SQES);
+    sqes_ = sqes == MAP_FAILED ? 0 : (struct io_uring_sqe*)sqes;
+    if (!sqRing_ || !cqRing_ || !sqes_) {
+        sensordLogW() << "Can not map io_uring: " << strerror(errno);
+        close();
+        return false;
+    }
+
+    char* sq = (char*)sqRing_;
+    char* cq = (char*)cqRing_;
+    sqTail_ = (unsigned*)(sq + params.sq_off.tail);
+    sqArray_ = (unsigned*)(sq + params.sq_off.array);
+    sqMask_ = *(unsigned*)(sq + params.sq_off.ring_mask);
+    cqHead_ = (unsigned*)(cq + params.cq_off.head);
+    cqTail_ = (unsigned*)(cq + params.cq_off.tail);
+    cqMask_ = *(unsigned*)(cq + params.cq_off.ring_mask);
+    cqes_ = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+
+    // Buffers are pinned by the kernel, so they are registered once
+    // and never reallocated
+    buffers_.fill(0, fds.size() * bufferSize);
+    QVector<struct iovec> iovecs(fds.size());
+    for (int i = 0; i < fds.size(); ++i) {
+        iovecs[i].iov_base = buffers_.data() + i * bufferSize;
+        iovecs[i].iov_len = bufferSize;
+    }
+    if (uringRegister(ringFd_, IORING_REGISTER_BUFFERS, iovecs.constData(), iovecs.size()) < 0 ||
+        uringRegister(ringFd_, IORING_REGISTER_FILES, fds.constData(), fds.size()) < 0) {
+        sensordLogD() << "Can not register io_uring files: " << strerror(errno);
+        close();
+        return false;
+    }
+
+    count_ = fds.size();
+    bufferSize_ = bufferSize;
+    results_.fill(0, count_);
+    return true;
+#else
+    return false;
+#endif
+}
+
+void UringReader::close()
+{
+#ifdef SENSORD_IO_URING
+    if (sqes_)
+        munmap(sqes_, sqesSize_);
+    if (cqRing_ && cqRing_ != sqRing_)
+        munmap(cqRing_, cqSize_);
+    if (sqRing_)
+        munmap(sqRing_, sqSize_);
+#endif
+    if (ringFd_ >= 0)
+        ::close(ringFd_);
+    ringFd_ = -1;
+    sqRing_ = 0;
+    cqRing_ = 0;
+    sqes_ = 0;
+    count_ = 0;
+    buffers_.clear();
+    results_.clear();
+}
+
+bool UringReader::isOpen() const
+{
+    return ringFd_ >= 0;
+}
+
+bool UringReader::readAll()
+{
+    if (ringFd_ < 0)
+        return false;
+
+#ifdef SENSORD_IO_URING
+    // Only this thread writes the submission tail
+    unsigned tail = *sqTail_;
+    for (int i = 0; i < count_; ++i) {
+        unsigned index = tail & sqMask_;
+        struct io_uring_sqe* sqe = &sqes_[index];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_READ_FIXED;
+        sqe->flags = IOSQE_FIXED_FILE;
+        sqe->fd = i;
+        sqe->addr = (quint64)(quintptr)data(i);
+        sqe->len = bufferSize_ - 1;
+        sqe->off = 0;
+        sqe->buf_index = i;
+        sqe->user_data = i;
+        sqArray_[index] = index;
+        results_[i] = -ECANCELED;
+        ++tail;
+    }
+    __atomic_store_n(sqTail_, tail, __ATOMIC_RELEASE);
+
+    unsigned submit = count_;
+    int reaped = 0;
+    while (reaped < count_) {
+        int ret = uringEnter(ringFd_, submit, count_ - reaped, IORING_ENTER_GETEVENTS);
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            sensordLogW() << "io_uring_enter(): " << strerror(errno);
+            return false;
+        }
+        if ((unsigned)ret > submit || (!ret && submit))
+            return false;
+        submit -= ret;
+        reaped += reap();
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+int UringReader::reap()
+{
+    int taken = 0;
+#ifdef SENSORD_IO_URING
+    unsigned head = *cqHead_;
+    unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head, ++taken) {
+        const struct io_uring_cqe& cqe = cqes_[head & cqMask_];
+        if (cqe.user_data < (quint64)count_)
+            results_[cqe.user_data] = cqe.res;
+    }
+    __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+#endif
+    return taken;
+}
+
+int UringReader::result(int index) const
+{
+    return results_.at(index);
+}
+
+char* UringReader::data(int index)
+{
+    return buffers_.data() + index * bufferSize_;
+}
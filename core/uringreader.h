@@ -0,0 +1,131 @@
+/**
+   @file uringreader.h
+   @brief Batched sysfs reads through io_uring
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef URINGREADER_H
+#define URINGREADER_H
+
+#include <QVector>
+#include <stddef.h>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+/**
+ * Reads a set of files from offset 0 with one system call. Files and
+ * one buffer per file are registered with an io_uring when opened, and
+ * #readAll() submits a fixed buffer read of every file and reaps all the
+ * completions together, instead of one pread() per file.
+ *
+ * Available when sensord is built with CONFIG+=iouring and the kernel
+ * supports io_uring, otherwise #open() fails and the caller keeps
+ * reading the files itself. Not thread safe, the ring is used by the
+ * reader thread of its owner only.
+ */
+class UringReader
+{
+public:
+    /**
+     * Constructor. Reader is closed.
+     */
+    UringReader();
+
+    /**
+     * Destructor. Closes the ring.
+     */
+    ~UringReader();
+
+    /**
+     * Set up a ring reading given files.
+     *
+     * @param fds files to read, must stay open while the ring is.
+     * @param bufferSize size of the buffer of each file, one byte of
+     *        which is left for a terminator.
+     * @return was the ring set up.
+     */
+    bool open(const QVector<int>& fds, int bufferSize);
+
+    /**
+     * Release the ring and its buffers.
+     */
+    void close();
+
+    /**
+     * Is a ring set up.
+     *
+     * @return is the reader open.
+     */
+    bool isOpen() const;
+
+    /**
+     * Read every file from offset 0.
+     *
+     * @return was every read submitted and completed, results of
+     *         individual files are given by #result().
+     */
+    bool readAll();
+
+    /**
+     * Result of the last read of a file.
+     *
+     * @param index index of the file in the opened set.
+     * @return bytes read or negative errno.
+     */
+    int result(int index) const;
+
+    /**
+     * Buffer of a file, holding the bytes of the last read.
+     *
+     * @param index index of the file in the opened set.
+     * @return buffer of #open() bufferSize bytes.
+     */
+    char* data(int index);
+
+private:
+    Q_DISABLE_COPY(UringReader)
+
+    /**
+     * Take completions from the completion queue.
+     *
+     * @return number of completions taken.
+     */
+    int reap();
+
+    int            ringFd_;     /**< io_uring or -1 */
+    void*          sqRing_;     /**< mapped submission queue ring */
+    void*          cqRing_;     /**< mapped completion queue ring, may be sqRing_ */
+    size_t         sqSize_;     /**< size of the sqRing_ mapping */
+    size_t         cqSize_;     /**< size of the cqRing_ mapping */
+    io_uring_sqe*  sqes_;       /**< mapped submission queue entries */
+    size_t         sqesSize_;   /**< size of the sqes_ mapping */
+    unsigned*      sqTail_;     /**< submission queue tail */
+    unsigned*      sqArray_;    /**< submission queue index array */
+    unsigned       sqMask_;     /**< submission ring mask */
+    unsigned*      cqHead_;     /**< completion queue head */
+    unsigned*      cqTail_;     /**< completion queue tail */
+    unsigned       cqMask_;     /**< completion ring mask */
+    io_uring_cqe*  cqes_;       /**< completion queue entries */
+    int            count_;      /**< number of registered files */
+    int            bufferSize_; /**< size of each buffer */
+    QVector<char>  buffers_;    /**< registered buffers, bufferSize_ per file */
+    QVector<int>   results_;    /**< result of the last read of each file */
+};
+
+#endif // URINGREADER_H
@@ -0,0 +1,405 @@
+/**
+   @file xyzlanes.h
+   @brief Structure-of-arrays batches of xyz samples
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef XYZLANES_H
+#define XYZLANES_H
+
+#include "filter.h"
+#include "datatypes/atomic.h"
+#include <string.h>
+
+/**
+ * Batch of xyz samples stored as structure of arrays. Each axis is a
+ * contiguous lane, so per-axis math over a batch compiles to vector
+ * instructions.
+ *
+ * @tparam VALUE axis value type.
+ */
+template <class VALUE = int>
+struct XyzLanes
+{
+    static const unsigned SIZE = FILTER_BATCH_SIZE; /**< max samples per batch */
+
+    unsigned count;                               /**< samples in the batch */
+    quint64  timestamp[SIZE];                     /**< sample timestamps */
+    VALUE    x[SIZE] __attribute__((aligned(16))); /**< x values */
+    VALUE    y[SIZE] __attribute__((aligned(16))); /**< y values */
+    VALUE    z[SIZE] __attribute__((aligned(16))); /**< z values */
+
+    /**
+     * Lane of an axis.
+     *
+     * @param axis 0 for x, 1 for y, 2 for z.
+     * @return lane values.
+     */
+    VALUE* lane(int axis) { return axis == 0 ? x : (axis == 1 ? y : z); }
+    const VALUE* lane(int axis) const { return axis == 0 ? x : (axis == 1 ? y : z); }
+
+    /**
+     * Fill the batch from samples with timestamp_, x_, y_ and z_ members.
+     *
+     * @param n number of samples, at most #SIZE.
+     * @param values samples.
+     */
+    template <class TYPE>
+    void load(unsigned n, const TYPE* values)
+    {
+        count = n;
+        for (unsigned i = 0; i < n; ++i) {
+            timestamp[i] = values[i].timestamp_;
+            x[i] = values[i].x_;
+            y[i] = values[i].y_;
+            z[i] = values[i].z_;
+        }
+    }
+
+    /**
+     * Write the batch to samples with timestamp_, x_, y_ and z_ members.
+     * Other members of the samples are left as they are.
+     *
+     * @param values location for #count samples.
+     */
+    template <class TYPE>
+    void store(TYPE* values) const
+    {
+        for (unsigned i = 0; i < count; ++i) {
+            values[i].timestamp_ = timestamp[i];
+            values[i].x_ = x[i];
+            values[i].y_ = y[i];
+            values[i].z_ = z[i];
+        }
+    }
+};
+
+template <class VALUE>
+const unsigned XyzLanes<VALUE>::SIZE;
+
+/**
+ * Interface of sinks accepting lane batches, see LaneSource.
+ *
+ * @tparam VALUE axis value type.
+ */
+template <class VALUE>
+class LaneConsumer
+{
+public:
+    /**
+     * Push lane batch to the sink.
+     *
+     * @param lanes samples.
+     */
+    virtual void collectLanes(const XyzLanes<VALUE>& lanes) = 0;
+
+    /**
+     * Does the sink consume the lanes, see DemandNode.
+     *
+     * @return is the sink demanded.
+     */
+    virtual bool demanded() const { return true; }
+
+protected:
+    /**
+     * Destructor.
+     */
+    virtual ~LaneConsumer() {}
+};
+
+/**
+ * Sink of filters processing lanes. Joins sources of array of samples
+ * like any Sink, their samples are converted into lanes at most
+ * XyzLanes::SIZE at a time. LaneSource passes lanes without conversion.
+ *
+ * @tparam DERIVED sink implementor type.
+ * @tparam TYPE sample type of sources using arrays of samples.
+ * @tparam VALUE axis value type.
+ */
+template <class DERIVED, class TYPE, class VALUE = int>
+class LaneSink : public SinkTyped<TYPE>, public LaneConsumer<VALUE>
+{
+public:
+    /**
+     * Lane callback function type.
+     */
+    typedef void (DERIVED::* Member)(const XyzLanes<VALUE>& lanes);
+
+    /**
+     * Callback function type for arrays of samples.
+     */
+    typedef void (DERIVED::* ArrayMember)(unsigned n, const TYPE* values);
+
+    /**
+     * Constructor.
+     *
+     * @param instance implementor reference.
+     * @param member lane callback.
+     * @param arrayMember callback for arrays of samples, NULL to have
+     *                    them converted for the lane callback.
+     */
+    LaneSink(DERIVED* instance, Member member, ArrayMember arrayMember = 0) :
+        instance_(instance),
+        member_(member),
+        arrayMember_(arrayMember)
+    {}
+
+    /**
+     * Convert samples into lanes for the lane callback.
+     *
+     * @param n number of samples.
+     * @param values samples.
+     */
+    void collectAsLanes(unsigned n, const TYPE* values)
+    {
+        XyzLanes<VALUE> lanes;
+        for (unsigned done = 0; done < n; done += XyzLanes<VALUE>::SIZE) {
+            lanes.load(qMin(n - done, XyzLanes<VALUE>::SIZE), values + done);
+            (instance_->*member_)(lanes);
+        }
+    }
+
+    bool demanded() const
+    {
+        return demandOf(instance_);
+    }
+
+private:
+    void collect(int n, const TYPE* values)
+    {
+        if (arrayMember_)
+            (instance_->*arrayMember_)(n, values);
+        else
+            collectAsLanes(n, values);
+    }
+
+    void collectLanes(const XyzLanes<VALUE>& lanes)
+    {
+        (instance_->*member_)(lanes);
+    }
+
+    DERIVED*    instance_;    /** sink callback implementor */
+    Member      member_;      /** lane callback function */
+    ArrayMember arrayMember_; /** array callback function or NULL */
+};
+
+/**
+ * Source of lane batches. LaneSink and other LaneConsumer sinks get the
+ * lanes as they are. For other sinks of TYPE samples the lanes are
+ * converted, once per batch, so filters processing lanes can be mixed
+ * with filters processing arrays of samples.
+ *
+ * @tparam TYPE sample type of sinks using arrays of samples.
+ * @tparam VALUE axis value type.
+ */
+template <class TYPE, class VALUE = int>
+class LaneSource : public SourceBase
+{
+public:
+    /**
+     * Propagate lanes to connected sinks.
+     *
+     * @param lanes samples.
+     */
+    void propagate(const XyzLanes<VALUE>& lanes)
+    {
+        if (!lanes.count)
+            return;
+        const Topology t(snapshot());
+        bool convert = false;
+        for (int i = 0; i < t.laneSinks.size(); ++i) {
+            if (t.laneSinks.at(i)->demanded()) {
+                t.laneCounters.at(i).count(lanes.count);
+                t.laneSinks.at(i)->collectLanes(lanes);
+            }
+        }
+        for (int i = 0; i < t.sinks.size() && !convert; ++i)
+            convert = t.sinks.at(i)->demanded();
+        if (!convert)
+            return;
+        TYPE values[XyzLanes<VALUE>::SIZE];
+        lanes.store(values);
+        for (int i = 0; i < t.sinks.size(); ++i) {
+            if (t.sinks.at(i)->demanded()) {
+                t.counters.at(i).count(lanes.count);
+                t.sinks.at(i)->collect(lanes.count, values);
+            }
+        }
+    }
+
+    /**
+     * Propagate array of samples to connected sinks. Lane sinks get the
+     * samples converted.
+     *
+     * @param n how many elements to stream.
+     * @param values source from where to stream data.
+     */
+    void propagate(int n, const TYPE* values)
+    {
+        if (n <= 0)
+            return;
+        const Topology t(snapshot());
+        bool convert = false;
+        for (int i = 0; i < t.sinks.size(); ++i) {
+            if (t.sinks.at(i)->demanded()) {
+                t.counters.at(i).count(n);
+                t.sinks.at(i)->collect(n, values);
+            }
+        }
+        for (int i = 0; i < t.laneSinks.size() && !convert; ++i)
+            convert = t.laneSinks.at(i)->demanded();
+        if (!convert)
+            return;
+        XyzLanes<VALUE> lanes;
+        for (unsigned done = 0; done < (unsigned)n; done += XyzLanes<VALUE>::SIZE) {
+            lanes.load(qMin(n - done, XyzLanes<VALUE>::SIZE), values + done);
+            for (int i = 0; i < t.laneSinks.size(); ++i) {
+                if (t.laneSinks.at(i)->demanded()) {
+                    t.laneCounters.at(i).count(lanes.count);
+                    t.laneSinks.at(i)->collectLanes(lanes);
+                }
+            }
+        }
+    }
+
+    bool demanded() const
+    {
+        QMutexLocker locker(&mutex_);
+        for (int i = 0; i < laneSinks_.size(); ++i) {
+            if (laneSinks_.at(i)->demanded())
+                return true;
+        }
+        for (int i = 0; i < sinks_.size(); ++i) {
+            if (sinks_.at(i)->demanded())
+                return true;
+        }
+        return false;
+    }
+
+    void connections(QList<SourceConnection>& connections) const
+    {
+        QMutexLocker locker(&mutex_);
+        appendConnections(laneSinks_, laneCounters_, connections);
+        appendConnections(sinks_, counters_, connections);
+    }
+
+private:
+    /**
+     * Connected sinks, shared with the members below until the next
+     * join or unjoin, see Source.
+     */
+    struct Topology
+    {
+        QVector<LaneConsumer<VALUE>*> laneSinks;    /**< lane sinks */
+        QVector<SourceCounters>       laneCounters; /**< counters of laneSinks */
+        QVector<SinkTyped<TYPE>*>     sinks;        /**< array sinks */
+        QVector<SourceCounters>       counters;     /**< counters of sinks */
+    };
+
+    /**
+     * Take snapshot of the connected sinks to propagate to.
+     *
+     * @return sinks at the time of the call.
+     */
+    Topology snapshot() const
+    {
+        QMutexLocker locker(&mutex_);
+        Topology topology;
+        topology.laneSinks = laneSinks_;
+        topology.laneCounters = laneCounters_;
+        topology.sinks = sinks_;
+        topology.counters = counters_;
+        return topology;
+    }
+
+    /**
+     * Append connections of one kind of sinks.
+     *
+     * @param sinks connected sinks.
+     * @param counters counters of the sinks.
+     * @param connections list to append connections to.
+     */
+    template <class SINK>
+    static void appendConnections(const QVector<SINK*>& sinks, const QVector<SourceCounters>& counters,
+                                  QList<SourceConnection>& connections)
+    {
+        for (int i = 0; i < sinks.size(); ++i) {
+            SourceConnection connection;
+            connection.sink = dynamic_cast<SinkBase*>(sinks.at(i));
+            connection.samples = Atomic::load(counters.at(i).samples);
+            connection.batches = Atomic::load(counters.at(i).batches);
+            connections.append(connection);
+        }
+    }
+
+    bool joinTypeChecked(SinkBase* sink)
+    {
+        QMutexLocker locker(&mutex_);
+        LaneConsumer<VALUE>* lanes = dynamic_cast<LaneConsumer<VALUE>*>(sink);
+        if (lanes) {
+            if (!laneSinks_.contains(lanes)) {
+                laneSinks_.append(lanes);
+                laneCounters_.append(SourceCounters());
+            }
+            return true;
+        }
+        SinkTyped<TYPE>* type = dynamic_cast<SinkTyped<TYPE>*>(sink);
+        if (type) {
+            if (!sinks_.contains(type)) {
+                sinks_.append(type);
+                counters_.append(SourceCounters());
+            }
+            return true;
+        }
+        sensordLogC() << "Failed to join type '" << typeid(type).name() << " to lane source!";
+        return false;
+    }
+
+    bool unjoinTypeChecked(SinkBase* sink)
+    {
+        QMutexLocker locker(&mutex_);
+        LaneConsumer<VALUE>* lanes = dynamic_cast<LaneConsumer<VALUE>*>(sink);
+        if (lanes) {
+            int index = laneSinks_.indexOf(lanes);
+            if (index >= 0) {
+                laneSinks_.remove(index);
+                laneCounters_.remove(index);
+            }
+            return true;
+        }
+        SinkTyped<TYPE>* type = dynamic_cast<SinkTyped<TYPE>*>(sink);
+        if (type) {
+            int index = sinks_.indexOf(type);
+            if (index >= 0) {
+                sinks_.remove(index);
+                counters_.remove(index);
+            }
+            return true;
+        }
+        sensordLogC() << "Failed to unjoin type '" << typeid(type).name() << " from lane source!";
+        return false;
+    }
+
+    mutable QMutex                mutex_;        /**< topology lock, guards the vectors below */
+    QVector<LaneConsumer<VALUE>*> laneSinks_;    /**< connected lane sinks in join order */
+    QVector<SourceCounters>       laneCounters_; /**< counters of laneSinks_, same order */
+    QVector<SinkTyped<TYPE>*>     sinks_;        /**< connected array sinks in join order */
+    QVector<SourceCounters>       counters_;     /**< counters of sinks_, same order */
+};
+
+#endif // XYZLANES_H
@@ -0,0 +1,162 @@
+/**
+   @file atomic.h
+   @brief Ordered loads and stores of Qt atomics
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef ATOMIC_H
+#define ATOMIC_H
+
+#include <QAtomicInt>
+#include <QAtomicPointer>
+
+/**
+ * Plain and ordered loads and stores of QAtomicInt and QAtomicPointer.
+ * Qt 5 has them as members. Qt 4 has only read-modify-write operations,
+ * which would write to read-only mappings such as the shared ring of a
+ * client, so there the value is accessed with the compiler builtins.
+ */
+class Atomic
+{
+public:
+    /**
+     * Load without ordering.
+     *
+     * @param atomic value to load.
+     * @return value.
+     */
+    static int load(const QBasicAtomicInt& atomic)
+    {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+        return atomic.load();
+#else
+        return __atomic_load_n(&atomic._q_value, __ATOMIC_RELAXED);
+#endif
+    }
+
+    /**
+     * Load ordered before the loads and stores following it.
+     *
+     * @param atomic value to load.
+     * @return value.
+     */
+    static int loadAcquire(const QBasicAtomicInt& atomic)
+    {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+        return atomic.loadAcquire();
+#else
+        return __atomic_load_n(&atomic._q_value, __ATOMIC_ACQUIRE);
+#endif
+    }
+
+    /**
+     * Store without ordering.
+     *
+     * @param atomic value to store to.
+     * @param value new value.
+     */
+    static void store(QBasicAtomicInt& atomic, int value)
+    {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+        atomic.store(value);
+#else
+        __atomic_store_n(&atomic._q_value, value, __ATOMIC_RELAXED);
+#endif
+    }
+
+    /**
+     * Store ordered after the loads and stores preceding it.
+     *
+     * @param atomic value to store to.
+     * @param value new value.
+     */
+    static void storeRelease(QBasicAtomicInt& atomic, int value)
+    {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+        atomic.storeRelease(value);
+#else
+        __atomic_store_n(&atomic._q_value, value, __ATOMIC_RELEASE);
+#endif
+    }
+
+    /**
+     * Load pointer without ordering.
+     *
+     * @param atomic pointer to load.
+     * @return pointer.
+     */
+    template <typename T>
+    static T* load(const QBasicAtomicPointer<T>& atomic)
+    {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+        return atomic.load();
+#else
+        return __atomic_load_n(&atomic._q_value, __ATOMIC_RELAXED);
+#endif
+    }
+
+    /**
+     * Load pointer ordered before the loads and stores following it.
+     *
+     * @param atomic pointer to load.
+     * @return pointer.
+     */
+    template <typename T>
+    static T* loadAcquire(const QBasicAtomicPointer<T>& atomic)
+    {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+        return atomic.loadAcquire();
+#else
+        return __atomic_load_n(&atomic._q_value, __ATOMIC_ACQUIRE);
+#endif
+    }
+
+    /**
+     * Store pointer without ordering.
+     *
+     * @param atomic pointer to store to.
+     * @param value new pointer.
+     */
+    template <typename T>
+    static void store(QBasicAtomicPointer<T>& atomic, T* value)
+    {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+        atomic.store(value);
+#else
+        __atomic_store_n(&atomic._q_value, value, __ATOMIC_RELAXED);
+#endif
+    }
+
+    /**
+     * Store pointer ordered after the loads and stores preceding it.
+     *
+     * @param atomic pointer to store to.
+     * @param value new pointer.
+     */
+    template <typename T>
+    static void storeRelease(QBasicAtomicPointer<T>& atomic, T* value)
+    {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+        atomic.storeRelease(value);
+#else
+        __atomic_store_n(&atomic._q_value, value, __ATOMIC_RELEASE);
+#endif
+    }
+};
+
+#endif // ATOMIC_H
@@ -0,0 +1,152 @@
+/**
+   @file compactframe.cpp
+   @brief Compact encoding of socket frames
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "compactframe.h"
+#include <string.h>
+
+/** Longest varint of a quint64 */
+static const int MAX_VARINT_BYTES = 10;
+
+bool CompactFrame::encodable(int size)
+{
+    return size >= (int)sizeof(quint64) && (size - sizeof(quint64)) % sizeof(qint32) == 0 &&
+           (int)((size - sizeof(quint64)) / sizeof(qint32)) <= MAX_WORDS;
+}
+
+void CompactFrame::encode(const struct iovec* slices, int sliceCount, int size, unsigned int count, QByteArray& frame)
+{
+    CompactFrameHeader header;
+    header.count = count;
+    header.size = size;
+    header.narrow = 0;
+    header.length = 0;
+
+    if (!encodable(size)) {
+        header.length = count * size;
+        frame.resize(sizeof(header) + header.length);
+        char* out = frame.data() + sizeof(header);
+        for (int i = 0; i < sliceCount; ++i) {
+            memcpy(out, slices[i].iov_base, slices[i].iov_len);
+            out += slices[i].iov_len;
+        }
+        memcpy(frame.data(), &header, sizeof(header));
+        return;
+    }
+
+    int words = (size - sizeof(quint64)) / sizeof(qint32);
+    header.narrow = (1 << words) - 1;
+    for (int i = 0; i < sliceCount; ++i) {
+        const char* sample = (const char*)slices[i].iov_base;
+        const char* end = sample + slices[i].iov_len;
+        for (; sample < end; sample += size) {
+            for (int w = 0; w < words; ++w) {
+                qint32 value;
+                memcpy(&value, sample + sizeof(quint64) + w * sizeof(value), sizeof(value));
+                if (value != (qint16)value)
+                    header.narrow &= ~(1 << w);
+            }
+        }
+    }
+
+    frame.resize(sizeof(header) + count * (MAX_VARINT_BYTES + words * sizeof(qint32)));
+    unsigned char* out = (unsigned char*)frame.data() + sizeof(header);
+    const unsigned char* begin = out;
+    quint64 previous = 0;
+    for (int i = 0; i < sliceCount; ++i) {
+        const char* sample = (const char*)slices[i].iov_base;
+        const char* end = sample + slices[i].iov_len;
+        for (; sample < end; sample += size) {
+            quint64 timestamp;
+            memcpy(&timestamp, sample, sizeof(timestamp));
+            qint64 delta = (qint64)(timestamp - previous);
+            quint64 zigzag = ((quint64)delta << 1) ^ (quint64)(delta >> 63);
+            previous = timestamp;
+            while (zigzag >= 0x80) {
+                *out++ = (zigzag & 0x7f) | 0x80;
+                zigzag >>= 7;
+            }
+            *out++ = zigzag;
+
+            for (int w = 0; w < words; ++w) {
+                const char* word = sample + sizeof(quint64) + w * sizeof(qint32);
+                if (header.narrow & (1 << w)) {
+                    qint32 value;
+                    memcpy(&value, word, sizeof(value));
+                    qint16 narrow = value;
+                    memcpy(out, &narrow, sizeof(narrow));
+                    out += sizeof(narrow);
+                } else {
+                    memcpy(out, word, sizeof(qint32));
+                    out += sizeof(qint32);
+                }
+            }
+        }
+    }
+    header.length = out - begin;
+    memcpy(frame.data(), &header, sizeof(header));
+    frame.resize(sizeof(header) + header.length);
+}
+
+bool CompactFrame::decode(const CompactFrameHeader& header, const char* data, char* samples)
+{
+    if (!encodable(header.size)) {
+        if (header.length != header.count * header.size)
+            return false;
+        memcpy(samples, data, header.length);
+        return true;
+    }
+
+    int words = (header.size - sizeof(quint64)) / sizeof(qint32);
+    const unsigned char* in = (const unsigned char*)data;
+    const unsigned char* end = in + header.length;
+    quint64 timestamp = 0;
+    for (unsigned int i = 0; i < header.count; ++i, samples += header.size) {
+        quint64 zigzag = 0;
+        for (int shift = 0; ; shift += 7) {
+            if (in == end || shift >= 64)
+                return false;
+            zigzag |= (quint64)(*in & 0x7f) << shift;
+            if (!(*in++ & 0x80))
+                break;
+        }
+        timestamp += (quint64)((qint64)(zigzag >> 1) ^ -(qint64)(zigzag & 1));
+        memcpy(samples, &timestamp, sizeof(timestamp));
+
+        for (int w = 0; w < words; ++w) {
+            qint32 value;
+            if (header.narrow & (1 << w)) {
+                qint16 narrow;
+                if (end - in < (int)sizeof(narrow))
+                    return false;
+                memcpy(&narrow, in, sizeof(narrow));
+                in += sizeof(narrow);
+                value = narrow;
+            } else {
+                if (end - in < (int)sizeof(value))
+                    return false;
+                memcpy(&value, in, sizeof(value));
+                in += sizeof(value);
+            }
+            memcpy(samples + sizeof(quint64) + w * sizeof(value), &value, sizeof(value));
+        }
+    }
+    return in == end;
+}
@@ -0,0 +1,88 @@
+/**
+   @file compactframe.h
+   @brief Compact encoding of socket frames
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef COMPACTFRAME_H
+#define COMPACTFRAME_H
+
+#include <QtGlobal>
+#include <QByteArray>
+#include <sys/uio.h>
+
+/**
+ * Header of a frame written with CompactSocketTransport. It replaces the
+ * object count of plain frames and is followed by #length bytes of
+ * encoded samples.
+ */
+struct CompactFrameHeader
+{
+    quint32 count;  /**< number of samples */
+    quint16 size;   /**< size of a decoded sample in bytes */
+    quint16 narrow; /**< bit n is set if word n of every sample is stored in 16 bits */
+    quint32 length; /**< bytes of encoded samples following the header */
+};
+
+/**
+ * Lossless encoding of TimedData based samples. A sample is taken to be
+ * its quint64 timestamp followed by 32-bit words, which covers padding
+ * as well. Each sample is stored as the zigzag varint difference of its
+ * timestamp to the previous one, the first one to zero, followed by its
+ * words. Words whose values fit in 16 bits in the whole frame are stored
+ * in 16 bits.
+ *
+ * Samples of other layouts are stored as they are.
+ */
+class CompactFrame
+{
+public:
+    /** Words of a sample beyond this are stored as they are. */
+    static const int MAX_WORDS = 16;
+
+    /**
+     * Can samples of given size be delta encoded.
+     *
+     * @param size sample size in bytes.
+     * @return false if samples are stored as they are.
+     */
+    static bool encodable(int size);
+
+    /**
+     * Encode samples into a frame, header included.
+     *
+     * @param slices slices holding whole samples.
+     * @param sliceCount number of slices.
+     * @param size sample size in bytes.
+     * @param count total number of samples in the slices.
+     * @param frame set to the encoded frame. Its allocation is reused.
+     */
+    static void encode(const struct iovec* slices, int sliceCount, int size, unsigned int count, QByteArray& frame);
+
+    /**
+     * Decode samples of a frame.
+     *
+     * @param header header of the frame.
+     * @param data #CompactFrameHeader::length bytes following the header.
+     * @param samples location for header.count samples of header.size bytes.
+     * @return false if the frame is corrupted.
+     */
+    static bool decode(const CompactFrameHeader& header, const char* data, char* samples);
+};
+
+#endif // COMPACTFRAME_H
@@ -27,7 +27,10 @@
 #ifndef COMPASS_H
 #define COMPASS_H
 
+#include <QObject>
+#ifndef SENSORFW_NO_DBUS
 #include <QDBusArgument>
+#endif
 
 #include <datatypes/orientationdata.h>
 
@@ -118,11 +121,14 @@ public:
 private:
     CompassData data_;
 
+#ifndef SENSORFW_NO_DBUS
     friend const QDBusArgument &operator>>(const QDBusArgument &argument, Compass& data);
+#endif
 };
 
 Q_DECLARE_METATYPE( Compass )
 
+#ifndef SENSORFW_NO_DBUS
 /**
  * Marshall the Compass data into a D-Bus argument
  *
@@ -147,10 +153,13 @@ inline QDBusArgument &operator<<(QDBusArgument &argument, const Compass &data)
  */
 inline const QDBusArgument &operator>>(const QDBusArgument &argument, Compass &data)
 {
+    quint64 timestamp;
     argument.beginStructure();
-    argument >> data.data_.timestamp_ >> data.data_.degrees_ >> data.data_.rawDegrees_ >> data.data_.correctedDegrees_ >> data.data_.level_;
+    argument >> timestamp >> data.data_.degrees_ >> data.data_.rawDegrees_ >> data.data_.correctedDegrees_ >> data.data_.level_;
+    data.data_.timestamp_ = timestamp;
     argument.endStructure();
     return argument;
 }
+#endif // SENSORFW_NO_DBUS
 
 #endif // COMPASS_H
@@ -28,7 +28,9 @@
 #define DATARANGE_H
 
 #include <QObject>
+#ifndef SENSORFW_NO_DBUS
 #include <QDBusArgument>
+#endif
 #include <QPair>
 
 /* Datatype for storing integer ranges. */
@@ -107,6 +109,7 @@ typedef QList<DataRange> DataRangeList;
 Q_DECLARE_METATYPE( DataRange )
 Q_DECLARE_METATYPE( DataRangeList )
 
+#ifndef SENSORFW_NO_DBUS
 /**
  * Marshall the DataRange into a D-Bus argument
  *
@@ -242,6 +245,7 @@ inline const QDBusArgument &operator>>(const QDBusArgument &argument, IntegerRan
     argument.endArray();
     return argument;
 }
+#endif // SENSORFW_NO_DBUS
 
 /**
  * DataRange request class.
@@ -21,16 +21,28 @@ HEADERS += xyz.h \
     orientationdata.h \
     tap.h \
     posedata.h \
+    fusiondata.h \
+    statisticsdata.h \
+    rotationdeltadata.h \
     tapdata.h \
     touchdata.h \
-    proximity.h
+    proximity.h \
+    sharedring.h \
+    compactframe.h \
+    sensortrace.h \
+    tracearchive.h \
+    atomic.h
 
 SOURCES += xyz.cpp \
     orientation.cpp \
     unsigned.cpp \
     compass.cpp \
     utils.cpp \
-    tap.cpp
+    tap.cpp \
+    sharedring.cpp \
+    compactframe.cpp \
+    sensortrace.cpp \
+    tracearchive.cpp
 
 include(../common-install.pri)
 publicheaders.path  = $${publicheaders.path}/datatypes
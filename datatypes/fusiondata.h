@@ -0,0 +1,52 @@
+/**
+   @file fusiondata.h
+   @brief Datatype for synchronized motion sensor samples
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef FUSIONDATA_H
+#define FUSIONDATA_H
+
+#include <datatypes/genericdata.h>
+
+/**
+ * Accelerometer, gyroscope and magnetometer samples aligned to a common
+ * timestamp. Each vector holds x, y and z in the units of the
+ * corresponding sensor.
+ */
+class FusionData : public TimedData
+{
+public:
+    /**
+     * Constructor.
+     */
+    FusionData() : TimedData(0)
+    {
+        for (int i = 0; i < 3; ++i)
+            accelerometer_[i] = gyroscope_[i] = magnetometer_[i] = 0;
+    }
+
+    int accelerometer_[3]; /**< acceleration in mG */
+    int gyroscope_[3];     /**< angular velocity in mdps */
+    int magnetometer_[3];  /**< calibrated magnetic field */
+};
+SENSORD_SAMPLE_SIZE(FusionData, 44);
+
+Q_DECLARE_METATYPE(FusionData)
+
+#endif // FUSIONDATA_H
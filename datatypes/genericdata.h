@@ -30,9 +30,22 @@
 #include <QMetaType>
 
 /**
- * A base class for measurement data that contain timestamp.
+ * Compile time check of sample size. Samples are copied to sockets and
+ * shared memory rings as they are, so their layout is part of the
+ * client protocol.
+ *
+ * @param type sample type.
+ * @param size expected size in bytes.
  */
-class TimedData
+#define SENSORD_SAMPLE_SIZE(type, size) \
+    typedef char type##SizeCheck[sizeof(type) == (size) ? 1 : -1]
+
+/**
+ * A base class for measurement data that contain timestamp. Timestamp
+ * is aligned to 4 bytes only, so samples of 32-bit values carry no
+ * padding after the timestamp or at the end.
+ */
+class __attribute__((packed, aligned(4))) TimedData
 {
 public:
 
@@ -71,6 +84,9 @@ public:
     int y_; /**< Y value */
     int z_; /**< Z value */
 };
+SENSORD_SAMPLE_SIZE(TimedData, 8);
+SENSORD_SAMPLE_SIZE(TimedXyzData, 20);
+
 Q_DECLARE_METATYPE ( TimedXyzData )
 
 #endif // GENERICDATA_H
@@ -28,7 +28,10 @@
 #ifndef MAGNETICFIELDDATA_H
 #define MAGNETICFIELDDATA_H
 
+#include <QObject>
+#ifndef SENSORFW_NO_DBUS
 #include <QDBusArgument>
+#endif
 #include <datatypes/orientationdata.h>
 
 /**
@@ -174,11 +177,14 @@ public:
 private:
     CalibratedMagneticFieldData data_; /**< Contained data */
 
+#ifndef SENSORFW_NO_DBUS
     friend const QDBusArgument &operator>>(const QDBusArgument &argument, MagneticField& data);
+#endif
 };
 
 Q_DECLARE_METATYPE( MagneticField )
 
+#ifndef SENSORFW_NO_DBUS
 /**
  * Marshall the MagneticField data into a D-Bus argument
  *
@@ -205,12 +211,15 @@ inline QDBusArgument &operator<<(QDBusArgument &argument, const MagneticField &d
  */
 inline const QDBusArgument &operator>>(const QDBusArgument &argument, MagneticField &data)
 {
+    quint64 timestamp;
     argument.beginStructure();
-    argument >> data.data_.timestamp_ >> data.data_.level_;
+    argument >> timestamp >> data.data_.level_;
     argument >> data.data_.x_ >> data.data_.y_ >> data.data_.z_;
     argument >> data.data_.rx_ >> data.data_.ry_ >> data.data_.rz_;
+    data.data_.timestamp_ = timestamp;
     argument.endStructure();
     return argument;
 }
+#endif // SENSORFW_NO_DBUS
 
 #endif // MAGNETICFIELDDATA_H
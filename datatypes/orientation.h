@@ -27,7 +27,10 @@
 #ifndef ORIENTATION_H
 #define ORIENTATION_H
 
+#include <QObject>
+#ifndef SENSORFW_NO_DBUS
 #include <QDBusArgument>
+#endif
 #include <datatypes/orientationdata.h>
 
 /**
@@ -118,11 +121,14 @@ public:
 private:
     OrientationData data_; /**< Contained data */
 
+#ifndef SENSORFW_NO_DBUS
     friend const QDBusArgument &operator>>(const QDBusArgument &argument, Orientation& orientation);
+#endif
 };
 
 Q_DECLARE_METATYPE( Orientation )
 
+#ifndef SENSORFW_NO_DBUS
 /**
  * Marshall the Orientation data into a D-Bus argument
  *
@@ -147,10 +153,13 @@ inline QDBusArgument &operator<<(QDBusArgument &argument, const Orientation &ori
  */
 inline const QDBusArgument &operator>>(const QDBusArgument &argument, Orientation &orientation)
 {
+    quint64 timestamp;
     argument.beginStructure();
-    argument >> orientation.data_.timestamp_ >> orientation.data_.x_ >> orientation.data_.y_ >> orientation.data_.z_;
+    argument >> timestamp >> orientation.data_.x_ >> orientation.data_.y_ >> orientation.data_.z_;
+    orientation.data_.timestamp_ = timestamp;
     argument.endStructure();
     return argument;
 }
+#endif // SENSORFW_NO_DBUS
 
 #endif // ORIENTATION_H
@@ -104,6 +104,7 @@ public:
     int rz_;    /**< raw Z coordinate value */
     int level_; /**< Magnetometer calibration level. Higher value means better calibration. */
 };
+SENSORD_SAMPLE_SIZE(CalibratedMagneticFieldData, 36);
 
 /**
  * Datatype for compass measurements.
@@ -143,6 +144,7 @@ public:
     int correctedDegrees_; /**< Declination corrected angle to north */
     int level_;   /**< Magnetometer calibration level. Higher value means better calibration. */
 };
+SENSORD_SAMPLE_SIZE(CompassData, 24);
 
 /**
  * Datatype for proximity measurements
@@ -167,5 +169,6 @@ public:
 
     bool withinProximity_; /**< is an object within proximity or not */
 };
+SENSORD_SAMPLE_SIZE(ProximityData, 16);
 
 #endif // ORIENTATIONDATA_H
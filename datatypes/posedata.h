@@ -101,6 +101,7 @@ public:
      */
     PoseData(const quint64& timestamp, Orientation orientation) : TimedData(timestamp), orientation_(orientation) {}
 };
+SENSORD_SAMPLE_SIZE(PoseData, 12);
 
 Q_DECLARE_METATYPE(PoseData)
 
@@ -26,7 +26,10 @@
 #ifndef PROXIMITY_H
 #define PROXIMITY_H
 
+#include <QObject>
+#ifndef SENSORFW_NO_DBUS
 #include <QDBusArgument>
+#endif
 
 #include <datatypes/unsigned.h>
 #include <datatypes/orientationdata.h>
@@ -115,11 +118,14 @@ public:
 private:
     ProximityData data_; /**< Contained proximity reading. */
 
+#ifndef SENSORFW_NO_DBUS
     friend const QDBusArgument &operator>>(const QDBusArgument &argument, Proximity& data);
+#endif
 };
 
 Q_DECLARE_METATYPE( Proximity )
 
+#ifndef SENSORFW_NO_DBUS
 /**
  * Marshall the Proximity data into a D-Bus argument
  *
@@ -144,10 +150,13 @@ inline QDBusArgument &operator<<(QDBusArgument &argument, const Proximity &data)
  */
 inline const QDBusArgument &operator>>(const QDBusArgument &argument, Proximity &data)
 {
+    quint64 timestamp;
     argument.beginStructure();
-    argument >> data.data_.timestamp_ >> data.data_.value_ >> data.data_.withinProximity_;
+    argument >> timestamp >> data.data_.value_ >> data.data_.withinProximity_;
+    data.data_.timestamp_ = timestamp;
     argument.endStructure();
     return argument;
 }
+#endif // SENSORFW_NO_DBUS
 
 #endif // PROXIMITY_H
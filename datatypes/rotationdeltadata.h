@@ -0,0 +1,62 @@
+/**
+   @file rotationdeltadata.h
+   @brief Datatype for rotation accumulated over a window
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+
+#ifndef ROTATIONDELTADATA_H
+#define ROTATIONDELTADATA_H
+
+#include <datatypes/genericdata.h>
+
+/**
+ * Rotation of the device accumulated from the gyroscope samples of one
+ * window. Timestamp is that of the last sample in the window. Windows
+ * follow each other without gaps, so composing the deltas of consecutive
+ * records gives the rotation over their whole span.
+ *
+ * The quaternion is the exact composition of the per sample rotations,
+ * mapping vectors of the device frame at the end of the window to the
+ * frame at its start. The angles are the per axis sums of angular
+ * velocity times time, which equal the rotation for small or single axis
+ * motion.
+ */
+class RotationDeltaData : public TimedData
+{
+public:
+    /**
+     * Constructor.
+     */
+    RotationDeltaData() : TimedData(0), count_(0), duration_(0)
+    {
+        delta_[0] = 1;
+        for (int i = 0; i < 3; ++i)
+            delta_[i + 1] = angle_[i] = 0;
+    }
+
+    quint32 count_;    /**< number of samples integrated */
+    quint32 duration_; /**< integrated time in microseconds */
+    float   delta_[4]; /**< rotation as unit quaternion, w x y z */
+    float   angle_[3]; /**< rotation about x, y and z in millidegrees */
+};
+SENSORD_SAMPLE_SIZE(RotationDeltaData, 44);
+
+Q_DECLARE_METATYPE(RotationDeltaData)
+
+#endif // ROTATIONDELTADATA_H
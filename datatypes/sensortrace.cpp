@@ -0,0 +1,150 @@
+/**
+   @file sensortrace.cpp
+   @brief Binary sensor sample traces
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "sensortrace.h"
+#include <QDebug>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+SensorTrace::SensorTrace() :
+    map_(MAP_FAILED),
+    mapSize_(0),
+    records_(0),
+    recordSize_(0),
+    count_(0)
+{
+}
+
+SensorTrace::~SensorTrace()
+{
+    close();
+}
+
+bool SensorTrace::open(const QString& path)
+{
+    close();
+
+    int fd = ::open(path.toLocal8Bit().constData(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        qWarning() << "Failed to open sensor trace" << path << ":" << strerror(errno);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(SensorTraceHeader)) {
+        qWarning() << "Sensor trace" << path << "is truncated";
+        ::close(fd);
+        return false;
+    }
+    map_ = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map_ == MAP_FAILED) {
+        qWarning() << "Failed to map sensor trace" << path << ":" << strerror(errno);
+        return false;
+    }
+    mapSize_ = st.st_size;
+    madvise(map_, mapSize_, MADV_SEQUENTIAL);
+
+    const SensorTraceHeader* header = (const SensorTraceHeader*)map_;
+    if (header->magic != MAGIC || header->version != VERSION ||
+        header->recordSize < MIN_RECORD_SIZE) {
+        qWarning() << "Unsupported sensor trace" << path;
+        close();
+        return false;
+    }
+    recordSize_ = header->recordSize;
+    records_ = (const char*)map_ + sizeof(SensorTraceHeader);
+    count_ = (mapSize_ - sizeof(SensorTraceHeader)) / recordSize_;
+    if (header->count && header->count < count_)
+        count_ = header->count;
+    return true;
+}
+
+void SensorTrace::close()
+{
+    if (map_ != MAP_FAILED)
+        munmap(map_, mapSize_);
+    map_ = MAP_FAILED;
+    mapSize_ = 0;
+    records_ = 0;
+    recordSize_ = 0;
+    count_ = 0;
+}
+
+unsigned int SensorTrace::count() const
+{
+    return count_;
+}
+
+SensorTraceWriter::SensorTraceWriter() :
+    file_(0)
+{
+}
+
+SensorTraceWriter::~SensorTraceWriter()
+{
+    close();
+}
+
+bool SensorTraceWriter::open(const QString& path)
+{
+    close();
+
+    file_ = fopen(path.toLocal8Bit().constData(), "wb");
+    if (!file_) {
+        qWarning() << "Failed to create sensor trace" << path << ":" << strerror(errno);
+        return false;
+    }
+    SensorTraceHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = SensorTrace::MAGIC;
+    header.version = SensorTrace::VERSION;
+    header.recordSize = sizeof(SensorTraceRecord);
+    if (fwrite(&header, sizeof(header), 1, file_) != 1) {
+        qWarning() << "Failed to write sensor trace" << path << ":" << strerror(errno);
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool SensorTraceWriter::append(quint64 timestamp, int x, int y, int z)
+{
+    if (!file_)
+        return false;
+    SensorTraceRecord record;
+    record.timestamp = timestamp;
+    record.x = x;
+    record.y = y;
+    record.z = z;
+    record.reserved = 0;
+    return fwrite(&record, sizeof(record), 1, file_) == 1;
+}
+
+void SensorTraceWriter::close()
+{
+    if (file_)
+        fclose(file_);
+    file_ = 0;
+}
@@ -0,0 +1,163 @@
+/**
+   @file sensortrace.h
+   @brief Binary sensor sample traces
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef SENSORTRACE_H
+#define SENSORTRACE_H
+
+#include <QtGlobal>
+#include <QString>
+#include <stdio.h>
+
+/**
+ * Trace file header. The header is followed by records of #recordSize
+ * bytes in host byte order, oldest first. Preallocated traces keep
+ * #count up to date so that the unused tail is ignored.
+ */
+struct SensorTraceHeader
+{
+    quint32 magic;      /**< #SensorTrace::MAGIC */
+    quint32 version;    /**< #SensorTrace::VERSION */
+    quint32 recordSize; /**< size of single record in bytes */
+    quint32 count;      /**< valid records, 0 if all records in the file are valid */
+};
+
+/**
+ * Traced three axis sample, e.g. TimedXyzData of an accelerometer,
+ * magnetometer or gyroscope adaptor. Records of traces written by
+ * TraceRecorder end after #z, #reserved is only valid in larger records.
+ */
+struct SensorTraceRecord
+{
+    quint64 timestamp; /**< monotonic capture time in microseconds */
+    qint32  x;         /**< x value */
+    qint32  y;         /**< y value */
+    qint32  z;         /**< z value */
+    quint32 reserved;  /**< zero */
+};
+
+/**
+ * Read-only memory mapped sensor trace.
+ */
+class SensorTrace
+{
+public:
+    static const quint32 MAGIC = 0x53465754;  /**< header magic */
+    static const quint32 VERSION = 1;         /**< format version */
+    static const quint32 MIN_RECORD_SIZE = 20; /**< timestamp, x, y and z */
+
+    /**
+     * Constructor. Trace is empty until opened.
+     */
+    SensorTrace();
+
+    /**
+     * Destructor.
+     */
+    ~SensorTrace();
+
+    /**
+     * Map trace file.
+     *
+     * @param path trace file path.
+     * @return was the file mapped and its header valid.
+     */
+    bool open(const QString& path);
+
+    /**
+     * Unmap trace file.
+     */
+    void close();
+
+    /**
+     * Number of records.
+     *
+     * @return record count.
+     */
+    unsigned int count() const;
+
+    /**
+     * Record at given index.
+     *
+     * @param index record index, less than #count().
+     * @return record.
+     */
+    const SensorTraceRecord& at(unsigned int index) const
+    {
+        return *(const SensorTraceRecord*)(records_ + (size_t)index * recordSize_);
+    }
+
+private:
+    Q_DISABLE_COPY(SensorTrace)
+
+    void*        map_;        /**< mapped file */
+    size_t       mapSize_;    /**< mapped size in bytes */
+    const char*  records_;    /**< first record */
+    unsigned int recordSize_; /**< record size in bytes */
+    unsigned int count_;      /**< record count */
+};
+
+/**
+ * Appends records into a sensor trace file.
+ */
+class SensorTraceWriter
+{
+public:
+    /**
+     * Constructor.
+     */
+    SensorTraceWriter();
+
+    /**
+     * Destructor. Closes the file.
+     */
+    ~SensorTraceWriter();
+
+    /**
+     * Create trace file and write its header.
+     *
+     * @param path trace file path.
+     * @return was the file created.
+     */
+    bool open(const QString& path);
+
+    /**
+     * Append a record.
+     *
+     * @param timestamp monotonic capture time in microseconds.
+     * @param x x value.
+     * @param y y value.
+     * @param z z value.
+     * @return was the record written.
+     */
+    bool append(quint64 timestamp, int x, int y, int z);
+
+    /**
+     * Flush and close the file.
+     */
+    void close();
+
+private:
+    Q_DISABLE_COPY(SensorTraceWriter)
+
+    FILE* file_; /**< trace file */
+};
+
+#endif // SENSORTRACE_H
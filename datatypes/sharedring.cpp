@@ -0,0 +1,234 @@
+/**
+   @file sharedring.cpp
+   @brief Shared memory sample ring
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "sharedring.h"
+#include "atomic.h"
+#include <QDebug>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/memfd.h>
+
+#ifndef F_ADD_SEALS
+#define F_ADD_SEALS (1024 + 9)
+#define F_SEAL_SHRINK 0x0002
+#define F_SEAL_GROW   0x0004
+#endif
+
+SharedRing::SharedRing(unsigned int capacity, unsigned int start) :
+    fd_(-1),
+    capacity_(capacity),
+    mapSize_(sizeof(SharedRingHeader) + capacity),
+    header_(0),
+    slots_(0),
+    start_(start)
+{
+    fd_ = syscall(SYS_memfd_create, "sensorfw-ring", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd_ < 0) {
+        qWarning() << "Failed to create shared memory ring:" << strerror(errno);
+        return;
+    }
+    if (ftruncate(fd_, mapSize_) < 0) {
+        qWarning() << "Failed to size shared memory ring:" << strerror(errno);
+        close(fd_);
+        fd_ = -1;
+        return;
+    }
+    // Clients must not be able to shrink the area under our mapping
+    fcntl(fd_, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW);
+
+    void* map = mmap(0, mapSize_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (map == MAP_FAILED) {
+        qWarning() << "Failed to map shared memory ring:" << strerror(errno);
+        close(fd_);
+        fd_ = -1;
+        return;
+    }
+    header_ = (SharedRingHeader*)map;
+    slots_ = (char*)map + sizeof(SharedRingHeader);
+    header_->sampleSize = 0;
+    header_->slotCount = 0;
+    Atomic::store(header_->writeCount, start_);
+    header_->magic = MAGIC;
+}
+
+SharedRing::~SharedRing()
+{
+    if (header_)
+        munmap(header_, mapSize_);
+    if (fd_ >= 0)
+        close(fd_);
+}
+
+bool SharedRing::isValid() const
+{
+    return header_ != 0;
+}
+
+int SharedRing::fd() const
+{
+    return fd_;
+}
+
+bool SharedRing::write(const void* source, int size, unsigned int count)
+{
+    if (!header_ || size <= 0)
+        return false;
+
+    if (!header_->sampleSize) {
+        if ((unsigned int)size > capacity_)
+            return false;
+        header_->sampleSize = size;
+        unsigned int slots = 1;
+        while (slots <= capacity_ / size / 2)
+            slots <<= 1;
+        header_->slotCount = slots;
+    } else if (header_->sampleSize != (quint32)size) {
+        return false;
+    }
+
+    const char* samples = (const char*)source;
+    unsigned int mask = header_->slotCount - 1;
+    unsigned int written = Atomic::load(header_->writeCount);
+    for (unsigned int i = 0; i < count; ++i, ++written) {
+        memcpy(slots_ + (written & mask) * size, samples + i * size, size);
+        // Full barrier: readers validate their copy against the write
+        // count, so the count must be visible before next slot is reused.
+        header_->writeCount.fetchAndStoreOrdered(written + 1);
+    }
+    return true;
+}
+
+unsigned int SharedRing::writeCount() const
+{
+    if (!header_)
+        return 0;
+    return Atomic::load(header_->writeCount);
+}
+
+SharedRingReader::SharedRingReader() :
+    fd_(-1),
+    mapSize_(0),
+    header_(0),
+    readCount_(0)
+{
+}
+
+SharedRingReader::~SharedRingReader()
+{
+    detach();
+}
+
+bool SharedRingReader::attach(int fd)
+{
+    detach();
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(SharedRingHeader)) {
+        qWarning() << "Invalid shared memory ring";
+        close(fd);
+        return false;
+    }
+    void* map = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        qWarning() << "Failed to map shared memory ring:" << strerror(errno);
+        close(fd);
+        return false;
+    }
+    header_ = (const SharedRingHeader*)map;
+    if (header_->magic != SharedRing::MAGIC) {
+        qWarning() << "Invalid shared memory ring";
+        munmap(map, st.st_size);
+        header_ = 0;
+        close(fd);
+        return false;
+    }
+    fd_ = fd;
+    mapSize_ = st.st_size;
+    readCount_ = Atomic::loadAcquire(header_->writeCount);
+    return true;
+}
+
+void SharedRingReader::detach()
+{
+    if (header_)
+        munmap((void*)header_, mapSize_);
+    if (fd_ >= 0)
+        close(fd_);
+    header_ = 0;
+    fd_ = -1;
+    mapSize_ = 0;
+}
+
+bool SharedRingReader::isAttached() const
+{
+    return header_ != 0;
+}
+
+unsigned int SharedRingReader::available(int size)
+{
+    if (!header_)
+        return 0;
+    unsigned int written = Atomic::loadAcquire(header_->writeCount);
+    if (written == readCount_ || header_->sampleSize != (quint32)size)
+        return 0;
+    unsigned int slots = header_->slotCount;
+    if (!slots || (slots & (slots - 1)) || sizeof(SharedRingHeader) + (quint64)slots * size > mapSize_)
+        return 0;
+    // Oldest slot may be under rewrite already
+    if (written - readCount_ >= slots)
+        readCount_ = written - slots + 1;
+    return written - readCount_;
+}
+
+unsigned int SharedRingReader::read(void* buffer, int size, unsigned int count)
+{
+    unsigned int unread = available(size);
+    if (count > unread)
+        count = unread;
+    if (!count)
+        return 0;
+
+    const char* slots = (const char*)header_ + sizeof(SharedRingHeader);
+    unsigned int slotCount = header_->slotCount;
+    unsigned int mask = slotCount - 1;
+    unsigned int first = readCount_;
+    for (unsigned int i = 0; i < count; ++i)
+        memcpy((char*)buffer + i * size, slots + ((first + i) & mask) * size, size);
+
+    // Copies must complete before the write count is re-read. Samples
+    // which the producer may have overwritten meanwhile are discarded.
+    __sync_synchronize();
+    unsigned int written = Atomic::load(header_->writeCount);
+    unsigned int skip = 0;
+    if (written - first >= slotCount) {
+        skip = written - first - slotCount + 1;
+        if (skip > count)
+            skip = count;
+        memmove(buffer, (char*)buffer + skip * size, (count - skip) * size);
+    }
+    readCount_ = first + count;
+    return count - skip;
+}
@@ -0,0 +1,223 @@
+/**
+   @file sharedring.h
+   @brief Shared memory sample ring
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef SHAREDRING_H
+#define SHAREDRING_H
+
+#include <QtGlobal>
+#include <QAtomicInt>
+
+/**
+ * Data transport requested by the client after writing its session ID to
+ * the data socket. If shared memory transport is accepted sensord replies
+ * with single byte carrying the ring file descriptor as SCM_RIGHTS
+ * ancillary data. Refusal is single byte without file descriptor.
+ *
+ * Multiplexed transport is accepted with byte 'M' for the first session of
+ * a connection. Further sessions register by writing their session ID and
+ * transport to the same connection without reply. Each frame is then
+ * preceded by MultiplexedFrameHeader.
+ *
+ * Compact socket transport is accepted with byte 'C'. Each frame is then
+ * a CompactFrameHeader followed by encoded samples, see CompactFrame.
+ *
+ * Control transport opens no session, the session ID is ignored. It is
+ * accepted with byte 'K', after which the connection carries requests
+ * and replies as lines of text, see ControlHandler. Refused connections
+ * are closed after byte 'N'.
+ *
+ * Packet transport is only offered on the SOCK_SEQPACKET data socket, see
+ * global/seqpacket_socket, and it is the only transport offered there. It
+ * is accepted with byte 'P', after which every frame is one message, so
+ * that a single recv() returns exactly one whole frame.
+ */
+enum SharedRingTransport
+{
+    SocketTransport = 0,         /**< samples are written to the socket */
+    SharedRingDoorbellTransport, /**< samples in ring, write count written to the socket */
+    SharedRingPollTransport,     /**< samples in ring, nothing written to the socket */
+    MultiplexedTransport,        /**< sessions share the socket, frames carry session ID */
+    CompactSocketTransport,      /**< samples are written to the socket delta encoded */
+    ControlTransport,            /**< requests to sensord instead of samples */
+    SeqPacketTransport           /**< samples are written to the socket, one frame per message */
+};
+
+/**
+ * Header preceding frames on a multiplexed connection.
+ */
+struct MultiplexedFrameHeader
+{
+    qint32  sessionId; /**< session the frame belongs to */
+    quint32 length;    /**< frame length in bytes, excluding this header */
+};
+
+/**
+ * Layout of the shared memory area header. The header is followed by
+ * #slotCount sample slots of #sampleSize bytes each.
+ *
+ * Ring has the same semantics as RingBuffer: #writeCount tells how many
+ * samples have been written in total and sample n is stored in slot
+ * n & (#slotCount - 1). #slotCount is a power of two, so slot positions
+ * stay continuous when the count wraps. Each reader tracks its own read
+ * count.
+ */
+struct SharedRingHeader
+{
+    quint32         magic;      /**< #SharedRing::MAGIC when initialized */
+    quint32         sampleSize; /**< sample size in bytes, 0 until first write */
+    quint32         slotCount;  /**< number of slots, power of two, 0 until first write */
+    QBasicAtomicInt writeCount; /**< how many samples have been written */
+};
+
+/**
+ * Producer side of memfd backed sample ring. The ring is created with
+ * fixed byte capacity and laid out for the sample size of the first write.
+ * File descriptor returned by #fd() can be passed to clients which map
+ * it read-only with SharedRingReader.
+ */
+class SharedRing
+{
+public:
+    static const quint32 MAGIC = 0x53465752; /**< header magic */
+
+    /**
+     * Constructor.
+     *
+     * @param capacity size of the sample area in bytes. Slots take the
+     *                 largest power of two samples fitting it.
+     * @param start initial write count. Lets tests cross the count wrap
+     *              without writing 2^32 samples.
+     */
+    SharedRing(unsigned int capacity, unsigned int start = 0);
+
+    /**
+     * Destructor.
+     */
+    ~SharedRing();
+
+    /**
+     * Was shared memory area created succesfully.
+     *
+     * @return is ring usable.
+     */
+    bool isValid() const;
+
+    /**
+     * File descriptor of the shared memory area.
+     *
+     * @return file descriptor or -1 if ring is not valid.
+     */
+    int fd() const;
+
+    /**
+     * Append samples into the ring.
+     *
+     * @param source location of contiguous samples.
+     * @param size size of single sample in bytes.
+     * @param count how many samples to write.
+     * @return false if sample size does not match ring layout.
+     */
+    bool write(const void* source, int size, unsigned int count);
+
+    /**
+     * How many samples have been written to the ring.
+     *
+     * @return write count.
+     */
+    unsigned int writeCount() const;
+
+private:
+    Q_DISABLE_COPY(SharedRing)
+
+    int               fd_;       /**< memfd */
+    unsigned int      capacity_; /**< sample area size in bytes */
+    unsigned int      mapSize_;  /**< mapped size in bytes */
+    SharedRingHeader* header_;   /**< mapped header */
+    char*             slots_;    /**< mapped sample area */
+    unsigned int      start_;    /**< write count of the first sample */
+};
+
+/**
+ * Consumer side of memfd backed sample ring.
+ */
+class SharedRingReader
+{
+public:
+    /**
+     * Constructor.
+     */
+    SharedRingReader();
+
+    /**
+     * Destructor.
+     */
+    ~SharedRingReader();
+
+    /**
+     * Map shared memory area read-only. Reader takes ownership of the
+     * file descriptor. Samples written before attaching are skipped.
+     *
+     * @param fd file descriptor received from sensord.
+     * @return was area mapped succesfully.
+     */
+    bool attach(int fd);
+
+    /**
+     * Unmap shared memory area.
+     */
+    void detach();
+
+    /**
+     * Is shared memory area mapped.
+     *
+     * @return is reader attached.
+     */
+    bool isAttached() const;
+
+    /**
+     * How many unread samples are in the ring. If the reader has fallen
+     * behind more than whole ring the overwritten samples are skipped.
+     *
+     * @param size expected sample size in bytes.
+     * @return unread sample count or 0 if ring layout does not match.
+     */
+    unsigned int available(int size);
+
+    /**
+     * Copy unread samples from the ring.
+     *
+     * @param buffer location for the samples.
+     * @param size expected sample size in bytes.
+     * @param count maximum number of samples to read.
+     * @return how many samples were read.
+     */
+    unsigned int read(void* buffer, int size, unsigned int count);
+
+private:
+    Q_DISABLE_COPY(SharedRingReader)
+
+    int                     fd_;        /**< memfd */
+    unsigned int            mapSize_;   /**< mapped size in bytes */
+    const SharedRingHeader* header_;    /**< mapped header */
+    unsigned int            readCount_; /**< how many samples have been read */
+};
+
+#endif // SHAREDRING_H
@@ -0,0 +1,57 @@
+/**
+   @file statisticsdata.h
+   @brief Datatype for windowed statistics of XYZ samples
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef STATISTICSDATA_H
+#define STATISTICSDATA_H
+
+#include <datatypes/genericdata.h>
+
+/**
+ * Per axis minimum, maximum, mean and sample variance of the XYZ samples
+ * of one window. Timestamp is that of the last sample in the window, and
+ * the values are in the units of the sampled sensor.
+ */
+class XyzStatisticsData : public TimedData
+{
+public:
+    /**
+     * Constructor.
+     */
+    XyzStatisticsData() : TimedData(0), count_(0), window_(0)
+    {
+        for (int i = 0; i < 3; ++i) {
+            min_[i] = max_[i] = 0;
+            mean_[i] = variance_[i] = 0;
+        }
+    }
+
+    quint32 count_;       /**< number of samples in the window */
+    quint32 window_;      /**< window length in milliseconds */
+    int     min_[3];      /**< smallest x, y and z */
+    int     max_[3];      /**< largest x, y and z */
+    float   mean_[3];     /**< mean of x, y and z */
+    float   variance_[3]; /**< sample variance of x, y and z */
+};
+SENSORD_SAMPLE_SIZE(XyzStatisticsData, 64);
+
+Q_DECLARE_METATYPE(XyzStatisticsData)
+
+#endif // STATISTICSDATA_H
@@ -26,7 +26,10 @@
 #ifndef TAP_H
 #define TAP_H
 
+#include <QObject>
+#ifndef SENSORFW_NO_DBUS
 #include <QDBusArgument>
+#endif
 
 #include <datatypes/tapdata.h>
 
@@ -81,11 +84,14 @@ public:
 private:
     TapData data_; /**< Contained tap data */
 
+#ifndef SENSORFW_NO_DBUS
     friend const QDBusArgument &operator>>(const QDBusArgument &argument, Tap& tap);
+#endif
 };
 
 Q_DECLARE_METATYPE( Tap )
 
+#ifndef SENSORFW_NO_DBUS
 /**
  * Marshall the Tap data into a D-Bus argument
  *
@@ -111,14 +117,17 @@ inline QDBusArgument &operator<<(QDBusArgument &argument, const Tap &tap)
 inline const QDBusArgument &operator>>(const QDBusArgument &argument, Tap &tap)
 {
     int tmp;
+    quint64 timestamp;
     argument.beginStructure();
-    argument >> tap.data_.timestamp_;
+    argument >> timestamp;
     argument >> tmp;
     tap.data_.direction_ = (TapData::Direction)tmp;
     argument >> tmp;
     tap.data_.type_ = (TapData::Type)tmp;
+    tap.data_.timestamp_ = timestamp;
     argument.endStructure();
     return argument;
 }
+#endif // SENSORFW_NO_DBUS
 
 #endif // TAP_H
@@ -78,5 +78,6 @@ public:
     TapData(const quint64& timestamp, Direction direction, Type type) :
         TimedData(timestamp), direction_(direction), type_(type) {}
 };
+SENSORD_SAMPLE_SIZE(TapData, 16);
 
 #endif // TAPDATA_H
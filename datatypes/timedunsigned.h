@@ -48,6 +48,7 @@ public:
 
     unsigned value_; /**< Measurement value. */
 };
+SENSORD_SAMPLE_SIZE(TimedUnsigned, 12);
 
 Q_DECLARE_METATYPE ( TimedUnsigned )
 
@@ -62,5 +62,6 @@ public:
     TouchData(TimedXyzData timedXyzData, int object, FingerState state) :
         TimedXyzData(timedXyzData), object_(object), state_(state) {}
 };
+SENSORD_SAMPLE_SIZE(TouchData, 28);
 
 #endif // TOUCHDATA_H
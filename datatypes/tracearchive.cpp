@@ -0,0 +1,385 @@
+/**
+   @file tracearchive.cpp
+   @brief Columnar block indexed archives of sensor traces
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+
+#include "tracearchive.h"
+#include <QDebug>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/** Longest varint of a quint64 */
+static const int MAX_VARINT_BYTES = 10;
+
+static inline unsigned char* putVarint(unsigned char* out, qint64 delta)
+{
+    quint64 zigzag = ((quint64)delta << 1) ^ (quint64)(delta >> 63);
+    while (zigzag >= 0x80) {
+        *out++ = (zigzag & 0x7f) | 0x80;
+        zigzag >>= 7;
+    }
+    *out++ = zigzag;
+    return out;
+}
+
+static inline bool getVarint(const unsigned char*& in, const unsigned char* end, qint64& delta)
+{
+    quint64 zigzag = 0;
+    for (int shift = 0; ; shift += 7) {
+        if (in == end || shift >= 64)
+            return false;
+        zigzag |= (quint64)(*in & 0x7f) << shift;
+        if (!(*in++ & 0x80))
+            break;
+    }
+    delta = (qint64)(zigzag >> 1) ^ -(qint64)(zigzag & 1);
+    return true;
+}
+
+TraceArchive::TraceArchive() :
+    map_(MAP_FAILED),
+    mapSize_(0),
+    index_(0),
+    blockSize_(0),
+    blocks_(0),
+    count_(0)
+{
+}
+
+TraceArchive::~TraceArchive()
+{
+    close();
+}
+
+bool TraceArchive::probe(const QString& path)
+{
+    int fd = ::open(path.toLocal8Bit().constData(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+    quint32 magic = 0;
+    bool archive = ::read(fd, &magic, sizeof(magic)) == sizeof(magic) && magic == MAGIC;
+    ::close(fd);
+    return archive;
+}
+
+bool TraceArchive::open(const QString& path)
+{
+    close();
+
+    int fd = ::open(path.toLocal8Bit().constData(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        qWarning() << "Failed to open trace archive" << path << ":" << strerror(errno);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(TraceArchiveHeader)) {
+        qWarning() << "Trace archive" << path << "is truncated";
+        ::close(fd);
+        return false;
+    }
+    map_ = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map_ == MAP_FAILED) {
+        qWarning() << "Failed to map trace archive" << path << ":" << strerror(errno);
+        return false;
+    }
+    mapSize_ = st.st_size;
+    madvise(map_, mapSize_, MADV_SEQUENTIAL);
+
+    const TraceArchiveHeader* header = (const TraceArchiveHeader*)map_;
+    if (header->magic != MAGIC || header->version != VERSION || !header->blockSize) {
+        qWarning() << "Unsupported trace archive" << path;
+        close();
+        return false;
+    }
+    if (!header->indexOffset || header->indexOffset > mapSize_ ||
+        (mapSize_ - header->indexOffset) / sizeof(TraceArchiveIndexEntry) < header->blockCount ||
+        header->indexOffset % sizeof(quint64)) {
+        qWarning() << "Trace archive" << path << "has no valid block index";
+        close();
+        return false;
+    }
+
+    // Validate the index once so that decode() can trust it
+    index_ = (const TraceArchiveIndexEntry*)((const char*)map_ + header->indexOffset);
+    quint64 records = 0;
+    for (unsigned int i = 0; i < header->blockCount; ++i) {
+        const TraceArchiveIndexEntry& entry = index_[i];
+        bool last = i + 1 == header->blockCount;
+        if (entry.offset < sizeof(TraceArchiveHeader) || entry.offset > header->indexOffset ||
+            entry.length > header->indexOffset - entry.offset || !entry.count ||
+            entry.count > header->blockSize || (!last && entry.count != header->blockSize)) {
+            qWarning() << "Trace archive" << path << "has a corrupted block index";
+            close();
+            return false;
+        }
+        records += entry.count;
+    }
+    if (records != header->count) {
+        qWarning() << "Trace archive" << path << "index does not match its record count";
+        close();
+        return false;
+    }
+
+    blockSize_ = header->blockSize;
+    blocks_ = header->blockCount;
+    count_ = header->count;
+    return true;
+}
+
+void TraceArchive::close()
+{
+    if (map_ != MAP_FAILED)
+        munmap(map_, mapSize_);
+    map_ = MAP_FAILED;
+    mapSize_ = 0;
+    index_ = 0;
+    blockSize_ = 0;
+    blocks_ = 0;
+    count_ = 0;
+}
+
+unsigned int TraceArchive::count() const
+{
+    return count_;
+}
+
+unsigned int TraceArchive::blockSize() const
+{
+    return blockSize_;
+}
+
+unsigned int TraceArchive::blockCount() const
+{
+    return blocks_;
+}
+
+unsigned int TraceArchive::findBlock(quint64 timestamp) const
+{
+    unsigned int low = 0;
+    unsigned int high = blocks_;
+    while (low < high) {
+        unsigned int middle = low + (high - low) / 2;
+        if (index_[middle].lastTimestamp < timestamp)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low;
+}
+
+bool TraceArchive::decode(unsigned int block, SensorTraceRecord* records) const
+{
+    const TraceArchiveIndexEntry& entry = index_[block];
+    const unsigned char* in = (const unsigned char*)map_ + entry.offset;
+    const unsigned char* end = in + entry.length;
+    const unsigned int n = entry.count;
+    qint64 delta;
+
+    quint64 timestamp = entry.firstTimestamp;
+    for (unsigned int i = 0; i < n; ++i) {
+        if (!getVarint(in, end, delta))
+            return false;
+        timestamp += (quint64)delta;
+        records[i].timestamp = timestamp;
+        records[i].reserved = 0;
+    }
+
+    // Deltas wrap around like the 32-bit values they were taken of
+    qint32 value = 0;
+    for (unsigned int i = 0; i < n; ++i) {
+        if (!getVarint(in, end, delta))
+            return false;
+        value = (qint32)((quint32)value + (quint32)delta);
+        records[i].x = value;
+    }
+    value = 0;
+    for (unsigned int i = 0; i < n; ++i) {
+        if (!getVarint(in, end, delta))
+            return false;
+        value = (qint32)((quint32)value + (quint32)delta);
+        records[i].y = value;
+    }
+    value = 0;
+    for (unsigned int i = 0; i < n; ++i) {
+        if (!getVarint(in, end, delta))
+            return false;
+        value = (qint32)((quint32)value + (quint32)delta);
+        records[i].z = value;
+    }
+    return in == end;
+}
+
+TraceArchiveWriter::TraceArchiveWriter() :
+    file_(0),
+    blockSize_(DEFAULT_BLOCK_SIZE),
+    count_(0),
+    offset_(0)
+{
+}
+
+TraceArchiveWriter::~TraceArchiveWriter()
+{
+    close();
+}
+
+bool TraceArchiveWriter::open(const QString& path, unsigned int blockSize)
+{
+    close();
+
+    file_ = fopen(path.toLocal8Bit().constData(), "wb");
+    if (!file_) {
+        qWarning() << "Failed to create trace archive" << path << ":" << strerror(errno);
+        return false;
+    }
+    blockSize_ = qMax(1u, blockSize);
+    count_ = 0;
+    offset_ = sizeof(TraceArchiveHeader);
+    pending_.clear();
+    pending_.reserve(blockSize_);
+    index_.clear();
+
+    // Header is completed by close(), until then readers reject the file
+    TraceArchiveHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = TraceArchive::MAGIC;
+    header.version = TraceArchive::VERSION;
+    header.blockSize = blockSize_;
+    if (fwrite(&header, sizeof(header), 1, file_) != 1) {
+        qWarning() << "Failed to write trace archive" << path << ":" << strerror(errno);
+        fclose(file_);
+        file_ = 0;
+        return false;
+    }
+    return true;
+}
+
+bool TraceArchiveWriter::append(quint64 timestamp, int x, int y, int z)
+{
+    if (!file_)
+        return false;
+    SensorTraceRecord record;
+    record.timestamp = timestamp;
+    record.x = x;
+    record.y = y;
+    record.z = z;
+    record.reserved = 0;
+    pending_.append(record);
+    ++count_;
+    return pending_.size() < (int)blockSize_ || flush();
+}
+
+bool TraceArchiveWriter::append(const SensorTrace& trace)
+{
+    for (unsigned int i = 0; i < trace.count(); ++i) {
+        const SensorTraceRecord& record = trace.at(i);
+        if (!append(record.timestamp, record.x, record.y, record.z))
+            return false;
+    }
+    return true;
+}
+
+bool TraceArchiveWriter::flush()
+{
+    const int n = pending_.size();
+    if (!n)
+        return true;
+    const SensorTraceRecord* records = pending_.constData();
+
+    block_.resize(n * (MAX_VARINT_BYTES + 3 * 5));
+    unsigned char* out = (unsigned char*)block_.data();
+    const unsigned char* begin = out;
+
+    quint64 timestamp = records[0].timestamp;
+    for (int i = 0; i < n; ++i) {
+        out = putVarint(out, (qint64)(records[i].timestamp - timestamp));
+        timestamp = records[i].timestamp;
+    }
+    qint32 value = 0;
+    for (int i = 0; i < n; ++i) {
+        out = putVarint(out, (qint64)records[i].x - value);
+        value = records[i].x;
+    }
+    value = 0;
+    for (int i = 0; i < n; ++i) {
+        out = putVarint(out, (qint64)records[i].y - value);
+        value = records[i].y;
+    }
+    value = 0;
+    for (int i = 0; i < n; ++i) {
+        out = putVarint(out, (qint64)records[i].z - value);
+        value = records[i].z;
+    }
+
+    TraceArchiveIndexEntry entry;
+    entry.offset = offset_;
+    entry.firstTimestamp = records[0].timestamp;
+    entry.lastTimestamp = records[n - 1].timestamp;
+    entry.count = n;
+    entry.length = out - begin;
+    pending_.resize(0);
+
+    if (fwrite(begin, 1, entry.length, file_) != entry.length) {
+        qWarning() << "Failed to write trace archive block:" << strerror(errno);
+        fclose(file_);
+        file_ = 0;
+        return false;
+    }
+    index_.append(entry);
+    offset_ += entry.length;
+    return true;
+}
+
+bool TraceArchiveWriter::close()
+{
+    if (!file_)
+        return false;
+    bool written = flush();
+    if (!file_)
+        return false;
+
+    // Index entries hold 64-bit fields, keep them aligned in the mapping
+    static const char padding[sizeof(quint64)] = { 0 };
+    unsigned int pad = (sizeof(quint64) - offset_ % sizeof(quint64)) % sizeof(quint64);
+    TraceArchiveHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = TraceArchive::MAGIC;
+    header.version = TraceArchive::VERSION;
+    header.blockSize = blockSize_;
+    header.blockCount = index_.size();
+    header.count = count_;
+    header.indexOffset = offset_ + pad;
+
+    written = written &&
+        fwrite(padding, 1, pad, file_) == pad &&
+        fwrite(index_.constData(), sizeof(TraceArchiveIndexEntry), index_.size(), file_) == (size_t)index_.size() &&
+        fseek(file_, 0, SEEK_SET) == 0 &&
+        fwrite(&header, sizeof(header), 1, file_) == 1;
+    if (fclose(file_) != 0)
+        written = false;
+    file_ = 0;
+    if (!written)
+        qWarning() << "Failed to complete trace archive:" << strerror(errno);
+    return written;
+}
@@ -0,0 +1,247 @@
+/**
+   @file tracearchive.h
+   @brief Columnar block indexed archives of sensor traces
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+
+#ifndef TRACEARCHIVE_H
+#define TRACEARCHIVE_H
+
+#include <QtGlobal>
+#include <QString>
+#include <QByteArray>
+#include <QVector>
+#include <stdio.h>
+#include "sensortrace.h"
+
+/**
+ * Archive file header. The header is followed by the encoded blocks and
+ * the block index of #blockCount TraceArchiveIndexEntry items at
+ * #indexOffset. Fields are in host byte order. An archive whose writer
+ * did not finish has a zero #indexOffset.
+ */
+struct TraceArchiveHeader
+{
+    quint32 magic;       /**< #TraceArchive::MAGIC */
+    quint32 version;     /**< #TraceArchive::VERSION */
+    quint32 blockSize;   /**< records per block, all but the last block are full */
+    quint32 blockCount;  /**< number of blocks */
+    quint32 count;       /**< number of records */
+    quint32 reserved;    /**< zero */
+    quint64 indexOffset; /**< file offset of the block index */
+};
+
+/**
+ * Block index entry. Blocks can be located by record number or
+ * timestamp without touching the encoded data.
+ */
+struct TraceArchiveIndexEntry
+{
+    quint64 offset;         /**< file offset of the block */
+    quint64 firstTimestamp; /**< timestamp of the first record */
+    quint64 lastTimestamp;  /**< timestamp of the last record */
+    quint32 count;          /**< records in the block */
+    quint32 length;         /**< encoded bytes of the block */
+};
+
+/**
+ * Read-only memory mapped archive of a sensor trace.
+ *
+ * Records are stored in blocks of a fixed number of records. Each block
+ * holds four columns one after another: timestamps, x, y and z. A column
+ * stores the zigzag varint difference of each value to the previous one
+ * in the column, the first timestamp to that of the index entry and the
+ * first x, y and z to zero. Steady sampling and slowly changing values
+ * take one or two bytes per value instead of the 24 byte records of
+ * SensorTrace, and columns are decoded in tight loops straight from the
+ * mapping.
+ */
+class TraceArchive
+{
+public:
+    static const quint32 MAGIC = 0x41465754;  /**< header magic */
+    static const quint32 VERSION = 1;         /**< format version */
+
+    /**
+     * Constructor. Archive is empty until opened.
+     */
+    TraceArchive();
+
+    /**
+     * Destructor.
+     */
+    ~TraceArchive();
+
+    /**
+     * Does given file start with the archive magic.
+     *
+     * @param path file path.
+     * @return is the file an archive.
+     */
+    static bool probe(const QString& path);
+
+    /**
+     * Map archive file.
+     *
+     * @param path archive file path.
+     * @return was the file mapped and its header and index valid.
+     */
+    bool open(const QString& path);
+
+    /**
+     * Unmap archive file.
+     */
+    void close();
+
+    /**
+     * Number of records.
+     *
+     * @return record count.
+     */
+    unsigned int count() const;
+
+    /**
+     * Records per block. All blocks but the last are full.
+     *
+     * @return block size.
+     */
+    unsigned int blockSize() const;
+
+    /**
+     * Number of blocks.
+     *
+     * @return block count.
+     */
+    unsigned int blockCount() const;
+
+    /**
+     * Index entry of given block.
+     *
+     * @param block block index, less than #blockCount().
+     * @return index entry.
+     */
+    const TraceArchiveIndexEntry& block(unsigned int block) const
+    {
+        return index_[block];
+    }
+
+    /**
+     * Find the block holding the first record at or after given time.
+     *
+     * @param timestamp time in microseconds.
+     * @return block index, #blockCount() if all records are older.
+     */
+    unsigned int findBlock(quint64 timestamp) const;
+
+    /**
+     * Decode the records of a block.
+     *
+     * @param block block index, less than #blockCount().
+     * @param records location for TraceArchiveIndexEntry::count records.
+     * @return false if the block is corrupted.
+     */
+    bool decode(unsigned int block, SensorTraceRecord* records) const;
+
+private:
+    Q_DISABLE_COPY(TraceArchive)
+
+    void*                         map_;       /**< mapped file */
+    size_t                        mapSize_;   /**< mapped size in bytes */
+    const TraceArchiveIndexEntry* index_;     /**< block index */
+    unsigned int                  blockSize_; /**< records per block */
+    unsigned int                  blocks_;    /**< block count */
+    unsigned int                  count_;     /**< record count */
+};
+
+/**
+ * Writes records into a trace archive, encoding a block whenever it is
+ * full. Records must be appended in time order for the block index to be
+ * searchable, although any timestamps are stored losslessly.
+ */
+class TraceArchiveWriter
+{
+public:
+    /** Default records per block, about 40 seconds at 100 Hz. */
+    static const unsigned int DEFAULT_BLOCK_SIZE = 4096;
+
+    /**
+     * Constructor.
+     */
+    TraceArchiveWriter();
+
+    /**
+     * Destructor. Closes the archive.
+     */
+    ~TraceArchiveWriter();
+
+    /**
+     * Create archive file and write a placeholder header.
+     *
+     * @param path archive file path.
+     * @param blockSize records per block.
+     * @return was the file created.
+     */
+    bool open(const QString& path, unsigned int blockSize = DEFAULT_BLOCK_SIZE);
+
+    /**
+     * Append a record.
+     *
+     * @param timestamp monotonic capture time in microseconds.
+     * @param x x value.
+     * @param y y value.
+     * @param z z value.
+     * @return was the record written.
+     */
+    bool append(quint64 timestamp, int x, int y, int z);
+
+    /**
+     * Append all records of a trace, e.g. one written by TraceRecorder.
+     *
+     * @param trace opened trace.
+     * @return were the records written.
+     */
+    bool append(const SensorTrace& trace);
+
+    /**
+     * Write the last block and the index, and close the file.
+     *
+     * @return was the archive completed.
+     */
+    bool close();
+
+private:
+    Q_DISABLE_COPY(TraceArchiveWriter)
+
+    /**
+     * Encode and write the pending records as one block.
+     *
+     * @return was the block written.
+     */
+    bool flush();
+
+    FILE*                            file_;       /**< archive file */
+    unsigned int                     blockSize_;  /**< records per block */
+    unsigned int                     count_;      /**< records written */
+    quint64                          offset_;     /**< file offset of the next block */
+    QVector<SensorTraceRecord>       pending_;    /**< records of the open block */
+    QVector<TraceArchiveIndexEntry>  index_;      /**< entries of written blocks */
+    QByteArray                       block_;      /**< encoded block, allocation reused */
+};
+
+#endif // TRACEARCHIVE_H
@@ -27,7 +27,10 @@
 #ifndef UNSIGNED_H
 #define UNSIGNED_H
 
+#include <QObject>
+#ifndef SENSORFW_NO_DBUS
 #include <QDBusArgument>
+#endif
 #include <datatypes/timedunsigned.h>
 
 /**
@@ -98,11 +101,14 @@ public:
 private:
     TimedUnsigned data_; /**< Contained data. */
 
+#ifndef SENSORFW_NO_DBUS
     friend const QDBusArgument &operator>>(const QDBusArgument &argument, Unsigned& data);
+#endif
 };
 
 Q_DECLARE_METATYPE( Unsigned )
 
+#ifndef SENSORFW_NO_DBUS
 /**
  * Marshall the Unsigned data into a D-Bus argument
  *
@@ -127,10 +133,13 @@ inline QDBusArgument &operator<<(QDBusArgument &argument, const Unsigned &data)
  */
 inline const QDBusArgument &operator>>(const QDBusArgument &argument, Unsigned &data)
 {
+    quint64 timestamp;
     argument.beginStructure();
-    argument >> data.data_.timestamp_ >> data.data_.value_;
+    argument >> timestamp >> data.data_.value_;
+    data.data_.timestamp_ = timestamp;
     argument.endStructure();
     return argument;
 }
+#endif // SENSORFW_NO_DBUS
 
 #endif // UNSIGNED_H
@@ -26,7 +26,9 @@
  */
 
 #include <QtGlobal>
+#ifndef SENSORFW_NO_DBUS
 #include <QDBusMetaType>
+#endif
 #include <ctime>
 #include "utils.h"
 #include "xyz.h"
@@ -38,10 +40,14 @@
 #include "datarange.h"
 #include "tap.h"
 #include "posedata.h"
+#include "fusiondata.h"
+#include "statisticsdata.h"
+#include "rotationdeltadata.h"
 #include "proximity.h"
 
 void __attribute__ ((constructor)) datatypes_init(void)
 {
+#ifndef SENSORFW_NO_DBUS
     qDBusRegisterMetaType<XYZ>();
     qDBusRegisterMetaType<Compass>();
     qDBusRegisterMetaType<Unsigned>();
@@ -52,8 +58,23 @@ void __attribute__ ((constructor)) datatypes_init(void)
     qDBusRegisterMetaType<DataRangeList>();
     qDBusRegisterMetaType<IntegerRange>();
     qDBusRegisterMetaType<IntegerRangeList>();
+#else
+    qRegisterMetaType<XYZ>();
+    qRegisterMetaType<Compass>();
+    qRegisterMetaType<Unsigned>();
+    qRegisterMetaType<Orientation>();
+    qRegisterMetaType<MagneticField>();
+    qRegisterMetaType<Tap>();
+    qRegisterMetaType<DataRange>();
+    qRegisterMetaType<DataRangeList>();
+    qRegisterMetaType<IntegerRange>();
+    qRegisterMetaType<IntegerRangeList>();
+#endif
     qRegisterMetaType<TimedUnsigned>();
     qRegisterMetaType<PoseData>();
+    qRegisterMetaType<FusionData>();
+    qRegisterMetaType<XyzStatisticsData>();
+    qRegisterMetaType<RotationDeltaData>();
     qRegisterMetaType<Proximity>();
 }
 
@@ -27,7 +27,10 @@
 #ifndef XYZ_H
 #define XYZ_H
 
+#include <QObject>
+#ifndef SENSORFW_NO_DBUS
 #include <QDBusArgument>
+#endif
 #include <datatypes/orientationdata.h>
 
 /**
@@ -115,11 +118,14 @@ public:
 private:
     TimedXyzData data_; /**< Contained data. */
 
+#ifndef SENSORFW_NO_DBUS
     friend const QDBusArgument &operator>>(const QDBusArgument &argument, XYZ& xyz);
+#endif
 };
 
 Q_DECLARE_METATYPE( XYZ )
 
+#ifndef SENSORFW_NO_DBUS
 /**
  * Marshall the XYZ data into a D-Bus argument
  *
@@ -144,10 +150,13 @@ inline QDBusArgument &operator<<(QDBusArgument &argument, const XYZ &xyz)
  */
 inline const QDBusArgument &operator>>(const QDBusArgument &argument, XYZ &xyz)
 {
+    quint64 timestamp;
     argument.beginStructure();
-    argument >> xyz.data_.timestamp_ >> xyz.data_.x_ >> xyz.data_.y_ >> xyz.data_.z_;
+    argument >> timestamp >> xyz.data_.x_ >> xyz.data_.y_ >> xyz.data_.z_;
+    xyz.data_.timestamp_ = timestamp;
     argument.endStructure();
     return argument;
 }
+#endif // SENSORFW_NO_DBUS
 
 #endif // XYZ_H
@@ -34,6 +34,7 @@
 SampleChain::SampleChain(const QString& id) :
     AbstractChain(id)
 {
+    NodeArenaScope scope(&arena());
     SensorManager& sm = SensorManager::instance();
 
     // Get a pointer (refcounted) to the adaptor from sensor manager
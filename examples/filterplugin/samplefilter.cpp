@@ -30,18 +30,25 @@ SampleFilter::SampleFilter() :
 {
 }
 
-void SampleFilter::filter(unsigned, const TimedUnsigned* data)
+void SampleFilter::filter(unsigned n, const TimedUnsigned* data)
 {
-    TimedUnsigned transformed;
+    // Sinks may receive several samples at once. Process all of them
+    // and propagate the results as a single batch.
+    FilterBatch<TimedUnsigned> batch;
+    batch.resize(n);
 
-    // Usually you want to keep the timestamp of the original data, as
-    // one is likely to be interested in the time that the action
-    // happened. Apply common sense.
-    transformed.timestamp_ = data->timestamp_;
+    for (unsigned i = 0; i < n; ++i, ++data) {
+        TimedUnsigned& transformed(batch[i]);
 
-    // Do something for the value.
-    transformed.value_ = data->value_ * data->value_;
+        // Usually you want to keep the timestamp of the original data, as
+        // one is likely to be interested in the time that the action
+        // happened. Apply common sense.
+        transformed.timestamp_ = data->timestamp_;
 
-    // Propagate the altered sample to outputs
-    source_.propagate(1, &transformed);
+        // Do something for the value.
+        transformed.value_ = data->value_ * data->value_;
+    }
+
+    // Propagate the altered samples to outputs
+    batch.propagate(source_);
 }
@@ -34,6 +34,7 @@ SampleSensorChannel::SampleSensorChannel(const QString& id) :
         DataEmitter<TimedUnsigned>(10),
         previousSample_(0, 0)
 {
+    NodeArenaScope scope(&arena());
     SensorManager& sm = SensorManager::instance();
 
     // Get pointer to chain and create a reader for it
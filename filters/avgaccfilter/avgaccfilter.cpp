@@ -23,36 +23,43 @@
 
 AvgAccFilter::AvgAccFilter() :
     Filter<TimedXyzData, AvgAccFilter, TimedXyzData>(this, &AvgAccFilter::interpret),
-    avgAccdata(0,0,0,0),
     filterFactor(0.2)
 {
+    reset();
 }
 
-void AvgAccFilter::interpret(unsigned, const TimedXyzData *data)
+void AvgAccFilter::interpret(unsigned n, const TimedXyzData *data)
 {
-    avgAccdata.x_ = data->x_ * filterFactor + avgAccdata.x_ * (1.0 - filterFactor);
-    avgAccdata.y_ = data->y_ * filterFactor + avgAccdata.y_ * (1.0 - filterFactor);
-    avgAccdata.z_ = data->z_ * filterFactor + avgAccdata.z_ * (1.0 - filterFactor);
-
-    TimedXyzData filteredData(data->timestamp_,
-                              avgAccdata.x_,
-                              avgAccdata.y_,
-                              avgAccdata.z_);
-
-    sensordLogT() << "averaged: "
-                  << filteredData.x_
-                  << ", "
-                  << filteredData.y_
-                  << ", " << filteredData.z_;
-
-    source_.propagate(1, &filteredData);
+    FilterBatch<TimedXyzData> batch;
+    const double keep = 1.0 - filterFactor;
+
+    for (unsigned i = 0; i < n; ++i, ++data) {
+        average[0] = data->x_ * filterFactor + average[0] * keep;
+        average[1] = data->y_ * filterFactor + average[1] * keep;
+        average[2] = data->z_ * filterFactor + average[2] * keep;
+
+        TimedXyzData filteredData(data->timestamp_,
+                                  qRound(average[0]),
+                                  qRound(average[1]),
+                                  qRound(average[2]));
+
+        sensordLogT() << "averaged: "
+                      << filteredData.x_
+                      << ", "
+                      << filteredData.y_
+                      << ", " << filteredData.z_;
+
+        batch.append(filteredData);
+    }
+
+    batch.propagate(source_);
 }
 
 void AvgAccFilter::reset()
 {
-    avgAccdata.x_ = 0;
-    avgAccdata.y_ = 0;
-    avgAccdata.z_ = 0;
+    average[0] = 0;
+    average[1] = 0;
+    average[2] = 0;
 }
 
 void AvgAccFilter::setFactor(qreal f)
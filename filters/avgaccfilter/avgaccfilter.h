@@ -46,11 +46,7 @@ private:
 
     void interpret(unsigned, const TimedXyzData*);
 
-    typedef QList<TimedXyzData> XyzAvgAccBuffer;
-
-    TimedXyzData avgAccdata;
-    XyzAvgAccBuffer avgBuffer;
-    unsigned int avgBufferSize;
+    double average[3]; /**< running average, unrounded so that it reaches steady input */
     qreal filterFactor;
 };
 
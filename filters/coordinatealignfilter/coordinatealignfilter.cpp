@@ -25,21 +25,113 @@
  */
 
 #include "coordinatealignfilter.h"
+#include "logging.h"
+
+XyzTransformKernel CoordinateAlignFilter::kernel_ = xyzTransformScalar;
 
 CoordinateAlignFilter::CoordinateAlignFilter() :
-        Filter<TimedXyzData, CoordinateAlignFilter, TimedXyzData>(this, &CoordinateAlignFilter::filter)
+        sink_(this, &CoordinateAlignFilter::filterLanes, &CoordinateAlignFilter::filter),
+        permute_(false),
+        signs_(0),
+        identity_(false)
 {
+    addSink(&sink_, "sink");
+    addSource(&source_, "source");
+    setMatrix(matrix_);
 }
 
-void CoordinateAlignFilter::filter(unsigned, const TimedXyzData* data)
+void CoordinateAlignFilter::setMatrix(const TMatrix& matrix)
 {
-    TimedXyzData transformed;
+    matrix_ = matrix;
+    for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 3; ++j)
+            coefficients_[i * 3 + j] = matrix_.data_[i][j];
+    permute_ = permutation(matrix_, axes_, signs_);
+    identity_ = permute_ && !signs_ && axes_[0] == 0 && axes_[1] == 1 && axes_[2] == 2;
+}
+
+bool CoordinateAlignFilter::permutation(const TMatrix& matrix, int axes[3], int& signs)
+{
+    signs = 0;
+    for (int i = 0; i < 3; ++i) {
+        axes[i] = -1;
+        for (int j = 0; j < 3; ++j) {
+            double value = matrix.data_[i][j];
+            if (value == 0)
+                continue;
+            if ((value != 1 && value != -1) || axes[i] != -1)
+                return false;
+            axes[i] = j;
+            if (value < 0)
+                signs |= 1 << i;
+        }
+        if (axes[i] == -1)
+            return false;
+    }
+    // Each source axis must be used once
+    return axes[0] != axes[1] && axes[0] != axes[2] && axes[1] != axes[2];
+}
+
+void CoordinateAlignFilter::selectKernel()
+{
+    const char* name = 0;
+    kernel_ = xyzTransformKernel(&name);
+    sensordLogD() << "CoordinateAlignFilter using" << name << "transform kernel";
+}
+
+void CoordinateAlignFilter::filter(unsigned n, const TimedXyzData* data)
+{
+    if (identity_)
+        source_.propagate(n, data);
+    else
+        sink_.collectAsLanes(n, data);
+}
+
+void CoordinateAlignFilter::filterLanes(const XyzLanes<int>& in)
+{
+    if (identity_) {
+        source_.propagate(in);
+        return;
+    }
+
+    XyzLanes<int> out;
+    out.count = in.count;
+    memcpy(out.timestamp, in.timestamp, in.count * sizeof(in.timestamp[0]));
+
+    if (permute_) {
+        // Lanes are copied or negated as a whole
+        for (int a = 0; a < 3; ++a) {
+            const int* src = in.lane(axes_[a]);
+            int* dst = out.lane(a);
+            if (signs_ & (1 << a)) {
+                for (unsigned i = 0; i < in.count; ++i)
+                    dst[i] = -src[i];
+            } else {
+                memcpy(dst, src, in.count * sizeof(int));
+            }
+        }
+        source_.propagate(out);
+        return;
+    }
+
+    XyzBlock block;
+    for (unsigned done = 0; done < in.count; done += XyzBlock::SIZE) {
+        unsigned count = qMin(in.count - done, XyzBlock::SIZE);
+
+        for (unsigned i = 0; i < count; ++i) {
+            block.x[i] = in.x[done + i];
+            block.y[i] = in.y[done + i];
+            block.z[i] = in.z[done + i];
+        }
 
-    transformed.timestamp_ = data->timestamp_;
+        kernel_(coefficients_, count, block);
 
-    transformed.x_ = matrix_.get(0,0)*data->x_ + matrix_.get(0,1)*data->y_ + matrix_.get(0,2)*data->z_;
-    transformed.y_ = matrix_.get(1,0)*data->x_ + matrix_.get(1,1)*data->y_ + matrix_.get(1,2)*data->z_;
-    transformed.z_ = matrix_.get(2,0)*data->x_ + matrix_.get(2,1)*data->y_ + matrix_.get(2,2)*data->z_;
+        for (unsigned i = 0; i < count; ++i) {
+            out.x[done + i] = block.x[i];
+            out.y[done + i] = block.y[i];
+            out.z[done + i] = block.z[i];
+        }
+    }
 
-    source_.propagate(1, &transformed);
+    source_.propagate(out);
 }
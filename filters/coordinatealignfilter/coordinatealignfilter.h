@@ -29,6 +29,8 @@
 
 #include "datatypes/orientationdata.h"
 #include "filter.h"
+#include "xyzlanes.h"
+#include "xyztransform.h"
 
 /**
  * TMatrix holds a transformation matrix.
@@ -71,8 +73,19 @@ Q_DECLARE_METATYPE(TMatrix);
  * Transformation is described by transformation matrix which is set through
  * \c TMatrix property. Matrix must be of size 3x3. Default TMatrix is
  * identity matrix.
+ *
+ * Batches are staged into structure-of-arrays blocks and transformed with
+ * a vectorized kernel chosen by #selectKernel(). Matrices which only swap
+ * axes and flip signs are detected when set and handled by specialized
+ * permutation kernels without multiplications; identity matrix passes
+ * samples through unchanged.
+ */
+/**
+ * Filter transforming samples with a matrix. Samples are processed as
+ * XyzLanes, so lane batches from other lane filters are transformed
+ * without conversion.
  */
-class CoordinateAlignFilter : public QObject, public Filter<TimedXyzData, CoordinateAlignFilter, TimedXyzData>
+class CoordinateAlignFilter : public QObject, public FilterBase
 {
     Q_OBJECT;
     Q_PROPERTY(TMatrix transMatrix READ matrix WRITE setMatrix);
@@ -88,7 +101,13 @@ public:
 
     const TMatrix& matrix() const { return matrix_; }
 
-    void setMatrix(const TMatrix& matrix) { matrix_ = matrix; }
+    void setMatrix(const TMatrix& matrix);
+
+    /**
+     * Select transform kernel for the running CPU. Called when the plugin
+     * is loaded; scalar kernel is used until then.
+     */
+    static void selectKernel();
 
 protected:
     /**
@@ -97,9 +116,38 @@ protected:
     CoordinateAlignFilter();
 
 private:
+    /**
+     * Callback for arrays of samples. Identity passes them through,
+     * others are converted into lanes.
+     */
     void filter(unsigned, const TimedXyzData*);
 
-    TMatrix matrix_;
+    /**
+     * Callback for lane batches.
+     */
+    void filterLanes(const XyzLanes<int>& lanes);
+
+    /**
+     * Check if matrix permutes axes and flips signs.
+     *
+     * @param matrix transformation matrix.
+     * @param axes set to source axis of each output axis.
+     * @param signs set to sign bits, bit n set negates output axis n.
+     * @return is matrix a signed permutation.
+     */
+    static bool permutation(const TMatrix& matrix, int axes[3], int& signs);
+
+    LaneSink<CoordinateAlignFilter, TimedXyzData> sink_;   /**< data sink */
+    LaneSource<TimedXyzData>                      source_; /**< data source */
+
+    TMatrix       matrix_;
+    float         coefficients_[9]; /**< matrix_ in row-major order for kernels */
+    bool          permute_;         /**< is matrix_ a signed permutation */
+    int           axes_[3];         /**< source axes of a permutation */
+    int           signs_;           /**< negated axes of a permutation */
+    bool          identity_;        /**< is matrix_ identity */
+
+    static XyzTransformKernel kernel_; /**< selected transform kernel */
 };
 
 #endif // COORDINATEALIGNFILTER_H
@@ -1,9 +1,11 @@
 TARGET = coordinatealignfilter
 
 HEADERS += coordinatealignfilter.h \
-           coordinatealignfilterplugin.h
+           coordinatealignfilterplugin.h \
+           xyztransform.h
 
 SOURCES += coordinatealignfilter.cpp \
-           coordinatealignfilterplugin.cpp
+           coordinatealignfilterplugin.cpp \
+           xyztransform.cpp
 
 include( ../filter-config.pri )
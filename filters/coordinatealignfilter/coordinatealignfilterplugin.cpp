@@ -32,6 +32,7 @@ void CoordinateAlignFilterPlugin::Register(class Loader&)
 {
     sensordLogD() << "registering coordinatealignfilter";
     SensorManager& sm = SensorManager::instance();
+    CoordinateAlignFilter::selectKernel();
     sm.registerFilter<CoordinateAlignFilter>("coordinatealignfilter");
 }
 
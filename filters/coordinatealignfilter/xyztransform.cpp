@@ -0,0 +1,100 @@
+/**
+   @file xyztransform.cpp
+   @brief 3x3 transform kernels for batches of xyz samples
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "xyztransform.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#if !defined(__aarch64__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+#endif
+
+void xyzTransformScalar(const float m[9], unsigned n, XyzBlock& block)
+{
+    for (unsigned i = 0; i < n; ++i) {
+        float x = block.x[i];
+        float y = block.y[i];
+        float z = block.z[i];
+        block.x[i] = m[0] * x + m[1] * y + m[2] * z;
+        block.y[i] = m[3] * x + m[4] * y + m[5] * z;
+        block.z[i] = m[6] * x + m[7] * y + m[8] * z;
+    }
+}
+
+#if defined(__SSE2__)
+
+static void xyzTransformSse(const float m[9], unsigned n, XyzBlock& block)
+{
+    __m128 c[9];
+    for (int k = 0; k < 9; ++k)
+        c[k] = _mm_set1_ps(m[k]);
+
+    // Block is padded to a multiple of four, lanes past n are ignored
+    for (unsigned i = 0; i < n; i += 4) {
+        __m128 x = _mm_load_ps(block.x + i);
+        __m128 y = _mm_load_ps(block.y + i);
+        __m128 z = _mm_load_ps(block.z + i);
+        _mm_store_ps(block.x + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(c[0], x), _mm_mul_ps(c[1], y)), _mm_mul_ps(c[2], z)));
+        _mm_store_ps(block.y + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(c[3], x), _mm_mul_ps(c[4], y)), _mm_mul_ps(c[5], z)));
+        _mm_store_ps(block.z + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(c[6], x), _mm_mul_ps(c[7], y)), _mm_mul_ps(c[8], z)));
+    }
+}
+
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+
+static void xyzTransformNeon(const float m[9], unsigned n, XyzBlock& block)
+{
+    for (unsigned i = 0; i < n; i += 4) {
+        float32x4_t x = vld1q_f32(block.x + i);
+        float32x4_t y = vld1q_f32(block.y + i);
+        float32x4_t z = vld1q_f32(block.z + i);
+        vst1q_f32(block.x + i, vmlaq_n_f32(vmlaq_n_f32(vmulq_n_f32(x, m[0]), y, m[1]), z, m[2]));
+        vst1q_f32(block.y + i, vmlaq_n_f32(vmlaq_n_f32(vmulq_n_f32(x, m[3]), y, m[4]), z, m[5]));
+        vst1q_f32(block.z + i, vmlaq_n_f32(vmlaq_n_f32(vmulq_n_f32(x, m[6]), y, m[7]), z, m[8]));
+    }
+}
+
+#endif
+
+XyzTransformKernel xyzTransformKernel(const char** name)
+{
+#if defined(__SSE2__)
+    if (name)
+        *name = "sse2";
+    return xyzTransformSse;
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#if !defined(__aarch64__)
+    if (getauxval(AT_HWCAP) & HWCAP_NEON)
+#endif
+    {
+        if (name)
+            *name = "neon";
+        return xyzTransformNeon;
+    }
+#endif
+    if (name)
+        *name = "scalar";
+    return xyzTransformScalar;
+}
@@ -0,0 +1,62 @@
+/**
+   @file xyztransform.h
+   @brief 3x3 transform kernels for batches of xyz samples
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef XYZTRANSFORM_H
+#define XYZTRANSFORM_H
+
+/**
+ * Structure-of-arrays staging block for xyz samples. Components are
+ * stored contiguously so kernels can load several samples per vector
+ * register.
+ */
+struct XyzBlock
+{
+    static const unsigned SIZE = 32; /**< samples per block, multiple of 4 */
+
+    float x[SIZE] __attribute__((aligned(16))); /**< x components */
+    float y[SIZE] __attribute__((aligned(16))); /**< y components */
+    float z[SIZE] __attribute__((aligned(16))); /**< z components */
+};
+
+/**
+ * Transform kernel. Multiplies samples 0..n-1 of the block in place by
+ * row-major 3x3 matrix.
+ *
+ * @param m row-major matrix coefficients.
+ * @param n number of samples, at most XyzBlock::SIZE.
+ * @param block samples to transform.
+ */
+typedef void (*XyzTransformKernel)(const float m[9], unsigned n, XyzBlock& block);
+
+/**
+ * Portable scalar kernel.
+ */
+void xyzTransformScalar(const float m[9], unsigned n, XyzBlock& block);
+
+/**
+ * Select fastest kernel supported by the CPU.
+ *
+ * @param name set to the name of selected kernel if not NULL.
+ * @return selected kernel.
+ */
+XyzTransformKernel xyzTransformKernel(const char** name = 0);
+
+#endif // XYZTRANSFORM_H
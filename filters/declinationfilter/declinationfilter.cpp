@@ -26,63 +26,83 @@
 
 #include <MGConfItem>
 #include <QSettings>
+#include <QFileSystemWatcher>
+#include <QFileInfo>
 
 #include "declinationfilter.h"
-#include "config.h"
 #include "logging.h"
+#include "datatypes/atomic.h"
 
 const char* DeclinationFilter::declinationKey = "/system/osso/location/settings/magneticvariation";
 
+/** Location configuration holding magnetic declination */
+static const char* LOCATION_CONF = "/etc/xdg/sensorfw/location.conf";
+
 DeclinationFilter::DeclinationFilter() :
         Filter<CompassData, DeclinationFilter, CompassData>(this, &DeclinationFilter::correct),
-        declinationCorrection_(0)
+        declinationCorrection_(0),
+        declinationItem_(new MGConfItem(declinationKey)),
+        locationWatcher_(new QFileSystemWatcher)
 {
-    updateInterval_ = Config::configuration()->value<quint64>("compass/declination_update_interval", 1000 * 60 * 60) * 1000;
+    // Directory is watched too, as the file may not exist yet or be
+    // replaced by a new one
+    locationWatcher_->addPath(QFileInfo(LOCATION_CONF).absolutePath());
+    connect(locationWatcher_, SIGNAL(fileChanged(QString)), this, SLOT(loadSettings()));
+    connect(locationWatcher_, SIGNAL(directoryChanged(QString)), this, SLOT(loadSettings()));
+    connect(declinationItem_, SIGNAL(valueChanged()), this, SLOT(loadSettings()));
     loadSettings();
 }
 
-void DeclinationFilter::correct(unsigned, const CompassData* data)
+DeclinationFilter::~DeclinationFilter()
 {
-    CompassData newOrientation(*data);
-    if(newOrientation.timestamp_ - lastUpdate_ > updateInterval_)
-    {
-        loadSettings();
-        lastUpdate_ = newOrientation.timestamp_;
-    }
-    newOrientation.correctedDegrees_ = newOrientation.degrees_;
+    delete locationWatcher_;
+    delete declinationItem_;
+}
+
+void DeclinationFilter::correct(unsigned n, const CompassData* data)
+{
+    // Settings are not read on the data path, only the cached value
 #if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
-    if(declinationCorrection_)
+    int declination = declinationCorrection_;
 #else
-    if(declinationCorrection_.loadAcquire() == 0)
+    int declination = Atomic::loadAcquire(declinationCorrection_);
 #endif
+    FilterBatch<CompassData> batch;
+    for (unsigned i = 0; i < n; ++i)
+        batch.append(correctSample(data[i], declination));
+    batch.propagate(source_);
+}
+
+CompassData DeclinationFilter::correctSample(const CompassData& data, int declination)
+{
+    CompassData newOrientation(data);
+    newOrientation.correctedDegrees_ = newOrientation.degrees_;
+    if(declination)
     {
-#if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
-        newOrientation.correctedDegrees_ += declinationCorrection_;
-#else
-        newOrientation.correctedDegrees_ += declinationCorrection_.loadAcquire();
-#endif
-        newOrientation.correctedDegrees_ %= 360;
+        newOrientation.correctedDegrees_ = (newOrientation.correctedDegrees_ + declination + 360) % 360;
         sensordLogT() << "DeclinationFilter corrected degree " << newOrientation.degrees_ << " => " << newOrientation.correctedDegrees_ << ". Level: " << newOrientation.level_;
     }
     orientation_ = newOrientation;
-    source_.propagate(1, &orientation_);
+    return orientation_;
 }
 
 void DeclinationFilter::loadSettings()
 {
-    QSettings confFile("/etc/xdg/sensorfw/location.conf", QSettings::IniFormat);
+    if (QFile::exists(LOCATION_CONF) && !locationWatcher_->files().contains(LOCATION_CONF))
+        locationWatcher_->addPath(LOCATION_CONF);
+
+    QSettings confFile(LOCATION_CONF, QSettings::IniFormat);
     confFile.beginGroup("location");
     double declination = confFile.value("declination",0).toDouble();
     if (declination != 0) {
-        declinationCorrection_ = declination;
+        declinationCorrection_ = qRound(declination);
     } else {
-        MGConfItem item(declinationKey);
-        declinationCorrection_ = item.value().toInt();
+        declinationCorrection_ = declinationItem_->value().toInt();
     }
 #if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
     sensordLogD() << "Fetched declination correction from GConf: " << declinationCorrection_;
 #else
-    sensordLogD() << "Fetched declination correction from GConf: " << declinationCorrection_.loadAcquire();
+    sensordLogD() << "Fetched declination correction from GConf: " << Atomic::loadAcquire(declinationCorrection_);
 #endif
 }
 
@@ -92,6 +112,6 @@ int DeclinationFilter::declinationCorrection()
 #if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
     return declinationCorrection_;
 #else
-    return declinationCorrection_.loadAcquire();
+    return Atomic::loadAcquire(declinationCorrection_);
 #endif
 }
@@ -32,6 +32,9 @@
 #include "datatypes/orientationdata.h"
 #include "filter.h"
 
+class MGConfItem;
+class QFileSystemWatcher;
+
 /**
  * Filter for calculating declination correction for Compass data.
  */
@@ -52,21 +55,31 @@ public:
 
     /**
      * Holds the declination correction amount applied in the calculation.
-     * The value is read from GConf key \c /system/osso/location/settings/magneticvariation.
+     * The value is read from /etc/xdg/sensorfw/location.conf, or from GConf
+     * key \c /system/osso/location/settings/magneticvariation when not set
+     * there. It is cached and reloaded when either changes.
      */
     int declinationCorrection();
 
+    ~DeclinationFilter();
+
+private Q_SLOTS:
+    /**
+     * Update cached declination correction.
+     */
+    void loadSettings();
+
 private:
     DeclinationFilter();
 
     void correct(unsigned, const CompassData*);
 
-    void loadSettings();
+    CompassData correctSample(const CompassData& data, int declination);
 
     CompassData orientation_;
     QAtomicInt declinationCorrection_;
-    quint64 lastUpdate_;
-    quint64 updateInterval_;
+    MGConfItem* declinationItem_;
+    QFileSystemWatcher* locationWatcher_;
 
     static const char* declinationKey;
 };
@@ -31,6 +31,7 @@ DownsampleFilter::DownsampleFilter() :
     bufferSize_(1),
     timeout_(-1)
 {
+    buffer_.setCapacity(bufferSize_);
 }
 
 unsigned int DownsampleFilter::bufferSize() const
@@ -42,6 +43,7 @@ void DownsampleFilter::setBufferSize(unsigned int size)
 {
     sensordLogD() << "DownsampleFilter buffer size = " << size;
     bufferSize_ = size;
+    buffer_.setCapacity(size);
 }
 
 int DownsampleFilter::timeout() const
@@ -55,44 +57,36 @@ void DownsampleFilter::setTimeout(int ms)
     sensordLogD() << "DownsampleFilter timeout = " << ms;
 }
 
-void DownsampleFilter::filter(unsigned, const TimedXyzData* data)
+void DownsampleFilter::filter(unsigned n, const TimedXyzData* data)
 {
-    buffer_.push_back(*data);
-
-    for(TimedXyzDownsampleBuffer::iterator it = buffer_.begin(); it != buffer_.end(); ++it)
-    {
-        if(static_cast<unsigned int>(buffer_.size()) > bufferSize_ ||
-           (timeout_ && (data->timestamp_ - it->timestamp_ >
-                         static_cast<unsigned long>(timeout_))))
-        {
-            it = buffer_.erase(it);
-            if(it == buffer_.end())
-                break;
-        }
-        else
-            break;
-    }
+    FilterBatch<TimedXyzData> batch;
 
-    if(static_cast<unsigned int>(buffer_.size()) < bufferSize_)
-        return;
-
-    long x = 0;
-    long y = 0;
-    long z = 0;
-    foreach(const TimedXyzData& data, buffer_)
-    {
-        x += data.x_;
-        y += data.y_;
-        z += data.z_;
+    for (unsigned i = 0; i < n; ++i, ++data) {
+        TimedXyzData downsampled;
+        if (downsample(*data, downsampled))
+            batch.append(downsampled);
     }
-    int count = buffer_.count();
-    TimedXyzData downsampled(data->timestamp_,
-                             x / count,
-                             y / count,
-                             z / count);
+
+    batch.propagate(source_);
+}
+
+bool DownsampleFilter::downsample(const TimedXyzData& sample, TimedXyzData& downsampled)
+{
+    long values[3] = { sample.x_, sample.y_, sample.z_ };
+    buffer_.push(sample.timestamp_, values);
+    if(timeout_ > 0)
+        buffer_.expire(sample.timestamp_, timeout_);
+
+    if(static_cast<unsigned int>(buffer_.count()) < bufferSize_)
+        return false;
+
+    downsampled = TimedXyzData(sample.timestamp_,
+                               buffer_.average(0),
+                               buffer_.average(1),
+                               buffer_.average(2));
 
     sensordLogT() << "Downsampled: " << downsampled.x_ << ", " << downsampled.y_ << ", " << downsampled.z_;
 
-    source_.propagate(1, &downsampled);
     buffer_.clear();
+    return true;
 }
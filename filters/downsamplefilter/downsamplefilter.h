@@ -26,10 +26,10 @@
 #ifndef DOWNSAMPLEFILTER_H
 #define DOWNSAMPLEFILTER_H
 
-#include <QList>
 #include <QObject>
 #include "datatypes/orientationdata.h"
 #include "filter.h"
+#include "downsamplewindow.h"
 
 /**
  * @brief Downsample filter.
@@ -95,8 +95,17 @@ private:
      */
     void filter(unsigned, const TimedXyzData*);
 
+    /**
+     * Add sample to the downsample buffer.
+     *
+     * @param sample incoming sample.
+     * @param downsampled set to the averaged sample when buffer is full.
+     * @return was averaged sample produced.
+     */
+    bool downsample(const TimedXyzData& sample, TimedXyzData& downsampled);
+
     /** Sample buffer type for TimedXyzData downsampling. */
-    typedef QList<TimedXyzData> TimedXyzDownsampleBuffer;
+    typedef DownsampleWindow<3> TimedXyzDownsampleBuffer;
 
     unsigned int bufferSize_; /**< buffer size */
     long timeout_;   /**< timeout in milliseconds */
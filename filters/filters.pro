@@ -4,7 +4,9 @@ SUBDIRS = coordinatealignfilter \
           orientationinterpreter \
           rotationfilter \
           downsamplefilter \
-          avgaccfilter
+          avgaccfilter \
+          lowpassfilter \
+          syncfilter
 
 include(../common-install.pri)
 publicheaders.files = *.h
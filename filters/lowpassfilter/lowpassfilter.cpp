@@ -0,0 +1,209 @@
+/**
+   @file lowpassfilter.cpp
+   @brief LowPassFilter
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "lowpassfilter.h"
+#include "logging.h"
+#include <math.h>
+
+/** Largest number of FIR taps */
+static const unsigned int MAX_TAPS = 256;
+
+/** Largest number of biquad sections */
+static const unsigned int MAX_SECTIONS = 4;
+
+LowPassFilter::LowPassFilter() :
+    Filter<TimedXyzData, LowPassFilter, TimedXyzData>(this, &LowPassFilter::filter),
+    iir_(false),
+    factor_(1),
+    cutoff_(0),
+    taps_(0),
+    sections_(2),
+    phase_(0),
+    primed_(false),
+    firKernel_(firKernel()),
+    biquadKernel_(biquadKernel()),
+    pos_(0)
+{
+    design();
+}
+
+QString LowPassFilter::mode() const
+{
+    return iir_ ? "iir" : "fir";
+}
+
+void LowPassFilter::setMode(const QString& mode)
+{
+    if (mode != "fir" && mode != "iir") {
+        sensordLogW() << "Unknown LowPassFilter mode" << mode;
+        return;
+    }
+    iir_ = (mode == "iir");
+    design();
+}
+
+unsigned int LowPassFilter::factor() const
+{
+    return factor_;
+}
+
+void LowPassFilter::setFactor(unsigned int factor)
+{
+    factor_ = qMax(1u, factor);
+    design();
+}
+
+double LowPassFilter::cutoff() const
+{
+    return cutoff_;
+}
+
+void LowPassFilter::setCutoff(double cutoff)
+{
+    cutoff_ = qBound(0.0, cutoff, 1.0);
+    design();
+}
+
+unsigned int LowPassFilter::taps() const
+{
+    return coefs_.size();
+}
+
+void LowPassFilter::setTaps(unsigned int taps)
+{
+    taps_ = qMin(taps, MAX_TAPS);
+    design();
+}
+
+unsigned int LowPassFilter::sections() const
+{
+    return sections_;
+}
+
+void LowPassFilter::setSections(unsigned int sections)
+{
+    sections_ = qBound(1u, sections, MAX_SECTIONS);
+    design();
+}
+
+void LowPassFilter::design()
+{
+    // Cutoff in cycles per input sample
+    double fc = 0.5 * (cutoff_ > 0 ? cutoff_ : qMin(1.0, 0.8 / factor_));
+    phase_ = 0;
+    primed_ = false;
+
+    if (iir_) {
+        // Butterworth of order 2 * sections as cascade of biquads,
+        // bilinear transform with prewarped cutoff
+        double k = tan(M_PI * qMin(fc, 0.49));
+        biquads_.resize(sections_);
+        states_.resize(sections_);
+        for (unsigned int i = 0; i < sections_; ++i) {
+            double q = 1.0 / (2.0 * cos((2.0 * i + 1.0) * M_PI / (4.0 * sections_)));
+            double norm = 1.0 / (1.0 + k / q + k * k);
+            BiquadSection& s = biquads_[i];
+            s.b0 = k * k * norm;
+            s.b1 = 2.0 * s.b0;
+            s.b2 = s.b0;
+            s.a1 = 2.0 * (k * k - 1.0) * norm;
+            s.a2 = (1.0 - k / q + k * k) * norm;
+        }
+        sensordLogD() << "LowPassFilter iir: sections" << sections_ << "factor" << factor_ << "cutoff" << 2 * fc;
+        return;
+    }
+
+    // Windowed sinc, padded with leading zeros to a multiple of the
+    // vector width and stored oldest first to match the history
+    unsigned int n = qBound(1u, taps_ ? taps_ : 8 * factor_, MAX_TAPS);
+    unsigned int padded = (n + 3) & ~3u;
+    coefs_.fill(0, padded);
+    double sum = 0;
+    QVector<double> h(n);
+    for (unsigned int i = 0; i < n; ++i) {
+        double t = i - (n - 1) / 2.0;
+        double sinc = t == 0 ? 2 * fc : sin(2 * M_PI * fc * t) / (M_PI * t);
+        double window = n > 1 ? 0.54 - 0.46 * cos(2 * M_PI * i / (n - 1)) : 1.0;
+        h[i] = sinc * window;
+        sum += h[i];
+    }
+    for (unsigned int i = 0; i < n; ++i)
+        coefs_[padded - 1 - i] = h[i] / sum;
+
+    for (int axis = 0; axis < 3; ++axis)
+        history_[axis].fill(0, 2 * padded);
+    pos_ = 0;
+    sensordLogD() << "LowPassFilter fir: taps" << n << "factor" << factor_ << "cutoff" << 2 * fc;
+}
+
+void LowPassFilter::prime(const float values[4])
+{
+    if (iir_) {
+        // Steady state of unity DC gain sections for constant input
+        for (int i = 0; i < states_.size(); ++i) {
+            const BiquadSection& c = biquads_.at(i);
+            for (int lane = 0; lane < 4; ++lane) {
+                states_[i].s1[lane] = values[lane] * (1 - c.b0);
+                states_[i].s2[lane] = values[lane] * (c.b2 - c.a2);
+            }
+        }
+    } else {
+        for (int axis = 0; axis < 3; ++axis)
+            history_[axis].fill(values[axis]);
+    }
+    primed_ = true;
+}
+
+void LowPassFilter::filter(unsigned n, const TimedXyzData* data)
+{
+    FilterBatch<TimedXyzData> batch;
+    const unsigned int window = coefs_.size();
+
+    for (unsigned i = 0; i < n; ++i, ++data) {
+        float values[4] = { (float)data->x_, (float)data->y_, (float)data->z_, 0 };
+        if (!primed_)
+            prime(values);
+
+        if (iir_) {
+            biquadKernel_(biquads_.constData(), states_.data(), states_.size(), values);
+        } else {
+            // Every sample is stored twice, so the newest window is
+            // always contiguous and ends at pos_ + window
+            for (int axis = 0; axis < 3; ++axis) {
+                history_[axis][pos_] = values[axis];
+                history_[axis][pos_ + window] = values[axis];
+            }
+            pos_ = (pos_ + 1) % window;
+        }
+
+        if (++phase_ < factor_)
+            continue;
+        phase_ = 0;
+
+        if (!iir_) {
+            for (int axis = 0; axis < 3; ++axis)
+                values[axis] = firKernel_(coefs_.constData(), history_[axis].constData() + pos_, window);
+        }
+        batch.append(TimedXyzData(data->timestamp_, qRound(values[0]), qRound(values[1]), qRound(values[2])));
+    }
+
+    batch.propagate(source_);
+}
@@ -0,0 +1,177 @@
+/**
+   @file lowpassfilter.h
+   @brief LowPassFilter
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef LOWPASSFILTER_H
+#define LOWPASSFILTER_H
+
+#include <QObject>
+#include <QVector>
+#include "datatypes/orientationdata.h"
+#include "filter.h"
+#include "lowpasskernel.h"
+
+/**
+ * @brief Low-pass filter and decimator for XYZ data.
+ *
+ * Filters incoming samples with a windowed sinc FIR or a cascade of
+ * Butterworth biquads and passes on every factor:th sample. One filter
+ * placed in a chain decimates once for all sinks behind it, so slow
+ * consumers do not each need their own averaging. The FIR is evaluated
+ * only for the samples passed on, which makes it a polyphase decimator.
+ *
+ * Cutoff is given as a fraction of the input Nyquist frequency; 0 selects
+ * 0.8 / factor, which keeps aliasing of the decimated output low.
+ */
+class LowPassFilter : public QObject, public Filter<TimedXyzData, LowPassFilter, TimedXyzData>
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(LowPassFilter)
+    Q_PROPERTY(QString mode READ mode WRITE setMode)
+    Q_PROPERTY(unsigned int factor READ factor WRITE setFactor)
+    Q_PROPERTY(double cutoff READ cutoff WRITE setCutoff)
+    Q_PROPERTY(unsigned int taps READ taps WRITE setTaps)
+    Q_PROPERTY(unsigned int sections READ sections WRITE setSections)
+
+public:
+
+    /**
+     * Factory method.
+     *
+     * @return New LowPassFilter instance.
+     */
+    static FilterBase* factoryMethod() { return new LowPassFilter; }
+
+    /**
+     * Filter kernel, "fir" or "iir".
+     *
+     * @return mode.
+     */
+    QString mode() const;
+
+    /**
+     * Set filter kernel. Unknown modes are ignored.
+     *
+     * @param mode "fir" or "iir".
+     */
+    void setMode(const QString& mode);
+
+    /**
+     * Decimation factor.
+     *
+     * @return input samples per output sample.
+     */
+    unsigned int factor() const;
+
+    /**
+     * Set decimation factor, 1 filters without decimating.
+     *
+     * @param factor input samples per output sample.
+     */
+    void setFactor(unsigned int factor);
+
+    /**
+     * Cutoff frequency.
+     *
+     * @return cutoff as fraction of the input Nyquist frequency, 0 if
+     *         derived from the factor.
+     */
+    double cutoff() const;
+
+    /**
+     * Set cutoff frequency.
+     *
+     * @param cutoff fraction of the input Nyquist frequency, 0 to derive
+     *        it from the factor.
+     */
+    void setCutoff(double cutoff);
+
+    /**
+     * Number of FIR taps.
+     *
+     * @return taps.
+     */
+    unsigned int taps() const;
+
+    /**
+     * Set number of FIR taps, at most 256.
+     *
+     * @param taps taps, 0 selects 8 * factor.
+     */
+    void setTaps(unsigned int taps);
+
+    /**
+     * Number of IIR sections.
+     *
+     * @return second order sections.
+     */
+    unsigned int sections() const;
+
+    /**
+     * Set number of IIR sections, from 1 to 4. Order of the filter is
+     * twice the section count.
+     *
+     * @param sections second order sections.
+     */
+    void setSections(unsigned int sections);
+
+protected:
+    /**
+     * Constructor.
+     */
+    LowPassFilter();
+
+private:
+    /**
+     * Callback for incoming data to be filtered.
+     */
+    void filter(unsigned, const TimedXyzData*);
+
+    /**
+     * Compute coefficients for the current settings and reset state.
+     */
+    void design();
+
+    /**
+     * Fill history and state as if the sample had been the input so far,
+     * so the output starts without a transient.
+     *
+     * @param values x, y, z and padding lane.
+     */
+    void prime(const float values[4]);
+
+    bool iir_;                 /**< use biquads instead of FIR */
+    unsigned int factor_;      /**< decimation factor */
+    double cutoff_;            /**< cutoff, fraction of Nyquist or 0 */
+    unsigned int taps_;        /**< requested FIR taps, 0 for default */
+    unsigned int sections_;    /**< biquad sections */
+    unsigned int phase_;       /**< input samples since the last output */
+    bool primed_;              /**< has state been primed */
+
+    FirKernel firKernel_;             /**< selected FIR kernel */
+    BiquadKernel biquadKernel_;       /**< selected biquad kernel */
+    QVector<float> coefs_;            /**< FIR coefficients, oldest first, padded to 4 */
+    QVector<float> history_[3];       /**< doubled FIR history per axis */
+    unsigned int pos_;                /**< next history slot */
+    QVector<BiquadSection> biquads_;  /**< biquad coefficients */
+    QVector<BiquadState> states_;     /**< biquad state */
+};
+
+#endif // LOWPASSFILTER_H
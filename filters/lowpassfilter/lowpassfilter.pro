@@ -0,0 +1,11 @@
+TARGET = lowpassfilter
+
+HEADERS += lowpassfilter.h \
+           lowpassfilterplugin.h \
+           lowpasskernel.h
+
+SOURCES += lowpassfilter.cpp \
+           lowpassfilterplugin.cpp \
+           lowpasskernel.cpp
+
+include( ../filter-config.pri )
@@ -0,0 +1,166 @@
+/**
+   @file lowpasskernel.cpp
+   @brief FIR and biquad kernels of the low-pass filter
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "lowpasskernel.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#if !defined(__aarch64__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+#endif
+
+float firScalar(const float* coefs, const float* samples, unsigned n)
+{
+    float sum = 0;
+    for (unsigned i = 0; i < n; ++i)
+        sum += coefs[i] * samples[i];
+    return sum;
+}
+
+void biquadScalar(const BiquadSection* sections, BiquadState* states, unsigned count, float values[4])
+{
+    for (unsigned k = 0; k < count; ++k) {
+        const BiquadSection& c = sections[k];
+        BiquadState& s = states[k];
+        for (int lane = 0; lane < 4; ++lane) {
+            float x = values[lane];
+            float y = c.b0 * x + s.s1[lane];
+            s.s1[lane] = c.b1 * x - c.a1 * y + s.s2[lane];
+            s.s2[lane] = c.b2 * x - c.a2 * y;
+            values[lane] = y;
+        }
+    }
+}
+
+#if defined(__SSE2__)
+
+static float firSse(const float* coefs, const float* samples, unsigned n)
+{
+    __m128 sum = _mm_setzero_ps();
+    for (unsigned i = 0; i < n; i += 4)
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(coefs + i), _mm_loadu_ps(samples + i)));
+    // Horizontal sum of the four partial sums
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+    return _mm_cvtss_f32(sum);
+}
+
+static void biquadSse(const BiquadSection* sections, BiquadState* states, unsigned count, float values[4])
+{
+    __m128 v = _mm_loadu_ps(values);
+    for (unsigned k = 0; k < count; ++k) {
+        const BiquadSection& c = sections[k];
+        BiquadState& s = states[k];
+        __m128 s1 = _mm_loadu_ps(s.s1);
+        __m128 s2 = _mm_loadu_ps(s.s2);
+        __m128 y = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(c.b0), v), s1);
+        s1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(_mm_set1_ps(c.b1), v), _mm_mul_ps(_mm_set1_ps(c.a1), y)), s2);
+        s2 = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(c.b2), v), _mm_mul_ps(_mm_set1_ps(c.a2), y));
+        _mm_storeu_ps(s.s1, s1);
+        _mm_storeu_ps(s.s2, s2);
+        v = y;
+    }
+    _mm_storeu_ps(values, v);
+}
+
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+
+static float firNeon(const float* coefs, const float* samples, unsigned n)
+{
+    float32x4_t sum = vdupq_n_f32(0);
+    for (unsigned i = 0; i < n; i += 4)
+        sum = vmlaq_f32(sum, vld1q_f32(coefs + i), vld1q_f32(samples + i));
+    float32x2_t half = vadd_f32(vget_low_f32(sum), vget_high_f32(sum));
+    return vget_lane_f32(vpadd_f32(half, half), 0);
+}
+
+static void biquadNeon(const BiquadSection* sections, BiquadState* states, unsigned count, float values[4])
+{
+    float32x4_t v = vld1q_f32(values);
+    for (unsigned k = 0; k < count; ++k) {
+        const BiquadSection& c = sections[k];
+        BiquadState& s = states[k];
+        float32x4_t s1 = vld1q_f32(s.s1);
+        float32x4_t s2 = vld1q_f32(s.s2);
+        float32x4_t y = vmlaq_n_f32(s1, v, c.b0);
+        s1 = vmlsq_n_f32(vmlaq_n_f32(s2, v, c.b1), y, c.a1);
+        s2 = vmlsq_n_f32(vmulq_n_f32(v, c.b2), y, c.a2);
+        vst1q_f32(s.s1, s1);
+        vst1q_f32(s.s2, s2);
+        v = y;
+    }
+    vst1q_f32(values, v);
+}
+
+#if !defined(__aarch64__)
+static bool hasNeon()
+{
+    return getauxval(AT_HWCAP) & HWCAP_NEON;
+}
+#endif
+
+#endif
+
+FirKernel firKernel(const char** name)
+{
+#if defined(__SSE2__)
+    if (name)
+        *name = "sse2";
+    return firSse;
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#if !defined(__aarch64__)
+    if (hasNeon())
+#endif
+    {
+        if (name)
+            *name = "neon";
+        return firNeon;
+    }
+#endif
+    if (name)
+        *name = "scalar";
+    return firScalar;
+}
+
+BiquadKernel biquadKernel(const char** name)
+{
+#if defined(__SSE2__)
+    if (name)
+        *name = "sse2";
+    return biquadSse;
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#if !defined(__aarch64__)
+    if (hasNeon())
+#endif
+    {
+        if (name)
+            *name = "neon";
+        return biquadNeon;
+    }
+#endif
+    if (name)
+        *name = "scalar";
+    return biquadScalar;
+}
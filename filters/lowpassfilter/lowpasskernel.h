@@ -0,0 +1,94 @@
+/**
+   @file lowpasskernel.h
+   @brief FIR and biquad kernels of the low-pass filter
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef LOWPASSKERNEL_H
+#define LOWPASSKERNEL_H
+
+/**
+ * FIR kernel. Dot product of coefficients and a window of samples of one
+ * axis, both stored contiguously oldest first.
+ *
+ * @param coefs coefficients.
+ * @param samples sample window, need not be aligned.
+ * @param n window length, multiple of 4.
+ * @return filtered sample.
+ */
+typedef float (*FirKernel)(const float* coefs, const float* samples, unsigned n);
+
+/**
+ * Coefficients of one second order section, normalized to a0 = 1.
+ */
+struct BiquadSection
+{
+    float b0; /**< feedforward coefficient */
+    float b1; /**< feedforward coefficient */
+    float b2; /**< feedforward coefficient */
+    float a1; /**< feedback coefficient */
+    float a2; /**< feedback coefficient */
+};
+
+/**
+ * Transposed direct form II state of one section, one lane per axis.
+ */
+struct BiquadState
+{
+    float s1[4]; /**< first delay, lanes x, y, z and padding */
+    float s2[4]; /**< second delay, lanes x, y, z and padding */
+};
+
+/**
+ * Biquad kernel. Runs one sample of all axes through a cascade of
+ * sections in place, axes in the lanes of a vector.
+ *
+ * @param sections coefficients of the cascade.
+ * @param states state of every section.
+ * @param count number of sections.
+ * @param values x, y, z and padding lane.
+ */
+typedef void (*BiquadKernel)(const BiquadSection* sections, BiquadState* states, unsigned count, float values[4]);
+
+/**
+ * Portable scalar FIR kernel.
+ */
+float firScalar(const float* coefs, const float* samples, unsigned n);
+
+/**
+ * Portable scalar biquad kernel.
+ */
+void biquadScalar(const BiquadSection* sections, BiquadState* states, unsigned count, float values[4]);
+
+/**
+ * Select fastest FIR kernel supported by the CPU.
+ *
+ * @param name set to the name of selected kernel if not NULL.
+ * @return selected kernel.
+ */
+FirKernel firKernel(const char** name = 0);
+
+/**
+ * Select fastest biquad kernel supported by the CPU.
+ *
+ * @param name set to the name of selected kernel if not NULL.
+ * @return selected kernel.
+ */
+BiquadKernel biquadKernel(const char** name = 0);
+
+#endif // LOWPASSKERNEL_H
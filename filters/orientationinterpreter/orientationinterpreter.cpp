@@ -30,12 +30,15 @@
 #include "orientationinterpreter.h"
 #include "logging.h"
 #include "config.h"
+#include "boosthints.h"
+#include "datatypes/atomic.h"
 #include <math.h>
 #include <stdlib.h>
 #include <limits.h>
 
 const float OrientationInterpreter::RADIANS_TO_DEGREES = 180.0/M_PI;
 const int OrientationInterpreter::SAME_AXIS_LIMIT = 5;
+const int OrientationInterpreter::TAN_SHIFT = 20;
 const int OrientationInterpreter::OVERFLOW_MIN = 0;
 const int OrientationInterpreter::OVERFLOW_MAX = INT_MAX;
 const int OrientationInterpreter::THRESHOLD_LANDSCAPE = 25;
@@ -43,7 +46,7 @@ const int OrientationInterpreter::THRESHOLD_PORTRAIT = 20;
 const int OrientationInterpreter::DISCARD_TIME = 750000;
 const int OrientationInterpreter::AVG_BUFFER_MAX_SIZE = 10;
 const char* OrientationInterpreter::CPU_BOOST_PATH = "/sys/power/pm_optimizer_rotation";
-typedef PoseData (OrientationInterpreter::*ptrFUN)(int);
+typedef PoseData (OrientationInterpreter::*ptrFUN)(bool, bool);
 
 OrientationInterpreter::OrientationInterpreter() :
         accDataSink(this, &OrientationInterpreter::accDataAvailable),
@@ -51,32 +54,76 @@ OrientationInterpreter::OrientationInterpreter() :
         face(PoseData::Undefined),
         previousFace(PoseData::Undefined),
         orientationData(PoseData::Undefined),
-        cpuBoostFile(CPU_BOOST_PATH)
-
+        cpuBoost(-1),
+        tuningPending(0)
 {
     addSink(&accDataSink, "accsink");
     addSource(&topEdgeSource, "topedge");
     addSource(&faceSource, "face");
     addSource(&orientationSource, "orientation");
 
-    minLimit = Config::configuration()->value("orientation/overflow_min", QVariant(OVERFLOW_MIN)).toInt();
-    maxLimit = Config::configuration()->value("orientation/overflow_max", QVariant(OVERFLOW_MAX)).toInt();
+    Tuning tuning;
+    loadTuning(tuning);
+    applyTuning(tuning);
+    tan2SameAxis = squaredTan(SAME_AXIS_LIMIT - 1);
 
-    angleThresholdPortrait = Config::configuration()->value("orientation/threshold_portrait",QVariant(THRESHOLD_PORTRAIT)).toInt();
-    angleThresholdLandscape = Config::configuration()->value("orientation/threshold_landscape",QVariant(THRESHOLD_LANDSCAPE)).toInt();
-    discardTime = Config::configuration()->value("orientation/discard_time", QVariant(DISCARD_TIME)).toUInt();
-    maxBufferSize = Config::configuration()->value("orientation/buffer_size", QVariant(AVG_BUFFER_MAX_SIZE)).toInt();
+    // Boost cpu on changes that affect orientation
+    cpuBoost = BoostHints::instance().registerHint("orientation", CPU_BOOST_PATH);
+}
 
-    // Open the handle for boosting cpu on changes that affect orientation
-    if (!cpuBoostFile.exists() || !cpuBoostFile.open(QIODevice::WriteOnly))
-    {
-        sensordLogW() << "Failed to open" << CPU_BOOST_PATH << "for adjusting cpu freq for orientation.";
+void OrientationInterpreter::loadTuning(Tuning& tuning)
+{
+    tuning.minLimit = Config::configuration()->value("orientation/overflow_min", QVariant(OVERFLOW_MIN)).toInt();
+    tuning.maxLimit = Config::configuration()->value("orientation/overflow_max", QVariant(OVERFLOW_MAX)).toInt();
+
+    tuning.angleThresholdPortrait = Config::configuration()->value("orientation/threshold_portrait",QVariant(THRESHOLD_PORTRAIT)).toInt();
+    tuning.angleThresholdLandscape = Config::configuration()->value("orientation/threshold_landscape",QVariant(THRESHOLD_LANDSCAPE)).toInt();
+    tuning.discardTime = Config::configuration()->value("orientation/discard_time", QVariant(DISCARD_TIME)).toUInt();
+    tuning.maxBufferSize = Config::configuration()->value("orientation/buffer_size", QVariant(AVG_BUFFER_MAX_SIZE)).toInt();
+}
+
+void OrientationInterpreter::applyTuning(const Tuning& tuning)
+{
+    minLimit = tuning.minLimit;
+    maxLimit = tuning.maxLimit;
+    angleThresholdPortrait = tuning.angleThresholdPortrait;
+    angleThresholdLandscape = tuning.angleThresholdLandscape;
+    discardTime = tuning.discardTime;
+    maxBufferSize = tuning.maxBufferSize;
+    dataBuffer.setCapacity(maxBufferSize);
+
+    tan2Portrait = squaredTan(angleThresholdPortrait);
+    tan2Landscape = squaredTan(angleThresholdLandscape);
+}
+
+void OrientationInterpreter::reconfigure(const QStringList& keys)
+{
+    bool changed = false;
+    foreach (const QString& key, keys)
+        changed |= key.startsWith("orientation/");
+    if (!changed)
+        return;
+
+    // Sample processing may run in a chain worker, hand values over
+    QMutexLocker locker(&tuningMutex);
+    loadTuning(pendingTuning);
+    Atomic::storeRelease(tuningPending, 1);
+}
+
+void OrientationInterpreter::accDataAvailable(unsigned n, const AccelerationData* pdata)
+{
+    if (tuningPending.testAndSetAcquire(1, 0)) {
+        QMutexLocker locker(&tuningMutex);
+        applyTuning(pendingTuning);
     }
+
+    for (unsigned i = 0; i < n; ++i)
+        processSample(pdata[i]);
 }
 
-void OrientationInterpreter::accDataAvailable(unsigned, const AccelerationData* pdata)
+void OrientationInterpreter::processSample(const AccelerationData& value)
 {
-    data = *pdata;
+    data = value;
 
     // Check overflow
     if (overFlowCheck())
@@ -85,29 +132,14 @@ void OrientationInterpreter::accDataAvailable(unsigned, const AccelerationData*
         return;
     }
 
-    // Append new value to buffer
-    dataBuffer.append(data);
+    // Average over the newest samples within discard time
+    long values[3] = { data.x_, data.y_, data.z_ };
+    dataBuffer.push(data.timestamp_, values);
+    dataBuffer.expire(data.timestamp_, discardTime);
 
-    // Clear old values from buffer.
-    while (dataBuffer.count() > maxBufferSize || (dataBuffer.count() > 1 && (data.timestamp_ - dataBuffer.first().timestamp_ > discardTime)))
-    {
-        dataBuffer.removeFirst();
-    }
-
-    //Calculate average
-    long x = 0;
-    long y = 0;
-    long z = 0;
-    foreach (const AccelerationData& sample, dataBuffer)
-    {
-        x += sample.x_;
-        y += sample.y_;
-        z += sample.z_;
-    }
-
-    data.x_ = x / dataBuffer.count();
-    data.y_ = y / dataBuffer.count();
-    data.z_ = z / dataBuffer.count();
+    data.x_ = dataBuffer.average(0);
+    data.y_ = dataBuffer.average(1);
+    data.z_ = dataBuffer.average(2);
 
     // calculate topedge
     processTopEdge();
@@ -125,23 +157,27 @@ bool OrientationInterpreter::overFlowCheck()
     return !((vector >= minLimit) && (vector <= maxLimit));
 }
 
-int OrientationInterpreter::orientationCheck(const AccelerationData &data,  OrientationMode mode) const
+qint64 OrientationInterpreter::squaredTan(int degrees)
 {
-    if (mode == OrientationInterpreter::Landscape)
-        return round(atan((double)data.x_ / sqrt(data.y_ * data.y_ + data.z_ * data.z_)) * RADIANS_TO_DEGREES);
-    else
-        return round(atan((double)data.y_ / sqrt(data.x_ * data.x_ + data.z_ * data.z_)) * RADIANS_TO_DEGREES);
+    // Angles round half away from zero
+    double angle = degrees + 0.5;
+    if (angle >= 90)
+        return -1;
+    if (angle <= 0)
+        return 0;
+    double t = tan(angle / RADIANS_TO_DEGREES);
+    return (qint64)ceil(t * t * ((qint64)1 << TAN_SHIFT));
 }
 
-PoseData OrientationInterpreter::rotateToPortrait(int rotation)
+PoseData OrientationInterpreter::rotateToPortrait(bool positive, bool sameAxis)
 {
     PoseData newTopEdge = PoseData::Undefined;
-    newTopEdge.orientation_ = (rotation >= 0) ? PoseData::BottomUp : PoseData::BottomDown;
+    newTopEdge.orientation_ = positive ? PoseData::BottomUp : PoseData::BottomDown;
 
     // Some threshold to switching between portrait modes
     if (topEdge.orientation_ == PoseData::BottomUp || topEdge.orientation_ == PoseData::BottomDown)
     {
-        if (abs(rotation) < SAME_AXIS_LIMIT)
+        if (sameAxis)
         {
             newTopEdge.orientation_ = topEdge.orientation_;
         }
@@ -150,15 +186,15 @@ PoseData OrientationInterpreter::rotateToPortrait(int rotation)
     return newTopEdge;
 }
 
-PoseData OrientationInterpreter::rotateToLandscape(int rotation)
+PoseData OrientationInterpreter::rotateToLandscape(bool positive, bool sameAxis)
 {
 
     PoseData newTopEdge = PoseData::Undefined;
-    newTopEdge.orientation_ = (rotation >= 0) ? PoseData::LeftUp : PoseData::RightUp;
+    newTopEdge.orientation_ = positive ? PoseData::LeftUp : PoseData::RightUp;
     // Some threshold to switching between landscape modes
     if (topEdge.orientation_ == PoseData::LeftUp || topEdge.orientation_ == PoseData::RightUp)
     {
-        if (abs(rotation) < SAME_AXIS_LIMIT)
+        if (sameAxis)
         {
             newTopEdge.orientation_ = topEdge.orientation_;
         }
@@ -167,13 +203,19 @@ PoseData OrientationInterpreter::rotateToLandscape(int rotation)
     return newTopEdge;
 }
 
-PoseData OrientationInterpreter::orientationRotation (const AccelerationData &data, OrientationMode mode, PoseData (OrientationInterpreter::*ptrFUN)(int))
+PoseData OrientationInterpreter::orientationRotation (const AccelerationData &data, OrientationMode mode, PoseData (OrientationInterpreter::*ptrFUN)(bool, bool))
 {
-    int rotation = orientationCheck(data, mode);
-    int threshold = (mode == OrientationInterpreter::Portrait) ? angleThresholdPortrait : angleThresholdLandscape;
+    // Tilt of the mode axis is compared as squared tangents in integers
+    qint64 axis = (mode == OrientationInterpreter::Landscape) ? data.x_ : data.y_;
+    qint64 other = (mode == OrientationInterpreter::Landscape) ? data.y_ : data.x_;
+    qint64 tilt = (axis * axis) << TAN_SHIFT;
+    qint64 plane = other * other + (qint64)data.z_ * data.z_;
+    qint64 threshold = (mode == OrientationInterpreter::Portrait) ? tan2Portrait : tan2Landscape;
+
     //if rotation is bigger than the threshold, then rotate using the function passed
-    PoseData newTopEdge = (abs(rotation) > threshold) ? (this->*ptrFUN)(rotation) : PoseData::Undefined;
-    return newTopEdge;
+    if (axis == 0 || threshold < 0 || tilt < threshold * plane)
+        return PoseData::Undefined;
+    return (this->*ptrFUN)(axis > 0, tan2SameAxis >= 0 && tilt < tan2SameAxis * plane);
 }
 
 void OrientationInterpreter::processTopEdge()
@@ -204,11 +246,7 @@ void OrientationInterpreter::processTopEdge()
     if (topEdge.orientation_ != newTopEdge.orientation_)
     {
         // Request CPU clock raise to get smooth desktop rotation
-        if (cpuBoostFile.isOpen())
-        {
-            cpuBoostFile.write("1", 1);
-            cpuBoostFile.flush();
-        }
+        BoostHints::instance().hint(cpuBoost);
 
         topEdge.orientation_ = newTopEdge.orientation_;
         sensordLogT() << "new TopEdge value: " << topEdge.orientation_;
@@ -30,8 +30,10 @@
 #define ORIENTATIONINTERPRETER_H
 
 #include <QObject>
-#include <QFile>
+#include <QMutex>
+#include <QAtomicInt>
 #include "filter.h"
+#include "downsamplewindow.h"
 #include <datatypes/orientationdata.h>
 #include <datatypes/posedata.h>
 
@@ -55,6 +57,7 @@ private:
     Source<PoseData> orientationSource;
 
     void accDataAvailable(unsigned, const AccelerationData*);
+    void processSample(const AccelerationData& value);
 
     bool overFlowCheck();
     void processTopEdge();
@@ -69,7 +72,7 @@ private:
     bool updatePreviousFace;
 
     AccelerationData data;
-    QList<AccelerationData> dataBuffer;
+    DownsampleWindow<3> dataBuffer;
 
     int minLimit;
     int maxLimit;
@@ -80,7 +83,7 @@ private:
 
     PoseData orientationData;
 
-    QFile cpuBoostFile;
+    int cpuBoost; /**< BoostHints handle raised on orientation changes */
 
     enum OrientationMode
     {
@@ -88,13 +91,59 @@ private:
         Landscape     /**< Orientation mode is landscape */
     };
 
-    PoseData rotateToLandscape(int);
-    PoseData rotateToPortrait(int);
-    int orientationCheck(const AccelerationData&, OrientationMode) const;
-    PoseData orientationRotation(const AccelerationData&, OrientationMode, PoseData (OrientationInterpreter::*)(int));
+    PoseData rotateToLandscape(bool positive, bool sameAxis);
+    PoseData rotateToPortrait(bool positive, bool sameAxis);
+    PoseData orientationRotation(const AccelerationData&, OrientationMode, PoseData (OrientationInterpreter::*)(bool, bool));
+
+    /**
+     * Squared tangent of the smallest angle rounding above given whole
+     * degrees, in TAN_SHIFT fixed point. Tilt of component a from the
+     * plane of components b and c rounds above the angle when
+     * (a^2 << TAN_SHIFT) >= squaredTan * (b^2 + c^2).
+     *
+     * @param degrees angle in degrees.
+     * @return fixed point value, or -1 if no tilt rounds above the angle.
+     */
+    static qint64 squaredTan(int degrees);
+
+    qint64 tan2Portrait;  /**< squaredTan() of angleThresholdPortrait */
+    qint64 tan2Landscape; /**< squaredTan() of angleThresholdLandscape */
+    qint64 tan2SameAxis;  /**< squaredTan() of SAME_AXIS_LIMIT - 1 */
+
+    /**
+     * Tunable configuration values.
+     */
+    struct Tuning
+    {
+        int minLimit;                /**< orientation/overflow_min */
+        int maxLimit;                /**< orientation/overflow_max */
+        int angleThresholdPortrait;  /**< orientation/threshold_portrait */
+        int angleThresholdLandscape; /**< orientation/threshold_landscape */
+        unsigned long discardTime;   /**< orientation/discard_time */
+        int maxBufferSize;           /**< orientation/buffer_size */
+    };
+
+    /**
+     * Read tuning from configuration.
+     *
+     * @param tuning values to fill.
+     */
+    static void loadTuning(Tuning& tuning);
+
+    /**
+     * Take tuning into use. Called from the thread processing samples.
+     *
+     * @param tuning values to use.
+     */
+    void applyTuning(const Tuning& tuning);
+
+    QMutex     tuningMutex;   /**< protects pendingTuning */
+    Tuning     pendingTuning; /**< tuning read by reconfigure() */
+    QAtomicInt tuningPending; /**< is pendingTuning waiting to be applied */
 
     static const float RADIANS_TO_DEGREES;
     static const int SAME_AXIS_LIMIT;
+    static const int TAN_SHIFT;
 
     static const int OVERFLOW_MIN;
     static const int OVERFLOW_MAX;
@@ -118,6 +167,14 @@ public:
     }
 
     PoseData orientation() const { return orientationData; }
+
+    /**
+     * Re-read orientation tuning. New values are applied before the
+     * next batch is processed.
+     *
+     * @param keys changed configuration keys.
+     */
+    void reconfigure(const QStringList& keys);
 };
 
 #endif
@@ -27,44 +27,112 @@
 #include "rotationfilter.h"
 #include <math.h>
 
+/** Conversion factor from radians to degrees */
+static const float RADIANS_TO_DEGREES = 180 / M_PI;
+
+/**
+ * Single precision atan2 with a minimax polynomial for atan on [0, 1].
+ * Absolute error is below 1e-5 radians. atan2(0, 0) is 0.
+ */
+static inline float fastAtan2(float y, float x)
+{
+    float ax = fabsf(x);
+    float ay = fabsf(y);
+    float high = qMax(ax, ay);
+    float low = qMin(ax, ay);
+    float t = high > 0 ? low / high : 0;
+    float t2 = t * t;
+    float r = t * (0.99997726f + t2 * (-0.33262347f + t2 * (0.19354346f +
+              t2 * (-0.11643287f + t2 * (0.05265332f + t2 * -0.01172120f)))));
+    r = ay > ax ? (float)M_PI_2 - r : r;
+    r = x < 0 ? (float)M_PI - r : r;
+    return y < 0 ? -r : r;
+}
+
 RotationFilter::RotationFilter() :
         accelerometerDataSink_(this, &RotationFilter::interpret),
         compassDataSink_(this, &RotationFilter::updateZvalue),
-        rotation_(0,0,0,0)
+        rotation_(0,0,0,0),
+        enabled_(true),
+        interval_(0),
+        deadline_(0)
 {
     addSink(&accelerometerDataSink_, "accelerometersink");
     addSink(&compassDataSink_, "compasssink");
     addSource(&source_, "source");
 }
 
-void RotationFilter::interpret(unsigned, const TimedXyzData* data)
+void RotationFilter::setEnabled(bool value)
 {
-    const int RADIANS_TO_DEGREES = 180/M_PI;
+    enabled_ = value;
+    deadline_ = 0;
+}
 
-    rotation_.timestamp_ = data->timestamp_;
+bool RotationFilter::isEnabled() const
+{
+    return enabled_;
+}
 
-    // X-Rotation
-    rotation_.x_ = round(atan((double)data->y_ / sqrt(data->x_ * data->x_ + data->z_ * data->z_)) * RADIANS_TO_DEGREES);
-    rotation_.x_ = -rotation_.x_;
-
-    // Y-rotation
-    if (data->x_ == 0 && data->y_ == 0 && data->z_ > 0) {
-        rotation_.y_ = 180;
-    } else if (data->x_ == 0 && data->z_  == 0) {
-        rotation_.y_ = 0;
-    } else {
-        rotation_.y_ = round(atan((double)data->x_ / sqrt(data->y_ * data->y_ + data->z_ * data->z_)) * RADIANS_TO_DEGREES);
-
-        qreal theta = atan(sqrt(data->x_ * data->x_ + data->y_ * data->y_) / data->z_) * RADIANS_TO_DEGREES;
-        if (theta > 0) {
-            if (rotation_.y_ >= 0)
-                rotation_.y_ = 180 - rotation_.y_;
-            else
-                rotation_.y_ = -180 - rotation_.y_;
+void RotationFilter::setOutputInterval(unsigned int ms)
+{
+    interval_ = (quint64)ms * 1000;
+    deadline_ = 0;
+}
+
+unsigned int RotationFilter::outputInterval() const
+{
+    return interval_ / 1000;
+}
+
+void RotationFilter::interpret(unsigned n, const TimedXyzData* data)
+{
+    if (!enabled_)
+        return;
+
+    FilterBatch<TimedXyzData> batch;
+    for (unsigned i = 0; i < n; ++i) {
+        if (interval_) {
+            // Same schedule as CompassFilter output interval
+            if (data[i].timestamp_ + interval_ < deadline_)
+                deadline_ = data[i].timestamp_;
+            if (data[i].timestamp_ < deadline_)
+                continue;
+            if (data[i].timestamp_ >= deadline_ + interval_)
+                deadline_ = data[i].timestamp_;
+            deadline_ += interval_;
         }
+        batch.append(data[i]);
     }
+    if (!batch.size())
+        return;
 
-    source_.propagate(1, &rotation_);
+    rotate(batch.size(), batch.data(), rotation_.z_);
+    rotation_ = batch[batch.size() - 1];
+    batch.propagate(source_);
+}
+
+void RotationFilter::rotate(unsigned n, TimedXyzData* samples, int z)
+{
+    for (unsigned i = 0; i < n; ++i) {
+        float ax = samples[i].x_;
+        float ay = samples[i].y_;
+        float az = samples[i].z_;
+
+        // X-rotation is the elevation of y from the xz plane
+        float x = -fastAtan2(ay, sqrtf(ax * ax + az * az)) * RADIANS_TO_DEGREES;
+
+        // Y-rotation is the elevation of x from the yz plane, measured
+        // from the other side when the device faces down. Device lying
+        // on its side has no Y-rotation.
+        float yz = sqrtf(ay * ay + az * az);
+        float y = fastAtan2(ax, az >= 0 ? -yz : yz) * RADIANS_TO_DEGREES;
+        y = (ax == 0 && az == 0) ? 0 : y;
+
+        int degrees = y >= 0 ? (int)(y + 0.5f) : (int)(y - 0.5f);
+        samples[i].x_ = x >= 0 ? (int)(x + 0.5f) : (int)(x - 0.5f);
+        samples[i].y_ = degrees == -180 ? 180 : degrees;
+        samples[i].z_ = z;
+    }
 }
 
 double RotationFilter::vectorLength(const TimedXyzData& data)
@@ -72,8 +140,13 @@ double RotationFilter::vectorLength(const TimedXyzData& data)
     return sqrt(data.x_ * data.x_ + data.y_ * data.y_ + data.z_ * data.z_);
 }
 
-void RotationFilter::updateZvalue(unsigned, const CompassData* data)
+void RotationFilter::updateZvalue(unsigned n, const CompassData* data)
 {
+    // Only the latest heading matters
+    if (!n)
+        return;
+    data += n - 1;
+
     rotation_.timestamp_ = data->timestamp_;
 
     /// Z-rotation
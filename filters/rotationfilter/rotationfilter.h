@@ -40,6 +40,9 @@
 class RotationFilter : public QObject, public FilterBase
 {
     Q_OBJECT;
+    Q_PROPERTY(bool enabled READ isEnabled WRITE setEnabled)
+    Q_PROPERTY(unsigned int outputInterval READ outputInterval WRITE setOutputInterval)
+
 public:
     /**
      * Factory method.
@@ -50,6 +53,51 @@ public:
         return new RotationFilter();
     }
 
+    /**
+     * Enable or disable rotation computation. Disabled filter drops
+     * accelerometer samples, so a shared accelerometer chain running for
+     * other sensors costs nothing here. Filter is enabled by default.
+     *
+     * @param value compute rotations.
+     */
+    void setEnabled(bool value);
+
+    /**
+     * Is rotation computed.
+     *
+     * @return is filter enabled.
+     */
+    bool isEnabled() const;
+
+    /**
+     * Set how often rotation is computed. Accelerometer samples arriving
+     * in between are dropped.
+     *
+     * @param ms interval in milliseconds, 0 computes rotation for every
+     *           accelerometer sample.
+     */
+    void setOutputInterval(unsigned int ms);
+
+    /**
+     * How often rotation is computed.
+     *
+     * @return interval in milliseconds.
+     */
+    unsigned int outputInterval() const;
+
+    /**
+     * Compute X and Y axis rotations in place. Single precision kernel
+     * without branches on the data path. Its atan2 approximation is
+     * within 0.001 degrees, so results differ from double precision only
+     * where rounding to whole degrees is a tie.
+     *
+     * @param n number of samples.
+     * @param samples accelerometer samples, x and y are replaced with
+     *                rotations in degrees and z is set to given value.
+     * @param z Z axis rotation.
+     */
+    static void rotate(unsigned n, TimedXyzData* samples, int z);
+
 private:
 
     /**
@@ -76,6 +124,9 @@ private:
     }
 
     TimedXyzData rotation_;
+    bool enabled_;     /**< is rotation computed */
+    quint64 interval_; /**< output interval in microseconds */
+    quint64 deadline_; /**< timestamp at which next rotation is due */
 };
 
 #endif // ROTATIONFILTER_H
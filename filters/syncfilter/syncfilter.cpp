@@ -0,0 +1,181 @@
+/**
+   @file syncfilter.cpp
+   @brief SyncFilter
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "syncfilter.h"
+#include "config.h"
+#include <QMutexLocker>
+
+SyncFilter::Stream::Stream() :
+        count_(0),
+        next_(0)
+{
+}
+
+void SyncFilter::Stream::append(quint64 timestamp, int x, int y, int z)
+{
+    Sample& sample = samples_[next_];
+    sample.timestamp = timestamp;
+    sample.values[0] = x;
+    sample.values[1] = y;
+    sample.values[2] = z;
+    next_ = (next_ + 1) % HISTORY;
+    if (count_ < HISTORY)
+        ++count_;
+}
+
+const SyncFilter::Stream::Sample& SyncFilter::Stream::at(int i) const
+{
+    return samples_[(next_ - count_ + i + HISTORY) % HISTORY];
+}
+
+bool SyncFilter::Stream::covers(quint64 timestamp) const
+{
+    return !count_ || at(count_ - 1).timestamp >= timestamp;
+}
+
+void SyncFilter::Stream::valueAt(quint64 timestamp, bool interpolate, int* values) const
+{
+    if (!count_) {
+        values[0] = values[1] = values[2] = 0;
+        return;
+    }
+
+    // Newest sample not after the tick, or the oldest one if all are
+    int before = 0;
+    while (before + 1 < count_ && at(before + 1).timestamp <= timestamp)
+        ++before;
+    const Sample& a = at(before);
+    if (before + 1 == count_ || a.timestamp >= timestamp) {
+        for (int i = 0; i < 3; ++i)
+            values[i] = a.values[i];
+        return;
+    }
+
+    const Sample& b = at(before + 1);
+    qint64 span = b.timestamp - a.timestamp;
+    qint64 offset = timestamp - a.timestamp;
+    for (int i = 0; i < 3; ++i) {
+        if (interpolate)
+            values[i] = a.values[i] + (qint64)(b.values[i] - a.values[i]) * offset / span;
+        else
+            values[i] = (offset * 2 < span) ? a.values[i] : b.values[i];
+    }
+}
+
+SyncFilter::SyncFilter() :
+        accelerometerDataSink_(this, &SyncFilter::tick),
+        gyroscopeDataSink_(this, &SyncFilter::updateGyroscope),
+        magnetometerDataSink_(this, &SyncFilter::updateMagnetometer),
+        latestTick_(0),
+        interpolate_(true),
+        maxDelay_(20000)
+{
+    addSink(&accelerometerDataSink_, "accelerometersink");
+    addSink(&gyroscopeDataSink_, "gyroscopesink");
+    addSink(&magnetometerDataSink_, "magnetometersink");
+    addSource(&source_, "source");
+
+    if (Config::configuration()) {
+        interpolate_ = Config::configuration()->value<QString>("fusion/sync_mode", "interpolate") != "nearest";
+        maxDelay_ = Config::configuration()->value<quint64>("fusion/max_delay", maxDelay_ / 1000) * 1000;
+    }
+    pending_.reserve(MAX_PENDING);
+}
+
+void SyncFilter::setInterpolate(bool interpolate)
+{
+    QMutexLocker locker(&mutex_);
+    interpolate_ = interpolate;
+}
+
+bool SyncFilter::interpolate() const
+{
+    return interpolate_;
+}
+
+void SyncFilter::setMaxDelay(quint64 delay)
+{
+    QMutexLocker locker(&mutex_);
+    maxDelay_ = delay;
+    release();
+}
+
+quint64 SyncFilter::maxDelay() const
+{
+    return maxDelay_;
+}
+
+void SyncFilter::tick(unsigned n, const TimedXyzData* data)
+{
+    QMutexLocker locker(&mutex_);
+    for (unsigned i = 0; i < n; ++i, ++data) {
+        // Streams are too far behind, give up waiting for them
+        if (pending_.size() == MAX_PENDING)
+            release(true);
+        pending_.append(*data);
+        if (data->timestamp_ > latestTick_)
+            latestTick_ = data->timestamp_;
+    }
+    release();
+}
+
+void SyncFilter::updateGyroscope(unsigned n, const TimedXyzData* data)
+{
+    QMutexLocker locker(&mutex_);
+    for (unsigned i = 0; i < n; ++i, ++data)
+        gyroscope_.append(data->timestamp_, data->x_, data->y_, data->z_);
+    release();
+}
+
+void SyncFilter::updateMagnetometer(unsigned n, const CalibratedMagneticFieldData* data)
+{
+    QMutexLocker locker(&mutex_);
+    for (unsigned i = 0; i < n; ++i, ++data)
+        magnetometer_.append(data->timestamp_, data->x_, data->y_, data->z_);
+    release();
+}
+
+void SyncFilter::release(bool all)
+{
+    FilterBatch<FusionData> batch;
+    int released = 0;
+    for (; released < pending_.size(); ++released) {
+        const TimedXyzData& tick = pending_.at(released);
+        bool late = all || latestTick_ >= tick.timestamp_ + maxDelay_;
+        if (!late && !(gyroscope_.covers(tick.timestamp_) && magnetometer_.covers(tick.timestamp_)))
+            break;
+
+        FusionData frame;
+        frame.timestamp_ = tick.timestamp_;
+        frame.accelerometer_[0] = tick.x_;
+        frame.accelerometer_[1] = tick.y_;
+        frame.accelerometer_[2] = tick.z_;
+        gyroscope_.valueAt(tick.timestamp_, interpolate_, frame.gyroscope_);
+        magnetometer_.valueAt(tick.timestamp_, interpolate_, frame.magnetometer_);
+        batch.append(frame);
+        if ((unsigned)batch.size() == FILTER_BATCH_SIZE) {
+            batch.propagate(source_);
+            batch.clear();
+        }
+    }
+    pending_.remove(0, released);
+    batch.propagate(source_);
+}
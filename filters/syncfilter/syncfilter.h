@@ -0,0 +1,184 @@
+/**
+   @file syncfilter.h
+   @brief SyncFilter
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef SYNCFILTER_H
+#define SYNCFILTER_H
+
+#include <QObject>
+#include <QMutex>
+#include <QVector>
+
+#include "orientationdata.h"
+#include "fusiondata.h"
+#include "filter.h"
+
+/**
+ * @brief Filter joining accelerometer, gyroscope and magnetometer streams.
+ *
+ * Every accelerometer sample is a tick of the common timebase. Gyroscope
+ * and magnetometer values at the tick are either taken from the nearest
+ * sample or linearly interpolated between the samples around it. A tick
+ * is held back until the other streams have a sample at or after it, at
+ * most until an accelerometer sample #maxDelay() newer has arrived.
+ * Streams which have not delivered anything do not hold ticks back.
+ *
+ * Mode and delay are read from fusion/sync_mode ("nearest" or
+ * "interpolate") and fusion/max_delay (milliseconds).
+ */
+class SyncFilter : public QObject, public FilterBase
+{
+    Q_OBJECT;
+public:
+    /**
+     * Factory method.
+     * @return New SyncFilter instance as FilterBase*.
+     */
+    static FilterBase* factoryMethod()
+    {
+        return new SyncFilter();
+    }
+
+    /**
+     * Set whether the streams are interpolated to the tick.
+     *
+     * @param interpolate interpolate instead of taking nearest sample.
+     */
+    void setInterpolate(bool interpolate);
+
+    /**
+     * Are the streams interpolated to the tick.
+     *
+     * @return is interpolation used.
+     */
+    bool interpolate() const;
+
+    /**
+     * Set how long ticks are held back for late streams.
+     *
+     * @param delay delay in microseconds of accelerometer time.
+     */
+    void setMaxDelay(quint64 delay);
+
+    /**
+     * How long ticks are held back for late streams.
+     *
+     * @return delay in microseconds.
+     */
+    quint64 maxDelay() const;
+
+private:
+    /**
+     * Default constructor.
+     */
+    SyncFilter();
+
+    /**
+     * Recent samples of a stream aligned to the ticks.
+     */
+    class Stream
+    {
+    public:
+        Stream();
+
+        /**
+         * Store a sample.
+         *
+         * @param timestamp sample time.
+         * @param x X value.
+         * @param y Y value.
+         * @param z Z value.
+         */
+        void append(quint64 timestamp, int x, int y, int z);
+
+        /**
+         * Is the value at given time known without waiting for more
+         * samples.
+         *
+         * @param timestamp tick time.
+         * @return true if stream has no samples or has one at or after
+         *         the tick.
+         */
+        bool covers(quint64 timestamp) const;
+
+        /**
+         * Value of the stream at given time.
+         *
+         * @param timestamp tick time.
+         * @param interpolate interpolate instead of taking nearest sample.
+         * @param values location for x, y and z.
+         */
+        void valueAt(quint64 timestamp, bool interpolate, int* values) const;
+
+    private:
+        /** Number of samples kept. */
+        static const int HISTORY = 16;
+
+        /**
+         * Stored sample.
+         */
+        struct Sample
+        {
+            quint64 timestamp; /**< sample time */
+            int     values[3]; /**< x, y and z */
+        };
+
+        /**
+         * Get stored sample.
+         *
+         * @param i index from the oldest sample.
+         * @return sample.
+         */
+        const Sample& at(int i) const;
+
+        Sample samples_[HISTORY]; /**< ring of samples */
+        int    count_;            /**< stored samples */
+        int    next_;             /**< slot of the next sample */
+    };
+
+    Sink<SyncFilter, TimedXyzData> accelerometerDataSink_;
+    Sink<SyncFilter, TimedXyzData> gyroscopeDataSink_;
+    Sink<SyncFilter, CalibratedMagneticFieldData> magnetometerDataSink_;
+    Source<FusionData> source_;
+
+    void tick(unsigned, const TimedXyzData*);
+    void updateGyroscope(unsigned, const TimedXyzData*);
+    void updateMagnetometer(unsigned, const CalibratedMagneticFieldData*);
+
+    /**
+     * Propagate ticks which can be completed. Caller holds mutex_.
+     *
+     * @param all propagate all ticks without waiting for other streams.
+     */
+    void release(bool all = false);
+
+    /** Ticks held back at most. */
+    static const int MAX_PENDING = 64;
+
+    QMutex                mutex_;        /**< sinks may be fed from different threads */
+    QVector<TimedXyzData> pending_;      /**< ticks waiting for other streams */
+    Stream                gyroscope_;    /**< gyroscope samples */
+    Stream                magnetometer_; /**< magnetometer samples */
+    quint64               latestTick_;   /**< newest accelerometer timestamp */
+    bool                  interpolate_;  /**< interpolate instead of nearest */
+    quint64               maxDelay_;     /**< hold back limit in microseconds */
+};
+
+#endif // SYNCFILTER_H
@@ -0,0 +1,9 @@
+TARGET = syncfilter
+
+HEADERS += syncfilter.h \
+           syncfilterplugin.h
+
+SOURCES += syncfilter.cpp \
+           syncfilterplugin.cpp
+
+include( ../filter-config.pri )
@@ -0,0 +1,37 @@
+/**
+   @file syncfilterplugin.cpp
+   @brief Plugin for SyncFilter
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "syncfilterplugin.h"
+#include "syncfilter.h"
+#include "sensormanager.h"
+
+#include "logging.h"
+
+void SyncFilterPlugin::Register(class Loader&)
+{
+    sensordLogD() << "registering syncfilter";
+    SensorManager& sm = SensorManager::instance();
+    sm.registerFilter<SyncFilter>("syncfilter");
+}
+
+#if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
+Q_EXPORT_PLUGIN2(syncfilter, SyncFilterPlugin)
+#endif
@@ -26,12 +26,28 @@
    </p>
  */
 
+#include <QTimer>
 #include "sensormanagerinterface.h"
 #include "abstractsensor_i.h"
 #ifdef SENSORFW_MCE_WATCHER
 #include "mcewatcher.h"
 #endif
 
+/**
+ * Static metadata of a sensor, shared by its interfaces in the process.
+ */
+struct SensorMetadata
+{
+    SensorMetadata() : interfaces(0) {}
+
+    int interfaces;                 /**< live interfaces of the sensor */
+    QMap<QString, QVariant> values; /**< accessor results by method name */
+};
+
+/** Metadata of sensors, keyed by D-Bus object path */
+static QMap<QString, SensorMetadata> metadataCache;
+static QMutex metadataMutex;
+
 struct AbstractSensorChannelInterface::AbstractSensorChannelInterfaceImpl : public QDBusAbstractInterface
 {
     AbstractSensorChannelInterfaceImpl(QObject* parent, int sessionId, const QString& path, const char* interfaceName);
@@ -51,6 +67,18 @@ struct AbstractSensorChannelInterface::AbstractSensorChannelInterfaceImpl : publ
     bool running_;
     bool standbyOverride_;
     bool downsampling_;
+    unsigned int changeThreshold_;
+    unsigned int motionThreshold_;
+    unsigned int motionDuration_;
+    unsigned int framePeriod_;
+    unsigned int framePhase_;
+    unsigned int frameLead_;
+    bool frameExtrapolate_;
+    int priority_;
+    quint64 token_;
+    unsigned int batchLatency_;
+    unsigned int batchSize_;
+    QTimer batchTimer_;
 };
 
 AbstractSensorChannelInterface::AbstractSensorChannelInterfaceImpl::AbstractSensorChannelInterfaceImpl(QObject* parent, int sessionId, const QString& path, const char* interfaceName) :
@@ -64,8 +92,20 @@ AbstractSensorChannelInterface::AbstractSensorChannelInterfaceImpl::AbstractSens
     socketReader_(parent),
     running_(false),
     standbyOverride_(false),
-    downsampling_(true)
-{
+    downsampling_(true),
+    changeThreshold_(0),
+    motionThreshold_(0),
+    motionDuration_(0),
+    framePeriod_(0),
+    framePhase_(0),
+    frameLead_(0),
+    frameExtrapolate_(false),
+    priority_(0),
+    token_(0),
+    batchLatency_(0),
+    batchSize_(0)
+{
+    batchTimer_.setSingleShot(true);
 }
 
 AbstractSensorChannelInterface::AbstractSensorChannelInterface(const QString& path, const char* interfaceName, int sessionId) :
@@ -74,6 +114,14 @@ AbstractSensorChannelInterface::AbstractSensorChannelInterface(const QString& pa
     if (!pimpl_->socketReader_.initiateConnection(sessionId)) {
         setError(SClientSocketError, "Socket connection failed.");
     }
+
+    {
+        QMutexLocker locker(&metadataMutex);
+        ++metadataCache[path].interfaces;
+    }
+    QDBusConnection::systemBus().connect(SERVICE_NAME, path, interfaceName, "propertiesChanged",
+                                         this, SLOT(propertiesChanged(const QVariantMap&)));
+    connect(&pimpl_->batchTimer_, SIGNAL(timeout()), this, SLOT(batchTimeout()));
 #ifdef SENSORFW_MCE_WATCHER
     MceWatcher *mcewatcher;
     mcewatcher = new MceWatcher(this);
@@ -84,6 +132,12 @@ AbstractSensorChannelInterface::AbstractSensorChannelInterface(const QString& pa
 
 AbstractSensorChannelInterface::~AbstractSensorChannelInterface()
 {
+    {
+        QMutexLocker locker(&metadataMutex);
+        QMap<QString, SensorMetadata>::iterator it = metadataCache.find(pimpl_->path());
+        if (it != metadataCache.end() && --it->interfaces == 0)
+            metadataCache.erase(it);
+    }
     if ( pimpl_->isValid() )
         SensorManagerInterface::instance().releaseInterface(id(), pimpl_->sessionId_);
     if (!pimpl_->socketReader_.dropConnection())
@@ -126,8 +180,21 @@ QDBusReply<void> AbstractSensorChannelInterface::start(int sessionId)
     }
     pimpl_->running_ = true;
 
-    connect(pimpl_->socketReader_.socket(), SIGNAL(readyRead()), this, SLOT(dataReceived()));
+    connect(&pimpl_->socketReader_, SIGNAL(readyRead()), this, SLOT(dataReceived()), Qt::UniqueConnection);
+
+    QDBusMessage reply = pimpl_->callWithArgumentList(QDBus::Block, QLatin1String("configureAndStart"), startArguments(sessionId));
+    if (reply.type() != QDBusMessage::ErrorMessage || QDBusError(reply).type() != QDBusError::UnknownMethod) {
+        sessionToken();
+        if (pimpl_->changeThreshold_)
+            setChangeThreshold(sessionId, pimpl_->changeThreshold_);
+        if (pimpl_->motionThreshold_)
+            setMotionThreshold(sessionId, pimpl_->motionThreshold_, pimpl_->motionDuration_);
+        if (pimpl_->framePeriod_)
+            setFramePacing(sessionId, pimpl_->framePeriod_, pimpl_->framePhase_, pimpl_->frameLead_, pimpl_->frameExtrapolate_);
+        return reply;
+    }
 
+    // sensord without configureAndStart
     QList<QVariant> argumentList;
     argumentList << qVariantFromValue(sessionId);
     QDBusReply<void> returnValue = pimpl_->callWithArgumentList(QDBus::Block, QLatin1String("start"), argumentList);
@@ -137,10 +204,65 @@ QDBusReply<void> AbstractSensorChannelInterface::start(int sessionId)
     setBufferInterval(sessionId, pimpl_->bufferInterval_);
     setBufferSize(sessionId, pimpl_->bufferSize_);
     setDownsampling(pimpl_->sessionId_, pimpl_->downsampling_);
+    if (pimpl_->changeThreshold_)
+        setChangeThreshold(sessionId, pimpl_->changeThreshold_);
+    if (pimpl_->motionThreshold_)
+        setMotionThreshold(sessionId, pimpl_->motionThreshold_, pimpl_->motionDuration_);
+    if (pimpl_->framePeriod_)
+        setFramePacing(sessionId, pimpl_->framePeriod_, pimpl_->framePhase_, pimpl_->frameLead_, pimpl_->frameExtrapolate_);
 
     return returnValue;
 }
 
+QDBusPendingCall AbstractSensorChannelInterface::startAsync()
+{
+    clearError();
+
+    if (!pimpl_->running_) {
+        pimpl_->running_ = true;
+        connect(&pimpl_->socketReader_, SIGNAL(readyRead()), this, SLOT(dataReceived()), Qt::UniqueConnection);
+    }
+    QDBusPendingCall call = pimpl_->asyncCallWithArgumentList(QLatin1String("configureAndStart"), startArguments(pimpl_->sessionId_));
+    // Messages are handled in order, so the threshold is applied after start.
+    if (pimpl_->changeThreshold_) {
+        QList<QVariant> argumentList;
+        argumentList << qVariantFromValue(pimpl_->sessionId_) << qVariantFromValue(pimpl_->changeThreshold_);
+        pimpl_->asyncCallWithArgumentList(QLatin1String("setChangeThreshold"), argumentList);
+    }
+    if (pimpl_->motionThreshold_) {
+        QList<QVariant> argumentList;
+        argumentList << qVariantFromValue(pimpl_->sessionId_) << qVariantFromValue(pimpl_->motionThreshold_) << qVariantFromValue(pimpl_->motionDuration_);
+        pimpl_->asyncCallWithArgumentList(QLatin1String("setMotionThreshold"), argumentList);
+    }
+    if (pimpl_->framePeriod_) {
+        QList<QVariant> argumentList;
+        argumentList << qVariantFromValue(pimpl_->sessionId_) << qVariantFromValue(pimpl_->framePeriod_)
+                     << qVariantFromValue(pimpl_->framePhase_) << qVariantFromValue(pimpl_->frameLead_)
+                     << qVariantFromValue(pimpl_->frameExtrapolate_);
+        pimpl_->asyncCallWithArgumentList(QLatin1String("setFramePacing"), argumentList);
+    }
+    return call;
+}
+
+QList<QVariant> AbstractSensorChannelInterface::startArguments(int sessionId) const
+{
+    QList<QVariant> argumentList;
+    argumentList << qVariantFromValue(sessionId)
+                 << qVariantFromValue(pimpl_->standbyOverride_)
+                 << qVariantFromValue(pimpl_->interval_)
+                 << qVariantFromValue(pimpl_->bufferInterval_)
+                 << qVariantFromValue(pimpl_->bufferSize_)
+                 << qVariantFromValue(pimpl_->downsampling_);
+    return argumentList;
+}
+
+void AbstractSensorChannelInterface::setStarted()
+{
+    clearError();
+    pimpl_->running_ = true;
+    connect(&pimpl_->socketReader_, SIGNAL(readyRead()), this, SLOT(dataReceived()), Qt::UniqueConnection);
+}
+
 QDBusReply<void> AbstractSensorChannelInterface::stop(int sessionId)
 {
     clearError();
@@ -150,7 +272,9 @@ QDBusReply<void> AbstractSensorChannelInterface::stop(int sessionId)
     }
     pimpl_->running_ = false ;
 
-    disconnect(pimpl_->socketReader_.socket(), SIGNAL(readyRead()), this, SLOT(dataReceived()));
+    disconnect(&pimpl_->socketReader_, SIGNAL(readyRead()), this, SLOT(dataReceived()));
+    pimpl_->batchTimer_.stop();
+    flushBatch();
 
     QList<QVariant> argumentList;
     argumentList << qVariantFromValue(sessionId);
@@ -195,7 +319,7 @@ QDBusReply<bool> AbstractSensorChannelInterface::setStandbyOverride(int sessionI
 
 DataRangeList AbstractSensorChannelInterface::getAvailableDataRanges()
 {
-    return getAccessor<DataRangeList>("getAvailableDataRanges");
+    return getCachedAccessor<DataRangeList>("getAvailableDataRanges");
 }
 
 DataRange AbstractSensorChannelInterface::getCurrentDataRange()
@@ -206,33 +330,33 @@ DataRange AbstractSensorChannelInterface::getCurrentDataRange()
 void AbstractSensorChannelInterface::requestDataRange(DataRange range)
 {
     clearError();
-    call(QDBus::Block, QLatin1String("requestDataRange"), qVariantFromValue(pimpl_->sessionId_), qVariantFromValue(range));
+    call(QDBus::NoBlock, QLatin1String("requestDataRange"), qVariantFromValue(pimpl_->sessionId_), qVariantFromValue(range));
 }
 
 void AbstractSensorChannelInterface::removeDataRangeRequest()
 {
     clearError();
-    call(QDBus::Block, QLatin1String("removeDataRangeRequest"), qVariantFromValue(pimpl_->sessionId_));
+    call(QDBus::NoBlock, QLatin1String("removeDataRangeRequest"), qVariantFromValue(pimpl_->sessionId_));
 }
 
 DataRangeList AbstractSensorChannelInterface::getAvailableIntervals()
 {
-    return getAccessor<DataRangeList>("getAvailableIntervals");
+    return getCachedAccessor<DataRangeList>("getAvailableIntervals");
 }
 
 IntegerRangeList AbstractSensorChannelInterface::getAvailableBufferIntervals()
 {
-    return getAccessor<IntegerRangeList>("getAvailableBufferIntervals");
+    return getCachedAccessor<IntegerRangeList>("getAvailableBufferIntervals");
 }
 
 IntegerRangeList AbstractSensorChannelInterface::getAvailableBufferSizes()
 {
-    return getAccessor<IntegerRangeList>("getAvailableBufferSizes");
+    return getCachedAccessor<IntegerRangeList>("getAvailableBufferSizes");
 }
 
 bool AbstractSensorChannelInterface::hwBuffering()
 {
-    return getAccessor<bool>("hwBuffering");
+    return getCachedAccessor<bool>("hwBuffering");
 }
 
 int AbstractSensorChannelInterface::sessionId() const
@@ -257,12 +381,12 @@ QString AbstractSensorChannelInterface::errorString()
 
 QString AbstractSensorChannelInterface::description()
 {
-    return getAccessor<QString>("description");
+    return getCachedAccessor<QString>("description");
 }
 
 QString AbstractSensorChannelInterface::id()
 {
-    return getAccessor<QString>("id");
+    return getCachedAccessor<QString>("id");
 }
 
 int AbstractSensorChannelInterface::interval()
@@ -274,9 +398,15 @@ int AbstractSensorChannelInterface::interval()
 
 void AbstractSensorChannelInterface::setInterval(int value)
 {
+    if (pimpl_->running_ && value == pimpl_->interval_)
+        return;
     pimpl_->interval_ = value;
-    if (pimpl_->running_)
-        setInterval(pimpl_->sessionId_, value);
+    if (pimpl_->running_) {
+        // Nothing is returned, later calls are ordered after this one
+        QList<QVariant> argumentList;
+        argumentList << qVariantFromValue(pimpl_->sessionId_) << qVariantFromValue(value);
+        pimpl_->callWithArgumentList(QDBus::NoBlock, QLatin1String("setInterval"), argumentList);
+    }
 }
 
 unsigned int AbstractSensorChannelInterface::bufferInterval()
@@ -324,7 +454,64 @@ bool AbstractSensorChannelInterface::setStandbyOverride(bool override)
 
 QString AbstractSensorChannelInterface::type()
 {
-    return getAccessor<QString>("type");
+    return getCachedAccessor<QString>("type");
+}
+
+bool AbstractSensorChannelInterface::cachedMetadata(const char* name, QVariant& value) const
+{
+    QMutexLocker locker(&metadataMutex);
+    QMap<QString, SensorMetadata>::const_iterator it = metadataCache.constFind(pimpl_->path());
+    if (it == metadataCache.constEnd() || !it->values.contains(name))
+        return false;
+    value = it->values.value(name);
+    return true;
+}
+
+QVariantMap AbstractSensorChannelInterface::status()
+{
+    QDBusReply<QVariantMap> reply(call(QDBus::Block, QLatin1String("status"), qVariantFromValue(sessionId())));
+    if (!reply.isValid()) {
+        qDebug() << "Failed to get 'status' from sensord: " << reply.error().message();
+        return QVariantMap();
+    }
+
+    // Values of sensord types arrive marshalled
+    QVariantMap status(reply.value());
+    for (QVariantMap::iterator it = status.begin(); it != status.end(); ++it) {
+        if (!it->canConvert<QDBusArgument>())
+            continue;
+        QDBusArgument argument(it->value<QDBusArgument>());
+        if (it.key() == "getCurrentDataRange")
+            *it = qVariantFromValue(qdbus_cast<DataRange>(argument));
+        else if (it.key() == "getAvailableDataRanges" || it.key() == "getAvailableIntervals")
+            *it = qVariantFromValue(qdbus_cast<DataRangeList>(argument));
+        else if (it.key() == "getAvailableBufferIntervals" || it.key() == "getAvailableBufferSizes")
+            *it = qVariantFromValue(qdbus_cast<IntegerRangeList>(argument));
+    }
+
+    static const char* const CACHED[] = {
+        "description", "id", "type", "hwBuffering", "getAvailableDataRanges",
+        "getAvailableIntervals", "getAvailableBufferIntervals", "getAvailableBufferSizes"
+    };
+    for (unsigned int i = 0; i < sizeof(CACHED) / sizeof(CACHED[0]); ++i)
+        if (status.contains(CACHED[i]))
+            cacheMetadata(CACHED[i], status.value(CACHED[i]));
+    return status;
+}
+
+void AbstractSensorChannelInterface::cacheMetadata(const char* name, const QVariant& value)
+{
+    QMutexLocker locker(&metadataMutex);
+    metadataCache[pimpl_->path()].values.insert(name, value);
+}
+
+void AbstractSensorChannelInterface::propertiesChanged(const QVariantMap& changes)
+{
+    Q_UNUSED(changes);
+    QMutexLocker locker(&metadataMutex);
+    QMap<QString, SensorMetadata>::iterator it = metadataCache.find(pimpl_->path());
+    if (it != metadataCache.end())
+        it->values.clear();
 }
 
 void AbstractSensorChannelInterface::clearError()
@@ -339,7 +526,26 @@ void AbstractSensorChannelInterface::dataReceived()
     {
         if(!dataReceivedImpl())
             return;
-    } while(pimpl_->socketReader_.socket()->bytesAvailable());
+    } while(pimpl_->socketReader_.bytesAvailable());
+}
+
+bool AbstractSensorChannelInterface::poll()
+{
+    if (!pimpl_->running_)
+        return false;
+    return dataReceivedImpl();
+}
+
+int AbstractSensorChannelInterface::socketDescriptor()
+{
+    return pimpl_->socketReader_.socketDescriptor();
+}
+
+unsigned int AbstractSensorChannelInterface::drain(void* buffer, unsigned int sampleSize, unsigned int max)
+{
+    if (!pimpl_->running_ || !sampleSize)
+        return 0;
+    return pimpl_->socketReader_.drain(buffer, sampleSize, max);
 }
 
 bool AbstractSensorChannelInterface::read(void* buffer, int size)
@@ -357,6 +563,27 @@ bool AbstractSensorChannelInterface::setDataRangeIndex(int dataRangeIndex)
     return false;
 }
 
+bool AbstractSensorChannelInterface::readLatest()
+{
+    clearError();
+    // Stopped interface does not listen to the data connection
+    connect(&pimpl_->socketReader_, SIGNAL(readyRead()), this, SLOT(dataReceived()), Qt::UniqueConnection);
+    QDBusReply<bool> dbusReply = pimpl_->call(QLatin1String("readLatest"), qVariantFromValue(pimpl_->sessionId_));
+    if (dbusReply.isValid())
+        return dbusReply.value();
+    return false;
+}
+
+bool AbstractSensorChannelInterface::readHistory(unsigned int ms)
+{
+    clearError();
+    connect(&pimpl_->socketReader_, SIGNAL(readyRead()), this, SLOT(dataReceived()), Qt::UniqueConnection);
+    QDBusReply<bool> dbusReply = pimpl_->call(QLatin1String("readHistory"), qVariantFromValue(pimpl_->sessionId_), qVariantFromValue(ms));
+    if (dbusReply.isValid())
+        return dbusReply.value();
+    return false;
+}
+
 QDBusMessage AbstractSensorChannelInterface::call(QDBus::CallMode mode,
                                                   const QString& method,
                                                   const QVariant& arg1,
@@ -401,6 +628,166 @@ bool AbstractSensorChannelInterface::setDownsampling(bool value)
     return setDownsampling(pimpl_->sessionId_, value).isValid();
 }
 
+unsigned int AbstractSensorChannelInterface::changeThreshold() const
+{
+    return pimpl_->changeThreshold_;
+}
+
+bool AbstractSensorChannelInterface::setChangeThreshold(unsigned int value)
+{
+    pimpl_->changeThreshold_ = value;
+    if (!pimpl_->running_)
+        return true;
+    return setChangeThreshold(pimpl_->sessionId_, value).isValid();
+}
+
+unsigned int AbstractSensorChannelInterface::motionThreshold() const
+{
+    return pimpl_->motionThreshold_;
+}
+
+unsigned int AbstractSensorChannelInterface::motionDuration() const
+{
+    return pimpl_->motionDuration_;
+}
+
+bool AbstractSensorChannelInterface::setMotionThreshold(unsigned int threshold, unsigned int duration)
+{
+    pimpl_->motionThreshold_ = threshold;
+    pimpl_->motionDuration_ = duration;
+    if (!pimpl_->running_)
+        return true;
+    return setMotionThreshold(pimpl_->sessionId_, threshold, duration).isValid();
+}
+
+quint64 AbstractSensorChannelInterface::sessionToken()
+{
+    if (!pimpl_->token_) {
+        QDBusReply<qulonglong> reply = SensorManagerInterface::instance().sessionToken(pimpl_->sessionId_);
+        if (reply.isValid())
+            pimpl_->token_ = reply.value();
+    }
+    return pimpl_->token_;
+}
+
+bool AbstractSensorChannelInterface::resume()
+{
+    clearError();
+
+    if (!pimpl_->token_) {
+        setError(SaCannotAccessSensor, "Session is not resumable.");
+        return false;
+    }
+
+    // Socket is connected first, so that the configuration applied when
+    // the session is resumed reaches it
+    pimpl_->socketReader_.dropConnection();
+    if (!pimpl_->socketReader_.initiateConnection(pimpl_->sessionId_)) {
+        setError(SClientSocketError, "Socket connection failed.");
+        return false;
+    }
+
+    QDBusReply<int> reply = SensorManagerInterface::instance().resumeSession(pimpl_->token_);
+    if (!reply.isValid() || reply.value() != pimpl_->sessionId_) {
+        setError(SaCannotAccessSensor, reply.isValid() ? QString("Unknown resume token.") : reply.error().message());
+        return false;
+    }
+    // Priority is not recorded, the resumed session starts from the default
+    if (pimpl_->priority_)
+        setPriority(pimpl_->sessionId_, pimpl_->priority_);
+    if (!pimpl_->running_)
+        return true;
+    connect(&pimpl_->socketReader_, SIGNAL(readyRead()), this, SLOT(dataReceived()), Qt::UniqueConnection);
+    // Settings beyond the recorded ones are sent again
+    if (pimpl_->changeThreshold_)
+        setChangeThreshold(pimpl_->sessionId_, pimpl_->changeThreshold_);
+    if (pimpl_->motionThreshold_)
+        setMotionThreshold(pimpl_->sessionId_, pimpl_->motionThreshold_, pimpl_->motionDuration_);
+    if (pimpl_->framePeriod_)
+        setFramePacing(pimpl_->sessionId_, pimpl_->framePeriod_, pimpl_->framePhase_, pimpl_->frameLead_, pimpl_->frameExtrapolate_);
+    return true;
+}
+
+unsigned int AbstractSensorChannelInterface::framePeriod() const
+{
+    return pimpl_->framePeriod_;
+}
+
+bool AbstractSensorChannelInterface::setFramePacing(unsigned int period, unsigned int phase, unsigned int lead, bool extrapolate)
+{
+    pimpl_->framePeriod_ = period;
+    pimpl_->framePhase_ = phase;
+    pimpl_->frameLead_ = lead;
+    pimpl_->frameExtrapolate_ = extrapolate;
+    if (!pimpl_->running_)
+        return true;
+    return setFramePacing(pimpl_->sessionId_, period, phase, lead, extrapolate).isValid();
+}
+
+int AbstractSensorChannelInterface::priority() const
+{
+    return pimpl_->priority_;
+}
+
+bool AbstractSensorChannelInterface::setPriority(int priority)
+{
+    pimpl_->priority_ = priority;
+    return setPriority(pimpl_->sessionId_, priority).isValid();
+}
+
+void AbstractSensorChannelInterface::setBatching(unsigned int maxLatency, unsigned int maxSamples)
+{
+    pimpl_->batchLatency_ = maxLatency;
+    pimpl_->batchSize_ = maxSamples;
+    pimpl_->batchTimer_.stop();
+    flushBatch();
+}
+
+unsigned int AbstractSensorChannelInterface::batchLatency() const
+{
+    return pimpl_->batchLatency_;
+}
+
+unsigned int AbstractSensorChannelInterface::batchSize() const
+{
+    return pimpl_->batchSize_;
+}
+
+bool AbstractSensorChannelInterface::setThreadedReceive(bool enabled)
+{
+    return pimpl_->socketReader_.setThreadedReceive(enabled);
+}
+
+bool AbstractSensorChannelInterface::threadedReceive() const
+{
+    return pimpl_->socketReader_.threadedReceive();
+}
+
+bool AbstractSensorChannelInterface::batching() const
+{
+    return pimpl_->batchLatency_ > 0;
+}
+
+bool AbstractSensorChannelInterface::batchPending(unsigned int pending)
+{
+    if (pimpl_->batchSize_ && pending >= pimpl_->batchSize_) {
+        pimpl_->batchTimer_.stop();
+        return true;
+    }
+    if (!pimpl_->batchTimer_.isActive())
+        pimpl_->batchTimer_.start(pimpl_->batchLatency_);
+    return false;
+}
+
+void AbstractSensorChannelInterface::flushBatch()
+{
+}
+
+void AbstractSensorChannelInterface::batchTimeout()
+{
+    flushBatch();
+}
+
 QDBusReply<void> AbstractSensorChannelInterface::setDownsampling(int sessionId, bool value)
 {
     clearError();
@@ -410,6 +797,43 @@ QDBusReply<void> AbstractSensorChannelInterface::setDownsampling(int sessionId,
     return pimpl_->callWithArgumentList(QDBus::Block, QLatin1String("setDownsampling"), argumentList);
 }
 
+QDBusReply<void> AbstractSensorChannelInterface::setChangeThreshold(int sessionId, unsigned int value)
+{
+    clearError();
+
+    QList<QVariant> argumentList;
+    argumentList << qVariantFromValue(sessionId) << qVariantFromValue(value);
+    return pimpl_->callWithArgumentList(QDBus::Block, QLatin1String("setChangeThreshold"), argumentList);
+}
+
+QDBusReply<void> AbstractSensorChannelInterface::setMotionThreshold(int sessionId, unsigned int threshold, unsigned int duration)
+{
+    clearError();
+
+    QList<QVariant> argumentList;
+    argumentList << qVariantFromValue(sessionId) << qVariantFromValue(threshold) << qVariantFromValue(duration);
+    return pimpl_->callWithArgumentList(QDBus::Block, QLatin1String("setMotionThreshold"), argumentList);
+}
+
+QDBusReply<void> AbstractSensorChannelInterface::setFramePacing(int sessionId, unsigned int period, unsigned int phase, unsigned int lead, bool extrapolate)
+{
+    clearError();
+
+    QList<QVariant> argumentList;
+    argumentList << qVariantFromValue(sessionId) << qVariantFromValue(period) << qVariantFromValue(phase)
+                 << qVariantFromValue(lead) << qVariantFromValue(extrapolate);
+    return pimpl_->callWithArgumentList(QDBus::Block, QLatin1String("setFramePacing"), argumentList);
+}
+
+QDBusReply<void> AbstractSensorChannelInterface::setPriority(int sessionId, int priority)
+{
+    clearError();
+
+    QList<QVariant> argumentList;
+    argumentList << qVariantFromValue(sessionId) << qVariantFromValue(priority);
+    return pimpl_->callWithArgumentList(QDBus::Block, QLatin1String("setPriority"), argumentList);
+}
+
 void AbstractSensorChannelInterface::displayStateChanged(bool displayState)
 {
     if (!pimpl_->standbyOverride_) {
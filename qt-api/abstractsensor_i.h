@@ -39,6 +39,32 @@
 #include "socketreader.h"
 #include "datatypes/datarange.h"
 
+/**
+ * Callback receiving sensor frames without conversion to QObject based
+ * types. Observers are invoked from the thread of the sensor interface
+ * before any signals are emitted.
+ *
+ * @tparam T type of the objects sent by sensord.
+ */
+template<typename T>
+class SensorFrameObserver
+{
+public:
+    /**
+     * Destructor.
+     */
+    virtual ~SensorFrameObserver() {}
+
+    /**
+     * Called for every frame received from sensord.
+     *
+     * @param values objects of the frame. Points into the receive buffer
+     *               of the interface and is valid only during the call.
+     * @param count number of objects.
+     */
+    virtual void frameReceived(const T* values, unsigned int count) = 0;
+};
+
 /**
  * Base-class for client facades of different sensor types.
  */
@@ -46,6 +72,7 @@ class AbstractSensorChannelInterface : public QObject
 {
     Q_OBJECT
     Q_DISABLE_COPY(AbstractSensorChannelInterface)
+    friend class SensorManagerInterface;
     Q_PROPERTY(int sessionId READ sessionId)
     Q_PROPERTY(SensorError errorCode READ errorCode)
     Q_PROPERTY(QString errorString READ errorString)
@@ -58,6 +85,7 @@ class AbstractSensorChannelInterface : public QObject
     Q_PROPERTY(unsigned int bufferSize READ bufferSize WRITE setBufferSize)
     Q_PROPERTY(bool hwBuffering READ hwBuffering)
     Q_PROPERTY(bool downsampling READ downsampling WRITE setDownsampling)
+    Q_PROPERTY(unsigned int changeThreshold READ changeThreshold WRITE setChangeThreshold)
 
 public:
 
@@ -183,6 +211,157 @@ public:
      */
     bool setDownsampling(bool value);
 
+    /**
+     * Change threshold of the session.
+     *
+     * @return change threshold, 0 if every sample is delivered.
+     */
+    unsigned int changeThreshold() const;
+
+    /**
+     * Deliver a sample only when its value differs from the one last
+     * delivered to this session by more than given threshold. Supported
+     * by sensors of discrete values such as ALS and proximity; others
+     * deliver every sample regardless.
+     *
+     * @param value change threshold in units of the sample value, 0 delivers every sample.
+     * @return was change threshold succesfully sent to the sensor.
+     */
+    bool setChangeThreshold(unsigned int value);
+
+    /**
+     * Motion threshold of the session.
+     *
+     * @return motion threshold, 0 if every sample is delivered.
+     */
+    unsigned int motionThreshold() const;
+
+    /**
+     * Minimum motion duration of the session.
+     *
+     * @return duration in milliseconds.
+     */
+    unsigned int motionDuration() const;
+
+    /**
+     * Deliver a sample only when the device has moved: the magnitude of
+     * the difference to the last delivered sample has to exceed given
+     * threshold for at least given duration. Nothing is written to the
+     * session while the device lies still. Supported by the accelerometer;
+     * others deliver every sample regardless.
+     *
+     * @param threshold delta magnitude threshold in units of the sample value, 0 delivers every sample.
+     * @param duration minimum duration of the motion in milliseconds.
+     * @return was motion threshold succesfully sent to the sensor.
+     */
+    bool setMotionThreshold(unsigned int threshold, unsigned int duration);
+
+    /**
+     * Frame period of the session.
+     *
+     * @return frame period in microseconds, 0 if delivery is not paced.
+     */
+    unsigned int framePeriod() const;
+
+    /**
+     * Deliver one sample per display frame: the newest one is written
+     * lead microseconds before each vsync, optionally predicted to the
+     * vsync time. Meant for UI clients animating with the sensor, the
+     * vsync phase is taken on the monotonic clock.
+     *
+     * @param period frame period in microseconds, 0 ends pacing.
+     * @param phase vsync time modulo period in microseconds.
+     * @param lead how long before vsync the sample is written, in microseconds.
+     * @param extrapolate predict the sample to the vsync time.
+     * @return was frame pacing succesfully sent to the sensor.
+     */
+    bool setFramePacing(unsigned int period, unsigned int phase, unsigned int lead, bool extrapolate);
+
+    /**
+     * Get priority of the session, see setPriority().
+     *
+     * @return session priority.
+     */
+    int priority() const;
+
+    /**
+     * Set priority of the session for overload protection. When sensord
+     * is overloaded, sessions with lowest priority get coalesced samples
+     * and then longer intervals first. Sessions at or above the protected
+     * priority of the device are never degraded. Default is 0.
+     *
+     * @param priority session priority.
+     * @return was priority succesfully sent to the sensor.
+     */
+    bool setPriority(int priority);
+
+    /**
+     * Resume token of the session. Token is queried on first start()
+     * and cached, see resume().
+     *
+     * @return resume token, 0 if the session is not resumable.
+     */
+    quint64 sessionToken();
+
+    /**
+     * Get the session back after sensord has restarted. Data socket is
+     * reconnected and the session recreated with its recorded
+     * configuration in one call, instead of requesting the sensor and
+     * configuring it again.
+     *
+     * @return was session resumed.
+     */
+    bool resume();
+
+    /**
+     * Batch samples on the client side to limit the rate of signals.
+     * Samples are collected and delivered at most \a maxLatency
+     * milliseconds after the first of them arrived, or when \a maxSamples
+     * have been collected, whichever comes first. Delivery goes through
+     * frameAvailable if it is connected and otherwise through consecutive
+     * dataAvailable signals. Independent of server side buffering set with
+     * setBufferSize(). Supported by sensors delivering frames.
+     *
+     * @param maxLatency maximum delay in milliseconds, 0 disables batching.
+     * @param maxSamples maximum samples per batch, 0 for no limit.
+     */
+    void setBatching(unsigned int maxLatency, unsigned int maxSamples);
+
+    /**
+     * Maximum delay of client side batches.
+     *
+     * @return delay in milliseconds, 0 if batching is disabled.
+     */
+    unsigned int batchLatency() const;
+
+    /**
+     * Maximum size of client side batches.
+     *
+     * @return samples per batch, 0 for no limit.
+     */
+    unsigned int batchSize() const;
+
+    /**
+     * Receive samples in a background thread instead of the thread of
+     * the interface. The thread reads and decodes frames as they arrive
+     * and the interface gets one notification per event loop pass for
+     * all of them, so a busy GUI thread neither falls behind the socket
+     * nor handles every frame separately. Also enabled by setting
+     * SENSORFW_RECEIVE environment variable to "thread". Not used with
+     * shared memory and multiplexed transports.
+     *
+     * @param enabled receive in a background thread.
+     * @return was the mode switched.
+     */
+    bool setThreadedReceive(bool enabled);
+
+    /**
+     * Are samples received in a background thread, see setThreadedReceive().
+     *
+     * @return is a receive thread running.
+     */
+    bool threadedReceive() const;
+
     /**
      * Returns list of available buffer interval ranges.
      *
@@ -229,6 +408,19 @@ public:
      */
     virtual QDBusReply<void> start();
 
+    /**
+     * Start sensor without waiting for sensord. The session is started
+     * and configured with current property values in a single D-Bus call,
+     * and samples are received as soon as sensord has processed it. The
+     * returned call can be watched with QDBusPendingCallWatcher.
+     *
+     * Requires sensord with the configureAndStart method. For older
+     * versions the call fails and start() should be used.
+     *
+     * @return pending call from which the success can be seen.
+     */
+    QDBusPendingCall startAsync();
+
     /**
      * Stop sensor. This will cause acquired resourced to be released.
      *
@@ -279,6 +471,29 @@ public:
      */
     bool setDataRangeIndex(int dataRangeIndex);
 
+    /**
+     * Ask for the latest sample of the sensor. The sample arrives
+     * through the usual signals, also when the interface is not
+     * started, so polling clients need not stream. Only a sensor
+     * running for some session has a latest sample.
+     *
+     * @return was a sample sent.
+     */
+    bool readLatest();
+
+    /**
+     * Ask for the samples the sensor has produced during the last given
+     * milliseconds. The samples arrive as one batch through the usual
+     * signals, also when the interface is not started, so clients woken
+     * by a trigger can look back without streaming all the time. Only
+     * sensors with <tt>history_size</tt> configured in sensord keep a
+     * history, and only while running for some session.
+     *
+     * @param ms length of the window in milliseconds.
+     * @return were samples sent.
+     */
+    bool readHistory(unsigned int ms);
+
     /**
      * Does the sensor driver support buffering or not.
      *
@@ -286,6 +501,17 @@ public:
      */
     bool hwBuffering();
 
+    /**
+     * Read every property of the sensor and of this session in one call,
+     * see AbstractSensorChannelAdaptor::status() of sensord. Ranges are
+     * returned as DataRangeList, DataRange and IntegerRangeList values.
+     * Metadata read through the status is cached like when read one by
+     * one.
+     *
+     * @return properties by name, empty if the call failed.
+     */
+    QVariantMap status();
+
     /**
      * Does the current instance have valid connection established
      * to sensor daemon.
@@ -294,6 +520,40 @@ public:
      */
     bool isValid() const;
 
+    /**
+     * Deliver samples waiting in the shared memory ring. Needed only when
+     * shared memory transport without doorbell is in use
+     * (SENSORFW_TRANSPORT=shm-poll) as then nothing is written to the
+     * data socket.
+     *
+     * @return were any samples delivered.
+     */
+    bool poll();
+
+    /**
+     * File descriptor of the data connection, for integrating the sensor
+     * into an external poll or epoll loop together with drain(). It
+     * becomes readable when samples arrive, except with shared memory
+     * transport without doorbell. With multiplexed transport
+     * (SENSORFW_TRANSPORT=mux) the descriptor is shared by all sessions
+     * of the thread.
+     *
+     * @return socket descriptor, -1 if not connected.
+     */
+    int socketDescriptor();
+
+    /**
+     * Copy received samples into given buffer without blocking and without
+     * a Qt event loop. Samples drained this way are not emitted as signals.
+     *
+     * @param buffer Location for at most \a max samples.
+     * @param sampleSize Size of the samples sent by sensord for this
+     *                   sensor, e.g. sizeof(TimedXyzData).
+     * @param max Maximum number of samples.
+     * @return number of samples copied.
+     */
+    unsigned int drain(void* buffer, unsigned int sampleSize, unsigned int max);
+
 private:
     /**
      * Set error information.
@@ -317,6 +577,18 @@ private Q_SLOTS: // METHODS
 
     void displayStateChanged(bool displayState);
 
+    /**
+     * Drop cached metadata of the sensor when sensord reports changes.
+     *
+     * @param changes changed properties and their values.
+     */
+    void propertiesChanged(const QVariantMap& changes);
+
+    /**
+     * Deliver the client side batch when its latency has been reached.
+     */
+    void batchTimeout();
+
     /**
      * Set interval to session.
      *
@@ -362,6 +634,46 @@ private Q_SLOTS: // METHODS
      */
     QDBusReply<void> setDownsampling(int sessionId, bool value);
 
+    /**
+     * Set change threshold to session.
+     *
+     * @param sessionId session ID.
+     * @param value change threshold.
+     * @return DBus reply.
+     */
+    QDBusReply<void> setChangeThreshold(int sessionId, unsigned int value);
+
+    /**
+     * Set motion threshold to session.
+     *
+     * @param sessionId session ID.
+     * @param threshold delta magnitude threshold.
+     * @param duration minimum duration in milliseconds.
+     * @return DBus reply.
+     */
+    QDBusReply<void> setMotionThreshold(int sessionId, unsigned int threshold, unsigned int duration);
+
+    /**
+     * Set frame pacing to session.
+     *
+     * @param sessionId session ID.
+     * @param period frame period in microseconds.
+     * @param phase vsync time modulo period in microseconds.
+     * @param lead delivery time before vsync in microseconds.
+     * @param extrapolate predict samples to vsync time.
+     * @return DBus reply.
+     */
+    QDBusReply<void> setFramePacing(int sessionId, unsigned int period, unsigned int phase, unsigned int lead, bool extrapolate);
+
+    /**
+     * Set overload priority to session.
+     *
+     * @param sessionId session ID.
+     * @param priority session priority.
+     * @return DBus reply.
+     */
+    QDBusReply<void> setPriority(int sessionId, int priority);
+
     /**
      * Start sensor for session.
      *
@@ -370,6 +682,19 @@ private Q_SLOTS: // METHODS
      */
     QDBusReply<void> start(int sessionId);
 
+    /**
+     * Arguments for starting and configuring session in one call.
+     *
+     * @param sessionId session ID.
+     * @return arguments of configureAndStart.
+     */
+    QList<QVariant> startArguments(int sessionId) const;
+
+    /**
+     * Mark session started by SensorManagerInterface::startInterfaces().
+     */
+    void setStarted();
+
     /**
      * Stop sensor for session.
      *
@@ -411,6 +736,17 @@ protected:
     template<typename T>
     bool read(QVector<T>& values);
 
+    /**
+     * Read next frame from socket without copying it.
+     *
+     * @tparam Type of the objects in the frame.
+     * @param values Set to the objects, valid until next read.
+     * @param count Set to the number of objects.
+     * @return was a frame read.
+     */
+    template<typename T>
+    bool readFrame(const T*& values, unsigned int& count);
+
     /**
      * Callback for subclasses in which they must read their expected data
      * from socket.
@@ -419,6 +755,28 @@ protected:
      */
     virtual bool dataReceivedImpl() = 0;
 
+    /**
+     * Is client side batching enabled.
+     *
+     * @return is batching enabled.
+     */
+    bool batching() const;
+
+    /**
+     * Tell that samples are waiting in the client side batch of the
+     * subclass. Starts the latency timer for the first sample.
+     *
+     * @param pending number of samples in the batch.
+     * @return should the batch be delivered now with flushBatch().
+     */
+    bool batchPending(unsigned int pending);
+
+    /**
+     * Deliver samples in the client side batch. Called when the batch is
+     * full, its latency is reached or the sensor is stopped.
+     */
+    virtual void flushBatch();
+
     /**
      * Utility for calling DBus methods from current connection which
      * return value and take no args.
@@ -430,6 +788,36 @@ protected:
     template<typename T>
     T getAccessor(const char* name);
 
+    /**
+     * Like getAccessor() for properties which do not change while the
+     * sensor exists. The value is fetched once and shared by all
+     * interfaces of the sensor in the process, until sensord signals a
+     * property change or the last interface of the sensor is destroyed.
+     *
+     * @tparam return type.
+     * @param name method name.
+     * @return called method return value.
+     */
+    template<typename T>
+    T getCachedAccessor(const char* name);
+
+    /**
+     * Look up cached metadata of the sensor.
+     *
+     * @param name method name.
+     * @param value set to the cached value if found.
+     * @return was the value cached.
+     */
+    bool cachedMetadata(const char* name, QVariant& value) const;
+
+    /**
+     * Store metadata of the sensor into the cache.
+     *
+     * @param name method name.
+     * @param value value returned by the method.
+     */
+    void cacheMetadata(const char* name, const QVariant& value);
+
     /**
      * Utility for calling DBus methods from current connection which
      * return nothing and take one arg.
@@ -484,6 +872,12 @@ bool AbstractSensorChannelInterface::read(QVector<T>& values)
     return getSocketReader().read(values);
 }
 
+template<typename T>
+bool AbstractSensorChannelInterface::readFrame(const T*& values, unsigned int& count)
+{
+    return getSocketReader().readFrame(values, count);
+}
+
 template<typename T>
 T AbstractSensorChannelInterface::getAccessor(const char* name)
 {
@@ -496,6 +890,22 @@ T AbstractSensorChannelInterface::getAccessor(const char* name)
     return reply.value();
 }
 
+template<typename T>
+T AbstractSensorChannelInterface::getCachedAccessor(const char* name)
+{
+    QVariant value;
+    if(cachedMetadata(name, value))
+        return value.value<T>();
+    QDBusReply<T> reply(call(QDBus::Block, QLatin1String(name)));
+    if(!reply.isValid())
+    {
+        qDebug() << "Failed to get '" << name << "' from sensord: " << reply.error().message();
+        return T();
+    }
+    cacheMetadata(name, qVariantFromValue(reply.value()));
+    return reply.value();
+}
+
 template<typename T>
 void AbstractSensorChannelInterface::setAccessor(const char* name, const T& value)
 {
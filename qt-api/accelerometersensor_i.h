@@ -97,6 +97,16 @@ public:
      */
     static AccelerometerSensorChannelInterface* interface(const QString& id);
 
+    /**
+     * Set observer receiving frames as AccelerationData without conversion. While
+     * an observer is set dataAvailable and frameAvailable are emitted only
+     * if requested with \a emitSignals.
+     *
+     * @param observer frame observer, or NULL to remove it.
+     * @param emitSignals should signals be emitted as well.
+     */
+    void setFrameObserver(SensorFrameObserver<AccelerationData>* observer, bool emitSignals = false);
+
 protected:
 
 #if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
@@ -106,8 +116,13 @@ protected:
 #endif
 virtual bool dataReceivedImpl();
 
+    virtual void flushBatch();
+
 private:
     bool frameAvailableConnected; /**< has applicaiton connected slot for frameAvailable signal. */
+    SensorFrameObserver<AccelerationData>* frameObserver; /**< raw frame observer or NULL */
+    bool signalsEnabled; /**< are signals emitted while frameObserver is set */
+    QVector<XYZ> batch; /**< samples collected for client side batching */
 
 Q_SIGNALS:
     /**
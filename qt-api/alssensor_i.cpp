@@ -64,12 +64,16 @@ ALSSensorChannelInterface* ALSSensorChannelInterface::interface(const QString& i
 
 bool ALSSensorChannelInterface::dataReceivedImpl()
 {
-    QVector<TimedUnsigned> values;
-    if(!read<TimedUnsigned>(values))
-        return false;
-    foreach(const TimedUnsigned& data, values)
-        emit ALSChanged(data);
-    return true;
+    const TimedUnsigned* values;
+    unsigned int count;
+    bool received = false;
+    while(readFrame<TimedUnsigned>(values, count))
+    {
+        received = true;
+        for(unsigned int i = 0; i < count; ++i)
+            emit ALSChanged(values[i]);
+    }
+    return received;
 }
 
 Unsigned ALSSensorChannelInterface::lux()
@@ -62,12 +62,16 @@ CompassSensorChannelInterface* CompassSensorChannelInterface::interface(const QS
 
 bool CompassSensorChannelInterface::dataReceivedImpl()
 {
-    QVector<CompassData> values;
-    if(!read<CompassData>(values))
-        return false;
-    foreach(const CompassData& data, values)
-        emit dataAvailable(Compass(data, useDeclination_));
-    return true;
+    const CompassData* values;
+    unsigned int count;
+    bool received = false;
+    while(readFrame<CompassData>(values, count))
+    {
+        received = true;
+        for(unsigned int i = 0; i < count; ++i)
+            emit dataAvailable(Compass(values[i], useDeclination_));
+    }
+    return received;
 }
 
 Compass CompassSensorChannelInterface::get()
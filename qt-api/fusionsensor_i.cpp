@@ -0,0 +1,108 @@
+/**
+   @file fusionsensor_i.cpp
+   @brief Interface for FusionSensor
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "sensormanagerinterface.h"
+#include "fusionsensor_i.h"
+
+const char* FusionSensorChannelInterface::staticInterfaceName = "local.FusionSensor";
+
+AbstractSensorChannelInterface* FusionSensorChannelInterface::factoryMethod(const QString& id, int sessionId)
+{
+    return new FusionSensorChannelInterface(OBJECT_PATH + "/" + id, sessionId);
+}
+
+FusionSensorChannelInterface::FusionSensorChannelInterface(const QString &path, int sessionId)
+    : AbstractSensorChannelInterface(path, FusionSensorChannelInterface::staticInterfaceName, sessionId),
+      frameAvailableConnected(false),
+      frameObserver(0),
+      signalsEnabled(true)
+{
+}
+
+FusionSensorChannelInterface* FusionSensorChannelInterface::interface(const QString& id)
+{
+    SensorManagerInterface& sm = SensorManagerInterface::instance();
+    if ( !sm.registeredAndCorrectClassName( id, FusionSensorChannelInterface::staticMetaObject.className() ) )
+    {
+        return 0;
+    }
+
+    return dynamic_cast<FusionSensorChannelInterface*>(sm.interface(id));
+}
+
+bool FusionSensorChannelInterface::hasGyroscope()
+{
+    return getCachedAccessor<bool>("hasGyroscope");
+}
+
+bool FusionSensorChannelInterface::hasMagnetometer()
+{
+    return getCachedAccessor<bool>("hasMagnetometer");
+}
+
+bool FusionSensorChannelInterface::dataReceivedImpl()
+{
+    const FusionData* values;
+    unsigned int count;
+    bool received = false;
+    while(readFrame<FusionData>(values, count))
+    {
+        received = true;
+        if(frameObserver)
+            frameObserver->frameReceived(values, count);
+        if(!signalsEnabled)
+            continue;
+        if(!frameAvailableConnected || count == 1)
+        {
+            for(unsigned int i = 0; i < count; ++i)
+                emit dataAvailable(values[i]);
+        }
+        else
+        {
+            QVector<FusionData> frame(count);
+            memcpy(frame.data(), values, count * sizeof(FusionData));
+            emit frameAvailable(frame);
+        }
+    }
+    return received;
+}
+
+void FusionSensorChannelInterface::setFrameObserver(SensorFrameObserver<FusionData>* observer, bool emitSignals)
+{
+    frameObserver = observer;
+    signalsEnabled = !observer || emitSignals;
+}
+
+#if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
+void FusionSensorChannelInterface::connectNotify(const char* signal)
+#else
+void FusionSensorChannelInterface::connectNotify(const QMetaMethod &signal)
+#endif
+{
+#if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
+    if(QLatin1String(signal) == SIGNAL(frameAvailable(QVector<FusionData>)))
+#else
+    static const QMetaMethod frameAvailableSignal = QMetaMethod::fromSignal(&FusionSensorChannelInterface::frameAvailable);
+    if(signal == frameAvailableSignal)
+#endif
+        frameAvailableConnected = true;
+    dbusConnectNotify(signal);
+}
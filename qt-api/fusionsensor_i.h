@@ -0,0 +1,133 @@
+/**
+   @file fusionsensor_i.h
+   @brief Interface for FusionSensor
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef FUSIONSENSOR_I_H
+#define FUSIONSENSOR_I_H
+
+#include <QtDBus/QtDBus>
+#include <QVector>
+
+#include "abstractsensor_i.h"
+#include <datatypes/fusiondata.h>
+
+/**
+ * Client interface for accessing synchronized accelerometer, gyroscope
+ * and magnetometer samples. Each sample carries all three vectors aligned
+ * to the accelerometer timestamp.
+ */
+class FusionSensorChannelInterface : public AbstractSensorChannelInterface
+{
+    Q_OBJECT;
+    Q_DISABLE_COPY(FusionSensorChannelInterface)
+    Q_PROPERTY(bool hasGyroscope READ hasGyroscope)
+    Q_PROPERTY(bool hasMagnetometer READ hasMagnetometer)
+
+public:
+    /**
+     * Name of the D-Bus interface for this class.
+     */
+    static const char* staticInterfaceName;
+
+    /**
+     * Create new instance of the class.
+     *
+     * @param id Sensor ID.
+     * @param sessionId Session ID.
+     * @return Pointer to new instance of the class.
+     */
+    static AbstractSensorChannelInterface* factoryMethod(const QString& id, int sessionId);
+
+    /**
+     * Constructor.
+     *
+     * @param path      path.
+     * @param sessionId session id.
+     */
+    FusionSensorChannelInterface(const QString &path, int sessionId);
+
+    /**
+     * Request an interface to the sensor.
+     *
+     * @param id sensor ID.
+     * @return Pointer to interface, or NULL on failure.
+     */
+    static FusionSensorChannelInterface* interface(const QString& id);
+
+    /**
+     * Is gyroscope available. Without it gyroscope vectors are zero.
+     *
+     * @return is gyroscope available.
+     */
+    bool hasGyroscope();
+
+    /**
+     * Is magnetometer available. Without it magnetometer vectors are zero.
+     *
+     * @return is magnetometer available.
+     */
+    bool hasMagnetometer();
+
+    /**
+     * Set observer receiving frames without copying. While an observer
+     * is set dataAvailable and frameAvailable are emitted only if
+     * requested with \a emitSignals.
+     *
+     * @param observer frame observer, or NULL to remove it.
+     * @param emitSignals should signals be emitted as well.
+     */
+    void setFrameObserver(SensorFrameObserver<FusionData>* observer, bool emitSignals = false);
+
+protected:
+#if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
+    virtual void connectNotify(const char* signal);
+#else
+    virtual void connectNotify(const QMetaMethod & signal);
+#endif
+    virtual bool dataReceivedImpl();
+
+private:
+    bool frameAvailableConnected; /**< has applicaiton connected slot for frameAvailable signal. */
+    SensorFrameObserver<FusionData>* frameObserver; /**< raw frame observer or NULL */
+    bool signalsEnabled; /**< are signals emitted while frameObserver is set */
+
+Q_SIGNALS:
+    /**
+     * Sent when new synchronized sample has become available.
+     *
+     * @param data New sample.
+     */
+    void dataAvailable(const FusionData& data);
+
+    /**
+     * Sent when new measurement frame has become available.
+     * If app doesn't connect to this signal content of frames
+     * will be sent through dataAvailable signal.
+     *
+     * @param frame New measurement frame.
+     */
+    void frameAvailable(const QVector<FusionData>& frame);
+};
+
+namespace local {
+  typedef ::FusionSensorChannelInterface FusionSensor;
+}
+
+#endif
@@ -39,7 +39,9 @@ AbstractSensorChannelInterface* GyroscopeSensorChannelInterface::factoryMethod(c
 
 GyroscopeSensorChannelInterface::GyroscopeSensorChannelInterface(const QString &path, int sessionId)
     : AbstractSensorChannelInterface(path, GyroscopeSensorChannelInterface::staticInterfaceName, sessionId),
-      frameAvailableConnected(false)
+      frameAvailableConnected(false),
+      frameObserver(0),
+      signalsEnabled(true)
 {
 }
 
@@ -67,23 +69,58 @@ GyroscopeSensorChannelInterface* GyroscopeSensorChannelInterface::interface(cons
 
 bool GyroscopeSensorChannelInterface::dataReceivedImpl()
 {
-    QVector<TimedXyzData> values;
-    if(!read<TimedXyzData>(values))
-        return false;
-    if(!frameAvailableConnected || values.size() == 1)
+    const TimedXyzData* values;
+    unsigned int count;
+    bool received = false;
+    while(readFrame<TimedXyzData>(values, count))
     {
-        foreach(const TimedXyzData& data, values)
-            emit dataAvailable(XYZ(data));
+        received = true;
+        if(frameObserver)
+            frameObserver->frameReceived(values, count);
+        if(!signalsEnabled)
+            continue;
+        if(batching())
+        {
+            for(unsigned int i = 0; i < count; ++i)
+                batch.push_back(XYZ(values[i]));
+            if(batchPending(batch.size()))
+                flushBatch();
+            continue;
+        }
+        if(!frameAvailableConnected || count == 1)
+        {
+            for(unsigned int i = 0; i < count; ++i)
+                emit dataAvailable(XYZ(values[i]));
+        }
+        else
+        {
+            QVector<XYZ> realValues;
+            realValues.reserve(count);
+            for(unsigned int i = 0; i < count; ++i)
+                realValues.push_back(XYZ(values[i]));
+            emit frameAvailable(realValues);
+        }
     }
+    return received;
+}
+
+void GyroscopeSensorChannelInterface::flushBatch()
+{
+    if(batch.isEmpty())
+        return;
+    QVector<XYZ> frame;
+    frame.swap(batch);
+    if(frameAvailableConnected && frame.size() > 1)
+        emit frameAvailable(frame);
     else
-    {
-        QVector<XYZ> realValues;
-        realValues.reserve(values.size());
-        foreach(const TimedXyzData& data, values)
-            realValues.push_back(XYZ(data));
-        emit frameAvailable(realValues);
-    }
-    return true;
+        foreach(const XYZ& data, frame)
+            emit dataAvailable(data);
+}
+
+void GyroscopeSensorChannelInterface::setFrameObserver(SensorFrameObserver<TimedXyzData>* observer, bool emitSignals)
+{
+    frameObserver = observer;
+    signalsEnabled = !observer || emitSignals;
 }
 
 #if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
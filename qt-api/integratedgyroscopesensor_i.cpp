@@ -0,0 +1,61 @@
+/**
+   @file integratedgyroscopesensor_i.cpp
+   @brief Interface for IntegratedGyroscopeSensor
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+
+#include "sensormanagerinterface.h"
+#include "integratedgyroscopesensor_i.h"
+
+const char* IntegratedGyroscopeSensorChannelInterface::staticInterfaceName = "local.IntegratedGyroscopeSensor";
+
+AbstractSensorChannelInterface* IntegratedGyroscopeSensorChannelInterface::factoryMethod(const QString& id, int sessionId)
+{
+    return new IntegratedGyroscopeSensorChannelInterface(OBJECT_PATH + "/" + id, sessionId);
+}
+
+IntegratedGyroscopeSensorChannelInterface::IntegratedGyroscopeSensorChannelInterface(const QString &path, int sessionId)
+    : AbstractSensorChannelInterface(path, IntegratedGyroscopeSensorChannelInterface::staticInterfaceName, sessionId)
+{
+}
+
+IntegratedGyroscopeSensorChannelInterface* IntegratedGyroscopeSensorChannelInterface::interface(const QString& id)
+{
+    SensorManagerInterface& sm = SensorManagerInterface::instance();
+    if ( !sm.registeredAndCorrectClassName( id, IntegratedGyroscopeSensorChannelInterface::staticMetaObject.className() ) )
+    {
+        return 0;
+    }
+
+    return dynamic_cast<IntegratedGyroscopeSensorChannelInterface*>(sm.interface(id));
+}
+
+bool IntegratedGyroscopeSensorChannelInterface::dataReceivedImpl()
+{
+    const RotationDeltaData* values;
+    unsigned int count;
+    bool received = false;
+    while(readFrame<RotationDeltaData>(values, count))
+    {
+        received = true;
+        for(unsigned int i = 0; i < count; ++i)
+            emit dataAvailable(values[i]);
+    }
+    return received;
+}
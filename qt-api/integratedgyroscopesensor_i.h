@@ -0,0 +1,88 @@
+/**
+   @file integratedgyroscopesensor_i.h
+   @brief Interface for IntegratedGyroscopeSensor
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+
+#ifndef INTEGRATEDGYROSCOPESENSOR_I_H
+#define INTEGRATEDGYROSCOPESENSOR_I_H
+
+#include <QtDBus/QtDBus>
+
+#include "abstractsensor_i.h"
+#include <datatypes/rotationdeltadata.h>
+
+/**
+ * Client interface for accessing rotation accumulated from gyroscope
+ * samples (integratedgyroscopesensor). One delta is received per interval,
+ * while sensord integrates the gyroscope at its own rate.
+ */
+class IntegratedGyroscopeSensorChannelInterface : public AbstractSensorChannelInterface
+{
+    Q_OBJECT;
+    Q_DISABLE_COPY(IntegratedGyroscopeSensorChannelInterface)
+
+public:
+    /**
+     * Name of the D-Bus interface for this class.
+     */
+    static const char* staticInterfaceName;
+
+    /**
+     * Create new instance of the class.
+     *
+     * @param id Sensor ID.
+     * @param sessionId Session ID.
+     * @return Pointer to new instance of the class.
+     */
+    static AbstractSensorChannelInterface* factoryMethod(const QString& id, int sessionId);
+
+    /**
+     * Constructor.
+     *
+     * @param path      path.
+     * @param sessionId session id.
+     */
+    IntegratedGyroscopeSensorChannelInterface(const QString &path, int sessionId);
+
+    /**
+     * Request an interface to the sensor.
+     *
+     * @param id sensor ID.
+     * @return Pointer to interface, or NULL on failure.
+     */
+    static IntegratedGyroscopeSensorChannelInterface* interface(const QString& id);
+
+protected:
+    virtual bool dataReceivedImpl();
+
+Q_SIGNALS:
+    /**
+     * Sent when rotation of an interval has become available.
+     *
+     * @param data rotation since the previous delta.
+     */
+    void dataAvailable(const RotationDeltaData& data);
+};
+
+namespace local {
+  typedef ::IntegratedGyroscopeSensorChannelInterface IntegratedGyroscopeSensor;
+}
+
+#endif
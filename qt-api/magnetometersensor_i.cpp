@@ -37,7 +37,9 @@ AbstractSensorChannelInterface* MagnetometerSensorChannelInterface::factoryMetho
 
 MagnetometerSensorChannelInterface::MagnetometerSensorChannelInterface(const QString& path, int sessionId) :
     AbstractSensorChannelInterface(path, MagnetometerSensorChannelInterface::staticInterfaceName, sessionId),
-    frameAvailableConnected(false)
+    frameAvailableConnected(false),
+    frameObserver(0),
+    signalsEnabled(true)
 {
 }
 
@@ -64,23 +66,58 @@ MagnetometerSensorChannelInterface* MagnetometerSensorChannelInterface::interfac
 
 bool MagnetometerSensorChannelInterface::dataReceivedImpl()
 {
-    QVector<CalibratedMagneticFieldData> values;
-    if(!read<CalibratedMagneticFieldData>(values))
-        return false;
-    if(!frameAvailableConnected || values.size() == 1)
+    const CalibratedMagneticFieldData* values;
+    unsigned int count;
+    bool received = false;
+    while(readFrame<CalibratedMagneticFieldData>(values, count))
     {
-        foreach(const CalibratedMagneticFieldData& data, values)
-            emit dataAvailable(MagneticField(data));
+        received = true;
+        if(frameObserver)
+            frameObserver->frameReceived(values, count);
+        if(!signalsEnabled)
+            continue;
+        if(batching())
+        {
+            for(unsigned int i = 0; i < count; ++i)
+                batch.push_back(MagneticField(values[i]));
+            if(batchPending(batch.size()))
+                flushBatch();
+            continue;
+        }
+        if(!frameAvailableConnected || count == 1)
+        {
+            for(unsigned int i = 0; i < count; ++i)
+                emit dataAvailable(MagneticField(values[i]));
+        }
+        else
+        {
+            QVector<MagneticField> realValues;
+            realValues.reserve(count);
+            for(unsigned int i = 0; i < count; ++i)
+                realValues.push_back(MagneticField(values[i]));
+            emit frameAvailable(realValues);
+        }
     }
+    return received;
+}
+
+void MagnetometerSensorChannelInterface::flushBatch()
+{
+    if(batch.isEmpty())
+        return;
+    QVector<MagneticField> frame;
+    frame.swap(batch);
+    if(frameAvailableConnected && frame.size() > 1)
+        emit frameAvailable(frame);
     else
-    {
-        QVector<MagneticField> realValues;
-        realValues.reserve(values.size());
-        foreach(const CalibratedMagneticFieldData& data, values)
-            realValues.push_back(MagneticField(data));
-        emit frameAvailable(realValues);
-    }
-    return true;
+        foreach(const MagneticField& data, frame)
+            emit dataAvailable(data);
+}
+
+void MagnetometerSensorChannelInterface::setFrameObserver(SensorFrameObserver<CalibratedMagneticFieldData>* observer, bool emitSignals)
+{
+    frameObserver = observer;
+    signalsEnabled = !observer || emitSignals;
 }
 
 #if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
@@ -99,6 +99,16 @@ public:
      */
     static MagnetometerSensorChannelInterface* interface(const QString& id);
 
+    /**
+     * Set observer receiving frames as CalibratedMagneticFieldData without
+     * conversion. While an observer is set dataAvailable and frameAvailable
+     * are emitted only if requested with \a emitSignals.
+     *
+     * @param observer frame observer, or NULL to remove it.
+     * @param emitSignals should signals be emitted as well.
+     */
+    void setFrameObserver(SensorFrameObserver<CalibratedMagneticFieldData>* observer, bool emitSignals = false);
+
 protected:
 #if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
     virtual void connectNotify(const char* signal);
@@ -107,8 +117,13 @@ protected:
 #endif
     virtual bool dataReceivedImpl();
 
+    virtual void flushBatch();
+
 private:
     bool frameAvailableConnected; /**< has applicaiton connected slot for frameAvailable signal. */
+    SensorFrameObserver<CalibratedMagneticFieldData>* frameObserver; /**< raw frame observer or NULL */
+    bool signalsEnabled; /**< are signals emitted while frameObserver is set */
+    QVector<MagneticField> batch; /**< samples collected for client side batching */
 
 public Q_SLOTS:
     /**
@@ -0,0 +1,165 @@
+/**
+   @file multiplexedconnection.cpp
+   @brief Data connection shared by sessions of a client
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "multiplexedconnection.h"
+#include "socketreader.h"
+#include <QDebug>
+#include <QHash>
+#include <QMutex>
+#include <QThread>
+#include <QTimer>
+#include <string.h>
+
+/** Connections of threads */
+static QHash<QThread*, MultiplexedConnection*> connections;
+static QMutex connectionsMutex;
+
+MultiplexedConnection* MultiplexedConnection::instance()
+{
+    QMutexLocker locker(&connectionsMutex);
+    return connections.value(QThread::currentThread(), 0);
+}
+
+MultiplexedConnection::MultiplexedConnection(QLocalSocket* socket, int sessionId, SocketReader* reader) :
+    socket_(socket),
+    used_(0)
+{
+    socket_->setParent(this);
+    readers_.insert(sessionId, reader);
+    connect(socket_, SIGNAL(readyRead()), this, SLOT(socketReadable()));
+
+    QMutexLocker locker(&connectionsMutex);
+    if (!connections.contains(thread()))
+        connections.insert(thread(), this);
+}
+
+MultiplexedConnection::~MultiplexedConnection()
+{
+    {
+        QMutexLocker locker(&connectionsMutex);
+        if (connections.value(thread()) == this)
+            connections.remove(thread());
+    }
+    socket_->disconnectFromServer();
+    if (socket_->state() != QLocalSocket::UnconnectedState)
+        socket_->waitForDisconnected();
+}
+
+bool MultiplexedConnection::join(int sessionId, SocketReader* reader)
+{
+    if (readers_.contains(sessionId) || !socket_->isValid())
+        return false;
+
+    int request[2] = { sessionId, MultiplexedTransport };
+    if (socket_->write((const char*)request, sizeof(request)) != sizeof(request)) {
+        qDebug() << "[MULTIPLEXEDCONNECTION]: Registration write failed: " << socket_->errorString();
+        return false;
+    }
+    socket_->flush();
+    readers_.insert(sessionId, reader);
+    return true;
+}
+
+void MultiplexedConnection::leave(int sessionId)
+{
+    readers_.remove(sessionId);
+    pending_.remove(sessionId);
+    if (!readers_.isEmpty())
+        return;
+
+    // Readers may leave while being notified
+    {
+        QMutexLocker locker(&connectionsMutex);
+        if (connections.value(thread()) == this)
+            connections.remove(thread());
+    }
+    deleteLater();
+}
+
+void MultiplexedConnection::poll(SocketReader* reader)
+{
+    if (socket_->bytesAvailable() <= 0) {
+        bool blocked = socket_->blockSignals(true);
+        socket_->waitForReadyRead(0);
+        socket_->blockSignals(blocked);
+    }
+    receive();
+    pending_.remove(readers_.key(reader, -1));
+    if (!pending_.isEmpty())
+        QTimer::singleShot(0, this, SLOT(notify()));
+}
+
+QLocalSocket* MultiplexedConnection::socket()
+{
+    return socket_;
+}
+
+void MultiplexedConnection::socketReadable()
+{
+    receive();
+    notify();
+}
+
+void MultiplexedConnection::notify()
+{
+    QSet<int> sessions = pending_;
+    pending_.clear();
+    foreach (int sessionId, sessions) {
+        // Handlers may make readers leave
+        SocketReader* reader = readers_.value(sessionId, 0);
+        if (reader)
+            reader->notify();
+    }
+}
+
+void MultiplexedConnection::receive()
+{
+    qint64 available = socket_->bytesAvailable();
+    if (available <= 0)
+        return;
+    if (used_ + available > buffer_.size())
+        buffer_.resize(used_ + available);
+    qint64 bytes = socket_->read(buffer_.data() + used_, available);
+    if (bytes > 0)
+        used_ += bytes;
+
+    int begin = 0;
+    MultiplexedFrameHeader header;
+    while (used_ - begin >= (int)sizeof(header)) {
+        memcpy(&header, buffer_.constData() + begin, sizeof(header));
+        if (header.length > MAX_FRAME_BYTES) {
+            qWarning() << "Too long frame in multiplexed socket. Flushing it to empty";
+            begin = used_;
+            break;
+        }
+        int frameSize = sizeof(header) + header.length;
+        if (used_ - begin < frameSize)
+            break;
+        SocketReader* reader = readers_.value(header.sessionId, 0);
+        if (reader) {
+            reader->receive(buffer_.constData() + begin + sizeof(header), header.length);
+            pending_.insert(header.sessionId);
+        }
+        begin += frameSize;
+    }
+    used_ -= begin;
+    memmove(buffer_.data(), buffer_.constData() + begin, used_);
+}
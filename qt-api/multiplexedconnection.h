@@ -0,0 +1,130 @@
+/**
+   @file multiplexedconnection.h
+   @brief Data connection shared by sessions of a client
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef MULTIPLEXEDCONNECTION_H
+#define MULTIPLEXEDCONNECTION_H
+
+#include <QObject>
+#include <QLocalSocket>
+#include <QByteArray>
+#include <QMap>
+#include <QSet>
+
+class SocketReader;
+
+/**
+ * Single data socket carrying frames of several sessions. Frames are
+ * preceded by MultiplexedFrameHeader and handed to the SocketReader of
+ * their session, which parses them as if they were read from a socket of
+ * its own.
+ *
+ * Sessions created in the same thread share one connection. The
+ * connection is closed when its last session leaves.
+ */
+class MultiplexedConnection : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(MultiplexedConnection)
+
+public:
+    /**
+     * Connection of the calling thread.
+     *
+     * @return connection or NULL if the thread has none.
+     */
+    static MultiplexedConnection* instance();
+
+    /**
+     * Constructor. Takes over a connection accepted by sensord for its
+     * first session and makes it the connection of the calling thread.
+     *
+     * @param socket connected socket. Ownership is transferred.
+     * @param sessionId ID of the first session.
+     * @param reader reader of the first session.
+     */
+    MultiplexedConnection(QLocalSocket* socket, int sessionId, SocketReader* reader);
+
+    /**
+     * Destructor. Closes the connection.
+     */
+    ~MultiplexedConnection();
+
+    /**
+     * Register another session on the connection.
+     *
+     * @param sessionId Session ID.
+     * @param reader reader of the session.
+     * @return was the registration written.
+     */
+    bool join(int sessionId, SocketReader* reader);
+
+    /**
+     * Stop delivering frames of a session. Connection is deleted later
+     * when no session is left.
+     *
+     * @param sessionId Session ID.
+     */
+    void leave(int sessionId);
+
+    /**
+     * Hand frames waiting in the socket to their readers without a Qt
+     * event loop. Other readers are notified from the event loop later.
+     *
+     * @param reader reader not to be notified.
+     */
+    void poll(SocketReader* reader);
+
+    /**
+     * Shared socket.
+     *
+     * @return socket.
+     */
+    QLocalSocket* socket();
+
+private slots:
+    /**
+     * Callback for new data in socket.
+     */
+    void socketReadable();
+
+    /**
+     * Emit readyRead() of readers which have received frames.
+     */
+    void notify();
+
+private:
+    /**
+     * Move bytes available in the socket to the readers of complete
+     * frames.
+     */
+    void receive();
+
+    /** Longer frames are treated as stream corruption. */
+    static const unsigned int MAX_FRAME_BYTES = 65536;
+
+    QLocalSocket*               socket_;  /**< shared data connection */
+    QMap<int, SocketReader*>    readers_; /**< readers of sessions */
+    QSet<int>                   pending_; /**< sessions with frames not notified */
+    QByteArray                  buffer_;  /**< received bytes, size is its capacity */
+    int                         used_;    /**< bytes in buffer_ */
+};
+
+#endif // MULTIPLEXEDCONNECTION_H
@@ -62,12 +62,16 @@ OrientationSensorChannelInterface* OrientationSensorChannelInterface::interface(
 
 bool OrientationSensorChannelInterface::dataReceivedImpl()
 {
-    QVector<TimedUnsigned> values;
-    if(!read<TimedUnsigned>(values))
-        return false;
-    foreach(const TimedUnsigned& data, values)
-        emit orientationChanged(data);
-    return true;
+    const TimedUnsigned* values;
+    unsigned int count;
+    bool received = false;
+    while(readFrame<TimedUnsigned>(values, count))
+    {
+        received = true;
+        for(unsigned int i = 0; i < count; ++i)
+            emit orientationChanged(values[i]);
+    }
+    return received;
 }
 
 Unsigned OrientationSensorChannelInterface::orientation()
@@ -63,16 +63,20 @@ ProximitySensorChannelInterface* ProximitySensorChannelInterface::interface(cons
 
 bool ProximitySensorChannelInterface::dataReceivedImpl()
 {
-    QVector<ProximityData> values;
-    if(!read<ProximityData>(values))
-        return false;
-    foreach(const ProximityData& data, values)
+    const ProximityData* values;
+    unsigned int count;
+    bool received = false;
+    while(readFrame<ProximityData>(values, count))
     {
-        Proximity proximity(data);
-        emit dataAvailable(proximity);
-        emit reflectanceDataAvailable(proximity);
+        received = true;
+        for(unsigned int i = 0; i < count; ++i)
+        {
+            Proximity proximity(values[i]);
+            emit dataAvailable(proximity);
+            emit reflectanceDataAvailable(proximity);
+        }
     }
-    return true;
+    return received;
 }
 
 Unsigned ProximitySensorChannelInterface::proximity()
@@ -9,6 +9,9 @@ SOURCES += sensormanagerinterface.cpp \
     sensormanager_i.cpp \
     abstractsensor_i.cpp \
     socketreader.cpp \
+    multiplexedconnection.cpp \
+    socketreceiver.cpp \
+    samplepredictor.cpp \
     compasssensor_i.cpp \
     orientationsensor_i.cpp \
     accelerometersensor_i.cpp \
@@ -17,12 +20,18 @@ SOURCES += sensormanagerinterface.cpp \
     proximitysensor_i.cpp \
     rotationsensor_i.cpp \
     magnetometersensor_i.cpp \
-    gyroscopesensor_i.cpp
+    gyroscopesensor_i.cpp \
+    fusionsensor_i.cpp \
+    statisticssensor_i.cpp \
+    integratedgyroscopesensor_i.cpp
 
 HEADERS += sensormanagerinterface.h \
     sensormanager_i.h \
     abstractsensor_i.h \
     socketreader.h \
+    multiplexedconnection.h \
+    socketreceiver.h \
+    samplepredictor.h \
     compasssensor_i.h \
     orientationsensor_i.h \
     accelerometersensor_i.h \
@@ -31,7 +40,10 @@ HEADERS += sensormanagerinterface.h \
     proximitysensor_i.h \
     rotationsensor_i.h \
     magnetometersensor_i.h \
-    gyroscopesensor_i.h
+    gyroscopesensor_i.h \
+    fusionsensor_i.h \
+    statisticssensor_i.h \
+    integratedgyroscopesensor_i.h
 
 SENSORFW_INCLUDEPATHS = .. \
     ../include \
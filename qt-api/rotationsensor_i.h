@@ -108,6 +108,16 @@ public:
      */
     static RotationSensorChannelInterface* interface(const QString& id);
 
+    /**
+     * Set observer receiving frames as TimedXyzData without conversion. While
+     * an observer is set dataAvailable and frameAvailable are emitted only
+     * if requested with \a emitSignals.
+     *
+     * @param observer frame observer, or NULL to remove it.
+     * @param emitSignals should signals be emitted as well.
+     */
+    void setFrameObserver(SensorFrameObserver<TimedXyzData>* observer, bool emitSignals = false);
+
 protected:
 #if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
     virtual void connectNotify(const char* signal);
@@ -117,8 +127,13 @@ protected:
 
     virtual bool dataReceivedImpl();
 
+    virtual void flushBatch();
+
 private:
     bool frameAvailableConnected; /**< has applicaiton connected slot for frameAvailable signal. */
+    SensorFrameObserver<TimedXyzData>* frameObserver; /**< raw frame observer or NULL */
+    bool signalsEnabled; /**< are signals emitted while frameObserver is set */
+    QVector<XYZ> batch; /**< samples collected for client side batching */
 
 Q_SIGNALS:
     /**
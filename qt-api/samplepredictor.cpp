@@ -0,0 +1,161 @@
+/**
+   @file samplepredictor.cpp
+   @brief Client side prediction of sensor values
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "samplepredictor.h"
+#include <QMutexLocker>
+#include <math.h>
+#include <string.h>
+
+/** Default prediction horizon in microseconds */
+static const quint64 DEFAULT_HORIZON = 100000;
+
+/** Rotations smaller than this, in radians, are not continued */
+static const double MIN_ANGLE = 1e-9;
+
+SamplePredictor::SamplePredictor(Mode mode, int count, QObject* parent) :
+    QObject(parent),
+    mode_(mode),
+    count_(mode == Quaternion ? 4 : qBound(1, count, (int)MAX_VALUES)),
+    horizon_(DEFAULT_HORIZON),
+    samples_(0)
+{
+    time_[0] = time_[1] = 0;
+}
+
+SamplePredictor::Mode SamplePredictor::mode() const
+{
+    return mode_;
+}
+
+int SamplePredictor::valueCount() const
+{
+    return count_;
+}
+
+void SamplePredictor::setHorizon(quint64 horizon)
+{
+    QMutexLocker locker(&mutex_);
+    horizon_ = horizon;
+}
+
+quint64 SamplePredictor::horizon() const
+{
+    QMutexLocker locker(&mutex_);
+    return horizon_;
+}
+
+void SamplePredictor::addSample(quint64 timestamp, const double* values)
+{
+    QMutexLocker locker(&mutex_);
+    if (samples_ && timestamp <= time_[1])
+        return;
+    time_[0] = time_[1];
+    memcpy(values_[0], values_[1], sizeof(values_[0]));
+    time_[1] = timestamp;
+    memcpy(values_[1], values, count_ * sizeof(double));
+    samples_ = qMin(samples_ + 1, 2);
+}
+
+bool SamplePredictor::predict(quint64 timestamp, double* values) const
+{
+    QMutexLocker locker(&mutex_);
+    if (!samples_)
+        return false;
+    if (samples_ == 1) {
+        memcpy(values, values_[1], count_ * sizeof(double));
+        return true;
+    }
+
+    quint64 target = qBound(time_[0], timestamp, time_[1] + horizon_);
+    double factor = ((double)target - (double)time_[1]) / (double)(time_[1] - time_[0]);
+    if (mode_ == Quaternion) {
+        rotate(factor, values);
+        return true;
+    }
+    for (int i = 0; i < count_; ++i)
+        values[i] = values_[1][i] + (values_[1][i] - values_[0][i]) * factor;
+    return true;
+}
+
+void SamplePredictor::rotate(double factor, double* values) const
+{
+    const double* q0 = values_[0];
+    const double* q1 = values_[1];
+
+    // Rotation from the older sample to the latest, d = q1 * conj(q0)
+    double d[4];
+    d[0] =  q1[0] * q0[0] + q1[1] * q0[1] + q1[2] * q0[2] + q1[3] * q0[3];
+    d[1] = -q1[0] * q0[1] + q1[1] * q0[0] - q1[2] * q0[3] + q1[3] * q0[2];
+    d[2] = -q1[0] * q0[2] + q1[1] * q0[3] + q1[2] * q0[0] - q1[3] * q0[1];
+    d[3] = -q1[0] * q0[3] - q1[1] * q0[2] + q1[2] * q0[1] + q1[3] * q0[0];
+    // q and -q are the same rotation, take the shorter way
+    if (d[0] < 0)
+        for (int i = 0; i < 4; ++i)
+            d[i] = -d[i];
+
+    double sine = sqrt(d[1] * d[1] + d[2] * d[2] + d[3] * d[3]);
+    double angle = 2 * atan2(sine, d[0]);
+    if (angle < MIN_ANGLE) {
+        memcpy(values, q1, 4 * sizeof(double));
+        return;
+    }
+
+    // Same axis, angle scaled by the factor, applied to the latest sample
+    double half = angle * factor / 2;
+    double r[4];
+    r[0] = cos(half);
+    for (int i = 1; i < 4; ++i)
+        r[i] = d[i] / sine * sin(half);
+    values[0] = r[0] * q1[0] - r[1] * q1[1] - r[2] * q1[2] - r[3] * q1[3];
+    values[1] = r[0] * q1[1] + r[1] * q1[0] + r[2] * q1[3] - r[3] * q1[2];
+    values[2] = r[0] * q1[2] - r[1] * q1[3] + r[2] * q1[0] + r[3] * q1[1];
+    values[3] = r[0] * q1[3] + r[1] * q1[2] - r[2] * q1[1] + r[3] * q1[0];
+
+    double norm = sqrt(values[0] * values[0] + values[1] * values[1] + values[2] * values[2] + values[3] * values[3]);
+    if (norm > 0)
+        for (int i = 0; i < 4; ++i)
+            values[i] /= norm;
+}
+
+quint64 SamplePredictor::latest() const
+{
+    QMutexLocker locker(&mutex_);
+    return samples_ ? time_[1] : 0;
+}
+
+void SamplePredictor::reset()
+{
+    QMutexLocker locker(&mutex_);
+    samples_ = 0;
+    time_[0] = time_[1] = 0;
+}
+
+void SamplePredictor::addFrame(const QVector<XYZ>& frame)
+{
+    foreach (const XYZ& data, frame)
+        addData(data);
+}
+
+void SamplePredictor::addData(const XYZ& data)
+{
+    double values[MAX_VALUES] = { (double)data.x(), (double)data.y(), (double)data.z() };
+    addSample(data.XYZData().timestamp_, values);
+}
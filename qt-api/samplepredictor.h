@@ -0,0 +1,165 @@
+/**
+   @file samplepredictor.h
+   @brief Client side prediction of sensor values
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef SAMPLEPREDICTOR_H
+#define SAMPLEPREDICTOR_H
+
+#include <QObject>
+#include <QMutex>
+#include <QVector>
+#include <datatypes/xyz.h>
+
+/**
+ * Predicts sensor values at a given time from the latest two samples, so
+ * that a client rendering at display rate can ask sensord for a lower
+ * sample rate and still move smoothly between samples.
+ *
+ * In Linear mode every value is extrapolated along the line through the
+ * two samples. In Quaternion mode the values are a rotation quaternion
+ * w, x, y, z and the rotation between the samples is continued at the
+ * same angular velocity. Predictions are made at most horizon() past the
+ * latest sample, later times get the prediction at the horizon, and not
+ * before the older sample.
+ *
+ * Samples and queries may come from different threads. Connect
+ * frameAvailable or dataAvailable of an XYZ interface to addFrame() or
+ * addData(), or feed other samples with addSample().
+ */
+class SamplePredictor : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(SamplePredictor)
+
+public:
+    /**
+     * Extrapolation of the values.
+     */
+    enum Mode
+    {
+        Linear = 0,    /**< values move linearly */
+        Quaternion     /**< values are a rotation quaternion w, x, y, z */
+    };
+
+    /** Most values in a sample */
+    static const int MAX_VALUES = 16;
+
+    /**
+     * Constructor.
+     *
+     * @param mode extrapolation of the values.
+     * @param count number of values in a sample, 4 in Quaternion mode
+     *        and at most MAX_VALUES.
+     * @param parent parent QObject.
+     */
+    SamplePredictor(Mode mode = Linear, int count = 3, QObject* parent = 0);
+
+    /**
+     * Extrapolation of the values.
+     *
+     * @return mode.
+     */
+    Mode mode() const;
+
+    /**
+     * Number of values in a sample.
+     *
+     * @return value count.
+     */
+    int valueCount() const;
+
+    /**
+     * Set how far past the latest sample values are predicted. Defaults
+     * to 100 ms.
+     *
+     * @param horizon horizon in microseconds.
+     */
+    void setHorizon(quint64 horizon);
+
+    /**
+     * How far past the latest sample values are predicted.
+     *
+     * @return horizon in microseconds.
+     */
+    quint64 horizon() const;
+
+    /**
+     * Add a sample. Samples not newer than the latest one are ignored.
+     *
+     * @param timestamp sample time in microseconds, as in sensord samples.
+     * @param values valueCount() values.
+     */
+    void addSample(quint64 timestamp, const double* values);
+
+    /**
+     * Predict values at given time.
+     *
+     * @param timestamp time in microseconds.
+     * @param values set to valueCount() predicted values.
+     * @return false if no sample has been added.
+     */
+    bool predict(quint64 timestamp, double* values) const;
+
+    /**
+     * Timestamp of the latest sample.
+     *
+     * @return timestamp in microseconds, 0 if there is no sample.
+     */
+    quint64 latest() const;
+
+    /**
+     * Forget the samples, e.g. when the sensor is restarted.
+     */
+    void reset();
+
+public Q_SLOTS:
+    /**
+     * Add the samples of a frame.
+     *
+     * @param frame samples, oldest first.
+     */
+    void addFrame(const QVector<XYZ>& frame);
+
+    /**
+     * Add a sample.
+     *
+     * @param data sample.
+     */
+    void addData(const XYZ& data);
+
+private:
+    /**
+     * Continue the rotation between the two samples.
+     *
+     * @param factor multiple of the sample interval past the latest one.
+     * @param values set to the predicted quaternion.
+     */
+    void rotate(double factor, double* values) const;
+
+    mutable QMutex mutex_;                 /**< guards the samples */
+    Mode           mode_;                  /**< extrapolation of the values */
+    int            count_;                 /**< values in a sample */
+    quint64        horizon_;               /**< prediction horizon, microseconds */
+    int            samples_;               /**< samples held, at most two */
+    quint64        time_[2];               /**< older and latest sample time */
+    double         values_[2][MAX_VALUES]; /**< older and latest sample values */
+};
+
+#endif // SAMPLEPREDICTOR_H
@@ -95,3 +95,42 @@ QDBusReply<bool> LocalSensorManagerInterface::releaseSensor(const QString& id, i
     argumentList << qVariantFromValue(pid);
     return callWithArgumentList(QDBus::Block, QLatin1String("releaseSensor"), argumentList);
 }
+
+QDBusReply<qulonglong> LocalSensorManagerInterface::sessionToken(int sessionId)
+{
+    QList<QVariant> argumentList;
+    argumentList << qVariantFromValue(sessionId);
+    return callWithArgumentList(QDBus::Block, QLatin1String("sessionToken"), argumentList);
+}
+
+QDBusReply<int> LocalSensorManagerInterface::resumeSession(qulonglong token)
+{
+    qint64 pid = QCoreApplication::applicationPid();
+    QList<QVariant> argumentList;
+    argumentList << qVariantFromValue(token) << qVariantFromValue(pid);
+    return callWithArgumentList(QDBus::Block, QLatin1String("resumeSession"), argumentList);
+}
+
+QDBusReply<QList<int> > LocalSensorManagerInterface::openSessions(const QStringList& ids)
+{
+    qint64 pid = QCoreApplication::applicationPid();
+    QList<QVariant> argumentList;
+    argumentList << qVariantFromValue(ids) << qVariantFromValue(pid);
+    return callWithArgumentList(QDBus::Block, QLatin1String("openSessions"), argumentList);
+}
+
+QDBusReply<QList<bool> > LocalSensorManagerInterface::startSessions(const QList<int>& sessionIds, const QList<bool>& standbyOverrides,
+                                                                    const QList<int>& intervals, const QList<uint>& bufferIntervals,
+                                                                    const QList<uint>& bufferSizes, const QList<bool>& downsamplings)
+{
+    QList<QVariant> argumentList;
+    argumentList << qVariantFromValue(sessionIds) << qVariantFromValue(standbyOverrides)
+                 << qVariantFromValue(intervals) << qVariantFromValue(bufferIntervals)
+                 << qVariantFromValue(bufferSizes) << qVariantFromValue(downsamplings);
+    return callWithArgumentList(QDBus::Block, QLatin1String("startSessions"), argumentList);
+}
+
+QDBusReply<QStringList> LocalSensorManagerInterface::capabilities()
+{
+    return call(QDBus::Block, QLatin1String("capabilities"));
+}
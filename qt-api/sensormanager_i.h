@@ -106,6 +106,55 @@ public Q_SLOTS:
      */
     QDBusReply<bool> releaseSensor(const QString& id, int sessionId);
 
+    /**
+     * Query resume token of a session.
+     *
+     * @param sessionId session ID.
+     * @return DBus reply with the token, 0 if the session is not resumable.
+     */
+    QDBusReply<qulonglong> sessionToken(int sessionId);
+
+    /**
+     * Request sensor daemon to resume a session after it has restarted.
+     *
+     * @param token resume token.
+     * @return DBus reply with the session ID.
+     */
+    QDBusReply<int> resumeSession(qulonglong token);
+
+    /**
+     * Request sensor daemon to load plugins of sensors and create a
+     * session for each in one call.
+     *
+     * @param ids sensor IDs.
+     * @return DBus reply with a session ID per sensor, -1 if not granted.
+     */
+    QDBusReply<QList<int> > openSessions(const QStringList& ids);
+
+    /**
+     * Request sensor daemon to start and configure sessions in one call.
+     * Lists are indexed like \a sessionIds.
+     *
+     * @param sessionIds session IDs.
+     * @param standbyOverrides standby override of each session.
+     * @param intervals interval of each session.
+     * @param bufferIntervals buffer interval of each session.
+     * @param bufferSizes buffer size of each session.
+     * @param downsamplings downsampling of each session.
+     * @return DBus reply telling which sessions were started.
+     */
+    QDBusReply<QList<bool> > startSessions(const QList<int>& sessionIds, const QList<bool>& standbyOverrides,
+                                           const QList<int>& intervals, const QList<uint>& bufferIntervals,
+                                           const QList<uint>& bufferSizes, const QList<bool>& downsamplings);
+
+    /**
+     * Query capabilities of sensors seen by the daemon: description,
+     * data ranges, intervals and buffer sizes. Plugins are not loaded.
+     *
+     * @return DBus reply with one line per sensor.
+     */
+    QDBusReply<QStringList> capabilities();
+
 Q_SIGNALS:
 
     /**
@@ -81,6 +81,71 @@ AbstractSensorChannelInterface* SensorManagerInterface::interface(const QString&
     return ifc;
 }
 
+QList<AbstractSensorChannelInterface*> SensorManagerInterface::interfaces(const QStringList& ids)
+{
+    QList<AbstractSensorChannelInterface*> ifcs;
+    SensorManagerInterface& sm = SensorManagerInterface::instance();
+    QDBusReply<QList<int> > reply = sm.openSessions(ids);
+    if (!reply.isValid() || reply.value().size() != ids.size()) {
+        // sensord without openSessions
+        foreach (const QString& id, ids)
+            ifcs.append(sm.loadPlugin(getCleanId(id)).value() ? interface(id) : 0);
+        return ifcs;
+    }
+
+    QList<int> sessions = reply.value();
+    for (int i = 0; i < ids.size(); ++i) {
+        QString cleanId = getCleanId(ids.at(i));
+        AbstractSensorChannelInterface* ifc = 0;
+        if (sessions.at(i) < 0)
+            qDebug() << "Requested sensor id '" << ids.at(i) << "' interface not granted";
+        else if (!sensorInterfaceMap_.contains(cleanId))
+            qDebug() << "Requested sensor id '" << ids.at(i) << "' interface not known";
+        else
+            ifc = sensorInterfaceMap_[cleanId].sensorInterfaceFactory(cleanId, sessions.at(i));
+        // Granted session without interface would be left open
+        if (!ifc && sessions.at(i) >= 0)
+            releaseInterface(cleanId, sessions.at(i));
+        ifcs.append(ifc);
+    }
+    return ifcs;
+}
+
+QList<bool> SensorManagerInterface::startInterfaces(const QList<AbstractSensorChannelInterface*>& interfaces)
+{
+    QList<int> sessionIds;
+    QList<bool> standbyOverrides;
+    QList<int> intervals;
+    QList<uint> bufferIntervals;
+    QList<uint> bufferSizes;
+    QList<bool> downsamplings;
+    foreach (AbstractSensorChannelInterface* ifc, interfaces) {
+        QList<QVariant> arguments(ifc->startArguments(ifc->sessionId()));
+        sessionIds << arguments.at(0).toInt();
+        standbyOverrides << arguments.at(1).toBool();
+        intervals << arguments.at(2).toInt();
+        bufferIntervals << arguments.at(3).toUInt();
+        bufferSizes << arguments.at(4).toUInt();
+        downsamplings << arguments.at(5).toBool();
+    }
+
+    QList<bool> started;
+    QDBusReply<QList<bool> > reply = SensorManagerInterface::instance().startSessions(sessionIds, standbyOverrides, intervals,
+                                                                                     bufferIntervals, bufferSizes, downsamplings);
+    if (!reply.isValid() || reply.value().size() != interfaces.size()) {
+        // sensord without startSessions
+        foreach (AbstractSensorChannelInterface* ifc, interfaces)
+            started.append(ifc->start().isValid());
+        return started;
+    }
+
+    started = reply.value();
+    for (int i = 0; i < interfaces.size(); ++i)
+        if (started.at(i))
+            interfaces.at(i)->setStarted();
+    return started;
+}
+
 bool SensorManagerInterface::releaseInterface(const QString& id, int sessionId)
 {
     QString cleanId = getCleanId(id);
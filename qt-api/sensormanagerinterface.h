@@ -51,6 +51,27 @@ public:
     void registerSensorInterface(const QString& sensorName);
 
     AbstractSensorChannelInterface* interface(const QString& id);
+
+    /**
+     * Create interfaces for several sensors. Plugins are loaded and
+     * sessions requested in one call to sensord, falling back to
+     * interface() per sensor if sensord does not support it. Interfaces
+     * of the sensors must be registered.
+     *
+     * @param ids sensor IDs.
+     * @return interface for each ID, NULL where the sensor was not granted.
+     */
+    QList<AbstractSensorChannelInterface*> interfaces(const QStringList& ids);
+
+    /**
+     * Start interfaces with their current configuration in one call to
+     * sensord, see AbstractSensorChannelInterface::start(). Falls back to
+     * start() per interface if sensord does not support it.
+     *
+     * @param interfaces stopped interfaces.
+     * @return was each interface started.
+     */
+    QList<bool> startInterfaces(const QList<AbstractSensorChannelInterface*>& interfaces);
     bool releaseInterface(const QString& id, int sessionId);
 
     bool registeredAndCorrectClassName(const QString& id, const QString& className ) const;
@@ -25,30 +25,84 @@
  */
 
 #include "socketreader.h"
+#include "multiplexedconnection.h"
+#include "socketreceiver.h"
+#include <QSocketNotifier>
+#include <sys/socket.h>
+#include <sys/ioctl.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 const char* SocketReader::channelIDString = "_SENSORCHANNEL_";
 
+/** Initial receive buffer size, holds a few full frames */
+static const int RECEIVE_BUFFER_SIZE = 4096;
+
+/** SOCK_SEQPACKET data socket, see global/seqpacket_socket of sensord */
+static const char* PACKET_SOCKET_NAME = "/var/run/sensord-seqpacket.sock";
+
 SocketReader::SocketReader(QObject* parent) :
     QObject(parent),
     socket_(NULL),
-    tagRead_(false)
+    mux_(NULL),
+    receiver_(NULL),
+    threaded_(qgetenv("SENSORFW_RECEIVE") == "thread"),
+    packetFd_(-1),
+    packetNotifier_(NULL),
+    packetOpen_(false),
+    sessionId_(-1),
+    tagRead_(false),
+    compact_(false),
+    compactUsed_(0),
+    buffer_(RECEIVE_BUFFER_SIZE, 0),
+    begin_(0),
+    end_(0)
 {
 }
 
 SocketReader::~SocketReader()
 {
-    if (socket_) {
+    if (connected()) {
         dropConnection();
     }
 }
 
 bool SocketReader::initiateConnection(int sessionId)
 {
-    if (socket_ != NULL) {
+    if (connected()) {
         qDebug() << "attempting to initiate connection on connected socket";
         return false;
     }
 
+    int transport = SocketTransport;
+    QByteArray transportName = qgetenv("SENSORFW_TRANSPORT");
+    if (transportName == "shm")
+        transport = SharedRingDoorbellTransport;
+    else if (transportName == "shm-poll")
+        transport = SharedRingPollTransport;
+    else if (transportName == "mux")
+        transport = MultiplexedTransport;
+    else if (transportName == "compact")
+        transport = CompactSocketTransport;
+
+    sessionId_ = sessionId;
+    if (transportName == "seqpacket") {
+        if (connectPacket(sessionId))
+            return true;
+        qDebug() << "[SOCKETREADER]: Packet transport not available, using socket";
+    }
+    if (transport == MultiplexedTransport) {
+        MultiplexedConnection* mux = MultiplexedConnection::instance();
+        if (mux && mux->join(sessionId, this)) {
+            mux_ = mux;
+            return true;
+        }
+    }
+
     socket_ = new QLocalSocket(this);
     socket_->connectToServer("/var/run/sensord.sock", QIODevice::ReadWrite);
 
@@ -57,34 +111,198 @@ bool SocketReader::initiateConnection(int sessionId)
         return false;
     }
 
-    if (socket_->write((const char*)&sessionId, sizeof(sessionId)) != sizeof(sessionId)) {
+    // Session ID and transport request must arrive in single write
+    int request[2] = { sessionId, transport };
+    int requestSize = (transport == SocketTransport) ? sizeof(int) : sizeof(request);
+    if (socket_->write((const char*)request, requestSize) != requestSize) {
         qDebug() << "[SOCKETREADER]: SessionId write failed: " << socket_->errorString();
     }
     socket_->flush();
-    readSocketTag();
+    char reply = 0;
+    if (transport != SocketTransport)
+        reply = readTransportReply(socket_->socketDescriptor());
+    if (!tagRead_)
+        readSocketTag();
 
+    compact_ = (reply == 'C');
+    if (reply == 'M') {
+        mux_ = new MultiplexedConnection(socket_, sessionId, this);
+        socket_ = NULL;
+    } else {
+        connect(socket_, SIGNAL(readyRead()), this, SIGNAL(readyRead()));
+        if (threaded_ && !ring_.isAttached())
+            startReceiver();
+    }
     return true;
 }
 
+bool SocketReader::connectPacket(int sessionId)
+{
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, PACKET_SOCKET_NAME, sizeof(address.sun_path) - 1);
+
+    int fd = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return false;
+    if (::connect(fd, (struct sockaddr*)&address, sizeof(address)) < 0) {
+        qDebug() << "[SOCKETREADER]: Failed to connect packet socket: " << strerror(errno);
+        ::close(fd);
+        return false;
+    }
+
+    // Request is a single message like on the stream socket
+    int request[2] = { sessionId, SeqPacketTransport };
+    if (::send(fd, request, sizeof(request), MSG_NOSIGNAL) != (ssize_t)sizeof(request) ||
+        readTransportReply(fd) != 'P') {
+        ::close(fd);
+        tagRead_ = false;
+        return false;
+    }
+
+    packetFd_ = fd;
+    packetOpen_ = true;
+    packetNotifier_ = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+    connect(packetNotifier_, SIGNAL(activated(int)), this, SLOT(packetReadable()));
+    return true;
+}
+
+bool SocketReader::connected() const
+{
+    return socket_ || mux_ || receiver_ || packetFd_ >= 0;
+}
+
+void SocketReader::packetReadable()
+{
+    // Closed socket stays readable, it is reported once
+    fill();
+    if (!packetOpen_)
+        packetNotifier_->setEnabled(false);
+    emit readyRead();
+}
+
 bool SocketReader::dropConnection()
 {
-    if (!socket_)
+    if (packetFd_ >= 0) {
+        delete packetNotifier_;
+        packetNotifier_ = NULL;
+        ::close(packetFd_);
+        packetFd_ = -1;
+        packetOpen_ = false;
+    } else if (mux_) {
+        mux_->leave(sessionId_);
+        mux_ = NULL;
+    } else if (receiver_) {
+        delete receiver_;
+        receiver_ = NULL;
+    } else if (socket_) {
+        socket_->disconnectFromServer();
+        if(socket_->state() != QLocalSocket::UnconnectedState)
+            socket_->waitForDisconnected();
+        delete socket_;
+        socket_ = NULL;
+    } else {
+        return false;
+    }
+
+    tagRead_ = false;
+    compact_ = false;
+    compactUsed_ = 0;
+    ring_.detach();
+    begin_ = end_ = 0;
+
+    return true;
+}
+
+QLocalSocket* SocketReader::socket()
+{
+    return mux_ ? mux_->socket() : socket_;
+}
+
+qint64 SocketReader::bytesAvailable()
+{
+    if (receiver_)
+        return receiver_->available();
+    if (packetFd_ >= 0) {
+        // Size of the next message
+        int bytes = 0;
+        return ioctl(packetFd_, FIONREAD, &bytes) < 0 ? 0 : bytes;
+    }
+    return socket_ ? socket_->bytesAvailable() : 0;
+}
+
+bool SocketReader::setThreadedReceive(bool enabled)
+{
+    threaded_ = enabled;
+    if (enabled && socket_ && !ring_.isAttached())
+        return startReceiver();
+    if (!enabled && receiver_)
+        return stopReceiver();
+    return true;
+}
+
+bool SocketReader::threadedReceive() const
+{
+    return receiver_ != NULL;
+}
+
+bool SocketReader::startReceiver()
+{
+    // Duplicate keeps the connection open when QLocalSocket closes its own
+    int fd = fcntl(socket_->socketDescriptor(), F_DUPFD_CLOEXEC, 0);
+    if (fd < 0) {
+        qDebug() << "[SOCKETREADER]: Failed to hand socket to receive thread: " << strerror(errno);
         return false;
+    }
 
-    socket_->disconnectFromServer();
-    if(socket_->state() != QLocalSocket::UnconnectedState)
-        socket_->waitForDisconnected();
+    // Bytes QLocalSocket has buffered already are not in the socket anymore
+    fill();
+    QByteArray pending(compactBuffer_.constData(), compactUsed_);
+    compactUsed_ = 0;
+    disconnect(socket_, SIGNAL(readyRead()), this, SIGNAL(readyRead()));
+    socket_->abort();
     delete socket_;
     socket_ = NULL;
 
-    tagRead_ = false;
+    receiver_ = new SocketReceiver(fd, compact_, pending, this);
+    receiver_->start();
+    return true;
+}
+
+bool SocketReader::stopReceiver()
+{
+    receiver_->stop();
+    fill();
+    QByteArray pending(receiver_->pendingCompact());
+    int fd = receiver_->takeDescriptor();
+    delete receiver_;
+    receiver_ = NULL;
 
+    if (compactBuffer_.size() < pending.size())
+        compactBuffer_.resize(pending.size());
+    memcpy(compactBuffer_.data(), pending.constData(), pending.size());
+    compactUsed_ = pending.size();
+
+    socket_ = new QLocalSocket(this);
+    if (!socket_->setSocketDescriptor(fd, QLocalSocket::ConnectedState, QIODevice::ReadWrite)) {
+        qDebug() << "[SOCKETREADER]: Failed to take socket back from receive thread: " << socket_->errorString();
+        ::close(fd);
+        delete socket_;
+        socket_ = NULL;
+        return false;
+    }
+    connect(socket_, SIGNAL(readyRead()), this, SIGNAL(readyRead()));
     return true;
 }
 
-QLocalSocket* SocketReader::socket()
+void SocketReader::deliver()
 {
-    return socket_;
+    // Frames arriving from now on queue the next call
+    if (!receiver_)
+        return;
+    receiver_->acknowledge();
+    emit readyRead();
 }
 
 bool SocketReader::readSocketTag()
@@ -95,32 +313,314 @@ bool SocketReader::readSocketTag()
     return true;
 }
 
-bool SocketReader::read(void* buffer, int size)
+char SocketReader::readTransportReply(int fd)
 {
-    int bytesRead = 0;
-    int retry = 100;
-    while(bytesRead < size)
-    {
-        int bytes = socket_->read((char *)buffer + bytesRead, size);
-        if(bytes == 0)
-        {
-            if(!retry)
-                return false;
-            struct timespec ts;
-            ts.tv_sec = 0;
-            ts.tv_nsec = 100000000;
-            nanosleep( &ts, NULL );
-            --retry;
+    // Magic byte and the reply are read without QLocalSocket as its
+    // buffering would drop the ancillary data.
+    for (int i = 0; i < 2; ++i) {
+        struct pollfd pfd;
+        pfd.fd = fd;
+        pfd.events = POLLIN;
+        if (poll(&pfd, 1, 30000) != 1) {
+            qDebug() << "[SOCKETREADER]: Timeout waiting for transport reply";
+            return 0;
+        }
+
+        char byte;
+        struct iovec iov;
+        iov.iov_base = &byte;
+        iov.iov_len = sizeof(byte);
+        char control[CMSG_SPACE(sizeof(int))];
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        if (recvmsg(fd, &msg, MSG_CMSG_CLOEXEC) != sizeof(byte)) {
+            qDebug() << "[SOCKETREADER]: Failed to read transport reply: " << strerror(errno);
+            return 0;
+        }
+        if (i == 0) {
+            tagRead_ = true;
             continue;
         }
-        if(bytes < 1)
+
+        if (byte == 'M' || byte == 'C' || byte == 'P')
+            return byte;
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        if (byte != 'R' || !cmsg || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+            qDebug() << "[SOCKETREADER]: Requested transport refused, using socket";
+            return byte;
+        }
+        int ringFd;
+        memcpy(&ringFd, CMSG_DATA(cmsg), sizeof(int));
+        return ring_.attach(ringFd) ? byte : 0;
+    }
+    return 0;
+}
+
+void SocketReader::receive(const char* data, int size)
+{
+    if (begin_ == end_)
+        begin_ = end_ = frameOffset();
+    reserve(size);
+    memcpy(buffer_.data() + end_, data, size);
+    end_ += size;
+}
+
+void SocketReader::notify()
+{
+    emit readyRead();
+}
+
+bool SocketReader::read(void* buffer, int size)
+{
+    if (!connected() || fill() < size)
+        return false;
+    memcpy(buffer, buffer_.constData() + begin_, size);
+    begin_ += size;
+    return true;
+}
+
+bool SocketReader::readFrame(const void*& values, int size, unsigned int& count)
+{
+    if (!connected()) {
+        return false;
+    }
+
+    if (ring_.isAttached()) {
+        // Doorbells only tell that ring has been written to
+        discard();
+        unsigned int available = ring_.available(size);
+        if (!available)
+            return false;
+        char* frame = frameSpace(available * size);
+        count = ring_.read(frame, size, available);
+        values = frame;
+        return count > 0;
+    }
+
+    if (!nextFrame(size, count))
+        return false;
+    values = buffer_.constData() + begin_ + sizeof(count);
+    begin_ += sizeof(count) + count * size;
+    return true;
+}
+
+unsigned int SocketReader::drain(void* buffer, int size, unsigned int max)
+{
+    if (!connected() || !max)
+        return 0;
+
+    // Without an event loop QLocalSocket reads the socket only when asked.
+    // Its readyRead() would hand the data to the interface instead.
+    if (mux_) {
+        mux_->poll(this);
+    } else if (socket_ && socket_->bytesAvailable() <= 0) {
+        bool blocked = socket_->blockSignals(true);
+        socket_->waitForReadyRead(0);
+        socket_->blockSignals(blocked);
+    }
+
+    if (ring_.isAttached()) {
+        discard();
+        return ring_.read(buffer, size, qMin(max, ring_.available(size)));
+    }
+
+    unsigned int drained = 0;
+    unsigned int count;
+    while (drained < max && nextFrame(size, count)) {
+        unsigned int taken = qMin(count, max - drained);
+        memcpy((char*)buffer + drained * size, buffer_.constData() + begin_ + sizeof(count), taken * size);
+        drained += taken;
+        // Rest of the frame becomes a frame of its own for the next call.
+        begin_ += taken * size;
+        count -= taken;
+        if (count)
+            memcpy(buffer_.data() + begin_, &count, sizeof(count));
+        else
+            begin_ += sizeof(count);
+    }
+    return drained;
+}
+
+int SocketReader::socketDescriptor()
+{
+    if (packetFd_ >= 0)
+        return packetFd_;
+    QLocalSocket* socket = this->socket();
+    return socket ? (int)socket->socketDescriptor() : -1;
+}
+
+bool SocketReader::nextFrame(int size, unsigned int& count)
+{
+    int buffered = fill();
+    while (buffered >= (int)sizeof(count)) {
+        memcpy(&count, buffer_.constData() + begin_, sizeof(count));
+        if (count > MAX_FRAME_OBJECTS) {
+            qWarning() << "Too many samples waiting in socket. Flushing it to empty";
+            discard();
+            return false;
+        }
+        int frameSize = sizeof(count) + count * size;
+        if (buffered < frameSize)
             return false;
-        bytesRead += bytes;
+        if (count) {
+            if (begin_ != frameOffset())
+                compact();
+            return true;
+        }
+        begin_ += frameSize;
+        buffered -= frameSize;
+    }
+    return false;
+}
+
+int SocketReader::fill()
+{
+    if (begin_ == end_)
+        begin_ = end_ = frameOffset();
+    if (receiver_) {
+        // Frames are decoded already, at most two copies around the ring end
+        const char* data;
+        int size;
+        while ((size = receiver_->peek(data)) > 0) {
+            receive(data, size);
+            receiver_->consume(size);
+        }
+        return end_ - begin_;
+    }
+    if (packetFd_ >= 0) {
+        fillPacket();
+        return end_ - begin_;
+    }
+    // Multiplexed connection hands frames in as they arrive
+    qint64 available = socket_ ? socket_->bytesAvailable() : 0;
+    if (available <= 0)
+        return end_ - begin_;
+
+    if (compact_) {
+        fillCompact();
+        return end_ - begin_;
     }
-    return (bytesRead > 0);
+
+    reserve(available);
+    qint64 bytes = socket_->read(buffer_.data() + end_, available);
+    if (bytes > 0)
+        end_ += bytes;
+    return end_ - begin_;
+}
+
+void SocketReader::fillCompact()
+{
+    qint64 available = socket_->bytesAvailable();
+    if (compactUsed_ + available > compactBuffer_.size())
+        compactBuffer_.resize(compactUsed_ + available);
+    qint64 bytes = socket_->read(compactBuffer_.data() + compactUsed_, available);
+    if (bytes > 0)
+        compactUsed_ += bytes;
+
+    int begin = 0;
+    CompactFrameHeader header;
+    while (compactUsed_ - begin >= (int)sizeof(header)) {
+        memcpy(&header, compactBuffer_.constData() + begin, sizeof(header));
+        if (header.count > MAX_FRAME_OBJECTS || !header.size || header.length > header.count * (header.size + 2)) {
+            qWarning() << "Corrupted compact frame in socket. Flushing it to empty";
+            begin = compactUsed_;
+            break;
+        }
+        int frameSize = sizeof(header) + header.length;
+        if (compactUsed_ - begin < frameSize)
+            break;
+
+        // Decoded frame is laid out as plain one
+        reserve(sizeof(header.count) + header.count * header.size);
+        char* frame = buffer_.data() + end_;
+        if (CompactFrame::decode(header, compactBuffer_.constData() + begin + sizeof(header), frame + sizeof(header.count))) {
+            memcpy(frame, &header.count, sizeof(header.count));
+            end_ += sizeof(header.count) + header.count * header.size;
+        } else {
+            qWarning() << "Failed to decode compact frame of " << header.count << " samples";
+        }
+        begin += frameSize;
+    }
+    compactUsed_ -= begin;
+    memmove(compactBuffer_.data(), compactBuffer_.constData() + begin, compactUsed_);
+}
+
+void SocketReader::fillPacket()
+{
+    while (packetOpen_) {
+        // Message is taken whole, so its size is peeked first
+        ssize_t size = recv(packetFd_, NULL, 0, MSG_PEEK | MSG_TRUNC | MSG_DONTWAIT);
+        if (size > 0) {
+            reserve(size);
+            size = recv(packetFd_, buffer_.data() + end_, size, MSG_DONTWAIT);
+        }
+        if (size > 0) {
+            end_ += size;
+        } else if (size == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+            packetOpen_ = false;
+        } else {
+            break;
+        }
+    }
+}
+
+void SocketReader::reserve(int size)
+{
+    if (end_ + size > buffer_.size()) {
+        int needed = FRAME_ALIGNMENT + end_ - begin_ + size;
+        if (needed > buffer_.size())
+            buffer_.resize(needed);
+        compact();
+    }
+}
+
+void SocketReader::discard()
+{
+    // Read through the receive buffer to avoid readAll() allocations
+    while (((socket_ && socket_->bytesAvailable() > 0) || (receiver_ && receiver_->available() > 0) ||
+            (packetFd_ >= 0 && bytesAvailable() > 0)) && fill() > 0)
+        begin_ = end_;
+    begin_ = end_ = frameOffset();
+    compactUsed_ = 0;
+}
+
+int SocketReader::frameOffset() const
+{
+    quintptr objects = (quintptr)buffer_.constData() + sizeof(unsigned int);
+    return (FRAME_ALIGNMENT - objects % FRAME_ALIGNMENT) % FRAME_ALIGNMENT;
+}
+
+void SocketReader::compact()
+{
+    if (begin_ == frameOffset())
+        return;
+    if (FRAME_ALIGNMENT + end_ - begin_ > buffer_.size())
+        buffer_.resize(buffer_.size() + FRAME_ALIGNMENT);
+    int offset = frameOffset();
+    memmove(buffer_.data() + offset, buffer_.constData() + begin_, end_ - begin_);
+    end_ = offset + end_ - begin_;
+    begin_ = offset;
+}
+
+char* SocketReader::frameSpace(int size)
+{
+    int needed = frameOffset() + sizeof(unsigned int) + size;
+    if (needed > buffer_.size())
+        buffer_.resize(needed + FRAME_ALIGNMENT);
+    begin_ = end_ = frameOffset();
+    return buffer_.data() + begin_ + sizeof(unsigned int);
 }
 
 bool SocketReader::isConnected()
 {
-    return (socket_ && socket_->isValid() && socket_->state() == QLocalSocket::ConnectedState);
+    if (receiver_)
+        return receiver_->isConnected();
+    if (packetFd_ >= 0)
+        return packetOpen_;
+    QLocalSocket* socket = this->socket();
+    return (socket && socket->isValid() && socket->state() == QLocalSocket::ConnectedState);
 }
@@ -30,6 +30,14 @@
 #include <QObject>
 #include <QLocalSocket>
 #include <QVector>
+#include <QByteArray>
+#include <string.h>
+#include <datatypes/sharedring.h>
+#include <datatypes/compactframe.h>
+
+class MultiplexedConnection;
+class SocketReceiver;
+class QSocketNotifier;
 
 /**
  * @brief Helper class for reading socket datachannel from sensord
@@ -58,7 +66,17 @@ public:
     ~SocketReader();
 
     /**
-     * Initiates new data socket connection.
+     * Initiates new data socket connection. Shared memory transport is
+     * requested if SENSORFW_TRANSPORT environment variable is set to
+     * "shm" (ring with doorbell) or "shm-poll" (ring without doorbell).
+     * With "mux" sessions of the thread share single connection, see
+     * MultiplexedConnection. With "compact" frames are delta encoded,
+     * see CompactFrame, and decoded as they are received. With
+     * "seqpacket" the SOCK_SEQPACKET data socket is used, every frame
+     * then arrives as one message and is read with a single recv(). Socket
+     * transport is used if sensord refuses the request. Socket is
+     * received in a background thread if SENSORFW_RECEIVE environment
+     * variable is set to "thread", see setThreadedReceive().
      *
      * @param sessionId ID for the current session.
      * @return was the connection established successfully.
@@ -73,17 +91,27 @@ public:
 
     /**
      * Provides access to the internal QLocalSocket for direct reading.
+     * With multiplexed transport the socket is shared with other sessions
+     * and must not be read directly.
      *
      * @return Pointer to the internal QLocalSocket. Pointer can be \c NULL
-     *         if \c initiateConnection() has not been called successfully.
+     *         if \c initiateConnection() has not been called successfully,
+     *         or if the packet socket is read without QLocalSocket.
      */
     QLocalSocket* socket();
 
     /**
-     * Attempt to read given number of bytes from the socket. As
-     * QLocalSocket is used, we are guaranteed that any number of bytes
-     * written in single operation are available for immediate reading
-     * with a single operation.
+     * Number of bytes waiting in the session socket. Frames received over
+     * multiplexed connection are already buffered by the reader.
+     *
+     * @return bytes not yet received.
+     */
+    qint64 bytesAvailable();
+
+    /**
+     * Attempt to read given number of bytes from the socket. The call
+     * does not block. If fewer bytes have arrived nothing is consumed and
+     * the received bytes stay buffered for a later call.
      *
      * @param size Number of bytes to read.
      * @param buffer Location for storing the data.
@@ -92,8 +120,11 @@ public:
     bool read(void* buffer, int size);
 
     /**
-     * Attempt to read objects from the sockets. The call blocks until
-     * there are minimum amount of expected bytes availabled in the socket.
+     * Attempt to read objects from the socket. Received bytes are
+     * accumulated into a receive buffer and objects of every complete
+     * frame in it are appended. A partial frame stays buffered until the
+     * rest of it arrives, so the call does not block. With shared memory
+     * transport objects are read from the ring.
      *
      * @param values Vector to which objects will be appended.
      * @tparam T type of expected object in the stream.
@@ -102,6 +133,53 @@ public:
     template<typename T>
     bool read(QVector<T>& values);
 
+    /**
+     * Attempt to read the next frame without copying it. The objects are
+     * left in the receive buffer, suitably aligned for T, and stay valid
+     * until the next read from this reader, with multiplexed transport
+     * also until the connection is next read for any session. With shared memory transport
+     * all objects available in the ring are returned as one frame.
+     *
+     * @param values Set to the first object of the frame.
+     * @param count Set to the number of objects in the frame.
+     * @tparam T type of expected object in the stream.
+     * @return true if a non-empty frame was read.
+     */
+    template<typename T>
+    bool readFrame(const T*& values, unsigned int& count);
+
+    /**
+     * Untyped version of readFrame().
+     *
+     * @param values Set to the first object of the frame.
+     * @param size Size of an object in bytes.
+     * @param count Set to the number of objects in the frame.
+     * @return true if a non-empty frame was read.
+     */
+    bool readFrame(const void*& values, int size, unsigned int& count);
+
+    /**
+     * Copy received objects into given buffer without blocking and without
+     * a Qt event loop. Bytes waiting in the socket are read directly, and
+     * a frame not fitting into the buffer is left partially unread for the
+     * next call. Objects drained are not passed to readyRead() handlers.
+     *
+     * @param buffer Location for at most \a max objects.
+     * @param size Size of an object in bytes.
+     * @param max Maximum number of objects.
+     * @return number of objects copied.
+     */
+    unsigned int drain(void* buffer, int size, unsigned int max);
+
+    /**
+     * File descriptor of the data socket. It becomes readable when
+     * objects can be read, except with shared memory transport without
+     * doorbell which must be polled.
+     *
+     * @return socket descriptor or -1 if not connected.
+     */
+    int socketDescriptor();
+
     /**
      * Returns whether the socket is currently connected.
      *
@@ -109,7 +187,47 @@ public:
      */
     bool isConnected();
 
+    /**
+     * Receive the data socket in a background thread, see SocketReceiver.
+     * The thread reads the socket and decodes compact frames as they
+     * arrive, and readyRead() is emitted once per event loop pass for
+     * everything received since. Applies to socket and compact
+     * transports; shared memory and multiplexed transports are left as
+     * they are. Setting survives reconnects. While the thread receives,
+     * socket() is \c NULL and socketDescriptor() is -1.
+     *
+     * @param enabled receive in a background thread.
+     * @return was the connection switched, true if not connected.
+     */
+    bool setThreadedReceive(bool enabled);
+
+    /**
+     * Is the data socket received in a background thread.
+     *
+     * @return is a receive thread running.
+     */
+    bool threadedReceive() const;
+
+Q_SIGNALS:
+    /**
+     * Emitted when data has been received for the session.
+     */
+    void readyRead();
+
+private Q_SLOTS:
+    /**
+     * Emit readyRead() for bytes collected by the receive thread.
+     */
+    void deliver();
+
+    /**
+     * Emit readyRead() for messages waiting in the packet socket.
+     */
+    void packetReadable();
+
 private:
+    friend class MultiplexedConnection;
+
     /**
      * Prefix text needed to be written to the sensor daemon socket connection
      * when establishing new session.
@@ -121,36 +239,173 @@ private:
      */
     bool readSocketTag();
 
+    /**
+     * Reads initial magic byte and reply to transport request directly
+     * from the socket file descriptor. Shared memory ring passed with the
+     * reply is attached.
+     *
+     * @param fd connected data socket.
+     * @return reply byte, 0 if no reply was read.
+     */
+    char readTransportReply(int fd);
+
+    /**
+     * Connect the SOCK_SEQPACKET data socket and request
+     * SeqPacketTransport for the session.
+     *
+     * @param sessionId ID for the current session.
+     * @return was the transport accepted.
+     */
+    bool connectPacket(int sessionId);
+
+    /**
+     * Is any kind of data connection open.
+     *
+     * @return is a connection initiated.
+     */
+    bool connected() const;
+
+    /**
+     * Hand the data socket over to a receive thread.
+     *
+     * @return was the thread started.
+     */
+    bool startReceiver();
+
+    /**
+     * Stop the receive thread and read the data socket with QLocalSocket
+     * again.
+     *
+     * @return was the socket taken back.
+     */
+    bool stopReceiver();
+
+    /**
+     * Append frames received over multiplexed connection to the receive
+     * buffer.
+     *
+     * @param data received frames.
+     * @param size size of the frames in bytes.
+     */
+    void receive(const char* data, int size);
+
+    /**
+     * Emit readyRead() for frames received over multiplexed connection.
+     */
+    void notify();
+
+    /**
+     * Make room for given number of bytes after the received bytes. The
+     * buffer is compacted and grown only when the bytes do not fit.
+     *
+     * @param size Number of bytes.
+     */
+    void reserve(int size);
+
+    /**
+     * Move bytes available in the socket into the receive buffer. The
+     * buffer is compacted and grown only when the bytes do not fit.
+     *
+     * @return number of buffered bytes not consumed yet.
+     */
+    int fill();
+
+    /**
+     * Decode compact frames available in the socket into plain frames in
+     * the receive buffer. A partial frame stays in #compact_.
+     */
+    void fillCompact();
+
+    /**
+     * Receive messages waiting in the packet socket, each one whole frame,
+     * into the receive buffer.
+     */
+    void fillPacket();
+
+    /**
+     * Drop everything received so far.
+     */
+    void discard();
+
+    /**
+     * Offset in the receive buffer at which a frame starts so that its
+     * objects are aligned.
+     *
+     * @return offset in bytes.
+     */
+    int frameOffset() const;
+
+    /**
+     * Move unconsumed bytes to the start of the receive buffer, keeping the
+     * next frame aligned.
+     */
+    void compact();
+
+    /**
+     * Make sure a complete non-empty frame is at the start of the receive
+     * buffer, with its objects aligned. Empty frames are skipped.
+     *
+     * @param size Size of an object in bytes.
+     * @param count Set to the number of objects in the frame.
+     * @return is a frame available.
+     */
+    bool nextFrame(int size, unsigned int& count);
+
+    /**
+     * Space for objects of a frame copied from the shared memory ring.
+     * Drops everything received from the socket.
+     *
+     * @param size Size of the objects in bytes.
+     * @return aligned location in the receive buffer.
+     */
+    char* frameSpace(int size);
+
+    /** Frames with more objects are treated as stream corruption. */
+    static const unsigned int MAX_FRAME_OBJECTS = 1000;
+
+    /** Alignment of objects in frames returned by readFrame(). */
+    static const int FRAME_ALIGNMENT = 8;
+
     QLocalSocket* socket_; /**< socket data connection to sensord */
+    MultiplexedConnection* mux_; /**< shared connection if in use */
+    SocketReceiver* receiver_; /**< receive thread if in use */
+    bool threaded_; /**< is threaded receive requested */
+    int packetFd_; /**< SOCK_SEQPACKET data connection or -1 */
+    QSocketNotifier* packetNotifier_; /**< readability of packetFd_, or NULL */
+    bool packetOpen_; /**< has sensord not closed packetFd_ */
+    int sessionId_; /**< session ID of the connection */
     bool tagRead_; /**< is initial magic byte read from the socket */
+    SharedRingReader ring_; /**< shared memory ring if in use */
+    bool compact_; /**< are frames compact encoded */
+    QByteArray compactBuffer_; /**< received compact bytes, size is its capacity */
+    int compactUsed_; /**< bytes in compactBuffer_ */
+    QByteArray buffer_; /**< receive buffer, size is its capacity */
+    int begin_; /**< first unconsumed byte in buffer_ */
+    int end_; /**< end of received bytes in buffer_ */
 };
 
 template<typename T>
 bool SocketReader::read(QVector<T>& values)
 {
-    if (!socket_) {
-        return false;
-    }
-
+    const T* frame;
     unsigned int count;
-    if(!read((void*)&count, sizeof(unsigned int)))
-    {
-        socket_->readAll();
-        return false;
+    bool objectsRead = false;
+    while (readFrame(frame, count)) {
+        int oldSize = values.size();
+        values.resize(oldSize + count);
+        memcpy((void*)(values.data() + oldSize), frame, count * sizeof(T));
+        objectsRead = true;
     }
-    if(count > 1000)
-    {
-        qWarning() << "Too many samples waiting in socket. Flushing it to empty";
-        socket_->readAll();
-        return false;
-    }
-    values.resize(values.size() + count);
-    if(!read((void*)values.data(), sizeof(T) * count))
-    {
-        qWarning() << "Error occured while reading data from socket: " << socket_->errorString();
-        socket_->readAll();
+    return objectsRead;
+}
+
+template<typename T>
+bool SocketReader::readFrame(const T*& values, unsigned int& count)
+{
+    const void* frame;
+    if (!readFrame(frame, sizeof(T), count))
         return false;
-    }
+    values = (const T*)frame;
     return true;
 }
 
@@ -0,0 +1,264 @@
+/**
+   @file socketreceiver.cpp
+   @brief Background thread receiving a data connection
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "socketreceiver.h"
+#include "datatypes/atomic.h"
+#include <datatypes/compactframe.h>
+#include <QDebug>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <poll.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+/** Frames with more objects are treated as stream corruption, as in SocketReader */
+static const unsigned int MAX_FRAME_OBJECTS = 1000;
+
+/** Least free space in the compact buffer for a read */
+static const int COMPACT_READ_SIZE = 4096;
+
+SocketReceiver::SocketReceiver(int fd, bool compact, const QByteArray& pending, QObject* target) :
+    QThread(),
+    fd_(fd),
+    wakeFd_(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)),
+    compact_(compact),
+    target_(target),
+    ring_(RING_SIZE, 0),
+    head_(0),
+    tail_(0),
+    pending_(0),
+    waiting_(0),
+    connected_(1),
+    stopping_(0),
+    compactBuffer_(pending),
+    compactUsed_(pending.size())
+{
+}
+
+SocketReceiver::~SocketReceiver()
+{
+    stop();
+    if (fd_ >= 0)
+        ::close(fd_);
+    if (wakeFd_ >= 0)
+        ::close(wakeFd_);
+}
+
+void SocketReceiver::stop()
+{
+    Atomic::storeRelease(stopping_, 1);
+    quint64 one = 1;
+    if (wakeFd_ >= 0 && ::write(wakeFd_, &one, sizeof(one)) < 0)
+        qDebug() << "[SOCKETRECEIVER]: Failed to wake receive thread: " << strerror(errno);
+    wait();
+}
+
+int SocketReceiver::takeDescriptor()
+{
+    int fd = fd_;
+    fd_ = -1;
+    return fd;
+}
+
+QByteArray SocketReceiver::pendingCompact() const
+{
+    return compactBuffer_.left(compactUsed_);
+}
+
+bool SocketReceiver::isConnected() const
+{
+    return Atomic::loadAcquire(connected_) != 0;
+}
+
+int SocketReceiver::available() const
+{
+    return (unsigned)Atomic::loadAcquire(tail_) - (unsigned)Atomic::loadAcquire(head_);
+}
+
+int SocketReceiver::peek(const char*& data) const
+{
+    unsigned head = Atomic::load(head_);
+    unsigned used = (unsigned)Atomic::loadAcquire(tail_) - head;
+    int offset = head & (RING_SIZE - 1);
+    data = ring_.constData() + offset;
+    return qMin((int)used, RING_SIZE - offset);
+}
+
+void SocketReceiver::consume(int size)
+{
+    Atomic::storeRelease(head_, Atomic::load(head_) + size);
+    // Ordered exchange keeps the thread from missing the released space
+    if (waiting_.testAndSetOrdered(1, 0)) {
+        quint64 one = 1;
+        if (::write(wakeFd_, &one, sizeof(one)) < 0)
+            qDebug() << "[SOCKETRECEIVER]: Failed to wake receive thread: " << strerror(errno);
+    }
+}
+
+void SocketReceiver::acknowledge()
+{
+    Atomic::storeRelease(pending_, 0);
+}
+
+void SocketReceiver::run()
+{
+    while (!Atomic::loadAcquire(stopping_)) {
+        if (!compact_ && available() == RING_SIZE && !waitForSpace())
+            break;
+
+        struct pollfd fds[2];
+        fds[0].fd = fd_;
+        fds[0].events = POLLIN;
+        fds[0].revents = 0;
+        fds[1].fd = wakeFd_;
+        fds[1].events = POLLIN;
+        fds[1].revents = 0;
+        if (::poll(fds, 2, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            qDebug() << "[SOCKETRECEIVER]: Poll failed: " << strerror(errno);
+            break;
+        }
+        if (fds[1].revents)
+            clearWakeup();
+        if (!fds[0].revents)
+            continue;
+
+        bool open = compact_ ? receiveCompact() : receivePlain();
+        if (!open) {
+            if (!Atomic::loadAcquire(stopping_)) {
+                Atomic::storeRelease(connected_, 0);
+                notify();
+            }
+            break;
+        }
+    }
+}
+
+bool SocketReceiver::receivePlain()
+{
+    unsigned tail = Atomic::load(tail_);
+    int space = RING_SIZE - available();
+    int offset = tail & (RING_SIZE - 1);
+    ssize_t bytes = recv(fd_, ring_.data() + offset, qMin(space, RING_SIZE - offset), MSG_DONTWAIT);
+    if (bytes == 0)
+        return false;
+    if (bytes < 0)
+        return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    Atomic::storeRelease(tail_, tail + bytes);
+    notify();
+    return true;
+}
+
+bool SocketReceiver::receiveCompact()
+{
+    if (compactBuffer_.size() - compactUsed_ < COMPACT_READ_SIZE)
+        compactBuffer_.resize(compactUsed_ + COMPACT_READ_SIZE);
+    ssize_t bytes = recv(fd_, compactBuffer_.data() + compactUsed_, compactBuffer_.size() - compactUsed_, MSG_DONTWAIT);
+    if (bytes == 0)
+        return false;
+    if (bytes < 0)
+        return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    compactUsed_ += bytes;
+
+    int begin = 0;
+    bool open = true;
+    CompactFrameHeader header;
+    while (open && compactUsed_ - begin >= (int)sizeof(header)) {
+        memcpy(&header, compactBuffer_.constData() + begin, sizeof(header));
+        if (header.count > MAX_FRAME_OBJECTS || !header.size || header.length > header.count * (header.size + 2)) {
+            qWarning() << "Corrupted compact frame in socket. Flushing it to empty";
+            begin = compactUsed_;
+            break;
+        }
+        int frameSize = sizeof(header) + header.length;
+        if (compactUsed_ - begin < frameSize)
+            break;
+
+        // Decoded frame is laid out as plain one
+        int plainSize = sizeof(header.count) + header.count * header.size;
+        if (frame_.size() < plainSize)
+            frame_.resize(plainSize);
+        if (CompactFrame::decode(header, compactBuffer_.constData() + begin + sizeof(header), frame_.data() + sizeof(header.count))) {
+            memcpy(frame_.data(), &header.count, sizeof(header.count));
+            open = write(frame_.constData(), plainSize);
+        } else {
+            qWarning() << "Failed to decode compact frame of " << header.count << " samples";
+        }
+        begin += frameSize;
+    }
+    compactUsed_ -= begin;
+    memmove(compactBuffer_.data(), compactBuffer_.constData() + begin, compactUsed_);
+    return open;
+}
+
+bool SocketReceiver::write(const char* data, int size)
+{
+    while (size > 0) {
+        int space = RING_SIZE - available();
+        if (!space) {
+            if (!waitForSpace())
+                return false;
+            continue;
+        }
+        unsigned tail = Atomic::load(tail_);
+        int offset = tail & (RING_SIZE - 1);
+        int chunk = qMin(qMin(size, space), RING_SIZE - offset);
+        memcpy(ring_.data() + offset, data, chunk);
+        Atomic::storeRelease(tail_, tail + chunk);
+        notify();
+        data += chunk;
+        size -= chunk;
+    }
+    return true;
+}
+
+bool SocketReceiver::waitForSpace()
+{
+    while (!Atomic::loadAcquire(stopping_)) {
+        waiting_.fetchAndStoreOrdered(1);
+        if (available() < RING_SIZE) {
+            Atomic::storeRelease(waiting_, 0);
+            return true;
+        }
+        struct pollfd pfd;
+        pfd.fd = wakeFd_;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if (::poll(&pfd, 1, -1) > 0)
+            clearWakeup();
+    }
+    return false;
+}
+
+void SocketReceiver::notify()
+{
+    if (pending_.testAndSetOrdered(0, 1))
+        QMetaObject::invokeMethod(target_, "deliver", Qt::QueuedConnection);
+}
+
+void SocketReceiver::clearWakeup()
+{
+    quint64 count;
+    while (::read(wakeFd_, &count, sizeof(count)) > 0)
+        ;
+}
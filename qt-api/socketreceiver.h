@@ -0,0 +1,184 @@
+/**
+   @file socketreceiver.h
+   @brief Background thread receiving a data connection
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef SOCKETRECEIVER_H
+#define SOCKETRECEIVER_H
+
+#include <QThread>
+#include <QAtomicInt>
+#include <QByteArray>
+
+/**
+ * Receives a data connection in a thread of its own, so that a busy GUI
+ * thread neither delays reading the socket nor pays for the read calls.
+ * Compact frames are decoded in the thread. Plain frames are written into
+ * a single producer single consumer byte ring, which the owning
+ * SocketReader empties into its receive buffer without locking.
+ *
+ * The owner is notified by queuing a call to its deliver() slot. Only one
+ * call is queued at a time: frames arriving before the owner has called
+ * acknowledge() are delivered by the same call, so a GUI thread gets one
+ * notification per event loop pass with everything accumulated since.
+ *
+ * When the ring is full the thread stops reading until the owner has
+ * consumed bytes, leaving sensord to apply its own buffering.
+ */
+class SocketReceiver : public QThread
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(SocketReceiver)
+
+public:
+    /**
+     * Constructor. Receiving starts with start().
+     *
+     * @param fd connected data socket, owned by the receiver until
+     *        takeDescriptor().
+     * @param compact are frames compact encoded.
+     * @param pending compact bytes already read from the socket.
+     * @param target object with a deliver() slot, called queued.
+     */
+    SocketReceiver(int fd, bool compact, const QByteArray& pending, QObject* target);
+
+    /**
+     * Destructor. Stops the thread and closes the socket.
+     */
+    ~SocketReceiver();
+
+    /**
+     * Stop the thread. Bytes already in the ring stay readable.
+     */
+    void stop();
+
+    /**
+     * Take the socket back after stop().
+     *
+     * @return socket descriptor, -1 if taken already.
+     */
+    int takeDescriptor();
+
+    /**
+     * Compact bytes of a partial frame read from the socket. Valid after
+     * stop().
+     *
+     * @return undecoded bytes.
+     */
+    QByteArray pendingCompact() const;
+
+    /**
+     * Is the connection still open. Cleared when sensord closes it.
+     *
+     * @return is socket connected.
+     */
+    bool isConnected() const;
+
+    /**
+     * Number of bytes in the ring.
+     *
+     * @return bytes readable with peek().
+     */
+    int available() const;
+
+    /**
+     * Contiguous bytes at the read position of the ring. Called by the
+     * owner only.
+     *
+     * @param data Set to the first byte.
+     * @return number of bytes, 0 if the ring is empty.
+     */
+    int peek(const char*& data) const;
+
+    /**
+     * Release bytes returned by peek(). Called by the owner only.
+     *
+     * @param size number of bytes.
+     */
+    void consume(int size);
+
+    /**
+     * Allow the next notification. Called by the owner before reading.
+     */
+    void acknowledge();
+
+protected:
+    void run();
+
+private:
+    /**
+     * Read the socket directly into the ring.
+     *
+     * @return false if the connection is lost.
+     */
+    bool receivePlain();
+
+    /**
+     * Read the socket and decode complete compact frames into the ring.
+     *
+     * @return false if the connection is lost or stop() was called.
+     */
+    bool receiveCompact();
+
+    /**
+     * Copy bytes into the ring, waiting for space if needed.
+     *
+     * @param data bytes.
+     * @param size number of bytes, at most the ring capacity.
+     * @return false if stop() was called while waiting.
+     */
+    bool write(const char* data, int size);
+
+    /**
+     * Wait until the ring has space or stop() is called.
+     *
+     * @return false if stop() was called.
+     */
+    bool waitForSpace();
+
+    /**
+     * Publish written bytes and queue a notification unless one is pending.
+     */
+    void notify();
+
+    /**
+     * Clear the wakeup event.
+     */
+    void clearWakeup();
+
+    /** Ring capacity in bytes, a power of two. */
+    static const int RING_SIZE = 256 * 1024;
+
+    int fd_;                 /**< data socket or -1 */
+    int wakeFd_;             /**< eventfd signaled by stop() and consume() */
+    bool compact_;           /**< are frames compact encoded */
+    QObject* target_;        /**< object notified through deliver() */
+    QByteArray ring_;        /**< received plain frames */
+    QAtomicInt head_;        /**< bytes consumed, written by the owner */
+    QAtomicInt tail_;        /**< bytes written, written by the thread */
+    QAtomicInt pending_;     /**< is a notification queued */
+    QAtomicInt waiting_;     /**< is the thread waiting for space */
+    QAtomicInt connected_;   /**< is the socket open */
+    QAtomicInt stopping_;    /**< has stop() been called */
+    QByteArray compactBuffer_; /**< received compact bytes, size is its capacity */
+    int compactUsed_;        /**< bytes in compactBuffer_ */
+    QByteArray frame_;       /**< decoded frame, allocation reused */
+};
+
+#endif // SOCKETRECEIVER_H
@@ -0,0 +1,65 @@
+/**
+   @file statisticssensor_i.cpp
+   @brief Interface for StatisticsSensor
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "sensormanagerinterface.h"
+#include "statisticssensor_i.h"
+
+const char* StatisticsSensorChannelInterface::staticInterfaceName = "local.StatisticsSensor";
+
+AbstractSensorChannelInterface* StatisticsSensorChannelInterface::factoryMethod(const QString& id, int sessionId)
+{
+    return new StatisticsSensorChannelInterface(OBJECT_PATH + "/" + id, sessionId);
+}
+
+StatisticsSensorChannelInterface::StatisticsSensorChannelInterface(const QString &path, int sessionId)
+    : AbstractSensorChannelInterface(path, StatisticsSensorChannelInterface::staticInterfaceName, sessionId)
+{
+}
+
+StatisticsSensorChannelInterface* StatisticsSensorChannelInterface::interface(const QString& id)
+{
+    SensorManagerInterface& sm = SensorManagerInterface::instance();
+    if ( !sm.registeredAndCorrectClassName( id, StatisticsSensorChannelInterface::staticMetaObject.className() ) )
+    {
+        return 0;
+    }
+
+    return dynamic_cast<StatisticsSensorChannelInterface*>(sm.interface(id));
+}
+
+unsigned int StatisticsSensorChannelInterface::window()
+{
+    return getCachedAccessor<unsigned int>("window");
+}
+
+bool StatisticsSensorChannelInterface::dataReceivedImpl()
+{
+    const XyzStatisticsData* values;
+    unsigned int count;
+    bool received = false;
+    while(readFrame<XyzStatisticsData>(values, count))
+    {
+        received = true;
+        for(unsigned int i = 0; i < count; ++i)
+            emit dataAvailable(values[i]);
+    }
+    return received;
+}
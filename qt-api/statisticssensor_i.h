@@ -0,0 +1,95 @@
+/**
+   @file statisticssensor_i.h
+   @brief Interface for StatisticsSensor
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef STATISTICSSENSOR_I_H
+#define STATISTICSSENSOR_I_H
+
+#include <QtDBus/QtDBus>
+
+#include "abstractsensor_i.h"
+#include <datatypes/statisticsdata.h>
+
+/**
+ * Client interface for accessing windowed statistics of accelerometer
+ * (accelerometerstatisticssensor) or gyroscope (gyroscopestatisticssensor)
+ * samples. One record is received per window instead of every sample.
+ */
+class StatisticsSensorChannelInterface : public AbstractSensorChannelInterface
+{
+    Q_OBJECT;
+    Q_DISABLE_COPY(StatisticsSensorChannelInterface)
+    Q_PROPERTY(unsigned int window READ window)
+
+public:
+    /**
+     * Name of the D-Bus interface for this class.
+     */
+    static const char* staticInterfaceName;
+
+    /**
+     * Create new instance of the class.
+     *
+     * @param id Sensor ID.
+     * @param sessionId Session ID.
+     * @return Pointer to new instance of the class.
+     */
+    static AbstractSensorChannelInterface* factoryMethod(const QString& id, int sessionId);
+
+    /**
+     * Constructor.
+     *
+     * @param path      path.
+     * @param sessionId session id.
+     */
+    StatisticsSensorChannelInterface(const QString &path, int sessionId);
+
+    /**
+     * Request an interface to the sensor.
+     *
+     * @param id sensor ID.
+     * @return Pointer to interface, or NULL on failure.
+     */
+    static StatisticsSensorChannelInterface* interface(const QString& id);
+
+    /**
+     * Window length of the records.
+     *
+     * @return window length in milliseconds.
+     */
+    unsigned int window();
+
+protected:
+    virtual bool dataReceivedImpl();
+
+Q_SIGNALS:
+    /**
+     * Sent when statistics of a window have become available.
+     *
+     * @param data statistics of the window.
+     */
+    void dataAvailable(const XyzStatisticsData& data);
+};
+
+namespace local {
+  typedef ::StatisticsSensorChannelInterface StatisticsSensor;
+}
+
+#endif
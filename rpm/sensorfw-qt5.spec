@@ -9,6 +9,7 @@ Source0:    %{name}-%{version}.tar.bz2
 Source1:    sensorfw-rpmlintrc
 Source2:    sensord.service
 Source3:    sensord-daemon-conf-setup
+Source4:    sensord.socket
 Requires:   qt5-qtcore
 Requires:   sensord-configs
 Requires:   systemd
@@ -92,10 +93,15 @@ export QT_SELECT=5
 %qmake5_install
 
 install -D -m644 %{SOURCE2} $RPM_BUILD_ROOT/%{_lib}/systemd/system/sensord.service
+install -D -m644 %{SOURCE4} $RPM_BUILD_ROOT/%{_lib}/systemd/system/sensord.socket
 install -D -m750 %{SOURCE3} $RPM_BUILD_ROOT/%{_bindir}/sensord-daemon-conf-setup
 
 mkdir -p %{buildroot}/%{_lib}/systemd/system/basic.target.wants
 ln -s ../sensord.service %{buildroot}/%{_lib}/systemd/system/basic.target.wants/sensord.service
+mkdir -p %{buildroot}/%{_lib}/systemd/system/sockets.target.wants
+ln -s ../sensord.socket %{buildroot}/%{_lib}/systemd/system/sockets.target.wants/sensord.socket
+
+mkdir -p %{buildroot}/%{_localstatedir}/lib/sensord
 
 %preun
 if [ "$1" -eq 0 ]; then
@@ -127,8 +133,11 @@ systemctl daemon-reload || :
 %config %{_sysconfdir}/dbus-1/system.d/sensorfw.conf
 %config %{_sysconfdir}/sensorfw/sensord.conf
 %dir %{_sysconfdir}/sensorfw/sensord.conf.d/
+%dir %{_localstatedir}/lib/sensord
 /%{_lib}/systemd/system/sensord.service
 /%{_lib}/systemd/system/basic.target.wants/sensord.service
+/%{_lib}/systemd/system/sensord.socket
+/%{_lib}/systemd/system/sockets.target.wants/sensord.socket
 %{_bindir}/sensord-daemon-conf-setup
 
 %files devel
@@ -152,7 +161,11 @@ systemctl daemon-reload || :
 %attr(755,root,root)%{_bindir}/sensoradaptors-test
 %attr(755,root,root)%{_bindir}/sensorapi-test
 %attr(755,root,root)%{_bindir}/sensorbenchmark-test
+%attr(755,root,root)%{_bindir}/sensorchains-benchmark
 %attr(755,root,root)%{_bindir}/sensorchains-test
+%attr(755,root,root)%{_bindir}/sensorclient-benchmark
+%attr(755,root,root)%{_bindir}/sensorcontrol-benchmark
+%attr(755,root,root)%{_bindir}/sensordataflow-benchmark
 %attr(755,root,root)%{_bindir}/sensordataflow-test
 %attr(755,root,root)%{_bindir}/sensord-deadclient
 %attr(755,root,root)%{_bindir}/sensordiverter.sh
@@ -160,9 +173,12 @@ systemctl daemon-reload || :
 %attr(755,root,root)%{_bindir}/sensordummyclient-qt5
 %attr(755,root,root)%{_bindir}/sensorexternal-test
 %attr(755,root,root)%{_bindir}/sensorfilters-test
+%attr(755,root,root)%{_bindir}/sensorloaddriver-qt5
 %attr(755,root,root)%{_bindir}/sensormetadata-test
 %attr(755,root,root)%{_bindir}/sensorpowermanagement-test
+%attr(755,root,root)%{_bindir}/sensorslowclient-benchmark
 %attr(755,root,root)%{_bindir}/sensorstandbyoverride-test
+%attr(755,root,root)%{_bindir}/sensorstress-benchmark
 %attr(755,root,root)%{_bindir}/sensortestapp
 
 %files configs
@@ -50,6 +50,7 @@ rm -rf %{buildroot}
 %files
 %defattr(-,root,root,-)
 %{_libdir}/libsensorclient.so.*
+%{_libdir}/libsensorclient-c.so.*
 %{_libdir}/libsensordatatypes.so.*
 
 %files devel
@@ -30,6 +30,9 @@
 #include "logging.h"
 #include "abstractsensor.h"
 #include "config.h"
+#include "datatypes/atomic.h"
+#include <QFileInfo>
+#include <QDateTime>
 
 const QString CalibrationHandler::SENSOR_NAME("magnetometersensor");
 
@@ -37,12 +40,21 @@ CalibrationHandler::CalibrationHandler(QObject* parent) :
     QObject(parent),
     m_sensor(NULL),
     m_sessionId(-1),
-    m_level(-1)
+    m_level(-1),
+    m_active(false),
+    m_running(false),
+    m_sink(this, &CalibrationHandler::samplesReceived),
+    m_sinkLevel(-1)
 {
     m_timer.setSingleShot(true);
+    m_dutyTimer.setSingleShot(true);
 
     m_calibRate = Config::configuration()->value<int>("magnetometer/calibration_rate", 100);
     m_calibTimeout = Config::configuration()->value<int>("magnetometer/calibration_timeout", 60000);
+    m_burst = Config::configuration()->value<int>("magnetometer/calibration_burst", 10000);
+    m_pause = Config::configuration()->value<int>("magnetometer/calibration_pause", 20000);
+    m_freshTime = Config::configuration()->value<int>("magnetometer/calibration_fresh_time", 3600000);
+    m_cachePath = Config::configuration()->value<QString>("magnetometer/calibration_cache", "/var/lib/sensord/magnetometer-calibration");
 }
 
 CalibrationHandler::~CalibrationHandler()
@@ -50,6 +62,8 @@ CalibrationHandler::~CalibrationHandler()
     if (m_sessionId > 0)
     {
         SensorManager& sm = SensorManager::instance();
+        if (m_sensor)
+            m_sensor->internalSource().unjoin(&m_sink);
         sm.releaseSensor(SENSOR_NAME, m_sessionId);
         m_sensor = NULL;
     }
@@ -64,6 +78,16 @@ bool CalibrationHandler::initiateSession()
         sensordLogW() << "Failed to load magnetometer plug-in";
         return false;
     }
+
+    // Nothing to drive when the HAL calibrates
+    AbstractChain* chain = sm.requestChain("magcalibrationchain");
+    if (chain && !chain->property("softwareCalibration").toBool())
+    {
+        sensordLogD() << "Magnetometer is calibrated by HAL, no background calibration.";
+        sm.releaseChain("magcalibrationchain");
+        return true;
+    }
+
     m_sessionId = sm.requestSensor(SENSOR_NAME);
     if (m_sessionId <= 0)
     {
@@ -72,56 +96,134 @@ bool CalibrationHandler::initiateSession()
     else
     {
         m_sensor = reinterpret_cast<MagnetometerSensorChannel*>(sm.getSensorInstance(SENSOR_NAME)->sensor_);
+        m_sensor->internalSource().join(&m_sink);
     }
+    if (chain)
+        sm.releaseChain("magcalibrationchain");
 
     // Connect timeout
     connect(&m_timer, SIGNAL(timeout()), this, SLOT(calibrationTimeout()));
+    connect(&m_dutyTimer, SIGNAL(timeout()), this, SLOT(dutyTimeout()));
     resumeCalibration();
     return true;
 }
 
-void CalibrationHandler::sampleReceived(const MagneticField& sample)
+void CalibrationHandler::samplesReceived(unsigned n, const CalibratedMagneticFieldData* values)
+{
+    int level = values[n - 1].level_;
+    if (m_sinkLevel.fetchAndStoreRelaxed(level) != level)
+        QMetaObject::invokeMethod(this, "levelChanged", Qt::QueuedConnection, Q_ARG(int, level));
+}
+
+void CalibrationHandler::levelChanged(int level)
 {
+    // Channel delivers samples of other sessions as well
+    if (!m_running)
+        return;
+
     //Reset timer when level changes
-    if ((sample.level() != m_level))
+    if (level != m_level)
     {
-        m_level = sample.level();
+        m_level = level;
         m_timer.start(m_calibTimeout);
     }
+    if (m_level >= MAX_LEVEL)
+    {
+        sensordLogD() << "Stopping magnetometer background calibration, calibration converged.";
+        finish();
+    }
 }
 
 void CalibrationHandler::stopCalibration()
 {
-    if (m_sensor && m_timer.isActive())
+    if (m_active)
     {
-        m_timer.stop();
-        m_sensor->setStandbyOverrideRequest(m_sessionId, false);
-        m_sensor->stop();
-        disconnect(m_sensor, SIGNAL(internalData(const MagneticField&)), this, SLOT(sampleReceived(const MagneticField&)));
+        finish();
         sensordLogD() << "Stopping magnetometer background calibration due to PSM on";
     }
 }
 
 void CalibrationHandler::calibrationTimeout()
 {
-    if (m_sensor)
+    sensordLogD() << "Stopping magnetometer background calibration due to timeout.";
+    finish();
+}
+
+void CalibrationHandler::dutyTimeout()
+{
+    if (m_running)
     {
-        sensordLogD() << "Stopping magnetometer background calibration due to timeout.";
-        m_sensor->setStandbyOverrideRequest(m_sessionId, false);
-        m_sensor->stop();
-        disconnect(m_sensor, SIGNAL(internalData(const MagneticField&)), this, SLOT(sampleReceived(const MagneticField&)));
+        stopSensor();
+        m_dutyTimer.start(m_pause);
+    }
+    else
+    {
+        startSensor();
+        m_dutyTimer.start(m_burst);
     }
 }
 
 void CalibrationHandler::resumeCalibration()
 {
-    sensordLogD() << "Resuming magnetometer background calibration";
-    if (m_sensor && !m_timer.isActive())
+    if (!m_sensor)
+        return;
+    if (m_active)
+    {
+        m_timer.start(m_calibTimeout);
+        return;
+    }
+    if (isCacheFresh())
     {
-        m_sensor->start();
-        m_sensor->setIntervalRequest(m_sessionId, m_calibRate);
-        m_sensor->setStandbyOverrideRequest(m_sessionId, true);
-        connect(m_sensor, SIGNAL(internalData(const MagneticField&)), this, SLOT(sampleReceived(const MagneticField&)));
+        sensordLogD() << "Magnetometer calibration is fresh, not resuming background calibration";
+        return;
     }
+
+    sensordLogD() << "Resuming magnetometer background calibration";
+    m_active = true;
     m_timer.start(m_calibTimeout);
+    startSensor();
+    if (m_burst > 0 && m_pause > 0)
+        m_dutyTimer.start(m_burst);
+}
+
+void CalibrationHandler::startSensor()
+{
+    if (m_running)
+        return;
+    m_running = true;
+    // First sample reports the level, converged or not
+    Atomic::storeRelease(m_sinkLevel, -1);
+    m_sensor->start();
+    m_sensor->setIntervalRequest(m_sessionId, m_calibRate);
+    m_sensor->setStandbyOverrideRequest(m_sessionId, true);
+}
+
+void CalibrationHandler::stopSensor()
+{
+    if (!m_running)
+        return;
+    m_running = false;
+    m_sensor->setStandbyOverrideRequest(m_sessionId, false);
+    m_sensor->stop();
+}
+
+void CalibrationHandler::finish()
+{
+    m_active = false;
+    m_timer.stop();
+    m_dutyTimer.stop();
+    if (m_sensor)
+        stopSensor();
+}
+
+bool CalibrationHandler::isCacheFresh() const
+{
+    // A worse calibration seen since the cache was written needs work
+    if (m_freshTime <= 0 || m_cachePath.isEmpty() || (m_level >= 0 && m_level < MAX_LEVEL))
+        return false;
+    QFileInfo cache(m_cachePath);
+    if (!cache.exists())
+        return false;
+    qint64 age = cache.lastModified().msecsTo(QDateTime::currentDateTime());
+    return age >= 0 && age < m_freshTime;
 }
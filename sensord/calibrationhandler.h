@@ -29,15 +29,26 @@
 
 #include <QObject>
 #include <QString>
-#include <QTimer>
-#include "datatypes/magneticfield.h"
+#include <QAtomicInt>
+#include "clock.h"
+#include "sink.h"
 #include "magnetometersensor.h"
 
 /**
  * @brief Helper class for maintaining magnetometer calibration.
  *
- * Keeps a session open to magnetometer with low frequency to maintain
- * calibration.
+ * Keeps a session open to magnetometer to maintain calibration. The
+ * magnetometer is duty cycled: it runs at calibration rate for bursts
+ * of magnetometer/calibration_burst ms separated by pauses of
+ * magnetometer/calibration_pause ms. Calibration ends when the
+ * calibration level reaches its maximum or has not changed for
+ * magnetometer/calibration_timeout ms. It is not resumed while the
+ * calibration cache was written less than
+ * magnetometer/calibration_fresh_time ms ago.
+ *
+ * Samples reach the handler through a sink joined to the internal source
+ * of the channel, in the thread delivering them. Only changes of the
+ * calibration level are passed on to the handler thread.
  */
 class CalibrationHandler : public QObject
 {
@@ -65,9 +76,11 @@ public:
 
 public slots:
     /**
-     * Callback when new sample is received from magnetometer.
+     * Callback when calibration level of the magnetometer changes.
+     *
+     * @param level new calibration level.
      */
-    void sampleReceived(const MagneticField&);
+    void levelChanged(int level);
 
     /**
      * Stop calibration.
@@ -85,15 +98,60 @@ private slots:
      */
     void calibrationTimeout();
 
+    /**
+     * Callback for the end of a burst or a pause.
+     */
+    void dutyTimeout();
+
 private:
+    /**
+     * Run magnetometer at calibration rate.
+     */
+    void startSensor();
+
+    /**
+     * Let magnetometer stop.
+     */
+    void stopSensor();
+
+    /**
+     * End calibration.
+     */
+    void finish();
+
+    /**
+     * Is the persisted calibration recent enough to skip calibrating.
+     *
+     * @return is calibration cache fresh.
+     */
+    bool isCacheFresh() const;
+
+    /**
+     * Sink callback, compares the level of the latest sample.
+     *
+     * @param n number of samples.
+     * @param values samples.
+     */
+    void samplesReceived(unsigned n, const CalibratedMagneticFieldData* values);
+
     static const QString       SENSOR_NAME;    /**< magnetometer sensor name */
+    static const int           MAX_LEVEL = 3;  /**< calibration level of a converged fit */
 
     MagnetometerSensorChannel* m_sensor;       /**< magnetometer sensor channel */
     int                        m_sessionId;    /**< session ID */
     int                        m_level;        /**< calibration level */
-    QTimer                     m_timer;        /**< calibration timer */
+    ClockTimer                 m_timer;        /**< calibration timer */
+    ClockTimer                 m_dutyTimer;    /**< burst and pause timer */
+    bool                       m_active;       /**< is calibration in progress */
+    bool                       m_running;      /**< is magnetometer running for calibration */
     int                        m_calibRate;    /**< calibration rate */
     int                        m_calibTimeout; /**< calibration timeout */
+    int                        m_burst;        /**< burst length in ms, 0 runs continuously */
+    int                        m_pause;        /**< pause length in ms */
+    int                        m_freshTime;    /**< age of a fresh calibration cache in ms, 0 always calibrates */
+    QString                    m_cachePath;    /**< calibration cache file */
+    Sink<CalibrationHandler, CalibratedMagneticFieldData> m_sink; /**< sink joined to the channel */
+    QAtomicInt                 m_sinkLevel;    /**< level last seen by the sink, -1 to report the next one */
 };
 
 #endif // CALIBRATION_HANDLER
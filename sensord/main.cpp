@@ -44,6 +44,12 @@
 #include "logging.h"
 #include "calibrationhandler.h"
 #include "parser.h"
+#include "lowlatency.h"
+#include "startuptrace.h"
+
+#ifdef SENSORD_STATIC_PLUGINS
+void registerStaticPlugins();
+#endif
 
 static QtMsgType logLevel;
 static QtMessageHandler previousMessageHandler;
@@ -65,6 +71,7 @@ void signalUSR1(int param)
     logLevel = QtMsgType(logLevel + 1);
     if (logLevel > QtSystemMsg)
         logLevel = QtDebugMsg;
+    sensordSetLogLevel(logLevel);
     std::cerr << "New debugging level: " << logLevel << "\n";
 }
 
@@ -83,6 +90,12 @@ void signalUSR2(int param)
     }
 }
 
+void signalHUP(int param)
+{
+    Q_UNUSED(param);
+    SensorManager::requestReload();
+}
+
 void signalINT(int param)
 {
     Q_UNUSED(param);
@@ -106,9 +119,16 @@ int main(int argc, char *argv[])
     }
 
     logLevel = parser.getLogLevel();
+    sensordSetLogLevel(logLevel);
+
+    if (parser.startupTrace())
+    {
+        StartupTrace::instance().start(parser.startupTracePath());
+    }
 
     const char* CONFIG_FILE_PATH = "/etc/sensorfw/sensord.conf";
     const char* CONFIG_DIR_PATH = "/etc/sensorfw/sensord.conf.d/";
+    const char* CONFIG_CACHE_PATH = "/var/lib/sensord/config-cache";
 
     QString defConfigFile = CONFIG_FILE_PATH;
     if(parser.configFileInput())
@@ -122,7 +142,12 @@ int main(int argc, char *argv[])
         defConfigDir = parser.configDirPath();
     }
 
-    if (!Config::loadConfig(defConfigFile, defConfigDir))
+    bool configLoaded;
+    {
+        StartupSpan span("config", "Config::loadConfig");
+        configLoaded = Config::loadConfig(defConfigFile, defConfigDir, CONFIG_CACHE_PATH);
+    }
+    if (!configLoaded)
     {
         sensordLogC() << "Config file error! Load using default paths.";
         if (!Config::loadConfig(CONFIG_FILE_PATH, CONFIG_DIR_PATH))
@@ -132,19 +157,23 @@ int main(int argc, char *argv[])
         }
     }
 
-    signal(SIGUSR1, signalUSR1);
-    signal(SIGUSR2, signalUSR2);
-    signal(SIGINT, signalINT);
-
-#ifdef PROVIDE_CONTEXT_INFO
-    if (parser.contextInfo())
+    // Before adaptor and writer threads are started, so their stacks get
+    // the fixed size
+    if (Config::configuration()->value<bool>("global/low_latency", false))
     {
-        sensordLogD() << "Loading ContextSensor " << sm.loadPlugin("contextsensor");
-        sensordLogD() << "Loading ALSSensor " << sm.loadPlugin("alssensor");
+        LowLatency::enable(Config::configuration()->value<unsigned int>("global/low_latency_stack_size", 256) * 1024,
+                           Config::configuration()->value<unsigned int>("global/low_latency_buffer_size", 256));
     }
+
+#ifdef SENSORD_STATIC_PLUGINS
+    registerStaticPlugins();
 #endif
 
-    
+    signal(SIGUSR1, signalUSR1);
+    signal(SIGUSR2, signalUSR2);
+    signal(SIGINT, signalINT);
+    signal(SIGHUP, signalHUP);
+
     if (parser.createDaemon())
     {
         int pid = fork();
@@ -167,12 +196,38 @@ int main(int argc, char *argv[])
         QObject::connect(&sm, SIGNAL(stopCalibration()), calibrationHandler_, SLOT(stopCalibration()));
     }
 
-    if (!sm.registerService())
+    bool registered;
+    {
+        StartupSpan span("service", "SensorManager::registerService");
+        registered = sm.registerService();
+    }
+    if (!registered)
     {
         sensordLogW() << "Failed to register service on D-Bus. Aborting.";
         exit(EXIT_FAILURE);
     }
 
+#ifdef PROVIDE_CONTEXT_INFO
+    // Loaded from the event loop so that initialization of the plugins
+    // does not delay service registration, and adaptor threads are not
+    // started before forking the daemon.
+    if (parser.contextInfo())
+    {
+        sm.loadPluginsLater(QStringList() << "contextsensor" << "alssensor");
+    }
+#endif
+
+    if (!Config::configuration()->value<QStringList>("netstream/channels").isEmpty())
+    {
+        sm.loadPluginsLater(QStringList() << "netstreamsensor");
+    }
+
+    // Written once the event loop has loaded the plugins queued above
+    if (StartupTrace::instance().isEnabled())
+    {
+        QMetaObject::invokeMethod(&StartupTrace::instance(), "finish", Qt::QueuedConnection);
+    }
+
     int ret = app.exec();
     sensordLogD() << "Exiting...";
     Config::close();
@@ -194,5 +249,7 @@ void printUsage()
     qDebug() << "                                  framework.\n";
     qDebug() << " --no-magnetometer-bg-calibration Do not start calibration of magnetometer in";
     qDebug() << "                                  the background.\n";
+    qDebug() << " --startup-trace=<path>           Write a timeline of startup as Chrome trace";
+    qDebug() << "                                  JSON into given file.\n";
     qDebug() << " -h, --help                       Show usage info and exit.";
 }
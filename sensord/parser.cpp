@@ -34,6 +34,7 @@ Parser::Parser(QStringList arguments) :
     configDir_(false),
     daemon_(false),
     magnetometerCalibration_(true),
+    startupTrace_(false),
     configFilePath_(""),
     logLevel_(QtWarningMsg)
 {
@@ -76,6 +77,12 @@ void Parser::parsingCommandLine(QStringList arguments)
             configDir_ = true;
             configDirPath_ = data.at(1);
         }
+        else if (opt.startsWith("--startup-trace="))
+        {
+            data = opt.split("=");
+            startupTrace_ = true;
+            startupTracePath_ = data.at(1);
+        }
         else if (opt.startsWith("--no-context-info"))
             contextInfo_ = false;
         else if (opt.startsWith("--no-magnetometer-bg-calibration"))
@@ -134,3 +141,12 @@ bool Parser::createDaemon() const
     return daemon_;
 }
 
+bool Parser::startupTrace() const
+{
+    return startupTrace_;
+}
+
+const QString& Parser::startupTracePath() const
+{
+    return startupTracePath_;
+}
@@ -48,6 +48,8 @@ public:
     bool contextInfo() const;
     bool magnetometerCalibration() const;
     bool createDaemon() const;
+    bool startupTrace() const;
+    const QString& startupTracePath() const;
 
 private:
     void parsingCommandLine(QStringList arguments);
@@ -58,9 +60,11 @@ private:
     bool configDir_;
     bool daemon_;
     bool magnetometerCalibration_;
+    bool startupTrace_;
 
     QString configFilePath_;
     QString configDirPath_;
+    QString startupTracePath_;
     QtMsgType logLevel_;
 };
 
@@ -41,6 +41,27 @@ contextprovider {
     PKGCONFIG += contextprovider-1.0
 }
 
+# Plugins linked in are registered with the loader by generated code,
+# see STATIC_PLUGINS in common-config.pri
+static_plugins:equals(QT_MAJOR_VERSION, 5) {
+    DEFINES += SENSORD_STATIC_PLUGINS
+    STATIC_PLUGINS_SOURCE = $$OUT_PWD/staticplugins.cpp
+    STATIC_PLUGINS_LINES = "$${LITERAL_HASH}include \"loader.h\"" ""
+    STATIC_PLUGINS_CALLS =
+    for(static_plugin, STATIC_PLUGINS) {
+        plugin_dir = $$section(static_plugin, :, 0, 0)
+        plugin_name = $$section(static_plugin, :, 1, 1)
+        plugin_class = $$section(static_plugin, :, 2, 2)
+        LIBS += ../$$plugin_dir/lib$${plugin_name}-qt5.a
+        PRE_TARGETDEPS += ../$$plugin_dir/lib$${plugin_name}-qt5.a
+        STATIC_PLUGINS_LINES += "extern const QStaticPlugin qt_static_plugin_$${plugin_class}();"
+        STATIC_PLUGINS_CALLS += "    Loader::instance().registerStaticPlugin(\"$$plugin_name\", qt_static_plugin_$${plugin_class}().instance);"
+    }
+    STATIC_PLUGINS_LINES += "" "void registerStaticPlugins()" "{" $$STATIC_PLUGINS_CALLS "}"
+    write_file($$STATIC_PLUGINS_SOURCE, STATIC_PLUGINS_LINES)|error("Failed to write $$STATIC_PLUGINS_SOURCE")
+    SOURCES += $$STATIC_PLUGINS_SOURCE
+}
+
 TARGET_H.files = $$HEADERS
 target.path = /usr/sbin/
 
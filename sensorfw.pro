@@ -7,12 +7,24 @@ SUBDIRS = datatypes \
           sensors \
           sensord \
           qt-api \
+          c-api \
           chains \
           tests \
           examples
 
+# Plugins linked into sensord are built before it
+static_plugins {
+    SUBDIRS -= sensord tests examples
+    SUBDIRS += sensord tests examples
+}
+
+# Client libraries, tests and examples use the D-Bus interface
+nodbus {
+    SUBDIRS -= qt-api c-api tests examples
+}
+
 equals(QT_MAJOR_VERSION, 4): {
-    SUBDIRS = datatypes qt-api
+    SUBDIRS = datatypes qt-api c-api
 }
 
 contains(CONFIG,hybris) {
@@ -27,7 +39,9 @@ contains(CONFIG,hybris) {
     QTCONFIGFILES.files = sensord.prf
 
     qt-api.depends = datatypes
+    c-api.depends = qt-api
     sensord.depends = datatypes adaptors sensors chains
+    static_plugins: sensord.depends += filters
 
     #include( doc/doc.pri )
     include( common-install.pri )
@@ -80,7 +94,8 @@ equals(QT_MAJOR_VERSION, 5):  {
         SENSORDCONFIGFILES.files = config/90-sensord-default.conf
         SENSORDCONFIGFILES.path = /etc/sensorfw/sensord.conf.d
 
-        INSTALLS += DBUSCONFIGFILES SENSORDCONFIGFILE SENSORDCONFIGFILES
+        INSTALLS += SENSORDCONFIGFILE SENSORDCONFIGFILES
+        !nodbus: INSTALLS += DBUSCONFIGFILES
     }
 }
 
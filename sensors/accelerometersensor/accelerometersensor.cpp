@@ -33,18 +33,20 @@
 
 AccelerometerSensorChannel::AccelerometerSensorChannel(const QString& id) :
         AbstractSensorChannel(id),
-        DataEmitter<AccelerationData>(1),
+        DataEmitter<AccelerationData>(chunkSize(FILTER_BATCH_SIZE)),
         previousSample_(0,0,0,0)
 {
+    NodeArenaScope scope(&arena());
     SensorManager& sm = SensorManager::instance();
 
     accelerometerChain_ = sm.requestChain("accelerometerchain");
     Q_ASSERT( accelerometerChain_ );
     setValid(accelerometerChain_->isValid());
 
-    accelerometerReader_ = new BufferReader<AccelerationData>(1);
+    accelerometerReader_ = new BufferReader<AccelerationData>(chunkSize(FILTER_BATCH_SIZE));
 
-    outputBuffer_ = new RingBuffer<AccelerationData>(1);
+    outputBuffer_ = new RingBuffer<AccelerationData>(chunkSize(FILTER_BATCH_SIZE));
+    nameInternalBuffer("output", outputBuffer_);
 
     // Create buffers for filter chain
     filterBin_ = new Bin;
@@ -113,13 +115,18 @@ void AccelerometerSensorChannel::emitData(const AccelerationData& value)
     downsampleAndPropagate(value, downsampleBuffer_);
 }
 
-void AccelerometerSensorChannel::removeSession(int sessionId)
+void AccelerometerSensorChannel::emitData(const AccelerationData* values, unsigned n)
 {
-    downsampleBuffer_.remove(sessionId);
-    AbstractSensorChannel::removeSession(sessionId);
+    previousSample_ = values[n - 1];
+    downsampleAndPropagate(values, n, downsampleBuffer_);
 }
 
 bool AccelerometerSensorChannel::downsamplingSupported() const
 {
     return true;
 }
+
+bool AccelerometerSensorChannel::motionThresholdSupported() const
+{
+    return true;
+}
@@ -67,10 +67,10 @@ public:
 
     XYZ get() const { return previousSample_; }
 
-    virtual void removeSession(int sessionId);
-
     virtual bool downsamplingSupported() const;
 
+    virtual bool motionThresholdSupported() const;
+
 public Q_SLOTS:
     bool start();
     bool stop();
@@ -97,6 +97,7 @@ private:
     TimedXyzDownsampleBuffer         downsampleBuffer_;
 
     void emitData(const AccelerationData& value);
+    void emitData(const AccelerationData* values, unsigned n);
 };
 
 #endif
@@ -27,8 +27,6 @@
 #ifndef ACCELEROMETER_SENSOR_H
 #define ACCELEROMETER_SENSOR_H
 
-#include <QtDBus/QtDBus>
-
 #include "datatypes/xyz.h"
 #include "abstractsensor_a.h"
 
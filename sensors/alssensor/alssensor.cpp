@@ -28,6 +28,7 @@
 #include "sensormanager.h"
 #include "bin.h"
 #include "bufferreader.h"
+#include "changefilter.h"
 #include "datatypes/orientation.h"
 
 #ifdef PROVIDE_CONTEXT_INFO
@@ -36,7 +37,7 @@
 
 ALSSensorChannel::ALSSensorChannel(const QString& id) :
         AbstractSensorChannel(id),
-        DataEmitter<TimedUnsigned>(1),
+        DataEmitter<TimedUnsigned>(chunkSize(1)),
         previousValue_(0,0)
 #ifdef PROVIDE_CONTEXT_INFO
         ,service(QDBusConnection::systemBus()),
@@ -44,22 +45,29 @@ ALSSensorChannel::ALSSensorChannel(const QString& id) :
         isBrightProperty(service, "Environment.IsBright")
 #endif
 {
+    NodeArenaScope scope(&arena());
     SensorManager& sm = SensorManager::instance();
 
     alsAdaptor_ = sm.requestDeviceAdaptor("alsadaptor");
     Q_ASSERT( alsAdaptor_ );
 
-    alsReader_ = new BufferReader<TimedUnsigned>(1);
+    alsReader_ = new BufferReader<TimedUnsigned>(chunkSize(1));
 
-    outputBuffer_ = new RingBuffer<TimedUnsigned>(1);
+    // Repeated lux values need not wake up the output buffer
+    changeFilter_ = new ChangeFilter<TimedUnsigned>;
+
+    outputBuffer_ = new RingBuffer<TimedUnsigned>(chunkSize(1));
+    nameInternalBuffer("output", outputBuffer_);
 
     // Create buffers for filter chain
     filterBin_ = new Bin;
 
     filterBin_->add(alsReader_, "als");
+    filterBin_->add(changeFilter_, "changes");
     filterBin_->add(outputBuffer_, "buffer");
 
-    filterBin_->join("als", "source", "buffer", "sink");
+    filterBin_->join("als", "source", "changes", "sink");
+    filterBin_->join("changes", "source", "buffer", "sink");
 
     // Join datasources to the chain
     connectToSource(alsAdaptor_, "als", alsReader_);
@@ -100,6 +108,7 @@ ALSSensorChannel::~ALSSensorChannel()
     sm.releaseDeviceAdaptor("alsadaptor");
 
     delete alsReader_;
+    delete changeFilter_;
     delete outputBuffer_;
     delete marshallingBin_;
     delete filterBin_;
@@ -129,12 +138,17 @@ bool ALSSensorChannel::stop()
     return true;
 }
 
+bool ALSSensorChannel::changeThresholdSupported() const
+{
+    return true;
+}
+
 void ALSSensorChannel::emitData(const TimedUnsigned& value)
 {
     if (value.value_ != previousValue_.value_) {
         previousValue_.value_ = value.value_;
 
-        writeToClients((const void*)(&value), sizeof(value));
+        writeChangesToClients((const void*)(&value), sizeof(value), value.value_);
     }
 
 #ifdef PROVIDE_CONTEXT_INFO
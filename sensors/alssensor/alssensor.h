@@ -75,6 +75,8 @@ public:
      */
     Unsigned lux() const { return previousValue_; }
 
+    virtual bool changeThresholdSupported() const;
+
 public Q_SLOTS:
     bool start();
     bool stop();
@@ -96,6 +98,7 @@ private:
     Bin*                          marshallingBin_;
     DeviceAdaptor*                alsAdaptor_;
     BufferReader<TimedUnsigned>*  alsReader_;
+    FilterBase*                   changeFilter_;
     RingBuffer<TimedUnsigned>*    outputBuffer_;
 
     void emitData(const TimedUnsigned& value);
@@ -27,7 +27,6 @@
 #ifndef ALS_SENSOR_H
 #define ALS_SENSOR_H
 
-#include <QtDBus/QtDBus>
 #include <QObject>
 
 #include "datatypes/unsigned.h"
@@ -32,18 +32,20 @@
 
 CompassSensorChannel::CompassSensorChannel(const QString& id) :
         AbstractSensorChannel(id),
-        DataEmitter<CompassData>(1),
+        DataEmitter<CompassData>(chunkSize(FILTER_BATCH_SIZE)),
         compassData(0, -1, -1)
 {
+    NodeArenaScope scope(&arena());
     SensorManager& sm = SensorManager::instance();
 
     compassChain_ = sm.requestChain("compasschain");
     Q_ASSERT( compassChain_ );
     setValid(compassChain_->isValid());
 
-    inputReader_ = new BufferReader<CompassData>(1);
+    inputReader_ = new BufferReader<CompassData>(chunkSize(FILTER_BATCH_SIZE));
 
-    outputBuffer_ = new RingBuffer<CompassData>(1);
+    outputBuffer_ = new RingBuffer<CompassData>(chunkSize(FILTER_BATCH_SIZE));
+    nameInternalBuffer("output", outputBuffer_);
 
     // Create buffers for filter chain
     filterBin_ = new Bin;
@@ -116,3 +118,9 @@ void CompassSensorChannel::emitData(const CompassData& value)
     compassData = value;
     writeToClients((const void*)(&value), sizeof(CompassData));
 }
+
+void CompassSensorChannel::emitData(const CompassData* values, unsigned n)
+{
+    compassData = values[n - 1];
+    writeToClients((const void*)values, sizeof(CompassData), n);
+}
@@ -90,6 +90,7 @@ private:
     RingBuffer<CompassData>* outputBuffer_;
 
     void emitData(const CompassData& value);
+    void emitData(const CompassData* values, unsigned n);
 };
 
 #endif
@@ -27,7 +27,6 @@
 #ifndef COMPASS_SENSOR_H
 #define COMPASS_SENSOR_H
 
-#include <QtDBus/QtDBus>
 #include "abstractsensor_a.h"
 #include "datatypes/compass.h"
 
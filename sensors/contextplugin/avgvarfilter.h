@@ -25,31 +25,131 @@
 #ifndef AVGVARFILTER_H
 #define AVGVARFILTER_H
 
-#include "filter.h"
+#include "staticchain.h"
+#include "runningstatistics.h"
 
 #include <QPair>
-#include <QVector>
-#include <QMutex>
 
-class AvgVarFilter : public QObject, public Filter<double, AvgVarFilter, QPair<double, double> >
+/*!
+
+    \class SlidingVariance
+
+    \brief Moving average and variance over the last SIZE samples.
+
+    The window is updated with RunningStatistics, replacing the oldest
+    sample by the newest one once the window is full.
+
+*/
+
+template <int SIZE>
+class SlidingVariance
 {
-    Q_OBJECT
+public:
+    SlidingVariance() { reset(); }
+
+    /*!
+        Forget all samples.
+    */
+    void reset()
+    {
+        current = 0;
+        stats.reset();
+    }
+
+    /*!
+        Add sample to the window, replacing the oldest one once the
+        window is full.
+
+        \return true if the window was full before the sample.
+    */
+    bool add(double value)
+    {
+        // Ramp-up-phase:
+        if (stats.count() < SIZE) {
+            samples[stats.count()] = value;
+            stats.add(value);
+            return false;
+        }
+
+        stats.replace(samples[current], value);
+        samples[current] = value;
+        if (++current >= SIZE)
+            current = 0;
+        return true;
+    }
+
+    /*!
+        \return average of the samples in the window.
+    */
+    double average() const { return stats.mean(); }
+
+    /*!
+        \return sample variance of the samples in the window.
+    */
+    double variance() const { return stats.variance(); }
+
+private:
+    int current;             /*!< index of the oldest sample once full */
+    RunningStatistics stats; /*!< mean and variance of the window */
+    double samples[SIZE];    /*!< window of samples */
+};
+
+/*!
+
+    \class AvgVarStage
 
+    \brief Stage computing moving average and variance of SIZE samples.
+
+    Outputs pairs of average and variance for each sample that arrives
+    after the window of SIZE samples has been filled. The stage is fed
+    by a single reader thread; reset() must be called while no data
+    flows into it.
+
+*/
+
+template <int SIZE>
+class AvgVarStage
+{
 public:
-    AvgVarFilter(int samples);
-    void reset();
+    typedef double                 Input;
+    typedef QPair<double, double>  Output;
+
+    static const char* name() { return "avgvar"; }
+
+    // Start the ramp-up again
+    void reset()
+    {
+        window.reset();
+    }
+
+    template <class NEXT>
+    void process(const double& data, NEXT& next)
+    {
+        if (window.add(data))
+            next(QPair<double, double>(window.average(), window.variance()));
+    }
 
 private:
-    int size;
-    int samplesReceived;
-    int current;
-    QVector<double> samples;
-    QVector<double> samplesSquared;
-    double sampleSum;
-    double sampleSquareSum;
-    QMutex mutex;
-
-    void interpret(unsigned, const double* data);
+    SlidingVariance<SIZE> window;
+};
+
+/*!
+
+    \class AvgVarFilter
+
+    \brief Filter running AvgVarStage.
+
+*/
+
+template <int SIZE>
+class AvgVarFilter : public StaticChainFilter<AvgVarStage<SIZE> >
+{
+public:
+    // Start the ramp-up again
+    void reset()
+    {
+        this->pipe().reset();
+    }
 };
 
 #endif
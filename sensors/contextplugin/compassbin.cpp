@@ -26,12 +26,16 @@
 #include "compassbin.h"
 #include "contextplugin.h"
 #include "sensormanager.h"
+#include "config.h"
+
+const int CompassBin::HEADING_INTERVAL = 250;
 
 CompassBin::CompassBin(ContextProvider::Service& s, bool pluginValid):
     headingProperty(s, "Location.Heading"),
+    headingPublisher(headingProperty),
     compassChain(0),
     compassReader(10),
-    headingFilter(&headingProperty),
+    headingFilter(&headingPublisher),
     sessionId(0)
 {
     if (pluginValid)
@@ -68,6 +72,12 @@ void CompassBin::startRun()
         return;
     }
 
+    // Heading is updated at its own rate, whatever other clients of
+    // the compass request
+    unsigned int interval = Config::configuration()->value("context/heading_interval", QVariant(HEADING_INTERVAL)).toUInt();
+    compassReader.setInterval(interval);
+    compassReader.reset();
+
     RingBufferBase* rb = compassChain->findBuffer("truenorth");
     if (!rb)
     {
@@ -80,6 +90,7 @@ void CompassBin::startRun()
 
     start();
     compassChain->start();
+    compassChain->setIntervalRequest(sessionId, interval);
 }
 
 void CompassBin::stopRun()
@@ -93,6 +104,7 @@ void CompassBin::stopRun()
         {
             rb->unjoin(&compassReader);
         }
+        compassChain->removeSession(sessionId);
         SensorManager::instance().releaseChain("compasschain");
         compassChain = NULL;
     }
@@ -30,6 +30,7 @@
 #include "datatypes/orientationdata.h"
 
 #include "headingfilter.h"
+#include "propertypublisher.h"
 
 #include <ContextProvider>
 
@@ -40,6 +41,9 @@ class CompassBin : public QObject, Bin
     Q_OBJECT
 
 public:
+    using Bin::operator new;
+    using Bin::operator delete;
+
     CompassBin(ContextProvider::Service& service, bool pluginValid = true);
     ~CompassBin();
 
@@ -48,13 +52,16 @@ private Q_SLOTS:
     void stopRun();
 
 private:
-    Property headingProperty;
+    ContextProvider::Property headingProperty;
+    PropertyPublisher headingPublisher;
 
     AbstractChain* compassChain;
-    BufferReader<CompassData> compassReader;
+    DecimatingReader<CompassData> compassReader;
     HeadingFilter headingFilter;
 
     int sessionId;
+
+    static const int HEADING_INTERVAL;
 };
 
 #endif
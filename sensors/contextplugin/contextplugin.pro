@@ -16,7 +16,8 @@ HEADERS += contextplugin.h \
            avgvarfilter.h \
            cutterfilter.h \
            stabilityfilter.h \
-           headingfilter.h
+           headingfilter.h \
+           propertypublisher.h
 
 
 SOURCES += contextplugin.cpp \
@@ -26,10 +27,10 @@ SOURCES += contextplugin.cpp \
            contextsensor.cpp \
            screeninterpreterfilter.cpp \
            normalizerfilter.cpp \
-           avgvarfilter.cpp \
            cutterfilter.cpp \
            stabilityfilter.cpp \
-           headingfilter.cpp
+           headingfilter.cpp \
+           propertypublisher.cpp
 
 CONTEXT.files = 'com.nokia.SensorService.context'
 CONTEXT.path = '/usr/share/contextkit/providers'
@@ -24,15 +24,7 @@
 
 #include "cutterfilter.h"
 
-CutterFilter::CutterFilter(double divider) :
-    Filter<double, CutterFilter, double>(this, &CutterFilter::interpret),
-    divider(divider)
+CutterFilter::CutterFilter(double divider)
 {
-    //qDebug() << "Creating the CutterFilter";
-}
-
-void CutterFilter::interpret(unsigned, const double* data)
-{
-    double n = *data / divider;
-    source_.propagate(1, &n);
+    pipe().setDivider(divider);
 }
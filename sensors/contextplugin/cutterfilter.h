@@ -25,18 +25,39 @@
 #ifndef CUTTERFILTER_H
 #define CUTTERFILTER_H
 
-#include "filter.h"
+#include "staticchain.h"
 
-class CutterFilter : public QObject, public Filter<double, CutterFilter, double>
+/**
+ * Stage dividing values by a constant.
+ */
+class CutterStage
 {
-    Q_OBJECT
-
 public:
-    CutterFilter(double divider);
+    typedef double Input;
+    typedef double Output;
+
+    CutterStage() : divider(1) {}
+
+    static const char* name() { return "cutter"; }
+
+    void setDivider(double value) { divider = value; }
+
+    template <class NEXT>
+    void process(const double& data, NEXT& next)
+    {
+        next(data / divider);
+    }
 
 private:
-    void interpret(unsigned, const double* data);
     double divider;
 };
 
+class CutterFilter : public QObject, public StaticChainFilter<CutterStage>
+{
+    Q_OBJECT
+
+public:
+    CutterFilter(double divider);
+};
+
 #endif
@@ -28,20 +28,18 @@
 #include "filter.h"
 #include "datatypes/orientationdata.h"
 
-#include <ContextProvider>
-
-using ContextProvider::Property;
+#include "propertypublisher.h"
 
 class HeadingFilter : public QObject, public Filter<CompassData, HeadingFilter, CompassData>
 {
     Q_OBJECT
 
 public:
-    HeadingFilter(Property* headingProperty);
+    HeadingFilter(PropertyPublisher* headingProperty);
     void reset();
 
 private:
-    Property* headingProperty;
+    PropertyPublisher* headingProperty;
     void interpret(unsigned, const CompassData* data);
 };
 
@@ -23,24 +23,6 @@
 */
 
 #include "normalizerfilter.h"
-#include "genericdata.h"
-#include "logging.h"
-#include <math.h>
 
-NormalizerFilter::NormalizerFilter() :
-        Filter<TimedXyzData, NormalizerFilter, double>(this, &NormalizerFilter::interpret),
-        prevTime(0)
+NormalizerFilter::NormalizerFilter()
 {}
-
-void NormalizerFilter::interpret(unsigned, const TimedXyzData* data)
-{
-    // Subsample to 1hz rate.
-    if (data->timestamp_ - prevTime > 1000000 || prevTime == 0)
-    {
-        double n = sqrt(data->x_ * data->x_ + data->y_ * data->y_ + data->z_ * data-> z_);
-        source_.propagate(1, &n);
-        prevTime = data->timestamp_;
-    } else {
-        sensordLogT() << "Discarded sample from normalizer due to too short time delta.";
-    }
-}
@@ -25,19 +25,47 @@
 #ifndef NORMALIZERFILTER_H
 #define NORMALIZERFILTER_H
 
-#include "filter.h"
+#include "staticchain.h"
 #include "orientationdata.h"
+#include "logging.h"
+#include <math.h>
 
-class NormalizerFilter : public QObject, public Filter<TimedXyzData, NormalizerFilter, double>
+/**
+ * Stage computing the magnitude of acceleration, subsampled to 1 Hz.
+ */
+class NormalizerStage
 {
-    Q_OBJECT
-
 public:
-    NormalizerFilter();
+    typedef TimedXyzData Input;
+    typedef double       Output;
+
+    NormalizerStage() : prevTime(0) {}
+
+    static const char* name() { return "normalizer"; }
+
+    template <class NEXT>
+    void process(const TimedXyzData& data, NEXT& next)
+    {
+        // Subsample to 1hz rate.
+        if (data.timestamp_ - prevTime > 1000000 || prevTime == 0)
+        {
+            next(sqrt(data.x_ * data.x_ + data.y_ * data.y_ + data.z_ * data.z_));
+            prevTime = data.timestamp_;
+        } else {
+            sensordLogT() << "Discarded sample from normalizer due to too short time delta.";
+        }
+    }
 
 private:
-    void interpret(unsigned, const TimedXyzData* data);
     quint64 prevTime;
 };
 
+class NormalizerFilter : public QObject, public StaticChainFilter<NormalizerStage>
+{
+    Q_OBJECT
+
+public:
+    NormalizerFilter();
+};
+
 #endif
@@ -34,10 +34,13 @@ OrientationBin::OrientationBin(ContextProvider::Service& s):
     topEdgeProperty(s, "Screen.TopEdge"),
     isCoveredProperty(s, "Screen.IsCovered"),
     isFlatProperty(s, "Position.IsFlat"),
+    topEdgePublisher(topEdgeProperty),
+    isCoveredPublisher(isCoveredProperty),
+    isFlatPublisher(isFlatProperty),
     accelerometerReader(10),
     topEdgeReader(10),
     faceReader(10),
-    screenInterpreterFilter(&topEdgeProperty, &isCoveredProperty, &isFlatProperty),
+    screenInterpreterFilter(&topEdgePublisher, &isCoveredPublisher, &isFlatPublisher),
     sessionId(0)
 {
     add(&topEdgeReader, "topedge");
@@ -56,9 +59,9 @@ OrientationBin::OrientationBin(ContextProvider::Service& s):
     connect(&group, SIGNAL(lastSubscriberDisappeared()), this, SLOT(stopRun()));
 
     // Set default values (if the default isn't Unknown)
-    topEdgeProperty.setValue("top");
-    isCoveredProperty.setValue(false);
-    isFlatProperty.setValue(false);
+    topEdgePublisher.setValue("top");
+    isCoveredPublisher.setValue(false);
+    isFlatPublisher.setValue(false);
 }
 
 OrientationBin::~OrientationBin()
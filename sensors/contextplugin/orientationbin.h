@@ -33,6 +33,7 @@
 #include "posedata.h"
 
 #include "screeninterpreterfilter.h"
+#include "propertypublisher.h"
 
 #include <ContextProvider>
 
@@ -45,6 +46,9 @@ class OrientationBin : public QObject, Bin
     Q_OBJECT
 
 public:
+    using Bin::operator new;
+    using Bin::operator delete;
+
     OrientationBin(ContextProvider::Service& service);
     ~OrientationBin();
 
@@ -56,6 +60,9 @@ private:
     ContextProvider::Property topEdgeProperty;
     ContextProvider::Property isCoveredProperty;
     ContextProvider::Property isFlatProperty;
+    PropertyPublisher topEdgePublisher;
+    PropertyPublisher isCoveredPublisher;
+    PropertyPublisher isFlatPublisher;
     ContextProvider::Group group;
 
     BufferReader<AccelerationData> accelerometerReader;
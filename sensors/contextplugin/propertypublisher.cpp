@@ -0,0 +1,82 @@
+/**
+   @file propertypublisher.cpp
+   @brief Change driven, rate limited context property publication
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "propertypublisher.h"
+#include "config.h"
+
+const int PropertyPublisher::DEFAULT_MIN_INTERVAL = 200;
+
+PropertyPublisher::PropertyPublisher(ContextProvider::Property& property) :
+    property_(property),
+    minInterval_(Config::configuration()->value("context/min_publish_interval", QVariant(DEFAULT_MIN_INTERVAL)).toInt()),
+    publishedAt_(0)
+{
+    timer_.setSingleShot(true);
+    connect(&timer_, SIGNAL(timeout()), this, SLOT(publishHeld()));
+}
+
+void PropertyPublisher::setValue(const QVariant& value)
+{
+    if (value == published_) {
+        // Change held for the interval was taken back
+        if (held_.isValid()) {
+            held_ = QVariant();
+            timer_.stop();
+        }
+        return;
+    }
+
+    quint64 elapsed = Clock::monotonicMs() - publishedAt_;
+    if (!published_.isValid() || minInterval_ <= 0 || elapsed >= (quint64)minInterval_) {
+        publish(value);
+        return;
+    }
+
+    held_ = value;
+    if (!timer_.isActive())
+        timer_.start(minInterval_ - elapsed);
+}
+
+void PropertyPublisher::unsetValue()
+{
+    timer_.stop();
+    held_ = QVariant();
+    published_ = QVariant();
+    property_.unsetValue();
+}
+
+void PropertyPublisher::publishHeld()
+{
+    if (!held_.isValid())
+        return;
+    QVariant value(held_);
+    held_ = QVariant();
+    publish(value);
+}
+
+void PropertyPublisher::publish(const QVariant& value)
+{
+    timer_.stop();
+    held_ = QVariant();
+    published_ = value;
+    publishedAt_ = Clock::monotonicMs();
+    property_.setValue(value);
+}
@@ -0,0 +1,91 @@
+/**
+   @file propertypublisher.h
+   @brief Change driven, rate limited context property publication
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef PROPERTYPUBLISHER_H
+#define PROPERTYPUBLISHER_H
+
+#include "clock.h"
+
+#include <ContextProvider>
+
+#include <QVariant>
+
+/**
+ * Publishes values of a context property for the filters of the sample
+ * path. A value equal to the published one is dropped without touching
+ * ContextKit. The first value after unsetValue() is published at once,
+ * later changes at most once per minimum interval: a change arriving
+ * sooner is held and the latest held value published when the interval
+ * has passed, unless the property has changed back by then.
+ *
+ * The interval is read from context/min_publish_interval in milliseconds,
+ * 0 publishes every change at once.
+ */
+class PropertyPublisher : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(PropertyPublisher)
+
+public:
+    /**
+     * Constructor.
+     *
+     * @param property published property, must outlive the publisher.
+     */
+    PropertyPublisher(ContextProvider::Property& property);
+
+    /**
+     * Publish value if it differs from the published one.
+     *
+     * @param value property value.
+     */
+    void setValue(const QVariant& value);
+
+    /**
+     * Unset the property at once and drop a held value.
+     */
+    void unsetValue();
+
+private Q_SLOTS:
+    /**
+     * Publish held value when the minimum interval has passed.
+     */
+    void publishHeld();
+
+private:
+    /**
+     * Publish value and start a new interval.
+     *
+     * @param value property value.
+     */
+    void publish(const QVariant& value);
+
+    ContextProvider::Property& property_; /**< published property */
+    int      minInterval_; /**< least milliseconds between publications */
+    QVariant published_;   /**< published value, invalid when unset */
+    QVariant held_;        /**< value waiting for the interval, invalid if none */
+    quint64  publishedAt_; /**< time of the last publication, ms */
+    ClockTimer timer_;     /**< end of the interval when a value is held */
+
+    static const int DEFAULT_MIN_INTERVAL;
+};
+
+#endif // PROPERTYPUBLISHER_H
@@ -28,14 +28,12 @@
 #include "config.h"
 #include "logging.h"
 
-#include <ContextProvider>
-
 const char* ScreenInterpreterFilter::orientationValues[4] = {"left", "top", "right", "bottom"};
 
 ScreenInterpreterFilter::ScreenInterpreterFilter(
-    ContextProvider::Property* topEdgeProperty,
-    ContextProvider::Property* isCoveredProperty,
-    ContextProvider::Property* isFlatProperty) :
+    PropertyPublisher* topEdgeProperty,
+    PropertyPublisher* isCoveredProperty,
+    PropertyPublisher* isFlatProperty) :
     Filter<PoseData, ScreenInterpreterFilter, PoseData>(this, &ScreenInterpreterFilter::interpret),
     topEdgeProperty(topEdgeProperty),
     isCoveredProperty(isCoveredProperty),
@@ -50,11 +48,13 @@ ScreenInterpreterFilter::ScreenInterpreterFilter(
     offset = Config::configuration()->value("context/orientation_offset", QVariant(0)).toInt();
 }
 
-void ScreenInterpreterFilter::interpret(unsigned, const PoseData* data)
+void ScreenInterpreterFilter::interpret(unsigned n, const PoseData* data)
 {
-    sensordLogT() << "Data received on ScreenInterpreter... " << data->timestamp_;
-    provideScreenData(data->orientation_);
-    source_.propagate(1, data);
+    for (unsigned i = 0; i < n; ++i) {
+        sensordLogT() << "Data received on ScreenInterpreter... " << data[i].timestamp_;
+        provideScreenData(data[i].orientation_);
+    }
+    source_.propagate(n, data);
 }
 
 void ScreenInterpreterFilter::provideScreenData(PoseData::Orientation orientation)
@@ -30,7 +30,7 @@
 #include "filter.h"
 #include "posedata.h"
 
-#include <ContextProvider>
+#include "propertypublisher.h"
 
 /*!
 
@@ -49,12 +49,12 @@ class ScreenInterpreterFilter : public QObject, public Filter<PoseData, ScreenIn
     Q_OBJECT
 
 public:
-    ScreenInterpreterFilter(ContextProvider::Property* topEdgeProperty, ContextProvider::Property* isCoveredProperty, ContextProvider::Property* isFlatProperty);
+    ScreenInterpreterFilter(PropertyPublisher* topEdgeProperty, PropertyPublisher* isCoveredProperty, PropertyPublisher* isFlatProperty);
 
 private:
-    ContextProvider::Property* topEdgeProperty;
-    ContextProvider::Property* isCoveredProperty;
-    ContextProvider::Property* isFlatProperty;
+    PropertyPublisher* topEdgeProperty;
+    PropertyPublisher* isCoveredProperty;
+    PropertyPublisher* isFlatProperty;
     void interpret(unsigned, const PoseData* data);
     void provideScreenData(PoseData::Orientation orientation);
 
@@ -30,6 +30,7 @@
 #include "config.h"
 #include "logging.h"
 
+const int StabilityBin::SAMPLE_INTERVAL = 100;
 const int StabilityBin::STABILITY_THRESHOLD = 7;
 const int StabilityBin::UNSTABILITY_THRESHOLD = 300;
 const float StabilityBin::STABILITY_HYSTERESIS = 0.1;
@@ -37,22 +38,21 @@ const float StabilityBin::STABILITY_HYSTERESIS = 0.1;
 StabilityBin::StabilityBin(ContextProvider::Service& s):
     isStableProperty(s, "Position.Stable"),
     isShakyProperty(s, "Position.Shaky"),
+    isStablePublisher(isStableProperty),
+    isShakyPublisher(isShakyProperty),
     accelerometerReader(10),
-    cutterFilter(4.0),
-    avgVarFilter(60),
-    stabilityFilter(&isStableProperty, &isShakyProperty, STABILITY_THRESHOLD, UNSTABILITY_THRESHOLD, STABILITY_HYSTERESIS),
+    stabilityFilter(&isStablePublisher, &isShakyPublisher, STABILITY_THRESHOLD, UNSTABILITY_THRESHOLD, STABILITY_HYSTERESIS),
     sessionId(0)
 {
+    avgVarFilter.pipe().second().first().setDivider(4.0);
+
     add(&accelerometerReader, "accelerometer");
-    add(&normalizerFilter, "normalizerfilter");
-    add(&cutterFilter, "cutterfilter");
     add(&avgVarFilter, "avgvarfilter");
     add(&stabilityFilter, "stabilityfilter");
 
-    join("accelerometer", "source", "normalizerfilter", "sink");
-    join("normalizerfilter", "source", "cutterfilter", "sink");
-    join("cutterfilter", "source", "avgvarfilter", "sink");
+    join("accelerometer", "source", "avgvarfilter", "sink");
     join("avgvarfilter", "source", "stabilityfilter", "sink");
+    sensordLogD() << "Stability pipeline:" << avgVarFilter.stageNames().join(" -> ");
 
     // Context group
     group.add(isStableProperty);
@@ -82,6 +82,17 @@ void StabilityBin::startRun()
         return;
     }
 
+    // Reset the status of the avg & var computation before samples
+    // flow in; reset default values for properties whose values aren't
+    // reliable after a restart
+    avgVarFilter.pipe().second().second().reset();
+
+    // Stability is judged at its own rate, whatever other clients of
+    // the accelerometer request
+    unsigned int interval = Config::configuration()->value("context/stability_interval", QVariant(SAMPLE_INTERVAL)).toUInt();
+    accelerometerReader.setInterval(interval);
+    accelerometerReader.reset();
+
     RingBufferBase* rb = accelerometerAdaptor->findBuffer("accelerometer");
     if (!rb)
     {
@@ -90,15 +101,12 @@ void StabilityBin::startRun()
         rb->join(&accelerometerReader);
     }
 
-    // Reset the status of the avg & var computation; reset default
-    // values for properties whose values aren't reliable after a
-    // restart
-    avgVarFilter.reset();
-    isStableProperty.unsetValue();
-    isShakyProperty.unsetValue();
+    isStablePublisher.unsetValue();
+    isShakyPublisher.unsetValue();
     start();
     accelerometerAdaptor->startSensor();
     accelerometerAdaptor->setStandbyOverrideRequest(sessionId, true);
+    accelerometerAdaptor->setIntervalRequest(sessionId, interval);
 }
 
 void StabilityBin::stopRun()
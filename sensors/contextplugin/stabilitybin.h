@@ -36,6 +36,7 @@
 #include "cutterfilter.h"
 #include "avgvarfilter.h"
 #include "stabilityfilter.h"
+#include "propertypublisher.h"
 
 #include <ContextProvider>
 
@@ -43,11 +44,21 @@
 
 class DeviceAdaptor;
 
+/**
+ * Acceleration magnitude to moving average and variance, composed at
+ * compile time from the stages of the normalizer, cutter and avgvar
+ * filters.
+ */
+typedef StaticChain<NormalizerStage, StaticChain<CutterStage, AvgVarStage<60> > > StabilityPipe;
+
 class StabilityBin : public QObject, Bin
 {
     Q_OBJECT
 
 public:
+    using Bin::operator new;
+    using Bin::operator delete;
+
     StabilityBin(ContextProvider::Service& service);
     ~StabilityBin();
 
@@ -58,18 +69,19 @@ private Q_SLOTS:
 private:
     ContextProvider::Property isStableProperty;
     ContextProvider::Property isShakyProperty;
+    PropertyPublisher isStablePublisher;
+    PropertyPublisher isShakyPublisher;
     ContextProvider::Group group;
 
-    BufferReader<AccelerationData> accelerometerReader;
+    DecimatingReader<AccelerationData> accelerometerReader;
     DeviceAdaptor* accelerometerAdaptor;
 
-    NormalizerFilter normalizerFilter;
-    CutterFilter cutterFilter;
-    AvgVarFilter avgVarFilter;
+    StaticChainFilter<StabilityPipe> avgVarFilter;
     StabilityFilter stabilityFilter;
 
     int sessionId;
 
+    static const int SAMPLE_INTERVAL;
     static const int STABILITY_THRESHOLD;
     static const int UNSTABILITY_THRESHOLD;
     static const float STABILITY_HYSTERESIS;
@@ -28,50 +28,64 @@
 
 const int StabilityFilter::defaultTimeout = 60; // seconds
 
-StabilityFilter::StabilityFilter(Property* stableProperty, Property* unstableProperty,
+StabilityFilter::StabilityFilter(PropertyPublisher* stableProperty, PropertyPublisher* unstableProperty,
                                  double lowThreshold, double highThreshold, double hysteresis)
     : Filter<QPair<double, double>, StabilityFilter, QPair<double, double> >(this, &StabilityFilter::interpret),
       lowThreshold(lowThreshold),
       highThreshold(highThreshold),
       hysteresis(hysteresis),
       stableProperty(stableProperty),
-      unstableProperty(unstableProperty)
+      unstableProperty(unstableProperty),
+      lastUnsteady(0)
 {
+    timer.setSingleShot(true);
     connect(&timer, SIGNAL(timeout()), this, SLOT(timeoutTriggered()));
     timeout = Config::configuration()->value("context/stability_timeout", QVariant(defaultTimeout)).toInt() * 1000;
 }
 
-void StabilityFilter::interpret(unsigned, const QPair<double, double>* data)
+void StabilityFilter::interpret(unsigned n, const QPair<double, double>* data)
 {
-    // To take into account hysteresis and keep it simple, compute
-    // stability and instability separately
-    if (data->second < lowThreshold * (1 - hysteresis)) {
-        stableProperty->setValue(true);
-        timer.stop();
-    }
-    else {
-        timer.start(timeout);
+    for (unsigned i = 0; i < n; ++i) {
+        // To take into account hysteresis and keep it simple, compute
+        // stability and instability separately
+        if (data[i].second < lowThreshold * (1 - hysteresis)) {
+            stableProperty->setValue(true);
+            if (timer.isActive())
+                timer.stop();
+        }
+        else {
+            // Timer runs from the first unsteady sample, the timeout
+            // checks whether later ones have moved the deadline
+            lastUnsteady = Clock::monotonicMs();
+            if (!timer.isActive())
+                timer.start(timeout);
 
-        if (data->second > lowThreshold * (1 + hysteresis)) {
-            stableProperty->setValue(false);
+            if (data[i].second > lowThreshold * (1 + hysteresis)) {
+                stableProperty->setValue(false);
+            }
         }
-    }
 
-    if (data->second < highThreshold * (1 - hysteresis)) {
-        unstableProperty->setValue(false);
-    }
-    else if (data->second > highThreshold * (1 + hysteresis)) {
-        unstableProperty->setValue(true);
+        if (data[i].second < highThreshold * (1 - hysteresis)) {
+            unstableProperty->setValue(false);
+        }
+        else if (data[i].second > highThreshold * (1 + hysteresis)) {
+            unstableProperty->setValue(true);
+        }
     }
 
     // Propagate the data further without changing it
-    source_.propagate(1, data);
+    source_.propagate(n, data);
 }
 
 void StabilityFilter::timeoutTriggered()
 {
+    quint64 elapsed = Clock::monotonicMs() - lastUnsteady;
+    if (elapsed < (quint64)timeout) {
+        timer.start(timeout - elapsed);
+        return;
+    }
+
     sensordLogT() << "Stationary timeout triggered.";
 
     stableProperty->setValue(true);
-    timer.stop();
 }
@@ -26,11 +26,10 @@
 #define STABILITYFILTER_H
 
 #include "filter.h"
-
-#include <ContextProvider>
+#include "clock.h"
+#include "propertypublisher.h"
 
 #include <QPair>
-#include <QTimer>
 
 /*!
 
@@ -43,16 +42,19 @@
     variance of the data. StabilityFilter pushes the data forward
     unchanged.
 
-*/
+    Orientation.IsStable is set while the variance is low, or
+    when no samples have arrived for the stability timeout since the
+    last unsteady one. The timeout timer is armed when the variance
+    rises, not on every sample.
 
-using ContextProvider::Property;
+*/
 
 class StabilityFilter : public QObject, public Filter<QPair<double, double>, StabilityFilter, QPair<double, double> >
 {
     Q_OBJECT
 
 public:
-    StabilityFilter(Property* stableProperty, Property* unstableProperty,
+    StabilityFilter(PropertyPublisher* stableProperty, PropertyPublisher* unstableProperty,
                     double lowThreshold, double highThreshold, double hysteresis = 0.0);
 
 public Q_SLOTS:
@@ -62,10 +64,11 @@ private:
     double lowThreshold;
     double highThreshold;
     double hysteresis;
-    Property* stableProperty;
-    Property* unstableProperty;
+    PropertyPublisher* stableProperty;
+    PropertyPublisher* unstableProperty;
     void interpret(unsigned, const QPair<double, double>* data);
-    QTimer timer;
+    ClockTimer timer;
+    quint64 lastUnsteady; /**< time of the last unsteady sample, ms */
 
     int timeout;
     static const int defaultTimeout;
@@ -0,0 +1,185 @@
+/**
+   @file fusionsensor.cpp
+   @brief FusionSensor
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "fusionsensor.h"
+#include "sensormanager.h"
+#include "bin.h"
+#include "bufferreader.h"
+
+FusionSensorChannel::FusionSensorChannel(const QString& id) :
+        AbstractSensorChannel(id),
+        DataEmitter<FusionData>(chunkSize(FILTER_BATCH_SIZE)),
+        gyroscopeReader_(NULL),
+        magnetometerReader_(NULL)
+{
+    NodeArenaScope scope(&arena());
+    SensorManager& sm = SensorManager::instance();
+
+    accelerometerChain_ = sm.requestChain("accelerometerchain");
+    Q_ASSERT( accelerometerChain_ );
+    setValid(accelerometerChain_->isValid());
+
+    accelerometerReader_ = new BufferReader<AccelerationData>(chunkSize(FILTER_BATCH_SIZE));
+
+    gyroscopeAdaptor_ = sm.requestDeviceAdaptor("gyroscopeadaptor");
+    if (gyroscopeAdaptor_ && gyroscopeAdaptor_->isValid()) {
+        gyroscopeReader_ = new BufferReader<TimedXyzData>(chunkSize(FILTER_BATCH_SIZE));
+    } else {
+        sensordLogW() << "Unable to use gyroscope for fusion.";
+    }
+
+    magnetometerChain_ = sm.requestChain("magcalibrationchain");
+    if (magnetometerChain_ && magnetometerChain_->isValid()) {
+        magnetometerReader_ = new BufferReader<CalibratedMagneticFieldData>(chunkSize(FILTER_BATCH_SIZE));
+    } else {
+        sensordLogW() << "Unable to use magnetometer for fusion.";
+    }
+
+    syncFilter_ = sm.instantiateFilter("syncfilter");
+    Q_ASSERT(syncFilter_);
+
+    outputBuffer_ = new RingBuffer<FusionData>(chunkSize(FILTER_BATCH_SIZE));
+    nameInternalBuffer("output", outputBuffer_);
+
+    // Create buffers for filter chain
+    filterBin_ = new Bin;
+
+    filterBin_->add(accelerometerReader_, "accelerometer");
+    filterBin_->add(syncFilter_, "syncfilter");
+    filterBin_->add(outputBuffer_, "buffer");
+
+    filterBin_->join("accelerometer", "source", "syncfilter", "accelerometersink");
+    filterBin_->join("syncfilter", "source", "buffer", "sink");
+    connectToSource(accelerometerChain_, "accelerometer", accelerometerReader_);
+
+    if (hasGyroscope())
+    {
+        filterBin_->add(gyroscopeReader_, "gyroscope");
+        filterBin_->join("gyroscope", "source", "syncfilter", "gyroscopesink");
+        connectToSource(gyroscopeAdaptor_, "gyroscope", gyroscopeReader_);
+        addStandbyOverrideSource(gyroscopeAdaptor_);
+    }
+
+    if (hasMagnetometer())
+    {
+        filterBin_->add(magnetometerReader_, "magnetometer");
+        filterBin_->join("magnetometer", "source", "syncfilter", "magnetometersink");
+        connectToSource(magnetometerChain_, "calibratedmagnetometerdata", magnetometerReader_);
+        addStandbyOverrideSource(magnetometerChain_);
+    }
+
+    marshallingBin_ = new Bin;
+    marshallingBin_->add(this, "sensorchannel");
+
+    outputBuffer_->join(this);
+
+    setDescription("accelerometer, gyroscope and magnetometer samples aligned to accelerometer timestamps");
+    addStandbyOverrideSource(accelerometerChain_);
+    setIntervalSource(accelerometerChain_);
+}
+
+FusionSensorChannel::~FusionSensorChannel()
+{
+    SensorManager& sm = SensorManager::instance();
+
+    disconnectFromSource(accelerometerChain_, "accelerometer", accelerometerReader_);
+    sm.releaseChain("accelerometerchain");
+
+    if (hasGyroscope())
+    {
+        disconnectFromSource(gyroscopeAdaptor_, "gyroscope", gyroscopeReader_);
+        delete gyroscopeReader_;
+    }
+    if (gyroscopeAdaptor_)
+        sm.releaseDeviceAdaptor("gyroscopeadaptor");
+
+    if (hasMagnetometer())
+    {
+        disconnectFromSource(magnetometerChain_, "calibratedmagnetometerdata", magnetometerReader_);
+        delete magnetometerReader_;
+    }
+    if (magnetometerChain_)
+        sm.releaseChain("magcalibrationchain");
+
+    delete accelerometerReader_;
+    delete syncFilter_;
+    delete outputBuffer_;
+    delete marshallingBin_;
+    delete filterBin_;
+}
+
+bool FusionSensorChannel::start()
+{
+    sensordLogD() << "Starting FusionSensorChannel";
+
+    if (AbstractSensorChannel::start()) {
+        marshallingBin_->start();
+        filterBin_->start();
+        accelerometerChain_->start();
+        if (hasGyroscope())
+            gyroscopeAdaptor_->startSensor();
+        if (hasMagnetometer())
+            magnetometerChain_->start();
+    }
+    return true;
+}
+
+bool FusionSensorChannel::stop()
+{
+    sensordLogD() << "Stopping FusionSensorChannel";
+
+    if (AbstractSensorChannel::stop()) {
+        accelerometerChain_->stop();
+        if (hasGyroscope())
+            gyroscopeAdaptor_->stopSensor();
+        if (hasMagnetometer())
+            magnetometerChain_->stop();
+        filterBin_->stop();
+        marshallingBin_->stop();
+    }
+    return true;
+}
+
+void FusionSensorChannel::emitData(const FusionData& value)
+{
+    writeToClients((const void*)(&value), sizeof(FusionData));
+}
+
+void FusionSensorChannel::emitData(const FusionData* values, unsigned n)
+{
+    writeToClients((const void*)values, sizeof(FusionData), n);
+}
+
+unsigned int FusionSensorChannel::interval() const
+{
+    // Accelerometer samples are the ticks
+    return accelerometerChain_->getInterval();
+}
+
+bool FusionSensorChannel::setInterval(unsigned int value, int sessionId)
+{
+    bool success = accelerometerChain_->setIntervalRequest(sessionId, value);
+    if (hasGyroscope())
+        success = gyroscopeAdaptor_->setIntervalRequest(sessionId, value) && success;
+    if (hasMagnetometer())
+        success = magnetometerChain_->setIntervalRequest(sessionId, value) && success;
+    return success;
+}
@@ -0,0 +1,103 @@
+/**
+   @file fusionsensor.h
+   @brief FusionSensor
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef FUSION_SENSOR_CHANNEL_H
+#define FUSION_SENSOR_CHANNEL_H
+
+#include "abstractsensor.h"
+#include "abstractchain.h"
+#include "deviceadaptor.h"
+#include "fusionsensor_a.h"
+#include "dataemitter.h"
+#include "datatypes/orientationdata.h"
+#include "datatypes/fusiondata.h"
+
+class Bin;
+template <class TYPE> class BufferReader;
+class FilterBase;
+
+/**
+ * @brief Sensor providing synchronized accelerometer, gyroscope and
+ * magnetometer samples.
+ *
+ * Samples of the three sources are aligned to accelerometer timestamps by
+ * SyncFilter and written to clients as one FusionData object per tick.
+ * Missing gyroscope or magnetometer is reported as zero vectors.
+ */
+class FusionSensorChannel :
+        public AbstractSensorChannel,
+        public DataEmitter<FusionData>
+{
+    Q_OBJECT;
+    Q_PROPERTY(bool hasGyroscope READ hasGyroscope);
+    Q_PROPERTY(bool hasMagnetometer READ hasMagnetometer);
+
+public:
+    /**
+     * Factory method for FusionSensorChannel.
+     * @return new FusionSensorChannel as AbstractSensorChannel*.
+     */
+    static AbstractSensorChannel* factoryMethod(const QString& id)
+    {
+        FusionSensorChannel* sc = new FusionSensorChannel(id);
+        new FusionSensorChannelAdaptor(sc);
+
+        return sc;
+    }
+
+    bool hasGyroscope() const
+    {
+        return gyroscopeReader_;
+    }
+
+    bool hasMagnetometer() const
+    {
+        return magnetometerReader_;
+    }
+
+    virtual unsigned int interval() const;
+    virtual bool setInterval(unsigned int value, int sessionId);
+
+public Q_SLOTS:
+    bool start();
+    bool stop();
+
+protected:
+    FusionSensorChannel(const QString& id);
+    virtual ~FusionSensorChannel();
+
+private:
+    Bin*                                        filterBin_;
+    Bin*                                        marshallingBin_;
+    AbstractChain*                              accelerometerChain_;
+    DeviceAdaptor*                              gyroscopeAdaptor_;
+    AbstractChain*                              magnetometerChain_;
+    BufferReader<AccelerationData>*             accelerometerReader_;
+    BufferReader<TimedXyzData>*                 gyroscopeReader_;
+    BufferReader<CalibratedMagneticFieldData>*  magnetometerReader_;
+    FilterBase*                                 syncFilter_;
+    RingBuffer<FusionData>*                     outputBuffer_;
+
+    void emitData(const FusionData& value);
+    void emitData(const FusionData* values, unsigned n);
+};
+
+#endif // FUSION_SENSOR_CHANNEL_H
@@ -0,0 +1,11 @@
+TARGET       = fusionsensor
+
+HEADERS += fusionsensor.h   \
+           fusionsensor_a.h \
+           fusionplugin.h
+
+SOURCES += fusionsensor.cpp   \
+           fusionsensor_a.cpp \
+           fusionplugin.cpp
+
+include( ../sensor-config.pri )
@@ -0,0 +1,37 @@
+/**
+   @file fusionsensor_a.cpp
+   @brief D-Bus adaptor for FusionSensor
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "fusionsensor_a.h"
+
+FusionSensorChannelAdaptor::FusionSensorChannelAdaptor(QObject* parent) :
+    AbstractSensorChannelAdaptor(parent)
+{
+}
+
+bool FusionSensorChannelAdaptor::hasGyroscope() const
+{
+    return qvariant_cast<bool>(parent()->property("hasGyroscope"));
+}
+
+bool FusionSensorChannelAdaptor::hasMagnetometer() const
+{
+    return qvariant_cast<bool>(parent()->property("hasMagnetometer"));
+}
@@ -0,0 +1,43 @@
+/**
+   @file fusionsensor_a.h
+   @brief D-Bus adaptor for FusionSensor
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef FUSION_SENSOR_H
+#define FUSION_SENSOR_H
+
+#include "abstractsensor_a.h"
+
+class FusionSensorChannelAdaptor : public AbstractSensorChannelAdaptor
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(FusionSensorChannelAdaptor)
+    Q_CLASSINFO("D-Bus Interface", "local.FusionSensor")
+    Q_PROPERTY(bool hasGyroscope READ hasGyroscope)
+    Q_PROPERTY(bool hasMagnetometer READ hasMagnetometer)
+
+public:
+    FusionSensorChannelAdaptor(QObject* parent);
+
+public Q_SLOTS:
+    bool hasGyroscope() const;
+    bool hasMagnetometer() const;
+};
+
+#endif
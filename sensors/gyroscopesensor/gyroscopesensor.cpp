@@ -32,17 +32,19 @@
 
 GyroscopeSensorChannel::GyroscopeSensorChannel(const QString& id) :
         AbstractSensorChannel(id),
-        DataEmitter<TimedXyzData>(10),
+        DataEmitter<TimedXyzData>(chunkSize(10)),
         previousSample_()
 {
+    NodeArenaScope scope(&arena());
     SensorManager& sm = SensorManager::instance();
 
     gyroscopeAdaptor_ = sm.requestDeviceAdaptor("gyroscopeadaptor");
     Q_ASSERT( gyroscopeAdaptor_ );
 
-    gyroscopeReader_ = new BufferReader<TimedXyzData>(1);
+    gyroscopeReader_ = new BufferReader<TimedXyzData>(chunkSize(FILTER_BATCH_SIZE));
 
-    outputBuffer_ = new RingBuffer<TimedXyzData>(1);
+    outputBuffer_ = new RingBuffer<TimedXyzData>(chunkSize(FILTER_BATCH_SIZE));
+    nameInternalBuffer("output", outputBuffer_);
 
     // Create buffers for filter chain
     filterBin_ = new Bin;
@@ -111,3 +113,9 @@ void GyroscopeSensorChannel::emitData(const TimedXyzData& value)
     previousSample_ = value;
     writeToClients((const void*)(&value), sizeof(TimedXyzData));
 }
+
+void GyroscopeSensorChannel::emitData(const TimedXyzData* values, unsigned n)
+{
+    previousSample_ = values[n - 1];
+    writeToClients((const void*)values, sizeof(TimedXyzData), n);
+}
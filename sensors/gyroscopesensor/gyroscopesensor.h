@@ -84,6 +84,7 @@ private:
     TimedXyzData                previousSample_;
 
     void emitData(const TimedXyzData& value);
+    void emitData(const TimedXyzData* values, unsigned n);
 
 };
 
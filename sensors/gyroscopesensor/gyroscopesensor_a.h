@@ -28,8 +28,6 @@
 #ifndef GYROSCOPE_SENSOR_H
 #define GYROSCOPE_SENSOR_H
 
-#include <QtDBus/QtDBus>
-
 #include "abstractsensor_a.h"
 #include "datatypes/orientationdata.h"
 #include "datatypes/xyz.h"
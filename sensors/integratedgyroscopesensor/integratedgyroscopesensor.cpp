@@ -0,0 +1,152 @@
+/**
+   @file integratedgyroscopesensor.cpp
+   @brief IntegratedGyroscopeSensor
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+
+#include "integratedgyroscopesensor.h"
+#include "rotationdeltafilter.h"
+#include "sensormanager.h"
+#include "config.h"
+#include "bin.h"
+#include "bufferreader.h"
+
+/** Output interval until a session requests one, ms */
+static const unsigned int DEFAULT_INTERVAL = 100;
+
+IntegratedGyroscopeSensorChannel::IntegratedGyroscopeSensorChannel(const QString& id) :
+        AbstractSensorChannel(id),
+        DataEmitter<RotationDeltaData>(chunkSize(FILTER_BATCH_SIZE)),
+        outputInterval_(DEFAULT_INTERVAL),
+        configuredSourceInterval_(Config::configuration()->value<unsigned int>(id + "/source_interval", 0))
+{
+    NodeArenaScope scope(&arena());
+    SensorManager& sm = SensorManager::instance();
+
+    gyroscopeAdaptor_ = sm.requestDeviceAdaptor("gyroscopeadaptor");
+    Q_ASSERT( gyroscopeAdaptor_ );
+    setValid(gyroscopeAdaptor_->isValid());
+
+    reader_ = new BufferReader<TimedXyzData>(chunkSize(FILTER_BATCH_SIZE));
+    deltaFilter_ = new RotationDeltaFilter(outputInterval_);
+
+    outputBuffer_ = new RingBuffer<RotationDeltaData>(chunkSize(FILTER_BATCH_SIZE));
+    nameInternalBuffer("output", outputBuffer_);
+
+    // Create buffers for filter chain
+    filterBin_ = new Bin;
+    filterBin_->add(reader_, "input");
+    filterBin_->add(deltaFilter_, "delta");
+    filterBin_->add(outputBuffer_, "output");
+
+    filterBin_->join("input", "source", "delta", "sink");
+    filterBin_->join("delta", "source", "output", "sink");
+
+    connectToSource(gyroscopeAdaptor_, "gyroscope", reader_);
+
+    marshallingBin_ = new Bin;
+    marshallingBin_->add(this, "sensorchannel");
+
+    outputBuffer_->join(this);
+
+    setDescription("rotation accumulated per interval as quaternion and x, y and z mdeg");
+    setRangeSource(gyroscopeAdaptor_);
+    addStandbyOverrideSource(gyroscopeAdaptor_);
+
+    // Interval is kept locally, gyroscope runs faster than the output
+    introduceAvailableIntervals(id);
+    if (getAvailableIntervals().isEmpty())
+        introduceAvailableInterval(DataRange(10, 1000, 0));
+    setDefaultInterval(DEFAULT_INTERVAL);
+}
+
+IntegratedGyroscopeSensorChannel::~IntegratedGyroscopeSensorChannel()
+{
+    SensorManager& sm = SensorManager::instance();
+
+    disconnectFromSource(gyroscopeAdaptor_, "gyroscope", reader_);
+    sm.releaseDeviceAdaptor("gyroscopeadaptor");
+
+    delete reader_;
+    delete deltaFilter_;
+    delete outputBuffer_;
+    delete marshallingBin_;
+    delete filterBin_;
+}
+
+unsigned int IntegratedGyroscopeSensorChannel::interval() const
+{
+    return outputInterval_;
+}
+
+bool IntegratedGyroscopeSensorChannel::setInterval(unsigned int value, int sessionId)
+{
+    outputInterval_ = qMax(1u, value);
+    deltaFilter_->setWindow(outputInterval_);
+    return gyroscopeAdaptor_->setIntervalRequest(sessionId, sourceInterval(outputInterval_));
+}
+
+unsigned int IntegratedGyroscopeSensorChannel::sourceInterval(unsigned int value) const
+{
+    unsigned int fastest = configuredSourceInterval_;
+    if (!fastest) {
+        foreach (const DataRange& range, gyroscopeAdaptor_->getAvailableIntervals()) {
+            unsigned int interval = (unsigned int)range.min;
+            if (interval && (!fastest || interval < fastest))
+                fastest = interval;
+        }
+    }
+    return fastest ? qMin(fastest, value) : value;
+}
+
+bool IntegratedGyroscopeSensorChannel::start()
+{
+    sensordLogD() << "Starting IntegratedGyroscopeSensorChannel";
+
+    if (AbstractSensorChannel::start()) {
+        // Rotation is not integrated over pauses of the sensor
+        deltaFilter_->reset();
+        marshallingBin_->start();
+        filterBin_->start();
+        gyroscopeAdaptor_->startSensor();
+    }
+    return true;
+}
+
+bool IntegratedGyroscopeSensorChannel::stop()
+{
+    sensordLogD() << "Stopping IntegratedGyroscopeSensorChannel";
+
+    if (AbstractSensorChannel::stop()) {
+        gyroscopeAdaptor_->stopSensor();
+        filterBin_->stop();
+        marshallingBin_->stop();
+    }
+    return true;
+}
+
+void IntegratedGyroscopeSensorChannel::emitData(const RotationDeltaData& value)
+{
+    writeToClients((const void*)(&value), sizeof(RotationDeltaData));
+}
+
+void IntegratedGyroscopeSensorChannel::emitData(const RotationDeltaData* values, unsigned n)
+{
+    writeToClients((const void*)values, sizeof(RotationDeltaData), n);
+}
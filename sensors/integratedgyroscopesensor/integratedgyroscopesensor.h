@@ -0,0 +1,99 @@
+/**
+   @file integratedgyroscopesensor.h
+   @brief IntegratedGyroscopeSensor
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+
+#ifndef INTEGRATED_GYROSCOPE_SENSOR_CHANNEL_H
+#define INTEGRATED_GYROSCOPE_SENSOR_CHANNEL_H
+
+#include "abstractsensor.h"
+#include "deviceadaptor.h"
+#include "integratedgyroscopesensor_a.h"
+#include "dataemitter.h"
+#include "datatypes/rotationdeltadata.h"
+
+class Bin;
+template <class TYPE> class BufferReader;
+class RotationDeltaFilter;
+
+/**
+ * @brief Sensor providing rotation accumulated from gyroscope samples.
+ *
+ * Gyroscope samples are integrated in the daemon at the rate of the
+ * gyroscope, and the rotation accumulated since the previous record is
+ * written to clients once per interval. Intervals of
+ * <em>id</em>/intervals (default 10-1000 ms) are accepted. The gyroscope
+ * is sampled every <em>id</em>/source_interval milliseconds, by default
+ * at its fastest available interval, but never slower than the requested
+ * interval.
+ */
+class IntegratedGyroscopeSensorChannel :
+        public AbstractSensorChannel,
+        public DataEmitter<RotationDeltaData>
+{
+    Q_OBJECT;
+
+public:
+    /**
+     * Factory method for IntegratedGyroscopeSensorChannel.
+     * @return new IntegratedGyroscopeSensorChannel as AbstractSensorChannel*.
+     */
+    static AbstractSensorChannel* factoryMethod(const QString& id)
+    {
+        IntegratedGyroscopeSensorChannel* sc = new IntegratedGyroscopeSensorChannel(id);
+        new IntegratedGyroscopeSensorChannelAdaptor(sc);
+
+        return sc;
+    }
+
+    virtual unsigned int interval() const;
+    virtual bool setInterval(unsigned int value, int sessionId);
+
+public Q_SLOTS:
+    bool start();
+    bool stop();
+
+protected:
+    IntegratedGyroscopeSensorChannel(const QString& id);
+    virtual ~IntegratedGyroscopeSensorChannel();
+
+private:
+    /**
+     * Gyroscope interval used for given output interval.
+     *
+     * @param value output interval in milliseconds.
+     * @return gyroscope interval in milliseconds.
+     */
+    unsigned int sourceInterval(unsigned int value) const;
+
+    Bin*                               filterBin_;
+    Bin*                               marshallingBin_;
+    DeviceAdaptor*                     gyroscopeAdaptor_;
+    BufferReader<TimedXyzData>*        reader_;
+    RotationDeltaFilter*               deltaFilter_;
+    RingBuffer<RotationDeltaData>*     outputBuffer_;
+    unsigned int                       outputInterval_; /**< window of deltaFilter_ */
+    unsigned int                       configuredSourceInterval_; /**< id/source_interval, 0 for fastest */
+
+    void emitData(const RotationDeltaData& value);
+    void emitData(const RotationDeltaData* values, unsigned n);
+};
+
+#endif // INTEGRATED_GYROSCOPE_SENSOR_CHANNEL_H
@@ -0,0 +1,13 @@
+TARGET       = integratedgyroscopesensor
+
+HEADERS += integratedgyroscopesensor.h   \
+           integratedgyroscopesensor_a.h \
+           rotationdeltafilter.h         \
+           integratedgyroscopeplugin.h
+
+SOURCES += integratedgyroscopesensor.cpp   \
+           integratedgyroscopesensor_a.cpp \
+           rotationdeltafilter.cpp         \
+           integratedgyroscopeplugin.cpp
+
+include( ../sensor-config.pri )
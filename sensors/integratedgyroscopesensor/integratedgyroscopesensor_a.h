@@ -0,0 +1,38 @@
+/**
+   @file integratedgyroscopesensor_a.h
+   @brief D-Bus adaptor for IntegratedGyroscopeSensor
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+
+#ifndef INTEGRATED_GYROSCOPE_SENSOR_H
+#define INTEGRATED_GYROSCOPE_SENSOR_H
+
+#include "abstractsensor_a.h"
+
+class IntegratedGyroscopeSensorChannelAdaptor : public AbstractSensorChannelAdaptor
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(IntegratedGyroscopeSensorChannelAdaptor)
+    Q_CLASSINFO("D-Bus Interface", "local.IntegratedGyroscopeSensor")
+
+public:
+    IntegratedGyroscopeSensorChannelAdaptor(QObject* parent);
+};
+
+#endif
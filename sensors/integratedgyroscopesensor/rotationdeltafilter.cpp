@@ -0,0 +1,123 @@
+/**
+   @file rotationdeltafilter.cpp
+   @brief RotationDeltaFilter
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+
+#include "rotationdeltafilter.h"
+#include <math.h>
+
+/** Gyroscope mdps to rad/s */
+static const double MDPS_TO_RADIANS = 0.017453292519943295 / 1000;
+
+RotationDeltaFilter::RotationDeltaFilter(unsigned int window) :
+    Filter<TimedXyzData, RotationDeltaFilter, RotationDeltaData>(this, &RotationDeltaFilter::filter),
+    window_(qMax(1u, window)),
+    start_(0),
+    last_(0),
+    hasLast_(false)
+{
+    open(0);
+}
+
+unsigned int RotationDeltaFilter::window() const
+{
+    return window_;
+}
+
+void RotationDeltaFilter::setWindow(unsigned int window)
+{
+    window_ = qMax(1u, window);
+}
+
+void RotationDeltaFilter::reset()
+{
+    hasLast_ = false;
+    open(0);
+}
+
+void RotationDeltaFilter::open(quint64 timestamp)
+{
+    start_ = timestamp;
+    count_ = 0;
+    duration_ = 0;
+    q_[0] = 1;
+    for (int i = 0; i < 3; ++i)
+        q_[i + 1] = angle_[i] = 0;
+}
+
+void RotationDeltaFilter::filter(unsigned n, const TimedXyzData* data)
+{
+    FilterBatch<RotationDeltaData> batch;
+    const quint64 length = window_ * 1000ULL;
+
+    for (unsigned i = 0; i < n; ++i, ++data) {
+        if (count_ && data->timestamp_ >= start_ + length) {
+            batch.append(record());
+            open(last_);
+        }
+        if (!hasLast_)
+            open(data->timestamp_);
+        else if (data->timestamp_ > last_ && data->timestamp_ - last_ <= MAX_STEP)
+            integrate(*data, data->timestamp_ - last_);
+        last_ = data->timestamp_;
+        hasLast_ = true;
+        ++count_;
+    }
+
+    batch.propagate(source_);
+}
+
+void RotationDeltaFilter::integrate(const TimedXyzData& rate, quint64 dt)
+{
+    double seconds = dt / 1000000.0;
+    double omega[3] = { rate.x_ * MDPS_TO_RADIANS, rate.y_ * MDPS_TO_RADIANS, rate.z_ * MDPS_TO_RADIANS };
+    angle_[0] += rate.x_ * seconds;
+    angle_[1] += rate.y_ * seconds;
+    angle_[2] += rate.z_ * seconds;
+    duration_ += dt;
+
+    // Rotation of the step about its axis, q = q * dq
+    double norm = sqrt(omega[0] * omega[0] + omega[1] * omega[1] + omega[2] * omega[2]);
+    if (norm == 0)
+        return;
+    double half = 0.5 * norm * seconds;
+    double s = sin(half) / norm;
+    double d[4] = { cos(half), omega[0] * s, omega[1] * s, omega[2] * s };
+    double w = q_[0], x = q_[1], y = q_[2], z = q_[3];
+    q_[0] = w * d[0] - x * d[1] - y * d[2] - z * d[3];
+    q_[1] = w * d[1] + x * d[0] + y * d[3] - z * d[2];
+    q_[2] = w * d[2] - x * d[3] + y * d[0] + z * d[1];
+    q_[3] = w * d[3] + x * d[2] - y * d[1] + z * d[0];
+}
+
+RotationDeltaData RotationDeltaFilter::record() const
+{
+    RotationDeltaData data;
+    data.timestamp_ = last_;
+    data.count_ = count_;
+    data.duration_ = (quint32)qMin(duration_, (quint64)0xffffffffu);
+
+    double norm = sqrt(q_[0] * q_[0] + q_[1] * q_[1] + q_[2] * q_[2] + q_[3] * q_[3]);
+    for (int i = 0; i < 4; ++i)
+        data.delta_[i] = (float)(q_[i] / norm);
+    for (int i = 0; i < 3; ++i)
+        data.angle_[i] = (float)angle_[i];
+    return data;
+}
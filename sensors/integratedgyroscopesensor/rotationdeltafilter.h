@@ -0,0 +1,108 @@
+/**
+   @file rotationdeltafilter.h
+   @brief RotationDeltaFilter
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+
+#ifndef ROTATIONDELTAFILTER_H
+#define ROTATIONDELTAFILTER_H
+
+#include "filter.h"
+#include "datatypes/genericdata.h"
+#include "datatypes/rotationdeltadata.h"
+
+/**
+ * @brief Integrates gyroscope samples into rotation deltas.
+ *
+ * Each sample is integrated over the time since the previous one, and
+ * the rotation accumulated over consecutive windows of fixed length is
+ * output as one RotationDeltaData per window. As in StatisticsFilter a
+ * window is closed by the first sample past its end. That sample starts
+ * the next window, so no rotation is lost between records. Gaps longer
+ * than MAX_STEP, as when the sensor has been stopped, are not integrated.
+ */
+class RotationDeltaFilter : public Filter<TimedXyzData, RotationDeltaFilter, RotationDeltaData>
+{
+public:
+    /**
+     * Constructor.
+     *
+     * @param window window length in milliseconds.
+     */
+    RotationDeltaFilter(unsigned int window = 100);
+
+    /**
+     * Window length.
+     *
+     * @return window length in milliseconds.
+     */
+    unsigned int window() const;
+
+    /**
+     * Set window length. The open window is closed by the next sample
+     * past the new length.
+     *
+     * @param window window length in milliseconds, at least 1.
+     */
+    void setWindow(unsigned int window);
+
+    /**
+     * Drop rotation of the open window and forget the previous sample.
+     */
+    void reset();
+
+private:
+    void filter(unsigned n, const TimedXyzData* data);
+
+    /**
+     * Rotate the open window by one sample.
+     *
+     * @param rate angular velocity in mdps.
+     * @param dt time step in microseconds.
+     */
+    void integrate(const TimedXyzData& rate, quint64 dt);
+
+    /**
+     * Rotation of the open window.
+     *
+     * @return record.
+     */
+    RotationDeltaData record() const;
+
+    /**
+     * Start a new window at the given sample.
+     *
+     * @param timestamp timestamp of the first sample.
+     */
+    void open(quint64 timestamp);
+
+    /** Longer gaps between samples are not integrated, us. */
+    static const quint64 MAX_STEP = 500000;
+
+    unsigned int window_;    /**< window length in milliseconds */
+    quint64      start_;     /**< start of the open window */
+    quint64      last_;      /**< timestamp of the previous sample */
+    bool         hasLast_;   /**< is last_ valid */
+    quint32      count_;     /**< samples in the open window */
+    quint64      duration_;  /**< integrated time of the open window, us */
+    double       q_[4];      /**< rotation of the open window, w x y z */
+    double       angle_[3];  /**< summed rotation about x, y and z, mdeg */
+};
+
+#endif // ROTATIONDELTAFILTER_H
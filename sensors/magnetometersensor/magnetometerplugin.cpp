@@ -25,7 +25,6 @@
 
 #include "magnetometerplugin.h"
 #include "magnetometersensor.h"
-#include "magnetometerscalefilter.h"
 #include "sensormanager.h"
 #include "logging.h"
 
@@ -33,7 +32,6 @@ void MagnetometerPlugin::Register(class Loader&)
 {
     SensorManager& sm = SensorManager::instance();
     sm.registerSensor<MagnetometerSensorChannel>("magnetometersensor");
-    sm.registerFilter<MagnetometerScaleFilter>("magnetometerscalefilter");
 }
 
 QStringList MagnetometerPlugin::Dependencies() {
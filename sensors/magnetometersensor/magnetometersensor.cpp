@@ -34,30 +34,24 @@
 
 MagnetometerSensorChannel::MagnetometerSensorChannel(const QString& id) :
         AbstractSensorChannel(id),
-        DataEmitter<CalibratedMagneticFieldData>(1),
-        scaleFilter_(NULL),
+        DataEmitter<CalibratedMagneticFieldData>(chunkSize(FILTER_BATCH_SIZE)),
         prevMeasurement_()
 {
+    NodeArenaScope scope(&arena());
     SensorManager& sm = SensorManager::instance();
 
     compassChain_ = sm.requestChain("magcalibrationchain");
     Q_ASSERT( compassChain_ );
     setValid(compassChain_->isValid());
 
-    magnetometerReader_ = new BufferReader<CalibratedMagneticFieldData>(1);
+    magnetometerReader_ = new BufferReader<CalibratedMagneticFieldData>(chunkSize(FILTER_BATCH_SIZE));
 
+    // Scaling is done by the calibration of the chain
     scaleCoefficient_ = Config::configuration()->value("magnetometer/scale_coefficient", QVariant(300)).toInt();
+    const char* chainBuffer = scaleCoefficient_ != 1 ? "scaledmagnetometerdata" : "calibratedmagnetometerdata";
 
-    if (scaleCoefficient_ != 1)
-    {
-        scaleFilter_ = sm.instantiateFilter("magnetometerscalefilter");
-        if (scaleFilter_ == NULL)
-        {
-            sensordLogW() << "Failed to initialise scaling filter for magnetometer.";
-        }
-    }
-
-    outputBuffer_ = new RingBuffer<CalibratedMagneticFieldData>(1);
+    outputBuffer_ = new RingBuffer<CalibratedMagneticFieldData>(chunkSize(FILTER_BATCH_SIZE));
+    nameInternalBuffer("output", outputBuffer_);
 
     // Create buffers for filter chain
     filterBin_ = new Bin;
@@ -65,18 +59,10 @@ MagnetometerSensorChannel::MagnetometerSensorChannel(const QString& id) :
     filterBin_->add(magnetometerReader_, "magnetometer");
     filterBin_->add(outputBuffer_, "buffer");
 
-    if (scaleFilter_)
-    {
-        filterBin_->add(scaleFilter_, "filter");
-        filterBin_->join("magnetometer", "source", "filter", "sink");
-        filterBin_->join("filter", "source", "buffer", "sink");
-    } else
-    {
-        filterBin_->join("magnetometer", "source", "buffer", "sink");
-    }
+    filterBin_->join("magnetometer", "source", "buffer", "sink");
 
     // Join datasources to the chain
-    connectToSource(compassChain_, "calibratedmagnetometerdata", magnetometerReader_);
+    connectToSource(compassChain_, chainBuffer, magnetometerReader_);
 
     marshallingBin_ = new Bin;
     marshallingBin_->add(this, "sensorchannel");
@@ -84,7 +70,7 @@ MagnetometerSensorChannel::MagnetometerSensorChannel(const QString& id) :
     outputBuffer_->join(this);
 
     // AK897X requires scaling, which affects available ranges
-    if (scaleFilter_)
+    if (scaleCoefficient_ != 1)
     {
         // Get available ranges and introduce modified ones
         QList<DataRange> rangeList = compassChain_->getAvailableDataRanges();
@@ -106,11 +92,9 @@ MagnetometerSensorChannel::~MagnetometerSensorChannel()
 {
     SensorManager& sm = SensorManager::instance();
 
-    disconnectFromSource(compassChain_, "calibratedmagnetometerdata", magnetometerReader_);
+    disconnectFromSource(compassChain_, scaleCoefficient_ != 1 ? "scaledmagnetometerdata" : "calibratedmagnetometerdata", magnetometerReader_);
     sm.releaseChain("magcalibrationchain");
 
-    if (scaleFilter_) delete scaleFilter_;
-
     delete magnetometerReader_;
     delete outputBuffer_;
     delete marshallingBin_;
@@ -145,7 +129,14 @@ void MagnetometerSensorChannel::emitData(const CalibratedMagneticFieldData& valu
 {
     prevMeasurement_ = value;
     downsampleAndPropagate(value, downsampleBuffer_);
-    emit internalData(value);
+    internalSource_.propagate(1, &value);
+}
+
+void MagnetometerSensorChannel::emitData(const CalibratedMagneticFieldData* values, unsigned n)
+{
+    prevMeasurement_ = values[n - 1];
+    downsampleAndPropagate(values, n, downsampleBuffer_);
+    internalSource_.propagate(n, values);
 }
 
 void MagnetometerSensorChannel::resetCalibration()
@@ -166,12 +157,6 @@ bool MagnetometerSensorChannel::setDataRange(const DataRange& range, int session
     return true;
 }
 
-void MagnetometerSensorChannel::removeSession(int sessionId)
-{
-    downsampleBuffer_.remove(sessionId);
-    AbstractSensorChannel::removeSession(sessionId);
-}
-
 bool MagnetometerSensorChannel::downsamplingSupported() const
 {
     return true;
@@ -32,6 +32,7 @@
 #include "abstractchain.h"
 #include "magnetometersensor_a.h"
 #include "dataemitter.h"
+#include "source.h"
 #include "deviceadaptor.h"
 #include "datatypes/orientationdata.h"
 
@@ -69,10 +70,20 @@ public:
         return MagneticField(prevMeasurement_);
     }
 
-    virtual void removeSession(int sessionId);
-
     virtual bool downsamplingSupported() const;
 
+    /**
+     * Source of every sample delivered to sessions, for consumers within
+     * sensord. Sinks are called in the thread delivering the samples and
+     * should be joined before the channel is started.
+     *
+     * @return sample source.
+     */
+    Source<CalibratedMagneticFieldData>& internalSource()
+    {
+        return internalSource_;
+    }
+
 public Q_SLOTS:
     bool start();
     bool stop();
@@ -83,7 +94,6 @@ signals:
      * @param data Newly measured data.
      */
     void dataAvailable(const MagneticField& data);
-    void internalData(const MagneticField& data);
 
 protected:
     MagnetometerSensorChannel(const QString& id);
@@ -95,14 +105,15 @@ private:
     Bin*                                       filterBin_;
     Bin*                                       marshallingBin_;
     AbstractChain*                             compassChain_;
-    FilterBase*                                scaleFilter_;
     BufferReader<CalibratedMagneticFieldData>* magnetometerReader_;
     RingBuffer<CalibratedMagneticFieldData>*   outputBuffer_;
     CalibratedMagneticFieldData                prevMeasurement_;
     int                                        scaleCoefficient_;
     MagneticFieldDownsampleBuffer              downsampleBuffer_;
+    Source<CalibratedMagneticFieldData>        internalSource_; /**< in-daemon consumers, not an emitter source so it does not gate session delivery */
 
     void emitData(const CalibratedMagneticFieldData& value);
+    void emitData(const CalibratedMagneticFieldData* values, unsigned n);
 };
 
 #endif // MAGNETOMETER_SENSOR_CHANNEL_H
@@ -27,8 +27,6 @@
 #ifndef MAGNETOMETER_SENSOR_H
 #define MAGNETOMETER_SENSOR_H
 
-#include <QtDBus/QtDBus>
-
 #include "datatypes/magneticfield.h"
 #include "abstractsensor_a.h"
 
@@ -0,0 +1,325 @@
+/**
+   @file netstreamer.cpp
+   @brief Streams a ring buffer to a network collector
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "netstreamer.h"
+#include "datatypes/compactframe.h"
+#include "logging.h"
+#include "datatypes/atomic.h"
+#include <QUrl>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/** Milliseconds before a failed connection is opened again */
+static const quint64 RETRY_DELAY = 1000;
+
+/** Bytes a sample may grow by in encoding, timestamp varint over 8 bytes */
+static const unsigned ENCODING_SLACK = 2;
+
+static quint64 monotonicMs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000ULL + ts.tv_nsec / 1000000;
+}
+
+bool NetStreamTarget::resolve(const QString& url)
+{
+    QUrl parsed(url);
+    if (parsed.scheme() == "udp")
+        type = SOCK_DGRAM;
+    else if (parsed.scheme() == "tcp")
+        type = SOCK_STREAM;
+    else {
+        sensordLogW() << "Unsupported stream target " << url << ", expected udp://host:port or tcp://host:port";
+        return false;
+    }
+    if (parsed.host().isEmpty() || parsed.port() <= 0) {
+        sensordLogW() << "Stream target " << url << " has no host or port";
+        return false;
+    }
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = type;
+    struct addrinfo* result = 0;
+    int error = getaddrinfo(parsed.host().toLocal8Bit().constData(),
+                            QByteArray::number(parsed.port()).constData(), &hints, &result);
+    if (error || !result) {
+        sensordLogW() << "Can not resolve stream target " << url << ": " << gai_strerror(error);
+        return false;
+    }
+    memcpy(&address, result->ai_addr, result->ai_addrlen);
+    length = result->ai_addrlen;
+    freeaddrinfo(result);
+    return true;
+}
+
+NetStreamer::NetStreamer(int channel, quint32 device, const NetStreamTarget& target,
+                         unsigned batchSize, unsigned batchInterval, unsigned maxDatagram) :
+    channel_(channel),
+    device_(device),
+    target_(target),
+    batchSize_(qMax(1u, batchSize)),
+    batchInterval_(batchInterval),
+    maxDatagram_(maxDatagram),
+    strand_(0),
+    buffer_(0),
+    reader_(0),
+    fd_(-1),
+    connecting_(false),
+    retryAt_(0),
+    size_(0),
+    limit_(0),
+    count_(0),
+    batchStart_(0),
+    sequence_(0),
+    sent_(0),
+    failed_(0)
+{
+}
+
+NetStreamer::~NetStreamer()
+{
+    stop();
+}
+
+bool NetStreamer::start(RingBufferBase* buffer, const QString& name, ChainWorker* worker)
+{
+    if (buffer_ || !buffer || !worker)
+        return false;
+
+    reader_ = buffer->createRawReader(this);
+    if (!reader_) {
+        sensordLogW() << "Objects of " << name << " cannot be streamed as raw data";
+        return false;
+    }
+
+    strand_ = new ChainStrand("netstream " + name, worker);
+    reader_->reader()->setStrand(strand_);
+    strand_->add(reader_->reader());
+    buffer_ = buffer;
+    if (!buffer_->join(reader_->reader())) {
+        stop();
+        return false;
+    }
+    sensordLogD() << "Streaming " << name << " as channel " << channel_;
+    return true;
+}
+
+void NetStreamer::stop()
+{
+    if (!buffer_)
+        return;
+
+    buffer_->unjoin(reader_->reader());
+    strand_->remove(reader_->reader());
+    delete strand_;
+    strand_ = 0;
+    failed_.fetchAndAddRelaxed(reader_->reader()->lost() + count_);
+    delete reader_;
+    reader_ = 0;
+    buffer_ = 0;
+    count_ = 0;
+    closeSocket();
+}
+
+unsigned NetStreamer::sent() const
+{
+    return Atomic::load(sent_);
+}
+
+unsigned NetStreamer::lost() const
+{
+    return Atomic::load(failed_) + (reader_ ? reader_->reader()->lost() : 0);
+}
+
+void NetStreamer::writeRaw(unsigned n, const void* values, unsigned size)
+{
+    if (!size_) {
+        size_ = size;
+        limit_ = batchSize_;
+        // Datagram holds whole frames, size the batch so that it fits
+        if (target_.type == SOCK_DGRAM) {
+            unsigned headers = sizeof(NetStreamFrameHeader) + sizeof(CompactFrameHeader);
+            unsigned fit = maxDatagram_ > headers ? (maxDatagram_ - headers) / (size + ENCODING_SLACK) : 0;
+            limit_ = qBound(1u, fit, batchSize_);
+        }
+        batch_.reserve(limit_ * size_);
+    }
+
+    const char* from = (const char*)values;
+    while (n) {
+        if (!count_)
+            batchStart_ = monotonicMs();
+        unsigned take = qMin(n, limit_ - count_);
+        batch_.append(from, take * size_);
+        count_ += take;
+        from += take * size_;
+        n -= take;
+        if (count_ == limit_ || (batchInterval_ && monotonicMs() - batchStart_ >= batchInterval_))
+            flush();
+    }
+}
+
+void NetStreamer::flush()
+{
+    struct iovec slice;
+    slice.iov_base = batch_.data();
+    slice.iov_len = batch_.size();
+    CompactFrame::encode(&slice, 1, size_, count_, frame_);
+
+    NetStreamFrameHeader header;
+    header.magic = NETSTREAM_MAGIC;
+    header.device = device_;
+    header.channel = channel_;
+    header.reserved = 0;
+    header.sequence = sequence_;
+    header.lost = Atomic::load(failed_) + reader_->reader()->lost();
+
+    if (send(header, frame_)) {
+        ++sequence_;
+        sent_.fetchAndAddRelaxed(count_);
+    } else {
+        failed_.fetchAndAddRelaxed(count_);
+    }
+    batch_.resize(0);
+    count_ = 0;
+}
+
+bool NetStreamer::send(const NetStreamFrameHeader& header, const QByteArray& frame)
+{
+    if (fd_ < 0 && !openSocket())
+        return false;
+    if (!connected())
+        return false;
+
+    // Stream must not be cut inside a frame, finish the previous one first
+    if (!pending_.isEmpty()) {
+        ssize_t written = ::send(fd_, pending_.constData(), pending_.size(), MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (written < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+            closeSocket();
+            return false;
+        }
+        if (written > 0)
+            pending_.remove(0, written);
+        if (!pending_.isEmpty())
+            return false;
+    }
+
+    struct iovec slices[2];
+    slices[0].iov_base = (void*)&header;
+    slices[0].iov_len = sizeof(header);
+    slices[1].iov_base = (void*)frame.constData();
+    slices[1].iov_len = frame.size();
+    struct msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = slices;
+    message.msg_iovlen = 2;
+
+    size_t total = sizeof(header) + frame.size();
+    ssize_t written = sendmsg(fd_, &message, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (written < 0) {
+        // Full socket buffer only costs this frame
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != ENOBUFS) {
+            sensordLogD() << "Stream channel " << channel_ << " send failed: " << strerror(errno);
+            if (target_.type == SOCK_STREAM)
+                closeSocket();
+        }
+        return false;
+    }
+    if ((size_t)written < total) {
+        if (target_.type == SOCK_DGRAM)
+            return false;
+        size_t skip = written;
+        if (skip < sizeof(header)) {
+            pending_.append((const char*)&header + skip, sizeof(header) - skip);
+            skip = 0;
+        } else {
+            skip -= sizeof(header);
+        }
+        pending_.append(frame.constData() + skip, frame.size() - skip);
+    }
+    return true;
+}
+
+bool NetStreamer::openSocket()
+{
+    if (monotonicMs() < retryAt_)
+        return false;
+    fd_ = ::socket(target_.address.ss_family, target_.type | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd_ < 0) {
+        sensordLogW() << "Stream channel " << channel_ << " can not create socket: " << strerror(errno);
+        retryAt_ = monotonicMs() + RETRY_DELAY;
+        return false;
+    }
+    // UDP connect only sets the destination
+    connecting_ = false;
+    if (::connect(fd_, (const sockaddr*)&target_.address, target_.length) < 0) {
+        if (errno != EINPROGRESS) {
+            sensordLogW() << "Stream channel " << channel_ << " can not connect: " << strerror(errno);
+            closeSocket();
+            return false;
+        }
+        connecting_ = true;
+    }
+    pending_.clear();
+    return true;
+}
+
+bool NetStreamer::connected()
+{
+    if (!connecting_)
+        return true;
+
+    struct pollfd pfd;
+    pfd.fd = fd_;
+    pfd.events = POLLOUT;
+    pfd.revents = 0;
+    if (poll(&pfd, 1, 0) <= 0)
+        return false;
+
+    int error = 0;
+    socklen_t length = sizeof(error);
+    if (getsockopt(fd_, SOL_SOCKET, SO_ERROR, &error, &length) < 0 || error) {
+        sensordLogW() << "Stream channel " << channel_ << " can not connect: " << strerror(error ? error : errno);
+        closeSocket();
+        return false;
+    }
+    connecting_ = false;
+    sensordLogD() << "Stream channel " << channel_ << " connected";
+    return true;
+}
+
+void NetStreamer::closeSocket()
+{
+    if (fd_ >= 0)
+        ::close(fd_);
+    fd_ = -1;
+    connecting_ = false;
+    pending_.clear();
+    retryAt_ = monotonicMs() + RETRY_DELAY;
+}
@@ -0,0 +1,197 @@
+/**
+   @file netstreamer.h
+   @brief Streams a ring buffer to a network collector
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef NETSTREAMER_H
+#define NETSTREAMER_H
+
+#include "ringbuffer.h"
+#include "chainscheduler.h"
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QString>
+#include <sys/socket.h>
+
+/**
+ * Header of a frame streamed to a collector. It is followed by a
+ * CompactFrameHeader and the encoded samples, see CompactFrame. Over UDP
+ * every datagram is one frame, over TCP frames follow each other on the
+ * stream. Fields are in host byte order.
+ */
+struct NetStreamFrameHeader
+{
+    quint32 magic;    /**< NETSTREAM_MAGIC */
+    quint32 device;   /**< netstream/device_id of the sender */
+    quint16 channel;  /**< index of the channel in netstream/channels */
+    quint16 reserved; /**< zero */
+    quint32 sequence; /**< frame number of the channel, sequence gaps are frames lost in transit */
+    quint32 lost;     /**< samples of the channel the sender has lost so far */
+};
+
+/** Magic of NetStreamFrameHeader, "SNS1" */
+static const quint32 NETSTREAM_MAGIC = 0x534e5331;
+
+/**
+ * Address of a collector, from "udp://host:port" or "tcp://host:port".
+ */
+struct NetStreamTarget
+{
+    NetStreamTarget() : type(0), length(0) {}
+
+    /**
+     * Resolve collector address.
+     *
+     * @param url collector URL.
+     * @return was the URL resolved.
+     */
+    bool resolve(const QString& url);
+
+    int              type;    /**< SOCK_DGRAM or SOCK_STREAM */
+    sockaddr_storage address; /**< collector address */
+    socklen_t        length;  /**< address length */
+};
+
+/**
+ * Streams objects written into a ring buffer to a collector. Objects
+ * are collected into batches which are sent as one frame when the batch
+ * is full or spans the batch interval, measured when objects arrive.
+ *
+ * Like TraceRecorder the streamer reads the buffer in a strand, so the
+ * writer of the buffer never waits for the network. Sockets are non
+ * blocking: frames which can not be sent at once are dropped and their
+ * samples counted as lost, as are samples the buffer overwrote before
+ * the streamer read them. TCP connections are reestablished after a
+ * second when lost.
+ */
+class NetStreamer : public RawObjectWriter
+{
+public:
+    /**
+     * Constructor.
+     *
+     * @param channel channel index written into the frames.
+     * @param device device ID written into the frames.
+     * @param target collector address.
+     * @param batchSize most samples in a frame.
+     * @param batchInterval most milliseconds between the first sample
+     *        of a batch and its sending, 0 to send full batches only.
+     * @param maxDatagram most bytes of an UDP datagram.
+     */
+    NetStreamer(int channel, quint32 device, const NetStreamTarget& target,
+                unsigned batchSize, unsigned batchInterval, unsigned maxDatagram);
+
+    /**
+     * Destructor. Stops streaming.
+     */
+    ~NetStreamer();
+
+    /**
+     * Start streaming objects written into given buffer.
+     *
+     * @param buffer streamed buffer, must outlive streaming.
+     * @param name name of the strand reading the buffer.
+     * @param worker worker running the strand.
+     * @return false if already streaming or objects of the buffer are not
+     *         trivially copyable.
+     */
+    bool start(RingBufferBase* buffer, const QString& name, ChainWorker* worker);
+
+    /**
+     * Stop streaming. Pending batch is dropped.
+     */
+    void stop();
+
+    /**
+     * Number of samples sent.
+     *
+     * @return sent sample count.
+     */
+    unsigned sent() const;
+
+    /**
+     * Number of samples lost, see NetStreamFrameHeader::lost.
+     *
+     * @return lost sample count.
+     */
+    unsigned lost() const;
+
+    void writeRaw(unsigned n, const void* values, unsigned size);
+
+private:
+    Q_DISABLE_COPY(NetStreamer)
+
+    /**
+     * Encode the batch and send it.
+     */
+    void flush();
+
+    /**
+     * Send frame, opening the socket if needed.
+     *
+     * @param header frame header.
+     * @param frame encoded samples with CompactFrameHeader.
+     * @return was the frame sent or queued in the socket.
+     */
+    bool send(const NetStreamFrameHeader& header, const QByteArray& frame);
+
+    /**
+     * Open socket and start connecting it.
+     *
+     * @return was the socket created.
+     */
+    bool openSocket();
+
+    /**
+     * Is a TCP connection established. Completes asynchronous connect.
+     *
+     * @return can frames be sent.
+     */
+    bool connected();
+
+    /**
+     * Close socket, it is opened again after the retry delay.
+     */
+    void closeSocket();
+
+    int                      channel_;       /**< channel index */
+    quint32                  device_;        /**< device ID */
+    NetStreamTarget          target_;        /**< collector address */
+    unsigned                 batchSize_;     /**< most samples in a frame */
+    unsigned                 batchInterval_; /**< batch interval in milliseconds */
+    unsigned                 maxDatagram_;   /**< most bytes in a datagram */
+    ChainStrand*             strand_;        /**< strand of the reader */
+    RingBufferBase*          buffer_;        /**< streamed buffer or NULL */
+    RawRingBufferReaderBase* reader_;        /**< reader of the buffer */
+    int                      fd_;            /**< socket or -1 */
+    bool                     connecting_;    /**< is TCP connect in progress */
+    quint64                  retryAt_;       /**< earliest time to open the socket again, ms */
+    unsigned                 size_;          /**< object size, 0 before the first write */
+    unsigned                 limit_;         /**< most samples in the current batch */
+    QByteArray               batch_;         /**< objects of the pending batch */
+    unsigned                 count_;         /**< objects in the pending batch */
+    quint64                  batchStart_;    /**< arrival of the first object of the batch, ms */
+    QByteArray               frame_;         /**< encoded frame, allocation reused */
+    QByteArray               pending_;       /**< unsent tail of a partially written TCP frame */
+    quint32                  sequence_;      /**< next frame number */
+    QAtomicInt               sent_;          /**< sent samples */
+    QAtomicInt               failed_;        /**< samples lost in sending */
+};
+
+#endif // NETSTREAMER_H
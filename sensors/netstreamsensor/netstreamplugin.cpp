@@ -0,0 +1,50 @@
+/**
+   @file netstreamplugin.cpp
+   @brief Plugin for NetStreamSensorChannel
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "netstreamplugin.h"
+#include "netstreamsensor.h"
+#include "sensormanager.h"
+#include "sfwerror.h"
+#include "logging.h"
+
+void NetStreamPlugin::Register(class Loader&)
+{
+    sensordLogD() << "registering netstreamsensor";
+    SensorManager& sm = SensorManager::instance();
+    sm.registerSensor<NetStreamSensorChannel>("netstreamsensor");
+}
+
+void NetStreamPlugin::Init(class Loader&)
+{
+    // Session is held for the lifetime of sensord, like a client would
+    SensorManager& sm = SensorManager::instance();
+    int sessionId = sm.requestSensor("netstreamsensor");
+    const SensorInstanceEntry* entry = sm.getSensorInstance("netstreamsensor");
+    if (sessionId == INVALID_SESSION || !entry || !entry->sensor_) {
+        sensordLogW() << "Failed to create netstreamsensor, not streaming";
+        return;
+    }
+    static_cast<NetStreamSensorChannel*>(entry->sensor_)->startStreaming(sessionId);
+}
+
+#if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
+Q_EXPORT_PLUGIN2(netstreamsensor, NetStreamPlugin)
+#endif
@@ -0,0 +1,143 @@
+/**
+   @file netstreamsensor.cpp
+   @brief Sensor channel streaming buffers to a network collector
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "netstreamsensor.h"
+#include "netstreamer.h"
+#include "sensormanager.h"
+#include "config.h"
+#include "logging.h"
+
+NetStreamSensorChannel::NetStreamSensorChannel(const QString& id) :
+    AbstractSensorChannel(id),
+    sessionId_(-1)
+{
+    setDescription("streams sensor buffers to a network collector");
+    setValid(true);
+}
+
+NetStreamSensorChannel::~NetStreamSensorChannel()
+{
+    stopStreaming();
+}
+
+bool NetStreamSensorChannel::startStreaming(int sessionId)
+{
+    if (!streams_.isEmpty())
+        return false;
+
+    Config* config = Config::configuration();
+    QStringList channels = config->value<QStringList>("netstream/channels");
+    NetStreamTarget target;
+    if (channels.isEmpty() || !target.resolve(config->value<QString>("netstream/target")))
+        return false;
+
+    unsigned batchSize = config->value<unsigned int>("netstream/batch_size", 32);
+    unsigned batchInterval = config->value<unsigned int>("netstream/batch_interval", 20);
+    unsigned maxDatagram = config->value<unsigned int>("netstream/max_datagram", 1400);
+    quint32 device = config->value<unsigned int>("netstream/device_id", 0);
+    unsigned interval = config->value<unsigned int>("netstream/interval", 0);
+    bool standbyOverride = config->value<bool>("netstream/standby_override", true);
+    if (!scheduler_.start(qMax(1, config->value<int>("netstream/workers", 1))))
+        return false;
+
+    sessionId_ = sessionId;
+    SensorManager& sm = SensorManager::instance();
+    for (int channel = 0; channel < channels.size(); ++channel) {
+        QString name(channels.at(channel).trimmed());
+        int slash = name.indexOf('/');
+        if (slash <= 0) {
+            sensordLogW() << "Stream channel " << name << " is not of form node/buffer";
+            continue;
+        }
+
+        Stream stream;
+        stream.node = name.left(slash);
+        stream.adaptor = stream.node.endsWith("adaptor");
+        stream.streamer = 0;
+        RingBufferBase* buffer = 0;
+        if (stream.adaptor) {
+            DeviceAdaptor* adaptor = sm.requestDeviceAdaptor(stream.node);
+            stream.source = adaptor;
+            if (adaptor)
+                buffer = adaptor->findBuffer(name.mid(slash + 1));
+        } else {
+            AbstractChain* chain = sm.requestChain(stream.node);
+            stream.source = chain;
+            if (chain)
+                buffer = chain->findBuffer(name.mid(slash + 1));
+        }
+        if (!stream.source) {
+            sensordLogW() << "Stream channel " << name << " has no node " << stream.node;
+            continue;
+        }
+
+        stream.streamer = new NetStreamer(channel, device, target, batchSize, batchInterval, maxDatagram);
+        if (!buffer || !stream.streamer->start(buffer, name, scheduler_.workerFor(stream.node))) {
+            sensordLogW() << "Stream channel " << name << " can not be streamed";
+            delete stream.streamer;
+            releaseNode(stream);
+            continue;
+        }
+
+        if (stream.adaptor)
+            static_cast<DeviceAdaptor*>(stream.source)->startSensor();
+        else
+            static_cast<AbstractChain*>(stream.source)->start();
+        if (interval)
+            stream.source->setIntervalRequest(sessionId_, interval);
+        if (standbyOverride)
+            stream.source->setStandbyOverrideRequest(sessionId_, true);
+        streams_.append(stream);
+    }
+
+    if (streams_.isEmpty()) {
+        scheduler_.stop();
+        return false;
+    }
+    sensordLogD() << "Streaming " << streams_.size() << " channel(s) to " << config->value<QString>("netstream/target");
+    return true;
+}
+
+void NetStreamSensorChannel::stopStreaming()
+{
+    foreach (const Stream& stream, streams_) {
+        if (stream.adaptor)
+            static_cast<DeviceAdaptor*>(stream.source)->stopSensor();
+        else
+            static_cast<AbstractChain*>(stream.source)->stop();
+        stream.streamer->stop();
+        sensordLogD() << "Stream of " << stream.node << " sent " << stream.streamer->sent()
+                      << " and lost " << stream.streamer->lost() << " samples";
+        delete stream.streamer;
+        releaseNode(stream);
+    }
+    streams_.clear();
+    scheduler_.stop();
+}
+
+void NetStreamSensorChannel::releaseNode(const Stream& stream)
+{
+    stream.source->removeSession(sessionId_);
+    if (stream.adaptor)
+        SensorManager::instance().releaseDeviceAdaptor(stream.node);
+    else
+        SensorManager::instance().releaseChain(stream.node);
+}
@@ -0,0 +1,94 @@
+/**
+   @file netstreamsensor.h
+   @brief Sensor channel streaming buffers to a network collector
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef NETSTREAMSENSOR_H
+#define NETSTREAMSENSOR_H
+
+#include "abstractsensor.h"
+#include "chainscheduler.h"
+#include <QList>
+
+class NetStreamer;
+
+/**
+ * Streams the buffers listed in netstream/channels to the collector at
+ * netstream/target, see NetStreamer. Channels are named like buffers
+ * in SensorManager::printStatistics(), node/buffer. Nodes whose ID ends
+ * with "adaptor" are device adaptors, others are chains. Streamed nodes
+ * are kept running with the session of the channel.
+ *
+ * The channel has no clients of its own, NetStreamPlugin requests it
+ * when loaded.
+ */
+class NetStreamSensorChannel : public AbstractSensorChannel
+{
+    Q_OBJECT
+
+public:
+    virtual ~NetStreamSensorChannel();
+
+    static AbstractSensorChannel* factoryMethod(const QString& id)
+    {
+        NetStreamSensorChannel* sc = new NetStreamSensorChannel(id);
+        return sc;
+    }
+
+    /**
+     * Start streaming the configured channels.
+     *
+     * @param sessionId session used to request the streamed nodes.
+     * @return was any channel started.
+     */
+    bool startStreaming(int sessionId);
+
+    /**
+     * Stop streaming and release the streamed nodes.
+     */
+    void stopStreaming();
+
+protected:
+    NetStreamSensorChannel(const QString& id);
+
+private:
+    /**
+     * Streamed channel.
+     */
+    struct Stream
+    {
+        QString      node;     /**< node ID */
+        bool         adaptor;  /**< is the node a device adaptor */
+        NodeBase*    source;   /**< node owning the buffer */
+        NetStreamer* streamer; /**< streamer of the buffer */
+    };
+
+    /**
+     * Stop node of a stream and release it.
+     *
+     * @param stream stream.
+     */
+    void releaseNode(const Stream& stream);
+
+    QList<Stream>  streams_;   /**< streamed channels */
+    ChainScheduler scheduler_; /**< runs the streamers */
+    int            sessionId_; /**< session of the streamed nodes */
+};
+
+#endif // NETSTREAMSENSOR_H
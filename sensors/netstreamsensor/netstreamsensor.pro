@@ -0,0 +1,11 @@
+TARGET       = netstreamsensor
+
+HEADERS += netstreamsensor.h \
+           netstreamer.h \
+           netstreamplugin.h
+
+SOURCES += netstreamsensor.cpp \
+           netstreamer.cpp \
+           netstreamplugin.cpp
+
+include( ../sensor-config.pri )
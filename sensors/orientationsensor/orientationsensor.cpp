@@ -32,18 +32,20 @@
 
 OrientationSensorChannel::OrientationSensorChannel(const QString& id) :
         AbstractSensorChannel(id),
-        DataEmitter<PoseData>(1),
+        DataEmitter<PoseData>(chunkSize(1)),
         prevOrientation(PoseData::Undefined)
 {
+    NodeArenaScope scope(&arena());
     SensorManager& sm = SensorManager::instance();
 
     orientationChain_ = sm.requestChain("orientationchain");
     Q_ASSERT( orientationChain_ );
     setValid(orientationChain_->isValid());
 
-    orientationReader_ = new BufferReader<PoseData>(1);
+    orientationReader_ = new BufferReader<PoseData>(chunkSize(1));
 
-    outputBuffer_ = new RingBuffer<PoseData>(1);
+    outputBuffer_ = new RingBuffer<PoseData>(chunkSize(1));
+    nameInternalBuffer("output", outputBuffer_);
 
     // Create buffers for filter chain
     filterBin_ = new Bin;
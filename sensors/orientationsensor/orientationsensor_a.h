@@ -27,8 +27,6 @@
 #ifndef ORIENTATION_SENSOR_H
 #define ORIENTATION_SENSOR_H
 
-#include <QtDBus/QtDBus>
-
 #include "datatypes/orientation.h"
 #include "datatypes/unsigned.h"
 #include "abstractsensor_a.h"
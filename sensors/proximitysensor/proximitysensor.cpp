@@ -33,16 +33,18 @@
 
 ProximitySensorChannel::ProximitySensorChannel(const QString& id) :
         AbstractSensorChannel(id),
-        DataEmitter<ProximityData>(1)
+        DataEmitter<ProximityData>(chunkSize(1))
 {
+    NodeArenaScope scope(&arena());
     SensorManager& sm = SensorManager::instance();
 
     proximityAdaptor_ = sm.requestDeviceAdaptor("proximityadaptor");
     Q_ASSERT( proximityAdaptor_ );
 
-    proximityReader_ = new BufferReader<ProximityData>(1);
+    proximityReader_ = new BufferReader<ProximityData>(chunkSize(1));
 
-    outputBuffer_ = new RingBuffer<ProximityData>(1);
+    outputBuffer_ = new RingBuffer<ProximityData>(chunkSize(1));
+    nameInternalBuffer("output", outputBuffer_);
 
     // Create buffers for filter chain
     filterBin_ = new Bin;
@@ -106,6 +108,11 @@ bool ProximitySensorChannel::stop()
     return true;
 }
 
+bool ProximitySensorChannel::changeThresholdSupported() const
+{
+    return true;
+}
+
 void ProximitySensorChannel::emitData(const ProximityData& value)
 {
     previousValue_.timestamp_ = value.timestamp_;
@@ -113,8 +120,10 @@ void ProximitySensorChannel::emitData(const ProximityData& value)
     if (value.value_ != previousValue_.value_ ||
         value.withinProximity_ != previousValue_.withinProximity_)
     {
+        // Crossing the proximity limit is delivered regardless of thresholds.
+        bool crossed = value.withinProximity_ != previousValue_.withinProximity_;
         previousValue_.value_ = value.value_;
         previousValue_.withinProximity_ = value.withinProximity_;
-        writeToClients((const void *)&value, sizeof(ProximityData));
+        writeChangesToClients((const void *)&value, sizeof(ProximityData), value.value_, crossed);
     }
 }
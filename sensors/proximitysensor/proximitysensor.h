@@ -71,6 +71,8 @@ public:
 
     Proximity proximityReflectance() const { return previousValue_; }
 
+    virtual bool changeThresholdSupported() const;
+
 public Q_SLOTS:
     bool start();
     bool stop();
@@ -27,8 +27,6 @@
 #ifndef PROXIMITY_SENSOR_H
 #define PROXIMITY_SENSOR_H
 
-#include <QtDBus/QtDBus>
-
 #include "abstractsensor_a.h"
 #include "datatypes/unsigned.h"
 #include "datatypes/proximity.h"
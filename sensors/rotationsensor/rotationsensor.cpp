@@ -30,39 +30,78 @@
 #include "sensormanager.h"
 #include "bin.h"
 #include "bufferreader.h"
+#include "loader.h"
+#include "config.h"
 
 RotationSensorChannel::RotationSensorChannel(const QString& id) :
         AbstractSensorChannel(id),
-        DataEmitter<TimedXyzData>(1),
+        DataEmitter<TimedXyzData>(chunkSize(FILTER_BATCH_SIZE)),
+        accelerometerChain_(NULL),
+        compassChain_(NULL),
+        rotationAdaptor_(NULL),
+        rotationReader_(NULL),
+        absoluteRotation_(false),
+        accelerometerReader_(NULL),
         compassReader_(NULL),
-        prevRotation_(0,0,0,0)
+        rotationFilter_(NULL),
+        prevRotation_(0,0,0,0),
+        outputInterval_(0)
 {
+    NodeArenaScope scope(&arena());
     SensorManager& sm = SensorManager::instance();
 
+    outputBuffer_ = new RingBuffer<TimedXyzData>(chunkSize(FILTER_BATCH_SIZE));
+    nameInternalBuffer("output", outputBuffer_);
+
+    // Create buffers for filter chain
+    filterBin_ = new Bin;
+    filterBin_->add(outputBuffer_, "buffer");
+
+    marshallingBin_ = new Bin;
+    marshallingBin_->add(this, "sensorchannel");
+
+    outputBuffer_->join(this);
+
+    setDescription("x, y, and z axes rotation in degrees");
+    introduceAvailableDataRange(DataRange(-179, 180, 1));
+
+    rotationAdaptor_ = requestRotationAdaptor();
+    if (rotationAdaptor_)
+    {
+        // Sensor hub delivers rotation in the format of the filter
+        setValid(true);
+        absoluteRotation_ = rotationAdaptor_->property("absolute").toBool();
+        rotationReader_ = new BufferReader<TimedXyzData>(chunkSize(FILTER_BATCH_SIZE));
+        filterBin_->add(rotationReader_, "rotationvector");
+        filterBin_->join("rotationvector", "source", "buffer", "sink");
+        connectToSource(rotationAdaptor_, "rotationvector", rotationReader_);
+        addStandbyOverrideSource(rotationAdaptor_);
+        foreach (const DataRange& range, rotationAdaptor_->getAvailableIntervals())
+            introduceAvailableInterval(range);
+        setDefaultInterval(100);
+        return;
+    }
+
     accelerometerChain_ = sm.requestChain("accelerometerchain");
     Q_ASSERT( accelerometerChain_ );
     setValid(accelerometerChain_->isValid());
 
-    accelerometerReader_ = new BufferReader<AccelerationData>(1);
+    accelerometerReader_ = new BufferReader<AccelerationData>(chunkSize(FILTER_BATCH_SIZE));
 
     compassChain_ = sm.requestChain("compasschain");
     if (compassChain_ && compassChain_->isValid()) {
-        compassReader_ = new BufferReader<CompassData>(1);
+        compassReader_ = new BufferReader<CompassData>(chunkSize(FILTER_BATCH_SIZE));
     } else {
         sensordLogW() << "Unable to use compass for z-axis rotation.";
     }
 
     rotationFilter_ = sm.instantiateFilter("rotationfilter");
     Q_ASSERT(rotationFilter_);
-
-    outputBuffer_ = new RingBuffer<TimedXyzData>(1);
-
-    // Create buffers for filter chain
-    filterBin_ = new Bin;
+    // Accelerometer chain may run for other sensors while this is stopped
+    setFilterProperty("enabled", false);
 
     filterBin_->add(accelerometerReader_, "accelerometer");
     filterBin_->add(rotationFilter_, "rotationfilter");
-    filterBin_->add(outputBuffer_, "buffer");
 
     if (hasZ())
     {
@@ -81,13 +120,6 @@ RotationSensorChannel::RotationSensorChannel(const QString& id) :
         addStandbyOverrideSource(compassChain_);
     }
 
-    marshallingBin_ = new Bin;
-    marshallingBin_->add(this, "sensorchannel");
-
-    outputBuffer_->join(this);
-
-    setDescription("x, y, and z axes rotation in degrees");
-    introduceAvailableDataRange(DataRange(-179, 180, 1));
     addStandbyOverrideSource(accelerometerChain_);
 
     // Provide interval value from acc, but range depends on sane compass
@@ -100,7 +132,10 @@ RotationSensorChannel::RotationSensorChannel(const QString& id) :
             introduceAvailableInterval(DataRange(ranges[i], ranges[i], 0));
         }
     } else {
-        setIntervalSource(accelerometerChain_);
+        // Interval is kept locally so that rotation is computed only as
+        // often as rotation sessions need, accelerometer may run faster.
+        foreach (const DataRange& range, accelerometerChain_->getAvailableIntervals())
+            introduceAvailableInterval(range);
     }
 
     setDefaultInterval(100); // Tricky. Might need to make this conditional.
@@ -110,14 +145,23 @@ RotationSensorChannel::~RotationSensorChannel()
 {
     SensorManager& sm = SensorManager::instance();
 
-    disconnectFromSource(accelerometerChain_, "accelerometer", accelerometerReader_);
-    sm.releaseChain("accelerometerchain");
-
-    if (hasZ())
+    if (rotationAdaptor_)
     {
-        disconnectFromSource(compassChain_, "truenorth", compassReader_);
-        sm.releaseChain("compasschain");
-        delete compassReader_;
+        disconnectFromSource(rotationAdaptor_, "rotationvector", rotationReader_);
+        sm.releaseDeviceAdaptor("rotationvectoradaptor");
+        delete rotationReader_;
+    }
+    else
+    {
+        disconnectFromSource(accelerometerChain_, "accelerometer", accelerometerReader_);
+        sm.releaseChain("accelerometerchain");
+
+        if (compassReader_)
+        {
+            disconnectFromSource(compassChain_, "truenorth", compassReader_);
+            sm.releaseChain("compasschain");
+            delete compassReader_;
+        }
     }
 
     delete accelerometerReader_;
@@ -127,11 +171,42 @@ RotationSensorChannel::~RotationSensorChannel()
     delete filterBin_;
 }
 
+DeviceAdaptor* RotationSensorChannel::requestRotationAdaptor()
+{
+    if (!Config::configuration()->value<bool>("rotation/hal_rotation_vector", false))
+        return NULL;
+
+    // Adaptor is not a plugin dependency, devices without one fall back
+    SensorManager& sm = SensorManager::instance();
+    DeviceAdaptor* adaptor = NULL;
+    if (Loader::instance().loadPluginFor("rotationvectoradaptor"))
+        adaptor = sm.requestDeviceAdaptor("rotationvectoradaptor");
+    if (adaptor && !adaptor->isValid())
+    {
+        sm.releaseDeviceAdaptor("rotationvectoradaptor");
+        adaptor = NULL;
+    }
+    if (!adaptor)
+        sensordLogW() << "HAL rotation vector not available, computing rotation from accelerometer and compass.";
+    return adaptor;
+}
+
 bool RotationSensorChannel::start()
 {
     sensordLogD() << "Starting RotationSensorChannel";
 
     if (AbstractSensorChannel::start()) {
+        if (rotationAdaptor_) {
+            marshallingBin_->start();
+            filterBin_->start();
+            rotationAdaptor_->startSensor();
+            return true;
+        }
+        // Removed requests do not reach setInterval(), use the current winner
+        int sessionId;
+        unsigned int value = evaluateIntervalRequests(sessionId);
+        setOutputInterval(sessionId >= 0 ? value : 0);
+        setFilterProperty("enabled", true);
         marshallingBin_->start();
         filterBin_->start();
         accelerometerChain_->start();
@@ -149,6 +224,12 @@ bool RotationSensorChannel::stop()
     sensordLogD() << "Stopping RotationSensorChannel";
 
     if (AbstractSensorChannel::stop()) {
+        if (rotationAdaptor_) {
+            rotationAdaptor_->stopSensor();
+            filterBin_->stop();
+            marshallingBin_->stop();
+            return true;
+        }
         accelerometerChain_->stop();
         filterBin_->stop();
         if (hasZ())
@@ -157,6 +238,7 @@ bool RotationSensorChannel::stop()
             compassChain_->setProperty("compassEnabled", false);
         }
         marshallingBin_->stop();
+        setFilterProperty("enabled", false);
     }
     return true;
 }
@@ -169,14 +251,27 @@ void RotationSensorChannel::emitData(const TimedXyzData& value)
     downsampleAndPropagate(value, downsampleBuffer_);
 }
 
+void RotationSensorChannel::emitData(const TimedXyzData* values, unsigned n)
+{
+    QMutexLocker locker(&mutex_);
+
+    prevRotation_ = values[n - 1];
+    downsampleAndPropagate(values, n, downsampleBuffer_);
+}
+
 unsigned int RotationSensorChannel::interval() const
 {
-    // Just provide accelerometer rate for now.
-    return accelerometerChain_->getInterval();
+    if (rotationAdaptor_)
+        return rotationAdaptor_->getInterval();
+    return qMax(outputInterval_, accelerometerChain_->getInterval());
 }
 
 bool RotationSensorChannel::setInterval(unsigned int value, int sessionId)
 {
+    if (rotationAdaptor_)
+        return rotationAdaptor_->setIntervalRequest(sessionId, value);
+
+    setOutputInterval(value);
     bool success = accelerometerChain_->setIntervalRequest(sessionId, value);
     if (hasZ())
     {
@@ -186,13 +281,20 @@ bool RotationSensorChannel::setInterval(unsigned int value, int sessionId)
     return success;
 }
 
-void RotationSensorChannel::removeSession(int sessionId)
+bool RotationSensorChannel::downsamplingSupported() const
 {
-    downsampleBuffer_.remove(sessionId);
-    AbstractSensorChannel::removeSession(sessionId);
+    return true;
 }
 
-bool RotationSensorChannel::downsamplingSupported() const
+void RotationSensorChannel::setFilterProperty(const char* name, const QVariant& value)
 {
-    return true;
+    QObject* filter = dynamic_cast<QObject*>(rotationFilter_);
+    if (filter)
+        filter->setProperty(name, value);
+}
+
+void RotationSensorChannel::setOutputInterval(unsigned int value)
+{
+    outputInterval_ = value;
+    setFilterProperty("outputInterval", value);
 }
@@ -28,8 +28,10 @@
 #define ROTATION_SENSOR_CHANNEL_H
 
 #include <QMutex>
+#include <QVariant>
 #include "abstractsensor.h"
 #include "abstractchain.h"
+#include "deviceadaptor.h"
 #include "rotationsensor_a.h"
 #include "dataemitter.h"
 #include "datatypes/orientationdata.h"
@@ -40,6 +42,11 @@ class FilterBase;
 
 /**
  * @brief Sensor providing device rotation around axes.
+ *
+ * Rotation is computed from accelerometer and compass by RotationFilter.
+ * With <em>rotation/hal_rotation_vector</em> set it is taken from the
+ * rotation vector of the sensor hub instead, through rotationvectoradaptor,
+ * when the device configures one.
  */
 class RotationSensorChannel :
         public AbstractSensorChannel,
@@ -69,14 +76,12 @@ public:
 
     bool hasZ() const
     {
-        return compassReader_;
+        return compassReader_ || absoluteRotation_;
     }
 
     virtual unsigned int interval() const;
     virtual bool setInterval(unsigned int value, int sessionId);
 
-    virtual void removeSession(int sessionId);
-
     virtual bool downsamplingSupported() const;
 
 public Q_SLOTS:
@@ -99,6 +104,9 @@ private:
     Bin*                         marshallingBin_;
     AbstractChain*               accelerometerChain_;
     AbstractChain*               compassChain_;
+    DeviceAdaptor*               rotationAdaptor_;     /**< HAL rotation vector or NULL */
+    BufferReader<TimedXyzData>*  rotationReader_;      /**< reader of rotationAdaptor_ */
+    bool                         absoluteRotation_;    /**< is HAL rotation around z referenced to north */
     BufferReader<TimedXyzData>*  accelerometerReader_;
     BufferReader<CompassData>*   compassReader_;
     FilterBase*                  rotationFilter_;
@@ -106,8 +114,33 @@ private:
     TimedXyzData                 prevRotation_;
     TimedXyzDownsampleBuffer     downsampleBuffer_;
     QMutex                       mutex_;
+    unsigned int                 outputInterval_; /**< interval of rotationFilter_ output */
 
     void emitData(const TimedXyzData& value);
+    void emitData(const TimedXyzData* values, unsigned n);
+
+    /**
+     * Set a property of the rotation filter. The filter lives in its own
+     * plugin and is controlled through Qt properties.
+     *
+     * @param name property name.
+     * @param value property value.
+     */
+    void setFilterProperty(const char* name, const QVariant& value);
+
+    /**
+     * Compute rotation only as often as sessions need.
+     *
+     * @param value interval in milliseconds, 0 for every sample.
+     */
+    void setOutputInterval(unsigned int value);
+
+    /**
+     * Request the HAL rotation vector adaptor if configured.
+     *
+     * @return valid adaptor or NULL.
+     */
+    static DeviceAdaptor* requestRotationAdaptor();
 };
 
 #endif // ROTATION_SENSOR_CHANNEL_H
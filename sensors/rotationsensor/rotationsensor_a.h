@@ -27,8 +27,6 @@
 #ifndef ROTATION_SENSOR_H
 #define ROTATION_SENSOR_H
 
-#include <QtDBus/QtDBus>
-
 #include "datatypes/xyz.h"
 #include "abstractsensor_a.h"
 
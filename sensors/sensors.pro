@@ -11,6 +11,10 @@ SUBDIRS  = accelerometersensor \
            compasssensor \
            rotationsensor \
            magnetometersensor \
-           gyroscopesensor
+           gyroscopesensor \
+           fusionsensor \
+           statisticssensor \
+           integratedgyroscopesensor \
+           netstreamsensor
 
-contextprovider:SUBDIRS += contextplugin
+contextprovider:!nodbus:SUBDIRS += contextplugin
@@ -0,0 +1,83 @@
+/**
+   @file statisticsfilter.cpp
+   @brief StatisticsFilter
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "statisticsfilter.h"
+
+StatisticsFilter::StatisticsFilter(unsigned int window) :
+    Filter<TimedXyzData, StatisticsFilter, XyzStatisticsData>(this, &StatisticsFilter::filter),
+    window_(qMax(1u, window)),
+    start_(0),
+    last_(0)
+{
+}
+
+unsigned int StatisticsFilter::window() const
+{
+    return window_;
+}
+
+void StatisticsFilter::setWindow(unsigned int window)
+{
+    window_ = qMax(1u, window);
+    reset();
+}
+
+void StatisticsFilter::reset()
+{
+    for (int axis = 0; axis < 3; ++axis)
+        stats_[axis].reset();
+}
+
+void StatisticsFilter::filter(unsigned n, const TimedXyzData* data)
+{
+    FilterBatch<XyzStatisticsData> batch;
+    const quint64 length = window_ * 1000ULL;
+
+    for (unsigned i = 0; i < n; ++i, ++data) {
+        if (stats_[0].count() && data->timestamp_ >= start_ + length) {
+            batch.append(record());
+            reset();
+        }
+        if (!stats_[0].count())
+            start_ = data->timestamp_;
+        last_ = data->timestamp_;
+        stats_[0].add(data->x_);
+        stats_[1].add(data->y_);
+        stats_[2].add(data->z_);
+    }
+
+    batch.propagate(source_);
+}
+
+XyzStatisticsData StatisticsFilter::record() const
+{
+    XyzStatisticsData data;
+    data.timestamp_ = last_;
+    data.count_ = stats_[0].count();
+    data.window_ = window_;
+    for (int axis = 0; axis < 3; ++axis) {
+        data.min_[axis] = (int)stats_[axis].min();
+        data.max_[axis] = (int)stats_[axis].max();
+        data.mean_[axis] = stats_[axis].mean();
+        data.variance_[axis] = stats_[axis].variance();
+    }
+    return data;
+}
@@ -0,0 +1,84 @@
+/**
+   @file statisticsfilter.h
+   @brief StatisticsFilter
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef STATISTICSFILTER_H
+#define STATISTICSFILTER_H
+
+#include "filter.h"
+#include "runningstatistics.h"
+#include "datatypes/genericdata.h"
+#include "datatypes/statisticsdata.h"
+
+/**
+ * @brief Windowed statistics of XYZ samples.
+ *
+ * Collects per axis minimum, maximum, mean and variance of the samples
+ * whose timestamps fall in consecutive windows of fixed length, and
+ * outputs one XyzStatisticsData per window. A window is closed by the
+ * first sample past its end, so records are never emitted for windows
+ * the sampling has not yet covered.
+ */
+class StatisticsFilter : public Filter<TimedXyzData, StatisticsFilter, XyzStatisticsData>
+{
+public:
+    /**
+     * Constructor.
+     *
+     * @param window window length in milliseconds.
+     */
+    StatisticsFilter(unsigned int window = 1000);
+
+    /**
+     * Window length.
+     *
+     * @return window length in milliseconds.
+     */
+    unsigned int window() const;
+
+    /**
+     * Set window length. Samples of the open window are dropped.
+     *
+     * @param window window length in milliseconds, at least 1.
+     */
+    void setWindow(unsigned int window);
+
+    /**
+     * Drop samples of the open window.
+     */
+    void reset();
+
+private:
+    void filter(unsigned n, const TimedXyzData* data);
+
+    /**
+     * Statistics of the open window.
+     *
+     * @return record.
+     */
+    XyzStatisticsData record() const;
+
+    unsigned int      window_;   /**< window length in milliseconds */
+    quint64           start_;    /**< timestamp of the first sample in the window */
+    quint64           last_;     /**< timestamp of the last sample in the window */
+    RunningStatistics stats_[3]; /**< statistics of x, y and z */
+};
+
+#endif // STATISTICSFILTER_H
@@ -0,0 +1,146 @@
+/**
+   @file statisticssensor.cpp
+   @brief StatisticsSensor
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "statisticssensor.h"
+#include "statisticsfilter.h"
+#include "sensormanager.h"
+#include "config.h"
+#include "bin.h"
+#include "bufferreader.h"
+
+StatisticsSensorChannel::StatisticsSensorChannel(const QString& id) :
+        AbstractSensorChannel(id),
+        DataEmitter<XyzStatisticsData>(chunkSize(FILTER_BATCH_SIZE)),
+        accelerometerChain_(NULL),
+        gyroscopeAdaptor_(NULL)
+{
+    NodeArenaScope scope(&arena());
+    SensorManager& sm = SensorManager::instance();
+
+    NodeBase* source;
+    QString bufferName;
+    if (id.startsWith("gyroscope")) {
+        gyroscopeAdaptor_ = sm.requestDeviceAdaptor("gyroscopeadaptor");
+        Q_ASSERT( gyroscopeAdaptor_ );
+        source = gyroscopeAdaptor_;
+        bufferName = "gyroscope";
+        setDescription("per window x, y and z angular velocity statistics in mdps");
+    } else {
+        accelerometerChain_ = sm.requestChain("accelerometerchain");
+        Q_ASSERT( accelerometerChain_ );
+        source = accelerometerChain_;
+        bufferName = "accelerometer";
+        setDescription("per window x, y and z acceleration statistics in mG");
+    }
+    setValid(source->isValid());
+
+    reader_ = new BufferReader<TimedXyzData>(chunkSize(FILTER_BATCH_SIZE));
+    statisticsFilter_ = new StatisticsFilter(Config::configuration()->value<unsigned int>(id + "/window", 1000));
+
+    outputBuffer_ = new RingBuffer<XyzStatisticsData>(chunkSize(FILTER_BATCH_SIZE));
+    nameInternalBuffer("output", outputBuffer_);
+
+    // Create buffers for filter chain
+    filterBin_ = new Bin;
+    filterBin_->add(reader_, "input");
+    filterBin_->add(statisticsFilter_, "statistics");
+    filterBin_->add(outputBuffer_, "output");
+
+    filterBin_->join("input", "source", "statistics", "sink");
+    filterBin_->join("statistics", "source", "output", "sink");
+
+    connectToSource(source, bufferName, reader_);
+
+    marshallingBin_ = new Bin;
+    marshallingBin_->add(this, "sensorchannel");
+
+    outputBuffer_->join(this);
+
+    setRangeSource(source);
+    addStandbyOverrideSource(source);
+    setIntervalSource(source);
+}
+
+StatisticsSensorChannel::~StatisticsSensorChannel()
+{
+    SensorManager& sm = SensorManager::instance();
+
+    if (gyroscopeAdaptor_) {
+        disconnectFromSource(gyroscopeAdaptor_, "gyroscope", reader_);
+        sm.releaseDeviceAdaptor("gyroscopeadaptor");
+    } else {
+        disconnectFromSource(accelerometerChain_, "accelerometer", reader_);
+        sm.releaseChain("accelerometerchain");
+    }
+
+    delete reader_;
+    delete statisticsFilter_;
+    delete outputBuffer_;
+    delete marshallingBin_;
+    delete filterBin_;
+}
+
+unsigned int StatisticsSensorChannel::window() const
+{
+    return statisticsFilter_->window();
+}
+
+bool StatisticsSensorChannel::start()
+{
+    sensordLogD() << "Starting StatisticsSensorChannel";
+
+    if (AbstractSensorChannel::start()) {
+        // Windows do not span pauses of the sensor
+        statisticsFilter_->reset();
+        marshallingBin_->start();
+        filterBin_->start();
+        if (gyroscopeAdaptor_)
+            gyroscopeAdaptor_->startSensor();
+        else
+            accelerometerChain_->start();
+    }
+    return true;
+}
+
+bool StatisticsSensorChannel::stop()
+{
+    sensordLogD() << "Stopping StatisticsSensorChannel";
+
+    if (AbstractSensorChannel::stop()) {
+        if (gyroscopeAdaptor_)
+            gyroscopeAdaptor_->stopSensor();
+        else
+            accelerometerChain_->stop();
+        filterBin_->stop();
+        marshallingBin_->stop();
+    }
+    return true;
+}
+
+void StatisticsSensorChannel::emitData(const XyzStatisticsData& value)
+{
+    writeToClients((const void*)(&value), sizeof(XyzStatisticsData));
+}
+
+void StatisticsSensorChannel::emitData(const XyzStatisticsData* values, unsigned n)
+{
+    writeToClients((const void*)values, sizeof(XyzStatisticsData), n);
+}
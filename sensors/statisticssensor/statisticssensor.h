@@ -0,0 +1,94 @@
+/**
+   @file statisticssensor.h
+   @brief StatisticsSensor
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef STATISTICS_SENSOR_CHANNEL_H
+#define STATISTICS_SENSOR_CHANNEL_H
+
+#include "abstractsensor.h"
+#include "abstractchain.h"
+#include "deviceadaptor.h"
+#include "statisticssensor_a.h"
+#include "dataemitter.h"
+#include "datatypes/statisticsdata.h"
+
+class Bin;
+template <class TYPE> class BufferReader;
+class StatisticsFilter;
+
+/**
+ * @brief Sensor providing windowed statistics of motion samples.
+ *
+ * Per axis minimum, maximum, mean and variance of accelerometer
+ * (accelerometerstatisticssensor) or gyroscope
+ * (gyroscopestatisticssensor) samples are computed in the daemon and
+ * written to clients once per window of <em>id</em>/window milliseconds
+ * (default 1000). Interval requests set the sampling interval of the
+ * underlying sensor.
+ */
+class StatisticsSensorChannel :
+        public AbstractSensorChannel,
+        public DataEmitter<XyzStatisticsData>
+{
+    Q_OBJECT;
+    Q_PROPERTY(unsigned int window READ window);
+
+public:
+    /**
+     * Factory method for StatisticsSensorChannel.
+     * @return new StatisticsSensorChannel as AbstractSensorChannel*.
+     */
+    static AbstractSensorChannel* factoryMethod(const QString& id)
+    {
+        StatisticsSensorChannel* sc = new StatisticsSensorChannel(id);
+        new StatisticsSensorChannelAdaptor(sc);
+
+        return sc;
+    }
+
+    /**
+     * Window length.
+     *
+     * @return window length in milliseconds.
+     */
+    unsigned int window() const;
+
+public Q_SLOTS:
+    bool start();
+    bool stop();
+
+protected:
+    StatisticsSensorChannel(const QString& id);
+    virtual ~StatisticsSensorChannel();
+
+private:
+    Bin*                               filterBin_;
+    Bin*                               marshallingBin_;
+    AbstractChain*                     accelerometerChain_;
+    DeviceAdaptor*                     gyroscopeAdaptor_;
+    BufferReader<TimedXyzData>*        reader_;
+    StatisticsFilter*                  statisticsFilter_;
+    RingBuffer<XyzStatisticsData>*     outputBuffer_;
+
+    void emitData(const XyzStatisticsData& value);
+    void emitData(const XyzStatisticsData* values, unsigned n);
+};
+
+#endif // STATISTICS_SENSOR_CHANNEL_H
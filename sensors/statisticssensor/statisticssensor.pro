@@ -0,0 +1,13 @@
+TARGET       = statisticssensor
+
+HEADERS += statisticssensor.h   \
+           statisticssensor_a.h \
+           statisticsfilter.h   \
+           statisticsplugin.h
+
+SOURCES += statisticssensor.cpp   \
+           statisticssensor_a.cpp \
+           statisticsfilter.cpp   \
+           statisticsplugin.cpp
+
+include( ../sensor-config.pri )
@@ -0,0 +1,41 @@
+/**
+   @file statisticssensor_a.h
+   @brief D-Bus adaptor for StatisticsSensor
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef STATISTICS_SENSOR_H
+#define STATISTICS_SENSOR_H
+
+#include "abstractsensor_a.h"
+
+class StatisticsSensorChannelAdaptor : public AbstractSensorChannelAdaptor
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(StatisticsSensorChannelAdaptor)
+    Q_CLASSINFO("D-Bus Interface", "local.StatisticsSensor")
+    Q_PROPERTY(unsigned int window READ window)
+
+public:
+    StatisticsSensorChannelAdaptor(QObject* parent);
+
+public Q_SLOTS:
+    unsigned int window() const;
+};
+
+#endif
@@ -32,16 +32,18 @@
 
 TapSensorChannel::TapSensorChannel(const QString& id) :
         AbstractSensorChannel(id),
-        DataEmitter<TapData>(1)
+        DataEmitter<TapData>(chunkSize(1))
 {
+    NodeArenaScope scope(&arena());
     SensorManager& sm = SensorManager::instance();
 
     tapAdaptor_ = sm.requestDeviceAdaptor("tapadaptor");
     Q_ASSERT( tapAdaptor_ );
 
-    tapReader_ = new BufferReader<TapData>(1);
+    tapReader_ = new BufferReader<TapData>(chunkSize(1));
 
-    outputBuffer_ = new RingBuffer<TapData>(1);
+    outputBuffer_ = new RingBuffer<TapData>(chunkSize(1));
+    nameInternalBuffer("output", outputBuffer_);
 
     // Create buffers for filter chain
     filterBin_ = new Bin;
@@ -27,7 +27,6 @@
 #ifndef TAP_SENSOR_H
 #define TAP_SENSOR_H
 
-#include <QtDBus/QtDBus>
 #include <QObject>
 
 #include "abstractsensor_a.h"
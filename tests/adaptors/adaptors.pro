@@ -47,4 +47,12 @@ INCLUDEPATH += ../.. \
 
 QMAKE_LIBDIR_FLAGS += -L../../builddir/core -L../../core/ -lrt
 
+contains(CONFIG,hybris) {
+    DEFINES += SENSORFW_HYBRIS_TEST
+    HEADERS += ../../adaptors/hybrisaccelerometer/hybrisaccelerometeradaptor.h
+    SOURCES += ../../adaptors/hybrisaccelerometer/hybrisaccelerometeradaptor.cpp
+    INCLUDEPATH += ../../adaptors/hybrisaccelerometer
+    QMAKE_LIBDIR_FLAGS += -lhybrissensorfw-qt5
+}
+
 include(../../common.pri)
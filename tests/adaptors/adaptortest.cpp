@@ -39,9 +39,14 @@
 #include "kbslideradaptor.h"
 #include "proximityadaptor.h"
 #include "gyroscopeadaptor.h"
+#include "sysfsadaptor.h"
 
 #include "config.h"
 
+#ifdef SENSORFW_HYBRIS_TEST
+#include "hybrisaccelerometeradaptor.h"
+#endif
+
 void AdaptorTest::initTestCase()
 {
     Config::loadConfig("/etc/sensorfw/sensord.conf", "/etc/sensorfw/sensord.conf.d");
@@ -156,5 +161,67 @@ void AdaptorTest::testGyroscopeAdaptor()
     adaptor->stopAdaptor();
 }
 
+void AdaptorTest::testParseValues()
+{
+    long values[3];
+
+    QCOMPARE(SysfsAdaptor::parseValues("42\n", 3, values, 3), 1);
+    QCOMPARE(values[0], 42L);
+
+    QCOMPARE(SysfsAdaptor::parseValues("(-12,0,+7)", 10, values, 3), 3);
+    QCOMPARE(values[0], -12L);
+    QCOMPARE(values[1], 0L);
+    QCOMPARE(values[2], 7L);
+
+    QCOMPARE(SysfsAdaptor::parseValues("x: 5 y: -6", 10, values, 3), 2);
+    QCOMPARE(values[0], 5L);
+    QCOMPARE(values[1], -6L);
+
+    QCOMPARE(SysfsAdaptor::parseValues("ff:10:0", 7, values, 3, SysfsAdaptor::HexValues), 3);
+    QCOMPARE(values[0], 255L);
+    QCOMPARE(values[1], 16L);
+    QCOMPARE(values[2], 0L);
+
+    // Only the given bytes are parsed
+    QCOMPARE(SysfsAdaptor::parseValues("123456", 3, values, 3), 1);
+    QCOMPARE(values[0], 123L);
+
+    QCOMPARE(SysfsAdaptor::parseValues("", 0, values, 3), 0);
+    QCOMPARE(SysfsAdaptor::parseValues("-", 1, values, 3), 0);
+    QCOMPARE(SysfsAdaptor::parseValues("1 2 3 4", 7, values, 3), -1);
+    QCOMPARE(SysfsAdaptor::parseValues("99999999999999999999999", 23, values, 3), -1);
+}
+
+#ifdef SENSORFW_HYBRIS_TEST
+void AdaptorTest::testHybrisAdaptorRecreate()
+{
+    HybrisManager* manager = HybrisManager::instance();
+    int registered = manager->adaptorCount(SENSOR_TYPE_ACCELEROMETER);
+
+    DeviceAdaptor* adaptor = HybrisAccelerometerAdaptor::factoryMethod("accelerometeradaptor");
+    QVERIFY(adaptor);
+    QCOMPARE(manager->adaptorCount(SENSOR_TYPE_ACCELEROMETER), registered + 1);
+    QVERIFY(adaptor->startAdaptor());
+    QVERIFY(adaptor->startSensor());
+    adaptor->stopSensor();
+    adaptor->stopAdaptor();
+
+    // Deleted adaptor must not be left for dispatch
+    delete adaptor;
+    QCOMPARE(manager->adaptorCount(SENSOR_TYPE_ACCELEROMETER), registered);
+
+    // Created again it is registered once and runs as before
+    adaptor = HybrisAccelerometerAdaptor::factoryMethod("accelerometeradaptor");
+    QVERIFY(adaptor);
+    QCOMPARE(manager->adaptorCount(SENSOR_TYPE_ACCELEROMETER), registered + 1);
+    QVERIFY(adaptor->startAdaptor());
+    QVERIFY(adaptor->startSensor());
+    QTest::qWait(100);
+    adaptor->stopSensor();
+    adaptor->stopAdaptor();
+    delete adaptor;
+    QCOMPARE(manager->adaptorCount(SENSOR_TYPE_ACCELEROMETER), registered);
+}
+#endif
 
 QTEST_MAIN(AdaptorTest)
@@ -58,6 +58,14 @@ private slots:
     void testTouchAdaptor();
     void testGyroscopeAdaptor();
 
+    // Sysfs payload parsing
+    void testParseValues();
+
+#ifdef SENSORFW_HYBRIS_TEST
+    // Adaptor deleted when idle and created again
+    void testHybrisAdaptorRecreate();
+#endif
+
 };
 
 #endif // ADAPTORTEST_H
@@ -1,2 +1,10 @@
 TEMPLATE = subdirs
-SUBDIRS = benchmarktest fakeadaptor dummyclient
+SUBDIRS = benchmarktest fakeadaptor dummyclient dataflowbenchmark loaddriver clientbenchmark stressbenchmark slowclientbenchmark controlbenchmark startupbenchmark
+
+benchmarkcompare.files = sensorbenchmark-compare.py
+benchmarkcompare.path = /usr/bin
+
+benchmarkthresholds.files = benchmark-thresholds.conf
+benchmarkthresholds.path = /usr/share/sensorfw-tests
+
+INSTALLS += benchmarkcompare benchmarkthresholds
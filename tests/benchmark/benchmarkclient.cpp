@@ -0,0 +1,85 @@
+/**
+   @file benchmarkclient.cpp
+   @brief Client session shared by the client side benchmarks
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+*/
+
+
+#include <QDebug>
+#include "benchmarkclient.h"
+#include "sensormanagerinterface.h"
+#include "accelerometersensor_i.h"
+#include "datatypes/utils.h"
+
+BenchmarkClient::BenchmarkClient(const QString& sensorId, quint64 period, QObject* parent) :
+    QObject(parent),
+    sensor_(NULL),
+    period_(qMax(period, (quint64)1)),
+    last_(0),
+    samples_(0),
+    lost_(0)
+{
+    AccelerometerSensorChannelInterface* sensor = AccelerometerSensorChannelInterface::interface(sensorId);
+    if (sensor == NULL || !sensor->isValid()) {
+        qDebug() << "[BenchmarkClient] Unable to get session:" << SensorManagerInterface::instance().errorString();
+        delete sensor;
+        return;
+    }
+    connect(sensor, SIGNAL(dataAvailable(const XYZ&)), this, SLOT(data(const XYZ&)));
+    sensor->setStandbyOverride(true);
+    sensor_ = sensor;
+}
+
+BenchmarkClient::~BenchmarkClient()
+{
+    delete sensor_;
+}
+
+void BenchmarkClient::registerSensor(const QString& sensorId)
+{
+    SensorManagerInterface& sm = SensorManagerInterface::instance();
+    sm.loadPlugin(sensorId);
+    sm.registerSensorInterface<AccelerometerSensorChannelInterface>(sensorId);
+}
+
+void BenchmarkClient::start()
+{
+    if (sensor_)
+        sensor_->start();
+}
+
+void BenchmarkClient::stop()
+{
+    if (sensor_)
+        sensor_->stop();
+}
+
+void BenchmarkClient::data(const XYZ& data)
+{
+    quint64 now = Utils::getTimeStamp();
+    quint64 timestamp = data.XYZData().timestamp_;
+    // Steps longer than the adaptor period are samples lost on the way
+    if (last_ && timestamp > last_) {
+        quint64 steps = (timestamp - last_ + period_ / 2) / period_;
+        if (steps > 1)
+            lost_ += steps - 1;
+    }
+    last_ = qMax(last_, timestamp);
+    ++samples_;
+    latencies_.append(now > timestamp ? (quint32)qMin(now - timestamp, (quint64)0xffffffffu) : 0);
+}
@@ -0,0 +1,82 @@
+/**
+   @file benchmarkclient.h
+   @brief Client session shared by the client side benchmarks
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+*/
+
+
+#ifndef BENCHMARKCLIENT_H
+#define BENCHMARKCLIENT_H
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include "abstractsensor_i.h"
+#include "datatypes/xyz.h"
+
+/**
+ * Accelerometer session reading its samples promptly, counting them,
+ * their latency from the sample timestamp to delivery and samples
+ * missing from the timestamp sequence.
+ *
+ * Built into benchmarks which set <code>CONFIG += benchmarkclient</code>
+ * before including benchmarkresults.pri.
+ */
+class BenchmarkClient : public QObject
+{
+    Q_OBJECT
+public:
+    /**
+     * Open a session to the sensor.
+     *
+     * @param sensorId measured sensor.
+     * @param period generation period of the adaptor in microseconds.
+     */
+    BenchmarkClient(const QString& sensorId, quint64 period, QObject* parent = 0);
+    ~BenchmarkClient();
+
+    /**
+     * Load the plugin of an accelerometer type sensor and register its
+     * client interface.
+     *
+     * @param sensorId sensor.
+     */
+    static void registerSensor(const QString& sensorId);
+
+    bool isValid() const { return sensor_ != NULL; }
+
+    void start();
+    void stop();
+
+    unsigned long samples() const { return samples_; }
+    unsigned long lost() const { return lost_; }
+    const QVector<quint32>& latencies() const { return latencies_; }
+
+public slots:
+    void data(const XYZ& data);
+
+private:
+    AbstractSensorChannelInterface* sensor_;    /**< session */
+    quint64                         period_;    /**< expected timestamp step */
+    quint64                         last_;      /**< timestamp of the previous sample, 0 before the first */
+    unsigned long                   samples_;   /**< received samples */
+    unsigned long                   lost_;      /**< timestamp gaps in periods */
+    QVector<quint32>                latencies_; /**< latencies in microseconds */
+};
+
+#endif // BENCHMARKCLIENT_H
@@ -0,0 +1,143 @@
+/**
+   @file benchmarkresults.cpp
+   @brief Machine-readable benchmark results
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+*/
+
+
+#include "benchmarkresults.h"
+#include <QDir>
+#include <QFile>
+#include <QStringList>
+#include <QProcess>
+#include <QDebug>
+#include <qnumeric.h>
+
+QList<BenchmarkResults::Result> BenchmarkResults::results_;
+
+/**
+ * JSON string literal of text.
+ */
+static QString jsonString(const QString& text)
+{
+    QString quoted("\"");
+    for (int i = 0; i < text.size(); ++i) {
+        QChar c = text.at(i);
+        if (c == '"' || c == '\\')
+            quoted += QString("\\") + c;
+        else if (c.unicode() < 0x20)
+            quoted += QString("\\u%1").arg(c.unicode(), 4, 16, QChar('0'));
+        else
+            quoted += c;
+    }
+    return quoted + "\"";
+}
+
+/**
+ * JSON number, null for values JSON can not express.
+ */
+static QString jsonNumber(double value)
+{
+    return qIsFinite(value) ? QString::number(value, 'g', 10) : QString("null");
+}
+
+void BenchmarkResults::record(const QString& name, const QString& metric, const QString& unit,
+                              double value, Better better, unsigned long iterations, double variance)
+{
+    Result result;
+    result.name = name;
+    result.metric = metric;
+    result.unit = unit;
+    result.value = value;
+    result.iterations = iterations;
+    result.variance = variance;
+    result.better = better;
+    results_.append(result);
+}
+
+void BenchmarkResults::record(const QString& name, const QString& metric, const QString& unit,
+                              const QList<double>& values, Better better)
+{
+    if (values.isEmpty())
+        return;
+    double mean = 0;
+    foreach (double value, values)
+        mean += value;
+    mean /= values.size();
+    double variance = 0;
+    foreach (double value, values)
+        variance += (value - mean) * (value - mean);
+    if (values.size() > 1)
+        variance /= values.size() - 1;
+    record(name, metric, unit, mean, better, values.size(), variance);
+}
+
+bool BenchmarkResults::write(const QString& target)
+{
+    QString dir = qgetenv("SENSORFW_BENCHMARK_RESULTS");
+    if (dir.isEmpty())
+        dir = "/tmp/sensorfw-benchmarks";
+    QDir().mkpath(dir);
+    QString path = dir + "/" + target + ".json";
+
+    QStringList entries;
+    foreach (const Result& result, results_) {
+        // Quoted texts are not passed through arg(), they may hold '%'
+        entries << "    {\"name\": " + jsonString(result.name) +
+                   ", \"metric\": " + jsonString(result.metric) +
+                   ", \"unit\": " + jsonString(result.unit) +
+                   ", \"value\": " + jsonNumber(result.value) +
+                   ", \"iterations\": " + QString::number(result.iterations) +
+                   ", \"variance\": " + jsonNumber(result.variance) +
+                   ", \"better\": \"" + (result.better == HigherIsBetter ? "higher" : "lower") + "\"}";
+    }
+    results_.clear();
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Can not write benchmark results to" << path;
+        return false;
+    }
+    QString json = "{\"target\": " + jsonString(target) + ", \"results\": [\n" + entries.join(",\n") + "\n]}\n";
+    file.write(json.toUtf8());
+    qDebug() << "Benchmark results written to" << path;
+    return true;
+}
+
+long BenchmarkResults::residentKb(int pid)
+{
+    QFile file(QString("/proc/%1/status").arg(pid));
+    if (!file.open(QIODevice::ReadOnly))
+        return -1;
+    foreach (const QByteArray& line, file.readAll().split('\n')) {
+        if (line.startsWith("VmRSS:"))
+            return line.mid(6).trimmed().split(' ').first().toLong();
+    }
+    return -1;
+}
+
+int BenchmarkResults::sensordProcessId()
+{
+    QProcess process;
+    process.start(QString("pidof sensord"));
+    process.waitForReadyRead(1000);
+    int pid = process.readLine().trimmed().toInt();
+    process.close();
+    process.waitForFinished();
+    return pid;
+}
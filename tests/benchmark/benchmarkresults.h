@@ -0,0 +1,121 @@
+/**
+   @file benchmarkresults.h
+   @brief Machine-readable benchmark results
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+*/
+
+
+#ifndef BENCHMARKRESULTS_H
+#define BENCHMARKRESULTS_H
+
+#include <QList>
+#include <QString>
+
+/**
+ * Results of a benchmark target, written as JSON for tracking
+ * performance across builds, see sensorbenchmark-compare. The file of a
+ * target is
+ *
+ * <pre>{"target": "sensordataflow-benchmark", "results": [
+ *   {"name": "AvgAccFilter", "metric": "time", "unit": "ns/sample",
+ *    "value": 12.5, "iterations": 512000, "variance": 0, "better": "lower"}]}</pre>
+ *
+ * Name and metric identify a result between runs. Variance is that of
+ * the value over the iterations when they were measured separately,
+ * otherwise 0.
+ *
+ * Files are written into the directory named by SENSORFW_BENCHMARK_RESULTS,
+ * /tmp/sensorfw-benchmarks by default.
+ */
+class BenchmarkResults
+{
+public:
+    /**
+     * Which direction of change is an improvement.
+     */
+    enum Better
+    {
+        HigherIsBetter, /**< e.g. throughput */
+        LowerIsBetter   /**< e.g. latency, CPU time or memory */
+    };
+
+    /**
+     * Record a result.
+     *
+     * @param name benchmark name.
+     * @param metric measured quantity.
+     * @param unit unit of the value.
+     * @param value measured value.
+     * @param better direction of improvement.
+     * @param iterations how many iterations the value covers.
+     * @param variance variance of the value over the iterations.
+     */
+    static void record(const QString& name, const QString& metric, const QString& unit,
+                       double value, Better better, unsigned long iterations = 1, double variance = 0);
+
+    /**
+     * Record mean and variance of separately measured iterations.
+     *
+     * @param name benchmark name.
+     * @param metric measured quantity.
+     * @param unit unit of the values.
+     * @param values value of each iteration.
+     * @param better direction of improvement.
+     */
+    static void record(const QString& name, const QString& metric, const QString& unit,
+                       const QList<double>& values, Better better);
+
+    /**
+     * Write recorded results of the target and forget them.
+     *
+     * @param target benchmark target, names the file.
+     * @return was the file written.
+     */
+    static bool write(const QString& target);
+
+    /**
+     * Resident set size of a process.
+     *
+     * @param pid process.
+     * @return VmRSS in kB or -1 if not readable.
+     */
+    static long residentKb(int pid);
+
+    /**
+     * Process ID of the running sensord.
+     *
+     * @return process ID or 0 if sensord is not running.
+     */
+    static int sensordProcessId();
+
+private:
+    struct Result
+    {
+        QString       name;       /**< benchmark name */
+        QString       metric;     /**< measured quantity */
+        QString       unit;       /**< unit */
+        double        value;      /**< value */
+        unsigned long iterations; /**< iterations covered */
+        double        variance;   /**< variance over the iterations */
+        Better        better;     /**< direction of improvement */
+    };
+
+    static QList<Result> results_; /**< results recorded since last write */
+};
+
+#endif // BENCHMARKRESULTS_H
@@ -0,0 +1,10 @@
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD
+HEADERS += $$PWD/benchmarkresults.h
+SOURCES += $$PWD/benchmarkresults.cpp
+
+# Client session shared by the client side benchmarks
+contains(CONFIG, benchmarkclient) {
+    HEADERS += $$PWD/benchmarkclient.h
+    SOURCES += $$PWD/benchmarkclient.cpp
+}
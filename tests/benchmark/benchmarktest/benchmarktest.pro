@@ -4,6 +4,7 @@ QT += testlib \
 QT -= gui
 
 include(../../common-install.pri)
+include(../benchmarkresults.pri)
 
 CONFIG += debug
 TEMPLATE = app
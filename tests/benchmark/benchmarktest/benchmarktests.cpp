@@ -28,6 +28,7 @@
 
 #include "benchmarktests.h"
 #include "signaldump.h"
+#include "benchmarkresults.h"
 
 void BenchmarkTest::initTestCase()
 {
@@ -51,6 +52,7 @@ void BenchmarkTest::cleanup()
 
 void BenchmarkTest::cleanupTestCase()
 {
+    BenchmarkResults::write("sensorbenchmark-test");
 }
 
 void BenchmarkTest::testIdleMemCpu()
@@ -142,6 +144,21 @@ void BenchmarkTest::testThroughput()
     qDebug() << "[      Clean]:" << cleanAvg << cleanMin << cleanMax;
     qDebug() << "[      Dirty]:" << dirtyAvg << dirtyMin << dirtyMax;
 
+    // smaps sizes are in kB
+    QList<double> clean;
+    QList<double> dirty;
+    foreach (int value, signalDump.memoryClean)
+        clean << value;
+    foreach (int value, signalDump.memoryDirty)
+        dirty << value;
+    BenchmarkResults::record(sensorName, "throughput", "samples/s", sampleRate, BenchmarkResults::HigherIsBetter, signalDump.cnt);
+    BenchmarkResults::record(sensorName, "cpu", "%", cpuUsage * 100, BenchmarkResults::LowerIsBetter);
+    BenchmarkResults::record(sensorName, "private clean", "kB", clean, BenchmarkResults::LowerIsBetter);
+    BenchmarkResults::record(sensorName, "private dirty", "kB", dirty, BenchmarkResults::LowerIsBetter);
+    long rss = BenchmarkResults::residentKb(sensordPid);
+    if (rss >= 0)
+        BenchmarkResults::record(sensorName, "rss", "kB", rss, BenchmarkResults::LowerIsBetter);
+
     delete sensorIfc;
 }
 
@@ -178,6 +195,10 @@ void BenchmarkTest::testSessionLeaks()
     qDebug() << "[           ]:" << deltaClean*1.0/ITERATIONS << "bytes / session";
     qDebug() << "[      Dirty]:" << deltaDirty << "bytes in total";
     qDebug() << "[           ]:" << deltaDirty*1.0/ITERATIONS << "bytes / session";
+    BenchmarkResults::record("session leaks", "private clean", "kB/session", deltaClean * 1.0 / ITERATIONS,
+                             BenchmarkResults::LowerIsBetter, ITERATIONS);
+    BenchmarkResults::record("session leaks", "private dirty", "kB/session", deltaDirty * 1.0 / ITERATIONS,
+                             BenchmarkResults::LowerIsBetter, ITERATIONS);
 }
 
 void BenchmarkTest::testLostSessionLeaks()
@@ -215,6 +236,10 @@ void BenchmarkTest::testLostSessionLeaks()
     qDebug() << "[           ]:" << deltaClean*1.0/ITERATIONS << "bytes / session";
     qDebug() << "[      Dirty]:" << deltaDirty << "bytes in total";
     qDebug() << "[           ]:" << deltaDirty*1.0/ITERATIONS << "bytes / session";
+    BenchmarkResults::record("lost session leaks", "private clean", "kB/session", deltaClean * 1.0 / ITERATIONS,
+                             BenchmarkResults::LowerIsBetter, ITERATIONS);
+    BenchmarkResults::record("lost session leaks", "private dirty", "kB/session", deltaDirty * 1.0 / ITERATIONS,
+                             BenchmarkResults::LowerIsBetter, ITERATIONS);
 }
 
 QTEST_MAIN(BenchmarkTest)
@@ -0,0 +1,185 @@
+/**
+   @file clientbenchmarks.cpp
+   @brief Client API cost benchmarks
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+*/
+
+#include <QElapsedTimer>
+#include <QLocalSocket>
+#include <QStringList>
+#include <sys/resource.h>
+
+#include "sensormanagerinterface.h"
+#include "accelerometersensor_i.h"
+#include "alssensor_i.h"
+#include "compasssensor_i.h"
+#include "gyroscopesensor_i.h"
+#include "magnetometersensor_i.h"
+#include "orientationsensor_i.h"
+#include "proximitysensor_i.h"
+#include "rotationsensor_i.h"
+#include "tapsensor_i.h"
+#include "clientbenchmarks.h"
+#include "benchmarkresults.h"
+
+/** Length of single run */
+static const int RUN_MS = 3000;
+
+/** Buffer size of buffered sessions */
+static const unsigned BUFFER_SIZE = 32;
+
+/** Signals delivering single samples */
+static const char* const SAMPLE_SIGNALS[] = {
+    "dataAvailable(XYZ)",
+    "dataAvailable(MagneticField)",
+    "dataAvailable(Compass)",
+    "dataAvailable(Unsigned)",
+    "dataAvailable(Tap)",
+    "ALSChanged(Unsigned)",
+    "orientationChanged(Unsigned)"
+};
+
+/**
+ * Connect a signal of the sensor if the interface has it.
+ *
+ * @param sensor sensor interface.
+ * @param signal normalized signal signature.
+ * @param counter receiver.
+ * @param slot receiving slot, as given by SLOT().
+ * @return was the signal connected.
+ */
+static bool connectSignal(AbstractSensorChannelInterface* sensor, const char* signal, ClientCounter* counter, const char* slot)
+{
+    if (sensor->metaObject()->indexOfSignal(signal) < 0)
+        return false;
+    QByteArray signature = QByteArray("2") + signal;
+    return QObject::connect(sensor, signature.constData(), counter, slot);
+}
+
+/**
+ * CPU time used by the process.
+ *
+ * @return user and system time in microseconds.
+ */
+static quint64 cpuTime()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000ULL +
+           usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+void ClientBenchmark::initTestCase()
+{
+    SensorManagerInterface& sm = SensorManagerInterface::instance();
+    QVERIFY(sm.isValid());
+
+    sm.loadPlugin("accelerometersensor");
+    sm.loadPlugin("alssensor");
+    sm.loadPlugin("compasssensor");
+    sm.loadPlugin("gyroscopesensor");
+    sm.loadPlugin("magnetometersensor");
+    sm.loadPlugin("orientationsensor");
+    sm.loadPlugin("proximitysensor");
+    sm.loadPlugin("rotationsensor");
+    sm.loadPlugin("tapsensor");
+
+    sm.registerSensorInterface<AccelerometerSensorChannelInterface>("accelerometersensor");
+    sm.registerSensorInterface<ALSSensorChannelInterface>("alssensor");
+    sm.registerSensorInterface<CompassSensorChannelInterface>("compasssensor");
+    sm.registerSensorInterface<GyroscopeSensorChannelInterface>("gyroscopesensor");
+    sm.registerSensorInterface<MagnetometerSensorChannelInterface>("magnetometersensor");
+    sm.registerSensorInterface<OrientationSensorChannelInterface>("orientationsensor");
+    sm.registerSensorInterface<ProximitySensorChannelInterface>("proximitysensor");
+    sm.registerSensorInterface<RotationSensorChannelInterface>("rotationsensor");
+    sm.registerSensorInterface<TapSensorChannelInterface>("tapsensor");
+}
+
+void ClientBenchmark::cleanupTestCase()
+{
+    BenchmarkResults::write("sensorclient-benchmark");
+}
+
+void ClientBenchmark::benchmarkSensor_data()
+{
+    QTest::addColumn<QString>("sensorName");
+    QTest::addColumn<unsigned>("bufferSize");
+
+    QStringList sensors;
+    sensors << "accelerometersensor" << "alssensor" << "compasssensor" << "gyroscopesensor"
+            << "magnetometersensor" << "orientationsensor" << "proximitysensor"
+            << "rotationsensor" << "tapsensor";
+    foreach (const QString& sensor, sensors) {
+        QTest::newRow(qPrintable(sensor + " unbuffered")) << sensor << 0u;
+        QTest::newRow(qPrintable(sensor + " buffered")) << sensor << BUFFER_SIZE;
+    }
+}
+
+void ClientBenchmark::benchmarkSensor()
+{
+    QFETCH(QString, sensorName);
+    QFETCH(unsigned, bufferSize);
+
+    AbstractSensorChannelInterface* sensor = SensorManagerInterface::instance().interface(sensorName);
+    if (!sensor || !sensor->isValid()) {
+        delete sensor;
+        qDebug() << sensorName << "not available, skipped";
+        return;
+    }
+
+    ClientCounter counter;
+    for (unsigned i = 0; i < sizeof(SAMPLE_SIGNALS) / sizeof(SAMPLE_SIGNALS[0]); ++i)
+        connectSignal(sensor, SAMPLE_SIGNALS[i], &counter, SLOT(sample()));
+    // Frames are only emitted to receivers of buffered sessions
+    if (bufferSize) {
+        connectSignal(sensor, "frameAvailable(QVector<XYZ>)", &counter, SLOT(xyzFrame(QVector<XYZ>)));
+        connectSignal(sensor, "frameAvailable(QVector<MagneticField>)", &counter, SLOT(magneticFrame(QVector<MagneticField>)));
+        sensor->setBufferSize(bufferSize);
+    }
+    QLocalSocket* socket = sensor->findChild<QLocalSocket*>();
+    if (socket)
+        connect(socket, SIGNAL(readyRead()), &counter, SLOT(wakeup()));
+    sensor->setStandbyOverride(true);
+    sensor->start();
+
+    QElapsedTimer timer;
+    timer.start();
+    quint64 cpu = cpuTime();
+    QTest::qWait(RUN_MS);
+    cpu = cpuTime() - cpu;
+    double seconds = timer.elapsed() / 1000.0;
+
+    sensor->stop();
+    delete sensor;
+
+    if (!counter.samples) {
+        qDebug() << sensorName << "delivered no samples, skipped";
+        return;
+    }
+    qDebug("%lu samples in %lu frames, %.1f us cpu/sample, %.1f wakeups/s",
+           counter.samples, counter.frames, (double)cpu / counter.samples, counter.wakeups / seconds);
+    QString name(QTest::currentDataTag());
+    BenchmarkResults::record(name, "cpu", "us/sample", (double)cpu / counter.samples,
+                             BenchmarkResults::LowerIsBetter, counter.samples);
+    BenchmarkResults::record(name, "wakeups", "wakeups/s", counter.wakeups / seconds,
+                             BenchmarkResults::LowerIsBetter);
+    BenchmarkResults::record(name, "throughput", "samples/s", counter.samples / seconds,
+                             BenchmarkResults::HigherIsBetter);
+}
+
+QTEST_MAIN(ClientBenchmark)
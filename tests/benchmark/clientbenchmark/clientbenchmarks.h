@@ -0,0 +1,76 @@
+/**
+   @file clientbenchmarks.h
+   @brief Client API cost benchmarks
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+*/
+
+#ifndef CLIENTBENCHMARKS_H
+#define CLIENTBENCHMARKS_H
+
+#include <QTest>
+#include <QVector>
+#include "datatypes/xyz.h"
+#include "datatypes/magneticfield.h"
+
+/**
+ * Counts samples, frames and socket wakeups of one session.
+ */
+class ClientCounter : public QObject
+{
+    Q_OBJECT
+
+public:
+    ClientCounter() : samples(0), frames(0), wakeups(0) {}
+
+    unsigned long samples; /**< delivered samples, in frames or one by one */
+    unsigned long frames;  /**< delivered frames */
+    unsigned long wakeups; /**< socket readyRead notifications */
+
+public slots:
+    void sample() { ++samples; }
+    void xyzFrame(const QVector<XYZ>& frame) { ++frames; samples += frame.size(); }
+    void magneticFrame(const QVector<MagneticField>& frame) { ++frames; samples += frame.size(); }
+    void wakeup() { ++wakeups; }
+};
+
+/**
+ * Client side cost of receiving sensor data through the Qt API from a
+ * running sensord: socket reads, sample conversion and signal emission.
+ * Each sensor interface is run with an unbuffered and a buffered session
+ * and CPU time of the client process per delivered sample and socket
+ * wakeups per second are reported:
+ *
+ * <pre>QDEBUG : ClientBenchmark::benchmarkSensor(accelerometersensor buffered) 3000 samples in 94 frames, 2.1 us cpu/sample, 31.3 wakeups/s</pre>
+ *
+ * Sensors which deliver nothing during the run, e.g. tap or proximity
+ * without stimulus, are skipped. Results are also written as JSON, see
+ * BenchmarkResults.
+ */
+class ClientBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void benchmarkSensor_data();
+    void benchmarkSensor();
+};
+
+#endif // CLIENTBENCHMARKS_H
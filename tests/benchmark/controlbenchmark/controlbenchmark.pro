@@ -0,0 +1,28 @@
+QT += testlib dbus network
+QT -= gui
+
+include(../../common-install.pri)
+CONFIG += benchmarkclient
+include(../benchmarkresults.pri)
+
+TEMPLATE = app
+TARGET = sensorcontrol-benchmark
+
+HEADERS += controlbenchmarks.h
+SOURCES += controlbenchmarks.cpp
+
+SENSORFW_INCLUDEPATHS = ../../.. \
+                        ../../../include \
+                        ../../../qt-api
+
+DEPENDPATH += $$SENSORFW_INCLUDEPATHS
+INCLUDEPATH += $$SENSORFW_INCLUDEPATHS
+
+QMAKE_LIBDIR_FLAGS += -L../../../qt-api \
+                      -L../../../datatypes
+equals(QT_MAJOR_VERSION, 4):{
+    QMAKE_LIBDIR_FLAGS += -lsensordatatypes -lsensorclient
+}
+equals(QT_MAJOR_VERSION, 5):{
+    QMAKE_LIBDIR_FLAGS += -lsensordatatypes-qt5 -lsensorclient-qt5
+}
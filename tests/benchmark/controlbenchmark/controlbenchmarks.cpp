@@ -0,0 +1,243 @@
+/**
+   @file controlbenchmarks.cpp
+   @brief Control-plane latency of sensor sessions
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+*/
+
+
+#include <QCoreApplication>
+#include <QProcess>
+#include <QStringList>
+#include <stdio.h>
+#include <time.h>
+#include "sensormanagerinterface.h"
+#include "accelerometersensor_i.h"
+#include "controlbenchmarks.h"
+#include "benchmarkclient.h"
+#include "benchmarkresults.h"
+
+/** Sensor sessions are opened to */
+static const char* const SENSOR = "accelerometersensor";
+
+/** Session cycles of the sequential run */
+static const int SEQUENTIAL_CYCLES = 200;
+
+/** Session cycles of each concurrent client */
+static const int CONCURRENT_CYCLES = 100;
+
+/** Milliseconds a client process may take to get ready or finish */
+static const int CLIENT_TIMEOUT = 60000;
+
+/** Intervals configured in turn, milliseconds */
+static const int INTERVALS[] = { 10, 20, 50, 100 };
+
+static quint64 nowUs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+const char* ControlLatencies::name(int operation)
+{
+    static const char* const NAMES[OperationCount] = {
+        "open", "metadata", "configure", "start", "stop", "close"
+    };
+    return operation >= 0 && operation < OperationCount ? NAMES[operation] : "unknown";
+}
+
+bool ControlLatencies::run(const QString& sensorId, int cycles)
+{
+    for (int cycle = 0; cycle < cycles; ++cycle) {
+        quint64 start = nowUs();
+        AccelerometerSensorChannelInterface* sensor = AccelerometerSensorChannelInterface::interface(sensorId);
+        if (sensor == NULL || !sensor->isValid()) {
+            qWarning() << "Unable to get session:" << SensorManagerInterface::instance().errorString();
+            delete sensor;
+            return false;
+        }
+        quint64 opened = nowUs();
+        latencies_[Open].append(opened - start);
+
+        sensor->getAvailableIntervals();
+        sensor->getAvailableDataRanges();
+        sensor->getAvailableBufferSizes();
+        quint64 queried = nowUs();
+        latencies_[Metadata].append(queried - opened);
+
+        sensor->setInterval(INTERVALS[cycle % (sizeof(INTERVALS) / sizeof(INTERVALS[0]))]);
+        sensor->setBufferSize(1);
+        sensor->setStandbyOverride(true);
+        quint64 configured = nowUs();
+        latencies_[Configure].append(configured - queried);
+
+        bool ok = sensor->start().isValid();
+        quint64 started = nowUs();
+        latencies_[Start].append(started - configured);
+
+        ok = sensor->stop().isValid() && ok;
+        quint64 stopped = nowUs();
+        latencies_[Stop].append(stopped - started);
+
+        delete sensor;
+        latencies_[Close].append(nowUs() - stopped);
+        if (!ok) {
+            qWarning() << "Session of" << sensorId << "did not start or stop";
+            return false;
+        }
+    }
+    return true;
+}
+
+QByteArray ControlLatencies::serialize() const
+{
+    QByteArray data;
+    for (int operation = 0; operation < OperationCount; ++operation) {
+        data += name(operation);
+        foreach (quint32 latency, latencies_[operation])
+            data += ' ' + QByteArray::number(latency);
+        data += '\n';
+    }
+    return data;
+}
+
+void ControlLatencies::merge(const QByteArray& data)
+{
+    foreach (const QByteArray& line, data.split('\n')) {
+        QList<QByteArray> words(line.split(' '));
+        for (int operation = 0; operation < OperationCount; ++operation) {
+            if (words.first() != name(operation))
+                continue;
+            for (int i = 1; i < words.size(); ++i)
+                latencies_[operation].append(words.at(i).toUInt());
+        }
+    }
+}
+
+void ControlLatencies::report(const QString& name, double seconds)
+{
+    for (int operation = 0; operation < OperationCount; ++operation) {
+        QVector<quint32>& latencies(latencies_[operation]);
+        if (latencies.isEmpty())
+            continue;
+        qSort(latencies);
+        quint32 p50 = latencies.at(latencies.size() / 2);
+        quint32 p99 = latencies.at(latencies.size() * 99 / 100);
+        double rate = seconds > 0 ? latencies.size() / seconds : 0;
+        qDebug("%s: p50 %u us, p99 %u us, %.0f calls/s", ControlLatencies::name(operation), p50, p99, rate);
+
+        QString metric(ControlLatencies::name(operation));
+        BenchmarkResults::record(name, metric + " latency p50", "us", p50, BenchmarkResults::LowerIsBetter, latencies.size());
+        BenchmarkResults::record(name, metric + " latency p99", "us", p99, BenchmarkResults::LowerIsBetter, latencies.size());
+        BenchmarkResults::record(name, metric + " throughput", "calls/s", rate, BenchmarkResults::HigherIsBetter, latencies.size());
+    }
+}
+
+void ControlBenchmark::initTestCase()
+{
+    qDBusRegisterMetaType<IntegerRange>();
+    qDBusRegisterMetaType<IntegerRangeList>();
+    qDBusRegisterMetaType<DataRange>();
+    qDBusRegisterMetaType<DataRangeList>();
+
+    QVERIFY(SensorManagerInterface::instance().isValid());
+    BenchmarkClient::registerSensor(SENSOR);
+}
+
+void ControlBenchmark::cleanupTestCase()
+{
+    BenchmarkResults::write("sensorcontrol-benchmark");
+}
+
+void ControlBenchmark::benchmarkSequential()
+{
+    ControlLatencies latencies;
+    // Warm-up loads the sensor plugin and its chains
+    QVERIFY(latencies.run(SENSOR, 1));
+
+    latencies = ControlLatencies();
+    quint64 start = nowUs();
+    QVERIFY(latencies.run(SENSOR, SEQUENTIAL_CYCLES));
+    latencies.report("sequential", (nowUs() - start) / 1e6);
+}
+
+void ControlBenchmark::benchmarkConcurrent_data()
+{
+    QTest::addColumn<int>("clients");
+    QTest::newRow("2 clients") << 2;
+    QTest::newRow("4 clients") << 4;
+    QTest::newRow("8 clients") << 8;
+}
+
+void ControlBenchmark::benchmarkConcurrent()
+{
+    QFETCH(int, clients);
+
+    QList<QProcess*> processes;
+    QStringList args;
+    args << "-w" << SENSOR << QString::number(CONCURRENT_CYCLES);
+    for (int i = 0; i < clients; ++i) {
+        QProcess* process = new QProcess(this);
+        process->setProcessChannelMode(QProcess::ForwardedErrorChannel);
+        process->start(QCoreApplication::applicationFilePath(), args);
+        processes.append(process);
+    }
+
+    // Clients connect to D-Bus first and run their cycles together
+    bool ready = true;
+    foreach (QProcess* process, processes)
+        ready = process->waitForReadyRead(CLIENT_TIMEOUT) && process->readLine().startsWith("ready") && ready;
+    quint64 start = nowUs();
+    foreach (QProcess* process, processes)
+        process->write("go\n");
+
+    ControlLatencies latencies;
+    bool finished = ready;
+    foreach (QProcess* process, processes) {
+        finished = process->waitForFinished(CLIENT_TIMEOUT) && process->exitCode() == 0 && finished;
+        latencies.merge(process->readAllStandardOutput());
+    }
+    double seconds = (nowUs() - start) / 1e6;
+    qDeleteAll(processes);
+
+    QVERIFY2(finished, "Client process failed");
+    latencies.report(QString("%1 clients").arg(clients), seconds);
+}
+
+int main(int argc, char** argv)
+{
+    QCoreApplication app(argc, argv);
+    QStringList args = app.arguments();
+
+    // Concurrent client started by benchmarkConcurrent: -w <sensor> <cycles>
+    if (args.size() == 4 && args.at(1) == "-w") {
+        BenchmarkClient::registerSensor(args.at(2));
+        printf("ready\n");
+        fflush(stdout);
+        char line[16];
+        if (!fgets(line, sizeof(line), stdin))
+            return 1;
+        ControlLatencies latencies;
+        bool ok = latencies.run(args.at(2), args.at(3).toInt());
+        fputs(latencies.serialize().constData(), stdout);
+        return ok ? 0 : 1;
+    }
+
+    ControlBenchmark benchmark;
+    return QTest::qExec(&benchmark, argc, argv);
+}
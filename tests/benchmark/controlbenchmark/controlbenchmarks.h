@@ -0,0 +1,114 @@
+/**
+   @file controlbenchmarks.h
+   @brief Control-plane latency of sensor sessions
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+*/
+
+
+#ifndef CONTROLBENCHMARKS_H
+#define CONTROLBENCHMARKS_H
+
+#include <QTest>
+#include <QVector>
+
+/**
+ * Latencies of the control-plane operations of a session, see
+ * ControlBenchmark.
+ */
+class ControlLatencies
+{
+public:
+    /**
+     * Measured operations of one session cycle.
+     */
+    enum Operation
+    {
+        Open = 0,  /**< session opened */
+        Metadata,  /**< available intervals, data ranges and buffer sizes read */
+        Configure, /**< interval, buffer size and standby override set */
+        Start,     /**< session started */
+        Stop,      /**< session stopped */
+        Close,     /**< session closed */
+        OperationCount
+    };
+
+    /**
+     * Run session cycles and record their latencies.
+     *
+     * @param sensorId sensor to open sessions to.
+     * @param cycles session cycles.
+     * @return false if a session could not be opened or started.
+     */
+    bool run(const QString& sensorId, int cycles);
+
+    /**
+     * Write latencies as lines of "<operation> <us> ...".
+     *
+     * @return serialized latencies.
+     */
+    QByteArray serialize() const;
+
+    /**
+     * Add latencies written by #serialize().
+     *
+     * @param data serialized latencies.
+     */
+    void merge(const QByteArray& data);
+
+    /**
+     * Print and record percentiles of every operation.
+     *
+     * @param name benchmark name.
+     * @param seconds wall time of the cycles, for throughput.
+     */
+    void report(const QString& name, double seconds);
+
+    /**
+     * Name of an operation.
+     */
+    static const char* name(int operation);
+
+private:
+    QVector<quint32> latencies_[OperationCount]; /**< latencies in microseconds */
+};
+
+/**
+ * Latency and throughput of session control through the D-Bus interface
+ * of a running sensord: opening a session, reading the metadata that
+ * sensormetadata-test checks, configuring, starting, stopping and
+ * closing it. Cycles are run by a single client, and by concurrent
+ * client processes which start together:
+ *
+ * <pre>QDEBUG : ControlBenchmark::benchmarkConcurrent(4 clients) start: p50 412 us, p99 1630 us, 2417 calls/s</pre>
+ *
+ * Results are also written as JSON, see BenchmarkResults.
+ */
+class ControlBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void benchmarkSequential();
+    void benchmarkConcurrent_data();
+    void benchmarkConcurrent();
+};
+
+#endif // CONTROLBENCHMARKS_H
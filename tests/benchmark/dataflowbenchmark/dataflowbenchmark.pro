@@ -0,0 +1,56 @@
+QT += testlib dbus network
+QT -= gui
+
+include(../../common-install.pri)
+include(../benchmarkresults.pri)
+
+TEMPLATE = app
+TARGET = sensordataflow-benchmark
+
+CONFIG += link_pkgconfig
+
+PKGCONFIG += mlite5
+
+HEADERS += dataflowbenchmarks.h \
+    ../../../filters/avgaccfilter/avgaccfilter.h \
+    ../../../filters/coordinatealignfilter/coordinatealignfilter.h \
+    ../../../filters/coordinatealignfilter/xyztransform.h \
+    ../../../filters/declinationfilter/declinationfilter.h \
+    ../../../filters/downsamplefilter/downsamplefilter.h \
+    ../../../filters/orientationinterpreter/orientationinterpreter.h \
+    ../../../filters/rotationfilter/rotationfilter.h \
+    ../../../chains/compasschain/compassfilter.h \
+    ../../../chains/compasschain/orientationfilter.h \
+    ../../../chains/magcalibrationchain/calibrationfilter.h \
+    ../../../chains/magcalibrationchain/ellipsoidcalibrator.h
+
+SOURCES += dataflowbenchmarks.cpp \
+    ../../../filters/avgaccfilter/avgaccfilter.cpp \
+    ../../../filters/coordinatealignfilter/coordinatealignfilter.cpp \
+    ../../../filters/coordinatealignfilter/xyztransform.cpp \
+    ../../../filters/declinationfilter/declinationfilter.cpp \
+    ../../../filters/downsamplefilter/downsamplefilter.cpp \
+    ../../../filters/orientationinterpreter/orientationinterpreter.cpp \
+    ../../../filters/rotationfilter/rotationfilter.cpp \
+    ../../../chains/compasschain/compassfilter.cpp \
+    ../../../chains/compasschain/orientationfilter.cpp \
+    ../../../chains/magcalibrationchain/calibrationfilter.cpp \
+    ../../../chains/magcalibrationchain/ellipsoidcalibrator.cpp
+
+INCLUDEPATH += ../../../include \
+    ../../.. \
+    ../../../filters/avgaccfilter \
+    ../../../filters/coordinatealignfilter \
+    ../../../filters/declinationfilter \
+    ../../../filters/downsamplefilter \
+    ../../../filters/orientationinterpreter \
+    ../../../filters/rotationfilter \
+    ../../../chains/compasschain \
+    ../../../chains/magcalibrationchain \
+    ../../../core \
+    ../../../datatypes
+
+QMAKE_LIBDIR_FLAGS += -L../../../builddir/datatypes -L../../../datatypes
+QMAKE_LIBDIR_FLAGS += -L../../../builddir/core -L../../../core
+
+include(../../../common.pri)
@@ -0,0 +1,429 @@
+/**
+   @file dataflowbenchmarks.cpp
+   @brief Microbenchmarks for the data flow core and filters
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+*/
+
+#include <QList>
+#include <QVector>
+#include <math.h>
+#include <time.h>
+
+#include "config.h"
+#include "alloccounter.h"
+#include "ringbuffer.h"
+#include "bufferreader.h"
+#include "dataemitter.h"
+#include "source.h"
+#include "sink.h"
+#include "filter.h"
+#include "orientationdata.h"
+#include "posedata.h"
+#include "tapdata.h"
+#include "touchdata.h"
+#include "timedunsigned.h"
+#include "avgaccfilter.h"
+#include "coordinatealignfilter.h"
+#include "declinationfilter.h"
+#include "downsamplefilter.h"
+#include "orientationinterpreter.h"
+#include "rotationfilter.h"
+#include "compassfilter.h"
+#include "orientationfilter.h"
+#include "calibrationfilter.h"
+#include "dataflowbenchmarks.h"
+#include "benchmarkresults.h"
+
+/** Rounds each benchmark pushes its input through */
+static const int ROUNDS = 2000;
+
+/** Synthetic input length */
+static const unsigned SAMPLES = 256;
+
+/** Samples propagated at a time, matching filter batches */
+static const unsigned BATCH = FILTER_BATCH_SIZE;
+
+/**
+ * Measures wall time and heap allocations from construction until
+ * #report() and prints and records them per processed sample. In allocation
+ * tracking builds (see AllocCounter) the measured path must not
+ * allocate at all.
+ */
+class SampleMeter
+{
+public:
+    SampleMeter(const QString& name) :
+        name_(name),
+        allocations_(AllocCounter::threadCount()),
+        start_(now())
+    {
+    }
+
+    void report(unsigned long samples) const
+    {
+        quint64 elapsed = now() - start_;
+        unsigned long allocations = AllocCounter::threadCount() - allocations_;
+        BenchmarkResults::record(name_, "time", "ns/sample", samples ? (double)elapsed / samples : 0.0,
+                                 BenchmarkResults::LowerIsBetter, samples);
+        if (!AllocCounter::isEnabled()) {
+            qDebug("%s: %.1f ns/sample", name_.toLocal8Bit().constData(),
+                   samples ? (double)elapsed / samples : 0.0);
+            return;
+        }
+        qDebug("%s: %.1f ns/sample, %.3f allocations/sample",
+               name_.toLocal8Bit().constData(),
+               samples ? (double)elapsed / samples : 0.0,
+               samples ? (double)allocations / samples : 0.0);
+        BenchmarkResults::record(name_, "allocations", "allocations/sample", samples ? (double)allocations / samples : 0.0,
+                                 BenchmarkResults::LowerIsBetter, samples);
+        QVERIFY2(allocations == 0, qPrintable(name_ + " allocates on the steady-state sample path"));
+    }
+
+private:
+    static quint64 now()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    }
+
+    QString       name_;        /**< benchmark name */
+    unsigned long allocations_; /**< allocation count at start */
+    quint64       start_;       /**< start time in nanoseconds */
+};
+
+/**
+ * Sink counting received samples.
+ */
+template <class TYPE>
+class SampleCounter
+{
+public:
+    SampleCounter() :
+        count(0),
+        sink(this, &SampleCounter::collect)
+    {}
+
+    void collect(unsigned n, const TYPE* values)
+    {
+        Q_UNUSED(values);
+        count += n;
+    }
+
+    unsigned long count;
+    Sink<SampleCounter, TYPE> sink;
+};
+
+/**
+ * Ring buffer reader draining the buffer in chunks whenever woken up.
+ */
+template <class TYPE>
+class DrainingReader : public RingBufferReader<TYPE>
+{
+public:
+    DrainingReader() : count(0) {}
+
+    void pushNewData()
+    {
+        TYPE values[BATCH];
+        unsigned n;
+        while ((n = RingBufferReader<TYPE>::read(BATCH, values)) > 0)
+            count += n;
+    }
+
+    unsigned long count;
+};
+
+/**
+ * DataEmitter counting emitted samples.
+ */
+class CountingEmitter : public DataEmitter<TimedXyzData>
+{
+public:
+    CountingEmitter(unsigned chunkSize) :
+        DataEmitter<TimedXyzData>(chunkSize),
+        count(0),
+        sum(0)
+    {}
+
+    unsigned long count;
+    long sum;
+
+protected:
+    void emitData(const TimedXyzData& value)
+    {
+        ++count;
+        sum += value.x_;
+    }
+};
+
+/**
+ * Push input through the source in filter sized batches, after one
+ * warm-up round which is not measured.
+ */
+template <class TYPE>
+static void propagateRounds(Source<TYPE>& source, const QVector<TYPE>& input, int rounds = ROUNDS)
+{
+    for (int round = 0; round < rounds; ++round) {
+        for (int i = 0; i < input.size(); i += BATCH)
+            source.propagate(qMin((unsigned)(input.size() - i), BATCH), input.constData() + i);
+    }
+}
+
+/**
+ * Synthetic samples sampled at 100 Hz.
+ */
+static QVector<TimedXyzData> xyzInput(int amplitude)
+{
+    QVector<TimedXyzData> input(SAMPLES);
+    for (unsigned i = 0; i < SAMPLES; ++i) {
+        double phase = i * 2 * M_PI / SAMPLES;
+        input[i] = TimedXyzData(i * 10000,
+                                (int)(amplitude * sin(phase)),
+                                (int)(amplitude * cos(phase)),
+                                (int)(amplitude * sin(2 * phase)));
+    }
+    return input;
+}
+
+static QVector<CompassData> compassInput()
+{
+    QVector<CompassData> input(SAMPLES);
+    for (unsigned i = 0; i < SAMPLES; ++i)
+        input[i] = CompassData(i * 10000, (i * 360 / SAMPLES) % 360, 3);
+    return input;
+}
+
+static QVector<CalibratedMagneticFieldData> magneticInput()
+{
+    QVector<TimedXyzData> xyz = xyzInput(50000);
+    QVector<CalibratedMagneticFieldData> input(SAMPLES);
+    for (unsigned i = 0; i < SAMPLES; ++i)
+        input[i] = CalibratedMagneticFieldData(xyz[i].timestamp_, xyz[i].x_, xyz[i].y_, xyz[i].z_,
+                                               xyz[i].x_, xyz[i].y_, xyz[i].z_, 3);
+    return input;
+}
+
+/**
+ * Write samples into ring buffer read by single reader.
+ */
+template <class TYPE>
+static void benchmarkRingBufferType(const QString& name)
+{
+    RingBuffer<TYPE> buffer(2 * BATCH);
+    DrainingReader<TYPE> reader;
+    QVERIFY(buffer.join(&reader));
+    Source<TYPE> source;
+    QVERIFY(source.join(buffer.sink("sink")));
+
+    QVector<TYPE> input(SAMPLES);
+    propagateRounds(source, input, 1);
+    SampleMeter meter("RingBuffer<" + name + ">");
+    propagateRounds(source, input);
+    meter.report(ROUNDS * SAMPLES);
+
+    QCOMPARE(reader.count, (unsigned long)(ROUNDS + 1) * SAMPLES);
+    QCOMPARE(buffer.overwritten(), 0u);
+    buffer.unjoin(&reader);
+}
+
+/**
+ * Push input into single input filter and count its output.
+ */
+template <class INPUT, class OUTPUT>
+static void benchmarkFilter(const QString& name, FilterBase* filter,
+                            const char* sinkName, const char* sourceName,
+                            const QVector<INPUT>& input)
+{
+    Source<INPUT> source;
+    SampleCounter<OUTPUT> output;
+    QVERIFY(source.join(filter->sink(sinkName)));
+    QVERIFY(filter->source(sourceName)->join(&output.sink));
+
+    propagateRounds(source, input, 1);
+    SampleMeter meter(name);
+    propagateRounds(source, input);
+    meter.report(ROUNDS * input.size());
+
+    QVERIFY(output.count > 0);
+    delete filter;
+}
+
+void DataFlowBenchmark::initTestCase()
+{
+    Config::loadConfig(CONFIG_FILE_PATH, CONFIG_DIR_PATH);
+}
+
+void DataFlowBenchmark::cleanupTestCase()
+{
+    BenchmarkResults::write("sensordataflow-benchmark");
+}
+
+void DataFlowBenchmark::benchmarkRingBuffer()
+{
+    benchmarkRingBufferType<TimedXyzData>("TimedXyzData");
+    benchmarkRingBufferType<TimedUnsigned>("TimedUnsigned");
+    benchmarkRingBufferType<CalibratedMagneticFieldData>("CalibratedMagneticFieldData");
+    benchmarkRingBufferType<CompassData>("CompassData");
+    benchmarkRingBufferType<ProximityData>("ProximityData");
+    benchmarkRingBufferType<PoseData>("PoseData");
+    benchmarkRingBufferType<TapData>("TapData");
+    benchmarkRingBufferType<TouchData>("TouchData");
+}
+
+void DataFlowBenchmark::benchmarkPropagate_data()
+{
+    QTest::addColumn<int>("sinkCount");
+    QTest::newRow("1 sink") << 1;
+    QTest::newRow("2 sinks") << 2;
+    QTest::newRow("4 sinks") << 4;
+    QTest::newRow("16 sinks") << 16;
+}
+
+void DataFlowBenchmark::benchmarkPropagate()
+{
+    QFETCH(int, sinkCount);
+
+    Source<TimedXyzData> source;
+    QList<SampleCounter<TimedXyzData>*> sinks;
+    for (int i = 0; i < sinkCount; ++i) {
+        sinks.append(new SampleCounter<TimedXyzData>);
+        QVERIFY(source.join(&sinks.last()->sink));
+    }
+
+    QVector<TimedXyzData> input = xyzInput(1000);
+    propagateRounds(source, input, 1);
+    SampleMeter meter(QString("Source::propagate to %1 sink(s)").arg(sinkCount));
+    propagateRounds(source, input);
+    meter.report(ROUNDS * SAMPLES);
+
+    QCOMPARE(sinks.last()->count, (unsigned long)(ROUNDS + 1) * SAMPLES);
+    qDeleteAll(sinks);
+}
+
+void DataFlowBenchmark::benchmarkBufferReader_data()
+{
+    QTest::addColumn<int>("chunkSize");
+    QTest::newRow("chunk 1") << 1;
+    QTest::newRow("chunk 8") << 8;
+    QTest::newRow("chunk 32") << 32;
+}
+
+void DataFlowBenchmark::benchmarkBufferReader()
+{
+    QFETCH(int, chunkSize);
+
+    RingBuffer<TimedXyzData> buffer(2 * BATCH);
+    BufferReader<TimedXyzData> reader(chunkSize);
+    SampleCounter<TimedXyzData> output;
+    QVERIFY(buffer.join(&reader));
+    QVERIFY(reader.source("source")->join(&output.sink));
+    Source<TimedXyzData> source;
+    QVERIFY(source.join(buffer.sink("sink")));
+
+    QVector<TimedXyzData> input = xyzInput(1000);
+    propagateRounds(source, input, 1);
+    SampleMeter meter(QString("BufferReader chunk %1").arg(chunkSize));
+    propagateRounds(source, input);
+    meter.report(ROUNDS * SAMPLES);
+
+    QCOMPARE(output.count, (unsigned long)(ROUNDS + 1) * SAMPLES);
+    buffer.unjoin(&reader);
+}
+
+void DataFlowBenchmark::benchmarkDataEmitter_data()
+{
+    benchmarkBufferReader_data();
+}
+
+void DataFlowBenchmark::benchmarkDataEmitter()
+{
+    QFETCH(int, chunkSize);
+
+    RingBuffer<TimedXyzData> buffer(2 * BATCH);
+    CountingEmitter emitter(chunkSize);
+    QVERIFY(buffer.join(&emitter));
+    Source<TimedXyzData> source;
+    QVERIFY(source.join(buffer.sink("sink")));
+
+    QVector<TimedXyzData> input = xyzInput(1000);
+    propagateRounds(source, input, 1);
+    SampleMeter meter(QString("DataEmitter chunk %1").arg(chunkSize));
+    propagateRounds(source, input);
+    meter.report(ROUNDS * SAMPLES);
+
+    QCOMPARE(emitter.count, (unsigned long)(ROUNDS + 1) * SAMPLES);
+    buffer.unjoin(&emitter);
+}
+
+void DataFlowBenchmark::benchmarkFilters()
+{
+    QVector<TimedXyzData> acceleration = xyzInput(1000);
+
+    benchmarkFilter<TimedXyzData, TimedXyzData>("AvgAccFilter", AvgAccFilter::factoryMethod(),
+                                                "sink", "source", acceleration);
+
+    benchmarkFilter<TimedXyzData, TimedXyzData>("CoordinateAlignFilter identity", CoordinateAlignFilter::factoryMethod(),
+                                                "sink", "source", acceleration);
+
+    double general[3][3] = {{0.5, 0.5, 0}, {-0.5, 0.5, 0}, {0, 0, 1}};
+    FilterBase* align = CoordinateAlignFilter::factoryMethod();
+    ((CoordinateAlignFilter*)align)->setMatrix(TMatrix(general));
+    benchmarkFilter<TimedXyzData, TimedXyzData>("CoordinateAlignFilter general", align,
+                                                "sink", "source", acceleration);
+
+    benchmarkFilter<CompassData, CompassData>("DeclinationFilter", DeclinationFilter::factoryMethod(),
+                                              "sink", "source", compassInput());
+
+    FilterBase* downsample = DownsampleFilter::factoryMethod();
+    ((DownsampleFilter*)downsample)->setBufferSize(4);
+    benchmarkFilter<TimedXyzData, TimedXyzData>("DownsampleFilter", downsample,
+                                                "sink", "source", acceleration);
+
+    benchmarkFilter<AccelerationData, PoseData>("OrientationInterpreter", OrientationInterpreter::factoryMethod(),
+                                                "accsink", "orientation", acceleration);
+
+    // Rotation needs a compass heading before it produces output
+    FilterBase* rotation = RotationFilter::factoryMethod();
+    Source<CompassData> heading;
+    QVERIFY(heading.join(rotation->sink("compasssink")));
+    CompassData north(0, 0, 3);
+    heading.propagate(1, &north);
+    benchmarkFilter<TimedXyzData, TimedXyzData>("RotationFilter", rotation,
+                                                "accelerometersink", "source", acceleration);
+}
+
+void DataFlowBenchmark::benchmarkChainFilters()
+{
+    benchmarkFilter<TimedXyzData, CalibratedMagneticFieldData>("CalibrationFilter", CalibrationFilter::factoryMethod(),
+                                                               "magsink", "calibratedmagneticfield", xyzInput(50000));
+
+    // Compass needs gravity before it produces output
+    FilterBase* compass = CompassFilter::factoryMethod();
+    Source<AccelerationData> gravity;
+    QVERIFY(gravity.join(compass->sink("accsink")));
+    TimedXyzData down(0, 0, 0, -1000);
+    gravity.propagate(1, &down);
+    benchmarkFilter<CalibratedMagneticFieldData, CompassData>("CompassFilter", compass,
+                                                              "magsink", "magnorthangle", magneticInput());
+
+    benchmarkFilter<CompassData, CompassData>("OrientationFilter", OrientationFilter::factoryMethod(),
+                                              "orientsink", "magnorthangle", compassInput());
+}
+
+QTEST_MAIN(DataFlowBenchmark)
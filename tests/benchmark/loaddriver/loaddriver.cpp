@@ -0,0 +1,282 @@
+/**
+   @file loaddriver.cpp
+   @brief Multi-client load driver for scaling benchmarks
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+*/
+
+#include <QCoreApplication>
+#include <QProcess>
+#include <QStringList>
+#include <QTimer>
+#include <unistd.h>
+#include "sensormanagerinterface.h"
+#include "accelerometersensor_i.h"
+#include "magnetometersensor_i.h"
+#include "datatypes/utils.h"
+#include "loaddriver.h"
+#include "benchmarkresults.h"
+
+LoadClient::LoadClient(const QString& sensorId, int interval, unsigned bufferSize, QObject* parent) :
+    QObject(parent),
+    sensor_(NULL),
+    trace_(NULL),
+    samples_(0)
+{
+    SensorManagerInterface& sm = SensorManagerInterface::instance();
+
+    if (sensorId == "magnetometersensor") {
+        MagnetometerSensorChannelInterface* sensor = MagnetometerSensorChannelInterface::interface(sensorId);
+        if (sensor)
+            connect(sensor, SIGNAL(dataAvailable(const MagneticField&)), this, SLOT(magnetometerData(const MagneticField&)));
+        sensor_ = sensor;
+    } else {
+        AccelerometerSensorChannelInterface* sensor = AccelerometerSensorChannelInterface::interface(sensorId);
+        if (sensor)
+            connect(sensor, SIGNAL(dataAvailable(const XYZ&)), this, SLOT(accelerometerData(const XYZ&)));
+        sensor_ = sensor;
+    }
+
+    if (sensor_ == NULL || !sensor_->isValid()) {
+        qDebug() << "[LoadClient] Unable to get session:" << sm.errorString();
+        delete sensor_;
+        sensor_ = NULL;
+        return;
+    }
+
+    if (interval > 0)
+        sensor_->setInterval(interval);
+    if (bufferSize > 0)
+        sensor_->setBufferSize(bufferSize);
+    sensor_->setStandbyOverride(true);
+}
+
+LoadClient::~LoadClient()
+{
+    delete sensor_;
+}
+
+void LoadClient::start()
+{
+    if (sensor_)
+        sensor_->start();
+}
+
+void LoadClient::stop()
+{
+    if (sensor_)
+        sensor_->stop();
+}
+
+void LoadClient::accelerometerData(const XYZ& data)
+{
+    record(data.XYZData().timestamp_, data.x(), data.y(), data.z());
+}
+
+void LoadClient::magnetometerData(const MagneticField& data)
+{
+    record(data.timestamp(), data.rx(), data.ry(), data.rz());
+}
+
+void LoadClient::record(quint64 timestamp, int x, int y, int z)
+{
+    quint64 now = Utils::getTimeStamp();
+    if (trace_)
+        trace_->append(timestamp, x, y, z);
+    ++samples_;
+    latencies_.append(now > timestamp ? (quint32)qMin(now - timestamp, (quint64)0xffffffffu) : 0);
+}
+
+LoadDriver::LoadDriver(const QString& sensorId, int clients, int interval, unsigned bufferSize, QObject* parent) :
+    QObject(parent),
+    sensorId_(sensorId),
+    sensordPid_(0)
+{
+    SensorManagerInterface& sm = SensorManagerInterface::instance();
+    sm.loadPlugin(sensorId);
+    if (sensorId == "magnetometersensor")
+        sm.registerSensorInterface<MagnetometerSensorChannelInterface>(sensorId);
+    else
+        sm.registerSensorInterface<AccelerometerSensorChannelInterface>(sensorId);
+
+    for (int i = 0; i < clients; ++i) {
+        LoadClient* client = new LoadClient(sensorId, interval, bufferSize);
+        if (!client->isValid()) {
+            delete client;
+            break;
+        }
+        clients_.append(client);
+    }
+}
+
+LoadDriver::~LoadDriver()
+{
+    qDeleteAll(clients_);
+}
+
+bool LoadDriver::start(int sensordPid)
+{
+    if (clients_.isEmpty())
+        return false;
+
+    sensordPid_ = sensordPid;
+    if (sensordPid_)
+        sensordCpu_.getCpuUsage(sensordPid_);
+    driverCpu_.getCpuUsage(getpid());
+    started_.start();
+
+    foreach (LoadClient* client, clients_)
+        client->start();
+    return true;
+}
+
+bool LoadDriver::recordTrace(const QString& path)
+{
+    if (clients_.isEmpty() || !trace_.open(path))
+        return false;
+    clients_.first()->setTrace(&trace_);
+    return true;
+}
+
+void LoadDriver::stop()
+{
+    foreach (LoadClient* client, clients_)
+        client->stop();
+    if (!clients_.isEmpty())
+        clients_.first()->setTrace(NULL);
+    trace_.close();
+
+    double seconds = started_.elapsed() / 1000.0;
+    double sensordCpu = sensordPid_ ? sensordCpu_.getCpuUsage(sensordPid_) : 0;
+    double driverCpu = driverCpu_.getCpuUsage(getpid());
+
+    unsigned long total = 0;
+    unsigned long slowest = 0;
+    unsigned long fastest = 0;
+    QVector<quint32> latencies;
+    foreach (LoadClient* client, clients_) {
+        if (client == clients_.first() || client->samples() < slowest)
+            slowest = client->samples();
+        if (client->samples() > fastest)
+            fastest = client->samples();
+        total += client->samples();
+        latencies += client->latencies();
+    }
+    qSort(latencies);
+
+    qDebug("%s: %d client(s), %.1f s", sensorId_.toLocal8Bit().constData(), clients_.size(), seconds);
+    qDebug("  throughput: %.0f samples/s total, %.0f..%.0f samples/s per client",
+           total / seconds, slowest / seconds, fastest / seconds);
+    if (!latencies.isEmpty()) {
+        qDebug("  latency: p50 %u us, p99 %u us, p999 %u us, max %u us",
+               latencies.at(latencies.size() / 2),
+               latencies.at(latencies.size() * 99 / 100),
+               latencies.at(latencies.size() * 999 / 1000),
+               latencies.last());
+    }
+    if (sensordPid_)
+        qDebug("  cpu: sensord %.1f %%, driver %.1f %%", 100 * sensordCpu, 100 * driverCpu);
+    else
+        qDebug("  cpu: driver %.1f %%", 100 * driverCpu);
+
+    QString name = QString("%1 %2 client(s)").arg(sensorId_).arg(clients_.size());
+    BenchmarkResults::record(name, "throughput", "samples/s", total / seconds, BenchmarkResults::HigherIsBetter, total);
+    BenchmarkResults::record(name, "slowest client", "samples/s", slowest / seconds, BenchmarkResults::HigherIsBetter);
+    if (!latencies.isEmpty()) {
+        double mean = 0;
+        foreach (quint32 latency, latencies)
+            mean += latency;
+        mean /= latencies.size();
+        double variance = 0;
+        foreach (quint32 latency, latencies)
+            variance += (latency - mean) * (latency - mean);
+        variance /= latencies.size();
+        BenchmarkResults::record(name, "latency mean", "us", mean, BenchmarkResults::LowerIsBetter, latencies.size(), variance);
+        BenchmarkResults::record(name, "latency p50", "us", latencies.at(latencies.size() / 2), BenchmarkResults::LowerIsBetter, latencies.size());
+        BenchmarkResults::record(name, "latency p99", "us", latencies.at(latencies.size() * 99 / 100), BenchmarkResults::LowerIsBetter, latencies.size());
+        BenchmarkResults::record(name, "latency p999", "us", latencies.at(latencies.size() * 999 / 1000), BenchmarkResults::LowerIsBetter, latencies.size());
+    }
+    BenchmarkResults::record(name, "driver cpu", "%", 100 * driverCpu, BenchmarkResults::LowerIsBetter);
+    if (sensordPid_) {
+        BenchmarkResults::record(name, "sensord cpu", "%", 100 * sensordCpu, BenchmarkResults::LowerIsBetter);
+        long rss = BenchmarkResults::residentKb(sensordPid_);
+        if (rss >= 0)
+            BenchmarkResults::record(name, "sensord rss", "kB", rss, BenchmarkResults::LowerIsBetter);
+    }
+    BenchmarkResults::write("sensorloaddriver");
+
+    emit finished();
+}
+
+static void usage()
+{
+    qDebug("Usage: sensorloaddriver [-s accelerometersensor|magnetometersensor] [-c clients]\n"
+           "                        [-t seconds] [-i interval ms] [-b buffer size] [-r trace file]");
+}
+
+int main(int argc, char** argv)
+{
+    QCoreApplication app(argc, argv);
+
+    QString sensorId("accelerometersensor");
+    int clients = 1;
+    int seconds = 10;
+    int interval = 0;
+    unsigned bufferSize = 0;
+    QString tracePath;
+
+    QStringList args = app.arguments();
+    for (int i = 1; i < args.size(); ++i) {
+        if (i + 1 == args.size()) {
+            usage();
+            return 1;
+        }
+        const QString& option = args.at(i);
+        const QString& value = args.at(++i);
+        if (option == "-s")
+            sensorId = value;
+        else if (option == "-c")
+            clients = qMax(1, value.toInt());
+        else if (option == "-t")
+            seconds = qMax(1, value.toInt());
+        else if (option == "-i")
+            interval = value.toInt();
+        else if (option == "-b")
+            bufferSize = value.toUInt();
+        else if (option == "-r")
+            tracePath = value;
+        else {
+            usage();
+            return 1;
+        }
+    }
+
+    LoadDriver driver(sensorId, clients, interval, bufferSize);
+    if (!tracePath.isEmpty() && !driver.recordTrace(tracePath)) {
+        qDebug() << "[LoadDriver] Unable to record trace" << tracePath;
+        return 1;
+    }
+    if (!driver.start(BenchmarkResults::sensordProcessId())) {
+        qDebug() << "[LoadDriver] No sessions opened for" << sensorId;
+        return 1;
+    }
+
+    QTimer::singleShot(seconds * 1000, &driver, SLOT(stop()));
+    QObject::connect(&driver, SIGNAL(finished()), &app, SLOT(quit()));
+
+    return app.exec();
+}
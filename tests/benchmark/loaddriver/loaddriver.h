@@ -0,0 +1,127 @@
+/**
+   @file loaddriver.h
+   @brief Multi-client load driver for scaling benchmarks
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+*/
+
+#ifndef LOADDRIVER_H
+#define LOADDRIVER_H
+
+#include <QObject>
+#include <QList>
+#include <QVector>
+#include "abstractsensor_i.h"
+#include "datatypes/xyz.h"
+#include "datatypes/magneticfield.h"
+#include "datatypes/sensortrace.h"
+#include "signaldump.h"
+
+/**
+ * Single client session counting samples and their latency from the
+ * sample timestamp to delivery.
+ */
+class LoadClient : public QObject
+{
+    Q_OBJECT;
+public:
+    /**
+     * Open a session to the sensor.
+     *
+     * @param sensorId accelerometersensor or magnetometersensor.
+     * @param interval requested interval in milliseconds, 0 for default.
+     * @param bufferSize requested buffer size, 0 for default.
+     */
+    LoadClient(const QString& sensorId, int interval, unsigned bufferSize, QObject* parent = 0);
+    ~LoadClient();
+
+    bool isValid() const { return sensor_ != NULL; }
+
+    void start();
+    void stop();
+
+    /**
+     * Record received samples into a trace.
+     *
+     * @param trace opened trace writer, NULL to stop recording.
+     */
+    void setTrace(SensorTraceWriter* trace) { trace_ = trace; }
+
+    unsigned long samples() const { return samples_; }
+    const QVector<quint32>& latencies() const { return latencies_; }
+
+public slots:
+    void accelerometerData(const XYZ& data);
+    void magnetometerData(const MagneticField& data);
+
+private:
+    void record(quint64 timestamp, int x, int y, int z);
+
+    AbstractSensorChannelInterface* sensor_;    /**< session */
+    SensorTraceWriter*              trace_;     /**< recorded trace */
+    unsigned long                   samples_;   /**< received samples */
+    QVector<quint32>                latencies_; /**< latencies in microseconds */
+};
+
+/**
+ * Opens a number of sessions, runs them for given time and prints
+ * throughput, latency percentiles and CPU use of sensord and the driver.
+ */
+class LoadDriver : public QObject
+{
+    Q_OBJECT;
+public:
+    LoadDriver(const QString& sensorId, int clients, int interval, unsigned bufferSize, QObject* parent = 0);
+    ~LoadDriver();
+
+    /**
+     * Start all sessions.
+     *
+     * @param sensordPid sensord process ID for CPU accounting, 0 to skip.
+     * @return false if no session could be opened.
+     */
+    bool start(int sensordPid);
+
+    /**
+     * Record samples of the first session into a trace file, for
+     * replaying with replayadaptor.
+     *
+     * @param path trace file path.
+     * @return was the file created.
+     */
+    bool recordTrace(const QString& path);
+
+signals:
+    void finished();
+
+public slots:
+    /**
+     * Stop all sessions and print the report.
+     */
+    void stop();
+
+private:
+    QString            sensorId_;   /**< measured sensor */
+    QList<LoadClient*> clients_;    /**< sessions */
+    int                sensordPid_; /**< sensord process ID */
+    SignalDump         sensordCpu_; /**< sensord CPU counters */
+    SignalDump         driverCpu_;  /**< driver CPU counters */
+    QTime              started_;    /**< start time */
+    SensorTraceWriter  trace_;      /**< recorded trace */
+};
+
+#endif
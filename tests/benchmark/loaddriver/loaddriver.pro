@@ -0,0 +1,26 @@
+TEMPLATE = app
+TARGET = sensorloaddriver
+QT += dbus network
+
+include( ../../common-install.pri)
+include(../benchmarkresults.pri)
+
+INCLUDEPATH += ../../../qt-api \
+               ../../../core \
+               ../../../include \
+               ../benchmarktest \
+               ../../..
+
+SOURCES += loaddriver.cpp
+HEADERS += loaddriver.h
+
+QMAKE_LIBDIR_FLAGS += -L../../../qt-api  \
+                      -L../../../datatypes \
+                      -L../../../core
+
+equals(QT_MAJOR_VERSION, 4):{
+    QMAKE_LIBDIR_FLAGS += -lsensordatatypes -lsensorclient
+}
+equals(QT_MAJOR_VERSION, 5):{
+    QMAKE_LIBDIR_FLAGS += -lsensordatatypes-qt5 -lsensorclient-qt5
+}
@@ -0,0 +1,139 @@
+#!/usr/bin/env python
+##
+## This file is part of Sensord.
+##
+## Sensord is free software; you can redistribute it and/or modify
+## it under the terms of the GNU Lesser General Public License
+## version 2.1 as published by the Free Software Foundation.
+##
+## Sensord is distributed in the hope that it will be useful,
+## but WITHOUT ANY WARRANTY; without even the implied warranty of
+## MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+## Lesser General Public License for more details.
+##
+## You should have received a copy of the GNU Lesser General Public
+## License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+##
+
+"""Compare two sets of benchmark results written by BenchmarkResults.
+
+Results are identified by target, name and metric. A result regresses
+when it changed in the worse direction by more than its threshold, in
+percent of the baseline, and by more than the noise given by the
+variances of both runs. Exits with 1 if anything regressed.
+
+Thresholds file has lines "<pattern> <percent>", the pattern is matched
+against "target/name/metric" with shell wildcards and the first matching
+line applies. Lines starting with '#' are comments.
+"""
+
+import fnmatch
+import json
+import math
+import optparse
+import os
+import sys
+
+def loadResults(path):
+    """Results of a file or of all .json files in a directory, by key."""
+    if os.path.isdir(path):
+        files = [os.path.join(path, name) for name in sorted(os.listdir(path)) if name.endswith('.json')]
+    else:
+        files = [path]
+    results = {}
+    for name in files:
+        with open(name) as f:
+            data = json.load(f)
+        for result in data.get('results', []):
+            if result.get('value') is None:
+                continue
+            key = '%s/%s/%s' % (data.get('target', ''), result['name'], result['metric'])
+            results[key] = result
+    return results
+
+def loadThresholds(path):
+    thresholds = []
+    if not path:
+        return thresholds
+    with open(path) as f:
+        for line in f:
+            line = line.strip()
+            if not line or line.startswith('#'):
+                continue
+            pattern, percent = line.rsplit(None, 1)
+            thresholds.append((pattern, float(percent)))
+    return thresholds
+
+def threshold(key, thresholds, default):
+    for pattern, percent in thresholds:
+        if fnmatch.fnmatchcase(key, pattern):
+            return percent
+    return default
+
+def noise(base, current, sigmas):
+    """Standard error of the difference of the means, in sigmas."""
+    error = 0.0
+    for result in (base, current):
+        iterations = max(1, int(result.get('iterations', 1)))
+        error += float(result.get('variance', 0) or 0) / iterations
+    return sigmas * math.sqrt(error)
+
+def compare(baseline, current, thresholds, default, sigmas):
+    regressions = 0
+    missing = 0
+    for key in sorted(baseline):
+        base = baseline[key]
+        if key not in current:
+            print('%-10s %s' % ('missing', key))
+            missing += 1
+            continue
+        now = current[key]
+        before = float(base['value'])
+        after = float(now['value'])
+        # Positive change is worse
+        worse = after - before
+        if base.get('better', 'lower') == 'higher':
+            worse = -worse
+        if before:
+            change = 100.0 * worse / abs(before)
+        else:
+            change = 0.0 if not worse else math.copysign(float('inf'), worse)
+        limit = threshold(key, thresholds, default)
+        if change > limit and abs(after - before) > noise(base, now, sigmas):
+            status = 'REGRESSED'
+            regressions += 1
+        elif change < -limit and abs(after - before) > noise(base, now, sigmas):
+            status = 'improved'
+        else:
+            status = 'ok'
+        print('%-10s %s: %g -> %g %s (%+.1f %% worse, limit %g %%)'
+              % (status, key, before, after, now.get('unit', ''), change, limit))
+    for key in sorted(set(current) - set(baseline)):
+        print('%-10s %s' % ('new', key))
+    return regressions, missing
+
+def main():
+    parser = optparse.OptionParser(usage='%prog [options] <baseline> <current>\n\n'
+                                         'Baseline and current are result files or directories of them.')
+    parser.add_option('-t', '--threshold', type='float', default=5.0,
+                      help='default threshold in percent [%default]')
+    parser.add_option('-c', '--thresholds', help='thresholds file')
+    parser.add_option('-s', '--sigmas', type='float', default=2.0,
+                      help='changes within this many standard errors are noise [%default]')
+    parser.add_option('-m', '--fail-missing', action='store_true', default=False,
+                      help='fail if a baseline result is missing')
+    options, args = parser.parse_args()
+    if len(args) != 2:
+        parser.error('baseline and current results are needed')
+
+    baseline = loadResults(args[0])
+    current = loadResults(args[1])
+    regressions, missing = compare(baseline, current, loadThresholds(options.thresholds),
+                                   options.threshold, options.sigmas)
+    print('%d result(s), %d regression(s), %d missing' % (len(baseline), regressions, missing))
+    if regressions or (options.fail_missing and missing):
+        return 1
+    return 0
+
+if __name__ == '__main__':
+    sys.exit(main())
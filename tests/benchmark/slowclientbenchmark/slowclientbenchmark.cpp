@@ -0,0 +1,262 @@
+/**
+   @file slowclientbenchmark.cpp
+   @brief Delivery to healthy clients next to stalled and dead ones
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+*/
+
+
+#include <QCoreApplication>
+#include <QStringList>
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "sensormanagerinterface.h"
+#include "accelerometersensor_i.h"
+#include "slowclientbenchmark.h"
+#include "benchmarkclient.h"
+#include "benchmarkresults.h"
+
+/** Milliseconds a client process may take to start its session */
+static const int CLIENT_START_TIMEOUT = 5000;
+
+SlowClientDriver::SlowClientDriver(const QString& sensorId, int healthy, int stalled, int dead, int rate, QObject* parent) :
+    QObject(parent),
+    sensorId_(sensorId),
+    stalled_(stalled),
+    dead_(dead),
+    rate_(qMax(rate, 1)),
+    sensordPid_(0),
+    passed_(false)
+{
+    BenchmarkClient::registerSensor(sensorId_);
+    for (int i = 0; i < healthy; ++i) {
+        BenchmarkClient* client = new BenchmarkClient(sensorId_, 1000000ULL / rate_);
+        if (!client->isValid()) {
+            delete client;
+            break;
+        }
+        clients_.append(client);
+    }
+    connect(&sampler_, SIGNAL(timeout()), this, SLOT(sample()));
+}
+
+SlowClientDriver::~SlowClientDriver()
+{
+    qDeleteAll(clients_);
+    foreach (QProcess* process, processes_) {
+        process->kill();
+        process->waitForFinished();
+    }
+    qDeleteAll(processes_);
+}
+
+QProcess* SlowClientDriver::startStalled()
+{
+    QProcess* process = new QProcess(this);
+    process->setProcessChannelMode(QProcess::ForwardedErrorChannel);
+    process->start(QCoreApplication::applicationFilePath(), QStringList() << "-x" << sensorId_);
+    if (!process->waitForReadyRead(CLIENT_START_TIMEOUT) ||
+        !process->readAllStandardOutput().startsWith("ready")) {
+        qDebug() << "[SlowClientDriver] Client process did not start its session";
+        process->kill();
+        process->waitForFinished();
+        delete process;
+        return NULL;
+    }
+    // Session runs, stop reading it
+    ::kill(process->pid(), SIGSTOP);
+    return process;
+}
+
+bool SlowClientDriver::start(int sensordPid, int seconds)
+{
+    if (clients_.isEmpty())
+        return false;
+
+    sensordPid_ = sensordPid;
+    for (int i = 0; i < dead_ + stalled_; ++i) {
+        QProcess* process = startStalled();
+        if (!process)
+            return false;
+        processes_.append(process);
+    }
+
+    started_.start();
+    foreach (BenchmarkClient* client, clients_)
+        client->start();
+    if (sensordPid_) {
+        sample();
+        sampler_.start(1000);
+    }
+    if (dead_)
+        QTimer::singleShot(seconds * 500, this, SLOT(killDead()));
+    return true;
+}
+
+void SlowClientDriver::sample()
+{
+    long rss = BenchmarkResults::residentKb(sensordPid_);
+    if (rss >= 0)
+        memory_.append(rss);
+}
+
+void SlowClientDriver::killDead()
+{
+    for (int i = 0; i < dead_ && i < processes_.size(); ++i)
+        ::kill(processes_.at(i)->pid(), SIGKILL);
+}
+
+void SlowClientDriver::stop()
+{
+    sampler_.stop();
+    foreach (BenchmarkClient* client, clients_)
+        client->stop();
+    double seconds = started_.elapsed() / 1000.0;
+    foreach (QProcess* process, processes_) {
+        process->kill();
+        process->waitForFinished();
+    }
+
+    passed_ = true;
+    if (sensordPid_ && ::kill(sensordPid_, 0) < 0 && errno == ESRCH) {
+        qDebug() << "[SlowClientDriver] sensord died during the run";
+        passed_ = false;
+    }
+
+    unsigned long total = 0;
+    unsigned long lost = 0;
+    QVector<quint32> latencies;
+    foreach (BenchmarkClient* client, clients_) {
+        total += client->samples();
+        lost += client->lost();
+        latencies += client->latencies();
+    }
+    qSort(latencies);
+
+    qDebug("%s: %d healthy, %d stalled, %d dead client(s), %.1f s",
+           sensorId_.toLocal8Bit().constData(), clients_.size(), stalled_, dead_, seconds);
+    qDebug("  healthy: %.0f samples/s per client, %lu lost (%.3f %%)",
+           total / seconds / clients_.size(), lost, total + lost ? 100.0 * lost / (total + lost) : 0.0);
+    if (!latencies.isEmpty()) {
+        qDebug("  latency: p50 %u us, p99 %u us, p999 %u us, max %u us",
+               latencies.at(latencies.size() / 2),
+               latencies.at(latencies.size() * 99 / 100),
+               latencies.at(latencies.size() * 999 / 1000),
+               latencies.last());
+    }
+    if (!memory_.isEmpty()) {
+        long peak = memory_.first();
+        foreach (long rss, memory_)
+            peak = qMax(peak, rss);
+        qDebug("  sensord rss: %ld kB at start, %ld kB at end, %ld kB peak",
+               memory_.first(), memory_.last(), peak);
+    }
+
+    QString name = QString("%1 %2 healthy %3 stalled %4 dead").arg(sensorId_).arg(clients_.size()).arg(stalled_).arg(dead_);
+    BenchmarkResults::record(name, "throughput", "samples/s", total / seconds / clients_.size(),
+                             BenchmarkResults::HigherIsBetter, total);
+    BenchmarkResults::record(name, "lost", "%", total + lost ? 100.0 * lost / (total + lost) : 0.0,
+                             BenchmarkResults::LowerIsBetter, total + lost);
+    if (!latencies.isEmpty()) {
+        BenchmarkResults::record(name, "latency p50", "us", latencies.at(latencies.size() / 2), BenchmarkResults::LowerIsBetter, latencies.size());
+        BenchmarkResults::record(name, "latency p99", "us", latencies.at(latencies.size() * 99 / 100), BenchmarkResults::LowerIsBetter, latencies.size());
+        BenchmarkResults::record(name, "latency p999", "us", latencies.at(latencies.size() * 999 / 1000), BenchmarkResults::LowerIsBetter, latencies.size());
+        BenchmarkResults::record(name, "latency max", "us", latencies.last(), BenchmarkResults::LowerIsBetter, latencies.size());
+    }
+    if (!memory_.isEmpty()) {
+        long peak = memory_.first();
+        foreach (long rss, memory_)
+            peak = qMax(peak, rss);
+        BenchmarkResults::record(name, "sensord rss growth", "kB", memory_.last() - memory_.first(),
+                                 BenchmarkResults::LowerIsBetter, memory_.size());
+        BenchmarkResults::record(name, "sensord rss peak", "kB", peak, BenchmarkResults::LowerIsBetter, memory_.size());
+    }
+    BenchmarkResults::write("sensorslowclient-benchmark");
+
+    emit finished();
+}
+
+static void usage()
+{
+    qDebug("Usage: sensorslowclient-benchmark [-s sensor] [-n healthy] [-m stalled] [-d dead]\n"
+           "                                  [-t seconds] [-r loadgen rate]");
+}
+
+int main(int argc, char** argv)
+{
+    QCoreApplication app(argc, argv);
+    QStringList args = app.arguments();
+
+    // Client process started by the driver: -x <sensor>
+    if (args.size() == 3 && args.at(1) == "-x") {
+        BenchmarkClient::registerSensor(args.at(2));
+        AccelerometerSensorChannelInterface* sensor = AccelerometerSensorChannelInterface::interface(args.at(2));
+        if (sensor == NULL || !sensor->isValid())
+            return 1;
+        sensor->setStandbyOverride(true);
+        if (!sensor->start().isValid())
+            return 1;
+        printf("ready\n");
+        fflush(stdout);
+        return app.exec();
+    }
+
+    QString sensorId("accelerometersensor");
+    int healthy = 2;
+    int stalled = 2;
+    int dead = 1;
+    int seconds = 30;
+    int rate = 1000;
+    for (int i = 1; i < args.size(); ++i) {
+        if (i + 1 == args.size()) {
+            usage();
+            return 1;
+        }
+        const QString& option = args.at(i);
+        const QString& value = args.at(++i);
+        if (option == "-s")
+            sensorId = value;
+        else if (option == "-n")
+            healthy = qMax(1, value.toInt());
+        else if (option == "-m")
+            stalled = qMax(0, value.toInt());
+        else if (option == "-d")
+            dead = qMax(0, value.toInt());
+        else if (option == "-t")
+            seconds = qMax(1, value.toInt());
+        else if (option == "-r")
+            rate = qMax(1, value.toInt());
+        else {
+            usage();
+            return 1;
+        }
+    }
+
+    SlowClientDriver driver(sensorId, healthy, stalled, dead, rate);
+    if (!driver.start(BenchmarkResults::sensordProcessId(), seconds)) {
+        qDebug() << "[SlowClientDriver] Unable to start clients for" << sensorId;
+        return 1;
+    }
+
+    QTimer::singleShot(seconds * 1000, &driver, SLOT(stop()));
+    QObject::connect(&driver, SIGNAL(finished()), &app, SLOT(quit()));
+
+    int result = app.exec();
+    return result ? result : (driver.passed() ? 0 : 1);
+}
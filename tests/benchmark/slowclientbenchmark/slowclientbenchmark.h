@@ -0,0 +1,111 @@
+/**
+   @file slowclientbenchmark.h
+   @brief Delivery to healthy clients next to stalled and dead ones
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+*/
+
+
+#ifndef SLOWCLIENTBENCHMARK_H
+#define SLOWCLIENTBENCHMARK_H
+
+#include <QObject>
+#include <QList>
+#include <QProcess>
+#include <QTime>
+#include <QTimer>
+#include <QVector>
+
+class BenchmarkClient;
+
+/**
+ * Runs healthy sessions next to stalled and dead clients. Stalled
+ * clients are child processes which open and start a session and are
+ * then stopped with SIGSTOP, so sensord sees sessions whose sockets fill
+ * up and are never read. Dead clients are stopped the same way and
+ * killed with SIGKILL halfway through the run, like the client killed
+ * by sensord-deadclienttest.
+ *
+ * Delivery latency and loss of the healthy sessions are reported, plus
+ * resident memory of sensord sampled every second, so that a stalled
+ * client slowing down others or growing queues in sensord shows up as a
+ * regression. Meant for sensord configured with loadgenadaptor; the rate
+ * given with -r is its loadgen_rate.
+ */
+class SlowClientDriver : public QObject
+{
+    Q_OBJECT
+public:
+    SlowClientDriver(const QString& sensorId, int healthy, int stalled, int dead, int rate, QObject* parent = 0);
+    ~SlowClientDriver();
+
+    /**
+     * Start healthy sessions and the stalled and dead clients.
+     *
+     * @param sensordPid sensord process ID for memory sampling, 0 to skip.
+     * @param seconds run time.
+     * @return false if no healthy session could be opened.
+     */
+    bool start(int sensordPid, int seconds);
+
+    /**
+     * Did sensord survive the run.
+     */
+    bool passed() const { return passed_; }
+
+signals:
+    void finished();
+
+public slots:
+    /**
+     * Stop healthy sessions, kill the clients and print the report.
+     */
+    void stop();
+
+private slots:
+    /**
+     * Sample sensord memory.
+     */
+    void sample();
+
+    /**
+     * Kill the dead clients.
+     */
+    void killDead();
+
+private:
+    /**
+     * Start a client process and stop it once its session runs.
+     *
+     * @return client process, NULL if its session did not start.
+     */
+    QProcess* startStalled();
+
+    QString                 sensorId_;   /**< measured sensor */
+    int                     stalled_;    /**< stalled client count */
+    int                     dead_;       /**< dead client count */
+    int                     rate_;       /**< adaptor rate in samples per second */
+    QList<BenchmarkClient*> clients_;    /**< healthy sessions */
+    QList<QProcess*>        processes_;  /**< stalled and dead clients, dead ones first */
+    int                     sensordPid_; /**< sensord process ID */
+    QTimer                  sampler_;    /**< memory sampling timer */
+    QVector<long>           memory_;     /**< sensord resident memory each second, kB */
+    QTime                   started_;    /**< start time */
+    bool                    passed_;     /**< result of the run */
+};
+
+#endif // SLOWCLIENTBENCHMARK_H
@@ -0,0 +1,27 @@
+QT += testlib dbus network
+QT -= gui
+
+include(../../common-install.pri)
+include(../benchmarkresults.pri)
+
+TEMPLATE = app
+TARGET = sensorstartup-benchmark
+
+HEADERS += startupbenchmarks.h
+SOURCES += startupbenchmarks.cpp
+
+SENSORFW_INCLUDEPATHS = ../../.. \
+                        ../../../include \
+                        ../../../qt-api
+
+DEPENDPATH += $$SENSORFW_INCLUDEPATHS
+INCLUDEPATH += $$SENSORFW_INCLUDEPATHS
+
+QMAKE_LIBDIR_FLAGS += -L../../../qt-api \
+                      -L../../../datatypes
+equals(QT_MAJOR_VERSION, 4):{
+    QMAKE_LIBDIR_FLAGS += -lsensordatatypes -lsensorclient
+}
+equals(QT_MAJOR_VERSION, 5):{
+    QMAKE_LIBDIR_FLAGS += -lsensordatatypes-qt5 -lsensorclient-qt5
+}
@@ -0,0 +1,352 @@
+/**
+   @file startupbenchmarks.cpp
+   @brief Time to the first sample of a starting client
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+*/
+
+#include <QCoreApplication>
+#include <QProcess>
+#include <QStringList>
+#include <QTimer>
+#include <stdio.h>
+#include <time.h>
+#include "sensormanagerinterface.h"
+#include "accelerometersensor_i.h"
+#include "alssensor_i.h"
+#include "compasssensor_i.h"
+#include "gyroscopesensor_i.h"
+#include "magnetometersensor_i.h"
+#include "orientationsensor_i.h"
+#include "proximitysensor_i.h"
+#include "rotationsensor_i.h"
+#include "tapsensor_i.h"
+#include "startupbenchmarks.h"
+#include "benchmarkresults.h"
+
+/** Client processes started for each sensor and state */
+static const int RUNS = 5;
+
+/** Milliseconds a started sensor may take to deliver its first sample */
+static const int FIRST_SAMPLE_TIMEOUT = 5000;
+
+/** Milliseconds a client process may take */
+static const int CLIENT_TIMEOUT = 60000;
+
+/** Milliseconds before a cold run, for the adaptor to stop after the previous one */
+static const int COLD_PAUSE = 2000;
+
+/** Milliseconds the warm session runs before the first client */
+static const int WARM_UP = 500;
+
+/** Signals delivering single samples */
+static const char* const SAMPLE_SIGNALS[] = {
+    "dataAvailable(XYZ)",
+    "dataAvailable(MagneticField)",
+    "dataAvailable(Compass)",
+    "dataAvailable(Unsigned)",
+    "dataAvailable(Tap)",
+    "ALSChanged(Unsigned)",
+    "orientationChanged(Unsigned)"
+};
+
+typedef void (*RegisterFunction)(const QString& id);
+typedef AbstractSensorChannelInterface* (*OpenFunction)(const QString& id, int sessionId);
+
+template <class INTERFACE>
+static void registerInterface(const QString& id)
+{
+    SensorManagerInterface::instance().registerSensorInterface<INTERFACE>(id);
+}
+
+/**
+ * Sensor started by the benchmark.
+ */
+struct StartupSensor
+{
+    const char*      id;                /**< sensor ID */
+    RegisterFunction registerInterface; /**< registers the interface class */
+    OpenFunction     open;              /**< creates the interface of a session */
+};
+
+static const StartupSensor SENSORS[] = {
+    { "accelerometersensor", &registerInterface<AccelerometerSensorChannelInterface>, &AccelerometerSensorChannelInterface::factoryMethod },
+    { "alssensor", &registerInterface<ALSSensorChannelInterface>, &ALSSensorChannelInterface::factoryMethod },
+    { "compasssensor", &registerInterface<CompassSensorChannelInterface>, &CompassSensorChannelInterface::factoryMethod },
+    { "gyroscopesensor", &registerInterface<GyroscopeSensorChannelInterface>, &GyroscopeSensorChannelInterface::factoryMethod },
+    { "magnetometersensor", &registerInterface<MagnetometerSensorChannelInterface>, &MagnetometerSensorChannelInterface::factoryMethod },
+    { "orientationsensor", &registerInterface<OrientationSensorChannelInterface>, &OrientationSensorChannelInterface::factoryMethod },
+    { "proximitysensor", &registerInterface<ProximitySensorChannelInterface>, &ProximitySensorChannelInterface::factoryMethod },
+    { "rotationsensor", &registerInterface<RotationSensorChannelInterface>, &RotationSensorChannelInterface::factoryMethod },
+    { "tapsensor", &registerInterface<TapSensorChannelInterface>, &TapSensorChannelInterface::factoryMethod }
+};
+
+static const int SENSOR_COUNT = sizeof(SENSORS) / sizeof(SENSORS[0]);
+
+static quint64 nowUs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+static const StartupSensor* findSensor(const QString& id)
+{
+    for (int i = 0; i < SENSOR_COUNT; ++i) {
+        if (id == SENSORS[i].id)
+            return &SENSORS[i];
+    }
+    return NULL;
+}
+
+/**
+ * Connect a signal of the sensor if the interface has it.
+ *
+ * @param sensor sensor interface.
+ * @param signal normalized signal signature.
+ * @param receiver receiving object.
+ * @return was the signal connected.
+ */
+static bool connectSignal(AbstractSensorChannelInterface* sensor, const char* signal, QObject* receiver)
+{
+    if (sensor->metaObject()->indexOfSignal(signal) < 0)
+        return false;
+    QByteArray signature = QByteArray("2") + signal;
+    return QObject::connect(sensor, signature.constData(), receiver, SLOT(sample()));
+}
+
+bool FirstSampleWaiter::wait(int timeout)
+{
+    if (!received_) {
+        QTimer::singleShot(timeout, &loop_, SLOT(quit()));
+        loop_.exec();
+    }
+    return received_ != 0;
+}
+
+void FirstSampleWaiter::sample()
+{
+    if (received_)
+        return;
+    received_ = nowUs();
+    loop_.quit();
+}
+
+const char* StartupPhases::name(int phase)
+{
+    static const char* const NAMES[PhaseCount] = {
+        "manager", "plugin", "session", "connect", "start", "first sample", "total"
+    };
+    return phase >= 0 && phase < PhaseCount ? NAMES[phase] : "unknown";
+}
+
+bool StartupPhases::run(const StartupSensor& sensor)
+{
+    quint64 begin = nowUs();
+    SensorManagerInterface& sm = SensorManagerInterface::instance();
+    if (!sm.isValid()) {
+        qWarning() << "Unable to connect to sensord";
+        return false;
+    }
+    quint64 connected = nowUs();
+    latencies_[Manager].append(connected - begin);
+
+    sm.loadPlugin(sensor.id);
+    sensor.registerInterface(sensor.id);
+    quint64 loaded = nowUs();
+    latencies_[Plugin].append(loaded - connected);
+
+    QDBusReply<int> session = sm.requestSensor(sensor.id);
+    int sessionId = session.isValid() ? session.value() : -1;
+    quint64 requested = nowUs();
+    latencies_[Session].append(requested - loaded);
+    if (sessionId < 0) {
+        qWarning() << "Unable to get session:" << sm.errorString();
+        return false;
+    }
+
+    AbstractSensorChannelInterface* channel = sensor.open(sensor.id, sessionId);
+    quint64 opened = nowUs();
+    latencies_[Connect].append(opened - requested);
+    if (!channel || !channel->isValid()) {
+        qWarning() << "Unable to connect session of" << sensor.id;
+        delete channel;
+        return false;
+    }
+
+    FirstSampleWaiter waiter;
+    for (unsigned i = 0; i < sizeof(SAMPLE_SIGNALS) / sizeof(SAMPLE_SIGNALS[0]); ++i)
+        connectSignal(channel, SAMPLE_SIGNALS[i], &waiter);
+    quint64 configured = nowUs();
+    channel->setStandbyOverride(true);
+    bool ok = channel->start().isValid();
+    quint64 started = nowUs();
+    latencies_[Start].append(started - configured);
+
+    if (ok && waiter.wait(FIRST_SAMPLE_TIMEOUT)) {
+        latencies_[FirstSample].append(waiter.received() - started);
+        latencies_[Total].append(waiter.received() - begin);
+    }
+
+    channel->stop();
+    delete channel;
+    if (!ok)
+        qWarning() << "Session of" << sensor.id << "did not start";
+    return ok;
+}
+
+QByteArray StartupPhases::serialize() const
+{
+    QByteArray data;
+    for (int phase = 0; phase < PhaseCount; ++phase) {
+        // Phase names have spaces, numbers follow a colon
+        data += name(phase);
+        data += ':';
+        foreach (quint32 latency, latencies_[phase])
+            data += ' ' + QByteArray::number(latency);
+        data += '\n';
+    }
+    return data;
+}
+
+void StartupPhases::merge(const QByteArray& data)
+{
+    foreach (const QByteArray& line, data.split('\n')) {
+        int colon = line.indexOf(':');
+        if (colon < 0)
+            continue;
+        QByteArray phaseName(line.left(colon));
+        for (int phase = 0; phase < PhaseCount; ++phase) {
+            if (phaseName != name(phase))
+                continue;
+            foreach (const QByteArray& word, line.mid(colon + 1).simplified().split(' ')) {
+                if (!word.isEmpty())
+                    latencies_[phase].append(word.toUInt());
+            }
+        }
+    }
+}
+
+void StartupPhases::report(const QString& name) const
+{
+    QStringList line;
+    for (int phase = 0; phase < PhaseCount; ++phase) {
+        const QVector<quint32>& latencies(latencies_[phase]);
+        if (latencies.isEmpty())
+            continue;
+        QList<double> values;
+        double sum = 0;
+        foreach (quint32 latency, latencies) {
+            values.append(latency);
+            sum += latency;
+        }
+        line << QString("%1 %2 us").arg(StartupPhases::name(phase)).arg(qRound(sum / latencies.size()));
+        BenchmarkResults::record(name, QString(StartupPhases::name(phase)) + " latency", "us",
+                                 values, BenchmarkResults::LowerIsBetter);
+    }
+    qDebug("%s", qPrintable(line.join(", ")));
+}
+
+void StartupBenchmark::initTestCase()
+{
+    QVERIFY(SensorManagerInterface::instance().isValid());
+}
+
+void StartupBenchmark::cleanupTestCase()
+{
+    BenchmarkResults::write("sensorstartup-benchmark");
+}
+
+void StartupBenchmark::benchmarkStartup_data()
+{
+    QTest::addColumn<QString>("sensorName");
+    QTest::addColumn<bool>("warm");
+
+    for (int i = 0; i < SENSOR_COUNT; ++i) {
+        QString sensor(SENSORS[i].id);
+        QTest::newRow(qPrintable(sensor + " cold")) << sensor << false;
+        QTest::newRow(qPrintable(sensor + " warm")) << sensor << true;
+    }
+}
+
+void StartupBenchmark::benchmarkStartup()
+{
+    QFETCH(QString, sensorName);
+    QFETCH(bool, warm);
+
+    // Session of the benchmark keeps the adaptor running
+    AbstractSensorChannelInterface* running = NULL;
+    if (warm) {
+        SensorManagerInterface& sm = SensorManagerInterface::instance();
+        sm.loadPlugin(sensorName);
+        findSensor(sensorName)->registerInterface(sensorName);
+        running = sm.interface(sensorName);
+        if (!running || !running->isValid()) {
+            delete running;
+            qDebug() << sensorName << "not available, skipped";
+            return;
+        }
+        running->setStandbyOverride(true);
+        running->start();
+        QTest::qWait(WARM_UP);
+    }
+
+    StartupPhases phases;
+    int runs = 0;
+    for (int i = 0; i < RUNS; ++i) {
+        if (!warm)
+            QTest::qWait(COLD_PAUSE);
+        QProcess process;
+        process.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+        process.start(QCoreApplication::applicationFilePath(), QStringList() << "-c" << sensorName);
+        if (!process.waitForFinished(CLIENT_TIMEOUT) || process.exitCode() != 0)
+            break;
+        phases.merge(process.readAllStandardOutput());
+        ++runs;
+    }
+
+    if (running) {
+        running->stop();
+        delete running;
+    }
+
+    if (!runs) {
+        qDebug() << sensorName << "not available, skipped";
+        return;
+    }
+    phases.report(QTest::currentDataTag());
+}
+
+int main(int argc, char** argv)
+{
+    QCoreApplication app(argc, argv);
+    QStringList args = app.arguments();
+
+    // Client started by benchmarkStartup: -c <sensor>
+    if (args.size() == 3 && args.at(1) == "-c") {
+        const StartupSensor* sensor = findSensor(args.at(2));
+        if (!sensor)
+            return 1;
+        StartupPhases phases;
+        bool ok = phases.run(*sensor);
+        fputs(phases.serialize().constData(), stdout);
+        return ok ? 0 : 1;
+    }
+
+    StartupBenchmark benchmark;
+    return QTest::qExec(&benchmark, argc, argv);
+}
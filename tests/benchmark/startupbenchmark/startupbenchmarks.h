@@ -0,0 +1,150 @@
+/**
+   @file startupbenchmarks.h
+   @brief Time to the first sample of a starting client
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+*/
+
+#ifndef STARTUPBENCHMARKS_H
+#define STARTUPBENCHMARKS_H
+
+#include <QTest>
+#include <QEventLoop>
+#include <QVector>
+
+struct StartupSensor;
+
+/**
+ * Phases from client process start to the first sample of a sensor, see
+ * StartupBenchmark.
+ */
+class StartupPhases
+{
+public:
+    /**
+     * Measured phases of one client startup.
+     */
+    enum Phase
+    {
+        Manager = 0, /**< SensorManagerInterface connected to sensord */
+        Plugin,      /**< sensor plugin loaded and interface registered */
+        Session,     /**< session requested over D-Bus */
+        Connect,     /**< interface created, data socket connected and tagged */
+        Start,       /**< standby override set and session started, adaptor activated */
+        FirstSample, /**< first sample delivered after start returned */
+        Total,       /**< whole startup, from manager to first sample */
+        PhaseCount
+    };
+
+    /**
+     * Start a client of the sensor once and record its phases. Called
+     * in a fresh process, so that the manager phase is measured.
+     *
+     * @param sensor sensor to start.
+     * @return false if a session could not be opened or started.
+     */
+    bool run(const StartupSensor& sensor);
+
+    /**
+     * Write phases as lines of "<phase> <us> ...".
+     *
+     * @return serialized phases.
+     */
+    QByteArray serialize() const;
+
+    /**
+     * Add phases written by #serialize().
+     *
+     * @param data serialized phases.
+     */
+    void merge(const QByteArray& data);
+
+    /**
+     * Print and record mean and variance of every phase.
+     *
+     * @param name benchmark name.
+     */
+    void report(const QString& name) const;
+
+    /**
+     * Name of a phase.
+     */
+    static const char* name(int phase);
+
+private:
+    QVector<quint32> latencies_[PhaseCount]; /**< latencies in microseconds */
+};
+
+/**
+ * Waits for the first sample signal of a sensor interface.
+ */
+class FirstSampleWaiter : public QObject
+{
+    Q_OBJECT
+
+public:
+    FirstSampleWaiter() : received_(0) {}
+
+    /**
+     * Run the event loop until a sample arrives.
+     *
+     * @param timeout most milliseconds to wait.
+     * @return was a sample received.
+     */
+    bool wait(int timeout);
+
+    /**
+     * Arrival of the first sample.
+     *
+     * @return monotonic time in microseconds, 0 if none arrived.
+     */
+    quint64 received() const { return received_; }
+
+public slots:
+    void sample();
+
+private:
+    QEventLoop loop_;   /**< loop run by wait() */
+    quint64 received_;  /**< arrival of the first sample */
+};
+
+/**
+ * Time to the first sample of a client starting up against a running
+ * sensord, per sensor. Every run is a client process of its own, broken
+ * into the phases of StartupPhases. Runs are cold, with no other session
+ * of the sensor so that the adaptor is activated, and warm, with a session
+ * of the benchmark keeping the sensor running:
+ *
+ * <pre>QDEBUG : StartupBenchmark::benchmarkStartup(accelerometersensor cold) manager 5210 us, plugin 820 us, session 1460 us, connect 640 us, start 2270 us, first sample 18350 us, total 28750 us</pre>
+ *
+ * Cold runs are spaced further apart than global/sensor_linger should be.
+ * Sensors which deliver nothing without stimulus report no first sample.
+ * Results are also written as JSON, see BenchmarkResults.
+ */
+class StartupBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void benchmarkStartup_data();
+    void benchmarkStartup();
+};
+
+#endif // STARTUPBENCHMARKS_H
@@ -0,0 +1,289 @@
+/**
+   @file stressbenchmark.cpp
+   @brief Concurrency stress benchmark of the threaded sample path
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+*/
+
+
+#include <QCoreApplication>
+#include <QStringList>
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "sensormanagerinterface.h"
+#include "accelerometersensor_i.h"
+#include "stressbenchmark.h"
+#include "benchmarkclient.h"
+#include "benchmarkresults.h"
+
+/** Intervals churn sessions cycle through, in milliseconds */
+static const int CHURN_INTERVALS[] = { 1, 5, 10, 20, 100 };
+static const int CHURN_INTERVAL_COUNT = sizeof(CHURN_INTERVALS) / sizeof(CHURN_INTERVALS[0]);
+
+/** Milliseconds a worker may take beyond the run time to report */
+static const int WORKER_GRACE = 5000;
+
+ChurnWorker::ChurnWorker(const QString& sensorId, QObject* parent) :
+    QObject(parent),
+    sensorId_(sensorId),
+    sensor_(NULL),
+    phase_(0),
+    operations_(0),
+    failures_(0)
+{
+    BenchmarkClient::registerSensor(sensorId_);
+    connect(&timer_, SIGNAL(timeout()), this, SLOT(step()));
+    timer_.start(0);
+}
+
+ChurnWorker::~ChurnWorker()
+{
+    delete sensor_;
+}
+
+void ChurnWorker::step()
+{
+    int interval = CHURN_INTERVALS[(operations_ + failures_) % CHURN_INTERVAL_COUNT];
+    bool ok = true;
+    switch (phase_) {
+    case 0:
+        sensor_ = AccelerometerSensorChannelInterface::interface(sensorId_);
+        if (sensor_ == NULL || !sensor_->isValid()) {
+            delete sensor_;
+            sensor_ = NULL;
+            ok = false;
+            break;
+        }
+        sensor_->setStandbyOverride(true);
+        break;
+    case 1:
+        ok = sensor_->start().isValid();
+        break;
+    case 2:
+    case 3:
+        sensor_->setInterval(interval);
+        break;
+    case 4:
+        ok = sensor_->stop().isValid();
+        break;
+    default:
+        delete sensor_;
+        sensor_ = NULL;
+        break;
+    }
+
+    if (!ok) {
+        ++failures_;
+        // Session is closed and the cycle restarted
+        delete sensor_;
+        sensor_ = NULL;
+        phase_ = 0;
+        return;
+    }
+    ++operations_;
+    phase_ = sensor_ ? phase_ + 1 : 0;
+}
+
+void ChurnWorker::stop()
+{
+    timer_.stop();
+    delete sensor_;
+    sensor_ = NULL;
+    printf("churn %lu %lu\n", operations_, failures_);
+    fflush(stdout);
+    emit finished();
+}
+
+StressDriver::StressDriver(const QString& sensorId, int clients, int workers, int rate, QObject* parent) :
+    QObject(parent),
+    sensorId_(sensorId),
+    workers_(workers),
+    rate_(qMax(rate, 1)),
+    sensordPid_(0),
+    passed_(false)
+{
+    BenchmarkClient::registerSensor(sensorId_);
+    for (int i = 0; i < clients; ++i) {
+        BenchmarkClient* client = new BenchmarkClient(sensorId_, 1000000ULL / rate_);
+        if (!client->isValid()) {
+            delete client;
+            break;
+        }
+        clients_.append(client);
+    }
+}
+
+StressDriver::~StressDriver()
+{
+    qDeleteAll(clients_);
+    foreach (QProcess* process, processes_) {
+        process->kill();
+        process->waitForFinished();
+    }
+    qDeleteAll(processes_);
+}
+
+bool StressDriver::start(int sensordPid, int seconds)
+{
+    if (clients_.isEmpty())
+        return false;
+
+    sensordPid_ = sensordPid;
+    started_.start();
+    foreach (BenchmarkClient* client, clients_)
+        client->start();
+
+    QStringList args;
+    args << "-w" << sensorId_ << QString::number(seconds);
+    for (int i = 0; i < workers_; ++i) {
+        QProcess* process = new QProcess(this);
+        process->setProcessChannelMode(QProcess::ForwardedErrorChannel);
+        process->start(QCoreApplication::applicationFilePath(), args);
+        processes_.append(process);
+    }
+    return true;
+}
+
+void StressDriver::stop()
+{
+    foreach (BenchmarkClient* client, clients_)
+        client->stop();
+    double seconds = started_.elapsed() / 1000.0;
+
+    passed_ = true;
+    unsigned long operations = 0;
+    unsigned long failures = 0;
+    foreach (QProcess* process, processes_) {
+        if (!process->waitForFinished(WORKER_GRACE) || process->exitCode() != 0) {
+            qDebug() << "[StressDriver] Churn worker did not finish";
+            passed_ = false;
+            continue;
+        }
+        QList<QByteArray> counts(process->readAllStandardOutput().simplified().split(' '));
+        if (counts.size() == 3 && counts.at(0) == "churn") {
+            operations += counts.at(1).toULong();
+            failures += counts.at(2).toULong();
+        }
+    }
+    if (sensordPid_ && kill(sensordPid_, 0) < 0 && errno == ESRCH) {
+        qDebug() << "[StressDriver] sensord died during the run";
+        passed_ = false;
+    }
+
+    unsigned long total = 0;
+    unsigned long lost = 0;
+    QVector<quint32> latencies;
+    foreach (BenchmarkClient* client, clients_) {
+        total += client->samples();
+        lost += client->lost();
+        latencies += client->latencies();
+    }
+    qSort(latencies);
+
+    qDebug("%s: %d client(s), %d churn worker(s), %.1f s",
+           sensorId_.toLocal8Bit().constData(), clients_.size(), workers_, seconds);
+    qDebug("  throughput: %.0f samples/s total, %lu lost (%.3f %%)",
+           total / seconds, lost, total + lost ? 100.0 * lost / (total + lost) : 0.0);
+    if (!latencies.isEmpty()) {
+        qDebug("  latency: p50 %u us, p99 %u us, p999 %u us, max %u us",
+               latencies.at(latencies.size() / 2),
+               latencies.at(latencies.size() * 99 / 100),
+               latencies.at(latencies.size() * 999 / 1000),
+               latencies.last());
+    }
+    qDebug("  churn: %.0f calls/s, %lu failed", operations / seconds, failures);
+
+    QString name = QString("%1 %2 client(s) %3 worker(s)").arg(sensorId_).arg(clients_.size()).arg(workers_);
+    BenchmarkResults::record(name, "throughput", "samples/s", total / seconds, BenchmarkResults::HigherIsBetter, total);
+    BenchmarkResults::record(name, "lost", "%", total + lost ? 100.0 * lost / (total + lost) : 0.0,
+                             BenchmarkResults::LowerIsBetter, total + lost);
+    if (!latencies.isEmpty()) {
+        BenchmarkResults::record(name, "latency p50", "us", latencies.at(latencies.size() / 2), BenchmarkResults::LowerIsBetter, latencies.size());
+        BenchmarkResults::record(name, "latency p99", "us", latencies.at(latencies.size() * 99 / 100), BenchmarkResults::LowerIsBetter, latencies.size());
+        BenchmarkResults::record(name, "latency p999", "us", latencies.at(latencies.size() * 999 / 1000), BenchmarkResults::LowerIsBetter, latencies.size());
+        BenchmarkResults::record(name, "latency max", "us", latencies.last(), BenchmarkResults::LowerIsBetter, latencies.size());
+    }
+    BenchmarkResults::record(name, "churn", "calls/s", operations / seconds, BenchmarkResults::HigherIsBetter, operations);
+    BenchmarkResults::record(name, "churn failures", "calls", failures, BenchmarkResults::LowerIsBetter, operations + failures);
+    BenchmarkResults::write("sensorstress-benchmark");
+
+    emit finished();
+}
+
+static void usage()
+{
+    qDebug("Usage: sensorstress-benchmark [-s sensor] [-c clients] [-w workers]\n"
+           "                              [-t seconds] [-r loadgen rate]");
+}
+
+int main(int argc, char** argv)
+{
+    QCoreApplication app(argc, argv);
+    QStringList args = app.arguments();
+
+    // Churn worker started by the driver: -w <sensor> <seconds>
+    if (args.size() == 4 && args.at(1) == "-w") {
+        ChurnWorker worker(args.at(2));
+        QTimer::singleShot(args.at(3).toInt() * 1000, &worker, SLOT(stop()));
+        QObject::connect(&worker, SIGNAL(finished()), &app, SLOT(quit()));
+        return app.exec();
+    }
+
+    QString sensorId("accelerometersensor");
+    int clients = 2;
+    int workers = 4;
+    int seconds = 20;
+    int rate = 1000;
+    for (int i = 1; i < args.size(); ++i) {
+        if (i + 1 == args.size()) {
+            usage();
+            return 1;
+        }
+        const QString& option = args.at(i);
+        const QString& value = args.at(++i);
+        if (option == "-s")
+            sensorId = value;
+        else if (option == "-c")
+            clients = qMax(1, value.toInt());
+        else if (option == "-w")
+            workers = qMax(0, value.toInt());
+        else if (option == "-t")
+            seconds = qMax(1, value.toInt());
+        else if (option == "-r")
+            rate = qMax(1, value.toInt());
+        else {
+            usage();
+            return 1;
+        }
+    }
+
+    StressDriver driver(sensorId, clients, workers, rate);
+    if (!driver.start(BenchmarkResults::sensordProcessId(), seconds)) {
+        qDebug() << "[StressDriver] No sessions opened for" << sensorId;
+        return 1;
+    }
+
+    // Workers stop themselves after the run time, collect them after that
+    QTimer::singleShot(seconds * 1000 + 500, &driver, SLOT(stop()));
+    QObject::connect(&driver, SIGNAL(finished()), &app, SLOT(quit()));
+
+    int result = app.exec();
+    return result ? result : (driver.passed() ? 0 : 1);
+}
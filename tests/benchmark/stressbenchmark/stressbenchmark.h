@@ -0,0 +1,126 @@
+/**
+   @file stressbenchmark.h
+   @brief Concurrency stress benchmark of the threaded sample path
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+*/
+
+
+#ifndef STRESSBENCHMARK_H
+#define STRESSBENCHMARK_H
+
+#include <QObject>
+#include <QList>
+#include <QProcess>
+#include <QTime>
+#include <QTimer>
+#include "abstractsensor_i.h"
+
+class BenchmarkClient;
+
+/**
+ * Churn worker, run as a child process of the benchmark so that its
+ * D-Bus calls reach sensord concurrently with those of the other workers.
+ * Repeatedly opens a session, changes its interval while it runs and
+ * closes it again, then prints the operation counts on exit.
+ */
+class ChurnWorker : public QObject
+{
+    Q_OBJECT
+public:
+    ChurnWorker(const QString& sensorId, QObject* parent = 0);
+    ~ChurnWorker();
+
+signals:
+    void finished();
+
+public slots:
+    /**
+     * Run one step of the session cycle.
+     */
+    void step();
+
+    /**
+     * Close the session, print the counts and finish.
+     */
+    void stop();
+
+private:
+    QString                         sensorId_;   /**< churned sensor */
+    AbstractSensorChannelInterface* sensor_;     /**< current session or NULL */
+    QTimer                          timer_;      /**< step timer, lets the event loop read the socket */
+    int                             phase_;      /**< position in the session cycle */
+    unsigned long                   operations_; /**< completed calls */
+    unsigned long                   failures_;   /**< failed calls */
+};
+
+/**
+ * Runs stable sessions while churn workers open and close sessions and
+ * change intervals against the same sensor, so that sample handoff
+ * between adaptor threads, SensorManager and the socket handler happens
+ * while session state changes under it. Prints and records throughput,
+ * tail latency and lost samples of the stable sessions and the churn
+ * rate, and fails if sensord dies during the run.
+ *
+ * Meant for sensord configured with loadgenadaptor at a kHz rate; the
+ * rate given with -r is the loadgen_rate used to count lost samples.
+ * A sensord built with <code>CONFIG+=tsan</code> and run with
+ * <code>TSAN_OPTIONS=halt_on_error=1</code> turns any data race in
+ * the exercised paths into a failure of the benchmark.
+ */
+class StressDriver : public QObject
+{
+    Q_OBJECT
+public:
+    StressDriver(const QString& sensorId, int clients, int workers, int rate, QObject* parent = 0);
+    ~StressDriver();
+
+    /**
+     * Start stable sessions and churn workers.
+     *
+     * @param sensordPid sensord process ID for liveness check, 0 to skip.
+     * @param seconds run time of the workers.
+     * @return false if no session could be opened.
+     */
+    bool start(int sensordPid, int seconds);
+
+    /**
+     * Did every worker finish and sensord survive the run.
+     */
+    bool passed() const { return passed_; }
+
+signals:
+    void finished();
+
+public slots:
+    /**
+     * Stop stable sessions, collect worker counts and print the report.
+     */
+    void stop();
+
+private:
+    QString                 sensorId_;   /**< stressed sensor */
+    int                     workers_;    /**< churn worker count */
+    int                     rate_;       /**< adaptor rate in samples per second */
+    QList<BenchmarkClient*> clients_;    /**< stable sessions */
+    QList<QProcess*>        processes_;  /**< churn workers */
+    int                     sensordPid_; /**< sensord process ID */
+    QTime                   started_;    /**< start time */
+    bool                    passed_;     /**< result of the run */
+};
+
+#endif // STRESSBENCHMARK_H
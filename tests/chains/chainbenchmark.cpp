@@ -0,0 +1,253 @@
+/**
+   @file chainbenchmark.cpp
+   @brief End-to-end cost of sensor chains
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+*/
+
+
+#include "chainbenchmark.h"
+#include "benchmarkresults.h"
+#include "sensormanager.h"
+#include "abstractchain.h"
+#include "ringbuffer.h"
+#include "filter.h"
+#include "config.h"
+#include "datatypes/posedata.h"
+#include <QDir>
+#include <QFile>
+#include <math.h>
+#include <time.h>
+
+/** Rounds each stage pushes its input through */
+static const int ROUNDS = 200;
+
+/** Synthetic input length per adaptor */
+static const int SAMPLES = 256;
+
+/** Size of the injection buffers, matching device adaptors */
+static const unsigned INJECTION_BUFFER_SIZE = 1024;
+
+static quint64 nowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+InjectionAdaptor::InjectionAdaptor(const QString& id) :
+    DeviceAdaptor(id)
+{
+    // Buffer names read by accelerometerchain and magcalibrationchain
+    QString name = id.contains("magnetometer") ? "calibratedmagneticfield" : "accelerometer";
+    buffer_ = new DeviceAdaptorRingBuffer<TimedXyzData>(INJECTION_BUFFER_SIZE);
+    setAdaptedSensor(name, "Injected " + name + " samples", buffer_);
+    setDescription("Benchmark input");
+}
+
+InjectionAdaptor::~InjectionAdaptor()
+{
+    delete buffer_;
+}
+
+void InjectionAdaptor::init()
+{
+    introduceAvailableDataRange(DataRange(-65535, 65535, 1));
+    introduceAvailableInterval(DataRange(0, 1000, 0));
+}
+
+/**
+ * Reader counting the output of the measured chain.
+ */
+template <class TYPE>
+class OutputCounter : public RingBufferReader<TYPE>
+{
+public:
+    OutputCounter() : count(0) {}
+
+    void pushNewData()
+    {
+        TYPE chunk[FILTER_BATCH_SIZE];
+        unsigned n;
+        while ((n = this->read(FILTER_BATCH_SIZE, chunk)))
+            count += n;
+    }
+
+    unsigned long count;
+};
+
+/**
+ * Synthetic samples at 100 Hz, a vector turning around all axes.
+ */
+static QVector<TimedXyzData> xyzInput(int amplitude, quint64 start)
+{
+    QVector<TimedXyzData> input(SAMPLES);
+    for (int i = 0; i < SAMPLES; ++i) {
+        double phase = i * 2 * M_PI / SAMPLES;
+        input[i] = TimedXyzData(start + i * 10000,
+                                (int)(amplitude * sin(phase)),
+                                (int)(amplitude * cos(phase)),
+                                (int)(amplitude * sin(2 * phase)));
+    }
+    return input;
+}
+
+/**
+ * Inject input rounds, interleaving the adaptors given.
+ *
+ * @return injected sample count.
+ */
+static unsigned long injectRounds(InjectionAdaptor* accelerometer, InjectionAdaptor* magnetometer, int rounds)
+{
+    static const QVector<TimedXyzData> acceleration = xyzInput(1000, 1000000);
+    static const QVector<TimedXyzData> field = xyzInput(50000, 1000000);
+    unsigned long injected = 0;
+    for (int round = 0; round < rounds; ++round) {
+        for (int i = 0; i < SAMPLES; ++i) {
+            if (accelerometer) {
+                accelerometer->inject(acceleration.at(i));
+                ++injected;
+            }
+            if (magnetometer) {
+                magnetometer->inject(field.at(i));
+                ++injected;
+            }
+        }
+    }
+    return injected;
+}
+
+/**
+ * Measure a chain in stages, see ChainBenchmark.
+ *
+ * @param stages chains in start order, the measured chain last.
+ * @param output output buffer of the measured chain.
+ */
+template <class OUTPUT>
+static void benchmarkChain(const QStringList& stages, const char* output,
+                           InjectionAdaptor* accelerometer, InjectionAdaptor* magnetometer)
+{
+    SensorManager& sm = SensorManager::instance();
+    const QString& name = stages.last();
+
+    // Nothing reads the adaptors yet, this is the cost of injection
+    injectRounds(accelerometer, magnetometer, 1);
+    quint64 start = nowNs();
+    unsigned long injected = injectRounds(accelerometer, magnetometer, ROUNDS);
+    double previous = (double)(nowNs() - start) / injected;
+    qDebug("%s: injection %.1f ns/sample", name.toLocal8Bit().constData(), previous);
+    BenchmarkResults::record(name + " injection", "time", "ns/sample", previous,
+                             BenchmarkResults::LowerIsBetter, injected);
+
+    QList<AbstractChain*> chains;
+    OutputCounter<OUTPUT> counter;
+    double total = 0;
+    double rate = 0;
+    foreach (const QString& stage, stages) {
+        QVERIFY(sm.loadPlugin(stage));
+        AbstractChain* chain = sm.requestChain(stage);
+        QVERIFY2(chain && chain->isValid(), qPrintable(stage + " is not available"));
+        chains.append(chain);
+        if (stage == name) {
+            RingBufferBase* buffer = chain->findBuffer(output);
+            QVERIFY(buffer);
+            QVERIFY(buffer->join(&counter));
+        }
+        QVERIFY(chain->start());
+
+        injectRounds(accelerometer, magnetometer, 1);
+        counter.count = 0;
+        start = nowNs();
+        injected = injectRounds(accelerometer, magnetometer, ROUNDS);
+        quint64 elapsed = nowNs() - start;
+        total = (double)elapsed / injected;
+
+        qDebug("%s: %s %.1f ns/sample", name.toLocal8Bit().constData(),
+               stage.toLocal8Bit().constData(), total - previous);
+        BenchmarkResults::record(name + " " + stage, "time", "ns/sample", total - previous,
+                                 BenchmarkResults::LowerIsBetter, injected);
+        previous = total;
+        rate = elapsed ? counter.count * 1e9 / elapsed : 0;
+    }
+
+    qDebug("%s: total %.1f ns/sample, output %.0f samples/s", name.toLocal8Bit().constData(), total, rate);
+    BenchmarkResults::record(name, "time", "ns/sample", total, BenchmarkResults::LowerIsBetter, injected);
+    BenchmarkResults::record(name, "output rate", "samples/s", rate, BenchmarkResults::HigherIsBetter, counter.count);
+    if (!counter.count)
+        qWarning("%s: no output, the chain filtered all input", name.toLocal8Bit().constData());
+
+    chains.last()->findBuffer(output)->unjoin(&counter);
+    for (int i = chains.size() - 1; i >= 0; --i) {
+        chains.at(i)->stop();
+        sm.releaseChain(stages.at(i));
+    }
+}
+
+void ChainBenchmark::initTestCase()
+{
+    // Chains and filters are loaded on demand so that the device adaptor
+    // plugins are never loaded in place of the injection adaptors
+    QString path = QDir::tempPath() + "/sensorchains-benchmark.conf";
+    QFile config(path);
+    QVERIFY(config.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    config.write("[global]\nlazy_plugin_loading = true\n");
+    config.close();
+    QVERIFY(Config::loadConfig(path, QString()));
+
+    SensorManager& sm = SensorManager::instance();
+    sm.registerDeviceAdaptor<InjectionAdaptor>("accelerometeradaptor");
+    sm.registerDeviceAdaptor<InjectionAdaptor>("magnetometeradaptor");
+    accelerometer_ = qobject_cast<InjectionAdaptor*>(sm.requestDeviceAdaptor("accelerometeradaptor"));
+    magnetometer_ = qobject_cast<InjectionAdaptor*>(sm.requestDeviceAdaptor("magnetometeradaptor"));
+    QVERIFY(accelerometer_);
+    QVERIFY(magnetometer_);
+}
+
+void ChainBenchmark::cleanupTestCase()
+{
+    SensorManager& sm = SensorManager::instance();
+    sm.releaseDeviceAdaptor("accelerometeradaptor");
+    sm.releaseDeviceAdaptor("magnetometeradaptor");
+    BenchmarkResults::write("sensorchains-benchmark");
+    QFile::remove(QDir::tempPath() + "/sensorchains-benchmark.conf");
+}
+
+void ChainBenchmark::benchmarkAccelerometerChain()
+{
+    benchmarkChain<AccelerationData>(QStringList() << "accelerometerchain", "accelerometer",
+                                     accelerometer_, NULL);
+}
+
+void ChainBenchmark::benchmarkMagCalibrationChain()
+{
+    benchmarkChain<CalibratedMagneticFieldData>(QStringList() << "magcalibrationchain", "calibratedmagnetometerdata",
+                                                NULL, magnetometer_);
+}
+
+void ChainBenchmark::benchmarkOrientationChain()
+{
+    benchmarkChain<PoseData>(QStringList() << "accelerometerchain" << "orientationchain", "orientation",
+                             accelerometer_, NULL);
+}
+
+void ChainBenchmark::benchmarkCompassChain()
+{
+    benchmarkChain<CompassData>(QStringList() << "accelerometerchain" << "magcalibrationchain" << "compasschain",
+                                "magneticnorth", accelerometer_, magnetometer_);
+}
+
+QTEST_MAIN(ChainBenchmark)
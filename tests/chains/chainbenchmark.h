@@ -0,0 +1,108 @@
+/**
+   @file chainbenchmark.h
+   @brief End-to-end cost of sensor chains
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+*/
+
+
+#ifndef CHAINBENCHMARK_H
+#define CHAINBENCHMARK_H
+
+#include <QTest>
+#include <QStringList>
+#include "deviceadaptor.h"
+#include "deviceadaptorringbuffer.h"
+#include "datatypes/orientationdata.h"
+
+/**
+ * Adaptor without hardware, samples are written into its buffer by the
+ * benchmark. Registered as accelerometeradaptor and magnetometeradaptor
+ * in place of the device adaptors, with the buffer names the chains
+ * read.
+ */
+class InjectionAdaptor : public DeviceAdaptor
+{
+    Q_OBJECT
+public:
+    static DeviceAdaptor* factoryMethod(const QString& id)
+    {
+        return new InjectionAdaptor(id);
+    }
+
+    bool startAdaptor() { return true; }
+    void stopAdaptor() {}
+
+    bool startSensor() { return true; }
+    void stopSensor() {}
+
+    void init();
+
+    /**
+     * Commit a sample into the adaptor buffer and wake up its readers,
+     * as an adaptor does for each sample it reads.
+     *
+     * @param sample injected sample.
+     */
+    void inject(const TimedXyzData& sample)
+    {
+        *buffer_->nextSlot() = sample;
+        buffer_->commit();
+        buffer_->wakeUpReaders();
+    }
+
+protected:
+    InjectionAdaptor(const QString& id);
+    ~InjectionAdaptor();
+
+private:
+    DeviceAdaptorRingBuffer<TimedXyzData>* buffer_; /**< injected samples */
+};
+
+/**
+ * In-process benchmark of the accelerometer, magnetometer calibration,
+ * orientation and compass chains. Samples are injected into the adaptor
+ * buffers and flow synchronously through the chains, so wall time per
+ * injected sample is the cost of the chain. A chain is measured in
+ * stages: the chains it depends on are started one at a time before
+ * itself, and the cost of a stage is the increase of the total over the
+ * previous stage:
+ *
+ * <pre>QDEBUG : ChainBenchmark::benchmarkCompassChain() compasschain: magcalibrationchain 410.2 ns/sample</pre>
+ *
+ * Output rate is output samples per second of the measured chain at
+ * full speed.
+ */
+class ChainBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void benchmarkAccelerometerChain();
+    void benchmarkMagCalibrationChain();
+    void benchmarkOrientationChain();
+    void benchmarkCompassChain();
+
+private:
+    InjectionAdaptor* accelerometer_; /**< accelerometer input */
+    InjectionAdaptor* magnetometer_;  /**< magnetometer input */
+};
+
+#endif // CHAINBENCHMARK_H
@@ -0,0 +1,22 @@
+QT += dbus network
+
+include(../common-install.pri)
+include(../benchmark/benchmarkresults.pri)
+
+TEMPLATE = app
+TARGET = sensorchains-benchmark
+
+HEADERS += chainbenchmark.h
+SOURCES += chainbenchmark.cpp
+
+INCLUDEPATH += ../../include \
+    ../../chains \
+    ../../core \
+    ../../adaptors \
+    ../../datatypes \
+    ../..
+
+QMAKE_LIBDIR_FLAGS += -L../../builddir/datatypes -L../../datatypes/
+QMAKE_LIBDIR_FLAGS += -L../../builddir/core -L../../core/
+
+include(../../common.pri)
@@ -1,24 +1,5 @@
-QT += dbus network
+TEMPLATE = subdirs
 
-include(../common-install.pri)
-
-TEMPLATE = app
-TARGET = sensorchains-test
-
-CONFIG += testcase
-
-HEADERS += chainstest.h
-SOURCES += chainstest.cpp
-
-INCLUDEPATH += ../../include \
-    ../../chains \
-    ../../core \
-    ../../chains \    
-    ../../adaptors \
-    ../../datatypes \
-    ../..
-
-QMAKE_LIBDIR_FLAGS += -L../../builddir/datatypes -L../../datatypes/
-QMAKE_LIBDIR_FLAGS += -L../../builddir/core -L../../core/
-
-include(../../common.pri)
+SUBDIRS = chainstest chainbenchmark
+chainstest.file = chainstest.pro
+chainbenchmark.file = chainbenchmark.pro
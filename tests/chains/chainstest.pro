@@ -0,0 +1,24 @@
+QT += dbus network
+
+include(../common-install.pri)
+
+TEMPLATE = app
+TARGET = sensorchains-test
+
+CONFIG += testcase
+
+HEADERS += chainstest.h
+SOURCES += chainstest.cpp
+
+INCLUDEPATH += ../../include \
+    ../../chains \
+    ../../core \
+    ../../chains \    
+    ../../adaptors \
+    ../../datatypes \
+    ../..
+
+QMAKE_LIBDIR_FLAGS += -L../../builddir/datatypes -L../../datatypes/
+QMAKE_LIBDIR_FLAGS += -L../../builddir/core -L../../core/
+
+include(../../common.pri)
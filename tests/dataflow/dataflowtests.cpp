@@ -27,7 +27,14 @@
 
 #include <QtDebug>
 #include <QTest>
+#include <QSignalSpy>
 #include <QVariant>
+#include <QThread>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QLocalServer>
+#include <QLocalSocket>
 
 #include <typeinfo>
 #include "sensormanager.h"
@@ -37,13 +44,50 @@
 #include "config.h"
 #include "dataflowtests.h"
 #include "loader.h"
+#include "logging.h"
 #include "plugin.h"
+#include "samplequeue.h"
+#include "sharedring.h"
+#include "compactframe.h"
+#include "spscqueue.h"
+#include "timerwheel.h"
+#include "clockdomain.h"
+#include "clock.h"
+#include "utils.h"
+#include "chainscheduler.h"
+#include "latencytracer.h"
+#include "tracerecorder.h"
+#include "tracearchive.h"
+#include "dataflowgraph.h"
+#include "overloadcontroller.h"
+#include "devicediscovery.h"
+#include "iioadaptor.h"
+#include "deviceadaptorringbuffer.h"
+#include "uringreader.h"
+#include "timestampreconstructor.h"
+#include "source.h"
+#include "sink.h"
+#include "historyring.h"
+#include "rangeconversion.h"
+#include "sessionthreshold.h"
+#include "sockethandler.h"
+#include "sessionstore.h"
+#include "downsamplewindow.h"
+#include "thresholdwindow.h"
+#include "datatypes/atomic.h"
 #include <accelerometeradaptor/accelerometeradaptor.h>
 #include <accelerometerchain/accelerometerchain.h>
 #include <coordinatealignfilter/coordinatealignfilter.h>
 
 #include <stdio.h>
+#include <limits.h>
+#include <string.h>
 #include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <linux/input.h>
 
 void DataFlowTest::initTestCase()
 {
@@ -188,6 +232,1813 @@ void DataFlowTest::testChainSharing()
     sm.releaseChain("accelerometerchain");
     // check that does not exist
 }
+
+void DataFlowTest::testSampleQueue()
+{
+    SampleQueue queue(2);
+    QVERIFY(queue.acquire());
+    QVERIFY(!queue.acquire());
+
+    bool wakeup = false;
+    int first = 1;
+    int second = 2;
+    int third = 3;
+
+    int sessions[SampleQueue::MAX_FANOUT + 1] = { 10, 11, 12 };
+
+    // Only the empty -> non-empty transition requests a wakeup
+    QVERIFY(queue.push(sessions, 1, &first, sizeof(int), wakeup));
+    QVERIFY(wakeup);
+    QVERIFY(queue.push(sessions + 1, 2, &second, sizeof(int), wakeup));
+    QVERIFY(!wakeup);
+
+    // Queue is full
+    QVERIFY(!queue.push(sessions, 1, &third, sizeof(int), wakeup));
+    QCOMPARE(queue.dropCount(), 1u);
+
+    const SampleQueue::Slot* slot = queue.front();
+    QVERIFY(slot);
+    QCOMPARE(slot->sessionCount, 1);
+    QCOMPARE(slot->sessions[0], 10);
+    QCOMPARE(*(const int*)slot->data, first);
+    queue.pop();
+
+    // Sample shared by two sessions occupies single slot
+    slot = queue.front();
+    QVERIFY(slot);
+    QCOMPARE(slot->sessionCount, 2);
+    QCOMPARE(slot->sessions[1], 12);
+    QCOMPARE(*(const int*)slot->data, second);
+    queue.pop();
+    QVERIFY(!queue.front());
+
+    // Oversized samples and too wide fan-out are rejected
+    char big[SampleQueue::MAX_SAMPLE_SIZE + 1];
+    QVERIFY(!queue.push(sessions, 1, big, sizeof(big), wakeup));
+    QVERIFY(!queue.push(sessions, SampleQueue::MAX_FANOUT + 1, &first, sizeof(int), wakeup));
+
+    // Every drop is counted and reported once
+    QCOMPARE(queue.dropCount(), 3u);
+    QCOMPARE(queue.takeDrops(), 3u);
+    QCOMPARE(queue.takeDrops(), 0u);
+    QVERIFY(!queue.push(sessions, 1, big, sizeof(big), wakeup));
+    QCOMPARE(queue.takeDrops(), 1u);
+
+    queue.release();
+    QVERIFY(queue.acquire());
+}
+
+/**
+ * Pushes increasing sequence into a SpscQueue from its own thread.
+ */
+class SequenceProducer : public QThread
+{
+public:
+    SequenceProducer(SpscQueue<int>& queue, int count) : queue_(queue), count_(count) {}
+
+    void run()
+    {
+        bool wakeup;
+        for (int i = 0; i < count_; ) {
+            if (queue_.push(i, wakeup))
+                ++i;
+            else
+                yieldCurrentThread();
+        }
+    }
+
+private:
+    SpscQueue<int>& queue_;
+    int count_;
+};
+
+void DataFlowTest::testSpscQueue()
+{
+    SpscQueue<int> queue(2);
+    bool wakeup = false;
+    int value = 0;
+
+    // Only the empty -> non-empty transition requests a wakeup
+    QVERIFY(queue.push(1, wakeup));
+    QVERIFY(wakeup);
+    QVERIFY(queue.push(2, wakeup));
+    QVERIFY(!wakeup);
+    QVERIFY(!queue.push(3, wakeup));
+    QCOMPARE(queue.dropCount(), 1u);
+
+    QVERIFY(queue.pop(value));
+    QCOMPARE(value, 1);
+    QVERIFY(queue.pop(value));
+    QCOMPARE(value, 2);
+    QVERIFY(!queue.pop(value));
+
+    // Slots filled and consumed in place behave like push() and pop()
+    int* slot = queue.reserve();
+    QVERIFY(slot);
+    *slot = 4;
+    QVERIFY(!queue.front());
+    queue.commit(wakeup);
+    QVERIFY(wakeup);
+    QCOMPARE(queue.depth(), 1u);
+    QVERIFY(queue.reserve());
+    queue.commit(wakeup);
+    QVERIFY(!wakeup);
+    QVERIFY(!queue.reserve());
+    QCOMPARE(queue.dropCount(), 2u);
+    QVERIFY(queue.front());
+    QCOMPARE(*queue.front(), 4);
+    queue.pop();
+    QCOMPARE(queue.depth(), 1u);
+    queue.pop();
+    QVERIFY(!queue.front());
+
+    // Size is rounded up to a power of two, so slots stay in order when
+    // the counters wrap
+    SpscQueue<int> wrapping(3, UINT_MAX - 1);
+    QCOMPARE(wrapping.size(), 4u);
+    for (int i = 0; i < 4; ++i)
+        QVERIFY(wrapping.push(10 + i, wakeup));
+    QVERIFY(!wrapping.push(14, wakeup));
+    QCOMPARE(wrapping.depth(), 4u);
+    for (int i = 0; i < 4; ++i) {
+        QVERIFY(wrapping.pop(value));
+        QCOMPARE(value, 10 + i);
+    }
+    QVERIFY(!wrapping.pop(value));
+    for (int round = 0; round < 3; ++round) {
+        QVERIFY(wrapping.push(20 + round, wakeup));
+        QVERIFY(wakeup);
+        QVERIFY(wrapping.pop(value));
+        QCOMPARE(value, 20 + round);
+    }
+    QCOMPARE(wrapping.depth(), 0u);
+
+    // Values handed over from another thread arrive complete and in order
+    static const int COUNT = 100000;
+    SpscQueue<int> shared(16);
+    SequenceProducer producer(shared, COUNT);
+    producer.start();
+    int expected = 0;
+    bool ordered = true;
+    while (expected < COUNT) {
+        if (shared.pop(value)) {
+            ordered = ordered && (value == expected);
+            ++expected;
+        } else {
+            QThread::yieldCurrentThread();
+        }
+    }
+    QVERIFY(producer.wait());
+    QVERIFY(ordered);
+    QVERIFY(!shared.pop(value));
+}
+
+void DataFlowTest::testSharedRing()
+{
+    SharedRing ring(8 * sizeof(int));
+    QVERIFY(ring.isValid());
+
+    SharedRingReader reader;
+    QVERIFY(reader.attach(dup(ring.fd())));
+    QCOMPARE(reader.available(sizeof(int)), 0u);
+
+    int values[16];
+    for (int i = 0; i < 16; ++i)
+        values[i] = i;
+
+    int out[16];
+    QVERIFY(ring.write(values, sizeof(int), 3));
+    QCOMPARE(reader.read(out, sizeof(int), 16), 3u);
+    QCOMPARE(out[0], 0);
+    QCOMPARE(out[2], 2);
+
+    // Reader fell behind more than whole ring, oldest samples are skipped
+    QVERIFY(ring.write(values + 3, sizeof(int), 12));
+    QCOMPARE(reader.read(out, sizeof(int), 16), 7u);
+    QCOMPARE(out[0], 8);
+    QCOMPARE(out[6], 14);
+
+    // Ring layout is fixed by the first write
+    QVERIFY(!ring.write(values, sizeof(short), 1));
+    QCOMPARE(ring.writeCount(), 15u);
+
+    // Slots are rounded down to a power of two, here 8 of 12 fitting, so
+    // samples keep their slots when the write count wraps
+    SharedRing wrapping(12 * sizeof(int), UINT_MAX - 4);
+    SharedRingReader wrapReader;
+    QVERIFY(wrapReader.attach(dup(wrapping.fd())));
+    QVERIFY(wrapping.write(values, sizeof(int), 8));
+    QCOMPARE(wrapping.writeCount(), 3u);
+    QCOMPARE(wrapReader.read(out, sizeof(int), 16), 7u);
+    for (int i = 0; i < 7; ++i)
+        QCOMPARE(out[i], i + 1);
+    QVERIFY(wrapping.write(values + 8, sizeof(int), 8));
+    QCOMPARE(wrapReader.read(out, sizeof(int), 16), 7u);
+    for (int i = 0; i < 7; ++i)
+        QCOMPARE(out[i], i + 9);
+}
+
+void DataFlowTest::testCompactFrame()
+{
+    TimedXyzData samples[4];
+    memset(samples, 0, sizeof(samples));
+    for (int i = 0; i < 4; ++i) {
+        samples[i].timestamp_ = 1000000000ULL + i * 10000;
+        samples[i].x_ = i * 100;
+        samples[i].y_ = -i;
+        samples[i].z_ = 1 << (15 + i);
+    }
+    // Timestamps may also go backwards
+    samples[3].timestamp_ = 5;
+
+    // Slices as written by SessionData
+    struct iovec slices[2];
+    slices[0].iov_base = samples;
+    slices[0].iov_len = sizeof(TimedXyzData);
+    slices[1].iov_base = samples + 1;
+    slices[1].iov_len = 3 * sizeof(TimedXyzData);
+
+    QByteArray frame;
+    CompactFrame::encode(slices, 2, sizeof(TimedXyzData), 4, frame);
+    CompactFrameHeader header;
+    memcpy(&header, frame.constData(), sizeof(header));
+    QCOMPARE(header.count, 4u);
+    QCOMPARE((int)header.size, (int)sizeof(TimedXyzData));
+    QCOMPARE((int)header.length, frame.size() - (int)sizeof(header));
+    QVERIFY(frame.size() < (int)(sizeof(unsigned int) + sizeof(samples)));
+    // z does not fit in 16 bits
+    QVERIFY(header.narrow & 1);
+    QVERIFY(!(header.narrow & 4));
+
+    TimedXyzData decoded[4];
+    QVERIFY(CompactFrame::decode(header, frame.constData() + sizeof(header), (char*)decoded));
+    QVERIFY(memcmp(samples, decoded, sizeof(samples)) == 0);
+
+    // Truncated frame is rejected
+    header.length -= 1;
+    QVERIFY(!CompactFrame::decode(header, frame.constData() + sizeof(header), (char*)decoded));
+
+    // Samples of other layouts are stored as they are
+    short words[3] = { 1, 2, 3 };
+    slices[0].iov_base = words;
+    slices[0].iov_len = sizeof(words);
+    CompactFrame::encode(slices, 1, sizeof(short), 3, frame);
+    memcpy(&header, frame.constData(), sizeof(header));
+    QCOMPARE((unsigned int)header.length, (unsigned int)sizeof(words));
+    short out[3];
+    QVERIFY(CompactFrame::decode(header, frame.constData() + sizeof(header), (char*)out));
+    QCOMPARE(out[2], (short)3);
+}
+
+/**
+ * Sink recording how many samples it has received and in which order
+ * relative to other sinks.
+ */
+class CountingSink
+{
+public:
+    CountingSink(int* order = 0) :
+        count(0),
+        position(-1),
+        order_(order),
+        sink(this, &CountingSink::collect)
+    {}
+
+    void collect(unsigned n, const TimedXyzData* values)
+    {
+        Q_UNUSED(values);
+        count += n;
+        if (order_ && position < 0)
+            position = (*order_)++;
+    }
+
+    unsigned count;
+    int      position;
+    int*     order_;
+    Sink<CountingSink, TimedXyzData> sink;
+};
+
+/**
+ * Sink joining other sinks to its source and unjoining itself when it
+ * receives samples, changing the topology under propagation.
+ */
+class JoiningSink
+{
+public:
+    JoiningSink(Source<TimedXyzData>* source, const QList<CountingSink*>* joined) :
+        source_(source),
+        joined_(joined),
+        sink(this, &JoiningSink::collect)
+    {}
+
+    void collect(unsigned n, const TimedXyzData* values)
+    {
+        Q_UNUSED(n);
+        Q_UNUSED(values);
+        foreach (CountingSink* joined, *joined_)
+            source_->join(&joined->sink);
+        source_->unjoin(&sink);
+    }
+
+    Source<TimedXyzData>*           source_;
+    const QList<CountingSink*>*     joined_;
+    Sink<JoiningSink, TimedXyzData> sink;
+};
+
+/**
+ * Timer wheel entry recording when it expired.
+ */
+class WheelProbe : public TimerWheel::Entry
+{
+public:
+    WheelProbe() : clock(0), expired(0) {}
+
+    quint64* clock;   /**< time fed to the wheel */
+    quint64  expired; /**< time of expiry, 0 if not expired */
+
+protected:
+    void timeout() { expired = *clock; }
+};
+
+void DataFlowTest::testTimerWheel()
+{
+    TimerWheel wheel;
+    quint64 base = TimerWheel::now();
+    quint64 clock = base;
+
+    // Deadlines on each level of the wheel and beyond it
+    const quint64 delays[] = { 1, 63, 64, 100, 4095, 4096, 70000, 300000 };
+    const int count = sizeof(delays) / sizeof(delays[0]);
+    WheelProbe probes[count];
+    for (int i = 0; i < count; ++i) {
+        probes[i].clock = &clock;
+        wheel.schedule(&probes[i], base + delays[i]);
+    }
+    QCOMPARE(wheel.count(), count);
+
+    WheelProbe cancelled;
+    cancelled.clock = &clock;
+    wheel.schedule(&cancelled, base + 50);
+    wheel.cancel(&cancelled);
+    QVERIFY(!cancelled.isScheduled());
+    QCOMPARE(wheel.count(), count);
+
+    while (wheel.count()) {
+        ++clock;
+        wheel.expire(clock);
+    }
+    for (int i = 0; i < count; ++i)
+        QCOMPARE(probes[i].expired, base + delays[i]);
+    QCOMPARE(cancelled.expired, 0ULL);
+
+    // Equal periods are aligned to the same tick
+    QCOMPARE(TimerWheel::alignedDeadline(1001, 100), 1100ULL);
+    QCOMPARE(TimerWheel::alignedDeadline(1099, 100), 1100ULL);
+    QCOMPARE(TimerWheel::alignedDeadline(1100, 100), 1200ULL);
+
+    // Entries due in the same tick expire in one pass
+    WheelProbe first;
+    WheelProbe second;
+    first.clock = &clock;
+    second.clock = &clock;
+    wheel.schedule(&first, clock + 10);
+    wheel.schedule(&second, clock + 10);
+    clock += 20;
+    QCOMPARE(wheel.expire(clock), 2);
+    QCOMPARE(first.expired, clock);
+    QCOMPARE(second.expired, clock);
+}
+
+void DataFlowTest::testVirtualClock()
+{
+    VirtualClock virtualClock;
+    Clock::setInstance(&virtualClock);
+    quint64 start = TimerWheel::now();
+
+    // Wheel timer follows the virtual clock, no event loop needed
+    TimerWheel wheel;
+    quint64 clock = 0;
+    WheelProbe probe;
+    probe.clock = &clock;
+    wheel.schedule(&probe, start + 100);
+    virtualClock.advance(50000);
+    QVERIFY(probe.isScheduled());
+    clock = 1;
+    virtualClock.advance(60000);
+    QVERIFY(!probe.isScheduled());
+    QCOMPARE(probe.expired, 1ULL);
+
+    // Periodic timer fires once per elapsed interval
+    ClockTimer timer;
+    QSignalSpy spy(&timer, SIGNAL(timeout()));
+    timer.start(10);
+    virtualClock.advance(35000);
+    QCOMPARE(spy.count(), 3);
+    timer.setSingleShot(true);
+    timer.start(10);
+    virtualClock.advance(100000);
+    QCOMPARE(spy.count(), 4);
+    QVERIFY(!timer.isActive());
+
+    QCOMPARE(TimerWheel::now(), start + 245);
+    Clock::setInstance(0);
+}
+
+void DataFlowTest::testClockDomain()
+{
+    QCOMPARE(ClockDomain::toMonotonic(ClockDomain::Monotonic, 12345ULL), 12345ULL);
+    QCOMPARE(ClockDomain::offset(ClockDomain::Monotonic), 0LL);
+
+    // Current wall clock time converts to current monotonic time
+    struct timespec real;
+    clock_gettime(CLOCK_REALTIME, &real);
+    quint64 converted = ClockDomain::toMonotonic(ClockDomain::Realtime, real.tv_sec * 1000000ULL + real.tv_nsec / 1000);
+    quint64 monotonic = Utils::getTimeStamp();
+    QVERIFY(converted <= monotonic + 1000 && converted + 1000 >= monotonic);
+
+    // Offsets are cached, conversion is exact for equal inputs
+    QCOMPARE(ClockDomain::toMonotonic(ClockDomain::Boottime, 5000000000ULL),
+             ClockDomain::toMonotonic(ClockDomain::Boottime, 5000000000ULL));
+
+    // Stamps before the monotonic epoch are clamped
+    QCOMPARE(ClockDomain::toMonotonic(ClockDomain::Realtime, 1ULL), 0ULL);
+
+    QCOMPARE(ClockDomain::clockFromString("boottime", ClockDomain::Monotonic), ClockDomain::Boottime);
+    QCOMPARE(ClockDomain::clockFromString("realtime", ClockDomain::Monotonic), ClockDomain::Realtime);
+}
+
+void DataFlowTest::testPropagate()
+{
+    Source<TimedXyzData> source;
+    int order = 0;
+    CountingSink first(&order);
+    CountingSink second(&order);
+    CountingSink third(&order);
+
+    QVERIFY(source.join(&third.sink));
+    QVERIFY(source.join(&first.sink));
+    QVERIFY(source.join(&second.sink));
+    // Joining twice does not duplicate delivery
+    QVERIFY(source.join(&first.sink));
+
+    TimedXyzData data[2];
+    source.propagate(2, data);
+    QCOMPARE(first.count, 2u);
+    QCOMPARE(second.count, 2u);
+    QCOMPARE(third.count, 2u);
+
+    // Sinks are called in join order
+    QCOMPARE(third.position, 0);
+    QCOMPARE(first.position, 1);
+    QCOMPARE(second.position, 2);
+
+    QVERIFY(source.unjoin(&first.sink));
+    source.propagate(1, data);
+    QCOMPARE(first.count, 2u);
+    QCOMPARE(second.count, 3u);
+    QCOMPARE(third.count, 3u);
+
+    // Sinks joined during propagation, enough to grow the vector, get
+    // samples from the next batch on; the unjoined sink gets no more
+    Source<TimedXyzData> changing;
+    QList<CountingSink*> late;
+    for (int i = 0; i < 16; ++i)
+        late.append(new CountingSink);
+    JoiningSink joining(&changing, &late);
+    CountingSink after;
+    QVERIFY(changing.join(&joining.sink));
+    QVERIFY(changing.join(&after.sink));
+    changing.propagate(1, data);
+    QCOMPARE(after.count, 1u);
+    QCOMPARE(late.first()->count, 0u);
+    changing.propagate(1, data);
+    QCOMPARE(after.count, 2u);
+    foreach (CountingSink* sink, late)
+        QCOMPARE(sink->count, 1u);
+    qDeleteAll(late);
+}
+
+void DataFlowTest::benchmarkPropagate_data()
+{
+    QTest::addColumn<int>("sinkCount");
+    QTest::newRow("1 sink") << 1;
+    QTest::newRow("4 sinks") << 4;
+    QTest::newRow("16 sinks") << 16;
+}
+
+void DataFlowTest::benchmarkPropagate()
+{
+    QFETCH(int, sinkCount);
+
+    Source<TimedXyzData> source;
+    QList<CountingSink*> sinks;
+    for (int i = 0; i < sinkCount; ++i) {
+        sinks.append(new CountingSink);
+        source.join(&sinks.last()->sink);
+    }
+
+    TimedXyzData data(0, 1, 2, 3);
+    QBENCHMARK {
+        source.propagate(1, &data);
+    }
+
+    QVERIFY(sinks.first()->count > 0);
+    qDeleteAll(sinks);
+}
+
+void DataFlowTest::testRingBufferPassThrough()
+{
+    Source<TimedXyzData> source;
+    RingBuffer<TimedXyzData> buffer(4);
+    BufferReader<TimedXyzData> first(2);
+    BufferReader<TimedXyzData> second(2);
+    CountingSink firstSink;
+    CountingSink secondSink;
+
+    Bin bin;
+    bin.add(&buffer, "buffer");
+    bin.add(&first, "first");
+    QVERIFY(source.join(buffer.sink("sink")));
+    QVERIFY(first.source("source")->join(&firstSink.sink));
+    QVERIFY(second.source("source")->join(&secondSink.sink));
+    QVERIFY(buffer.join(&first));
+    bin.start();
+
+    // Single reader gets whole write directly, larger than the ring
+    TimedXyzData data[6];
+    source.propagate(6, data);
+    QCOMPARE(firstSink.count, 6u);
+
+    // Second reader makes the buffer buffer again
+    QVERIFY(buffer.join(&second));
+    source.propagate(3, data);
+    QCOMPARE(firstSink.count, 9u);
+    QCOMPARE(secondSink.count, 3u);
+
+    QVERIFY(buffer.unjoin(&second));
+    source.propagate(2, data);
+    QCOMPARE(firstSink.count, 11u);
+    QCOMPARE(secondSink.count, 3u);
+
+    bin.stop();
+}
+
+void DataFlowTest::testDecimatingReader()
+{
+    Source<TimedXyzData> source;
+    RingBuffer<TimedXyzData> buffer(32);
+    DecimatingReader<TimedXyzData> reader(4, 10);
+    CountingSink sink;
+
+    Bin bin;
+    bin.add(&buffer, "buffer");
+    bin.add(&reader, "reader");
+    QVERIFY(source.join(buffer.sink("sink")));
+    QVERIFY(reader.source("source")->join(&sink.sink));
+    QVERIFY(buffer.join(&reader));
+    bin.start();
+
+    // 500 Hz source, one sample per 10 ms gets through
+    TimedXyzData data[20];
+    for (int i = 0; i < 20; ++i)
+        data[i].timestamp_ = i * 2000;
+    source.propagate(20, data);
+    QCOMPARE(sink.count, 4u);
+
+    // Without interval every sample gets through
+    reader.setInterval(0);
+    source.propagate(3, data);
+    QCOMPARE(sink.count, 7u);
+
+    bin.stop();
+}
+
+void DataFlowTest::testDemand()
+{
+    Source<TimedXyzData> source;
+    RingBuffer<TimedXyzData> buffer(8);
+    BufferReader<TimedXyzData> reader(4);
+    CountingSink sink;
+
+    Bin bin;
+    bin.add(&buffer, "buffer");
+    bin.add(&reader, "reader");
+    QVERIFY(source.join(buffer.sink("sink")));
+    QVERIFY(reader.source("source")->join(&sink.sink));
+    QVERIFY(buffer.join(&reader));
+    bin.start();
+
+    TimedXyzData data[3];
+    source.propagate(3, data);
+    QCOMPARE(sink.count, 3u);
+    QVERIFY(buffer.demanded());
+
+    // Stopped bin has no consumers, the buffer is skipped
+    bin.stop();
+    QVERIFY(!reader.demanded());
+    QVERIFY(!buffer.demanded());
+    QVERIFY(!source.demanded());
+    source.propagate(3, data);
+    QCOMPARE(buffer.written(), 3u);
+
+    // Restarted reader gets new data only
+    bin.start();
+    QVERIFY(buffer.demanded());
+    source.propagate(2, data);
+    QCOMPARE(sink.count, 5u);
+
+    bin.stop();
+}
+
+void DataFlowTest::testDataflowGraph()
+{
+    Source<TimedXyzData> source;
+    RingBuffer<TimedXyzData> buffer(8);
+    BufferReader<TimedXyzData> reader(4);
+    CountingSink sink;
+
+    Bin bin;
+    bin.add(&buffer, "buffer");
+    bin.add(&reader, "reader");
+    QVERIFY(source.join(buffer.sink("sink")));
+    QVERIFY(reader.source("source")->join(&sink.sink));
+    QVERIFY(buffer.join(&reader));
+    bin.start();
+
+    TimedXyzData data[3];
+    source.propagate(3, data);
+    source.propagate(3, data);
+
+    DataflowGraph graph;
+    bin.describe(graph, "test");
+    graph.build();
+    QCOMPARE(graph.edges().size(), 2);
+
+    // Reader was added before the buffer, so its edge to the sink is first
+    const DataflowGraph::Edge& read = graph.edges().at(1);
+    QCOMPARE(read.samples, 6u);
+    QCOMPARE(read.batches, 2u);
+    QCOMPARE(read.occupancy, 0);
+    QCOMPARE(read.capacity, 8u);
+    QVERIFY(read.rate < 0);
+    const DataflowGraph::Edge& push = graph.edges().at(0);
+    QCOMPARE(push.samples, 6u);
+    QCOMPARE(push.source, QString("source"));
+    QVERIFY(graph.toDot().contains("test/buffer"));
+    QVERIFY(graph.toJson().contains("\"name\":\"test/reader\""));
+
+    // Rates are measured against the previous snapshot
+    source.propagate(3, data);
+    DataflowGraph next;
+    bin.describe(next, "test");
+    next.build();
+    next.measure(graph.samples(), 1000000);
+    QCOMPARE(next.edges().at(0).rate, 3.0);
+    QCOMPARE(next.edges().at(1).rate, 3.0);
+
+    bin.stop();
+}
+
+void DataFlowTest::testOverloadController()
+{
+    OverloadController controller;
+    QSignalSpy spy(&controller, SIGNAL(levelChanged(int, int)));
+    controller.addSession(1, 5);
+    controller.addSession(2, 0);
+    controller.addSession(3, 10);
+
+    // Lowest priority is degraded to the highest level before the next one
+    for (int i = 0; i < 4; ++i)
+        controller.update(90, 0);
+    QVERIFY(controller.overloaded());
+    QCOMPARE(spy.count(), 4);
+    QCOMPARE(controller.level(2), 4);
+    QCOMPARE(controller.level(1), 0);
+    controller.update(0, 100);
+    QCOMPARE(controller.level(1), 1);
+    QCOMPARE(spy.last().at(0).toInt(), 1);
+    QCOMPARE(spy.last().at(1).toInt(), 1);
+
+    // Protected session is never degraded
+    for (int i = 0; i < 10; ++i)
+        controller.update(90, 0);
+    QCOMPARE(controller.level(1), 4);
+    QCOMPARE(controller.level(3), 0);
+
+    // Load near the threshold does not restore anything
+    spy.clear();
+    for (int i = 0; i < 10; ++i)
+        controller.update(40, 0);
+    QVERIFY(!controller.overloaded());
+    QCOMPARE(spy.count(), 0);
+
+    // Highest priority is restored first after the calm checks
+    for (int i = 0; i < 5; ++i)
+        controller.update(0, 0);
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(controller.level(1), 3);
+    QCOMPARE(controller.level(2), 4);
+
+    // Session which becomes protected is restored at once
+    controller.setPriority(2, 10);
+    QCOMPARE(controller.level(2), 0);
+    QCOMPARE(spy.last().at(0).toInt(), 2);
+    QCOMPARE(spy.last().at(1).toInt(), 0);
+}
+
+/**
+ * Write a sysfs attribute of the fake device tree.
+ */
+static void writeAttribute(const QString& path, const QByteArray& value)
+{
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    file.write(value);
+}
+
+/**
+ * Remove the fake device tree.
+ */
+static void removeTree(const QString& path)
+{
+    QDir dir(path);
+    foreach (const QFileInfo& info, dir.entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot)) {
+        if (info.isDir())
+            removeTree(info.filePath());
+        else
+            dir.remove(info.fileName());
+    }
+    dir.rmdir(path);
+}
+
+void DataFlowTest::testDeviceDiscovery()
+{
+    QString root = QDir::tempPath() + "/sensordataflow-test-sysfs";
+    removeTree(root);
+    writeAttribute(root + "/input/event2/device/name", "LIS3DH Accelerometer\n");
+    writeAttribute(root + "/input/event2/device/capabilities/ev", "9\n");
+    writeAttribute(root + "/input/event2/device/capabilities/abs", "7\n");
+    writeAttribute(root + "/input/event0/device/name", "gpio-keys\n");
+    writeAttribute(root + "/input/event0/device/capabilities/ev", "3\n");
+    writeAttribute(root + "/iio/iio:device0/name", "bmi160_gyro\n");
+    QDir().mkpath(root + "/iio/trigger0");
+
+    DeviceDiscovery discovery(root + "/input", root + "/iio");
+    QSignalSpy added(&discovery, SIGNAL(deviceAdded(DiscoveredDevice)));
+    QSignalSpy removed(&discovery, SIGNAL(deviceRemoved(DiscoveredDevice)));
+    QCOMPARE(discovery.count(), 3);
+
+    QList<DiscoveredDevice> devices = discovery.find(DiscoveredDevice::Input, "accelerometer");
+    QCOMPARE(devices.size(), 1);
+    QCOMPARE(devices.at(0).number, 2);
+    QCOMPARE(devices.at(0).node, QString("/dev/input/event2"));
+    QVERIFY(devices.at(0).hasEvent(EV_ABS));
+    QVERIFY(devices.at(0).hasAbs(ABS_Z));
+    QVERIFY(!devices.at(0).hasAbs(ABS_RX));
+    QCOMPARE(discovery.find(DiscoveredDevice::Input, QString()).at(0).number, 0);
+    QCOMPARE(discovery.find(DiscoveredDevice::Iio, "gyro").at(0).entry, QString("iio:device0"));
+
+    // Device attached after the scan is indexed from its uevent
+    writeAttribute(root + "/input/event11/device/name", "USB Accelerometer\n");
+    static const char ATTACH[] = "add@/devices/usb/input/input11/event11\0ACTION=add\0"
+                                 "SUBSYSTEM=input\0DEVNAME=input/event11";
+    discovery.handleUevent(QByteArray(ATTACH, sizeof(ATTACH)));
+    QCOMPARE(added.count(), 1);
+    devices = discovery.find(DiscoveredDevice::Input, "accelerometer");
+    QCOMPARE(devices.size(), 2);
+    QCOMPARE(devices.at(1).number, 11);
+
+    // Events of other devices are ignored
+    static const char PARENT[] = "add@/devices/usb/input/input11\0ACTION=add\0SUBSYSTEM=input";
+    discovery.handleUevent(QByteArray(PARENT, sizeof(PARENT)));
+    QCOMPARE(added.count(), 1);
+
+    static const char DETACH[] = "remove@/devices/usb/input/input11/event11\0ACTION=remove\0"
+                                 "SUBSYSTEM=input\0DEVNAME=input/event11";
+    discovery.handleUevent(QByteArray(DETACH, sizeof(DETACH)));
+    QCOMPARE(removed.count(), 1);
+    QCOMPARE(discovery.count(), 3);
+
+    removeTree(root);
+}
+
+void DataFlowTest::testUringReader()
+{
+    UringReader reader;
+    QVERIFY(!reader.open(QVector<int>(), 64));
+    QVERIFY(!reader.isOpen());
+
+    QString path = QDir::tempPath() + "/sensordataflow-test.uring";
+    writeAttribute(path, "12 -34 56\n");
+    int fd = ::open(path.toLocal8Bit().constData(), O_RDONLY);
+    QVERIFY(fd >= 0);
+    QVector<int> fds;
+    fds << fd << fd;
+    // Without io_uring support the caller reads the files itself
+    if (reader.open(fds, 8)) {
+        for (int i = 0; i < 2; ++i) {
+            QVERIFY(reader.readAll());
+            QCOMPARE(reader.result(0), 7);
+            QCOMPARE(QByteArray(reader.data(1), reader.result(1)), QByteArray("12 -34 "));
+        }
+        reader.close();
+    }
+    ::close(fd);
+    QFile::remove(path);
+}
+
+void DataFlowTest::testTimestampReconstructor()
+{
+    TimestampReconstructor timestamps;
+    timestamps.setPeriod(10000);
+    quint64 stamps[8];
+
+    // First burst is placed back from its read time
+    timestamps.reconstruct(1000000, 4, stamps);
+    QCOMPARE(stamps[0], (quint64)970000);
+    QCOMPARE(stamps[3], (quint64)1000000);
+
+    // Device clock 2% slow, bursts read on time
+    quint64 end = 1000000;
+    for (int burst = 0; burst < 100; ++burst) {
+        end += 8 * 10200;
+        timestamps.reconstruct(end, 8, stamps);
+        for (int i = 1; i < 8; ++i)
+            QVERIFY(stamps[i] > stamps[i - 1]);
+        QVERIFY(stamps[7] <= end);
+    }
+    QVERIFY(timestamps.estimatedPeriod() >= 10150 && timestamps.estimatedPeriod() <= 10250);
+    QVERIFY(end - stamps[7] < 100);
+
+    // After a gap the burst is placed back from the read time again
+    end += 1000000;
+    timestamps.reconstruct(end, 2, stamps);
+    QCOMPARE(stamps[1], end);
+    QVERIFY(stamps[1] - stamps[0] >= 10150 && stamps[1] - stamps[0] <= 10250);
+
+    // Single samples keep their read time
+    timestamps.reconstruct(end + 10000, 1, stamps);
+    QCOMPARE(stamps[0], end + 10000);
+}
+
+/**
+ * Ring buffer reader which is read explicitly by the test.
+ */
+class PollingReader : public RingBufferReader<int>
+{
+public:
+    using RingBufferReader<int>::read;
+    void pushNewData() {}
+};
+
+void DataFlowTest::testRingBufferWrap()
+{
+    // Capacity is rounded up to four
+    RingBuffer<int> buffer(3);
+    PollingReader reader;
+    QVERIFY(buffer.join(&reader));
+
+    Source<int> source;
+    QVERIFY(source.join(buffer.sink("sink")));
+
+    int values[6] = { 1, 2, 3, 4, 5, 6 };
+    int out[8];
+    source.propagate(3, values);
+    QCOMPARE(reader.read(2, out), 2u);
+    QCOMPARE(out[1], 2);
+
+    // Write wraps around the end of the ring, read in one go
+    source.propagate(3, values + 3);
+    QCOMPARE(reader.read(8, out), 4u);
+    QCOMPARE(out[0], 3);
+    QCOMPARE(out[1], 4);
+    QCOMPARE(out[3], 6);
+    QCOMPARE(reader.read(8, out), 0u);
+
+    // Oversized write keeps the newest objects
+    source.propagate(6, values);
+    QCOMPARE(reader.read(8, out), 4u);
+    QCOMPARE(out[0], 3);
+    QCOMPARE(out[3], 6);
+}
+
+void DataFlowTest::testRingBufferStatistics()
+{
+    RingBuffer<int> buffer(4);
+    PollingReader reader;
+    QVERIFY(buffer.join(&reader));
+
+    Source<int> source;
+    QVERIFY(source.join(buffer.sink("sink")));
+
+    // Writer laps the reader by two objects
+    int values[6] = { 1, 2, 3, 4, 5, 6 };
+    int out[8];
+    source.propagate(6, values);
+    QCOMPARE(buffer.written(), 6u);
+    QCOMPARE(reader.read(8, out), 4u);
+    QCOMPARE(buffer.delivered(), 4u);
+    QCOMPARE(buffer.overwritten(), 2u);
+    QCOMPARE(buffer.processingTime().count(), 1u);
+    QCOMPARE(reader.lost(), 2u);
+    QCOMPARE(buffer.maxLost(), 2u);
+
+    // Reader joining later has lost nothing
+    PollingReader late;
+    QVERIFY(buffer.join(&late));
+    source.propagate(2, values);
+    QCOMPARE(late.read(8, out), 2u);
+    QCOMPARE(late.lost(), 0u);
+    QCOMPARE(buffer.maxLost(), 2u);
+
+    LatencyHistogram histogram;
+    QCOMPARE(histogram.percentile(50), 0ull);
+    for (int i = 0; i < 99; ++i)
+        histogram.record(1000);
+    histogram.record(1000000);
+    QCOMPARE(histogram.count(), 100u);
+    QCOMPARE(histogram.percentile(50), 1024ull);
+    QCOMPARE(histogram.percentile(99), 1024ull);
+    QCOMPARE(histogram.percentile(100), 1048576ull);
+    histogram.reset();
+    QCOMPARE(histogram.count(), 0u);
+}
+
+void DataFlowTest::testLatencyTracer()
+{
+    LatencyTracer tracer;
+    QVERIFY(tracer.probe("test", LatencyTracer::ChainStage) == NULL);
+    QVERIFY(tracer.start(false));
+    LatencyProbe* probe = tracer.probe("test", LatencyTracer::ChainStage);
+    QVERIFY(probe != NULL);
+    QVERIFY(tracer.probe("test", LatencyTracer::ChainStage) == probe);
+    QVERIFY(tracer.probe("test", LatencyTracer::SocketStage) != probe);
+
+    RingBuffer<TimedXyzData> buffer(4);
+    buffer.setLatencyProbe(probe);
+    Source<TimedXyzData> source;
+    QVERIFY(source.join(buffer.sink("sink")));
+
+    // Samples stamped a millisecond ago
+    quint64 stamp = LatencyHistogram::now() / 1000 - 1000;
+    TimedXyzData samples[3] = { TimedXyzData(stamp, 1, 2, 3),
+                                TimedXyzData(stamp, 4, 5, 6),
+                                TimedXyzData(stamp, 7, 8, 9) };
+    source.propagate(3, samples);
+    QCOMPARE(probe->histogram().count(), 3u);
+    QVERIFY(probe->histogram().percentile(50) >= 1000000ull);
+
+    // Objects without timestamp are not traced
+    RingBuffer<int> ints(4);
+    ints.setLatencyProbe(probe);
+    Source<int> intSource;
+    QVERIFY(intSource.join(ints.sink("sink")));
+    int value = 1;
+    intSource.propagate(1, &value);
+    QCOMPARE(probe->histogram().count(), 3u);
+
+    QStringList output;
+    tracer.statistics(output);
+    QCOMPARE(output.size(), 1);
+    QVERIFY(output.at(0).contains("test chain: 3 sample(s)"));
+}
+
+/**
+ * Ring buffer reader recording the thread it is run in.
+ */
+class ThreadRecordingReader : public RingBufferReader<int>
+{
+public:
+    ThreadRecordingReader() : thread_(0), sum_(0) {}
+
+    void pushNewData()
+    {
+        thread_ = QThread::currentThread();
+        int values[8];
+        unsigned n;
+        while ((n = read(8, values)) > 0) {
+            for (unsigned i = 0; i < n; ++i)
+                sum_.fetchAndAddOrdered(values[i]);
+        }
+    }
+
+    QThread* thread_;
+    QAtomicInt sum_;
+};
+
+void DataFlowTest::testChainScheduler()
+{
+    ChainScheduler scheduler;
+    QVERIFY(!scheduler.isEnabled());
+    QVERIFY(!scheduler.workerFor("adaptor"));
+    QVERIFY(scheduler.start(2));
+    QVERIFY(!scheduler.start(2));
+
+    // Chains of one adaptor share the home worker
+    ChainWorker* home = scheduler.workerFor("adaptor");
+    QVERIFY(home);
+    QCOMPARE(scheduler.workerFor("adaptor"), home);
+    QVERIFY(scheduler.workerFor("other") != home);
+
+    RingBuffer<int> buffer(16);
+    RingBufferBase& base = buffer;
+    base.setPassThrough(true);
+    ChainStrand strand("test", home);
+    ThreadRecordingReader reader;
+    reader.setStrand(&strand);
+    strand.add(&reader);
+    QVERIFY(buffer.join(&reader));
+
+    Source<int> source;
+    QVERIFY(source.join(buffer.sink("sink")));
+
+    // Strand readers are not used for pass-through and run on a worker
+    int values[3] = { 1, 2, 3 };
+    source.propagate(3, values);
+    source.propagate(3, values);
+    QTRY_COMPARE(Atomic::load(reader.sum_), 12);
+    QVERIFY(reader.thread_ && reader.thread_ != QThread::currentThread());
+    QVERIFY(strand.runs() >= 1 && strand.runs() <= 2);
+    QCOMPARE(reader.unread(), 0u);
+
+    strand.remove(&reader);
+    QVERIFY(buffer.unjoin(&reader));
+    scheduler.stop();
+    QVERIFY(!scheduler.isEnabled());
+}
+
+void DataFlowTest::testTraceRecorder()
+{
+    QString path = QDir::tempPath() + "/sensordataflow-test.trace";
+    RingBuffer<TimedXyzData> buffer(16);
+    Source<TimedXyzData> source;
+    QVERIFY(source.join(buffer.sink("sink")));
+
+    // Four records per file, the previous file is kept as path.1
+    TraceRecorder recorder(path, 4, 2);
+    QVERIFY(recorder.start(&buffer));
+    QVERIFY(!recorder.start(&buffer));
+    for (int i = 0; i < 10; ++i) {
+        TimedXyzData sample(i + 1, i, -i, 2 * i);
+        source.propagate(1, &sample);
+    }
+    QTRY_COMPARE(recorder.recorded(), 10u);
+    recorder.stop();
+    QCOMPARE(recorder.dropped(), 0u);
+    QCOMPARE(recorder.rotations(), 2u);
+
+    SensorTrace trace;
+    QVERIFY(trace.open(path));
+    QCOMPARE(trace.count(), 2u);
+    QCOMPARE(trace.at(0).timestamp, (quint64)9);
+    QCOMPARE(trace.at(1).z, 18);
+    QVERIFY(trace.open(path + ".1"));
+    QCOMPARE(trace.count(), 4u);
+    QCOMPARE(trace.at(0).timestamp, (quint64)5);
+    QCOMPARE(trace.at(3).y, -7);
+    trace.close();
+
+    QFile::remove(path);
+    QFile::remove(path + ".1");
+}
+
+void DataFlowTest::testTraceArchive()
+{
+    QString path = QDir::tempPath() + "/sensordataflow-test.archive";
+    TraceArchiveWriter writer;
+    QVERIFY(writer.open(path, 64));
+    for (int i = 0; i < 200; ++i)
+        QVERIFY(writer.append(1000000 + i * 10000ULL, i, -1000 * i, (i & 1) ? INT_MAX : INT_MIN));
+
+    // Readers reject archives whose index is not written yet
+    TraceArchive archive;
+    QVERIFY(!archive.open(path));
+    QVERIFY(writer.close());
+
+    QVERIFY(TraceArchive::probe(path));
+    QVERIFY(archive.open(path));
+    QCOMPARE(archive.count(), 200u);
+    QCOMPARE(archive.blockSize(), 64u);
+    QCOMPARE(archive.blockCount(), 4u);
+    QCOMPARE(archive.block(3).count, 8u);
+    QCOMPARE(archive.block(1).firstTimestamp, (quint64)1640000);
+    QVERIFY(QFileInfo(path).size() < 200 * (qint64)sizeof(SensorTraceRecord));
+
+    // Blocks are found by time without decoding
+    QCOMPARE(archive.findBlock(0), 0u);
+    QCOMPARE(archive.findBlock(1000000 + 70 * 10000ULL), 1u);
+    QCOMPARE(archive.findBlock(1000000 + 200 * 10000ULL), 4u);
+
+    SensorTraceRecord records[64];
+    QVERIFY(archive.decode(1, records));
+    QCOMPARE(records[6].timestamp, (quint64)1700000);
+    QCOMPARE(records[6].x, 70);
+    QCOMPARE(records[6].y, -70000);
+    QCOMPARE(records[6].z, INT_MIN);
+    QCOMPARE(records[7].z, INT_MAX);
+    QVERIFY(archive.decode(3, records));
+    QCOMPARE(records[7].x, 199);
+    archive.close();
+
+    QFile::remove(path);
+}
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+typedef QtMessageHandler MessageHandler;
+
+static void discardMessage(QtMsgType, const QMessageLogContext&, const QString&)
+{
+}
+
+static MessageHandler installMessageHandler(MessageHandler handler)
+{
+    return qInstallMessageHandler(handler);
+}
+#else
+typedef QtMsgHandler MessageHandler;
+
+static void discardMessage(QtMsgType, const char*)
+{
+}
+
+static MessageHandler installMessageHandler(MessageHandler handler)
+{
+    return qInstallMsgHandler(handler);
+}
+#endif
+
+struct HistorySample
+{
+    quint64 timestamp;
+    quint64 value;
+};
+
+void DataFlowTest::testHistoryRing()
+{
+    HistoryRing ring(3);
+    QCOMPARE(ring.capacity(), 4u);
+
+    QByteArray samples;
+    int size = 0;
+    QCOMPARE(ring.window(0, samples, size), 0u);
+
+    // Single writes wrap around, only the newest capacity samples remain
+    for (quint64 i = 1; i <= 10; ++i) {
+        HistorySample sample = { i * 100, i };
+        ring.write(&sample, sizeof(sample), 1);
+    }
+    QCOMPARE(ring.window(0, samples, size), 4u);
+    QCOMPARE(size, (int)sizeof(HistorySample));
+    const HistorySample* window = (const HistorySample*)samples.constData();
+    for (unsigned int i = 0; i < 4; ++i)
+        QCOMPARE(window[i].value, 7ULL + i);
+
+    // Window starts at the first sample at or after the given time
+    QCOMPARE(ring.window(850, samples, size), 2u);
+    window = (const HistorySample*)samples.constData();
+    QCOMPARE(window[0].timestamp, 900ULL);
+    QCOMPARE(window[1].timestamp, 1000ULL);
+    QCOMPARE(ring.window(1001, samples, size), 0u);
+
+    // Batch crossing the end of the slots keeps its order
+    HistorySample batch[6];
+    for (unsigned int i = 0; i < 3; ++i) {
+        batch[i].timestamp = 1100 + i * 100;
+        batch[i].value = 11 + i;
+    }
+    ring.write(batch, sizeof(HistorySample), 3);
+    QCOMPARE(ring.window(0, samples, size), 4u);
+    window = (const HistorySample*)samples.constData();
+    for (unsigned int i = 0; i < 4; ++i)
+        QCOMPARE(window[i].value, 10ULL + i);
+
+    // Batch longer than the ring leaves its newest samples
+    for (unsigned int i = 0; i < 6; ++i) {
+        batch[i].timestamp = 1400 + i * 100;
+        batch[i].value = 14 + i;
+    }
+    ring.write(batch, sizeof(HistorySample), 6);
+    QCOMPARE(ring.window(0, samples, size), 4u);
+    window = (const HistorySample*)samples.constData();
+    QCOMPARE(window[0].value, 16ULL);
+    QCOMPARE(window[3].value, 19ULL);
+
+    // Samples without room for a timestamp are ignored
+    ring.write(batch, 4, 1);
+    QCOMPARE(ring.window(0, samples, size), 4u);
+
+    ring.clear();
+    QCOMPARE(ring.window(0, samples, size), 0u);
+
+    // Changed sample size drops the old samples
+    ring.write(batch, sizeof(HistorySample), 2);
+    quint64 wide[3] = { 2000, 1, 2 };
+    ring.write(wide, sizeof(wide), 1);
+    QCOMPARE(ring.window(0, samples, size), 1u);
+    QCOMPARE(size, (int)sizeof(wide));
+    QCOMPARE(((const quint64*)samples.constData())[2], 2ULL);
+}
+
+void DataFlowTest::testRangeConversion()
+{
+    DataRange active(-8000, 8000, 1);
+
+    // Active range and ranges covering it at its resolution pass samples
+    QVERIFY(!RangeConversion::between(active, active).active);
+    QVERIFY(!RangeConversion::between(active, DataRange(-16000, 16000, 1)).active);
+    QVERIFY(!RangeConversion::between(active, DataRange(100, -100, 1)).active);
+
+    // Narrower range clamps to the whole values inside it
+    RangeConversion narrow(RangeConversion::between(active, DataRange(-2000.5, 2000.5, 1)));
+    QVERIFY(narrow.active);
+    QCOMPARE(narrow.min, -2000);
+    QCOMPARE(narrow.max, 2000);
+    QCOMPARE(narrow.step, 1);
+    QCOMPARE(narrow.apply(123), 123);
+    QCOMPARE(narrow.apply(5000), 2000);
+    QCOMPARE(narrow.apply(-5000), -2000);
+
+    // Coarser resolution rounds half away from zero, values keep their unit
+    RangeConversion coarse(RangeConversion::between(active, DataRange(-8000, 8000, 16)));
+    QVERIFY(coarse.active);
+    QCOMPARE(coarse.step, 16);
+    QCOMPARE(coarse.apply(7), 0);
+    QCOMPARE(coarse.apply(8), 16);
+    QCOMPARE(coarse.apply(-7), 0);
+    QCOMPARE(coarse.apply(-8), -16);
+    QCOMPARE(coarse.apply(7999), 8000);
+    QCOMPARE(coarse.apply(-8000), -8000);
+
+    // Finer resolution than the active one is not rounded
+    RangeConversion fine(RangeConversion::between(active, DataRange(-4000, 4000, 0.5)));
+    QCOMPARE(fine.step, 1);
+    QCOMPARE(fine.apply(1001), 1001);
+
+    // Requests converting alike share a range class
+    QVERIFY(narrow == RangeConversion::between(active, DataRange(-2000, 2000, 1)));
+    QVERIFY(!(narrow == coarse));
+}
+
+void DataFlowTest::testChangeThreshold()
+{
+    // No threshold delivers every sample
+    ChangeThreshold change;
+    QVERIFY(change.pass(10, false));
+    QVERIFY(change.pass(10, false));
+    QVERIFY(!change.delivered);
+
+    // First sample is delivered and becomes the reference
+    change.threshold = 5;
+    QVERIFY(change.pass(100, false));
+    QCOMPARE(change.value, 100LL);
+
+    // Change of exactly the threshold is suppressed, either direction
+    QVERIFY(!change.pass(105, false));
+    QVERIFY(!change.pass(95, false));
+    QVERIFY(!change.pass(100, false));
+
+    // Suppressed samples do not move the reference, so a slow drift is
+    // delivered once it adds up past the threshold
+    QVERIFY(!change.pass(103, false));
+    QVERIFY(change.pass(106, false));
+    QCOMPARE(change.value, 106LL);
+    QVERIFY(change.pass(100, false));
+    QVERIFY(!change.pass(95, false));
+    QVERIFY(change.pass(94, false));
+
+    // Forced samples are delivered and become the reference
+    QVERIFY(change.pass(94, true));
+    QVERIFY(change.pass(96, true));
+    QCOMPARE(change.value, 96LL);
+    QVERIFY(!change.pass(101, false));
+
+    // Large values do not overflow the comparison
+    change = ChangeThreshold();
+    change.threshold = 0xffffffffu;
+    QVERIFY(change.pass(0, false));
+    QVERIFY(!change.pass(0xffffffffLL, false));
+    QVERIFY(change.pass(0x100000000LL, false));
+}
+
+void DataFlowTest::testMotionThreshold()
+{
+    MotionThreshold motion;
+    motion.threshold = 100;
+    motion.duration = 20000;
+
+    // First sample is the reference, exactly the threshold is no motion
+    QVERIFY(!motion.pass(TimedXyzData(1000, 0, 0, 0)));
+    QVERIFY(!motion.pass(TimedXyzData(2000, 100, 0, 0)));
+    QVERIFY(!motion.pass(TimedXyzData(2500, 0, -60, 80)));
+
+    // Magnitude just over the threshold must last the duration
+    QVERIFY(!motion.pass(TimedXyzData(3000, 60, 80, 1)));
+    QVERIFY(!motion.pass(TimedXyzData(22999, 200, 0, 0)));
+    QVERIFY(motion.pass(TimedXyzData(23000, 200, 0, 0)));
+
+    // Event is the new reference
+    QCOMPARE(motion.reference[0], 200);
+    QVERIFY(!motion.pass(TimedXyzData(24000, 200, 0, 0)));
+
+    // Falling back inside the threshold restarts the duration
+    QVERIFY(!motion.pass(TimedXyzData(30000, 400, 0, 0)));
+    QVERIFY(!motion.pass(TimedXyzData(40000, 250, 0, 0)));
+    QVERIFY(!motion.pass(TimedXyzData(45000, 400, 0, 0)));
+    QVERIFY(!motion.pass(TimedXyzData(60000, 400, 0, 0)));
+    QVERIFY(motion.pass(TimedXyzData(65000, 400, 0, 0)));
+
+    // Without duration the first sample over the threshold is an event
+    MotionThreshold instant;
+    instant.threshold = 10;
+    QVERIFY(!instant.pass(TimedXyzData(1000, 0, 0, 0)));
+    QVERIFY(instant.pass(TimedXyzData(1001, 0, 0, 11)));
+    QVERIFY(!instant.pass(TimedXyzData(1002, 0, 0, 21)));
+
+    // Samples without timestamp are not timed
+    MotionThreshold untimed;
+    untimed.threshold = 10;
+    untimed.duration = 1000000;
+    QVERIFY(!untimed.pass(TimedXyzData(0, 0, 0, 0)));
+    QVERIFY(untimed.pass(TimedXyzData(0, 11, 0, 0)));
+
+    // Full axis range does not overflow the magnitude
+    MotionThreshold wide;
+    wide.threshold = 0xffffffffu;
+    QVERIFY(!wide.pass(TimedXyzData(1, INT_MIN, INT_MIN, INT_MIN)));
+    QVERIFY(!wide.pass(TimedXyzData(2, INT_MAX, INT_MIN, INT_MIN)));
+    QVERIFY(wide.pass(TimedXyzData(3, INT_MAX, INT_MAX, INT_MIN)));
+}
+
+/**
+ * Read single sample frames written by SessionData.
+ *
+ * @param socket client end of the session socket.
+ * @param timestamps Set to the timestamps of the samples read.
+ */
+static void readSampleFrames(QLocalSocket& socket, QList<quint64>& timestamps)
+{
+    const qint64 frameSize = sizeof(unsigned int) + sizeof(HistorySample);
+    while (socket.bytesAvailable() || socket.waitForReadyRead(100)) {
+        while (socket.bytesAvailable() >= frameSize) {
+            unsigned int count = 0;
+            HistorySample sample;
+            socket.read((char*)&count, sizeof(count));
+            socket.read((char*)&sample, sizeof(sample));
+            QCOMPARE(count, 1u);
+            timestamps.append(sample.timestamp);
+        }
+    }
+}
+
+void DataFlowTest::testTimestampDecimation()
+{
+    QLocalServer server;
+    QVERIFY(server.listen(QString("sensorfw-dataflow-test-%1").arg(getpid())));
+    QLocalSocket client;
+    client.connectToServer(server.serverName());
+    QVERIFY(server.waitForNewConnection(1000));
+    QVERIFY(client.waitForConnected(1000));
+
+    SessionBufferPool pool;
+    TimerWheel wheel;
+    SessionData* session = new SessionData(server.nextPendingConnection(), &pool, &wheel);
+    session->setInterval(25);
+    session->setDownsampling(true);
+
+    // 10 ms samples at 25 ms interval: the phase restarts at each written
+    // sample, so every third sample goes out
+    for (quint64 t = 0; t <= 100; t += 10) {
+        HistorySample sample = { 1000000 + t * 1000, t };
+        QVERIFY(session->write(&sample, sizeof(sample)));
+    }
+    QList<quint64> timestamps;
+    readSampleFrames(client, timestamps);
+    QCOMPARE(timestamps, QList<quint64>() << 1000000 << 1030000 << 1060000 << 1090000);
+
+    // Sample exactly one interval after the last written one goes out
+    HistorySample sample = { 1115000, 0 };
+    QVERIFY(session->write(&sample, sizeof(sample)));
+    sample.timestamp = 1139999;
+    QVERIFY(session->write(&sample, sizeof(sample)));
+
+    // Timestamps going back restart the stream
+    sample.timestamp = 500000;
+    QVERIFY(session->write(&sample, sizeof(sample)));
+    sample.timestamp = 510000;
+    QVERIFY(session->write(&sample, sizeof(sample)));
+
+    timestamps.clear();
+    readSampleFrames(client, timestamps);
+    QCOMPARE(timestamps, QList<quint64>() << 1115000 << 500000);
+
+    // Without downsampling every sample goes out
+    session->setDownsampling(false);
+    sample.timestamp = 511000;
+    QVERIFY(session->write(&sample, sizeof(sample)));
+    timestamps.clear();
+    readSampleFrames(client, timestamps);
+    QCOMPARE(timestamps, QList<quint64>() << 511000);
+
+    delete session;
+}
+
+void DataFlowTest::testSessionStore()
+{
+    QString path = QDir::tempPath() + "/sensordataflow-test.sessions";
+    QFile::remove(path);
+    quint64 token;
+    {
+        SessionStore store;
+        QVERIFY(!store.isOpen());
+        QVERIFY(!store.issue(1, "accelerometersensor"));
+        QVERIFY(!store.open(path, 0));
+        QVERIFY(store.open(path, 2));
+        QVERIFY(!store.open(path, 2));
+        QVERIFY(store.previousSessions().isEmpty());
+        QCOMPARE(store.lastSessionId(), 0);
+
+        SessionRecord* record = store.issue(7, "accelerometersensor");
+        QVERIFY(record);
+        QVERIFY(record->token);
+        QCOMPARE(record->bufferSize, 1u);
+        QCOMPARE((int)record->downsampling, 1);
+        record->interval = 20;
+        record->running = 1;
+        token = record->token;
+        QVERIFY(store.find(7) == record);
+        QVERIFY(store.findToken(token) == record);
+        QVERIFY(!store.findToken(0));
+
+        // Longest sensor id fitting the record leaves room for the NUL
+        QVERIFY(!store.issue(8, QString(48, 'x')));
+        SessionRecord* second = store.issue(5, QString(47, 'x'));
+        QVERIFY(second);
+        QCOMPARE(QString(second->id), QString(47, 'x'));
+        QVERIFY(second->token != token);
+
+        // Full store issues nothing, the highest ID is kept
+        QVERIFY(!store.issue(9, "gyroscopesensor"));
+        QCOMPARE(store.lastSessionId(), 7);
+    }
+
+    // Reopened store finds the records left by the previous instance
+    {
+        SessionStore store;
+        QVERIFY(store.open(path, 2));
+        QCOMPARE(store.lastSessionId(), 7);
+        QCOMPARE(store.previousSessions(), QList<int>() << 7 << 5);
+        SessionRecord* record = store.findToken(token);
+        QVERIFY(record);
+        QCOMPARE(record->sessionId, 7);
+        QCOMPARE(record->interval, 20);
+        QCOMPARE((int)record->running, 1);
+        QCOMPARE(QString(record->id), QString("accelerometersensor"));
+
+        // Released record is free for a new session and forgotten
+        store.release(5);
+        QCOMPARE(store.previousSessions(), QList<int>() << 7);
+        QVERIFY(!store.find(5));
+        QVERIFY(store.issue(8, "gyroscopesensor"));
+    }
+
+    // Update made through one mapping is seen by a store opened meanwhile
+    {
+        SessionStore store;
+        QVERIFY(store.open(path, 2));
+        SessionStore other;
+        QVERIFY(other.open(path, 2));
+        store.find(8)->interval = 100;
+        QCOMPARE(other.find(8)->interval, 100);
+        QCOMPARE(other.lastSessionId(), 8);
+    }
+
+    // File of other capacity is cleared
+    {
+        SessionStore store;
+        QVERIFY(store.open(path, 3));
+        QVERIFY(store.previousSessions().isEmpty());
+        QVERIFY(!store.findToken(token));
+        QCOMPARE(store.lastSessionId(), 0);
+        store.issue(3, "gyroscopesensor");
+    }
+
+    // File of other layout is cleared
+    {
+        QFile file(path);
+        QVERIFY(file.open(QIODevice::ReadWrite));
+        QVERIFY(file.write("XXXX", 4) == 4);
+    }
+    {
+        SessionStore store;
+        QVERIFY(store.open(path, 3));
+        QVERIFY(store.previousSessions().isEmpty());
+        QVERIFY(!store.find(3));
+    }
+
+    QFile::remove(path);
+}
+
+void DataFlowTest::testDownsampleLength()
+{
+    // Sole session takes samples unchanged exactly when its window is one
+    QCOMPARE(downsampleLength(20, 0), 1);
+    QCOMPARE(downsampleLength(0, 10), 1);
+    QCOMPARE(downsampleLength(9, 10), 1);
+    QCOMPARE(downsampleLength(10, 10), 1);
+    QCOMPARE(downsampleLength(19, 10), 1);
+    QCOMPARE(downsampleLength(20, 10), 2);
+    QCOMPARE(downsampleLength(29, 10), 2);
+    QCOMPARE(downsampleLength(UINT_MAX, 1), INT_MAX);
+
+    // Window of one sample averages nothing
+    DownsampleWindow<3> window;
+    window.setCapacity(downsampleLength(19, 10));
+    long first[3] = { LONG_MIN, -1, LONG_MAX };
+    window.push(1000, first);
+    QCOMPARE(window.average(0), LONG_MIN);
+    QCOMPARE(window.average(2), LONG_MAX);
+    long second[3] = { 7, -7, 0 };
+    window.push(2000, second);
+    QCOMPARE(window.count(), 1);
+    QCOMPARE(window.average(0), 7L);
+    QCOMPARE(window.average(1), -7L);
+    QCOMPARE(window.average(2), 0L);
+}
+
+void DataFlowTest::testThresholdWindow()
+{
+    unsigned int low;
+    unsigned int high;
+
+    // Half width is the percentage of the reading
+    ThresholdWindow::bounds(1000, 10, 1, 65535, low, high);
+    QCOMPARE(low, 900u);
+    QCOMPARE(high, 1100u);
+
+    // Small readings get the least width, clipped at zero
+    ThresholdWindow::bounds(5, 10, 3, 65535, low, high);
+    QCOMPARE(low, 2u);
+    QCOMPARE(high, 8u);
+    ThresholdWindow::bounds(0, 10, 3, 65535, low, high);
+    QCOMPARE(low, 0u);
+    QCOMPARE(high, 3u);
+    ThresholdWindow::bounds(3, 10, 3, 65535, low, high);
+    QCOMPARE(low, 0u);
+    QCOMPARE(high, 6u);
+
+    // Window is clipped at the largest threshold
+    ThresholdWindow::bounds(65000, 10, 1, 65535, low, high);
+    QCOMPARE(low, 58500u);
+    QCOMPARE(high, 65535u);
+    ThresholdWindow::bounds(65535, 0, 0, 65535, low, high);
+    QCOMPARE(low, 65535u);
+    QCOMPARE(high, 65535u);
+
+    // Reading past the largest threshold keeps a window holding the maximum
+    ThresholdWindow::bounds(100000, 10, 1, 65535, low, high);
+    QCOMPARE(low, 58982u);
+    QCOMPARE(high, 65535u);
+
+    // Width beyond the threshold range opens the whole range
+    ThresholdWindow::bounds(UINT_MAX, UINT_MAX, 1, UINT_MAX, low, high);
+    QCOMPARE(low, 0u);
+    QCOMPARE(high, UINT_MAX);
+    ThresholdWindow::bounds(1000, 10, 100000, 65535, low, high);
+    QCOMPARE(low, 0u);
+    QCOMPARE(high, 65535u);
+}
+
+/**
+ * IIO adaptor decoding accelerometer records into its ring buffer.
+ */
+class IioTestAdaptor : public IioAdaptor
+{
+public:
+    IioTestAdaptor(const QString& root) :
+        IioAdaptor("iiotestadaptor", root + "/sys", root + "/dev"),
+        buffer_(8),
+        batches_(0)
+    {
+        // Added out of scan index order, values follow this order
+        z_ = addChannel("in_accel_z");
+        x_ = addChannel("in_accel_x");
+        y_ = addChannel("in_accel_y");
+        setAdaptedSensor("iiotest", "IIO test accelerometer", &buffer_);
+    }
+
+    using IioAdaptor::channelScale;
+    using IioAdaptor::descriptorOpened;
+    using IioAdaptor::processSample;
+
+    DeviceAdaptorRingBuffer<TimedXyzData> buffer_;
+    int batches_;
+    int x_;
+    int y_;
+    int z_;
+
+protected:
+    void processScans(const IioScan* scans, int count)
+    {
+        for (int i = 0; i < count; ++i) {
+            TimedXyzData* d = buffer_.nextSlot();
+            *d = TimedXyzData(scans[i].timestamp, (int)scans[i].values[x_],
+                              (int)scans[i].values[y_], (int)scans[i].values[z_]);
+            buffer_.commit();
+        }
+        buffer_.wakeUpReaders();
+        ++batches_;
+    }
+};
+
+/**
+ * Ring buffer reader of decoded IIO records.
+ */
+class IioPollingReader : public RingBufferReader<TimedXyzData>
+{
+public:
+    using RingBufferReader<TimedXyzData>::read;
+    void pushNewData() {}
+};
+
+/**
+ * Append a value of an IIO record.
+ */
+static void appendValue(QByteArray& record, quint64 value, int size, bool bigEndian)
+{
+    for (int i = 0; i < size; ++i) {
+        int byte = bigEndian ? size - 1 - i : i;
+        record.append((char)((value >> (8 * byte)) & 0xff));
+    }
+}
+
+/**
+ * Append a record of the fake IIO device.
+ */
+static void appendRecord(QByteArray& records, quint16 x, quint16 y, quint32 z, qint64 timestamp)
+{
+    appendValue(records, x, 2, false);
+    appendValue(records, y, 2, true);
+    appendValue(records, z, 4, true);
+    appendValue(records, timestamp, 8, false);
+}
+
+/**
+ * Read an attribute of the fake device tree.
+ */
+static QByteArray readAttribute(const QString& path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return QByteArray();
+    return file.readAll();
+}
+
+void DataFlowTest::testIioAdaptor()
+{
+    QString root = QDir::tempPath() + "/sensordataflow-test-iio";
+    QString device = root + "/sys/iio:device0";
+    removeTree(root);
+    writeAttribute(device + "/name", "test_accel\n");
+    writeAttribute(device + "/sampling_frequency", "100\n");
+    writeAttribute(device + "/current_timestamp_clock", "realtime\n");
+    writeAttribute(device + "/in_accel_scale", "0.5\n");
+    writeAttribute(device + "/in_accel_x_scale", "0.25\n");
+
+    // x: 12 bits above a status nibble, y: big endian, z: unsigned 24 bits
+    // below a status byte, followed by the 64 bit kernel timestamp
+    writeAttribute(device + "/scan_elements/in_accel_x_en", "0\n");
+    writeAttribute(device + "/scan_elements/in_accel_x_type", "le:s12/16>>4\n");
+    writeAttribute(device + "/scan_elements/in_accel_x_index", "0\n");
+    writeAttribute(device + "/scan_elements/in_accel_y_en", "0\n");
+    writeAttribute(device + "/scan_elements/in_accel_y_type", "be:s16/16>>0\n");
+    writeAttribute(device + "/scan_elements/in_accel_y_index", "1\n");
+    writeAttribute(device + "/scan_elements/in_accel_z_en", "0\n");
+    writeAttribute(device + "/scan_elements/in_accel_z_type", "be:u24/32>>8\n");
+    writeAttribute(device + "/scan_elements/in_accel_z_index", "2\n");
+    writeAttribute(device + "/scan_elements/in_timestamp_en", "0\n");
+    writeAttribute(device + "/scan_elements/in_timestamp_type", "le:s64/64>>0\n");
+    writeAttribute(device + "/scan_elements/in_timestamp_index", "3\n");
+    writeAttribute(device + "/buffer/length", "0\n");
+    writeAttribute(device + "/buffer/watermark", "0\n");
+    writeAttribute(device + "/buffer/enable", "0\n");
+
+    // Character device is a FIFO fed by the test
+    QDir().mkpath(root + "/dev");
+    QByteArray node = (root + "/dev/iio:device0").toLocal8Bit();
+    QCOMPARE(mkfifo(node.constData(), 0600), 0);
+    int readFd = open(node.constData(), O_RDONLY | O_NONBLOCK);
+    QVERIFY(readFd != -1);
+    int writeFd = open(node.constData(), O_WRONLY | O_NONBLOCK);
+    QVERIFY(writeFd != -1);
+
+    writeAttribute(root + "/sensord.conf", "[iiotest]\niio_device = iio:device0\n"
+                                           "iio_buffer_length = 32\niio_watermark = 4\n");
+    QVERIFY(Config::loadConfig(root + "/sensord.conf", QString()));
+
+    {
+        IioTestAdaptor adaptor(root);
+        adaptor.init();
+        QVERIFY(adaptor.isValid());
+        QCOMPARE(adaptor.interval(), 10u);
+        QCOMPARE(adaptor.channelScale(adaptor.x_), 0.25);
+        QCOMPARE(adaptor.channelScale(adaptor.y_), 0.5);
+        QCOMPARE(adaptor.channelScale(adaptor.z_), 0.5);
+        QCOMPARE(readAttribute(device + "/current_timestamp_clock"), QByteArray("monotonic\n"));
+
+        // Opening the device enables the scan elements and the buffer
+        adaptor.descriptorOpened(0, readFd);
+        QCOMPARE(readAttribute(device + "/scan_elements/in_accel_x_en"), QByteArray("1\n"));
+        QCOMPARE(readAttribute(device + "/scan_elements/in_accel_y_en"), QByteArray("1\n"));
+        QCOMPARE(readAttribute(device + "/scan_elements/in_accel_z_en"), QByteArray("1\n"));
+        QCOMPARE(readAttribute(device + "/scan_elements/in_timestamp_en"), QByteArray("1\n"));
+        QCOMPARE(readAttribute(device + "/buffer/length"), QByteArray("32\n"));
+        QCOMPARE(readAttribute(device + "/buffer/watermark"), QByteArray("4\n"));
+        QCOMPARE(readAttribute(device + "/buffer/enable"), QByteArray("1\n"));
+
+        IioPollingReader reader;
+        QVERIFY(adaptor.buffer_.join(&reader));
+
+        // Status bits below the shift are dropped, signed values extended
+        QByteArray records;
+        appendRecord(records, 0xffb5, 0xfffe, 0x123456ab, 5000000000LL);
+        appendRecord(records, 0x7ff0, 0x7fff, 0xffffff00, 5010000000LL);
+        appendRecord(records, 0x800f, 0x8000, 0x000000ff, 5020000000LL);
+        QCOMPARE(write(writeFd, records.constData(), records.size()), (ssize_t)records.size());
+        adaptor.processSample(0, readFd);
+        QCOMPARE(adaptor.batches_, 1);
+
+        TimedXyzData out[4];
+        QCOMPARE(reader.read(4, out), 3u);
+        QCOMPARE(out[0].timestamp_, (quint64)5000000);
+        QCOMPARE(out[0].x_, -5);
+        QCOMPARE(out[0].y_, -2);
+        QCOMPARE(out[0].z_, 0x123456);
+        QCOMPARE(out[1].timestamp_, (quint64)5010000);
+        QCOMPARE(out[1].x_, 2047);
+        QCOMPARE(out[1].y_, 32767);
+        QCOMPARE(out[1].z_, 0xffffff);
+        QCOMPARE(out[2].timestamp_, (quint64)5020000);
+        QCOMPARE(out[2].x_, -2048);
+        QCOMPARE(out[2].y_, -32768);
+        QCOMPARE(out[2].z_, 0);
+
+        // Nothing more to read
+        adaptor.processSample(0, readFd);
+        QCOMPARE(adaptor.batches_, 1);
+    }
+
+    // Buffer is disabled with the adaptor
+    QCOMPARE(readAttribute(device + "/buffer/enable"), QByteArray("0\n"));
+
+    close(writeFd);
+    close(readFd);
+    removeTree(root);
+}
+
+void DataFlowTest::testLogLevel()
+{
+    MessageHandler previous = installMessageHandler(discardMessage);
+    int evaluated = 0;
+
+    sensordSetLogLevel(QtWarningMsg);
+    sensordLogD() << ++evaluated;
+    QCOMPARE(evaluated, 0);
+    sensordLogW() << ++evaluated;
+    QCOMPARE(evaluated, 1);
+
+    sensordSetLogLevel(QtDebugMsg);
+    sensordLogD() << ++evaluated;
+    QCOMPARE(evaluated, 2);
+
+    installMessageHandler(previous);
+}
+
+void DataFlowTest::benchmarkLogging_data()
+{
+    QTest::addColumn<bool>("enabled");
+    QTest::newRow("debug enabled") << true;
+    QTest::newRow("debug disabled") << false;
+}
+
+void DataFlowTest::benchmarkLogging()
+{
+    QFETCH(bool, enabled);
+
+    // Formatting cost only, output is discarded
+    MessageHandler previous = installMessageHandler(discardMessage);
+    sensordSetLogLevel(enabled ? QtDebugMsg : QtWarningMsg);
+
+    TimedXyzData data(0, 1, 2, 3);
+    QString session("session");
+    QBENCHMARK {
+        sensordLogD() << "Downsampled for session" << session << ":" << data.x_ << data.y_ << data.z_;
+    }
+
+    sensordSetLogLevel(QtDebugMsg);
+    installMessageHandler(previous);
+}
+
 QList<QString> DataFlowTest::getKeys(const SensorManager &that)
 {
     return that.getAdaptorTypes();
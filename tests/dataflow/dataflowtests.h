@@ -45,6 +45,42 @@ private slots:
 
     void testAdaptorSharing();
     void testChainSharing();
+    void testSampleQueue();
+    void testSpscQueue();
+    void testSharedRing();
+    void testCompactFrame();
+    void testTimerWheel();
+    void testVirtualClock();
+    void testClockDomain();
+    void testPropagate();
+    void benchmarkPropagate_data();
+    void benchmarkPropagate();
+    void testRingBufferPassThrough();
+    void testDecimatingReader();
+    void testDemand();
+    void testDataflowGraph();
+    void testOverloadController();
+    void testDeviceDiscovery();
+    void testUringReader();
+    void testTimestampReconstructor();
+    void testRingBufferWrap();
+    void testRingBufferStatistics();
+    void testLatencyTracer();
+    void testChainScheduler();
+    void testTraceRecorder();
+    void testTraceArchive();
+    void testHistoryRing();
+    void testRangeConversion();
+    void testChangeThreshold();
+    void testMotionThreshold();
+    void testTimestampDecimation();
+    void testSessionStore();
+    void testDownsampleLength();
+    void testThresholdWindow();
+    void testIioAdaptor();
+    void testLogLevel();
+    void benchmarkLogging_data();
+    void benchmarkLogging();
 
     void cleanup() {};
     void cleanupTestCase();
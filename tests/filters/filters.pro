@@ -12,22 +12,49 @@ PKGCONFIG += mlite5
 HEADERS += filtertests.h \
     ../../filters/orientationinterpreter/orientationinterpreter.h \
     ../../filters/coordinatealignfilter/coordinatealignfilter.h \
+    ../../filters/coordinatealignfilter/xyztransform.h \
+    ../../filters/lowpassfilter/lowpasskernel.h \
     ../../filters/declinationfilter/declinationfilter.h \
-    ../../filters/rotationfilter/rotationfilter.h 
+    ../../filters/rotationfilter/rotationfilter.h \
+    ../../filters/syncfilter/syncfilter.h \
+    ../../sensors/statisticssensor/statisticsfilter.h \
+    ../../sensors/integratedgyroscopesensor/rotationdeltafilter.h \
+    ../../chains/compasschain/compassfilter.h \
+    ../../chains/magcalibrationchain/ellipsoidcalibrator.h \
+    ../../chains/magcalibrationchain/halcalibrationfilter.h \
+    ../../chains/fusionchain/attitudefilter.h \
+    ../../sensors/contextplugin/avgvarfilter.h
 
     
 SOURCES += filtertests.cpp \
     ../../filters/orientationinterpreter/orientationinterpreter.cpp \
     ../../filters/coordinatealignfilter/coordinatealignfilter.cpp \
+    ../../filters/coordinatealignfilter/xyztransform.cpp \
+    ../../filters/lowpassfilter/lowpasskernel.cpp \
     ../../filters/declinationfilter/declinationfilter.cpp \
-    ../../filters/rotationfilter/rotationfilter.cpp
+    ../../filters/rotationfilter/rotationfilter.cpp \
+    ../../filters/syncfilter/syncfilter.cpp \
+    ../../sensors/statisticssensor/statisticsfilter.cpp \
+    ../../sensors/integratedgyroscopesensor/rotationdeltafilter.cpp \
+    ../../chains/compasschain/compassfilter.cpp \
+    ../../chains/magcalibrationchain/ellipsoidcalibrator.cpp \
+    ../../chains/magcalibrationchain/halcalibrationfilter.cpp \
+    ../../chains/fusionchain/attitudefilter.cpp
 
 INCLUDEPATH += ../../include \
     ../../ \
     ../../filters/orientationinterpreter \
     ../../filters/coordinatealignfilter \
+    ../../filters/lowpassfilter \
     ../../filters/declinationfilter \
     ../../filters/rotationfilter \
+    ../../filters/syncfilter \
+    ../../sensors/statisticssensor \
+    ../../sensors/integratedgyroscopesensor \
+    ../../chains/compasschain \
+    ../../chains/magcalibrationchain \
+    ../../chains/fusionchain \
+    ../../sensors/contextplugin \
     ../../core \
     ../../datatypes
     
@@ -34,25 +34,52 @@
 #include "bufferreader.h"
 #include "filter.h"
 #include "coordinatealignfilter.h"
+#include "xyzlanes.h"
+#include "lowpasskernel.h"
 #include "orientationdata.h"
 #include "orientationinterpreter.h"
 #include "declinationfilter.h"
 #include "rotationfilter.h"
+#include "syncfilter.h"
+#include "statisticsfilter.h"
+#include "rotationdeltafilter.h"
+#include "compassfilter.h"
+#include "ellipsoidcalibrator.h"
+#include "halcalibrationfilter.h"
+#include "attitudefilter.h"
+#include "avgvarfilter.h"
+#include "changefilter.h"
+#include "sink.h"
 #include "filtertests.h"
 #include "config.h"
 #include <MGConfItem>
+#include <math.h>
+#include <string.h>
 
 void FilterApiTest::initTestCase()
 {
     Config::loadConfig(CONFIG_FILE_PATH, CONFIG_DIR_PATH);
 }
 
+void FilterApiTest::testCoordinateAlignFilter_data()
+{
+    QTest::addColumn<int>("batchSize");
+    QTest::addColumn<int>("scale");
+    // Scale 1 keeps the matrix a signed permutation, 2 forces general path
+    QTest::newRow("single samples") << 1 << 1;
+    QTest::newRow("single batch") << 8 << 1;
+    QTest::newRow("general matrix") << 8 << 2;
+}
+
 /**
  * This should be simple enough to be valid if one transformation matrix works.
  * Could add larger/smaller coefficients and another matrix if really pedant.
  */
 void FilterApiTest::testCoordinateAlignFilter()
 {
+    QFETCH(int, batchSize);
+    QFETCH(int, scale);
+
     // Transformation matrix to use for testing.
     double hconv[3][3] = {
         { 0, 0,-1},
@@ -89,6 +116,15 @@ void FilterApiTest::testCoordinateAlignFilter()
 
     int numInputs = (sizeof(inputData) / sizeof(TimedXyzData));
 
+    for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 3; ++j)
+            hconv[i][j] *= scale;
+    for (int i = 0; i < numInputs; ++i) {
+        expectedResult[i].x_ *= scale;
+        expectedResult[i].y_ *= scale;
+        expectedResult[i].z_ *= scale;
+    }
+
     Bin filterBin;
     DummyAdaptor<TimedXyzData> dummyAdaptor;
 
@@ -116,9 +152,9 @@ void FilterApiTest::testCoordinateAlignFilter()
     marshallingBin.start();
     filterBin.start();
 
-    // Start sends data once, so start from index 1.
-    for (int i = 0; i < numInputs; ++i) {
-        dummyAdaptor.pushNewData();
+    // Whole batch must come out of the filter, not just its first sample.
+    for (int i = 0; i < numInputs; i += batchSize) {
+        dummyAdaptor.pushNewData(batchSize);
     }
 
     filterBin.stop();
@@ -129,6 +165,149 @@ void FilterApiTest::testCoordinateAlignFilter()
     delete coordAlignFilter;
 }
 
+void FilterApiTest::testXyzTransformKernel()
+{
+    const float m[9] = { 0.5, 0, -1,
+                         -1, 2, 0,
+                         0, 1, 0.25 };
+
+    // Sample count not divisible by vector width
+    const unsigned n = 7;
+    XyzBlock scalar;
+    XyzBlock selected;
+    for (unsigned i = 0; i < n; ++i) {
+        scalar.x[i] = selected.x[i] = i * 10;
+        scalar.y[i] = selected.y[i] = -(int)i * 3;
+        scalar.z[i] = selected.z[i] = 1000 - i;
+    }
+
+    const char* name = 0;
+    XyzTransformKernel kernel = xyzTransformKernel(&name);
+    QVERIFY(name);
+    xyzTransformScalar(m, n, scalar);
+    kernel(m, n, selected);
+
+    for (unsigned i = 0; i < n; ++i) {
+        QCOMPARE(selected.x[i], scalar.x[i]);
+        QCOMPARE(selected.y[i], scalar.y[i]);
+        QCOMPARE(selected.z[i], scalar.z[i]);
+    }
+}
+
+void FilterApiTest::testLowPassKernels()
+{
+    float coefs[12];
+    float samples[12];
+    for (int i = 0; i < 12; ++i) {
+        coefs[i] = i * 0.125f;
+        samples[i] = 100 - i * 7;
+    }
+    const char* name = 0;
+    FirKernel fir = firKernel(&name);
+    QVERIFY(name);
+    QCOMPARE(fir(coefs, samples, 12), firScalar(coefs, samples, 12));
+
+    const BiquadSection sections[2] = { { 0.1f, 0.2f, 0.1f, -0.8f, 0.2f },
+                                        { 0.2f, 0.4f, 0.2f, -0.5f, 0.3f } };
+    BiquadState scalarStates[2];
+    BiquadState selectedStates[2];
+    memset(scalarStates, 0, sizeof(scalarStates));
+    memset(selectedStates, 0, sizeof(selectedStates));
+    name = 0;
+    BiquadKernel biquad = biquadKernel(&name);
+    QVERIFY(name);
+    for (int i = 0; i < 8; ++i) {
+        float scalar[4] = { 10.0f * i, -3.0f * i, 1000.0f, 0 };
+        float selected[4] = { 10.0f * i, -3.0f * i, 1000.0f, 0 };
+        biquadScalar(sections, scalarStates, 2, scalar);
+        biquad(sections, selectedStates, 2, selected);
+        for (int lane = 0; lane < 3; ++lane)
+            QCOMPARE(selected[lane], scalar[lane]);
+    }
+}
+
+/**
+ * Collects lane batches and arrays of samples from the same source.
+ */
+class LaneCollector
+{
+public:
+    LaneCollector() :
+        laneSink(this, &LaneCollector::collectLanes),
+        arraySink(this, &LaneCollector::collectArray),
+        lanes(0)
+    {}
+
+    void collectLanes(const XyzLanes<int>& batch)
+    {
+        ++lanes;
+        last = batch;
+    }
+
+    void collectArray(unsigned n, const TimedXyzData* values)
+    {
+        for (unsigned i = 0; i < n; ++i)
+            samples.append(values[i]);
+    }
+
+    LaneSink<LaneCollector, TimedXyzData> laneSink;
+    Sink<LaneCollector, TimedXyzData>     arraySink;
+    int                                   lanes;
+    XyzLanes<int>                         last;
+    QList<TimedXyzData>                   samples;
+};
+
+void FilterApiTest::testXyzLanes()
+{
+    double conv[3][3] = {
+        { 0, 2, 0},
+        {-2, 0, 0},
+        { 0, 0, 1}
+    };
+    TimedXyzData input[] = {
+        TimedXyzData(10, 1, 2, 3),
+        TimedXyzData(20, -4, 5, 6),
+        TimedXyzData(30, 7, 8, -9)
+    };
+
+    XyzLanes<int> lanes;
+    lanes.load(3, input);
+    QCOMPARE(lanes.count, 3u);
+    QCOMPARE(lanes.y[1], 5);
+    QCOMPARE(lanes.timestamp[2], (quint64)30);
+
+    FilterBase* align = CoordinateAlignFilter::factoryMethod();
+    ((CoordinateAlignFilter*)align)->setMatrix(TMatrix(conv));
+
+    LaneSource<TimedXyzData> source;
+    LaneCollector output;
+    QVERIFY(source.join(align->sink("sink")));
+    QVERIFY(align->source("source")->join(&output.laneSink));
+    QVERIFY(align->source("source")->join(&output.arraySink));
+
+    // Lanes go through the filter as such, array sinks get samples
+    source.propagate(lanes);
+    QCOMPARE(output.lanes, 1);
+    QCOMPARE(output.last.count, 3u);
+    QCOMPARE(output.last.x[1], 10);
+    QCOMPARE(output.last.y[1], 8);
+    QCOMPARE(output.last.z[2], -9);
+    QCOMPARE(output.samples.size(), 3);
+    QCOMPARE(output.samples.at(2).timestamp_, (quint64)30);
+    QCOMPARE(output.samples.at(2).x_, 16);
+    QCOMPARE(output.samples.at(2).y_, -14);
+
+    // Arrays from legacy sources are converted at the filter input
+    Source<TimedXyzData> legacy;
+    QVERIFY(legacy.join(align->sink("sink")));
+    legacy.propagate(3, input);
+    QCOMPARE(output.lanes, 2);
+    QCOMPARE(output.last.x[0], 4);
+    QCOMPARE(output.samples.size(), 6);
+
+    delete align;
+}
+
 // TODO: Add some state changes to verify functionality of threshold setting.
 void FilterApiTest::testTopEdgeInterpretationFilter()
 {
@@ -489,4 +668,602 @@ void FilterApiTest::testRotationFilter()
     delete rotationFilter;
 }
 
+void FilterApiTest::testSyncFilter_data()
+{
+    QTest::addColumn<bool>("interpolate");
+    QTest::newRow("interpolate") << true;
+    QTest::newRow("nearest") << false;
+}
+
+void FilterApiTest::testSyncFilter()
+{
+    QFETCH(bool, interpolate);
+
+    TimedXyzData accelerometerData[] = {
+        TimedXyzData(10, 1, 2, 3),
+        TimedXyzData(30, 4, 5, 6)
+    };
+
+    TimedXyzData gyroscopeData[] = {
+        TimedXyzData( 0,   0,    0,  0),
+        TimedXyzData(20, 200, -200, 20),
+        TimedXyzData(40, 400, -400, 40)
+    };
+
+    // Ticks lie halfway between gyroscope samples, nearest picks the later
+    int gyroscopeResult[2][2][3] = {
+        { {  200, -200, 20 }, {  400, -400, 40 } },
+        { {  100, -100, 10 }, {  300, -300, 30 } }
+    };
+
+    // Magnetometer is not connected, its values stay zero
+    FusionData expectedResult[2];
+    for (int i = 0; i < 2; ++i) {
+        expectedResult[i].timestamp_ = accelerometerData[i].timestamp_;
+        expectedResult[i].accelerometer_[0] = accelerometerData[i].x_;
+        expectedResult[i].accelerometer_[1] = accelerometerData[i].y_;
+        expectedResult[i].accelerometer_[2] = accelerometerData[i].z_;
+        for (int j = 0; j < 3; ++j)
+            expectedResult[i].gyroscope_[j] = gyroscopeResult[interpolate][i][j];
+    }
+
+    DummyAdaptor<TimedXyzData> accelerometerAdaptor;
+    DummyAdaptor<TimedXyzData> gyroscopeAdaptor;
+    DummyDataEmitter<FusionData> dbusEmitter;
+
+    SyncFilter* syncFilter = static_cast<SyncFilter*>(SyncFilter::factoryMethod());
+    syncFilter->setInterpolate(interpolate);
+    syncFilter->setMaxDelay(1000);
+    RingBuffer<FusionData> outputBuffer(10);
+
+    Bin filterBin;
+    filterBin.add(&accelerometerAdaptor, "accelerometer");
+    filterBin.add(&gyroscopeAdaptor, "gyroscope");
+    filterBin.add(syncFilter, "syncfilter");
+    filterBin.add(&outputBuffer, "buffer");
+
+    filterBin.join("accelerometer", "source", "syncfilter", "accelerometersink");
+    filterBin.join("gyroscope", "source", "syncfilter", "gyroscopesink");
+    filterBin.join("syncfilter", "source", "buffer", "sink");
+
+    Bin marshallingBin;
+    marshallingBin.add(&dbusEmitter, "testdataemitter");
+    outputBuffer.join(&dbusEmitter);
+
+    accelerometerAdaptor.setTestData(2, accelerometerData);
+    gyroscopeAdaptor.setTestData(3, gyroscopeData);
+    dbusEmitter.setExpectedData(2, expectedResult);
+
+    marshallingBin.start();
+    filterBin.start();
+
+    gyroscopeAdaptor.pushNewData(2);
+    accelerometerAdaptor.pushNewData();
+    QCOMPARE(dbusEmitter.numSamplesReceived(), 1);
+
+    // Second tick waits for a gyroscope sample after it
+    accelerometerAdaptor.pushNewData();
+    QCOMPARE(dbusEmitter.numSamplesReceived(), 1);
+    gyroscopeAdaptor.pushNewData();
+    QCOMPARE(dbusEmitter.numSamplesReceived(), 2);
+
+    filterBin.stop();
+    marshallingBin.stop();
+
+    delete syncFilter;
+}
+
+/**
+ * Collects records produced by a statistics filter.
+ */
+class StatisticsCollector
+{
+public:
+    StatisticsCollector() : sink(this, &StatisticsCollector::collect) {}
+
+    void collect(unsigned n, const XyzStatisticsData* values)
+    {
+        for (unsigned i = 0; i < n; ++i)
+            records.append(values[i]);
+    }
+
+    QVector<XyzStatisticsData> records;
+    Sink<StatisticsCollector, XyzStatisticsData> sink;
+};
+
+void FilterApiTest::testStatisticsFilter()
+{
+    StatisticsFilter filter(10);
+    StatisticsCollector collector;
+    Source<TimedXyzData> input;
+    QVERIFY(input.join(filter.sink("sink")));
+    QVERIFY(filter.source("source")->join(&collector.sink));
+
+    TimedXyzData data[] = {
+        TimedXyzData(    0,  1, -10, 100),
+        TimedXyzData( 4000,  2, -20, 100),
+        TimedXyzData( 8000,  6, -30, 100),
+        TimedXyzData(12000,  5,   0,   0)
+    };
+
+    // Window is closed by the first sample past its end
+    input.propagate(3, data);
+    QCOMPARE(collector.records.size(), 0);
+    input.propagate(1, data + 3);
+    QCOMPARE(collector.records.size(), 1);
+
+    const XyzStatisticsData& record = collector.records.at(0);
+    QCOMPARE(record.timestamp_, (quint64)8000);
+    QCOMPARE(record.count_, 3u);
+    QCOMPARE(record.window_, 10u);
+    QCOMPARE(record.min_[0], 1);
+    QCOMPARE(record.max_[0], 6);
+    QCOMPARE(record.min_[1], -30);
+    QCOMPARE(record.max_[1], -10);
+    QCOMPARE(record.mean_[0], 3.0f);
+    QCOMPARE(record.mean_[1], -20.0f);
+    QCOMPARE(record.variance_[0], 7.0f);
+    QCOMPARE(record.variance_[1], 100.0f);
+    QCOMPARE(record.variance_[2], 0.0f);
+
+    // Samples of an open window are dropped on reset
+    filter.reset();
+    TimedXyzData late(40000, 0, 0, 0);
+    input.propagate(1, &late);
+    QCOMPARE(collector.records.size(), 1);
+}
+
+/**
+ * Collects records produced by a rotation delta filter.
+ */
+class RotationDeltaCollector
+{
+public:
+    RotationDeltaCollector() : sink(this, &RotationDeltaCollector::collect) {}
+
+    void collect(unsigned n, const RotationDeltaData* values)
+    {
+        for (unsigned i = 0; i < n; ++i)
+            records.append(values[i]);
+    }
+
+    QVector<RotationDeltaData> records;
+    Sink<RotationDeltaCollector, RotationDeltaData> sink;
+};
+
+void FilterApiTest::testRotationDeltaFilter()
+{
+    RotationDeltaFilter filter(10);
+    RotationDeltaCollector collector;
+    Source<TimedXyzData> input;
+    QVERIFY(input.join(filter.sink("sink")));
+    QVERIFY(filter.source("source")->join(&collector.sink));
+
+    // 90 dps about z, 0.45 degrees per 5 ms step
+    TimedXyzData data[] = {
+        TimedXyzData(    0, 0, 0, 90000),
+        TimedXyzData( 5000, 0, 0, 90000),
+        TimedXyzData(10000, 0, 0, 90000),
+        TimedXyzData(15000, 0, 0, 90000)
+    };
+
+    // Window is closed by the first sample past its end
+    input.propagate(2, data);
+    QCOMPARE(collector.records.size(), 0);
+    input.propagate(2, data + 2);
+    QCOMPARE(collector.records.size(), 2);
+
+    const float half = 0.225f * 3.14159265f / 180;
+    const RotationDeltaData& first = collector.records.at(0);
+    QCOMPARE(first.timestamp_, (quint64)5000);
+    QCOMPARE(first.count_, 2u);
+    QCOMPARE(first.duration_, 5000u);
+    QVERIFY(fabsf(first.angle_[2] - 450) < 0.01f);
+    QCOMPARE(first.angle_[0], 0.0f);
+    QVERIFY(fabsf(first.delta_[0] - cosf(half)) < 1e-6f);
+    QVERIFY(fabsf(first.delta_[3] - sinf(half)) < 1e-6f);
+
+    // Next window starts at the last integrated sample, nothing is lost
+    const RotationDeltaData& second = collector.records.at(1);
+    QCOMPARE(second.timestamp_, (quint64)10000);
+    QCOMPARE(second.count_, 1u);
+    QCOMPARE(second.duration_, 5000u);
+    QVERIFY(fabsf(second.angle_[2] - 450) < 0.01f);
+
+    // Rotation is not integrated across a reset
+    filter.reset();
+    TimedXyzData late[] = {
+        TimedXyzData(40000, 0, 0, 90000),
+        TimedXyzData(60000, 0, 0, 0)
+    };
+    input.propagate(2, late);
+    QCOMPARE(collector.records.size(), 3);
+    QCOMPARE(collector.records.at(2).duration_, 0u);
+    QCOMPARE(collector.records.at(2).delta_[0], 1.0f);
+}
+
+/**
+ * Collects headings produced by a compass filter.
+ */
+class HeadingCollector
+{
+public:
+    HeadingCollector() : sink(this, &HeadingCollector::collect) {}
+
+    void collect(unsigned n, const CompassData* values)
+    {
+        for (unsigned i = 0; i < n; ++i)
+            degrees.append(values[i].degrees_);
+    }
+
+    QVector<int> degrees;
+    Sink<HeadingCollector, CompassData> sink;
+};
+
+void FilterApiTest::testCompassFilterTrigFree()
+{
+    CompassFilter* filters[2];
+    HeadingCollector collectors[2];
+    Source<CalibratedMagneticFieldData> magnetometer;
+    Source<AccelerationData> accelerometer;
+    for (int i = 0; i < 2; ++i) {
+        filters[i] = static_cast<CompassFilter*>(CompassFilter::factoryMethod());
+        filters[i]->setTrigFree(i == 1);
+        QVERIFY(magnetometer.join(filters[i]->sink("magsink")));
+        QVERIFY(accelerometer.join(filters[i]->sink("accsink")));
+        QVERIFY(filters[i]->source("magnorthangle")->join(&collectors[i].sink));
+    }
+
+    // Sweep device orientations and field directions on a coarse grid.
+    // Exact axis alignments are avoided, there rounding of the reference
+    // decides between headings 180 degrees apart.
+    int samples = 0;
+    for (int bx = -55; bx <= 60; bx += 30) {
+        for (int by = -55; by <= 60; by += 30) {
+            CalibratedMagneticFieldData field(0, 0, 0, 0, bx, by, -40, 3);
+            magnetometer.propagate(1, &field);
+
+            QVector<AccelerationData> gravity;
+            for (int x = -990; x <= 990; x += 220)
+                for (int y = -990; y <= 990; y += 220)
+                    for (int z = -990; z <= 990; z += 220)
+                        gravity.append(AccelerationData(samples++, x, y, z));
+            accelerometer.propagate(gravity.size(), gravity.constData());
+        }
+    }
+
+    QCOMPARE(collectors[0].degrees.size(), samples);
+    QCOMPARE(collectors[1].degrees.size(), samples);
+    int maxDelta = 0;
+    int differing = 0;
+    for (int i = 0; i < samples; ++i) {
+        int delta = qAbs(collectors[0].degrees[i] - collectors[1].degrees[i]);
+        delta = qMin(delta, 360 - delta);
+        maxDelta = qMax(maxDelta, delta);
+        if (delta)
+            ++differing;
+    }
+    qDebug() << "Trig-free compass kernel: max delta" << maxDelta << "degrees," << differing << "of" << samples << "headings differ";
+    // Only truncation to whole degrees may differ
+    QVERIFY(maxDelta <= 1);
+
+    delete filters[0];
+    delete filters[1];
+}
+
+void FilterApiTest::testCompassFilterOutputInterval()
+{
+    CompassFilter* filter = static_cast<CompassFilter*>(CompassFilter::factoryMethod());
+    HeadingCollector collector;
+    Source<CalibratedMagneticFieldData> magnetometer;
+    Source<AccelerationData> accelerometer;
+    QVERIFY(magnetometer.join(filter->sink("magsink")));
+    QVERIFY(accelerometer.join(filter->sink("accsink")));
+    QVERIFY(filter->source("magnorthangle")->join(&collector.sink));
+
+    CalibratedMagneticFieldData field(0, 0, 0, 0, 30, 20, -40, 3);
+    magnetometer.propagate(1, &field);
+
+    // 100 Hz accelerometer with 1 ms jitter, headings wanted at 20 Hz
+    filter->setOutputInterval(50);
+    QVector<AccelerationData> gravity;
+    for (int i = 0; i < 100; ++i)
+        gravity.append(AccelerationData(i * 10000 + (i % 2) * 1000, 100, 200, 900));
+    accelerometer.propagate(gravity.size(), gravity.constData());
+    QCOMPARE(collector.degrees.size(), 20);
+
+    // Without interval every sample gives a heading
+    filter->setOutputInterval(0);
+    accelerometer.propagate(gravity.size(), gravity.constData());
+    QCOMPARE(collector.degrees.size(), 120);
+
+    delete filter;
+}
+
+void FilterApiTest::testRotationFilterKernel()
+{
+    // Double precision reference of the rotations
+    QVector<TimedXyzData> samples;
+    QVector<TimedXyzData> expected;
+    for (int x = -1000; x <= 1000; x += 130) {
+        for (int y = -1000; y <= 1000; y += 170) {
+            for (int z = -1000; z <= 1000; z += 190) {
+                samples.append(TimedXyzData(samples.size(), x, y, z));
+                int rx = -qRound(atan2((double)y, sqrt((double)x * x + (double)z * z)) * 180 / M_PI);
+                int ry = 0;
+                if (x != 0 || z != 0) {
+                    double yz = sqrt((double)y * y + (double)z * z);
+                    ry = qRound(atan2((double)x, z >= 0 ? -yz : yz) * 180 / M_PI);
+                }
+                expected.append(TimedXyzData(0, rx, ry == -180 ? 180 : ry, 7));
+            }
+        }
+    }
+
+    RotationFilter::rotate(samples.size(), samples.data(), 7);
+    int maxDelta = 0;
+    for (int i = 0; i < samples.size(); ++i) {
+        int dy = qAbs(samples[i].y_ - expected[i].y_);
+        maxDelta = qMax(maxDelta, qMax(qAbs(samples[i].x_ - expected[i].x_), qMin(dy, 360 - dy)));
+        QCOMPARE(samples[i].z_, 7);
+    }
+    // Only ties in rounding to whole degrees may differ
+    QVERIFY(maxDelta <= 1);
+}
+
+/**
+ * Collects samples produced by a filter.
+ */
+class XyzCollector
+{
+public:
+    XyzCollector() : sink(this, &XyzCollector::collect) {}
+
+    void collect(unsigned n, const TimedXyzData* values)
+    {
+        for (unsigned i = 0; i < n; ++i)
+            samples.append(values[i]);
+    }
+
+    QVector<TimedXyzData> samples;
+    Sink<XyzCollector, TimedXyzData> sink;
+};
+
+void FilterApiTest::testRotationFilterOutputInterval()
+{
+    RotationFilter* filter = static_cast<RotationFilter*>(RotationFilter::factoryMethod());
+    XyzCollector collector;
+    Source<TimedXyzData> accelerometer;
+    QVERIFY(accelerometer.join(filter->sink("accelerometersink")));
+    QVERIFY(filter->source("source")->join(&collector.sink));
+
+    QVector<TimedXyzData> gravity;
+    for (int i = 0; i < 100; ++i)
+        gravity.append(TimedXyzData(i * 10000 + (i % 2) * 1000, 0, -500, -500));
+
+    filter->setEnabled(false);
+    accelerometer.propagate(gravity.size(), gravity.constData());
+    QCOMPARE(collector.samples.size(), 0);
+
+    filter->setEnabled(true);
+    filter->setOutputInterval(50);
+    accelerometer.propagate(gravity.size(), gravity.constData());
+    QCOMPARE(collector.samples.size(), 20);
+    QCOMPARE(collector.samples.last().x_, 45);
+
+    filter->setOutputInterval(0);
+    accelerometer.propagate(gravity.size(), gravity.constData());
+    QCOMPARE(collector.samples.size(), 120);
+
+    delete filter;
+}
+
+void FilterApiTest::testEllipsoidCalibrator()
+{
+    // Field of radius 400 stretched along a rotated axis and offset
+    const double offset[3] = { 300, -120, 45 };
+    const double scale[3] = { 1.3, 0.8, 1.0 };
+    const double angle = 0.4;
+    EllipsoidCalibrator calibrator(500, 0);
+    QVector<QVector<double> > fields;
+    for (int i = 0; i < 500; ++i) {
+        // Points spread evenly over the sphere
+        double z = 1 - (2 * i + 1) / 500.0;
+        double r = sqrt(1 - z * z);
+        double phi = i * 2.39996;
+        double v[3] = { 400 * r * cos(phi) * scale[0], 400 * r * sin(phi) * scale[1], 400 * z * scale[2] };
+        double x = cos(angle) * v[0] - sin(angle) * v[1] + offset[0];
+        double y = sin(angle) * v[0] + cos(angle) * v[1] + offset[1];
+        calibrator.accumulate(qRound(x), qRound(y), qRound(v[2] + offset[2]));
+        fields.append(QVector<double>() << x << y << v[2] + offset[2]);
+    }
+
+    const MagCalibration* calibration = 0;
+    for (int i = 0; i < 100 && !calibration; ++i) {
+        QTest::qSleep(10);
+        calibration = calibrator.calibration();
+    }
+    QVERIFY(calibration);
+    QCOMPARE(calibration->level, 3);
+    for (int i = 0; i < 3; ++i)
+        QVERIFY(fabs(calibration->offset[i] - offset[i]) < 1);
+
+    // Calibrated field has the same magnitude in every orientation
+    double smallest = 1e9;
+    double largest = 0;
+    foreach (const QVector<double>& field, fields) {
+        double length = 0;
+        for (int i = 0; i < 3; ++i) {
+            double calibrated = 0;
+            for (int j = 0; j < 3; ++j)
+                calibrated += calibration->matrix[i][j] * (field[j] - calibration->offset[j]);
+            length += calibrated * calibrated;
+        }
+        smallest = qMin(smallest, sqrt(length));
+        largest = qMax(largest, sqrt(length));
+    }
+    QVERIFY(largest - smallest < 4);
+
+    calibrator.reset();
+    QVERIFY(!calibrator.calibration());
+}
+
+/**
+ * Collects calibrated magnetometer samples.
+ */
+class CalibratedFieldCollector
+{
+public:
+    CalibratedFieldCollector() : sink(this, &CalibratedFieldCollector::collect) {}
+
+    void collect(unsigned n, const CalibratedMagneticFieldData* values)
+    {
+        for (unsigned i = 0; i < n; ++i)
+            records.append(values[i]);
+    }
+
+    QVector<CalibratedMagneticFieldData> records;
+    Sink<CalibratedFieldCollector, CalibratedMagneticFieldData> sink;
+};
+
+void FilterApiTest::testHalCalibrationFilter()
+{
+    HalCalibrationFilter filter(300);
+    CalibratedFieldCollector calibrated;
+    CalibratedFieldCollector scaled;
+    Source<CalibratedMagneticFieldData> input;
+    QVERIFY(input.join(filter.sink("magsink")));
+    QVERIFY(filter.source("calibratedmagneticfield")->join(&calibrated.sink));
+    QVERIFY(filter.source("scaledmagneticfield")->join(&scaled.sink));
+
+    CalibratedMagneticFieldData sample(1000, 2, -4, 5, 2, -4, 5, 3);
+    input.propagate(1, &sample);
+
+    // HAL level and values are passed on as they are
+    QCOMPARE(calibrated.records.size(), 1);
+    QCOMPARE(calibrated.records.at(0).timestamp_, (quint64)1000);
+    QCOMPARE(calibrated.records.at(0).level_, 3);
+    QCOMPARE(calibrated.records.at(0).y_, -4);
+
+    QCOMPARE(scaled.records.size(), 1);
+    QCOMPARE(scaled.records.at(0).level_, 3);
+    QCOMPARE(scaled.records.at(0).x_, 600);
+    QCOMPARE(scaled.records.at(0).z_, 1500);
+}
+
+void FilterApiTest::testAttitudeFilter()
+{
+    AttitudeFilter* filter = static_cast<AttitudeFilter*>(AttitudeFilter::factoryMethod());
+    HeadingCollector heading;
+    XyzCollector gravity;
+    XyzCollector rotation;
+    Source<TimedXyzData> gyroscope;
+    Source<AccelerationData> accelerometer;
+    Source<CalibratedMagneticFieldData> magnetometer;
+    QVERIFY(gyroscope.join(filter->sink("gyroscopesink")));
+    QVERIFY(accelerometer.join(filter->sink("accelerometersink")));
+    QVERIFY(magnetometer.join(filter->sink("magnetometersink")));
+    QVERIFY(filter->source("compass")->join(&heading.sink));
+    QVERIFY(filter->source("gravity")->join(&gravity.sink));
+    QVERIFY(filter->source("rotation")->join(&rotation.sink));
+
+    // Face up with the top edge towards west, field inclined downwards.
+    // Without gyroscope samples attitude follows the accelerometer.
+    CalibratedMagneticFieldData field(0, 200, 0, -350, 200, 0, -350, 3);
+    magnetometer.propagate(1, &field);
+    AccelerationData flat(0, 0, 0, -1000);
+    accelerometer.propagate(1, &flat);
+    QCOMPARE(heading.degrees.last(), 270);
+    QCOMPARE(gravity.samples.last().z_, -1000);
+    QCOMPARE(rotation.samples.last().z_, -90);
+
+    // Quarter turn counterclockwise in a second, without feedback
+    filter->setGains(0, 0);
+    QVector<TimedXyzData> rates;
+    for (int i = 0; i <= 100; ++i)
+        rates.append(TimedXyzData(i * 10000, 0, 0, 90000));
+    gyroscope.propagate(rates.size(), rates.constData());
+    QCOMPARE(heading.degrees.size(), 102);
+    QVERIFY(qAbs(heading.degrees.last() - 180) <= 1);
+    QCOMPARE(gravity.samples.last().z_, -1000);
+
+    delete filter;
+}
+
+void FilterApiTest::testSlidingVariance()
+{
+    // Large offset would cancel out in sums of squares
+    const double offset = 1e8;
+    SlidingVariance<4> window;
+    QVERIFY(!window.add(offset + 1));
+    QVERIFY(!window.add(offset + 2));
+    QVERIFY(!window.add(offset + 3));
+    QVERIFY(!window.add(offset + 4));
+
+    double values[4] = { 1, 2, 3, 4 };
+    for (int i = 0; i < 1000; ++i) {
+        double value = (i * 7919) % 13;
+        values[i % 4] = value;
+        QVERIFY(window.add(offset + value));
+
+        double mean = (values[0] + values[1] + values[2] + values[3]) / 4;
+        double variance = 0;
+        for (int j = 0; j < 4; ++j)
+            variance += (values[j] - mean) * (values[j] - mean);
+        variance /= 3;
+        QVERIFY(qAbs(window.average() - offset - mean) < 1e-6);
+        QVERIFY(qAbs(window.variance() - variance) < 1e-6);
+    }
+
+    window.reset();
+    QVERIFY(!window.add(5));
+    QCOMPARE(window.average(), 5.0);
+    QCOMPARE(window.variance(), 0.0);
+}
+
+class ProximityCollector
+{
+public:
+    ProximityCollector() : sink(this, &ProximityCollector::collect) {}
+
+    void collect(unsigned n, const ProximityData* values)
+    {
+        for (unsigned i = 0; i < n; ++i)
+            samples.append(values[i]);
+    }
+
+    QVector<ProximityData> samples;
+    Sink<ProximityCollector, ProximityData> sink;
+};
+
+void FilterApiTest::testChangeFilter()
+{
+    ChangeFilter<ProximityData> filter(2);
+    ProximityCollector collector;
+    Source<ProximityData> source;
+    QVERIFY(source.join(filter.sink("sink")));
+    QVERIFY(filter.source("source")->join(&collector.sink));
+
+    // Drift within tolerance is held back until it adds up
+    ProximityData input[] = {
+        ProximityData(1, 10, false),
+        ProximityData(2, 10, false),
+        ProximityData(3, 11, false),
+        ProximityData(4, 12, false),
+        ProximityData(5, 13, false),
+        ProximityData(6, 13, true),
+        ProximityData(7, 13, true)
+    };
+    source.propagate(sizeof(input) / sizeof(input[0]), input);
+    QCOMPARE(collector.samples.size(), 3);
+    QCOMPARE(collector.samples[0].timestamp_, (quint64)1);
+    QCOMPARE(collector.samples[1].timestamp_, (quint64)5);
+    QCOMPARE(collector.samples[2].timestamp_, (quint64)6);
+
+    // First sample after reset is always passed
+    filter.reset();
+    source.propagate(1, &input[6]);
+    QCOMPARE(collector.samples.size(), 4);
+}
+
 QTEST_MAIN(FilterApiTest)
@@ -36,6 +36,7 @@
 #include "source.h"
 #include "orientationdata.h"
 #include "posedata.h"
+#include "fusiondata.h"
 
 class FilterApiTest : public QObject
 {
@@ -45,12 +46,29 @@ private slots:
     void initTestCase();
     void init() {}
 
+    void testCoordinateAlignFilter_data();
     void testCoordinateAlignFilter();
+    void testXyzTransformKernel();
+    void testXyzLanes();
+    void testLowPassKernels();
     void testTopEdgeInterpretationFilter();
     void testFaceInterpretationFilter();
     void testDeclinationFilter();
     void testOrientationInterpretationFilter();
     void testRotationFilter();
+    void testSyncFilter_data();
+    void testSyncFilter();
+    void testStatisticsFilter();
+    void testRotationDeltaFilter();
+    void testCompassFilterTrigFree();
+    void testCompassFilterOutputInterval();
+    void testRotationFilterKernel();
+    void testRotationFilterOutputInterval();
+    void testEllipsoidCalibrator();
+    void testHalCalibrationFilter();
+    void testAttitudeFilter();
+    void testSlidingVariance();
+    void testChangeFilter();
 
     void cleanup() {}
     void cleanupTestCase() {}
@@ -59,7 +77,7 @@ private slots:
 /**
  * DummyAdaptor is a Pusher that can be used to push data into a filter for testing.
  * Input data is given as an array. Calling \c pushNewData() will propagate the next
- * value in the array into adaptor output.
+ * value, or next \c count values as a single batch, in the array into adaptor output.
  *
  * @todo For some reason we can only feed in 10 samples.. Anything beyond that will
  *       get compared to wrong expected output..
@@ -78,16 +96,16 @@ public:
         index_ = 0;
     }
 
-    void pushNewData() {
-        if (index_ >= datacount_) {
+    void pushNewData(int count = 1) {
+        if (index_ + count > datacount_) {
             QVERIFY2(false, "Test function error: out of input data.");
             index_ = 0;
         }
 
-        source_.propagate(1, &(data_[index_]));
+        source_.propagate(count, &(data_[index_]));
 
-        ++index_;
-        ++counter_;
+        index_ += count;
+        counter_ += count;
     }
 
     int getDataCount() { return counter_; }
@@ -161,6 +179,16 @@ public:
             QCOMPARE(d1->degrees_, d2->degrees_);
             QCOMPARE(d1->level_, d2->level_);
 
+        } else if (typeid(TYPE) == typeid(FusionData)) {
+            FusionData *d1 = (FusionData *)&data;
+            FusionData *d2 = (FusionData *)&(data_[i]);
+            QCOMPARE(d1->timestamp_, d2->timestamp_);
+            for (int j = 0; j < 3; ++j) {
+                QCOMPARE(d1->accelerometer_[j], d2->accelerometer_[j]);
+                QCOMPARE(d1->gyroscope_[j], d2->gyroscope_[j]);
+                QCOMPARE(d1->magnetometer_[j], d2->magnetometer_[j]);
+            }
+
         } else {
             QWARN("No comparison method for this type");
         }
@@ -0,0 +1,30 @@
+QT += testlib \
+      dbus \
+      network
+QT -= gui
+
+include(../../common-install.pri)
+include(../../benchmark/benchmarkresults.pri)
+
+TEMPLATE = app
+TARGET = sensorpower-benchmark
+HEADERS += powerbenchmarks.h
+SOURCES += powerbenchmarks.cpp
+
+SENSORFW_INCLUDEPATHS = ../../../qt-api \
+                        ../../../include \
+                        ../../../datatypes \
+                        ../../..
+
+DEPENDPATH += $$SENSORFW_INCLUDEPATHS
+INCLUDEPATH += $$SENSORFW_INCLUDEPATHS
+
+QMAKE_LIBDIR_FLAGS += -L../../../qt-api  \
+                      -L../../../datatypes
+
+equals(QT_MAJOR_VERSION, 4):{
+    QMAKE_LIBDIR_FLAGS += -lsensordatatypes -lsensorclient
+}
+equals(QT_MAJOR_VERSION, 5):{
+    QMAKE_LIBDIR_FLAGS += -lsensordatatypes-qt5 -lsensorclient-qt5
+}
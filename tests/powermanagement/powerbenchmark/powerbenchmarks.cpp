@@ -0,0 +1,286 @@
+/**
+   @file powerbenchmarks.cpp
+   @brief Sensord wakeup and power benchmarks
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+*/
+
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QProcess>
+#include <QStringList>
+#include <linux/perf_event.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "sensormanagerinterface.h"
+#include "accelerometersensor_i.h"
+#include "alssensor_i.h"
+#include "compasssensor_i.h"
+#include "gyroscopesensor_i.h"
+#include "powerbenchmarks.h"
+#include "benchmarkresults.h"
+
+#define BLANK_SCREEN QProcess::execute("mcetool --blank-screen");
+#define UNBLANK_SCREEN QProcess::execute("mcetool --unblank-screen");
+
+/** Milliseconds sessions run before counting starts */
+static const int SETTLE_MS = 2000;
+
+/** Default length of a run in seconds */
+static const int DEFAULT_RUN_SECONDS = 10;
+
+/** Tracepoint id files of raw_syscalls:sys_enter, tracefs and debugfs */
+static const char* const SYSCALL_TRACEPOINT[] = {
+    "/sys/kernel/tracing/events/raw_syscalls/sys_enter/id",
+    "/sys/kernel/debug/tracing/events/raw_syscalls/sys_enter/id"
+};
+
+static int syscallTracepoint()
+{
+    for (unsigned i = 0; i < sizeof(SYSCALL_TRACEPOINT) / sizeof(SYSCALL_TRACEPOINT[0]); ++i) {
+        QFile file(SYSCALL_TRACEPOINT[i]);
+        if (file.open(QIODevice::ReadOnly))
+            return file.readAll().trimmed().toInt();
+    }
+    return -1;
+}
+
+ProcessMonitor::ProcessMonitor(int pid) :
+    pid_(pid)
+{
+    int tracepoint = syscallTracepoint();
+    if (tracepoint < 0)
+        return;
+
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_TRACEPOINT;
+    attr.size = sizeof(attr);
+    attr.config = tracepoint;
+    attr.inherit = 1;
+    foreach (int tid, threads()) {
+        int fd = syscall(__NR_perf_event_open, &attr, tid, -1, -1, 0);
+        if (fd < 0) {
+            qDebug("Can not count syscalls of thread %d: %s", tid, strerror(errno));
+            foreach (int counter, counters_)
+                close(counter);
+            counters_.clear();
+            return;
+        }
+        counters_.append(fd);
+    }
+}
+
+ProcessMonitor::~ProcessMonitor()
+{
+    foreach (int counter, counters_)
+        close(counter);
+}
+
+QList<int> ProcessMonitor::threads() const
+{
+    QList<int> tids;
+    foreach (const QString& name, QDir(QString("/proc/%1/task").arg(pid_)).entryList(QDir::Dirs | QDir::NoDotAndDotDot))
+        tids.append(name.toInt());
+    return tids;
+}
+
+ProcessCounters ProcessMonitor::read() const
+{
+    ProcessCounters counters;
+    foreach (int tid, threads()) {
+        QFile file(QString("/proc/%1/task/%2/sched").arg(pid_).arg(tid));
+        if (!file.open(QIODevice::ReadOnly))
+            continue;
+        // Lines are "name : value", runtime is in milliseconds
+        foreach (const QByteArray& line, file.readAll().split('\n')) {
+            int colon = line.indexOf(':');
+            if (colon < 0)
+                continue;
+            QByteArray name = line.left(colon).trimmed();
+            QByteArray value = line.mid(colon + 1).trimmed();
+            qint64* counter = 0;
+            qint64 amount = 0;
+            if (name == "nr_wakeups") {
+                counter = &counters.wakeups;
+                amount = value.toLongLong();
+            } else if (name == "nr_switches") {
+                counter = &counters.switches;
+                amount = value.toLongLong();
+            } else if (name == "se.sum_exec_runtime") {
+                counter = &counters.cpuNs;
+                amount = (qint64)(value.toDouble() * 1000000);
+            }
+            if (counter)
+                *counter = qMax(*counter, (qint64)0) + amount;
+        }
+    }
+
+    if (!counters_.isEmpty()) {
+        counters.syscalls = 0;
+        foreach (int counter, counters_) {
+            quint64 value = 0;
+            if (::read(counter, &value, sizeof(value)) == (ssize_t)sizeof(value))
+                counters.syscalls += value;
+        }
+    }
+    return counters;
+}
+
+/**
+ * Counter growth per second.
+ *
+ * @param before counter at start, -1 if not available.
+ * @param after counter at end.
+ * @param seconds run length.
+ * @param scale divisor of the counter unit.
+ * @return rate or -1 if not available.
+ */
+static double rate(qint64 before, qint64 after, double seconds, double scale = 1)
+{
+    if (before < 0 || after < 0)
+        return -1;
+    return (after - before) / scale / seconds;
+}
+
+static QString formatRate(double value, const char* unit)
+{
+    if (value < 0)
+        return QString("n/a %1").arg(unit);
+    return QString("%1 %2").arg(value, 0, 'f', 1).arg(unit);
+}
+
+/**
+ * Record rate if available.
+ */
+static void recordRate(const QString& name, const char* metric, const char* unit, double value)
+{
+    if (value >= 0)
+        BenchmarkResults::record(name, metric, unit, value, BenchmarkResults::LowerIsBetter);
+}
+
+void PowerBenchmark::initTestCase()
+{
+    SensorManagerInterface& sm = SensorManagerInterface::instance();
+    QVERIFY(sm.isValid());
+
+    pid_ = BenchmarkResults::sensordProcessId();
+    QVERIFY2(pid_ > 0, "sensord is not running");
+
+    sm.loadPlugin("accelerometersensor");
+    sm.loadPlugin("alssensor");
+    sm.loadPlugin("compasssensor");
+    sm.loadPlugin("gyroscopesensor");
+
+    sm.registerSensorInterface<AccelerometerSensorChannelInterface>("accelerometersensor");
+    sm.registerSensorInterface<ALSSensorChannelInterface>("alssensor");
+    sm.registerSensorInterface<CompassSensorChannelInterface>("compasssensor");
+    sm.registerSensorInterface<GyroscopeSensorChannelInterface>("gyroscopesensor");
+}
+
+void PowerBenchmark::cleanupTestCase()
+{
+    BenchmarkResults::write("sensorpower-benchmark");
+}
+
+void PowerBenchmark::benchmarkScenario_data()
+{
+    QTest::addColumn<QStringList>("sensors");
+    QTest::addColumn<int>("interval");
+    QTest::addColumn<bool>("standbyOverride");
+    QTest::addColumn<bool>("screenOff");
+
+    // Idle sensord is the reference the other scenarios are compared to
+    QTest::newRow("idle") << QStringList() << 0 << false << false;
+    QTest::newRow("screen off override") << (QStringList() << "accelerometersensor") << 0 << true << true;
+    QTest::newRow("als") << (QStringList() << "alssensor") << 0 << false << false;
+    QTest::newRow("compass") << (QStringList() << "compasssensor") << 0 << false << false;
+    QTest::newRow("game 200 Hz") << (QStringList() << "accelerometersensor" << "gyroscopesensor") << 5 << false << false;
+}
+
+void PowerBenchmark::benchmarkScenario()
+{
+    QFETCH(QStringList, sensors);
+    QFETCH(int, interval);
+    QFETCH(bool, standbyOverride);
+    QFETCH(bool, screenOff);
+
+    int runSeconds = qgetenv("SENSORFW_POWER_SECONDS").toInt();
+    if (runSeconds <= 0)
+        runSeconds = DEFAULT_RUN_SECONDS;
+
+    QList<AbstractSensorChannelInterface*> sessions;
+    foreach (const QString& name, sensors) {
+        AbstractSensorChannelInterface* sensor = SensorManagerInterface::instance().interface(name);
+        if (!sensor || !sensor->isValid()) {
+            delete sensor;
+            qDeleteAll(sessions);
+            qDebug() << name << "not available, skipped";
+            return;
+        }
+        if (interval)
+            sensor->setInterval(interval);
+        sensor->setStandbyOverride(standbyOverride);
+        sensor->start();
+        sessions.append(sensor);
+    }
+    if (screenOff)
+        BLANK_SCREEN;
+    QTest::qWait(SETTLE_MS);
+
+    ProcessMonitor monitor(pid_);
+    QElapsedTimer timer;
+    timer.start();
+    ProcessCounters before = monitor.read();
+    QTest::qWait(runSeconds * 1000);
+    ProcessCounters after = monitor.read();
+    double seconds = timer.elapsed() / 1000.0;
+
+    if (screenOff)
+        UNBLANK_SCREEN;
+    foreach (AbstractSensorChannelInterface* sensor, sessions)
+        sensor->stop();
+    qDeleteAll(sessions);
+
+    double wakeups = rate(before.wakeups, after.wakeups, seconds);
+    double switches = rate(before.switches, after.switches, seconds);
+    double cpu = rate(before.cpuNs, after.cpuNs, seconds, 1000000);
+    double syscalls = rate(before.syscalls, after.syscalls, seconds);
+
+    QString name(QTest::currentDataTag());
+    recordRate(name, "wakeups", "wakeups/s", wakeups);
+    recordRate(name, "context switches", "switches/s", switches);
+    recordRate(name, "cpu", "ms/s", cpu);
+    recordRate(name, "syscalls", "syscalls/s", syscalls);
+    long rss = BenchmarkResults::residentKb(pid_);
+    if (rss >= 0)
+        BenchmarkResults::record(name, "rss", "kB", rss, BenchmarkResults::LowerIsBetter);
+
+    qDebug("%s, %s, %s, %s",
+           qPrintable(formatRate(wakeups, "wakeups/s")),
+           qPrintable(formatRate(switches, "switches/s")),
+           qPrintable(formatRate(cpu, "ms cpu/s")),
+           qPrintable(formatRate(syscalls, "syscalls/s")));
+}
+
+QTEST_MAIN(PowerBenchmark)
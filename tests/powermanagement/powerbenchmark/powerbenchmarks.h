@@ -0,0 +1,112 @@
+/**
+   @file powerbenchmarks.h
+   @brief Sensord wakeup and power benchmarks
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+*/
+
+
+#ifndef POWERBENCHMARKS_H
+#define POWERBENCHMARKS_H
+
+#include <QTest>
+#include <QList>
+
+/**
+ * Cumulative counters of a process, summed over its threads. Counters
+ * which the kernel does not offer are -1.
+ */
+struct ProcessCounters
+{
+    ProcessCounters() : wakeups(-1), switches(-1), cpuNs(-1), syscalls(-1) {}
+
+    qint64 wakeups;  /**< nr_wakeups of /proc/<pid>/task/<tid>/sched, needs schedstats */
+    qint64 switches; /**< nr_switches of /proc/<pid>/task/<tid>/sched */
+    qint64 cpuNs;    /**< se.sum_exec_runtime of /proc/<pid>/task/<tid>/sched */
+    qint64 syscalls; /**< raw_syscalls:sys_enter perf tracepoint count */
+};
+
+/**
+ * Reads scheduler statistics and perf counters of a running process.
+ * Perf counters are opened for the threads existing at construction and
+ * inherited by threads they create.
+ */
+class ProcessMonitor
+{
+public:
+    /**
+     * Constructor. Opens the syscall counters.
+     *
+     * @param pid monitored process.
+     */
+    ProcessMonitor(int pid);
+
+    /**
+     * Destructor. Closes the counters.
+     */
+    ~ProcessMonitor();
+
+    /**
+     * Read the counters of the process.
+     *
+     * @return counters.
+     */
+    ProcessCounters read() const;
+
+private:
+    Q_DISABLE_COPY(ProcessMonitor)
+
+    /**
+     * Threads of the process.
+     *
+     * @return thread IDs.
+     */
+    QList<int> threads() const;
+
+    int        pid_;      /**< monitored process */
+    QList<int> counters_; /**< perf counter per thread */
+};
+
+/**
+ * Cost of sensord in standard usage scenarios, for catching power
+ * regressions of the delivery path. Each scenario opens its sessions,
+ * lets sensord settle and counts wakeups, context switches, CPU time and
+ * syscalls of the sensord process over the run:
+ *
+ * <pre>QDEBUG : PowerBenchmark::benchmarkScenario(compass) 41.2 wakeups/s, 43.0 switches/s, 3.1 ms cpu/s, 612.4 syscalls/s</pre>
+ *
+ * Results are also written as JSON, see BenchmarkResults.
+ * SENSORFW_POWER_SECONDS sets the run length, 10 s by default. Syscalls
+ * are counted only when perf tracepoints are accessible, as root or with
+ * a permissive perf_event_paranoid.
+ */
+class PowerBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void benchmarkScenario_data();
+    void benchmarkScenario();
+
+private:
+    int pid_; /**< sensord process */
+};
+
+#endif // POWERBENCHMARKS_H
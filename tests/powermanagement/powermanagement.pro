@@ -1,2 +1,2 @@
 TEMPLATE = subdirs
-SUBDIRS = powermanagementtests driverpolltest standbyoverridetests
+SUBDIRS = powermanagementtests driverpolltest standbyoverridetests powerbenchmark